@@ -39,7 +39,10 @@
 /// header file that is included in multiple places. Note that Hookshot might fail to create the
 /// requested hook. Therefore, the return code from `SetHook` should be checked. Once `SetHook` has
 /// been invoked successfully, further invocations have no effect and simply return
-/// `EResult::NoEffect`.
+/// `EResult::NoEffect`. For methods of COM interfaces and other objects with virtual function
+/// tables, `SetVirtualTableHook` can be invoked instead, with the virtual function table and the
+/// index of the method's entry. That rewrites the entry rather than the method's code, and
+/// `Original` then invokes the original method directly. See #IHookshot::CreateVirtualTableHooks.
 #define HOOKSHOT_DYNAMIC_HOOK_FROM_FUNCTION(func)                                                  \
   namespace _HookshotInternal                                                                      \
   {                                                                                                \
@@ -177,7 +180,8 @@ namespace Hookshot
     typedef ReturnType callingConvention TFunction(ArgumentTypes...);                              \
     typedef ReturnType(callingConvention* TFunctionPtr)(ArgumentTypes...);                         \
     static ReturnType callingConvention Hook(ArgumentTypes...);                                    \
-    static ReturnType callingConvention Original(ArgumentTypes... args)                            \
+    static HOOKSHOT_ORIGINAL_FUNCTION_SPECIFIERS ReturnType callingConvention Original(           \
+        ArgumentTypes... args)                                                                     \
     {                                                                                              \
       return ((ReturnType(callingConvention*)(                                                     \
           ArgumentTypes...))DynamicHookBase<kOriginalFunctionName>::GetOriginalFunction())(        \
@@ -194,15 +198,21 @@ namespace Hookshot
       return DynamicHookBase<kOriginalFunctionName>::SetHook(hookshot, originalFunc, &Hook);       \
     }                                                                                              \
                                                                                                    \
+    static EResult SetVirtualTableHook(                                                            \
+        IHookshot* const hookshot, void* const virtualTable, const size_t slotIndex)               \
+    {                                                                                              \
+      return DynamicHookBase<kOriginalFunctionName>::SetVirtualTableHook(                          \
+          hookshot, virtualTable, slotIndex, &Hook);                                               \
+    }                                                                                              \
+                                                                                                   \
     static EResult DisableHook(IHookshot* const hookshot)                                          \
     {                                                                                              \
-      return hookshot->DisableHookFunction(&Hook);                                                 \
+      return DynamicHookBase<kOriginalFunctionName>::DisableHookFunction(hookshot, &Hook);         \
     }                                                                                              \
                                                                                                    \
     static EResult EnableHook(IHookshot* const hookshot)                                           \
     {                                                                                              \
-      return hookshot->ReplaceHookFunction(                                                        \
-          DynamicHookBase<kOriginalFunctionName>::GetOriginalFunctionAddress(), &Hook);            \
+      return DynamicHookBase<kOriginalFunctionName>::EnableHookFunction(hookshot, &Hook);          \
     }                                                                                              \
                                                                                                    \
     static const wchar_t* GetFunctionName(void)                                                    \
@@ -225,6 +235,16 @@ namespace Hookshot
 
     inline static const void* originalFunction = nullptr;
     inline static const void* originalFunctionAddress = nullptr;
+    inline static HookHandle hookHandle = kInvalidHookHandle;
+
+    /// Retrieves the interface through which the hook can be identified by its handle.
+    /// @param [in] hookshot Interface pointer through which all Hookshot functionality is accessed.
+    /// @return Interface pointer, or `nullptr` if the hook has no handle.
+    static inline IHookshot11* HookHandleInterface(IHookshot* const hookshot)
+    {
+      if (kInvalidHookHandle == hookHandle) return nullptr;
+      return reinterpret_cast<IHookshot11*>(hookshot->QueryInterface(kInterfaceVersion11));
+    }
 
   public:
 
@@ -254,6 +274,24 @@ namespace Hookshot
     {
       if (true == IsHookSet()) return EResult::NoEffect;
 
+      // Where available, the original function address is obtained along with creating the hook.
+      IHookshot10* const hookshot10 =
+          reinterpret_cast<IHookshot10*>(hookshot->QueryInterface(kInterfaceVersion10));
+      if (nullptr != hookshot10)
+      {
+        const void* createdOriginalFunction = nullptr;
+        const EResult result =
+            hookshot10->CreateHookEx(originalFunc, hookFunc, &createdOriginalFunction, &hookHandle);
+
+        if (SuccessfulResult(result))
+        {
+          originalFunction = createdOriginalFunction;
+          originalFunctionAddress = originalFunc;
+        }
+
+        return result;
+      }
+
       const EResult result = hookshot->CreateHook(originalFunc, hookFunc);
 
       if (SuccessfulResult(result))
@@ -264,6 +302,40 @@ namespace Hookshot
 
       return result;
     }
+
+    static inline EResult DisableHookFunction(IHookshot* const hookshot, const void* hookFunc)
+    {
+      IHookshot11* const hookshot11 = HookHandleInterface(hookshot);
+      if (nullptr != hookshot11) return hookshot11->DisableHookFunctionByHandle(hookHandle);
+
+      return hookshot->DisableHookFunction(hookFunc);
+    }
+
+    static inline EResult EnableHookFunction(IHookshot* const hookshot, const void* hookFunc)
+    {
+      IHookshot11* const hookshot11 = HookHandleInterface(hookshot);
+      if (nullptr != hookshot11)
+        return hookshot11->ReplaceHookFunctionByHandle(hookHandle, hookFunc);
+
+      return hookshot->ReplaceHookFunction(originalFunctionAddress, hookFunc);
+    }
+
+    static inline EResult SetVirtualTableHook(
+        IHookshot* const hookshot, void* virtualTable, size_t slotIndex, const void* hookFunc)
+    {
+      if (true == IsHookSet()) return EResult::NoEffect;
+
+      const EResult result =
+          hookshot->CreateVirtualTableHooks(virtualTable, &slotIndex, &hookFunc, 1, nullptr);
+
+      if (SuccessfulResult(result))
+      {
+        originalFunction = hookshot->GetOriginalFunction(hookFunc);
+        originalFunctionAddress = originalFunction;
+      }
+
+      return result;
+    }
   };
 
   /// Primary dynamic hook template. Specialized using #HOOKSHOT_DYNAMIC_HOOK_TEMPLATE.
@@ -0,0 +1,36 @@
+/***************************************************************************************************
+ * Hookshot
+ *   General-purpose library for injecting DLLs and hooking function calls.
+ ***************************************************************************************************
+ * Authored by Samuel Grossman
+ * Copyright (c) 2019-2025
+ ***********************************************************************************************//**
+ * @file HookContext.h
+ *   Helper for reading the context value passed by context hooks to their hook functions.
+ *   External users should include Hookshot.h instead of this file.
+ **************************************************************************************************/
+
+#pragma once
+
+#include <cstddef>
+#include <intrin.h>
+
+namespace Hookshot
+{
+  /// Reads the context value of the context hook that most recently transferred control to a hook
+  /// function on the calling thread. Must be invoked by the hook function before it invokes any
+  /// other function, because any context hook reached in the meantime replaces the value. The
+  /// value is accessed directly in the thread environment block, so this does not invoke any
+  /// functions either.
+  /// @param [in] contextOffset Offset of the context value within the thread environment block, as
+  /// returned by IHookshot::GetHookContextOffset, which must not be 0.
+  /// @return Context value supplied when the context hook was created.
+  inline void* ReadHookContext(size_t contextOffset)
+  {
+#ifdef _WIN64
+    return reinterpret_cast<void*>(__readgsqword(static_cast<unsigned long>(contextOffset)));
+#else
+    return reinterpret_cast<void*>(__readfsdword(static_cast<unsigned long>(contextOffset)));
+#endif
+  }
+} // namespace Hookshot
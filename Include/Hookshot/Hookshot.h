@@ -11,5 +11,7 @@
 
 #pragma once
 
+#include "HookContext.h"
 #include "HookshotFunctions.h"
 #include "HookshotTypes.h"
+#include "ReentrancyGuard.h"
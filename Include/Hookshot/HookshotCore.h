@@ -0,0 +1,230 @@
+/***************************************************************************************************
+ * Hookshot
+ *   General-purpose library for injecting DLLs and hooking function calls.
+ ***************************************************************************************************
+ * Authored by Samuel Grossman
+ * Copyright (c) 2019-2025
+ ***********************************************************************************************//**
+ * @file HookshotCore.h
+ *   Function prototypes for the direct interface to Hookshot's static core library. External users
+ *   that link with the static core library should include this file instead of Hookshot.h.
+ **************************************************************************************************/
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+#include "HookContext.h"
+#include "HookshotTypes.h"
+#include "ReentrancyGuard.h"
+
+// Applications that only hook their own functions can link with the static core library
+// (HookshotStatic), which becomes part of the application's own binary. It is the same as the core
+// library (HookshotCore) but is accessed by calling the functions declared in this file directly,
+// rather than by loading a DLL and calling virtual methods of an interface object. Calls are
+// therefore eligible for inlining when the application is built with link-time code generation.
+
+namespace Hookshot
+{
+  namespace Core
+  {
+    /// Initializes the static core library. Must be invoked once, before any of the other functions
+    /// in this namespace. If invoked multiple times, fails beginning with the second invocation.
+    /// @return `true` on success, `false` on failure.
+    bool Initialize(void);
+
+    /// Retrieves the Hookshot interface object, for functionality that is not offered directly by
+    /// this namespace. Calls made through it are virtual, just as with the other libraries.
+    /// @return Hookshot interface pointer.
+    IHookshot* GetInterface(void);
+
+    /// Performs the per-thread setup that a DLL performs when notified that a thread was created.
+    /// The static core library receives no such notifications, so applications that use debug
+    /// register hooks or call tracing should invoke this function at the start of each thread they
+    /// create after initializing the library.
+    void AttachCurrentThread(void);
+
+    /// Performs the per-thread cleanup that a DLL performs when notified that a thread is exiting.
+    /// Applications that invoke #AttachCurrentThread should invoke this function at the end of
+    /// each such thread.
+    void DetachCurrentThread(void);
+
+    /// Direct version of #IHookshot::CreateHook.
+    EResult CreateHook(void* originalFunc, const void* hookFunc);
+
+    /// Direct version of #IHookshot::CreateHooks.
+    EResult CreateHooks(const SHookSpec* hookSpecs, size_t numHookSpecs, EResult* results);
+
+    /// Direct version of #IHookshot::CreateHooksByExportName.
+    EResult CreateHooksByExportName(
+        void* moduleHandle,
+        const char* const* exportNames,
+        const void* const* hookFuncs,
+        size_t numHooks,
+        EResult* results);
+
+    /// Direct version of #IHookshot::DisableHookFunction.
+    EResult DisableHookFunction(const void* originalOrHookFunc);
+
+    /// Direct version of #IHookshot::GetOriginalFunction.
+    const void* GetOriginalFunction(const void* originalOrHookFunc);
+
+    /// Direct version of #IHookshot::ReplaceHookFunction.
+    EResult ReplaceHookFunction(const void* originalOrHookFunc, const void* newHookFunc);
+
+    /// Direct version of #IHookshot::RemoveHook.
+    EResult RemoveHook(const void* originalOrHookFunc);
+
+    /// Direct version of #IHookshot::BeginTransaction.
+    EResult BeginTransaction(void);
+
+    /// Direct version of #IHookshot::CommitTransaction.
+    EResult CommitTransaction(void);
+
+    /// Direct version of #IHookshot::GetHookStatistics.
+    EResult GetHookStatistics(const void* originalOrHookFunc, SHookStatistics* statistics);
+
+    /// Direct version of #IHookshot::SetHookGroup.
+    EResult SetHookGroup(const void* originalOrHookFunc, uint32_t groupId);
+
+    /// Direct version of #IHookshot::SetHookGroupEnabled.
+    EResult SetHookGroupEnabled(uint32_t groupId, bool enabled);
+
+    /// Direct version of #IHookshot::CreateCallbackHook.
+    EResult CreateCallbackHook(
+        void* originalFunc,
+        TCallbackHookPre preCallback,
+        TCallbackHookPost postCallback,
+        void* context);
+
+    /// Direct version of #IHookshot::CreateContextHook.
+    EResult CreateContextHook(void* originalFunc, const void* hookFunc, void* context);
+
+    /// Direct version of #IHookshot::GetHookContextOffset.
+    size_t GetHookContextOffset(void);
+
+    /// Direct version of #IHookshot::CreateProbe.
+    EResult CreateProbe(void* address, TProbeCallback callback, void* context);
+
+    /// Direct version of #IHookshot::FindPatterns.
+    EResult FindPatterns(
+        void* moduleHandle, const SBytePattern* patterns, size_t numPatterns, void** results);
+
+    /// Direct version of #IHookshot::CreateHotSwapHook.
+    EResult CreateHotSwapHook(void* originalFunc, const void* hookFunc, SHotSwapSlot** slot);
+
+    /// Direct version of #IHookshot::HotSwapHookFunction.
+    EResult HotSwapHookFunction(SHotSwapSlot* slot, const void* newHookFunc);
+
+    /// Direct version of #IHookshot::SetThreadHookOverride.
+    EResult SetThreadHookOverride(const void* originalOrHookFunc, const void* overrideFunc);
+
+    /// Direct version of #IHookshot::SetHookLatencyBudget.
+    EResult SetHookLatencyBudget(const void* originalOrHookFunc, uint32_t budgetMicroseconds);
+
+    /// Direct version of #IHookshot::GetMemoryFootprint.
+    EResult GetMemoryFootprint(SMemoryFootprint* footprint);
+
+    /// Direct version of #IHookshot::GetTrampolineStoreFootprints.
+    EResult GetTrampolineStoreFootprints(
+        STrampolineStoreFootprint* storeFootprints, size_t maxStoreFootprints, size_t* numStores);
+
+    /// Direct version of #IHookshot::GetModuleFootprints.
+    EResult GetModuleFootprints(
+        SModuleFootprint* moduleFootprints, size_t maxModuleFootprints, size_t* numModules);
+
+    /// Direct version of #IHookshot2::GetOriginalFunctions.
+    EResult GetOriginalFunctions(
+        const void* const* originalOrHookFuncs, size_t numFuncs, const void** originalFuncs);
+
+    /// Direct version of #IHookshot2::ReplaceHookFunctions.
+    EResult ReplaceHookFunctions(
+        const void* const* originalOrHookFuncs,
+        const void* const* newHookFuncs,
+        size_t numFuncs,
+        EResult* results);
+
+    /// Direct version of #IHookshot2::DisableHookFunctions.
+    EResult DisableHookFunctions(
+        const void* const* originalOrHookFuncs, size_t numFuncs, EResult* results);
+
+    /// Direct version of #IHookshot2::GetHooksStatistics.
+    EResult GetHooksStatistics(
+        const void* const* originalOrHookFuncs,
+        size_t numFuncs,
+        SHookStatistics* statistics,
+        EResult* results);
+
+    /// Direct version of #IHookshot2::RemoveHooks.
+    EResult RemoveHooks(const void* const* originalOrHookFuncs, size_t numFuncs, EResult* results);
+
+    /// Direct version of #IHookshot3::GetHookCallerHistogram.
+    EResult GetHookCallerHistogram(const void* originalOrHookFunc, SHookCallerHistogram* histogram);
+
+    /// Direct version of #IHookshot4::InstrumentModuleExports.
+    EResult InstrumentModuleExports(
+        void* moduleHandle, const SModuleInstrumentationOptions* options, size_t* numInstrumented);
+
+    /// Direct version of #IHookshot5::CreateHookAuto.
+    EResult CreateHookAuto(void* originalFunc, const void* hookFunc, EHookKind* chosenKind);
+
+    /// Direct version of #IHookshot6::Seal.
+    EResult Seal(void);
+
+    /// Direct version of #IHookshot7::CreateOneShotHook.
+    EResult CreateOneShotHook(void* originalFunc, const void* hookFunc);
+
+    /// Direct version of #IHookshot8::InvalidateCodeRange.
+    EResult InvalidateCodeRange(const void* rangeBase, size_t rangeSizeBytes);
+
+    /// Direct version of #IHookshot9::RelocateCode.
+    EResult RelocateCode(
+        const void* src,
+        size_t minBytes,
+        void* dst,
+        size_t dstCapacity,
+        uint32_t options,
+        SRelocatedCode* relocated);
+
+    /// Direct version of #IHookshot10::CreateHookEx.
+    EResult CreateHookEx(
+        void* originalFunc,
+        const void* hookFunc,
+        const void** originalFuncOut,
+        HookHandle* handleOut);
+
+    /// Direct version of #IHookshot11::GetHookHandle.
+    EResult GetHookHandle(const void* originalOrHookFunc, HookHandle* handle);
+
+    /// Direct version of #IHookshot11::ReplaceHookFunctionByHandle.
+    EResult ReplaceHookFunctionByHandle(HookHandle handle, const void* newHookFunc);
+
+    /// Direct version of #IHookshot11::DisableHookFunctionByHandle.
+    EResult DisableHookFunctionByHandle(HookHandle handle);
+
+    /// Direct version of #IHookshot11::GetHookStatisticsByHandle.
+    EResult GetHookStatisticsByHandle(HookHandle handle, SHookStatistics* statistics);
+
+    /// Direct version of #IHookshot12::CreateHooksBySymbol.
+    EResult CreateHooksBySymbol(
+        const wchar_t* symbolIndexFilename,
+        void* moduleHandle,
+        const char* const* symbolNames,
+        const void* const* hookFuncs,
+        size_t numHooks,
+        EResult* results);
+
+    /// Direct version of #IHookshot13::CreateSampledHook.
+    EResult CreateSampledHook(void* originalFunc, const void* hookFunc, uint32_t sampleInterval);
+
+    /// Direct version of #IHookshot13::SetSampledHookInterval.
+    EResult SetSampledHookInterval(const void* originalFunc, uint32_t sampleInterval);
+
+    /// Direct version of #IHookshot14::CanHook.
+    EResult CanHook(const void* originalFunc, SHookFeasibility* feasibility);
+
+    /// Direct version of #IHookshot15::GetHookPlanCacheStatistics.
+    EResult GetHookPlanCacheStatistics(SHookPlanCacheStatistics* statistics);
+  } // namespace Core
+} // namespace Hookshot
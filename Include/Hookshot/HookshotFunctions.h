@@ -17,6 +17,11 @@
 // Define this preprocessor symbol if linking directly with the Hookshot library and loading it by
 // normal means. Projects that build hook modules and projects that load the Hookshot library at
 // runtime (i.e. via LoadLibrary) should leave this preprocessor symbol undefined.
+// Applications that only hook their own functions can link with the core library (HookshotCore)
+// instead of the full library. It exposes the same interface but omits everything related to
+// injection and hook modules, installs no internal hooks, and reads no configuration file, so all
+// configurable behavior takes its default value. The static core library (HookshotStatic) is the
+// same but is linked directly into the application and used via "HookshotCore.h" instead.
 #ifdef HOOKSHOT_LINK_WITH_LIBRARY
 
 /// Initializes the Hookshot library.
@@ -40,6 +45,19 @@ extern "C" __declspec(dllimport) Hookshot::IHookshot* __fastcall HookshotLibrary
 #define HOOKSHOT_HOOK_MODULE_ENTRY(param)                                                          \
   extern "C" __declspec(dllexport) void __fastcall HookshotMain(Hookshot::IHookshot* param)
 
+/// Convenient definition for exporting a hook table from a Hookshot hook module.
+/// Macro parameter is a statically-allocated array of #Hookshot::SHookTableEntry objects. Hookshot
+/// creates all of the listed hooks, together with those listed by every other hook module it is
+/// loading, in a single batch before invoking any hook module entry points. A hook module that
+/// exports a hook table may omit its entry point if it has nothing else to do.
+#define HOOKSHOT_HOOK_MODULE_HOOK_TABLE(table)                                                     \
+  extern "C" __declspec(dllexport) const Hookshot::SHookTableEntry* __fastcall                     \
+      HookshotHookTable(size_t* numEntries)                                                        \
+  {                                                                                                \
+    *numEntries = (sizeof(table) / sizeof((table)[0]));                                            \
+    return (table);                                                                                \
+  }
+
 namespace Hookshot
 {
   /// Type definition for a pointer to the Hookshot library initialization function, whose address
@@ -55,6 +73,24 @@ namespace Hookshot
   /// function like `GetProcAddress`. Valid in 32-bit mode.
   inline constexpr char kLibraryInitializeProcName[] = "@HookshotLibraryInitialize@0";
 #endif
+
+  /// Type definition for a pointer to the function that reports the highest interface version
+  /// offered by the Hookshot library, whose address can be retrieved via a call to a function like
+  /// `GetProcAddress`. Hookshot builds that do not export it do not offer
+  /// #IHookshot::QueryInterface either.
+  using TInterfaceVersionProc = uint32_t(__fastcall*)(void);
+
+#ifdef _WIN64
+  /// Name of the function that reports the highest interface version offered by the Hookshot
+  /// library, which can be passed directly to a function like `GetProcAddress`. Valid in 64-bit
+  /// mode.
+  inline constexpr char kInterfaceVersionProcName[] = "HookshotInterfaceVersion";
+#else
+  /// Name of the function that reports the highest interface version offered by the Hookshot
+  /// library, which can be passed directly to a function like `GetProcAddress`. Valid in 32-bit
+  /// mode.
+  inline constexpr char kInterfaceVersionProcName[] = "@HookshotInterfaceVersion@0";
+#endif
 } // namespace Hookshot
 
 #endif
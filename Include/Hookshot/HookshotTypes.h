@@ -12,6 +12,20 @@
 
 #pragma once
 
+#include <cstddef>
+#include <cstdint>
+
+// Define this preprocessor symbol to have the `Original` functions of static and dynamic hooks
+// invoke the original function without a Control Flow Guard check, which otherwise adds a call to
+// the guard dispatch routine to every invocation. The target is always either the original function
+// itself or a trampoline that Hookshot created. Has no effect on projects built without Control
+// Flow Guard.
+#ifdef HOOKSHOT_ORIGINAL_WITHOUT_CFG_CHECK
+#define HOOKSHOT_ORIGINAL_FUNCTION_SPECIFIERS __forceinline __declspec(guard(nocf))
+#else
+#define HOOKSHOT_ORIGINAL_FUNCTION_SPECIFIERS __forceinline
+#endif
+
 namespace Hookshot
 {
   /// Enumeration of possible results from Hookshot functions.
@@ -35,7 +49,8 @@ namespace Hookshot
     /// Failed to set the hook.
     FailCannotSetHook,
 
-    /// Specified function is already hooked.
+    /// Specified function is already hooked in a way that conflicts with the request, such as being
+    /// the hook function of an existing hook.
     FailDuplicate,
 
     /// An argument that was supplied is invalid.
@@ -47,6 +62,9 @@ namespace Hookshot
     /// Unable to find a hook using the supplied identification.
     FailNotFound,
 
+    /// Operation was cancelled before it completed.
+    FailCancelled,
+
     /// Upper sentinel value, not used as an error code.
     UpperBoundValue
   };
@@ -59,6 +77,468 @@ namespace Hookshot
     return (result < EResult::BoundaryValue);
   }
 
+  /// Enumeration of the ways in which Hookshot can hook a function.
+  enum class EHookKind
+  {
+    /// The beginning of the original function is overwritten with a jump to the hook function, and
+    /// the overwritten instructions are transplanted into a trampoline. Every invocation of the
+    /// original function is hooked, no matter how it is reached. This is what #CreateHook does.
+    Inline,
+
+    /// Import address table entries that hold the address of the original function are rewritten
+    /// to hold the address of the hook function instead. Only calls made through those import
+    /// address tables are hooked. The code of the original function is not modified, so no
+    /// instructions are decoded or transplanted and no executable memory is allocated.
+    ImportAddressTable,
+
+    /// The export address table entry of the module that exports the original function is rewritten
+    /// to identify the hook function instead. Only callers that resolve the original function after
+    /// the hook is created, such as by invoking `GetProcAddress` or loading a module that imports
+    /// it, are hooked. The hook function must lie above the exporting module and within 4 GB of it.
+    ExportAddressTable,
+
+    /// Virtual function table entries, such as those of a COM interface, are rewritten to hold the
+    /// address of the hook function instead of the original method. Only calls made through those
+    /// virtual function tables are hooked. Created using #IHookshot::CreateVirtualTableHooks.
+    VirtualFunctionTable,
+
+    /// A hardware execution breakpoint is placed on the original function using one of the
+    /// processor's debug address registers, in every thread of the process, and the resulting
+    /// exception is redirected to the hook function. The code of the original function is not
+    /// modified, so this works even for functions too short to hold a jump instruction. Only four
+    /// such hooks can exist at once, and they take over the debug registers from any debugger.
+    /// Every call goes through the exception dispatcher, so these hooks are much slower than the
+    /// others and best suited to rarely-invoked functions.
+    DebugRegister,
+  };
+
+  /// Identifies a single hook to be created as part of a batch operation.
+  struct SHookSpec
+  {
+    /// Address of the function that should be hooked.
+    void* originalFunc;
+
+    /// Hook function that should be invoked instead of the original function.
+    const void* hookFunc;
+  };
+
+  /// Describes a single hook listed in the hook table exported by a hook module. Hookshot creates
+  /// the hooks in the hook tables of all hook modules it is loading together in one batch, before
+  /// invoking the entry point of any of them. See #HOOKSHOT_HOOK_MODULE_HOOK_TABLE.
+  struct SHookTableEntry
+  {
+    /// Name of the already-loaded module that contains the function to be hooked (for example,
+    /// L"kernel32.dll"). Compared case-insensitively.
+    const wchar_t* moduleName;
+
+    /// Name of the exported function that should be hooked, or `nullptr` to identify the function
+    /// by its relative virtual address instead. Forwarded exports are followed to the module that
+    /// implements them, provided that it is already loaded.
+    const char* exportName;
+
+    /// Relative virtual address of the function that should be hooked within its module. Only
+    /// used if no export name is specified.
+    uint32_t relativeAddress;
+
+    /// Hook function that should be invoked instead of the original function.
+    const void* hookFunc;
+
+    /// Optional location to be filled with the address that calls the original function, exactly
+    /// as would be returned by #IHookshot::GetOriginalFunction, once the hook is created. Left
+    /// unmodified if the hook cannot be created. May be `nullptr` if not needed.
+    const void** originalFuncOut;
+  };
+
+  /// Holds statistics collected for a single instrumented hook.
+  struct SHookStatistics
+  {
+    /// Number of times the hook has been invoked since it was created.
+    uint64_t callCount;
+  };
+
+  /// Number of buckets in a hook timing histogram, one per bit of the processor time stamp counter.
+  inline constexpr size_t kHookTimingHistogramNumBuckets = 64;
+
+  /// Holds the durations of a sample of the calls to a single hook whose timing is sampled.
+  struct SHookTimingHistogram
+  {
+    /// Number of calls per sample. One call out of every this many is timed.
+    uint32_t sampleInterval;
+
+    /// Number of sampled calls by duration, in processor time stamp counter ticks. Bucket i holds
+    /// calls that took at least 2^i ticks but fewer than 2^(i+1), except that bucket 0 also holds
+    /// calls that took 0 ticks. Durations include the hook function and everything it invokes,
+    /// including the original function.
+    uint64_t buckets[kHookTimingHistogramNumBuckets];
+  };
+
+  /// Maximum number of modules that a hook caller histogram can hold, which is also the maximum
+  /// number of recent timed calls whose callers it accounts for.
+  inline constexpr size_t kHookCallerHistogramMaxModules = 32;
+
+  /// Holds the modules that made a sample of the calls to a single hook whose timing is sampled.
+  struct SHookCallerHistogram
+  {
+    /// Number of recent timed calls whose callers are accounted for.
+    uint32_t numSamples;
+
+    /// Number of valid elements in each of the module arrays.
+    uint32_t numModules;
+
+    /// Handle of each module that made at least one of the sampled calls, or `nullptr` for calls
+    /// made from outside of any loaded module, in descending order of number of calls.
+    const void* modules[kHookCallerHistogramMaxModules];
+
+    /// Number of sampled calls made by each module.
+    uint32_t counts[kHookCallerHistogramMaxModules];
+  };
+
+  /// Selects what is recorded for each function when instrumenting all of the exports of a module
+  /// using #IHookshot4::InstrumentModuleExports.
+  struct SModuleInstrumentationOptions
+  {
+    /// Number of calls per timed call, for sampling the timing of each instrumented export as if
+    /// hook timing sampling were enabled in the configuration file, or 0 to only count calls.
+    /// Values larger than the largest positive 32-bit signed integer are clamped to it.
+    uint32_t sampleInterval;
+  };
+
+  /// Flag set in #SHookInfo::flags if the hook is disabled, so its original function is currently
+  /// restored to its unhooked state.
+  inline constexpr uint32_t kHookInfoFlagDisabled = 0x00000001;
+
+  /// Flag set in #SHookInfo::flags if the hook was created within the currently-open transaction
+  /// and its original function will not be modified until the transaction is committed.
+  inline constexpr uint32_t kHookInfoFlagPending = 0x00000002;
+
+  /// Flag set in #SHookInfo::flags if other hooks are chained onto the same original function.
+  inline constexpr uint32_t kHookInfoFlagChained = 0x00000004;
+
+  /// Flag set in #SHookInfo::flags if the hook is instrumented, in which case its call count is
+  /// valid.
+  inline constexpr uint32_t kHookInfoFlagInstrumented = 0x00000008;
+
+  /// Describes a single inline hook as captured by a snapshot of all hooks.
+  struct SHookInfo
+  {
+    /// Address of the function that is hooked.
+    const void* originalFunc;
+
+    /// Hook function that is invoked instead of the original function.
+    const void* hookFunc;
+
+    /// Address that the hook function invokes to call the original function, which is the same
+    /// as what #IHookshot::GetOriginalFunction returns for the hook function.
+    const void* originalFuncAfterHook;
+
+    /// Number of times the hook has been invoked since it was created, if it is instrumented, or
+    /// 0 otherwise. Shared by all of the hooks chained onto the same original function.
+    uint64_t callCount;
+
+    /// Combination of `kHookInfoFlag` values describing the state of the hook.
+    uint32_t flags;
+  };
+
+  /// Hook group identifier that indicates membership in no hook group.
+  inline constexpr uint32_t kHookGroupNone = 0;
+
+  /// Opaque object that represents an asynchronous hook installation operation.
+  struct SHookInstallOperation;
+
+  /// Signature of the function that reports progress of an asynchronous hook installation
+  /// operation. Invoked on a Hookshot worker thread, not on the thread that started the operation.
+  /// @param [in] context Application-defined value supplied when the operation was started.
+  /// @param [in] numHooksProcessed Number of hooks whose creation has been attempted so far.
+  /// @param [in] numHooksTotal Total number of hooks in the operation.
+  using THookInstallProgressCallback =
+      void(__fastcall*)(void* context, size_t numHooksProcessed, size_t numHooksTotal);
+
+  /// Number of arguments captured in #SCallbackHookCall::arguments.
+  inline constexpr size_t kCallbackHookNumArguments = 4;
+
+  /// Describes a single call intercepted by a callback hook. Filled in by Hookshot before the pre
+  /// callback is invoked, and the same object is passed to the post callback for the same call.
+  struct SCallbackHookCall
+  {
+    /// Application-defined value supplied when the callback hook was created.
+    void* context;
+
+    /// Address of the original function that was called.
+    const void* originalFunc;
+
+    /// Address to which the original function will return.
+    const void* returnAddress;
+
+    /// First few arguments of the call. In 64-bit mode these are the values of the integer
+    /// argument registers. In 32-bit mode these are the first values passed on the stack, so any
+    /// arguments passed in registers, such as the `this` pointer of a member function, are absent.
+    /// Modifying them has no effect on the call.
+    size_t arguments[kCallbackHookNumArguments];
+
+    /// Initially zero. The pre callback can store anything here for the post callback to use.
+    size_t userData;
+  };
+
+  /// Signature of the function that a callback hook invokes before the original function.
+  /// @param [in,out] call Information about the intercepted call.
+  using TCallbackHookPre = void(__fastcall*)(SCallbackHookCall* call);
+
+  /// Signature of the function that a callback hook invokes after the original function returns.
+  /// @param [in,out] call Information about the intercepted call.
+  /// @param [in] returnValue Value returned by the original function in its integer return
+  /// register. Meaningless if the original function returns nothing or a floating-point value.
+  using TCallbackHookPost = void(__fastcall*)(SCallbackHookCall* call, size_t returnValue);
+
+#ifdef _WIN64
+  /// Number of general-purpose registers captured in #SProbeContext::registers. In 64-bit mode
+  /// these are the volatile registers rax, rcx, rdx, r8, r9, r10, and r11, in that order.
+  inline constexpr size_t kProbeNumRegisters = 7;
+#else
+  /// Number of general-purpose registers captured in #SProbeContext::registers. In 32-bit mode
+  /// these are the volatile registers eax, ecx, and edx, in that order.
+  inline constexpr size_t kProbeNumRegisters = 3;
+#endif
+
+  /// Describes the state of the processor when execution reaches a probe. Filled in by Hookshot
+  /// before the probe callback is invoked. Non-volatile registers are not captured because the
+  /// probe callback preserves them anyway.
+  struct SProbeContext
+  {
+    /// Application-defined value supplied when the probe was created.
+    void* context;
+
+    /// Address of the instruction at which the probe was placed.
+    const void* address;
+
+    /// Value of the stack pointer when execution reached the probe.
+    size_t stackPointer;
+
+    /// Value of the flags register. Changes made by the probe callback take effect when execution
+    /// resumes.
+    size_t flags;
+
+    /// Values of the volatile general-purpose registers. Changes made by the probe callback take
+    /// effect when execution resumes.
+    size_t registers[kProbeNumRegisters];
+  };
+
+  /// Signature of the function that a probe invokes whenever execution reaches it.
+  /// @param [in,out] probeContext State of the processor at the probe.
+  using TProbeCallback = void(__fastcall*)(SProbeContext* probeContext);
+
+  /// Describes a sequence of bytes to be located in the executable code of a module, some of which
+  /// can be wildcards. Typically used to locate functions that are not exported.
+  struct SBytePattern
+  {
+    /// Bytes to be located.
+    const uint8_t* bytes;
+
+    /// Optional array, with the same number of elements as the byte array, that identifies which
+    /// bits of each byte are compared. A mask byte of 0xff requires an exact match, and a mask byte
+    /// of 0 makes the corresponding byte a wildcard. May be `nullptr` if every byte must match
+    /// exactly. At least one byte must be compared exactly.
+    const uint8_t* mask;
+
+    /// Number of bytes in the pattern.
+    size_t length;
+  };
+
+  /// Opaque object through which a hot-swappable hook transfers control to its hook function.
+  struct SHotSwapSlot;
+
+  /// Size, in bytes, of each slot counted by #STrampolineStoreFootprint::numWastedSlots.
+  inline constexpr size_t kTrampolineSlotSizeBytes = 16;
+
+  /// Describes the memory used by a single trampoline store, which is a block of address space
+  /// reserved to hold trampolines and the other code that Hookshot generates to implement hooks.
+  struct STrampolineStoreFootprint
+  {
+    /// Base address of the reserved address space.
+    const void* baseAddress;
+
+    /// Base address of the module, or of the memory region, near which the trampoline store was
+    /// placed, or `nullptr` if it was not placed near any of them. Always `nullptr` on 32-bit
+    /// builds, where all trampolines share the same memory.
+    const void* moduleBase;
+
+    /// Number of bytes of address space reserved.
+    size_t reservedBytes;
+
+    /// Number of bytes of committed memory, which counts against the commit limit.
+    size_t committedBytes;
+
+    /// Number of committed slots, each #kTrampolineSlotSizeBytes in size, that once held code
+    /// which is no longer needed, because its hook was removed or its trampoline was compacted,
+    /// and that have not yet been reused.
+    size_t numWastedSlots;
+  };
+
+  /// Describes the memory used on behalf of hooks whose original functions are in a single module,
+  /// or in a single memory region for original functions that are not in any module.
+  struct SModuleFootprint
+  {
+    /// Base address of the module or memory region.
+    const void* moduleBase;
+
+    /// Number of trampoline stores placed near the module. Always 0 on 32-bit builds.
+    size_t numTrampolineStores;
+
+    /// Number of bytes of address space reserved by trampoline stores placed near the module.
+    size_t trampolineReservedBytes;
+
+    /// Number of bytes of memory committed by trampoline stores placed near the module.
+    size_t trampolineCommittedBytes;
+
+    /// Number of pages of the module that Hookshot modified to redirect original functions. Such
+    /// pages are no longer shared with other processes, because modifying a page of a module image
+    /// gives the process its own private copy of it. Pages stay private after the hooks that
+    /// modified them are disabled, so they are still counted, but pages modified only by hooks that
+    /// have since been removed are not.
+    size_t numPrivatePatchedPages;
+  };
+
+  /// Describes the memory that Hookshot uses to implement inline hooks throughout the process.
+  struct SMemoryFootprint
+  {
+    /// Number of trampoline stores.
+    size_t numTrampolineStores;
+
+    /// Number of bytes of address space reserved by all trampoline stores.
+    size_t trampolineReservedBytes;
+
+    /// Number of bytes of memory committed by all trampoline stores.
+    size_t trampolineCommittedBytes;
+
+    /// Number of wasted slots in all trampoline stores, as in
+    /// #STrampolineStoreFootprint::numWastedSlots.
+    size_t numWastedTrampolineSlots;
+
+    /// Estimated number of bytes of heap memory held by the data structures that keep track of
+    /// hooks and trampolines.
+    size_t hookStoreHeapBytes;
+
+    /// Number of pages of modules, or of other memory regions, that Hookshot modified to redirect
+    /// original functions, as in #SModuleFootprint::numPrivatePatchedPages.
+    size_t numPrivatePatchedPages;
+  };
+
+  /// Option for #IHookshot9::RelocateCode that suppresses the jump back to the source code that
+  /// otherwise follows the relocated instructions if the last of them is not terminal. Useful for
+  /// callers that append their own code after the relocated instructions.
+  inline constexpr uint32_t kRelocateCodeOptionNoJumpBack = 0x00000001;
+
+  /// Option for #IHookshot9::RelocateCode that continues relocating instructions past a terminal
+  /// instruction, such as a return or an unconditional jump, until the minimum number of bytes is
+  /// reached. By default, relocation stops at the first terminal instruction.
+  inline constexpr uint32_t kRelocateCodeOptionContinuePastTerminal = 0x00000002;
+
+  /// Option for #IHookshot9::RelocateCode that prevents any relocated instruction from changing
+  /// length, so that every instruction is at the same offset in the destination as in the source.
+  /// Position-relative data accesses whose targets are out of range then cause relocation to fail
+  /// instead of being rewritten to use absolute addresses.
+  inline constexpr uint32_t kRelocateCodeOptionPreserveOffsets = 0x00000004;
+
+  /// Describes code relocated by #IHookshot9::RelocateCode.
+  struct SRelocatedCode
+  {
+    /// Number of bytes of source code that were relocated, which covers whole instructions and is
+    /// therefore at least the minimum requested, unless relocation stopped at a terminal
+    /// instruction.
+    size_t numSourceBytes;
+
+    /// Number of instructions that were relocated.
+    size_t numInstructions;
+
+    /// Number of bytes at the beginning of the destination that hold the relocated instructions
+    /// and the jump back to the source code, if there is one.
+    size_t numCodeBytes;
+
+    /// Number of bytes at the very end of the destination that hold jump assists and absolute
+    /// address slots, which are needed for instructions whose displacements do not reach their
+    /// targets from the destination. Nothing should be placed there.
+    size_t numTailBytes;
+
+    /// Number of branch instructions redirected through jump assists, which are unconditional
+    /// jumps that reach targets too far away for the original branch displacement.
+    size_t numJumpAssists;
+
+    /// Number of position-relative data accesses rewritten to use absolute addresses.
+    size_t numRewrittenMemoryReferences;
+
+    /// Whether or not a jump back to the source code, immediately after the relocated bytes,
+    /// follows the relocated instructions.
+    bool hasJumpBack;
+  };
+
+  /// Describes whether and how a function could be hooked, as determined by
+  /// #IHookshot14::CanHook without creating any hook.
+  struct SHookFeasibility
+  {
+    /// Kinds of hook that could plausibly hook the function, as a bit mask in which bit `1 << k`
+    /// is set for each #EHookKind value `k`. Kinds that certainly cannot are omitted, but creating
+    /// a hook of a kind that is included can still fail.
+    uint32_t possibleKinds;
+
+    /// Kind of hook estimated to be cheapest, which is the first one that
+    /// #IHookshot5::CreateHookAuto would attempt. Meaningful only if #possibleKinds is non-zero.
+    EHookKind cheapestKind;
+
+    /// Estimated cost of the cheapest kind of hook, on the same scale that
+    /// #IHookshot5::CreateHookAuto uses. Meaningful only if #possibleKinds is non-zero.
+    uint32_t cheapestCost;
+
+    /// Whether or not the function is already hooked inline, in which case a new inline hook
+    /// would be chained onto the existing hooks without modifying the function again.
+    bool isAlreadyHooked;
+
+    /// Number of bytes at the beginning of the function that an inline hook would overwrite and
+    /// transplant into its trampoline. 0 if the function is already hooked or if it cannot be
+    /// hooked inline.
+    uint32_t numTransplantedBytes;
+
+    /// Number of instructions that an inline hook would transplant into its trampoline.
+    uint32_t numTransplantedInstructions;
+
+    /// Number of transplanted instructions whose position-dependent displacements would need to
+    /// be adjusted because they refer to something outside the transplanted bytes.
+    uint32_t numRelocations;
+
+    /// Number of transplanted branch instructions expected to need jump assists because their
+    /// displacements are too narrow to reach their targets from a trampoline.
+    uint32_t numJumpAssists;
+
+    /// Whether or not an inline hook would need a new trampoline store to be placed and committed
+    /// because none of the existing ones that it could use has any free space. Placing a store
+    /// near a module for the first time is the most expensive part of creating an inline hook.
+    bool needsNewTrampolineStore;
+  };
+
+  /// Counts the uses of the hook plan cache by this process, as reported by
+  /// #IHookshot15::GetHookPlanCacheStatistics.
+  struct SHookPlanCacheStatistics
+  {
+    /// Number of original functions for which a cached hook plan was sought.
+    uint64_t numLookups;
+
+    /// Number of lookups that found a hook plan which still matches the original function and was
+    /// therefore used instead of decoding it.
+    uint64_t numHits;
+
+    /// Number of hook plans recorded after decoding original functions.
+    uint64_t numRecorded;
+  };
+
+  /// Opaque identifier of a single inline hook, obtained from #IHookshot10::CreateHookEx or
+  /// #IHookshot11::GetHookHandle. Encodes the location of the trampoline that implements the hook,
+  /// so methods that accept a handle locate the hook using arithmetic rather than by looking up
+  /// function addresses. A handle identifies the same hook for as long as it exists, even after
+  /// its hook function is replaced or disabled and even if it is chained onto other hooks. Once
+  /// the hook is removed, its handle is no longer accepted.
+  using HookHandle = uint64_t;
+
+  /// Hook handle value that never identifies any hook.
+  inline constexpr HookHandle kInvalidHookHandle = 0;
+
   /// Main interface used to access all Hookshot functionality. During initialization, Hookshot
   /// creates instances of objects that implement this interface as needed. Any hook modules that
   /// Hookshot loads are provided with an interface pointer when executing their entry point
@@ -71,7 +551,16 @@ namespace Hookshot
   {
   public:
 
-    /// Causes Hookshot to attempt to install a hook on the specified function.
+    /// Causes Hookshot to attempt to install a hook on the specified function. If the function is
+    /// already hooked, the new hook is chained in front of the existing hooks, so it is invoked
+    /// first, and invoking the address returned by #GetOriginalFunction for the new hook function
+    /// invokes the hook function that was previously first. Only the first hook modifies the
+    /// original function, so chained hooks take effect immediately, even within a transaction.
+    /// When a hook is part of a chain, identifying it by its original function address refers to
+    /// the first hook that was created, so the others must be identified by their hook functions.
+    /// If following jump thunks is enabled in the configuration file and the function consists of
+    /// nothing more than an unconditional jump, the hook is instead placed on the function to which
+    /// the jump ultimately leads, and either address identifies the hook thereafter.
     /// @param [in] originalFunc Address of the function that should be hooked.
     /// @param [in] hookFunc Hook function that should be invoked instead of the original function.
     /// @return Result of the operation.
@@ -79,8 +568,10 @@ namespace Hookshot
 
     /// Disables the hook function associated with the specified hook. On success, going forward all
     /// invocations of the original function will execute as if not hooked at all, and Hookshot no
-    /// longer associates the hook function with the hook. To re-enable the hook, use
-    /// #ReplaceHookFunction and identify the hook by its original function address.
+    /// longer associates the hook function with the hook. Where possible, the original function is
+    /// restored to its unhooked state, so that invoking it no longer incurs any overhead. To
+    /// re-enable the hook, use #ReplaceHookFunction and identify the hook by its original function
+    /// address.
     /// @param [in] originalOrHookFunc Address of either the original function or the current hook
     /// function (it does not matter which) currently associated with the hook.
     /// @return Result of the operation.
@@ -108,5 +599,981 @@ namespace Hookshot
     /// @return Result of the operation.
     virtual EResult __fastcall ReplaceHookFunction(
         const void* originalOrHookFunc, const void* newHookFunc) = 0;
+
+    /// Causes Hookshot to attempt to install multiple hooks in a single operation. Semantically
+    /// equivalent to invoking #CreateHook once per hook specification but considerably faster for
+    /// large numbers of hooks because locking, memory protection changes, and instruction cache
+    /// flushes are shared among all of the hooks in the batch. Failure to create one hook does not
+    /// prevent any of the others from being created.
+    /// @param [in] hookSpecs Array of hook specifications, one per hook to create.
+    /// @param [in] numHookSpecs Number of elements in the hook specification array.
+    /// @param [out] results Optional array, with the same number of elements as the hook
+    /// specification array, to be filled with the result of creating each individual hook. May be
+    /// `nullptr` if per-hook results are not needed.
+    /// @return Success if every hook was created, otherwise the result corresponding to the first
+    /// hook that could not be created.
+    virtual EResult __fastcall CreateHooks(
+        const SHookSpec* hookSpecs, size_t numHookSpecs, EResult* results) = 0;
+
+    /// Opens a hook transaction owned by the calling thread. While the transaction is open, hooks
+    /// created by the calling thread using #CreateHook or #CreateHooks are fully prepared and can
+    /// be queried and modified, but the original functions are not yet modified and hence the
+    /// hooks do not take effect. All such hooks go live together when the transaction is committed.
+    /// Only one transaction can be open at a time.
+    /// @return Result of the operation.
+    virtual EResult __fastcall BeginTransaction(void) = 0;
+
+    /// Commits the hook transaction owned by the calling thread. All other threads in the process
+    /// are suspended once, any of them that are stopped within the bytes about to be overwritten
+    /// are moved to the equivalent location in the corresponding hook's trampoline, all of the
+    /// pending original functions are modified, and then the other threads are resumed. Hooks that
+    /// cannot be made live at this point are removed, as if they had never been created.
+    /// @return Success if every pending hook went live, otherwise an indication that at least one
+    /// of them could not be made live.
+    virtual EResult __fastcall CommitTransaction(void) = 0;
+
+    /// Retrieves the statistics collected for the specified hook. Statistics are only collected
+    /// for hooks created while hook instrumentation is enabled in the configuration file. The count
+    /// includes every invocation of the original function, even while the hook function is
+    /// disabled or after it is replaced.
+    /// @param [in] originalOrHookFunc Address of the original function or the hook function
+    /// associated with the hook of interest.
+    /// @param [out] statistics Filled with the statistics on success.
+    /// @return Success if statistics were retrieved, NoEffect if the hook exists but is not
+    /// instrumented, or an indication of failure otherwise.
+    virtual EResult __fastcall GetHookStatistics(
+        const void* originalOrHookFunc, SHookStatistics* statistics) = 0;
+
+    /// Removes an existing hook entirely, along with any other hooks chained onto the same original
+    /// function, and restores the original function to its unhooked state. Hookshot forgets about
+    /// the original function and all of the hook functions, so the same original function can be
+    /// hooked again afterwards. Trampoline memory is not reused right away because other threads
+    /// might still be executing it. Instead, it is reclaimed during a later invocation of this
+    /// method, once all other threads have been observed outside of it. It is up to the caller to
+    /// ensure that no addresses previously returned by #GetOriginalFunction for the removed hooks
+    /// are invoked after this method returns.
+    /// @param [in] originalOrHookFunc Address of either the original function or any of the hook
+    /// functions (it does not matter which) currently associated with the hook.
+    /// @return Result of the operation.
+    virtual EResult __fastcall RemoveHook(const void* originalOrHookFunc) = 0;
+
+    /// Creates a hook on a function exported by a module that need not be loaded yet. If the module
+    /// is already loaded, this is equivalent to #CreateHook. Otherwise, the hook is created as soon
+    /// as the module is loaded, before any of its code runs, so there is no need to load the module
+    /// early or to hook the functions that load modules. A deferred hook is only created the first
+    /// time its module is loaded. Until then, #GetOriginalFunction returns `nullptr` for it, so a
+    /// hook function must not assume that the hook exists before it is first invoked.
+    /// @param [in] moduleName Base name of the module, including its extension (for example,
+    /// "d3d11.dll"). Compared case-insensitively.
+    /// @param [in] exportName Name of the exported function that should be hooked. Forwarded
+    /// exports are followed to the module that implements them, provided that it is already
+    /// loaded by the time the hook is created.
+    /// @param [in] hookFunc Hook function that should be invoked instead of the exported function.
+    /// @return Success if the hook was created or deferred, FailNotFound if the module is loaded
+    /// but does not export the function, or another indication of failure otherwise.
+    virtual EResult __fastcall CreateDeferredHook(
+        const wchar_t* moduleName, const char* exportName, const void* hookFunc) = 0;
+
+    /// Creates hooks on multiple functions exported by the same loaded module, identified by name.
+    /// The module's export table is parsed only once, and each name is located by binary search,
+    /// after which the hooks are created together exactly as if by #CreateHooks. This is much
+    /// faster than resolving each export individually when hooking many exports of one module.
+    /// Forwarded exports are followed to the module that implements them, provided that it is
+    /// already loaded, so hooking an export by any of its aliases hooks the same function.
+    /// @param [in] moduleHandle Handle of the module that exports the functions to be hooked,
+    /// which must already be loaded in the current process.
+    /// @param [in] exportNames Array of names of exported functions that should be hooked.
+    /// @param [in] hookFuncs Array of hook functions, one per exported function, that should be
+    /// invoked instead of the exported functions.
+    /// @param [in] numHooks Number of elements in the export name and hook function arrays.
+    /// @param [out] results Optional array, with the same number of elements as the export name
+    /// array, to be filled with the result of creating each individual hook. Exports that cannot
+    /// be found have a result of FailNotFound. May be `nullptr` if per-hook results are not needed.
+    /// @return Success if every hook was created, otherwise the result corresponding to the first
+    /// hook that could not be created.
+    virtual EResult __fastcall CreateHooksByExportName(
+        void* moduleHandle,
+        const char* const* exportNames,
+        const void* const* hookFuncs,
+        size_t numHooks,
+        EResult* results) = 0;
+
+    /// Creates a hook of the specified kind. Inline hooks are created exactly as if by #CreateHook.
+    /// Address table hooks leave the original function unmodified, so #GetOriginalFunction returns
+    /// the original function itself for them. Address table hooks cannot be chained, disabled, or
+    /// replaced, only removed using #RemoveHook, and they do not apply to modules loaded after
+    /// they are created. Debug register hooks are likewise only removed using #RemoveHook, and for
+    /// them #GetOriginalFunction returns a small stub that reaches the original function without
+    /// triggering the hook.
+    /// @param [in] hookKind Kind of hook to create.
+    /// @param [in] originalFunc Address of the function that should be hooked.
+    /// @param [in] hookFunc Hook function that should be invoked instead of the original function.
+    /// @param [in] importingModule For import address table hooks, handle of the only module whose
+    /// import address table should be rewritten, or `nullptr` to rewrite the import address tables
+    /// of all currently-loaded modules other than Hookshot itself. Ignored for other kinds.
+    /// @return Result of the operation. For address table hooks, FailNotFound indicates that no
+    /// address table entry refers to the original function. For debug register hooks,
+    /// FailAllocation indicates that all debug address registers are already in use.
+    virtual EResult __fastcall CreateHookWithKind(
+        EHookKind hookKind, void* originalFunc, const void* hookFunc, void* importingModule) = 0;
+
+    /// Creates hooks on multiple methods of an interface by rewriting entries of its virtual
+    /// function table, all in one batch. Entries that share a page are written together, so the
+    /// memory protection of each page is changed only once. Like other address table hooks, these
+    /// leave the original methods unmodified, and #GetOriginalFunction returns the original method
+    /// itself when given the hook function, so invoking it is a direct call. The same hook function
+    /// can be written into the virtual function tables of multiple interfaces, as long as all of
+    /// the entries it replaces refer to the same original method. Removing the hook using
+    /// #RemoveHook restores all of those entries.
+    /// @param [in] virtualTable Address of the virtual function table, which for a COM object is
+    /// the first pointer-sized value stored in the object.
+    /// @param [in] slotIndices Array of indices of the virtual function table entries to rewrite,
+    /// which are the positions of the methods within the interface declaration, counting from 0.
+    /// @param [in] hookFuncs Array of hook functions, one per entry.
+    /// @param [in] numHooks Number of elements in the slot index and hook function arrays.
+    /// @param [out] results Optional array, with the same number of elements as the slot index
+    /// array, to be filled with the result of creating each individual hook. May be `nullptr` if
+    /// per-hook results are not needed.
+    /// @return Success if every hook was created, otherwise the result corresponding to the first
+    /// hook that could not be created.
+    virtual EResult __fastcall CreateVirtualTableHooks(
+        void* virtualTable,
+        const size_t* slotIndices,
+        const void* const* hookFuncs,
+        size_t numHooks,
+        EResult* results) = 0;
+
+    /// Enables or disables the reentrancy guard of an existing inline hook. While it is enabled,
+    /// every invocation of the original function first checks the calling thread's reentrancy
+    /// guard depth, and if it is non-zero, the original function runs without invoking any hook
+    /// functions. The check is generated code that runs before the hook function and reads the
+    /// depth from a fixed offset within the thread environment block, so it is much cheaper than a
+    /// check written by hand using thread-local storage functions. The depth is maintained by hook
+    /// functions themselves, typically using ScopedReentrancyGuard, so that functions they invoke
+    /// do not re-enter any guarded hooks. A reentrancy guard applies to all of the hooks chained
+    /// onto the same original function, and invocations that bypass the hooks are not counted by
+    /// hook instrumentation.
+    /// @param [in] originalOrHookFunc Address of either the original function or any of the hook
+    /// functions (it does not matter which) currently associated with the hook.
+    /// @param [in] enabled Whether the reentrancy guard should be enabled or disabled.
+    /// @return Success if the reentrancy guard was enabled or disabled, NoEffect if it was already
+    /// in the requested state, FailNotFound if there is no such inline hook, or another indication
+    /// of failure otherwise. FailAllocation indicates that the per-thread depth is unavailable.
+    virtual EResult __fastcall SetHookReentrancyGuard(
+        const void* originalOrHookFunc, bool enabled) = 0;
+
+    /// Retrieves the offset, within the thread environment block, of the pointer-sized per-thread
+    /// reentrancy guard depth that is checked by hooks whose reentrancy guards are enabled. It is
+    /// the same for all threads and does not change for the lifetime of the process, so it can be
+    /// retrieved once and cached.
+    /// @return Offset in bytes, or 0 if reentrancy guards are unavailable.
+    virtual size_t __fastcall GetReentrancyGuardDepthOffset(void) = 0;
+
+    /// Restricts an existing inline hook to calls made from within a specified set of modules.
+    /// Calls from anywhere else run the original function without invoking any hook functions.
+    /// The check is generated code that runs before the hook function and compares the return
+    /// address against the address ranges that the modules occupied when the filter was set, so it
+    /// is much cheaper than a check written by hand using `_ReturnAddress` and
+    /// `GetModuleHandleEx`. The modules must remain loaded for as long as the filter is in effect.
+    /// A caller filter applies to all of the hooks chained onto the same original function, and
+    /// filtered invocations are not counted by hook instrumentation. Calls that pass a reentrancy
+    /// guard are checked by the caller filter afterwards.
+    /// @param [in] originalOrHookFunc Address of either the original function or any of the hook
+    /// functions (it does not matter which) currently associated with the hook.
+    /// @param [in] callerModules Array of base addresses, which are the same as module handles, of
+    /// the modules whose calls should invoke the hook. Replaces any previously-specified modules.
+    /// @param [in] numCallerModules Number of elements in the caller module array. If 0, the
+    /// caller filter is disabled and all calls invoke the hook.
+    /// @return Success if the caller filter was set or disabled, NoEffect if it was already
+    /// disabled, FailNotFound if there is no such inline hook, FailInvalidArgument if any of the
+    /// caller modules is not a loaded module, or another indication of failure otherwise.
+    virtual EResult __fastcall SetHookCallerFilter(
+        const void* originalOrHookFunc,
+        const void* const* callerModules,
+        size_t numCallerModules) = 0;
+
+    /// Creates a call trace hook, which is an inline hook whose hook function is generated code
+    /// that records each call and then runs the original function. Each record holds the first few
+    /// arguments, the return address, the original function address, and the processor time stamp
+    /// counter, and it is written into a per-thread ring buffer without taking any locks. Ring
+    /// buffers live in a named shared memory section, whose name contains the identifier of the
+    /// hooked process, so an external tool can read them while the process runs. Other hooks can
+    /// be chained onto the same original function. Threads that already existed when the first
+    /// call trace hook was created, other than the calling thread, run the hook without recording
+    /// anything. The generated code is never freed, even if the hook is later removed.
+    /// @param [in] originalFunc Address of the function that should be traced.
+    /// @return Result of the operation. FailAllocation indicates that call tracing is unavailable.
+    virtual EResult __fastcall CreateCallTraceHook(void* originalFunc) = 0;
+
+    /// Retrieves the timing histogram collected for the specified hook. Histograms are only
+    /// collected for hooks created while sampled hook timing is enabled in the configuration file.
+    /// Only one call out of every configured number of calls is timed, and calls are skipped if the
+    /// same thread is already timing another call or another thread is already timing a call to
+    /// the same hook. All of the hooks chained onto the same original function share a histogram.
+    /// Timed calls have their return addresses temporarily replaced, so exceptions must not unwind
+    /// through them, and sampled hook timing is incompatible with hardware-enforced stack
+    /// protection.
+    /// @param [in] originalOrHookFunc Address of the original function or the hook function
+    /// associated with the hook of interest.
+    /// @param [out] histogram Filled with the timing histogram on success.
+    /// @return Success if the histogram was retrieved, NoEffect if the hook exists but its timing
+    /// is not sampled, or an indication of failure otherwise.
+    virtual EResult __fastcall GetHookTimingHistogram(
+        const void* originalOrHookFunc, SHookTimingHistogram* histogram) = 0;
+
+    /// Prepares for creating a large number of inline hooks all at once, so that creating them
+    /// does not pause partway through to grow internal data structures. Sizes internal lookup
+    /// tables for the specified number of additional hooks and reserves enough trampoline memory
+    /// to hold them. On 64-bit builds, trampoline memory is reserved near each of the specified
+    /// modules, with the hooks assumed to be split evenly among them. On 32-bit builds, all
+    /// trampolines share the same memory, so the modules are not used. Purely an optimization, in
+    /// that hooks can be created regardless of whether or not this method is invoked or succeeds.
+    /// @param [in] numHooks Number of hooks that are about to be created.
+    /// @param [in] targetModules Array of base addresses, which are the same as module handles, of
+    /// the modules that contain the functions that are about to be hooked.
+    /// @param [in] numTargetModules Number of elements in the target module array.
+    /// @return Success if everything was reserved, NoEffect if the number of hooks is 0, or an
+    /// indication of failure otherwise. FailAllocation indicates that trampoline memory could not
+    /// be reserved near at least one of the modules.
+    virtual EResult __fastcall ReserveHooks(
+        size_t numHooks, const void* const* targetModules, size_t numTargetModules) = 0;
+
+    /// Captures information about every existing inline hook, including hooks chained onto other
+    /// hooks, all at once. Much faster than querying hooks individually because the hook store is
+    /// examined only once. Address table hooks and debug register hooks are not included.
+    /// @param [out] hookInfo Array to receive one element per hook, in no particular order. Can be
+    /// `nullptr` if its capacity is 0, which is useful for just counting the hooks.
+    /// @param [in] maxHookInfo Capacity of the array, in elements.
+    /// @param [out] numHooks Filled with the total number of hooks, which can exceed the capacity,
+    /// in which case only the first few hooks are captured.
+    /// @return Success if the snapshot was captured, or an indication of failure otherwise.
+    virtual EResult __fastcall SnapshotHooks(
+        SHookInfo* hookInfo, size_t maxHookInfo, size_t* numHooks) = 0;
+
+    /// Assigns an existing inline hook to a hook group, so that it can be enabled and disabled
+    /// together with the other members of the group using #SetHookGroupEnabled. Typically invoked
+    /// immediately after the hook is created. A hook belongs to at most one group, so assigning it
+    /// to a group removes it from whatever group it previously belonged to, and assigning it to
+    /// group #kHookGroupNone removes it from its group entirely. Removing a hook also removes it
+    /// from its group.
+    /// @param [in] originalOrHookFunc Address of either the original function or the current hook
+    /// function (it does not matter which) currently associated with the hook.
+    /// @param [in] groupId Application-defined identifier of the group.
+    /// @return Success if the group was assigned, NoEffect if the hook already belongs to the
+    /// specified group, or an indication of failure otherwise.
+    virtual EResult __fastcall SetHookGroup(const void* originalOrHookFunc, uint32_t groupId) = 0;
+
+    /// Enables or disables every hook in the specified hook group in a single operation. Disabling
+    /// a hook in a group is equivalent to #DisableHookFunction, and enabling it again restores the
+    /// hook function it had when it was last disabled this way. Much faster than toggling each hook
+    /// individually because the hook store is locked and trampoline memory is made writable only
+    /// once. Hooks in the group that are already in the requested state are left alone, and if
+    /// some of the hooks cannot be changed, the others are still changed.
+    /// @param [in] groupId Identifier of the group, as previously passed to #SetHookGroup.
+    /// @param [in] enabled `true` to enable the hooks in the group, `false` to disable them.
+    /// @return Success if at least one hook was changed and none failed, NoEffect if the group has
+    /// no members or all of them are already in the requested state, or the first failure
+    /// encountered otherwise.
+    virtual EResult __fastcall SetHookGroupEnabled(uint32_t groupId, bool enabled) = 0;
+
+    /// Starts installing multiple hooks in the background and returns without waiting for them to
+    /// be installed. Hooks are created on a Hookshot worker thread in batches, each of which is
+    /// equivalent to an invocation of #CreateHooks, and progress is reported after each batch. The
+    /// operation is not part of any transaction. Every operation that is started must eventually
+    /// be finished by passing it to #WaitForHookInstall exactly once.
+    /// @param [in] hookSpecs Array of hook specifications, one per hook to create. Copied, so it
+    /// need not remain valid after this method returns.
+    /// @param [in] numHookSpecs Number of elements in the hook specification array.
+    /// @param [in] progressCallback Optional function to invoke after each batch. Must not wait for
+    /// the operation to complete. May be `nullptr` if progress reports are not needed.
+    /// @param [in] progressCallbackContext Value to pass to the progress callback.
+    /// @param [out] operation Filled with the object that represents the operation on success.
+    /// @return Success if the operation was started, or an indication of failure otherwise.
+    virtual EResult __fastcall BeginCreateHooksAsync(
+        const SHookSpec* hookSpecs,
+        size_t numHookSpecs,
+        THookInstallProgressCallback progressCallback,
+        void* progressCallbackContext,
+        SHookInstallOperation** operation) = 0;
+
+    /// Requests that an asynchronous hook installation operation stop early and undo its effects.
+    /// Returns immediately. Once the batch in progress finishes, no further hooks are created, and
+    /// every hook that the operation created is removed, or is disabled if it was chained onto a
+    /// hook that already existed. Has no effect if the operation already completed.
+    /// @param [in] operation Operation to cancel, which must not yet have been finished.
+    /// @return Success if cancellation was requested, or an indication of failure otherwise.
+    virtual EResult __fastcall CancelHookInstall(SHookInstallOperation* operation) = 0;
+
+    /// Waits for an asynchronous hook installation operation to complete, retrieves its results,
+    /// and finishes it. The operation object is no longer valid once this method returns.
+    /// @param [in] operation Operation to wait for.
+    /// @param [out] results Optional array, with the same number of elements as the hook
+    /// specification array, to be filled with the result of creating each individual hook. Hooks
+    /// that were not created or were undone because of cancellation have a result of
+    /// FailCancelled. May be `nullptr` if per-hook results are not needed.
+    /// @return Success if every hook was created, FailCancelled if the operation was cancelled
+    /// before it completed, otherwise the result corresponding to the first hook that could not be
+    /// created.
+    virtual EResult __fastcall WaitForHookInstall(
+        SHookInstallOperation* operation, EResult* results) = 0;
+
+    /// Creates a hook that invokes a pre callback and a post callback around every call to the
+    /// original function, without requiring a hook function to be written for it. Hookshot places
+    /// a small stub in a trampoline that transfers control to shared dispatch code, which captures
+    /// the call, invokes the callbacks, and calls or jumps to the original function. Any number of
+    /// callback hooks therefore share the same dispatch code. Either callback may be `nullptr`.
+    /// Without a post callback, control is transferred to the original function after the pre
+    /// callback returns, so the call is otherwise unaffected. With a post callback, the original
+    /// function is called on a copy of its stack arguments, so its arguments must fit in 12
+    /// pointer-sized slots and must not vary in number. Floating-point return values are preserved
+    /// in 64-bit mode but, in 32-bit mode, only if the post callback does not use the x87 register
+    /// stack. Callbacks must not throw exceptions. Other hooks can be chained onto the same
+    /// original function. The generated code is never freed, even if the hook is later removed.
+    /// @param [in] originalFunc Address of the function that should be hooked.
+    /// @param [in] preCallback Function to invoke before the original function, or `nullptr`.
+    /// @param [in] postCallback Function to invoke after the original function, or `nullptr`.
+    /// @param [in] context Application-defined value passed to both callbacks.
+    /// @return Result of the operation.
+    virtual EResult __fastcall CreateCallbackHook(
+        void* originalFunc,
+        TCallbackHookPre preCallback,
+        TCallbackHookPost postCallback,
+        void* context) = 0;
+
+    /// Creates a hook that supplies a context value to its hook function, so that a single generic
+    /// hook function can serve any number of original functions. Hookshot places a small stub in
+    /// a trampoline that stores the context value into a per-thread slot and then jumps to the
+    /// hook function without otherwise affecting the call. The hook function retrieves the value
+    /// using #ReadHookContext before invoking any other function. Because the hook function is
+    /// shared, #GetOriginalFunction must be given the original function rather than the hook
+    /// function, and the result is typically stored in the object identified by the context value.
+    /// Replacing the hook function of a context hook discards its context value. Other hooks can be
+    /// chained onto the same original function. The generated code is never freed, even if the
+    /// hook is later removed.
+    /// @param [in] originalFunc Address of the function that should be hooked.
+    /// @param [in] hookFunc Generic hook function that should be invoked instead.
+    /// @param [in] context Value to supply to the hook function whenever this hook invokes it.
+    /// @return Result of the operation. FailAllocation indicates that the per-thread slot is
+    /// unavailable.
+    virtual EResult __fastcall CreateContextHook(
+        void* originalFunc, const void* hookFunc, void* context) = 0;
+
+    /// Retrieves the offset, within the thread environment block, of the pointer-sized per-thread
+    /// slot into which context hooks store their context values. It is the same for all threads
+    /// and does not change for the lifetime of the process, so it can be retrieved once and cached
+    /// and then passed to #ReadHookContext.
+    /// @return Offset in bytes, or 0 if context hooks are unavailable.
+    virtual size_t __fastcall GetHookContextOffset(void) = 0;
+
+    /// Places a probe at an arbitrary instruction, which need not be the beginning of a function,
+    /// so that a callback is invoked every time execution reaches it. Hookshot transplants the
+    /// instructions that are overwritten by a jump, exactly as it does for the beginning of a
+    /// function, and places a small stub in a trampoline that transfers control to shared probe
+    /// code. The probe code saves the volatile registers, including the vector registers that the
+    /// calling convention does not preserve, along with the flags, invokes the callback, restores
+    /// everything, and resumes execution at the transplanted instructions. No other branch may
+    /// target any of the overwritten instructions other than the first. The x87 register stack and
+    /// the upper halves of 256-bit or wider vector registers are not preserved, so probe callbacks
+    /// should not touch them, and probe callbacks must not throw exceptions. A probe is removed
+    /// using #RemoveHook with the address of its instruction. The generated code is never freed.
+    /// @param [in] address Address of the instruction at which to place the probe.
+    /// @param [in] callback Function to invoke whenever execution reaches the probe.
+    /// @param [in] context Application-defined value passed to the callback.
+    /// @return Result of the operation. FailAllocation indicates that probes are unavailable.
+    virtual EResult __fastcall CreateProbe(
+        void* address, TProbeCallback callback, void* context) = 0;
+
+    /// Locates multiple byte patterns in the executable sections of a loaded module, so that
+    /// functions that are not exported can be hooked. All patterns are searched for together in a
+    /// single pass over the code, filtering candidate positions using vector instructions, and
+    /// large modules are divided among worker threads. The results can be used directly as the
+    /// original functions of hooks created with #CreateHooks. Code that has already been hooked no
+    /// longer contains its original bytes, so patterns should be located before hooks are created.
+    /// If enabled in the configuration file, the locations found are remembered across runs of the
+    /// application and merely verified, rather than searched for, while the module is unchanged.
+    /// @param [in] moduleHandle Handle of the module to be searched, which must already be loaded
+    /// in the current process.
+    /// @param [in] patterns Array of patterns to be located.
+    /// @param [in] numPatterns Number of elements in the pattern array.
+    /// @param [out] results Array, with the same number of elements as the pattern array, to be
+    /// filled with the lowest address at which each pattern occurs, or `nullptr` for patterns that
+    /// do not occur at all.
+    /// @return Success if every pattern was located, FailNotFound if at least one was not, or
+    /// FailInvalidArgument if any of the parameters or patterns is invalid.
+    virtual EResult __fastcall FindPatterns(
+        void* moduleHandle, const SBytePattern* patterns, size_t numPatterns, void** results) = 0;
+
+    /// Creates a hook whose hook function can be changed very frequently and very cheaply. Hookshot
+    /// places a small stub, consisting of a single indirect jump, that reads the address of the
+    /// hook function from a slot in ordinary data memory. #HotSwapHookFunction changes the hook
+    /// function by writing to the slot, so unlike #ReplaceHookFunction it takes no locks, changes
+    /// no memory protection, and flushes no instruction cache. Hookshot associates the stub rather
+    /// than the hook function with the hook, so the hook is identified thereafter by its original
+    /// function address. Other hooks can be chained onto the same original function. The stub and
+    /// the slot are never freed, even if the hook is later removed.
+    /// @param [in] originalFunc Address of the function that should be hooked.
+    /// @param [in] hookFunc Initial hook function.
+    /// @param [out] slot Filled with the slot that identifies the hook to #HotSwapHookFunction.
+    /// @return Result of the operation.
+    virtual EResult __fastcall CreateHotSwapHook(
+        void* originalFunc, const void* hookFunc, SHotSwapSlot** slot) = 0;
+
+    /// Changes the hook function of a hook created by #CreateHotSwapHook using a single aligned
+    /// atomic store. Safe to invoke concurrently from any number of threads, including while other
+    /// threads are invoking the original function, each of which reaches either the old hook
+    /// function or the new one. The new hook function is not validated, so it must satisfy the same
+    /// requirements as the hook function of any other hook.
+    /// @param [in] slot Slot obtained from #CreateHotSwapHook.
+    /// @param [in] newHookFunc Address of the new hook function.
+    /// @return Result of the operation.
+    virtual EResult __fastcall HotSwapHookFunction(
+        SHotSwapSlot* slot, const void* newHookFunc) = 0;
+
+    /// Overrides the hook function of an inline hook, but only on the calling thread. The first
+    /// time a hook is overridden, Hookshot places a small stub in front of its hook function, and
+    /// from then on every call looks up the calling thread's override with a single thread-local
+    /// load. Threads that have never overridden any hook take a fast path that skips the lookup
+    /// entirely. If other hooks are chained onto the same original function, the override replaces
+    /// the entire chain. The stub remains in place, even if every override is later cleared.
+    /// Overrides have no effect while the hook is disabled.
+    /// @param [in] originalOrHookFunc Address of the original function or hook function of an
+    /// existing inline hook.
+    /// @param [in] overrideFunc Function that the calling thread should reach instead of the hook
+    /// function. The address of the original function bypasses the hook entirely on the calling
+    /// thread, and `nullptr` clears the override so that the calling thread reaches the hook
+    /// function again. Must satisfy the same requirements as any other hook function.
+    /// @return Result of the operation.
+    virtual EResult __fastcall SetThreadHookOverride(
+        const void* originalOrHookFunc, const void* overrideFunc) = 0;
+
+    /// Gives a hook whose timing is sampled a latency budget, which is a limit on the 99th
+    /// percentile duration of the calls to it. About once per second, Hookshot checks the calls
+    /// sampled since the previous check, and if a hook exceeds its budget several checks in a row,
+    /// Hookshot disables it exactly as #SetHookGroupEnabled would, emits an event, and removes its
+    /// budget. All of the hooks chained onto the same original function share a histogram and
+    /// therefore a budget, and they are all disabled together. Durations include everything the
+    /// hook function invokes, including the original function. Hooks created while a default
+    /// latency budget is configured in the configuration file are given that budget automatically.
+    /// @param [in] originalOrHookFunc Address of the original function or the hook function
+    /// associated with the hook of interest.
+    /// @param [in] budgetMicroseconds Latency budget in microseconds, or 0 to remove the budget.
+    /// @return Success if the budget was set or removed, NoEffect if the hook exists but its timing
+    /// is not sampled or it has no budget to remove, or an indication of failure otherwise.
+    virtual EResult __fastcall SetHookLatencyBudget(
+        const void* originalOrHookFunc, uint32_t budgetMicroseconds) = 0;
+
+    /// Measures the memory that Hookshot uses to implement inline hooks throughout the process.
+    /// Address table hooks and debug register hooks do not use any of the memory counted here.
+    /// @param [out] footprint Filled with the measurements on success.
+    /// @return Success if the measurements were taken, or an indication of failure otherwise.
+    virtual EResult __fastcall GetMemoryFootprint(SMemoryFootprint* footprint) = 0;
+
+    /// Measures the memory used by each trampoline store, all at once.
+    /// @param [out] storeFootprints Array to receive one element per trampoline store, in order of
+    /// creation. Can be `nullptr` if its capacity is 0, which is useful for just counting them.
+    /// @param [in] maxStoreFootprints Capacity of the array, in elements.
+    /// @param [out] numStores Filled with the total number of trampoline stores, which can exceed
+    /// the capacity, in which case only the first few are measured.
+    /// @return Success if the measurements were taken, or an indication of failure otherwise.
+    virtual EResult __fastcall GetTrampolineStoreFootprints(
+        STrampolineStoreFootprint* storeFootprints,
+        size_t maxStoreFootprints,
+        size_t* numStores) = 0;
+
+    /// Measures the memory used on behalf of hooks in each module, all at once. Only modules near
+    /// which trampoline stores were placed, or which contain original functions that Hookshot
+    /// modified, are included.
+    /// @param [out] moduleFootprints Array to receive one element per module, in order of
+    /// increasing base address. Can be `nullptr` if its capacity is 0, which is useful for just
+    /// counting the modules.
+    /// @param [in] maxModuleFootprints Capacity of the array, in elements.
+    /// @param [out] numModules Filled with the total number of modules, which can exceed the
+    /// capacity, in which case only the first few are measured.
+    /// @return Success if the measurements were taken, or an indication of failure otherwise.
+    virtual EResult __fastcall GetModuleFootprints(
+        SModuleFootprint* moduleFootprints, size_t maxModuleFootprints, size_t* numModules) = 0;
+
+    /// Retrieves a versioned extension of this interface. New functionality is offered through
+    /// versioned interfaces, rather than by adding methods to this one, so that hook modules can
+    /// determine what is available. Hookshot builds that predate this method do not export the
+    /// function named by #kInterfaceVersionProcName, so hook modules that need to work with them
+    /// should check for that export in the module that contains this interface object first.
+    /// @param [in] version Version number of the interface of interest, such as
+    /// #kInterfaceVersion2.
+    /// @return Interface pointer, which must be converted to the type that corresponds to the
+    /// requested version, or `nullptr` if this build of Hookshot does not offer that version. Has
+    /// the same lifetime as this interface pointer.
+    virtual void* __fastcall QueryInterface(uint32_t version) = 0;
+  };
+
+  /// Version number of #IHookshot itself, for use with #IHookshot::QueryInterface.
+  inline constexpr uint32_t kInterfaceVersion1 = 1;
+
+  /// Version number of #IHookshot2, for use with #IHookshot::QueryInterface.
+  inline constexpr uint32_t kInterfaceVersion2 = 2;
+
+  /// Version number of #IHookshot3, for use with #IHookshot::QueryInterface.
+  inline constexpr uint32_t kInterfaceVersion3 = 3;
+
+  /// Version number of #IHookshot4, for use with #IHookshot::QueryInterface.
+  inline constexpr uint32_t kInterfaceVersion4 = 4;
+
+  /// Version number of #IHookshot5, for use with #IHookshot::QueryInterface.
+  inline constexpr uint32_t kInterfaceVersion5 = 5;
+
+  /// Version number of #IHookshot6, for use with #IHookshot::QueryInterface.
+  inline constexpr uint32_t kInterfaceVersion6 = 6;
+
+  /// Version number of #IHookshot7, for use with #IHookshot::QueryInterface.
+  inline constexpr uint32_t kInterfaceVersion7 = 7;
+
+  /// Version number of #IHookshot8, for use with #IHookshot::QueryInterface.
+  inline constexpr uint32_t kInterfaceVersion8 = 8;
+
+  /// Version number of #IHookshot9, for use with #IHookshot::QueryInterface.
+  inline constexpr uint32_t kInterfaceVersion9 = 9;
+
+  /// Version number of #IHookshot10, for use with #IHookshot::QueryInterface.
+  inline constexpr uint32_t kInterfaceVersion10 = 10;
+
+  /// Version number of #IHookshot11, for use with #IHookshot::QueryInterface.
+  inline constexpr uint32_t kInterfaceVersion11 = 11;
+
+  /// Version number of #IHookshot12, for use with #IHookshot::QueryInterface.
+  inline constexpr uint32_t kInterfaceVersion12 = 12;
+
+  /// Version number of #IHookshot13, for use with #IHookshot::QueryInterface.
+  inline constexpr uint32_t kInterfaceVersion13 = 13;
+
+  /// Version number of #IHookshot14, for use with #IHookshot::QueryInterface.
+  inline constexpr uint32_t kInterfaceVersion14 = 14;
+
+  /// Version number of #IHookshot15, for use with #IHookshot::QueryInterface.
+  inline constexpr uint32_t kInterfaceVersion15 = 15;
+
+  /// Highest interface version offered by this build of Hookshot.
+  inline constexpr uint32_t kInterfaceVersionLatest = kInterfaceVersion15;
+
+  /// Second version of the Hookshot interface, obtained via #IHookshot::QueryInterface. Each of its
+  /// methods operates on an array of hooks and does once what would otherwise be done per hook,
+  /// such as acquiring a lock, and lookups avoid taking any lock wherever possible. Failure of an
+  /// operation on one hook does not prevent it from being attempted on the others. Hook modules can
+  /// move to these methods one at a time, since this interface and #IHookshot can be used together
+  /// freely.
+  class IHookshot2
+  {
+  public:
+
+    /// Array version of #IHookshot::GetOriginalFunction. Does not take any locks for inline hooks
+    /// created by their original function addresses.
+    /// @param [in] originalOrHookFuncs Array of addresses of original functions or hook functions.
+    /// @param [in] numFuncs Number of elements in each array.
+    /// @param [out] originalFuncs Array to be filled with the address that invokes the original
+    /// behavior of each function, or `nullptr` for each function that is not hooked.
+    /// @return Success if an address was found for every function, otherwise FailNotFound.
+    virtual EResult __fastcall GetOriginalFunctions(
+        const void* const* originalOrHookFuncs, size_t numFuncs, const void** originalFuncs) = 0;
+
+    /// Array version of #IHookshot::ReplaceHookFunction. All of the hook functions are replaced
+    /// while holding the lock once.
+    /// @param [in] originalOrHookFuncs Array of addresses of either the original function or the
+    /// hook function currently associated with each hook.
+    /// @param [in] newHookFuncs Array of addresses of the new hook functions.
+    /// @param [in] numFuncs Number of elements in each array.
+    /// @param [out] results Optional array to be filled with the result for each hook. May be
+    /// `nullptr` if per-hook results are not needed.
+    /// @return Success if every hook function was replaced, otherwise the result corresponding to
+    /// the first hook whose hook function could not be replaced.
+    virtual EResult __fastcall ReplaceHookFunctions(
+        const void* const* originalOrHookFuncs,
+        const void* const* newHookFuncs,
+        size_t numFuncs,
+        EResult* results) = 0;
+
+    /// Array version of #IHookshot::DisableHookFunction. All of the hook functions are disabled
+    /// while holding the lock once.
+    /// @param [in] originalOrHookFuncs Array of addresses of either the original function or the
+    /// hook function currently associated with each hook.
+    /// @param [in] numFuncs Number of elements in the array.
+    /// @param [out] results Optional array to be filled with the result for each hook. May be
+    /// `nullptr` if per-hook results are not needed.
+    /// @return Success if every hook function was disabled, otherwise the result corresponding to
+    /// the first hook whose hook function could not be disabled.
+    virtual EResult __fastcall DisableHookFunctions(
+        const void* const* originalOrHookFuncs, size_t numFuncs, EResult* results) = 0;
+
+    /// Array version of #IHookshot::GetHookStatistics. All of the statistics are retrieved while
+    /// holding the lock once, in shared mode.
+    /// @param [in] originalOrHookFuncs Array of addresses of the original function or the hook
+    /// function associated with each hook of interest.
+    /// @param [in] numFuncs Number of elements in each array.
+    /// @param [out] statistics Array to be filled with the statistics for each hook. Elements for
+    /// hooks whose statistics could not be retrieved are left unmodified.
+    /// @param [out] results Optional array to be filled with the result for each hook. May be
+    /// `nullptr` if per-hook results are not needed.
+    /// @return Success if statistics were retrieved for every hook, otherwise the result
+    /// corresponding to the first hook for which they could not be retrieved.
+    virtual EResult __fastcall GetHooksStatistics(
+        const void* const* originalOrHookFuncs,
+        size_t numFuncs,
+        SHookStatistics* statistics,
+        EResult* results) = 0;
+
+    /// Array version of #IHookshot::RemoveHook.
+    /// @param [in] originalOrHookFuncs Array of addresses of the original function or the hook
+    /// function associated with each hook to remove.
+    /// @param [in] numFuncs Number of elements in the array.
+    /// @param [out] results Optional array to be filled with the result for each hook. May be
+    /// `nullptr` if per-hook results are not needed.
+    /// @return Success if every hook was removed, otherwise the result corresponding to the first
+    /// hook that could not be removed.
+    virtual EResult __fastcall RemoveHooks(
+        const void* const* originalOrHookFuncs, size_t numFuncs, EResult* results) = 0;
+  };
+
+  /// Third version of the Hookshot interface, obtained via #IHookshot::QueryInterface. Offers
+  /// attribution of hooked calls to the modules that make them.
+  class IHookshot3
+  {
+  public:
+
+    /// Retrieves the modules that made the most recent timed calls to the specified hook. Callers
+    /// are only recorded for hooks whose timing is sampled, and only if caller recording is also
+    /// enabled in the configuration file. Recording a caller costs a few instructions on each
+    /// timed call, and resolving callers to modules is deferred until this method is invoked, so
+    /// modules unloaded in the meantime are reported as `nullptr`. All of the hooks chained onto
+    /// the same original function share a caller histogram.
+    /// @param [in] originalOrHookFunc Address of the original function or the hook function
+    /// associated with the hook of interest.
+    /// @param [out] histogram Filled with the caller histogram on success.
+    /// @return Success if the histogram was retrieved, NoEffect if the hook exists but its callers
+    /// are not recorded, or an indication of failure otherwise.
+    virtual EResult __fastcall GetHookCallerHistogram(
+        const void* originalOrHookFunc, SHookCallerHistogram* histogram) = 0;
+  };
+
+  /// Fourth version of the Hookshot interface, obtained via #IHookshot::QueryInterface. Offers
+  /// instrumentation of whole modules without writing a hook function for each of their functions.
+  class IHookshot4
+  {
+  public:
+
+    /// Instruments every function that a loaded module exports, so that the number of times each
+    /// one is invoked is counted, and optionally its timing sampled. The export table is read once,
+    /// and all of the hooks are created together exactly as if by #IHookshot::CreateHooks. Each
+    /// hook function is a small counting stub that Hookshot generates, which transfers control to
+    /// the original function, so calls are otherwise unaffected. Exports that are forwarded to
+    /// other modules, that are not code, that are already hooked, or whose first instructions are
+    /// too short or cannot be transplanted are skipped. Results are retrieved for each export, by
+    /// its address, using #IHookshot::GetHookStatistics, #IHookshot::GetHookTimingHistogram, or
+    /// #IHookshot::SnapshotHooks, and the hooks can be removed using #IHookshot::RemoveHook.
+    /// @param [in] moduleHandle Handle of the module whose exports should be instrumented, which
+    /// must already be loaded in the current process.
+    /// @param [in] options Selects what is recorded for each export.
+    /// @param [out] numInstrumented Optional location to be filled with the number of exports that
+    /// were instrumented. May be `nullptr` if not needed.
+    /// @return Success if at least one export was instrumented, NoEffect if none of them could be,
+    /// or an indication of failure otherwise.
+    virtual EResult __fastcall InstrumentModuleExports(
+        void* moduleHandle,
+        const SModuleInstrumentationOptions* options,
+        size_t* numInstrumented) = 0;
+  };
+
+  /// Fifth version of the Hookshot interface, obtained via #IHookshot::QueryInterface.
+  class IHookshot5
+  {
+  public:
+
+    /// Creates a hook using whichever kind of hook is estimated to be cheapest for the specified
+    /// function. Each kind that could plausibly hook it is assigned a cost that accounts for the
+    /// overhead it adds to every call, the pages it would make private to this process, the work
+    /// needed to install it, and the extent to which it might miss calls. Kinds are then attempted
+    /// from cheapest to most expensive until one succeeds. As a result, an inline hook is usually
+    /// chosen, but a hook that would be the only modification to an otherwise-untouched page may be
+    /// placed in import address tables instead, and a function too short to be hooked inline may be
+    /// hooked using a debug address register. Export address table hooks are chosen only if no
+    /// other kind succeeds. The hook is identified and removed just like one created using
+    /// #IHookshot::CreateHookWithKind with the chosen kind.
+    /// @param [in] originalFunc Address of the function that should be hooked.
+    /// @param [in] hookFunc Hook function that should be invoked instead of the original function.
+    /// @param [out] chosenKind Optional location to be filled with the kind of hook that was
+    /// created, if one was. May be `nullptr` if not needed.
+    /// @return Result of attempting the last kind of hook, which is an indication of success if and
+    /// only if a hook was created.
+    virtual EResult __fastcall CreateHookAuto(
+        void* originalFunc, const void* hookFunc, EHookKind* chosenKind) = 0;
+  };
+
+  /// Sixth version of the Hookshot interface, obtained via #IHookshot::QueryInterface.
+  class IHookshot6
+  {
+  public:
+
+    /// Seals the current set of hooks, for processes that are done creating and modifying hooks
+    /// and from then on only look them up. The table that #IHookshot::GetOriginalFunction consults
+    /// is snapshotted into an immutable table indexed by a perfect hash function, so that each
+    /// lookup takes no lock and reads exactly one slot, which never straddles a cache line. Hooks
+    /// can still be created, modified, and removed afterwards, but the first such change unseals
+    /// the hooks, and lookups go back to the general-purpose table until this method is invoked
+    /// again. Each invocation retains a snapshot for the lifetime of the process, so this method
+    /// should not be invoked frequently.
+    /// @return Success if the hooks are now sealed, NoEffect if they were already sealed, or an
+    /// indication of failure otherwise.
+    virtual EResult __fastcall Seal(void) = 0;
+  };
+
+  /// Seventh version of the Hookshot interface, obtained via #IHookshot::QueryInterface. Offers
+  /// hooks that remove themselves after the first call.
+  class IHookshot7
+  {
+  public:
+
+    /// Creates a hook that is invoked for only the first call to the original function, for hooks
+    /// that capture something once, such as a pointer or a configuration value passed to an
+    /// initialization function. Exactly one call reaches the hook function, even if several threads
+    /// make the first call at once, and every other call invokes the original function directly.
+    /// The hook function can therefore invoke the original function using its own address rather
+    /// than one obtained from #IHookshot::GetOriginalFunction. Shortly after the first call, the
+    /// hook is removed and the original function is restored, after which calls to it cost nothing
+    /// extra. If other hooks are chained onto the same original function, the one-shot hook is
+    /// disabled rather than removed so that they remain.
+    /// @param [in] originalFunc Address of the function that should be hooked.
+    /// @param [in] hookFunc Hook function that should be invoked for the first call.
+    /// @return Result of the operation.
+    virtual EResult __fastcall CreateOneShotHook(void* originalFunc, const void* hookFunc) = 0;
+  };
+
+  /// Eighth version of the Hookshot interface, obtained via #IHookshot::QueryInterface. Offers
+  /// invalidation of hooks on code that is about to be discarded or reused.
+  class IHookshot8
+  {
+  public:
+
+    /// Invalidates every hook whose original function lies within a range of code that is about to
+    /// be discarded or reused, such as code generated at runtime by a just-in-time compiler. Each
+    /// such hook is removed, along with any hooks chained onto the same original function, but the
+    /// original function is not written to, so the range may already be freed. Trampolines are
+    /// freed for reuse by later hooks once no thread can be executing them. Must be invoked before
+    /// any new code placed within the range can be executed.
+    /// @param [in] rangeBase Address of the beginning of the code range.
+    /// @param [in] rangeSizeBytes Size of the code range, in bytes.
+    /// @return Success if every hook within the range was invalidated, NoEffect if there were no
+    /// hooks within the range, or an indication of failure otherwise.
+    virtual EResult __fastcall InvalidateCodeRange(
+        const void* rangeBase, size_t rangeSizeBytes) = 0;
+  };
+
+  /// Ninth version of the Hookshot interface, obtained via #IHookshot::QueryInterface. Offers the
+  /// engine that transplants code into trampolines for use on other code.
+  class IHookshot9
+  {
+  public:
+
+    /// Relocates whole instructions from one location to another, so that they behave the same at
+    /// the destination as they did at the source, for code that copies instructions out of a
+    /// function, such as probes and code caches. This is the same engine that transplants code out
+    /// of original functions and into trampolines. Branches and position-relative data accesses are
+    /// adjusted for their new locations, except those that refer to other relocated instructions.
+    /// Branches whose targets are out of range go through jump assists, and data accesses whose
+    /// targets are out of range are rewritten to use absolute addresses, both of which are placed
+    /// at the very end of the destination. Instructions are relocated until at least the minimum
+    /// number of bytes is covered or, by default, until a terminal instruction is relocated. Unless
+    /// the last relocated instruction is terminal, a jump back to the next source instruction
+    /// follows by default. The destination must be the location from which the relocated code will
+    /// execute, must be writable, and must be within reach of a 32-bit displacement of the source.
+    /// The instruction cache is flushed for the destination.
+    /// @param [in] src Address of the first instruction to relocate.
+    /// @param [in] minBytes Minimum number of bytes of source code to relocate.
+    /// @param [out] dst Address to which the relocated code should be written.
+    /// @param [in] dstCapacity Number of bytes available at the destination.
+    /// @param [in] options Combination of `kRelocateCodeOption` values, or 0 for default behavior.
+    /// @param [out] relocated Optional location to be filled with a description of the relocated
+    /// code, if relocation succeeds. May be `nullptr` if not needed.
+    /// @return Success if the code was relocated, FailInvalidArgument if an argument is invalid or
+    /// the source code cannot be decoded, or FailCannotSetHook if the code cannot be relocated to
+    /// the destination, in which case the contents of the destination are undefined.
+    virtual EResult __fastcall RelocateCode(
+        const void* src,
+        size_t minBytes,
+        void* dst,
+        size_t dstCapacity,
+        uint32_t options,
+        SRelocatedCode* relocated) = 0;
+  };
+
+  /// Tenth version of the Hookshot interface, obtained via #IHookshot::QueryInterface. Offers
+  /// creation of a hook together with retrieval of its original function.
+  class IHookshot10
+  {
+  public:
+
+    /// Combines #IHookshot::CreateHook with #IHookshot::GetOriginalFunction, for hook modules that
+    /// need the address of the original function as soon as the hook is created. The address is
+    /// taken from the hook that was just created, so it is correct even if the hook was chained
+    /// onto existing hooks or placed on the target of a jump thunk, and retrieving it involves
+    /// neither a second call through this interface nor a second lookup by the caller.
+    /// @param [in] originalFunc Address of the function that should be hooked.
+    /// @param [in] hookFunc Hook function that should be invoked instead of the original function.
+    /// @param [out] originalFuncOut Optional location to be filled with the address that invokes
+    /// the original function from the perspective of the new hook, if the hook is created. May be
+    /// `nullptr` if not needed.
+    /// @param [out] handleOut Optional location to be filled with a handle that identifies the new
+    /// hook, if it is created. May be `nullptr` if not needed.
+    /// @return Result of the operation, which is the same as that of #IHookshot::CreateHook.
+    virtual EResult __fastcall CreateHookEx(
+        void* originalFunc,
+        const void* hookFunc,
+        const void** originalFuncOut,
+        HookHandle* handleOut) = 0;
+  };
+
+  /// Eleventh version of the Hookshot interface, obtained via #IHookshot::QueryInterface. Offers
+  /// opaque handles that identify individual hooks.
+  class IHookshot11
+  {
+  public:
+
+    /// Retrieves the handle that identifies an existing inline hook, for hooks that were created
+    /// without obtaining one.
+    /// @param [in] originalOrHookFunc Address of either the original function or the hook function
+    /// currently associated with the hook.
+    /// @param [out] handle Filled with the handle on success.
+    /// @return Success if the handle was retrieved, or an indication of failure otherwise.
+    virtual EResult __fastcall GetHookHandle(
+        const void* originalOrHookFunc, HookHandle* handle) = 0;
+
+    /// Handle version of #IHookshot::ReplaceHookFunction. Locates the hook without looking up any
+    /// function address.
+    /// @param [in] handle Handle that identifies the hook.
+    /// @param [in] newHookFunc Address of the new hook function.
+    /// @return Result of the operation, which is FailNotFound if the handle does not identify an
+    /// existing hook.
+    virtual EResult __fastcall ReplaceHookFunctionByHandle(
+        HookHandle handle, const void* newHookFunc) = 0;
+
+    /// Handle version of #IHookshot::DisableHookFunction. Locates the hook without looking up any
+    /// function address. The hook can be re-enabled using #ReplaceHookFunctionByHandle with the
+    /// same handle.
+    /// @param [in] handle Handle that identifies the hook.
+    /// @return Result of the operation, which is FailNotFound if the handle does not identify an
+    /// existing hook.
+    virtual EResult __fastcall DisableHookFunctionByHandle(HookHandle handle) = 0;
+
+    /// Handle version of #IHookshot::GetHookStatistics. Locates the hook without looking up any
+    /// function address.
+    /// @param [in] handle Handle that identifies the hook.
+    /// @param [out] statistics Filled with the statistics on success.
+    /// @return Result of the operation, which is FailNotFound if the handle does not identify an
+    /// existing hook.
+    virtual EResult __fastcall GetHookStatisticsByHandle(
+        HookHandle handle, SHookStatistics* statistics) = 0;
+  };
+
+  /// Twelfth version of the Hookshot interface, obtained via #IHookshot::QueryInterface. Offers
+  /// hooking of functions by the names they have in debugging symbols.
+  class IHookshot12
+  {
+  public:
+
+    /// Creates hooks on multiple functions within the same loaded module, identified by the names
+    /// they have in the module's debugging symbols, so that functions which are not exported can be
+    /// hooked by name. Names are looked up in a symbol index file created ahead of time by the
+    /// HookshotSymbolIndex tool, which records the relative virtual address of every function in
+    /// particular builds of modules. The file is memory-mapped once per process and each name is
+    /// located by binary search, so no debugging symbols are loaded. The hooks are then created
+    /// together exactly as if by #IHookshot::CreateHooks.
+    /// @param [in] symbolIndexFilename Name of the symbol index file.
+    /// @param [in] moduleHandle Handle of the module that contains the functions to be hooked,
+    /// which must already be loaded in the current process.
+    /// @param [in] symbolNames Array of names of functions that should be hooked, exactly as they
+    /// appear in the symbol index file.
+    /// @param [in] hookFuncs Array of hook functions, one per function name, that should be
+    /// invoked instead of the named functions.
+    /// @param [in] numHooks Number of elements in the symbol name and hook function arrays.
+    /// @param [out] results Optional array, with the same number of elements as the symbol name
+    /// array, to be filled with the result of creating each individual hook. Names that cannot be
+    /// found, including all of them if the symbol index file does not exist or does not contain
+    /// this build of the module, have a result of FailNotFound. May be `nullptr` if per-hook
+    /// results are not needed.
+    /// @return Success if every hook was created, otherwise the result corresponding to the first
+    /// hook that could not be created.
+    virtual EResult __fastcall CreateHooksBySymbol(
+        const wchar_t* symbolIndexFilename,
+        void* moduleHandle,
+        const char* const* symbolNames,
+        const void* const* hookFuncs,
+        size_t numHooks,
+        EResult* results) = 0;
+  };
+
+  /// Thirteenth version of the Hookshot interface, obtained via #IHookshot::QueryInterface. Offers
+  /// hooks that are invoked for only some of the calls to their original functions.
+  class IHookshot13
+  {
+  public:
+
+    /// Creates a hook that is invoked for only one out of every so many calls to the original
+    /// function, for tracing functions that are called too often for every call to be observed.
+    /// All other calls invoke the original function directly, so their only extra cost is a
+    /// decrement and a predictable branch. The countdown to the next sampled call is shared by all
+    /// threads and is not updated atomically, so under contention the interval between sampled
+    /// calls is approximate. The hook function must invoke the original function using the address
+    /// obtained by passing the original function address to #IHookshot::GetOriginalFunction. If the
+    /// SampledHookInterval configuration setting is present, its value is used in place of the
+    /// requested interval for every sampled hook.
+    /// @param [in] originalFunc Address of the function that should be hooked.
+    /// @param [in] hookFunc Hook function that should be invoked for sampled calls.
+    /// @param [in] sampleInterval Number of calls per call that reaches the hook function. Must be
+    /// non-zero and no greater than the largest signed 32-bit value.
+    /// @return Result of the operation.
+    virtual EResult __fastcall CreateSampledHook(
+        void* originalFunc, const void* hookFunc, uint32_t sampleInterval) = 0;
+
+    /// Changes the number of calls per call that reaches the hook function of every sampled hook
+    /// created for the specified original function. Takes effect immediately.
+    /// @param [in] originalFunc Address of the original function of the sampled hook.
+    /// @param [in] sampleInterval Number of calls per call that reaches the hook function. Must be
+    /// non-zero and no greater than the largest signed 32-bit value.
+    /// @return Success if the interval was changed, NoEffect if it was already set as requested,
+    /// FailNotFound if no sampled hook exists for the original function, or an indication of
+    /// failure otherwise.
+    virtual EResult __fastcall SetSampledHookInterval(
+        const void* originalFunc, uint32_t sampleInterval) = 0;
+  };
+
+  /// Fourteenth version of the Hookshot interface, obtained via #IHookshot::QueryInterface. Offers
+  /// examination of whether and how a function could be hooked, without hooking it.
+  class IHookshot14
+  {
+  public:
+
+    /// Determines whether and how the specified function could be hooked, without creating a hook,
+    /// allocating trampoline memory, or modifying anything. The beginning of the function is
+    /// decoded and its instructions are examined exactly as #IHookshot::CreateHook would, and
+    /// each kind of hook is assigned the same estimated cost as in #IHookshot5::CreateHookAuto,
+    /// assuming the hook function is reached through a trampoline. Useful for filtering a large
+    /// number of candidate functions before creating any hooks. The result reflects the current
+    /// state of the hooks, so it can be invalidated by any hook subsequently created or removed.
+    /// @param [in] originalFunc Address of the function that would be hooked.
+    /// @param [out] feasibility Filled with a description of how the function could be hooked.
+    /// @return Success if at least one kind of hook could plausibly hook the function,
+    /// FailCannotSetHook if none could, or an indication of failure otherwise.
+    virtual EResult __fastcall CanHook(const void* originalFunc, SHookFeasibility* feasibility) = 0;
+
+  };
+
+  /// Fifteenth version of the Hookshot interface, obtained via #IHookshot::QueryInterface. Offers
+  /// examination of how effectively the hook plan cache is being used.
+  class IHookshot15
+  {
+  public:
+
+    /// Retrieves the number of hook plan cache lookups, hits, and recorded hook plans since this
+    /// process started. The hook plan cache is used only if enabled by the configuration file.
+    /// @param [out] statistics Filled with the hook plan cache statistics.
+    /// @return Success if the hook plan cache is enabled, NoEffect if it is disabled, in which
+    /// case all of the statistics are 0, or an indication of failure otherwise.
+    virtual EResult __fastcall GetHookPlanCacheStatistics(SHookPlanCacheStatistics* statistics) = 0;
   };
 } // namespace Hookshot
@@ -0,0 +1,66 @@
+/***************************************************************************************************
+ * Hookshot
+ *   General-purpose library for injecting DLLs and hooking function calls.
+ ***************************************************************************************************
+ * Authored by Samuel Grossman
+ * Copyright (c) 2019-2025
+ ***********************************************************************************************//**
+ * @file AddressTableHooks.h
+ *   Interface declaration for hooks that rewrite entries in module import and export address
+ *   tables rather than modifying the code of the original function.
+ **************************************************************************************************/
+
+#pragma once
+
+#include "ApiWindows.h"
+#include "HookshotTypes.h"
+
+namespace Hookshot
+{
+  namespace AddressTableHooks
+  {
+    /// Creates a hook by rewriting address table entries that refer to the original function.
+    /// @param [in] hookKind Kind of hook to create. Must identify an address table hook kind.
+    /// @param [in] originalFunc Address of the function that should be hooked.
+    /// @param [in] hookFunc Hook function that should be invoked instead of the original function.
+    /// @param [in] importingModule For import address table hooks, the only module whose import
+    /// address table should be rewritten, or `nullptr` to rewrite the import address tables of all
+    /// modules loaded in the process other than Hookshot itself. Ignored for other kinds.
+    /// @return Result of the operation.
+    EResult CreateAddressTableHook(
+        EHookKind hookKind, void* originalFunc, const void* hookFunc, HMODULE importingModule);
+
+    /// Creates hooks by rewriting entries of a single virtual function table, all in one batch.
+    /// Entries that share a page are written together with a single protection change.
+    /// @param [in] virtualTable Address of the virtual function table.
+    /// @param [in] slotIndices Array of indices of the virtual function table entries to rewrite.
+    /// @param [in] hookFuncs Array of hook functions, one per entry.
+    /// @param [in] numHooks Number of elements in the slot index and hook function arrays.
+    /// @param [in,out] results Array, with the same number of elements as the slot index array,
+    /// of results for each hook. Hooks whose results are already failures on input are skipped,
+    /// which allows callers to reject some of them in advance. Must not be `nullptr`.
+    /// @return Success if every hook was created, otherwise the result corresponding to the first
+    /// hook that could not be created.
+    EResult CreateVirtualTableHooks(
+        void* virtualTable,
+        const size_t* slotIndices,
+        const void* const* hookFuncs,
+        size_t numHooks,
+        EResult* results);
+
+    /// Retrieves the address that invokes the original behavior of a function hooked by an
+    /// address table hook, which is just the original function itself because its code is never
+    /// modified. Does not take any locks if there are no address table hooks.
+    /// @param [in] originalOrHookFunc Address of either the original function or the hook
+    /// function associated with the hook.
+    /// @return Address of the original function, or `nullptr` if no address table hook matches.
+    const void* GetOriginalFunction(const void* originalOrHookFunc);
+
+    /// Removes an address table hook by restoring every address table entry it rewrote, unless
+    /// something else has since rewritten that entry again.
+    /// @param [in] originalOrHookFunc Address of either the original function or the hook
+    /// function associated with the hook.
+    /// @return Result of the operation.
+    EResult RemoveAddressTableHook(const void* originalOrHookFunc);
+  } // namespace AddressTableHooks
+} // namespace Hookshot
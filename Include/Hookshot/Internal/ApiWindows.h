@@ -12,6 +12,16 @@
 
 #pragma once
 
+// Hookshot generates, decodes, and relocates x86 and x64 machine code, and its injection payload is
+// written in x86 and x64 assembly. Arm64Instruction can relocate ARM64 instructions and encode
+// trampolines, but it is built only into the tests, because nothing else uses it yet and the hook
+// stubs, trampolines, and injection payload exist only for x86 and x64. Building for ARM64 or
+// ARM64EC is therefore rejected outright rather than producing a library that cannot hook anything.
+// On ARM64 systems, the x64 build hooks x64 processes running under emulation.
+#if defined(_M_ARM64) || defined(_M_ARM64EC)
+#error "Hookshot supports only x86 and x64 targets."
+#endif
+
 // Windows header files are sensitive to include order. Compilation will fail if the order is
 // incorrect. Top-level macros and headers must come first, followed by headers for other parts
 // of system functionality.
@@ -28,6 +38,7 @@
 #include <psapi.h>
 #include <shlobj.h>
 #include <shlwapi.h>
+#include <tlhelp32.h>
 
 namespace Hookshot
 {
@@ -41,4 +52,14 @@ namespace Hookshot
   /// @return Recommended address to use for the Windows API function, which could be the same as
   /// the static address.
   void* GetWindowsApiFunctionAddress(const char* const funcName, void* const funcStaticAddress);
+
+  /// Retrieves the proper addresses of multiple Windows API functions at once, as if by invoking
+  /// #GetWindowsApiFunctionAddress for each of them. The export table of each lower-level binary is
+  /// located and validated only once for all of the functions.
+  /// @param [in] funcNames API function names.
+  /// @param [in, out] funcAddresses On input, the static address of each function. On output, the
+  /// recommended address to use for each function, which could be the same as its static address.
+  /// @param [in] numFuncs Number of functions.
+  void GetWindowsApiFunctionAddresses(
+      const char* const* funcNames, void** funcAddresses, size_t numFuncs);
 } // namespace Hookshot
@@ -0,0 +1,231 @@
+/***************************************************************************************************
+ * Hookshot
+ *   General-purpose library for injecting DLLs and hooking function calls.
+ ***************************************************************************************************
+ * Authored by Samuel Grossman
+ * Copyright (c) 2019-2025
+ ***********************************************************************************************//**
+ * @file Arm64Instruction.h
+ *   Declaration of functionality for manipulating binary ARM64 instructions.
+ **************************************************************************************************/
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+namespace Hookshot
+{
+  /// Decodes and relocates ARM64 instructions. Every ARM64 instruction is 4 bytes long, and only a
+  /// few forms depend on their own position: `adr`, `adrp`, loads from a literal pool, and relative
+  /// branches. Relocating any other instruction is just a matter of copying it. A
+  /// position-dependent instruction whose target is out of reach from its new location is replaced
+  /// by an equivalent sequence that holds its absolute target in an inline literal. Such sequences
+  /// follow the platform's conventions for branch veneers, so they use only the
+  /// intra-procedure-call scratch registers `x16` and `x17`, and only where the instruction does
+  /// not have a destination register of its own that can be used instead. Nothing here depends on
+  /// the processor architecture of the running process, which is what allows this functionality to
+  /// be tested on any architecture.
+  class Arm64Instruction
+  {
+  public:
+
+    /// Length of every ARM64 instruction, in bytes.
+    static constexpr int kInstructionLengthBytes = 4;
+
+    /// Length of an unconditional jump instruction, in bytes, as written by #WriteJumpInstruction.
+    static constexpr int kJumpInstructionLengthBytes = kInstructionLengthBytes;
+
+    /// Length of an absolute jump sequence, in bytes, as written by #WriteAbsoluteJumpInstruction.
+    /// Consists of `ldr x16, #8` and `br x16` followed by the 64-bit target address.
+    static constexpr int kAbsoluteJumpInstructionLengthBytes =
+        (2 * kInstructionLengthBytes) + sizeof(uint64_t);
+
+    /// Maximum length of the instruction sequence that #EncodeInstruction writes for a single
+    /// instruction, in bytes. Consists of three instructions and a 64-bit literal.
+    static constexpr int kMaxRelocatedLengthBytes =
+        (3 * kInstructionLengthBytes) + sizeof(uint64_t);
+
+    /// Encoding of `nop`.
+    static constexpr uint32_t kNopInstruction = 0xd503201f;
+
+    /// Enumerates the position-dependent forms of instruction that require more than copying to
+    /// relocate.
+    enum class EPositionDependentKind : uint8_t
+    {
+      /// Instruction does not depend on its position.
+      None,
+
+      /// `adr`, which computes an address within 1 MB.
+      Adr,
+
+      /// `adrp`, which computes the address of a 4 kB page within 4 GB.
+      Adrp,
+
+      /// `ldr` or `ldrsw` from a literal within 1 MB, into a general-purpose or SIMD register.
+      LoadLiteral,
+
+      /// `prfm` of a literal within 1 MB, which is only a hint.
+      PrefetchLiteral,
+
+      /// `b`, which branches within 128 MB. Also used for `b.al` and `b.nv`, which always branch.
+      Branch,
+
+      /// `bl`, which calls a function within 128 MB.
+      BranchWithLink,
+
+      /// `b.cond`, which branches within 1 MB if a condition holds.
+      ConditionalBranch,
+
+      /// `cbz` or `cbnz`, which branch within 1 MB depending on whether a register is zero.
+      CompareAndBranch,
+
+      /// `tbz` or `tbnz`, which branch within 32 kB depending on a single bit of a register.
+      TestAndBranch
+    };
+
+    Arm64Instruction(void);
+
+    /// Determines if a jump instruction can be assembled from the specified location to the
+    /// specified location.
+    /// @param [in] from Proposed address of the jump instruction itself.
+    /// @param [in] to Proposed target address of the jump instruction.
+    /// @return `true` if possible, `false` if not.
+    static bool CanWriteJumpInstruction(const void* const from, const void* const to);
+
+    /// Fills the specified buffer with `nop` instructions.
+    /// @param [out] buf Buffer to which `nop` instructions should be written.
+    /// @param [in] numBytes Size of the buffer to fill, in bytes, which must be a multiple of the
+    /// instruction length.
+    static void FillWithNop(void* const buf, const size_t numBytes);
+
+    /// Relocates enough whole instructions from the beginning of the specified code to cover at
+    /// least the specified number of bytes, and then writes a jump back to the first instruction
+    /// that was not relocated. No jump back is written if an instruction that unconditionally
+    /// transfers control elsewhere is reached first, in which case relocation stops there. This
+    /// is what the part of a trampoline that invokes the original function consists of.
+    /// @param [in] src Address of the code to relocate, which must be 4-byte aligned.
+    /// @param [in] minLengthBytes Minimum number of bytes of code to relocate.
+    /// @param [out] dst Buffer to which the relocated code is written, where it will execute.
+    /// @param [in] dstSizeBytes Number of bytes available in the buffer.
+    /// @param [out] numRelocatedBytes Optionally filled with the number of bytes of code relocated
+    /// from the source, which is less than the minimum if relocation stopped early.
+    /// @return Number of bytes written, or 0 on failure due to the buffer being too small.
+    static int TransplantInstructions(
+        const void* const src,
+        const int minLengthBytes,
+        void* const dst,
+        const int dstSizeBytes,
+        int* const numRelocatedBytes = nullptr);
+
+    /// Places an unconditional jump instruction at the specified location.
+    /// @param [out] where Buffer to which the jump instruction should be written.
+    /// @param [in] whereSizeBytes Number of bytes available for writing the jump instruction.
+    /// @param [in] to Target address of the jump instruction.
+    /// @return `true` on success, `false` on failure due to the buffer being too small or the
+    /// jump target being too far for a `b` instruction.
+    static bool WriteJumpInstruction(
+        void* const where, const int whereSizeBytes, const void* const to);
+
+    /// Places an absolute jump sequence at the specified location, which can reach any target
+    /// address. Supplied buffer must be large enough to hold #kAbsoluteJumpInstructionLengthBytes
+    /// bytes.
+    /// @param [out] where Buffer to which the jump sequence should be written.
+    /// @param [in] whereSizeBytes Number of bytes available for writing the jump sequence.
+    /// @param [in] to Target address of the jump sequence.
+    /// @return `true` on success, `false` on failure due to the buffer being too small.
+    static bool WriteAbsoluteJumpInstruction(
+        void* const where, const int whereSizeBytes, const void* const to);
+
+    /// Attempts to decode the instruction at the specified address.
+    /// @param [in] instruction Address of the instruction to decode, which must be 4-byte aligned.
+    /// @return `true` on success, `false` on failure.
+    bool DecodeInstruction(const void* const instruction);
+
+    /// Decodes an instruction whose encoding has already been read, as if it were located at the
+    /// specified address.
+    /// @param [in] instructionEncoding Binary representation of the instruction.
+    /// @param [in] instruction Address at which the instruction is located, which must be 4-byte
+    /// aligned.
+    /// @return `true` on success, `false` on failure.
+    bool DecodeInstruction(const uint32_t instructionEncoding, const void* const instruction);
+
+    /// Attempts to encode this instruction to the specified address, adjusting or replacing it as
+    /// needed so that it behaves exactly as it would have at its original address. Instructions
+    /// that do not depend on their position are copied.
+    /// @param [out] buf Destination buffer.
+    /// @param [in] maxLengthBytes Maximum allowed encoding length, in bytes. Relocation never needs
+    /// more than #kMaxRelocatedLengthBytes.
+    /// @param [in] executionAddress Address at which the encoded instructions will execute, or
+    /// `nullptr` if they will execute in the destination buffer itself.
+    /// @return Number of bytes written on success, 0 on failure due to the buffer being too small
+    /// or this instruction being invalid.
+    int EncodeInstruction(
+        void* const buf,
+        const int maxLengthBytes = kMaxRelocatedLengthBytes,
+        const void* const executionAddress = nullptr) const;
+
+    /// If this instruction contains a position-dependent reference, computes and returns the
+    /// absolute address to which it refers. For `adrp` this is the address of the page.
+    /// @return Absolute target address, or `nullptr` if either this instruction is invalid or no
+    /// such reference exists.
+    void* GetAbsoluteMemoryReferenceTarget(void) const;
+
+    /// Retrieves and returns the original location in memory of this instruction.
+    /// @return Original address of this instruction, or `nullptr` if it is invalid.
+    inline const void* GetAddress(void) const
+    {
+      return address;
+    }
+
+    /// Retrieves and returns the binary representation of this instruction.
+    /// @return Binary representation of this instruction.
+    inline uint32_t GetEncoding(void) const
+    {
+      return encoding;
+    }
+
+    /// Retrieves and returns the form of position-dependent reference this instruction makes.
+    /// @return Form of position-dependent reference, which is `None` if the instruction does not
+    /// make one or is invalid.
+    inline EPositionDependentKind GetPositionDependentKind(void) const
+    {
+      return positionDependentKind;
+    }
+
+    /// Determines if this instruction makes a reference whose target depends on its position.
+    /// @return `true` if so, `false` otherwise or if this instruction is invalid.
+    inline bool HasPositionDependentMemoryReference(void) const
+    {
+      return (EPositionDependentKind::None != positionDependentKind);
+    }
+
+    /// Determines if this instruction makes a reference, in the form of a relative branch
+    /// displacement, whose target depends on its position.
+    /// @return `true` if so, `false` otherwise or if this instruction is invalid.
+    bool HasRelativeBranchDisplacement(void) const;
+
+    /// Determines if this instruction unconditionally transfers control somewhere other than the
+    /// next instruction without returning, as do `b`, `br`, and `ret`.
+    /// @return `true` if so, `false` otherwise or if this instruction is invalid.
+    bool IsTerminal(void) const;
+
+    /// Determines if this object holds a valid instruction.
+    /// @return `true` if so, `false` otherwise.
+    inline bool IsValid(void) const
+    {
+      return (nullptr != address);
+    }
+
+  private:
+
+    /// Original address of the instruction, or `nullptr` if no instruction has been decoded.
+    const void* address;
+
+    /// Binary representation of the instruction.
+    uint32_t encoding;
+
+    /// Form of position-dependent reference that the instruction makes.
+    EPositionDependentKind positionDependentKind;
+  };
+} // namespace Hookshot
@@ -0,0 +1,52 @@
+/***************************************************************************************************
+ * Hookshot
+ *   General-purpose library for injecting DLLs and hooking function calls.
+ ***************************************************************************************************
+ * Authored by Samuel Grossman
+ * Copyright (c) 2019-2025
+ ***********************************************************************************************//**
+ * @file AsyncHookInstall.h
+ *   Interface declaration for installing large numbers of hooks in the background, with progress
+ *   reporting and cancellation.
+ **************************************************************************************************/
+
+#pragma once
+
+#include <cstddef>
+
+#include "HookshotTypes.h"
+
+namespace Hookshot
+{
+  namespace AsyncHookInstall
+  {
+    /// Starts an asynchronous hook installation operation on a task scheduler worker thread. If no
+    /// worker thread could be created, the entire operation runs on the calling thread instead.
+    /// @param [in] hookshot Interface through which hooks are created and undone.
+    /// @param [in] hookSpecs Array of hook specifications, one per hook to create.
+    /// @param [in] numHookSpecs Number of elements in the hook specification array.
+    /// @param [in] progressCallback Optional function to invoke after each batch.
+    /// @param [in] progressCallbackContext Value to pass to the progress callback.
+    /// @param [out] operation Filled with the object that represents the operation on success.
+    /// @return Result of the operation.
+    EResult Begin(
+        IHookshot* hookshot,
+        const SHookSpec* hookSpecs,
+        size_t numHookSpecs,
+        THookInstallProgressCallback progressCallback,
+        void* progressCallbackContext,
+        SHookInstallOperation** operation);
+
+    /// Requests that an asynchronous hook installation operation be cancelled.
+    /// @param [in] operation Operation to cancel.
+    /// @return Result of the operation.
+    EResult Cancel(SHookInstallOperation* operation);
+
+    /// Waits for an asynchronous hook installation operation to complete, retrieves its results,
+    /// and destroys it.
+    /// @param [in] operation Operation to wait for.
+    /// @param [out] results Optional array to be filled with per-hook results.
+    /// @return Overall result of the operation.
+    EResult Wait(SHookInstallOperation* operation, EResult* results);
+  } // namespace AsyncHookInstall
+} // namespace Hookshot
@@ -0,0 +1,32 @@
+/***************************************************************************************************
+ * Hookshot
+ *   General-purpose library for injecting DLLs and hooking function calls.
+ ***************************************************************************************************
+ * Authored by Samuel Grossman
+ * Copyright (c) 2019-2025
+ ***********************************************************************************************//**
+ * @file BatchLaunch.h
+ *   Creation and injection of many programs, listed in a manifest file, from a single process.
+ **************************************************************************************************/
+
+#pragma once
+
+#include <string_view>
+
+namespace Hookshot
+{
+  namespace BatchLaunch
+  {
+    /// Launches and injects every command line listed in a manifest file, keeping at most the
+    /// specified number of launched programs running at a time, and waits for all of them to exit.
+    /// The manifest contains one complete command line per line, including the executable, encoded
+    /// as either UTF-8 or UTF-16 with a byte order mark. Blank lines and lines that begin with `;`
+    /// are skipped. Everything that injection computes once per injecting process, such as the
+    /// injected code, the addresses of the functions it calls, and authorization decisions, is
+    /// reused for every launch. The result of each launch is written to the log.
+    /// @param [in] maxConcurrentLaunches Maximum number of launched programs running at a time.
+    /// @param [in] manifestFilename Name of the manifest file.
+    /// @return Exit code from this program.
+    int Run(unsigned int maxConcurrentLaunches, std::wstring_view manifestFilename);
+  } // namespace BatchLaunch
+} // namespace Hookshot
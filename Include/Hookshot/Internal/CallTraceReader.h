@@ -0,0 +1,74 @@
+/***************************************************************************************************
+ * Hookshot
+ *   General-purpose library for injecting DLLs and hooking function calls.
+ ***************************************************************************************************
+ * Authored by Samuel Grossman
+ * Copyright (c) 2019-2025
+ ***********************************************************************************************//**
+ * @file CallTraceReader.h
+ *   Interface declaration for draining the calls that call trace hooks record into the per-thread
+ *   ring buffers of another process's call trace section, without otherwise interacting with that
+ *   process.
+ **************************************************************************************************/
+
+#pragma once
+
+#include <cstdint>
+#include <vector>
+
+#include "CallTracing.h"
+
+namespace Hookshot
+{
+  namespace CallTraceReader
+  {
+    /// Position up to which each per-thread ring buffer of a call trace section has been drained.
+    /// Must be zero-initialized before the first drain and then passed to every subsequent drain of
+    /// the same section.
+    struct SDrainState
+    {
+      /// Write offset of the next record to drain from each per-thread ring buffer.
+      uint64_t nextRecordOffsets[CallTracing::kMaxThreadBuffers];
+
+      /// Total number of records that were overwritten by their recording threads before they
+      /// could be drained.
+      uint64_t numRecordsLost;
+    };
+
+    /// Single call drained from a call trace section.
+    struct SDrainedRecord
+    {
+      /// Identifier of the thread that owned the ring buffer when the record was drained. Because
+      /// ring buffers are given to other threads once their owning threads exit, this is 0 if the
+      /// buffer was unowned, and might occasionally identify a later owner.
+      uint32_t threadId;
+
+      /// Index of the per-thread ring buffer from which the record was drained.
+      uint32_t threadBufferIndex;
+
+      /// Copy of the record.
+      CallTracing::SRecord record;
+    };
+
+    /// Determines if a mapped view of a call trace section has the layout this reader expects.
+    /// @param [in] header Header at the beginning of a mapped view of the section.
+    /// @return `true` if so, `false` if the section is not yet initialized or has a different
+    /// layout, such as one recorded by a different version of Hookshot.
+    bool IsSectionLayoutValid(const CallTracing::SHeader* header);
+
+    /// Copies every record that has been completely written into a call trace section since the
+    /// previous drain, and advances the drain state past them. Records are read while their
+    /// recording threads keep writing, so any record that might have been overwritten while it was
+    /// being copied is discarded and counted as lost. The most recent record in a ring buffer whose
+    /// owning thread is still running might be incomplete, so it is left for the next drain.
+    /// Neither locks nor otherwise interferes with the recording process.
+    /// @param [in] header Header at the beginning of a mapped view of the section.
+    /// @param [in,out] drainState Position up to which each ring buffer has been drained.
+    /// @param [out] drainedRecords Filled with copies of the drained records, ordered by timestamp.
+    /// @return `true` on success, `false` if the section has an unexpected layout.
+    bool DrainRecords(
+        const CallTracing::SHeader* header,
+        SDrainState* drainState,
+        std::vector<SDrainedRecord>* drainedRecords);
+  } // namespace CallTraceReader
+} // namespace Hookshot
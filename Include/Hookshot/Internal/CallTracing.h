@@ -0,0 +1,175 @@
+/***************************************************************************************************
+ * Hookshot
+ *   General-purpose library for injecting DLLs and hooking function calls.
+ ***************************************************************************************************
+ * Authored by Samuel Grossman
+ * Copyright (c) 2019-2025
+ ***********************************************************************************************//**
+ * @file CallTracing.h
+ *   Layout and interface declaration for the named shared memory section into which call trace
+ *   hooks record the calls they intercept, one ring buffer per thread.
+ **************************************************************************************************/
+
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+
+#include "ApiWindows.h"
+
+namespace Hookshot
+{
+  namespace CallTracing
+  {
+    /// Value that identifies a call trace section, stored at the very beginning of it.
+    inline constexpr uint32_t kSectionMagic = 0x52544b48;
+
+    /// Version of the call trace section layout. Must be incremented whenever the layout of any of
+    /// the structures below changes.
+    inline constexpr uint32_t kSectionVersion = 1;
+
+    /// Maximum number of threads that can record calls at the same time. Threads beyond this limit
+    /// run call trace hooks without recording anything.
+    inline constexpr uint32_t kMaxThreadBuffers = 64;
+
+    /// Number of records in each per-thread ring buffer. Must be a power of two.
+    inline constexpr uint32_t kRecordsPerThreadBuffer = 1024;
+
+    /// Number of arguments recorded for each call. In 64-bit processes these are the parameter
+    /// registers, and in 32-bit processes these are the first few pointer-sized values on the stack
+    /// after the return address. Arguments the function does not actually take are still recorded
+    /// but are meaningless.
+    inline constexpr uint32_t kNumRecordedArguments = 4;
+
+    /// Single call intercepted by a call trace hook. Values are widened to 64 bits so that the
+    /// layout is the same for 32-bit and 64-bit processes. Fields are written in order, with the
+    /// timestamp last.
+    struct SRecord
+    {
+      /// First few arguments passed to the function.
+      uint64_t arguments[kNumRecordedArguments];
+
+      /// Address to which the function will return, which identifies the caller.
+      uint64_t returnAddress;
+
+      /// Address of the original function, which identifies the call trace hook.
+      uint64_t originalFunc;
+
+      /// Value of the processor time stamp counter when the call was recorded. Modern processors
+      /// keep this counter invariant and synchronized across all processes, so readers can convert
+      /// it to wall-clock time by sampling it themselves alongside `QueryPerformanceCounter`.
+      uint64_t timestamp;
+
+      /// Unused, present to keep the size of the record a power of two.
+      uint64_t reserved;
+    };
+
+    /// Beginning of a per-thread ring buffer, which is immediately followed by
+    /// #kRecordsPerThreadBuffer records. Written without any synchronization by the thread that
+    /// owns it, so a reader has obtained a consistent copy of a record if the write offset shows
+    /// that it was neither still being written nor overwritten while being copied.
+    struct SThreadBufferHeader
+    {
+      /// Total number of bytes of records ever written into this buffer. Advanced by the size of a
+      /// record just before each record is written, so the most recent record, which might still
+      /// be incomplete, is located one record before this offset, modulo the size of the ring.
+      volatile uint64_t writeOffset;
+
+      /// Identifier of the thread that owns this buffer, or 0 if it is unowned. Buffers are
+      /// released when their owning threads exit and can then be given to other threads, in which
+      /// case the write offset continues to advance from where it was.
+      std::atomic<uint32_t> threadId;
+
+      /// Unused, present to keep the size of the header the same as the size of a record.
+      uint32_t reserved[13];
+    };
+
+    /// Complete per-thread ring buffer.
+    struct SThreadBuffer
+    {
+      /// Header at the beginning of the buffer.
+      SThreadBufferHeader header;
+
+      /// Records, used as a ring.
+      SRecord records[kRecordsPerThreadBuffer];
+    };
+
+    /// Beginning of a call trace section, which is immediately followed by #kMaxThreadBuffers
+    /// per-thread ring buffers.
+    struct SHeader
+    {
+      /// Always #kSectionMagic.
+      uint32_t magic;
+
+      /// Always #kSectionVersion.
+      uint32_t version;
+
+      /// Identifier of the recording process.
+      uint32_t processId;
+
+      /// Always #kMaxThreadBuffers.
+      uint32_t maxThreadBuffers;
+
+      /// Always #kRecordsPerThreadBuffer.
+      uint32_t recordsPerThreadBuffer;
+
+      /// Always `sizeof(SRecord)`.
+      uint32_t recordSizeBytes;
+
+      /// Number of threads that could not be given a buffer because all of them were owned.
+      std::atomic<uint32_t> numThreadsWithoutBuffers;
+
+      /// Unused, present to keep the size of the header the same as the size of a record.
+      uint32_t reserved[9];
+    };
+
+    static_assert(
+        std::atomic<uint32_t>::is_always_lock_free,
+        "Call trace section uses atomics that can be shared between processes.");
+    static_assert(64 == sizeof(SRecord), "Call trace record layout is unexpected.");
+    static_assert(
+        sizeof(SRecord) == sizeof(SThreadBufferHeader),
+        "Call trace thread buffer header layout is unexpected.");
+    static_assert(sizeof(SRecord) == sizeof(SHeader), "Call trace header layout is unexpected.");
+    static_assert(
+        0 == (kRecordsPerThreadBuffer & (kRecordsPerThreadBuffer - 1)),
+        "Call trace ring buffer size must be a power of two.");
+
+    /// Total size, in bytes, of a call trace section.
+    inline constexpr size_t kSectionSizeBytes =
+        sizeof(SHeader) + (sizeof(SThreadBuffer) * kMaxThreadBuffers);
+
+    /// Retrieves the per-thread ring buffers that follow the header of a call trace section.
+    /// @param [in] header Header at the beginning of the section.
+    /// @return Address of the first per-thread ring buffer.
+    inline SThreadBuffer* ThreadBuffersForHeader(SHeader* header)
+    {
+      return reinterpret_cast<SThreadBuffer*>(&header[1]);
+    }
+
+    /// Retrieves the per-thread ring buffers that follow the header of a call trace section.
+    /// @param [in] header Header at the beginning of the section.
+    /// @return Address of the first per-thread ring buffer.
+    inline const SThreadBuffer* ThreadBuffersForHeader(const SHeader* header)
+    {
+      return reinterpret_cast<const SThreadBuffer*>(&header[1]);
+    }
+
+    /// Retrieves the shared call recording code that call trace stubs jump to, creating it along
+    /// with the call trace section if needed. Only attempted once, no matter how many times it is
+    /// invoked. Once it succeeds, the calling thread and every thread created afterwards are given
+    /// per-thread ring buffers. Threads that already existed are not, so they run call trace
+    /// hooks without recording anything.
+    /// @return Address of the call recording code, or `nullptr` if call tracing is unavailable.
+    const void* GetRecorder(void);
+
+    /// Gives the calling thread a per-thread ring buffer, if call tracing is available and the
+    /// thread does not already have one. Invoked whenever a thread is created.
+    void AttachCurrentThread(void);
+
+    /// Releases the calling thread's per-thread ring buffer, if it has one, so that it can be given
+    /// to another thread. Invoked whenever a thread exits.
+    void DetachCurrentThread(void);
+  } // namespace CallTracing
+} // namespace Hookshot
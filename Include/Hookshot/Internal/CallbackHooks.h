@@ -0,0 +1,45 @@
+/***************************************************************************************************
+ * Hookshot
+ *   General-purpose library for injecting DLLs and hooking function calls.
+ ***************************************************************************************************
+ * Authored by Samuel Grossman
+ * Copyright (c) 2019-2025
+ ***********************************************************************************************//**
+ * @file CallbackHooks.h
+ *   Declaration of the shared dispatch code that invokes the callbacks of callback hooks.
+ **************************************************************************************************/
+
+#pragma once
+
+#include "HookshotTypes.h"
+
+namespace Hookshot
+{
+  namespace CallbackHooks
+  {
+    /// Describes a single callback hook. Each callback hook stub identifies one of these, and the
+    /// shared dispatch code reads it on every call, so its layout is fixed and it must remain valid
+    /// for as long as the stub exists.
+    struct SDescriptor
+    {
+      /// Function to invoke before the original function, or `nullptr` if none.
+      TCallbackHookPre preCallback;
+
+      /// Function to invoke after the original function returns, or `nullptr` if none.
+      TCallbackHookPost postCallback;
+
+      /// Application-defined value passed to both callbacks.
+      void* context;
+
+      /// Address of the original function, as reported to both callbacks.
+      const void* originalFunc;
+    };
+
+    /// Retrieves the shared dispatch code that callback hook stubs jump to, creating it if needed.
+    /// Only attempted once, no matter how many times it is invoked. Callback hook stubs are call
+    /// trace stubs whose trace identifier is the address of a descriptor, so the dispatch code
+    /// expects the same register contract as the shared call recording code.
+    /// @return Address of the dispatch code, or `nullptr` if it could not be created.
+    const void* GetDispatcher(void);
+  } // namespace CallbackHooks
+} // namespace Hookshot
@@ -0,0 +1,46 @@
+/***************************************************************************************************
+ * Hookshot
+ *   General-purpose library for injecting DLLs and hooking function calls.
+ ***************************************************************************************************
+ * Authored by Samuel Grossman
+ * Copyright (c) 2019-2025
+ ***********************************************************************************************//**
+ * @file CodeCaves.h
+ *   Interface declaration for placing small pieces of code in the padding between functions.
+ **************************************************************************************************/
+
+#pragma once
+
+#include <cstddef>
+
+namespace Hookshot
+{
+  /// Code caves are runs of `int 3` padding that compilers and linkers leave between functions in
+  /// the executable sections of a module. They are always within reach of a relative jump from
+  /// anywhere in the same module, so a hook stub placed in one can bridge the distance between an
+  /// original function and a trampoline that could not be placed anywhere near it. Each module is
+  /// scanned for code caves the first time one is needed in it. All functions require that the
+  /// hook store lock be held exclusively.
+  namespace CodeCaves
+  {
+    /// Size of each code cave, in bytes. Large enough to hold an absolute jump instruction.
+    inline constexpr size_t kCaveSizeBytes = 16;
+
+    /// Number of padding bytes that must immediately precede and follow a code cave. They keep
+    /// code caves away from padding that is part of the code around it, such as the space
+    /// reserved for hot-patching in front of a function.
+    inline constexpr size_t kGuardSizeBytes = 8;
+
+    /// Allocates a code cave within reach of a relative jump written at the specified address. The
+    /// code cave is taken from the executable sections of the module that contains that address.
+    /// @param [in] jumpSite Address at which the relative jump to the code cave will be written.
+    /// @return Address of the code cave, or `nullptr` if there is none available.
+    void* Allocate(const void* jumpSite);
+
+    /// Returns a code cave to the module from which it was allocated so that it can be allocated
+    /// again. Its contents are left as they are. Has no effect if that module has since been
+    /// unloaded or replaced.
+    /// @param [in] cave Address of the code cave, as previously returned by #Allocate.
+    void Deallocate(const void* cave);
+  } // namespace CodeCaves
+} // namespace Hookshot
@@ -12,12 +12,15 @@
 #pragma once
 
 #include <array>
+#include <chrono>
 #include <cstddef>
 #include <cstdint>
 
 #include "ApiWindows.h"
 #include "Inject.h"
 #include "InjectResult.h"
+#include "InjectionArena.h"
+#include "Tracing.h"
 
 namespace Hookshot
 {
@@ -29,7 +32,8 @@ namespace Hookshot
   /// entry point. Upon completion of all injection operations, control within the injected process
   /// will return to the designated entry point code. For newly-created processes in suspended
   /// state, the entry point can simply be the starting address of the process. Once injection
-  /// completes successfully, the process will simply start normally.
+  /// completes successfully, the process will simply start normally. The code region must be
+  /// writable when injection begins, and it is made executable once the injected code is written.
   class CodeInjector
   {
   public:
@@ -42,14 +46,26 @@ namespace Hookshot
         void* const baseAddressData,
         const bool cleanupCodeBuffer,
         const bool cleanupDataBuffer,
+        const bool sharedCodeRegion,
         void* const entryPoint,
         const size_t sizeCode,
         const size_t sizeData,
         const HANDLE injectedProcess,
-        const HANDLE injectedProcessMainThread);
+        const HANDLE injectedProcessMainThread,
+        InjectionArena& arena);
 
     CodeInjector(const CodeInjector&) = delete;
 
+    /// Retrieves a section object whose contents are a code region that already contains the
+    /// injected code, followed immediately by an empty data region. Views of this section can be
+    /// mapped into any number of processes, which then share the physical pages that hold the
+    /// injected code. The section is created the first time this method is invoked, and the region
+    /// sizes specified at that time are used for all subsequent invocations.
+    /// @param [in] sizeCode Size of the code region, in bytes.
+    /// @param [in] sizeData Size of the data region, in bytes.
+    /// @return Handle of the section object, or `nullptr` if it could not be created.
+    static HANDLE GetSharedCodeSection(const size_t sizeCode, const size_t sizeData);
+
     /// Sets the injected code into the injected process and runs it upon completion.
     /// Performs the actual operations of copying over code to the right locations and then
     /// executing it. Upon successful completion, the main thread of the injected process will be
@@ -57,8 +73,52 @@ namespace Hookshot
     /// construction time.
     /// @param [in] enableDebugFeatures If `true`, signals to the injected process that a debugger
     /// is present, so certain debug features should be enabled.
+    /// @param [in] runAsApc If `true`, the injected code is queued as an asynchronous procedure
+    /// call to the main thread, which runs it before reaching the entry point. This avoids
+    /// modifying the entry point and requires fewer synchronization operations, but the main thread
+    /// must not yet have started running. Otherwise, the entry point is temporarily replaced with a
+    /// trampoline to the injected code.
+    /// @param [in,out] phaseDurations Receives the durations of the injection phases that this
+    /// method performs.
+    /// @return Indicator of the result of the operation.
+    EInjectResult SetAndRun(
+        const bool enableDebugFeatures,
+        const bool runAsApc,
+        Tracing::SInjectPhaseDurations& phaseDurations);
+
+    /// Sets the injected code into the injected process and starts running it, but returns as soon
+    /// as the injected code is loading the library rather than waiting for it to finish. This
+    /// allows a single thread to wait for any number of injections at once. Once this method
+    /// succeeds, #CheckRunFinished indicates when the injected code is done, at which point
+    /// #FinishStartedRun completes the injection. See #SetAndRun for more information.
+    /// @param [in] enableDebugFeatures If `true`, signals to the injected process that a debugger
+    /// is present, so certain debug features should be enabled.
+    /// @param [in] runAsApc Whether or not to run the injected code as an asynchronous procedure
+    /// call. See #SetAndRun.
+    /// @param [in] syncEvent Auto-reset event that the injected code signals each time it reaches
+    /// a synchronization barrier, including once it is done. Must remain valid until the injection
+    /// is complete. If `nullptr`, the only way to detect that the injected code is done is polling.
+    /// @param [in,out] phaseDurations Receives the durations of the injection phases that this
+    /// method performs.
+    /// @return Indicator of the result of the operation.
+    EInjectResult SetAndStartRun(
+        const bool enableDebugFeatures,
+        const bool runAsApc,
+        const HANDLE syncEvent,
+        Tracing::SInjectPhaseDurations& phaseDurations);
+
+    /// Determines, without blocking, whether or not the injected code started using
+    /// #SetAndStartRun is done.
+    /// @param [out] finished Set to `true` if the injected code is done, `false` otherwise.
+    /// @return Indicator of the result of the operation.
+    EInjectResult CheckRunFinished(bool* finished);
+
+    /// Completes an injection started using #SetAndStartRun. Blocks until the injected code is
+    /// done, which does not take any time if #CheckRunFinished already indicated so.
+    /// @param [in,out] phaseDurations Receives the durations of the injection phases that this
+    /// method performs.
     /// @return Indicator of the result of the operation.
-    EInjectResult SetAndRun(const bool enableDebugFeatures);
+    EInjectResult FinishStartedRun(Tracing::SInjectPhaseDurations& phaseDurations);
 
   private:
 
@@ -81,24 +141,57 @@ namespace Hookshot
     size_t GetTrampolineCodeSize(void) const;
 
     /// Determines the location within the injected process' address space of the GetLastError,
-    /// GetProcAddress, and LoadLibraryA functions. These are required to be passed to the injected
-    /// code so they may be invoked.
+    /// GetProcAddress, LoadLibraryA, and SetEvent functions. These are required to be passed to
+    /// the injected code so they may be invoked.
     /// @param [out] addrGetLastError On success, filled with the address of GetLastError.
     /// @param [out] addrGetProcAddress On success, filled with the address of GetProcAddress.
     /// @param [out] addrLoadLibraryA On success, filled with the address of LoadLibraryA.
+    /// @param [out] addrSetEvent On success, filled with the address of SetEvent.
     /// @return `true` on success, `false` on failure.
     bool LocateFunctions(
-        void*& addrGetLastError, void*& addrGetProcAddress, void*& addrLoadLibraryA) const;
+        void*& addrGetLastError,
+        void*& addrGetProcAddress,
+        void*& addrLoadLibraryA,
+        void*& addrSetEvent) const;
 
     /// Runs the injected process once the injected code has been set.
+    /// @param [in] runAsApc Whether or not to run the injected code as an asynchronous procedure
+    /// call. See #SetAndRun.
     /// @return Indicator of the result of the operation.
-    EInjectResult Run(void);
+    EInjectResult Run(const bool runAsApc);
+
+    /// Implements the bulk of #Run once an event object has been created for synchronization.
+    /// @param [in] syncEvent Auto-reset event, in this process' handle table, that the injected
+    /// code should signal each time it reaches a synchronization barrier. If `nullptr`, all
+    /// synchronization uses polling.
+    /// @param [in] runAsApc Whether or not to run the injected code as an asynchronous procedure
+    /// call. See #SetAndRun.
+    /// @return Indicator of the result of the operation.
+    EInjectResult RunWithSyncEvent(const HANDLE syncEvent, const bool runAsApc);
+
+    /// Implements the first part of #RunWithSyncEvent, which starts the injected code and fills in
+    /// the values it needs, leaving it running until it is done loading the library.
+    /// @param [in] syncEvent Auto-reset event that the injected code should signal each time it
+    /// reaches a synchronization barrier, or `nullptr` to use polling.
+    /// @param [in] runAsApc Whether or not to run the injected code as an asynchronous procedure
+    /// call. See #SetAndRun.
+    /// @return Indicator of the result of the operation.
+    EInjectResult StartRun(const HANDLE syncEvent, const bool runAsApc);
+
+    /// Implements the second part of #RunWithSyncEvent, which waits for the injected code to be
+    /// done, synchronizes with it a final time, and reads the result of the injection.
+    /// @return Indicator of the result of the operation.
+    EInjectResult FinishRun(void);
 
     /// Sets the injected code into the injected process, performing all required operations.
+    /// Code and data regions are built locally and, if the data region immediately follows the code
+    /// region, written into the injected process using a single write operation.
     /// @param [in] enableDebugFeatures If `true`, signals to the injected process that a debugger
     /// is present, so certain debug features should be enabled.
+    /// @param [in] runAsApc Whether or not the injected code is to be run as an asynchronous
+    /// procedure call, in which case no trampoline is set. See #SetAndRun.
     /// @return Indicator of the result of the operation.
-    EInjectResult Set(const bool enableDebugFeatures);
+    EInjectResult Set(const bool enableDebugFeatures, const bool runAsApc);
 
     /// Returns the code region occupied by the trampoline to its original content.
     /// This is necessary to allow the injected process to execute as normal.
@@ -119,6 +212,11 @@ namespace Hookshot
     /// injected process once it is running.
     const bool cleanupDataBuffer;
 
+    /// Specifies if the code region is part of a view of the section returned by
+    /// #GetSharedCodeSection, in which case it already contains the injected code and only the
+    /// data region needs to be written.
+    const bool sharedCodeRegion;
+
     /// Entry point for the injected code.
     void* const entryPoint;
 
@@ -134,10 +232,37 @@ namespace Hookshot
     /// Main thread handle for the injected process.
     const HANDLE injectedProcessMainThread;
 
+    /// Arena of the injection that this object performs, from which local buffers are obtained.
+    InjectionArena& arena;
+
     /// Container for holding the code that gets replaced by trampoline code.
     std::array<uint8_t, kMaxTrampolineCodeBytes> oldCodeAtTrampoline;
 
-    /// Utility object for providing access to all code being injected.
-    const InjectInfo injectInfo;
+    /// Whether or not the injected code started using #SetAndStartRun runs as an asynchronous
+    /// procedure call.
+    bool runIsApc;
+
+    /// Time at which running the injected code started, used for measuring its duration when the
+    /// run is split across multiple method calls.
+    std::chrono::steady_clock::time_point runStartTime;
+
+    /// Synchronization flag value that the injected code writes once it is done, captured when the
+    /// injected code is started.
+    size_t runSyncVar1;
+
+    /// Synchronization flag value that allows the injected code to proceed once it is done,
+    /// captured when the injected code is started.
+    size_t runSyncVar2;
+
+    /// Event, in this process' handle table, that the injected code signals whenever it writes the
+    /// sync flag, or `nullptr` if synchronization uses polling.
+    HANDLE runSyncEvent;
+
+    /// Handle of the sync event in the injected process' handle table, or `nullptr` if it was not
+    /// duplicated there.
+    HANDLE remoteSyncEvent;
+
+    /// Utility object for providing access to all code being injected. Shared by all instances.
+    const InjectInfo& injectInfo;
   };
 } // namespace Hookshot
@@ -0,0 +1,61 @@
+/***************************************************************************************************
+ * Hookshot
+ *   General-purpose library for injecting DLLs and hooking function calls.
+ ***************************************************************************************************
+ * Authored by Samuel Grossman
+ * Copyright (c) 2019-2025
+ ***********************************************************************************************//**
+ * @file CodeRelocation.h
+ *   Interface declaration for relocating instructions from one location to another.
+ **************************************************************************************************/
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+#include "HookshotTypes.h"
+#include "X86Instruction.h"
+
+namespace Hookshot
+{
+  /// Moves blocks of instructions to new locations, adjusting their position-dependent memory
+  /// references so that they behave the same as they did at their original locations. Used both
+  /// for transplanting code out of original functions and into trampolines and for relocating
+  /// code on behalf of hook modules.
+  namespace CodeRelocation
+  {
+    /// Relocates already-decoded instructions, which must be contiguous, to the specified
+    /// destination. Instructions without position-dependent memory references are copied,
+    /// and all others are re-encoded with adjusted displacements.
+    /// @param [in,out] instructions Decoded instructions, in order. Displacements are modified in
+    /// place, so these must be copies if the originals are still needed.
+    /// @param [in] numInstructions Number of elements in the instruction array. Must be at least 1.
+    /// @param [in] sourceBytes Bytes of the instructions, which may be a snapshot of the code at
+    /// the addresses from which the instructions were decoded.
+    /// @param [out] dst Location from which the relocated code will execute.
+    /// @param [in] dstCapacity Number of bytes available at the destination.
+    /// @param [in] options Combination of `kRelocateCodeOption` values.
+    /// @param [out] relocated Filled with a description of the relocated code on success.
+    /// @return `true` if successful, `false` otherwise.
+    bool RelocateInstructions(
+        X86Instruction* instructions,
+        int numInstructions,
+        const uint8_t* sourceBytes,
+        void* dst,
+        int dstCapacity,
+        uint32_t options,
+        SRelocatedCode* relocated);
+
+    /// Implements #IHookshot9::RelocateCode by decoding instructions at the source and then
+    /// relocating them. Parameters and return value are the same as that method, except that
+    /// the description of the relocated code is required.
+    EResult RelocateCode(
+        const void* src,
+        size_t minBytes,
+        void* dst,
+        size_t dstCapacity,
+        uint32_t options,
+        SRelocatedCode* relocated);
+  } // namespace CodeRelocation
+} // namespace Hookshot
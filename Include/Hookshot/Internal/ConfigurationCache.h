@@ -0,0 +1,72 @@
+/***************************************************************************************************
+ * Hookshot
+ *   General-purpose library for injecting DLLs and hooking function calls.
+ ***************************************************************************************************
+ * Authored by Samuel Grossman
+ * Copyright (c) 2019-2025
+ ***********************************************************************************************//**
+ * @file ConfigurationCache.h
+ *   Interface declaration for the precompiled binary snapshot of the configuration file.
+ **************************************************************************************************/
+
+#pragma once
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include <Infra/Core/Configuration.h>
+
+namespace Hookshot
+{
+  namespace ConfigurationCache
+  {
+    /// Enumerates the types of values that can be held in a configuration cache entry.
+    enum class EConfigurationCacheValueType : uint16_t
+    {
+      /// Integer value, held in the integer value field.
+      Integer,
+
+      /// Boolean value, held in the integer value field as either 0 or 1.
+      Boolean,
+
+      /// String value, held in the string value field.
+      String,
+    };
+
+    /// Holds a single configuration value as it was read from the configuration file.
+    struct SConfigurationCacheEntry
+    {
+      /// Name of the section that contains the value.
+      std::wstring section;
+
+      /// Name of the setting to which the value belongs.
+      std::wstring name;
+
+      /// Type of the value.
+      EConfigurationCacheValueType type;
+
+      /// Value itself, if it is an integer or a Boolean.
+      int64_t integerValue;
+
+      /// Value itself, if it is a string.
+      std::wstring stringValue;
+    };
+
+    /// Attempts to load configuration data from the binary snapshot. Succeeds only if a snapshot
+    /// exists and was generated from the current version of the configuration file, as identified
+    /// by its size and last-modified time. A snapshot already in memory in another process, such
+    /// as the parent of this process, is preferred over the snapshot file. Only the global section
+    /// and the section for the currently-running executable are loaded.
+    /// @param [out] configData Configuration data object to be filled.
+    /// @return `true` if configuration data was loaded from the snapshot, `false` otherwise.
+    bool ReadConfigurationCache(Infra::Configuration::ConfigurationData* configData);
+
+    /// Generates a binary snapshot from the values read from the current version of the
+    /// configuration file, replacing any existing snapshot file and making the snapshot available
+    /// in memory to other processes. Failures are silently ignored, since the only consequence is
+    /// that the configuration file will be parsed again next time.
+    /// @param [in] entries All of the values read from the configuration file, from all sections.
+    void WriteConfigurationCache(const std::vector<SConfigurationCacheEntry>& entries);
+  } // namespace ConfigurationCache
+} // namespace Hookshot
@@ -0,0 +1,31 @@
+/***************************************************************************************************
+ * Hookshot
+ *   General-purpose library for injecting DLLs and hooking function calls.
+ ***************************************************************************************************
+ * Authored by Samuel Grossman
+ * Copyright (c) 2019-2025
+ ***********************************************************************************************//**
+ * @file ConfigurationReloader.h
+ *   Interface declaration for reloading runtime-tunable settings whenever the configuration file
+ *   changes, without restarting the process.
+ **************************************************************************************************/
+
+#pragma once
+
+namespace Hookshot
+{
+  /// The configuration reloader watches the configuration file and, whenever it changes, parses it
+  /// again and applies the settings that can change while Hookshot is running. These are the log
+  /// level and the hook instrumentation and timing settings. All other settings keep the values
+  /// read at startup.
+  namespace ConfigurationReloader
+  {
+    /// Determines whether or not the configuration file should be watched for changes.
+    /// @return `true` if so, `false` otherwise.
+    bool IsEnabled(void);
+
+    /// Starts watching the configuration file on a dedicated thread. Has no effect if watching is
+    /// disabled or has already been started.
+    void StartWatching(void);
+  } // namespace ConfigurationReloader
+} // namespace Hookshot
@@ -0,0 +1,52 @@
+/***************************************************************************************************
+ * Hookshot
+ *   General-purpose library for injecting DLLs and hooking function calls.
+ ***************************************************************************************************
+ * Authored by Samuel Grossman
+ * Copyright (c) 2019-2025
+ ***********************************************************************************************//**
+ * @file DebugRegisterHooks.h
+ *   Interface declaration for hooks implemented using hardware execution breakpoints, which can
+ *   hook functions that are too short to be patched.
+ **************************************************************************************************/
+
+#pragma once
+
+#include "ApiWindows.h"
+#include "HookshotTypes.h"
+
+namespace Hookshot
+{
+  namespace DebugRegisterHooks
+  {
+    /// Maximum number of debug register hooks that can exist at the same time, which is the
+    /// number of debug address registers available on the processor.
+    inline constexpr unsigned int kMaxDebugRegisterHooks = 4;
+
+    /// Loads the debug registers of the calling thread so that it observes all existing debug
+    /// register hooks. Intended to be invoked whenever a new thread starts. Has no effect if there
+    /// are no debug register hooks.
+    void ApplyToCurrentThread(void);
+
+    /// Creates a hook using a hardware execution breakpoint on the original function, which is
+    /// applied to every thread in the process. The original function is not modified.
+    /// @param [in] originalFunc Address of the function that should be hooked.
+    /// @param [in] hookFunc Hook function that should be invoked instead of the original function.
+    /// @return Result of the operation.
+    EResult CreateDebugRegisterHook(void* originalFunc, const void* hookFunc);
+
+    /// Retrieves the address that invokes the original behavior of a function hooked by a debug
+    /// register hook. Does not take any locks.
+    /// @param [in] originalOrHookFunc Address of either the original function or the hook
+    /// function associated with the hook.
+    /// @return Address that invokes the original function without triggering the hook, or
+    /// `nullptr` if no debug register hook matches.
+    const void* GetOriginalFunction(const void* originalOrHookFunc);
+
+    /// Removes a debug register hook by clearing its breakpoint from every thread in the process.
+    /// @param [in] originalOrHookFunc Address of either the original function or the hook
+    /// function associated with the hook.
+    /// @return Result of the operation.
+    EResult RemoveDebugRegisterHook(const void* originalOrHookFunc);
+  } // namespace DebugRegisterHooks
+} // namespace Hookshot
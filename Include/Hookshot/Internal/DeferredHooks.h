@@ -0,0 +1,62 @@
+/***************************************************************************************************
+ * Hookshot
+ *   General-purpose library for injecting DLLs and hooking function calls.
+ ***************************************************************************************************
+ * Authored by Samuel Grossman
+ * Copyright (c) 2019-2025
+ ***********************************************************************************************//**
+ * @file DeferredHooks.h
+ *   Interface declaration for hooks on functions exported by modules that might not yet be
+ *   loaded, which are installed as soon as the loader maps those modules.
+ **************************************************************************************************/
+
+#pragma once
+
+#include "ApiWindows.h"
+#include "HookshotTypes.h"
+
+namespace Hookshot
+{
+  namespace DeferredHooks
+  {
+    /// Registers a hook on a function exported by a module, identified by name. If the module is
+    /// already loaded, the hook is created right away. Otherwise, it is created as soon as the
+    /// loader maps the module, before any of the module's own code runs. Deferred hooks are created
+    /// only once, the first time the module is loaded.
+    /// @param [in] moduleName Base name of the module, including its extension, compared
+    /// case-insensitively.
+    /// @param [in] exportName Name of the exported function to hook. Forwarded exports are not
+    /// followed.
+    /// @param [in] hookFunc Hook function that should be invoked instead of the exported function.
+    /// @return Result of the operation.
+    EResult CreateDeferredHook(
+        const wchar_t* moduleName, const char* exportName, const void* hookFunc);
+
+    /// Registers a call trace hook on a function exported by a module, identified by name. Created
+    /// at the same time as a deferred hook would be, otherwise behaves just like a call trace hook
+    /// created directly.
+    /// @param [in] moduleName Base name of the module, including its extension, compared
+    /// case-insensitively.
+    /// @param [in] exportName Name of the exported function to trace.
+    /// @return Result of the operation.
+    EResult CreateDeferredCallTraceHook(const wchar_t* moduleName, const char* exportName);
+
+    /// Function that performs an action once a module is loaded.
+    /// @param [in] context Value supplied when the action was registered.
+    using TDeferredActionProc = void (*)(void* context);
+
+    /// Registers an action to be performed the first time a module, identified by name, is loaded.
+    /// Actions are performed at the same time as deferred hooks are created, which is with the
+    /// loader lock held, so they must not load or unload modules themselves, although they can hand
+    /// that work to another thread. If the module is already loaded, the action is performed right
+    /// away on the calling thread.
+    /// @param [in] moduleName Base name of the module, including its extension, compared
+    /// case-insensitively.
+    /// @param [in] actionProc Function that performs the action.
+    /// @param [in] context Value to pass to the action function.
+    /// @return `true` if the action was registered, `false` if loader notifications are
+    /// unavailable.
+    bool CreateDeferredAction(
+        const wchar_t* moduleName, TDeferredActionProc actionProc, void* context);
+  } // namespace DeferredHooks
+} // namespace Hookshot
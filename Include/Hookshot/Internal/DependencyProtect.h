@@ -37,33 +37,76 @@ namespace Hookshot
     // read-only (but updated behind-the-scenes) function pointer. Naming convention is
     // "[second macro parameter]_[third macro parameter]" for each function pointer.
 
+    PROTECTED_DEPENDENCY(, Windows, AddDllDirectory);
+    PROTECTED_DEPENDENCY(, Windows, AddVectoredExceptionHandler);
     PROTECTED_DEPENDENCY(, Windows, CloseHandle);
+    PROTECTED_DEPENDENCY(, Windows, CopyFile);
+    PROTECTED_DEPENDENCY(, Windows, CreateEvent);
     PROTECTED_DEPENDENCY(, Windows, CreateFileMapping);
     PROTECTED_DEPENDENCY(, Windows, CreateProcess);
+    PROTECTED_DEPENDENCY(, Windows, CreateThread);
+    PROTECTED_DEPENDENCY(, Windows, CreateToolhelp32Snapshot);
+    PROTECTED_DEPENDENCY(, Windows, DeleteFile);
+    PROTECTED_DEPENDENCY(, Windows, DeleteProcThreadAttributeList);
     PROTECTED_DEPENDENCY(, Windows, DuplicateHandle);
     PROTECTED_DEPENDENCY(, Windows, FindClose);
+    PROTECTED_DEPENDENCY(, Windows, FindFirstChangeNotification);
     PROTECTED_DEPENDENCY(, Windows, FindFirstFileEx);
+    PROTECTED_DEPENDENCY(, Windows, FindNextChangeNotification);
     PROTECTED_DEPENDENCY(, Windows, FindNextFile);
     PROTECTED_DEPENDENCY(, Windows, FlushInstructionCache);
     PROTECTED_DEPENDENCY(, Windows, FormatMessage);
+    PROTECTED_DEPENDENCY(, Windows, FreeLibrary);
+    PROTECTED_DEPENDENCY(, Windows, GetCurrentProcessId);
+    PROTECTED_DEPENDENCY(, Windows, GetCurrentThreadId);
+    PROTECTED_DEPENDENCY(, Windows, GetEnvironmentVariable);
     PROTECTED_DEPENDENCY(, Windows, GetExitCodeProcess);
+    PROTECTED_DEPENDENCY(, Windows, GetFileAttributesEx);
     PROTECTED_DEPENDENCY(, Windows, GetLastError);
     PROTECTED_DEPENDENCY(, Windows, GetModuleHandleEx);
     PROTECTED_DEPENDENCY(, Windows, GetProcAddress);
+    PROTECTED_DEPENDENCY(, Windows, GetProcessId);
+    PROTECTED_DEPENDENCY(, Windows, GetProcessWorkingSetSize);
+    PROTECTED_DEPENDENCY(, Windows, GetThreadContext);
+    PROTECTED_DEPENDENCY(, Windows, InitializeProcThreadAttributeList);
     PROTECTED_DEPENDENCY(, Windows, IsDebuggerPresent);
+    PROTECTED_DEPENDENCY(, Windows, IsProcessInJob);
     PROTECTED_DEPENDENCY(, Windows, LoadLibrary);
+    PROTECTED_DEPENDENCY(, Windows, LoadLibraryEx);
     PROTECTED_DEPENDENCY(, Windows, MessageBox);
     PROTECTED_DEPENDENCY(, Windows, MapViewOfFile);
+    PROTECTED_DEPENDENCY(, Windows, MapViewOfFileEx);
+    PROTECTED_DEPENDENCY(, Windows, OpenJobObject);
+    PROTECTED_DEPENDENCY(, Windows, OpenThread);
     PROTECTED_DEPENDENCY(, Windows, OutputDebugString);
     PROTECTED_DEPENDENCY(, Windows, QueryFullProcessImageName);
     PROTECTED_DEPENDENCY(, Windows, ResumeThread);
+#ifdef _WIN64
+    PROTECTED_DEPENDENCY(, Windows, RtlAddFunctionTable);
+    PROTECTED_DEPENDENCY(, Windows, RtlDeleteFunctionTable);
+    PROTECTED_DEPENDENCY(, Windows, RtlLookupFunctionEntry);
+#endif
+    PROTECTED_DEPENDENCY(, Windows, SetEvent);
+    PROTECTED_DEPENDENCY(, Windows, SetHandleInformation);
     PROTECTED_DEPENDENCY(, Windows, SetLastError);
+    PROTECTED_DEPENDENCY(, Windows, SetProcessWorkingSetSize);
+    PROTECTED_DEPENDENCY(, Windows, SetThreadContext);
+    PROTECTED_DEPENDENCY(, Windows, SetThreadPriority);
+    PROTECTED_DEPENDENCY(, Windows, Sleep);
+    PROTECTED_DEPENDENCY(, Windows, SuspendThread);
     PROTECTED_DEPENDENCY(, Windows, TerminateProcess);
+    PROTECTED_DEPENDENCY(, Windows, Thread32First);
+    PROTECTED_DEPENDENCY(, Windows, Thread32Next);
+    PROTECTED_DEPENDENCY(, Windows, TlsAlloc);
+    PROTECTED_DEPENDENCY(, Windows, TlsFree);
     PROTECTED_DEPENDENCY(, Windows, UnmapViewOfFile);
+    PROTECTED_DEPENDENCY(, Windows, UpdateProcThreadAttribute);
     PROTECTED_DEPENDENCY(, Windows, VirtualAlloc);
     PROTECTED_DEPENDENCY(, Windows, VirtualFree);
+    PROTECTED_DEPENDENCY(, Windows, VirtualLock);
     PROTECTED_DEPENDENCY(, Windows, VirtualQuery);
     PROTECTED_DEPENDENCY(, Windows, VirtualProtect);
+    PROTECTED_DEPENDENCY(, Windows, WaitForMultipleObjects);
     PROTECTED_DEPENDENCY(, Windows, WaitForSingleObject);
   } // namespace Protected
 
@@ -0,0 +1,62 @@
+/***************************************************************************************************
+ * Hookshot
+ *   General-purpose library for injecting DLLs and hooking function calls.
+ ***************************************************************************************************
+ * Authored by Samuel Grossman
+ * Copyright (c) 2019-2025
+ ***********************************************************************************************//**
+ * @file ExitSummary.h
+ *   Interface declaration for summarizing hook statistics and install timings when the process
+ *   exits.
+ **************************************************************************************************/
+
+#pragma once
+
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+
+#include "HookshotTypes.h"
+
+namespace Hookshot
+{
+  /// Keeps a few process-wide counters about hook creation and, when the process exits, appends a
+  /// compact summary of them and of every hook to a CSV file shared by all processes. Processes
+  /// that only run briefly are gone before anything can read their published statistics, so this
+  /// is the only way to find out what their hooks cost. The summary is written with a single
+  /// append, and the write is abandoned if it does not complete within a bounded amount of time,
+  /// so exit is never held up for long.
+  namespace ExitSummary
+  {
+    /// Maximum amount of time, in milliseconds, that writing the summary can delay process exit.
+    inline constexpr uint32_t kWriteTimeoutMilliseconds = 100;
+
+    /// Size, in bytes, above which the summary file is renamed and a new one started. Only the
+    /// most recent renamed file is kept.
+    inline constexpr int64_t kMaxFileSizeBytes = 1024 * 1024;
+
+    /// Determines whether or not this process should write a summary when it exits.
+    /// @return `true` if so, `false` otherwise.
+    bool IsEnabled(void);
+
+    /// Records the outcome and duration of an attempt to create a single hook. Has no effect if
+    /// the summary is disabled.
+    /// @param [in] result Result of the attempt.
+    /// @param [in] startTime Point in time at which the attempt started.
+    void RecordInstall(EResult result, std::chrono::steady_clock::time_point startTime);
+
+    /// Records the outcomes and overall duration of an attempt to create a batch of hooks. Has no
+    /// effect if the summary is disabled.
+    /// @param [in] results Result for each hook in the batch.
+    /// @param [in] numResults Number of elements in the result array.
+    /// @param [in] startTime Point in time at which the attempt started.
+    void RecordInstallBatch(
+        const EResult* results, size_t numResults, std::chrono::steady_clock::time_point startTime);
+
+    /// Appends the summary for this process to the summary file. Has no effect if the summary is
+    /// disabled. Intended to be invoked once, while the process is exiting, in which case other
+    /// threads might have been terminated while holding locks, so per-hook rows are omitted if the
+    /// hook store lock cannot be acquired immediately.
+    void Write(void);
+  } // namespace ExitSummary
+} // namespace Hookshot
@@ -0,0 +1,109 @@
+/***************************************************************************************************
+ * Hookshot
+ *   General-purpose library for injecting DLLs and hooking function calls.
+ ***************************************************************************************************
+ * Authored by Samuel Grossman
+ * Copyright (c) 2019-2025
+ ***********************************************************************************************//**
+ * @file ExportResolver.h
+ *   Interface declaration for resolving procedures exported by modules, whether loaded in the
+ *   current process or in another process.
+ **************************************************************************************************/
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <string_view>
+#include <vector>
+
+#include "ApiWindows.h"
+
+namespace Hookshot
+{
+  namespace ExportResolver
+  {
+    /// Read-only view of memory that contains a module's export table. For modules loaded in the
+    /// current process, this can be the entire module image. For modules loaded in other
+    /// processes, this is typically a local copy of just the export table.
+    struct SExportTableView
+    {
+      /// Pointer to the beginning of the viewed memory.
+      const uint8_t* data;
+
+      /// Relative virtual address, within the module, of the first byte of viewed memory.
+      DWORD dataRelativeAddress;
+
+      /// Number of bytes of viewed memory.
+      DWORD dataSize;
+
+      /// Relative virtual address, within the module, of the export directory.
+      DWORD exportDirectoryRelativeAddress;
+
+      /// Size of the export directory, in bytes, from the module's data directory table. Exported
+      /// addresses that lie within the export directory are forwarders rather than procedures.
+      DWORD exportDirectorySize;
+    };
+
+    /// Creates a view of the export table of a module loaded in the current process.
+    /// @param [in] moduleHandle Handle to the module whose export table is to be viewed.
+    /// @param [out] exportTableView Filled with the view, if the operation is successful.
+    /// @return `true` if the module has an export table and a view was created, `false` otherwise.
+    bool CreateLocalExportTableView(HMODULE moduleHandle, SExportTableView* exportTableView);
+
+    /// Resolves the relative virtual addresses of one or more exported procedures by name. Export
+    /// names are stored in sorted order, so each name is located by binary search. Names that are
+    /// not exported, or that are forwarded to other modules, are not resolved.
+    /// @param [in] exportTableView View of the export table to search.
+    /// @param [in] procNames Names of the exported procedures to resolve.
+    /// @param [in] numProcNames Number of names to resolve.
+    /// @param [out] procRelativeAddresses Filled with the relative virtual address of each
+    /// requested procedure, or 0 for each procedure that could not be resolved.
+    /// @param [out] forwarders Optional array to be filled with the forwarder string of each
+    /// requested procedure that is forwarded to another module, which has the form
+    /// `Module.ProcName` or `Module.#Ordinal`, or an empty string for each other procedure. Strings
+    /// point into viewed memory.
+    /// @return Number of procedures that were successfully resolved.
+    size_t ResolveExports(
+        const SExportTableView& exportTableView,
+        const std::string_view* procNames,
+        size_t numProcNames,
+        DWORD* procRelativeAddresses,
+        std::string_view* forwarders = nullptr);
+
+    /// Retrieves the address of a procedure exported by a module loaded in the current process.
+    /// Similar to `GetProcAddress`, including following forwarders, except that modules named by
+    /// forwarders are never loaded. A forwarded procedure is only resolved if the module that
+    /// implements it is already loaded, which is always the case for modules that the system
+    /// loads along with the module being searched. Aliases of the same procedure exported by
+    /// multiple modules therefore resolve to the same address.
+    /// @param [in] moduleHandle Handle to the module to be searched.
+    /// @param [in] procName Name of the exported procedure.
+    /// @return Address of the exported procedure, or `nullptr` if it could not be resolved.
+    void* GetLocalProcAddress(HMODULE moduleHandle, std::string_view procName);
+
+    /// Retrieves the addresses of multiple procedures exported by a module loaded in the current
+    /// process. The export table is located and validated only once for all of them. Forwarders
+    /// are followed as in #GetLocalProcAddress.
+    /// @param [in] moduleHandle Handle to the module to be searched.
+    /// @param [in] procNames Names of the exported procedures.
+    /// @param [in] numProcNames Number of names to resolve.
+    /// @param [out] procAddresses Filled with the address of each requested procedure, or
+    /// `nullptr` for each procedure that could not be resolved.
+    /// @return Number of procedures that were successfully resolved.
+    size_t GetLocalProcAddresses(
+        HMODULE moduleHandle,
+        const std::string_view* procNames,
+        size_t numProcNames,
+        void** procAddresses);
+
+    /// Retrieves the address of every procedure that a module loaded in the current process
+    /// exports and implements itself, in a single pass over its export table. Forwarders are
+    /// skipped, as are exports that lie outside of the module's executable sections, such as
+    /// exported variables. A procedure exported under several names or ordinals appears once.
+    /// @param [in] moduleHandle Handle to the module whose exports are to be retrieved.
+    /// @return Addresses of the exported procedures in increasing order, which is empty if the
+    /// module has no export table.
+    std::vector<void*> GetLocalCodeExports(HMODULE moduleHandle);
+  } // namespace ExportResolver
+} // namespace Hookshot
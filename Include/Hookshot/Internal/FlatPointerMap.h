@@ -0,0 +1,459 @@
+/***************************************************************************************************
+ * Hookshot
+ *   General-purpose library for injecting DLLs and hooking function calls.
+ ***************************************************************************************************
+ * Authored by Samuel Grossman
+ * Copyright (c) 2019-2025
+ ***********************************************************************************************//**
+ * @file FlatPointerMap.h
+ *   Data structure declaration and implementation for a flat hash table keyed by pointers.
+ **************************************************************************************************/
+
+#pragma once
+
+#include <intrin.h>
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <stdexcept>
+#include <type_traits>
+#include <utility>
+
+namespace Hookshot
+{
+  /// Open-addressing hash table keyed by pointers, intended as a replacement for the subset of
+  /// `std::unordered_map` that the hook store uses. Entries are stored contiguously rather than in
+  /// individually-allocated nodes. Each slot has a one-byte control tag holding part of the hash of
+  /// its key, and tags are compared 16 at a time so that a lookup usually touches a single group of
+  /// tags and a single entry. Capacity can be reserved ahead of time to avoid rehashing during bulk
+  /// insertion. Nothing is allocated until the first insertion, so static instances are safe to
+  /// use during static initialization. Not concurrency-safe. Any insertion can invalidate all
+  /// iterators and references, and erasure invalidates iterators and references to the erased
+  /// entry only.
+  /// @tparam KeyType Pointer type used as the key.
+  /// @tparam ValueType Type of the mapped value. Must be default-constructible and movable.
+  template <typename KeyType, typename ValueType> class FlatPointerMap
+  {
+    static_assert(std::is_pointer_v<KeyType>, "FlatPointerMap keys must be pointers.");
+
+  public:
+
+    /// Type of each entry, which is laid out the same way as in `std::unordered_map`.
+    using value_type = std::pair<KeyType, ValueType>;
+
+    /// Forward iterator over all of the entries in the table, in no particular order.
+    template <typename MapType, typename EntryType> class IteratorBase
+    {
+    public:
+
+      IteratorBase(MapType* map, size_t index) : map(map), index(index)
+      {
+        SkipUnoccupied();
+      }
+
+      EntryType& operator*(void) const
+      {
+        return map->entries[index];
+      }
+
+      EntryType* operator->(void) const
+      {
+        return &map->entries[index];
+      }
+
+      IteratorBase& operator++(void)
+      {
+        index += 1;
+        SkipUnoccupied();
+        return *this;
+      }
+
+      bool operator==(const IteratorBase& other) const
+      {
+        return (index == other.index);
+      }
+
+      bool operator!=(const IteratorBase& other) const
+      {
+        return (index != other.index);
+      }
+
+    private:
+
+      /// Advances the index past any slots that do not hold entries.
+      void SkipUnoccupied(void)
+      {
+        while ((index < map->capacity) && (false == IsFull(map->ControlTag(index))))
+          index += 1;
+      }
+
+      /// Map over which iteration is taking place.
+      MapType* map;
+
+      /// Slot index of the current entry, or the capacity of the map if iteration is complete.
+      size_t index;
+    };
+
+    using iterator = IteratorBase<FlatPointerMap, value_type>;
+    using const_iterator = IteratorBase<const FlatPointerMap, const value_type>;
+
+    FlatPointerMap(void) : groups(), entries(), capacity(0), numEntries(0), numTombstones(0) {}
+
+    FlatPointerMap(const FlatPointerMap&) = delete;
+
+    iterator begin(void)
+    {
+      return iterator(this, 0);
+    }
+
+    const_iterator begin(void) const
+    {
+      return const_iterator(this, 0);
+    }
+
+    iterator end(void)
+    {
+      return iterator(this, capacity);
+    }
+
+    const_iterator end(void) const
+    {
+      return const_iterator(this, capacity);
+    }
+
+    /// Retrieves a reference to the value associated with the specified key.
+    /// @param [in] key Key to look up, which must be present.
+    /// @return Reference to the associated value.
+    ValueType& at(KeyType key)
+    {
+      const size_t index = FindIndex(key);
+      if (capacity == index) throw std::out_of_range("FlatPointerMap key not found.");
+      return entries[index].second;
+    }
+
+    /// Retrieves a reference to the value associated with the specified key.
+    /// @param [in] key Key to look up, which must be present.
+    /// @return Reference to the associated value.
+    const ValueType& at(KeyType key) const
+    {
+      const size_t index = FindIndex(key);
+      if (capacity == index) throw std::out_of_range("FlatPointerMap key not found.");
+      return entries[index].second;
+    }
+
+    /// Removes all entries but keeps the allocated capacity.
+    void clear(void)
+    {
+      for (size_t i = 0; i < capacity; ++i)
+      {
+        if (true == IsFull(ControlTag(i))) entries[i] = value_type();
+        ControlTag(i) = kControlEmpty;
+      }
+
+      numEntries = 0;
+      numTombstones = 0;
+    }
+
+    /// Counts the entries with the specified key.
+    /// @param [in] key Key to look up.
+    /// @return 1 if the key is present, 0 otherwise.
+    size_t count(KeyType key) const
+    {
+      return ((capacity == FindIndex(key)) ? 0 : 1);
+    }
+
+    /// Determines whether or not the table holds any entries.
+    /// @return `true` if there are no entries, `false` otherwise.
+    bool empty(void) const
+    {
+      return (0 == numEntries);
+    }
+
+    /// Removes the entry with the specified key, if it is present.
+    /// @param [in] key Key of the entry to remove.
+    /// @return Number of entries removed, either 0 or 1.
+    size_t erase(KeyType key)
+    {
+      const size_t index = FindIndex(key);
+      if (capacity == index) return 0;
+
+      entries[index] = value_type();
+      numEntries -= 1;
+
+      // A slot whose group still has an empty slot can never be in the middle of a probe sequence,
+      // because probing stops at the first group with an empty slot, so it can be made empty
+      // instead of leaving behind a tombstone.
+      if (0 != MatchGroup(index / kGroupSize, kControlEmpty))
+      {
+        ControlTag(index) = kControlEmpty;
+      }
+      else
+      {
+        ControlTag(index) = kControlTombstone;
+        numTombstones += 1;
+      }
+
+      return 1;
+    }
+
+    /// Locates the entry with the specified key.
+    /// @param [in] key Key to look up.
+    /// @return Iterator to the entry, or the end iterator if the key is not present.
+    iterator find(KeyType key)
+    {
+      return iterator(this, FindIndex(key));
+    }
+
+    /// Locates the entry with the specified key.
+    /// @param [in] key Key to look up.
+    /// @return Iterator to the entry, or the end iterator if the key is not present.
+    const_iterator find(KeyType key) const
+    {
+      return const_iterator(this, FindIndex(key));
+    }
+
+    /// Ensures that the specified total number of entries can be held without rehashing.
+    /// @param [in] numEntriesToHold Number of entries that should fit.
+    void reserve(size_t numEntriesToHold)
+    {
+      if ((numEntriesToHold + numTombstones) <= MaxEntriesForCapacity(capacity)) return;
+      Rehash(CapacityForEntries(numEntriesToHold));
+    }
+
+    /// Retrieves the number of slots in the table, whether or not they hold entries.
+    /// @return Number of slots.
+    size_t bucket_count(void) const
+    {
+      return capacity;
+    }
+
+    /// Retrieves the number of entries in the table.
+    /// @return Number of entries.
+    size_t size(void) const
+    {
+      return numEntries;
+    }
+
+    /// Retrieves a reference to the value associated with the specified key, inserting a
+    /// default-constructed value first if the key is not present.
+    /// @param [in] key Key to look up or insert.
+    /// @return Reference to the associated value.
+    ValueType& operator[](KeyType key)
+    {
+      size_t index = FindIndex(key);
+      if (capacity != index) return entries[index].second;
+
+      if ((numEntries + numTombstones + 1) > MaxEntriesForCapacity(capacity))
+        Rehash(CapacityForEntries(numEntries + 1));
+
+      index = FindInsertIndex(key);
+      if (kControlTombstone == ControlTag(index)) numTombstones -= 1;
+
+      ControlTag(index) = TagForHash(HashForKey(key));
+      entries[index].first = key;
+      numEntries += 1;
+      return entries[index].second;
+    }
+
+  private:
+
+    /// Number of slots whose control tags are compared together.
+    static constexpr size_t kGroupSize = 16;
+
+    /// Control tag for a slot that has never held an entry.
+    static constexpr int8_t kControlEmpty = static_cast<int8_t>(0x80);
+
+    /// Control tag for a slot whose entry was removed but that is still part of a probe sequence.
+    static constexpr int8_t kControlTombstone = static_cast<int8_t>(0xfe);
+
+    /// Control tags for a single group of slots, aligned so that they can be loaded all at once.
+    struct alignas(kGroupSize) SGroup
+    {
+      /// One control tag per slot. Occupied slots have tags with the high bit clear.
+      int8_t controlTags[kGroupSize];
+    };
+
+    /// Determines whether or not a control tag marks an occupied slot.
+    /// @param [in] controlTag Control tag to check.
+    /// @return `true` if so, `false` otherwise.
+    static inline bool IsFull(int8_t controlTag)
+    {
+      return (controlTag >= 0);
+    }
+
+    /// Computes the hash of a key. Pointers are frequently aligned, so the low bits are not useful.
+    /// Fibonacci hashing spreads the remaining bits across the whole hash.
+    /// @param [in] key Key to hash.
+    /// @return Hash of the key.
+    static inline size_t HashForKey(KeyType key)
+    {
+      constexpr size_t kMultiplier =
+          ((sizeof(size_t) > 4) ? static_cast<size_t>(0x9e3779b97f4a7c15ull)
+                                : static_cast<size_t>(0x9e3779b9u));
+      return ((reinterpret_cast<size_t>(key) >> 4) * kMultiplier);
+    }
+
+    /// Extracts the control tag from a hash, using its highest bits, which are the best mixed.
+    /// @param [in] hash Hash of a key.
+    /// @return Control tag, which always has its high bit clear.
+    static inline int8_t TagForHash(size_t hash)
+    {
+      return static_cast<int8_t>(hash >> ((sizeof(size_t) * 8) - 7));
+    }
+
+    /// Determines the maximum number of entries, including tombstones, that a table of the
+    /// specified capacity can hold before it must be rehashed. Keeping the table at most 7/8 full
+    /// guarantees that every probe sequence eventually reaches a group with an empty slot.
+    /// @param [in] tableCapacity Number of slots in the table.
+    /// @return Maximum number of entries.
+    static inline size_t MaxEntriesForCapacity(size_t tableCapacity)
+    {
+      return ((tableCapacity / 8) * 7);
+    }
+
+    /// Determines the smallest valid capacity that can hold the specified number of entries.
+    /// @param [in] numEntriesToHold Number of entries that should fit.
+    /// @return Capacity, which is a power of two and a multiple of the group size.
+    static inline size_t CapacityForEntries(size_t numEntriesToHold)
+    {
+      size_t newCapacity = kGroupSize;
+      while (MaxEntriesForCapacity(newCapacity) < numEntriesToHold)
+        newCapacity *= 2;
+      return newCapacity;
+    }
+
+    /// Retrieves the control tag for a slot.
+    /// @param [in] index Slot index.
+    /// @return Reference to the control tag.
+    inline int8_t& ControlTag(size_t index) const
+    {
+      return groups[index / kGroupSize].controlTags[index % kGroupSize];
+    }
+
+    /// Compares all of the control tags in a group with the specified value simultaneously.
+    /// @param [in] groupIndex Index of the group to check.
+    /// @param [in] controlTag Control tag value to compare.
+    /// @return Bit mask with one bit set for each slot in the group whose tag matches.
+    inline unsigned int MatchGroup(size_t groupIndex, int8_t controlTag) const
+    {
+      const __m128i groupTags =
+          _mm_load_si128(reinterpret_cast<const __m128i*>(groups[groupIndex].controlTags));
+      return static_cast<unsigned int>(
+          _mm_movemask_epi8(_mm_cmpeq_epi8(groupTags, _mm_set1_epi8(controlTag))));
+    }
+
+    /// Identifies all of the slots in a group that do not hold entries.
+    /// @param [in] groupIndex Index of the group to check.
+    /// @return Bit mask with one bit set for each slot in the group that is empty or a tombstone.
+    inline unsigned int MatchGroupAvailable(size_t groupIndex) const
+    {
+      const __m128i groupTags =
+          _mm_load_si128(reinterpret_cast<const __m128i*>(groups[groupIndex].controlTags));
+      return static_cast<unsigned int>(_mm_movemask_epi8(groupTags));
+    }
+
+    /// Computes the index of the group at which probing for the specified hash begins.
+    /// @param [in] hash Hash of a key.
+    /// @return Starting group index.
+    inline size_t StartGroupForHash(size_t hash) const
+    {
+      return ((hash ^ (hash >> ((sizeof(size_t) * 8) / 2))) & ((capacity / kGroupSize) - 1));
+    }
+
+    /// Computes the index of the lowest set bit in a group match mask.
+    /// @param [in] mask Non-zero match mask.
+    /// @return Index of the lowest set bit.
+    static inline size_t LowestSetBit(unsigned int mask)
+    {
+      unsigned long bitIndex = 0;
+      _BitScanForward(&bitIndex, mask);
+      return static_cast<size_t>(bitIndex);
+    }
+
+    /// Locates the slot that holds the specified key.
+    /// @param [in] key Key to look up.
+    /// @return Slot index, or the capacity if the key is not present.
+    size_t FindIndex(KeyType key) const
+    {
+      if (0 == numEntries) return capacity;
+
+      const size_t hash = HashForKey(key);
+      const int8_t tag = TagForHash(hash);
+      const size_t numGroups = capacity / kGroupSize;
+
+      for (size_t probe = 0, groupIndex = StartGroupForHash(hash); probe < numGroups;
+           ++probe, groupIndex = (groupIndex + 1) & (numGroups - 1))
+      {
+        for (unsigned int matches = MatchGroup(groupIndex, tag); 0 != matches;
+             matches &= (matches - 1))
+        {
+          const size_t index = (groupIndex * kGroupSize) + LowestSetBit(matches);
+          if (key == entries[index].first) return index;
+        }
+
+        if (0 != MatchGroup(groupIndex, kControlEmpty)) break;
+      }
+
+      return capacity;
+    }
+
+    /// Locates the first slot along the probe sequence for the specified key that can receive a
+    /// new entry. Requires that the key not already be present and that the table not be full.
+    /// @param [in] key Key to be inserted.
+    /// @return Slot index.
+    size_t FindInsertIndex(KeyType key) const
+    {
+      const size_t numGroups = capacity / kGroupSize;
+
+      for (size_t groupIndex = StartGroupForHash(HashForKey(key));;
+           groupIndex = (groupIndex + 1) & (numGroups - 1))
+      {
+        const unsigned int available = MatchGroupAvailable(groupIndex);
+        if (0 != available) return ((groupIndex * kGroupSize) + LowestSetBit(available));
+      }
+    }
+
+    /// Moves all entries into a newly-allocated table with the specified capacity, discarding all
+    /// tombstones in the process.
+    /// @param [in] newCapacity Capacity of the new table, which must be able to hold all entries.
+    void Rehash(size_t newCapacity)
+    {
+      std::unique_ptr<SGroup[]> oldGroups = std::move(groups);
+      std::unique_ptr<value_type[]> oldEntries = std::move(entries);
+      const size_t oldCapacity = capacity;
+
+      groups = std::make_unique<SGroup[]>(newCapacity / kGroupSize);
+      entries = std::make_unique<value_type[]>(newCapacity);
+      capacity = newCapacity;
+      numTombstones = 0;
+
+      for (size_t i = 0; i < capacity; ++i)
+        ControlTag(i) = kControlEmpty;
+
+      for (size_t i = 0; i < oldCapacity; ++i)
+      {
+        if (false == IsFull(oldGroups[i / kGroupSize].controlTags[i % kGroupSize])) continue;
+
+        const size_t index = FindInsertIndex(oldEntries[i].first);
+        ControlTag(index) = TagForHash(HashForKey(oldEntries[i].first));
+        entries[index] = std::move(oldEntries[i]);
+      }
+    }
+
+    /// Control tags, one group per 16 slots.
+    std::unique_ptr<SGroup[]> groups;
+
+    /// Entry storage, one per slot.
+    std::unique_ptr<value_type[]> entries;
+
+    /// Number of slots. Either 0 or a power of two that is at least the group size.
+    size_t capacity;
+
+    /// Number of slots that hold entries.
+    size_t numEntries;
+
+    /// Number of slots that hold tombstones.
+    size_t numTombstones;
+  };
+} // namespace Hookshot
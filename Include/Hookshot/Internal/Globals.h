@@ -43,9 +43,64 @@ namespace Hookshot
     };
 
 #ifndef HOOKSHOT_SKIP_CONFIG
+    /// Holds the settings that can be changed while Hookshot is running, without restarting the
+    /// process. Published versions are immutable, so readers never observe a partial update.
+    struct SRuntimeSettings
+    {
+      /// Configured logging level, where 0 means the log is disabled.
+      int64_t logLevel;
+
+      /// Whether or not newly-created hooks should count the number of times they are invoked.
+      bool instrumentHooks;
+
+      /// Number of calls per timed call for sampled hooks, or 0 if timing is not sampled.
+      uint32_t hookTimingSampleInterval;
+
+      /// Number of calls per hook function invocation for every sampled hook, or 0 if each sampled
+      /// hook uses the interval requested when it was created.
+      uint32_t sampledHookInterval;
+
+      /// Latency budget for sampled hooks in microseconds, or 0 if there is no budget.
+      uint32_t hookLatencyBudgetMicroseconds;
+
+      bool operator==(const SRuntimeSettings& other) const = default;
+    };
+
     /// Retrieves the Hookshot configuration data object.
     /// Only useful if IsConfigurationDataValid returns `true`.
     const Infra::Configuration::ConfigurationData& GetConfigurationData(void);
+
+    /// Retrieves the performance profile resolved from the configuration data, which holds the
+    /// settings that select the injection, hook installation, and instrumentation modes.
+    /// @return Resolved performance profile.
+    const SPerformanceProfile& GetPerformanceProfile(void);
+
+    /// Retrieves the most recently published runtime-tunable settings. Until any are published,
+    /// these are resolved from the configuration data read at startup.
+    /// @return Current runtime-tunable settings.
+    const SRuntimeSettings& GetRuntimeSettings(void);
+
+    /// Publishes a new version of the runtime-tunable settings, replacing the current version for
+    /// all subsequent calls to GetRuntimeSettings.
+    /// @param [in] runtimeSettings Runtime-tunable settings to publish.
+    void PublishRuntimeSettings(const SRuntimeSettings& runtimeSettings);
+
+    /// Resolves runtime-tunable settings from configuration data and its performance profile.
+    /// Numeric values are clamped to the ranges supported by the hook stubs.
+    /// @param [in] configData Configuration data from which to read the log level.
+    /// @param [in] performanceProfile Performance profile from which to read other settings.
+    /// @return Resolved runtime-tunable settings.
+    SRuntimeSettings ResolveRuntimeSettings(
+        const Infra::Configuration::ConfigurationData& configData,
+        const SPerformanceProfile& performanceProfile);
+
+#ifndef HOOKSHOT_CORE_LIBRARY
+    /// Changes the minimum severity for log output to match a configured logging level. Creates
+    /// the log file if needed. If the log is already enabled, a level of 0 limits output to
+    /// errors, since an open log file cannot be closed.
+    /// @param [in] logLevel Configured logging level, where 0 means the log is disabled.
+    void ApplyLogLevel(int64_t logLevel);
+#endif
 #endif
 
     /// Retrieves the method by which this form of Hookshot was loaded.
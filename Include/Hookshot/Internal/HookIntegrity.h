@@ -0,0 +1,81 @@
+/***************************************************************************************************
+ * Hookshot
+ *   General-purpose library for injecting DLLs and hooking function calls.
+ ***************************************************************************************************
+ * Authored by Samuel Grossman
+ * Copyright (c) 2019-2025
+ ***********************************************************************************************//**
+ * @file HookIntegrity.h
+ *   Interface declaration for detecting and repairing overwritten hook redirections.
+ **************************************************************************************************/
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+namespace Hookshot
+{
+  /// The hook integrity monitor finds original functions whose redirections have been overwritten
+  /// by something other than Hookshot, such as an overlay or anti-cheat tool restoring the prologues
+  /// it expects to see, and redirects them again. Every patch site is described by a small window
+  /// of memory held in flat arrays, so that a periodic check compares several of them at once and
+  /// hooks themselves pay nothing for being monitored.
+  namespace HookIntegrity
+  {
+    /// Interval, in milliseconds, at which every patch site is checked.
+    inline constexpr uint32_t kCheckIntervalMilliseconds = 5000;
+
+    /// Number of bytes in the window compared at each patch site. Large enough to hold every byte
+    /// modified to redirect an original function, including one laid out for hot-patching.
+    inline constexpr size_t kWindowSizeBytes = sizeof(uint64_t);
+
+    /// Patch sites to be checked. Elements at the same position in each array describe the same
+    /// patch site.
+    struct SPatchSites
+    {
+      /// Address of the first byte of each window.
+      std::vector<const uint8_t*> windows;
+
+      /// Expected contents of each window, as read from memory.
+      std::vector<uint64_t> expectedBytes;
+
+      /// Mask that selects the bytes of each window that belong to the patch site. All other bytes
+      /// are ignored.
+      std::vector<uint64_t> masks;
+    };
+
+    /// Determines the window that covers a range of bytes modified to redirect an original function.
+    /// The window never extends into a page that the range itself does not touch, so reading it is
+    /// safe whenever reading the range is safe.
+    /// @param [in] patchedBegin Address of the first modified byte.
+    /// @param [in] patchedEnd Address just past the last modified byte.
+    /// @param [in] pageSize System page size, in bytes.
+    /// @param [out] window Filled with the address of the first byte of the window.
+    /// @param [out] mask Filled with the mask that selects the modified bytes within the window.
+    /// @return `true` on success, `false` if the range does not fit in a window.
+    bool WindowForPatchedRange(
+        size_t patchedBegin,
+        size_t patchedEnd,
+        size_t pageSize,
+        const uint8_t** window,
+        uint64_t* mask);
+
+    /// Compares the current contents of every patch site with the expected contents, two windows
+    /// at a time using SSE2 instructions, which every supported processor has.
+    /// @param [in] patchSites Patch sites to compare.
+    /// @param [out] mismatches Filled with the position of each patch site whose contents differ,
+    /// in increasing order.
+    void FindMismatchedPatchSites(const SPatchSites& patchSites, std::vector<size_t>& mismatches);
+
+    /// Determines whether or not the hook integrity monitor should run in this process.
+    /// @return `true` if so, `false` otherwise.
+    bool IsEnabled(void);
+
+    /// Starts checking patch sites periodically, using a background task that schedules itself
+    /// again after each check. Has no effect if the hook integrity monitor is disabled or has
+    /// already been started.
+    void StartMonitor(void);
+  } // namespace HookIntegrity
+} // namespace Hookshot
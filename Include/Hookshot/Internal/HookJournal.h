@@ -0,0 +1,69 @@
+/***************************************************************************************************
+ * Hookshot
+ *   General-purpose library for injecting DLLs and hooking function calls.
+ ***************************************************************************************************
+ * Authored by Samuel Grossman
+ * Copyright (c) 2019-2025
+ ***********************************************************************************************//**
+ * @file HookJournal.h
+ *   Declaration of a compact journal of trampoline set-up operations.
+ **************************************************************************************************/
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+namespace Hookshot
+{
+  namespace HookJournal
+  {
+    /// Enumerates the trampoline operations that are recorded in the journal.
+    enum class EOperation : uint8_t
+    {
+      /// Hook function was set, either when creating a hook or when replacing its hook function.
+      SetHookFunction,
+
+      /// Original function was set, which involves transplanting code into the trampoline.
+      SetOriginalFunction,
+    };
+
+    /// Single journal entry. Kept small and free of strings so that recording is cheap.
+    struct SRecord
+    {
+      /// Trampoline on which the operation was performed.
+      const void* trampoline;
+
+      /// Original function address. Not known for hook function operations.
+      const void* originalFunc;
+
+      /// Hook function address. Not known for original function operations.
+      const void* hookFunc;
+
+      /// Type of operation that was performed.
+      EOperation operation;
+
+      /// Number of bytes decoded from the original function. Meaningful for original function
+      /// operations only.
+      uint8_t numDecodedBytes;
+
+      /// Whether or not any jump assists were needed while transplanting code. Meaningful for
+      /// original function operations only.
+      bool usedJumpAssist;
+
+      /// Whether or not the operation succeeded.
+      bool succeeded;
+    };
+
+    /// Maximum number of records retained in the journal. Older records are overwritten once the
+    /// journal is full.
+    inline constexpr size_t kCapacity = 256;
+    static_assert(0 == (kCapacity & (kCapacity - 1)), "Journal capacity must be a power of two.");
+
+    /// Appends a record to the journal. The record is stored in binary form and is formatted into
+    /// a message only if messages of the appropriate severity would actually be output. Safe to use
+    /// from multiple threads concurrently, since each record is given its own slot.
+    /// @param [in] record Record to append.
+    void Record(const SRecord& record);
+  } // namespace HookJournal
+} // namespace Hookshot
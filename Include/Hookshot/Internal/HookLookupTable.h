@@ -0,0 +1,218 @@
+/***************************************************************************************************
+ * Hookshot
+ *   General-purpose library for injecting DLLs and hooking function calls.
+ ***************************************************************************************************
+ * Authored by Samuel Grossman
+ * Copyright (c) 2019-2025
+ ***********************************************************************************************//**
+ * @file HookLookupTable.h
+ *   Data structure declaration for lock-free lookup of trampolines by function address.
+ **************************************************************************************************/
+
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+#include "Trampoline.h"
+
+namespace Hookshot
+{
+  /// Open-addressing hash table that maps function addresses (either original or hook) to the
+  /// trampolines that implement their associated hooks. Lookups are lock-free and may run
+  /// concurrently with modifications. Modifications are not thread-safe with respect to each other
+  /// and require a form of external concurrency control. Entries are never physically removed
+  /// while the table is in use, so removal leaves behind a tombstone whose key can later be
+  /// reused. Whenever the table needs to grow, a new table is built and published atomically.
+  /// Previous tables are retained for the lifetime of this object because concurrent readers might
+  /// still be accessing them, but because capacity doubles each time, the total amount of retained
+  /// memory is bounded by the size of the current table. The table can also be sealed, which takes
+  /// an immutable snapshot of its contents indexed by a perfect hash function, so that each lookup
+  /// touches exactly one slot without probing. Any modification unseals the table, after which
+  /// lookups go back to the regular table until it is sealed again.
+  class HookLookupTable
+  {
+  public:
+
+    HookLookupTable(void);
+
+    HookLookupTable(const HookLookupTable&) = delete;
+
+    /// Retrieves the trampoline associated with the specified function address.
+    /// Can be invoked concurrently with any other method.
+    /// @param [in] func Function address, either original or hook, to look up.
+    /// @return Associated trampoline, or `nullptr` if there is no association.
+    Trampoline* Find(const void* func) const;
+
+    /// Associates the specified function address with the specified trampoline, replacing any
+    /// existing association. Requires external serialization with other modifying methods.
+    /// @param [in] func Function address, either original or hook, to be used as a key.
+    /// @param [in] trampoline Trampoline to which the function address should be mapped.
+    void Insert(const void* func, Trampoline* trampoline);
+
+    /// Removes any association between the specified function address and a trampoline. Requires
+    /// external serialization with other modifying methods.
+    /// @param [in] func Function address, either original or hook, to be removed.
+    void Erase(const void* func);
+
+    /// Determines whether or not the table is currently sealed. Can be invoked concurrently with
+    /// any other method.
+    /// @return `true` if so, `false` otherwise.
+    inline bool IsSealed(void) const
+    {
+      return (nullptr != currentSealedTable.load(std::memory_order_acquire));
+    }
+
+    /// Seals the table by building a perfect-hash snapshot of its current contents and publishing
+    /// it so that readers start using it. Requires external serialization with other modifying
+    /// methods. The snapshot is retained for the lifetime of this object because concurrent readers
+    /// might still be accessing it even after the table is unsealed.
+    /// @return `true` if the table is sealed, `false` if no perfect hash function could be found.
+    bool Seal(void);
+
+    /// Computes the number of bytes of heap memory held by this table, including tables that are
+    /// retained only because concurrent readers might still be accessing them. Requires external
+    /// serialization with modifying methods.
+    /// @return Number of bytes.
+    size_t HeapBytes(void) const;
+
+  private:
+
+    /// Individual slot in the table. Key is written once and never changes after that, whereas
+    /// value can be updated and is set to `nullptr` to indicate that the slot is a tombstone.
+    struct SSlot
+    {
+      /// Function address used as the key. A value of `nullptr` means the slot is unused.
+      std::atomic<const void*> key;
+
+      /// Trampoline address stored as the value.
+      std::atomic<Trampoline*> value;
+    };
+
+    /// Complete table, including its slots and metadata. Published as a unit.
+    struct STable
+    {
+      /// Number of slots in the table. Always a power of two.
+      size_t capacity;
+
+      /// Number of slots that have a non-null key, including tombstones.
+      size_t numOccupied;
+
+      /// Slot storage.
+      std::unique_ptr<SSlot[]> slots;
+    };
+
+    /// Individual slot in a sealed table. Aligned to its own size so that no slot ever straddles a
+    /// cache line. A key of `nullptr` means the slot is unused.
+    struct alignas(2 * sizeof(void*)) SSealedSlot
+    {
+      /// Function address used as the key.
+      const void* key;
+
+      /// Trampoline address stored as the value.
+      Trampoline* value;
+    };
+
+    /// Immutable table indexed by a perfect hash function. Keys are first distributed among
+    /// buckets, and each bucket has a seed, chosen while building the table, that sends every key
+    /// in the bucket to a distinct slot that no other key uses.
+    struct SSealedTable
+    {
+      /// Number of slots in the table. Always a power of two.
+      size_t capacity;
+
+      /// Number of buckets among which keys are distributed. Always a power of two.
+      size_t numBuckets;
+
+      /// Seed of each bucket.
+      std::unique_ptr<uint32_t[]> bucketSeeds;
+
+      /// Slot storage.
+      std::unique_ptr<SSealedSlot[]> slots;
+    };
+
+    /// Initial number of slots in a newly-created table.
+    static constexpr size_t kInitialCapacity = 256;
+
+    /// Average number of keys per bucket in a sealed table.
+    static constexpr size_t kSealedKeysPerBucket = 4;
+
+    /// Maximum number of seeds tried for any one bucket of a sealed table before giving up on its
+    /// current capacity and trying again with double the capacity.
+    static constexpr uint32_t kSealedMaxSeedsPerBucket = 65536;
+
+    /// Number of times the capacity of a sealed table is doubled before sealing is given up.
+    static constexpr int kSealedMaxCapacityDoublings = 2;
+
+    /// Mixes all of the bits of a key together with a seed, for use in sealed tables.
+    /// @param [in] func Function address being used as a key.
+    /// @param [in] seed Seed to mix into the hash.
+    /// @return Hash value, all of whose bits are usable.
+    static inline uint64_t SealedHashForKey(const void* func, const uint64_t seed)
+    {
+      uint64_t hash =
+          static_cast<uint64_t>(reinterpret_cast<size_t>(func)) + (seed * 0x9e3779b97f4a7c15ull);
+      hash = (hash ^ (hash >> 30)) * 0xbf58476d1ce4e5b9ull;
+      hash = (hash ^ (hash >> 27)) * 0x94d049bb133111ebull;
+      return (hash ^ (hash >> 31));
+    }
+
+    /// Computes the slot index for the specified key in a sealed table.
+    /// @param [in] table Sealed table being accessed.
+    /// @param [in] func Function address being used as a key.
+    /// @return Slot index, which is the only slot that can hold the key.
+    static inline size_t SealedSlotIndexForKey(const SSealedTable& table, const void* func)
+    {
+      const size_t bucketIndex =
+          static_cast<size_t>(SealedHashForKey(func, 0)) & (table.numBuckets - 1);
+      const uint64_t bucketSeed = 1 + static_cast<uint64_t>(table.bucketSeeds[bucketIndex]);
+      return static_cast<size_t>(SealedHashForKey(func, bucketSeed)) & (table.capacity - 1);
+    }
+
+    /// Attempts to build a sealed table with the specified capacity holding the specified entries.
+    /// @param [in] entries Key and value of each entry. Keys must be distinct and non-null.
+    /// @param [in] capacity Number of slots, which must be a power of two at least as large as the
+    /// number of entries.
+    /// @return Sealed table, or `nullptr` if no perfect hash function was found.
+    static std::unique_ptr<SSealedTable> BuildSealedTable(
+        const std::vector<SSealedSlot>& entries, size_t capacity);
+
+    /// Removes the published sealed table, if any, so that readers go back to the regular table.
+    /// The sealed table itself is retained.
+    void Unseal(void);
+
+    /// Computes the starting slot index for the specified key.
+    /// @param [in] func Function address being used as a key.
+    /// @param [in] capacity Number of slots in the table being probed.
+    /// @return Starting slot index for a linear probe.
+    static inline size_t SlotIndexForKey(const void* func, const size_t capacity)
+    {
+      // Function addresses are frequently aligned, so the low bits are not useful. Fibonacci
+      // hashing spreads the remaining bits across the whole index range.
+      constexpr size_t kMultiplier =
+          ((sizeof(size_t) > 4) ? static_cast<size_t>(0x9e3779b97f4a7c15ull)
+                                : static_cast<size_t>(0x9e3779b9u));
+      return ((reinterpret_cast<size_t>(func) >> 4) * kMultiplier) & (capacity - 1);
+    }
+
+    /// Builds a new table with double the capacity, moves all live entries into it, and publishes
+    /// it so readers start using it. The previous table is retained.
+    void Grow(void);
+
+    /// Currently-published table. Readers access it without taking any locks.
+    std::atomic<STable*> currentTable;
+
+    /// Owns all tables ever published, including the current one.
+    std::vector<std::unique_ptr<STable>> allTables;
+
+    /// Currently-published sealed table, or `nullptr` if the table is not sealed. Readers access it
+    /// without taking any locks, and when it is published it takes precedence over #currentTable.
+    std::atomic<SSealedTable*> currentSealedTable;
+
+    /// Owns all sealed tables ever published, including the current one.
+    std::vector<std::unique_ptr<SSealedTable>> allSealedTables;
+  };
+} // namespace Hookshot
@@ -0,0 +1,140 @@
+/***************************************************************************************************
+ * Hookshot
+ *   General-purpose library for injecting DLLs and hooking function calls.
+ ***************************************************************************************************
+ * Authored by Samuel Grossman
+ * Copyright (c) 2019-2025
+ ***********************************************************************************************//**
+ * @file HookModuleBundle.h
+ *   Declaration of the hook module bundle file format and interface declaration for loading hook
+ *   modules from hook module bundle files.
+ **************************************************************************************************/
+
+#pragma once
+
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include "ApiWindows.h"
+
+namespace Hookshot
+{
+  /// A hook module bundle file holds several hook modules, each already laid out the way it
+  /// appears in memory once loaded and already relocated for a chosen base address. Bundles are
+  /// created ahead of time by the hook module bundling tool. At runtime the entire bundle is
+  /// mapped into memory with a single copy-on-write view, preferably at the chosen base address,
+  /// which removes the need to open, map, and relocate each hook module separately. Imports are
+  /// resolved as each hook module is loaded, because the addresses of the libraries that hook
+  /// modules import can change whenever the system restarts.
+  ///
+  /// A hook module bundle file consists of a header and an array of module entries, followed by
+  /// the image of each hook module. Every image begins at a file offset that is a multiple of the
+  /// system allocation granularity, so each is placed at a valid module base address once the
+  /// bundle is mapped.
+  ///
+  /// Hook modules loaded from bundles are not known to the system loader. They cannot be unloaded,
+  /// do not receive thread attach and detach notifications, and must not use implicit thread-local
+  /// storage. Bundles are supported only by the 64-bit form of Hookshot, because the 32-bit
+  /// system exception dispatcher refuses to run exception handlers located outside of images that
+  /// the system loader has loaded.
+  namespace HookModuleBundle
+  {
+    /// Signature that identifies a hook module bundle file. Spells "HSMB" in a hex dump.
+    inline constexpr uint32_t kSignature = 0x424d5348;
+
+    /// Version of the hook module bundle file format. Must be incremented whenever the format
+    /// changes.
+    inline constexpr uint32_t kVersion = 1;
+
+    /// File extension conventionally used for hook module bundle files.
+    inline constexpr std::wstring_view kStrFileExtension = L".HookshotBundle";
+
+    /// Alignment, in bytes, of each hook module image within a hook module bundle file, and of the
+    /// base address at which a hook module bundle file is mapped.
+    inline constexpr uint64_t kImageAlignmentBytes = 64 * 1024;
+
+    /// Maximum length, in characters and including the null terminator, of the file name of a
+    /// hook module stored in a hook module bundle file.
+    inline constexpr size_t kMaxHookModuleNameChars = 64;
+
+    /// Header at the very beginning of a hook module bundle file.
+    struct SFileHeader
+    {
+      /// Must be equal to #kSignature.
+      uint32_t signature;
+
+      /// Must be equal to #kVersion.
+      uint32_t version;
+
+      /// Processor architecture of all of the hook modules, using the same values as the machine
+      /// field of an executable file header.
+      uint32_t machine;
+
+      /// Number of module entries that immediately follow the header.
+      uint32_t numModules;
+
+      /// Base address for which the hook modules are relocated, assuming the bundle file is mapped
+      /// in its entirety starting at this address. Must be a multiple of #kImageAlignmentBytes.
+      uint64_t preferredBaseAddress;
+
+      /// Total size of the hook module bundle file, in bytes.
+      uint64_t fileSizeBytes;
+    };
+
+    /// Describes a single hook module within a hook module bundle file.
+    struct SModuleEntry
+    {
+      /// Offset of the hook module image from the beginning of the file. Must be a multiple of
+      /// #kImageAlignmentBytes.
+      uint64_t imageOffset;
+
+      /// Size of the hook module image, in bytes, which is the size of image from its header.
+      uint32_t imageSizeBytes;
+
+      /// Unused, for alignment only.
+      uint32_t reserved;
+
+      /// File name of the hook module, without any directory, null-terminated.
+      wchar_t name[kMaxHookModuleNameChars];
+    };
+
+    static_assert(
+        0 == (sizeof(SFileHeader) % alignof(SModuleEntry)),
+        "Hook module bundle file header size must preserve module entry alignment.");
+
+    /// Maps a hook module bundle file into memory so that the hook modules it holds can be loaded.
+    /// The file remains mapped for the lifetime of the process. Opening the same file more than
+    /// once has no additional effect.
+    /// @param [in] bundleFileName Name of the hook module bundle file.
+    /// @param [out] hookModuleNames Filled with the file names of the hook modules in the bundle,
+    /// in the order in which they are stored.
+    /// @return `true` if the bundle was mapped and is valid, `false` otherwise, in which case the
+    /// system error code identifies the reason.
+    bool OpenBundle(std::wstring_view bundleFileName, std::vector<std::wstring>* hookModuleNames);
+
+    /// Determines whether or not a hook module is held by any hook module bundle file that has been
+    /// opened. Only the file name is compared, without any directory, and case is ignored.
+    /// @param [in] hookModuleFileName File name of the hook module, which can include a directory.
+    /// @return `true` if so, `false` if not.
+    bool IsBundledHookModule(std::wstring_view hookModuleFileName);
+
+    /// Loads a hook module held by a hook module bundle file that has been opened. This involves
+    /// relocating it, if the bundle could not be mapped at its preferred base address, resolving
+    /// its imports, protecting its sections, and finally invoking its entry point. Loading a hook
+    /// module more than once has no additional effect. Safe to invoke concurrently from multiple
+    /// threads.
+    /// @param [in] hookModuleFileName File name of the hook module, which can include a directory.
+    /// @return Handle of the loaded hook module, or `nullptr` on failure, in which case the system
+    /// error code identifies the reason.
+    HMODULE LoadHookModule(std::wstring_view hookModuleFileName);
+
+    /// Determines whether or not a hook module held by any hook module bundle file that has been
+    /// opened has also been successfully loaded. Only the file name is compared, without any
+    /// directory, and case is ignored.
+    /// @param [in] hookModuleFileName File name of the hook module, which can include a directory.
+    /// @return `true` if so, `false` if not.
+    bool IsBundledHookModuleLoaded(std::wstring_view hookModuleFileName);
+  } // namespace HookModuleBundle
+} // namespace Hookshot
@@ -0,0 +1,61 @@
+/***************************************************************************************************
+ * Hookshot
+ *   General-purpose library for injecting DLLs and hooking function calls.
+ ***************************************************************************************************
+ * Authored by Samuel Grossman
+ * Copyright (c) 2019-2025
+ ***********************************************************************************************//**
+ * @file HookModuleManifest.h
+ *   Interface declaration for the cached list of hook modules present in a directory.
+ **************************************************************************************************/
+
+#pragma once
+
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <vector>
+
+namespace Hookshot
+{
+  /// A hook module manifest lists the full paths of all of the hook modules found in a directory,
+  /// so that processes loading hook modules by default do not each need to enumerate the directory
+  /// contents. Manifests are kept in the temporary directory, one per hook module directory, and
+  /// identify the version of the directory from which they were generated by its last-modified
+  /// time. Adding, removing, or renaming a file updates that time, so a manifest is only ever used
+  /// if the set of files in the directory has not changed since it was generated.
+  namespace HookModuleManifest
+  {
+    /// Determines whether or not the hook module manifest is enabled by the configuration file.
+    /// @return `true` if so, `false` if not.
+    bool IsEnabled(void);
+
+    /// Attempts to retrieve the hook modules present in a directory from its manifest.
+    /// @param [in] directoryName Full path of the directory that contains the hook modules.
+    /// @param [out] hookModuleFileNames Filled with the full path of each hook module, if the
+    /// operation succeeds.
+    /// @return `true` if a manifest exists and matches the directory as it currently exists,
+    /// `false` otherwise.
+    bool ReadHookModuleManifest(
+        std::wstring_view directoryName, std::vector<std::wstring>* hookModuleFileNames);
+
+    /// Writes a manifest for a directory, replacing any existing one. Failures are silently
+    /// ignored, since the only consequence is that the directory will be enumerated again next
+    /// time.
+    /// @param [in] directoryName Full path of the directory that contains the hook modules.
+    /// @param [in] directoryLastWriteTime Last-modified time of the directory, which must have
+    /// been obtained before its contents were enumerated.
+    /// @param [in] hookModuleFileNames Full path of each hook module found in the directory.
+    void WriteHookModuleManifest(
+        std::wstring_view directoryName,
+        uint64_t directoryLastWriteTime,
+        const std::vector<std::wstring>& hookModuleFileNames);
+
+    /// Retrieves the last-modified time of a directory, for use when generating its manifest.
+    /// @param [in] directoryName Full path of the directory.
+    /// @param [out] lastWriteTime Filled with the last-modified time, if the operation succeeds.
+    /// @return `true` if the directory exists and its last-modified time was retrieved, `false`
+    /// otherwise.
+    bool GetDirectoryLastWriteTime(std::wstring_view directoryName, uint64_t* lastWriteTime);
+  } // namespace HookModuleManifest
+} // namespace Hookshot
@@ -0,0 +1,44 @@
+/***************************************************************************************************
+ * Hookshot
+ *   General-purpose library for injecting DLLs and hooking function calls.
+ ***************************************************************************************************
+ * Authored by Samuel Grossman
+ * Copyright (c) 2019-2025
+ ***********************************************************************************************//**
+ * @file HookModuleReloader.h
+ *   Interface declaration for reloading hook modules whenever their files change, without
+ *   restarting the process.
+ **************************************************************************************************/
+
+#pragma once
+
+#include <string_view>
+
+#include "ApiWindows.h"
+
+namespace Hookshot
+{
+  namespace HookModuleReloader
+  {
+    /// Determines whether or not hook modules should be reloaded whenever their files change.
+    /// @return `true` if so, `false` otherwise.
+    bool IsHotReloadEnabled(void);
+
+    /// Loads a hook module from a copy of its file, so that the file itself remains free to be
+    /// replaced, and begins tracking it for changes. If no copy can be made, the hook module is
+    /// loaded directly and is not tracked. Safe to invoke concurrently from multiple threads.
+    /// @param [in] hookModuleFileName File name of the hook module to load.
+    /// @return Handle of the loaded module, or `nullptr` on failure.
+    HMODULE LoadHookModule(std::wstring_view hookModuleFileName);
+
+    /// Starts watching the specified directory on a dedicated thread. Whenever the file of any
+    /// tracked hook module in that directory changes, a copy of the new version is loaded and
+    /// initialized in a hook transaction. Each hook it creates on an original function already
+    /// hooked by the previous version replaces the previous version's hook function instead. Hooks
+    /// of the previous version that the new version does not recreate are removed. The previous
+    /// version is unloaded once no other thread is observed to be executing it or to have it on
+    /// its stack. Has no effect if no hook modules are tracked.
+    /// @param [in] directoryName Directory that contains the tracked hook modules.
+    void StartWatching(std::wstring_view directoryName);
+  } // namespace HookModuleReloader
+} // namespace Hookshot
@@ -0,0 +1,60 @@
+/***************************************************************************************************
+ * Hookshot
+ *   General-purpose library for injecting DLLs and hooking function calls.
+ ***************************************************************************************************
+ * Authored by Samuel Grossman
+ * Copyright (c) 2019-2025
+ ***********************************************************************************************//**
+ * @file HookPlanCache.h
+ *   Interface declaration for the persistent cache of precomputed hook plans.
+ **************************************************************************************************/
+
+#pragma once
+
+#include "HookshotTypes.h"
+#include "Trampoline.h"
+
+namespace Hookshot
+{
+  /// A hook plan describes the instructions that need to be transplanted out of an original
+  /// function in a position-independent way, so that they can be transplanted into a trampoline by
+  /// copying and patching bytes rather than by decoding and re-encoding them. Plans are identified
+  /// by the name and timestamp of the module that contains the original function, along with the
+  /// original function's offset within it. They are kept in a file that is shared by all processes
+  /// and memory-mapped the first time a plan is needed. Plans generated while processes are running
+  /// are also published immediately in a shared memory segment, so that other processes, typically
+  /// children of the one that generated them, can use them before the file is written. A plan is
+  /// only ever used if the original function still contains exactly the bytes from which the plan
+  /// was generated.
+  namespace HookPlanCache
+  {
+    /// Determines whether or not the hook plan cache is enabled by the configuration file.
+    /// @return `true` if so, `false` if not.
+    bool IsEnabled(void);
+
+    /// Retrieves the number of lookups, hits, and recorded hook plans since this process started.
+    /// Safe to invoke concurrently from multiple threads.
+    /// @param [out] statistics Filled with the hook plan cache statistics.
+    void GetStatistics(SHookPlanCacheStatistics* statistics);
+
+    /// Attempts to fill the specified decoded original function object using a cached hook plan
+    /// instead of decoding the original function. Safe to invoke concurrently from multiple
+    /// threads.
+    /// @param [in] originalFunc Original function address.
+    /// @param [out] decoded Filled with the cached hook plan, if the operation succeeds.
+    /// @return `true` if a valid hook plan was found for the original function as it currently
+    /// exists, `false` otherwise.
+    bool LookupHookPlan(const void* originalFunc, Trampoline::SDecodedOriginalFunction* decoded);
+
+    /// Records the hook plan for an original function that was just decoded, so that it can be
+    /// written to the hook plan cache file. Safe to invoke concurrently from multiple threads.
+    /// @param [in] decoded Decoded original function, which must contain a valid hook plan.
+    void RecordHookPlan(const Trampoline::SDecodedOriginalFunction& decoded);
+
+    /// Writes all hook plans recorded by this process, merged with those already present, to the
+    /// hook plan cache file. Hook plans continue to be available to this process afterwards.
+    /// Failures are silently ignored, since the only consequence is that some original functions
+    /// will be decoded again next time.
+    void WriteHookPlanCache(void);
+  } // namespace HookPlanCache
+} // namespace Hookshot
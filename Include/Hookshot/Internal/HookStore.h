@@ -11,13 +11,26 @@
 
 #pragma once
 
+#include <climits>
+#include <cstddef>
 #include <cstdint>
 #include <shared_mutex>
+#include <array>
+#include <list>
+#include <mutex>
 #include <unordered_map>
+#include <unordered_set>
+#include <utility>
 #include <vector>
 
 #include "ApiWindows.h"
+#include "CallbackHooks.h"
+#include "FlatPointerMap.h"
+#include "HookIntegrity.h"
+#include "HookLookupTable.h"
 #include "HookshotTypes.h"
+#include "SampledTiming.h"
+#include "SharedStatistics.h"
 #include "Trampoline.h"
 #include "TrampolineStore.h"
 
@@ -25,11 +38,39 @@ namespace Hookshot
 {
   /// Holds information about hooks and provides an interface a hook module can use to configure
   /// them. Enforces serialization between threads as needed. This is a global data structure
-  /// accessed using an interface object.
-  class HookStore : public IHookshot
+  /// accessed using an interface object, of which every version is implemented here. Final, so that
+  /// calls made through a reference to this class rather than to its interface are direct calls.
+  class HookStore final : public IHookshot,
+                          public IHookshot2,
+                          public IHookshot3,
+                          public IHookshot4,
+                          public IHookshot5,
+                          public IHookshot6,
+                          public IHookshot7,
+                          public IHookshot8,
+                          public IHookshot9,
+                          public IHookshot10,
+                          public IHookshot11,
+                          public IHookshot12,
+                          public IHookshot13,
+                          public IHookshot14,
+                          public IHookshot15
   {
   public:
 
+    /// Identifies an existing hook whose hook function lies within a particular range of addresses.
+    struct SHookInRange
+    {
+      /// Address of the function that is hooked.
+      void* originalFunc;
+
+      /// Hook function, which lies within the range.
+      const void* hookFunc;
+
+      /// Whether or not other hooks are chained onto the same original function.
+      bool isChained;
+    };
+
     /// Internal version of #CreateHook. Intended to be used within Hookshot only. Can be used to
     /// create hooks that are for internal Hookshot use and hooks requested by API users.
     /// @param [in] originalFunc Address of the function that should be hooked.
@@ -45,34 +86,1473 @@ namespace Hookshot
         const bool isInternal,
         const void** originalFuncAfterHook);
 
+    /// Internal version of #CreateCallTraceHook. Intended to be used within Hookshot only, such as
+    /// for creating call trace hooks that are requested by the configuration file rather than by a
+    /// hook module.
+    /// @param [in] originalFunc Address of the function that should be traced.
+    /// @return Result of the operation.
+    static EResult CreateCallTraceHookInternal(void* originalFunc);
+
+    /// Creates a batch of hooks for internal Hookshot use, all while holding the hook store lock
+    /// once and changing memory protection once per affected page. Internal hooks are never
+    /// chained, so an original function that is already hooked is a duplicate. Not usable within
+    /// transactions.
+    /// @param [in] hookSpecs Hooks to create.
+    /// @param [in] numHookSpecs Number of hooks to create.
+    /// @param [in] originalFuncsAfterHook One pointer per hook, each filled on success with what
+    /// would ordinarily be returned by #GetOriginalFunction. Individual pointers can be `nullptr`.
+    /// @param [out] results One result per hook.
+    static void CreateInternalHooks(
+        const SHookSpec* hookSpecs,
+        size_t numHookSpecs,
+        const void** const* originalFuncsAfterHook,
+        EResult* results);
+
+#ifdef _WIN64
+    /// Suggests a location for the first trampoline store placed near the module that contains the
+    /// specified original function, such as the location that the parent process used for its own
+    /// trampolines near the same module. The suggested location is tried before any other, and it
+    /// is ignored if a trampoline store has already been placed near the module.
+    /// @param [in] originalFunc Address of a function that is about to be hooked.
+    /// @param [in] trampolineStoreAddress Suggested base address for the trampoline store.
+    static void SuggestTrampolineStoreLocation(
+        const void* originalFunc, void* trampolineStoreAddress);
+#endif
+
+    /// Internal version of #CreateHooksByExportName. Intended to be used within Hookshot only.
+    /// Resolves the exported functions and then creates all of the hooks by invoking #CreateHooks
+    /// on the specified interface, so that interfaces which wrap the hook store can intercept hook
+    /// creation. Parameters are otherwise the same as #CreateHooksByExportName.
+    /// @param [in] hookshot Interface through which to create the hooks.
+    /// @return Result of the operation.
+    static EResult __fastcall CreateHooksByExportNameInternal(
+        IHookshot* hookshot,
+        void* moduleHandle,
+        const char* const* exportNames,
+        const void* const* hookFuncs,
+        size_t numHooks,
+        EResult* results);
+
+    /// Internal version of #CreateHooksBySymbol. Intended to be used within Hookshot only. Looks up
+    /// the symbols and then creates all of the hooks by invoking #CreateHooks on the specified
+    /// interface, so that interfaces which wrap the hook store can intercept hook creation.
+    /// Parameters are otherwise the same as #CreateHooksBySymbol.
+    /// @param [in] hookshot Interface through which to create the hooks.
+    /// @return Result of the operation.
+    static EResult __fastcall CreateHooksBySymbolInternal(
+        IHookshot* hookshot,
+        const wchar_t* symbolIndexFilename,
+        void* moduleHandle,
+        const char* const* symbolNames,
+        const void* const* hookFuncs,
+        size_t numHooks,
+        EResult* results);
+
+    /// Identifies all existing hooks whose hook functions lie within the specified range of
+    /// addresses, such as the image of a hook module. Intended to be used within Hookshot only.
+    /// @param [in] begin Lowest address in the range.
+    /// @param [in] end One past the highest address in the range.
+    /// @return All hooks whose hook functions lie within the range.
+    static std::vector<SHookInRange> HooksWithHookFunctionsInRange(
+        const void* begin, const void* end);
+
+    /// Determines whether or not any thread in this process, other than the calling thread, might
+    /// be executing code within the specified range of addresses or might return into it. Other
+    /// threads are suspended briefly, and the instruction pointer, the integer registers, and every
+    /// pointer-sized value on the live part of the stack of each one are checked, so the result is
+    /// conservative. Intended to be used within Hookshot only.
+    /// @param [in] begin Lowest address in the range.
+    /// @param [in] end One past the highest address in the range.
+    /// @return `true` if so, `false` if not.
+    static bool IsAddressRangeInUseByOtherThreads(const void* begin, const void* end);
+
+    /// Opens handles to, and then suspends, all threads in this process other than the calling
+    /// thread. All memory allocation happens before the first thread is suspended because a
+    /// suspended thread might be holding a lock that allocation requires. Threads created after
+    /// enumeration begins are not suspended. Intended to be used within Hookshot only.
+    /// @param [out] threads Filled with handles to the threads that were suspended.
+    static void SuspendOtherThreads(std::vector<HANDLE>& threads);
+
+    /// Resumes and closes handles to all of the specified threads. Intended to be used within
+    /// Hookshot only.
+    /// @param [in] threads Handles to threads previously suspended by #SuspendOtherThreads.
+    static void ResumeThreads(const std::vector<HANDLE>& threads);
+
+    /// Fills an array of shared statistics records with information about every existing inline
+    /// hook, including hooks chained onto other hooks. Takes the lock in shared mode. Intended to
+    /// be used within Hookshot only.
+    /// @param [out] records Array to receive one record per hook.
+    /// @param [in] maxRecords Capacity of the record array.
+    /// @param [out] numHooks Filled with the total number of hooks, which can exceed the capacity.
+    /// @param [out] numRecords Filled with the number of records written.
+    static void CollectStatistics(
+        SharedStatistics::SRecord* records,
+        uint32_t maxRecords,
+        uint32_t* numHooks,
+        uint32_t* numRecords);
+
+    /// Fills an array of shared statistics records exactly as #CollectStatistics does, except that
+    /// nothing is collected if the lock cannot be taken in shared mode immediately. Suitable for
+    /// use while the process is exiting, when the lock might be held by a terminated thread.
+    /// Intended to be used within Hookshot only.
+    /// @param [out] records Array to receive one record per hook.
+    /// @param [in] maxRecords Capacity of the record array.
+    /// @param [out] numHooks Filled with the total number of hooks, which can exceed the capacity.
+    /// @param [out] numRecords Filled with the number of records written.
+    /// @return `true` if statistics were collected, `false` if the lock was unavailable.
+    static bool TryCollectStatistics(
+        SharedStatistics::SRecord* records,
+        uint32_t maxRecords,
+        uint32_t* numHooks,
+        uint32_t* numRecords);
+
+    /// Checks every latency budget against the calls sampled since the previous check, and
+    /// disables any hook that has exceeded its budget for too many checks in a row. Takes the lock
+    /// in exclusive mode. Intended to be used within Hookshot only.
+    /// @param [in] ticksPerMicrosecond Measured rate of the processor time stamp counter.
+    /// @return Number of latency budgets that remain configured after the check.
+    static size_t EnforceLatencyBudgets(uint64_t ticksPerMicrosecond);
+
+    /// Removes every one-shot hook whose first call has happened. A one-shot hook that has since
+    /// had other hooks chained onto it is disabled instead, because removing it would also remove
+    /// them. Takes the lock in shared mode to check and in exclusive mode only if there is a hook
+    /// to remove. Intended to be used within Hookshot only.
+    /// @return Number of one-shot hooks that remain because their first calls have not happened.
+    static size_t RemoveFiredOneShotHooks(void);
+
+    /// Checks the patch site of every enabled hook and redirects again any original function whose
+    /// redirection has been overwritten by something other than Hookshot. Takes the lock in shared
+    /// mode to check and in exclusive mode only if a repair is needed or the patch sites need to be
+    /// identified again. Intended to be used within Hookshot only.
+    /// @return Number of original functions redirected again.
+    static size_t RepairOverwrittenPatches(void);
+
+    /// Changes the number of calls per timed call of every hook whose timing is already sampled.
+    /// Hooks whose timing is not sampled are unaffected. Intended to be used within Hookshot only.
+    /// @param [in] sampleInterval Number of calls per timed call. Must be non-zero.
+    /// @return Number of hooks whose sample interval was changed.
+    static size_t SetHookTimingSampleIntervals(uint32_t sampleInterval);
+
+    /// Changes the number of calls per hook function invocation of every sampled hook that still
+    /// exists. Intended to be used within Hookshot only.
+    /// @param [in] sampleInterval Number of calls per hook function invocation. Must be non-zero.
+    /// @return Number of sampled hooks whose sample interval was changed.
+    static size_t SetSampledHookIntervals(uint32_t sampleInterval);
+
+    /// Allocates a thread-local storage slot that is held directly in the thread environment
+    /// block, so that generated code can access it at a fixed offset. Slots are never freed.
+    /// Intended to be used within Hookshot only.
+    /// @return Offset of the slot within the thread environment block, or 0 if no such slot could
+    /// be allocated.
+    static size_t AllocateThreadEnvironmentBlockSlot(void);
+
     // IHookshot
     EResult __fastcall CreateHook(void* originalFunc, const void* hookFunc) override;
     EResult __fastcall DisableHookFunction(const void* originalOrHookFunc) override;
     const void* __fastcall GetOriginalFunction(const void* originalOrHookFunc) override;
     EResult __fastcall ReplaceHookFunction(
         const void* originalOrHookFunc, const void* newHookFunc) override;
+    EResult __fastcall CreateHooks(
+        const SHookSpec* hookSpecs, size_t numHookSpecs, EResult* results) override;
+    EResult __fastcall BeginTransaction(void) override;
+    EResult __fastcall CommitTransaction(void) override;
+    EResult __fastcall GetHookStatistics(
+        const void* originalOrHookFunc, SHookStatistics* statistics) override;
+    EResult __fastcall RemoveHook(const void* originalOrHookFunc) override;
+    EResult __fastcall CreateDeferredHook(
+        const wchar_t* moduleName, const char* exportName, const void* hookFunc) override;
+    EResult __fastcall CreateHooksByExportName(
+        void* moduleHandle,
+        const char* const* exportNames,
+        const void* const* hookFuncs,
+        size_t numHooks,
+        EResult* results) override;
+    EResult __fastcall CreateHookWithKind(
+        EHookKind hookKind,
+        void* originalFunc,
+        const void* hookFunc,
+        void* importingModule) override;
+    EResult __fastcall CreateVirtualTableHooks(
+        void* virtualTable,
+        const size_t* slotIndices,
+        const void* const* hookFuncs,
+        size_t numHooks,
+        EResult* results) override;
+    EResult __fastcall SetHookReentrancyGuard(
+        const void* originalOrHookFunc, bool enabled) override;
+    size_t __fastcall GetReentrancyGuardDepthOffset(void) override;
+    EResult __fastcall SetHookCallerFilter(
+        const void* originalOrHookFunc,
+        const void* const* callerModules,
+        size_t numCallerModules) override;
+    EResult __fastcall CreateCallTraceHook(void* originalFunc) override;
+    EResult __fastcall GetHookTimingHistogram(
+        const void* originalOrHookFunc, SHookTimingHistogram* histogram) override;
+    EResult __fastcall ReserveHooks(
+        size_t numHooks, const void* const* targetModules, size_t numTargetModules) override;
+    EResult __fastcall SnapshotHooks(
+        SHookInfo* hookInfo, size_t maxHookInfo, size_t* numHooks) override;
+    EResult __fastcall SetHookGroup(const void* originalOrHookFunc, uint32_t groupId) override;
+    EResult __fastcall SetHookGroupEnabled(uint32_t groupId, bool enabled) override;
+    EResult __fastcall BeginCreateHooksAsync(
+        const SHookSpec* hookSpecs,
+        size_t numHookSpecs,
+        THookInstallProgressCallback progressCallback,
+        void* progressCallbackContext,
+        SHookInstallOperation** operation) override;
+    EResult __fastcall CancelHookInstall(SHookInstallOperation* operation) override;
+    EResult __fastcall WaitForHookInstall(
+        SHookInstallOperation* operation, EResult* results) override;
+    EResult __fastcall CreateCallbackHook(
+        void* originalFunc,
+        TCallbackHookPre preCallback,
+        TCallbackHookPost postCallback,
+        void* context) override;
+    EResult __fastcall CreateContextHook(
+        void* originalFunc, const void* hookFunc, void* context) override;
+    size_t __fastcall GetHookContextOffset(void) override;
+    EResult __fastcall CreateProbe(void* address, TProbeCallback callback, void* context) override;
+    EResult __fastcall FindPatterns(
+        void* moduleHandle,
+        const SBytePattern* patterns,
+        size_t numPatterns,
+        void** results) override;
+    EResult __fastcall CreateHotSwapHook(
+        void* originalFunc, const void* hookFunc, SHotSwapSlot** slot) override;
+    EResult __fastcall HotSwapHookFunction(SHotSwapSlot* slot, const void* newHookFunc) override;
+    EResult __fastcall SetThreadHookOverride(
+        const void* originalOrHookFunc, const void* overrideFunc) override;
+    EResult __fastcall SetHookLatencyBudget(
+        const void* originalOrHookFunc, uint32_t budgetMicroseconds) override;
+    EResult __fastcall GetMemoryFootprint(SMemoryFootprint* footprint) override;
+    EResult __fastcall GetTrampolineStoreFootprints(
+        STrampolineStoreFootprint* storeFootprints,
+        size_t maxStoreFootprints,
+        size_t* numStores) override;
+    EResult __fastcall GetModuleFootprints(
+        SModuleFootprint* moduleFootprints,
+        size_t maxModuleFootprints,
+        size_t* numModules) override;
+    void* __fastcall QueryInterface(uint32_t version) override;
+
+    // IHookshot2
+    EResult __fastcall GetOriginalFunctions(
+        const void* const* originalOrHookFuncs,
+        size_t numFuncs,
+        const void** originalFuncs) override;
+    EResult __fastcall ReplaceHookFunctions(
+        const void* const* originalOrHookFuncs,
+        const void* const* newHookFuncs,
+        size_t numFuncs,
+        EResult* results) override;
+    EResult __fastcall DisableHookFunctions(
+        const void* const* originalOrHookFuncs, size_t numFuncs, EResult* results) override;
+    EResult __fastcall GetHooksStatistics(
+        const void* const* originalOrHookFuncs,
+        size_t numFuncs,
+        SHookStatistics* statistics,
+        EResult* results) override;
+    EResult __fastcall RemoveHooks(
+        const void* const* originalOrHookFuncs, size_t numFuncs, EResult* results) override;
+
+    // IHookshot3
+    EResult __fastcall GetHookCallerHistogram(
+        const void* originalOrHookFunc, SHookCallerHistogram* histogram) override;
+
+    // IHookshot4
+    EResult __fastcall InstrumentModuleExports(
+        void* moduleHandle,
+        const SModuleInstrumentationOptions* options,
+        size_t* numInstrumented) override;
+
+    // IHookshot5
+    EResult __fastcall CreateHookAuto(
+        void* originalFunc, const void* hookFunc, EHookKind* chosenKind) override;
+
+    // IHookshot6
+    EResult __fastcall Seal(void) override;
+
+    // IHookshot7
+    EResult __fastcall CreateOneShotHook(void* originalFunc, const void* hookFunc) override;
+
+    // IHookshot8
+    EResult __fastcall InvalidateCodeRange(const void* rangeBase, size_t rangeSizeBytes) override;
+
+    // IHookshot9
+    EResult __fastcall RelocateCode(
+        const void* src,
+        size_t minBytes,
+        void* dst,
+        size_t dstCapacity,
+        uint32_t options,
+        SRelocatedCode* relocated) override;
+
+    // IHookshot10
+    EResult __fastcall CreateHookEx(
+        void* originalFunc,
+        const void* hookFunc,
+        const void** originalFuncOut,
+        HookHandle* handleOut) override;
+
+    // IHookshot11
+    EResult __fastcall GetHookHandle(const void* originalOrHookFunc, HookHandle* handle) override;
+    EResult __fastcall ReplaceHookFunctionByHandle(
+        HookHandle handle, const void* newHookFunc) override;
+    EResult __fastcall DisableHookFunctionByHandle(HookHandle handle) override;
+    EResult __fastcall GetHookStatisticsByHandle(
+        HookHandle handle, SHookStatistics* statistics) override;
+
+    // IHookshot12
+    EResult __fastcall CreateHooksBySymbol(
+        const wchar_t* symbolIndexFilename,
+        void* moduleHandle,
+        const char* const* symbolNames,
+        const void* const* hookFuncs,
+        size_t numHooks,
+        EResult* results) override;
+
+    // IHookshot13
+    EResult __fastcall CreateSampledHook(
+        void* originalFunc, const void* hookFunc, uint32_t sampleInterval) override;
+    EResult __fastcall SetSampledHookInterval(
+        const void* originalFunc, uint32_t sampleInterval) override;
+
+    // IHookshot14
+    EResult __fastcall CanHook(const void* originalFunc, SHookFeasibility* feasibility) override;
+
+    // IHookshot15
+    EResult __fastcall GetHookPlanCacheStatistics(SHookPlanCacheStatistics* statistics) override;
 
   private:
 
+    /// Number of bytes at the beginning of an original function that are overwritten by the jump
+    /// that redirects execution to its hook. Equal to the length of a jump instruction.
+    static constexpr size_t kOriginalFunctionPrologueSizeBytes = 5;
+
+#ifdef _WIN64
+    /// Number of bytes at the beginning of an original function that are overwritten by the
+    /// absolute jump that redirects execution to its hook, which is used when no trampoline can be
+    /// placed close enough to it. Equal to the length of an absolute jump instruction.
+    static constexpr size_t kAbsoluteJumpPrologueSizeBytes = 14;
+
+    /// Maximum number of candidate locations probed by a single search for a place to put a
+    /// trampoline store near a memory region, if the caller can instead use a trampoline placed
+    /// anywhere in memory. Each probe costs at least one system call, and the address space near a
+    /// module is sometimes so crowded that a complete search takes far longer than the hook is
+    /// worth. Later searches resume where this one stopped.
+    static constexpr int kMaxLocationsProbedBeforeFarTrampoline = 256;
+
+    /// Maximum distance, in bytes, below the base address of a module at which a trampoline store
+    /// is placed for original functions in that module. Transplanted RIP-relative data accesses
+    /// whose targets are out of range are rewritten to use absolute addresses, so only the jumps
+    /// between the trampolines and the original functions limit this distance, and the rest of the
+    /// 2GB range is left for the size of the module itself.
+    static constexpr size_t kMaxTrampolineStoreDistanceBytes = static_cast<size_t>(INT_MAX / 2);
+#endif
+
+    /// Number of entries in each per-thread table of hook overrides, which is also the maximum
+    /// number of hooks that can ever be given thread overrides.
+    static constexpr size_t kMaxThreadOverrides = 1024;
+
+    /// Number of trampoline stores and number of slots per trampoline store that hook handles can
+    /// encode, each of which occupies 16 bits of a handle. Hooks whose trampolines lie beyond
+    /// either limit have no handles.
+    static constexpr size_t kHookHandleMaxStores = 0xffff;
+    static constexpr size_t kHookHandleMaxSlots = 0x10000;
+
+    /// Describes a pending redirection that is part of a batch operation.
+    struct SPendingRedirect
+    {
+      /// Source address, which is the original function to be hooked.
+      void* from;
+
+      /// Destination address, which is the hook region of the associated trampoline.
+      const void* to;
+
+      /// Index of the associated hook specification in the batch.
+      size_t hookSpecIndex;
+
+      /// Trampoline that implements the hook.
+      Trampoline* trampoline;
+
+      /// Whether or not the redirection must be skipped because it cannot be written safely.
+      bool skipped;
+
+      /// Whether or not the redirection was successfully written.
+      bool succeeded;
+    };
+
+    /// Holds information about a page that is modified by a batch of redirections.
+    struct SAffectedPage
+    {
+      /// Base address of the page.
+      size_t address;
+
+      /// Original protection flags, for restoration.
+      DWORD originalProtection;
+
+      /// Whether or not the page was successfully made writable.
+      bool unprotected;
+
+      /// Whether or not the original protection flags were successfully restored.
+      bool restored;
+    };
+
+    /// Describes the reentrancy guard of a hook, which is implemented by a stub that sits between
+    /// the innermost trampoline and its hook function, or its instrumentation stub if it has one.
+    struct SReentrancyGuard
+    {
+      /// Reentrancy guard stub. Once allocated, it stays in place for as long as the hook exists.
+      Trampoline* stub;
+
+      /// Whether or not the reentrancy guard is enabled. A disabled reentrancy guard stub
+      /// transfers control to the hook function no matter what the per-thread depth is.
+      bool enabled;
+    };
+
+    /// Describes the caller filter of a hook, which is implemented by a stub that sits between the
+    /// reentrancy guard stub, or the innermost trampoline if it has none, and its hook function, or
+    /// its instrumentation stub if it has one.
+    struct SCallerFilter
+    {
+      /// Caller filter stub. Once allocated, it stays in place for as long as the hook exists.
+      Trampoline* stub;
+
+      /// Every table of caller address ranges that the caller filter stub has ever used, the last
+      /// of which is current. Threads might still be scanning a previous table after it is
+      /// replaced, so all of them are kept until the caller filter stub is reclaimed.
+      std::list<std::vector<Trampoline::SCallerAddressRange>> rangeTables;
+
+      /// Whether or not the caller filter is enabled. A disabled caller filter stub transfers
+      /// control to the hook function no matter who the caller is.
+      bool enabled;
+    };
+
+    /// Describes the thread override of a hook, which is implemented by a stub that sits closest to
+    /// its hook function, behind every other stub.
+    struct SThreadOverride
+    {
+      /// Thread override stub. Once allocated, it is never deallocated, even if the hook is
+      /// removed, because threads might still be executing it.
+      Trampoline* stub;
+
+      /// Index of the entry within each per-thread table of hook overrides that the stub consults.
+      /// Never reused by any other hook.
+      size_t index;
+    };
+
+    /// Describes a one-shot hook, which is implemented by a stub that is the hook function of its
+    /// trampoline and that lets only the first call through to the real hook function.
+    struct SOneShotHook
+    {
+      /// One-shot stub. Once its hook is created, it is never deallocated, even if the hook is
+      /// removed, because threads might still be executing it.
+      Trampoline* stub;
+
+      /// Flag that the stub sets when it is first executed. Never freed, for the same reason.
+      volatile long* firedFlag;
+    };
+
+    /// Describes a sampled hook, which is implemented by a stub that is the hook function of its
+    /// trampoline and that lets only one out of every so many calls through to the real hook
+    /// function.
+    struct SSampledHook
+    {
+      /// Sampled hook stub. Once its hook is created, it is never deallocated, even if the hook is
+      /// removed, because threads might still be executing it.
+      Trampoline* stub;
+
+      /// Address of the original function that the sampled hook was created for.
+      const void* originalFunc;
+
+      /// Number of calls per hook function invocation.
+      uint32_t sampleInterval;
+    };
+
+    /// Describes the sampled timing of a hook, which is implemented by a stub that sits between the
+    /// innermost trampoline, or its instrumentation stub if it has one, and its hook function.
+    struct SSampledTiming
+    {
+      /// Sampled timing stub. Once allocated, it stays in place for as long as the hook exists.
+      Trampoline* stub;
+
+      /// Sample block into which timed calls are recorded. Never freed.
+      SampledTiming::SSampleBlock* sampleBlock;
+
+      /// Number of calls per sample.
+      uint32_t sampleInterval;
+    };
+
+    /// Describes an export counter stub, which is an instrumentation stub that serves as the hook
+    /// function of an instrumented export until its trampoline is prepared.
+    struct SExportCounterStub
+    {
+      /// Instrumentation stub, whose target is set once the trampoline exists.
+      Trampoline* stub;
+
+      /// Number of calls per sample for the export, or 0 to use the configured value.
+      uint32_t sampleInterval;
+    };
+
+    /// Estimated cost of hooking a particular function using a particular kind of hook, in the
+    /// abstract units of the cost model used to select hook kinds automatically.
+    struct SHookKindCost
+    {
+      /// Kind of hook being considered.
+      EHookKind hookKind;
+
+      /// Estimated cost, with lower values being preferable.
+      uint32_t cost;
+    };
+
+    /// Describes the latency budget of a hook whose timing is sampled.
+    struct SLatencyBudget
+    {
+      /// Maximum 99th percentile duration, in microseconds.
+      uint32_t budgetMicroseconds;
+
+      /// Number of consecutive checks in which the hook has exceeded its budget.
+      uint32_t numChecksOverBudget;
+
+      /// Contents of the timing histogram as of the previous check, so that each check covers only
+      /// the calls sampled since then.
+      uint64_t previousBuckets[kHookTimingHistogramNumBuckets];
+    };
+
+    /// Identifies one of the hooks in a chain of hooks that share the same original function.
+    struct SChainedHook
+    {
+      /// Hook function.
+      const void* hookFunc;
+
+      /// Trampoline that implements the hook. Its original function region leads to the next hook
+      /// function in the chain, or to the original function itself for the innermost hook.
+      Trampoline* trampoline;
+    };
+
+    /// Describes the membership of a hook in a hook group.
+    struct SHookGroupMember
+    {
+      /// Identifier of the group.
+      uint32_t groupId;
+
+      /// Hook function to restore when the group is enabled. Updated each time the group is
+      /// disabled, so that it always reflects the most recent hook function.
+      const void* enabledHookFunc;
+    };
+
+    /// Describes a trampoline that belonged to a removed hook and is waiting to be reclaimed.
+    struct SRetiredTrampoline
+    {
+      /// Trampoline that implemented the hook.
+      Trampoline* trampoline;
+
+      /// Instrumentation stub that sat between the trampoline and its hook function, if any.
+      const Trampoline* instrumentationStub;
+
+      /// Sampled timing stub that sat between the trampoline and its hook function, if any.
+      const Trampoline* sampledTimingStub;
+
+      /// Reentrancy guard stub that sat between the trampoline and its hook function, if any.
+      const Trampoline* reentrancyGuardStub;
+
+      /// Caller filter stub that sat between the trampoline and its hook function, if any.
+      const Trampoline* callerFilterStub;
+
+      /// Hook stub that the original function jumped to instead of the trampoline, if any.
+      const Trampoline::UHookCode* hookStub;
+
+      /// Code cave that the original function jumped to on its way to the trampoline, if any.
+      const void* codeCaveStub;
+
+      /// Reclamation epoch during which the trampoline was retired. It can only be reclaimed during
+      /// a later epoch.
+      uint64_t retiredEpoch;
+
+      /// Whether or not some thread was observed executing the trampoline during the current
+      /// reclamation epoch.
+      bool executing;
+    };
+
+    /// Tracks how far into a sequence of trampoline stores every store is known to be full, so that
+    /// allocating a trampoline does not keep looking at stores that cannot satisfy it.
+    struct SFreeSpaceCursor
+    {
+      /// Position within the sequence of the first store that might have free space.
+      size_t position;
+
+      /// Value of TrampolineStore::DeallocationCount as of the last time the sequence was looked
+      /// at from the beginning. Stores before #position can only have gained free space if this
+      /// value has changed since then.
+      uint64_t deallocationCount;
+    };
+
+#ifdef _WIN64
+    /// Holds information about the trampoline stores placed near a particular memory region.
+    struct SNearModuleStores
+    {
+      /// Indices of trampoline stores placed near the memory region, in order of creation.
+      std::vector<int> storeIndices;
+
+      /// Position within #storeIndices from which to look for a store with free space.
+      SFreeSpaceCursor freeSpaceCursor;
+
+      /// Number of candidate locations, counting backward from the memory region's base address,
+      /// that have already been probed, whether successfully or not. The next search for a place
+      /// to put a new trampoline store begins immediately after these.
+      int numLocationsTried;
+
+      /// Location to try before searching for a place to put the first trampoline store, or
+      /// `nullptr` if there is none. Cleared once it has been tried.
+      void* suggestedStoreAddress;
+
+      /// Indices of trampoline stores placed near other memory regions that are also close enough
+      /// to this memory region to be used for it, in the order in which they were found to be.
+      std::vector<int> sharedStoreIndices;
+
+      /// Position within #sharedStoreIndices from which to look for a store with free space.
+      SFreeSpaceCursor sharedFreeSpaceCursor;
+    };
+#endif
+
+    /// Allocates a trampoline that is suitable for hooking the specified original function, placing
+    /// it within range of the original function as needed. Requires that the hook store lock be
+    /// held exclusively.
+    /// @param [in] originalFunc Address of the function that is being hooked.
+    /// @param [out] trampolineStoreOut Filled with the store from which the trampoline was
+    /// allocated.
+    /// @param [out] trampolineOut Filled with the allocated trampoline.
+    /// @param [in] canUseFarTrampoline Whether or not the caller can use a trampoline placed
+    /// anywhere in memory if this fails, in which case the search for space near the original
+    /// function is cut short. Has no effect in 32-bit mode.
+    /// @return Result of the operation.
+    static EResult AllocateTrampoline(
+        void* originalFunc,
+        TrampolineStore** trampolineStoreOut,
+        Trampoline** trampolineOut,
+        const bool canUseFarTrampoline = false);
+
+#ifdef _WIN64
+    /// Allocates a trampoline without regard for where it is placed, for hooks whose original
+    /// functions are redirected using absolute jumps. Requires that the hook store lock be held
+    /// exclusively.
+    /// @param [out] trampolineStoreOut Filled with the store from which the trampoline was
+    /// allocated.
+    /// @param [out] trampolineOut Filled with the allocated trampoline.
+    /// @return Result of the operation.
+    static EResult AllocateFarTrampoline(
+        TrampolineStore** trampolineStoreOut, Trampoline** trampolineOut);
+#endif
+
+    /// Locates a trampoline store with space for another trampoline within a sequence of stores,
+    /// starting from the specified cursor and advancing it past every store that turns out to be
+    /// full. Stores before the cursor are looked at again only if some trampoline has been
+    /// deallocated since they were last looked at, in which case they are looked at in order of
+    /// creation so that the space given back is reused before any new store is placed. Requires
+    /// that the hook store lock be held exclusively.
+    /// @param [in] storeIndices Indices within #trampolines of the stores in the sequence, or
+    /// `nullptr` if the sequence consists of all of #trampolines in order.
+    /// @param [in] numStores Number of stores in the sequence.
+    /// @param [in,out] cursor Cursor into the sequence.
+    /// @return Index within #trampolines of a store with free space, or the number of elements in
+    /// #trampolines if there is none.
+    static size_t FindTrampolineStoreWithFreeSpace(
+        const int* storeIndices, size_t numStores, SFreeSpaceCursor& cursor);
+
+    /// Identifies the trampoline store that holds the specified trampoline. Requires that the hook
+    /// store lock be held.
+    /// @param [in] trampoline Trampoline to locate.
+    /// @return Trampoline store that holds the trampoline, or `nullptr` if there is none.
+    static TrampolineStore* FindTrampolineStore(const Trampoline* trampoline);
+
+    /// Encodes the handle that identifies the hook implemented by the specified trampoline, which
+    /// consists of the index of its trampoline store, its slot within that store, and the
+    /// generation of the hook in that slot. Requires that the hook store lock be held.
+    /// @param [in] trampoline Trampoline that implements a registered hook.
+    /// @return Handle that identifies the hook, or #kInvalidHookHandle if the trampoline does not
+    /// implement a registered hook.
+    static HookHandle HookHandleForTrampoline(const Trampoline* trampoline);
+
+    /// Decodes the specified hook handle using only arithmetic and checks that it still identifies
+    /// a registered hook. Requires that the hook store lock be held.
+    /// @param [in] handle Handle to decode.
+    /// @return Trampoline that implements the hook, or `nullptr` if the handle is malformed or the
+    /// hook it identified no longer exists.
+    static Trampoline* TrampolineForHookHandle(HookHandle handle);
+
+#ifdef _WIN64
+    /// Locates a trampoline store placed near some other memory region that has space for another
+    /// trampoline and is close enough to the specified memory region to be used for it, so that
+    /// memory regions near each other share trampoline stores instead of each having their own.
+    /// Stores already found to be close enough are looked at first, and any other store found to
+    /// be close enough is remembered for next time. Requires that the hook store lock be held
+    /// exclusively.
+    /// @param [in] originalFunc Address of the function that is being hooked.
+    /// @param [in] baseAddress Base address of the memory region that contains the function.
+    /// @param [in,out] nearModuleStores Placement information for the memory region.
+    /// @return Index within #trampolines of a store with free space, or the number of elements in
+    /// #trampolines if there is none.
+    static size_t FindSharedTrampolineStoreWithFreeSpace(
+        const void* originalFunc, void* baseAddress, SNearModuleStores& nearModuleStores);
+
+    /// Determines whether or not a trampoline store placed near some memory region can be used for
+    /// original functions in another memory region, which requires it to be no farther from that
+    /// memory region's base address than a store placed for it would be.
+    /// @param [in] trampolineStore Trampoline store to check.
+    /// @param [in] baseAddress Base address of the memory region.
+    /// @return `true` if so, `false` if not.
+    static bool IsTrampolineStoreNear(const TrampolineStore& trampolineStore, void* baseAddress);
+
+    /// Places a new trampoline store as close as possible before the specified memory region,
+    /// resuming the search from wherever the previous search for the same region stopped. Requires
+    /// that the hook store lock be held exclusively.
+    /// @param [in] baseAddress Base address of the memory region.
+    /// @param [in,out] nearModuleStores Placement information for the memory region, which is
+    /// updated to include the new store.
+    /// @param [in] maxLocationsToProbe Maximum number of candidate locations to probe during this
+    /// search.
+    /// @return Index of the new store within #trampolines, or -1 if none could be placed.
+    static int PlaceTrampolineStoreNear(
+        void* baseAddress, SNearModuleStores& nearModuleStores, int maxLocationsToProbe);
+#endif
+
+    /// Identifies the original function of the registered hook that the specified trampoline
+    /// implements, using the metadata of the trampoline's slot within its store. Requires that the
+    /// hook store lock be held.
+    /// @param [in] trampoline Trampoline to check.
+    /// @return Original function, or `nullptr` if the trampoline does not implement a registered
+    /// hook.
+    static const void* OriginalFunctionForTrampoline(const Trampoline* trampoline);
+
+    /// Records the original function of the registered hook that the specified trampoline
+    /// implements in the metadata of the trampoline's slot within its store. Requires that the
+    /// hook store lock be held exclusively.
+    /// @param [in] trampoline Trampoline to update.
+    /// @param [in] originalFunc Original function, or `nullptr` if the trampoline no longer
+    /// implements a registered hook.
+    static void SetOriginalFunctionForTrampoline(
+        const Trampoline* trampoline, const void* originalFunc);
+
+    /// Deallocates a trampoline that is not in use by any hook, along with its instrumentation stub
+    /// and reentrancy guard stub if it has them. Requires that the hook store lock be held
+    /// exclusively.
+    /// @param [in] trampoline Trampoline to deallocate.
+    static void DeallocateTrampoline(Trampoline* trampoline);
+
+    /// Allocates the per-processor call counters of a new instrumentation stub. Counters are never
+    /// freed, because threads might still be executing the stub after its hook is removed.
+    /// @return Pointer to the counters, which are initially zero.
+    static Trampoline::SInstrumentationCounterShard* AllocateInstrumentationCounterShards(void);
+
+    /// Allocates an instrumentation stub for a prepared trampoline and inserts it between the
+    /// trampoline and the hook function. If no stub can be allocated, the trampoline is left as-is
+    /// and the hook is simply not instrumented. Requires that the hook store lock be held
+    /// exclusively.
+    /// @param [in] originalFunc Address of the function that is being hooked.
+    /// @param [in] hookFunc Hook function that should be invoked instead of the original function.
+    /// @param [in] trampoline Trampoline that implements the hook.
+    static void InstrumentTrampoline(
+        void* originalFunc, const void* hookFunc, Trampoline* trampoline);
+
+    /// Allocates a sampled timing stub for a prepared trampoline and inserts it between the
+    /// trampoline and the hook function. Must be invoked before #InstrumentTrampoline. If sampled
+    /// timing is unavailable or no stub can be allocated, the trampoline is left as-is and the
+    /// hook is simply not timed. Requires that the hook store lock be held exclusively.
+    /// @param [in] originalFunc Address of the function that is being hooked.
+    /// @param [in] hookFunc Hook function that should be invoked instead of the original function.
+    /// @param [in] trampoline Trampoline that implements the hook.
+    /// @param [in] sampleInterval Number of calls per sample.
+    static void SampleTrampoline(
+        void* originalFunc,
+        const void* hookFunc,
+        Trampoline* trampoline,
+        uint32_t sampleInterval);
+
+    /// Allocates a hook stub for a prepared trampoline from the same store, so that the original
+    /// function can jump to the hook stub instead of to the hook region of the trampoline. The hook
+    /// stub mirrors the hook region of the trampoline. If no hook stub can be allocated, the
+    /// trampoline is used directly. Requires that the hook store lock be held exclusively.
+    /// @param [in] trampoline Trampoline that implements the hook.
+    static void SegregateHookStub(Trampoline* trampoline);
+
+    /// Determines the address to which an original function should jump in order to enter its
+    /// hook by way of its trampoline. This is the trampoline's code cave stub if it has one, then
+    /// its hook stub if it has one, or its hook region otherwise. Requires that the hook store lock
+    /// be held.
+    /// @param [in] trampoline Trampoline that implements the hook.
+    /// @return Address that transfers control to the hook function.
+    static const void* HookEntryForTrampoline(const Trampoline* trampoline);
+
+    /// Determines the hook function associated with a trampoline, looking through its
+    /// instrumentation stub or reentrancy guard stub if it has one. Requires that the hook store
+    /// lock be held.
+    /// @param [in] trampoline Trampoline that implements the hook.
+    /// @return Address of the hook function.
+    static const void* HookFunctionForTrampoline(Trampoline* trampoline);
+
+    /// Changes the hook function to which a trampoline transfers control, going through its
+    /// instrumentation stub or reentrancy guard stub if it has one. Requires that the hook store
+    /// lock be held exclusively and that a trampoline write window be open.
+    /// @param [in] trampoline Trampoline whose hook region is to be retargeted.
+    /// @param [in] hookFunc New hook function address.
+    /// @return `true` on success, `false` on failure.
+    static bool RetargetTrampoline(Trampoline* trampoline, const void* hookFunc);
+
+    /// Writes both jump targets of a reentrancy guard stub. While the reentrancy guard is enabled,
+    /// threads whose depth is non-zero go to the original function region of the trampoline, and
+    /// otherwise they go to the hook function just like all other threads. Requires that the hook
+    /// store lock be held exclusively and that a trampoline write window be open.
+    /// @param [in] trampoline Trampoline that the reentrancy guard belongs to.
+    /// @param [in] reentrancyGuard Reentrancy guard to update.
+    /// @param [in] hookFunc Hook function address, or the address of the instrumentation stub.
+    /// @return `true` on success, `false` on failure.
+    static bool UpdateReentrancyGuardStub(
+        const Trampoline* trampoline,
+        const SReentrancyGuard& reentrancyGuard,
+        const void* hookFunc);
+
+    /// Writes both jump targets of a caller filter stub. While the caller filter is enabled, calls
+    /// from outside its caller address ranges go to the original function region of the
+    /// trampoline, and otherwise they go to the hook function just like all other calls. Requires
+    /// that the hook store lock be held exclusively and that a trampoline write window be open.
+    /// @param [in] trampoline Trampoline that the caller filter belongs to.
+    /// @param [in] callerFilter Caller filter to update.
+    /// @param [in] hookFunc Hook function address, or the address of the instrumentation stub.
+    /// @return `true` on success, `false` on failure.
+    static bool UpdateCallerFilterStub(
+        const Trampoline* trampoline, const SCallerFilter& callerFilter, const void* hookFunc);
+
+    /// Points a call trace stub at the original function region of the trampoline that implements
+    /// its hook, if the specified hook function is a call trace stub. Must be invoked after the
+    /// trampoline is prepared but before execution is redirected into it. Requires that the hook
+    /// store lock be held exclusively and that a trampoline write window be open.
+    /// @param [in] hookFunc Hook function address, which might be a call trace stub.
+    /// @param [in] trampoline Trampoline that implements the hook.
+    /// @return `true` on success or if the hook function is not a call trace stub, `false` on
+    /// failure.
+    static bool BindCallTraceStub(const void* hookFunc, const Trampoline* trampoline);
+
+    /// Points the bypass of a one-shot stub at the original function region of the trampoline that
+    /// implements its hook, if the specified hook function is a one-shot stub. Must be invoked
+    /// after the trampoline is prepared but before execution is redirected into it. Requires that
+    /// the hook store lock be held exclusively and that a trampoline write window be open.
+    /// @param [in] hookFunc Hook function address, which might be a one-shot stub.
+    /// @param [in] trampoline Trampoline that implements the hook.
+    /// @return `true` on success or if the hook function is not a one-shot stub, `false` on
+    /// failure.
+    static bool BindOneShotStub(const void* hookFunc, const Trampoline* trampoline);
+
+    /// Points the bypass of a sampled hook stub at the original function region of the trampoline
+    /// that implements its hook, if the specified hook function is a sampled hook stub. Must be
+    /// invoked after the trampoline is prepared but before execution is redirected into it.
+    /// Requires that the hook store lock be held exclusively and that a trampoline write window be
+    /// open.
+    /// @param [in] hookFunc Hook function address, which might be a sampled hook stub.
+    /// @param [in] trampoline Trampoline that implements the hook.
+    /// @return `true` on success or if the hook function is not a sampled hook stub, `false` on
+    /// failure.
+    static bool BindSampledHookStub(const void* hookFunc, const Trampoline* trampoline);
+
+    /// Retrieves the offset, within the thread environment block, of the pointer-sized per-thread
+    /// slot that holds each thread's table of hook overrides. Allocated the first time it is
+    /// needed.
+    /// @return Offset in bytes, or 0 if thread overrides are unavailable.
+    static size_t GetThreadOverrideTableOffset(void);
+
+    /// Determines where a newly-created hook should redirect execution from its original function.
+    /// This is normally the trampoline's hook region, but if so configured, it can be the hook
+    /// function itself. Requires that the hook store lock be held.
+    /// @param [in] originalFunc Address of the function that is being hooked.
+    /// @param [in] hookFunc Hook function that should be invoked instead of the original function.
+    /// @param [in] trampoline Prepared trampoline that implements the hook.
+    /// @return Address to which the original function should jump.
+    static const void* RedirectTargetForHook(
+        const void* originalFunc, const void* hookFunc, Trampoline* trampoline);
+
+    /// Changes the hook function that is invoked first when a hooked original function is called.
+    /// Retargets the trampoline that the original function jumps to and, if needed, re-patches the
+    /// original function too. This happens if the original function jumps directly to its hook
+    /// function, if it was previously restored to its unhooked state, or if the new hook function
+    /// is the trampoline's own original function region, in which case the hook is being disabled
+    /// and the original function is restored to its unhooked state if possible. Requires that the
+    /// hook store lock be held exclusively and that a trampoline write window be open.
+    /// @param [in] originalFunc Address of the hooked function.
+    /// @param [in] trampoline Trampoline that modified the original function.
+    /// @param [in] hookFunc New hook function address.
+    /// @return `true` on success, `false` on failure.
+    static bool RetargetHook(
+        const void* originalFunc, Trampoline* trampoline, const void* hookFunc);
+
+    /// Determines whether or not the specified original function belongs to a hook created in the
+    /// open transaction and therefore has not yet been modified. Requires that the hook store lock
+    /// be held.
+    /// @param [in] originalFunc Address of the original function to check.
+    /// @return `true` if so, `false` if not.
+    static bool IsRedirectPending(const void* originalFunc);
+
+    /// Saves the bytes at the beginning of an original function that are about to be overwritten
+    /// by a jump, so that the original function can later be restored if its hook is disabled.
+    /// Also records whether the original function is laid out for hot-patching, which determines
+    /// where the jump is written. Requires that the hook store lock be held exclusively.
+    /// @param [in] originalFunc Address of the function that is being hooked.
+    static void SaveOriginalFunctionPrologue(const void* originalFunc);
+
+    /// Determines whether or not the specified address identifies the original function of an
+    /// existing hook, as opposed to a hook function or an address that is not involved in any
+    /// hook. Requires that the hook store lock be held.
+    /// @param [in] func Address to check.
+    /// @return `true` if so, `false` if not.
+    static bool IsHookedOriginalFunction(const void* func);
+
+    /// If following jump thunks is enabled, determines the function that should actually be
+    /// hooked when the specified original function is requested. Starting from the requested
+    /// address, unconditional jumps are followed for as long as the address reached is not already
+    /// involved in a hook, since the entry point of a hooked function holds Hookshot's own jump.
+    /// Requires that the hook store lock be held, at least in shared mode.
+    /// @param [in] originalFunc Address of the function whose hook was requested.
+    /// @return Address of the function to hook, which is the requested address itself if it is not
+    /// a thunk or if following jump thunks is disabled.
+    static void* ResolveJumpThunks(void* originalFunc);
+
+    /// Maps an address that was hooked by following its jump thunk to the original function that
+    /// was actually hooked, so that the thunk can identify the hook in queries. Requires that the
+    /// hook store lock be held, at least in shared mode.
+    /// @param [in] func Address to map.
+    /// @return Original function for which the address is a thunk, or the address itself if it is
+    /// not a known thunk.
+    static const void* ResolveJumpThunkAlias(const void* func);
+
+    /// Adds a hook to the front of the chain of hooks for an original function that is already
+    /// hooked, so that it is invoked before all of the existing hooks. Its trampoline's original
+    /// function region jumps to the hook function that was previously first in the chain. The
+    /// original function itself is modified only if it jumps directly to its first hook function,
+    /// and even then atomically, so the new hook takes effect immediately, even if a transaction is
+    /// open. Requires that the hook store lock be held exclusively and that a trampoline write
+    /// window be open.
+    /// @param [in] originalFunc Address of the function that is already hooked.
+    /// @param [in] hookFunc Hook function that is not yet involved in any hook.
+    /// @return Result of the operation.
+    static EResult ChainHook(void* originalFunc, const void* hookFunc);
+
+    /// Allocates a trampoline and sets both its hook and original functions, so that all that
+    /// remains to activate the hook is to redirect execution from the original function into the
+    /// trampoline. On failure, the trampoline is deallocated. Requires that the hook store lock be
+    /// held exclusively.
+    /// @param [in] originalFunc Address of the function that is being hooked.
+    /// @param [in] hookFunc Hook function that should be invoked instead of the original function.
+    /// @param [in] decoded Original function instructions decoded ahead of time, or `nullptr` if
+    /// they are not available. Used only if the original function has not changed since.
+    /// @param [out] trampolineStoreOut Filled with the store from which the trampoline was
+    /// allocated.
+    /// @param [out] trampolineOut Filled with the prepared trampoline.
+    /// @param [in] canUseFarTrampoline Whether or not the caller can redirect the original function
+    /// using an absolute jump to a trampoline placed anywhere in memory if no trampoline can be
+    /// allocated near it.
+    /// @return Result of the operation.
+    static EResult PrepareTrampoline(
+        void* originalFunc,
+        const void* hookFunc,
+        const Trampoline::SDecodedOriginalFunction* decoded,
+        TrampolineStore** trampolineStoreOut,
+        Trampoline** trampolineOut,
+        const bool canUseFarTrampoline);
+
+    /// Completes the preparation of a trampoline whose hook and original functions are both set.
+    /// Gives back its unused space, instruments it if so configured or if its hook function is an
+    /// export counter stub, and gives it a hook stub if so configured. Requires that the hook store
+    /// lock be held exclusively.
+    /// @param [in] originalFunc Address of the function that is being hooked.
+    /// @param [in] hookFunc Hook function that should be invoked instead of the original function.
+    /// @param [in] trampoline Trampoline to complete.
+    /// @param [in] trampolineSizeBytesUsed Number of bytes of the trampoline in use, as reported
+    /// when its original function was set.
+    /// @return Store that holds the trampoline, which can change because completing it can
+    /// allocate new stores.
+    static TrampolineStore* CompleteTrampoline(
+        void* originalFunc,
+        const void* hookFunc,
+        Trampoline* trampoline,
+        size_t trampolineSizeBytesUsed);
+
+    /// Implements #CreateHookInternal while holding the hook store lock throughout. Requires that
+    /// the hook store lock be held exclusively.
+    /// @param [in] originalFunc Address of the function that should be hooked.
+    /// @param [in] hookFunc Hook function that should be invoked instead of the original function.
+    /// @param [in] isInternal If `true`, identifies the requested hook as being for internal
+    /// Hookshot use.
+    /// @param [out] originalFuncAfterHook For internal hooks only, this is a pointer to be filled
+    /// with what would ordinarily be returned by #GetOriginalFunction.
+    /// @param [in] decoded Original function instructions decoded ahead of time, or `nullptr` if
+    /// they are not available.
+    /// @return Result of the operation.
+    static EResult CreateHookWithLockHeld(
+        void* originalFunc,
+        const void* hookFunc,
+        const bool isInternal,
+        const void** originalFuncAfterHook,
+        const Trampoline::SDecodedOriginalFunction* decoded);
+
+#ifdef _WIN64
+    /// Creates a hook whose original function is redirected to a trampoline placed anywhere in
+    /// memory. Used when no trampoline can be placed close enough to the original function for a
+    /// relative jump to reach it. The original function jumps to an absolute jump placed in a code
+    /// cave within its own module if there is one available, and otherwise it is overwritten with
+    /// the absolute jump itself. Otherwise identical to
+    /// #CreateHookWithLockHeld, except that the hook cannot be part of a transaction and the
+    /// original function has always been checked for duplicates already. Requires that the hook
+    /// store lock be held exclusively.
+    /// @param [in] originalFunc Address of the function that should be hooked.
+    /// @param [in] hookFunc Hook function that should be invoked instead of the original function.
+    /// @param [in] isInternal If `true`, identifies the requested hook as being for internal
+    /// Hookshot use.
+    /// @param [out] originalFuncAfterHook For internal hooks only, this is a pointer to be filled
+    /// with what would ordinarily be returned by #GetOriginalFunction.
+    /// @return Result of the operation.
+    static EResult CreateFarHookWithLockHeld(
+        void* originalFunc,
+        const void* hookFunc,
+        const bool isInternal,
+        const void** originalFuncAfterHook);
+
+    /// Redirects the flow of execution from the specified original function to the specified
+    /// address by overwriting its first few instructions with an absolute jump. Other threads are
+    /// suspended while this happens, and any of them stopped partway through the overwritten
+    /// instructions is moved to the same offset within the original function region of the
+    /// trampoline, which holds an exact copy of them. Requires that the hook store lock be held
+    /// exclusively.
+    /// @param [in,out] from Original function, part of which will be overwritten.
+    /// @param [in] to Destination address.
+    /// @param [in] trampoline Trampoline whose original function region was set using
+    /// Trampoline::SetOriginalFunctionFar.
+    /// @return `true` on success, `false` on failure.
+    static bool RedirectExecutionAbsolute(void* from, const void* to, const Trampoline* trampoline);
+#endif
+
+    /// Creates a hook requested by an API user without holding the hook store lock while its
+    /// original function is decoded and transplanted, which is by far the most time-consuming part
+    /// of creating a hook. Hooks into different modules can therefore be created concurrently.
+    /// Hooks into the same module are still created one at a time, which also ensures that a hook
+    /// created onto an original function whose first hook is still being created is chained onto
+    /// it. Only usable outside of transactions and if trampolines are not write-protected.
+    /// @param [in] originalFunc Address of the function that should be hooked.
+    /// @param [in] hookFunc Hook function that should be invoked instead of the original function.
+    /// @param [in] decoded Original function instructions decoded ahead of time, or `nullptr` if
+    /// they are not available.
+    /// @return Result of the operation.
+    static EResult CreateHookInShard(
+        void* originalFunc,
+        const void* hookFunc,
+        const Trampoline::SDecodedOriginalFunction* decoded);
+
+    /// Determines whether or not the specified function is already involved in a hook, whether as
+    /// original or hook function, including a hook that is still being created. Requires that the
+    /// hook store lock be held.
+    /// @param [in] func Address of the function to check.
+    /// @return `true` if so, `false` if not.
+    static inline bool IsFunctionInUse(const void* func)
+    {
+      return ((0 != functionToTrampoline.count(func)) || (0 != reservedFunctions.count(func)));
+    }
+
+    /// Inserts a newly-created hook into all of the hook store data structures so that it is
+    /// visible to the API user. Requires that the hook store lock be held exclusively.
+    /// @param [in] originalFunc Address of the function that was hooked.
+    /// @param [in] hookFunc Hook function associated with the hook.
+    /// @param [in] trampoline Trampoline that implements the hook.
+    /// @param [in] redirectTarget Address to which the original function jumps.
+    static void RegisterHook(
+        const void* originalFunc,
+        const void* hookFunc,
+        Trampoline* trampoline,
+        const void* redirectTarget);
+
+    /// Registers the entry points of all newly-allocated trampolines and hook stubs as valid
+    /// Control Flow Guard call targets, in one batch per trampoline store. Must be invoked before
+    /// anything can reach them, meaning before original functions are redirected and before any
+    /// protected dependency is redirected through a trampoline. Requires that the hook store lock
+    /// be held exclusively.
+    static void RegisterTrampolineCallTargets(void);
+
+    /// Removes a hook from all of the hook store data structures, along with any other hooks
+    /// chained onto the same original function. Used for hooks whose original functions could not
+    /// be modified after they were already registered. Requires that the hook store lock be held
+    /// exclusively.
+    /// @param [in] trampoline Trampoline that implements the hook.
+    static void UnregisterHook(Trampoline* trampoline);
+
+    /// Replaces the hook function of an existing hook, as #ReplaceHookFunction does. Requires that
+    /// the hook store lock be held exclusively and that a trampoline write window be open.
+    /// @param [in] originalOrHookFunc Address of either the original function or the hook function
+    /// currently associated with the hook.
+    /// @param [in] newHookFunc Address of the new hook function.
+    /// @return Result of the operation.
+    static EResult ReplaceHookFunctionWithLockHeld(
+        const void* originalOrHookFunc, const void* newHookFunc);
+
+    /// Replaces the hook function of the hook implemented by the specified trampoline, once it has
+    /// been located. Requires that the hook store lock be held exclusively and that a trampoline
+    /// write window be open.
+    /// @param [in] trampoline Trampoline that implements the hook.
+    /// @param [in] newHookFunc Address of the new hook function.
+    /// @return Result of the operation.
+    static EResult ReplaceHookFunctionForTrampolineWithLockHeld(
+        Trampoline* trampoline, const void* newHookFunc);
+
+    /// Removes an existing inline hook, along with any other hooks chained onto the same original
+    /// function, as #RemoveHook does once it has determined that the hook is an inline hook.
+    /// Requires that the hook store lock be held exclusively by the specified lock object, which is
+    /// released on success so that the removal can be logged without holding it.
+    /// @param [in,out] lock Lock object that holds the hook store lock.
+    /// @param [in] originalOrHookFunc Address of either the original function or the hook function
+    /// currently associated with the hook, which must have an entry in the function lookup.
+    /// @param [in] restoreOriginalFunction Whether or not to write the original bytes back to the
+    /// original function. Skipped for code that is being discarded and must not be written.
+    /// @return Result of the operation.
+    static EResult RemoveInlineHookWithLockHeld(
+        std::unique_lock<std::shared_mutex>& lock,
+        const void* originalOrHookFunc,
+        bool restoreOriginalFunction);
+
+    /// Retrieves the statistics collected for an existing hook, as #GetHookStatistics does.
+    /// Requires that the hook store lock be held.
+    /// @param [in] originalOrHookFunc Address of the original function or the hook function
+    /// associated with the hook of interest.
+    /// @param [out] statistics Filled with the statistics on success.
+    /// @return Result of the operation.
+    static EResult GetHookStatisticsWithLockHeld(
+        const void* originalOrHookFunc, SHookStatistics* statistics);
+
+    /// Retrieves the statistics collected for the hook implemented by the specified trampoline,
+    /// once it has been located. Requires that the hook store lock be held.
+    /// @param [in] trampoline Trampoline that implements the hook.
+    /// @param [out] statistics Filled with the statistics on success.
+    /// @return Result of the operation.
+    static EResult GetHookStatisticsForTrampolineWithLockHeld(
+        Trampoline* trampoline, SHookStatistics* statistics);
+
+    /// Fills an array of shared statistics records, as #CollectStatistics does. Requires that the
+    /// hook store lock be held.
+    /// @param [out] records Array to receive one record per hook.
+    /// @param [in] maxRecords Capacity of the record array.
+    /// @param [out] numHooks Filled with the total number of hooks, which can exceed the capacity.
+    /// @param [out] numRecords Filled with the number of records written.
+    static void CollectStatisticsWithLockHeld(
+        SharedStatistics::SRecord* records,
+        uint32_t maxRecords,
+        uint32_t* numHooks,
+        uint32_t* numRecords);
+
+    /// Sorts a batch of redirections by address and identifies all of the pages they modify. This
+    /// is the only part of a batch redirection that allocates memory, which allows it to be done
+    /// before other threads are suspended.
+    /// @param [in,out] redirects Pending redirections, which are reordered by this function.
+    /// @param [out] affectedPages Filled with the pages modified by the redirections.
+    static void PlanRedirectExecutionBatch(
+        std::vector<SPendingRedirect>& redirects, std::vector<SAffectedPage>& affectedPages);
+
+    /// Redirects the flow of execution for a planned batch of redirections. Changes memory
+    /// protection once per affected page and flushes the instruction cache once per contiguous
+    /// range of affected pages. On return, each redirection's success flag is updated to reflect
+    /// the result of the operation. Does not allocate memory.
+    /// @param [in,out] redirects Pending redirections, as sorted by #PlanRedirectExecutionBatch.
+    /// @param [in,out] affectedPages Pages as identified by #PlanRedirectExecutionBatch.
+    static void ApplyRedirectExecutionBatch(
+        std::vector<SPendingRedirect>& redirects, std::vector<SAffectedPage>& affectedPages);
+
+    /// Redirects the flow of execution for multiple source functions at once. Semantically
+    /// equivalent to redirecting each one individually but considerably faster.
+    /// @param [in,out] redirects Pending redirections, which are reordered by this function.
+    static void RedirectExecutionBatch(std::vector<SPendingRedirect>& redirects);
+
+    /// Determines whether or not a planned batch of redirections can be written without suspending
+    /// other threads. This is the case while hook modules are loaded during injection, as long as
+    /// the only other threads are loader worker threads and none of the redirections modifies the
+    /// loader, because then no other thread can be executing any of the bytes being overwritten.
+    /// @param [in] redirects Pending redirections.
+    /// @return `true` if so, `false` if not.
+    static bool CanRedirectWithoutSuspendingThreads(const std::vector<SPendingRedirect>& redirects);
+
+    /// Moves any of the specified suspended threads whose instruction pointers lie strictly within
+    /// the bytes about to be overwritten by a planned batch of redirections to the equivalent
+    /// location within the corresponding trampolines. Redirections for which this cannot be done
+    /// are marked as skipped. Does not allocate memory.
+    /// @param [in] threads Handles to suspended threads.
+    /// @param [in,out] redirects Pending redirections, as sorted by #PlanRedirectExecutionBatch.
+    /// @return Number of threads whose instruction pointers were moved.
+    static size_t RelocateSuspendedThreads(
+        const std::vector<HANDLE>& threads, std::vector<SPendingRedirect>& redirects);
+
+    /// Retires all of the trampolines, across the whole chain, that implement the hook for the
+    /// specified original function, which must already be unregistered. Retired trampolines are
+    /// not deallocated until they are reclaimed. Requires that the hook store lock be held
+    /// exclusively.
+    /// @param [in] chainedHooks Hooks whose trampolines are to be retired.
+    static void RetireTrampolines(const std::vector<SChainedHook>& chainedHooks);
+
+    /// Identifies retired trampolines that are eligible for reclamation during the current epoch
+    /// but are still in use by any of the specified suspended threads, either because a thread is
+    /// executing one or because a thread might return into one. Registers and stacks are scanned
+    /// conservatively for addresses within retired trampolines. Does not allocate memory. Requires
+    /// that the hook store lock be held exclusively.
+    /// @param [in] threads Handles to suspended threads.
+    static void MarkExecutingRetiredTrampolines(const std::vector<HANDLE>& threads);
+
+    /// Deallocates all retired trampolines that were retired during a previous epoch and that no
+    /// thread was observed to be executing during the current epoch. Requires that the hook store
+    /// lock be held exclusively.
+    /// @return Number of trampolines deallocated.
+    static size_t ReclaimRetiredTrampolines(void);
+
+    /// Identifies the patch site of every enabled hook, along with the bytes Hookshot last wrote
+    /// there and the redirection that writes them again. Hooks whose original functions are not
+    /// part of any loaded module are not monitored. Requires that the hook store lock be held
+    /// exclusively.
+    static void IdentifyPatchSites(void);
+
+    /// Determines whether or not a reference is held to every module that contains a monitored
+    /// patch site. Requires that the hook store lock be held.
+    /// @param [in] moduleReferences Modules to which references are held, in increasing order.
+    /// @return `true` if so, `false` if any of them is not held.
+    static bool ArePatchSiteModulesHeld(const std::vector<HMODULE>& moduleReferences);
+
+    /// Implements #RepairOverwrittenPatches while holding a reference to every module that contains
+    /// a patch site being checked, so that none of them can be unloaded during the check. Requires
+    /// that the hook store lock not be held.
+    /// @param [out] moduleReferences Filled with every module reference acquired, in increasing
+    /// order, all of which the caller must release once the hook store lock is no longer held.
+    /// @return Number of original functions redirected again.
+    static size_t RepairOverwrittenPatchesInternal(std::vector<HMODULE>& moduleReferences);
+
+    /// Determines whether or not the calling thread owns the currently-open transaction. Requires
+    /// that the hook store lock be held.
+    /// @return `true` if so, `false` if not.
+    static bool IsTransactionOwnedByCurrentThread(void);
+
+    /// Estimates the number of bytes of heap memory held by the data structures that make up the
+    /// hook store. Requires that the hook store lock be held.
+    /// @return Number of bytes.
+    static size_t HookStoreHeapBytes(void);
+
+    /// Identifies the pages that were modified to redirect the original functions of registered
+    /// hooks, each of which is thereby made private to this process. Requires that the hook store
+    /// lock be held.
+    /// @return Pairs of base address of the module or memory region that contains the page and
+    /// address of the page, sorted and without duplicates.
+    static std::vector<std::pair<const void*, size_t>> PatchedPages(void);
+
+    /// Identifies the hooks in a batch whose redirections would each be the only modification to a
+    /// page that is not already private to this process. Requires that the hook store lock be held.
+    /// @param [in] originalFuncs Original function of each hook in the batch.
+    /// @param [in] results Result so far for each hook in the batch. Hooks that have already failed
+    /// are not considered.
+    /// @return Whether or not the redirection of each hook would be isolated on its own pages, at
+    /// the same position as in the batch.
+    static std::vector<bool> FindIsolatedPatchSites(
+        const std::vector<void*>& originalFuncs, const EResult* results);
+
+    /// Estimates the cost of hooking a function using each kind of hook that could plausibly hook
+    /// it. Kinds that certainly cannot are omitted. Requires that the hook store lock be held.
+    /// @param [in] originalFunc Address of the function that is being hooked.
+    /// @param [in] hookFunc Address of the hook function, or `nullptr` if not yet known, in which
+    /// case the hook function is assumed to be reached through a trampoline.
+    /// @param [out] feasibility Optional location to be filled with details of how the function
+    /// would be hooked inline, other than the fields that summarize the returned costs.
+    /// @return Plausible kinds of hook and their estimated costs, from cheapest to most expensive.
+    static std::vector<SHookKindCost> EstimateHookKindCosts(
+        void* originalFunc, const void* hookFunc, SHookFeasibility* feasibility = nullptr);
+
+    /// Identifies the base address of the module or memory region near which each trampoline store
+    /// was placed. Requires that the hook store lock be held.
+    /// @return Base address for each trampoline store, at the same position as in #trampolines,
+    /// or `nullptr` for each trampoline store that was not placed near any of them.
+    static std::vector<const void*> TrampolineStoreModuleBases(void);
+
     /// Enforces serialized access to all parts of the hook data structure.
     static std::shared_mutex hookStoreMutex;
 
     /// Maps from function address (either original or target) to trampoline address.
-    static std::unordered_map<const void*, Trampoline*> functionToTrampoline;
+    static FlatPointerMap<const void*, Trampoline*> functionToTrampoline;
+
+    /// Lock-free mirror of #functionToTrampoline that is used to service read-only queries without
+    /// taking the hook store lock. Updated while the lock is held exclusively.
+    static HookLookupTable functionToTrampolineLookup;
+
+
+    /// Maps from trampoline address to the address of the instrumentation stub that sits between
+    /// it and its hook function. Only instrumented hooks have entries.
+    static std::unordered_map<const Trampoline*, Trampoline*> trampolineToInstrumentationStub;
+
+    /// Maps from export counter stub address to the export counter stub, for stubs whose
+    /// trampolines are not yet prepared. Once prepared, each stub becomes the instrumentation stub
+    /// of its trampoline and its entry is removed. Entries of hooks that could not be created are
+    /// removed along with their stubs.
+    static std::unordered_map<const void*, SExportCounterStub> exportCounterStubs;
+
+    /// Maps from trampoline address to the sampled timing that sits between it, or its
+    /// instrumentation stub if it has one, and its hook function. Only hooks whose timing is
+    /// sampled have entries.
+    static std::unordered_map<const Trampoline*, SSampledTiming> trampolineToSampledTiming;
+
+    /// Maps from trampoline address to the latency budget that applies to the durations recorded
+    /// by its sampled timing stub. Only hooks whose timing is sampled can have entries, and the
+    /// entry is removed once the hook is disabled for exceeding its budget.
+    static std::unordered_map<const Trampoline*, SLatencyBudget> trampolineToLatencyBudget;
+
+    /// Maps from trampoline address to the reentrancy guard that sits between it and its hook
+    /// function, or its instrumentation stub if it has one. Only innermost trampolines of hooks
+    /// whose reentrancy guards were ever enabled have entries.
+    static std::unordered_map<const Trampoline*, SReentrancyGuard> trampolineToReentrancyGuard;
 
-    /// Maps from trampoline address to original function address.
-    static std::unordered_map<Trampoline*, const void*> trampolineToOriginalFunction;
+    /// Maps from trampoline address to the caller filter that sits between it, or its reentrancy
+    /// guard stub if it has one, and its hook function, or its instrumentation stub if it has one.
+    /// Only innermost trampolines of hooks that were ever given caller filters have entries.
+    static std::unordered_map<const Trampoline*, SCallerFilter> trampolineToCallerFilter;
+
+    /// Maps from trampoline address to the thread override that sits closest to its hook function.
+    /// Only innermost trampolines of hooks that were ever given thread overrides have entries.
+    static std::unordered_map<const Trampoline*, SThreadOverride> trampolineToThreadOverride;
+
+    /// Number of per-thread table entries that have been assigned to thread override stubs.
+    static size_t numThreadOverrides;
+
+    /// Maps from call trace stub address to the call trace stub itself. Call trace stubs, which
+    /// also serve as the stubs of callback hooks, and probe stubs are used as hook functions, have
+    /// their targets set once their hooks' trampolines exist, and are never deallocated once their
+    /// hooks are created.
+    static std::unordered_map<const void*, Trampoline*> callTraceStubs;
+
+    /// Descriptors identified by the stubs of callback hooks. Held in a list so that their
+    /// addresses never change, and never removed once their hooks are created.
+    static std::list<CallbackHooks::SDescriptor> callbackHookDescriptors;
+
+    /// Maps from one-shot stub address to the one-shot hook that it implements. Entries are removed
+    /// once their hooks are removed, whether that happens after the first call or otherwise.
+    static std::unordered_map<const void*, SOneShotHook> oneShotHooks;
+
+    /// Flags set by one-shot stubs when they are first executed. Held in a list so that their
+    /// addresses never change, and never removed once their hooks are created.
+    static std::list<long> oneShotFiredFlags;
+
+    /// Maps from sampled hook stub address to the sampled hook that it implements. Entries are
+    /// never removed, just like the stubs themselves, so an entry whose stub is no longer the hook
+    /// function of any trampoline belongs to a hook that has since been removed.
+    static std::unordered_map<const void*, SSampledHook> sampledHooks;
+
+    /// Maps from original function address to the hooks chained onto it, ordered from the
+    /// outermost, which is invoked first, to the innermost, which is the first hook that was
+    /// created and whose trampoline modified the original function. Only original functions with
+    /// more than one hook have entries.
+    static std::unordered_map<const void*, std::vector<SChainedHook>> hookChains;
+
+    /// Holds the addresses of original functions that jump directly to their hook functions rather
+    /// than to their trampolines. Each such jump can be changed atomically if the hook function is
+    /// replaced.
+    static std::unordered_set<const void*> directlyRedirectedFunctions;
+
+    /// Maps from original function address to the bytes that were overwritten by the jump that
+    /// redirects execution to the hook.
+    static FlatPointerMap<const void*, std::array<uint8_t, kOriginalFunctionPrologueSizeBytes>>
+        originalFunctionPrologues;
+
+#ifdef _WIN64
+    /// Maps from original function address to the bytes that were overwritten by the absolute jump
+    /// that redirects execution to the hook. Only original functions redirected using absolute
+    /// jumps have entries, and none of them also have entries in #originalFunctionPrologues.
+    static FlatPointerMap<const void*, std::array<uint8_t, kAbsoluteJumpPrologueSizeBytes>>
+        absoluteJumpPrologues;
+#endif
+
+    /// Holds the addresses of original functions whose hooks are disabled and which have therefore
+    /// been restored to their unhooked state. Their hooks remain registered and their trampolines
+    /// remain valid, so they can be enabled again.
+    static std::unordered_set<const void*> unhookedFunctions;
+
+    /// Maps from trampoline address to the hook group to which the hook it implements belongs.
+    /// Only trampolines of hooks that belong to a group have entries.
+    static std::unordered_map<const Trampoline*, SHookGroupMember> trampolineToHookGroup;
+
+    /// Holds the addresses of original functions that are laid out for hot-patching. Their jumps
+    /// are written into the padding before them, and their entry points hold short jumps to those
+    /// jumps, so only their first instructions are ever overwritten.
+    static std::unordered_set<const void*> hotPatchedFunctions;
+
+    /// Holds the addresses of the original and hook functions of hooks that are being created
+    /// without the hook store lock held, so that no other hook can involve them in the meantime.
+    static std::unordered_set<const void*> reservedFunctions;
+
+    /// Maps from the address of a jump thunk whose hook was placed on its ultimate target instead
+    /// to the original function that was actually hooked. Entries are removed when the hook on the
+    /// original function is removed.
+    static std::unordered_map<const void*, const void*> jumpThunkTargets;
+
+    /// Maps from trampoline address to the address of the hook stub that the original function jumps
+    /// to instead of the hook region of the trampoline. Only trampolines with hook stubs have
+    /// entries.
+    static std::unordered_map<const Trampoline*, Trampoline::UHookCode*> trampolineToHookStub;
+
+#ifdef _WIN64
+    /// Maps from trampoline address to the address of the code cave holding an absolute jump to
+    /// the trampoline, which the original function reaches using a relative jump because the
+    /// trampoline itself is too far away. Only trampolines placed using a code cave have entries.
+    static std::unordered_map<const Trampoline*, void*> trampolineToCodeCaveStub;
+#endif
+
+    /// Trampolines that belonged to removed hooks and have not yet been reclaimed.
+    static std::vector<SRetiredTrampoline> retiredTrampolines;
+
+    /// Current reclamation epoch, which advances each time a hook is removed. Every thread that is
+    /// observed, while suspended during an epoch later than the one in which a trampoline was
+    /// retired, to be neither executing it nor holding any address within it in a register or on
+    /// its stack has passed a quiescent point with respect to it.
+    static uint64_t reclamationEpoch;
 
     /// Trampoline storage. Used internally to implement hooks.
     static std::vector<TrampolineStore> trampolines;
 
+    /// Maps from the base address of each trampoline store's buffer to the index of that store
+    /// within #trampolines. Used to locate the store that holds any address by masking it.
+    static FlatPointerMap<const void*, size_t> trampolineStoreIndices;
+
+    /// Generation most recently given to a registered hook, which is part of every hook handle.
+    static uint32_t lastHookGeneration;
+
+    /// Identifier of the thread that owns the currently-open transaction, or 0 if no transaction
+    /// is open.
+    static DWORD transactionThreadId;
+
+    /// Redirections that have been prepared as part of the currently-open transaction and will be
+    /// written when it is committed. Hook specification indices hold the order of creation.
+    static std::vector<SPendingRedirect> transactionRedirects;
+
+    /// Patch sites checked by the hook integrity monitor, as of the last time they were identified.
+    static HookIntegrity::SPatchSites patchSites;
+
+    /// Redirection that repairs each patch site, at the same position as in #patchSites.
+    static std::vector<SPendingRedirect> patchSiteRedirects;
+
+    /// Distinct modules that contain monitored patch sites.
+    static std::vector<HMODULE> patchSiteModules;
+
 #ifdef _WIN64
-    /// Maps from target function base address to trampoline storage index. In 64-bit mode,
-    /// TrampolineStore objects are placed close to target functions. For each target function, the
-    /// base address of its associated memory region is computed and used as a key to this map.
-    /// TrampolineStore objects are appended to the storage vector as normal, and the index of each
-    /// such created TrampolineStore object is the value.
-    static std::unordered_map<void*, std::vector<int>> trampolineStoreMap;
+    /// Maps from target function base address to trampoline storage placement information. In
+    /// 64-bit mode, TrampolineStore objects are placed close to target functions. For each target
+    /// function, the base address of its associated memory region is computed and used as a key to
+    /// this map. TrampolineStore objects are appended to the storage vector as normal, and the
+    /// index of each such created TrampolineStore object is recorded in the value along with how
+    /// far the search for free memory near the region has progressed.
+    static FlatPointerMap<void*, SNearModuleStores> trampolineStoreMap;
+
+    /// Indices of trampoline stores placed anywhere in memory rather than near a particular memory
+    /// region, in order of creation. They hold trampolines for hooks whose original functions are
+    /// redirected using absolute jumps.
+    static std::vector<int> farStoreIndices;
+
+    /// Position within #farStoreIndices from which to look for a store with free space.
+    static SFreeSpaceCursor farStoreFreeSpaceCursor;
+#else
+    /// Position within #trampolines from which to look for a store with free space. In 32-bit mode
+    /// all trampoline stores form a single sequence.
+    static SFreeSpaceCursor trampolineStoreFreeSpaceCursor;
 #endif
   };
 } // namespace Hookshot
@@ -0,0 +1,55 @@
+/***************************************************************************************************
+ * Hookshot
+ *   General-purpose library for injecting DLLs and hooking function calls.
+ ***************************************************************************************************
+ * Authored by Samuel Grossman
+ * Copyright (c) 2019-2025
+ ***********************************************************************************************//**
+ * @file HookTable.h
+ *   Interface declaration for installing the hook tables exported by hook modules.
+ **************************************************************************************************/
+
+#pragma once
+
+#include <cstddef>
+
+#include "ApiWindows.h"
+#include "HookshotTypes.h"
+
+namespace Hookshot
+{
+  namespace HookTable
+  {
+    /// Identifies the hook table exported by a single hook module.
+    struct SHookModuleHookTable
+    {
+      /// File name of the hook module, for logging purposes.
+      const wchar_t* hookModuleFileName;
+
+      /// Entries in the hook table.
+      const SHookTableEntry* entries;
+
+      /// Number of entries in the hook table.
+      size_t numEntries;
+    };
+
+    /// Locates the hook table exported by a hook module that has already been loaded.
+    /// @param [in] hookModule Handle of the hook module.
+    /// @param [out] entries Filled with the entries in the hook table, or `nullptr` if the hook
+    /// module does not export one.
+    /// @param [out] numEntries Filled with the number of entries in the hook table, or 0 if the
+    /// hook module does not export one.
+    /// @return `true` if the hook module exports a hook table, `false` otherwise.
+    bool LocateHookTable(HMODULE hookModule, const SHookTableEntry** entries, size_t* numEntries);
+
+    /// Resolves the original functions listed in one or more hook tables and creates all of the
+    /// hooks together in a single batch, after which the address of each original function is
+    /// written wherever its hook table entry requests. Failures are logged per entry.
+    /// @param [in] hookshot Interface through which to create the hooks.
+    /// @param [in] hookTables Hook tables whose hooks should be created.
+    /// @param [in] numHookTables Number of hook tables.
+    /// @return Number of hooks successfully created.
+    size_t InstallHookTables(
+        IHookshot* hookshot, const SHookModuleHookTable* hookTables, size_t numHookTables);
+  } // namespace HookTable
+} // namespace Hookshot
@@ -11,16 +11,109 @@
 
 #pragma once
 
+#include <cstdint>
 #include <string_view>
+#include <vector>
 
 #include <Infra/Core/Configuration.h>
 
+#include "ConfigurationCache.h"
+
 namespace Hookshot
 {
   using namespace ::Infra::Configuration;
 
+  /// Values of the settings that a performance profile can set, which together select the
+  /// injection, hook installation, and instrumentation modes. Each value comes from the applied
+  /// performance profile if it sets it, otherwise from the global section, otherwise it is the
+  /// default value.
+  struct SPerformanceProfile
+  {
+    /// Value of the InjectChildProcessesAsynchronously setting.
+    bool injectChildProcessesAsynchronously : 1;
+
+    /// Value of the InjectChildProcessesUsingJob setting.
+    bool injectChildProcessesUsingJob : 1;
+
+    /// Value of the InjectUsingApc setting.
+    bool injectUsingApc : 1;
+
+    /// Value of the ShareInjectedCode setting.
+    bool shareInjectedCode : 1;
+
+    /// Value of the LoadHookModulesInParallel setting.
+    bool loadHookModulesInParallel : 1;
+
+    /// Value of the DirectHookJumps setting.
+    bool directHookJumps : 1;
+
+    /// Value of the SegregateHookStubs setting.
+    bool segregateHookStubs : 1;
+
+    /// Value of the WriteProtectTrampolines setting.
+    bool writeProtectTrampolines : 1;
+
+    /// Value of the LockTrampolinePages setting.
+    bool lockTrampolinePages : 1;
+
+    /// Value of the FollowJumpThunks setting.
+    bool followJumpThunks : 1;
+
+    /// Value of the PreferImportHooksForIsolatedPages setting.
+    bool preferImportHooksForIsolatedPages : 1;
+
+    /// Value of the PreferEfficiencyCoresForBackgroundWork setting.
+    bool preferEfficiencyCoresForBackgroundWork : 1;
+
+    /// Value of the LowerBackgroundWorkPriority setting.
+    bool lowerBackgroundWorkPriority : 1;
+
+    /// Value of the MonitorHookIntegrity setting.
+    bool monitorHookIntegrity : 1;
+
+    /// Value of the InstrumentHooks setting.
+    bool instrumentHooks : 1;
+
+    /// Value of the RecordHookCallers setting.
+    bool recordHookCallers : 1;
+
+    /// Value of the HookTimingSampleInterval setting.
+    int64_t hookTimingSampleInterval;
+
+    /// Value of the SampledHookInterval setting.
+    int64_t sampledHookInterval;
+
+    /// Value of the HookLatencyBudgetMicroseconds setting.
+    int64_t hookLatencyBudgetMicroseconds;
+  };
+
   class HookshotConfigReader : public ConfigurationFileReader
   {
+  public:
+
+    /// Resolves the performance profile assigned to the currently-running executable, falling
+    /// back to the global section for every setting that the profile does not set. Has no effect
+    /// on the configuration data itself.
+    /// @param [in] configData Configuration data that was read.
+    /// @return Resolved performance profile.
+    static SPerformanceProfile ReadPerformanceProfile(const ConfigurationData& configData);
+
+    /// Enables capturing of all values as they are read, for the purpose of generating a
+    /// configuration cache. While capturing, all executable-specific sections are read rather
+    /// than just the one for the currently-running executable. Must be called before reading.
+    inline void EnableValueCapture(void)
+    {
+      captureValues = true;
+    }
+
+    /// Retrieves all of the values captured while reading.
+    /// @return Read-only reference to the captured values.
+    inline const std::vector<ConfigurationCache::SConfigurationCacheEntry>& CapturedValues(
+        void) const
+    {
+      return capturedValues;
+    }
+
   protected:
 
     // ConfigurationFileReader
@@ -33,5 +126,26 @@ namespace Hookshot
         std::wstring_view section, std::wstring_view name, const TStringView value) override;
     void BeginRead(void) override;
     EValueType TypeForValue(std::wstring_view section, std::wstring_view name) override;
+
+  private:
+
+    /// Records a value that was read, if value capture is enabled.
+    /// @param [in] section Name of the section that contains the value.
+    /// @param [in] name Name of the setting to which the value belongs.
+    /// @param [in] type Type of the value.
+    /// @param [in] integerValue Value itself, if it is an integer or a Boolean.
+    /// @param [in] stringValue Value itself, if it is a string.
+    void CaptureValue(
+        std::wstring_view section,
+        std::wstring_view name,
+        ConfigurationCache::EConfigurationCacheValueType type,
+        int64_t integerValue,
+        std::wstring_view stringValue);
+
+    /// Whether or not values are captured as they are read.
+    bool captureValues = false;
+
+    /// Values captured while reading.
+    std::vector<ConfigurationCache::SConfigurationCacheEntry> capturedValues;
   };
 } // namespace Hookshot
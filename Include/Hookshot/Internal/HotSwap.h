@@ -0,0 +1,67 @@
+/***************************************************************************************************
+ * Hookshot
+ *   General-purpose library for injecting DLLs and hooking function calls.
+ ***************************************************************************************************
+ * Authored by Samuel Grossman
+ * Copyright (c) 2019-2025
+ ***********************************************************************************************//**
+ * @file HotSwap.h
+ *   Declaration of the stubs and slots through which hot-swappable hooks reach their hook
+ *   functions.
+ **************************************************************************************************/
+
+#pragma once
+
+#include <atomic>
+
+#include "HookshotTypes.h"
+
+namespace Hookshot
+{
+  /// Pointer-sized, pointer-aligned location from which a hot-swap stub reads the address of its
+  /// hook function every time it executes. Held in memory that is never executable or
+  /// write-protected, so that a hot-swappable hook is retargeted by a single aligned store, with no
+  /// locks, memory protection changes, or instruction cache flushes.
+  struct SHotSwapSlot
+  {
+    /// Address of the hook function to which the hot-swap stub transfers control.
+    std::atomic<const void*> hookFunc;
+  };
+
+  static_assert(sizeof(SHotSwapSlot) == sizeof(void*), "Hot-swap slots must be pointer-sized.");
+  static_assert(std::atomic<const void*>::is_always_lock_free, "Hot-swap slots must be lock-free.");
+
+  /// A hot-swap stub is a single indirect jump instruction through a hot-swap slot, which is used
+  /// as the hook function of a hot-swappable hook. Stubs are held in executable pages that are
+  /// filled once and never modified again, each paired with a data page holding their slots. Stubs
+  /// and slots are never freed once handed out, because threads might still be executing them.
+  /// Allocation is not concurrency-safe and requires some external form of concurrency control,
+  /// but slots can be read and written concurrently from any number of threads.
+  namespace HotSwap
+  {
+    /// Allocates a hot-swap slot and initializes it to target the specified hook function.
+    /// Previously-deallocated slots are reused first, and otherwise a new pair of pages is placed.
+    /// @param [in] hookFunc Initial hook function.
+    /// @return Newly-allocated slot, or `nullptr` in the event of a failure.
+    SHotSwapSlot* AllocateSlot(const void* hookFunc);
+
+    /// Deallocates a hot-swap slot whose stub has never been reachable by any other thread, such as
+    /// when the hook that would have used it could not be created.
+    /// @param [in] slot Slot to deallocate.
+    void DeallocateSlot(SHotSwapSlot* slot);
+
+    /// Retrieves the address of the stub that transfers control through the specified slot.
+    /// @param [in] slot Slot of interest, which must have been allocated using #AllocateSlot.
+    /// @return Address of the stub.
+    const void* GetStub(const SHotSwapSlot* slot);
+
+    /// Retargets the stub that transfers control through the specified slot. Takes effect for the
+    /// very next execution of the stub on any thread.
+    /// @param [in] slot Slot to modify, which must have been allocated using #AllocateSlot.
+    /// @param [in] hookFunc New hook function.
+    inline void SetHookFunction(SHotSwapSlot* slot, const void* hookFunc)
+    {
+      slot->hookFunc.store(hookFunc, std::memory_order_release);
+    }
+  } // namespace HotSwap
+} // namespace Hookshot
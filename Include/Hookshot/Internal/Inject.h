@@ -21,9 +21,15 @@
 #define injectInit(hproc, pinjectdata)                                                             \
   size_t syncVar1 = 1, syncVar2 = 2;                                                               \
   const HANDLE injectedProcessHandle = hproc;                                                      \
+  HANDLE syncEventHandle = nullptr;                                                                \
   SInjectData* const injectedProcessData = reinterpret_cast<SInjectData*>(pinjectdata);            \
   size_t* const syncFlagAddress = &(injectedProcessData->sync)
 
+/// Specifies an event that the injected process signals whenever it writes to the sync flag, which
+/// allows subsequent waits to block instead of polling. Requires the event handle, expressed in
+/// this process' handle table, as a parameter.
+#define injectSyncEnableEvent(hevent) syncEventHandle = hevent
+
 /// Reads the specified SInjectData field from the injected process' data region. Requires the field
 /// name and a pointer to an output variable as parameters.
 #define injectDataFieldRead(field, pdest)                                                          \
@@ -47,7 +53,7 @@
 /// `injectSyncAdvance()` is invoked. Returns `true` if successful, `false` if reading the sync flag
 /// from the injected process failed.
 #define injectSyncWait()                                                                           \
-  injectSyncWaitImpl(syncVar1, syncVar2, injectedProcessHandle, syncFlagAddress)
+  injectSyncWaitImpl(syncVar1, syncVar2, injectedProcessHandle, syncEventHandle, syncFlagAddress)
 
 /// Performs the second part of synchronization. Returns `true` if successful, `false` if writing
 /// the sync flag from the injected process failed.
@@ -61,6 +67,17 @@
 
 namespace Hookshot
 {
+  /// Number of times to poll the sync flag without pausing when no sync event is available.
+  inline constexpr unsigned int kInjectSyncSpinCount = 256;
+
+  /// Number of times to poll the sync flag, including the initial spins, before pausing between
+  /// polls changes from yielding the processor to sleeping.
+  inline constexpr unsigned int kInjectSyncYieldCount = 1024;
+
+  /// Maximum amount of time, in milliseconds, to wait for the sync event before polling the sync
+  /// flag again. Bounds the delay that results from any missed signal.
+  inline constexpr DWORD kInjectSyncEventTimeoutMilliseconds = 10;
+
   /// Reads data from the injected process. Not intended to be invoked other than by using
   /// appropriate macros.
   inline bool injectDataFieldReadImpl(
@@ -108,18 +125,22 @@ namespace Hookshot
   }
 
   /// Implements the first part of the syncing logic. Waits until the injected process writes the
-  /// expected value to the sync flag and then returns. Not intended to be invoked other than by
-  /// using appropriate macros.
-  inline bool injectSyncWaitImpl(
-      size_t& syncVar1,
-      size_t& syncVar2,
+  /// expected value to the sync flag and then returns. If a sync event is available, blocks on it
+  /// between reads of the sync flag. Otherwise, polls for a bounded number of iterations and then
+  /// yields or sleeps between reads. The sync flag is pointer-sized in the injected process, which
+  /// is not the same size as in this process when injecting a process of the other architecture.
+  /// Not intended to be invoked other than by using appropriate macros.
+  template <typename SyncFlagType> inline bool injectSyncWaitImpl(
+      SyncFlagType& syncVar1,
+      SyncFlagType& syncVar2,
       const HANDLE& syncProcessHandle,
-      size_t* const& syncFlagAddress)
+      const HANDLE& syncEventHandle,
+      SyncFlagType* const& syncFlagAddress)
   {
-    size_t syncFlagValue = 0;
+    SyncFlagType syncFlagValue = 0;
     SIZE_T numBytes = 0;
 
-    while (syncFlagValue != syncVar1)
+    for (unsigned int numPolls = 0; true; ++numPolls)
     {
       if ((FALSE ==
            ReadProcessMemory(
@@ -130,6 +151,15 @@ namespace Hookshot
                &numBytes)) ||
           (sizeof(syncFlagValue) != numBytes))
         return false;
+
+      if (syncFlagValue == syncVar1) break;
+
+      if (nullptr != syncEventHandle)
+        WaitForSingleObject(syncEventHandle, kInjectSyncEventTimeoutMilliseconds);
+      else if (numPolls >= kInjectSyncYieldCount)
+        Sleep(1);
+      else if (numPolls >= kInjectSyncSpinCount)
+        SwitchToThread();
     }
 
     return true;
@@ -138,11 +168,11 @@ namespace Hookshot
   /// Implements the second part of the syncing logic. Writes the value to the sync flag for which
   /// the injected process is currently waiting. Not intended to be invoked other than by using
   /// appropriate macros.
-  inline bool injectSyncAdvanceImpl(
-      size_t& syncVar1,
-      size_t& syncVar2,
+  template <typename SyncFlagType> inline bool injectSyncAdvanceImpl(
+      SyncFlagType& syncVar1,
+      SyncFlagType& syncVar2,
       const HANDLE& syncProcessHandle,
-      size_t* const& syncFlagAddress)
+      SyncFlagType* const& syncFlagAddress)
   {
     SIZE_T numBytes = 0;
 
@@ -220,15 +250,25 @@ namespace Hookshot
     /// control to the Hookshot library.
     void* cleanupBaseAddress[5];
 
+    /// Address of the SetEvent function in the injected process. Written by the injecting process
+    /// at the same time as the other function addresses, or left as `nullptr` if no sync event is
+    /// available.
+    const void* funcSetEvent;
+
+    /// Handle, in the injected process' handle table, of an event that the injected process should
+    /// signal whenever it writes to the sync flag. Ignored if `nullptr`.
+    HANDLE syncEvent;
+
     /// Padding for 128-byte alignment.
-    size_t unused5[(128 / sizeof(size_t)) - 10];
+    size_t unused5[(128 / sizeof(size_t)) - 12];
   };
 
   /// Utility class for managing information about the structure of the assembly-written injected
   /// code. Injected code is dynamically loaded into this process at runtime and then copied to the
   /// injected process. Pointers contained within this class are expressed in this process' address
   /// space and correspond to the code that has been loaded. Requires knowledge of the symbols
-  /// exported by the modules that contain the code.
+  /// exported by the modules that contain the code. The injected code never changes, so it is
+  /// parsed only once per process, and the single resulting object is shared read-only.
   class InjectInfo
   {
   public:
@@ -236,10 +276,23 @@ namespace Hookshot
     /// Maximum size, in bytes, of the binary files that are loaded.
     static constexpr size_t kMaxInjectBinaryFileSize = 4096;
 
-    InjectInfo(void);
-
     InjectInfo(const InjectInfo&) = delete;
 
+    /// Retrieves the process-wide information about the injected code, parsing it the first time
+    /// this method is invoked. Concurrency-safe.
+    /// @return Reference to the singleton instance, whose initialization result should be checked
+    /// before any of its other methods are called.
+    static const InjectInfo& GetInstance(void);
+
+#ifdef _WIN64
+    /// Retrieves the process-wide information about the 32-bit injected code, which is embedded
+    /// alongside the 64-bit injected code so that 32-bit processes can be injected directly,
+    /// parsing it the first time this method is invoked. Concurrency-safe.
+    /// @return Reference to the singleton instance, whose initialization result should be checked
+    /// before any of its other methods are called.
+    static const InjectInfo& GetWow64Instance(void);
+#endif
+
     /// Provides read-only access to the correspondingly-named instance variable.
     /// @return Value of the corresponding instance variable.
     inline void* GetInjectTrampolineStart(void) const
@@ -282,6 +335,13 @@ namespace Hookshot
       return injectCodeEnd;
     }
 
+    /// Provides read-only access to the correspondingly-named instance variable.
+    /// @return Value of the corresponding instance variable.
+    inline void* GetInjectApcBegin(void) const
+    {
+      return injectApcBegin;
+    }
+
     /// Specifies the result of attempting to initialize this object.
     /// If not successful, it should be destroyed without any other methods called.
     /// @return Indicator of the result of initialization.
@@ -292,6 +352,11 @@ namespace Hookshot
 
   private:
 
+    /// Parses the injected code held in the specified resource.
+    /// @param [in] resourceId Identifier of the resource that holds the injected code binary.
+    /// @param [in] machine Machine type that the injected code binary is required to target.
+    InjectInfo(const WORD resourceId, const WORD machine);
+
     /// Start of the trampoline code block.
     void* injectTrampolineStart;
 
@@ -313,6 +378,10 @@ namespace Hookshot
     /// End of the main code block.
     void* injectCodeEnd;
 
+    /// Alternative entry point within the main code block, used when the injected code runs as an
+    /// asynchronous procedure call rather than by way of the trampoline.
+    void* injectApcBegin;
+
     /// Indicator of the result of the initialization of this object.
     EInjectResult initializationResult;
   };
@@ -28,6 +28,9 @@ namespace Hookshot
     /// Creation of the new process failed.
     ErrorCreateProcess,
 
+    /// Opening an existing process failed.
+    ErrorOpenProcess,
+
     /// Determination of the machine type of the new process failed.
     ErrorDetermineMachineProcess,
 
@@ -106,6 +109,13 @@ namespace Hookshot
     /// Failed to run injected code due to the main thread of the injected process not waking up.
     ErrorRunFailedResumeThread,
 
+    /// Failed to queue injected code to run as an asynchronous procedure call on the main thread of
+    /// the injected process.
+    ErrorRunFailedQueueApc,
+
+    /// Failed to create a thread in an existing process on which to run injected code.
+    ErrorCreateInjectionThread,
+
     /// Failed to synchronize with injected code due to an issue reading from or writing to injected
     /// process memory.
     ErrorRunFailedSync,
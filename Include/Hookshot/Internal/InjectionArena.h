@@ -0,0 +1,67 @@
+/***************************************************************************************************
+ * Hookshot
+ *   General-purpose library for injecting DLLs and hooking function calls.
+ ***************************************************************************************************
+ * Authored by Samuel Grossman
+ * Copyright (c) 2019-2025
+ ***********************************************************************************************//**
+ * @file InjectionArena.h
+ *   Declaration of the fixed-capacity memory arena from which process injection obtains buffers.
+ **************************************************************************************************/
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+namespace Hookshot
+{
+  /// Fixed-capacity region of memory from which a single injection obtains all of the buffers it
+  /// needs. Memory comes directly from the virtual memory manager rather than from a heap, so the
+  /// time needed to inject a process does not depend on the state of the injecting process' heap,
+  /// which can be heavily contended when injection takes place inside a hooked process creation
+  /// function. Individual buffers are never freed. Instead, all of them are freed at once when the
+  /// arena is destroyed. The region used by the most recently destroyed arena is kept for re-use,
+  /// so injections that do not overlap with one another do not need to reserve or commit memory.
+  class InjectionArena
+  {
+  public:
+
+    /// Maximum number of bytes that can be allocated from a single arena. Address space is
+    /// reserved for all of it up front, but memory is only committed as it is needed.
+    static constexpr size_t kCapacityBytes = 4 * 1024 * 1024;
+
+    InjectionArena(void);
+
+    InjectionArena(const InjectionArena&) = delete;
+
+    ~InjectionArena(void);
+
+    /// Allocates a buffer from this arena. Contents are not initialized, and the buffer remains
+    /// valid until this arena is destroyed.
+    /// @param [in] sizeBytes Size of the buffer, in bytes.
+    /// @return Address of the buffer, or `nullptr` if this arena does not have enough capacity
+    /// remaining.
+    void* Allocate(size_t sizeBytes);
+
+    /// Allocates an array of elements from this arena. See #Allocate for more information.
+    /// @tparam ElementType Type of each element, which must be trivially constructible.
+    /// @param [in] count Number of elements in the array.
+    /// @return Address of the first element, or `nullptr` if this arena does not have enough
+    /// capacity remaining.
+    template <typename ElementType> inline ElementType* AllocateArray(size_t count)
+    {
+      if (count > (kCapacityBytes / sizeof(ElementType))) return nullptr;
+      return reinterpret_cast<ElementType*>(Allocate(count * sizeof(ElementType)));
+    }
+
+  private:
+
+    /// Base address of the reserved region, or `nullptr` if a region could not be reserved, in
+    /// which case all allocations fail.
+    uint8_t* region;
+
+    /// Number of bytes at the start of the region that are already in use.
+    size_t numBytesUsed;
+  };
+} // namespace Hookshot
@@ -0,0 +1,34 @@
+/***************************************************************************************************
+ * Hookshot
+ *   General-purpose library for injecting DLLs and hooking function calls.
+ ***************************************************************************************************
+ * Authored by Samuel Grossman
+ * Copyright (c) 2019-2025
+ ***********************************************************************************************//**
+ * @file InjectionBenchmark.h
+ *   Measurement of end-to-end injection latency by repeatedly launching a program.
+ **************************************************************************************************/
+
+#pragma once
+
+#include <string_view>
+
+namespace Hookshot
+{
+  namespace InjectionBenchmark
+  {
+    /// Repeatedly launches the specified program and measures how long it takes from process
+    /// creation until its original entry point is about to run, and from process creation until it
+    /// first waits for input. Programs without a user interface, such as console programs, never
+    /// wait for input, so only the former is measured for them. The program is launched without
+    /// being injected, injected with hook modules skipped, and injected with hook modules loaded as
+    /// configured, each of those first one launch at a time and then all launches at once. Every
+    /// launched process is terminated as soon as it has been measured. Distributions of the
+    /// measurements, along with those of the duration of each injection phase, are written to the
+    /// log, and a summary is displayed. Intended to be used with the example test program.
+    /// @param [in] numLaunches Number of times to launch the program for each measurement.
+    /// @param [in] commandLine Command line of the program to launch, including its executable.
+    /// @return Exit code from this program.
+    int Run(unsigned int numLaunches, std::wstring_view commandLine);
+  } // namespace InjectionBenchmark
+} // namespace Hookshot
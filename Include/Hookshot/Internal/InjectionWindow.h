@@ -0,0 +1,43 @@
+/***************************************************************************************************
+ * Hookshot
+ *   General-purpose library for injecting DLLs and hooking function calls.
+ ***************************************************************************************************
+ * Authored by Samuel Grossman
+ * Copyright (c) 2019-2025
+ ***********************************************************************************************//**
+ * @file InjectionWindow.h
+ *   Interface declaration for tracking the part of injection during which hook modules are loaded.
+ **************************************************************************************************/
+
+#pragma once
+
+namespace Hookshot
+{
+  /// Keeps track of whether or not the injected process is still loading hook modules, before its
+  /// own entry point has run. During that window, the only threads normally running are the main
+  /// thread, which loads the hook modules, and worker threads belonging to the loader, which only
+  /// ever execute code in the loader itself. Code outside of the loader can therefore be modified
+  /// without suspending any threads, as long as nothing has started any other thread.
+  namespace InjectionWindow
+  {
+    /// Opens the window. Invoked by the injection landing code just before loading hook modules.
+    void Open(void);
+
+    /// Closes the window. Invoked by the injection landing code once hook modules are loaded and
+    /// before the injected process continues to its entry point.
+    void Close(void);
+
+    /// Determines whether or not the specified address lies within the loader, which is the only
+    /// code that loader worker threads execute.
+    /// @param [in] address Address to check.
+    /// @return `true` if so, `false` if not.
+    bool IsLoaderCode(const void* address);
+
+    /// Determines whether or not the window is open and every thread other than the calling thread
+    /// started in the loader, which is true of loader worker threads and of threads that have just
+    /// been created and not yet reached their own start routines. Checks each thread individually,
+    /// which is much faster than suspending it, because few threads exist during the window.
+    /// @return `true` if so, `false` if not.
+    bool IsOnlyLoaderRunning(void);
+  } // namespace InjectionWindow
+} // namespace Hookshot
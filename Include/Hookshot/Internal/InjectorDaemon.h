@@ -0,0 +1,106 @@
+/***************************************************************************************************
+ * Hookshot
+ *   General-purpose library for injecting DLLs and hooking function calls.
+ ***************************************************************************************************
+ * Authored by Samuel Grossman
+ * Copyright (c) 2019-2025
+ ***********************************************************************************************//**
+ * @file InjectorDaemon.h
+ *   Interface declaration for requesting process creation and injection from a long-lived
+ *   injector daemon.
+ **************************************************************************************************/
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <string_view>
+
+#include "ApiWindows.h"
+#include "InjectResult.h"
+
+namespace Hookshot
+{
+  namespace InjectorDaemon
+  {
+    /// Maximum number of characters in the command line of a process to be created.
+    inline constexpr uint32_t kMaxCommandLineLength = 32767;
+
+    /// Maximum number of characters in the current directory of a process to be created.
+    inline constexpr uint32_t kMaxCurrentDirectoryLength = 32767;
+
+    /// Maximum number of characters in the environment block of a process to be created.
+    inline constexpr uint32_t kMaxEnvironmentLength = 1048576;
+
+    /// Amount of time, in milliseconds, for which the injector daemon waits for a request before
+    /// exiting.
+    inline constexpr DWORD kIdleTimeoutMilliseconds = 600000;
+
+    /// Fixed-size beginning of a request to create and inject a process. Immediately followed on
+    /// the named pipe by the command line, the current directory, and the environment block, each
+    /// consisting of exactly the specified number of characters and none of them null-terminated
+    /// except for the two null characters that end the environment block.
+    struct SRequestHeader
+    {
+      /// Number of characters in the command line. Must not be 0.
+      uint32_t commandLineLength;
+
+      /// Number of characters in the current directory, or 0 to use that of the injector daemon.
+      uint32_t currentDirectoryLength;
+
+      /// Number of characters in the environment block, or 0 to use that of the injector daemon.
+      uint32_t environmentLength;
+    };
+
+    /// Response to a request to create and inject a process. To ensure safety, all values are
+    /// 64-bit integers.
+    struct SResponse
+    {
+      /// EInjectionResult value, as a 64-bit integer. Indicates the result of the injection
+      /// attempt.
+      uint64_t injectionResult;
+
+      /// Extended injection result, as a 64-bit integer.
+      uint64_t extendedInjectionResult;
+
+      /// Handle of the new process, as a 64-bit integer, valid in the requesting process and
+      /// suitable only for waiting and querying, or 0 if no process was created.
+      uint64_t processHandle;
+    };
+
+    /// Determines whether or not the injector daemon should create and inject processes on behalf
+    /// of this process, which is the case whenever the appropriate environment variable is set.
+    /// @return `true` if so, `false` otherwise.
+    bool IsEnabled(void);
+
+    /// Reads the specified number of bytes from a named pipe, waiting until all of them arrive.
+    /// Works for named pipes opened either with or without overlapped I/O.
+    /// @param [in] pipeHandle Handle of the named pipe.
+    /// @param [out] buffer Buffer to fill.
+    /// @param [in] numBytes Number of bytes to read.
+    /// @return `true` if successful, `false` otherwise.
+    bool ReadPipe(HANDLE pipeHandle, void* buffer, size_t numBytes);
+
+    /// Writes the specified number of bytes to a named pipe, waiting until all of them are written.
+    /// Works for named pipes opened either with or without overlapped I/O.
+    /// @param [in] pipeHandle Handle of the named pipe.
+    /// @param [in] buffer Buffer holding the bytes to write.
+    /// @param [in] numBytes Number of bytes to write.
+    /// @return `true` if successful, `false` otherwise.
+    bool WritePipe(HANDLE pipeHandle, const void* buffer, size_t numBytes);
+
+    /// Submits a request to the injector daemon to create and inject a process using the specified
+    /// command line, and the current directory and environment of this process. Starts the
+    /// injector daemon if it is not already running. The new process is allowed to run once it is
+    /// injected. On return, the last system error code is set to the extended injection result.
+    /// @param [in] commandLine Command line of the process to create.
+    /// @param [out] result Indicator of the result of the injection attempt, if the request was
+    /// served.
+    /// @param [out] processHandle Handle of the new process, suitable only for waiting and
+    /// querying, if the request was served successfully.
+    /// @return `true` if the injector daemon served the request, `false` if it could not be reached,
+    /// in which case the caller should create and inject the process itself.
+    bool CreateInjectedProcess(
+        std::wstring_view commandLine, EInjectResult* result, HANDLE* processHandle);
+  } // namespace InjectorDaemon
+} // namespace Hookshot
@@ -14,9 +14,10 @@
 
 #pragma once
 
-#include <string_view>
+#include <cstddef>
 #include <type_traits>
 
+#include "ApiWindows.h"
 #include "HookStore.h"
 
 /// Declares an internal hook. Defines a type to represent a hook for the specified function.
@@ -28,8 +29,7 @@
 #define HOOKSHOT_INTERNAL_HOOK(func)                                                               \
   inline constexpr wchar_t kInternalHookName__##func[] = _CRT_WIDE(#func);                         \
   inline const bool kInternalHookIsRegistered__##func = ::Hookshot::RegisterInternalHook(          \
-      kInternalHookName__##func,                                                                   \
-      &::Hookshot::InternalHook<kInternalHookName__##func, decltype(func)>::SetHook);              \
+      ::Hookshot::InternalHook<kInternalHookName__##func, decltype(func)>::GetRegistration());     \
   using InternalHook_##func = ::Hookshot::InternalHook<kInternalHookName__##func, decltype(func)>
 
 /// Implements internal hook template specialization so that function prototypes and calling
@@ -56,14 +56,34 @@
                                                                                                    \
     static void* OriginalFunctionAddress(void);                                                    \
                                                                                                    \
-    static EResult SetHook(void)                                                                   \
+    static SInternalHookRegistration GetRegistration(void)                                         \
     {                                                                                              \
-      return InternalHookBase<kOriginalFunctionName>::SetHook(&OriginalFunctionAddress, &Hook);    \
+      return InternalHookBase<kOriginalFunctionName>::GetRegistration(                             \
+          &OriginalFunctionAddress, &Hook);                                                        \
     }                                                                                              \
   };
 
 namespace Hookshot
 {
+  /// Maximum number of internal hooks that can be registered. Registrations beyond this limit fail.
+  inline constexpr size_t kMaxInternalHooks = 16;
+
+  /// Everything needed to set an internal hook, captured when the hook is registered.
+  struct SInternalHookRegistration
+  {
+    /// Name associated with the hook, used for reporting failures.
+    const wchar_t* hookName;
+
+    /// Resolves the address of the original function at the time hooks are set.
+    void* (*funcGetOriginalFunctionAddress)(void);
+
+    /// Hook function that should be invoked instead of the original function.
+    const void* hookFunc;
+
+    /// Filled with the address to use for invoking the original function once the hook is set.
+    const void** originalFunctionOut;
+  };
+
   /// Base class for all internal hooks.
   template <const wchar_t* kOriginalFunctionName> class InternalHookBase
   {
@@ -74,11 +94,14 @@ namespace Hookshot
       return originalFunction;
     }
 
-    static inline EResult SetHook(
+    static inline SInternalHookRegistration GetRegistration(
         void* (*funcGetOriginalFunctionAddress)(void), const void* hookFunc)
     {
-      return HookStore::CreateHookInternal(
-          funcGetOriginalFunctionAddress(), hookFunc, true, &originalFunction);
+      return {
+          .hookName = kOriginalFunctionName,
+          .funcGetOriginalFunctionAddress = funcGetOriginalFunctionAddress,
+          .hookFunc = hookFunc,
+          .originalFunctionOut = &originalFunction};
     }
 
   private:
@@ -104,14 +127,27 @@ namespace Hookshot
 #endif
 
   /// Registers an internal hook so that it is automatically set when all internal hooks are set.
-  /// Intended to be invoked automatically by the #HOOKSHOT_INTERNAL_HOOK macro, and will fail once
-  /// internal hooks have already been set. Not concurrency-safe.
-  /// @param [in] hookName Name associated with the hook to be set.
-  /// @param [in] setHookFunc Address of the internal hook's `SetHook` class method.
-  /// @return `true` after registration is complete.
-  bool RegisterInternalHook(std::wstring_view hookName, EResult (*setHookFunc)(void));
-
-  /// Sets all internal hooks that have been registered. Can only be called once. Subsequent calls
-  /// have no effect. Not concurrency-safe.
+  /// Intended to be invoked automatically by the #HOOKSHOT_INTERNAL_HOOK macro during static
+  /// initialization, and will fail once internal hooks have already been set or if
+  /// #kMaxInternalHooks hooks are already registered. Not concurrency-safe.
+  /// @param [in] registration Everything needed to set the hook.
+  /// @return `true` after registration is complete, `false` otherwise.
+  bool RegisterInternalHook(const SInternalHookRegistration& registration);
+
+  /// Sets all internal hooks that have been registered, all together in a single batch. Can only be
+  /// called once. Subsequent calls have no effect. Not concurrency-safe. If the parent process
+  /// published the layout of its own internal hooks for this process, trampolines are placed at the
+  /// same locations as the parent's wherever the original functions are at the same addresses.
   void SetAllInternalHooks(void);
+
+  /// Publishes the locations of the trampolines that implement this process' internal hooks for a
+  /// child process that is about to be injected, so that it can place its own internal hook
+  /// trampolines at the same locations without searching for space near each module. System
+  /// modules are loaded at the same addresses in every process of the same architecture, so the
+  /// same locations are almost always free and within reach in the child process. Only 64-bit
+  /// processes place trampolines near modules, so there is nothing to publish otherwise.
+  /// @param [in] childProcessId Identifier of the child process.
+  /// @return Handle of the shared memory section that holds the layout, which must be kept open
+  /// until the child process is injected and then closed, or `nullptr` if nothing was published.
+  HANDLE PublishInternalHookLayout(DWORD childProcessId);
 } // namespace Hookshot
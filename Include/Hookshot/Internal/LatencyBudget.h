@@ -0,0 +1,54 @@
+/***************************************************************************************************
+ * Hookshot
+ *   General-purpose library for injecting DLLs and hooking function calls.
+ ***************************************************************************************************
+ * Authored by Samuel Grossman
+ * Copyright (c) 2019-2025
+ ***********************************************************************************************//**
+ * @file LatencyBudget.h
+ *   Interface declaration for automatically disabling hooks whose sampled durations exceed their
+ *   latency budgets.
+ **************************************************************************************************/
+
+#pragma once
+
+#include <cstdint>
+
+#include "HookshotTypes.h"
+
+namespace Hookshot
+{
+  /// A latency budget is a limit on the 99th percentile duration of the calls to a hook whose timing
+  /// is sampled. A background task periodically compares the calls sampled since its previous check
+  /// against each budget, and a hook that exceeds its budget for several checks in a row is
+  /// disabled, so that a slow hook costs the application a few seconds rather than the rest of the
+  /// session. The task only keeps running for as long as any budgets are configured.
+  namespace LatencyBudget
+  {
+    /// Interval, in milliseconds, at which the background task checks every latency budget. Each
+    /// check covers only the calls sampled since the previous check.
+    inline constexpr uint32_t kCheckIntervalMilliseconds = 1000;
+
+    /// Number of consecutive checks in which a hook must exceed its latency budget before it is
+    /// disabled.
+    inline constexpr uint32_t kNumChecksBeforeDisable = 3;
+
+    /// Minimum number of sampled calls that a check must cover to say anything about a hook. Checks
+    /// that cover fewer calls neither count towards disabling the hook nor reset the count.
+    inline constexpr uint64_t kMinSamplesPerCheck = 100;
+
+    /// Estimates the 99th percentile duration of the calls in a timing histogram. Because each
+    /// bucket only bounds its durations to within a factor of two, the estimate is the lower bound
+    /// of the bucket that holds the 99th percentile, so it never overstates the duration.
+    /// @param [in] buckets Timing histogram buckets, of which there are always
+    /// #kHookTimingHistogramNumBuckets.
+    /// @param [out] numSamples Filled with the total number of calls in the histogram.
+    /// @return Estimated 99th percentile duration, in processor time stamp counter ticks.
+    uint64_t EstimatePercentile99Ticks(const uint64_t* buckets, uint64_t* numSamples);
+
+    /// Ensures that a background task will check every latency budget after the check interval has
+    /// elapsed. The task schedules itself again for as long as any budgets remain configured. Has
+    /// no effect if the task is already scheduled. Safe to invoke with the hook store lock held.
+    void ScheduleCheck(void);
+  } // namespace LatencyBudget
+} // namespace Hookshot
@@ -31,12 +31,21 @@ namespace Hookshot
     /// @return `true` if successful, `false` otherwise.
     bool Initialize(Globals::ELoadMethod loadMethod);
 
-    /// Attempts to load and initialize all applicable hook modules.
+#ifndef HOOKSHOT_CORE_LIBRARY
+    /// Attempts to load and initialize all applicable hook modules. None are loaded if the
+    /// environment variable that requests skipping them is set.
     /// @return Number of hook modules successfully loaded.
     int LoadHookModules(void);
 
-    /// Attempts to load and initialize all applicable inject-only libraries.
-    /// @return Number of inject-only libraries successfully loaded.
+    /// Attempts to load and initialize all applicable inject-only libraries. Those configured to be
+    /// deferred are instead handed to a worker thread, which loads them in the background.
+    /// @return Number of inject-only libraries successfully loaded, not counting deferred ones.
     int LoadInjectOnlyLibraries(void);
+
+    /// Attempts to create all call trace hooks requested by the configuration file. Hooks on
+    /// functions exported by modules that are not yet loaded are created once those modules load.
+    /// @return Number of call trace hooks successfully created or deferred.
+    int CreateConfiguredCallTraceHooks(void);
+#endif
   } // namespace LibraryInterface
 } // namespace Hookshot
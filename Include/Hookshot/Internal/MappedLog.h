@@ -0,0 +1,71 @@
+/***************************************************************************************************
+ * Hookshot
+ *   General-purpose library for injecting DLLs and hooking function calls.
+ ***************************************************************************************************
+ * Authored by Samuel Grossman
+ * Copyright (c) 2019-2025
+ ***********************************************************************************************//**
+ * @file MappedLog.h
+ *   Interface declaration for a log sink that appends messages to a memory-mapped ring file
+ *   without taking locks or allocating memory.
+ **************************************************************************************************/
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+#include <Infra/Core/Message.h>
+
+namespace Hookshot
+{
+  namespace MappedLog
+  {
+    /// Total size, in bytes, of the ring file, including its header.
+    inline constexpr size_t kFileSizeBytes = 4 * 1024 * 1024;
+
+    /// Maximum length, in characters, of a single formatted message, including its prefix and
+    /// line terminator. Longer messages are truncated.
+    inline constexpr size_t kMaxMessageLengthChars = 1024;
+
+    /// Whether or not debug messages are compiled in at all. Defining HOOKSHOT_SKIP_DEBUG_MESSAGES
+    /// removes them, along with everything done solely to prepare them, from the build.
+#ifdef HOOKSHOT_SKIP_DEBUG_MESSAGES
+    inline constexpr bool kDebugMessagesCompiledIn = false;
+#else
+    inline constexpr bool kDebugMessagesCompiledIn = true;
+#endif
+
+    /// Determines whether or not debug messages would currently be output anywhere. Intended to be
+    /// checked once before a sequence of debug messages, so that preparing them, and even invoking
+    /// the output function, can be skipped entirely when they would just be discarded.
+    /// @return `true` if so, `false` otherwise.
+    inline bool IsDebugOutputLive(void)
+    {
+      if constexpr (false == kDebugMessagesCompiledIn)
+        return false;
+      else
+        return Infra::Message::WillOutputMessageOfSeverity(Infra::Message::ESeverity::Debug);
+    }
+
+    /// Creates the ring file and begins directing messages output using #OutputFormatted to it.
+    /// Only attempted once, no matter how many times it is invoked. If sharing with child processes
+    /// is requested and the parent of this process is itself using a shared ring file, that ring
+    /// file is used instead of creating a new one, so that an entire process tree appends messages
+    /// to the single ring file created at its root, each prefixed with the identifier of the
+    /// process that output it.
+    /// @param [in] shareWithChildProcesses Whether or not to join the ring file of the parent
+    /// process and to make the ring file in use available to child processes.
+    /// @return `true` if the ring file is in use, `false` otherwise.
+    bool Enable(bool shareWithChildProcesses);
+
+    /// Formats a message into a fixed-size buffer on the stack and outputs it, provided that
+    /// messages of the specified severity would be output at all. If the ring file is in use, the
+    /// message is appended to it by reserving space with a single atomic operation, so any number
+    /// of threads can output messages concurrently without waiting for one another. Otherwise the
+    /// message is passed along for normal output.
+    /// @param [in] severity Severity of the message.
+    /// @param [in] format Format string, followed by any arguments it requires.
+    void OutputFormatted(Infra::Message::ESeverity severity, const wchar_t* format, ...);
+  } // namespace MappedLog
+} // namespace Hookshot
@@ -0,0 +1,34 @@
+/***************************************************************************************************
+ * Hookshot
+ *   General-purpose library for injecting DLLs and hooking function calls.
+ ***************************************************************************************************
+ * Authored by Samuel Grossman
+ * Copyright (c) 2019-2025
+ ***********************************************************************************************//**
+ * @file ModuleIndex.h
+ *   Interface declaration for the index of address ranges occupied by loaded modules.
+ **************************************************************************************************/
+
+#pragma once
+
+#include "ApiWindows.h"
+
+namespace Hookshot
+{
+  /// The module index holds the address range of every module loaded in the current process, sorted
+  /// by base address. It is built the first time it is needed and kept up to date by loader
+  /// notifications from then on, so determining which module contains an address takes a single
+  /// binary search rather than any system calls. Lookups do not take any locks and can run
+  /// concurrently with updates, retrying only if an update completes in the meantime.
+  namespace ModuleIndex
+  {
+    /// Determines which loaded module contains an address. Safe to invoke concurrently from any
+    /// number of threads, including while the loader lock is held.
+    /// @param [in] address Address of interest.
+    /// @param [out] moduleHandle Filled with the handle of the module that contains the address,
+    /// or `nullptr` if no loaded module contains it. Not modified if the index is unavailable.
+    /// @return `true` if the index is available, in which case the result is authoritative, or
+    /// `false` if it is unavailable, in which case the caller should ask the system instead.
+    bool FindModuleForAddress(const void* address, HMODULE* moduleHandle);
+  } // namespace ModuleIndex
+} // namespace Hookshot
@@ -0,0 +1,36 @@
+/***************************************************************************************************
+ * Hookshot
+ *   General-purpose library for injecting DLLs and hooking function calls.
+ ***************************************************************************************************
+ * Authored by Samuel Grossman
+ * Copyright (c) 2019-2025
+ ***********************************************************************************************//**
+ * @file OneShotHooks.h
+ *   Interface declaration for removing one-shot hooks once their first calls have happened.
+ **************************************************************************************************/
+
+#pragma once
+
+#include <cstdint>
+
+namespace Hookshot
+{
+  /// A one-shot hook is implemented by a stub that sets a flag and lets only the call that first
+  /// sets it through to the hook function, sending every other call straight to the original
+  /// function. The stub cannot restore the original function itself, because doing so requires
+  /// suspending every other thread, so a background task periodically looks for stubs whose flags
+  /// are set and removes their hooks, after which calls to the original functions cost nothing
+  /// extra. The task only keeps running for as long as there are one-shot hooks left to remove.
+  namespace OneShotHooks
+  {
+    /// Interval, in milliseconds, at which the background task looks for one-shot hooks whose first
+    /// calls have happened. Until then, calls pay for the stub's bypass.
+    inline constexpr uint32_t kCheckIntervalMilliseconds = 50;
+
+    /// Ensures that a background task will look for one-shot hooks to remove after the check
+    /// interval has elapsed. The task schedules itself again for as long as any one-shot hooks
+    /// remain. Has no effect if the task is already scheduled. Safe to invoke with the hook store
+    /// lock held.
+    void ScheduleCheck(void);
+  } // namespace OneShotHooks
+} // namespace Hookshot
@@ -0,0 +1,79 @@
+/***************************************************************************************************
+ * Hookshot
+ *   General-purpose library for injecting DLLs and hooking function calls.
+ ***************************************************************************************************
+ * Authored by Samuel Grossman
+ * Copyright (c) 2019-2025
+ ***********************************************************************************************//**
+ * @file PatternCache.h
+ *   Interface declaration for the persistent cache of byte pattern search results.
+ **************************************************************************************************/
+
+#pragma once
+
+#include <cstdint>
+
+#include "ApiWindows.h"
+#include "HookshotTypes.h"
+
+namespace Hookshot
+{
+  /// The pattern cache remembers where each byte pattern was found in each module, so that the
+  /// same module does not need to be searched again the next time the application runs. Results
+  /// are identified by the full path, timestamp, and image size of the module, along with a hash of
+  /// the pattern, and consist of the offset at which the pattern was found. They are kept in a file
+  /// next to the configuration file that is memory-mapped the first time a result is needed. A
+  /// cached result is only ever used after verifying that the pattern still occurs there.
+  namespace PatternCache
+  {
+    /// Identifies a particular build of a module loaded at a particular path.
+    struct SModuleIdentity
+    {
+      /// Hash of the full path of the module, compared case-insensitively.
+      uint64_t pathHash;
+
+      /// Timestamp from the header of the module.
+      uint32_t timeDateStamp;
+
+      /// Size of the module's image, from its header.
+      uint32_t sizeOfImage;
+    };
+
+    /// Determines whether or not the pattern cache is enabled by the configuration file.
+    /// @return `true` if so, `false` if not.
+    bool IsEnabled(void);
+
+    /// Identifies a module loaded in the current process for the purpose of caching the results of
+    /// searching it.
+    /// @param [in] moduleHandle Handle of the module of interest.
+    /// @param [out] moduleIdentity Filled with the identity of the module, if the operation
+    /// succeeds.
+    /// @return `true` if the module was identified, `false` otherwise.
+    bool GetModuleIdentity(HMODULE moduleHandle, SModuleIdentity* moduleIdentity);
+
+    /// Retrieves the cached location of a pattern within a module. The caller is responsible for
+    /// verifying that the pattern still occurs there. Safe to invoke concurrently from multiple
+    /// threads.
+    /// @param [in] moduleIdentity Identity of the module that was searched.
+    /// @param [in] pattern Pattern that was searched for.
+    /// @param [out] rva Filled with the offset of the pattern from the base address of the module,
+    /// if the operation succeeds.
+    /// @return `true` if a location was cached, `false` otherwise.
+    bool LookupPattern(
+        const SModuleIdentity& moduleIdentity, const SBytePattern& pattern, uint32_t* rva);
+
+    /// Records the location at which a pattern was found within a module, so that it can be written
+    /// to the pattern cache file. Safe to invoke concurrently from multiple threads.
+    /// @param [in] moduleIdentity Identity of the module that was searched.
+    /// @param [in] pattern Pattern that was found.
+    /// @param [in] rva Offset of the pattern from the base address of the module.
+    void RecordPattern(
+        const SModuleIdentity& moduleIdentity, const SBytePattern& pattern, uint32_t rva);
+
+    /// Writes all locations recorded by this process, merged with those already present, to the
+    /// pattern cache file. Cached locations continue to be available to this process afterwards.
+    /// Failures are silently ignored, since the only consequence is that some modules will be
+    /// searched again next time.
+    void WritePatternCache(void);
+  } // namespace PatternCache
+} // namespace Hookshot
@@ -0,0 +1,39 @@
+/***************************************************************************************************
+ * Hookshot
+ *   General-purpose library for injecting DLLs and hooking function calls.
+ ***************************************************************************************************
+ * Authored by Samuel Grossman
+ * Copyright (c) 2019-2025
+ ***********************************************************************************************//**
+ * @file PatternScanner.h
+ *   Interface declaration for locating byte patterns in the executable code of loaded modules.
+ **************************************************************************************************/
+
+#pragma once
+
+#include <cstddef>
+
+#include "ApiWindows.h"
+#include "HookshotTypes.h"
+
+namespace Hookshot
+{
+  namespace PatternScanner
+  {
+    /// Locates multiple byte patterns in the executable sections of a module loaded in the current
+    /// process. Each section is divided into chunks, and every pattern is searched for within a
+    /// chunk before moving on to the next one, so the code is read from memory only once. Candidate
+    /// positions are identified by comparing two anchor bytes of each pattern using vector
+    /// instructions, and only those candidates are compared in full. Large modules are divided
+    /// among the task scheduler's worker threads.
+    /// @param [in] moduleHandle Handle of the module to be searched.
+    /// @param [in] patterns Array of patterns to be located.
+    /// @param [in] numPatterns Number of elements in the pattern array.
+    /// @param [out] results Filled with the lowest address at which each pattern occurs, or
+    /// `nullptr` for each pattern that does not occur.
+    /// @return Success if every pattern was located, FailNotFound if at least one was not, or
+    /// FailInvalidArgument if any of the parameters or patterns is invalid.
+    EResult FindPatterns(
+        HMODULE moduleHandle, const SBytePattern* patterns, size_t numPatterns, void** results);
+  } // namespace PatternScanner
+} // namespace Hookshot
@@ -0,0 +1,25 @@
+/***************************************************************************************************
+ * Hookshot
+ *   General-purpose library for injecting DLLs and hooking function calls.
+ ***************************************************************************************************
+ * Authored by Samuel Grossman
+ * Copyright (c) 2019-2025
+ ***********************************************************************************************//**
+ * @file Probes.h
+ *   Declaration of the shared probe code that invokes the callbacks of probes.
+ **************************************************************************************************/
+
+#pragma once
+
+namespace Hookshot
+{
+  namespace Probes
+  {
+    /// Retrieves the shared probe code that probe stubs call, creating it if needed. Only
+    /// attempted once, no matter how many times it is invoked. The probe code reads the callback,
+    /// context value, and probe address from the probe stub, which it locates using the return
+    /// address on the top of the stack, and returns to the probe stub once the callback is done.
+    /// @return Address of the probe code, or `nullptr` if it could not be created.
+    const void* GetDispatcher(void);
+  } // namespace Probes
+} // namespace Hookshot
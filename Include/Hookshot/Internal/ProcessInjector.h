@@ -12,18 +12,59 @@
 #pragma once
 
 #include <cstddef>
+#include <vector>
 
 #include "ApiWindows.h"
 #include "InjectResult.h"
 #include "RemoteProcessInjector.h"
+#include "Tracing.h"
 
 namespace Hookshot
 {
   namespace ProcessInjector
   {
+    /// Objects through which every process that joins a job is injected as it is created.
+    struct SInjectionJob
+    {
+      /// Job object, which is named so that injected processes can identify it.
+      HANDLE jobHandle;
+
+      /// I/O completion port that receives notifications from the job object.
+      HANDLE completionPortHandle;
+    };
+
+    /// Determines whether or not the process created by this executable should be placed into a
+    /// job object, every other process in which this executable then injects, as configured.
+    /// @return `true` if so, `false` otherwise.
+    bool ShouldInjectChildProcessesUsingJob(void);
+
+    /// Creates a job object and a completion port that receives its notifications. Also sets an
+    /// environment variable that identifies the job object to processes subsequently created by
+    /// this process, which allows injected processes to leave the injection of their own child
+    /// processes to this process.
+    /// @param [out] injectionJob Filled with the objects that were created, if successful.
+    /// @return `true` if successful, `false` otherwise.
+    bool CreateInjectionJob(SInjectionJob* injectionJob);
+
+    /// Places a process, which must be suspended, into a job object and allows it to run. Then
+    /// injects every other process that joins the job, which includes all processes it creates
+    /// unless they explicitly break away from the job, as they appear. Injections overlap with one
+    /// another, so a slow injection does not delay any process that joins the job after it. Returns
+    /// once no processes remain in the job and all injections are complete. Closes all of the job's
+    /// objects before returning.
+    /// @param [in] injectionJob Job object and completion port previously created using
+    /// #CreateInjectionJob.
+    /// @param [in] rootProcessInfo Information about the process to place into the job, which
+    /// should already be injected.
+    /// @return `true` if the process was placed into the job, `false` if it could not be and was
+    /// instead just allowed to run.
+    bool ServeInjectionJob(
+        const SInjectionJob& injectionJob, const PROCESS_INFORMATION& rootProcessInfo);
+
     /// Creates a new process using the specified parameters and attempts to inject Hookshot code
     /// into it before it is allowed to run. Refer to Microsoft's documentation on CreateProcess for
-    /// information on parameters.
+    /// information on parameters other than the last.
+    /// @param [out] phaseDurations Optionally filled with the durations of each injection phase.
     /// @return Indicator of the result of the operation.
     EInjectResult CreateInjectedProcess(
         LPCWSTR lpApplicationName,
@@ -35,7 +76,48 @@ namespace Hookshot
         LPVOID lpEnvironment,
         LPCWSTR lpCurrentDirectory,
         LPSTARTUPINFOW lpStartupInfo,
-        LPPROCESS_INFORMATION lpProcessInformation);
+        LPPROCESS_INFORMATION lpProcessInformation,
+        Tracing::SInjectPhaseDurations* phaseDurations = nullptr);
+
+    /// Result of injecting one of several processes that are already running.
+    struct SRunningProcessInjectResult
+    {
+      /// Identifier of the process.
+      DWORD processId;
+
+      /// Indicator of the result of the operation.
+      EInjectResult result;
+
+      /// System error code that accompanies the result.
+      DWORD systemErrorCode;
+
+      /// Durations of each injection phase.
+      Tracing::SInjectPhaseDurations phaseDurations;
+    };
+
+    /// Attempts to inject Hookshot code into a process that is already running, without
+    /// interrupting any of its existing threads. The injected code runs on a new thread created in
+    /// that process. Only processes of the same architecture as this running binary can be injected
+    /// this way.
+    /// @param [in] processId Identifier of the process to inject.
+    /// @param [in] enableDebugFeatures If `true`, signals to the injected process that a debugger
+    /// is present, so certain debug features should be enabled.
+    /// @param [out] phaseDurations Optionally filled with the durations of each injection phase.
+    /// @return Indicator of the result of the operation.
+    EInjectResult InjectRunningProcess(
+        const DWORD processId,
+        const bool enableDebugFeatures,
+        Tracing::SInjectPhaseDurations* phaseDurations = nullptr);
+
+    /// Attempts to inject Hookshot code into multiple processes that are already running, in
+    /// parallel using the thread pool. Returns only once all of them have been attempted. See
+    /// #InjectRunningProcess for more information.
+    /// @param [in] processIds Identifiers of the processes to inject.
+    /// @param [in] enableDebugFeatures If `true`, signals to the injected processes that a debugger
+    /// is present, so certain debug features should be enabled.
+    /// @return Result of injecting each process, in the same order as the process identifiers.
+    std::vector<SRunningProcessInjectResult> InjectRunningProcesses(
+        const std::vector<DWORD>& processIds, const bool enableDebugFeatures);
 
     /// Injects a process created by another instance of Hookshot. Communication between instances
     /// occurs by means of shared memory using the handle passed in, including more detailed error
@@ -45,5 +127,23 @@ namespace Hookshot
     /// @return `false` if an inter-process communication mechanism failed, `true` otherwise.
     bool PerformRequestedRemoteInjection(
         RemoteProcessInjector::SInjectRequest* const remoteInjectionData);
+
+    /// Acts as the injector daemon, which creates and injects processes on behalf of short-lived
+    /// instances of the Hookshot executable and the Hookshot Launcher. Requests arrive through a
+    /// named pipe and are served concurrently. Everything this process caches about injection,
+    /// such as the configuration, the locations of remote functions, and authorization results,
+    /// stays warm across requests. Returns once no request has arrived for a while, or immediately
+    /// if another injector daemon is already running.
+    /// @return `false` if an inter-process communication mechanism failed, `true` otherwise.
+    bool ServeInjectorDaemon(void);
+
+    /// Acts as a broker for another instance of Hookshot, repeatedly waiting for that instance to
+    /// submit an injection request and then performing it. Returns once the requesting instance
+    /// terminates.
+    /// @param [in,out] brokerChannel Data structure holding information exchanged between this
+    /// Hookshot process and the Hookshot process that submits requests.
+    /// @return `false` if an inter-process communication mechanism failed, `true` otherwise.
+    bool ServeRemoteInjectionRequests(
+        RemoteProcessInjector::SInjectBrokerChannel* const brokerChannel);
   } // namespace ProcessInjector
 } // namespace Hookshot
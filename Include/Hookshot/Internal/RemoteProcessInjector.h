@@ -15,6 +15,7 @@
 
 #include "ApiWindows.h"
 #include "InjectResult.h"
+#include "Tracing.h"
 
 namespace Hookshot
 {
@@ -43,20 +44,49 @@ namespace Hookshot
 
       /// Extended injection result, as a 64-bit integer.
       uint64_t extendedInjectionResult;
+
+      /// Durations of each phase of the injection attempt.
+      Tracing::SInjectPhaseDurations phaseDurations;
+    };
+
+    /// Defines the structure of the shared memory through which a long-lived broker instance of
+    /// Hookshot accepts injection requests. The requesting instance spawns the broker once and then
+    /// submits any number of requests, one at a time, by filling #request and signalling an event.
+    /// All handles are 64-bit integers that must be valid for the broker.
+    struct SInjectBrokerChannel
+    {
+      /// Handle of an auto-reset event that the requesting instance signals once #request holds a
+      /// new injection request.
+      uint64_t requestReadyEvent;
+
+      /// Handle of an auto-reset event that the broker signals once it has finished processing the
+      /// request and filled in the results.
+      uint64_t requestCompleteEvent;
+
+      /// Handle of the requesting process. The broker exits once this process terminates.
+      uint64_t requestingProcessHandle;
+
+      /// Current injection request.
+      SInjectRequest request;
     };
 
-    /// Spawns a Hookshot executable and uses IPC to request that it injects the specified process.
+    /// Uses IPC to request that a Hookshot executable inject the specified process. The first
+    /// request for a given architecture spawns a broker instance of the Hookshot executable, and
+    /// subsequent requests reuse it for as long as it stays alive. Concurrency-safe.
     /// @param [in] processHandle Handle to the process to inject.
     /// @param [in] threadHandle Handle to the main thread of the process to inject.
     /// @param [in] switchArchitecture If `true`, specifies that the injection must cross a
     /// processor architecture boundary (i.e. 32-bit -> 64-bit or vice versa).
     /// @param [in] enableDebugFeatures If `true`, signals to the injected process that a debugger
     /// is present, so certain debug features should be enabled.
+    /// @param [out] phaseDurations Optionally filled with the durations of each injection phase,
+    /// as measured by the Hookshot executable that performed the injection.
     /// @return Indicator of the result of the operation.
     EInjectResult InjectProcess(
         const HANDLE processHandle,
         const HANDLE threadHandle,
         const bool switchArchitecture,
-        const bool enableDebugFeatures);
+        const bool enableDebugFeatures,
+        Tracing::SInjectPhaseDurations* phaseDurations = nullptr);
   } // namespace RemoteProcessInjector
 } // namespace Hookshot
@@ -0,0 +1,86 @@
+/***************************************************************************************************
+ * Hookshot
+ *   General-purpose library for injecting DLLs and hooking function calls.
+ ***************************************************************************************************
+ * Authored by Samuel Grossman
+ * Copyright (c) 2019-2025
+ ***********************************************************************************************//**
+ * @file SampledTiming.h
+ *   Interface declaration for timing a sample of the calls that pass through sampled timing stubs.
+ **************************************************************************************************/
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+#include "HookshotTypes.h"
+
+namespace Hookshot
+{
+  namespace SampledTiming
+  {
+    /// Number of caller slots in each sample block. Must be a power of two.
+    inline constexpr size_t kNumCallerSlots = 32;
+
+    /// Per-hook state that the shared sampling code uses while timing a call and into which it
+    /// accumulates the results. Owned by at most one thread at a time, which is the thread whose
+    /// call is being timed, so none of the fields need to be updated atomically.
+    struct alignas(64) SSampleBlock
+    {
+      /// Address to which the call being timed will return once the timing is complete.
+      uint64_t returnAddress;
+
+      /// Value of the processor time stamp counter just before the call being timed began.
+      uint64_t startTimestamp;
+
+      /// Non-zero while a thread owns this block. Acquired using an atomic exchange.
+      uint32_t busy;
+
+      /// Selects the caller slot in which the next caller is recorded, once reduced modulo
+      /// #kNumCallerSlots. Incremented each time a caller is recorded.
+      uint32_t nextCallerSlot;
+
+      /// Parameter registers that the sampling code saves while it reads the time stamp counter.
+      /// Used only in 64-bit processes.
+      uint64_t savedRegisters[2];
+
+      /// Unused, present to start the histogram buckets on their own cache line.
+      uint64_t reserved2[3];
+
+      /// Number of sampled calls by duration, in processor time stamp counter ticks. Bucket i holds
+      /// calls that took at least 2^i ticks but fewer than 2^(i+1), except that bucket 0 also
+      /// holds calls that took 0 ticks.
+      uint64_t buckets[kHookTimingHistogramNumBuckets];
+
+      /// Return addresses of the most recent timed calls, if caller recording is enabled, used as a
+      /// ring buffer. Slots that have not yet been used hold 0.
+      uint64_t callers[kNumCallerSlots];
+    };
+
+    static_assert(64 == offsetof(SSampleBlock, buckets), "Sample block layout is unexpected.");
+
+    /// Retrieves the shared sampling code that sampled timing stubs jump to, creating it if needed.
+    /// Only attempted once, no matter how many times it is invoked. Requires that the hook store
+    /// lock be held exclusively.
+    /// @return Address of the sampling code, or `nullptr` if sampled timing is unavailable.
+    const void* GetSampler(void);
+
+    /// Determines whether or not the specified address lies within the shared sampling code, in
+    /// which case the executing thread might still be reading from a sampled timing stub.
+    /// @param [in] address Address to check, typically a thread's instruction pointer.
+    /// @return `true` if so, `false` otherwise.
+    bool IsWithinSampler(size_t address);
+
+    /// Determines whether or not the shared sampling code records the caller of each timed call.
+    /// @return `true` if so, `false` otherwise.
+    bool IsCallerRecordingEnabled(void);
+
+    /// Allocates and zero-initializes a sample block. Sample blocks are never freed because a
+    /// sampled call can return into the shared sampling code, which then writes to the sample
+    /// block, long after its hook is removed. Requires that the hook store lock be held
+    /// exclusively.
+    /// @return Newly-allocated sample block.
+    SSampleBlock* AllocateSampleBlock(void);
+  } // namespace SampledTiming
+} // namespace Hookshot
@@ -0,0 +1,192 @@
+/***************************************************************************************************
+ * Hookshot
+ *   General-purpose library for injecting DLLs and hooking function calls.
+ ***************************************************************************************************
+ * Authored by Samuel Grossman
+ * Copyright (c) 2019-2025
+ ***********************************************************************************************//**
+ * @file SharedStatistics.h
+ *   Layout and interface declaration for the named shared memory section through which each
+ *   process publishes statistics about its hooks for other processes to read.
+ **************************************************************************************************/
+
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+
+#include "ApiWindows.h"
+
+namespace Hookshot
+{
+  namespace SharedStatistics
+  {
+    /// Value that identifies a hook statistics section, stored at the very beginning of it.
+    inline constexpr uint32_t kSectionMagic = 0x54534b48;
+
+    /// Version of the hook statistics section layout. Must be incremented whenever the layout of
+    /// any of the structures below changes.
+    inline constexpr uint32_t kSectionVersion = 4;
+
+    /// Maximum number of per-hook records that a hook statistics section can hold. Hooks beyond
+    /// this limit are still counted but have no records of their own.
+    inline constexpr uint32_t kMaxRecords = 2048;
+
+    /// Interval, in milliseconds, at which the contents of the hook statistics section are
+    /// refreshed.
+    inline constexpr uint32_t kPublishIntervalMilliseconds = 1000;
+
+    /// Maximum number of initialization phase durations that a hook statistics section can hold.
+    inline constexpr uint32_t kMaxStartupPhases = 8;
+
+    /// Record flag that indicates the hook is instrumented, meaning its call count is valid.
+    inline constexpr uint32_t kRecordFlagInstrumented = 0x00000001;
+
+    /// Record flag that indicates the timing of the hook is sampled, meaning its number of sampled
+    /// calls and its sampled latency are valid.
+    inline constexpr uint32_t kRecordFlagSampled = 0x00000002;
+
+    /// Record flag that indicates the callers of the hook are recorded, meaning its top caller is
+    /// valid as long as at least one caller has been recorded.
+    inline constexpr uint32_t kRecordFlagCallersRecorded = 0x00000004;
+
+    /// Statistics for a single hook. Addresses are widened to 64 bits so that the layout is the
+    /// same for 32-bit and 64-bit processes.
+    struct SRecord
+    {
+      /// Address of the original function.
+      uint64_t originalFunc;
+
+      /// Address of the hook function.
+      uint64_t hookFunc;
+
+      /// Number of times the hook has been invoked since it was created. Readers derive call rates
+      /// by comparing successive values against the publish timestamps in the header.
+      uint64_t callCount;
+
+      /// Bitwise combination of record flags.
+      uint32_t flags;
+
+      /// Number of the most recently recorded callers that are the top caller.
+      uint32_t numTopCallerSamples;
+
+      /// Number of calls whose duration has been sampled since the hook was created.
+      uint64_t numSampledCalls;
+
+      /// Estimated 99th percentile duration of the sampled calls, in processor time stamp counter
+      /// ticks. Readers convert it to time using the rate published in the header.
+      uint64_t sampledLatencyTicks;
+
+      /// Return address that appears most often among the most recently recorded callers, or 0 if
+      /// no callers have been recorded.
+      uint64_t topCaller;
+    };
+
+    /// Beginning of a hook statistics section, which is immediately followed by #kMaxRecords
+    /// records. Everything other than the install failure and patch repair counts is protected by the sequence
+    /// number: the publishing process makes it odd before modifying anything and even afterwards,
+    /// so a reader has obtained a consistent copy if it observes the same even value both before
+    /// and after copying. The startup profile is written at most once and is instead published by
+    /// storing its phase count last, so it is valid once a reader observes a non-zero phase count.
+    struct SHeader
+    {
+      /// Always #kSectionMagic.
+      uint32_t magic;
+
+      /// Always #kSectionVersion.
+      uint32_t version;
+
+      /// Identifier of the publishing process.
+      uint32_t processId;
+
+      /// Always #kMaxRecords.
+      uint32_t maxRecords;
+
+      /// Sequence number, incremented before and after each update.
+      std::atomic<uint32_t> sequence;
+
+      /// Number of times the hook creation functions have been asked to create a hook and failed.
+      /// Incremented atomically whenever such a failure occurs, independently of the sequence.
+      std::atomic<uint32_t> numInstallFailures;
+
+      /// Total number of hooks that currently exist.
+      uint32_t numHooks;
+
+      /// Number of valid records that follow this header.
+      uint32_t numRecords;
+
+      /// System tick count, in milliseconds, at which the records were last refreshed.
+      uint64_t publishTimestamp;
+
+      /// Measured rate of the processor time stamp counter, in ticks per microsecond, or 0 if it
+      /// has not yet been measured.
+      uint64_t ticksPerMicrosecond;
+
+      /// Number of valid initialization phase durations, or 0 if no startup profile is available.
+      std::atomic<uint32_t> numStartupPhases;
+
+      /// Number of times the hook integrity monitor has found an original function whose
+      /// redirection was overwritten and redirected it again. Incremented atomically whenever this
+      /// happens, independently of the sequence.
+      std::atomic<uint32_t> numPatchRepairs;
+
+      /// Amount of time from the start of initialization to the end, in microseconds.
+      int64_t startupTotalMicroseconds;
+
+      /// Duration of each initialization phase, in microseconds, or -1 if it did not run. Phases
+      /// are in the order in which Hookshot enumerates them.
+      int64_t startupPhaseMicroseconds[kMaxStartupPhases];
+    };
+
+    static_assert(
+        std::atomic<uint32_t>::is_always_lock_free,
+        "Hook statistics section uses atomics that can be shared between processes.");
+    static_assert(0 == sizeof(SHeader) % sizeof(uint64_t), "Hook statistics header is misaligned.");
+    static_assert(56 == sizeof(SRecord), "Hook statistics record layout is unexpected.");
+
+    /// Total size, in bytes, of a hook statistics section.
+    inline constexpr size_t kSectionSizeBytes = sizeof(SHeader) + (sizeof(SRecord) * kMaxRecords);
+
+    /// Retrieves the records that follow the header of a hook statistics section.
+    /// @param [in] header Header at the beginning of the section.
+    /// @return Address of the first record.
+    inline SRecord* RecordsForHeader(SHeader* header)
+    {
+      return reinterpret_cast<SRecord*>(&header[1]);
+    }
+
+    /// Retrieves the records that follow the header of a hook statistics section.
+    /// @param [in] header Header at the beginning of the section.
+    /// @return Address of the first record.
+    inline const SRecord* RecordsForHeader(const SHeader* header)
+    {
+      return reinterpret_cast<const SRecord*>(&header[1]);
+    }
+
+    /// Determines whether or not this process should publish hook statistics.
+    /// @return `true` if so, `false` otherwise.
+    bool IsPublishingEnabled(void);
+
+    /// Counts a failed attempt to create a hook. Has no effect if publishing is disabled.
+    void CountInstallFailure(void);
+
+    /// Counts original functions whose overwritten redirections were repaired by the hook
+    /// integrity monitor. Has no effect if publishing is disabled.
+    /// @param [in] numRepairs Number of original functions redirected again.
+    void CountPatchRepairs(uint32_t numRepairs);
+
+    /// Stores the duration of each initialization phase in the hook statistics section. Has no
+    /// effect if publishing is disabled or if a startup profile has already been stored.
+    /// @param [in] phaseMicroseconds Duration of each initialization phase, in microseconds.
+    /// @param [in] numPhases Number of elements in the phase duration array. Phases beyond
+    /// #kMaxStartupPhases are omitted.
+    /// @param [in] totalMicroseconds Total duration of initialization, in microseconds.
+    void PublishStartupProfile(
+        const int64_t* phaseMicroseconds, size_t numPhases, int64_t totalMicroseconds);
+
+    /// Starts refreshing the hook statistics section on a dedicated thread, which also creates the
+    /// section if it does not already exist. Has no effect if publishing is disabled or has
+    /// already been started.
+    void StartPublishing(void);
+  } // namespace SharedStatistics
+} // namespace Hookshot
@@ -0,0 +1,101 @@
+/***************************************************************************************************
+ * Hookshot
+ *   General-purpose library for injecting DLLs and hooking function calls.
+ ***************************************************************************************************
+ * Authored by Samuel Grossman
+ * Copyright (c) 2019-2025
+ ***********************************************************************************************//**
+ * @file SharedStatisticsReader.h
+ *   Interface declaration for reading the hook statistics that other processes publish through
+ *   their named shared memory sections, without otherwise interacting with those processes.
+ **************************************************************************************************/
+
+#pragma once
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include "SharedStatistics.h"
+
+namespace Hookshot
+{
+  namespace SharedStatisticsReader
+  {
+    /// Consistent copy of the contents of a hook statistics section.
+    struct SSnapshot
+    {
+      /// Total number of hooks in the publishing process.
+      uint32_t numHooks;
+
+      /// Number of failed attempts to create hooks in the publishing process.
+      uint32_t numInstallFailures;
+
+      /// Number of overwritten redirections repaired in the publishing process.
+      uint32_t numPatchRepairs;
+
+      /// System tick count, in milliseconds, at which the records were published.
+      uint64_t publishTimestamp;
+
+      /// Measured rate of the processor time stamp counter in the publishing process, in ticks per
+      /// microsecond, or 0 if it has not yet been measured.
+      uint64_t ticksPerMicrosecond;
+
+      /// Number of valid initialization phase durations, or 0 if no startup profile was published.
+      uint32_t numStartupPhases;
+
+      /// Total duration of initialization in the publishing process, in microseconds.
+      int64_t startupTotalMicroseconds;
+
+      /// Duration of each initialization phase in the publishing process, in microseconds.
+      int64_t startupPhaseMicroseconds[SharedStatistics::kMaxStartupPhases];
+
+      /// Copies of the valid records.
+      std::vector<SharedStatistics::SRecord> records;
+    };
+
+    /// Identifies a process that is publishing hook statistics.
+    struct SPublishingProcess
+    {
+      /// Identifier of the process.
+      uint32_t processId;
+
+      /// File name of the executable that the process is running.
+      std::wstring executableName;
+    };
+
+    /// Maps a read-only view of the hook statistics section published by the specified process.
+    /// Neither opens nor otherwise interferes with the process itself.
+    /// @param [in] processId Identifier of the process whose section should be mapped.
+    /// @return Header at the beginning of the mapped view, or `nullptr` if the process is not
+    /// publishing hook statistics, in which case the system error code is available.
+    const SharedStatistics::SHeader* MapSection(uint32_t processId);
+
+    /// Unmaps a view of a hook statistics section previously mapped by #MapSection.
+    /// @param [in] header Header at the beginning of the mapped view.
+    void UnmapSection(const SharedStatistics::SHeader* header);
+
+    /// Copies the contents of a hook statistics section published by another process, retrying
+    /// until the copy is not torn by a concurrent update. Neither locks nor otherwise interferes
+    /// with the publishing process.
+    /// @param [in] header Header at the beginning of a mapped view of the section.
+    /// @param [out] snapshot Filled with a copy of the section contents.
+    /// @return `true` on success, `false` if the section has an unexpected layout or no consistent
+    /// copy could be obtained.
+    bool ReadSnapshot(const SharedStatistics::SHeader* header, SSnapshot* snapshot);
+
+    /// Computes the rate at which each hook was called between two snapshots of the same section.
+    /// Hooks that are not instrumented, or that did not exist when the earlier snapshot was taken,
+    /// have a rate of 0.
+    /// @param [in] previousSnapshot Earlier snapshot.
+    /// @param [in] currentSnapshot Later snapshot.
+    /// @return Calls per second for each record in the later snapshot, in the same order.
+    std::vector<uint64_t> ComputeCallsPerSecond(
+        const SSnapshot& previousSnapshot, const SSnapshot& currentSnapshot);
+
+    /// Enumerates every running process that is currently publishing hook statistics, by checking
+    /// for the existence of each process's section.
+    /// @return Publishing processes, ordered by process identifier.
+    std::vector<SPublishingProcess> EnumeratePublishingProcesses(void);
+  } // namespace SharedStatisticsReader
+} // namespace Hookshot
@@ -0,0 +1,46 @@
+/***************************************************************************************************
+ * Hookshot
+ *   General-purpose library for injecting DLLs and hooking function calls.
+ ***************************************************************************************************
+ * Authored by Samuel Grossman
+ * Copyright (c) 2019-2025
+ ***********************************************************************************************//**
+ * @file StartupProfile.h
+ *   Interface declaration for measuring how long each phase of Hookshot initialization takes.
+ **************************************************************************************************/
+
+#pragma once
+
+#include <cstdint>
+
+#include "Tracing.h"
+
+namespace Hookshot
+{
+  /// Records the start and end times of each phase of initialization in a fixed-size buffer. The
+  /// timestamps are always recorded, since doing so costs only a few clock reads, but they are only
+  /// reported if the configuration file asks for it. Initialization runs on a single thread, so
+  /// none of these functions are safe to invoke concurrently.
+  namespace StartupProfile
+  {
+    /// Records the start of an initialization phase.
+    /// @param [in] phase Phase that is starting.
+    void BeginPhase(Tracing::EStartupPhase phase);
+
+    /// Records the end of an initialization phase.
+    /// @param [in] phase Phase that is ending, which must previously have been started.
+    void EndPhase(Tracing::EStartupPhase phase);
+
+    /// Reports the duration of each initialization phase, if the configuration file enables
+    /// startup profiling, by writing a message to the log, emitting an event, and storing the
+    /// durations in the hook statistics section if it is published. Intended to be invoked once,
+    /// after the last phase has ended.
+    void Report(void);
+
+    /// Computes the total duration of initialization, whether or not the configuration file
+    /// enables startup profiling.
+    /// @return Amount of time from the start of the first phase to the end of the last, in
+    /// microseconds, or -1 if no phase has both started and ended.
+    int64_t GetTotalMicroseconds(void);
+  } // namespace StartupProfile
+} // namespace Hookshot
@@ -28,6 +28,36 @@ namespace Hookshot
     /// mapping handle rather than an executable name.
     inline constexpr wchar_t kCharCmdlineIndicatorFileMappingHandle = L'|';
 
+    /// Character that occurs at the start of a command-line argument to indicate it is the
+    /// identifier of a process whose hook statistics should be displayed rather than an executable
+    /// name.
+    inline constexpr wchar_t kCharCmdlineIndicatorHookStatisticsProcessId = L'#';
+
+    /// Character that occurs at the start of a command-line argument to indicate it is the
+    /// identifier of a process whose traced calls should be drained and displayed rather than an
+    /// executable name.
+    inline constexpr wchar_t kCharCmdlineIndicatorCallTraceProcessId = L'=';
+
+    /// Character that occurs at the start of a command-line argument to indicate it is the
+    /// identifier of an already-running process that should be injected rather than an executable
+    /// name.
+    inline constexpr wchar_t kCharCmdlineIndicatorInjectProcessId = L'@';
+
+    /// Character that occurs by itself as a command-line argument to indicate that the executable
+    /// should run as the injector daemon rather than launch an executable.
+    inline constexpr wchar_t kCharCmdlineIndicatorInjectorDaemon = L'~';
+
+    /// Character that occurs at the start of a command-line argument to indicate it is the number
+    /// of times the executable named by the next argument should be launched to measure injection
+    /// latency, rather than an executable name.
+    inline constexpr wchar_t kCharCmdlineIndicatorInjectionBenchmark = L'!';
+
+    /// Character that occurs at the start of a command-line argument to indicate that the next
+    /// argument is a manifest file listing command lines to launch, rather than an executable
+    /// name. The rest of the argument, if present, is the maximum number of launched programs
+    /// running at a time.
+    inline constexpr wchar_t kCharCmdlineIndicatorBatchLaunch = L'+';
+
     /// Name of the section in the injection binary that contains injection code.
     /// PE header encodes section name strings in UTF-8, so each character must directly be
     /// specified as being one byte. Per PE header specs, maximum string length is 8 including
@@ -69,12 +99,42 @@ namespace Hookshot
     inline constexpr std::string_view kStrHookLibraryInitFuncName = "@HookshotMain@4";
 #endif
 
+    /// Function name of the hook module's exported hook table accessor, which is optional.
+#ifdef _WIN64
+    inline constexpr std::string_view kStrHookLibraryHookTableFuncName = "HookshotHookTable";
+#else
+    inline constexpr std::string_view kStrHookLibraryHookTableFuncName = "@HookshotHookTable@4";
+#endif
+
     /// Configuration file setting name for specifying an injected library to load.
     inline constexpr std::wstring_view kStrConfigurationSettingNameInject = L"Inject";
 
-    /// Configuration file setting name for specifying a hook module to load.
+    /// Configuration file setting name for specifying an injected library to load in the
+    /// background, rather than before the executable's entry point runs.
+    inline constexpr std::wstring_view kStrConfigurationSettingNameInjectDeferred =
+        L"InjectDeferred";
+
+    /// Configuration file setting name for specifying a hook module to load. The name of the hook
+    /// module can be followed by `@` and the name of a trigger module, in which case the hook
+    /// module is only loaded once the trigger module is loaded.
     inline constexpr std::wstring_view kStrConfigurationSettingNameHookModule = L"HookModule";
 
+    /// Configuration file setting name for specifying a hook module bundle file, which holds
+    /// several hook modules that are all loaded before any other hook modules. Relative names are
+    /// relative to the directory in which hook modules are looked for.
+    inline constexpr std::wstring_view kStrConfigurationSettingNameHookModuleBundle =
+        L"HookModuleBundle";
+
+    /// Configuration file setting name for specifying an exported function, identified as
+    /// `module!export`, on which to create a call trace hook without loading any hook module.
+    inline constexpr std::wstring_view kStrConfigurationSettingNameTraceCall = L"TraceCall";
+
+    /// Configuration file setting name for specifying a module near which trampoline memory should
+    /// be reserved in the background during startup, so that the first hook created in that module
+    /// finds it ready. Modules that are not yet loaded are handled once they are loaded.
+    inline constexpr std::wstring_view kStrConfigurationSettingNamePreallocateTrampolinesNear =
+        L"PreallocateTrampolinesNear";
+
     /// Configuration file setting name for enabling and specifying the verbosity of output to the
     /// log file.
     inline constexpr std::wstring_view kStrConfigurationSettingNameLogLevel = L"LogLevel";
@@ -90,9 +150,256 @@ namespace Hookshot
         kStrConfigurationSettingNameLoadHookModulesFromHookshotDirectory =
             L"LoadHookModulesFromHookshotDirectory";
 
+    /// Configuration file setting for specifying that hook modules and injection-only libraries,
+    /// along with their dependencies, should be looked for only in the directory of the library
+    /// being loaded, the system directory, and any configured hook module search directories,
+    /// rather than along the full default search path.
+    inline constexpr std::wstring_view kStrConfigurationSettingNameRestrictHookModuleSearchPath =
+        L"RestrictHookModuleSearchPath";
+
+    /// Configuration file setting for specifying an additional directory in which to look for the
+    /// dependencies of hook modules and injection-only libraries when the search path is
+    /// restricted.
+    inline constexpr std::wstring_view kStrConfigurationSettingNameHookModuleSearchDirectory =
+        L"HookModuleSearchDirectory";
+
+    /// Configuration file setting for specifying that child processes should be injected on a
+    /// worker thread so that the parent process' call to create them can return immediately.
+    inline constexpr std::wstring_view
+        kStrConfigurationSettingNameInjectChildProcessesAsynchronously =
+            L"InjectChildProcessesAsynchronously";
+
+    /// Configuration file setting for specifying that child processes should be told where this
+    /// process placed the trampolines for its internal hooks, so that they can place their own
+    /// internal hook trampolines at the same locations rather than searching for space.
+    inline constexpr std::wstring_view
+        kStrConfigurationSettingNameShareInternalHookLayoutWithChildProcesses =
+            L"ShareInternalHookLayoutWithChildProcesses";
+
+    /// Configuration file setting for specifying that hook modules should be loaded and
+    /// initialized concurrently on worker threads rather than one after another.
+    inline constexpr std::wstring_view kStrConfigurationSettingNameLoadHookModulesInParallel =
+        L"LoadHookModulesInParallel";
+
+    /// Configuration file setting for specifying that, when hook modules are loaded in parallel,
+    /// their initialization functions should still be invoked one at a time in priority order,
+    /// which is the order in which they are configured.
+    inline constexpr std::wstring_view kStrConfigurationSettingNamePreserveHookModuleOrder =
+        L"PreserveHookModuleOrder";
+
+    /// Configuration file setting for specifying that hooks should count the number of times they
+    /// are invoked, so that the counts can be queried using the Hookshot interface.
+    inline constexpr std::wstring_view kStrConfigurationSettingNameInstrumentHooks =
+        L"InstrumentHooks";
+
+    /// Configuration file setting for specifying that hooks should time one out of every so many
+    /// calls, so that histograms of their durations can be queried using the Hookshot interface.
+    /// The value is the number of calls per timed call, and 0 disables sampled hook timing.
+    inline constexpr std::wstring_view kStrConfigurationSettingNameHookTimingSampleInterval =
+        L"HookTimingSampleInterval";
+
+    /// Configuration file setting for specifying the interval of every sampled hook, in place of
+    /// the interval requested by the hook module that created it. The value is the number of calls
+    /// per call that reaches the hook function, and 0 keeps the requested intervals.
+    inline constexpr std::wstring_view kStrConfigurationSettingNameSampledHookInterval =
+        L"SampledHookInterval";
+
+    /// Configuration file setting for specifying that calls timed by sampled hook timing should
+    /// also have their return addresses recorded, so that the modules calling each hook can be
+    /// queried using the Hookshot interface.
+    inline constexpr std::wstring_view kStrConfigurationSettingNameRecordHookCallers =
+        L"RecordHookCallers";
+
+    /// Configuration file setting for specifying the latency budget given to each hook whose timing
+    /// is sampled. The value is a number of microseconds, and a hook whose sampled 99th percentile
+    /// duration stays above it is disabled. 0 disables latency budgets by default.
+    inline constexpr std::wstring_view kStrConfigurationSettingNameHookLatencyBudgetMicroseconds =
+        L"HookLatencyBudgetMicroseconds";
+
+    /// Configuration file setting for specifying that original functions should jump directly to
+    /// their hook functions, rather than by way of their trampolines, whenever possible.
+    inline constexpr std::wstring_view kStrConfigurationSettingNameDirectHookJumps =
+        L"DirectHookJumps";
+
+    /// Configuration file setting for specifying that the code that transfers control to each hook
+    /// function should be kept separately from transplanted original function code.
+    inline constexpr std::wstring_view kStrConfigurationSettingNameSegregateHookStubs =
+        L"SegregateHookStubs";
+
+    /// Configuration file setting for specifying that trampoline memory should be writable only
+    /// while Hookshot is actively modifying trampolines.
+    inline constexpr std::wstring_view kStrConfigurationSettingNameWriteProtectTrampolines =
+        L"WriteProtectTrampolines";
+
+    /// Configuration file setting for specifying that trampoline memory should be faulted in and
+    /// locked into the working set as soon as it is committed, so that the first call through a
+    /// hook never takes a page fault.
+    inline constexpr std::wstring_view kStrConfigurationSettingNameLockTrampolinePages =
+        L"LockTrampolinePages";
+
+    /// Configuration file setting for specifying that original functions should periodically be
+    /// checked for redirections overwritten by something other than Hookshot, which are then
+    /// written again.
+    inline constexpr std::wstring_view kStrConfigurationSettingNameMonitorHookIntegrity =
+        L"MonitorHookIntegrity";
+
+    /// Configuration file setting for specifying that hook modules should be loaded from copies of
+    /// their files and reloaded automatically whenever their files change.
+    inline constexpr std::wstring_view kStrConfigurationSettingNameHotReloadHookModules =
+        L"HotReloadHookModules";
+
+    /// Configuration file setting for specifying that hook statistics should be published in a
+    /// named shared memory section, so that other processes can read them.
+    inline constexpr std::wstring_view kStrConfigurationSettingNamePublishHookStatistics =
+        L"PublishHookStatistics";
+
+    /// Configuration file setting for specifying that a summary of hook creation and of every hook
+    /// should be appended to the exit summary file when the process exits.
+    inline constexpr std::wstring_view kStrConfigurationSettingNameWriteExitSummary =
+        L"WriteExitSummary";
+
+    /// Configuration file setting for specifying that the most frequent log messages should be
+    /// appended to a memory-mapped ring file rather than written to the log file one at a time.
+    /// Only applicable if logging is enabled.
+    inline constexpr std::wstring_view kStrConfigurationSettingNameLogToMappedFile =
+        L"LogToMappedFile";
+
+    /// Configuration file setting for specifying that child processes should append their most
+    /// frequent log messages to the memory-mapped ring file of the process at the root of the
+    /// process tree rather than each creating a ring file of their own. Only applicable if
+    /// messages are logged to a memory-mapped ring file.
+    inline constexpr std::wstring_view
+        kStrConfigurationSettingNameShareMappedLogWithChildProcesses =
+            L"ShareMappedLogWithChildProcesses";
+
+    /// Configuration file setting for specifying that the instructions transplanted out of each
+    /// original function should be described in a hook plan cache file shared by all processes, so
+    /// that hooking the same function again does not require decoding it.
+    inline constexpr std::wstring_view kStrConfigurationSettingNameCacheHookPlans =
+        L"CacheHookPlans";
+
+    /// Configuration file setting for specifying that the list of hook modules found in the hook
+    /// module directory should be kept in a manifest file shared by all processes, so that loading
+    /// hook modules by default does not require enumerating the directory in every process.
+    inline constexpr std::wstring_view kStrConfigurationSettingNameCacheHookModuleManifest =
+        L"CacheHookModuleManifest";
+
+    /// Configuration file setting for specifying that the code injected into new processes should
+    /// be mapped from a section shared by all of them rather than copied into each one separately.
+    inline constexpr std::wstring_view kStrConfigurationSettingNameShareInjectedCode =
+        L"ShareInjectedCode";
+
+    /// Configuration file setting for specifying that the injecting process should keep an image
+    /// of the Hookshot library mapped for as long as it runs, so that every process it injects maps
+    /// the library at the same base address and shares the pages that hold it.
+    inline constexpr std::wstring_view kStrConfigurationSettingNamePinHookshotLibraryImage =
+        L"PinHookshotLibraryImage";
+
+    /// Configuration file setting for specifying that the code injected into new processes should
+    /// run as an asynchronous procedure call on the main thread rather than by temporarily
+    /// replacing the entry point with a trampoline.
+    inline constexpr std::wstring_view kStrConfigurationSettingNameInjectUsingApc =
+        L"InjectUsingApc";
+
+    /// Configuration file setting for specifying that the Hookshot executable should place the
+    /// process it creates into a job object and inject every other process that joins the job,
+    /// rather than each injected process injecting its own child processes.
+    inline constexpr std::wstring_view kStrConfigurationSettingNameInjectChildProcessesUsingJob =
+        L"InjectChildProcessesUsingJob";
+
+    /// Configuration file setting for specifying a pattern that identifies child processes to
+    /// inject. If any are specified, only child processes whose executables match one of them are
+    /// injected. Patterns can contain the wildcards `*` and `?` and are matched without regard to
+    /// case against the executable file name, or against the full path if they contain a
+    /// backslash.
+    inline constexpr std::wstring_view kStrConfigurationSettingNameAllowChildProcess =
+        L"AllowChildProcess";
+
+    /// Configuration file setting for specifying a pattern that identifies child processes not to
+    /// inject, written the same way as for AllowChildProcess. Takes precedence over it.
+    inline constexpr std::wstring_view kStrConfigurationSettingNameDenyChildProcess =
+        L"DenyChildProcess";
+
+    /// Configuration file setting for specifying that the amount of time each phase of Hookshot
+    /// initialization takes in an injected process should be reported once initialization is
+    /// complete, in the log, as an event, and in the hook statistics section if it is published.
+    inline constexpr std::wstring_view kStrConfigurationSettingNameProfileStartup =
+        L"ProfileStartup";
+
+    /// Configuration file setting for specifying that hooks whose original functions are thunks,
+    /// consisting only of an unconditional jump, should instead be placed on the functions to
+    /// which the thunks ultimately jump.
+    inline constexpr std::wstring_view kStrConfigurationSettingNameFollowJumpThunks =
+        L"FollowJumpThunks";
+
+    /// Configuration file setting for specifying that the locations at which byte patterns are
+    /// found should be kept in a pattern cache file next to the configuration file, so that the
+    /// same build of a module does not need to be searched again every time the application runs.
+    inline constexpr std::wstring_view kStrConfigurationSettingNameCachePatternSearches =
+        L"CachePatternSearches";
+
+    /// Configuration file setting for specifying that hooks created in a batch should be placed in
+    /// import address tables, rather than by modifying their original functions, whenever the
+    /// modification would be the only one on a page that is not otherwise made private.
+    inline constexpr std::wstring_view
+        kStrConfigurationSettingNamePreferImportHooksForIsolatedPages =
+            L"PreferImportHooksForIsolatedPages";
+
+    /// Configuration file setting for specifying that Hookshot's background threads should run only
+    /// on the most power-efficient cores of a hybrid processor, leaving its higher-performance
+    /// cores to the application.
+    inline constexpr std::wstring_view
+        kStrConfigurationSettingNamePreferEfficiencyCoresForBackgroundWork =
+            L"PreferEfficiencyCoresForBackgroundWork";
+
+    /// Configuration file setting for specifying that Hookshot's background threads should run at
+    /// below-normal priority and request power-efficient execution from the operating system.
+    inline constexpr std::wstring_view kStrConfigurationSettingNameLowerBackgroundWorkPriority =
+        L"LowerBackgroundWorkPriority";
+
+    /// Configuration file setting for specifying the name of the performance profile to apply. A
+    /// value in the section for the currently-running executable takes precedence over one in the
+    /// global section.
+    inline constexpr std::wstring_view kStrConfigurationSettingNamePerformanceProfile =
+        L"PerformanceProfile";
+
+    /// Configuration file setting for specifying that the configuration file should be watched for
+    /// changes, upon which the settings that can change at runtime are reloaded and applied.
+    inline constexpr std::wstring_view kStrConfigurationSettingNameWatchConfigurationFile =
+        L"WatchConfigurationFile";
+
+    /// Prefix of the name of each configuration file section that defines a performance profile.
+    /// The rest of the section name is the name of the profile. Settings in the profile that is
+    /// applied take precedence over the same settings in the global section.
+    inline constexpr std::wstring_view kStrConfigurationSectionPrefixPerformanceProfile =
+        L"Profile:";
+
+    /// Name of the environment variable through which the Hookshot executable passes the name of
+    /// its injection job object to the processes it creates.
+    inline constexpr std::wstring_view kStrInjectionJobEnvironmentVariableName =
+        L"HOOKSHOT_INJECTION_JOB";
+
+    /// Name of the environment variable that, if set, directs the Hookshot executable and the
+    /// Hookshot Launcher to have the injector daemon create and inject processes on their behalf.
+    inline constexpr std::wstring_view kStrInjectorDaemonEnvironmentVariableName =
+        L"HOOKSHOT_INJECTOR_DAEMON";
+
+    /// Name of the environment variable that, if set, directs an injected process not to load any
+    /// hook modules. Used to measure injection latency without the cost of hook modules.
+    inline constexpr std::wstring_view kStrSkipHookModulesEnvironmentVariableName =
+        L"HOOKSHOT_SKIP_HOOK_MODULES";
+
     /// Expected filename of the dynamic-link library form of Hookshot.
     std::wstring_view GetHookshotDynamicLinkLibraryFilename(void);
 
+    /// Expected filename of the dynamic-link library form of Hookshot targeting the opposite
+    /// processor architecture. For example, when running in 64-bit mode, this is the name of the
+    /// 32-bit library, and vice versa.
+    std::wstring_view GetHookshotDynamicLinkLibraryOtherArchitectureFilename(void);
+
+    /// Expected filename of the Hookshot configuration file.
+    std::wstring_view GetHookshotConfigurationFilename(void);
+
     /// Expected filename of the executable form of Hookshot.
     std::wstring_view GetHookshotExecutableFilename(void);
 
@@ -116,6 +423,12 @@ namespace Hookshot
     /// @return Directory-wide authorization filename.
     Infra::TemporaryString AuthorizationFilenameDirectoryWide(std::wstring_view executablePath);
 
+    /// Generates the name of the shared memory section into which call trace hooks in the specified
+    /// process record the calls they intercept.
+    /// @param [in] processId Identifier of the recording process.
+    /// @return Shared memory section name.
+    Infra::TemporaryString CallTraceSectionName(uint32_t processId);
+
     /// Generates the expected filename of a hook module of the specified name.
     /// Hook module filename = (directory name)\(hook module name).(hook module suffix)
     /// @param [in] moduleName Hook module name to use when generating the filename.
@@ -123,5 +436,51 @@ namespace Hookshot
     /// @return Resulting hook module filename.
     Infra::TemporaryString HookModuleFilename(
         std::wstring_view moduleName, std::wstring_view directoryName);
+
+    /// Generates the name of the shared memory section through which the specified process
+    /// publishes its hook statistics.
+    /// @param [in] processId Identifier of the publishing process.
+    /// @return Shared memory section name.
+    Infra::TemporaryString HookStatisticsSectionName(uint32_t processId);
+
+    /// Generates the name of the job object whose processes are all injected by the specified
+    /// instance of the Hookshot executable.
+    /// @param [in] brokerProcessId Identifier of the Hookshot executable process.
+    /// @return Job object name.
+    Infra::TemporaryString InjectionJobObjectName(uint32_t brokerProcessId);
+
+    /// Generates the name of the named pipe through which the injector daemon accepts requests.
+    /// Each user in each session has its own injector daemon for each Hookshot executable.
+    /// @return Named pipe name.
+    Infra::TemporaryString InjectorDaemonPipeName(void);
+
+    /// Generates the name of the memory-mapped ring file to which log messages are appended, which
+    /// is specific to the current process.
+    /// Mapped log filename = (directory name)\(product name)_(executable name)_(process ID).log
+    /// @return Mapped log filename.
+    Infra::TemporaryString MappedLogFilename(void);
+
+    /// Generates the name of the file to which every process appends its exit summary.
+    /// Exit summary filename = (directory name)\(product name).ExitSummary.csv
+    /// @return Exit summary filename.
+    Infra::TemporaryString ExitSummaryFilename(void);
+
+    /// Generates the name of the shared memory section through which the memory-mapped ring file
+    /// created by the specified process is shared with its descendants.
+    /// @param [in] rootProcessId Identifier of the process that created the ring file.
+    /// @return Shared memory section name.
+    Infra::TemporaryString MappedLogSectionName(uint32_t rootProcessId);
+
+    /// Generates the name of the shared memory section through which the specified process tells
+    /// its child processes which process created the memory-mapped ring file that it uses.
+    /// @param [in] processId Identifier of the process that uses the ring file.
+    /// @return Shared memory section name.
+    Infra::TemporaryString MappedLogLinkSectionName(uint32_t processId);
+
+    /// Generates the name of the shared memory section through which a parent process tells the
+    /// specified child process where it placed the trampolines for its internal hooks.
+    /// @param [in] processId Identifier of the child process.
+    /// @return Shared memory section name.
+    Infra::TemporaryString InternalHookLayoutSectionName(uint32_t processId);
   } // namespace Strings
 } // namespace Hookshot
@@ -0,0 +1,145 @@
+/***************************************************************************************************
+ * Hookshot
+ *   General-purpose library for injecting DLLs and hooking function calls.
+ ***************************************************************************************************
+ * Authored by Samuel Grossman
+ * Copyright (c) 2019-2025
+ ***********************************************************************************************//**
+ * @file SymbolIndex.h
+ *   Declaration of the symbol index file format and interface declaration for looking up symbols
+ *   in symbol index files.
+ **************************************************************************************************/
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <string_view>
+
+#include "ApiWindows.h"
+
+namespace Hookshot
+{
+  /// A symbol index file maps the names of functions within particular builds of modules to their
+  /// relative virtual addresses, so that functions which are not exported can be hooked by name
+  /// without loading any debugging symbols into the hooked process. Symbol index files are created
+  /// ahead of time by the symbol indexing tool, which reads the debugging symbols of each module.
+  /// At runtime they are memory-mapped, and each name is located by binary search.
+  ///
+  /// A symbol index file consists of a header, an array of module entries sorted by module
+  /// identity, an array of symbol entries grouped by module and sorted by name within each group,
+  /// and finally a string table that holds the names. Names are not null-terminated.
+  namespace SymbolIndex
+  {
+    /// Signature that identifies a symbol index file. Spells "HSSI" in a hex dump.
+    inline constexpr uint32_t kSignature = 0x49535348;
+
+    /// Version of the symbol index file format. Must be incremented whenever the format changes.
+    inline constexpr uint32_t kVersion = 1;
+
+    /// File extension conventionally used for symbol index files.
+    inline constexpr std::wstring_view kStrFileExtension = L".SymbolIndex";
+
+    /// Header at the very beginning of a symbol index file.
+    struct SFileHeader
+    {
+      /// Must be equal to #kSignature.
+      uint32_t signature;
+
+      /// Must be equal to #kVersion.
+      uint32_t version;
+
+      /// Number of module entries that immediately follow the header.
+      uint32_t numModules;
+
+      /// Number of symbol entries that immediately follow the module entries.
+      uint32_t numSymbols;
+
+      /// Size, in bytes, of the string table that immediately follows the symbol entries.
+      uint32_t stringTableSizeBytes;
+
+      /// Unused, for alignment only.
+      uint32_t reserved;
+    };
+
+    /// Identifies a particular build of a module, using the same values that symbol servers use.
+    struct SModuleIdentity
+    {
+      /// Timestamp from the header of the module.
+      uint32_t timeDateStamp;
+
+      /// Size of the module's image, from its header.
+      uint32_t sizeOfImage;
+
+      inline bool operator==(const SModuleIdentity& other) const
+      {
+        return (timeDateStamp == other.timeDateStamp) && (sizeOfImage == other.sizeOfImage);
+      }
+
+      inline bool operator<(const SModuleIdentity& other) const
+      {
+        if (timeDateStamp != other.timeDateStamp) return (timeDateStamp < other.timeDateStamp);
+        return (sizeOfImage < other.sizeOfImage);
+      }
+    };
+
+    /// Describes the symbols of a single module within a symbol index file.
+    struct SModuleEntry
+    {
+      /// Build of the module to which the symbols belong.
+      SModuleIdentity identity;
+
+      /// Index of the first of this module's symbol entries.
+      uint32_t firstSymbol;
+
+      /// Number of symbol entries that belong to this module.
+      uint32_t numSymbols;
+    };
+
+    /// Describes a single named function within a symbol index file.
+    struct SSymbolEntry
+    {
+      /// Offset of the name within the string table.
+      uint32_t nameOffset;
+
+      /// Length of the name, in bytes.
+      uint32_t nameLength;
+
+      /// Offset of the function from the base address of its module.
+      uint32_t rva;
+    };
+
+    static_assert(
+        0 == (sizeof(SFileHeader) % alignof(SModuleEntry)),
+        "Symbol index file header size must preserve module entry alignment.");
+    static_assert(
+        0 == (sizeof(SModuleEntry) % alignof(SSymbolEntry)),
+        "Symbol index module entry size must preserve symbol entry alignment.");
+
+    /// Identifies a module loaded in the current process for the purpose of looking up its symbols.
+    /// @param [in] moduleHandle Handle of the module of interest.
+    /// @param [out] moduleIdentity Filled with the identity of the module, if the operation
+    /// succeeds.
+    /// @return `true` if the module was identified, `false` otherwise.
+    bool GetModuleIdentity(HMODULE moduleHandle, SModuleIdentity* moduleIdentity);
+
+    /// Resolves the relative virtual addresses of one or more symbols within a module loaded in
+    /// the current process. The symbol index file is mapped into memory the first time it is
+    /// used and remains mapped for the lifetime of the process. Safe to invoke concurrently from
+    /// multiple threads.
+    /// @param [in] symbolIndexFilename Name of the symbol index file.
+    /// @param [in] moduleHandle Handle of the module to which the symbols belong.
+    /// @param [in] symbolNames Names of the symbols to resolve. Elements may be `nullptr`.
+    /// @param [in] numSymbolNames Number of names to resolve.
+    /// @param [out] symbolRelativeAddresses Filled with the relative virtual address of each
+    /// symbol, or 0 for each symbol that the symbol index file does not contain.
+    /// @return `true` if the symbol index file was usable and contains the module, even if some
+    /// of the symbols were not found, or `false` otherwise, in which case no symbols are resolved.
+    bool LookupSymbols(
+        std::wstring_view symbolIndexFilename,
+        HMODULE moduleHandle,
+        const char* const* symbolNames,
+        size_t numSymbolNames,
+        uint32_t* symbolRelativeAddresses);
+  } // namespace SymbolIndex
+} // namespace Hookshot
@@ -0,0 +1,84 @@
+/***************************************************************************************************
+ * Hookshot
+ *   General-purpose library for injecting DLLs and hooking function calls.
+ ***************************************************************************************************
+ * Authored by Samuel Grossman
+ * Copyright (c) 2019-2025
+ ***********************************************************************************************//**
+ * @file TaskScheduler.h
+ *   Interface declaration for the scheduler that runs all of Hookshot's background work.
+ **************************************************************************************************/
+
+#pragma once
+
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <mutex>
+
+#include "ApiWindows.h"
+
+namespace Hookshot
+{
+  namespace TaskScheduler
+  {
+    /// Function that implements a task.
+    /// @param [in] context Value supplied when the task was submitted.
+    using TTaskProc = void (*)(void* context);
+
+    /// Set of tasks whose completion can be awaited together. Must remain valid until all of the
+    /// tasks submitted as part of it have completed. Contents are internal to the scheduler.
+    struct STaskGroup
+    {
+      /// Enforces serialized access to the number of outstanding tasks.
+      std::mutex mutex;
+
+      /// Notified when the last outstanding task completes.
+      std::condition_variable completed;
+
+      /// Number of tasks submitted as part of this group that have not yet completed.
+      size_t numOutstanding = 0;
+    };
+
+    /// Submits a task to be run on one of the scheduler's worker threads. The number of worker
+    /// threads is bounded and small, so that background work does not compete with the
+    /// application for processor time. Each worker thread has its own queue of tasks, and idle
+    /// worker threads steal tasks from the queues of busy ones. If no worker thread could be
+    /// created, the task runs on the calling thread before this function returns.
+    /// @param [in] taskProc Function that implements the task.
+    /// @param [in] context Value to pass to the task function.
+    /// @param [in] group Optional group of which the task is a part.
+    void Submit(TTaskProc taskProc, void* context, STaskGroup* group = nullptr);
+
+    /// Submits a task to be run on one of the scheduler's worker threads once the specified delay
+    /// has elapsed. Idle worker threads sleep until the earliest such task is due, so periodic
+    /// background work can be done by a task that submits itself again for as long as there is
+    /// work to do, without a dedicated thread and without waking up once there is none. Delayed
+    /// tasks cannot be part of a group. Safe to invoke from within a task.
+    /// @param [in] delayMilliseconds Minimum time, in milliseconds, before the task runs.
+    /// @param [in] taskProc Function that implements the task.
+    /// @param [in] context Value to pass to the task function.
+    /// @return `true` if the task was submitted, `false` if no worker thread could be created, in
+    /// which case the task will never run.
+    bool SubmitAfter(uint32_t delayMilliseconds, TTaskProc taskProc, void* context);
+
+    /// Waits for all of the tasks submitted as part of a group to complete. While waiting, the
+    /// calling thread runs any tasks from the same group that are still queued, so a group always
+    /// completes even if the worker threads are busy or cannot yet run.
+    /// @param [in] group Group whose tasks are to be awaited.
+    void Wait(STaskGroup& group);
+
+    /// Creates a thread that performs background work and applies to it the background thread
+    /// placement and priority policy selected by the performance profile before it starts running.
+    /// Every thread that Hookshot creates within the process, including the scheduler's own worker
+    /// threads, is created this way. Depending on the policy, the thread is restricted to the most
+    /// power-efficient cores of a hybrid processor, and it runs at below-normal priority with
+    /// power-efficient execution requested. Parts of the policy that the system does not support
+    /// are skipped.
+    /// @param [in] threadProc Entry point of the thread.
+    /// @param [in] parameter Value to pass to the entry point.
+    /// @return Handle of the new thread, which the caller must close, or `nullptr` if the thread
+    /// could not be created, in which case the system error code is available via GetLastError.
+    HANDLE CreateBackgroundThread(LPTHREAD_START_ROUTINE threadProc, LPVOID parameter);
+  } // namespace TaskScheduler
+} // namespace Hookshot
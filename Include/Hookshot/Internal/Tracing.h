@@ -0,0 +1,208 @@
+/***************************************************************************************************
+ * Hookshot
+ *   General-purpose library for injecting DLLs and hooking function calls.
+ ***************************************************************************************************
+ * Authored by Samuel Grossman
+ * Copyright (c) 2019-2025
+ ***********************************************************************************************//**
+ * @file Tracing.h
+ *   Interface declaration for emitting structured events using Event Tracing for Windows.
+ **************************************************************************************************/
+
+#pragma once
+
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <string_view>
+
+#include <Infra/Core/Message.h>
+
+#include "ApiWindows.h"
+#include "HookshotTypes.h"
+#include "InjectResult.h"
+
+namespace Hookshot
+{
+  namespace Tracing
+  {
+    /// Enumerates the phases of process injection that are reported as individual events.
+    enum class EInjectPhase
+    {
+      /// Verifying that Hookshot is authorized to inject the process.
+      Authorize,
+
+      /// Verifying that the process has the same architecture as the running Hookshot instance.
+      VerifyArchitecture,
+
+      /// Advancing the process so that the loader finishes loading its initial modules.
+      Advance,
+
+      /// Reading the process environment block to locate the executable image.
+      LocateProcessEnvironmentBlock,
+
+      /// Parsing the executable image headers to locate the entry point.
+      LocateEntryPoint,
+
+      /// Allocating code and data regions in the process.
+      Allocate,
+
+      /// Writing the injected code and data and placing the entry point trampoline.
+      SetInjectedCode,
+
+      /// Running the injected code until it has loaded the Hookshot library.
+      RunInjectedCode,
+
+      /// Restoring the original contents of the entry point after the injected code has run.
+      Cleanup,
+    };
+
+    /// Number of phases enumerated by EInjectPhase.
+    inline constexpr size_t kNumInjectPhases = static_cast<size_t>(EInjectPhase::Cleanup) + 1;
+
+    /// Holds the amount of time, in microseconds, that each phase of process injection took. Phases
+    /// that did not run, for example because an earlier phase failed, are recorded as -1. Contains
+    /// only 64-bit integers so that it can be exchanged between 32-bit and 64-bit processes.
+    struct SInjectPhaseDurations
+    {
+      /// Duration of each phase, in microseconds, indexed by EInjectPhase.
+      int64_t microseconds[kNumInjectPhases];
+
+      /// Marks all phases as not having run.
+      inline void Clear(void)
+      {
+        for (size_t i = 0; i < kNumInjectPhases; ++i)
+          microseconds[i] = -1;
+      }
+
+      /// Records the duration of a single phase.
+      /// @param [in] phase Phase that completed.
+      /// @param [in] durationMicroseconds Amount of time the phase took, in microseconds.
+      inline void Record(EInjectPhase phase, long long durationMicroseconds)
+      {
+        microseconds[static_cast<size_t>(phase)] = static_cast<int64_t>(durationMicroseconds);
+      }
+    };
+
+    /// Enumerates the phases of initializing Hookshot in an injected process, all of which run
+    /// before the original entry point of the process.
+    enum class EStartupPhase
+    {
+      /// Reading the configuration file, or its binary snapshot if one is available.
+      ReadConfiguration,
+
+      /// Initializing global data and enabling the log if it is configured.
+      InitializeGlobals,
+
+      /// Setting the hooks that Hookshot uses internally, which includes initializing the tables
+      /// used to decode instructions unless every internal hook uses a cached hook plan.
+      SetInternalHooks,
+
+      /// Starting to publish hook statistics if it is configured.
+      StartPublishing,
+
+      /// Loading hook modules and injection-only libraries.
+      LoadHookModules,
+    };
+
+    /// Number of phases enumerated by EStartupPhase.
+    inline constexpr size_t kNumStartupPhases =
+        static_cast<size_t>(EStartupPhase::LoadHookModules) + 1;
+
+    /// Holds the amount of time, in microseconds, that each phase of initialization took. Phases
+    /// that did not run are recorded as -1. Contains only 64-bit integers so that it can be copied
+    /// directly into the hook statistics section.
+    struct SStartupPhaseDurations
+    {
+      /// Duration of each phase, in microseconds, indexed by EStartupPhase.
+      int64_t microseconds[kNumStartupPhases];
+
+      /// Amount of time from the start of the first phase to the end of the last, in microseconds,
+      /// which includes time spent between phases.
+      int64_t totalMicroseconds;
+    };
+
+    /// Computes the number of microseconds that have elapsed since a particular point in time. Used
+    /// to measure the durations that are reported in events.
+    /// @param [in] start Point in time from which to measure.
+    /// @return Number of microseconds elapsed.
+    inline long long MicrosecondsSince(const std::chrono::steady_clock::time_point start)
+    {
+      return static_cast<long long>(std::chrono::duration_cast<std::chrono::microseconds>(
+                                        std::chrono::steady_clock::now() - start)
+                                        .count());
+    }
+
+    /// Emits an event marking the start of an API request to create a single hook.
+    /// @param [in] originalFunc Address of the function that should be hooked.
+    /// @param [in] hookFunc Hook function that should be invoked instead of the original function.
+    void CreateHookStart(const void* originalFunc, const void* hookFunc);
+
+    /// Emits an event marking the end of an API request to create a single hook.
+    /// @param [in] originalFunc Address of the function that should be hooked.
+    /// @param [in] hookFunc Hook function that should be invoked instead of the original function.
+    /// @param [in] result Result of the operation.
+    void CreateHookStop(const void* originalFunc, const void* hookFunc, EResult result);
+
+    /// Emits an event marking the start of an API request to create a batch of hooks.
+    /// @param [in] numHookSpecs Number of hooks requested.
+    void CreateHooksStart(size_t numHookSpecs);
+
+    /// Emits an event marking the end of an API request to create a batch of hooks.
+    /// @param [in] numHookSpecs Number of hooks requested.
+    /// @param [in] result Result of the operation.
+    void CreateHooksStop(size_t numHookSpecs, EResult result);
+
+    /// Emits an event reporting the completion of a single phase of process injection.
+    /// @param [in] processId Identifier of the process being injected.
+    /// @param [in] phase Phase that completed.
+    /// @param [in] durationMicroseconds Amount of time the phase took, in microseconds.
+    /// @param [in] result Result of the phase.
+    void InjectProcessPhase(
+        DWORD processId, EInjectPhase phase, long long durationMicroseconds, EInjectResult result);
+
+    /// Outputs a message listing the amount of time each phase of injecting a process took.
+    /// @param [in] severity Severity of the message.
+    /// @param [in] processId Identifier of the process that was injected.
+    /// @param [in] phaseDurations Durations of each injection phase.
+    void OutputInjectPhaseDurations(
+        Infra::Message::ESeverity severity,
+        DWORD processId,
+        const SInjectPhaseDurations& phaseDurations);
+
+    /// Emits an event reporting the amount of time each phase of initialization took.
+    /// @param [in] phaseDurations Durations of each initialization phase.
+    void StartupProfile(const SStartupPhaseDurations& phaseDurations);
+
+    /// Outputs a message listing the amount of time each phase of initialization took.
+    /// @param [in] severity Severity of the message.
+    /// @param [in] phaseDurations Durations of each initialization phase.
+    void OutputStartupPhaseDurations(
+        Infra::Message::ESeverity severity, const SStartupPhaseDurations& phaseDurations);
+
+    /// Emits an event reporting that a hook module library was loaded, or failed to load.
+    /// @param [in] hookModuleFileName File name of the hook module.
+    /// @param [in] durationMicroseconds Amount of time loading took, in microseconds.
+    /// @param [in] succeeded Whether or not the hook module was loaded successfully.
+    void HookModuleLoad(
+        std::wstring_view hookModuleFileName, long long durationMicroseconds, bool succeeded);
+
+    /// Emits an event reporting that a hook module's initialization function returned.
+    /// @param [in] hookModuleFileName File name of the hook module.
+    /// @param [in] durationMicroseconds Amount of time initialization took, in microseconds.
+    void HookModuleInitialize(std::wstring_view hookModuleFileName, long long durationMicroseconds);
+
+    /// Emits an event reporting that a hook was disabled because its sampled durations exceeded its
+    /// latency budget.
+    /// @param [in] originalFunc Address of the original function of the hook.
+    /// @param [in] hookFunc Hook function that was disabled.
+    /// @param [in] percentile99Microseconds Estimated 99th percentile duration of the hook, in
+    /// microseconds, during the most recent check.
+    /// @param [in] budgetMicroseconds Latency budget of the hook, in microseconds.
+    void HookLatencyBudgetExceeded(
+        const void* originalFunc,
+        const void* hookFunc,
+        uint64_t percentile99Microseconds,
+        uint32_t budgetMicroseconds);
+  } // namespace Tracing
+} // namespace Hookshot
@@ -15,6 +15,8 @@
 #include <cstdint>
 #include <cstdlib>
 
+#include "X86Instruction.h"
+
 namespace Hookshot
 {
   /// Generates and holds two types of trampoline code. The first type is used to transfer control
@@ -22,9 +24,11 @@ namespace Hookshot
   /// invoke the original (i.e. unhooked) functionality of said target function. In order to be
   /// useful, the memory location where a Trampoline object is stored must have execute permission.
   /// Once a target is set, the trampoline itself becomes essentially constant. Transplanted code
-  /// may be position-dependent, so this object cannot be moved or copied. Non-const methods in this
-  /// class are not thread-safe and require a form of external concurrency control if accessed from
-  /// multiple threads.
+  /// may be position-dependent, so this object cannot be moved or copied. Once its original
+  /// function is set, a trampoline might be compacted by the store that holds it, in which case the
+  /// unused end of its original function region is given to other trampolines. Non-const methods
+  /// in this class are not thread-safe and require a form of external concurrency control if
+  /// accessed from multiple threads.
   class Trampoline
   {
   public:
@@ -65,22 +69,202 @@ namespace Hookshot
       size_t ptr[kSizeBytes / sizeof(size_t)];
     };
 
+    /// Raw code type for transferring control to a hook function. Used for the hook region of each
+    /// trampoline and also for hook stubs, which are held separately from trampolines.
+    using UHookCode = UTrampolineCode<kTrampolineSizeHookFunctionBytes>;
+
     /// Layout definition for the trampoline code regions.
     struct STrampolineCode
     {
       /// Holds the trampoline code for transferring control to the hook function when the original
       /// function is invoked.
-      UTrampolineCode<kTrampolineSizeHookFunctionBytes> hook;
+      UHookCode hook;
 
       /// Holds the code transplanted from the original function and used to invoke original
       /// functionality.
       UTrampolineCode<kTrampolineSizeOriginalFunctionBytes> original;
     };
 
+    /// Range of return addresses checked by a caller filter stub. Tables of these are sorted by
+    /// beginning address, do not overlap, and are terminated by a sentinel whose beginning and end
+    /// are both the highest possible address.
+    struct SCallerAddressRange
+    {
+      /// Lowest address in the range.
+      size_t begin;
+
+      /// One past the highest address in the range.
+      size_t end;
+    };
+
+    /// Maximum number of shards into which the invocation counter of an instrumentation stub is
+    /// divided. Processor numbers within a processor group are always smaller than this.
+    static constexpr size_t kMaxInstrumentationCounterShards = 64;
+
+    /// One shard of the invocation counter of an instrumentation stub. Each processor increments
+    /// the shard selected by its processor number, and each shard occupies its own cache line, so
+    /// that processors invoking the same hook at the same time do not contend with each other.
+    struct alignas(64) SInstrumentationCounterShard
+    {
+      /// Number of invocations counted by this shard.
+      uint64_t count;
+    };
+
+    /// Maximum number of original function bytes that can be examined while decoding it. At most
+    /// one instruction can begin within the space needed for a jump instruction and still extend
+    /// beyond it.
+    static constexpr int kMaxOriginalFunctionBytesExamined =
+        (X86Instruction::kJumpInstructionLengthBytes - 1) +
+        X86Instruction::kMaxInstructionLengthBytes;
+
+    /// Position-independent description of a single instruction decoded from the beginning of an
+    /// original function. Enough to transplant the instruction by copying its bytes and adjusting
+    /// its displacement, without decoding or re-encoding it. Stored as-is in the hook plan cache.
+    using SHookPlanInstruction = X86Instruction::SInstructionLayout;
+
+    /// Instructions decoded from the beginning of an original function, ready to be transplanted
+    /// into a trampoline. Decoding does not involve any particular trampoline, so it can be done
+    /// ahead of time without any external concurrency control. Only re-encoding the instructions,
+    /// which depends on where they go, is left for when a trampoline is available.
+    struct SDecodedOriginalFunction
+    {
+      /// Original function address.
+      const void* originalFunc;
+
+      /// Whether or not the original function is laid out for hot-patching, in which case no
+      /// instructions are decoded because none need to be transplanted.
+      bool isHotPatchable;
+
+      /// Whether or not the original function is a system call stub, in which case no
+      /// instructions are decoded because a complete copy of the stub is generated instead of
+      /// transplanting any of them.
+      bool isSyscallStub;
+
+      /// Description of the system call stub. Valid only if #isSyscallStub is set.
+      X86Instruction::SSyscallStub syscallStub;
+
+      /// Number of valid elements in #instructions.
+      int numInstructions;
+
+      /// Number of original function bytes occupied by the decoded instructions.
+      int numDecodedBytes;
+
+      /// Number of valid elements in #examinedBytes.
+      int numExaminedBytes;
+
+      /// Copy of every original function byte that was examined while decoding, including any
+      /// padding, for detecting whether the original function has changed since it was decoded.
+      uint8_t examinedBytes[kMaxOriginalFunctionBytesExamined];
+
+      /// Whether or not #planInstructions describes all of the decoded instructions.
+      bool hasHookPlan;
+
+      /// Whether or not the instructions were described without being decoded, either by the hook
+      /// plan cache or because they form a common prologue. If so, #instructions is not filled and
+      /// only #planInstructions is valid.
+      bool isFromHookPlan;
+
+      /// Decoded instructions. Every instruction is at least one byte long, so no more of them can
+      /// be decoded than the number of bytes needed for a jump instruction.
+      X86Instruction instructions[X86Instruction::kJumpInstructionLengthBytes];
+
+      /// Position-independent descriptions of the decoded instructions. Valid only if
+      /// #hasHookPlan is set.
+      SHookPlanInstruction planInstructions[X86Instruction::kJumpInstructionLengthBytes];
+    };
+
+#ifdef _WIN64
+    /// Maximum number of unwind code slots in the unwind information for the original function
+    /// region of a trampoline. Chosen so that the unwind information is exactly the size of a hook
+    /// stub, which is enough to describe the handful of prologue instructions that are typically
+    /// transplanted.
+    static constexpr int kMaxUnwindCodeSlots = 6;
+
+    /// Unwind information for the original function region of a trampoline. Laid out exactly as
+    /// the `UNWIND_INFO` structure used by the operating system for exception dispatch and stack
+    /// walking on x64, without any exception handler.
+    struct SUnwindInfo
+    {
+      /// Version number in the low 3 bits and flags in the high 5 bits.
+      uint8_t versionAndFlags;
+
+      /// Size of the prologue, in bytes.
+      uint8_t sizeOfPrologBytes;
+
+      /// Number of valid elements in #unwindCode.
+      uint8_t countOfCodes;
+
+      /// Frame register in the low 4 bits and scaled frame register offset in the high 4 bits.
+      uint8_t frameRegisterAndOffset;
+
+      /// Unwind codes, sorted by decreasing prologue offset.
+      uint16_t unwindCode[kMaxUnwindCodeSlots];
+    };
+
+    static_assert(sizeof(SUnwindInfo) == sizeof(UHookCode));
+#endif
+
     Trampoline(void);
 
     Trampoline(const Trampoline&) = delete;
 
+#ifdef _WIN64
+    /// Builds unwind information for the original function region of this trampoline from the
+    /// unwind information of the original function, as found in its module's function table.
+    /// Only the unwind codes for prologue instructions that were transplanted are kept, and their
+    /// offsets are adjusted to refer to the transplanted instructions. Valid only after the
+    /// original function is set but before any of its bytes are overwritten.
+    /// @param [in] originalFunc Original function address, as previously passed to
+    /// #SetOriginalFunction.
+    /// @param [in] sizeBytesUsed Number of bytes used by this trampoline, as filled by
+    /// #SetOriginalFunction.
+    /// @param [out] unwindInfo Filled with the unwind information, if the operation succeeds.
+    /// @return `true` if successful, `false` if no unwind information is needed or if the
+    /// original function's unwind information cannot be adapted.
+    bool BuildOriginalFunctionUnwindInfo(
+        const void* originalFunc, size_t sizeBytesUsed, SUnwindInfo* unwindInfo) const;
+#endif
+
+    /// Examines already-decoded original function instructions to determine how many of them would
+    /// need their position-dependent displacements adjusted when transplanted into a trampoline,
+    /// and how many of those are relative branches whose displacements are too narrow to reach
+    /// their targets from any trampoline and would therefore need jump assists. Trampolines are
+    /// assumed to be placed within reach of 32-bit displacements, as they normally are. Nothing
+    /// is written anywhere.
+    /// @param [in] decoded Original function instructions, as filled by #DecodeOriginalFunction.
+    /// @param [out] numRelocations Filled with the number of instructions needing adjustment.
+    /// @param [out] numJumpAssists Filled with the number of jump assists expected to be needed.
+    static void CountOriginalFunctionRelocations(
+        const SDecodedOriginalFunction& decoded, int* numRelocations, int* numJumpAssists);
+
+    /// Decodes enough instructions from the beginning of the specified original function to make
+    /// space for a jump instruction, as the first step of transplanting them into a trampoline.
+    /// If the original function is a system call stub, if the hook plan cache already describes
+    /// the same original function, or if the original function begins with instructions commonly
+    /// found in prologues, then no instructions are actually decoded.
+    /// @param [in] originalFunc Original function address.
+    /// @param [out] decoded Filled with the decoded instructions. The number of bytes decoded is
+    /// filled even on failure.
+    /// @return `true` if successful, `false` otherwise.
+    static bool DecodeOriginalFunction(const void* originalFunc, SDecodedOriginalFunction* decoded);
+
+    /// Determines whether or not the original function bytes examined while decoding are still the
+    /// same, in which case the decoded instructions can still be transplanted.
+    /// @param [in] decoded Previously-decoded original function.
+    /// @return `true` if so, `false` if not.
+    static bool IsDecodedOriginalFunctionCurrent(const SDecodedOriginalFunction& decoded);
+
+    /// Retrieves and returns the address to which this trampoline transfers control when the
+    /// caller is accepted, if it is a caller filter stub. Valid only if this object was set using
+    /// #SetCallerFilterStub, otherwise may return a garbage value.
+    /// @return Address of the hook function that this caller filter stub targets.
+    const void* GetCallerFilterStubHookTarget(void) const;
+
+    /// Retrieves and returns the address to which the original function portion of this trampoline
+    /// jumps, if it was set using #SetChainTarget. Otherwise may return a garbage value.
+    /// @return Address of the next function in the hook chain.
+    const void* GetChainTarget(void) const;
+
     /// Retrieves and returns the address that, when invoked, uses this trampoline to access the
     /// hook fuction. Valid only if this object is already set, otherwise may return a garbage
     /// value.
@@ -90,15 +274,74 @@ namespace Hookshot
       return (void*)&code.hook;
     }
 
+    /// Retrieves and returns the address to which the specified hook code transfers control.
+    /// Valid only if the hook code was set using #SetHookCodeTarget, otherwise may return a garbage
+    /// value.
+    /// @param [in] hookCode Hook code to examine.
+    /// @return Address of the hook function that the hook code targets.
+    static inline const void* GetHookCodeTarget(const UHookCode& hookCode)
+    {
+#ifdef _WIN64
+      // No transformation required in 64-bit mode because the address is an absolute jump target.
+      return reinterpret_cast<void*>(hookCode.ptr[_countof(hookCode.ptr) - 1]);
+#else
+      // Computation is required in 32-bit mode because the value is a rel32 jump displacement.
+      // Formula rel32:
+      // * <absolute target address> = <instruction address after jmp> + <displacement>
+      // Known values:
+      // * <instruction address after jmp> = byte address directly after the hook code
+      // * <displacement> = stored value
+      return reinterpret_cast<void*>(
+          reinterpret_cast<size_t>(&hookCode.ptr[_countof(hookCode.ptr)]) +
+          hookCode.ptr[_countof(hookCode.ptr) - 1]);
+#endif
+    }
+
     /// Retrieves and returns the address that this trampoline targets for its hook function.
     /// This is the address originally supplied to #SetHookFunction.
     /// Valid only if this object is already set, otherwise may return a garbage value.
     /// @return Address of the hook function that this trampoline targets.
     const void* GetHookTrampolineTarget(void) const
     {
-      return HookAddressForValue();
+      return GetHookCodeTarget(code.hook);
     }
 
+    /// Determines the number of shards into which the invocation counter of every instrumentation
+    /// stub is divided. This is the number of processors rounded up to a power of two, up to
+    /// #kMaxInstrumentationCounterShards.
+    /// @return Number of invocation counter shards per instrumentation stub.
+    static size_t GetNumInstrumentationCounterShards(void);
+
+    /// Retrieves and returns the number of times this trampoline has been invoked, if it is an
+    /// instrumentation stub, by summing all of its invocation counter shards. Valid only if this
+    /// object was set using #SetInstrumentationStub, otherwise may return a garbage value.
+    /// @return Number of times the instrumentation stub has been invoked.
+    uint64_t GetInstrumentationStubCallCount(void) const;
+
+    /// Retrieves and returns the address to which this trampoline transfers control, if it is an
+    /// instrumentation stub. Valid only if this object was set using #SetInstrumentationStub,
+    /// otherwise may return a garbage value.
+    /// @return Address of the hook function that this instrumentation stub targets.
+    const void* GetInstrumentationStubTarget(void) const;
+
+    /// Retrieves and returns the address to which this trampoline transfers control when reentry is
+    /// allowed, if it is a reentrancy guard stub. Valid only if this object was set using
+    /// #SetReentrancyGuardStub, otherwise may return a garbage value.
+    /// @return Address of the hook function that this reentrancy guard stub targets.
+    const void* GetReentrancyGuardStubHookTarget(void) const;
+
+    /// Retrieves and returns the address to which this trampoline transfers control, if it is a
+    /// sampled timing stub. Valid only if this object was set using #SetSampledTimingStub,
+    /// otherwise may return a garbage value.
+    /// @return Address of the hook function that this sampled timing stub targets.
+    const void* GetSampledTimingStubTarget(void) const;
+
+    /// Retrieves and returns the address to which this trampoline transfers control when the
+    /// calling thread has no override, if it is a thread override stub. Valid only if this object
+    /// was set using #SetThreadOverrideStub, otherwise may return a garbage value.
+    /// @return Address of the hook function that this thread override stub targets.
+    const void* GetThreadOverrideStubHookTarget(void) const;
+
     /// Retrieves and returns the address that, when invoked, uses the contents of this trampoline
     /// to access the functionality of the original function. Valid only if this object is already
     /// set, otherwise may return a garbage value.
@@ -113,16 +356,267 @@ namespace Hookshot
     /// Clears out any previously-set hook and original functions.
     void Reset(void);
 
-    /// Sets the hook function to which this trampoline will redirect.
+    /// Turns this trampoline into a caller filter stub, which looks up the return address on the
+    /// top of the stack in a table of caller address ranges and then transfers control to the hook
+    /// function if any of them contains it or to the bypass function otherwise. Like an
+    /// instrumentation stub, a caller filter stub has no original function portion and does not
+    /// otherwise affect the call, and the address returned by #GetHookFunction is set as the hook
+    /// function of another trampoline.
+    /// @param [in] ranges Table of caller address ranges, which must remain valid for as long as
+    /// this stub might be executed.
+    /// @param [in] hookFunc Hook function address.
+    /// @param [in] bypassFunc Address to which control is transferred for all other callers, which
+    /// is usually the original function region of the filtered trampoline.
+    void SetCallerFilterStub(
+        const SCallerAddressRange* ranges, const void* hookFunc, const void* bypassFunc);
+
+    /// Changes the table of caller address ranges, if this trampoline is a caller filter stub. The
+    /// change happens atomically with respect to any threads executing it, but threads might still
+    /// be looking up addresses in the previous table for some time afterwards.
+    /// @param [in] ranges Table of caller address ranges.
+    void SetCallerFilterStubRanges(const SCallerAddressRange* ranges);
+
+    /// Changes the addresses to which this trampoline transfers control, if it is a caller filter
+    /// stub. Each address is changed atomically with respect to any threads executing it.
+    /// @param [in] hookFunc Hook function address.
+    /// @param [in] bypassFunc Address to which control is transferred for all other callers.
+    void SetCallerFilterStubTargets(const void* hookFunc, const void* bypassFunc);
+
+    /// Turns this trampoline into a call trace stub, which transfers control to the shared call
+    /// recording code so that the call is recorded and then transfers control to its target
+    /// without otherwise affecting the call. A call trace stub has no original function portion.
+    /// Instead, the address returned by #GetHookFunction is used as the hook function of a hook.
+    /// The target is not set, so the stub must not be executed until #SetCallTraceStubTarget has
+    /// been invoked.
+    /// @param [in] recorder Address of the shared call recording code.
+    /// @param [in] traceId Value that identifies this stub in recorded calls.
+    void SetCallTraceStub(const void* recorder, const void* traceId);
+
+    /// Changes the address to which this trampoline transfers control after the call is recorded,
+    /// if it is a call trace stub. The change happens atomically with respect to any threads
+    /// executing it.
+    /// @param [in] targetFunc Target address, which is usually the original function region of
+    /// the trampoline whose hook function is this stub.
+    void SetCallTraceStubTarget(const void* targetFunc);
+
+    /// Turns this trampoline into a probe stub, which transfers control to the shared probe code
+    /// so that a probe callback is invoked and then transfers control to its resume address. A
+    /// probe stub has no original function portion. Instead, the address returned by
+    /// #GetHookFunction is used as the hook function of a hook placed at the probe address. The
+    /// resume address is not set, so the stub must not be executed until
+    /// #SetCallTraceStubTarget has been invoked, exactly as for a call trace stub.
+    /// @param [in] dispatcher Address of the shared probe code.
+    /// @param [in] callback Address of the probe callback.
+    /// @param [in] context Context value to pass to the probe callback.
+    /// @param [in] address Address of the instruction at which the probe is placed.
+    void SetProbeStub(
+        const void* dispatcher, const void* callback, const void* context, const void* address);
+
+    /// Turns this trampoline into a context stub, which stores a context value into a per-thread
+    /// slot and then transfers control to a hook function without otherwise affecting the call. A
+    /// context stub has no original function portion. Instead, the address returned by
+    /// #GetHookFunction is used as the hook function of a hook.
+    /// @param [in] slotOffset Offset of the per-thread slot within the thread environment block.
+    /// @param [in] context Context value to store.
+    /// @param [in] hookFunc Hook function address.
+    void SetContextStub(size_t slotOffset, const void* context, const void* hookFunc);
+
+    /// Sets the original function portion of this trampoline to an unconditional jump to the
+    /// specified address instead of code transplanted from an original function. Used for hooks
+    /// chained onto an already-hooked function, for which the "original" functionality is the next
+    /// hook function in the chain. Can be invoked again to change the jump target, which happens
+    /// atomically with respect to any threads executing the trampoline.
+    /// @param [in] nextFunc Address of the next function in the hook chain.
+    void SetChainTarget(const void* nextFunc);
+
+    /// Writes hook code that transfers control to the specified hook function. This is the same
+    /// code that #SetHookFunction writes to the hook region of a trampoline, and it can likewise be
+    /// invoked again to change the hook function atomically with respect to any threads executing
+    /// it.
+    /// @param [out] hookCode Hook code to be written.
+    /// @param [in] hookFunc Hook function address.
+    static void SetHookCodeTarget(UHookCode* hookCode, const void* hookFunc);
+
+    /// Sets the hook function to which this trampoline will redirect. On 64-bit builds a direct
+    /// relative jump is used whenever the hook function is close enough to the trampoline, and an
+    /// indirect jump through an absolute address is used otherwise. Can be invoked again to change
+    /// the hook function, which happens atomically with respect to any threads executing it.
     /// @param [in] hookFunc Hook function address.
     void SetHookFunction(const void* hookFunc);
 
+    /// Turns this trampoline into an instrumentation stub, which counts the number of times it is
+    /// invoked and then transfers control to the specified hook function without otherwise
+    /// affecting the call. Instrumentation stubs have no original function portion. Instead, the
+    /// address returned by #GetHookFunction is set as the hook function of another trampoline.
+    /// @param [in] hookFunc Hook function address.
+    /// @param [in] counterShards Zero-initialized invocation counter shards, of which there must
+    /// be as many as #GetNumInstrumentationCounterShards indicates. Must remain valid for as long
+    /// as any thread could be executing this instrumentation stub.
+    void SetInstrumentationStub(const void* hookFunc, SInstrumentationCounterShard* counterShards);
+
+    /// Changes the hook function to which this trampoline transfers control, if it is an
+    /// instrumentation stub, without resetting its invocation count.
+    /// @param [in] hookFunc Hook function address.
+    void SetInstrumentationStubTarget(const void* hookFunc);
+
     /// Sets the original function portion of this trampoline so that invoking it will have the
     /// effect of invoking the original function. Transplants code as needed at the specified
     /// address so that there is enough space created there to write a jump instruction.
     /// @param [in] originalFunc Original function address.
+    /// @param [out] sizeBytesUsed Optionally filled with the number of bytes, starting from the
+    /// beginning of this trampoline and including the hook region, that are needed to hold all of
+    /// the code written to this trampoline. Filled only on success.
+    /// @return `true` if successful, `false` otherwise.
+    bool SetOriginalFunction(const void* originalFunc, size_t* sizeBytesUsed = nullptr);
+
+    /// Sets the original function portion of this trampoline using instructions that were already
+    /// decoded. Otherwise identical to the other form of this method.
+    /// @param [in] decoded Original function instructions, as filled by #DecodeOriginalFunction.
+    /// @param [out] sizeBytesUsed Optionally filled with the number of bytes, starting from the
+    /// beginning of this trampoline and including the hook region, that are needed to hold all of
+    /// the code written to this trampoline. Filled only on success.
+    /// @return `true` if successful, `false` otherwise.
+    bool SetOriginalFunction(
+        const SDecodedOriginalFunction& decoded, size_t* sizeBytesUsed = nullptr);
+
+#ifdef _WIN64
+    /// Sets the original function portion of this trampoline for an original function that is to
+    /// be redirected using an absolute jump, which is needed if this trampoline is too far away
+    /// for a relative jump to reach it. Enough instructions are copied to make space for the
+    /// absolute jump, and none of them may contain a position-dependent memory reference, since
+    /// this trampoline is generally too far away for any such reference to be adjusted. Only
+    /// available in 64-bit mode.
+    /// @param [in] originalFunc Original function address.
+    /// @param [out] sizeBytesUsed Optionally filled with the number of bytes, starting from the
+    /// beginning of this trampoline and including the hook region, that are needed to hold all of
+    /// the code written to this trampoline. Filled only on success.
+    /// @param [in] minLengthBytes Number of bytes of the original function that must be copied,
+    /// which is smaller than the length of an absolute jump if the original function is instead
+    /// redirected using a relative jump to a code cave that holds the absolute jump.
     /// @return `true` if successful, `false` otherwise.
-    bool SetOriginalFunction(const void* originalFunc);
+    bool SetOriginalFunctionFar(
+        const void* originalFunc,
+        size_t* sizeBytesUsed = nullptr,
+        int minLengthBytes = X86Instruction::kAbsoluteJumpInstructionLengthBytes);
+#endif
+
+    /// Turns this trampoline into a reentrancy guard stub, which reads a pointer-sized per-thread
+    /// depth value at a fixed offset from the beginning of the thread environment block and then
+    /// transfers control to the hook function if it is zero or to the bypass function otherwise.
+    /// Like an instrumentation stub, a reentrancy guard stub has no original function portion and
+    /// does not otherwise affect the call, and the address returned by #GetHookFunction is set as
+    /// the hook function of another trampoline.
+    /// @param [in] depthOffset Offset of the per-thread depth value within the thread environment
+    /// block, in bytes.
+    /// @param [in] hookFunc Hook function address.
+    /// @param [in] bypassFunc Address to which control is transferred while the depth is non-zero,
+    /// which is usually the original function region of the guarded trampoline.
+    void SetReentrancyGuardStub(size_t depthOffset, const void* hookFunc, const void* bypassFunc);
+
+    /// Changes the addresses to which this trampoline transfers control, if it is a reentrancy
+    /// guard stub. Each address is changed atomically with respect to any threads executing it.
+    /// @param [in] hookFunc Hook function address.
+    /// @param [in] bypassFunc Address to which control is transferred while the depth is non-zero.
+    void SetReentrancyGuardStubTargets(const void* hookFunc, const void* bypassFunc);
+
+    /// Turns this trampoline into a sampled timing stub, which counts down the calls that pass
+    /// through it and transfers control to the shared sampling code once every so many calls, so
+    /// that the call is timed. All other calls are transferred directly to the hook function. Like
+    /// an instrumentation stub, a sampled timing stub has no original function portion and does
+    /// not otherwise affect the call, and the address returned by #GetHookFunction is set as the
+    /// hook function of another trampoline.
+    /// @param [in] sampler Address of the shared sampling code.
+    /// @param [in] sampleInterval Number of calls per sample, which must be positive and
+    /// representable as a signed 32-bit value.
+    /// @param [in] sampleBlock Sample block into which the sampling code records timed calls,
+    /// which must remain valid for as long as this stub might be executed.
+    /// @param [in] hookFunc Hook function address.
+    void SetSampledTimingStub(
+        const void* sampler, uint32_t sampleInterval, void* sampleBlock, const void* hookFunc);
+
+    /// Changes the hook function to which this trampoline transfers control, if it is a sampled
+    /// timing stub. The change happens atomically with respect to any threads executing it.
+    /// @param [in] hookFunc Hook function address.
+    void SetSampledTimingStubTarget(const void* hookFunc);
+
+    /// Changes the number of calls per timed call, if this trampoline is a sampled timing stub.
+    /// Takes effect the next time the countdown runs out, without affecting the call being timed.
+    /// @param [in] sampleInterval Number of calls per timed call. Must be non-zero.
+    void SetSampledTimingStubInterval(uint32_t sampleInterval);
+
+    /// Turns this trampoline into a thread override stub, which reads a pointer-sized per-thread
+    /// table pointer at a fixed offset from the beginning of the thread environment block and, if
+    /// the table exists and its entry at the specified index is non-null, transfers control to the
+    /// address held in that entry. Otherwise it transfers control to the hook function. Like an
+    /// instrumentation stub, a thread override stub has no original function portion and does not
+    /// otherwise affect the call, and the address returned by #GetHookFunction is set as the hook
+    /// function of another trampoline.
+    /// @param [in] tableOffset Offset of the per-thread table pointer within the thread environment
+    /// block, in bytes.
+    /// @param [in] overrideIndex Index of the entry within each per-thread table that this stub
+    /// consults.
+    /// @param [in] hookFunc Hook function address.
+    void SetThreadOverrideStub(size_t tableOffset, size_t overrideIndex, const void* hookFunc);
+
+    /// Changes the hook function to which this trampoline transfers control when the calling thread
+    /// has no override, if it is a thread override stub. The change happens atomically with respect
+    /// to any threads executing it.
+    /// @param [in] hookFunc Hook function address.
+    void SetThreadOverrideStubTarget(const void* hookFunc);
+
+    /// Turns this trampoline into a one-shot stub, which atomically sets a flag and transfers
+    /// control to the hook function only if the flag was previously clear. Every other call is
+    /// transferred to the bypass function, which must be set using #SetOneShotStubBypass before the
+    /// stub is executed. Like an instrumentation stub, a one-shot stub has no original function
+    /// portion, and the address returned by #GetHookFunction is set as the hook function of another
+    /// trampoline.
+    /// @param [in] firedFlag Address of the flag, which must be initially zero and must remain
+    /// valid for as long as the stub can be executed.
+    /// @param [in] hookFunc Hook function address.
+    void SetOneShotStub(volatile long* firedFlag, const void* hookFunc);
+
+    /// Changes the address to which this trampoline transfers control once the flag has been set,
+    /// if it is a one-shot stub. The change happens atomically with respect to any threads
+    /// executing it.
+    /// @param [in] bypassFunc Bypass function address, normally the entry point of the trampoline
+    /// that invokes the original function.
+    void SetOneShotStubBypass(const void* bypassFunc);
+
+    /// Turns this trampoline into a sampled hook stub, which transfers control to the hook function
+    /// on only one out of every so many calls and to the bypass function on all other calls. The
+    /// bypass function must be set using #SetSampledHookStubBypass before the stub is executed.
+    /// Like an instrumentation stub, a sampled hook stub has no original function portion, and the
+    /// address returned by #GetHookFunction is set as the hook function of another trampoline.
+    /// @param [in] sampleInterval Number of calls per call that reaches the hook function. Must be
+    /// non-zero and no greater than the largest signed 32-bit value.
+    /// @param [in] hookFunc Hook function address.
+    void SetSampledHookStub(uint32_t sampleInterval, const void* hookFunc);
+
+    /// Changes the address to which this trampoline transfers control for calls that are not
+    /// sampled, if it is a sampled hook stub. The change happens atomically with respect to any
+    /// threads executing it.
+    /// @param [in] bypassFunc Bypass function address, normally the entry point of the trampoline
+    /// that invokes the original function.
+    void SetSampledHookStubBypass(const void* bypassFunc);
+
+    /// Changes the number of calls per call that reaches the hook function, if this trampoline is a
+    /// sampled hook stub. Threads executing it concurrently might observe the old interval for the
+    /// remainder of the current sample.
+    /// @param [in] sampleInterval Number of calls per call that reaches the hook function. Must be
+    /// non-zero and no greater than the largest signed 32-bit value.
+    void SetSampledHookStubInterval(uint32_t sampleInterval);
+
+    /// Translates an instruction boundary within the transplanted part of the original function
+    /// into the equivalent address within the original function region of this trampoline. Used to
+    /// relocate threads that are stopped in the middle of code about to be overwritten by a hook.
+    /// Valid only after the original function is set but before any of its bytes are overwritten.
+    /// @param [in] originalFunc Original function address, as previously passed to
+    /// #SetOriginalFunction.
+    /// @param [in] address Address within the original function to translate.
+    /// @return Equivalent address within this trampoline, or `nullptr` if the specified address is
+    /// not an instruction boundary within the transplanted part of the original function.
+    const void* TranslateOriginalFunctionAddress(
+        const void* originalFunc, const void* address) const;
 
   private:
 
@@ -145,42 +639,47 @@ namespace Hookshot
           reinterpret_cast<size_t>(addressAfterJmpInstruction);
     }
 
-    /// Computes the address of the hook function, given the value stored in this trampoline.
-    /// @return Address of the hook function.
-    inline const void* HookAddressForValue(void) const
-    {
-#ifdef _WIN64
-      // No transformation required in 64-bit mode because the address is an absolute jump target.
-      return reinterpret_cast<void*>(code.hook.ptr[_countof(code.hook.ptr) - 1]);
-#else
-      // Computation is required in 32-bit mode because the value is a rel32 jump displacement.
-      // Formula rel32:
-      // * <absolute target address> = <instruction address after jmp> + <displacement>
-      // Known values:
-      // * <instruction address after jmp> = byte address directly after code.hook
-      // * <displacement> = stored value
-      return reinterpret_cast<void*>(
-          reinterpret_cast<size_t>(&code.hook.ptr[_countof(code.hook.ptr)]) +
-          code.hook.ptr[_countof(code.hook.ptr) - 1]);
-#endif
-    }
+    /// Transplants code from the original function into this trampoline by copying the original
+    /// instruction bytes and adjusting their displacements, as described by a hook plan. Fails if
+    /// any instruction would need to be re-encoded, in which case it must be transplanted the usual
+    /// way instead.
+    /// @param [in] decoded Original function instructions, including a valid hook plan.
+    /// @param [out] usedJumpAssist Set to `true` if any jump assists were needed.
+    /// @param [out] numTrampolineBytesUsed Filled with the number of bytes at the beginning of the
+    /// original function region that hold code, including any jump assists.
+    /// @return `true` if successful, `false` otherwise.
+    bool ApplyHookPlan(
+        const SDecodedOriginalFunction& decoded, bool* usedJumpAssist, int* numTrampolineBytesUsed);
 
-    /// Computes the value to be inserted into the trampoline's hook address field.
-    /// Depending on the architecture, the address may require transformation before insertion into
-    /// the trampoline.
-    /// @param [in] hook Address of the hook function.
-    /// @return Transformed value of the hook function address, to be inserted into the trampoline.
-    inline size_t ValueForHookAddress(const void* hook) const
-    {
-#ifdef _WIN64
-      // No transformation required in 64-bit mode because the value is an absolute jump target
-      // address.
-      return reinterpret_cast<size_t>(hook);
-#else
-      // Computation is required in 32-bit mode because the value is a rel32 jump displacement.
-      return ComputeJumpDisplacement(&code.hook.ptr[_countof(code.hook.ptr)], hook);
-#endif
-    }
+    /// Describes the instructions at the beginning of the specified original function without
+    /// decoding them, which is only possible if all of them are instructions commonly found in
+    /// function prologues. On success, the result is a hook plan that transplants them by copying
+    /// and patching any position-dependent displacements.
+    /// @param [in] originalFunc Original function address.
+    /// @param [out] decoded Filled with the hook plan, if the operation succeeds.
+    /// @return `true` if successful, `false` if any instruction was not recognized.
+    static bool DecodeOriginalFunctionCommonPrologue(
+        const void* originalFunc, SDecodedOriginalFunction* decoded);
+
+    /// Decodes instructions from the beginning of the specified original function without
+    /// consulting the hook plan cache. Otherwise identical to #DecodeOriginalFunction.
+    /// @param [in] originalFunc Original function address.
+    /// @param [out] decoded Filled with the decoded instructions.
+    /// @return `true` if successful, `false` otherwise.
+    static bool DecodeOriginalFunctionInstructions(
+        const void* originalFunc, SDecodedOriginalFunction* decoded);
+
+    /// Implements #SetOriginalFunction by transplanting already-decoded code from the original
+    /// function into this trampoline, additionally reporting some details about the transplant for
+    /// the hook journal.
+    /// @param [in] decoded Original function instructions, as filled by #DecodeOriginalFunction.
+    /// @param [out] usedJumpAssist Set to `true` if any jump assists were needed.
+    /// @param [out] numTrampolineBytesUsed Filled with the number of bytes at the beginning of the
+    /// original function region that hold code, including any jump assists, which are written at
+    /// the end of the region.
+    /// @return `true` if successful, `false` otherwise.
+    bool TransplantOriginalFunction(
+        const SDecodedOriginalFunction& decoded, bool* usedJumpAssist, int* numTrampolineBytesUsed);
 
     /// Holds the trampoline code itself.
     STrampolineCode code;
@@ -13,25 +13,85 @@
 
 #include <cstddef>
 #include <cstdint>
+#include <map>
+#include <memory>
+#include <unordered_map>
+#include <vector>
 
+#include "ApiWindows.h"
 #include "Trampoline.h"
 
 namespace Hookshot
 {
-  /// Manages trampoline object allocation and construction. On creation, allocates buffer space for
+  /// Manages trampoline object allocation and construction. On creation, reserves buffer space for
   /// trampoline objects that, once filled with at least one trampoline, cannot be destroyed. This
   /// is because trampoline objects cannot be destroyed or reset once created and set, and the
-  /// buffer space that stores them must live as long as they do. Methods are not concurrency-safe
-  /// and require some external form of concurrency control.
+  /// buffer space that stores them must live as long as they do. The reservation covers a full
+  /// unit of virtual memory allocation granularity, and individual pages within it are committed
+  /// only as trampolines are allocated. Trampolines are placed one after another on 16-byte
+  /// boundaries, and each one is allocated at full size but can then be compacted down to the size
+  /// of the code it actually holds, which typically lets each page hold about twice as many of
+  /// them. No trampoline ever straddles a page boundary. Hook stubs, which hold just the code that
+  /// transfers control to a hook function, can also be allocated. They are placed one after another
+  /// starting from the end of the reservation, so they never share a page with any trampoline.
+  /// Memory given back by compacted or deallocated trampolines is kept as a set of coalesced free
+  /// ranges, from which new trampolines are allocated before the used part of the buffer grows, and
+  /// deallocated hook stubs are kept on a free list for reuse. On 64-bit builds, hook stubs and
+  /// trampolines whose original function is set are described by a single function table per
+  /// buffer, registered with the operating system so that stack walks through them do not need to
+  /// fall back to heuristics. Unwind information that the function table refers to is held in the
+  /// same space as hook stubs. If so
+  /// configured, committed pages are write-protected except during a write window, which spans a
+  /// batch of trampoline modifications and ends when a #WriteWindow object is destroyed. In
+  /// processes protected by Control Flow Guard, committed pages start out with no valid indirect
+  /// call targets, and the entry points of trampolines and hook stubs are registered as valid call
+  /// targets in one batch per buffer before anything can reach them.
+  /// Methods are not concurrency-safe and require some external form of concurrency control.
   class TrampolineStore
   {
   public:
 
+    /// Scoped write window. Trampoline memory made writable while an object of this type exists is
+    /// write-protected again when it is destroyed, which means each page changes protection at
+    /// most twice no matter how many of its trampolines are modified. Instruction cache flushes
+    /// requested in the meantime are likewise coalesced and deferred until it is destroyed. Write
+    /// windows can be nested, in which case only the outermost one has any effect.
+    class WriteWindow
+    {
+    public:
+
+      WriteWindow(void);
+
+      WriteWindow(const WriteWindow&) = delete;
+
+      ~WriteWindow(void);
+    };
+
+    /// Information about the hook implemented by the trampoline object at a particular slot, which
+    /// is any location in the buffer aligned to #kTrampolineStoreAlignmentBytes. Kept outside of
+    /// the buffer itself so that it is never executable or write-protected.
+    struct SSlotMetadata
+    {
+      /// Original function of the registered hook that the trampoline object implements, or
+      /// `nullptr` if it does not implement a registered hook.
+      const void* originalFunc;
+
+      /// Distinguishes the registered hook from all of the others that have ever been implemented
+      /// by a trampoline object in the same slot, so that stale hook handles are not accepted.
+      uint32_t hookGeneration;
+    };
+
     /// Amount of memory reserved for holding trampoline objects per instance of this object.
+    /// Equal to the virtual memory allocation granularity, which is the smallest amount of address
+    /// space that can be reserved at once, so that no part of the reservation is wasted.
     static const int kTrampolineStoreSizeBytes;
 
-    /// Maximum number of trampoline objects that can be held in this object.
-    static const int kTrampolineStoreCount;
+    /// Amount of memory committed at a time as trampoline objects are allocated.
+    static const int kTrampolineStoreCommitSizeBytes;
+
+    /// Alignment of every trampoline object held in this object, in bytes. Compacted trampoline
+    /// sizes are rounded up to a multiple of this value.
+    static constexpr int kTrampolineStoreAlignmentBytes = 16;
 
     TrampolineStore(void);
 
@@ -45,14 +105,12 @@ namespace Hookshot
 
     TrampolineStore(TrampolineStore&& other) noexcept;
 
-    inline Trampoline& operator[](const int index)
+    /// Retrieves the base address of the buffer that stores trampoline objects, which is always a
+    /// multiple of #kTrampolineStoreSizeBytes.
+    /// @return Base address of the buffer, or `nullptr` if this object is not initialized.
+    inline const void* BaseAddress(void) const
     {
-      return trampolines[index];
-    }
-
-    inline const Trampoline& operator[](const int index) const
-    {
-      return trampolines[index];
+      return trampolines;
     }
 
     /// Specifies if this object  is initialized properly.
@@ -62,32 +120,297 @@ namespace Hookshot
       return (nullptr != trampolines);
     }
 
-    /// Attempts to allocate and construct a new trampoline object.
-    /// @return Index of the newly-allocated trampoline object, or -1 in the event of a failure.
-    int Allocate(void);
+    /// Attempts to allocate and construct a new full-size trampoline object. Free ranges within the
+    /// used part of the buffer are reused first, and otherwise more memory is committed if needed.
+    /// @return Newly-allocated trampoline object, or `nullptr` in the event of a failure.
+    Trampoline* Allocate(void);
+
+    /// Attempts to allocate a new hook stub. Previously-deallocated hook stubs are reused first,
+    /// and otherwise more memory is committed if needed.
+    /// @return Newly-allocated hook stub, or `nullptr` in the event of a failure.
+    Trampoline::UHookCode* AllocateHookStub(void);
 
-    /// Deallocates the most recently-allocated trampoline object.
-    void Deallocate(void);
+    /// Gives back the unused memory at the end of a trampoline object, so that it can be used for
+    /// subsequent allocations. Can only be done once per trampoline object. Once compacted, the
+    /// trampoline object must never be modified beyond the specified size.
+    /// @param [in] trampoline Trampoline object to compact.
+    /// @param [in] sizeBytes Number of bytes at the beginning of the trampoline object that are in
+    /// use and must be kept.
+    void Compact(const Trampoline* trampoline, size_t sizeBytes);
+
+    /// Flushes the instruction cache for the specified modified trampoline memory. Within a write
+    /// window, the flush is deferred and merged with other nearby flushes, so that modifying many
+    /// trampolines results in very few flushes. Otherwise it happens immediately.
+    /// @param [in] address Start address of the modified memory.
+    /// @param [in] sizeBytes Number of bytes that were modified.
+    static void FlushInstructionCache(const void* address, size_t sizeBytes);
+
+    /// Immediately performs all instruction cache flushes deferred by the current write window.
+    /// Must be invoked before anything outside of trampoline memory is modified to transfer control
+    /// into trampoline memory that was modified during the current write window. Does not allocate
+    /// memory, so it is safe to invoke while other threads are suspended.
+    static void FlushDeferredInstructionCache(void);
+
+    /// Determines whether or not trampoline memory is write-protected outside of write windows.
+    /// @return `true` if so, `false` otherwise.
+    static bool IsWriteProtectionEnabled(void);
 
-    /// Retrieves the number of trampoline objects in this data structure.
-    /// @return Number of trampolines allocated.
+    /// Determines whether or not trampoline memory is faulted in and locked into the working set as
+    /// soon as it is committed.
+    /// @return `true` if so, `false` otherwise.
+    static bool IsPageLockingEnabled(void);
+
+    /// Ensures that the memory holding the specified trampoline object or hook stub is writable
+    /// until the current write window ends. Trampoline objects returned by #Allocate and hook stubs
+    /// returned by #AllocateHookStub are already writable. Has no effect if write protection is
+    /// disabled.
+    /// @param [in] trampoline Trampoline object or hook stub that is about to be modified.
+    /// @return `true` on success, `false` on failure.
+    static bool MakeWritable(const void* trampoline);
+
+    /// Determines whether or not the specified trampoline object or hook stub is held in this data
+    /// structure.
+    /// @param [in] trampoline Trampoline object or hook stub to check.
+    /// @return `true` if so, `false` otherwise.
+    inline bool Contains(const void* trampoline) const
+    {
+      const uint8_t* const trampolineBytes = reinterpret_cast<const uint8_t*>(trampoline);
+      const uint8_t* const storeBytes = reinterpret_cast<const uint8_t*>(trampolines);
+      return (
+          (nullptr != trampolines) && (trampolineBytes >= storeBytes) &&
+          (trampolineBytes < &storeBytes[kTrampolineStoreSizeBytes]));
+    }
+
+    /// Retrieves the metadata for the slot at which the specified trampoline object is located,
+    /// using only address arithmetic. Metadata is reset whenever its trampoline object is
+    /// deallocated.
+    /// @param [in] trampoline Trampoline object, which must be held in this data structure.
+    /// @return Reference to the slot metadata.
+    inline SSlotMetadata& SlotMetadata(const Trampoline* trampoline) const
+    {
+      const size_t offset = static_cast<size_t>(
+          reinterpret_cast<const uint8_t*>(trampoline) -
+          reinterpret_cast<const uint8_t*>(trampolines));
+      return slotMetadata[offset / kTrampolineStoreAlignmentBytes];
+    }
+
+    /// Deallocates the specified trampoline object, which must have been allocated from this data
+    /// structure and must not be in use by any hook.
+    /// @param [in] trampoline Trampoline object to deallocate.
+    void Deallocate(const Trampoline* trampoline);
+
+    /// Deallocates the specified hook stub, which must have been allocated from this data
+    /// structure and must not be in use by any hook.
+    /// @param [in] hookStub Hook stub to deallocate.
+    void DeallocateHookStub(const Trampoline::UHookCode* hookStub);
+
+    /// Retrieves the number of trampoline objects, hook stubs, and unwind information records in
+    /// this data structure.
+    /// @return Number of trampolines, hook stubs, and unwind information records allocated.
     inline int Count(void) const
     {
       return count;
     }
 
-    /// Retrieves the number of free spaces for trampoline objects in this data structure.
-    /// @return Remaining number of trampoline objects that can be allocated.
-    inline int FreeCount(void) const
+    /// Retrieves the number of free spaces for full-size trampoline objects in this data
+    /// structure.
+    /// @return Remaining number of full-size trampoline objects that can be allocated.
+    int FreeCount(void) const;
+
+    /// Determines whether or not at least one more full-size trampoline object can be allocated
+    /// from this data structure. Stops looking as soon as it finds space for one, so it is much
+    /// cheaper than #FreeCount.
+    /// @return `true` if so, `false` otherwise.
+    bool HasFreeSpace(void) const;
+
+    /// Retrieves the number of trampoline objects that have been deallocated from any instance of
+    /// this data structure. Any change in this value means that some instance might have gained
+    /// free space.
+    /// @return Number of deallocations so far.
+    static uint64_t DeallocationCount(void);
+
+    /// Retrieves the base addresses of the buffers of all instances of this data structure that
+    /// have had entry points awaiting registration by #RegisterCallTargets since the previous
+    /// invocation, and then forgets them. A buffer whose entry points were registered in the
+    /// meantime can still be included, in which case registering them again has no effect.
+    /// @return Base addresses of buffers with pending call targets.
+    static std::vector<const void*> TakeBuffersWithPendingCallTargets(void);
+
+    /// Retrieves the number of bytes of memory committed by this data structure, whether for
+    /// trampoline objects or for hook stubs.
+    /// @return Number of committed bytes.
+    inline int CommittedBytes(void) const
     {
-      return (kTrampolineStoreCount - count);
+      return (numCommittedBytes + numHookStubCommittedBytes);
     }
 
+    /// Retrieves the number of committed bytes that once held trampoline objects or hook stubs but
+    /// were given back and have not yet been reused. Memory that has never been handed out is not
+    /// included.
+    /// @return Number of wasted bytes.
+    int WastedBytes(void) const;
+
+    /// Registers the entry points of all trampoline objects and hook stubs allocated since the
+    /// previous invocation as valid Control Flow Guard call targets, using a single system call.
+    /// Must be invoked before any of them can be reached by an indirect call. If registration
+    /// fails, every location on the affected pages is made a valid call target instead. Has no
+    /// effect if the process is not protected by Control Flow Guard.
+    /// @return `true` if the entry points were registered individually or there was nothing to
+    /// register, `false` otherwise.
+    bool RegisterCallTargets(void);
+
+#ifdef _WIN64
+    /// Adds the specified trampoline object to the function table, so that exception dispatch and
+    /// stack walks through it work correctly. If its transplanted code includes part of the
+    /// original function's prologue, then its original function region gets unwind information
+    /// adapted from that of the original function, and otherwise it is described as a leaf
+    /// function. Removed automatically when the trampoline object is deallocated.
+    /// @param [in] trampoline Trampoline object whose original function is already set.
+    /// @param [in] originalFunc Original function address.
+    /// @param [in] sizeBytes Number of bytes at the beginning of the trampoline object that are in
+    /// use, as filled by Trampoline::SetOriginalFunction.
+    /// @return `true` if the function table is registered, `false` otherwise.
+    bool RegisterUnwindInfo(
+        const Trampoline* trampoline, const void* originalFunc, size_t sizeBytes);
+#endif
+
   private:
 
-    /// Number of trampolines allocated.
+    /// Adds a range of memory within the used part of the buffer to the free ranges, coalescing it
+    /// with any adjacent free ranges. A free range that ends up at the very end of the used part of
+    /// the buffer is instead removed from the used part of the buffer altogether.
+    /// @param [in] offset Offset of the beginning of the range, in bytes.
+    /// @param [in] sizeBytes Size of the range, in bytes.
+    void AddFreeRange(int offset, int sizeBytes);
+
+#ifdef _WIN64
+    /// Adds or replaces an entry in the function table, without registering the change with the
+    /// operating system. Has no effect if the unwind information offset is invalid.
+    /// @param [in] beginOffset Offset of the beginning of the code, in bytes.
+    /// @param [in] endOffset Offset of the end of the code, in bytes.
+    /// @param [in] unwindInfoOffset Offset of the unwind information, in bytes, or -1 if none.
+    void AddFunctionEntry(int beginOffset, int endOffset, int unwindInfoOffset);
+#endif
+
+    /// Records the specified entry point as one that needs to be registered as a valid Control Flow
+    /// Guard call target by the next invocation of #RegisterCallTargets. Has no effect if the
+    /// process is not protected by Control Flow Guard.
+    /// @param [in] callTarget Entry point within the buffer.
+    void AddPendingCallTarget(const void* callTarget);
+
+    /// Allocates space for a hook stub, or for anything else the same size as one, without adding
+    /// it to the function table.
+    /// @return Newly-allocated space, or `nullptr` in the event of a failure.
+    Trampoline::UHookCode* AllocateHookStubSlot(void);
+
+    /// Determines the offset at which a full-size trampoline object would be placed within the
+    /// specified free range, such that it does not straddle a page boundary.
+    /// @param [in] offset Offset of the beginning of the free range, in bytes.
+    /// @param [in] sizeBytes Size of the free range, in bytes.
+    /// @return Offset from the beginning of the buffer, in bytes, or -1 if a full-size trampoline
+    /// object does not fit.
+    static int AllocationOffsetWithinRange(int offset, int sizeBytes);
+
+    /// Gives back space previously allocated by #AllocateHookStubSlot.
+    /// @param [in] offset Offset of the space from the beginning of the buffer, in bytes.
+    void DeallocateHookStubSlot(int offset);
+
+#ifdef _WIN64
+    /// Retrieves the offset of the unwind information shared by all code in this buffer that does
+    /// not touch the stack, allocating it if needed.
+    /// @return Offset from the beginning of the buffer, in bytes, or -1 in the event of a failure.
+    int LeafUnwindInfoOffset(void);
+#endif
+
+    /// Determines the offset at which the next trampoline object would be placed if allocated from
+    /// the end of the used part of the buffer, such that it does not straddle a page boundary.
+    /// @return Offset from the beginning of the buffer, in bytes.
+    int NextAllocationOffset(void) const;
+
+    /// Determines the offset from the beginning of the buffer beyond which trampoline objects
+    /// cannot be placed because the memory is committed for hook stubs.
+    /// @return Offset from the beginning of the buffer, in bytes.
+    inline int TrampolineAreaEndOffset(void) const
+    {
+      return (kTrampolineStoreSizeBytes - numHookStubCommittedBytes);
+    }
+
+#ifdef _WIN64
+    /// Removes an entry from the function table, if it exists, without registering the change with
+    /// the operating system.
+    /// @param [in] beginOffset Offset of the beginning of the code, in bytes.
+    void RemoveFunctionEntry(int beginOffset);
+
+    /// Removes the function table registration, if there is one.
+    void UnregisterFunctionTable(void);
+
+    /// Registers the current contents of the function table with the operating system, replacing
+    /// whatever was previously registered. Once the function table is empty, it is unregistered.
+    void UpdateFunctionTable(void);
+#endif
+
+    /// Number of trampoline objects, hook stubs, and unwind information records currently
+    /// allocated.
     int count;
 
+    /// Number of bytes, starting from the beginning of the buffer, that have ever been handed out.
+    /// Memory beyond this offset has never been used.
+    int numUsedBytes;
+
+    /// Number of bytes, starting from the beginning of the buffer, that have been committed.
+    int numCommittedBytes;
+
+    /// Maps from the offset of each free range within the used part of the buffer to its size, in
+    /// bytes. Adjacent free ranges are always coalesced.
+    std::map<int, int> freeRanges;
+
+    /// Number of bytes, ending at the end of the buffer, that have ever been handed out for hook
+    /// stubs.
+    int numHookStubUsedBytes;
+
+    /// Number of bytes, ending at the end of the buffer, that have been committed for hook stubs.
+    int numHookStubCommittedBytes;
+
+    /// Offsets of hook stubs that were deallocated and can be reused.
+    std::vector<int> hookStubFreeList;
+
+    /// Maps from the offset of each compacted trampoline object to its compacted size, in bytes.
+    /// Trampoline objects not present are full-size.
+    std::unordered_map<int, int> compactedSizes;
+
+    /// Offsets of entry points that still need to be registered as valid Control Flow Guard call
+    /// targets.
+    std::vector<int> pendingCallTargetOffsets;
+
+#ifdef _WIN64
+    /// Maps from the offset of the beginning of each piece of code described by the function table
+    /// to its function table entry, which is expressed relative to the beginning of the buffer.
+    std::map<int, RUNTIME_FUNCTION> functionEntries;
+
+    /// Maps from the offset of each trampoline object that has unwind information of its own to
+    /// the offset of that unwind information.
+    std::unordered_map<int, int> unwindInfoOffsets;
+
+    /// Offset of the unwind information shared by all code that does not touch the stack, or -1 if
+    /// it has not been allocated.
+    int leafUnwindInfoOffset;
+
+    /// Function table entries currently registered with the operating system. Registered by
+    /// address, so the storage must not move or be freed for as long as it is registered.
+    std::vector<RUNTIME_FUNCTION> registeredFunctionEntries;
+
+    /// Handle of the registered function table, or `nullptr` if none is registered.
+    void* registeredFunctionTable;
+#endif
+
+    /// Metadata for each slot in the buffer, indexed by slot. Allocated only if the buffer is.
+    std::unique_ptr<SSlotMetadata[]> slotMetadata;
+
+    /// Whether or not the buffer is an individual reservation that this object releases when it is
+    /// destroyed. In 32-bit builds, buffers are normally carved out of larger shared reservations,
+    /// which are never released.
+    bool ownsReservation;
+
     /// Holds the trampoline objects themselves.
     Trampoline* trampolines;
   };
@@ -0,0 +1,48 @@
+/***************************************************************************************************
+ * Hookshot
+ *   General-purpose library for injecting DLLs and hooking function calls.
+ ***************************************************************************************************
+ * Authored by Samuel Grossman
+ * Copyright (c) 2019-2025
+ ***********************************************************************************************//**
+ * @file Wow64Injector.h
+ *   Interface declaration for injecting 32-bit processes directly from 64-bit Hookshot.
+ **************************************************************************************************/
+
+#pragma once
+
+#include "ApiWindows.h"
+#include "InjectResult.h"
+#include "Tracing.h"
+
+namespace Hookshot
+{
+  /// Injects newly-created 32-bit processes from the 64-bit form of Hookshot without starting an
+  /// instance of the 32-bit form to do it. The 32-bit injected code is embedded in the 64-bit
+  /// executable, and every step of the injection sequence is performed on the 32-bit view of the
+  /// process, including locating its 32-bit system libraries and its 32-bit process environment
+  /// block. Only available in 64-bit builds.
+  namespace Wow64Injector
+  {
+#ifdef _WIN64
+    /// Attempts to inject a newly-created and suspended 32-bit process with Hookshot code. Phases
+    /// are recorded in the same way as for processes whose architecture matches.
+    /// @param [in] processHandle Handle to the process to inject.
+    /// @param [in] threadHandle Handle to the main thread of the process to inject.
+    /// @param [in] enableDebugFeatures If `true`, signals to the injected process that a debugger
+    /// is present, so certain debug features should be enabled.
+    /// @param [in,out] phaseDurations Receives the durations of the injection phases that this
+    /// function performs.
+    /// @param [out] retryPossible Set to `true` if the injection failed before anything in the
+    /// process was modified, other than allowing its loader to initialize it, in which case the
+    /// process can still be injected some other way. Set to `false` otherwise.
+    /// @return Indicator of the result of the operation.
+    EInjectResult InjectProcess(
+        const HANDLE processHandle,
+        const HANDLE threadHandle,
+        const bool enableDebugFeatures,
+        Tracing::SInjectPhaseDurations& phaseDurations,
+        bool* retryPossible);
+#endif
+  } // namespace Wow64Injector
+} // namespace Hookshot
@@ -39,6 +39,75 @@ namespace Hookshot
     static constexpr int kJumpInstructionLengthBytes =
         sizeof(kJumpInstructionPreamble) + sizeof(uint32_t);
 
+    /// Preamble for writing an absolute jump instruction as in #WriteAbsoluteJumpInstruction.
+    /// Represents `jmp qword ptr [rip+0]`, which reads its target address from the 8 bytes that
+    /// immediately follow it. Only meaningful in 64-bit mode.
+    static constexpr uint8_t kAbsoluteJumpInstructionPreamble[] = {
+        0xff, 0x25, 0x00, 0x00, 0x00, 0x00};
+
+    /// Length of an absolute jump instruction, in bytes, as written by
+    /// #WriteAbsoluteJumpInstruction. Equal to the length of the binary preamble plus the size of
+    /// the 64-bit target address that follows it.
+    static constexpr int kAbsoluteJumpInstructionLengthBytes =
+        sizeof(kAbsoluteJumpInstructionPreamble) + sizeof(uint64_t);
+
+#ifdef _WIN64
+    /// Maximum length of the instruction sequence written by #EncodeWithAbsoluteMemoryReference, in
+    /// bytes. Consists of a load of the destination register from the address slot and the
+    /// instruction itself.
+    static constexpr int kMaxAbsoluteMemoryReferenceSequenceLengthBytes =
+        7 + kMaxInstructionLengthBytes;
+#endif
+
+    /// Encoding of `mov edi, edi`, which is the 2-byte instruction that does nothing and that
+    /// compilers emit at the entry point of every function laid out for hot-patching.
+    static constexpr uint8_t kHotPatchEntryInstruction[] = {0x8b, 0xff};
+
+    /// Length of the instruction at the entry point of a function laid out for hot-patching, in
+    /// bytes. This is the only part of such a function that needs to be overwritten to hook it.
+    static constexpr int kHotPatchEntryLengthBytes = sizeof(kHotPatchEntryInstruction);
+
+    /// Length of the padding that precedes a function laid out for hot-patching, in bytes. Exactly
+    /// large enough to hold an unconditional jump instruction.
+    static constexpr int kHotPatchPaddingLengthBytes = kJumpInstructionLengthBytes;
+
+    /// Encoding of the short jump written over the entry point of a function laid out for
+    /// hot-patching, which targets the beginning of the padding that precedes it.
+    static constexpr uint8_t kHotPatchEntryJumpInstruction[] = {
+        0xeb, static_cast<uint8_t>(-(kHotPatchEntryLengthBytes + kHotPatchPaddingLengthBytes))};
+    static_assert(sizeof(kHotPatchEntryJumpInstruction) == kHotPatchEntryLengthBytes);
+
+    /// Encoding of the system call stub that ntdll exports for each system call in 64-bit Windows
+    /// 10 and later, with the system call number left as 0. The stub chooses between `syscall`
+    /// and `int 2Eh` based on a flag in the shared user data page, whose address is fixed and
+    /// absolute, so the stub behaves identically at any location.
+    static constexpr uint8_t kSyscallStubTemplate[] = {
+        0x4c, 0x8b, 0xd1,                                     // mov r10, rcx
+        0xb8, 0x00, 0x00, 0x00, 0x00,                         // mov eax, <system call number>
+        0xf6, 0x04, 0x25, 0x08, 0x03, 0xfe, 0x7f, 0x01,       // test byte ptr [7ffe0308h], 1
+        0x75, 0x03,                                           // jne (to int 2Eh)
+        0x0f, 0x05,                                           // syscall
+        0xc3,                                                 // ret
+        0xcd, 0x2e,                                           // int 2Eh
+        0xc3};                                                // ret
+
+    /// Encoding of the system call stub that ntdll exports for each system call in 64-bit Windows
+    /// versions earlier than 10, with the system call number left as 0.
+    static constexpr uint8_t kSyscallStubShortTemplate[] = {
+        0x4c, 0x8b, 0xd1,                                     // mov r10, rcx
+        0xb8, 0x00, 0x00, 0x00, 0x00,                         // mov eax, <system call number>
+        0x0f, 0x05,                                           // syscall
+        0xc3};                                                // ret
+
+    /// Offset of the system call number within either form of system call stub, in bytes.
+    static constexpr int kSyscallStubNumberOffsetBytes = 4;
+
+    /// Number of bytes at the beginning of either form of system call stub that are covered by a
+    /// jump instruction written over it, which are exactly the first two instructions.
+    static constexpr int kSyscallStubPrologueLengthBytes =
+        kSyscallStubNumberOffsetBytes + sizeof(uint32_t);
+    static_assert(kSyscallStubPrologueLengthBytes >= kJumpInstructionLengthBytes);
+
     /// Value used to indicate an invalid memory displacement.
     static constexpr int64_t kInvalidMemoryDisplacement = INT64_MIN;
 
@@ -96,14 +165,45 @@ namespace Hookshot
       int operandLocation;
     };
 
-    X86Instruction(void);
+    /// Layout of a single instruction. Holds everything needed to relocate the instruction by
+    /// copying its bytes and patching its position-dependent displacement, if it has one.
+    struct SInstructionLayout
+    {
+      /// Length of the instruction, in bytes.
+      uint8_t lengthBytes;
+
+      /// Offset of the position-dependent displacement, in bytes from the beginning of the
+      /// instruction. Meaningful only if #displacementWidthBytes is non-zero.
+      uint8_t displacementOffsetBytes;
+
+      /// Width of the position-dependent displacement, in bytes, or 0 if the instruction does not
+      /// have one.
+      uint8_t displacementWidthBytes;
+
+      /// Whether or not the displacement is a relative branch displacement, in which case a jump
+      /// assist can be used if the displacement cannot be adjusted to reach its target.
+      bool isRelativeBranch;
 
-    /// Initializes the X86 instruction subsystem. Must be called once during program
-    /// initialization.
-    static inline void Initialize(void)
+      /// Whether or not the instruction marks the end of a control flow.
+      bool isTerminal;
+    };
+
+    /// Describes a system call stub recognized by #DecodeSyscallStub.
+    struct SSyscallStub
     {
-      xed_tables_init();
-    }
+      /// System call number that the stub loads before entering the kernel.
+      uint32_t syscallNumber;
+
+      /// Length of the stub, in bytes, which identifies which form of stub it is.
+      int lengthBytes;
+    };
+
+    X86Instruction(void);
+
+    /// Initializes the X86 instruction subsystem. Happens automatically the first time an
+    /// instruction is decoded, so invoking this explicitly only controls when the cost is paid.
+    /// Safe to invoke any number of times from any number of threads.
+    static void Initialize(void);
 
     /// Determines if a jump instruction can be assembled from the specified location to the
     /// specified location.
@@ -112,6 +212,57 @@ namespace Hookshot
     /// @return `true` if possible, `false` if not.
     static bool CanWriteJumpInstruction(const void* const from, const void* const to);
 
+    /// Determines the layout of the instruction at the specified address without using the
+    /// decoder, provided that it is one of the instruction forms that commonly appear in function
+    /// prologues. These include register pushes and pops, moves and arithmetic between registers
+    /// and memory, stack pointer adjustments, relative branches, and in 64-bit mode, RIP-relative
+    /// operands. Anything else, including any instruction with a prefix other than a single
+    /// operand size override or REX prefix, is left to the decoder.
+    /// @param [in] instruction Address of the instruction to examine.
+    /// @param [out] layout Filled with the layout of the instruction, if it is recognized.
+    /// @return `true` if the instruction is recognized, `false` otherwise.
+    static bool ClassifyCommonInstruction(
+        const void* const instruction, SInstructionLayout* const layout);
+
+    /// Determines if the function at the specified address is a system call stub exported by
+    /// ntdll, meaning that it matches one of the system call stub templates exactly apart from its
+    /// system call number. Only supported in 64-bit mode, where every such stub has one of these
+    /// forms. No instructions are decoded.
+    /// @param [in] func Address of the function to check.
+    /// @param [out] stub Filled with a description of the stub, if it is recognized.
+    /// @return `true` if the function is a system call stub, `false` if not.
+    static bool DecodeSyscallStub(const void* const func, SSyscallStub* const stub);
+
+    /// Determines if the function at the specified address is nothing more than a thunk, meaning
+    /// that it begins with an unconditional jump to somewhere else. Recognized forms are relative
+    /// jumps with 8-bit or 32-bit displacements and indirect jumps through a pointer in memory,
+    /// which is RIP-relative in 64-bit mode and absolute in 32-bit mode. The latter is how import
+    /// thunks and forwarding stubs are typically implemented.
+    /// @param [in] func Address of the function to check.
+    /// @return Address to which the thunk jumps, or `nullptr` if the function does not begin with
+    /// a recognized unconditional jump.
+    static void* GetJumpThunkTarget(const void* const func);
+
+    /// Determines if the function at the specified address is laid out for hot-patching, meaning
+    /// that it begins with `mov edi, edi` and is preceded by enough padding to hold a jump
+    /// instruction. Padding consists of `int 3` or `nop` instructions, or it can be a jump to the
+    /// instruction after the entry point, which is what remains after a hot-patch hook is removed.
+    /// Only supported in 32-bit mode, where `mov edi, edi` has no effect at all. Padding that lies
+    /// in a different page than the entry point is not examined because it might not be readable.
+    /// @param [in] func Address of the function to check.
+    /// @return `true` if the function is laid out for hot-patching, `false` if not.
+    static bool IsHotPatchable(const void* const func);
+
+    /// Writes a complete copy of a system call stub, generated from its template and system call
+    /// number, which behaves identically to the original stub wherever it is placed.
+    /// @param [out] where Buffer to which the system call stub should be written.
+    /// @param [in] whereSizeBytes Number of bytes available for writing the system call stub.
+    /// @param [in] stub Description of the stub, as filled by #DecodeSyscallStub.
+    /// @return Number of bytes written, or 0 on failure due to the buffer being too small or the
+    /// stub not being of a recognized form.
+    static int WriteSyscallStub(
+        void* const where, const int whereSizeBytes, const SSyscallStub& stub);
+
     /// Fills the specified buffer with nop instructions.
     /// @param [out] buf Buffer to which nop instructions should be written.
     /// @param [in] numBytes Size of the buffer to fill, in bytes.
@@ -127,6 +278,18 @@ namespace Hookshot
     static bool WriteJumpInstruction(
         void* const where, const int whereSizeBytes, const void* const to);
 
+#ifdef _WIN64
+    /// Places an absolute jump instruction at the specified location, which can reach any target
+    /// address. Supplied buffer must be large enough to hold #kAbsoluteJumpInstructionLengthBytes
+    /// bytes. Only available in 64-bit mode.
+    /// @param [out] where Buffer to which the jump instruction should be written.
+    /// @param [in] whereSizeBytes Number of bytes available for writing the jump instruction.
+    /// @param [in] to Target address of the jump instruction.
+    /// @return `true` on success, `false` on failure due to the buffer being too small.
+    static bool WriteAbsoluteJumpInstruction(
+        void* const where, const int whereSizeBytes, const void* const to);
+#endif
+
     /// If this instruction contains a position-dependent memory reference, determines if it is
     /// possible to set the displacement to the specified value.
     /// @param [in] displacement Desired displacement value to check.
@@ -151,6 +314,24 @@ namespace Hookshot
     int EncodeInstruction(
         void* const buf, const int maxLengthBytes = kMaxInstructionLengthBytes) const;
 
+#ifdef _WIN64
+    /// If this instruction contains a RIP-relative memory operand, encodes an equivalent sequence of
+    /// instructions that does not depend on its position, for use when the displacement cannot be
+    /// adjusted to reach the target. The destination register of this instruction is loaded with the
+    /// absolute target address held in the specified address slot and used as the base of the
+    /// memory operand, so that neither the stack nor any other register is touched. Only supported
+    /// if the destination is a general-purpose register, other than the stack pointer, that is
+    /// written in at least 32 bits without being read, as by `mov`, `movzx`, `movsxd`, and `lea`.
+    /// @param [out] buf Destination buffer.
+    /// @param [in] maxLengthBytes Maximum allowed encoding length, in bytes.
+    /// @param [in] addressSlot Address of the 8-byte slot from which the absolute target address is
+    /// loaded, which must be within reach of a RIP-relative reference from the destination buffer.
+    /// Filling it is up to the caller.
+    /// @return Number of bytes written on success, 0 on failure.
+    int EncodeWithAbsoluteMemoryReference(
+        void* const buf, const int maxLengthBytes, const void* const addressSlot) const;
+#endif
+
     /// If this instruction contains a position-dependent memory reference, computes and returns the
     /// absolute target address of said reference.
     /// @return Absolute target address, or `nullptr` if either this instruction is invalid or no
@@ -181,6 +362,12 @@ namespace Hookshot
     /// is invalid or no such memory reference exists.
     int64_t GetMemoryDisplacement(void) const;
 
+    /// If this instruction contains a position-dependent memory reference, determines where the
+    /// displacement is located within the binary representation of the instruction.
+    /// @return Offset of the displacement in bytes from the beginning of the instruction, or -1 if
+    /// either this instruction is invalid or no such memory reference exists.
+    int GetMemoryDisplacementOffsetBytes(void) const;
+
     /// If this instruction contains a position-dependent memory reference, determines the width in
     /// bits of the binary representation of the displacement value.
     /// @return Displacement value width in bits, or 0 if either this instruction is invalid or no
@@ -0,0 +1,77 @@
+/***************************************************************************************************
+ * Hookshot
+ *   General-purpose library for injecting DLLs and hooking function calls.
+ ***************************************************************************************************
+ * Authored by Samuel Grossman
+ * Copyright (c) 2019-2025
+ ***********************************************************************************************//**
+ * @file ReentrancyGuard.h
+ *   Helper for maintaining the per-thread depth checked by hooks with reentrancy guards. External
+ *   users should include Hookshot.h instead of this file.
+ **************************************************************************************************/
+
+#pragma once
+
+#include <cstddef>
+#include <intrin.h>
+
+namespace Hookshot
+{
+  /// Increments the calling thread's reentrancy guard depth for as long as an object of this type
+  /// exists. While the depth is non-zero, invoking the original function of any hook whose
+  /// reentrancy guard is enabled runs the original function without invoking any hook functions.
+  /// Typically created at the beginning of a hook function so that anything it invokes does not
+  /// re-enter guarded hooks. Objects can be nested, and each one must be destroyed by the same
+  /// thread that created it. The depth is accessed directly in the thread environment block, so
+  /// creating and destroying an object of this type does not invoke any functions.
+  class ScopedReentrancyGuard
+  {
+  public:
+
+    /// Increments the calling thread's reentrancy guard depth.
+    /// @param [in] depthOffset Offset of the depth within the thread environment block, as
+    /// returned by IHookshot::GetReentrancyGuardDepthOffset. If 0, this object has no effect.
+    inline ScopedReentrancyGuard(size_t depthOffset) : depthOffset(depthOffset)
+    {
+      if (0 != depthOffset) WriteDepth(depthOffset, ReadDepth(depthOffset) + 1);
+    }
+
+    ScopedReentrancyGuard(const ScopedReentrancyGuard&) = delete;
+
+    /// Restores the calling thread's reentrancy guard depth.
+    inline ~ScopedReentrancyGuard(void)
+    {
+      if (0 != depthOffset) WriteDepth(depthOffset, ReadDepth(depthOffset) - 1);
+    }
+
+    /// Reads the calling thread's reentrancy guard depth.
+    /// @param [in] depthOffset Offset of the depth within the thread environment block, which must
+    /// not be 0.
+    /// @return Current depth.
+    static inline size_t ReadDepth(size_t depthOffset)
+    {
+#ifdef _WIN64
+      return static_cast<size_t>(__readgsqword(static_cast<unsigned long>(depthOffset)));
+#else
+      return static_cast<size_t>(__readfsdword(static_cast<unsigned long>(depthOffset)));
+#endif
+    }
+
+  private:
+
+    /// Writes the calling thread's reentrancy guard depth.
+    /// @param [in] depthOffset Offset of the depth within the thread environment block.
+    /// @param [in] depth New depth.
+    static inline void WriteDepth(size_t depthOffset, size_t depth)
+    {
+#ifdef _WIN64
+      __writegsqword(static_cast<unsigned long>(depthOffset), static_cast<unsigned __int64>(depth));
+#else
+      __writefsdword(static_cast<unsigned long>(depthOffset), static_cast<unsigned long>(depth));
+#endif
+    }
+
+    /// Offset of the depth within the thread environment block, or 0 if there is none.
+    const size_t depthOffset;
+  };
+} // namespace Hookshot
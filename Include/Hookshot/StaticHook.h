@@ -18,6 +18,7 @@
 
 #pragma once
 
+#include <cstddef>
 #include <type_traits>
 #include <utility>
 
@@ -29,14 +30,15 @@
 /// of the created type are `Hook` (the hook function, which must be implemented) and `Original`
 /// (automatically implemented to provide access to the original un-hooked functionality of the
 /// specified function). To activate the static hook, the `SetHook` method must be invoked at
-/// runtime. Function prototypes for both `Hook` and `Original` are automatically set to match that
-/// of the specified function, including calling convention. To define the hook function, simply
-/// provide a funciton body for `StaticHook_[function name]::Hook`. The invocation of this macro
-/// should be placed in a location visible wherever access to the underlying type is needed. It is
-/// safe to place in a header file that is included in multiple places. Note that Hookshot might
-/// fail to create the requested hook. Therefore, the return code from `SetHook` should be checked.
-/// Once `SetHook` has been invoked successfully, further invocations have no effect and simply
-/// return `EResult::NoEffect`.
+/// runtime, or the static hook must be listed in a #StaticHookTable whose `SetHooks` method is
+/// invoked at runtime. Function prototypes for both `Hook` and `Original` are automatically set to
+/// match that of the specified function, including calling convention. To define the hook function,
+/// simply provide a funciton body for `StaticHook_[function name]::Hook`. The invocation of this
+/// macro should be placed in a location visible wherever access to the underlying type is needed.
+/// It is safe to place in a header file that is included in multiple places. Note that Hookshot
+/// might fail to create the requested hook. Therefore, the return code from `SetHook` should be
+/// checked. Once `SetHook` has been invoked successfully, further invocations have no effect and
+/// simply return `EResult::NoEffect`.
 #define HOOKSHOT_STATIC_HOOK(func)                                                                 \
   namespace _HookshotInternal                                                                      \
   {                                                                                                \
@@ -154,7 +156,8 @@ namespace Hookshot
     typedef ReturnType callingConvention TFunction(ArgumentTypes...);                              \
     typedef ReturnType(callingConvention* TFunctionPtr)(ArgumentTypes...);                         \
     static ReturnType callingConvention Hook(ArgumentTypes...);                                    \
-    static ReturnType callingConvention Original(ArgumentTypes... args)                            \
+    static HOOKSHOT_ORIGINAL_FUNCTION_SPECIFIERS ReturnType callingConvention Original(           \
+        ArgumentTypes... args)                                                                     \
     {                                                                                              \
       return ((ReturnType(callingConvention*)(                                                     \
           ArgumentTypes...))StaticHookBase<kOriginalFunctionName, kOriginalFunctionAddress>::      \
@@ -172,14 +175,27 @@ namespace Hookshot
           hookshot, &Hook);                                                                        \
     }                                                                                              \
                                                                                                    \
+    static SHookSpec GetHookSpec(void)                                                             \
+    {                                                                                              \
+      return {kOriginalFunctionAddress, &Hook};                                                    \
+    }                                                                                              \
+                                                                                                   \
+    static void CompleteSetHook(IHookshot* const hookshot, const EResult result)                   \
+    {                                                                                              \
+      StaticHookBase<kOriginalFunctionName, kOriginalFunctionAddress>::CompleteSetHook(            \
+          hookshot, result, &Hook);                                                                \
+    }                                                                                              \
+                                                                                                   \
     static EResult DisableHook(IHookshot* const hookshot)                                          \
     {                                                                                              \
-      return hookshot->DisableHookFunction(&Hook);                                                 \
+      return StaticHookBase<kOriginalFunctionName, kOriginalFunctionAddress>::DisableHookFunction( \
+          hookshot, &Hook);                                                                        \
     }                                                                                              \
                                                                                                    \
     static EResult EnableHook(IHookshot* const hookshot)                                           \
     {                                                                                              \
-      return hookshot->ReplaceHookFunction(kOriginalFunctionAddress, &Hook);                       \
+      return StaticHookBase<kOriginalFunctionName, kOriginalFunctionAddress>::EnableHookFunction(  \
+          hookshot, &Hook);                                                                        \
     }                                                                                              \
                                                                                                    \
     static const wchar_t* GetFunctionName(void)                                                    \
@@ -221,17 +237,71 @@ namespace Hookshot
     {
       if (true == IsHookSet()) return EResult::NoEffect;
 
-      const EResult result = hookshot->CreateHook(kOriginalFunctionAddress, hookFunc);
+      // Where available, the original function address is obtained along with creating the hook.
+      IHookshot10* const hookshot10 =
+          reinterpret_cast<IHookshot10*>(hookshot->QueryInterface(kInterfaceVersion10));
+      if (nullptr != hookshot10)
+      {
+        const void* createdOriginalFunction = nullptr;
+        const EResult result = hookshot10->CreateHookEx(
+            kOriginalFunctionAddress, hookFunc, &createdOriginalFunction, &hookHandle);
+        if (SuccessfulResult(result)) originalFunction = createdOriginalFunction;
 
-      if (SuccessfulResult(result))
-        originalFunction = hookshot->GetOriginalFunction(kOriginalFunctionAddress);
+        return result;
+      }
+
+      const EResult result = hookshot->CreateHook(kOriginalFunctionAddress, hookFunc);
+      CompleteSetHook(hookshot, result, hookFunc);
 
       return result;
     }
 
+    static inline void CompleteSetHook(
+        IHookshot* const hookshot, const EResult result, const void* hookFunc)
+    {
+      if (false == SuccessfulResult(result)) return;
+
+      originalFunction = hookshot->GetOriginalFunction(kOriginalFunctionAddress);
+
+      // The handle is obtained once here so that enabling and disabling the hook later do not
+      // need to look it up by address.
+      IHookshot11* const hookshot11 =
+          reinterpret_cast<IHookshot11*>(hookshot->QueryInterface(kInterfaceVersion11));
+      if ((nullptr == hookshot11) ||
+          (false == SuccessfulResult(hookshot11->GetHookHandle(hookFunc, &hookHandle))))
+        hookHandle = kInvalidHookHandle;
+    }
+
+    static inline EResult DisableHookFunction(IHookshot* const hookshot, const void* hookFunc)
+    {
+      IHookshot11* const hookshot11 = HookHandleInterface(hookshot);
+      if (nullptr != hookshot11) return hookshot11->DisableHookFunctionByHandle(hookHandle);
+
+      return hookshot->DisableHookFunction(hookFunc);
+    }
+
+    static inline EResult EnableHookFunction(IHookshot* const hookshot, const void* hookFunc)
+    {
+      IHookshot11* const hookshot11 = HookHandleInterface(hookshot);
+      if (nullptr != hookshot11)
+        return hookshot11->ReplaceHookFunctionByHandle(hookHandle, hookFunc);
+
+      return hookshot->ReplaceHookFunction(kOriginalFunctionAddress, hookFunc);
+    }
+
   private:
 
+    /// Retrieves the interface through which the hook can be identified by its handle.
+    /// @param [in] hookshot Interface pointer through which all Hookshot functionality is accessed.
+    /// @return Interface pointer, or `nullptr` if the hook has no handle.
+    static inline IHookshot11* HookHandleInterface(IHookshot* const hookshot)
+    {
+      if (kInvalidHookHandle == hookHandle) return nullptr;
+      return reinterpret_cast<IHookshot11*>(hookshot->QueryInterface(kInterfaceVersion11));
+    }
+
     inline static const void* originalFunction = nullptr;
+    inline static HookHandle hookHandle = kInvalidHookHandle;
   };
 
   /// Primary static hook template. Specialized using #HOOKSHOT_STATIC_HOOK_TEMPLATE.
@@ -251,4 +321,99 @@ namespace Hookshot
   HOOKSHOT_STATIC_HOOK_TEMPLATE(__stdcall, (__stdcall));
   HOOKSHOT_STATIC_HOOK_TEMPLATE(__vectorcall, (__vectorcall));
 #endif
+
+  /// Determines if the specified type is a static hook type declared using #HOOKSHOT_STATIC_HOOK.
+  /// Every such type has a hook function whose type is exactly that of the original function.
+  template <typename T, typename = void> inline constexpr bool kIsStaticHook = false;
+
+  template <typename T>
+  inline constexpr bool kIsStaticHook<T, std::void_t<typename T::TFunctionPtr>> =
+      std::is_same_v<decltype(&T::Hook), typename T::TFunctionPtr> &&
+      std::is_same_v<decltype(&T::GetHookSpec), SHookSpec (*)(void)>;
+
+  /// Determines if none of the specified types appears more than once.
+  template <typename T, typename... Rest> constexpr bool AreStaticHookTypesDistinct(void)
+  {
+    if constexpr (0 == sizeof...(Rest))
+      return true;
+    else
+      return (false == (std::is_same_v<T, Rest> || ...)) && AreStaticHookTypesDistinct<Rest...>();
+  }
+
+  /// Table of static hooks that are all set together using a single batch operation, which is
+  /// considerably faster than setting each of them individually. Template parameters are static
+  /// hook types declared using #HOOKSHOT_STATIC_HOOK, for example `StaticHook_MessageBoxW`, and
+  /// the table is typically given a name with a `using` declaration. The contents of the table are
+  /// fixed at compile time, and mistakes such as listing something other than a static hook or
+  /// listing the same static hook more than once trigger compiler errors.
+  template <typename... StaticHookTypes> class StaticHookTable
+  {
+    static_assert(0 != sizeof...(StaticHookTypes), "Static hook table cannot be empty.");
+    static_assert(
+        (kIsStaticHook<StaticHookTypes> && ...),
+        "Static hook table can only contain static hooks declared using HOOKSHOT_STATIC_HOOK.");
+    static_assert(
+        AreStaticHookTypesDistinct<StaticHookTypes...>(),
+        "Static hook table cannot contain the same static hook more than once.");
+
+  public:
+
+    /// Number of static hooks in the table.
+    static constexpr size_t kNumHooks = sizeof...(StaticHookTypes);
+
+    StaticHookTable(void) = delete;
+    StaticHookTable(const StaticHookTable& other) = delete;
+    StaticHookTable(StaticHookTable&& other) = delete;
+
+    /// Attempts to set all of the static hooks in the table that are not already set, using a
+    /// single batch operation. Each static hook that is set successfully behaves exactly as if its
+    /// own `SetHook` method had been invoked. Failure to set one static hook does not prevent any
+    /// of the others from being set.
+    /// @param [in] hookshot Interface pointer through which all Hookshot functionality is accessed.
+    /// @param [out] results Optional array, with #kNumHooks elements in the same order as the
+    /// table, to be filled with the result of setting each individual static hook. Static hooks
+    /// that were already set are given `EResult::NoEffect`. May be `nullptr` if per-hook results
+    /// are not needed.
+    /// @return Success if every static hook not already set was set successfully, `NoEffect` if
+    /// all of them were already set, or otherwise the result corresponding to the first static hook
+    /// that could not be set.
+    static EResult SetHooks(IHookshot* const hookshot, EResult* const results = nullptr)
+    {
+      static constexpr bool (*kFuncIsHookSet[])(void) = {&StaticHookTypes::IsHookSet...};
+      static constexpr SHookSpec (*kFuncGetHookSpec[])(void) = {&StaticHookTypes::GetHookSpec...};
+      static constexpr void (*kFuncCompleteSetHook[])(IHookshot* const, const EResult) = {
+          &StaticHookTypes::CompleteSetHook...};
+
+      SHookSpec hookSpecs[kNumHooks];
+      size_t hookSpecTableIndices[kNumHooks];
+      size_t numHookSpecs = 0;
+
+      for (size_t i = 0; i < kNumHooks; ++i)
+      {
+        if (true == kFuncIsHookSet[i]())
+        {
+          if (nullptr != results) results[i] = EResult::NoEffect;
+          continue;
+        }
+
+        hookSpecs[numHookSpecs] = kFuncGetHookSpec[i]();
+        hookSpecTableIndices[numHookSpecs] = i;
+        numHookSpecs += 1;
+      }
+
+      if (0 == numHookSpecs) return EResult::NoEffect;
+
+      EResult hookSpecResults[kNumHooks];
+      const EResult result = hookshot->CreateHooks(hookSpecs, numHookSpecs, hookSpecResults);
+
+      for (size_t i = 0; i < numHookSpecs; ++i)
+      {
+        const size_t tableIndex = hookSpecTableIndices[i];
+        kFuncCompleteSetHook[tableIndex](hookshot, hookSpecResults[i]);
+        if (nullptr != results) results[tableIndex] = hookSpecResults[i];
+      }
+
+      return result;
+    }
+  };
 } // namespace Hookshot
@@ -0,0 +1,44 @@
+/***************************************************************************************************
+ * Hookshot
+ *   General-purpose library for injecting DLLs and hooking function calls.
+ ***************************************************************************************************
+ * Authored by Samuel Grossman
+ * Copyright (c) 2019-2025
+ ***********************************************************************************************//**
+ * @file BenchmarkTiming.h
+ *   Timing functionality shared by all of the benchmarks, based on the high-resolution
+ *   performance counter.
+ **************************************************************************************************/
+
+#pragma once
+
+#include <windows.h>
+
+#include <cstdint>
+
+namespace HookshotBenchmark
+{
+  /// Retrieves the current value of the high-resolution performance counter.
+  /// @return Current performance counter value.
+  inline int64_t Now(void)
+  {
+    LARGE_INTEGER counter;
+    QueryPerformanceCounter(&counter);
+    return counter.QuadPart;
+  }
+
+  /// Converts a performance counter interval to nanoseconds.
+  /// @param [in] ticks Performance counter interval.
+  /// @return Equivalent number of nanoseconds.
+  inline double TicksToNanoseconds(const int64_t ticks)
+  {
+    static const double kNanosecondsPerTick = []() -> double
+    {
+      LARGE_INTEGER frequency;
+      QueryPerformanceFrequency(&frequency);
+      return (1000000000.0 / static_cast<double>(frequency.QuadPart));
+    }();
+
+    return (static_cast<double>(ticks) * kNanosecondsPerTick);
+  }
+} // namespace HookshotBenchmark
@@ -0,0 +1,28 @@
+/***************************************************************************************************
+ * Hookshot
+ *   General-purpose library for injecting DLLs and hooking function calls.
+ ***************************************************************************************************
+ * Authored by Samuel Grossman
+ * Copyright (c) 2019-2025
+ ***********************************************************************************************//**
+ * @file EngineComparison.h
+ *   Declaration of the comparison between Hookshot and other hooking engines, which runs the same
+ *   measurements through each engine that is available.
+ **************************************************************************************************/
+
+#pragma once
+
+namespace HookshotBenchmark
+{
+  namespace EngineComparison
+  {
+    /// Runs the same set of measurements through Hookshot and through every other hooking engine
+    /// whose library can be loaded from the search path, namely MinHook and Detours built as a
+    /// dynamic library. Engines that are not present are skipped. Measures hook installation
+    /// throughput, per-call overhead, the latency of toggling a hook between enabled and disabled,
+    /// and the memory committed per hook. Prints the results and writes them as CSV.
+    /// @param [in] csvPath Path of the CSV file to write, which is replaced if it already exists.
+    /// @return `true` if the CSV file was written, `false` otherwise.
+    bool Run(const wchar_t* csvPath);
+  } // namespace EngineComparison
+} // namespace HookshotBenchmark
@@ -0,0 +1,61 @@
+/***************************************************************************************************
+ * Hookshot
+ *   General-purpose library for injecting DLLs and hooking function calls.
+ ***************************************************************************************************
+ * Authored by Samuel Grossman
+ * Copyright (c) 2019-2025
+ ***********************************************************************************************//**
+ * @file FunctionGenerator.h
+ *   Generation of distinct functions that can serve as original or hook functions.
+ **************************************************************************************************/
+
+#pragma once
+
+#include <array>
+#include <cstddef>
+#include <cstdlib>
+#include <utility>
+
+#include "TestPattern.h"
+
+/// Generates a new function using FunctionGenerator and returns a pointer to it.
+/// A maximum of one instance of this macro can exist on each source code line.
+#define GENERATE_FUNCTION()               &FunctionGenerator<__LINE__>
+
+/// Generates a new function using FunctionGenerator and creates a pointer to it, using the
+/// specified name as the variable name. A maximum of one instance of this macro can exist on each
+/// source code line.
+#define GENERATE_AND_ASSIGN_FUNCTION(var) const auto var = GENERATE_FUNCTION()
+
+namespace HookshotTest
+{
+  /// Pointer-to-function type for the FunctionGenerator function template.
+  using TGeneratedTestFunction = int (*)(void);
+
+  /// Not intended ever to be called, but can be used to generate original and hook functions.
+  template <int n> HOOKSHOT_TEST_HELPER_FUNCTION int FunctionGenerator(void)
+  {
+    const int val = 100 * n;
+
+    for (int i = 0; i < (val / 10); ++i)
+      srand(static_cast<unsigned int>(val + i));
+
+    return val;
+  }
+
+  /// Generates a contiguous range of distinct functions using FunctionGenerator. Useful when the
+  /// number of functions needed is too large to write out one per line.
+  /// @tparam kFirst Template parameter of the first generated function. Ranges used within the
+  /// same source file must not overlap with each other or with any source code line number.
+  /// @tparam kCount Number of functions to generate.
+  /// @return Array of pointers to the generated functions.
+  template <int kFirst, size_t kCount>
+  inline std::array<TGeneratedTestFunction, kCount> GenerateFunctions(void)
+  {
+    return []<size_t... kIndices>(std::index_sequence<kIndices...>)
+    {
+      return std::array<TGeneratedTestFunction, kCount>{
+          &FunctionGenerator<kFirst + static_cast<int>(kIndices)>...};
+    }(std::make_index_sequence<kCount>());
+  }
+} // namespace HookshotTest
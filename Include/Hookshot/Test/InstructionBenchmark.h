@@ -0,0 +1,27 @@
+/***************************************************************************************************
+ * Hookshot
+ *   General-purpose library for injecting DLLs and hooking function calls.
+ ***************************************************************************************************
+ * Authored by Samuel Grossman
+ * Copyright (c) 2019-2025
+ ***********************************************************************************************//**
+ * @file InstructionBenchmark.h
+ *   Declaration of the microbenchmark of instruction decoding and encoding, broken down by
+ *   instruction class.
+ **************************************************************************************************/
+
+#pragma once
+
+namespace HookshotBenchmark
+{
+  namespace InstructionBenchmark
+  {
+    /// Measures the time taken by each of the instruction operations Hookshot performs while
+    /// transplanting code, namely decoding, encoding, updating a position-dependent displacement,
+    /// and querying the length. Each measurement is repeated for several classes of instruction,
+    /// such as plain arithmetic, RIP-relative memory references, relative branches of each width,
+    /// and EVEX-encoded instructions. Classes that use instruction set extensions the current
+    /// processor does not support are skipped. Prints the results in nanoseconds per operation.
+    void Run(void);
+  } // namespace InstructionBenchmark
+} // namespace HookshotBenchmark
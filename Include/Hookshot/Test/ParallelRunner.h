@@ -0,0 +1,43 @@
+/***************************************************************************************************
+ * Hookshot
+ *   General-purpose library for injecting DLLs and hooking function calls.
+ ***************************************************************************************************
+ * Authored by Samuel Grossman
+ * Copyright (c) 2019-2025
+ ***********************************************************************************************//**
+ * @file ParallelRunner.h
+ *   Declaration of functionality for running test cases in parallel across worker processes.
+ **************************************************************************************************/
+
+#pragma once
+
+#include <string_view>
+
+namespace HookshotTest
+{
+  namespace ParallelRunner
+  {
+    /// Registers the name of a test case so that it can be assigned to a worker process. Test
+    /// pattern macros create one static instance of this type per test case they define.
+    class TestCaseNameRegistrar
+    {
+    public:
+
+      /// Registers the specified test case name.
+      /// @param [in] testCaseName Full name of the test case, as known to the test harness.
+      TestCaseNameRegistrar(std::wstring_view testCaseName);
+    };
+
+    /// Runs all registered test cases whose names begin with the specified prefix, each in a
+    /// separate worker process because hooks cannot be removed within a process. Test cases whose
+    /// names begin with the name of another test case run in the same worker process as that test
+    /// case, since the test harness selects test cases by prefix. Output from each worker process
+    /// is captured and printed in a consistent order, followed by a summary of all of the results.
+    /// @param [in] prefix Prefix that test case names must match to be run.
+    /// @param [in] numWorkers Maximum number of worker processes to run at the same time.
+    /// @param [in] numRepetitions Number of times to run each test case.
+    /// @return Number of test case runs that failed, suitable for use as a process exit code.
+    int RunTestsWithMatchingPrefix(
+        std::wstring_view prefix, unsigned int numWorkers, unsigned int numRepetitions);
+  } // namespace ParallelRunner
+} // namespace HookshotTest
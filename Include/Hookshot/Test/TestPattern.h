@@ -16,6 +16,7 @@
 #include <Infra/Test/TestCase.h>
 
 #include "Hookshot.h"
+#include "ParallelRunner.h"
 #include "TestGlobals.h"
 
 /// Expected result of a call to an original version of a function.
@@ -37,6 +38,12 @@ using THookshotTestFunc = size_t(__fastcall*)(size_t scx, size_t sdx);
 /// call to such functions use different parameter values.
 #define HOOKSHOT_TEST_HELPER_FUNCTION __declspec(noinline) static
 
+/// Registers the name of a test case so that the parallel test runner can assign it to a worker
+/// process. Used internally by the test pattern macros, which already supply the full name.
+#define HOOKSHOT_REGISTER_TEST_CASE_NAME(fullname)                                                 \
+  static const ::HookshotTest::ParallelRunner::TestCaseNameRegistrar                               \
+      kTestCaseNameRegistrar_##fullname(L"" #fullname);
+
 /// Encapsulates the logic that implements a Hookshot test in which a hook is set successfully, thus
 /// effectively replacing the original function with the hooked version. This test pattern verifies
 /// that Hookshot correctly returns a hook identifier that identifies the hook, sets the hook, and
@@ -50,6 +57,7 @@ using THookshotTestFunc = size_t(__fastcall*)(size_t scx, size_t sdx);
 #define HOOKSHOT_HOOK_SET_SUCCESS_TEST_CONDITIONAL(name, cond)                                     \
   extern "C" size_t __fastcall name##_Original(size_t scx, size_t sdx);                            \
   extern "C" size_t __fastcall name##_Hook(size_t scx, size_t sdx);                                \
+  HOOKSHOT_REGISTER_TEST_CASE_NAME(HookSetSuccess_##name)                                          \
   TEST_CASE_CONDITIONAL(HookSetSuccess_##name, cond)                                               \
   {                                                                                                \
     TEST_ASSERT(Hookshot::SuccessfulResult(                                                        \
@@ -82,6 +90,7 @@ using THookshotTestFunc = size_t(__fastcall*)(size_t scx, size_t sdx);
   {                                                                                                \
     return __LINE__;                                                                               \
   }                                                                                                \
+  HOOKSHOT_REGISTER_TEST_CASE_NAME(HookSetFail_##name)                                             \
   TEST_CASE_CONDITIONAL(HookSetFail_##name, cond)                                                  \
   {                                                                                                \
     TEST_ASSERT(                                                                                   \
@@ -96,7 +105,9 @@ using THookshotTestFunc = size_t(__fastcall*)(size_t scx, size_t sdx);
 
 /// Encapsulates the logic that implements a completely custom Hookshot test.
 /// This particular macro just ensures a proper test case naming convention.
-#define HOOKSHOT_CUSTOM_TEST_CONDITIONAL(name, cond) TEST_CASE_CONDITIONAL(Custom_##name, cond)
+#define HOOKSHOT_CUSTOM_TEST_CONDITIONAL(name, cond)                                               \
+  HOOKSHOT_REGISTER_TEST_CASE_NAME(Custom_##name)                                                  \
+  TEST_CASE_CONDITIONAL(Custom_##name, cond)
 
 /// Convenience wrapper that unconditionally runs a custom test.
 #define HOOKSHOT_CUSTOM_TEST(name)                   HOOKSHOT_CUSTOM_TEST_CONDITIONAL(name, true)
@@ -0,0 +1,30 @@
+/***************************************************************************************************
+ * Hookshot
+ *   General-purpose library for injecting DLLs and hooking function calls.
+ ***************************************************************************************************
+ * Authored by Samuel Grossman
+ * Copyright (c) 2019-2025
+ ***********************************************************************************************//**
+ * @file TransplantFuzzer.h
+ *   Declaration of differential fuzzing of the instruction transplanting performed when hooks are
+ *   created.
+ **************************************************************************************************/
+
+#pragma once
+
+#include <cstdint>
+
+namespace HookshotBenchmark
+{
+  namespace TransplantFuzzer
+  {
+    /// Generates random instruction streams, hooks each one, and compares the register state left
+    /// behind by executing the original instruction stream before it is hooked with the register
+    /// state left behind by executing its trampoline afterwards. Prints throughput and transplant
+    /// statistics, along with the details of every mismatch found.
+    /// @param [in] seed Seed for the random number generator, which makes a run reproducible.
+    /// @param [in] numIterations Number of instruction streams to generate.
+    /// @return `true` if no mismatches were found, `false` otherwise.
+    bool Run(uint32_t seed, size_t numIterations);
+  } // namespace TransplantFuzzer
+} // namespace HookshotBenchmark
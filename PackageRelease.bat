@@ -9,12 +9,12 @@ set project_has_third_party_license=yes
 
 set files_release=LICENSE README.md
 
-set files_release_build_Win32=Hookshot.32.exe Hookshot.32.dll HookshotLauncher.32.exe
-set files_release_build_x64=Hookshot.64.exe Hookshot.64.dll HookshotLauncher.64.exe
+set files_release_build_Win32=Hookshot.32.exe Hookshot.32.dll HookshotCore.32.dll HookshotLauncher.32.exe HookshotTop.32.exe HookshotSymbolIndex.32.exe HookshotBundle.32.exe
+set files_release_build_x64=Hookshot.64.exe Hookshot.64.dll HookshotCore.64.dll HookshotLauncher.64.exe HookshotTop.64.exe HookshotSymbolIndex.64.exe HookshotBundle.64.exe
 
 
-set files_sdk_lib_build_Win32=Hookshot.32.lib
-set files_sdk_lib_build_x64=Hookshot.64.lib
+set files_sdk_lib_build_Win32=Hookshot.32.lib HookshotCore.32.lib HookshotStatic.32.lib
+set files_sdk_lib_build_x64=Hookshot.64.lib HookshotCore.64.lib HookshotStatic.64.lib
 set files_sdk_include=Include\Hookshot\*.h
 
 set third_party_license=IntelXED
@@ -5,12 +5,13 @@
 //
 #define IDR_HOOKSHOT_INJECT_CODE        100
 #define IDS_HOOKSHOT_VERSION_NAME       101
+#define IDR_HOOKSHOT_INJECT_CODE_WOW64  102
 
 // Next default values for new objects
 //
 #ifdef APSTUDIO_INVOKED
 #ifndef APSTUDIO_READONLY_SYMBOLS
-#define _APS_NEXT_RESOURCE_VALUE        102
+#define _APS_NEXT_RESOURCE_VALUE        103
 #define _APS_NEXT_COMMAND_VALUE         40001
 #define _APS_NEXT_CONTROL_VALUE         1001
 #define _APS_NEXT_SYMED_VALUE           101
@@ -0,0 +1,610 @@
+/***************************************************************************************************
+ * Hookshot
+ *   General-purpose library for injecting DLLs and hooking function calls.
+ ***************************************************************************************************
+ * Authored by Samuel Grossman
+ * Copyright (c) 2019-2025
+ ***********************************************************************************************//**
+ * @file AddressTableHooks.cpp
+ *   Implementation of hooks that rewrite entries in module import and export address tables
+ *   rather than modifying the code of the original function.
+ **************************************************************************************************/
+
+#include "AddressTableHooks.h"
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <algorithm>
+#include <mutex>
+#include <unordered_map>
+#include <unordered_set>
+#include <vector>
+
+#include <Infra/Core/Message.h>
+#include <Infra/Core/ProcessInfo.h>
+#include <Infra/Core/SystemInfo.h>
+#include <Infra/Core/TemporaryBuffer.h>
+
+#include "ApiWindows.h"
+#include "DependencyProtect.h"
+#include "HookshotTypes.h"
+
+namespace Hookshot
+{
+  namespace AddressTableHooks
+  {
+    /// Holds information about an address table hook, including every address table entry it
+    /// rewrote so that they can all be restored.
+    struct SAddressTableHook
+    {
+      /// Kind of address table hook.
+      EHookKind hookKind;
+
+      /// Address of the function that is hooked.
+      void* originalFunc;
+
+      /// Hook function, whose address was written into the address table entries.
+      const void* hookFunc;
+
+      /// Pointer-sized entries, either in import address tables or in virtual function tables, that
+      /// held the address of the original function.
+      std::vector<const void**> pointerEntries;
+
+      /// Export address table entries that held the relative virtual address of the original
+      /// function.
+      std::vector<DWORD*> exportAddressEntries;
+
+      /// Relative virtual address of the original function, as it appeared in the export address
+      /// table entries.
+      DWORD originalFuncRelativeAddress;
+
+      /// Relative virtual address of the hook function, as written into the export address table
+      /// entries.
+      DWORD hookFuncRelativeAddress;
+    };
+
+    /// Describes a pending write of a hook function into a virtual function table entry.
+    struct SVirtualTableWrite
+    {
+      /// Virtual function table entry to write.
+      const void** entry;
+
+      /// Original function, which the entry held before the write.
+      void* originalFunc;
+
+      /// Hook function to write into the entry.
+      const void* hookFunc;
+
+      /// Index of the associated hook in the batch.
+      size_t hookIndex;
+
+      /// Whether or not the write succeeded.
+      bool succeeded;
+    };
+
+    /// Enforces serialized access to the address table hooks.
+    static std::mutex addressTableHooksMutex;
+
+    /// All existing address table hooks, keyed by hook function.
+    static std::unordered_map<const void*, SAddressTableHook> addressTableHooks;
+
+    /// Maps from original function to the hook function of the address table hook on it.
+    static std::unordered_map<const void*, const void*> originalToHookFunction;
+
+    /// Number of existing address table hooks. Allows lookups to skip taking the lock in the
+    /// common case of there being no address table hooks at all.
+    static std::atomic<size_t> numAddressTableHooks = 0;
+
+    /// Locates the headers of a module loaded in the current process.
+    /// @param [in] moduleHandle Handle of the module of interest.
+    /// @return Pointer to the module's headers, or `nullptr` if they are not valid.
+    static const IMAGE_NT_HEADERS* GetModuleHeaders(HMODULE moduleHandle)
+    {
+      const IMAGE_DOS_HEADER* const dosHeader =
+          reinterpret_cast<const IMAGE_DOS_HEADER*>(moduleHandle);
+      if (IMAGE_DOS_SIGNATURE != dosHeader->e_magic) return nullptr;
+
+      const IMAGE_NT_HEADERS* const ntHeaders = reinterpret_cast<const IMAGE_NT_HEADERS*>(
+          reinterpret_cast<size_t>(dosHeader) + static_cast<size_t>(dosHeader->e_lfanew));
+      if (IMAGE_NT_SIGNATURE != ntHeaders->Signature) return nullptr;
+
+      return ntHeaders;
+    }
+
+    /// Translates a relative virtual address within a module loaded in the current process into
+    /// an absolute address.
+    /// @tparam T Type of data located at the relative virtual address.
+    /// @param [in] moduleHandle Handle of the module of interest.
+    /// @param [in] relativeAddress Relative virtual address to translate.
+    /// @return Absolute address.
+    template <typename T> static inline T* AtRelativeAddress(
+        HMODULE moduleHandle, DWORD relativeAddress)
+    {
+      return reinterpret_cast<T*>(
+          reinterpret_cast<size_t>(moduleHandle) + static_cast<size_t>(relativeAddress));
+    }
+
+    /// Determines the protection to apply to the page that contains the specified address while
+    /// writing to it. Address tables are sometimes merged into pages that also contain code, and
+    /// those must remain executable throughout because other threads might be executing them.
+    /// @param [in] address Address of interest.
+    /// @return Writable protection that preserves the ability to execute, if applicable.
+    static DWORD WritableProtectionFor(const void* address)
+    {
+      MEMORY_BASIC_INFORMATION memoryInfo = {};
+      if (0 == Protected::Windows_VirtualQuery(address, &memoryInfo, sizeof(memoryInfo)))
+        return PAGE_READWRITE;
+
+      constexpr DWORD kExecutableProtectionMask =
+          PAGE_EXECUTE | PAGE_EXECUTE_READ | PAGE_EXECUTE_READWRITE | PAGE_EXECUTE_WRITECOPY;
+      return ((0 != (memoryInfo.Protect & kExecutableProtectionMask)) ? PAGE_EXECUTE_READWRITE
+                                                                       : PAGE_READWRITE);
+    }
+
+    /// Writes a value into an address table entry, temporarily making it writable if needed.
+    /// Address table entries are naturally aligned, so other threads observe either the old value
+    /// or the new value and never a mix of the two.
+    /// @tparam T Type of the address table entry.
+    /// @param [in] entry Address table entry to write.
+    /// @param [in] value Value to write.
+    /// @return `true` on success, `false` on failure.
+    template <typename T> static bool WriteAddressTableEntry(T* entry, T value)
+    {
+      DWORD originalProtection = 0;
+      if (0 ==
+          Protected::Windows_VirtualProtect(
+              entry, sizeof(T), WritableProtectionFor(entry), &originalProtection))
+        return false;
+
+      *reinterpret_cast<volatile T*>(entry) = value;
+
+      DWORD unusedOriginalProtection = 0;
+      Protected::Windows_VirtualProtect(
+          entry, sizeof(T), originalProtection, &unusedOriginalProtection);
+      return true;
+    }
+
+    /// Retrieves the handle of the module that contains this code, namely Hookshot itself.
+    /// @return Hookshot's module handle.
+    static HMODULE GetHookshotModule(void)
+    {
+      static const HMODULE hookshotModule = []() -> HMODULE
+      {
+        HMODULE moduleHandle = nullptr;
+        Protected::Windows_GetModuleHandleEx(
+            GET_MODULE_HANDLE_EX_FLAG_FROM_ADDRESS | GET_MODULE_HANDLE_EX_FLAG_UNCHANGED_REFCOUNT,
+            reinterpret_cast<LPCWSTR>(&GetHookshotModule),
+            &moduleHandle);
+        return moduleHandle;
+      }();
+
+      return hookshotModule;
+    }
+
+    /// Rewrites every import address table entry in the specified module that holds the address of
+    /// the original function so that it holds the address of the hook function instead.
+    /// @param [in] moduleHandle Handle of the module whose import address table is to be rewritten.
+    /// @param [in,out] addressTableHook Hook being created, to which rewritten entries are added.
+    static void RewriteImportAddressEntries(
+        HMODULE moduleHandle, SAddressTableHook& addressTableHook)
+    {
+      const IMAGE_NT_HEADERS* const ntHeaders = GetModuleHeaders(moduleHandle);
+      if (nullptr == ntHeaders) return;
+
+      const IMAGE_DATA_DIRECTORY& importDataDirectory =
+          ntHeaders->OptionalHeader.DataDirectory[IMAGE_DIRECTORY_ENTRY_IMPORT];
+      if ((0 == importDataDirectory.VirtualAddress) || (0 == importDataDirectory.Size)) return;
+
+      // Each imported module has an import descriptor, and the list of descriptors is terminated by
+      // one that is all zeroes. The import address table of each imported module is an array of
+      // pointer-sized entries, also terminated by a zero entry, that the loader fills with the
+      // addresses of the imported functions.
+      for (const IMAGE_IMPORT_DESCRIPTOR* importDescriptor = AtRelativeAddress<
+               const IMAGE_IMPORT_DESCRIPTOR>(moduleHandle, importDataDirectory.VirtualAddress);
+           0 != importDescriptor->Name;
+           ++importDescriptor)
+      {
+        if (0 == importDescriptor->FirstThunk) continue;
+
+        for (IMAGE_THUNK_DATA* importAddressEntry =
+                 AtRelativeAddress<IMAGE_THUNK_DATA>(moduleHandle, importDescriptor->FirstThunk);
+             0 != importAddressEntry->u1.Function;
+             ++importAddressEntry)
+        {
+          const void** const entry =
+              reinterpret_cast<const void**>(&importAddressEntry->u1.Function);
+          if (addressTableHook.originalFunc != *entry) continue;
+
+          if (true == WriteAddressTableEntry(entry, addressTableHook.hookFunc))
+            addressTableHook.pointerEntries.push_back(entry);
+        }
+      }
+    }
+
+    /// Rewrites every import address table entry in all modules loaded in the current process,
+    /// other than Hookshot itself, that holds the address of the original function.
+    /// @param [in,out] addressTableHook Hook being created, to which rewritten entries are added.
+    static void RewriteImportAddressEntriesInAllModules(SAddressTableHook& addressTableHook)
+    {
+      Infra::TemporaryBuffer<HMODULE> loadedModules;
+      DWORD numLoadedModulesBytes = 0;
+
+      if (FALSE ==
+          EnumProcessModules(
+              Infra::ProcessInfo::GetCurrentProcessHandle(),
+              loadedModules.Data(),
+              loadedModules.CapacityBytes(),
+              &numLoadedModulesBytes))
+        return;
+
+      // Modules beyond the capacity of the buffer are not rewritten.
+      if (numLoadedModulesBytes > loadedModules.CapacityBytes())
+        numLoadedModulesBytes = loadedModules.CapacityBytes();
+
+      const DWORD numLoadedModules = numLoadedModulesBytes / sizeof(HMODULE);
+      for (DWORD i = 0; i < numLoadedModules; ++i)
+      {
+        if (GetHookshotModule() == loadedModules[i]) continue;
+        RewriteImportAddressEntries(loadedModules[i], addressTableHook);
+      }
+    }
+
+    /// Rewrites every export address table entry, in the module that contains the original
+    /// function, that identifies the original function so that it identifies the hook function
+    /// instead.
+    /// @param [in,out] addressTableHook Hook being created, to which rewritten entries are added.
+    /// @return Indicator of the result of the operation.
+    static EResult RewriteExportAddressEntries(SAddressTableHook& addressTableHook)
+    {
+      HMODULE moduleHandle = nullptr;
+      if (0 ==
+          Protected::Windows_GetModuleHandleEx(
+              GET_MODULE_HANDLE_EX_FLAG_FROM_ADDRESS | GET_MODULE_HANDLE_EX_FLAG_UNCHANGED_REFCOUNT,
+              reinterpret_cast<LPCWSTR>(addressTableHook.originalFunc),
+              &moduleHandle))
+        return EResult::FailNotFound;
+
+      const IMAGE_NT_HEADERS* const ntHeaders = GetModuleHeaders(moduleHandle);
+      if (nullptr == ntHeaders) return EResult::FailNotFound;
+
+      const IMAGE_DATA_DIRECTORY& exportDataDirectory =
+          ntHeaders->OptionalHeader.DataDirectory[IMAGE_DIRECTORY_ENTRY_EXPORT];
+      if ((0 == exportDataDirectory.VirtualAddress) || (0 == exportDataDirectory.Size))
+        return EResult::FailNotFound;
+
+      // Export address table entries are 32-bit relative virtual addresses, so the hook function
+      // must lie above the module and within 4 GB of it. It also must not appear to lie within the
+      // export directory, which would make the loader interpret it as a forwarder string.
+      const size_t moduleBase = reinterpret_cast<size_t>(moduleHandle);
+      const size_t hookFuncAddress = reinterpret_cast<size_t>(addressTableHook.hookFunc);
+      if ((hookFuncAddress <= moduleBase) ||
+          ((hookFuncAddress - moduleBase) > static_cast<size_t>(UINT32_MAX)))
+        return EResult::FailCannotSetHook;
+
+      addressTableHook.originalFuncRelativeAddress =
+          static_cast<DWORD>(reinterpret_cast<size_t>(addressTableHook.originalFunc) - moduleBase);
+      addressTableHook.hookFuncRelativeAddress = static_cast<DWORD>(hookFuncAddress - moduleBase);
+      if ((addressTableHook.hookFuncRelativeAddress >= exportDataDirectory.VirtualAddress) &&
+          (addressTableHook.hookFuncRelativeAddress <
+           (exportDataDirectory.VirtualAddress + exportDataDirectory.Size)))
+        return EResult::FailCannotSetHook;
+
+      const IMAGE_EXPORT_DIRECTORY* const exportDirectory =
+          AtRelativeAddress<const IMAGE_EXPORT_DIRECTORY>(
+              moduleHandle, exportDataDirectory.VirtualAddress);
+      DWORD* const exportAddressTable =
+          AtRelativeAddress<DWORD>(moduleHandle, exportDirectory->AddressOfFunctions);
+
+      for (DWORD i = 0; i < exportDirectory->NumberOfFunctions; ++i)
+      {
+        if (addressTableHook.originalFuncRelativeAddress != exportAddressTable[i]) continue;
+
+        if (true ==
+            WriteAddressTableEntry(
+                &exportAddressTable[i], addressTableHook.hookFuncRelativeAddress))
+          addressTableHook.exportAddressEntries.push_back(&exportAddressTable[i]);
+      }
+
+      return EResult::Success;
+    }
+
+    /// Restores every address table entry rewritten by the specified hook, skipping those that no
+    /// longer hold the value written when the hook was created.
+    /// @param [in] addressTableHook Hook whose address table entries are to be restored.
+    static void RestoreAddressTableEntries(const SAddressTableHook& addressTableHook)
+    {
+      for (const void** const entry : addressTableHook.pointerEntries)
+      {
+        if (addressTableHook.hookFunc == *entry)
+          WriteAddressTableEntry(entry, static_cast<const void*>(addressTableHook.originalFunc));
+      }
+
+      for (DWORD* const entry : addressTableHook.exportAddressEntries)
+      {
+        if (addressTableHook.hookFuncRelativeAddress == *entry)
+          WriteAddressTableEntry(entry, addressTableHook.originalFuncRelativeAddress);
+      }
+    }
+
+    /// Searches for an existing address table hook. Requires that the lock be held.
+    /// @param [in] originalOrHookFunc Address of either the original function or the hook
+    /// function associated with the hook.
+    /// @return Pointer to the matching hook, or `nullptr` if there is none.
+    static SAddressTableHook* FindAddressTableHook(const void* originalOrHookFunc)
+    {
+      const void* hookFunc = originalOrHookFunc;
+
+      const auto originalIter = originalToHookFunction.find(originalOrHookFunc);
+      if (originalToHookFunction.end() != originalIter) hookFunc = originalIter->second;
+
+      const auto hookIter = addressTableHooks.find(hookFunc);
+      if (addressTableHooks.end() == hookIter) return nullptr;
+
+      return &hookIter->second;
+    }
+
+    /// Begins tracking a newly-created address table hook. Requires that the lock be held.
+    /// @param [in] addressTableHook Hook to track.
+    static void InsertAddressTableHook(SAddressTableHook&& addressTableHook)
+    {
+      originalToHookFunction[addressTableHook.originalFunc] = addressTableHook.hookFunc;
+      addressTableHooks[addressTableHook.hookFunc] = std::move(addressTableHook);
+      numAddressTableHooks = addressTableHooks.size();
+    }
+
+    /// Writes hook functions into a batch of virtual function table entries. Entries that share a
+    /// page are written together, so each page has its protection changed just once.
+    /// @param [in,out] virtualTableWrites Entries to write, reordered by this function. Each one is
+    /// marked with whether or not it was successfully written.
+    static void WriteVirtualTableEntries(std::vector<SVirtualTableWrite>& virtualTableWrites)
+    {
+      const size_t pageSize =
+          static_cast<size_t>(Infra::SystemInfo::GetPlatformAndArchitectureInfo().dwPageSize);
+      auto pageOf = [pageSize](const void* address) -> size_t
+      {
+        return reinterpret_cast<size_t>(address) & ~(pageSize - 1);
+      };
+
+      std::sort(
+          virtualTableWrites.begin(),
+          virtualTableWrites.end(),
+          [](const SVirtualTableWrite& a, const SVirtualTableWrite& b) -> bool
+          {
+            return (a.entry < b.entry);
+          });
+
+      size_t pageBegin = 0;
+      while (pageBegin < virtualTableWrites.size())
+      {
+        const size_t page = pageOf(virtualTableWrites[pageBegin].entry);
+
+        size_t pageEnd = pageBegin + 1;
+        while ((pageEnd < virtualTableWrites.size()) &&
+               (page == pageOf(virtualTableWrites[pageEnd].entry)))
+          pageEnd += 1;
+
+        void* const pageAddress = reinterpret_cast<void*>(page);
+        DWORD originalProtection = 0;
+        const bool isWritable =
+            (0 !=
+             Protected::Windows_VirtualProtect(
+                 pageAddress, pageSize, WritableProtectionFor(pageAddress), &originalProtection));
+
+        for (size_t i = pageBegin; i < pageEnd; ++i)
+        {
+          SVirtualTableWrite& virtualTableWrite = virtualTableWrites[i];
+          if (true == isWritable)
+            *reinterpret_cast<const void* volatile*>(virtualTableWrite.entry) =
+                virtualTableWrite.hookFunc;
+          virtualTableWrite.succeeded = isWritable;
+        }
+
+        if (true == isWritable)
+        {
+          DWORD unusedOriginalProtection = 0;
+          Protected::Windows_VirtualProtect(
+              pageAddress, pageSize, originalProtection, &unusedOriginalProtection);
+        }
+
+        pageBegin = pageEnd;
+      }
+    }
+
+    EResult CreateAddressTableHook(
+        EHookKind hookKind, void* originalFunc, const void* hookFunc, HMODULE importingModule)
+    {
+      if ((EHookKind::ImportAddressTable != hookKind) &&
+          (EHookKind::ExportAddressTable != hookKind))
+        return EResult::FailInvalidArgument;
+      if ((nullptr == originalFunc) || (nullptr == hookFunc) || (originalFunc == hookFunc))
+        return EResult::FailInvalidArgument;
+
+      std::unique_lock<std::mutex> lock(addressTableHooksMutex);
+
+      // Address table hooks are not chained. A second hook would not find any entries that still
+      // refer to the original function, let alone be able to restore them independently.
+      if ((nullptr != FindAddressTableHook(originalFunc)) ||
+          (nullptr != FindAddressTableHook(hookFunc)))
+        return EResult::FailDuplicate;
+
+      SAddressTableHook newAddressTableHook = {
+          .hookKind = hookKind,
+          .originalFunc = originalFunc,
+          .hookFunc = hookFunc,
+          .pointerEntries = {},
+          .exportAddressEntries = {},
+          .originalFuncRelativeAddress = 0,
+          .hookFuncRelativeAddress = 0};
+
+      if (EHookKind::ImportAddressTable == hookKind)
+      {
+        if (nullptr == importingModule)
+          RewriteImportAddressEntriesInAllModules(newAddressTableHook);
+        else
+          RewriteImportAddressEntries(importingModule, newAddressTableHook);
+      }
+      else
+      {
+        const EResult rewriteResult = RewriteExportAddressEntries(newAddressTableHook);
+        if (false == SuccessfulResult(rewriteResult)) return rewriteResult;
+      }
+
+      const size_t numEntriesRewritten = newAddressTableHook.pointerEntries.size() +
+          newAddressTableHook.exportAddressEntries.size();
+      if (0 == numEntriesRewritten) return EResult::FailNotFound;
+
+      InsertAddressTableHook(std::move(newAddressTableHook));
+
+      lock.unlock();
+
+      Infra::Message::OutputFormatted(
+          Infra::Message::ESeverity::Info,
+          L"Successfully hooked function at 0x%llx by rewriting %llu %s address table entries.",
+          (long long)originalFunc,
+          (unsigned long long)numEntriesRewritten,
+          ((EHookKind::ImportAddressTable == hookKind) ? L"import" : L"export"));
+
+      return EResult::Success;
+    }
+
+    EResult CreateVirtualTableHooks(
+        void* virtualTable,
+        const size_t* slotIndices,
+        const void* const* hookFuncs,
+        size_t numHooks,
+        EResult* results)
+    {
+      const void** const virtualTableEntries = reinterpret_cast<const void**>(virtualTable);
+
+      std::vector<SVirtualTableWrite> virtualTableWrites;
+      virtualTableWrites.reserve(numHooks);
+
+      std::unique_lock<std::mutex> lock(addressTableHooksMutex);
+
+      // Duplicate checks must consider both existing hooks and hooks that appear earlier in the
+      // same batch, since the latter are not yet tracked. The same hook function can be written
+      // into multiple virtual function tables, for example those of related interfaces, as long as
+      // all of the entries it replaces hold the same original function.
+      std::unordered_set<const void**> entriesInBatch;
+      std::unordered_map<const void*, void*> hookToOriginalFunctionInBatch;
+
+      for (size_t i = 0; i < numHooks; ++i)
+      {
+        if (false == SuccessfulResult(results[i])) continue;
+
+        const void** const entry = &virtualTableEntries[slotIndices[i]];
+        void* const originalFunc = const_cast<void*>(*entry);
+        const void* const hookFunc = hookFuncs[i];
+
+        if ((nullptr == originalFunc) || (nullptr == hookFunc) || (originalFunc == hookFunc))
+        {
+          results[i] = EResult::FailInvalidArgument;
+          continue;
+        }
+
+        const SAddressTableHook* const existingByHookFunc = FindAddressTableHook(hookFunc);
+        const SAddressTableHook* const existingByOriginalFunc = FindAddressTableHook(originalFunc);
+        const auto batchIter = hookToOriginalFunctionInBatch.find(hookFunc);
+
+        const bool isExtendingExistingHook = ((nullptr != existingByHookFunc) &&
+                                              (EHookKind::VirtualFunctionTable ==
+                                               existingByHookFunc->hookKind) &&
+                                              (originalFunc == existingByHookFunc->originalFunc));
+        const bool isConflictingWithExistingHook =
+            ((false == isExtendingExistingHook) &&
+             ((nullptr != existingByHookFunc) || (nullptr != existingByOriginalFunc)));
+        const bool isConflictingWithBatch = ((0 != entriesInBatch.count(entry)) ||
+                                             ((hookToOriginalFunctionInBatch.end() != batchIter) &&
+                                              (originalFunc != batchIter->second)));
+
+        if ((true == isConflictingWithExistingHook) || (true == isConflictingWithBatch))
+        {
+          results[i] = EResult::FailDuplicate;
+          continue;
+        }
+
+        entriesInBatch.insert(entry);
+        hookToOriginalFunctionInBatch[hookFunc] = originalFunc;
+        virtualTableWrites.push_back(
+            {.entry = entry,
+             .originalFunc = originalFunc,
+             .hookFunc = hookFunc,
+             .hookIndex = i,
+             .succeeded = false});
+      }
+
+      WriteVirtualTableEntries(virtualTableWrites);
+
+      size_t numHooksCreated = 0;
+      for (const auto& virtualTableWrite : virtualTableWrites)
+      {
+        if (false == virtualTableWrite.succeeded)
+        {
+          results[virtualTableWrite.hookIndex] = EResult::FailCannotSetHook;
+          continue;
+        }
+
+        SAddressTableHook* addressTableHook = FindAddressTableHook(virtualTableWrite.hookFunc);
+        if (nullptr == addressTableHook)
+        {
+          InsertAddressTableHook(
+              {.hookKind = EHookKind::VirtualFunctionTable,
+               .originalFunc = virtualTableWrite.originalFunc,
+               .hookFunc = virtualTableWrite.hookFunc,
+               .pointerEntries = {},
+               .exportAddressEntries = {},
+               .originalFuncRelativeAddress = 0,
+               .hookFuncRelativeAddress = 0});
+          addressTableHook = FindAddressTableHook(virtualTableWrite.hookFunc);
+        }
+
+        addressTableHook->pointerEntries.push_back(virtualTableWrite.entry);
+        numHooksCreated += 1;
+      }
+
+      lock.unlock();
+
+      Infra::Message::OutputFormatted(
+          Infra::Message::ESeverity::Info,
+          L"Successfully created %llu of %llu hook(s) on virtual function table 0x%llx.",
+          (unsigned long long)numHooksCreated,
+          (unsigned long long)numHooks,
+          (long long)virtualTable);
+
+      for (size_t i = 0; i < numHooks; ++i)
+      {
+        if (false == SuccessfulResult(results[i])) return results[i];
+      }
+
+      return EResult::Success;
+    }
+
+    const void* GetOriginalFunction(const void* originalOrHookFunc)
+    {
+      if (0 == numAddressTableHooks) return nullptr;
+
+      std::unique_lock<std::mutex> lock(addressTableHooksMutex);
+
+      const SAddressTableHook* const addressTableHook = FindAddressTableHook(originalOrHookFunc);
+      if (nullptr == addressTableHook) return nullptr;
+
+      return addressTableHook->originalFunc;
+    }
+
+    EResult RemoveAddressTableHook(const void* originalOrHookFunc)
+    {
+      std::unique_lock<std::mutex> lock(addressTableHooksMutex);
+
+      const SAddressTableHook* const addressTableHook = FindAddressTableHook(originalOrHookFunc);
+      if (nullptr == addressTableHook) return EResult::FailNotFound;
+
+      RestoreAddressTableEntries(*addressTableHook);
+      originalToHookFunction.erase(addressTableHook->originalFunc);
+      addressTableHooks.erase(addressTableHook->hookFunc);
+      numAddressTableHooks = addressTableHooks.size();
+
+      return EResult::Success;
+    }
+  } // namespace AddressTableHooks
+} // namespace Hookshot
@@ -11,22 +11,44 @@
 
 #include "ApiWindows.h"
 
+#include <cstddef>
+#include <string_view>
+#include <vector>
+
+#include "ExportResolver.h"
+
 namespace Hookshot
 {
-  void* GetWindowsApiFunctionAddress(const char* const funcName, void* const funcStaticAddress)
+  /// Number of low-level binaries that are checked for Windows API functions.
+  static constexpr int kNumLowLevelBinaries = 1;
+
+  /// Retrieves the list of low-level binary module handles, specified as the result of a call to
+  /// LoadLibrary with the name of the binary. Each is checked in sequence for Windows API functions,
+  /// which are looked up by base name.
+  /// @return Array of low-level binary module handles, any of which could be `nullptr`.
+  static const HMODULE* LowLevelBinaries(void)
   {
-    // List of low-level binary module handles, specified as the result of a call to LoadLibrary
-    // with the name of the binary. Each is checked in sequence for the specified function, which is
-    // looked up by base name.
-    static const HMODULE hmodLowLevelBinaries[] = {LoadLibrary(L"KernelBase.dll")};
+    static const HMODULE hmodLowLevelBinaries[kNumLowLevelBinaries] = {
+        LoadLibrary(L"KernelBase.dll")};
+    return hmodLowLevelBinaries;
+  }
 
+  void* GetWindowsApiFunctionAddress(const char* const funcName, void* const funcStaticAddress)
+  {
+    const HMODULE* const hmodLowLevelBinaries = LowLevelBinaries();
     void* funcAddress = funcStaticAddress;
 
-    for (int i = 0; (funcAddress == funcStaticAddress) && (i < _countof(hmodLowLevelBinaries)); ++i)
+    for (int i = 0; (funcAddress == funcStaticAddress) && (i < kNumLowLevelBinaries); ++i)
     {
       if (nullptr != hmodLowLevelBinaries[i])
       {
-        void* const funcPossibleAddress = GetProcAddress(hmodLowLevelBinaries[i], funcName);
+        // Forwarded exports are not resolved by the export resolver, so `GetProcAddress` is still
+        // needed as a fallback.
+        void* funcPossibleAddress =
+            ExportResolver::GetLocalProcAddress(hmodLowLevelBinaries[i], funcName);
+        if (nullptr == funcPossibleAddress)
+          funcPossibleAddress =
+              reinterpret_cast<void*>(GetProcAddress(hmodLowLevelBinaries[i], funcName));
 
         if (nullptr != funcPossibleAddress) funcAddress = funcPossibleAddress;
       }
@@ -34,4 +56,43 @@ namespace Hookshot
 
     return funcAddress;
   }
+
+  void GetWindowsApiFunctionAddresses(
+      const char* const* funcNames, void** funcAddresses, size_t numFuncs)
+  {
+    const HMODULE* const hmodLowLevelBinaries = LowLevelBinaries();
+
+    std::vector<std::string_view> funcNameViews(funcNames, funcNames + numFuncs);
+    std::vector<void*> funcPossibleAddresses(numFuncs, nullptr);
+    std::vector<bool> funcIsResolved(numFuncs, false);
+
+    for (int i = 0; i < kNumLowLevelBinaries; ++i)
+    {
+      if (nullptr == hmodLowLevelBinaries[i]) continue;
+
+      ExportResolver::GetLocalProcAddresses(
+          hmodLowLevelBinaries[i],
+          funcNameViews.data(),
+          numFuncs,
+          funcPossibleAddresses.data());
+
+      for (size_t j = 0; j < numFuncs; ++j)
+      {
+        if (true == funcIsResolved[j]) continue;
+
+        // Forwarded exports are not resolved by the export resolver, so `GetProcAddress` is still
+        // needed as a fallback.
+        void* funcPossibleAddress = funcPossibleAddresses[j];
+        if (nullptr == funcPossibleAddress)
+          funcPossibleAddress =
+              reinterpret_cast<void*>(GetProcAddress(hmodLowLevelBinaries[i], funcNames[j]));
+
+        if (nullptr != funcPossibleAddress)
+        {
+          funcAddresses[j] = funcPossibleAddress;
+          funcIsResolved[j] = true;
+        }
+      }
+    }
+  }
 } // namespace Hookshot
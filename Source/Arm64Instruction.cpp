@@ -0,0 +1,632 @@
+/***************************************************************************************************
+ * Hookshot
+ *   General-purpose library for injecting DLLs and hooking function calls.
+ ***************************************************************************************************
+ * Authored by Samuel Grossman
+ * Copyright (c) 2019-2025
+ ***********************************************************************************************//**
+ * @file Arm64Instruction.cpp
+ *   Implementation of functionality for manipulating binary ARM64 instructions.
+ **************************************************************************************************/
+
+#include "Arm64Instruction.h"
+
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+
+namespace Hookshot
+{
+  /// Scratch register used by veneers to hold the target of a branch, which is `x16`.
+  static constexpr uint32_t kBranchScratchRegister = 16;
+
+  /// Scratch register used to hold the address of a literal that cannot be loaded directly into
+  /// the destination register of the original instruction, which is `x17`.
+  static constexpr uint32_t kLoadScratchRegister = 17;
+
+  /// Register number that identifies the zero register in the instructions that are relocated.
+  static constexpr uint32_t kZeroRegister = 31;
+
+  /// Encoding of `ldr xt, #imm` with the register and immediate both 0.
+  static constexpr uint32_t kLoadLiteral64Instruction = 0x58000000;
+
+  /// Encoding of `b #imm` with the immediate 0.
+  static constexpr uint32_t kBranchInstruction = 0x14000000;
+
+  /// Encoding of `br xn` with the register 0.
+  static constexpr uint32_t kBranchRegisterInstruction = 0xd61f0000;
+
+  /// Encoding of `blr xn` with the register 0.
+  static constexpr uint32_t kBranchWithLinkRegisterInstruction = 0xd63f0000;
+
+  /// Encoding of `adrp xd, #imm` with the register and immediate both 0.
+  static constexpr uint32_t kAdrpInstruction = 0x90000000;
+
+  /// Encoding of `add xd, xn, #imm` with the registers and immediate all 0.
+  static constexpr uint32_t kAddImmediate64Instruction = 0x91000000;
+
+  /// Encodings of loads from the address held in a base register, with no offset and with both
+  /// registers 0, indexed by the `opc` field of the literal load they replace. The first set loads
+  /// general-purpose registers, as `ldr wt`, `ldr xt`, and `ldrsw xt`, and the second loads SIMD
+  /// registers, as `ldr st`, `ldr dt`, and `ldr qt`.
+  static constexpr uint32_t kLoadRegisterInstructions[2][3] = {
+      {0xb9400000, 0xf9400000, 0xb9800000}, {0xbd400000, 0xfd400000, 0x3dc00000}};
+
+  /// Size of the page that `adrp` computes the address of, as a power of two.
+  static constexpr int kAdrpPageShift = 12;
+
+  /// Number of bytes that the inverted branch at the beginning of a relocated conditional branch
+  /// skips over, which is itself plus an absolute jump sequence.
+  static constexpr int64_t kInvertedBranchSkipBytes =
+      Arm64Instruction::kInstructionLengthBytes +
+      Arm64Instruction::kAbsoluteJumpInstructionLengthBytes;
+
+  /// Sign-extends the low-order bits of a value.
+  /// @param [in] value Value to sign-extend, whose bits above the width must all be 0.
+  /// @param [in] widthBits Number of low-order bits that hold the signed value.
+  /// @return Sign-extended value.
+  static inline int64_t SignExtend(const uint64_t value, const int widthBits)
+  {
+    const uint64_t signBit = (1ull << (widthBits - 1));
+    return static_cast<int64_t>((value ^ signBit) - signBit);
+  }
+
+  /// Determines if a displacement can be held by a signed immediate field of the specified width
+  /// after being scaled down by the specified power of two.
+  /// @param [in] displacement Displacement to check.
+  /// @param [in] widthBits Width of the immediate field, in bits.
+  /// @param [in] scaleShift Power of two by which the field is scaled.
+  /// @return `true` if so, `false` otherwise.
+  static inline bool DisplacementFits(
+      const int64_t displacement, const int widthBits, const int scaleShift)
+  {
+    if (0 != (displacement & ((1ll << scaleShift) - 1))) return false;
+
+    const int64_t scaledDisplacement = (displacement >> scaleShift);
+    return (
+        (scaledDisplacement >= -(1ll << (widthBits - 1))) &&
+        (scaledDisplacement < (1ll << (widthBits - 1))));
+  }
+
+  /// Replaces the value of a field within an instruction encoding.
+  /// @param [in] encoding Instruction encoding.
+  /// @param [in] value Value to place in the field, which is truncated to fit.
+  /// @param [in] shift Position of the lowest-order bit of the field.
+  /// @param [in] widthBits Width of the field, in bits.
+  /// @return Instruction encoding with the field replaced.
+  static inline uint32_t WithField(
+      const uint32_t encoding, const uint64_t value, const int shift, const int widthBits)
+  {
+    const uint32_t mask = ((1u << widthBits) - 1) << shift;
+    return ((encoding & ~mask) | ((static_cast<uint32_t>(value) << shift) & mask));
+  }
+
+  /// Determines the position-dependent form of an instruction.
+  /// @param [in] encoding Instruction encoding.
+  /// @return Form of position-dependent reference the instruction makes.
+  static Arm64Instruction::EPositionDependentKind PositionDependentKindFromEncoding(
+      const uint32_t encoding)
+  {
+    using EKind = Arm64Instruction::EPositionDependentKind;
+
+    if (0x10000000 == (encoding & 0x9f000000)) return EKind::Adr;
+    if (0x90000000 == (encoding & 0x9f000000)) return EKind::Adrp;
+
+    if (0x18000000 == (encoding & 0x3b000000))
+    {
+      const uint32_t opc = (encoding >> 30);
+      const bool isSimd = (0 != (encoding & (1u << 26)));
+
+      if (3 != opc) return EKind::LoadLiteral;
+      if (false == isSimd) return EKind::PrefetchLiteral;
+      return EKind::None;
+    }
+
+    if (0x14000000 == (encoding & 0xfc000000)) return EKind::Branch;
+    if (0x94000000 == (encoding & 0xfc000000)) return EKind::BranchWithLink;
+
+    // The always and never conditions both mean always, so such a conditional branch is really an
+    // unconditional branch with a shorter reach.
+    if (0x54000000 == (encoding & 0xff000010))
+      return (((encoding & 0xf) >= 0xe) ? EKind::Branch : EKind::ConditionalBranch);
+
+    if (0x34000000 == (encoding & 0x7e000000)) return EKind::CompareAndBranch;
+    if (0x36000000 == (encoding & 0x7e000000)) return EKind::TestAndBranch;
+
+    return EKind::None;
+  }
+
+  /// Computes the displacement, relative to the address of an instruction, to which it refers.
+  /// For `adrp` this is a displacement relative to the page that contains the instruction.
+  /// @param [in] encoding Instruction encoding.
+  /// @param [in] kind Form of position-dependent reference the instruction makes.
+  /// @return Displacement, in bytes.
+  static int64_t DisplacementFromEncoding(
+      const uint32_t encoding, const Arm64Instruction::EPositionDependentKind kind)
+  {
+    using EKind = Arm64Instruction::EPositionDependentKind;
+
+    switch (kind)
+    {
+      case EKind::Adr:
+      case EKind::Adrp:
+      {
+        const uint64_t immediate =
+            ((static_cast<uint64_t>((encoding >> 5) & 0x7ffff) << 2) | ((encoding >> 29) & 0x3));
+        return (SignExtend(immediate, 21) << ((EKind::Adrp == kind) ? kAdrpPageShift : 0));
+      }
+
+      case EKind::Branch:
+        // Conditional branches that always branch are classified as unconditional branches but
+        // keep their own encoding.
+        if (0x54000000 == (encoding & 0xff000000))
+          return (SignExtend((encoding >> 5) & 0x7ffff, 19) << 2);
+        return (SignExtend(encoding & 0x3ffffff, 26) << 2);
+
+      case EKind::BranchWithLink:
+        return (SignExtend(encoding & 0x3ffffff, 26) << 2);
+
+      case EKind::LoadLiteral:
+      case EKind::PrefetchLiteral:
+      case EKind::ConditionalBranch:
+      case EKind::CompareAndBranch:
+        return (SignExtend((encoding >> 5) & 0x7ffff, 19) << 2);
+
+      case EKind::TestAndBranch:
+        return (SignExtend((encoding >> 5) & 0x3fff, 14) << 2);
+
+      default:
+        return 0;
+    }
+  }
+
+  /// Accumulates instructions and literals in a buffer, keeping track of where each one will
+  /// execute.
+  class InstructionWriter
+  {
+  public:
+
+    InstructionWriter(
+        void* const destination,
+        const int destinationSizeBytes,
+        const uint64_t destinationExecutionAddress)
+        : buf(reinterpret_cast<uint8_t*>(destination)),
+          sizeBytes(destinationSizeBytes),
+          executionAddress(destinationExecutionAddress),
+          numBytesWritten(0),
+          overflowed(false)
+    {}
+
+    /// Retrieves the address at which the next instruction written will execute.
+    /// @return Execution address of the next instruction.
+    inline uint64_t CurrentExecutionAddress(void) const
+    {
+      return (executionAddress + static_cast<uint64_t>(numBytesWritten));
+    }
+
+    /// Retrieves the number of bytes written, or 0 if the buffer was too small for everything.
+    /// @return Number of bytes written.
+    inline int Result(void) const
+    {
+      return ((true == overflowed) ? 0 : numBytesWritten);
+    }
+
+    /// Appends a single instruction.
+    /// @param [in] encoding Instruction encoding.
+    inline void Instruction(const uint32_t encoding)
+    {
+      Append(&encoding, sizeof(encoding));
+    }
+
+    /// Appends a 64-bit literal.
+    /// @param [in] value Value of the literal.
+    inline void Literal(const uint64_t value)
+    {
+      Append(&value, sizeof(value));
+    }
+
+  private:
+
+    /// Appends raw bytes, unless the buffer is too small for them.
+    /// @param [in] data Bytes to append.
+    /// @param [in] numBytes Number of bytes to append.
+    inline void Append(const void* const data, const int numBytes)
+    {
+      if ((true == overflowed) || ((sizeBytes - numBytesWritten) < numBytes))
+      {
+        overflowed = true;
+        return;
+      }
+
+      std::memcpy(&buf[numBytesWritten], data, static_cast<size_t>(numBytes));
+      numBytesWritten += numBytes;
+    }
+
+    /// Destination buffer.
+    uint8_t* const buf;
+
+    /// Size of the destination buffer, in bytes.
+    const int sizeBytes;
+
+    /// Address at which the beginning of the destination buffer will execute.
+    const uint64_t executionAddress;
+
+    /// Number of bytes written so far.
+    int numBytesWritten;
+
+    /// Whether or not anything failed to fit in the destination buffer.
+    bool overflowed;
+  };
+
+  /// Appends a sequence that loads a 64-bit value into a register from an inline literal and
+  /// skips over the literal, which consists of `ldr xt, #8`, `b #12`, and the literal itself.
+  /// @param [in, out] writer Writer to which the sequence is appended.
+  /// @param [in] reg Number of the register into which the value is loaded.
+  /// @param [in] value Value to load.
+  static void WriteLoadValue(InstructionWriter& writer, const uint32_t reg, const uint64_t value)
+  {
+    writer.Instruction(kLoadLiteral64Instruction | (2u << 5) | reg);
+    writer.Instruction(kBranchInstruction | 3u);
+    writer.Literal(value);
+  }
+
+  /// Appends an absolute jump sequence, which consists of `ldr x16, #8`, `br x16`, and the target
+  /// address.
+  /// @param [in, out] writer Writer to which the sequence is appended.
+  /// @param [in] target Target address of the jump.
+  static void WriteAbsoluteJump(InstructionWriter& writer, const uint64_t target)
+  {
+    writer.Instruction(kLoadLiteral64Instruction | (2u << 5) | kBranchScratchRegister);
+    writer.Instruction(kBranchRegisterInstruction | (kBranchScratchRegister << 5));
+    writer.Literal(target);
+  }
+
+  /// Appends a jump to the specified target, which is a single `b` instruction if the target is
+  /// within reach and an absolute jump sequence otherwise.
+  /// @param [in, out] writer Writer to which the jump is appended.
+  /// @param [in] target Target address of the jump.
+  static void WriteJump(InstructionWriter& writer, const uint64_t target)
+  {
+    const int64_t displacement =
+        static_cast<int64_t>(target - writer.CurrentExecutionAddress());
+
+    if (true == DisplacementFits(displacement, 26, 2))
+      writer.Instruction(WithField(kBranchInstruction, displacement >> 2, 0, 26));
+    else
+      WriteAbsoluteJump(writer, target);
+  }
+
+  Arm64Instruction::Arm64Instruction(void)
+      : address(nullptr), encoding(0), positionDependentKind(EPositionDependentKind::None)
+  {}
+
+  bool Arm64Instruction::CanWriteJumpInstruction(const void* const from, const void* const to)
+  {
+    const int64_t displacement = static_cast<int64_t>(
+        static_cast<uint64_t>(reinterpret_cast<uintptr_t>(to)) -
+        static_cast<uint64_t>(reinterpret_cast<uintptr_t>(from)));
+    return DisplacementFits(displacement, 26, 2);
+  }
+
+  void Arm64Instruction::FillWithNop(void* const buf, const size_t numBytes)
+  {
+    uint8_t* const bufBytes = reinterpret_cast<uint8_t*>(buf);
+
+    for (size_t i = 0; (i + sizeof(kNopInstruction)) <= numBytes; i += sizeof(kNopInstruction))
+      std::memcpy(&bufBytes[i], &kNopInstruction, sizeof(kNopInstruction));
+  }
+
+  int Arm64Instruction::TransplantInstructions(
+      const void* const src,
+      const int minLengthBytes,
+      void* const dst,
+      const int dstSizeBytes,
+      int* const numRelocatedBytes)
+  {
+    const uint8_t* const srcBytes = reinterpret_cast<const uint8_t*>(src);
+    uint8_t* const dstBytes = reinterpret_cast<uint8_t*>(dst);
+
+    int numSrcBytes = 0;
+    int numDstBytes = 0;
+    bool reachedTerminal = false;
+
+    while ((numSrcBytes < minLengthBytes) && (false == reachedTerminal))
+    {
+      Arm64Instruction instruction;
+      if (false == instruction.DecodeInstruction(&srcBytes[numSrcBytes])) return 0;
+
+      const int numBytesWritten =
+          instruction.EncodeInstruction(&dstBytes[numDstBytes], dstSizeBytes - numDstBytes);
+      if (0 == numBytesWritten) return 0;
+
+      numSrcBytes += kInstructionLengthBytes;
+      numDstBytes += numBytesWritten;
+      reachedTerminal = instruction.IsTerminal();
+    }
+
+    if (false == reachedTerminal)
+    {
+      InstructionWriter writer(
+          &dstBytes[numDstBytes],
+          dstSizeBytes - numDstBytes,
+          static_cast<uint64_t>(reinterpret_cast<uintptr_t>(&dstBytes[numDstBytes])));
+      WriteJump(
+          writer, static_cast<uint64_t>(reinterpret_cast<uintptr_t>(&srcBytes[numSrcBytes])));
+      if (0 == writer.Result()) return 0;
+
+      numDstBytes += writer.Result();
+    }
+
+    if (nullptr != numRelocatedBytes) *numRelocatedBytes = numSrcBytes;
+    return numDstBytes;
+  }
+
+  bool Arm64Instruction::WriteJumpInstruction(
+      void* const where, const int whereSizeBytes, const void* const to)
+  {
+    if (whereSizeBytes < kJumpInstructionLengthBytes) return false;
+    if (false == CanWriteJumpInstruction(where, to)) return false;
+
+    InstructionWriter writer(
+        where, whereSizeBytes, static_cast<uint64_t>(reinterpret_cast<uintptr_t>(where)));
+    WriteJump(writer, static_cast<uint64_t>(reinterpret_cast<uintptr_t>(to)));
+    return (kJumpInstructionLengthBytes == writer.Result());
+  }
+
+  bool Arm64Instruction::WriteAbsoluteJumpInstruction(
+      void* const where, const int whereSizeBytes, const void* const to)
+  {
+    InstructionWriter writer(
+        where, whereSizeBytes, static_cast<uint64_t>(reinterpret_cast<uintptr_t>(where)));
+    WriteAbsoluteJump(writer, static_cast<uint64_t>(reinterpret_cast<uintptr_t>(to)));
+    return (kAbsoluteJumpInstructionLengthBytes == writer.Result());
+  }
+
+  bool Arm64Instruction::DecodeInstruction(const void* const instruction)
+  {
+    if (nullptr == instruction) return false;
+
+    uint32_t instructionEncoding = 0;
+    std::memcpy(&instructionEncoding, instruction, sizeof(instructionEncoding));
+    return DecodeInstruction(instructionEncoding, instruction);
+  }
+
+  bool Arm64Instruction::DecodeInstruction(
+      const uint32_t instructionEncoding, const void* const instruction)
+  {
+    if ((nullptr == instruction) ||
+        (0 != (reinterpret_cast<uintptr_t>(instruction) % kInstructionLengthBytes)))
+    {
+      address = nullptr;
+      return false;
+    }
+
+    address = instruction;
+    encoding = instructionEncoding;
+    positionDependentKind = PositionDependentKindFromEncoding(instructionEncoding);
+    return true;
+  }
+
+  int Arm64Instruction::EncodeInstruction(
+      void* const buf, const int maxLengthBytes, const void* const executionAddress) const
+  {
+    if (false == IsValid()) return 0;
+
+    InstructionWriter writer(
+        buf,
+        maxLengthBytes,
+        static_cast<uint64_t>(reinterpret_cast<uintptr_t>(
+            (nullptr == executionAddress) ? buf : executionAddress)));
+
+    const uint64_t target =
+        static_cast<uint64_t>(reinterpret_cast<uintptr_t>(GetAbsoluteMemoryReferenceTarget()));
+    const uint64_t pc = writer.CurrentExecutionAddress();
+    const int64_t displacement = static_cast<int64_t>(target - pc);
+    const uint32_t reg = (encoding & 0x1f);
+
+    switch (positionDependentKind)
+    {
+      case EPositionDependentKind::None:
+        writer.Instruction(encoding);
+        break;
+
+      case EPositionDependentKind::Adr:
+        // The destination register of `adr` can be the zero register, in which case it has no
+        // effect, but that of `add` would instead be the stack pointer.
+        if (kZeroRegister == reg)
+        {
+          writer.Instruction(kNopInstruction);
+        }
+        else if (true == DisplacementFits(displacement, 21, 0))
+        {
+          writer.Instruction(WithField(
+              WithField(encoding, static_cast<uint64_t>(displacement) >> 2, 5, 19),
+              static_cast<uint64_t>(displacement),
+              29,
+              2));
+        }
+        else
+        {
+          const int64_t pageDisplacement = static_cast<int64_t>(
+              (target >> kAdrpPageShift) - (pc >> kAdrpPageShift));
+          if (true == DisplacementFits(pageDisplacement, 21, 0))
+          {
+            writer.Instruction(WithField(
+                WithField(
+                    kAdrpInstruction | reg, static_cast<uint64_t>(pageDisplacement) >> 2, 5, 19),
+                static_cast<uint64_t>(pageDisplacement),
+                29,
+                2));
+            writer.Instruction(WithField(
+                kAddImmediate64Instruction | (reg << 5) | reg,
+                target & ((1ull << kAdrpPageShift) - 1),
+                10,
+                12));
+          }
+          else
+          {
+            WriteLoadValue(writer, reg, target);
+          }
+        }
+        break;
+
+      case EPositionDependentKind::Adrp:
+      {
+        const int64_t pageDisplacement =
+            static_cast<int64_t>((target >> kAdrpPageShift) - (pc >> kAdrpPageShift));
+
+        if (kZeroRegister == reg)
+          writer.Instruction(kNopInstruction);
+        else if (true == DisplacementFits(pageDisplacement, 21, 0))
+          writer.Instruction(WithField(
+              WithField(encoding, static_cast<uint64_t>(pageDisplacement) >> 2, 5, 19),
+              static_cast<uint64_t>(pageDisplacement),
+              29,
+              2));
+        else
+          WriteLoadValue(writer, reg, target);
+        break;
+      }
+
+      case EPositionDependentKind::LoadLiteral:
+        if (true == DisplacementFits(displacement, 19, 2))
+        {
+          writer.Instruction(WithField(encoding, displacement >> 2, 5, 19));
+        }
+        else
+        {
+          // General-purpose registers are loaded with the address of the literal and then with
+          // the literal itself, but SIMD registers cannot hold an address and neither can the
+          // zero register, so the scratch register is used instead.
+          const uint32_t opc = (encoding >> 30);
+          const uint32_t isSimd = ((encoding >> 26) & 1);
+          const uint32_t baseReg =
+              (((0 != isSimd) || (kZeroRegister == reg)) ? kLoadScratchRegister : reg);
+
+          writer.Instruction(kLoadLiteral64Instruction | (3u << 5) | baseReg);
+          writer.Instruction(kLoadRegisterInstructions[isSimd][opc] | (baseReg << 5) | reg);
+          writer.Instruction(kBranchInstruction | 3u);
+          writer.Literal(target);
+        }
+        break;
+
+      case EPositionDependentKind::PrefetchLiteral:
+        // A prefetch is only a hint, so one that cannot reach its target is simply dropped.
+        if (true == DisplacementFits(displacement, 19, 2))
+          writer.Instruction(WithField(encoding, displacement >> 2, 5, 19));
+        else
+          writer.Instruction(kNopInstruction);
+        break;
+
+      case EPositionDependentKind::Branch:
+        if (0x54000000 == (encoding & 0xff000000))
+        {
+          if (true == DisplacementFits(displacement, 19, 2))
+          {
+            writer.Instruction(WithField(encoding, displacement >> 2, 5, 19));
+            break;
+          }
+        }
+
+        WriteJump(writer, target);
+        break;
+
+      case EPositionDependentKind::BranchWithLink:
+        if (true == DisplacementFits(displacement, 26, 2))
+        {
+          writer.Instruction(WithField(encoding, displacement >> 2, 0, 26));
+        }
+        else
+        {
+          // The call returns to the branch that skips over the literal.
+          writer.Instruction(kLoadLiteral64Instruction | (3u << 5) | kBranchScratchRegister);
+          writer.Instruction(kBranchWithLinkRegisterInstruction | (kBranchScratchRegister << 5));
+          writer.Instruction(kBranchInstruction | 3u);
+          writer.Literal(target);
+        }
+        break;
+
+      case EPositionDependentKind::ConditionalBranch:
+      case EPositionDependentKind::CompareAndBranch:
+      case EPositionDependentKind::TestAndBranch:
+      {
+        const int immediateWidthBits =
+            ((EPositionDependentKind::TestAndBranch == positionDependentKind) ? 14 : 19);
+
+        if (true == DisplacementFits(displacement, immediateWidthBits, 2))
+        {
+          writer.Instruction(WithField(encoding, displacement >> 2, 5, immediateWidthBits));
+        }
+        else
+        {
+          // The condition is inverted so that the branch skips over an absolute jump to the
+          // original target whenever the original branch would not have been taken. Conditions
+          // are inverted by their lowest bit, and the others by the bit that distinguishes zero
+          // from non-zero.
+          const uint32_t invertedEncoding =
+              ((EPositionDependentKind::ConditionalBranch == positionDependentKind)
+                   ? (encoding ^ 1u)
+                   : (encoding ^ (1u << 24)));
+
+          writer.Instruction(WithField(
+              invertedEncoding, kInvertedBranchSkipBytes >> 2, 5, immediateWidthBits));
+          WriteAbsoluteJump(writer, target);
+        }
+        break;
+      }
+    }
+
+    return writer.Result();
+  }
+
+  void* Arm64Instruction::GetAbsoluteMemoryReferenceTarget(void) const
+  {
+    if ((false == IsValid()) || (false == HasPositionDependentMemoryReference())) return nullptr;
+
+    uint64_t base = static_cast<uint64_t>(reinterpret_cast<uintptr_t>(address));
+    if (EPositionDependentKind::Adrp == positionDependentKind)
+      base &= ~((1ull << kAdrpPageShift) - 1);
+
+    return reinterpret_cast<void*>(static_cast<uintptr_t>(
+        base + static_cast<uint64_t>(DisplacementFromEncoding(encoding, positionDependentKind))));
+  }
+
+  bool Arm64Instruction::HasRelativeBranchDisplacement(void) const
+  {
+    switch (positionDependentKind)
+    {
+      case EPositionDependentKind::Branch:
+      case EPositionDependentKind::BranchWithLink:
+      case EPositionDependentKind::ConditionalBranch:
+      case EPositionDependentKind::CompareAndBranch:
+      case EPositionDependentKind::TestAndBranch:
+        return true;
+
+      default:
+        return false;
+    }
+  }
+
+  bool Arm64Instruction::IsTerminal(void) const
+  {
+    if (false == IsValid()) return false;
+    if (EPositionDependentKind::Branch == positionDependentKind) return true;
+
+    // Unconditional branches to registers are distinguished by their `opc` field, which is 0 for
+    // `br`, 2 for `ret`, 4 for `eret`, and 8 for `braa` and `brab`. The remaining values identify
+    // forms that either return to the next instruction, such as `blr`, or are not allocated.
+    if (0xd6000000 != (encoding & 0xfe000000)) return false;
+
+    switch ((encoding >> 21) & 0xf)
+    {
+      case 0:
+      case 2:
+      case 4:
+      case 8:
+        return true;
+
+      default:
+        return false;
+    }
+  }
+} // namespace Hookshot
@@ -0,0 +1,234 @@
+/***************************************************************************************************
+ * Hookshot
+ *   General-purpose library for injecting DLLs and hooking function calls.
+ ***************************************************************************************************
+ * Authored by Samuel Grossman
+ * Copyright (c) 2019-2025
+ ***********************************************************************************************//**
+ * @file AsyncHookInstall.cpp
+ *   Implementation of installing large numbers of hooks in the background, with progress
+ *   reporting and cancellation.
+ **************************************************************************************************/
+
+#include "AsyncHookInstall.h"
+
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <mutex>
+#include <vector>
+
+#include <Infra/Core/Message.h>
+
+#include "HookshotTypes.h"
+#include "TaskScheduler.h"
+
+namespace Hookshot
+{
+  /// Holds all of the state of an asynchronous hook installation operation. Owned by the worker
+  /// thread until the operation completes, after which it is owned by whichever thread finishes the
+  /// operation by waiting for it.
+  struct SHookInstallOperation
+  {
+    /// Interface through which hooks are created and undone.
+    IHookshot* hookshot;
+
+    /// Hook specifications, copied from the ones supplied when the operation was started.
+    std::vector<SHookSpec> hookSpecs;
+
+    /// Result of creating each hook, in the same order as the hook specifications.
+    std::vector<EResult> results;
+
+    /// Whether or not each original function was already hooked immediately before the hook
+    /// that targets it was created, in which case the new hook was chained onto an existing one.
+    std::vector<bool> wasAlreadyHooked;
+
+    /// Function to invoke after each batch, or `nullptr` if progress is not reported.
+    THookInstallProgressCallback progressCallback;
+
+    /// Value to pass to the progress callback.
+    void* progressCallbackContext;
+
+    /// Set when cancellation is requested. Checked by the worker thread between batches.
+    std::atomic<bool> isCancelRequested;
+
+    /// Whether or not the operation was cancelled before it completed. Valid once it completes.
+    bool wasCancelled;
+
+    /// Whether or not the operation has completed.
+    bool isComplete;
+
+    /// Protects the completion flag.
+    std::mutex mutex;
+
+    /// Signalled when the operation completes.
+    std::condition_variable completed;
+  };
+
+  namespace AsyncHookInstall
+  {
+    /// Number of hooks created together as a single batch. Each batch locks the hook store and
+    /// suspends other threads once, so larger batches are more efficient, but cancellation is only
+    /// checked and progress only reported between batches.
+    static constexpr size_t kHooksPerBatch = 256;
+
+    /// Undoes every hook that an operation created, in the reverse order of creation. Hooks that
+    /// were chained onto already-existing hooks are disabled, since removing them would remove the
+    /// existing hooks as well.
+    /// @param [in,out] operation Operation whose hooks are to be undone.
+    /// @param [in] numHooksProcessed Number of hooks whose creation was attempted.
+    /// @return Number of hooks that could not be undone.
+    static size_t RollBack(SHookInstallOperation* operation, size_t numHooksProcessed)
+    {
+      size_t numHooksNotUndone = 0;
+
+      for (size_t i = numHooksProcessed; i > 0; --i)
+      {
+        const size_t index = i - 1;
+        if (EResult::Success != operation->results[index]) continue;
+
+        const void* const hookFunc = operation->hookSpecs[index].hookFunc;
+        const EResult undoResult = (true == operation->wasAlreadyHooked[index])
+            ? operation->hookshot->DisableHookFunction(hookFunc)
+            : operation->hookshot->RemoveHook(hookFunc);
+
+        // A hook that was chained onto another hook created by the same operation is removed
+        // along with that hook, so it might already be gone.
+        if ((false == SuccessfulResult(undoResult)) && (EResult::FailNotFound != undoResult))
+          numHooksNotUndone += 1;
+
+        operation->results[index] = EResult::FailCancelled;
+      }
+
+      return numHooksNotUndone;
+    }
+
+    /// Task that performs an entire asynchronous hook installation operation.
+    /// @param [in] context Pointer to the SHookInstallOperation object representing the operation.
+    static void HookInstallTask(void* context)
+    {
+      SHookInstallOperation* const operation = reinterpret_cast<SHookInstallOperation*>(context);
+      const size_t numHooksTotal = operation->hookSpecs.size();
+
+      size_t numHooksProcessed = 0;
+      while ((numHooksProcessed < numHooksTotal) && (false == operation->isCancelRequested))
+      {
+        const size_t numHooksInBatch = std::min(kHooksPerBatch, numHooksTotal - numHooksProcessed);
+
+        for (size_t i = numHooksProcessed; i < (numHooksProcessed + numHooksInBatch); ++i)
+          operation->wasAlreadyHooked[i] =
+              (nullptr !=
+               operation->hookshot->GetOriginalFunction(operation->hookSpecs[i].originalFunc));
+
+        operation->hookshot->CreateHooks(
+            &operation->hookSpecs[numHooksProcessed],
+            numHooksInBatch,
+            &operation->results[numHooksProcessed]);
+        numHooksProcessed += numHooksInBatch;
+
+        if (nullptr != operation->progressCallback)
+          operation->progressCallback(
+              operation->progressCallbackContext, numHooksProcessed, numHooksTotal);
+      }
+
+      const bool wasCancelled = operation->isCancelRequested;
+      if (true == wasCancelled)
+      {
+        const size_t numHooksNotUndone = RollBack(operation, numHooksProcessed);
+
+        Infra::Message::OutputFormatted(
+            ((0 == numHooksNotUndone) ? Infra::Message::ESeverity::Info
+                                      : Infra::Message::ESeverity::Warning),
+            L"Cancelled asynchronous installation of %llu hook(s) after attempting %llu, failing to undo %llu.",
+            static_cast<unsigned long long>(numHooksTotal),
+            static_cast<unsigned long long>(numHooksProcessed),
+            static_cast<unsigned long long>(numHooksNotUndone));
+      }
+      else
+      {
+        Infra::Message::OutputFormatted(
+            Infra::Message::ESeverity::Info,
+            L"Completed asynchronous installation of %llu hook(s), of which %llu were created.",
+            static_cast<unsigned long long>(numHooksTotal),
+            static_cast<unsigned long long>(std::count(
+                operation->results.cbegin(), operation->results.cend(), EResult::Success)));
+      }
+
+      std::unique_lock<std::mutex> lock(operation->mutex);
+      operation->wasCancelled = wasCancelled;
+      operation->isComplete = true;
+      operation->completed.notify_all();
+    }
+
+    EResult Begin(
+        IHookshot* hookshot,
+        const SHookSpec* hookSpecs,
+        size_t numHookSpecs,
+        THookInstallProgressCallback progressCallback,
+        void* progressCallbackContext,
+        SHookInstallOperation** operation)
+    {
+      if (nullptr == operation) return EResult::FailInvalidArgument;
+      if ((nullptr == hookSpecs) && (0 != numHookSpecs)) return EResult::FailInvalidArgument;
+
+      // Hooks not yet attempted when the operation is cancelled keep this result.
+      SHookInstallOperation* const newOperation = new SHookInstallOperation();
+      newOperation->hookshot = hookshot;
+      newOperation->hookSpecs.assign(hookSpecs, hookSpecs + numHookSpecs);
+      newOperation->results.assign(numHookSpecs, EResult::FailCancelled);
+      newOperation->wasAlreadyHooked.assign(numHookSpecs, false);
+      newOperation->progressCallback = progressCallback;
+      newOperation->progressCallbackContext = progressCallbackContext;
+      newOperation->isCancelRequested = false;
+      newOperation->wasCancelled = false;
+      newOperation->isComplete = false;
+
+      TaskScheduler::Submit(HookInstallTask, newOperation);
+
+      *operation = newOperation;
+      return EResult::Success;
+    }
+
+    EResult Cancel(SHookInstallOperation* operation)
+    {
+      if (nullptr == operation) return EResult::FailInvalidArgument;
+
+      operation->isCancelRequested = true;
+      return EResult::Success;
+    }
+
+    EResult Wait(SHookInstallOperation* operation, EResult* results)
+    {
+      if (nullptr == operation) return EResult::FailInvalidArgument;
+
+      do
+      {
+        std::unique_lock<std::mutex> lock(operation->mutex);
+        operation->completed.wait(
+            lock, [operation]() -> bool { return (true == operation->isComplete); });
+      }
+      while (false);
+
+      if (nullptr != results)
+        std::copy(operation->results.cbegin(), operation->results.cend(), results);
+
+      EResult overallResult = EResult::Success;
+      if (true == operation->wasCancelled)
+      {
+        overallResult = EResult::FailCancelled;
+      }
+      else
+      {
+        const auto firstFailure = std::find_if(
+            operation->results.cbegin(),
+            operation->results.cend(),
+            [](EResult result) -> bool { return (false == SuccessfulResult(result)); });
+        if (operation->results.cend() != firstFailure) overallResult = *firstFailure;
+      }
+
+      delete operation;
+      return overallResult;
+    }
+  } // namespace AsyncHookInstall
+} // namespace Hookshot
@@ -0,0 +1,321 @@
+/***************************************************************************************************
+ * Hookshot
+ *   General-purpose library for injecting DLLs and hooking function calls.
+ ***************************************************************************************************
+ * Authored by Samuel Grossman
+ * Copyright (c) 2019-2025
+ ***********************************************************************************************//**
+ * @file BatchLaunch.cpp
+ *   Creation and injection of many programs, listed in a manifest file, from a single process.
+ **************************************************************************************************/
+
+#include "BatchLaunch.h"
+
+#include <algorithm>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include <Infra/Core/Message.h>
+#include <Infra/Core/ProcessInfo.h>
+#include <Infra/Core/Strings.h>
+
+#include "ApiWindows.h"
+#include "InjectResult.h"
+#include "ProcessInjector.h"
+
+namespace Hookshot
+{
+  namespace BatchLaunch
+  {
+    /// Outcome of launching a single command line from the manifest.
+    struct SLaunchResult
+    {
+      /// Result of creating and injecting the program.
+      EInjectResult result;
+
+      /// System error code captured when creation or injection failed.
+      DWORD systemErrorCode;
+
+      /// Exit code of the program, valid only if it was successfully launched.
+      DWORD exitCode;
+    };
+
+    /// Information shared by every thread that launches programs from the manifest.
+    struct SBatch
+    {
+      /// Command lines to launch, in manifest order.
+      const std::vector<std::wstring>& commandLines;
+
+      /// Index of the next command line to be launched by whichever thread gets to it first.
+      std::atomic<size_t> nextIndex;
+
+      /// Outcome of each launch, in the same order as the command lines.
+      std::vector<SLaunchResult> results;
+    };
+
+    /// Reads the command lines listed in a manifest file.
+    /// @param [in] manifestFilename Name of the manifest file.
+    /// @param [out] commandLines Filled with the command lines, in the order they are listed.
+    /// @return `true` if the manifest was read, `false` otherwise.
+    static bool ReadManifest(
+        std::wstring_view manifestFilename, std::vector<std::wstring>& commandLines)
+    {
+      const HANDLE manifestFile = CreateFile(
+          std::wstring(manifestFilename).c_str(),
+          GENERIC_READ,
+          FILE_SHARE_READ,
+          nullptr,
+          OPEN_EXISTING,
+          FILE_FLAG_SEQUENTIAL_SCAN,
+          nullptr);
+      if (INVALID_HANDLE_VALUE == manifestFile) return false;
+
+      LARGE_INTEGER manifestSize = {};
+      if ((FALSE == GetFileSizeEx(manifestFile, &manifestSize)) ||
+          (manifestSize.QuadPart > static_cast<LONGLONG>(INT32_MAX)))
+      {
+        CloseHandle(manifestFile);
+        return false;
+      }
+
+      if (0 == manifestSize.QuadPart)
+      {
+        CloseHandle(manifestFile);
+        return true;
+      }
+
+      std::string manifestBytes(static_cast<size_t>(manifestSize.QuadPart), '\0');
+      DWORD numBytesRead = 0;
+      const bool readSucceeded =
+          ((FALSE !=
+            ReadFile(
+                manifestFile,
+                manifestBytes.data(),
+                static_cast<DWORD>(manifestBytes.size()),
+                &numBytesRead,
+                nullptr)) &&
+           (static_cast<DWORD>(manifestBytes.size()) == numBytesRead));
+      CloseHandle(manifestFile);
+      if (false == readSucceeded) return false;
+
+      std::wstring manifestText;
+      if ((manifestBytes.size() >= 2) && ('\xff' == manifestBytes[0]) &&
+          ('\xfe' == manifestBytes[1]))
+      {
+        manifestText.assign(
+            reinterpret_cast<const wchar_t*>(&manifestBytes[2]),
+            (manifestBytes.size() - 2) / sizeof(wchar_t));
+      }
+      else
+      {
+        std::string_view manifestUtf8(manifestBytes);
+        if (true == manifestUtf8.starts_with("\xef\xbb\xbf")) manifestUtf8.remove_prefix(3);
+
+        const int manifestTextLength = MultiByteToWideChar(
+            CP_UTF8,
+            0,
+            manifestUtf8.data(),
+            static_cast<int>(manifestUtf8.length()),
+            nullptr,
+            0);
+        manifestText.resize(static_cast<size_t>(std::max(manifestTextLength, 0)));
+        MultiByteToWideChar(
+            CP_UTF8,
+            0,
+            manifestUtf8.data(),
+            static_cast<int>(manifestUtf8.length()),
+            manifestText.data(),
+            static_cast<int>(manifestText.length()));
+      }
+
+      constexpr std::wstring_view kWhitespace = L" \t\r";
+
+      size_t lineStart = 0;
+      while (lineStart < manifestText.length())
+      {
+        size_t lineEnd = manifestText.find(L'\n', lineStart);
+        if (std::wstring::npos == lineEnd) lineEnd = manifestText.length();
+
+        std::wstring_view line(&manifestText[lineStart], lineEnd - lineStart);
+        lineStart = lineEnd + 1;
+
+        const size_t firstNonWhitespace = line.find_first_not_of(kWhitespace);
+        if (std::wstring_view::npos == firstNonWhitespace) continue;
+
+        line.remove_prefix(firstNonWhitespace);
+        line.remove_suffix(line.length() - (line.find_last_not_of(kWhitespace) + 1));
+        if (L';' == line.front()) continue;
+
+        commandLines.emplace_back(line);
+      }
+
+      return true;
+    }
+
+    /// Launches and injects a single command line and waits for the program to exit.
+    /// @param [in] commandLine Command line to launch.
+    /// @return Outcome of the launch.
+    static SLaunchResult LaunchAndWait(const std::wstring& commandLine)
+    {
+      SLaunchResult launchResult = {
+          .result = EInjectResult::Failure, .systemErrorCode = ERROR_SUCCESS, .exitCode = 0};
+
+      // Process creation is allowed to modify the command line, so each launch has its own copy.
+      std::wstring mutableCommandLine(commandLine);
+      STARTUPINFO startupInfo = {.cb = sizeof(startupInfo)};
+      PROCESS_INFORMATION processInfo = {};
+
+      launchResult.result = ProcessInjector::CreateInjectedProcess(
+          nullptr,
+          mutableCommandLine.data(),
+          nullptr,
+          nullptr,
+          FALSE,
+          0,
+          nullptr,
+          nullptr,
+          &startupInfo,
+          &processInfo);
+
+      if (EInjectResult::Success == launchResult.result)
+      {
+        WaitForSingleObject(processInfo.hProcess, INFINITE);
+        GetExitCodeProcess(processInfo.hProcess, &launchResult.exitCode);
+      }
+      else
+      {
+        launchResult.systemErrorCode = GetLastError();
+      }
+
+      if (nullptr != processInfo.hThread) CloseHandle(processInfo.hThread);
+      if (nullptr != processInfo.hProcess) CloseHandle(processInfo.hProcess);
+
+      return launchResult;
+    }
+
+    /// Executed by each launching thread. Repeatedly takes the next command line that has not yet
+    /// been launched, launches it, and waits for it to exit, until none are left.
+    /// @param [in] lpParameter Pointer to the shared batch information structure.
+    /// @return Always 0.
+    static DWORD WINAPI LaunchThreadProc(LPVOID lpParameter)
+    {
+      SBatch& batch = *reinterpret_cast<SBatch*>(lpParameter);
+
+      for (size_t index = batch.nextIndex.fetch_add(1, std::memory_order_relaxed);
+           index < batch.commandLines.size();
+           index = batch.nextIndex.fetch_add(1, std::memory_order_relaxed))
+      {
+        const SLaunchResult launchResult = LaunchAndWait(batch.commandLines[index]);
+        batch.results[index] = launchResult;
+
+        if (EInjectResult::Success == launchResult.result)
+          Infra::Message::OutputFormatted(
+              Infra::Message::ESeverity::Info,
+              L"Batch launch %u: %s exited with code %u.",
+              (unsigned int)(index + 1),
+              batch.commandLines[index].c_str(),
+              (unsigned int)launchResult.exitCode);
+        else
+          Infra::Message::OutputFormatted(
+              Infra::Message::ESeverity::Error,
+              L"Batch launch %u: Failed to inject %s: %s (%s)",
+              (unsigned int)(index + 1),
+              batch.commandLines[index].c_str(),
+              InjectResultString(launchResult.result).data(),
+              Infra::Strings::FromSystemErrorCode(launchResult.systemErrorCode).AsCString());
+      }
+
+      return 0;
+    }
+
+    int Run(unsigned int maxConcurrentLaunches, std::wstring_view manifestFilename)
+    {
+      std::vector<std::wstring> commandLines;
+      if (false == ReadManifest(manifestFilename, commandLines))
+      {
+        Infra::Message::OutputFormatted(
+            Infra::Message::ESeverity::ForcedInteractiveError,
+            L"Failed to read batch launch manifest %.*s (%s).",
+            static_cast<int>(manifestFilename.length()),
+            manifestFilename.data(),
+            Infra::Strings::FromSystemErrorCode(GetLastError()).AsCString());
+        return __LINE__;
+      }
+
+      if (true == commandLines.empty())
+      {
+        Infra::Message::OutputFormatted(
+            Infra::Message::ESeverity::ForcedInteractiveError,
+            L"Batch launch manifest %.*s does not list any command lines.",
+            static_cast<int>(manifestFilename.length()),
+            manifestFilename.data());
+        return __LINE__;
+      }
+
+      SBatch batch = {
+          .commandLines = commandLines,
+          .nextIndex = 0,
+          .results = std::vector<SLaunchResult>(
+              commandLines.size(),
+              {.result = EInjectResult::Failure,
+               .systemErrorCode = ERROR_SUCCESS,
+               .exitCode = 0})};
+
+      const unsigned int numThreads = static_cast<unsigned int>(
+          std::min(static_cast<size_t>(maxConcurrentLaunches), commandLines.size()));
+      Infra::Message::OutputFormatted(
+          Infra::Message::ESeverity::Info,
+          L"Launching %u command line(s) from %.*s, at most %u at a time.",
+          (unsigned int)commandLines.size(),
+          static_cast<int>(manifestFilename.length()),
+          manifestFilename.data(),
+          numThreads);
+
+      std::vector<HANDLE> threadHandles;
+      for (unsigned int i = 0; i < numThreads; ++i)
+      {
+        const HANDLE threadHandle =
+            CreateThread(nullptr, 0, LaunchThreadProc, &batch, 0, nullptr);
+        if (nullptr != threadHandle) threadHandles.push_back(threadHandle);
+      }
+
+      // If no thread could be created, this thread launches everything one at a time instead.
+      if (true == threadHandles.empty()) LaunchThreadProc(&batch);
+
+      // Waiting for multiple objects is limited in how many it can wait for at a time.
+      for (const HANDLE threadHandle : threadHandles)
+      {
+        WaitForSingleObject(threadHandle, INFINITE);
+        CloseHandle(threadHandle);
+      }
+
+      const unsigned int numFailed = static_cast<unsigned int>(std::count_if(
+          batch.results.begin(),
+          batch.results.end(),
+          [](const SLaunchResult& launchResult) -> bool
+          {
+            return (EInjectResult::Success != launchResult.result);
+          }));
+
+      if (0 != numFailed)
+      {
+        Infra::Message::OutputFormatted(
+            Infra::Message::ESeverity::ForcedInteractiveError,
+            L"%.*s failed to inject %u of %u command line(s) from %.*s. See the log for details.",
+            static_cast<int>(Infra::ProcessInfo::GetProductName().length()),
+            Infra::ProcessInfo::GetProductName().data(),
+            numFailed,
+            (unsigned int)commandLines.size(),
+            static_cast<int>(manifestFilename.length()),
+            manifestFilename.data());
+        return __LINE__;
+      }
+
+      return 0;
+    }
+  } // namespace BatchLaunch
+} // namespace Hookshot
@@ -0,0 +1,655 @@
+/***************************************************************************************************
+ * Hookshot
+ *   General-purpose library for injecting DLLs and hooking function calls.
+ ***************************************************************************************************
+ * Authored by Samuel Grossman
+ * Copyright (c) 2019-2025
+ ***********************************************************************************************//**
+ * @file BenchmarkMain.cpp
+ *   Entry point for the benchmark executable, which measures the performance of common Hookshot
+ *   operations so that regressions can be caught before release.
+ **************************************************************************************************/
+
+#include <windows.h>
+#include <intrin.h>
+
+#include <algorithm>
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <cwchar>
+#include <string_view>
+#include <vector>
+
+#include "BenchmarkTiming.h"
+#include "EngineComparison.h"
+#include "FunctionGenerator.h"
+#include "Hookshot.h"
+#include "InstructionBenchmark.h"
+#include "TestGlobals.h"
+#include "TransplantFuzzer.h"
+#include "X86Instruction.h"
+
+extern "C" size_t __fastcall CallOverhead_Baseline(size_t scx, size_t sdx);
+extern "C" size_t __fastcall CallOverheadHooked_Original(size_t scx, size_t sdx);
+extern "C" size_t __fastcall CallOverheadHooked_Hook(size_t scx, size_t sdx);
+extern "C" size_t __fastcall CallOverheadDisabled_Original(size_t scx, size_t sdx);
+extern "C" size_t __fastcall CallOverheadDisabled_Hook(size_t scx, size_t sdx);
+extern "C" size_t __fastcall CallOverheadGuarded_Original(size_t scx, size_t sdx);
+extern "C" size_t __fastcall CallOverheadGuarded_Hook(size_t scx, size_t sdx);
+
+namespace HookshotBenchmark
+{
+  using namespace ::HookshotTest;
+
+  /// Pointer-to-function type for the functions used in the call overhead measurement.
+  using TCallOverheadFunction = size_t(__fastcall*)(size_t, size_t);
+
+  /// Number of generated functions used for the largest hook creation measurement, which are also
+  /// used for the lookup measurement.
+  static constexpr size_t kNumFunctionsLarge = 10000;
+
+  /// Number of generated functions used for the medium-sized hook creation measurement.
+  static constexpr size_t kNumFunctionsMedium = 100;
+
+  /// Number of generated functions used for the smallest hook creation measurement.
+  static constexpr size_t kNumFunctionsSmall = 1;
+
+  /// Number of functions hooked during the scalability measurement. These are generated at run
+  /// time because generating this many functions at compile time is impractical.
+  static constexpr size_t kNumFunctionsScale = 100000;
+
+  /// Number of hooks created between measurements during the scalability measurement.
+  static constexpr size_t kNumFunctionsPerScaleBatch = 10000;
+
+  /// Size of each function generated at run time for the scalability measurement, in bytes.
+  static constexpr size_t kScaleFunctionSizeBytes = 16;
+
+  /// Number of lookups each thread performs between timestamps during the lookup measurement.
+  static constexpr size_t kNumLookupsPerSample = 1000;
+
+  /// Number of timed samples each thread collects during the lookup measurement.
+  static constexpr size_t kNumLookupSamplesPerThread = 1000;
+
+  /// Thread counts used for the lookup measurement.
+  static constexpr unsigned int kLookupThreadCounts[] = {1, 2, 4, 8, 16};
+
+  /// Number of times a hook function is replaced during the toggle measurement.
+  static constexpr size_t kNumReplaceToggles = 10000;
+
+  /// Number of calls made between timestamps during the call overhead measurement.
+  static constexpr size_t kNumCallsPerSample = 1000;
+
+  /// Number of timed samples collected for each function during the call overhead measurement.
+  static constexpr size_t kNumCallSamples = 10000;
+
+  /// Number of instruction streams generated during transplant fuzzing.
+  static constexpr size_t kNumFuzzIterations = 10000;
+
+  /// Command-line option, followed by a number, that specifies the seed used for transplant
+  /// fuzzing so that a run that found a mismatch can be reproduced.
+  static constexpr std::wstring_view kOptionFuzzSeed = L"--fuzz-seed=";
+
+  /// Command-line option, followed by a path, that specifies where the results of the comparison
+  /// with other hooking engines are written as CSV.
+  static constexpr std::wstring_view kOptionEngineCsv = L"--engine-csv=";
+
+  /// Path to which the results of the comparison with other hooking engines are written as CSV if
+  /// no other path is specified on the command line.
+  static constexpr const wchar_t* kDefaultEngineCsvPath = L"HookshotEngineComparison.csv";
+
+  /// Summary statistics for one measurement.
+  struct SLatencySummary
+  {
+    /// Number of operations per second, computed from the total time taken.
+    double operationsPerSecond;
+
+    /// Median latency of a single operation, in nanoseconds.
+    double p50Nanoseconds;
+
+    /// 99th-percentile latency of a single operation, in nanoseconds.
+    double p99Nanoseconds;
+  };
+
+  /// Computes summary statistics for a set of timed samples.
+  /// @param [in,out] sampleTicks Duration of each sample, in performance counter ticks. Sorted by
+  /// this function.
+  /// @param [in] numOperationsPerSample Number of operations each sample represents.
+  /// @return Summary statistics, normalized to a single operation.
+  static SLatencySummary Summarize(
+      std::vector<int64_t>& sampleTicks, const size_t numOperationsPerSample)
+  {
+    if (true == sampleTicks.empty()) return {};
+
+    std::sort(sampleTicks.begin(), sampleTicks.end());
+
+    int64_t totalTicks = 0;
+    for (const int64_t ticks : sampleTicks)
+      totalTicks += ticks;
+
+    const double numOperations =
+        static_cast<double>(sampleTicks.size()) * static_cast<double>(numOperationsPerSample);
+    const size_t p50Index = (sampleTicks.size() * 50) / 100;
+    const size_t p99Index = std::min(sampleTicks.size() - 1, (sampleTicks.size() * 99) / 100);
+
+    return {
+        .operationsPerSecond =
+            ((0 == totalTicks) ? 0.0 : (numOperations / (TicksToNanoseconds(totalTicks) / 1e9))),
+        .p50Nanoseconds = TicksToNanoseconds(sampleTicks[p50Index]) / numOperationsPerSample,
+        .p99Nanoseconds = TicksToNanoseconds(sampleTicks[p99Index]) / numOperationsPerSample};
+  }
+
+  /// Prints a single row of benchmark results.
+  /// @param [in] name Name of the measurement.
+  /// @param [in] summary Summary statistics for the measurement.
+  static void PrintResult(const wchar_t* name, const SLatencySummary& summary)
+  {
+    wprintf(
+        L"%-48s %16.0f ops/s    p50 %10.1f ns    p99 %10.1f ns\n",
+        name,
+        summary.operationsPerSecond,
+        summary.p50Nanoseconds,
+        summary.p99Nanoseconds);
+  }
+
+  /// Prints a single row of call overhead results.
+  /// @param [in] name Name of the measurement.
+  /// @param [in] cyclesPerCall Median number of processor cycles per call.
+  /// @param [in] baselineCyclesPerCall Median number of processor cycles per call to an identical
+  /// function that is not hooked.
+  static void PrintCallOverheadResult(
+      const wchar_t* name, const double cyclesPerCall, const double baselineCyclesPerCall)
+  {
+    wprintf(
+        L"%-48s %10.2f cycles/call    %+10.2f vs. unhooked\n",
+        name,
+        cyclesPerCall,
+        cyclesPerCall - baselineCyclesPerCall);
+  }
+
+  /// Measures how long it takes to decode enough of each function's prologue to transplant it,
+  /// which is the same decoding work Hookshot performs when setting up a trampoline. Must be run
+  /// before the functions are hooked.
+  /// @param [in] funcs Functions whose prologues should be decoded.
+  /// @param [in] numFuncs Number of functions.
+  /// @return Summary statistics, with each function's decode counted as one operation.
+  static SLatencySummary MeasureDecode(const TGeneratedTestFunction* funcs, const size_t numFuncs)
+  {
+    std::vector<int64_t> sampleTicks;
+    sampleTicks.reserve(numFuncs);
+
+    for (size_t i = 0; i < numFuncs; ++i)
+    {
+      const uint8_t* const funcBytes = reinterpret_cast<const uint8_t*>(funcs[i]);
+      int numDecodedBytes = 0;
+
+      const int64_t startTicks = Now();
+      while (numDecodedBytes < Hookshot::X86Instruction::kJumpInstructionLengthBytes)
+      {
+        Hookshot::X86Instruction instruction;
+        if ((false == instruction.DecodeInstruction(&funcBytes[numDecodedBytes])) ||
+            (true == instruction.IsTerminal()))
+          break;
+
+        numDecodedBytes += instruction.GetLengthBytes();
+      }
+      sampleTicks.push_back(Now() - startTicks);
+    }
+
+    return Summarize(sampleTicks, 1);
+  }
+
+  /// Measures how long it takes to create hooks one at a time.
+  /// @param [in] originalFuncs Functions to hook.
+  /// @param [in] hookFuncs Hook functions, one per function to hook.
+  /// @param [in] numFuncs Number of functions to hook.
+  /// @return Summary statistics, with each hook created counted as one operation.
+  static SLatencySummary MeasureCreateHook(
+      const TGeneratedTestFunction* originalFuncs,
+      const TGeneratedTestFunction* hookFuncs,
+      const size_t numFuncs)
+  {
+    std::vector<int64_t> sampleTicks;
+    sampleTicks.reserve(numFuncs);
+
+    for (size_t i = 0; i < numFuncs; ++i)
+    {
+      const int64_t startTicks = Now();
+      const Hookshot::EResult result =
+          HookshotInterface()->CreateHook(originalFuncs[i], hookFuncs[i]);
+      sampleTicks.push_back(Now() - startTicks);
+
+      if (false == Hookshot::SuccessfulResult(result))
+        wprintf(L"    Failed to create hook %llu.\n", (unsigned long long)i);
+    }
+
+    return Summarize(sampleTicks, 1);
+  }
+
+  /// Measures how hook creation scales to a very large number of hooks. Functions are generated at
+  /// run time and hooked in batches, and the throughput of each batch along with the memory that
+  /// Hookshot used for it are printed, so that any growth in the cost per hook as the number of
+  /// hooks grows is visible.
+  static void RunScalabilityBenchmark(void)
+  {
+    // Original and hook functions are interleaved. Each one loads a distinct value and returns,
+    // which is just long enough to be redirected using a relative jump, and the rest of its space
+    // is filled with breakpoints.
+    const size_t numGeneratedFuncs = 2 * kNumFunctionsScale;
+    uint8_t* const buffer = reinterpret_cast<uint8_t*>(VirtualAlloc(
+        nullptr,
+        numGeneratedFuncs * kScaleFunctionSizeBytes,
+        MEM_RESERVE | MEM_COMMIT,
+        PAGE_EXECUTE_READWRITE));
+    if (nullptr == buffer)
+    {
+      wprintf(L"    Failed to allocate space for generated functions.\n");
+      return;
+    }
+
+    for (size_t i = 0; i < numGeneratedFuncs; ++i)
+    {
+      uint8_t* const func = &buffer[i * kScaleFunctionSizeBytes];
+      const uint32_t value = static_cast<uint32_t>(i);
+
+      memset(func, 0xcc, kScaleFunctionSizeBytes);
+      func[0] = 0xb8;
+      memcpy(&func[1], &value, sizeof(value));
+      func[1 + sizeof(value)] = 0xc3;
+    }
+    FlushInstructionCache(GetCurrentProcess(), buffer, numGeneratedFuncs * kScaleFunctionSizeBytes);
+
+    Hookshot::SMemoryFootprint previousFootprint = {};
+    HookshotInterface()->GetMemoryFootprint(&previousFootprint);
+
+    for (size_t batchBegin = 0; batchBegin < kNumFunctionsScale;
+         batchBegin += kNumFunctionsPerScaleBatch)
+    {
+      const size_t batchEnd = std::min(batchBegin + kNumFunctionsPerScaleBatch, kNumFunctionsScale);
+      size_t numHooked = 0;
+
+      const int64_t startTicks = Now();
+      for (size_t i = batchBegin; i < batchEnd; ++i)
+      {
+        void* const originalFunc = &buffer[(2 * i) * kScaleFunctionSizeBytes];
+        const void* const hookFunc = &buffer[((2 * i) + 1) * kScaleFunctionSizeBytes];
+        const Hookshot::EResult result = HookshotInterface()->CreateHook(originalFunc, hookFunc);
+        if (true == Hookshot::SuccessfulResult(result)) numHooked += 1;
+      }
+      const int64_t elapsedTicks = Now() - startTicks;
+
+      Hookshot::SMemoryFootprint footprint = {};
+      HookshotInterface()->GetMemoryFootprint(&footprint);
+
+      const double batchBytes =
+          static_cast<double>(footprint.trampolineCommittedBytes + footprint.hookStoreHeapBytes) -
+          static_cast<double>(
+              previousFootprint.trampolineCommittedBytes + previousFootprint.hookStoreHeapBytes);
+      const double hooksInBatch = static_cast<double>(std::max<size_t>(1, numHooked));
+      previousFootprint = footprint;
+
+      wprintf(
+          L"  %6llu hooks %16.0f ops/s    %10.1f ns/hook    %8.1f bytes/hook    %4llu stores\n",
+          (unsigned long long)batchEnd,
+          hooksInBatch / (TicksToNanoseconds(elapsedTicks) / 1e9),
+          TicksToNanoseconds(elapsedTicks) / hooksInBatch,
+          batchBytes / hooksInBatch,
+          (unsigned long long)footprint.numTrampolineStores);
+
+      if (numHooked != (batchEnd - batchBegin))
+        wprintf(
+            L"    Failed to create %llu hooks.\n",
+            (unsigned long long)((batchEnd - batchBegin) - numHooked));
+    }
+  }
+
+  /// Information structure to pass to each thread during the lookup measurement.
+  struct SLookupThreadData
+  {
+    /// Functions to look up, all of which are expected to be hooked.
+    const TGeneratedTestFunction* funcs;
+
+    /// Number of functions to look up.
+    size_t numFuncs;
+
+    /// Event that all threads wait on before starting, so that they start together.
+    HANDLE startEvent;
+
+    /// Duration of each sample collected by this thread.
+    std::vector<int64_t> sampleTicks;
+  };
+
+  /// Executed by each thread during the lookup measurement.
+  /// @param [in] lpParameter Pointer to the thread's information structure.
+  /// @return Number of lookups that failed to find a hook.
+  static DWORD WINAPI LookupThreadProc(LPVOID lpParameter)
+  {
+    SLookupThreadData& threadData = *reinterpret_cast<SLookupThreadData*>(lpParameter);
+    Hookshot::IHookshot* const hookshot = HookshotInterface();
+    DWORD numFailures = 0;
+    size_t funcIndex = 0;
+
+    WaitForSingleObject(threadData.startEvent, INFINITE);
+
+    for (size_t sample = 0; sample < kNumLookupSamplesPerThread; ++sample)
+    {
+      const int64_t startTicks = Now();
+      for (size_t i = 0; i < kNumLookupsPerSample; ++i)
+      {
+        if (nullptr == hookshot->GetOriginalFunction(threadData.funcs[funcIndex]))
+          numFailures += 1;
+
+        funcIndex = ((funcIndex + 1) % threadData.numFuncs);
+      }
+      threadData.sampleTicks.push_back(Now() - startTicks);
+    }
+
+    return numFailures;
+  }
+
+  /// Measures lookup throughput and latency with the specified number of concurrent threads.
+  /// @param [in] funcs Functions to look up, all of which are expected to be hooked.
+  /// @param [in] numFuncs Number of functions to look up.
+  /// @param [in] numThreads Number of threads to use.
+  /// @return Summary statistics across all threads, with each lookup counted as one operation.
+  static SLatencySummary MeasureGetOriginalFunction(
+      const TGeneratedTestFunction* funcs, const size_t numFuncs, const unsigned int numThreads)
+  {
+    const HANDLE startEvent = CreateEvent(nullptr, TRUE, FALSE, nullptr);
+    std::vector<SLookupThreadData> threadData(numThreads);
+    std::vector<HANDLE> threadHandles(numThreads);
+
+    for (unsigned int i = 0; i < numThreads; ++i)
+    {
+      threadData[i].funcs = funcs;
+      threadData[i].numFuncs = numFuncs;
+      threadData[i].startEvent = startEvent;
+      threadData[i].sampleTicks.reserve(kNumLookupSamplesPerThread);
+      threadHandles[i] = CreateThread(nullptr, 0, LookupThreadProc, &threadData[i], 0, nullptr);
+    }
+
+    const int64_t startTicks = Now();
+    SetEvent(startEvent);
+    WaitForMultipleObjects(numThreads, threadHandles.data(), TRUE, INFINITE);
+    const int64_t elapsedTicks = Now() - startTicks;
+
+    std::vector<int64_t> allSampleTicks;
+    DWORD numFailures = 0;
+    for (unsigned int i = 0; i < numThreads; ++i)
+    {
+      DWORD thisThreadNumFailures = 0;
+      GetExitCodeThread(threadHandles[i], &thisThreadNumFailures);
+      numFailures += thisThreadNumFailures;
+      CloseHandle(threadHandles[i]);
+
+      allSampleTicks.insert(
+          allSampleTicks.end(), threadData[i].sampleTicks.begin(), threadData[i].sampleTicks.end());
+    }
+
+    CloseHandle(startEvent);
+
+    if (0 != numFailures)
+      wprintf(L"    %u lookup(s) failed to find a hook.\n", static_cast<unsigned int>(numFailures));
+
+    // Latency comes from the per-thread samples, but aggregate throughput is based on wall-clock
+    // time because the threads run concurrently.
+    SLatencySummary summary = Summarize(allSampleTicks, kNumLookupsPerSample);
+    summary.operationsPerSecond =
+        (static_cast<double>(numThreads) * kNumLookupSamplesPerThread * kNumLookupsPerSample) /
+        (TicksToNanoseconds(elapsedTicks) / 1e9);
+    return summary;
+  }
+
+  /// Measures how long it takes to toggle an existing hook between two hook functions.
+  /// @param [in] originalFunc Function that is already hooked.
+  /// @param [in] hookFuncA Current hook function.
+  /// @param [in] hookFuncB Alternate hook function, not currently involved in any hook.
+  /// @return Summary statistics, with each replacement counted as one operation.
+  static SLatencySummary MeasureReplaceHookFunction(
+      const TGeneratedTestFunction originalFunc,
+      const TGeneratedTestFunction hookFuncA,
+      const TGeneratedTestFunction hookFuncB)
+  {
+    std::vector<int64_t> sampleTicks;
+    sampleTicks.reserve(kNumReplaceToggles);
+
+    for (size_t i = 0; i < kNumReplaceToggles; ++i)
+    {
+      const TGeneratedTestFunction newHookFunc = ((0 == (i % 2)) ? hookFuncB : hookFuncA);
+
+      const int64_t startTicks = Now();
+      const Hookshot::EResult result =
+          HookshotInterface()->ReplaceHookFunction(originalFunc, newHookFunc);
+      sampleTicks.push_back(Now() - startTicks);
+
+      if (false == Hookshot::SuccessfulResult(result))
+        wprintf(L"    Failed to replace hook function on toggle %llu.\n", (unsigned long long)i);
+    }
+
+    return Summarize(sampleTicks, 1);
+  }
+
+  /// Measures the cost of calling a function in a tight loop, using the processor time stamp
+  /// counter. Calls are made through a volatile function pointer so that the compiler cannot
+  /// inline or elide them, and every call is expected to return its first parameter.
+  /// @param [in] func Function to call.
+  /// @return Median number of processor cycles per call.
+  static double MeasureCallCycles(const TCallOverheadFunction func)
+  {
+    volatile TCallOverheadFunction funcToCall = func;
+    std::vector<int64_t> sampleCycles;
+    sampleCycles.reserve(kNumCallSamples);
+    size_t numWrongResults = 0;
+
+    // Warm up the caches and branch predictors before any samples are collected.
+    for (size_t i = 0; i < kNumCallsPerSample; ++i)
+      funcToCall(kOriginalFunctionResult, 0);
+
+    for (size_t sample = 0; sample < kNumCallSamples; ++sample)
+    {
+      const uint64_t startCycles = __rdtsc();
+      for (size_t i = 0; i < kNumCallsPerSample; ++i)
+      {
+        if (kOriginalFunctionResult != funcToCall(kOriginalFunctionResult, 0))
+          numWrongResults += 1;
+      }
+      sampleCycles.push_back(static_cast<int64_t>(__rdtsc() - startCycles));
+    }
+
+    if (0 != numWrongResults)
+      wprintf(L"    %llu call(s) returned the wrong value.\n", (unsigned long long)numWrongResults);
+
+    std::sort(sampleCycles.begin(), sampleCycles.end());
+    return static_cast<double>(sampleCycles[sampleCycles.size() / 2]) / kNumCallsPerSample;
+  }
+
+  /// Creates a hook for the call overhead measurement, printing a message if it fails.
+  /// @param [in] originalFunc Function to hook.
+  /// @param [in] hookFunc Hook function.
+  /// @return `true` if the hook was created, `false` otherwise.
+  static bool CreateCallOverheadHook(
+      const TCallOverheadFunction originalFunc, const TCallOverheadFunction hookFunc)
+  {
+    const Hookshot::EResult result = HookshotInterface()->CreateHook(originalFunc, hookFunc);
+    if (true == Hookshot::SuccessfulResult(result)) return true;
+
+    wprintf(L"    Failed to create hook, result = %u.\n", static_cast<unsigned int>(result));
+    return false;
+  }
+
+  /// Determines which kind of jump a hooked original function uses to reach its hook function.
+  /// This is decided by the configuration file, so the measurement reports whichever one is in use
+  /// rather than switching between them.
+  /// @param [in] originalFunc Original function, which must already be hooked.
+  /// @param [in] hookFunc Hook function associated with the original function.
+  /// @return `true` if the original function jumps directly to the hook function using a rel32
+  /// displacement, `false` if it jumps indirectly by way of its trampoline.
+  static bool IsDirectHookJump(
+      const TCallOverheadFunction originalFunc, const TCallOverheadFunction hookFunc)
+  {
+    const uint8_t* const originalFuncBytes = reinterpret_cast<const uint8_t*>(originalFunc);
+    if (Hookshot::X86Instruction::kJumpInstructionPreamble[0] != originalFuncBytes[0]) return false;
+
+    int32_t displacement = 0;
+    memcpy(&displacement, &originalFuncBytes[1], sizeof(displacement));
+    const uint8_t* const jumpTarget =
+        &originalFuncBytes[Hookshot::X86Instruction::kJumpInstructionLengthBytes + displacement];
+    return (reinterpret_cast<const uint8_t*>(hookFunc) == jumpTarget);
+  }
+
+  /// Measures and prints the per-call overhead of each variant of inline hook, relative to calling
+  /// an identical function that is not hooked.
+  static void RunCallOverheadBenchmarks(void)
+  {
+    const double baselineCycles = MeasureCallCycles(CallOverhead_Baseline);
+    PrintCallOverheadResult(L"  Unhooked", baselineCycles, baselineCycles);
+
+    if (true == CreateCallOverheadHook(CallOverheadHooked_Original, CallOverheadHooked_Hook))
+    {
+      Hookshot::SHookStatistics statistics = {};
+      const bool isInstrumented =
+          (Hookshot::EResult::Success ==
+           HookshotInterface()->GetHookStatistics(CallOverheadHooked_Original, &statistics));
+      const bool isDirect = IsDirectHookJump(CallOverheadHooked_Original, CallOverheadHooked_Hook);
+
+      wchar_t name[64];
+      swprintf_s(
+          name,
+          L"  Hooked, %s%s",
+          ((true == isDirect) ? L"direct rel32 jump" : L"indirect via trampoline"),
+          ((true == isInstrumented) ? L", instrumented" : L""));
+      PrintCallOverheadResult(
+          name, MeasureCallCycles(CallOverheadHooked_Original), baselineCycles);
+
+      const TCallOverheadFunction trampolineFunc = reinterpret_cast<TCallOverheadFunction>(
+          HookshotInterface()->GetOriginalFunction(CallOverheadHooked_Original));
+      if (nullptr != trampolineFunc)
+        PrintCallOverheadResult(
+            L"  Original function via trampoline",
+            MeasureCallCycles(trampolineFunc),
+            baselineCycles);
+    }
+
+    if (true == CreateCallOverheadHook(CallOverheadDisabled_Original, CallOverheadDisabled_Hook))
+    {
+      if (true ==
+          Hookshot::SuccessfulResult(
+              HookshotInterface()->DisableHookFunction(CallOverheadDisabled_Original)))
+        PrintCallOverheadResult(
+            L"  Hook function disabled",
+            MeasureCallCycles(CallOverheadDisabled_Original),
+            baselineCycles);
+      else
+        wprintf(L"    Failed to disable hook function.\n");
+    }
+
+    if (true == CreateCallOverheadHook(CallOverheadGuarded_Original, CallOverheadGuarded_Hook))
+    {
+      if (true ==
+          Hookshot::SuccessfulResult(
+              HookshotInterface()->SetHookReentrancyGuard(CallOverheadGuarded_Original, true)))
+        PrintCallOverheadResult(
+            L"  Reentrancy guard enabled",
+            MeasureCallCycles(CallOverheadGuarded_Original),
+            baselineCycles);
+      else
+        wprintf(L"    Failed to enable reentrancy guard.\n");
+    }
+  }
+
+  /// Runs all of the benchmarks and prints the results.
+  /// @param [in] fuzzSeed Seed to use for transplant fuzzing.
+  /// @param [in] engineCsvPath Path of the CSV file to which the engine comparison is written.
+  /// @return Process exit code, which is non-zero if transplant fuzzing found any mismatches.
+  static int RunBenchmarks(const uint32_t fuzzSeed, const wchar_t* engineCsvPath)
+  {
+    if (nullptr == HookshotInterface())
+    {
+      wprintf(L"Failed to initialize Hookshot.\n");
+      return 1;
+    }
+
+    Hookshot::X86Instruction::Initialize();
+
+    // Template parameter ranges are chosen far away from any source code line number and from
+    // each other, so that every generated function is distinct.
+    static const auto originalFuncsSmall = GenerateFunctions<100000, kNumFunctionsSmall>();
+    static const auto hookFuncsSmall = GenerateFunctions<110000, kNumFunctionsSmall>();
+    static const auto alternateHookFuncsSmall = GenerateFunctions<120000, kNumFunctionsSmall>();
+    static const auto originalFuncsMedium = GenerateFunctions<200000, kNumFunctionsMedium>();
+    static const auto hookFuncsMedium = GenerateFunctions<210000, kNumFunctionsMedium>();
+    static const auto originalFuncsLarge = GenerateFunctions<300000, kNumFunctionsLarge>();
+    static const auto hookFuncsLarge = GenerateFunctions<400000, kNumFunctionsLarge>();
+
+    wprintf(L"Decoding\n");
+    PrintResult(
+        L"  XED decode of function prologues",
+        MeasureDecode(originalFuncsLarge.data(), originalFuncsLarge.size()));
+
+    wprintf(L"\nInstruction decoding and encoding, nanoseconds per operation\n");
+    InstructionBenchmark::Run();
+
+    wprintf(L"\nCreateHook\n");
+    PrintResult(
+        L"  1 function",
+        MeasureCreateHook(originalFuncsSmall.data(), hookFuncsSmall.data(), kNumFunctionsSmall));
+    PrintResult(
+        L"  100 functions",
+        MeasureCreateHook(
+            originalFuncsMedium.data(), hookFuncsMedium.data(), kNumFunctionsMedium));
+    PrintResult(
+        L"  10000 functions",
+        MeasureCreateHook(originalFuncsLarge.data(), hookFuncsLarge.data(), kNumFunctionsLarge));
+
+    wprintf(L"\nCreateHook scalability\n");
+    RunScalabilityBenchmark();
+
+    wprintf(L"\nGetOriginalFunction\n");
+    for (const unsigned int numThreads : kLookupThreadCounts)
+    {
+      wchar_t name[64];
+      swprintf_s(name, L"  %u thread(s)", numThreads);
+      PrintResult(
+          name,
+          MeasureGetOriginalFunction(
+              originalFuncsLarge.data(), originalFuncsLarge.size(), numThreads));
+    }
+
+    wprintf(L"\nReplaceHookFunction\n");
+    PrintResult(
+        L"  Toggle between two hook functions",
+        MeasureReplaceHookFunction(
+            originalFuncsSmall[0], hookFuncsSmall[0], alternateHookFuncsSmall[0]));
+
+    wprintf(L"\nCall overhead\n");
+    RunCallOverheadBenchmarks();
+
+    wprintf(L"\nEngine comparison\n");
+    EngineComparison::Run(engineCsvPath);
+
+    wprintf(L"\nTransplant fuzzing\n");
+    if (false == TransplantFuzzer::Run(fuzzSeed, kNumFuzzIterations)) return 1;
+
+    return 0;
+  }
+} // namespace HookshotBenchmark
+
+int wmain(int argc, const wchar_t* argv[])
+{
+  uint32_t fuzzSeed = static_cast<uint32_t>(GetTickCount());
+  const wchar_t* engineCsvPath = HookshotBenchmark::kDefaultEngineCsvPath;
+
+  for (int i = 1; i < argc; ++i)
+  {
+    const std::wstring_view arg = argv[i];
+    if (true == arg.starts_with(HookshotBenchmark::kOptionFuzzSeed))
+      fuzzSeed = static_cast<uint32_t>(
+          wcstoul(&argv[i][HookshotBenchmark::kOptionFuzzSeed.length()], nullptr, 10));
+    else if (true == arg.starts_with(HookshotBenchmark::kOptionEngineCsv))
+      engineCsvPath = &argv[i][HookshotBenchmark::kOptionEngineCsv.length()];
+  }
+
+  return HookshotBenchmark::RunBenchmarks(fuzzSeed, engineCsvPath);
+}
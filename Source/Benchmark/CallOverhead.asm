@@ -0,0 +1,94 @@
+;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;
+; Hookshot
+;   General-purpose library for injecting DLLs and hooking function calls.
+;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;
+; Authored by Samuel Grossman
+; Copyright (c) 2019-2025
+;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;
+
+INCLUDE TestDefinitions.inc
+
+
+; Functions used to measure how much a hook adds to the cost of each call. Every original function
+; is identical to the one used by the BasicFunction test case, so that the only difference between
+; calling them is the way each one is hooked. One of them is never hooked and serves as the
+; baseline. Each hook function does the same amount of work as the original functions. The engine
+; comparison hooks the same original function with each hooking engine in turn.
+
+
+_TEXT                                       SEGMENT
+
+
+BEGIN_HOOKSHOT_TEST_FUNCTION                CallOverhead_Baseline
+    mov sax, scx
+    nop
+    nop
+    nop
+    ret
+END_HOOKSHOT_TEST_FUNCTION                  CallOverhead_Baseline
+
+
+BEGIN_HOOKSHOT_TEST_FUNCTION                CallOverheadHooked_Original
+    mov sax, scx
+    nop
+    nop
+    nop
+    ret
+END_HOOKSHOT_TEST_FUNCTION                  CallOverheadHooked_Original
+
+
+BEGIN_HOOKSHOT_TEST_FUNCTION                CallOverheadHooked_Hook
+    mov sax, scx
+    ret
+END_HOOKSHOT_TEST_FUNCTION                  CallOverheadHooked_Hook
+
+
+BEGIN_HOOKSHOT_TEST_FUNCTION                CallOverheadDisabled_Original
+    mov sax, scx
+    nop
+    nop
+    nop
+    ret
+END_HOOKSHOT_TEST_FUNCTION                  CallOverheadDisabled_Original
+
+
+BEGIN_HOOKSHOT_TEST_FUNCTION                CallOverheadDisabled_Hook
+    mov sax, scx
+    ret
+END_HOOKSHOT_TEST_FUNCTION                  CallOverheadDisabled_Hook
+
+
+BEGIN_HOOKSHOT_TEST_FUNCTION                CallOverheadGuarded_Original
+    mov sax, scx
+    nop
+    nop
+    nop
+    ret
+END_HOOKSHOT_TEST_FUNCTION                  CallOverheadGuarded_Original
+
+
+BEGIN_HOOKSHOT_TEST_FUNCTION                CallOverheadGuarded_Hook
+    mov sax, scx
+    ret
+END_HOOKSHOT_TEST_FUNCTION                  CallOverheadGuarded_Hook
+
+
+BEGIN_HOOKSHOT_TEST_FUNCTION                CallOverheadEngine_Original
+    mov sax, scx
+    nop
+    nop
+    nop
+    ret
+END_HOOKSHOT_TEST_FUNCTION                  CallOverheadEngine_Original
+
+
+BEGIN_HOOKSHOT_TEST_FUNCTION                CallOverheadEngine_Hook
+    mov sax, scx
+    ret
+END_HOOKSHOT_TEST_FUNCTION                  CallOverheadEngine_Hook
+
+
+_TEXT                                       ENDS
+
+
+END
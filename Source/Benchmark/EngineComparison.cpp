@@ -0,0 +1,549 @@
+/***************************************************************************************************
+ * Hookshot
+ *   General-purpose library for injecting DLLs and hooking function calls.
+ ***************************************************************************************************
+ * Authored by Samuel Grossman
+ * Copyright (c) 2019-2025
+ ***********************************************************************************************//**
+ * @file EngineComparison.cpp
+ *   Implementation of the comparison between Hookshot and other hooking engines, which runs the
+ *   same measurements through each engine that is available.
+ **************************************************************************************************/
+
+#include "EngineComparison.h"
+
+#include <windows.h>
+#include <intrin.h>
+#include <psapi.h>
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+#include <memory>
+#include <unordered_map>
+#include <vector>
+
+#include "BenchmarkTiming.h"
+#include "FunctionGenerator.h"
+#include "Hookshot.h"
+#include "TestGlobals.h"
+
+extern "C" size_t __fastcall CallOverhead_Baseline(size_t scx, size_t sdx);
+extern "C" size_t __fastcall CallOverheadEngine_Original(size_t scx, size_t sdx);
+extern "C" size_t __fastcall CallOverheadEngine_Hook(size_t scx, size_t sdx);
+
+namespace HookshotBenchmark
+{
+  namespace EngineComparison
+  {
+    using namespace ::HookshotTest;
+
+    /// Pointer-to-function type for the functions used in the per-call overhead measurement.
+    using TCallOverheadFunction = size_t(__fastcall*)(size_t, size_t);
+
+    /// Number of generated functions hooked by each engine during the installation and memory
+    /// measurements. The same functions are used for every engine, which removes all of its hooks
+    /// before the next engine is measured.
+    static constexpr size_t kNumFunctions = 1000;
+
+    /// Number of times each engine toggles a hook between enabled and disabled.
+    static constexpr size_t kNumToggles = 1000;
+
+    /// Number of calls made between timestamps during the per-call overhead measurement.
+    static constexpr size_t kNumCallsPerSample = 1000;
+
+    /// Number of timed samples collected for each function during the per-call overhead
+    /// measurement.
+    static constexpr size_t kNumCallSamples = 1000;
+
+    /// Name of the processor architecture for which this benchmark was built, as written to the
+    /// CSV file.
+#ifdef _WIN64
+    static constexpr const wchar_t* kArchitectureName = L"x64";
+#else
+    static constexpr const wchar_t* kArchitectureName = L"x86";
+#endif
+
+    /// Adapter that exposes the operations of a hooking engine in a uniform way, so that every
+    /// engine is measured by exactly the same code. Each hook is identified by its original
+    /// function.
+    class IHookEngine
+    {
+    public:
+
+      virtual ~IHookEngine(void) = default;
+
+      /// Retrieves the name of the engine, as printed and written to the CSV file.
+      /// @return Name of the engine.
+      virtual const wchar_t* GetName(void) const = 0;
+
+      /// Creates and enables a hook.
+      /// @param [in] originalFunc Function to hook.
+      /// @param [in] hookFunc Hook function.
+      /// @return `true` if the hook was created, `false` otherwise.
+      virtual bool CreateHook(void* originalFunc, void* hookFunc) = 0;
+
+      /// Enables or disables an existing hook. Engines without a dedicated mechanism do so by
+      /// removing and creating the hook again.
+      /// @param [in] originalFunc Function that is hooked.
+      /// @param [in] hookFunc Hook function that was specified when the hook was created.
+      /// @param [in] enabled Whether the hook should be enabled or disabled.
+      /// @return `true` if the state of the hook was changed, `false` otherwise.
+      virtual bool SetHookEnabled(void* originalFunc, void* hookFunc, bool enabled) = 0;
+
+      /// Removes an existing hook, which must be enabled.
+      /// @param [in] originalFunc Function that is hooked.
+      /// @param [in] hookFunc Hook function that was specified when the hook was created.
+      /// @return `true` if the hook was removed, `false` otherwise.
+      virtual bool RemoveHook(void* originalFunc, void* hookFunc) = 0;
+    };
+
+    /// Hookshot itself, accessed through the same interface object used by hook modules.
+    class HookshotEngine : public IHookEngine
+    {
+    public:
+
+      const wchar_t* GetName(void) const override
+      {
+        return L"Hookshot";
+      }
+
+      bool CreateHook(void* originalFunc, void* hookFunc) override
+      {
+        return Hookshot::SuccessfulResult(HookshotInterface()->CreateHook(originalFunc, hookFunc));
+      }
+
+      bool SetHookEnabled(void* originalFunc, void* hookFunc, bool enabled) override
+      {
+        return Hookshot::SuccessfulResult(
+            (true == enabled) ? HookshotInterface()->ReplaceHookFunction(originalFunc, hookFunc)
+                              : HookshotInterface()->DisableHookFunction(originalFunc));
+      }
+
+      bool RemoveHook(void* originalFunc, void* hookFunc) override
+      {
+        return Hookshot::SuccessfulResult(HookshotInterface()->RemoveHook(originalFunc));
+      }
+    };
+
+    /// MinHook, loaded from its dynamic library.
+    class MinHookEngine : public IHookEngine
+    {
+    public:
+
+      /// Attempts to load MinHook and initialize it.
+      /// @return Engine object, or `nullptr` if MinHook is not present or could not be initialized.
+      static std::unique_ptr<IHookEngine> Load(void)
+      {
+#ifdef _WIN64
+        const HMODULE library = LoadLibrary(L"MinHook.x64.dll");
+#else
+        const HMODULE library = LoadLibrary(L"MinHook.x86.dll");
+#endif
+        if (nullptr == library) return nullptr;
+
+        std::unique_ptr<MinHookEngine> engine(new MinHookEngine(library));
+        if ((nullptr == engine->initialize) || (nullptr == engine->uninitialize) ||
+            (nullptr == engine->createHook) || (nullptr == engine->removeHook) ||
+            (nullptr == engine->enableHook) || (nullptr == engine->disableHook) ||
+            (kStatusOk != engine->initialize()))
+        {
+          engine->uninitialize = nullptr;
+          return nullptr;
+        }
+
+        return engine;
+      }
+
+      ~MinHookEngine(void) override
+      {
+        if (nullptr != uninitialize) uninitialize();
+        FreeLibrary(library);
+      }
+
+      const wchar_t* GetName(void) const override
+      {
+        return L"MinHook";
+      }
+
+      bool CreateHook(void* originalFunc, void* hookFunc) override
+      {
+        void* trampoline = nullptr;
+        if (kStatusOk != createHook(originalFunc, hookFunc, &trampoline)) return false;
+
+        return (kStatusOk == enableHook(originalFunc));
+      }
+
+      bool SetHookEnabled(void* originalFunc, void* hookFunc, bool enabled) override
+      {
+        return (
+            kStatusOk ==
+            ((true == enabled) ? enableHook(originalFunc) : disableHook(originalFunc)));
+      }
+
+      bool RemoveHook(void* originalFunc, void* hookFunc) override
+      {
+        return (kStatusOk == removeHook(originalFunc));
+      }
+
+    private:
+
+      /// Status code that MinHook functions return on success.
+      static constexpr int kStatusOk = 0;
+
+      /// Pointer-to-function types for the MinHook functions that are used.
+      using TInitializeFunction = int(WINAPI*)(void);
+      using TCreateHookFunction = int(WINAPI*)(void*, void*, void**);
+      using TTargetFunction = int(WINAPI*)(void*);
+
+      /// Resolves the MinHook functions that are used.
+      /// @param [in] library Handle of the MinHook library, which is owned by this object.
+      MinHookEngine(HMODULE library)
+          : library(library),
+            initialize(reinterpret_cast<TInitializeFunction>(
+                GetProcAddress(library, "MH_Initialize"))),
+            uninitialize(reinterpret_cast<TInitializeFunction>(
+                GetProcAddress(library, "MH_Uninitialize"))),
+            createHook(reinterpret_cast<TCreateHookFunction>(
+                GetProcAddress(library, "MH_CreateHook"))),
+            removeHook(
+                reinterpret_cast<TTargetFunction>(GetProcAddress(library, "MH_RemoveHook"))),
+            enableHook(
+                reinterpret_cast<TTargetFunction>(GetProcAddress(library, "MH_EnableHook"))),
+            disableHook(
+                reinterpret_cast<TTargetFunction>(GetProcAddress(library, "MH_DisableHook")))
+      {}
+
+      HMODULE library;
+      TInitializeFunction initialize;
+      TInitializeFunction uninitialize;
+      TCreateHookFunction createHook;
+      TTargetFunction removeHook;
+      TTargetFunction enableHook;
+      TTargetFunction disableHook;
+    };
+
+    /// Detours, loaded from a dynamic library build of it. Every operation is its own transaction,
+    /// and because Detours has no way of disabling a hook without removing it, toggling a hook
+    /// detaches and attaches it again.
+    class DetoursEngine : public IHookEngine
+    {
+    public:
+
+      /// Attempts to load Detours.
+      /// @return Engine object, or `nullptr` if Detours is not present.
+      static std::unique_ptr<IHookEngine> Load(void)
+      {
+        const HMODULE library = LoadLibrary(L"detours.dll");
+        if (nullptr == library) return nullptr;
+
+        std::unique_ptr<DetoursEngine> engine(new DetoursEngine(library));
+        if ((nullptr == engine->transactionBegin) || (nullptr == engine->updateThread) ||
+            (nullptr == engine->attach) || (nullptr == engine->detach) ||
+            (nullptr == engine->transactionCommit))
+          return nullptr;
+
+        return engine;
+      }
+
+      ~DetoursEngine(void) override
+      {
+        FreeLibrary(library);
+      }
+
+      const wchar_t* GetName(void) const override
+      {
+        return L"Detours";
+      }
+
+      bool CreateHook(void* originalFunc, void* hookFunc) override
+      {
+        return SetHookEnabled(originalFunc, hookFunc, true);
+      }
+
+      bool SetHookEnabled(void* originalFunc, void* hookFunc, bool enabled) override
+      {
+        // Detours replaces the pointer it is given with the address of the trampoline, and needs
+        // it again when detaching, so each one is kept at a stable address.
+        auto pointerIter = pointers.find(originalFunc);
+        if (pointers.end() == pointerIter)
+          pointerIter = pointers.emplace(originalFunc, originalFunc).first;
+
+        if (kStatusOk != transactionBegin()) return false;
+        updateThread(GetCurrentThread());
+
+        const long result = ((true == enabled) ? attach(&pointerIter->second, hookFunc)
+                                               : detach(&pointerIter->second, hookFunc));
+        if (kStatusOk != result)
+        {
+          transactionCommit();
+          return false;
+        }
+
+        return (kStatusOk == transactionCommit());
+      }
+
+      bool RemoveHook(void* originalFunc, void* hookFunc) override
+      {
+        if (false == SetHookEnabled(originalFunc, hookFunc, false)) return false;
+
+        pointers.erase(originalFunc);
+        return true;
+      }
+
+    private:
+
+      /// Status code that Detours functions return on success.
+      static constexpr long kStatusOk = NO_ERROR;
+
+      /// Pointer-to-function types for the Detours functions that are used.
+      using TTransactionFunction = long(WINAPI*)(void);
+      using TUpdateThreadFunction = long(WINAPI*)(HANDLE);
+      using TAttachFunction = long(WINAPI*)(void**, void*);
+
+      /// Resolves the Detours functions that are used.
+      /// @param [in] library Handle of the Detours library, which is owned by this object.
+      DetoursEngine(HMODULE library)
+          : library(library),
+            transactionBegin(reinterpret_cast<TTransactionFunction>(
+                GetProcAddress(library, "DetourTransactionBegin"))),
+            updateThread(reinterpret_cast<TUpdateThreadFunction>(
+                GetProcAddress(library, "DetourUpdateThread"))),
+            attach(reinterpret_cast<TAttachFunction>(GetProcAddress(library, "DetourAttach"))),
+            detach(reinterpret_cast<TAttachFunction>(GetProcAddress(library, "DetourDetach"))),
+            transactionCommit(reinterpret_cast<TTransactionFunction>(
+                GetProcAddress(library, "DetourTransactionCommit"))),
+            pointers()
+      {}
+
+      HMODULE library;
+      TTransactionFunction transactionBegin;
+      TUpdateThreadFunction updateThread;
+      TAttachFunction attach;
+      TAttachFunction detach;
+      TTransactionFunction transactionCommit;
+
+      /// Pointers passed to Detours for each hooked function, keyed by original function.
+      std::unordered_map<void*, void*> pointers;
+    };
+
+    /// Results of measuring a single engine.
+    struct SEngineResults
+    {
+      /// Number of hooks created per second during the installation measurement.
+      double installsPerSecond;
+
+      /// Number of bytes of private memory committed per hook during the installation measurement.
+      double committedBytesPerHook;
+
+      /// Median latency of enabling or disabling a hook, in nanoseconds.
+      double toggleNanoseconds;
+
+      /// Median number of processor cycles a hook adds to each call.
+      double callOverheadCycles;
+
+      /// Number of operations that failed during any measurement.
+      size_t numFailures;
+    };
+
+    /// Retrieves the amount of private memory committed by this process.
+    /// @return Number of bytes of private memory committed.
+    static size_t CommittedPrivateBytes(void)
+    {
+      PROCESS_MEMORY_COUNTERS_EX memoryCounters = {.cb = sizeof(memoryCounters)};
+      if (FALSE ==
+          GetProcessMemoryInfo(
+              GetCurrentProcess(),
+              reinterpret_cast<PROCESS_MEMORY_COUNTERS*>(&memoryCounters),
+              sizeof(memoryCounters)))
+        return 0;
+
+      return memoryCounters.PrivateUsage;
+    }
+
+    /// Measures the cost of calling a function in a tight loop, using the processor time stamp
+    /// counter. Calls are made through a volatile function pointer so that the compiler cannot
+    /// inline or elide them.
+    /// @param [in] func Function to call.
+    /// @return Median number of processor cycles per call.
+    static double MeasureCallCycles(const TCallOverheadFunction func)
+    {
+      volatile TCallOverheadFunction funcToCall = func;
+      std::vector<int64_t> sampleCycles;
+      sampleCycles.reserve(kNumCallSamples);
+
+      for (size_t i = 0; i < kNumCallsPerSample; ++i)
+        funcToCall(kOriginalFunctionResult, 0);
+
+      for (size_t sample = 0; sample < kNumCallSamples; ++sample)
+      {
+        const uint64_t startCycles = __rdtsc();
+        for (size_t i = 0; i < kNumCallsPerSample; ++i)
+          funcToCall(kOriginalFunctionResult, 0);
+        sampleCycles.push_back(static_cast<int64_t>(__rdtsc() - startCycles));
+      }
+
+      std::sort(sampleCycles.begin(), sampleCycles.end());
+      return static_cast<double>(sampleCycles[sampleCycles.size() / 2]) / kNumCallsPerSample;
+    }
+
+    /// Runs every measurement through a single engine and then removes all of its hooks.
+    /// @param [in] engine Engine to measure.
+    /// @param [in] originalFuncs Functions to hook, one per element of #kNumFunctions.
+    /// @param [in] hookFuncs Hook functions, one per function to hook.
+    /// @param [in] baselineCallCycles Median number of processor cycles per call to a function
+    /// that is not hooked.
+    /// @return Results of the measurements.
+    static SEngineResults MeasureEngine(
+        IHookEngine& engine,
+        const TGeneratedTestFunction* originalFuncs,
+        const TGeneratedTestFunction* hookFuncs,
+        const double baselineCallCycles)
+    {
+      SEngineResults results = {};
+      std::vector<bool> isHooked(kNumFunctions, false);
+      size_t numHooked = 0;
+
+      const size_t committedBytesBefore = CommittedPrivateBytes();
+      const int64_t installStartTicks = Now();
+      for (size_t i = 0; i < kNumFunctions; ++i)
+      {
+        isHooked[i] = engine.CreateHook(
+            reinterpret_cast<void*>(originalFuncs[i]), reinterpret_cast<void*>(hookFuncs[i]));
+        if (true == isHooked[i]) numHooked += 1;
+      }
+      const int64_t installTicks = Now() - installStartTicks;
+      const size_t committedBytesAfter = CommittedPrivateBytes();
+
+      results.numFailures += (kNumFunctions - numHooked);
+      if (0 != numHooked)
+      {
+        results.installsPerSecond =
+            static_cast<double>(numHooked) / (TicksToNanoseconds(installTicks) / 1e9);
+        results.committedBytesPerHook =
+            static_cast<double>(
+                (committedBytesAfter > committedBytesBefore)
+                    ? (committedBytesAfter - committedBytesBefore)
+                    : 0) /
+            static_cast<double>(numHooked);
+      }
+
+      if (true == isHooked[0])
+      {
+        void* const originalFunc = reinterpret_cast<void*>(originalFuncs[0]);
+        void* const hookFunc = reinterpret_cast<void*>(hookFuncs[0]);
+        std::vector<int64_t> sampleTicks;
+        sampleTicks.reserve(kNumToggles);
+
+        // An even number of toggles leaves the hook enabled, which removing it requires.
+        for (size_t i = 0; i < kNumToggles; ++i)
+        {
+          const int64_t startTicks = Now();
+          const bool toggled = engine.SetHookEnabled(originalFunc, hookFunc, (1 == (i % 2)));
+          sampleTicks.push_back(Now() - startTicks);
+
+          if (false == toggled) results.numFailures += 1;
+        }
+
+        std::sort(sampleTicks.begin(), sampleTicks.end());
+        results.toggleNanoseconds = TicksToNanoseconds(sampleTicks[sampleTicks.size() / 2]);
+      }
+
+      void* const callOverheadOriginal = reinterpret_cast<void*>(&CallOverheadEngine_Original);
+      void* const callOverheadHook = reinterpret_cast<void*>(&CallOverheadEngine_Hook);
+      if (true == engine.CreateHook(callOverheadOriginal, callOverheadHook))
+      {
+        results.callOverheadCycles =
+            MeasureCallCycles(CallOverheadEngine_Original) - baselineCallCycles;
+        if (false == engine.RemoveHook(callOverheadOriginal, callOverheadHook))
+          results.numFailures += 1;
+      }
+      else
+      {
+        results.numFailures += 1;
+      }
+
+      for (size_t i = 0; i < kNumFunctions; ++i)
+      {
+        if ((true == isHooked[i]) &&
+            (false ==
+             engine.RemoveHook(
+                 reinterpret_cast<void*>(originalFuncs[i]), reinterpret_cast<void*>(hookFuncs[i]))))
+          results.numFailures += 1;
+      }
+
+      return results;
+    }
+
+    bool Run(const wchar_t* csvPath)
+    {
+      // Template parameter ranges are chosen far away from any source code line number and from
+      // those used elsewhere in the benchmark executable.
+      static const auto originalFuncs = GenerateFunctions<500000, kNumFunctions>();
+      static const auto hookFuncs = GenerateFunctions<510000, kNumFunctions>();
+
+      // Other engines are measured first, because Hookshot keeps the trampoline stores it places
+      // even after all of its hooks are removed, whereas they release everything when unloaded.
+      std::vector<std::unique_ptr<IHookEngine>> engines;
+      for (auto loadEngine : {&MinHookEngine::Load, &DetoursEngine::Load})
+      {
+        std::unique_ptr<IHookEngine> engine = loadEngine();
+        if (nullptr != engine) engines.push_back(std::move(engine));
+      }
+      engines.push_back(std::make_unique<HookshotEngine>());
+
+      FILE* csvFile = nullptr;
+      if ((0 != _wfopen_s(&csvFile, csvPath, L"w")) || (nullptr == csvFile))
+      {
+        wprintf(L"    Failed to open %s for writing.\n", csvPath);
+        return false;
+      }
+
+      fwprintf(csvFile, L"engine,architecture,metric,value,unit\n");
+
+      const double baselineCallCycles = MeasureCallCycles(CallOverhead_Baseline);
+      for (const auto& engine : engines)
+      {
+        const SEngineResults results =
+            MeasureEngine(*engine, originalFuncs.data(), hookFuncs.data(), baselineCallCycles);
+
+        wprintf(
+            L"  %-46s %12.0f hooks/s    %8.1f ns/toggle    %+8.2f cycles/call    %8.0f B/hook\n",
+            engine->GetName(),
+            results.installsPerSecond,
+            results.toggleNanoseconds,
+            results.callOverheadCycles,
+            results.committedBytesPerHook);
+        if (0 != results.numFailures)
+          wprintf(L"    %llu operation(s) failed.\n", (unsigned long long)results.numFailures);
+
+        const struct
+        {
+          const wchar_t* metric;
+          double value;
+          const wchar_t* unit;
+        } rows[] = {
+            {L"install_throughput", results.installsPerSecond, L"hooks/s"},
+            {L"per_call_overhead", results.callOverheadCycles, L"cycles"},
+            {L"toggle_latency", results.toggleNanoseconds, L"ns"},
+            {L"memory_per_hook", results.committedBytesPerHook, L"bytes"},
+            {L"failures", static_cast<double>(results.numFailures), L"operations"}};
+
+        for (const auto& row : rows)
+          fwprintf(
+              csvFile,
+              L"%s,%s,%s,%.3f,%s\n",
+              engine->GetName(),
+              kArchitectureName,
+              row.metric,
+              row.value,
+              row.unit);
+      }
+
+      fclose(csvFile);
+      wprintf(L"    Results written to %s.\n", csvPath);
+      return true;
+    }
+  } // namespace EngineComparison
+} // namespace HookshotBenchmark
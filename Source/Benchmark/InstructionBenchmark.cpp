@@ -0,0 +1,211 @@
+/***************************************************************************************************
+ * Hookshot
+ *   General-purpose library for injecting DLLs and hooking function calls.
+ ***************************************************************************************************
+ * Authored by Samuel Grossman
+ * Copyright (c) 2019-2025
+ ***********************************************************************************************//**
+ * @file InstructionBenchmark.cpp
+ *   Implementation of the microbenchmark of instruction decoding and encoding, broken down by
+ *   instruction class.
+ **************************************************************************************************/
+
+#include "InstructionBenchmark.h"
+
+#include <windows.h>
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+#include <vector>
+
+#include "BenchmarkTiming.h"
+#include "CpuInfo.h"
+#include "X86Instruction.h"
+
+namespace HookshotBenchmark
+{
+  namespace InstructionBenchmark
+  {
+    using ::HookshotTest::CpuInfo;
+    using ::Hookshot::X86Instruction;
+
+    /// Number of times an operation is performed between timestamps.
+    static constexpr size_t kNumOperationsPerSample = 1000;
+
+    /// Number of timed samples collected for each operation and instruction class.
+    static constexpr size_t kNumSamples = 1000;
+
+    /// Displacement values between which position-dependent instructions are toggled. Both are
+    /// small enough to fit into the narrowest displacement of any instruction class.
+    static constexpr int64_t kDisplacementValues[] = {0x10, 0x20};
+
+    /// Name of the processor architecture for which this benchmark was built, as printed with the
+    /// results so that measurements from both architectures can be told apart.
+#ifdef _WIN64
+    static constexpr const wchar_t* kArchitectureName = L"x64";
+#else
+    static constexpr const wchar_t* kArchitectureName = L"x86";
+#endif
+
+    /// Describes one class of instruction to be measured, using a single representative
+    /// instruction.
+    struct SInstructionClass
+    {
+      /// Name of the instruction class, as printed with the results.
+      const wchar_t* name;
+
+      /// Encoded representative instruction. Unused trailing bytes are zero, so that the decoder
+      /// can always be given the maximum instruction length.
+      uint8_t bytes[X86Instruction::kMaxInstructionLengthBytes];
+
+      /// Determines if the current processor supports the instruction set extension that this
+      /// class requires, or `nullptr` if no extension is required.
+      bool (*isSupported)(const cpu_features::X86Features& features);
+    };
+
+    /// Classes of instruction to be measured. Displacements and branch targets are arbitrary.
+    static const SInstructionClass kInstructionClasses[] = {
+#ifdef _WIN64
+        {.name = L"Plain ALU", .bytes = {0x48, 0x01, 0xc8}, .isSupported = nullptr},
+        {.name = L"RIP-relative load",
+         .bytes = {0x48, 0x8b, 0x05, 0x00, 0x01, 0x00, 0x00},
+         .isSupported = nullptr},
+#else
+        {.name = L"Plain ALU", .bytes = {0x01, 0xc8}, .isSupported = nullptr},
+#endif
+        {.name = L"Conditional branch rel8", .bytes = {0x74, 0x40}, .isSupported = nullptr},
+        {.name = L"Unconditional branch rel32",
+         .bytes = {0xe9, 0x00, 0x01, 0x00, 0x00},
+         .isSupported = nullptr},
+        {.name = L"EVEX register",
+         .bytes = {0x62, 0xf1, 0x7c, 0x48, 0x58, 0xc1},
+         .isSupported = [](const cpu_features::X86Features& features) -> bool
+         {
+           return (0 != features.avx512f);
+         }},
+#ifdef _WIN64
+        {.name = L"EVEX RIP-relative",
+         .bytes = {0x62, 0xf1, 0x7c, 0x48, 0x58, 0x05, 0x00, 0x01, 0x00, 0x00},
+         .isSupported = [](const cpu_features::X86Features& features) -> bool
+         {
+           return (0 != features.avx512f);
+         }},
+#endif
+    };
+
+    /// Receives a value computed from the result of every operation, so that the compiler cannot
+    /// remove operations whose results would otherwise go unused.
+    static volatile size_t operationResultSink;
+
+    /// Measures how long a single operation takes.
+    /// @tparam OperationType Type of callable object that performs the operation once. It is
+    /// passed the index of the operation and returns a value derived from its result.
+    /// @param [in] operation Callable object that performs the operation once.
+    /// @return Median time taken per operation, in nanoseconds.
+    template <typename OperationType> static double MeasureOperation(OperationType operation)
+    {
+      std::vector<int64_t> sampleTicks;
+      sampleTicks.reserve(kNumSamples);
+
+      size_t resultAccumulator = 0;
+      for (size_t i = 0; i < kNumSamples; ++i)
+      {
+        const int64_t startTicks = Now();
+        for (size_t j = 0; j < kNumOperationsPerSample; ++j)
+          resultAccumulator += static_cast<size_t>(operation(j));
+        sampleTicks.push_back(Now() - startTicks);
+      }
+      operationResultSink = resultAccumulator;
+
+      std::sort(sampleTicks.begin(), sampleTicks.end());
+      return (
+          TicksToNanoseconds(sampleTicks[sampleTicks.size() / 2]) /
+          static_cast<double>(kNumOperationsPerSample));
+    }
+
+    /// Prints a single measurement, or a placeholder if it does not apply.
+    /// @param [in] nanoseconds Time taken per operation, in nanoseconds, or a negative value if
+    /// the measurement does not apply.
+    static void PrintMeasurement(const double nanoseconds)
+    {
+      if (nanoseconds < 0.0)
+        wprintf(L" %16s", L"n/a");
+      else
+        wprintf(L" %13.1f ns", nanoseconds);
+    }
+
+    /// Measures and prints each operation for one instruction class.
+    /// @param [in] instructionClass Instruction class to measure.
+    static void MeasureInstructionClass(const SInstructionClass& instructionClass)
+    {
+      wprintf(L"  %-32s", instructionClass.name);
+
+      if ((nullptr != instructionClass.isSupported) &&
+          (false == instructionClass.isSupported(CpuInfo::FeatureFlags())))
+      {
+        wprintf(L" Skipped, not supported by this processor.\n");
+        return;
+      }
+
+      X86Instruction instruction;
+      if (false == instruction.DecodeInstruction(instructionClass.bytes))
+      {
+        wprintf(L" Skipped, failed to decode.\n");
+        return;
+      }
+
+      const double decodeNanoseconds = MeasureOperation(
+          [&instructionClass](size_t) -> bool
+          {
+            X86Instruction decodedInstruction;
+            return decodedInstruction.DecodeInstruction(instructionClass.bytes);
+          });
+
+      uint8_t encodeBuffer[X86Instruction::kMaxInstructionLengthBytes] = {};
+      const double encodeNanoseconds = MeasureOperation(
+          [&instruction, &encodeBuffer](size_t) -> int
+          {
+            return instruction.EncodeInstruction(encodeBuffer);
+          });
+
+      double setDisplacementNanoseconds = -1.0;
+      if (true == instruction.HasPositionDependentMemoryReference())
+      {
+        setDisplacementNanoseconds = MeasureOperation(
+            [&instruction](size_t operationIndex) -> bool
+            {
+              return instruction.SetMemoryDisplacement(
+                  kDisplacementValues[operationIndex % _countof(kDisplacementValues)]);
+            });
+      }
+
+      const double getLengthNanoseconds = MeasureOperation(
+          [&instruction](size_t) -> int
+          {
+            return instruction.GetLengthBytes();
+          });
+
+      PrintMeasurement(decodeNanoseconds);
+      PrintMeasurement(encodeNanoseconds);
+      PrintMeasurement(setDisplacementNanoseconds);
+      PrintMeasurement(getLengthNanoseconds);
+      wprintf(L"\n");
+    }
+
+    void Run(void)
+    {
+      wprintf(
+          L"  %-32s %16s %16s %16s %16s\n",
+          kArchitectureName,
+          L"Decode",
+          L"Encode",
+          L"SetDisplacement",
+          L"GetLength");
+
+      for (const SInstructionClass& instructionClass : kInstructionClasses)
+        MeasureInstructionClass(instructionClass);
+    }
+  } // namespace InstructionBenchmark
+} // namespace HookshotBenchmark
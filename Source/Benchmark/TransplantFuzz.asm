@@ -0,0 +1,87 @@
+;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;
+; Hookshot
+;   General-purpose library for injecting DLLs and hooking function calls.
+;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;
+; Authored by Samuel Grossman
+; Copyright (c) 2019-2025
+;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;
+
+INCLUDE TestDefinitions.inc
+
+
+; Executes a generated instruction stream with a known initial register state and captures the
+; register state it leaves behind, so that the transplant fuzzer can compare an original function
+; with its trampoline. The first parameter (scx) points to a register state structure, laid out as
+; sax, sbx, scx, sdx, ssi, sdi, sbp, flags, which is loaded before the call and overwritten with
+; the resulting values afterwards. The second parameter (sdx) is the address of the code to call.
+; Stack pointer is the only general-purpose register that generated code must not modify.
+
+
+IFDEF _WIN64
+PTRSZ EQU 8
+ELSE
+PTRSZ EQU 4
+ENDIF
+
+
+_TEXT                                       SEGMENT
+
+
+BEGIN_HOOKSHOT_TEST_FUNCTION                TransplantFuzz_Execute
+    push sbx
+    push ssi
+    push sdi
+    push sbp
+    push scx
+    push sdx
+
+    push SIZE_T PTR [scx + 7 * PTRSZ]
+IFDEF _WIN64
+    popfq
+ELSE
+    popfd
+ENDIF
+
+    mov sax, SIZE_T PTR [scx + 0 * PTRSZ]
+    mov sbx, SIZE_T PTR [scx + 1 * PTRSZ]
+    mov sdx, SIZE_T PTR [scx + 3 * PTRSZ]
+    mov ssi, SIZE_T PTR [scx + 4 * PTRSZ]
+    mov sdi, SIZE_T PTR [scx + 5 * PTRSZ]
+    mov sbp, SIZE_T PTR [scx + 6 * PTRSZ]
+    mov scx, SIZE_T PTR [scx + 2 * PTRSZ]
+
+    call SIZE_T PTR [ssp]
+
+IFDEF _WIN64
+    pushfq
+ELSE
+    pushfd
+ENDIF
+    push sax
+
+    ; Stack now holds, from the top: sax, flags, code address, register state address.
+    mov sax, SIZE_T PTR [ssp + 3 * PTRSZ]
+    mov SIZE_T PTR [sax + 1 * PTRSZ], sbx
+    mov SIZE_T PTR [sax + 2 * PTRSZ], scx
+    mov SIZE_T PTR [sax + 3 * PTRSZ], sdx
+    mov SIZE_T PTR [sax + 4 * PTRSZ], ssi
+    mov SIZE_T PTR [sax + 5 * PTRSZ], sdi
+    mov SIZE_T PTR [sax + 6 * PTRSZ], sbp
+    pop sbx
+    mov SIZE_T PTR [sax + 0 * PTRSZ], sbx
+    pop sbx
+    mov SIZE_T PTR [sax + 7 * PTRSZ], sbx
+
+    add ssp, 2 * PTRSZ
+    pop sbp
+    pop sdi
+    pop ssi
+    pop sbx
+    ret
+END_HOOKSHOT_TEST_FUNCTION                  TransplantFuzz_Execute
+
+
+_TEXT                                       ENDS
+
+
+END
@@ -0,0 +1,542 @@
+/***************************************************************************************************
+ * Hookshot
+ *   General-purpose library for injecting DLLs and hooking function calls.
+ ***************************************************************************************************
+ * Authored by Samuel Grossman
+ * Copyright (c) 2019-2025
+ ***********************************************************************************************//**
+ * @file TransplantFuzzer.cpp
+ *   Implementation of differential fuzzing of the instruction transplanting performed when hooks
+ *   are created.
+ **************************************************************************************************/
+
+#include "TransplantFuzzer.h"
+
+#include <windows.h>
+
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <random>
+#include <vector>
+
+#include "Hookshot.h"
+#include "TestGlobals.h"
+#include "X86Instruction.h"
+
+namespace HookshotBenchmark
+{
+  namespace TransplantFuzzer
+  {
+    /// Register state loaded before and captured after executing generated code. Layout must match
+    /// the one expected by the assembly function that executes generated code.
+    struct SRegisterState
+    {
+      size_t sax;
+      size_t sbx;
+      size_t scx;
+      size_t sdx;
+      size_t ssi;
+      size_t sdi;
+      size_t sbp;
+      size_t flags;
+
+      bool operator==(const SRegisterState& other) const = default;
+    };
+  } // namespace TransplantFuzzer
+} // namespace HookshotBenchmark
+
+extern "C" void __fastcall TransplantFuzz_Execute(
+    HookshotBenchmark::TransplantFuzzer::SRegisterState* state, const void* code);
+
+namespace HookshotBenchmark
+{
+  namespace TransplantFuzzer
+  {
+    using ::HookshotTest::HookshotInterface;
+
+    /// Arithmetic status flags, which are the only flags that generated code can affect and
+    /// therefore the only ones that are loaded and compared.
+    static constexpr size_t kArithmeticFlagsMask = 0x08d5;
+
+    /// Flag that is always set in the flags register.
+    static constexpr size_t kReservedFlagAlwaysSet = 0x0002;
+
+    /// Size of the readable data area at the start of the sandbox, which generated memory loads
+    /// read from.
+    static constexpr size_t kDataAreaSizeBytes = 4096;
+
+    /// Size of the sandbox slot that holds each generated instruction stream and its hook function.
+    static constexpr size_t kSlotSizeBytes = 64;
+
+    /// Offset within each slot of its hook function, which is never executed but must be distinct
+    /// for each hook.
+    static constexpr size_t kHookFunctionOffset = 56;
+
+    /// Maximum size of each generated instruction stream, including its final `ret` instruction.
+    static constexpr size_t kMaxStreamSizeBytes = 48;
+
+    /// Maximum number of bytes that appending one instruction can add, including the instructions
+    /// skipped by a generated forward branch.
+    static constexpr size_t kMaxAppendSizeBytes = 2 + (3 * 7);
+
+    /// Maximum number of instructions generated at the top level of each instruction stream.
+    static constexpr unsigned int kMaxInstructionsPerStream = 8;
+
+    /// General-purpose register numbers that generated code is allowed to use, which are all of
+    /// the ones available in both 32-bit and 64-bit mode other than the stack pointer.
+    static constexpr uint8_t kUsableRegisters[] = {0, 1, 2, 3, 5, 6, 7};
+
+    /// Kinds of instructions that the generator can produce.
+    enum class EInstructionKind : unsigned int
+    {
+      MoveImmediate,
+      ArithmeticRegister,
+      ArithmeticImmediate,
+      Shift,
+      IncrementDecrement,
+      LoadEffectiveAddress,
+      ConditionalMove,
+      Nop,
+      PositionRelativeAddress,
+      MemoryLoad,
+      ForwardBranch,
+      UpperBoundValue
+    };
+
+    /// Totals accumulated over a fuzzing run.
+    struct SFuzzStatistics
+    {
+      size_t numGenerated;
+      size_t numInvalid;
+      size_t numRejected;
+      size_t numHooked;
+      size_t numMismatches;
+      size_t numTransplantedInstructions;
+      size_t numTransplantedBytes;
+      int64_t hookTicks;
+    };
+
+    /// Generates a uniformly-distributed random number in the range [0, bound).
+    /// @param [in,out] rng Random number generator.
+    /// @param [in] bound Upper bound, exclusive.
+    /// @return Random number.
+    static inline unsigned int RandomBelow(std::mt19937& rng, unsigned int bound)
+    {
+      return static_cast<unsigned int>(rng() % bound);
+    }
+
+    /// Generates a random pointer-sized value.
+    /// @param [in,out] rng Random number generator.
+    /// @return Random value.
+    static inline size_t RandomValue(std::mt19937& rng)
+    {
+      return ((static_cast<size_t>(rng()) << (sizeof(size_t) * 4)) ^ static_cast<size_t>(rng()));
+    }
+
+    /// Picks a random register that generated code is allowed to use.
+    /// @param [in,out] rng Random number generator.
+    /// @return Register number.
+    static inline uint8_t RandomRegister(std::mt19937& rng)
+    {
+      return kUsableRegisters[RandomBelow(rng, _countof(kUsableRegisters))];
+    }
+
+    /// Appends a 32-bit value to an instruction stream in little-endian byte order.
+    /// @param [in,out] stream Instruction stream.
+    /// @param [in] value Value to append.
+    static void AppendInt32(std::vector<uint8_t>& stream, int32_t value)
+    {
+      uint8_t valueBytes[sizeof(value)];
+      memcpy(valueBytes, &value, sizeof(value));
+      stream.insert(stream.end(), valueBytes, valueBytes + sizeof(valueBytes));
+    }
+
+    /// Appends one randomly-chosen instruction to an instruction stream. Every instruction either
+    /// operates purely on the usable registers and flags or reads from the data area, so executing
+    /// it cannot fault, and none of them modify the stack pointer.
+    /// @param [in,out] rng Random number generator.
+    /// @param [in] dataArea Start of the readable data area.
+    /// @param [in] streamAddress Address at which the first byte of the stream will be placed.
+    /// @param [in,out] stream Instruction stream to which to append.
+    /// @param [in] allowBranch Whether or not a forward branch can be generated.
+    static void AppendRandomInstruction(
+        std::mt19937& rng,
+        const uint8_t* dataArea,
+        const uint8_t* streamAddress,
+        std::vector<uint8_t>& stream,
+        bool allowBranch)
+    {
+      const uint8_t* const instructionAddress = &streamAddress[stream.size()];
+      const uint8_t reg = RandomRegister(rng);
+      const uint8_t otherReg = RandomRegister(rng);
+#ifdef _WIN64
+      const bool useRexW = (0 == RandomBelow(rng, 2));
+#else
+      const bool useRexW = false;
+#endif
+
+      switch (static_cast<EInstructionKind>(
+          RandomBelow(rng, static_cast<unsigned int>(EInstructionKind::UpperBoundValue))))
+      {
+        case EInstructionKind::ArithmeticRegister:
+        {
+          // add, or, and, sub, xor, cmp, test, mov
+          static constexpr uint8_t kOpcodes[] = {0x01, 0x09, 0x21, 0x29, 0x31, 0x39, 0x85, 0x89};
+          if (true == useRexW) stream.push_back(0x48);
+          stream.push_back(kOpcodes[RandomBelow(rng, _countof(kOpcodes))]);
+          stream.push_back(static_cast<uint8_t>(0xc0 | (otherReg << 3) | reg));
+          break;
+        }
+
+        case EInstructionKind::ArithmeticImmediate:
+          // add, or, adc, sbb, and, sub, xor, cmp with a sign-extended 8-bit immediate
+          if (true == useRexW) stream.push_back(0x48);
+          stream.push_back(0x83);
+          stream.push_back(static_cast<uint8_t>(0xc0 | (RandomBelow(rng, 8) << 3) | reg));
+          stream.push_back(static_cast<uint8_t>(rng()));
+          break;
+
+        case EInstructionKind::Shift:
+        {
+          // rol, ror, shl, shr, sar
+          static constexpr uint8_t kOperations[] = {0, 1, 4, 5, 7};
+          if (true == useRexW) stream.push_back(0x48);
+          stream.push_back(0xc1);
+          stream.push_back(static_cast<uint8_t>(
+              0xc0 | (kOperations[RandomBelow(rng, _countof(kOperations))] << 3) | reg));
+          stream.push_back(static_cast<uint8_t>(RandomBelow(rng, 32)));
+          break;
+        }
+
+        case EInstructionKind::IncrementDecrement:
+          if (true == useRexW) stream.push_back(0x48);
+          stream.push_back(0xff);
+          stream.push_back(static_cast<uint8_t>(0xc0 | (RandomBelow(rng, 2) << 3) | reg));
+          break;
+
+        case EInstructionKind::LoadEffectiveAddress:
+          if (true == useRexW) stream.push_back(0x48);
+          stream.push_back(0x8d);
+          stream.push_back(static_cast<uint8_t>(0x40 | (reg << 3) | otherReg));
+          stream.push_back(static_cast<uint8_t>(rng()));
+          break;
+
+        case EInstructionKind::ConditionalMove:
+          if (true == useRexW) stream.push_back(0x48);
+          stream.push_back(0x0f);
+          stream.push_back(static_cast<uint8_t>(0x40 | RandomBelow(rng, 16)));
+          stream.push_back(static_cast<uint8_t>(0xc0 | (reg << 3) | otherReg));
+          break;
+
+        case EInstructionKind::Nop:
+        {
+          // One-byte, two-byte, three-byte, and four-byte forms of nop
+          static constexpr uint8_t kNops[][4] = {
+              {0x90}, {0x66, 0x90}, {0x0f, 0x1f, 0x00}, {0x0f, 0x1f, 0x40, 0x00}};
+          const unsigned int nopLength = 1 + RandomBelow(rng, _countof(kNops));
+          stream.insert(stream.end(), &kNops[nopLength - 1][0], &kNops[nopLength - 1][nopLength]);
+          break;
+        }
+
+#ifdef _WIN64
+        case EInstructionKind::PositionRelativeAddress:
+        {
+          // lea reg, [rip + disp32]
+          stream.push_back(0x48);
+          stream.push_back(0x8d);
+          stream.push_back(static_cast<uint8_t>(0x05 | (reg << 3)));
+          AppendInt32(stream, static_cast<int32_t>(rng()));
+          break;
+        }
+
+        case EInstructionKind::MemoryLoad:
+        {
+          // mov reg, [rip + disp32], with the displacement chosen to read from the data area
+          static constexpr size_t kInstructionLength = 7;
+          const uint8_t* const loadAddress = &dataArea[sizeof(size_t) *
+              RandomBelow(rng, static_cast<unsigned int>(kDataAreaSizeBytes / sizeof(size_t)))];
+          stream.push_back(0x48);
+          stream.push_back(0x8b);
+          stream.push_back(static_cast<uint8_t>(0x05 | (reg << 3)));
+          AppendInt32(
+              stream,
+              static_cast<int32_t>(loadAddress - &instructionAddress[kInstructionLength]));
+          break;
+        }
+#else
+        case EInstructionKind::PositionRelativeAddress:
+        case EInstructionKind::MemoryLoad:
+        {
+          // mov reg, [disp32], which uses an absolute address in 32-bit mode
+          const uint8_t* const loadAddress = &dataArea[sizeof(size_t) *
+              RandomBelow(rng, static_cast<unsigned int>(kDataAreaSizeBytes / sizeof(size_t)))];
+          stream.push_back(0x8b);
+          stream.push_back(static_cast<uint8_t>(0x05 | (reg << 3)));
+          AppendInt32(stream, static_cast<int32_t>(reinterpret_cast<uintptr_t>(loadAddress)));
+          break;
+        }
+#endif
+
+        case EInstructionKind::ForwardBranch:
+          if (true == allowBranch)
+          {
+            // Either an unconditional or a conditional short branch that skips over a few
+            // instructions, all of which are generated first so that the displacement is known.
+            // The branch itself is 2 bytes long, so that is where the skipped instructions start.
+            std::vector<uint8_t> skippedInstructions;
+            const unsigned int numSkippedInstructions = 1 + RandomBelow(rng, 3);
+            for (unsigned int i = 0; i < numSkippedInstructions; ++i)
+              AppendRandomInstruction(
+                  rng, dataArea, &instructionAddress[2], skippedInstructions, false);
+
+            const unsigned int branchOpcode =
+                ((0 == RandomBelow(rng, 4)) ? 0xeb : (0x70 | RandomBelow(rng, 16)));
+            stream.push_back(static_cast<uint8_t>(branchOpcode));
+            stream.push_back(static_cast<uint8_t>(skippedInstructions.size()));
+            stream.insert(stream.end(), skippedInstructions.begin(), skippedInstructions.end());
+            break;
+          }
+          [[fallthrough]];
+
+        case EInstructionKind::MoveImmediate:
+        default:
+          stream.push_back(static_cast<uint8_t>(0xb8 | reg));
+          AppendInt32(stream, static_cast<int32_t>(rng()));
+          break;
+      }
+    }
+
+    /// Generates a random instruction stream that ends with a `ret` instruction.
+    /// @param [in,out] rng Random number generator.
+    /// @param [in] dataArea Start of the readable data area.
+    /// @param [in] streamAddress Address at which the first byte of the stream will be placed.
+    /// @return Generated instruction stream.
+    static std::vector<uint8_t> GenerateInstructionStream(
+        std::mt19937& rng, const uint8_t* dataArea, const uint8_t* streamAddress)
+    {
+      std::vector<uint8_t> stream;
+      const unsigned int numInstructions = 1 + RandomBelow(rng, kMaxInstructionsPerStream);
+
+      for (unsigned int i = 0; i < numInstructions; ++i)
+      {
+        if ((stream.size() + kMaxAppendSizeBytes) >= kMaxStreamSizeBytes) break;
+        AppendRandomInstruction(rng, dataArea, streamAddress, stream, true);
+      }
+
+      stream.push_back(0xc3);
+      return stream;
+    }
+
+    /// Decodes an entire generated instruction stream to verify that it consists only of valid
+    /// instructions whose lengths add up to the length of the stream.
+    /// @param [in] stream Instruction stream to check.
+    /// @return `true` if the stream is valid, `false` otherwise.
+    static bool IsValidInstructionStream(const std::vector<uint8_t>& stream)
+    {
+      size_t numDecodedBytes = 0;
+      while (numDecodedBytes < stream.size())
+      {
+        Hookshot::X86Instruction instruction;
+        if (false ==
+            instruction.DecodeInstruction(
+                &stream[numDecodedBytes], static_cast<int>(stream.size() - numDecodedBytes)))
+          return false;
+
+        numDecodedBytes += static_cast<size_t>(instruction.GetLengthBytes());
+      }
+
+      return (stream.size() == numDecodedBytes);
+    }
+
+    /// Counts the instructions and bytes that must be transplanted to make room for the jump that
+    /// redirects an original function to its hook.
+    /// @param [in] stream Instruction stream that was hooked.
+    /// @param [in,out] statistics Statistics to update.
+    static void CountTransplantedInstructions(
+        const std::vector<uint8_t>& stream, SFuzzStatistics& statistics)
+    {
+      size_t numDecodedBytes = 0;
+      while (numDecodedBytes < Hookshot::X86Instruction::kJumpInstructionLengthBytes)
+      {
+        Hookshot::X86Instruction instruction;
+        if (false ==
+            instruction.DecodeInstruction(
+                &stream[numDecodedBytes], static_cast<int>(stream.size() - numDecodedBytes)))
+          break;
+
+        numDecodedBytes += static_cast<size_t>(instruction.GetLengthBytes());
+        statistics.numTransplantedInstructions += 1;
+      }
+
+      statistics.numTransplantedBytes += numDecodedBytes;
+    }
+
+    /// Prints the details of a mismatch between an original instruction stream and its trampoline.
+    /// @param [in] iteration Iteration in which the mismatch was found.
+    /// @param [in] stream Instruction stream that was hooked.
+    /// @param [in] expected Register state left behind by the original instruction stream.
+    /// @param [in] actual Register state left behind by the trampoline.
+    static void PrintMismatch(
+        size_t iteration,
+        const std::vector<uint8_t>& stream,
+        const SRegisterState& expected,
+        const SRegisterState& actual)
+    {
+      wprintf(L"    Mismatch in iteration %llu:\n", static_cast<unsigned long long>(iteration));
+
+      size_t numDecodedBytes = 0;
+      while (numDecodedBytes < stream.size())
+      {
+        Hookshot::X86Instruction instruction;
+        if (false ==
+            instruction.DecodeInstruction(
+                &stream[numDecodedBytes], static_cast<int>(stream.size() - numDecodedBytes)))
+          break;
+
+        wchar_t disassembly[128] = L"";
+        instruction.PrintDisassembly(disassembly, _countof(disassembly));
+        wprintf(
+            L"        +%02llu: %s\n", static_cast<unsigned long long>(numDecodedBytes), disassembly);
+        numDecodedBytes += static_cast<size_t>(instruction.GetLengthBytes());
+      }
+
+      static constexpr struct
+      {
+        const wchar_t* name;
+        size_t SRegisterState::*value;
+      } kRegisters[] = {
+          {L"sax", &SRegisterState::sax},
+          {L"sbx", &SRegisterState::sbx},
+          {L"scx", &SRegisterState::scx},
+          {L"sdx", &SRegisterState::sdx},
+          {L"ssi", &SRegisterState::ssi},
+          {L"sdi", &SRegisterState::sdi},
+          {L"sbp", &SRegisterState::sbp},
+          {L"flags", &SRegisterState::flags}};
+
+      for (const auto& reg : kRegisters)
+      {
+        if (expected.*reg.value != actual.*reg.value)
+          wprintf(
+              L"        %-5s expected 0x%llx, actual 0x%llx\n",
+              reg.name,
+              static_cast<unsigned long long>(expected.*reg.value),
+              static_cast<unsigned long long>(actual.*reg.value));
+      }
+    }
+
+    bool Run(uint32_t seed, size_t numIterations)
+    {
+      std::mt19937 rng(seed);
+
+      // Sandbox consists of a data area followed by one slot per iteration. Slots are never reused
+      // because hooks are left in place.
+      const size_t sandboxSizeBytes = kDataAreaSizeBytes + (numIterations * kSlotSizeBytes);
+      uint8_t* const sandbox = reinterpret_cast<uint8_t*>(VirtualAlloc(
+          nullptr, sandboxSizeBytes, MEM_RESERVE | MEM_COMMIT, PAGE_EXECUTE_READWRITE));
+      if (nullptr == sandbox)
+      {
+        wprintf(L"    Failed to allocate the sandbox.\n");
+        return false;
+      }
+
+      uint8_t* const dataArea = sandbox;
+      for (size_t i = 0; i < kDataAreaSizeBytes; ++i)
+        dataArea[i] = static_cast<uint8_t>(rng());
+
+      SFuzzStatistics statistics = {};
+
+      for (size_t iteration = 0; iteration < numIterations; ++iteration)
+      {
+        uint8_t* const slot = &sandbox[kDataAreaSizeBytes + (iteration * kSlotSizeBytes)];
+        const std::vector<uint8_t> stream = GenerateInstructionStream(rng, dataArea, slot);
+        statistics.numGenerated += 1;
+
+        if (false == IsValidInstructionStream(stream))
+        {
+          statistics.numInvalid += 1;
+          continue;
+        }
+
+        memcpy(slot, stream.data(), stream.size());
+        slot[kHookFunctionOffset] = 0xc3;
+        FlushInstructionCache(GetCurrentProcess(), slot, kSlotSizeBytes);
+
+        const SRegisterState initialState = {
+            .sax = RandomValue(rng),
+            .sbx = RandomValue(rng),
+            .scx = RandomValue(rng),
+            .sdx = RandomValue(rng),
+            .ssi = RandomValue(rng),
+            .sdi = RandomValue(rng),
+            .sbp = RandomValue(rng),
+            .flags = ((RandomValue(rng) & kArithmeticFlagsMask) | kReservedFlagAlwaysSet)};
+
+        // Reference behavior is captured before hooking, at the same address, so that any
+        // position-relative references produce the same values in both executions.
+        SRegisterState expectedState = initialState;
+        TransplantFuzz_Execute(&expectedState, slot);
+        expectedState.flags &= kArithmeticFlagsMask;
+
+        LARGE_INTEGER startTicks;
+        LARGE_INTEGER endTicks;
+        QueryPerformanceCounter(&startTicks);
+        const Hookshot::EResult result =
+            HookshotInterface()->CreateHook(slot, &slot[kHookFunctionOffset]);
+        QueryPerformanceCounter(&endTicks);
+        statistics.hookTicks += (endTicks.QuadPart - startTicks.QuadPart);
+
+        if (false == Hookshot::SuccessfulResult(result))
+        {
+          statistics.numRejected += 1;
+          continue;
+        }
+
+        statistics.numHooked += 1;
+        CountTransplantedInstructions(stream, statistics);
+
+        SRegisterState actualState = initialState;
+        TransplantFuzz_Execute(&actualState, HookshotInterface()->GetOriginalFunction(slot));
+        actualState.flags &= kArithmeticFlagsMask;
+
+        if (expectedState != actualState)
+        {
+          statistics.numMismatches += 1;
+          PrintMismatch(iteration, stream, expectedState, actualState);
+        }
+      }
+
+      LARGE_INTEGER ticksPerSecond;
+      QueryPerformanceFrequency(&ticksPerSecond);
+      const double hookSeconds =
+          static_cast<double>(statistics.hookTicks) / static_cast<double>(ticksPerSecond.QuadPart);
+      const double numHooked = static_cast<double>(statistics.numHooked);
+      const double numTransplantedInstructions =
+          static_cast<double>(statistics.numTransplantedInstructions);
+      const double numTransplantedBytes = static_cast<double>(statistics.numTransplantedBytes);
+
+      wprintf(
+          L"  %llu stream(s) generated, %llu hooked, %llu rejected by Hookshot, %llu invalid\n",
+          static_cast<unsigned long long>(statistics.numGenerated),
+          static_cast<unsigned long long>(statistics.numHooked),
+          static_cast<unsigned long long>(statistics.numRejected),
+          static_cast<unsigned long long>(statistics.numInvalid));
+      wprintf(
+          L"  %.0f transplants/s, %.2f instruction(s) and %.2f byte(s) moved per transplant, %.2f byte(s) moved per instruction\n",
+          ((0.0 == hookSeconds) ? 0.0 : (numHooked / hookSeconds)),
+          ((0.0 == numHooked) ? 0.0 : (numTransplantedInstructions / numHooked)),
+          ((0.0 == numHooked) ? 0.0 : (numTransplantedBytes / numHooked)),
+          ((0.0 == numTransplantedInstructions)
+               ? 0.0
+               : (numTransplantedBytes / numTransplantedInstructions)));
+      wprintf(
+          L"  %llu mismatch(es) found using seed %u\n",
+          static_cast<unsigned long long>(statistics.numMismatches),
+          static_cast<unsigned int>(seed));
+
+      return (0 == statistics.numMismatches);
+    }
+  } // namespace TransplantFuzzer
+} // namespace HookshotBenchmark
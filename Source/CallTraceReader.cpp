@@ -0,0 +1,142 @@
+/***************************************************************************************************
+ * Hookshot
+ *   General-purpose library for injecting DLLs and hooking function calls.
+ ***************************************************************************************************
+ * Authored by Samuel Grossman
+ * Copyright (c) 2019-2025
+ ***********************************************************************************************//**
+ * @file CallTraceReader.cpp
+ *   Implementation of draining the calls that call trace hooks record into the per-thread ring
+ *   buffers of a call trace section.
+ **************************************************************************************************/
+
+#include "CallTraceReader.h"
+
+#include <algorithm>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+#include "CallTracing.h"
+
+namespace Hookshot
+{
+  namespace CallTraceReader
+  {
+    /// Size of each record, in bytes.
+    static constexpr uint64_t kRecordSizeBytes = sizeof(CallTracing::SRecord);
+
+    /// Size of the records in each per-thread ring buffer, in bytes.
+    static constexpr uint64_t kRingSizeBytes =
+        kRecordSizeBytes * CallTracing::kRecordsPerThreadBuffer;
+
+    /// Reads the write offset of a per-thread ring buffer. A 32-bit reader cannot read the whole
+    /// 64-bit value at once and could combine the halves of two different values, so the value is
+    /// read until two consecutive reads agree.
+    /// @param [in] bufferHeader Header of the ring buffer.
+    /// @return Write offset of the ring buffer.
+    static uint64_t ReadWriteOffset(const CallTracing::SThreadBufferHeader& bufferHeader)
+    {
+      uint64_t writeOffset = bufferHeader.writeOffset;
+
+      while (true)
+      {
+        const uint64_t writeOffsetAgain = bufferHeader.writeOffset;
+        if (writeOffsetAgain == writeOffset) return writeOffset;
+
+        writeOffset = writeOffsetAgain;
+      }
+    }
+
+    bool IsSectionLayoutValid(const CallTracing::SHeader* header)
+    {
+      if (CallTracing::kSectionMagic != header->magic) return false;
+
+      std::atomic_thread_fence(std::memory_order_acquire);
+      return (
+          (CallTracing::kSectionVersion == header->version) &&
+          (CallTracing::kMaxThreadBuffers == header->maxThreadBuffers) &&
+          (CallTracing::kRecordsPerThreadBuffer == header->recordsPerThreadBuffer) &&
+          (kRecordSizeBytes == header->recordSizeBytes));
+    }
+
+    bool DrainRecords(
+        const CallTracing::SHeader* header,
+        SDrainState* drainState,
+        std::vector<SDrainedRecord>* drainedRecords)
+    {
+      drainedRecords->clear();
+      if (false == IsSectionLayoutValid(header)) return false;
+
+      const CallTracing::SThreadBuffer* const threadBuffers =
+          CallTracing::ThreadBuffersForHeader(header);
+
+      for (uint32_t bufferIndex = 0; bufferIndex < CallTracing::kMaxThreadBuffers; ++bufferIndex)
+      {
+        const CallTracing::SThreadBuffer& threadBuffer = threadBuffers[bufferIndex];
+        uint64_t& nextRecordOffset = drainState->nextRecordOffsets[bufferIndex];
+
+        // A thread that has exited has finished writing all of its records. Ownership is checked
+        // both before and after reading the write offset in case the buffer was given to another
+        // thread in between, which might then have started writing a record.
+        const uint32_t threadId = threadBuffer.header.threadId.load(std::memory_order_acquire);
+        uint64_t endRecordOffset = ReadWriteOffset(threadBuffer.header);
+        if ((0 != threadId) ||
+            (0 != threadBuffer.header.threadId.load(std::memory_order_acquire)))
+          endRecordOffset =
+              ((endRecordOffset > kRecordSizeBytes) ? (endRecordOffset - kRecordSizeBytes) : 0);
+
+        if (endRecordOffset <= nextRecordOffset) continue;
+
+        // Only the most recent records remain in the ring. Any older ones were overwritten before
+        // they could be drained.
+        uint64_t firstRecordOffset = nextRecordOffset;
+        if ((endRecordOffset - firstRecordOffset) > kRingSizeBytes)
+          firstRecordOffset = endRecordOffset - kRingSizeBytes;
+
+        const size_t firstDrainedRecordIndex = drainedRecords->size();
+        for (uint64_t recordOffset = firstRecordOffset; recordOffset < endRecordOffset;
+             recordOffset += kRecordSizeBytes)
+        {
+          drainedRecords->push_back(
+              {.threadId = threadId,
+               .threadBufferIndex = bufferIndex,
+               .record = threadBuffer.records[(recordOffset % kRingSizeBytes) / kRecordSizeBytes]});
+        }
+
+        // Writing a record begins once the write offset has advanced past it. A record might have
+        // been overwritten while being copied if the write offset has since advanced past the
+        // record that reuses its position in the ring.
+        std::atomic_thread_fence(std::memory_order_acquire);
+        const uint64_t writeOffsetAfterCopy = ReadWriteOffset(threadBuffer.header);
+
+        uint64_t firstIntactRecordOffset = firstRecordOffset;
+        if (writeOffsetAfterCopy > (firstRecordOffset + kRingSizeBytes))
+          firstIntactRecordOffset =
+              std::min(writeOffsetAfterCopy - kRingSizeBytes, endRecordOffset);
+
+        const uint64_t numRecordsOverwritten =
+            (firstIntactRecordOffset - firstRecordOffset) / kRecordSizeBytes;
+        drainedRecords->erase(
+            drainedRecords->begin() + static_cast<ptrdiff_t>(firstDrainedRecordIndex),
+            drainedRecords->begin() +
+                static_cast<ptrdiff_t>(firstDrainedRecordIndex + numRecordsOverwritten));
+
+        drainState->numRecordsLost +=
+            ((firstRecordOffset - nextRecordOffset) / kRecordSizeBytes) + numRecordsOverwritten;
+        nextRecordOffset = endRecordOffset;
+      }
+
+      std::stable_sort(
+          drainedRecords->begin(),
+          drainedRecords->end(),
+          [](const SDrainedRecord& a, const SDrainedRecord& b) -> bool
+          {
+            return (a.record.timestamp < b.record.timestamp);
+          });
+
+      return true;
+    }
+  } // namespace CallTraceReader
+} // namespace Hookshot
@@ -0,0 +1,592 @@
+/***************************************************************************************************
+ * Hookshot
+ *   General-purpose library for injecting DLLs and hooking function calls.
+ ***************************************************************************************************
+ * Authored by Samuel Grossman
+ * Copyright (c) 2019-2025
+ ***********************************************************************************************//**
+ * @file CallTracing.cpp
+ *   Implementation of recording calls intercepted by call trace hooks into a named shared memory
+ *   section.
+ **************************************************************************************************/
+
+#include "CallTracing.h"
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <intrin.h>
+
+#include <Infra/Core/Message.h>
+#include <Infra/Core/ProcessInfo.h>
+#include <Infra/Core/Strings.h>
+
+#include "ApiWindows.h"
+#include "DependencyProtect.h"
+#include "HookStore.h"
+#include "Strings.h"
+
+namespace Hookshot
+{
+  namespace CallTracing
+  {
+    /// Shared call recording code, to which every call trace stub jumps after loading its own
+    /// address. Reads the calling thread's ring buffer address from a thread-local storage slot
+    /// held directly in the thread environment block and, if there is one, records the arguments,
+    /// return address, original function address, and time stamp counter into the next record.
+    /// Then jumps to the address held in the call trace stub. In 64-bit mode, the call trace stub's
+    /// address arrives in r11, and registers rax, r10, and r11 are used as scratch because they are
+    /// volatile and never hold parameters. In 32-bit mode, the call trace stub's address arrives on
+    /// the top of the stack, and every register that is used is saved and restored because some
+    /// calling conventions pass parameters in registers. Either way, the flags are also modified.
+    static constexpr uint8_t kRecorderCode[] = {
+#ifdef _WIN64
+        // mov r10, QWORD PTR gs:[<buffer slot offset>]
+        0x65,
+        0x4c,
+        0x8b,
+        0x14,
+        0x25,
+        0x00,
+        0x00,
+        0x00,
+        0x00,
+
+        // test r10, r10
+        0x4d,
+        0x85,
+        0xd2,
+
+        // jz $+65
+        0x74,
+        0x3f,
+
+        // mov rax, QWORD PTR [r10]
+        0x49,
+        0x8b,
+        0x02,
+
+        // add QWORD PTR [r10], <record size>
+        0x49,
+        0x83,
+        0x02,
+        0x40,
+
+        // and eax, <ring size mask>
+        0x25,
+        0x00,
+        0x00,
+        0x00,
+        0x00,
+
+        // lea r10, [r10+rax+<record size>]
+        0x4d,
+        0x8d,
+        0x54,
+        0x02,
+        0x40,
+
+        // mov QWORD PTR [r10], rcx
+        0x49,
+        0x89,
+        0x0a,
+
+        // mov QWORD PTR [r10+8], rdx
+        0x49,
+        0x89,
+        0x52,
+        0x08,
+
+        // mov QWORD PTR [r10+16], r8
+        0x4d,
+        0x89,
+        0x42,
+        0x10,
+
+        // mov QWORD PTR [r10+24], r9
+        0x4d,
+        0x89,
+        0x4a,
+        0x18,
+
+        // mov rax, QWORD PTR [rsp]
+        0x48,
+        0x8b,
+        0x04,
+        0x24,
+
+        // mov QWORD PTR [r10+32], rax
+        0x49,
+        0x89,
+        0x42,
+        0x20,
+
+        // mov rax, QWORD PTR [r11+32]
+        0x49,
+        0x8b,
+        0x43,
+        0x20,
+
+        // mov QWORD PTR [r10+40], rax
+        0x49,
+        0x89,
+        0x42,
+        0x28,
+
+        // push rdx
+        0x52,
+
+        // rdtsc
+        0x0f,
+        0x31,
+
+        // shl rdx, 32
+        0x48,
+        0xc1,
+        0xe2,
+        0x20,
+
+        // or rax, rdx
+        0x48,
+        0x09,
+        0xd0,
+
+        // pop rdx
+        0x5a,
+
+        // mov QWORD PTR [r10+48], rax
+        0x49,
+        0x89,
+        0x42,
+        0x30,
+
+        // jmp QWORD PTR [r11+24]
+        0x41,
+        0xff,
+        0x63,
+        0x18,
+#else
+        // push ecx
+        0x51,
+
+        // push edx
+        0x52,
+
+        // mov edx, DWORD PTR fs:[<buffer slot offset>]
+        0x64,
+        0x8b,
+        0x15,
+        0x00,
+        0x00,
+        0x00,
+        0x00,
+
+        // test edx, edx
+        0x85,
+        0xd2,
+
+        // jz $+97
+        0x74,
+        0x5f,
+
+        // mov ecx, DWORD PTR [edx]
+        0x8b,
+        0x0a,
+
+        // add DWORD PTR [edx], <record size>
+        0x83,
+        0x02,
+        0x40,
+
+        // adc DWORD PTR [edx+4], 0
+        0x83,
+        0x52,
+        0x04,
+        0x00,
+
+        // and ecx, <ring size mask>
+        0x81,
+        0xe1,
+        0x00,
+        0x00,
+        0x00,
+        0x00,
+
+        // lea edx, [edx+ecx+<record size>]
+        0x8d,
+        0x54,
+        0x0a,
+        0x40,
+
+        // mov ecx, DWORD PTR [esp+16]
+        0x8b,
+        0x4c,
+        0x24,
+        0x10,
+
+        // mov DWORD PTR [edx], ecx
+        0x89,
+        0x0a,
+
+        // mov ecx, DWORD PTR [esp+20]
+        0x8b,
+        0x4c,
+        0x24,
+        0x14,
+
+        // mov DWORD PTR [edx+8], ecx
+        0x89,
+        0x4a,
+        0x08,
+
+        // mov ecx, DWORD PTR [esp+24]
+        0x8b,
+        0x4c,
+        0x24,
+        0x18,
+
+        // mov DWORD PTR [edx+16], ecx
+        0x89,
+        0x4a,
+        0x10,
+
+        // mov ecx, DWORD PTR [esp+28]
+        0x8b,
+        0x4c,
+        0x24,
+        0x1c,
+
+        // mov DWORD PTR [edx+24], ecx
+        0x89,
+        0x4a,
+        0x18,
+
+        // mov ecx, DWORD PTR [esp+12]
+        0x8b,
+        0x4c,
+        0x24,
+        0x0c,
+
+        // mov DWORD PTR [edx+32], ecx
+        0x89,
+        0x4a,
+        0x20,
+
+        // mov ecx, DWORD PTR [esp+8]
+        0x8b,
+        0x4c,
+        0x24,
+        0x08,
+
+        // mov ecx, DWORD PTR [ecx+32]
+        0x8b,
+        0x49,
+        0x20,
+
+        // mov DWORD PTR [edx+40], ecx
+        0x89,
+        0x4a,
+        0x28,
+
+        // xor ecx, ecx
+        0x33,
+        0xc9,
+
+        // mov DWORD PTR [edx+4], ecx
+        0x89,
+        0x4a,
+        0x04,
+
+        // mov DWORD PTR [edx+12], ecx
+        0x89,
+        0x4a,
+        0x0c,
+
+        // mov DWORD PTR [edx+20], ecx
+        0x89,
+        0x4a,
+        0x14,
+
+        // mov DWORD PTR [edx+28], ecx
+        0x89,
+        0x4a,
+        0x1c,
+
+        // mov DWORD PTR [edx+36], ecx
+        0x89,
+        0x4a,
+        0x24,
+
+        // mov DWORD PTR [edx+44], ecx
+        0x89,
+        0x4a,
+        0x2c,
+
+        // mov ecx, edx
+        0x8b,
+        0xca,
+
+        // push eax
+        0x50,
+
+        // rdtsc
+        0x0f,
+        0x31,
+
+        // mov DWORD PTR [ecx+48], eax
+        0x89,
+        0x41,
+        0x30,
+
+        // mov DWORD PTR [ecx+52], edx
+        0x89,
+        0x51,
+        0x34,
+
+        // pop eax
+        0x58,
+
+        // pop edx
+        0x5a,
+
+        // pop ecx
+        0x59,
+
+        // push eax
+        0x50,
+
+        // mov eax, DWORD PTR [esp+4]
+        0x8b,
+        0x44,
+        0x24,
+        0x04,
+
+        // mov eax, DWORD PTR [eax+24]
+        0x8b,
+        0x40,
+        0x18,
+
+        // mov DWORD PTR [esp+4], eax
+        0x89,
+        0x44,
+        0x24,
+        0x04,
+
+        // pop eax
+        0x58,
+
+        // ret
+        0xc3,
+#endif
+    };
+
+    /// Byte offset within the call recording code of the thread environment block offset of the
+    /// ring buffer slot, which is an operand of the instruction that loads it.
+    static constexpr size_t kRecorderSlotOperandOffset = 5;
+
+#ifdef _WIN64
+    /// Byte offset within the call recording code of the mask that wraps the write offset around
+    /// the ring, which is an operand of the instruction that applies it.
+    static constexpr size_t kRecorderMaskOperandOffset = 22;
+#else
+    /// Byte offset within the call recording code of the mask that wraps the write offset around
+    /// the ring, which is an operand of the instruction that applies it.
+    static constexpr size_t kRecorderMaskOperandOffset = 24;
+#endif
+
+    // The call recording code addresses the records and the fields within them using 8-bit
+    // displacements and immediates, all of which assume this layout.
+    static_assert(0x40 == sizeof(SRecord), "Call recording code assumes a different record size.");
+    static_assert(
+        0x40 == sizeof(SThreadBufferHeader),
+        "Call recording code assumes a different thread buffer header size.");
+    static_assert(
+        (0x20 == offsetof(SRecord, returnAddress)) && (0x28 == offsetof(SRecord, originalFunc)) &&
+            (0x30 == offsetof(SRecord, timestamp)),
+        "Call recording code assumes a different record layout.");
+
+    /// Offset of the ring buffer slot within the thread environment block, or 0 if call tracing is
+    /// unavailable. Set once, before the call recording code is published.
+    static size_t bufferSlotOffset = 0;
+
+    /// Header of the call trace section, or `nullptr` if call tracing is unavailable or has not yet
+    /// been started. Threads are given per-thread ring buffers only once this is set.
+    static std::atomic<SHeader*> sectionHeader = nullptr;
+
+    /// Reads the calling thread's ring buffer slot.
+    /// @return Ring buffer owned by the calling thread, or `nullptr` if it does not have one.
+    static inline SThreadBuffer* ReadBufferSlot(void)
+    {
+#ifdef _WIN64
+      return reinterpret_cast<SThreadBuffer*>(
+          __readgsqword(static_cast<unsigned long>(bufferSlotOffset)));
+#else
+      return reinterpret_cast<SThreadBuffer*>(
+          __readfsdword(static_cast<unsigned long>(bufferSlotOffset)));
+#endif
+    }
+
+    /// Writes the calling thread's ring buffer slot.
+    /// @param [in] buffer Ring buffer owned by the calling thread, or `nullptr` if it has none.
+    static inline void WriteBufferSlot(SThreadBuffer* buffer)
+    {
+#ifdef _WIN64
+      __writegsqword(
+          static_cast<unsigned long>(bufferSlotOffset),
+          static_cast<unsigned __int64>(reinterpret_cast<size_t>(buffer)));
+#else
+      __writefsdword(
+          static_cast<unsigned long>(bufferSlotOffset),
+          static_cast<unsigned long>(reinterpret_cast<size_t>(buffer)));
+#endif
+    }
+
+    /// Creates and initializes the call trace section for this process. The section is
+    /// deliberately held open and mapped for the lifetime of the process.
+    /// @return Header at the beginning of the section, or `nullptr` if it could not be created.
+    static SHeader* CreateSection(void)
+    {
+      const DWORD processId = Protected::Windows_GetCurrentProcessId();
+
+      const HANDLE section = Protected::Windows_CreateFileMapping(
+          INVALID_HANDLE_VALUE,
+          nullptr,
+          PAGE_READWRITE,
+          0,
+          static_cast<DWORD>(kSectionSizeBytes),
+          Strings::CallTraceSectionName(static_cast<uint32_t>(processId)).AsCString());
+      if (nullptr == section)
+      {
+        Infra::Message::OutputFormatted(
+            Infra::Message::ESeverity::Warning,
+            L"Failed to create the call trace section: %s",
+            Infra::Strings::FromSystemErrorCode(Protected::Windows_GetLastError()).AsCString());
+        return nullptr;
+      }
+
+      SHeader* const header = reinterpret_cast<SHeader*>(
+          Protected::Windows_MapViewOfFile(section, FILE_MAP_WRITE, 0, 0, 0));
+      if (nullptr == header)
+      {
+        Protected::Windows_CloseHandle(section);
+        return nullptr;
+      }
+
+      // Newly-created sections are zero-filled, so all of the per-thread ring buffers already start
+      // out empty and unowned. Readers check the magic value last.
+      header->version = kSectionVersion;
+      header->processId = static_cast<uint32_t>(processId);
+      header->maxThreadBuffers = kMaxThreadBuffers;
+      header->recordsPerThreadBuffer = kRecordsPerThreadBuffer;
+      header->recordSizeBytes = static_cast<uint32_t>(sizeof(SRecord));
+      std::atomic_thread_fence(std::memory_order_release);
+      header->magic = kSectionMagic;
+
+      return header;
+    }
+
+    /// Places the call recording code into executable memory, filling in its operands.
+    /// @return Address of the call recording code, or `nullptr` if it could not be placed.
+    static const void* CreateRecorderCode(void)
+    {
+      uint8_t* const recorderCode = reinterpret_cast<uint8_t*>(Protected::Windows_VirtualAlloc(
+          nullptr, sizeof(kRecorderCode), MEM_RESERVE | MEM_COMMIT, PAGE_READWRITE));
+      if (nullptr == recorderCode) return nullptr;
+
+      std::memcpy(recorderCode, kRecorderCode, sizeof(kRecorderCode));
+
+      const uint32_t slotOperand = static_cast<uint32_t>(bufferSlotOffset);
+      std::memcpy(&recorderCode[kRecorderSlotOperandOffset], &slotOperand, sizeof(slotOperand));
+
+      const uint32_t maskOperand =
+          static_cast<uint32_t>((sizeof(SRecord) * kRecordsPerThreadBuffer) - 1);
+      std::memcpy(&recorderCode[kRecorderMaskOperandOffset], &maskOperand, sizeof(maskOperand));
+
+      DWORD unusedOldProtection = 0;
+      if (0 ==
+          Protected::Windows_VirtualProtect(
+              recorderCode, sizeof(kRecorderCode), PAGE_EXECUTE_READ, &unusedOldProtection))
+      {
+        Protected::Windows_VirtualFree(recorderCode, 0, MEM_RELEASE);
+        return nullptr;
+      }
+
+      Protected::Windows_FlushInstructionCache(
+          Infra::ProcessInfo::GetCurrentProcessHandle(), recorderCode, sizeof(kRecorderCode));
+      return recorderCode;
+    }
+
+    const void* GetRecorder(void)
+    {
+      static const void* const recorder = []() -> const void*
+      {
+        bufferSlotOffset = HookStore::AllocateThreadEnvironmentBlockSlot();
+        if (0 == bufferSlotOffset)
+        {
+          Infra::Message::Output(
+              Infra::Message::ESeverity::Warning,
+              L"Call tracing is unavailable because no thread-local storage slot could be allocated in the thread environment block.");
+          return nullptr;
+        }
+
+        SHeader* const header = CreateSection();
+        if (nullptr == header) return nullptr;
+
+        const void* const recorderCode = CreateRecorderCode();
+        if (nullptr == recorderCode)
+        {
+          Infra::Message::Output(
+              Infra::Message::ESeverity::Warning,
+              L"Call tracing is unavailable because the call recording code could not be placed.");
+          return nullptr;
+        }
+
+        sectionHeader.store(header, std::memory_order_release);
+
+        Infra::Message::OutputFormatted(
+            Infra::Message::ESeverity::Info,
+            L"Recording traced calls from up to %u threads with %u records each.",
+            kMaxThreadBuffers,
+            kRecordsPerThreadBuffer);
+        return recorderCode;
+      }();
+
+      if (nullptr != recorder) AttachCurrentThread();
+      return recorder;
+    }
+
+    void AttachCurrentThread(void)
+    {
+      SHeader* const header = sectionHeader.load(std::memory_order_acquire);
+      if (nullptr == header) return;
+      if (nullptr != ReadBufferSlot()) return;
+
+      const uint32_t threadId = static_cast<uint32_t>(Protected::Windows_GetCurrentThreadId());
+      SThreadBuffer* const threadBuffers = ThreadBuffersForHeader(header);
+
+      for (uint32_t i = 0; i < kMaxThreadBuffers; ++i)
+      {
+        uint32_t unowned = 0;
+        if (true == threadBuffers[i].header.threadId.compare_exchange_strong(unowned, threadId))
+        {
+          WriteBufferSlot(&threadBuffers[i]);
+          return;
+        }
+      }
+
+      header->numThreadsWithoutBuffers.fetch_add(1, std::memory_order_relaxed);
+    }
+
+    void DetachCurrentThread(void)
+    {
+      if (nullptr == sectionHeader.load(std::memory_order_acquire)) return;
+
+      SThreadBuffer* const buffer = ReadBufferSlot();
+      if (nullptr == buffer) return;
+
+      WriteBufferSlot(nullptr);
+      buffer->header.threadId.store(0, std::memory_order_release);
+    }
+  } // namespace CallTracing
+} // namespace Hookshot
@@ -0,0 +1,1115 @@
+/***************************************************************************************************
+ * Hookshot
+ *   General-purpose library for injecting DLLs and hooking function calls.
+ ***************************************************************************************************
+ * Authored by Samuel Grossman
+ * Copyright (c) 2019-2025
+ ***********************************************************************************************//**
+ * @file CallbackHooks.cpp
+ *   Implementation of the shared dispatch code that invokes the callbacks of callback hooks.
+ **************************************************************************************************/
+
+#include "CallbackHooks.h"
+
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+
+#include <Infra/Core/Message.h>
+#include <Infra/Core/ProcessInfo.h>
+
+#include "ApiWindows.h"
+#include "DependencyProtect.h"
+#include "HookshotTypes.h"
+#include "Trampoline.h"
+
+namespace Hookshot
+{
+  namespace CallbackHooks
+  {
+    /// Shared dispatch code, to which every callback hook stub jumps after loading its own address.
+    /// Saves the argument registers, fills in a call object on the stack using the descriptor
+    /// whose address is held in the stub, and invokes the pre callback if there is one. Then, if
+    /// there is no post callback, restores everything and jumps to the address held in the stub,
+    /// leaving nothing of itself on the stack. Otherwise, copies a fixed number of stack arguments,
+    /// calls the address held in the stub, invokes the post callback with the return value, and
+    /// returns to the original caller. In 64-bit mode, the stub's address arrives in r11, the stack
+    /// frame is described by unwind information registered when the code is placed, and the
+    /// floating-point argument registers are saved along with the integer ones. In 32-bit mode,
+    /// the stub's address arrives on the top of the stack, ebp is used as a frame pointer, and eax,
+    /// ecx, and edx are all saved because some calling conventions pass parameters in them. The
+    /// number of bytes of arguments popped by the original function is measured, so the original
+    /// caller's stack is left exactly as the original function would have left it.
+    static constexpr uint8_t kDispatcherCode[] = {
+#ifdef _WIN64
+        // push rbx
+        0x53,
+
+        // push rsi
+        0x56,
+
+        // sub rsp, 232
+        0x48,
+        0x81,
+        0xec,
+        0xe8,
+        0x00,
+        0x00,
+        0x00,
+
+        // mov rbx, r11
+        0x4c,
+        0x89,
+        0xdb,
+
+        // mov rsi, QWORD PTR [r11+32]
+        0x49,
+        0x8b,
+        0x73,
+        0x20,
+
+        // mov QWORD PTR [rsp+120], rcx
+        0x48,
+        0x89,
+        0x4c,
+        0x24,
+        0x78,
+
+        // mov QWORD PTR [rsp+128], rdx
+        0x48,
+        0x89,
+        0x94,
+        0x24,
+        0x80,
+        0x00,
+        0x00,
+        0x00,
+
+        // mov QWORD PTR [rsp+136], r8
+        0x4c,
+        0x89,
+        0x84,
+        0x24,
+        0x88,
+        0x00,
+        0x00,
+        0x00,
+
+        // mov QWORD PTR [rsp+144], r9
+        0x4c,
+        0x89,
+        0x8c,
+        0x24,
+        0x90,
+        0x00,
+        0x00,
+        0x00,
+
+        // movaps XMMWORD PTR [rsp+160], xmm0
+        0x0f,
+        0x29,
+        0x84,
+        0x24,
+        0xa0,
+        0x00,
+        0x00,
+        0x00,
+
+        // movaps XMMWORD PTR [rsp+176], xmm1
+        0x0f,
+        0x29,
+        0x8c,
+        0x24,
+        0xb0,
+        0x00,
+        0x00,
+        0x00,
+
+        // movaps XMMWORD PTR [rsp+192], xmm2
+        0x0f,
+        0x29,
+        0x94,
+        0x24,
+        0xc0,
+        0x00,
+        0x00,
+        0x00,
+
+        // movaps XMMWORD PTR [rsp+208], xmm3
+        0x0f,
+        0x29,
+        0x9c,
+        0x24,
+        0xd0,
+        0x00,
+        0x00,
+        0x00,
+
+        // mov rax, QWORD PTR [rsi+16]
+        0x48,
+        0x8b,
+        0x46,
+        0x10,
+
+        // mov QWORD PTR [rsp+96], rax
+        0x48,
+        0x89,
+        0x44,
+        0x24,
+        0x60,
+
+        // mov rax, QWORD PTR [rsi+24]
+        0x48,
+        0x8b,
+        0x46,
+        0x18,
+
+        // mov QWORD PTR [rsp+104], rax
+        0x48,
+        0x89,
+        0x44,
+        0x24,
+        0x68,
+
+        // mov rax, QWORD PTR [rsp+248]
+        0x48,
+        0x8b,
+        0x84,
+        0x24,
+        0xf8,
+        0x00,
+        0x00,
+        0x00,
+
+        // mov QWORD PTR [rsp+112], rax
+        0x48,
+        0x89,
+        0x44,
+        0x24,
+        0x70,
+
+        // mov QWORD PTR [rsp+152], 0
+        0x48,
+        0xc7,
+        0x84,
+        0x24,
+        0x98,
+        0x00,
+        0x00,
+        0x00,
+        0x00,
+        0x00,
+        0x00,
+        0x00,
+
+        // mov rax, QWORD PTR [rsi]
+        0x48,
+        0x8b,
+        0x06,
+
+        // test rax, rax
+        0x48,
+        0x85,
+        0xc0,
+
+        // jz $+9
+        0x74,
+        0x07,
+
+        // lea rcx, [rsp+96]
+        0x48,
+        0x8d,
+        0x4c,
+        0x24,
+        0x60,
+
+        // call rax
+        0xff,
+        0xd0,
+
+        // mov rcx, QWORD PTR [rsp+120]
+        0x48,
+        0x8b,
+        0x4c,
+        0x24,
+        0x78,
+
+        // mov rdx, QWORD PTR [rsp+128]
+        0x48,
+        0x8b,
+        0x94,
+        0x24,
+        0x80,
+        0x00,
+        0x00,
+        0x00,
+
+        // mov r8, QWORD PTR [rsp+136]
+        0x4c,
+        0x8b,
+        0x84,
+        0x24,
+        0x88,
+        0x00,
+        0x00,
+        0x00,
+
+        // mov r9, QWORD PTR [rsp+144]
+        0x4c,
+        0x8b,
+        0x8c,
+        0x24,
+        0x90,
+        0x00,
+        0x00,
+        0x00,
+
+        // movaps xmm0, XMMWORD PTR [rsp+160]
+        0x0f,
+        0x28,
+        0x84,
+        0x24,
+        0xa0,
+        0x00,
+        0x00,
+        0x00,
+
+        // movaps xmm1, XMMWORD PTR [rsp+176]
+        0x0f,
+        0x28,
+        0x8c,
+        0x24,
+        0xb0,
+        0x00,
+        0x00,
+        0x00,
+
+        // movaps xmm2, XMMWORD PTR [rsp+192]
+        0x0f,
+        0x28,
+        0x94,
+        0x24,
+        0xc0,
+        0x00,
+        0x00,
+        0x00,
+
+        // movaps xmm3, XMMWORD PTR [rsp+208]
+        0x0f,
+        0x28,
+        0x9c,
+        0x24,
+        0xd0,
+        0x00,
+        0x00,
+        0x00,
+
+        // cmp QWORD PTR [rsi+8], 0
+        0x48,
+        0x83,
+        0x7e,
+        0x08,
+        0x00,
+
+        // jne $+18
+        0x75,
+        0x10,
+
+        // mov r11, QWORD PTR [rbx+24]
+        0x4c,
+        0x8b,
+        0x5b,
+        0x18,
+
+        // add rsp, 232
+        0x48,
+        0x81,
+        0xc4,
+        0xe8,
+        0x00,
+        0x00,
+        0x00,
+
+        // pop rsi
+        0x5e,
+
+        // pop rbx
+        0x5b,
+
+        // jmp r11
+        0x41,
+        0xff,
+        0xe3,
+
+        // mov rax, QWORD PTR [rsp+288]
+        0x48,
+        0x8b,
+        0x84,
+        0x24,
+        0x20,
+        0x01,
+        0x00,
+        0x00,
+
+        // mov QWORD PTR [rsp+32], rax
+        0x48,
+        0x89,
+        0x44,
+        0x24,
+        0x20,
+
+        // mov rax, QWORD PTR [rsp+296]
+        0x48,
+        0x8b,
+        0x84,
+        0x24,
+        0x28,
+        0x01,
+        0x00,
+        0x00,
+
+        // mov QWORD PTR [rsp+40], rax
+        0x48,
+        0x89,
+        0x44,
+        0x24,
+        0x28,
+
+        // mov rax, QWORD PTR [rsp+304]
+        0x48,
+        0x8b,
+        0x84,
+        0x24,
+        0x30,
+        0x01,
+        0x00,
+        0x00,
+
+        // mov QWORD PTR [rsp+48], rax
+        0x48,
+        0x89,
+        0x44,
+        0x24,
+        0x30,
+
+        // mov rax, QWORD PTR [rsp+312]
+        0x48,
+        0x8b,
+        0x84,
+        0x24,
+        0x38,
+        0x01,
+        0x00,
+        0x00,
+
+        // mov QWORD PTR [rsp+56], rax
+        0x48,
+        0x89,
+        0x44,
+        0x24,
+        0x38,
+
+        // mov rax, QWORD PTR [rsp+320]
+        0x48,
+        0x8b,
+        0x84,
+        0x24,
+        0x40,
+        0x01,
+        0x00,
+        0x00,
+
+        // mov QWORD PTR [rsp+64], rax
+        0x48,
+        0x89,
+        0x44,
+        0x24,
+        0x40,
+
+        // mov rax, QWORD PTR [rsp+328]
+        0x48,
+        0x8b,
+        0x84,
+        0x24,
+        0x48,
+        0x01,
+        0x00,
+        0x00,
+
+        // mov QWORD PTR [rsp+72], rax
+        0x48,
+        0x89,
+        0x44,
+        0x24,
+        0x48,
+
+        // mov rax, QWORD PTR [rsp+336]
+        0x48,
+        0x8b,
+        0x84,
+        0x24,
+        0x50,
+        0x01,
+        0x00,
+        0x00,
+
+        // mov QWORD PTR [rsp+80], rax
+        0x48,
+        0x89,
+        0x44,
+        0x24,
+        0x50,
+
+        // mov rax, QWORD PTR [rsp+344]
+        0x48,
+        0x8b,
+        0x84,
+        0x24,
+        0x58,
+        0x01,
+        0x00,
+        0x00,
+
+        // mov QWORD PTR [rsp+88], rax
+        0x48,
+        0x89,
+        0x44,
+        0x24,
+        0x58,
+
+        // call QWORD PTR [rbx+24]
+        0xff,
+        0x53,
+        0x18,
+
+        // mov QWORD PTR [rsp+224], rax
+        0x48,
+        0x89,
+        0x84,
+        0x24,
+        0xe0,
+        0x00,
+        0x00,
+        0x00,
+
+        // movaps XMMWORD PTR [rsp+160], xmm0
+        0x0f,
+        0x29,
+        0x84,
+        0x24,
+        0xa0,
+        0x00,
+        0x00,
+        0x00,
+
+        // lea rcx, [rsp+96]
+        0x48,
+        0x8d,
+        0x4c,
+        0x24,
+        0x60,
+
+        // mov rdx, rax
+        0x48,
+        0x89,
+        0xc2,
+
+        // call QWORD PTR [rsi+8]
+        0xff,
+        0x56,
+        0x08,
+
+        // mov rax, QWORD PTR [rsp+224]
+        0x48,
+        0x8b,
+        0x84,
+        0x24,
+        0xe0,
+        0x00,
+        0x00,
+        0x00,
+
+        // movaps xmm0, XMMWORD PTR [rsp+160]
+        0x0f,
+        0x28,
+        0x84,
+        0x24,
+        0xa0,
+        0x00,
+        0x00,
+        0x00,
+
+        // add rsp, 232
+        0x48,
+        0x81,
+        0xc4,
+        0xe8,
+        0x00,
+        0x00,
+        0x00,
+
+        // pop rsi
+        0x5e,
+
+        // pop rbx
+        0x5b,
+
+        // ret
+        0xc3,
+#else
+        // push ebp
+        0x55,
+
+        // mov ebp, esp
+        0x89,
+        0xe5,
+
+        // push ebx
+        0x53,
+
+        // push esi
+        0x56,
+
+        // push edi
+        0x57,
+
+        // push eax
+        0x50,
+
+        // push ecx
+        0x51,
+
+        // push edx
+        0x52,
+
+        // sub esp, 32
+        0x83,
+        0xec,
+        0x20,
+
+        // mov ebx, DWORD PTR [ebp+4]
+        0x8b,
+        0x5d,
+        0x04,
+
+        // mov esi, DWORD PTR [ebx+32]
+        0x8b,
+        0x73,
+        0x20,
+
+        // mov eax, DWORD PTR [esi+8]
+        0x8b,
+        0x46,
+        0x08,
+
+        // mov DWORD PTR [esp], eax
+        0x89,
+        0x04,
+        0x24,
+
+        // mov eax, DWORD PTR [esi+12]
+        0x8b,
+        0x46,
+        0x0c,
+
+        // mov DWORD PTR [esp+4], eax
+        0x89,
+        0x44,
+        0x24,
+        0x04,
+
+        // mov eax, DWORD PTR [ebp+8]
+        0x8b,
+        0x45,
+        0x08,
+
+        // mov DWORD PTR [esp+8], eax
+        0x89,
+        0x44,
+        0x24,
+        0x08,
+
+        // mov eax, DWORD PTR [ebp+12]
+        0x8b,
+        0x45,
+        0x0c,
+
+        // mov DWORD PTR [esp+12], eax
+        0x89,
+        0x44,
+        0x24,
+        0x0c,
+
+        // mov eax, DWORD PTR [ebp+16]
+        0x8b,
+        0x45,
+        0x10,
+
+        // mov DWORD PTR [esp+16], eax
+        0x89,
+        0x44,
+        0x24,
+        0x10,
+
+        // mov eax, DWORD PTR [ebp+20]
+        0x8b,
+        0x45,
+        0x14,
+
+        // mov DWORD PTR [esp+20], eax
+        0x89,
+        0x44,
+        0x24,
+        0x14,
+
+        // mov eax, DWORD PTR [ebp+24]
+        0x8b,
+        0x45,
+        0x18,
+
+        // mov DWORD PTR [esp+24], eax
+        0x89,
+        0x44,
+        0x24,
+        0x18,
+
+        // mov DWORD PTR [esp+28], 0
+        0xc7,
+        0x44,
+        0x24,
+        0x1c,
+        0x00,
+        0x00,
+        0x00,
+        0x00,
+
+        // mov eax, DWORD PTR [esi]
+        0x8b,
+        0x06,
+
+        // test eax, eax
+        0x85,
+        0xc0,
+
+        // jz $+6
+        0x74,
+        0x04,
+
+        // mov ecx, esp
+        0x89,
+        0xe1,
+
+        // call eax
+        0xff,
+        0xd0,
+
+        // cmp DWORD PTR [esi+4], 0
+        0x83,
+        0x7e,
+        0x04,
+        0x00,
+
+        // jne $+19
+        0x75,
+        0x11,
+
+        // mov eax, DWORD PTR [ebx+24]
+        0x8b,
+        0x43,
+        0x18,
+
+        // mov DWORD PTR [ebp+4], eax
+        0x89,
+        0x45,
+        0x04,
+
+        // lea esp, [ebp-24]
+        0x8d,
+        0x65,
+        0xe8,
+
+        // pop edx
+        0x5a,
+
+        // pop ecx
+        0x59,
+
+        // pop eax
+        0x58,
+
+        // pop edi
+        0x5f,
+
+        // pop esi
+        0x5e,
+
+        // pop ebx
+        0x5b,
+
+        // pop ebp
+        0x5d,
+
+        // ret
+        0xc3,
+
+        // sub esp, 48
+        0x83,
+        0xec,
+        0x30,
+
+        // mov eax, DWORD PTR [ebp+12]
+        0x8b,
+        0x45,
+        0x0c,
+
+        // mov DWORD PTR [esp], eax
+        0x89,
+        0x04,
+        0x24,
+
+        // mov eax, DWORD PTR [ebp+16]
+        0x8b,
+        0x45,
+        0x10,
+
+        // mov DWORD PTR [esp+4], eax
+        0x89,
+        0x44,
+        0x24,
+        0x04,
+
+        // mov eax, DWORD PTR [ebp+20]
+        0x8b,
+        0x45,
+        0x14,
+
+        // mov DWORD PTR [esp+8], eax
+        0x89,
+        0x44,
+        0x24,
+        0x08,
+
+        // mov eax, DWORD PTR [ebp+24]
+        0x8b,
+        0x45,
+        0x18,
+
+        // mov DWORD PTR [esp+12], eax
+        0x89,
+        0x44,
+        0x24,
+        0x0c,
+
+        // mov eax, DWORD PTR [ebp+28]
+        0x8b,
+        0x45,
+        0x1c,
+
+        // mov DWORD PTR [esp+16], eax
+        0x89,
+        0x44,
+        0x24,
+        0x10,
+
+        // mov eax, DWORD PTR [ebp+32]
+        0x8b,
+        0x45,
+        0x20,
+
+        // mov DWORD PTR [esp+20], eax
+        0x89,
+        0x44,
+        0x24,
+        0x14,
+
+        // mov eax, DWORD PTR [ebp+36]
+        0x8b,
+        0x45,
+        0x24,
+
+        // mov DWORD PTR [esp+24], eax
+        0x89,
+        0x44,
+        0x24,
+        0x18,
+
+        // mov eax, DWORD PTR [ebp+40]
+        0x8b,
+        0x45,
+        0x28,
+
+        // mov DWORD PTR [esp+28], eax
+        0x89,
+        0x44,
+        0x24,
+        0x1c,
+
+        // mov eax, DWORD PTR [ebp+44]
+        0x8b,
+        0x45,
+        0x2c,
+
+        // mov DWORD PTR [esp+32], eax
+        0x89,
+        0x44,
+        0x24,
+        0x20,
+
+        // mov eax, DWORD PTR [ebp+48]
+        0x8b,
+        0x45,
+        0x30,
+
+        // mov DWORD PTR [esp+36], eax
+        0x89,
+        0x44,
+        0x24,
+        0x24,
+
+        // mov eax, DWORD PTR [ebp+52]
+        0x8b,
+        0x45,
+        0x34,
+
+        // mov DWORD PTR [esp+40], eax
+        0x89,
+        0x44,
+        0x24,
+        0x28,
+
+        // mov eax, DWORD PTR [ebp+56]
+        0x8b,
+        0x45,
+        0x38,
+
+        // mov DWORD PTR [esp+44], eax
+        0x89,
+        0x44,
+        0x24,
+        0x2c,
+
+        // mov edi, esp
+        0x89,
+        0xe7,
+
+        // mov eax, DWORD PTR [ebp-16]
+        0x8b,
+        0x45,
+        0xf0,
+
+        // mov ecx, DWORD PTR [ebp-20]
+        0x8b,
+        0x4d,
+        0xec,
+
+        // mov edx, DWORD PTR [ebp-24]
+        0x8b,
+        0x55,
+        0xe8,
+
+        // call DWORD PTR [ebx+24]
+        0xff,
+        0x53,
+        0x18,
+
+        // sub edi, esp
+        0x29,
+        0xe7,
+
+        // neg edi
+        0xf7,
+        0xdf,
+
+        // push edx
+        0x52,
+
+        // push eax
+        0x50,
+
+        // lea ecx, [ebp-56]
+        0x8d,
+        0x4d,
+        0xc8,
+
+        // mov edx, eax
+        0x89,
+        0xc2,
+
+        // call DWORD PTR [esi+4]
+        0xff,
+        0x56,
+        0x04,
+
+        // pop eax
+        0x58,
+
+        // pop edx
+        0x5a,
+
+        // mov ecx, DWORD PTR [ebp+8]
+        0x8b,
+        0x4d,
+        0x08,
+
+        // mov DWORD PTR [ebp+edi+8], ecx
+        0x89,
+        0x4c,
+        0x3d,
+        0x08,
+
+        // lea ecx, [ebp+edi+8]
+        0x8d,
+        0x4c,
+        0x3d,
+        0x08,
+
+        // mov ebx, DWORD PTR [ebp-4]
+        0x8b,
+        0x5d,
+        0xfc,
+
+        // mov esi, DWORD PTR [ebp-8]
+        0x8b,
+        0x75,
+        0xf8,
+
+        // mov edi, DWORD PTR [ebp-12]
+        0x8b,
+        0x7d,
+        0xf4,
+
+        // mov ebp, DWORD PTR [ebp]
+        0x8b,
+        0x6d,
+        0x00,
+
+        // mov esp, ecx
+        0x89,
+        0xcc,
+
+        // ret
+        0xc3,
+#endif
+    };
+
+    // The dispatch code addresses descriptor fields and call object fields using fixed
+    // displacements, all of which assume these layouts. Its stack frame holds exactly one call
+    // object.
+    static_assert(
+        (0 == offsetof(SDescriptor, preCallback)) &&
+            ((1 * sizeof(size_t)) == offsetof(SDescriptor, postCallback)) &&
+            ((2 * sizeof(size_t)) == offsetof(SDescriptor, context)) &&
+            ((3 * sizeof(size_t)) == offsetof(SDescriptor, originalFunc)),
+        "Callback dispatch code assumes a different descriptor layout.");
+    static_assert(
+        (0 == offsetof(SCallbackHookCall, context)) &&
+            ((1 * sizeof(size_t)) == offsetof(SCallbackHookCall, originalFunc)) &&
+            ((2 * sizeof(size_t)) == offsetof(SCallbackHookCall, returnAddress)) &&
+            ((3 * sizeof(size_t)) == offsetof(SCallbackHookCall, arguments)) &&
+            ((7 * sizeof(size_t)) == offsetof(SCallbackHookCall, userData)) &&
+            ((8 * sizeof(size_t)) == sizeof(SCallbackHookCall)),
+        "Callback dispatch code assumes a different call object layout.");
+
+#ifdef _WIN64
+    /// Unwind information for the dispatch code. Its prologue pushes rbx and rsi and then allocates
+    /// 232 bytes of stack space, which needs two unwind code slots because it exceeds 128 bytes.
+    static constexpr Trampoline::SUnwindInfo kDispatcherUnwindInfo = {
+        .versionAndFlags = 1,
+        .sizeOfPrologBytes = 9,
+        .countOfCodes = 4,
+        .frameRegisterAndOffset = 0,
+        .unwindCode = {
+            // UWOP_ALLOC_LARGE at prologue offset 9, followed by the size divided by 8
+            0x0109,
+            232 / 8,
+
+            // UWOP_PUSH_NONVOL rsi at prologue offset 2
+            0x6002,
+
+            // UWOP_PUSH_NONVOL rbx at prologue offset 1
+            0x3001,
+        }};
+#endif
+
+    /// Executable memory that holds the dispatch code. In 64-bit mode, also holds the unwind
+    /// information that describes its stack frame, so that exceptions and stack walks can pass
+    /// through it.
+    struct SDispatcherRegion
+    {
+      /// Dispatch code.
+      uint8_t code[sizeof(kDispatcherCode)];
+
+#ifdef _WIN64
+      /// Unwind information for the dispatch code.
+      alignas(4) Trampoline::SUnwindInfo unwindInfo;
+
+      /// Function table entry registered with the operating system.
+      RUNTIME_FUNCTION functionEntry;
+#endif
+    };
+
+    /// Places the dispatch code into executable memory and, in 64-bit mode, registers its unwind
+    /// information.
+    /// @return Address of the dispatch code, or `nullptr` if it could not be placed.
+    static const void* CreateDispatcherCode(void)
+    {
+      SDispatcherRegion* const region =
+          reinterpret_cast<SDispatcherRegion*>(Protected::Windows_VirtualAlloc(
+              nullptr, sizeof(SDispatcherRegion), MEM_RESERVE | MEM_COMMIT, PAGE_READWRITE));
+      if (nullptr == region) return nullptr;
+
+      std::memcpy(region->code, kDispatcherCode, sizeof(kDispatcherCode));
+
+#ifdef _WIN64
+      region->unwindInfo = kDispatcherUnwindInfo;
+      region->functionEntry = {
+          .BeginAddress = static_cast<DWORD>(offsetof(SDispatcherRegion, code)),
+          .EndAddress =
+              static_cast<DWORD>(offsetof(SDispatcherRegion, code) + sizeof(kDispatcherCode)),
+          .UnwindData = static_cast<DWORD>(offsetof(SDispatcherRegion, unwindInfo))};
+#endif
+
+      DWORD unusedOldProtection = 0;
+      if (0 ==
+          Protected::Windows_VirtualProtect(
+              region, sizeof(SDispatcherRegion), PAGE_EXECUTE_READ, &unusedOldProtection))
+      {
+        Protected::Windows_VirtualFree(region, 0, MEM_RELEASE);
+        return nullptr;
+      }
+
+#ifdef _WIN64
+      if (FALSE ==
+          Protected::Windows_RtlAddFunctionTable(
+              &region->functionEntry, 1, reinterpret_cast<DWORD64>(region)))
+      {
+        Protected::Windows_VirtualFree(region, 0, MEM_RELEASE);
+        return nullptr;
+      }
+#endif
+
+      Protected::Windows_FlushInstructionCache(
+          Infra::ProcessInfo::GetCurrentProcessHandle(), region->code, sizeof(region->code));
+      return region->code;
+    }
+
+    const void* GetDispatcher(void)
+    {
+      static const void* const dispatcher = []() -> const void*
+      {
+        const void* const dispatcherCode = CreateDispatcherCode();
+        if (nullptr == dispatcherCode)
+        {
+          Infra::Message::Output(
+              Infra::Message::ESeverity::Warning,
+              L"Callback hooks are unavailable because their dispatch code could not be placed.");
+          return nullptr;
+        }
+
+        return dispatcherCode;
+      }();
+
+      return dispatcher;
+    }
+  } // namespace CallbackHooks
+} // namespace Hookshot
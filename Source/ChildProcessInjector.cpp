@@ -9,27 +9,271 @@
  *   Implementation of internal hooks for injecting child processes.
  **************************************************************************************************/
 
+#include <cwctype>
+#include <string>
+#include <string_view>
+#include <unordered_set>
+#include <vector>
+
+#include <Infra/Core/Configuration.h>
 #include <Infra/Core/Message.h>
+#include <Infra/Core/ProcessInfo.h>
 #include <Infra/Core/Strings.h>
 #include <Infra/Core/TemporaryBuffer.h>
 
 #include "ApiWindows.h"
 #include "DependencyProtect.h"
+#include "Globals.h"
 #include "InjectResult.h"
 #include "InternalHook.h"
 #include "RemoteProcessInjector.h"
+#include "Strings.h"
+#include "TaskScheduler.h"
+#include "Tracing.h"
+
+/// Internal process creation function exported by `KernelBase.dll`, in which all of the process
+/// creation functions that create a process from within the calling process converge. These
+/// include the ANSI and Unicode forms of `CreateProcess` and `CreateProcessAsUser`. Not declared
+/// in any Windows header. Parameters are the same as `CreateProcessAsUserW` with an additional
+/// output parameter at the end that receives a restricted token, if one is created.
+extern "C" BOOL WINAPI CreateProcessInternalW(
+    HANDLE hUserToken,
+    LPCWSTR lpApplicationName,
+    LPWSTR lpCommandLine,
+    LPSECURITY_ATTRIBUTES lpProcessAttributes,
+    LPSECURITY_ATTRIBUTES lpThreadAttributes,
+    BOOL bInheritHandles,
+    DWORD dwCreationFlags,
+    LPVOID lpEnvironment,
+    LPCWSTR lpCurrentDirectory,
+    LPSTARTUPINFOW lpStartupInfo,
+    LPPROCESS_INFORMATION lpProcessInformation,
+    PHANDLE hNewToken);
 
 namespace Hookshot
 {
-  HOOKSHOT_INTERNAL_HOOK(CreateProcessA);
-  HOOKSHOT_INTERNAL_HOOK(CreateProcessW);
+  HOOKSHOT_INTERNAL_HOOK(CreateProcessInternalW);
 
-  /// Injects a newly-created child process with HookshotDll. Outputs a message indicating the
-  /// result of the attempted injection.
-  /// @param [in] processHandle Handle to the process to inject.
-  /// @param [in] threadHandle Handle to the main thread of the process to inject.
-  static void InjectChildProcess(const HANDLE processHandle, const HANDLE threadHandle)
+  /// Set while the current thread is injecting a child process. Injection can itself create a
+  /// process, namely a Hookshot executable of the other architecture, and any process created
+  /// while this flag is set is left alone.
+  static thread_local bool isInjectingChildProcess = false;
+
+  /// Determines whether or not child processes should be told where this process placed the
+  /// trampolines for its internal hooks, as configured.
+  /// @return `true` if so, `false` otherwise.
+  static bool ShouldShareInternalHookLayoutWithChildProcesses(void)
+  {
+    static const bool shareInternalHookLayoutWithChildProcesses =
+        Globals::GetConfigurationData()
+            [Infra::Configuration::kSectionNameGlobal]
+            [Strings::kStrConfigurationSettingNameShareInternalHookLayoutWithChildProcesses]
+                .ValueOr(false);
+
+    return shareInternalHookLayoutWithChildProcesses;
+  }
+
+  /// Set of executable patterns read from the configuration, compiled so that checking a child
+  /// process against them is cheap no matter how many there are. Patterns without wildcards are
+  /// looked up in hash sets, so only patterns with wildcards are matched one at a time. Everything
+  /// is held in lowercase.
+  struct SExecutablePatterns
+  {
+    /// Patterns without wildcards that are matched against the executable file name.
+    std::unordered_set<std::wstring> exactFileNames;
+
+    /// Patterns without wildcards that are matched against the full executable path.
+    std::unordered_set<std::wstring> exactPaths;
+
+    /// Patterns with wildcards that are matched against the executable file name.
+    std::vector<std::wstring> wildcardFileNames;
+
+    /// Patterns with wildcards that are matched against the full executable path.
+    std::vector<std::wstring> wildcardPaths;
+
+    /// Determines whether or not there are any patterns at all.
+    /// @return `true` if there are none, `false` otherwise.
+    inline bool IsEmpty(void) const
+    {
+      return (exactFileNames.empty() && exactPaths.empty() && wildcardFileNames.empty() &&
+              wildcardPaths.empty());
+    }
+  };
+
+  /// Converts a string to lowercase, one character at a time.
+  /// @param [in] str String to convert.
+  /// @return Lowercase version of the string.
+  static std::wstring ToLowercase(std::wstring_view str)
+  {
+    std::wstring lowercaseStr(str);
+    for (wchar_t& c : lowercaseStr)
+      c = static_cast<wchar_t>(std::towlower(c));
+
+    return lowercaseStr;
+  }
+
+  /// Determines whether or not a string matches a pattern that can contain the wildcards `*`, which
+  /// matches any sequence of characters, and `?`, which matches any single character. Only the most
+  /// recent `*` is ever backtracked to, so matching takes time proportional to the product of the
+  /// lengths in the worst case and to their sum in the usual case.
+  /// @param [in] pattern Pattern to match.
+  /// @param [in] str String to match against the pattern.
+  /// @return `true` if the string matches, `false` otherwise.
+  static bool MatchesWildcardPattern(std::wstring_view pattern, std::wstring_view str)
+  {
+    size_t patternPos = 0;
+    size_t strPos = 0;
+    size_t starPatternPos = std::wstring_view::npos;
+    size_t starStrPos = 0;
+
+    while (strPos < str.length())
+    {
+      if ((patternPos < pattern.length()) &&
+          ((L'?' == pattern[patternPos]) || (str[strPos] == pattern[patternPos])))
+      {
+        patternPos += 1;
+        strPos += 1;
+      }
+      else if ((patternPos < pattern.length()) && (L'*' == pattern[patternPos]))
+      {
+        starPatternPos = patternPos;
+        starStrPos = strPos;
+        patternPos += 1;
+      }
+      else if (std::wstring_view::npos != starPatternPos)
+      {
+        patternPos = starPatternPos + 1;
+        starStrPos += 1;
+        strPos = starStrPos;
+      }
+      else
+      {
+        return false;
+      }
+    }
+
+    while ((patternPos < pattern.length()) && (L'*' == pattern[patternPos]))
+      patternPos += 1;
+
+    return (pattern.length() == patternPos);
+  }
+
+  /// Determines whether or not an executable matches any of a set of patterns.
+  /// @param [in] patterns Compiled patterns.
+  /// @param [in] path Full executable path, in lowercase.
+  /// @param [in] fileName Executable file name, in lowercase.
+  /// @return `true` if any pattern matches, `false` otherwise.
+  static bool MatchesAnyExecutablePattern(
+      const SExecutablePatterns& patterns, const std::wstring& path, const std::wstring& fileName)
+  {
+    if ((0 != patterns.exactFileNames.count(fileName)) || (0 != patterns.exactPaths.count(path)))
+      return true;
+
+    for (const std::wstring& pattern : patterns.wildcardFileNames)
+    {
+      if (true == MatchesWildcardPattern(pattern, fileName)) return true;
+    }
+
+    for (const std::wstring& pattern : patterns.wildcardPaths)
+    {
+      if (true == MatchesWildcardPattern(pattern, path)) return true;
+    }
+
+    return false;
+  }
+
+  /// Reads and compiles the executable patterns for the specified setting from both the global
+  /// section and the section for the currently-running executable.
+  /// @param [in] settingName Name of the setting that holds the patterns.
+  /// @return Compiled patterns.
+  static SExecutablePatterns ReadExecutablePatterns(std::wstring_view settingName)
+  {
+    const auto& configData = Globals::GetConfigurationData();
+    const std::wstring_view sections[] = {
+        Infra::Configuration::kSectionNameGlobal, Infra::ProcessInfo::GetExecutableBaseName()};
+
+    SExecutablePatterns patterns;
+    for (const std::wstring_view section : sections)
+    {
+      if (false == configData.Contains(section, settingName)) continue;
+
+      for (const auto& configuredPattern : configData[section][settingName].Values())
+      {
+        std::wstring pattern = ToLowercase(std::wstring_view(configuredPattern));
+        if (true == pattern.empty()) continue;
+
+        const bool isPathPattern = (std::wstring::npos != pattern.find(L'\\'));
+        const bool isWildcardPattern = (std::wstring::npos != pattern.find_first_of(L"*?"));
+
+        if (true == isWildcardPattern)
+          (isPathPattern ? patterns.wildcardPaths : patterns.wildcardFileNames)
+              .push_back(std::move(pattern));
+        else
+          (isPathPattern ? patterns.exactPaths : patterns.exactFileNames)
+              .insert(std::move(pattern));
+      }
+    }
+
+    return patterns;
+  }
+
+  /// Determines whether or not a newly-created child process should be injected, according to the
+  /// configured allow and deny patterns. Checked before any injection work begins, so child
+  /// processes that are not injected cost only one query of their executable path, and not even
+  /// that if no patterns are configured. Child processes whose executable paths cannot be
+  /// determined are injected.
+  /// @param [in] processHandle Handle to the child process.
+  /// @return `true` if the child process should be injected, `false` otherwise.
+  static bool ShouldInjectChildProcess(const HANDLE processHandle)
+  {
+    static const SExecutablePatterns allowPatterns =
+        ReadExecutablePatterns(Strings::kStrConfigurationSettingNameAllowChildProcess);
+    static const SExecutablePatterns denyPatterns =
+        ReadExecutablePatterns(Strings::kStrConfigurationSettingNameDenyChildProcess);
+
+    if ((true == allowPatterns.IsEmpty()) && (true == denyPatterns.IsEmpty())) return true;
+
+    Infra::TemporaryBuffer<wchar_t> childProcessExecutable;
+    DWORD childProcessExecutableLength = childProcessExecutable.Capacity();
+    if (0 ==
+        Protected::Windows_QueryFullProcessImageName(
+            processHandle, 0, childProcessExecutable.Data(), &childProcessExecutableLength))
+      return true;
+
+    const std::wstring path = ToLowercase(
+        std::wstring_view(childProcessExecutable.Data(), childProcessExecutableLength));
+    const size_t fileNamePosition = path.find_last_of(L'\\');
+    const std::wstring fileName =
+        ((std::wstring::npos == fileNamePosition) ? path : path.substr(fileNamePosition + 1));
+
+    const bool shouldInject =
+        ((false == MatchesAnyExecutablePattern(denyPatterns, path, fileName)) &&
+         ((true == allowPatterns.IsEmpty()) ||
+          (true == MatchesAnyExecutablePattern(allowPatterns, path, fileName))));
+
+    if (false == shouldInject)
+      Infra::Message::OutputFormatted(
+          Infra::Message::ESeverity::Debug,
+          L"%s - Not injecting child process, as configured.",
+          childProcessExecutable.Data());
+
+    return shouldInject;
+  }
+
+  /// Outputs a message indicating the result of an attempted child process injection. Nothing is
+  /// queried or formatted unless the message would actually be output, because this happens for
+  /// every child process.
+  /// @param [in] processHandle Handle to the process that was injected.
+  /// @param [in] result Result of the attempted injection.
+  /// @param [in] systemErrorCode System error code captured immediately after the attempt.
+  static void OutputInjectChildProcessResult(
+      const HANDLE processHandle, const EInjectResult result, const DWORD systemErrorCode)
   {
+    const Infra::Message::ESeverity severity =
+        ((EInjectResult::Success == result) ? Infra::Message::ESeverity::Info
+                                            : Infra::Message::ESeverity::Warning);
+    if (false == Infra::Message::WillOutputMessageOfSeverity(severity)) return;
+
     Infra::TemporaryBuffer<wchar_t> childProcessExecutable;
     DWORD childProcessExecutableLength = childProcessExecutable.Capacity();
 
@@ -38,71 +282,204 @@ namespace Hookshot
             processHandle, 0, childProcessExecutable.Data(), &childProcessExecutableLength))
       childProcessExecutableLength = 0;
 
-    const EInjectResult result = RemoteProcessInjector::InjectProcess(
-        processHandle, threadHandle, false, Protected::Windows_IsDebuggerPresent());
-
     if (EInjectResult::Success == result)
       Infra::Message::OutputFormatted(
-          Infra::Message::ESeverity::Info,
+          severity,
           L"Successfully injected child process %s.",
           (0 == childProcessExecutableLength ? L"(error determining executable file name)"
                                              : &childProcessExecutable[0]));
     else
       Infra::Message::OutputFormatted(
-          Infra::Message::ESeverity::Warning,
+          severity,
           L"%s - Failed to inject child process: %s: %s",
           (0 == childProcessExecutableLength ? L"(error determining executable file name)"
                                              : &childProcessExecutable[0]),
           InjectResultString(result).data(),
-          Infra::Strings::FromSystemErrorCode(Protected::Windows_GetLastError()).AsCString());
+          Infra::Strings::FromSystemErrorCode(systemErrorCode).AsCString());
   }
 
-  void* InternalHook_CreateProcessA::OriginalFunctionAddress(void)
+  /// Injects a newly-created child process with HookshotDll. Outputs a message indicating the
+  /// result of the attempted injection.
+  /// @param [in] processHandle Handle to the process to inject.
+  /// @param [in] threadHandle Handle to the main thread of the process to inject.
+  static void InjectChildProcess(const HANDLE processHandle, const HANDLE threadHandle)
   {
-    return GetWindowsApiFunctionAddress("CreateProcessA", &CreateProcessA);
+    isInjectingChildProcess = true;
+
+    // The child process sets its internal hooks while it is being injected, so the layout only
+    // needs to exist until injection is complete.
+    const HANDLE internalHookLayout =
+        ((true == ShouldShareInternalHookLayoutWithChildProcesses())
+             ? PublishInternalHookLayout(Protected::Windows_GetProcessId(processHandle))
+             : nullptr);
+
+    Tracing::SInjectPhaseDurations phaseDurations;
+    const EInjectResult result = RemoteProcessInjector::InjectProcess(
+        processHandle,
+        threadHandle,
+        false,
+        Protected::Windows_IsDebuggerPresent(),
+        &phaseDurations);
+    const DWORD systemErrorCode = Protected::Windows_GetLastError();
+
+    if (nullptr != internalHookLayout) Protected::Windows_CloseHandle(internalHookLayout);
+
+    OutputInjectChildProcessResult(processHandle, result, systemErrorCode);
+    Tracing::OutputInjectPhaseDurations(
+        Infra::Message::ESeverity::Info,
+        Protected::Windows_GetProcessId(processHandle),
+        phaseDurations);
+
+    isInjectingChildProcess = false;
   }
 
-  BOOL InternalHook_CreateProcessA::Hook(
-      LPCSTR lpApplicationName,
-      LPSTR lpCommandLine,
-      LPSECURITY_ATTRIBUTES lpProcessAttributes,
-      LPSECURITY_ATTRIBUTES lpThreadAttributes,
-      BOOL bInheritHandles,
-      DWORD dwCreationFlags,
-      LPVOID lpEnvironment,
-      LPCSTR lpCurrentDirectory,
-      LPSTARTUPINFOA lpStartupInfo,
-      LPPROCESS_INFORMATION lpProcessInformation)
+  /// Holds the information needed to inject a child process on a worker thread. Handles are owned
+  /// by this object and closed once injection is complete.
+  struct SAsyncChildProcessInjection
   {
-    const bool shouldCreateSuspended = (0 != (dwCreationFlags & CREATE_SUSPENDED)) ? true : false;
-    PROCESS_INFORMATION processInfo = *lpProcessInformation;
+    /// Handle to the process to inject.
+    HANDLE processHandle;
 
-    const BOOL createProcessResult = Original(
-        lpApplicationName,
-        lpCommandLine,
-        lpProcessAttributes,
-        lpThreadAttributes,
-        bInheritHandles,
-        (dwCreationFlags | CREATE_SUSPENDED),
-        lpEnvironment,
-        lpCurrentDirectory,
-        lpStartupInfo,
-        &processInfo);
-    *lpProcessInformation = processInfo;
+    /// Handle to the main thread of the process to inject.
+    HANDLE threadHandle;
+  };
+
+  /// Determines whether or not child processes should be injected asynchronously, as configured.
+  /// @return `true` if so, `false` otherwise.
+  static bool ShouldInjectChildProcessesAsynchronously(void)
+  {
+    static const bool injectChildProcessesAsynchronously =
+        Globals::GetPerformanceProfile().injectChildProcessesAsynchronously;
 
-    if (0 != createProcessResult) InjectChildProcess(processInfo.hProcess, processInfo.hThread);
+    return injectChildProcessesAsynchronously;
+  }
 
-    if (false == shouldCreateSuspended) Protected::Windows_ResumeThread(processInfo.hThread);
+  /// Determines whether or not this process belongs to a job object whose processes are all
+  /// injected by an instance of the Hookshot executable acting as a broker. If so, child processes
+  /// join the same job and are injected by the broker, so the process creation hooks leave them
+  /// alone. The job is identified by an environment variable that the broker sets.
+  /// @return `true` if so, `false` otherwise.
+  static bool AreChildProcessesInjectedByJobBroker(void)
+  {
+    static const bool childProcessesInjectedByJobBroker = []() -> bool
+    {
+      Infra::TemporaryString jobName;
+      const DWORD jobNameLength = Protected::Windows_GetEnvironmentVariable(
+          Strings::kStrInjectionJobEnvironmentVariableName.data(),
+          jobName.Data(),
+          jobName.Capacity());
+      if ((0 == jobNameLength) || (jobNameLength >= jobName.Capacity())) return false;
 
-    return createProcessResult;
+      const HANDLE jobHandle =
+          Protected::Windows_OpenJobObject(JOB_OBJECT_QUERY, FALSE, jobName.Data());
+      if (nullptr == jobHandle) return false;
+
+      BOOL isProcessInJob = FALSE;
+      const BOOL isProcessInJobResult = Protected::Windows_IsProcessInJob(
+          Infra::ProcessInfo::GetCurrentProcessHandle(), jobHandle, &isProcessInJob);
+      Protected::Windows_CloseHandle(jobHandle);
+
+      return ((FALSE != isProcessInJobResult) && (FALSE != isProcessInJob));
+    }();
+
+    return childProcessesInjectedByJobBroker;
+  }
+
+  /// Task that injects a child process and then allows it to run.
+  /// @param [in] context Pointer to the SAsyncChildProcessInjection object describing the child
+  /// process to inject, whose ownership is transferred to this function.
+  static void InjectChildProcessTask(void* context)
+  {
+    SAsyncChildProcessInjection* const asyncInjection =
+        reinterpret_cast<SAsyncChildProcessInjection*>(context);
+
+    InjectChildProcess(asyncInjection->processHandle, asyncInjection->threadHandle);
+    Protected::Windows_ResumeThread(asyncInjection->threadHandle);
+
+    Protected::Windows_CloseHandle(asyncInjection->processHandle);
+    Protected::Windows_CloseHandle(asyncInjection->threadHandle);
+    delete asyncInjection;
+  }
+
+  /// Attempts to queue a newly-created child process for injection on a worker thread, which
+  /// resumes it once injection is complete. The child process is left suspended until then.
+  /// @param [in] processHandle Handle to the process to inject.
+  /// @param [in] threadHandle Handle to the main thread of the process to inject.
+  /// @return `true` if the child process was queued, `false` if it needs to be injected
+  /// synchronously instead.
+  static bool QueueChildProcessInjection(const HANDLE processHandle, const HANDLE threadHandle)
+  {
+    // The caller is free to close its handles as soon as process creation returns, so the worker
+    // thread needs its own.
+    SAsyncChildProcessInjection* const asyncInjection =
+        new SAsyncChildProcessInjection{.processHandle = nullptr, .threadHandle = nullptr};
+
+    if ((FALSE ==
+         Protected::Windows_DuplicateHandle(
+             Infra::ProcessInfo::GetCurrentProcessHandle(),
+             processHandle,
+             Infra::ProcessInfo::GetCurrentProcessHandle(),
+             &asyncInjection->processHandle,
+             0,
+             FALSE,
+             DUPLICATE_SAME_ACCESS)) ||
+        (FALSE ==
+         Protected::Windows_DuplicateHandle(
+             Infra::ProcessInfo::GetCurrentProcessHandle(),
+             threadHandle,
+             Infra::ProcessInfo::GetCurrentProcessHandle(),
+             &asyncInjection->threadHandle,
+             0,
+             FALSE,
+             DUPLICATE_SAME_ACCESS)))
+    {
+      if (nullptr != asyncInjection->processHandle)
+        Protected::Windows_CloseHandle(asyncInjection->processHandle);
+      if (nullptr != asyncInjection->threadHandle)
+        Protected::Windows_CloseHandle(asyncInjection->threadHandle);
+
+      delete asyncInjection;
+      return false;
+    }
+
+    TaskScheduler::Submit(InjectChildProcessTask, asyncInjection);
+    return true;
   }
 
-  void* InternalHook_CreateProcessW::OriginalFunctionAddress(void)
+  /// Handles a child process that has just been created in a suspended state by the process
+  /// creation hook. Injects it, unless configured otherwise, and, if the application did not
+  /// request that it be created suspended, allows it to run. Asynchronous injection is only
+  /// possible in the latter case, because otherwise the application could resume the child
+  /// process while it is being injected.
+  /// @param [in] processHandle Handle to the process to inject.
+  /// @param [in] threadHandle Handle to the main thread of the process to inject.
+  /// @param [in] shouldCreateSuspended Whether or not the application requested that the child
+  /// process be created in a suspended state.
+  static void HandleCreatedChildProcess(
+      const HANDLE processHandle, const HANDLE threadHandle, const bool shouldCreateSuspended)
   {
-    return GetWindowsApiFunctionAddress("CreateProcessW", &CreateProcessW);
+    if (false == ShouldInjectChildProcess(processHandle))
+    {
+      if (false == shouldCreateSuspended) Protected::Windows_ResumeThread(threadHandle);
+      return;
+    }
+
+    if ((false == shouldCreateSuspended) && (true == ShouldInjectChildProcessesAsynchronously()) &&
+        (true == QueueChildProcessInjection(processHandle, threadHandle)))
+      return;
+
+    InjectChildProcess(processHandle, threadHandle);
+
+    if (false == shouldCreateSuspended) Protected::Windows_ResumeThread(threadHandle);
   }
 
-  BOOL InternalHook_CreateProcessW::Hook(
+  void* InternalHook_CreateProcessInternalW::OriginalFunctionAddress(void)
+  {
+    return GetWindowsApiFunctionAddress("CreateProcessInternalW", nullptr);
+  }
+
+  BOOL InternalHook_CreateProcessInternalW::Hook(
+      HANDLE hUserToken,
       LPCWSTR lpApplicationName,
       LPWSTR lpCommandLine,
       LPSECURITY_ATTRIBUTES lpProcessAttributes,
@@ -112,12 +489,29 @@ namespace Hookshot
       LPVOID lpEnvironment,
       LPCWSTR lpCurrentDirectory,
       LPSTARTUPINFOW lpStartupInfo,
-      LPPROCESS_INFORMATION lpProcessInformation)
+      LPPROCESS_INFORMATION lpProcessInformation,
+      PHANDLE hNewToken)
   {
+    if ((true == isInjectingChildProcess) || (true == AreChildProcessesInjectedByJobBroker()))
+      return Original(
+          hUserToken,
+          lpApplicationName,
+          lpCommandLine,
+          lpProcessAttributes,
+          lpThreadAttributes,
+          bInheritHandles,
+          dwCreationFlags,
+          lpEnvironment,
+          lpCurrentDirectory,
+          lpStartupInfo,
+          lpProcessInformation,
+          hNewToken);
+
     const bool shouldCreateSuspended = (0 != (dwCreationFlags & CREATE_SUSPENDED)) ? true : false;
     PROCESS_INFORMATION processInfo = *lpProcessInformation;
 
     const BOOL createProcessResult = Original(
+        hUserToken,
         lpApplicationName,
         lpCommandLine,
         lpProcessAttributes,
@@ -127,12 +521,12 @@ namespace Hookshot
         lpEnvironment,
         lpCurrentDirectory,
         lpStartupInfo,
-        &processInfo);
+        &processInfo,
+        hNewToken);
     *lpProcessInformation = processInfo;
 
-    if (0 != createProcessResult) InjectChildProcess(processInfo.hProcess, processInfo.hThread);
-
-    if (false == shouldCreateSuspended) Protected::Windows_ResumeThread(processInfo.hThread);
+    if (0 != createProcessResult)
+      HandleCreatedChildProcess(processInfo.hProcess, processInfo.hThread, shouldCreateSuspended);
 
     return createProcessResult;
   }
@@ -0,0 +1,254 @@
+/***************************************************************************************************
+ * Hookshot
+ *   General-purpose library for injecting DLLs and hooking function calls.
+ ***************************************************************************************************
+ * Authored by Samuel Grossman
+ * Copyright (c) 2019-2025
+ ***********************************************************************************************//**
+ * @file CodeCaves.cpp
+ *   Implementation of placing small pieces of code in the padding between functions.
+ **************************************************************************************************/
+
+#include "CodeCaves.h"
+
+#include <cstddef>
+#include <cstdint>
+#include <immintrin.h>
+#include <unordered_map>
+#include <vector>
+
+#include "ApiWindows.h"
+#include "DependencyProtect.h"
+#include "X86Instruction.h"
+
+namespace Hookshot
+{
+  namespace CodeCaves
+  {
+    /// Value of the padding bytes that make up code caves, which encodes the `int 3` instruction.
+    /// Padding made of `nop` instructions is not used because compilers also place it within
+    /// functions to align branch targets, where it is executed.
+    static constexpr uint8_t kPaddingByte = 0xcc;
+
+    /// Mask, as produced by a comparison of a whole block, that selects every byte of the block.
+    static constexpr uint32_t kWholeBlockMask = (1u << kCaveSizeBytes) - 1;
+
+    /// Mask, as produced by a comparison of a whole block, that selects the guard bytes at the
+    /// beginning of the block.
+    static constexpr uint32_t kLeadingGuardMask = (1u << kGuardSizeBytes) - 1;
+
+    /// Mask, as produced by a comparison of a whole block, that selects the guard bytes at the end
+    /// of the block.
+    static constexpr uint32_t kTrailingGuardMask = kLeadingGuardMask
+        << (kCaveSizeBytes - kGuardSizeBytes);
+
+    static_assert(
+        sizeof(__m128i) == kCaveSizeBytes,
+        "Code caves must be exactly the size of the blocks compared during a scan.");
+    static_assert(
+        kGuardSizeBytes <= kCaveSizeBytes,
+        "Guard bytes must fit within the blocks on either side of a code cave.");
+    static_assert(
+        static_cast<size_t>(X86Instruction::kAbsoluteJumpInstructionLengthBytes) <= kCaveSizeBytes,
+        "Code caves must be large enough to hold an absolute jump instruction.");
+
+    /// Code caves found in a single module.
+    struct SModuleCaves
+    {
+      /// Timestamp in the headers of the module that was scanned. Together with the size of the
+      /// module, identifies it in case a different module has since been loaded at the same
+      /// address.
+      DWORD timeDateStamp;
+
+      /// Size of the module that was scanned, in bytes.
+      DWORD sizeOfImage;
+
+      /// Code caves in the module that are not allocated.
+      std::vector<void*> freeCaves;
+    };
+
+    /// Code caves found in every module scanned so far, keyed by module base address.
+    static std::unordered_map<const void*, SModuleCaves> moduleCaves;
+
+    /// Determines if the specified range of memory is committed and can be read.
+    /// @param [in] begin Address of the first byte of the range.
+    /// @param [in] sizeBytes Size of the range, in bytes.
+    /// @return `true` if so, `false` otherwise.
+    static bool IsReadable(const void* begin, size_t sizeBytes)
+    {
+      const size_t end = reinterpret_cast<size_t>(begin) + sizeBytes;
+
+      for (size_t address = reinterpret_cast<size_t>(begin); address < end;)
+      {
+        MEMORY_BASIC_INFORMATION memoryInfo = {};
+        if ((sizeof(memoryInfo) !=
+             Protected::Windows_VirtualQuery(
+                 reinterpret_cast<LPCVOID>(address), &memoryInfo, sizeof(memoryInfo))) ||
+            (MEM_COMMIT != memoryInfo.State) ||
+            (0 != (memoryInfo.Protect & (PAGE_NOACCESS | PAGE_EXECUTE | PAGE_GUARD))))
+          return false;
+
+        address = reinterpret_cast<size_t>(memoryInfo.BaseAddress) + memoryInfo.RegionSize;
+      }
+
+      return true;
+    }
+
+    /// Locates the headers of the module that contains the specified address. The memory
+    /// allocation that contains the address is considered to be a module if it begins with valid
+    /// headers, whether or not it was mapped by the loader.
+    /// @param [in] address Address within the module.
+    /// @param [out] moduleBase Filled with the base address of the module.
+    /// @return Headers of the module, or `nullptr` if the address is not within a module.
+    static const IMAGE_NT_HEADERS* NtHeadersForAddress(
+        const void* address, const uint8_t** moduleBase)
+    {
+      MEMORY_BASIC_INFORMATION memoryInfo = {};
+      if ((sizeof(memoryInfo) !=
+           Protected::Windows_VirtualQuery(address, &memoryInfo, sizeof(memoryInfo))) ||
+          (MEM_COMMIT != memoryInfo.State))
+        return nullptr;
+
+      const uint8_t* const base = reinterpret_cast<const uint8_t*>(memoryInfo.AllocationBase);
+      if (false == IsReadable(base, sizeof(IMAGE_DOS_HEADER))) return nullptr;
+
+      const IMAGE_DOS_HEADER* const dosHeader = reinterpret_cast<const IMAGE_DOS_HEADER*>(base);
+      if ((IMAGE_DOS_SIGNATURE != dosHeader->e_magic) || (dosHeader->e_lfanew < 0))
+        return nullptr;
+
+      const IMAGE_NT_HEADERS* const ntHeaders =
+          reinterpret_cast<const IMAGE_NT_HEADERS*>(&base[dosHeader->e_lfanew]);
+      if (false == IsReadable(ntHeaders, sizeof(IMAGE_NT_HEADERS))) return nullptr;
+      if ((IMAGE_NT_SIGNATURE != ntHeaders->Signature) ||
+          (IMAGE_NT_OPTIONAL_HDR_MAGIC != ntHeaders->OptionalHeader.Magic))
+        return nullptr;
+
+      if (false ==
+          IsReadable(
+              IMAGE_FIRST_SECTION(ntHeaders),
+              ntHeaders->FileHeader.NumberOfSections * sizeof(IMAGE_SECTION_HEADER)))
+        return nullptr;
+
+      *moduleBase = base;
+      return ntHeaders;
+    }
+
+    /// Determines which bytes of an aligned block are padding bytes, comparing all of them at once
+    /// using SSE2 instructions, which every supported processor has.
+    /// @param [in] block Address of the block, which must be aligned to its size.
+    /// @return Mask with one bit set for each padding byte, with the first byte in the lowest bit.
+    static inline uint32_t PaddingMaskForBlock(const uint8_t* block)
+    {
+      return static_cast<uint32_t>(_mm_movemask_epi8(_mm_cmpeq_epi8(
+          _mm_load_si128(reinterpret_cast<const __m128i*>(block)),
+          _mm_set1_epi8(static_cast<char>(kPaddingByte)))));
+    }
+
+    /// Finds every code cave in an executable section. A code cave is an aligned block made
+    /// entirely of padding bytes whose guard bytes, at the end of the block before it and at the
+    /// beginning of the block after it, are also all padding bytes.
+    /// @param [in] sectionBegin Address of the first byte of the section.
+    /// @param [in] sectionSizeBytes Size of the section, in bytes.
+    /// @param [in,out] caves Code caves found are appended to this container.
+    static void FindCavesInSection(
+        const uint8_t* sectionBegin, size_t sectionSizeBytes, std::vector<void*>& caves)
+    {
+      const size_t blocksBegin =
+          (reinterpret_cast<size_t>(sectionBegin) + (kCaveSizeBytes - 1)) & ~(kCaveSizeBytes - 1);
+      const size_t blocksEnd =
+          (reinterpret_cast<size_t>(sectionBegin) + sectionSizeBytes) & ~(kCaveSizeBytes - 1);
+      if ((blocksEnd <= blocksBegin) || ((blocksEnd - blocksBegin) < (3 * kCaveSizeBytes))) return;
+
+      uint32_t previousMask = PaddingMaskForBlock(reinterpret_cast<const uint8_t*>(blocksBegin));
+      uint32_t currentMask =
+          PaddingMaskForBlock(reinterpret_cast<const uint8_t*>(blocksBegin + kCaveSizeBytes));
+
+      for (size_t nextBlock = blocksBegin + (2 * kCaveSizeBytes); nextBlock < blocksEnd;
+           nextBlock += kCaveSizeBytes)
+      {
+        const uint32_t nextMask = PaddingMaskForBlock(reinterpret_cast<const uint8_t*>(nextBlock));
+
+        if ((kWholeBlockMask == currentMask) &&
+            (kTrailingGuardMask == (previousMask & kTrailingGuardMask)) &&
+            (kLeadingGuardMask == (nextMask & kLeadingGuardMask)))
+          caves.push_back(reinterpret_cast<void*>(nextBlock - kCaveSizeBytes));
+
+        previousMask = currentMask;
+        currentMask = nextMask;
+      }
+    }
+
+    /// Finds every code cave in the executable sections of a module.
+    /// @param [in] moduleBase Base address of the module.
+    /// @param [in] ntHeaders Headers of the module.
+    /// @return Code caves found.
+    static std::vector<void*> FindCavesInModule(
+        const uint8_t* moduleBase, const IMAGE_NT_HEADERS* ntHeaders)
+    {
+      std::vector<void*> caves;
+
+      const IMAGE_SECTION_HEADER* const sections = IMAGE_FIRST_SECTION(ntHeaders);
+      for (WORD i = 0; i < ntHeaders->FileHeader.NumberOfSections; ++i)
+      {
+        if (0 == (sections[i].Characteristics & IMAGE_SCN_MEM_EXECUTE)) continue;
+
+        const uint8_t* const sectionBegin = &moduleBase[sections[i].VirtualAddress];
+        const size_t sectionSizeBytes = static_cast<size_t>(
+            (0 != sections[i].Misc.VirtualSize) ? sections[i].Misc.VirtualSize
+                                                : sections[i].SizeOfRawData);
+        if (false == IsReadable(sectionBegin, sectionSizeBytes)) continue;
+
+        FindCavesInSection(sectionBegin, sectionSizeBytes, caves);
+      }
+
+      return caves;
+    }
+
+    void* Allocate(const void* jumpSite)
+    {
+      const uint8_t* moduleBase = nullptr;
+      const IMAGE_NT_HEADERS* const ntHeaders = NtHeadersForAddress(jumpSite, &moduleBase);
+      if (nullptr == ntHeaders) return nullptr;
+
+      // A module is scanned the first time a code cave is needed in it, and again only if some
+      // other module has replaced it at the same address.
+      const bool isNewModule = (0 == moduleCaves.count(moduleBase));
+      SModuleCaves& caves = moduleCaves[moduleBase];
+      if ((true == isNewModule) ||
+          (caves.timeDateStamp != ntHeaders->FileHeader.TimeDateStamp) ||
+          (caves.sizeOfImage != ntHeaders->OptionalHeader.SizeOfImage))
+      {
+        caves.timeDateStamp = ntHeaders->FileHeader.TimeDateStamp;
+        caves.sizeOfImage = ntHeaders->OptionalHeader.SizeOfImage;
+        caves.freeCaves = FindCavesInModule(moduleBase, ntHeaders);
+      }
+
+      for (size_t i = 0; i < caves.freeCaves.size(); ++i)
+      {
+        void* const cave = caves.freeCaves[i];
+        if (false == X86Instruction::CanWriteJumpInstruction(jumpSite, cave)) continue;
+
+        caves.freeCaves[i] = caves.freeCaves.back();
+        caves.freeCaves.pop_back();
+        return cave;
+      }
+
+      return nullptr;
+    }
+
+    void Deallocate(const void* cave)
+    {
+      const uint8_t* moduleBase = nullptr;
+      const IMAGE_NT_HEADERS* const ntHeaders = NtHeadersForAddress(cave, &moduleBase);
+      if (nullptr == ntHeaders) return;
+
+      const auto moduleCavesIter = moduleCaves.find(moduleBase);
+      if ((moduleCaves.end() == moduleCavesIter) ||
+          (moduleCavesIter->second.timeDateStamp != ntHeaders->FileHeader.TimeDateStamp) ||
+          (moduleCavesIter->second.sizeOfImage != ntHeaders->OptionalHeader.SizeOfImage))
+        return;
+
+      moduleCavesIter->second.freeCaves.push_back(const_cast<void*>(cave));
+    }
+  } // namespace CodeCaves
+} // namespace Hookshot
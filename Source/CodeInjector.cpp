@@ -13,7 +13,12 @@
 
 #include "CodeInjector.h"
 
+#include <algorithm>
+#include <array>
+#include <chrono>
 #include <cstddef>
+#include <cstdint>
+#include <cstring>
 
 #include <Infra/Core/ProcessInfo.h>
 #include <Infra/Core/Strings.h>
@@ -22,42 +27,236 @@
 #include "ApiWindows.h"
 #include "Inject.h"
 #include "InjectResult.h"
+#include "InjectionArena.h"
 #include "Strings.h"
+#include "Tracing.h"
 
 namespace Hookshot
 {
+  /// Fills a buffer with the contents of the code region. The code region is position-independent
+  /// and refers to the data region by its displacement from the start of the code region.
+  /// @param [in] injectInfo Information about the injected code.
+  /// @param [in] dataDisplacement Displacement, in bytes, of the data region from the start of the
+  /// code region.
+  /// @param [out] codeImage Buffer to fill, which must be large enough to hold all injected code.
+  static void BuildCodeImage(
+      const InjectInfo& injectInfo, const size_t dataDisplacement, uint8_t* const codeImage)
+  {
+    std::memcpy(
+        codeImage,
+        injectInfo.GetInjectCodeStart(),
+        reinterpret_cast<size_t>(injectInfo.GetInjectCodeEnd()) -
+            reinterpret_cast<size_t>(injectInfo.GetInjectCodeStart()));
+    std::memcpy(codeImage, &dataDisplacement, sizeof(dataDisplacement));
+  }
+
+  /// Determines whether or not a module loaded in this process is also loaded at the same base
+  /// address in another process. System libraries are mapped at the same base address in every
+  /// process for the duration of a boot session, so this is usually the case for them, and a single
+  /// remote read of the module's headers is enough to confirm it.
+  /// @param [in] process Handle of the other process, which must have read access.
+  /// @param [in] module Handle of the module in this process, which is also its base address.
+  /// @return `true` if the other process has an identical module image loaded at the same base
+  /// address, `false` if not or if this cannot be determined.
+  static bool IsModuleAtSameBaseAddress(const HANDLE process, const HMODULE module)
+  {
+    const IMAGE_DOS_HEADER* const dosHeader = reinterpret_cast<const IMAGE_DOS_HEADER*>(module);
+    const size_t headersSizeBytes =
+        static_cast<size_t>(dosHeader->e_lfanew) + sizeof(IMAGE_NT_HEADERS);
+
+    std::array<uint8_t, 1024> remoteHeaders;
+    if (headersSizeBytes > remoteHeaders.size()) return false;
+
+    SIZE_T numBytesRead = 0;
+    if ((FALSE ==
+         ReadProcessMemory(
+             process, module, remoteHeaders.data(), headersSizeBytes, &numBytesRead)) ||
+        (headersSizeBytes != numBytesRead))
+      return false;
+
+    // Headers include the image's link timestamp, size, and checksum, so a match means that the
+    // other process has the same build of the same module at the same address.
+    return (0 == std::memcmp(remoteHeaders.data(), module, headersSizeBytes));
+  }
+
   CodeInjector::CodeInjector(
       void* const baseAddressCode,
       void* const baseAddressData,
       const bool cleanupCodeBuffer,
       const bool cleanupDataBuffer,
+      const bool sharedCodeRegion,
       void* const entryPoint,
       const size_t sizeCode,
       const size_t sizeData,
       const HANDLE injectedProcess,
-      const HANDLE injectedProcessMainThread)
+      const HANDLE injectedProcessMainThread,
+      InjectionArena& arena)
       : baseAddressCode(baseAddressCode),
         baseAddressData(baseAddressData),
         cleanupCodeBuffer(cleanupCodeBuffer),
         cleanupDataBuffer(cleanupDataBuffer),
+        sharedCodeRegion(sharedCodeRegion),
         entryPoint(entryPoint),
         sizeCode(sizeCode),
         sizeData(sizeData),
         injectedProcess(injectedProcess),
         injectedProcessMainThread(injectedProcessMainThread),
+        arena(arena),
         oldCodeAtTrampoline(),
-        injectInfo()
+        runIsApc(false),
+        runStartTime(),
+        runSyncVar1(0),
+        runSyncVar2(0),
+        runSyncEvent(nullptr),
+        remoteSyncEvent(nullptr),
+        injectInfo(InjectInfo::GetInstance())
   {}
 
-  EInjectResult CodeInjector::SetAndRun(const bool enableDebugFeatures)
+  HANDLE CodeInjector::GetSharedCodeSection(const size_t sizeCode, const size_t sizeData)
+  {
+    static const HANDLE sharedCodeSection = [sizeCode, sizeData]() -> HANDLE
+    {
+      const InjectInfo& sectionInjectInfo = InjectInfo::GetInstance();
+      if (EInjectResult::Success != sectionInjectInfo.InitializationResult()) return nullptr;
+
+      const size_t requiredCodeSize =
+          reinterpret_cast<size_t>(sectionInjectInfo.GetInjectCodeEnd()) -
+          reinterpret_cast<size_t>(sectionInjectInfo.GetInjectCodeStart());
+      if (requiredCodeSize > sizeCode) return nullptr;
+
+      const unsigned long long sectionSize = static_cast<unsigned long long>(sizeCode + sizeData);
+      const HANDLE section = CreateFileMapping(
+          INVALID_HANDLE_VALUE,
+          nullptr,
+          PAGE_EXECUTE_READWRITE,
+          static_cast<DWORD>(sectionSize >> 32),
+          static_cast<DWORD>(sectionSize),
+          nullptr);
+      if (nullptr == section) return nullptr;
+
+      uint8_t* const sectionData =
+          reinterpret_cast<uint8_t*>(MapViewOfFile(section, FILE_MAP_WRITE, 0, 0, sizeCode));
+      if (nullptr == sectionData)
+      {
+        CloseHandle(section);
+        return nullptr;
+      }
+
+      // The data region always immediately follows the code region in every view of the section.
+      BuildCodeImage(sectionInjectInfo, sizeCode, sectionData);
+      UnmapViewOfFile(sectionData);
+
+      return section;
+    }();
+
+    return sharedCodeSection;
+  }
+
+  EInjectResult CodeInjector::SetAndRun(
+      const bool enableDebugFeatures,
+      const bool runAsApc,
+      Tracing::SInjectPhaseDurations& phaseDurations)
+  {
+    EInjectResult result = Check();
+
+    const DWORD processId = GetProcessId(injectedProcess);
+
+    if (EInjectResult::Success == result)
+    {
+      const auto phaseStartTime = std::chrono::steady_clock::now();
+      result = Set(enableDebugFeatures, runAsApc);
+
+      const long long setMicroseconds = Tracing::MicrosecondsSince(phaseStartTime);
+      phaseDurations.Record(Tracing::EInjectPhase::SetInjectedCode, setMicroseconds);
+      Tracing::InjectProcessPhase(
+          processId, Tracing::EInjectPhase::SetInjectedCode, setMicroseconds, result);
+    }
+
+    if (EInjectResult::Success == result)
+    {
+      const auto phaseStartTime = std::chrono::steady_clock::now();
+      result = Run(runAsApc);
+
+      const long long runMicroseconds = Tracing::MicrosecondsSince(phaseStartTime);
+      phaseDurations.Record(Tracing::EInjectPhase::RunInjectedCode, runMicroseconds);
+      Tracing::InjectProcessPhase(
+          processId, Tracing::EInjectPhase::RunInjectedCode, runMicroseconds, result);
+    }
+
+    if ((EInjectResult::Success == result) && (false == runAsApc))
+    {
+      const auto phaseStartTime = std::chrono::steady_clock::now();
+      result = UnsetTrampoline();
+
+      const long long cleanupMicroseconds = Tracing::MicrosecondsSince(phaseStartTime);
+      phaseDurations.Record(Tracing::EInjectPhase::Cleanup, cleanupMicroseconds);
+      Tracing::InjectProcessPhase(
+          processId, Tracing::EInjectPhase::Cleanup, cleanupMicroseconds, result);
+    }
+
+    return result;
+  }
+
+  EInjectResult CodeInjector::SetAndStartRun(
+      const bool enableDebugFeatures,
+      const bool runAsApc,
+      const HANDLE syncEvent,
+      Tracing::SInjectPhaseDurations& phaseDurations)
   {
     EInjectResult result = Check();
 
-    if (EInjectResult::Success == result) result = Set(enableDebugFeatures);
+    const DWORD processId = GetProcessId(injectedProcess);
+
+    if (EInjectResult::Success == result)
+    {
+      const auto phaseStartTime = std::chrono::steady_clock::now();
+      result = Set(enableDebugFeatures, runAsApc);
+
+      const long long setMicroseconds = Tracing::MicrosecondsSince(phaseStartTime);
+      phaseDurations.Record(Tracing::EInjectPhase::SetInjectedCode, setMicroseconds);
+      Tracing::InjectProcessPhase(
+          processId, Tracing::EInjectPhase::SetInjectedCode, setMicroseconds, result);
+    }
+
+    if (EInjectResult::Success == result)
+    {
+      runStartTime = std::chrono::steady_clock::now();
+      runIsApc = runAsApc;
+      result = StartRun(syncEvent, runAsApc);
+
+      if (EInjectResult::Success != result)
+      {
+        const long long runMicroseconds = Tracing::MicrosecondsSince(runStartTime);
+        phaseDurations.Record(Tracing::EInjectPhase::RunInjectedCode, runMicroseconds);
+        Tracing::InjectProcessPhase(
+            processId, Tracing::EInjectPhase::RunInjectedCode, runMicroseconds, result);
+      }
+    }
+
+    return result;
+  }
+
+  EInjectResult CodeInjector::FinishStartedRun(Tracing::SInjectPhaseDurations& phaseDurations)
+  {
+    const DWORD processId = GetProcessId(injectedProcess);
+
+    EInjectResult result = FinishRun();
+
+    const long long runMicroseconds = Tracing::MicrosecondsSince(runStartTime);
+    phaseDurations.Record(Tracing::EInjectPhase::RunInjectedCode, runMicroseconds);
+    Tracing::InjectProcessPhase(
+        processId, Tracing::EInjectPhase::RunInjectedCode, runMicroseconds, result);
 
-    if (EInjectResult::Success == result) result = Run();
+    if ((EInjectResult::Success == result) && (false == runIsApc))
+    {
+      const auto phaseStartTime = std::chrono::steady_clock::now();
+      result = UnsetTrampoline();
 
-    if (EInjectResult::Success == result) result = UnsetTrampoline();
+      const long long cleanupMicroseconds = Tracing::MicrosecondsSince(phaseStartTime);
+      phaseDurations.Record(Tracing::EInjectPhase::Cleanup, cleanupMicroseconds);
+      Tracing::InjectProcessPhase(
+          processId, Tracing::EInjectPhase::Cleanup, cleanupMicroseconds, result);
+    }
 
     return result;
   }
@@ -79,6 +278,11 @@ namespace Hookshot
         (INVALID_HANDLE_VALUE == injectedProcessMainThread))
       return EInjectResult::ErrorInternalInvalidParams;
 
+    if ((true == sharedCodeRegion) &&
+        (reinterpret_cast<size_t>(baseAddressData) !=
+         (reinterpret_cast<size_t>(baseAddressCode) + sizeCode)))
+      return EInjectResult::ErrorInternalInvalidParams;
+
     return EInjectResult::Success;
   }
 
@@ -100,15 +304,20 @@ namespace Hookshot
   }
 
   bool CodeInjector::LocateFunctions(
-      void*& addrGetLastError, void*& addrGetProcAddress, void*& addrLoadLibraryA) const
+      void*& addrGetLastError,
+      void*& addrGetProcAddress,
+      void*& addrLoadLibraryA,
+      void*& addrSetEvent) const
   {
     HMODULE moduleGetLastError = nullptr;
     HMODULE moduleGetProcAddress = nullptr;
     HMODULE moduleLoadLibraryA = nullptr;
+    HMODULE moduleSetEvent = nullptr;
 
     Infra::TemporaryString moduleFilenameGetLastError;
     Infra::TemporaryString moduleFilenameGetProcAddress;
     Infra::TemporaryString moduleFilenameLoadLibraryA;
+    Infra::TemporaryString moduleFilenameSetEvent;
     MODULEINFO moduleInfo;
 
     // Get module handles for the desired functions in the current process.
@@ -135,11 +344,47 @@ namespace Hookshot
             &moduleLoadLibraryA))
       return false;
 
+    if (FALSE ==
+        GetModuleHandleEx(
+            GET_MODULE_HANDLE_EX_FLAG_FROM_ADDRESS | GET_MODULE_HANDLE_EX_FLAG_UNCHANGED_REFCOUNT,
+            reinterpret_cast<LPCWSTR>(SetEvent),
+            &moduleSetEvent))
+      return false;
+
+    // In the common case, every module is loaded at the same address in the injected process, in
+    // which case so is every function, and there is no need to enumerate the injected process'
+    // modules.
+    const HMODULE requiredModules[] = {
+        moduleGetLastError, moduleGetProcAddress, moduleLoadLibraryA, moduleSetEvent};
+    bool allRequiredModulesAtSameBaseAddress = true;
+
+    for (size_t i = 0;
+         (i < _countof(requiredModules)) && (true == allRequiredModulesAtSameBaseAddress);
+         ++i)
+    {
+      if (std::find(requiredModules, &requiredModules[i], requiredModules[i]) !=
+          &requiredModules[i])
+        continue;
+
+      allRequiredModulesAtSameBaseAddress =
+          IsModuleAtSameBaseAddress(injectedProcess, requiredModules[i]);
+    }
+
+    if (true == allRequiredModulesAtSameBaseAddress)
+    {
+      addrGetLastError = reinterpret_cast<void*>(GetLastError);
+      addrGetProcAddress = reinterpret_cast<void*>(GetProcAddress);
+      addrLoadLibraryA = reinterpret_cast<void*>(LoadLibraryA);
+      addrSetEvent = reinterpret_cast<void*>(SetEvent);
+      return true;
+    }
+
     // Compute the relative addresses of each desired function with respect to the base address of
     // its associated DLL.
     size_t offsetGetLastError = static_cast<size_t>(-1);
     size_t offsetGetProcAddress = static_cast<size_t>(-1);
     size_t offsetLoadLibraryA = static_cast<size_t>(-1);
+    size_t offsetSetEvent = static_cast<size_t>(-1);
 
     if (FALSE ==
         GetModuleInformation(
@@ -176,6 +421,18 @@ namespace Hookshot
     offsetLoadLibraryA =
         reinterpret_cast<size_t>(LoadLibraryA) - reinterpret_cast<size_t>(moduleInfo.lpBaseOfDll);
 
+    if ((moduleSetEvent != moduleLoadLibraryA) &&
+        (FALSE ==
+         GetModuleInformation(
+             Infra::ProcessInfo::GetCurrentProcessHandle(),
+             moduleSetEvent,
+             &moduleInfo,
+             sizeof(moduleInfo))))
+      return false;
+
+    offsetSetEvent =
+        reinterpret_cast<size_t>(SetEvent) - reinterpret_cast<size_t>(moduleInfo.lpBaseOfDll);
+
     // Compute the full path names for each module that offers the required functions.
     moduleFilenameGetLastError.UnsafeSetSize(GetModuleFileName(
         moduleGetLastError,
@@ -195,6 +452,10 @@ namespace Hookshot
         moduleFilenameLoadLibraryA.Capacity()));
     if (true == moduleFilenameLoadLibraryA.Empty()) return false;
 
+    moduleFilenameSetEvent.UnsafeSetSize(GetModuleFileName(
+        moduleSetEvent, moduleFilenameSetEvent.Data(), moduleFilenameSetEvent.Capacity()));
+    if (true == moduleFilenameSetEvent.Empty()) return false;
+
     // Enumerate all of the modules in the target process.
     // This approach is necessary because GetModuleHandle(Ex) cannot act on processes other than the
     // calling process.
@@ -216,10 +477,11 @@ namespace Hookshot
     addrGetLastError = nullptr;
     addrGetProcAddress = nullptr;
     addrLoadLibraryA = nullptr;
+    addrSetEvent = nullptr;
 
     for (DWORD modidx = 0; (modidx < numLoadedModules) &&
          ((nullptr == addrGetLastError) || (nullptr == addrGetProcAddress) ||
-          (nullptr == addrLoadLibraryA));
+          (nullptr == addrLoadLibraryA) || (nullptr == addrSetEvent));
          ++modidx)
     {
       const HMODULE loadedModule = loadedModules[modidx];
@@ -273,31 +535,77 @@ namespace Hookshot
               reinterpret_cast<size_t>(moduleInfo.lpBaseOfDll) + offsetLoadLibraryA);
         }
       }
+
+      if (nullptr == addrSetEvent)
+      {
+        if (true ==
+            Infra::Strings::EqualsCaseInsensitive(
+                moduleFilenameSetEvent.AsStringView(), loadedModuleName.AsStringView()))
+        {
+          if (FALSE ==
+              GetModuleInformation(injectedProcess, loadedModule, &moduleInfo, sizeof(moduleInfo)))
+            return false;
+
+          addrSetEvent = reinterpret_cast<void*>(
+              reinterpret_cast<size_t>(moduleInfo.lpBaseOfDll) + offsetSetEvent);
+        }
+      }
     }
 
     return (
         (nullptr != addrGetLastError) && (nullptr != addrGetProcAddress) &&
-        (nullptr != addrLoadLibraryA));
+        (nullptr != addrLoadLibraryA) && (nullptr != addrSetEvent));
+  }
+
+  EInjectResult CodeInjector::Run(const bool runAsApc)
+  {
+    // Failure to create the event is not fatal because synchronization can fall back to polling.
+    const HANDLE syncEvent = CreateEvent(nullptr, FALSE, FALSE, nullptr);
+    const EInjectResult result = RunWithSyncEvent(syncEvent, runAsApc);
+
+    if (nullptr != syncEvent) CloseHandle(syncEvent);
+
+    return result;
+  }
+
+  EInjectResult CodeInjector::RunWithSyncEvent(const HANDLE syncEvent, const bool runAsApc)
+  {
+    const EInjectResult result = StartRun(syncEvent, runAsApc);
+    if (EInjectResult::Success != result) return result;
+
+    return FinishRun();
   }
 
-  EInjectResult CodeInjector::Run(void)
+  EInjectResult CodeInjector::StartRun(const HANDLE syncEvent, const bool runAsApc)
   {
     injectInit(injectedProcess, baseAddressData);
 
-    // Allow the injected code to start running.
-    if (1 != ResumeThread(injectedProcessMainThread))
-      return EInjectResult::ErrorRunFailedResumeThread;
+    // When running by way of the trampoline, the injected code waits at two synchronization
+    // barriers before loading the library, one upon starting and one while the values it needs are
+    // filled in. When running as an asynchronous procedure call, those values are filled in before
+    // it is queued, so neither barrier exists.
+    if (false == runAsApc)
+    {
+      // Allow the injected code to start running.
+      if (1 != ResumeThread(injectedProcessMainThread))
+        return EInjectResult::ErrorRunFailedResumeThread;
 
-    // Synchronize with the injected code.
-    if (false == injectSync()) return EInjectResult::ErrorRunFailedSync;
+      // Synchronize with the injected code.
+      if (false == injectSync()) return EInjectResult::ErrorRunFailedSync;
+    }
 
     // Fill in some values that the injected process needs to perform required operations.
+    // When running by way of the trampoline, the injected code cannot signal the sync event until
+    // it knows where to find SetEvent, so the first synchronization above always uses polling.
+    remoteSyncEvent = nullptr;
     {
       void* addrGetLastError;
       void* addrGetProcAddress;
       void* addrLoadLibraryA;
+      void* addrSetEvent;
 
-      if (true != LocateFunctions(addrGetLastError, addrGetProcAddress, addrLoadLibraryA))
+      if (true !=
+          LocateFunctions(addrGetLastError, addrGetProcAddress, addrLoadLibraryA, addrSetEvent))
         return EInjectResult::ErrorCannotLocateRequiredFunctions;
 
       if (false == injectDataFieldWrite(funcGetLastError, &addrGetLastError))
@@ -308,10 +616,74 @@ namespace Hookshot
 
       if (false == injectDataFieldWrite(funcLoadLibraryA, &addrLoadLibraryA))
         return EInjectResult::ErrorCannotWriteRequiredFunctionLocations;
+
+      if ((nullptr != syncEvent) &&
+          (FALSE !=
+           DuplicateHandle(
+               GetCurrentProcess(),
+               syncEvent,
+               injectedProcess,
+               &remoteSyncEvent,
+               EVENT_MODIFY_STATE,
+               FALSE,
+               0)))
+      {
+        if ((true == injectDataFieldWrite(funcSetEvent, &addrSetEvent)) &&
+            (true == injectDataFieldWrite(syncEvent, &remoteSyncEvent)))
+          injectSyncEnableEvent(syncEvent);
+      }
     }
 
-    // Synchronize with the injected code.
-    if (false == injectSync()) return EInjectResult::ErrorRunFailedSync;
+    if (true == runAsApc)
+    {
+      // Queue the injected code to run on the main thread, which happens as soon as it resumes and
+      // before it reaches the entry point.
+      const PAPCFUNC apcRoutine = reinterpret_cast<PAPCFUNC>(
+          reinterpret_cast<size_t>(baseAddressCode) +
+          (reinterpret_cast<size_t>(injectInfo.GetInjectApcBegin()) -
+           reinterpret_cast<size_t>(injectInfo.GetInjectCodeStart())));
+      if (0 == QueueUserAPC(apcRoutine, injectedProcessMainThread, 0))
+        return EInjectResult::ErrorRunFailedQueueApc;
+
+      // Allow the injected code to start running.
+      if (1 != ResumeThread(injectedProcessMainThread))
+        return EInjectResult::ErrorRunFailedResumeThread;
+    }
+    else
+    {
+      // Synchronize with the injected code.
+      if (false == injectSync()) return EInjectResult::ErrorRunFailedSync;
+    }
+
+    // The injected code is now loading the library. Synchronization state is kept so that waiting
+    // for it to finish can be done separately.
+    runSyncVar1 = syncVar1;
+    runSyncVar2 = syncVar2;
+    runSyncEvent = syncEventHandle;
+    return EInjectResult::Success;
+  }
+
+  EInjectResult CodeInjector::CheckRunFinished(bool* finished)
+  {
+    size_t syncFlagValue = 0;
+    if (false ==
+        injectDataFieldReadImpl(
+            injectedProcess,
+            &reinterpret_cast<const SInjectData*>(baseAddressData)->sync,
+            &syncFlagValue,
+            sizeof(syncFlagValue)))
+      return EInjectResult::ErrorRunFailedSync;
+
+    *finished = (runSyncVar1 == syncFlagValue);
+    return EInjectResult::Success;
+  }
+
+  EInjectResult CodeInjector::FinishRun(void)
+  {
+    injectInit(injectedProcess, baseAddressData);
+    syncVar1 = runSyncVar1;
+    syncVar2 = runSyncVar2;
+    injectSyncEnableEvent(runSyncEvent);
 
     // Wait for the injected code to reach completion and synchronize with it.
     // Once the injected code reaches this point, put the thread to sleep and then allow it to
@@ -322,6 +694,12 @@ namespace Hookshot
     if (0 != SuspendThread(injectedProcessMainThread))
       return EInjectResult::ErrorRunFailedSuspendThread;
 
+    // The injected code has signalled the sync event for the last time, so its handle to the event
+    // can be closed while the injected process is suspended.
+    if (nullptr != remoteSyncEvent)
+      DuplicateHandle(
+          injectedProcess, remoteSyncEvent, nullptr, nullptr, 0, FALSE, DUPLICATE_CLOSE_SOURCE);
+
     if (false == injectSyncAdvance()) return EInjectResult::ErrorRunFailedSync;
 
     // Read from the injected process to determine the result of the injection attempt.
@@ -338,85 +716,85 @@ namespace Hookshot
     return static_cast<EInjectResult>(injectionResult);
   }
 
-  EInjectResult CodeInjector::Set(const bool enableDebugFeatures)
+  EInjectResult CodeInjector::Set(const bool enableDebugFeatures, const bool runAsApc)
   {
     SIZE_T numBytes = 0;
 
-    // Back up the code currently at the trampoline's target location.
-    if ((FALSE ==
-         ReadProcessMemory(
-             injectedProcess,
-             entryPoint,
-             reinterpret_cast<LPVOID>(oldCodeAtTrampoline.data()),
-             GetTrampolineCodeSize(),
-             &numBytes)) ||
-        (GetTrampolineCodeSize() != numBytes))
-      EInjectResult::ErrorSetFailedRead;
-
-    // Write the trampoline code.
-    if ((FALSE ==
-         WriteProcessMemory(
-             injectedProcess,
-             entryPoint,
-             injectInfo.GetInjectTrampolineStart(),
-             GetTrampolineCodeSize(),
-             &numBytes)) ||
-        (GetTrampolineCodeSize() != numBytes) ||
-        (FALSE == FlushInstructionCache(injectedProcess, entryPoint, GetTrampolineCodeSize())))
-      EInjectResult::ErrorSetFailedWrite;
-
-    // Place the address of the main code entry point into the trampoline code at the correct
-    // location.
+    // A trampoline is only needed if the injected code is not run as an asynchronous procedure
+    // call.
+    if (false == runAsApc)
     {
-      void* const targetAddress = reinterpret_cast<void*>(
-          reinterpret_cast<size_t>(entryPoint) +
-          (reinterpret_cast<size_t>(injectInfo.GetInjectTrampolineAddressMarker()) -
-           reinterpret_cast<size_t>(injectInfo.GetInjectTrampolineStart())) -
-          sizeof(size_t));
-      const size_t sourceData = reinterpret_cast<size_t>(baseAddressCode) +
-          (reinterpret_cast<size_t>(injectInfo.GetInjectCodeBegin()) -
-           reinterpret_cast<size_t>(injectInfo.GetInjectCodeStart()));
-
+      // Back up the code currently at the trampoline's target location.
       if ((FALSE ==
-           WriteProcessMemory(
-               injectedProcess, targetAddress, &sourceData, sizeof(sourceData), &numBytes)) ||
-          (sizeof(sourceData) != numBytes) ||
-          (FALSE == FlushInstructionCache(injectedProcess, targetAddress, sizeof(sourceData))))
-        EInjectResult::ErrorSetFailedWrite;
-    }
+           ReadProcessMemory(
+               injectedProcess,
+               entryPoint,
+               reinterpret_cast<LPVOID>(oldCodeAtTrampoline.data()),
+               GetTrampolineCodeSize(),
+               &numBytes)) ||
+          (GetTrampolineCodeSize() != numBytes))
+        return EInjectResult::ErrorSetFailedRead;
 
-    // Write the main code.
-    if ((FALSE ==
-         WriteProcessMemory(
-             injectedProcess,
-             baseAddressCode,
-             injectInfo.GetInjectCodeStart(),
-             GetRequiredCodeSize(),
-             &numBytes)) ||
-        (GetRequiredCodeSize() != numBytes) ||
-        (FALSE == FlushInstructionCache(injectedProcess, baseAddressCode, GetRequiredCodeSize())))
-      EInjectResult::ErrorSetFailedWrite;
+      // Build the trampoline code locally, including the address of the main code entry point, so
+      // that it can be written all at once.
+      std::array<uint8_t, kMaxTrampolineCodeBytes> trampolineCode;
+      std::memcpy(
+          trampolineCode.data(), injectInfo.GetInjectTrampolineStart(), GetTrampolineCodeSize());
 
-    // Place the pointer to the data region into the correct spot in the code region.
-    {
-      void* const targetAddress = baseAddressCode;
-      const size_t sourceData = reinterpret_cast<size_t>(baseAddressData);
+      const size_t mainCodeEntryPoint = reinterpret_cast<size_t>(baseAddressCode) +
+          (reinterpret_cast<size_t>(injectInfo.GetInjectCodeBegin()) -
+           reinterpret_cast<size_t>(injectInfo.GetInjectCodeStart()));
+      std::memcpy(
+          &trampolineCode[(
+              reinterpret_cast<size_t>(injectInfo.GetInjectTrampolineAddressMarker()) -
+              reinterpret_cast<size_t>(injectInfo.GetInjectTrampolineStart()) - sizeof(size_t))],
+          &mainCodeEntryPoint,
+          sizeof(mainCodeEntryPoint));
 
       if ((FALSE ==
            WriteProcessMemory(
-               injectedProcess, targetAddress, &sourceData, sizeof(sourceData), &numBytes)) ||
-          (sizeof(sourceData) != numBytes) ||
-          (FALSE == FlushInstructionCache(injectedProcess, targetAddress, sizeof(sourceData))))
-        EInjectResult::ErrorSetFailedWrite;
+               injectedProcess,
+               entryPoint,
+               trampolineCode.data(),
+               GetTrampolineCodeSize(),
+               &numBytes)) ||
+          (GetTrampolineCodeSize() != numBytes) ||
+          (FALSE == FlushInstructionCache(injectedProcess, entryPoint, GetTrampolineCodeSize())))
+        return EInjectResult::ErrorSetFailedWrite;
     }
 
-    // Initialize the data region.
+    // Build the code and data regions locally. If the data region immediately follows the code
+    // region, which is the case whenever both come from the same allocation, then both regions are
+    // built as a single image and written all at once. A shared code region already contains the
+    // injected code, so only the data region is built and written.
+    const bool dataFollowsCode = (reinterpret_cast<size_t>(baseAddressData) ==
+                                  (reinterpret_cast<size_t>(baseAddressCode) + sizeCode));
+    const size_t codeImageSize = (true == sharedCodeRegion) ? 0
+        : (true == dataFollowsCode)                          ? sizeCode
+                                                             : GetRequiredCodeSize();
+    const size_t dataImageSize = InjectInfo::kMaxInjectBinaryFileSize;
+
+    const size_t imageSize = codeImageSize + dataImageSize;
+    uint8_t* const image = arena.AllocateArray<uint8_t>(imageSize);
+    if (nullptr == image) return EInjectResult::ErrorSetFailedWrite;
+
+    std::memset(image, 0, imageSize);
+    uint8_t* const codeImage = &image[0];
+    uint8_t* const dataImage = &image[codeImageSize];
+
+    if (false == sharedCodeRegion)
+      BuildCodeImage(
+          injectInfo,
+          reinterpret_cast<size_t>(baseAddressData) - reinterpret_cast<size_t>(baseAddressCode),
+          codeImage);
+
+    // Initialize the data region, which consists of a data structure followed by strings.
     {
       SInjectData injectData;
-      char injectDataStrings[InjectInfo::kMaxInjectBinaryFileSize - sizeof(injectData)];
+      char* const injectDataStrings = reinterpret_cast<char*>(&dataImage[sizeof(injectData)]);
+      const size_t injectDataStringsSize = dataImageSize - sizeof(injectData);
 
       memset(&injectData, 0, sizeof(injectData));
-      memset(&injectDataStrings, 0, sizeof(injectDataStrings));
 
       injectData.enableDebugFeatures = (true == enableDebugFeatures ? 1 : 0);
       injectData.injectionResultCodeSuccess = static_cast<uint32_t>(EInjectResult::Success);
@@ -428,17 +806,19 @@ namespace Hookshot
           static_cast<uint32_t>(EInjectResult::ErrorLibraryInitFailed);
       injectData.injectionResult = static_cast<uint32_t>(EInjectResult::Failure);
 
-      strcpy_s(injectDataStrings, Strings::kStrLibraryInitializationProcName.data());
+      strcpy_s(
+          injectDataStrings,
+          injectDataStringsSize,
+          Strings::kStrLibraryInitializationProcName.data());
 
       if (0 !=
           wcstombs_s(
               nullptr,
               &injectDataStrings[Strings::kStrLibraryInitializationProcName.length() + 1],
-              sizeof(injectDataStrings) -
-                  (Strings::kStrLibraryInitializationProcName.length() + 1) - 1,
+              injectDataStringsSize - (Strings::kStrLibraryInitializationProcName.length() + 1) - 1,
               Strings::GetHookshotDynamicLinkLibraryFilename().data(),
-              sizeof(injectDataStrings) -
-                  (Strings::kStrLibraryInitializationProcName.length() + 1) - 2))
+              injectDataStringsSize - (Strings::kStrLibraryInitializationProcName.length() + 1) -
+                  2))
         return EInjectResult::ErrorCannotGenerateLibraryFilename;
 
       injectData.strLibraryName = reinterpret_cast<const char*>(
@@ -459,24 +839,50 @@ namespace Hookshot
           injectData.cleanupBaseAddress[cleanupIndex++] = baseAddressData;
       }
 
+      std::memcpy(dataImage, &injectData, sizeof(injectData));
+    }
+
+    // Write the code and data regions.
+    if (true == sharedCodeRegion)
+    {
+      if ((FALSE ==
+           WriteProcessMemory(
+               injectedProcess, baseAddressData, dataImage, dataImageSize, &numBytes)) ||
+          (dataImageSize != numBytes))
+        return EInjectResult::ErrorSetFailedWrite;
+    }
+    else if (true == dataFollowsCode)
+    {
+      if ((FALSE ==
+           WriteProcessMemory(
+               injectedProcess, baseAddressCode, image, imageSize, &numBytes)) ||
+          (imageSize != numBytes))
+        return EInjectResult::ErrorSetFailedWrite;
+    }
+    else
+    {
       if ((FALSE ==
            WriteProcessMemory(
-               injectedProcess, baseAddressData, &injectData, sizeof(injectData), &numBytes)) ||
-          (sizeof(injectData) != numBytes))
-        EInjectResult::ErrorSetFailedWrite;
+               injectedProcess, baseAddressCode, codeImage, codeImageSize, &numBytes)) ||
+          (codeImageSize != numBytes))
+        return EInjectResult::ErrorSetFailedWrite;
 
       if ((FALSE ==
            WriteProcessMemory(
-               injectedProcess,
-               reinterpret_cast<void*>(
-                   reinterpret_cast<size_t>(baseAddressData) + sizeof(injectData)),
-               injectDataStrings,
-               sizeof(injectDataStrings),
-               &numBytes)) ||
-          (sizeof(injectDataStrings) != numBytes))
-        EInjectResult::ErrorSetFailedWrite;
+               injectedProcess, baseAddressData, dataImage, dataImageSize, &numBytes)) ||
+          (dataImageSize != numBytes))
+        return EInjectResult::ErrorSetFailedWrite;
     }
 
+    // Now that the code region is fully written, it can be made executable. For a shared code
+    // region this also makes sure the injected process can never obtain a private copy of it.
+    DWORD unusedOldProtect = 0;
+    if ((FALSE ==
+         VirtualProtectEx(
+             injectedProcess, baseAddressCode, sizeCode, PAGE_EXECUTE_READ, &unusedOldProtect)) ||
+        (FALSE == FlushInstructionCache(injectedProcess, baseAddressCode, GetRequiredCodeSize())))
+      return EInjectResult::ErrorVirtualProtectFailed;
+
     return EInjectResult::Success;
   }
 
@@ -0,0 +1,426 @@
+/***************************************************************************************************
+ * Hookshot
+ *   General-purpose library for injecting DLLs and hooking function calls.
+ ***************************************************************************************************
+ * Authored by Samuel Grossman
+ * Copyright (c) 2019-2025
+ ***********************************************************************************************//**
+ * @file CodeRelocation.cpp
+ *   Implementation of relocating instructions from one location to another.
+ **************************************************************************************************/
+
+#include "CodeRelocation.h"
+
+#include <climits>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <vector>
+
+#include <Infra/Core/Message.h>
+
+#include "HookshotTypes.h"
+#include "MappedLog.h"
+#include "TrampolineStore.h"
+#include "X86Instruction.h"
+
+namespace Hookshot
+{
+  namespace CodeRelocation
+  {
+    bool RelocateInstructions(
+        X86Instruction* instructions,
+        int numInstructions,
+        const uint8_t* sourceBytes,
+        void* dst,
+        int dstCapacity,
+        uint32_t options,
+        SRelocatedCode* relocated)
+    {
+      // Diagnostic messages are output for every instruction of every hook, so whether or not they
+      // would go anywhere is determined just once.
+      const bool debugOutputLive = MappedLog::IsDebugOutputLive();
+      const bool canRewriteMemoryReferences =
+          (0 == (options & kRelocateCodeOptionPreserveOffsets));
+
+      uint8_t* const dstBytes = reinterpret_cast<uint8_t*>(dst);
+
+      int numSourceBytes = 0;
+      for (int i = 0; i < numInstructions; ++i)
+        numSourceBytes += instructions[i].GetLengthBytes();
+
+      *relocated = {
+          .numSourceBytes = static_cast<size_t>(numSourceBytes),
+          .numInstructions = static_cast<size_t>(numInstructions),
+          .numCodeBytes = 0,
+          .numTailBytes = 0,
+          .numJumpAssists = 0,
+          .numRewrittenMemoryReferences = 0,
+          .hasJumpBack = false};
+
+      // Offsets within the source and within the destination are tracked separately because
+      // rewriting an instruction to use an absolute address makes it longer. Displacements that
+      // refer to other relocated instructions are only valid if the offsets stay the same, so
+      // they cannot be combined with any such rewrite.
+      int numSourceBytesProcessed = 0;
+      int numDestinationBytesWritten = 0;
+      int numTailBytesUsed = 0;
+      bool hasInternalMemoryReference = false;
+      bool hasRewrittenMemoryReference = false;
+
+      for (int i = 0; i < numInstructions; ++i)
+      {
+        void* const nextDestinationAddressToWrite = &dstBytes[numDestinationBytesWritten];
+        const void* absoluteAddressSlot = nullptr;
+
+        // First, handle any position-dependent memory references.
+        if (instructions[i].HasPositionDependentMemoryReference())
+        {
+          const int64_t originalDisplacement = instructions[i].GetMemoryDisplacement();
+          if (true == debugOutputLive)
+            MappedLog::OutputFormatted(
+                Infra::Message::ESeverity::Debug,
+                L"Instruction %d - Has a position-dependent memory reference with displacement 0x%llx.",
+                i,
+                (long long)originalDisplacement);
+
+          // If the displacement is so small that it refers to another instruction that is also
+          // being relocated, then there is no need to modify it. Note the need to check both
+          // forwards (positive) and backwards (negative) displacement directions.
+          const int64_t minForwardDisplacementNeedingModification = static_cast<int64_t>(
+              numSourceBytes - (numSourceBytesProcessed + instructions[i].GetLengthBytes()));
+          const int64_t minBackwardDisplacementNotNeedingModification = static_cast<int64_t>(
+              -1 * (numSourceBytesProcessed + instructions[i].GetLengthBytes()));
+
+          if (originalDisplacement >= minForwardDisplacementNeedingModification ||
+              originalDisplacement < minBackwardDisplacementNotNeedingModification)
+          {
+            // There are no changes to the length of the instruction, so the change to the
+            // displacement value is just the difference in its new and original locations.
+            const intptr_t newDisplacementValue =
+                (reinterpret_cast<intptr_t>(instructions[i].GetAddress()) -
+                 reinterpret_cast<intptr_t>(nextDestinationAddressToWrite)) +
+                static_cast<intptr_t>(originalDisplacement);
+            if (true == debugOutputLive)
+              MappedLog::OutputFormatted(
+                  Infra::Message::ESeverity::Debug,
+                  L"Instruction %d - Relocating from 0x%llx to 0x%llx, absolute target is 0x%llx, new displacement is 0x%llx.",
+                  i,
+                  reinterpret_cast<long long>(instructions[i].GetAddress()),
+                  reinterpret_cast<long long>(nextDestinationAddressToWrite),
+                  reinterpret_cast<long long>(instructions[i].GetAbsoluteMemoryReferenceTarget()),
+                  static_cast<long long>(newDisplacementValue));
+
+            // Try to replace the displacement in the original instruction. If this fails, perhaps
+            // using a 32-bit unconditional jump as an assist will help, especially if the original
+            // instruction uses an 8-bit or 16-bit relative displacement. However, an assist like
+            // this is only possible if the original instruction has a relative branch
+            // displacement, not a position-relative data access displacement. Note that the latter
+            // case, RIP-relative addressing, is only supported in 64-bit mode.
+            if (false ==
+                instructions[i].SetMemoryDisplacement(static_cast<int64_t>(newDisplacementValue)))
+            {
+              if ((true == instructions[i].HasRelativeBranchDisplacement()) &&
+                  ((numTailBytesUsed + X86Instruction::kJumpInstructionLengthBytes) <=
+                   (dstCapacity - numDestinationBytesWritten)))
+              {
+                // The way a jump assist works is by allocating space at the end of the
+                // destination for an unconditional jump instruction that targets the same address
+                // targetted by the original instruction. Variable numTailBytesUsed stores the
+                // number of such bytes already allocated at the end of the destination. Then,
+                // replace the displacement in the original instruction with a displacement value
+                // that takes it to the jump assist instruction. This solution works for any
+                // instruction that uses rel8 and rel16 branch displacements (such as loop, xbegin,
+                // etc.), not just conditional and unconditional jumps.
+
+                numTailBytesUsed += X86Instruction::kJumpInstructionLengthBytes;
+                relocated->numJumpAssists += 1;
+
+                void* const jumpAssistAddress = &dstBytes[dstCapacity - numTailBytesUsed];
+                void* const jumpAssistTargetAddress =
+                    instructions[i].GetAbsoluteMemoryReferenceTarget();
+                const intptr_t displacementValueToJumpAssist =
+                    reinterpret_cast<intptr_t>(jumpAssistAddress) -
+                    (reinterpret_cast<intptr_t>(nextDestinationAddressToWrite) +
+                     static_cast<intptr_t>(instructions[i].GetLengthBytes()));
+
+                if (true == debugOutputLive)
+                  MappedLog::OutputFormatted(
+                      Infra::Message::ESeverity::Debug,
+                      L"Instruction %d - Failed to set new displacement, but will attempt to use a jump assist (from=0x%llx, to=0x%llx, disp=0x%llx, target=0x%llx) instead.",
+                      i,
+                      reinterpret_cast<long long>(nextDestinationAddressToWrite),
+                      reinterpret_cast<long long>(jumpAssistAddress),
+                      static_cast<long long>(displacementValueToJumpAssist),
+                      reinterpret_cast<long long>(jumpAssistTargetAddress));
+
+                if (false ==
+                    instructions[i].SetMemoryDisplacement(
+                        static_cast<int64_t>(displacementValueToJumpAssist)))
+                {
+                  if (true == debugOutputLive)
+                    MappedLog::OutputFormatted(
+                        Infra::Message::ESeverity::Debug,
+                        L"Instruction %d - Jump assist failed, unable to set original instruction displacement.",
+                        i);
+                  return false;
+                }
+
+                if (false ==
+                    X86Instruction::WriteJumpInstruction(
+                        jumpAssistAddress,
+                        X86Instruction::kJumpInstructionLengthBytes,
+                        jumpAssistTargetAddress))
+                {
+                  if (true == debugOutputLive)
+                    MappedLog::OutputFormatted(
+                        Infra::Message::ESeverity::Debug,
+                        L"Instruction %d - Jump assist failed, unable write jump assist instruction.",
+                        i);
+                  return false;
+                }
+
+                if (true == debugOutputLive)
+                  MappedLog::OutputFormatted(
+                      Infra::Message::ESeverity::Debug,
+                      L"Instruction %d - Jump assist succeeded, encoded %d extra bytes at 0x%llx.",
+                      i,
+                      X86Instruction::kJumpInstructionLengthBytes,
+                      (long long)jumpAssistAddress);
+              }
+              else
+              {
+#ifdef _WIN64
+                // A RIP-relative data access whose target is out of range can instead be rewritten
+                // to load the absolute address of its target into its own destination register
+                // and access memory through that register. The absolute address is held in a slot
+                // allocated at the end of the destination, just like a jump assist.
+                if ((true == canRewriteMemoryReferences) &&
+                    (false == instructions[i].HasRelativeBranchDisplacement()) &&
+                    (false == hasInternalMemoryReference) &&
+                    ((numTailBytesUsed + static_cast<int>(sizeof(uint64_t))) <=
+                     (dstCapacity - numDestinationBytesWritten)))
+                {
+                  numTailBytesUsed += static_cast<int>(sizeof(uint64_t));
+                  relocated->numRewrittenMemoryReferences += 1;
+
+                  void* const absoluteAddressSlotToWrite =
+                      &dstBytes[dstCapacity - numTailBytesUsed];
+                  const uint64_t absoluteTargetAddress = reinterpret_cast<uint64_t>(
+                      instructions[i].GetAbsoluteMemoryReferenceTarget());
+                  std::memcpy(
+                      absoluteAddressSlotToWrite,
+                      &absoluteTargetAddress,
+                      sizeof(absoluteTargetAddress));
+
+                  absoluteAddressSlot = absoluteAddressSlotToWrite;
+                  hasRewrittenMemoryReference = true;
+
+                  if (true == debugOutputLive)
+                    MappedLog::OutputFormatted(
+                        Infra::Message::ESeverity::Debug,
+                        L"Instruction %d - Failed to set new displacement, so rewriting it to use absolute address 0x%llx stored at 0x%llx.",
+                        i,
+                        static_cast<long long>(absoluteTargetAddress),
+                        reinterpret_cast<long long>(absoluteAddressSlot));
+                }
+                else
+#endif
+                {
+                  if (true == debugOutputLive)
+                    MappedLog::OutputFormatted(
+                        Infra::Message::ESeverity::Debug,
+                        L"Instruction %d - Failed to set new displacement, and cannot use a jump assist.",
+                        i);
+                  return false;
+                }
+              }
+            }
+          }
+          else
+          {
+            if (true == hasRewrittenMemoryReference)
+            {
+              if (true == debugOutputLive)
+                MappedLog::OutputFormatted(
+                    Infra::Message::ESeverity::Debug,
+                    L"Instruction %d - Displacement refers to another relocated instruction, but an earlier instruction was rewritten.",
+                    i);
+              return false;
+            }
+
+            hasInternalMemoryReference = true;
+
+            if (true == debugOutputLive)
+              MappedLog::OutputFormatted(
+                  Infra::Message::ESeverity::Debug,
+                  L"Instruction %d - Displacement is short enough, no modification required.",
+                  i);
+          }
+        }
+
+        // Second, re-encode the instruction, unless it has no position-dependent memory reference,
+        // in which case its original bytes can just be copied. Re-encoding preserves instruction
+        // lengths, but rewriting an instruction to use an absolute address does not.
+        const int numDestinationBytesLeft =
+            dstCapacity - numDestinationBytesWritten - numTailBytesUsed;
+        int numEncodedBytes = 0;
+        if (false == instructions[i].HasPositionDependentMemoryReference())
+        {
+          const int instructionLengthBytes = instructions[i].GetLengthBytes();
+          if (instructionLengthBytes <= numDestinationBytesLeft)
+          {
+            std::memcpy(
+                nextDestinationAddressToWrite,
+                &sourceBytes[numSourceBytesProcessed],
+                instructionLengthBytes);
+            numEncodedBytes = instructionLengthBytes;
+          }
+        }
+#ifdef _WIN64
+        else if (nullptr != absoluteAddressSlot)
+        {
+          numEncodedBytes = instructions[i].EncodeWithAbsoluteMemoryReference(
+              nextDestinationAddressToWrite, numDestinationBytesLeft, absoluteAddressSlot);
+        }
+#endif
+        else
+        {
+          numEncodedBytes = instructions[i].EncodeInstruction(
+              nextDestinationAddressToWrite, numDestinationBytesLeft);
+        }
+
+        if (0 == numEncodedBytes)
+        {
+          if (true == debugOutputLive)
+            MappedLog::OutputFormatted(
+                Infra::Message::ESeverity::Debug,
+                L"Instruction %d - Failed to encode at 0x%llx.",
+                i,
+                (long long)nextDestinationAddressToWrite);
+          return false;
+        }
+
+        if (true == debugOutputLive)
+          MappedLog::OutputFormatted(
+              Infra::Message::ESeverity::Debug,
+              L"Instruction %d - Encoded %d byte(s) at 0x%llx.",
+              i,
+              numEncodedBytes,
+              (long long)nextDestinationAddressToWrite);
+        numSourceBytesProcessed += instructions[i].GetLengthBytes();
+        numDestinationBytesWritten += numEncodedBytes;
+      }
+
+      // If the last relocated instruction is terminal, then execution never falls through past
+      // it, so there is no need to jump back to the source. Otherwise, there are more instructions
+      // left at the source, so make sure to jump to them after executing the relocated ones.
+      if ((false == instructions[numInstructions - 1].IsTerminal()) &&
+          (0 == (options & kRelocateCodeOptionNoJumpBack)))
+      {
+        const uint8_t* const nextSourceInstruction =
+            &reinterpret_cast<const uint8_t*>(instructions[0].GetAddress())[numSourceBytes];
+        const int numDestinationBytesLeft =
+            dstCapacity - numDestinationBytesWritten - numTailBytesUsed;
+        if (true == debugOutputLive)
+          MappedLog::OutputFormatted(
+              Infra::Message::ESeverity::Debug,
+              L"Final encoded instruction is non-terminal, so adding a jump to 0x%llx with %d byte(s) free at the destination.",
+              (long long)nextSourceInstruction,
+              numDestinationBytesLeft);
+
+        if (false ==
+            X86Instruction::WriteJumpInstruction(
+                &dstBytes[numDestinationBytesWritten],
+                numDestinationBytesLeft,
+                nextSourceInstruction))
+        {
+          if (true == debugOutputLive)
+            MappedLog::OutputFormatted(
+                Infra::Message::ESeverity::Debug, L"Failed to write terminal jump instruction.");
+          return false;
+        }
+
+        numDestinationBytesWritten += X86Instruction::kJumpInstructionLengthBytes;
+        relocated->hasJumpBack = true;
+      }
+
+      relocated->numCodeBytes = static_cast<size_t>(numDestinationBytesWritten);
+      relocated->numTailBytes = static_cast<size_t>(numTailBytesUsed);
+      return true;
+    }
+
+    EResult RelocateCode(
+        const void* src,
+        size_t minBytes,
+        void* dst,
+        size_t dstCapacity,
+        uint32_t options,
+        SRelocatedCode* relocated)
+    {
+      const int dstCapacityBytes =
+          ((dstCapacity > static_cast<size_t>(INT_MAX)) ? INT_MAX
+                                                        : static_cast<int>(dstCapacity));
+
+      // Relocated instructions are never shorter than the originals, so the destination has to be
+      // at least as large as the requested amount of source code.
+      if ((nullptr == src) || (nullptr == dst) || (0 == minBytes) ||
+          (minBytes > static_cast<size_t>(dstCapacityBytes)))
+        return EResult::FailInvalidArgument;
+
+      const bool continuePastTerminal =
+          (0 != (options & kRelocateCodeOptionContinuePastTerminal));
+      const uint8_t* const srcBytes = reinterpret_cast<const uint8_t*>(src);
+
+      std::vector<X86Instruction> instructions;
+      instructions.reserve(1 + (minBytes / 2));
+
+      size_t numSourceBytes = 0;
+      while (numSourceBytes < minBytes)
+      {
+        X86Instruction& instruction = instructions.emplace_back();
+        if (false == instruction.DecodeInstruction(&srcBytes[numSourceBytes]))
+        {
+          if (true == MappedLog::IsDebugOutputLive())
+            MappedLog::OutputFormatted(
+                Infra::Message::ESeverity::Debug,
+                L"Unable to relocate code at 0x%llx because the instruction at offset %llu is invalid.",
+                (long long)src,
+                (unsigned long long)numSourceBytes);
+          return EResult::FailInvalidArgument;
+        }
+
+        numSourceBytes += static_cast<size_t>(instruction.GetLengthBytes());
+        if ((true == instruction.IsTerminal()) && (false == continuePastTerminal)) break;
+      }
+
+      if (false ==
+          RelocateInstructions(
+              instructions.data(),
+              static_cast<int>(instructions.size()),
+              srcBytes,
+              dst,
+              dstCapacityBytes,
+              options,
+              relocated))
+      {
+        if (true == MappedLog::IsDebugOutputLive())
+          MappedLog::OutputFormatted(
+              Infra::Message::ESeverity::Debug,
+              L"Unable to relocate %llu byte(s) of code from 0x%llx to 0x%llx.",
+              (unsigned long long)numSourceBytes,
+              (long long)src,
+              (long long)dst);
+        return EResult::FailCannotSetHook;
+      }
+
+      // Jump assists and absolute address slots are written at the very end of the destination,
+      // so if there are any then the whole destination is in use.
+      TrampolineStore::FlushInstructionCache(
+          dst,
+          ((0 == relocated->numTailBytes) ? relocated->numCodeBytes
+                                          : static_cast<size_t>(dstCapacityBytes)));
+      return EResult::Success;
+    }
+  } // namespace CodeRelocation
+} // namespace Hookshot
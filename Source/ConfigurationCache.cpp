@@ -0,0 +1,539 @@
+/***************************************************************************************************
+ * Hookshot
+ *   General-purpose library for injecting DLLs and hooking function calls.
+ ***************************************************************************************************
+ * Authored by Samuel Grossman
+ * Copyright (c) 2019-2025
+ ***********************************************************************************************//**
+ * @file ConfigurationCache.cpp
+ *   Implementation of the precompiled binary snapshot of the configuration file.
+ **************************************************************************************************/
+
+#include "ConfigurationCache.h"
+
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <cwctype>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include <Infra/Core/Configuration.h>
+#include <Infra/Core/ProcessInfo.h>
+#include <Infra/Core/Strings.h>
+#include <Infra/Core/TemporaryBuffer.h>
+
+#include "ApiWindows.h"
+#include "Strings.h"
+
+namespace Hookshot
+{
+  namespace ConfigurationCache
+  {
+    /// Signature that identifies a configuration cache file. Spells "HSCC" in a hex dump.
+    static constexpr uint32_t kConfigurationCacheSignature = 0x43435348;
+
+    /// Version of the configuration cache file format. Must be incremented whenever the format or
+    /// the set of configuration settings Hookshot understands changes.
+    static constexpr uint32_t kConfigurationCacheVersion = 3;
+
+    /// File extension for a configuration cache file.
+    static constexpr std::wstring_view kStrConfigurationCacheFileExtension = L".ConfigCache";
+
+    /// Alignment, in bytes, of each entry within a configuration cache file.
+    static constexpr size_t kConfigurationCacheEntryAlignment = 8;
+
+    /// Header at the very beginning of a configuration cache file.
+    struct SConfigurationCacheFileHeader
+    {
+      /// Must be equal to #kConfigurationCacheSignature.
+      uint32_t signature;
+
+      /// Must be equal to #kConfigurationCacheVersion.
+      uint32_t version;
+
+      /// Size, in bytes, of the configuration file from which the cache was generated.
+      uint64_t configurationFileSize;
+
+      /// Last-modified time of the configuration file from which the cache was generated.
+      uint64_t configurationFileLastWriteTime;
+
+      /// Number of entries that follow the header.
+      uint32_t numEntries;
+
+      /// Unused, for alignment only.
+      uint32_t reserved;
+    };
+
+    /// Header for a single entry in a configuration cache file. Immediately followed by the
+    /// section name, setting name, and string value, if any, none of which are null-terminated.
+    /// The next entry begins at the next multiple of #kConfigurationCacheEntryAlignment.
+    struct SConfigurationCacheFileEntry
+    {
+      /// Value of the integer or Boolean value.
+      int64_t integerValue;
+
+      /// Type of the value.
+      EConfigurationCacheValueType type;
+
+      /// Number of characters in the section name.
+      uint16_t sectionLength;
+
+      /// Number of characters in the setting name.
+      uint16_t nameLength;
+
+      /// Unused, for alignment only.
+      uint16_t reserved;
+
+      /// Number of characters in the string value.
+      uint32_t stringValueLength;
+
+      /// Unused, for alignment only.
+      uint32_t reserved2;
+    };
+
+    static_assert(
+        0 == (sizeof(SConfigurationCacheFileHeader) % kConfigurationCacheEntryAlignment),
+        "Configuration cache file header size must preserve entry alignment.");
+    static_assert(
+        0 == (sizeof(SConfigurationCacheFileEntry) % kConfigurationCacheEntryAlignment),
+        "Configuration cache file entry header size must preserve entry alignment.");
+
+    /// Rounds an offset within a configuration cache file up to the next entry boundary.
+    /// @param [in] offset Offset to round.
+    /// @return Rounded offset.
+    static inline size_t AlignToEntryBoundary(size_t offset)
+    {
+      return (offset + (kConfigurationCacheEntryAlignment - 1)) &
+          ~(kConfigurationCacheEntryAlignment - 1);
+    }
+
+    /// Identifies the version of the configuration file that is currently present.
+    struct SConfigurationFileVersion
+    {
+      /// Size of the file, in bytes.
+      uint64_t size;
+
+      /// Last-modified time of the file.
+      uint64_t lastWriteTime;
+    };
+
+    /// Retrieves the size and last-modified time of the configuration file.
+    /// @param [out] version Filled with the version information, if the operation succeeds.
+    /// @return `true` if the configuration file exists and its information was retrieved, `false`
+    /// otherwise.
+    static bool GetConfigurationFileVersion(SConfigurationFileVersion* version)
+    {
+      WIN32_FILE_ATTRIBUTE_DATA fileAttributes{};
+      if (FALSE ==
+          GetFileAttributesEx(
+              Strings::GetHookshotConfigurationFilename().data(),
+              GetFileExInfoStandard,
+              &fileAttributes))
+        return false;
+
+      *version = {
+          .size = (static_cast<uint64_t>(fileAttributes.nFileSizeHigh) << 32) |
+              static_cast<uint64_t>(fileAttributes.nFileSizeLow),
+          .lastWriteTime = (static_cast<uint64_t>(fileAttributes.ftLastWriteTime.dwHighDateTime)
+                            << 32) |
+              static_cast<uint64_t>(fileAttributes.ftLastWriteTime.dwLowDateTime)};
+      return true;
+    }
+
+    /// Computes a hash of the configuration file's path, which is used to name configuration
+    /// snapshots so that different Hookshot installations do not share them.
+    /// @return 64-bit FNV-1a hash of the case-folded configuration file path.
+    static uint64_t GetConfigurationFilenameHash(void)
+    {
+      static const uint64_t configurationFilenameHash = []() -> uint64_t
+      {
+        uint64_t hash = 14695981039346656037ull;
+        for (wchar_t c : Strings::GetHookshotConfigurationFilename())
+        {
+          hash ^= static_cast<uint64_t>(std::towlower(c));
+          hash *= 1099511628211ull;
+        }
+        return hash;
+      }();
+
+      return configurationFilenameHash;
+    }
+
+    /// Determines the name of the configuration cache file. It is placed in the temporary
+    /// directory, because the configuration file's own directory might not be writable.
+    /// @return Configuration cache file name.
+    static std::wstring_view GetConfigurationCacheFilename(void)
+    {
+      static const std::wstring configurationCacheFilename = []() -> std::wstring
+      {
+        Infra::TemporaryString temporaryDirectory;
+        temporaryDirectory.UnsafeSetSize(
+            GetTempPath(temporaryDirectory.Capacity(), temporaryDirectory.Data()));
+        if (true == temporaryDirectory.Empty()) return std::wstring();
+
+        Infra::TemporaryString filename;
+        filename << temporaryDirectory.AsStringView() << Infra::ProcessInfo::GetProductName()
+                 << L"."
+                 << Infra::Strings::Format(L"%016llx", (long long)GetConfigurationFilenameHash())
+                        .AsStringView()
+                 << kStrConfigurationCacheFileExtension;
+        return std::wstring(filename.AsStringView());
+      }();
+
+      return configurationCacheFilename;
+    }
+
+    /// Inserts a single value into a configuration data object.
+    /// @param [in,out] configData Configuration data object.
+    /// @param [in] section Section name.
+    /// @param [in] name Setting name.
+    /// @param [in] fileEntry Cache file entry that holds the value.
+    /// @param [in] stringValue String value, if applicable.
+    /// @return `true` if the value was inserted, `false` if the entry is invalid.
+    static bool InsertConfigurationValue(
+        Infra::Configuration::ConfigurationData* configData,
+        std::wstring_view section,
+        std::wstring_view name,
+        const SConfigurationCacheFileEntry& fileEntry,
+        std::wstring_view stringValue)
+    {
+      switch (fileEntry.type)
+      {
+        case EConfigurationCacheValueType::Integer:
+          configData->Insert(
+              section,
+              name,
+              static_cast<Infra::Configuration::TIntegerValue>(fileEntry.integerValue));
+          return true;
+
+        case EConfigurationCacheValueType::Boolean:
+          configData->Insert(
+              section,
+              name,
+              static_cast<Infra::Configuration::TBooleanValue>(0 != fileEntry.integerValue));
+          return true;
+
+        case EConfigurationCacheValueType::String:
+          configData->Insert(
+              section, name, Infra::Configuration::TStringValue(stringValue));
+          return true;
+
+        default:
+          return false;
+      }
+    }
+
+    /// Parses the contents of a configuration cache file and fills a configuration data object.
+    /// @param [in] cacheData Contents of the configuration cache file.
+    /// @param [in] cacheSize Size of the configuration cache file, in bytes.
+    /// @param [in] configurationFileVersion Version of the configuration file currently present.
+    /// @param [out] configData Configuration data object to be filled.
+    /// @return `true` if the cache file is valid and matches the configuration file, `false`
+    /// otherwise.
+    static bool ParseConfigurationCache(
+        const uint8_t* cacheData,
+        size_t cacheSize,
+        const SConfigurationFileVersion& configurationFileVersion,
+        Infra::Configuration::ConfigurationData* configData)
+    {
+      if (cacheSize < sizeof(SConfigurationCacheFileHeader)) return false;
+
+      const SConfigurationCacheFileHeader* const fileHeader =
+          reinterpret_cast<const SConfigurationCacheFileHeader*>(cacheData);
+      if ((kConfigurationCacheSignature != fileHeader->signature) ||
+          (kConfigurationCacheVersion != fileHeader->version) ||
+          (configurationFileVersion.size != fileHeader->configurationFileSize) ||
+          (configurationFileVersion.lastWriteTime != fileHeader->configurationFileLastWriteTime))
+        return false;
+
+      Infra::Configuration::ConfigurationData parsedConfigData;
+      size_t offset = sizeof(SConfigurationCacheFileHeader);
+
+      for (uint32_t i = 0; i < fileHeader->numEntries; ++i)
+      {
+        if ((cacheSize - offset) < sizeof(SConfigurationCacheFileEntry)) return false;
+
+        const SConfigurationCacheFileEntry* const fileEntry =
+            reinterpret_cast<const SConfigurationCacheFileEntry*>(&cacheData[offset]);
+        offset += sizeof(SConfigurationCacheFileEntry);
+
+        const size_t numStringBytes = sizeof(wchar_t) *
+            (static_cast<size_t>(fileEntry->sectionLength) +
+             static_cast<size_t>(fileEntry->nameLength) +
+             static_cast<size_t>(fileEntry->stringValueLength));
+        if ((cacheSize - offset) < numStringBytes) return false;
+
+        const wchar_t* const strings = reinterpret_cast<const wchar_t*>(&cacheData[offset]);
+        const std::wstring_view section(strings, fileEntry->sectionLength);
+        const std::wstring_view name(&strings[fileEntry->sectionLength], fileEntry->nameLength);
+        const std::wstring_view stringValue(
+            &strings[fileEntry->sectionLength + fileEntry->nameLength],
+            fileEntry->stringValueLength);
+
+        offset = AlignToEntryBoundary(offset + numStringBytes);
+        if (offset > cacheSize) return false;
+
+        // The cache holds every executable-specific section, but only the one for the
+        // currently-running executable is visible, just as if the configuration file were read.
+        if ((Infra::Configuration::kSectionNameGlobal != section) &&
+            (false ==
+             Infra::Strings::EqualsCaseInsensitive(
+                 section, Infra::ProcessInfo::GetExecutableBaseName())))
+          continue;
+
+        if (false ==
+            InsertConfigurationValue(&parsedConfigData, section, name, *fileEntry, stringValue))
+          return false;
+      }
+
+      *configData = std::move(parsedConfigData);
+      return true;
+    }
+
+    /// Determines the name of the shared memory section through which processes share an
+    /// in-memory configuration snapshot. The name identifies both the configuration file and its
+    /// version, so a section that exists can only hold a snapshot of the current configuration.
+    /// @param [in] configurationFileVersion Version of the configuration file currently present.
+    /// @return Shared memory section name.
+    static Infra::TemporaryString GetConfigurationSnapshotSectionName(
+        const SConfigurationFileVersion& configurationFileVersion)
+    {
+      Infra::TemporaryString sectionName;
+      sectionName << L"Local\\" << Infra::ProcessInfo::GetProductName()
+                  << Infra::Strings::Format(
+                         L".ConfigSnapshot.%016llx.%llx.%llx",
+                         (long long)GetConfigurationFilenameHash(),
+                         (long long)configurationFileVersion.size,
+                         (long long)configurationFileVersion.lastWriteTime)
+                         .AsStringView();
+      return sectionName;
+    }
+
+    /// Handle to the shared memory section that holds the configuration snapshot in use by this
+    /// process. Deliberately held open for the lifetime of the process, so that child processes,
+    /// which are typically started while their parents are still running, can find it.
+    static HANDLE configurationSnapshotSection = nullptr;
+
+    /// Attempts to load configuration data from a shared memory section published by another
+    /// process, typically the parent of this process, that has already read the configuration.
+    /// @param [in] configurationFileVersion Version of the configuration file currently present.
+    /// @param [out] configData Configuration data object to be filled.
+    /// @return `true` if configuration data was loaded, `false` otherwise.
+    static bool ReadConfigurationSnapshotSection(
+        const SConfigurationFileVersion& configurationFileVersion,
+        Infra::Configuration::ConfigurationData* configData)
+    {
+      const HANDLE section = OpenFileMapping(
+          FILE_MAP_READ,
+          FALSE,
+          GetConfigurationSnapshotSectionName(configurationFileVersion).AsCString());
+      if (nullptr == section) return false;
+
+      bool snapshotIsValid = false;
+
+      const void* const snapshotData = MapViewOfFile(section, FILE_MAP_READ, 0, 0, 0);
+      if (nullptr != snapshotData)
+      {
+        MEMORY_BASIC_INFORMATION snapshotMemoryInfo{};
+        if (0 != VirtualQuery(snapshotData, &snapshotMemoryInfo, sizeof(snapshotMemoryInfo)))
+          snapshotIsValid = ParseConfigurationCache(
+              reinterpret_cast<const uint8_t*>(snapshotData),
+              static_cast<size_t>(snapshotMemoryInfo.RegionSize),
+              configurationFileVersion,
+              configData);
+
+        UnmapViewOfFile(snapshotData);
+      }
+
+      if ((true == snapshotIsValid) && (nullptr == configurationSnapshotSection))
+        configurationSnapshotSection = section;
+      else
+        CloseHandle(section);
+
+      return snapshotIsValid;
+    }
+
+    /// Publishes a configuration snapshot in a shared memory section so that other processes, and
+    /// in particular child processes, can use it without reading any files. Failures are silently
+    /// ignored.
+    /// @param [in] snapshotData Contents of the configuration snapshot.
+    /// @param [in] snapshotSize Size of the configuration snapshot, in bytes.
+    /// @param [in] configurationFileVersion Version of the configuration file currently present.
+    static void PublishConfigurationSnapshotSection(
+        const uint8_t* snapshotData,
+        size_t snapshotSize,
+        const SConfigurationFileVersion& configurationFileVersion)
+    {
+      if (nullptr != configurationSnapshotSection) return;
+
+      const HANDLE section = CreateFileMapping(
+          INVALID_HANDLE_VALUE,
+          nullptr,
+          PAGE_READWRITE,
+          static_cast<DWORD>(static_cast<uint64_t>(snapshotSize) >> 32),
+          static_cast<DWORD>(snapshotSize),
+          GetConfigurationSnapshotSectionName(configurationFileVersion).AsCString());
+      if (nullptr == section) return;
+
+      // If some other process already published a snapshot of the same configuration, there is no
+      // need to write it again, but holding it open still keeps it available for child processes.
+      if (ERROR_ALREADY_EXISTS != GetLastError())
+      {
+        void* const sectionData = MapViewOfFile(section, FILE_MAP_WRITE, 0, 0, 0);
+        if (nullptr == sectionData)
+        {
+          CloseHandle(section);
+          return;
+        }
+
+        memcpy(sectionData, snapshotData, snapshotSize);
+        UnmapViewOfFile(sectionData);
+      }
+
+      configurationSnapshotSection = section;
+    }
+
+    bool ReadConfigurationCache(Infra::Configuration::ConfigurationData* configData)
+    {
+      SConfigurationFileVersion configurationFileVersion;
+      if (false == GetConfigurationFileVersion(&configurationFileVersion)) return false;
+
+      if (true == ReadConfigurationSnapshotSection(configurationFileVersion, configData))
+        return true;
+
+      const std::wstring_view cacheFilename = GetConfigurationCacheFilename();
+      if (true == cacheFilename.empty()) return false;
+
+      const HANDLE cacheFile = CreateFile(
+          cacheFilename.data(),
+          GENERIC_READ,
+          FILE_SHARE_READ | FILE_SHARE_DELETE,
+          nullptr,
+          OPEN_EXISTING,
+          FILE_ATTRIBUTE_NORMAL,
+          nullptr);
+      if (INVALID_HANDLE_VALUE == cacheFile) return false;
+
+      bool cacheIsValid = false;
+
+      LARGE_INTEGER cacheSize{};
+      if ((FALSE != GetFileSizeEx(cacheFile, &cacheSize)) && (cacheSize.QuadPart > 0))
+      {
+        const HANDLE cacheMapping =
+            CreateFileMapping(cacheFile, nullptr, PAGE_READONLY, 0, 0, nullptr);
+        if (nullptr != cacheMapping)
+        {
+          const void* const cacheData = MapViewOfFile(cacheMapping, FILE_MAP_READ, 0, 0, 0);
+          if (nullptr != cacheData)
+          {
+            cacheIsValid = ParseConfigurationCache(
+                reinterpret_cast<const uint8_t*>(cacheData),
+                static_cast<size_t>(cacheSize.QuadPart),
+                configurationFileVersion,
+                configData);
+
+            if (true == cacheIsValid)
+              PublishConfigurationSnapshotSection(
+                  reinterpret_cast<const uint8_t*>(cacheData),
+                  static_cast<size_t>(cacheSize.QuadPart),
+                  configurationFileVersion);
+
+            UnmapViewOfFile(cacheData);
+          }
+
+          CloseHandle(cacheMapping);
+        }
+      }
+
+      CloseHandle(cacheFile);
+      return cacheIsValid;
+    }
+
+    void WriteConfigurationCache(const std::vector<SConfigurationCacheEntry>& entries)
+    {
+      SConfigurationFileVersion configurationFileVersion;
+      if (false == GetConfigurationFileVersion(&configurationFileVersion)) return;
+
+      const std::wstring_view cacheFilename = GetConfigurationCacheFilename();
+      if (true == cacheFilename.empty()) return;
+
+      std::vector<uint8_t> cacheData(sizeof(SConfigurationCacheFileHeader), 0);
+      *reinterpret_cast<SConfigurationCacheFileHeader*>(cacheData.data()) = {
+          .signature = kConfigurationCacheSignature,
+          .version = kConfigurationCacheVersion,
+          .configurationFileSize = configurationFileVersion.size,
+          .configurationFileLastWriteTime = configurationFileVersion.lastWriteTime,
+          .numEntries = static_cast<uint32_t>(entries.size()),
+          .reserved = 0};
+
+      for (const auto& entry : entries)
+      {
+        if ((entry.section.length() > UINT16_MAX) || (entry.name.length() > UINT16_MAX) ||
+            (entry.stringValue.length() > UINT32_MAX))
+          return;
+
+        const SConfigurationCacheFileEntry fileEntry = {
+            .integerValue = entry.integerValue,
+            .type = entry.type,
+            .sectionLength = static_cast<uint16_t>(entry.section.length()),
+            .nameLength = static_cast<uint16_t>(entry.name.length()),
+            .reserved = 0,
+            .stringValueLength = static_cast<uint32_t>(entry.stringValue.length()),
+            .reserved2 = 0};
+
+        const uint8_t* const fileEntryBytes = reinterpret_cast<const uint8_t*>(&fileEntry);
+        cacheData.insert(cacheData.end(), fileEntryBytes, &fileEntryBytes[sizeof(fileEntry)]);
+
+        for (const std::wstring* string : {&entry.section, &entry.name, &entry.stringValue})
+        {
+          const uint8_t* const stringBytes = reinterpret_cast<const uint8_t*>(string->data());
+          cacheData.insert(
+              cacheData.end(), stringBytes, &stringBytes[sizeof(wchar_t) * string->length()]);
+        }
+
+        cacheData.resize(AlignToEntryBoundary(cacheData.size()), 0);
+      }
+
+      PublishConfigurationSnapshotSection(
+          cacheData.data(), cacheData.size(), configurationFileVersion);
+
+      // Multiple processes might try to generate the cache at the same time, so each one writes to
+      // its own temporary file and then atomically replaces whatever cache file is present.
+      Infra::TemporaryString temporaryCacheFilename;
+      temporaryCacheFilename << cacheFilename << L"."
+                             << Infra::Strings::Format(L"%u", GetCurrentProcessId()).AsStringView();
+
+      const HANDLE cacheFile = CreateFile(
+          temporaryCacheFilename.AsCString(),
+          GENERIC_WRITE,
+          0,
+          nullptr,
+          CREATE_ALWAYS,
+          FILE_ATTRIBUTE_TEMPORARY,
+          nullptr);
+      if (INVALID_HANDLE_VALUE == cacheFile) return;
+
+      DWORD numBytesWritten = 0;
+      const bool writeSucceeded =
+          ((FALSE !=
+            WriteFile(
+                cacheFile,
+                cacheData.data(),
+                static_cast<DWORD>(cacheData.size()),
+                &numBytesWritten,
+                nullptr)) &&
+           (static_cast<DWORD>(cacheData.size()) == numBytesWritten));
+      CloseHandle(cacheFile);
+
+      if ((false == writeSucceeded) ||
+          (FALSE ==
+           MoveFileEx(
+               temporaryCacheFilename.AsCString(),
+               cacheFilename.data(),
+               MOVEFILE_REPLACE_EXISTING)))
+        DeleteFile(temporaryCacheFilename.AsCString());
+    }
+  } // namespace ConfigurationCache
+} // namespace Hookshot
@@ -0,0 +1,201 @@
+/***************************************************************************************************
+ * Hookshot
+ *   General-purpose library for injecting DLLs and hooking function calls.
+ ***************************************************************************************************
+ * Authored by Samuel Grossman
+ * Copyright (c) 2019-2025
+ ***********************************************************************************************//**
+ * @file ConfigurationReloader.cpp
+ *   Implementation of reloading runtime-tunable settings whenever the configuration file changes,
+ *   without restarting the process.
+ **************************************************************************************************/
+
+#include "ConfigurationReloader.h"
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <string>
+
+#include <Infra/Core/Configuration.h>
+#include <Infra/Core/Message.h>
+#include <Infra/Core/ProcessInfo.h>
+#include <Infra/Core/Strings.h>
+
+#include "ApiWindows.h"
+#include "DependencyProtect.h"
+#include "Globals.h"
+#include "HookStore.h"
+#include "HookshotConfigReader.h"
+#include "Strings.h"
+#include "TaskScheduler.h"
+
+namespace Hookshot
+{
+  namespace ConfigurationReloader
+  {
+    /// Time, in milliseconds, to wait after a change is detected before reading the configuration
+    /// file. Editors often write a file in several steps, so reading it immediately could see a
+    /// partially-written file.
+    static constexpr DWORD kChangeSettleTimeMilliseconds = 500;
+
+    /// Last-write time of the configuration file when it was most recently read. Only accessed by
+    /// reload tasks, which never overlap.
+    static FILETIME configurationFileLastWriteTime = {};
+
+    /// Retrieves the last-write time of the configuration file.
+    /// @param [out] lastWriteTime Filled with the last-write time on success.
+    /// @return `true` on success, `false` on failure.
+    static bool GetConfigurationFileLastWriteTime(FILETIME* lastWriteTime)
+    {
+      WIN32_FILE_ATTRIBUTE_DATA fileAttributes = {};
+      if (0 ==
+          Protected::Windows_GetFileAttributesEx(
+              Strings::GetHookshotConfigurationFilename().data(),
+              GetFileExInfoStandard,
+              &fileAttributes))
+        return false;
+
+      *lastWriteTime = fileAttributes.ftLastWriteTime;
+      return true;
+    }
+
+    /// Task that reads the configuration file again and applies any runtime-tunable settings that
+    /// changed. If the file contains errors, the current settings are kept.
+    /// @param [in] context Unused.
+    static void ReloadConfigurationTask(void* context)
+    {
+      // Other files in the same directory, such as the configuration cache, also trigger change
+      // notifications. Those changes are ignored.
+      FILETIME lastWriteTime = {};
+      if (false == GetConfigurationFileLastWriteTime(&lastWriteTime)) return;
+      if (0 == CompareFileTime(&lastWriteTime, &configurationFileLastWriteTime)) return;
+      configurationFileLastWriteTime = lastWriteTime;
+
+      HookshotConfigReader configReader;
+      const Infra::Configuration::ConfigurationData configData =
+          configReader.ReadConfigurationFile();
+      if (true == configReader.HasErrorMessages())
+      {
+        Infra::Message::Output(
+            Infra::Message::ESeverity::Warning,
+            L"Errors were encountered while reloading the configuration file. The current settings remain in effect.");
+        configReader.LogAllErrorMessages();
+        return;
+      }
+
+      const Globals::SRuntimeSettings& oldSettings = Globals::GetRuntimeSettings();
+      const Globals::SRuntimeSettings newSettings = Globals::ResolveRuntimeSettings(
+          configData, HookshotConfigReader::ReadPerformanceProfile(configData));
+      if (newSettings == oldSettings) return;
+
+      Globals::PublishRuntimeSettings(newSettings);
+
+      if (newSettings.logLevel != oldSettings.logLevel)
+        Globals::ApplyLogLevel(newSettings.logLevel);
+
+      // Hooks whose timing is not already sampled have no stub in which to change the interval, so
+      // turning sampling off leaves existing stubs unchanged and only affects new hooks.
+      size_t numSampledHooksChanged = 0;
+      if ((0 != newSettings.hookTimingSampleInterval) &&
+          (newSettings.hookTimingSampleInterval != oldSettings.hookTimingSampleInterval))
+        numSampledHooksChanged =
+            HookStore::SetHookTimingSampleIntervals(newSettings.hookTimingSampleInterval);
+
+      // Likewise, removing the sampled hook interval leaves existing sampled hooks at whatever
+      // interval they have, rather than going back to the intervals originally requested.
+      size_t numSampledHookIntervalsChanged = 0;
+      if ((0 != newSettings.sampledHookInterval) &&
+          (newSettings.sampledHookInterval != oldSettings.sampledHookInterval))
+        numSampledHookIntervalsChanged =
+            HookStore::SetSampledHookIntervals(newSettings.sampledHookInterval);
+
+      Infra::Message::OutputFormatted(
+          Infra::Message::ESeverity::Info,
+          L"Reloaded the configuration file: LogLevel=%lld, InstrumentHooks=%s, HookTimingSampleInterval=%u, SampledHookInterval=%u, HookLatencyBudgetMicroseconds=%u. Changed the sample interval of %zu existing hook(s) and %zu sampled hook(s).",
+          static_cast<long long>(newSettings.logLevel),
+          ((true == newSettings.instrumentHooks) ? L"yes" : L"no"),
+          newSettings.hookTimingSampleInterval,
+          newSettings.sampledHookInterval,
+          newSettings.hookLatencyBudgetMicroseconds,
+          numSampledHooksChanged,
+          numSampledHookIntervalsChanged);
+    }
+
+    /// Thread procedure that watches the directory containing the configuration file. Reloading is
+    /// handed to the task scheduler so that it runs alongside other background work rather than on
+    /// this thread, and it is awaited so that reloads never overlap.
+    /// @param [in] parameter Unused.
+    /// @return Exit code, which is always 0.
+    static DWORD WINAPI WatchThreadProc(LPVOID parameter)
+    {
+      const std::wstring directoryName(Infra::ProcessInfo::GetThisModuleDirectoryName());
+
+      const HANDLE changeNotification = Protected::Windows_FindFirstChangeNotification(
+          directoryName.c_str(),
+          FALSE,
+          FILE_NOTIFY_CHANGE_FILE_NAME | FILE_NOTIFY_CHANGE_LAST_WRITE);
+      if (INVALID_HANDLE_VALUE == changeNotification)
+      {
+        Infra::Message::OutputFormatted(
+            Infra::Message::ESeverity::Warning,
+            L"Failed to watch \"%s\" for configuration file changes: %s",
+            directoryName.c_str(),
+            Infra::Strings::FromSystemErrorCode(Protected::Windows_GetLastError()).AsCString());
+        return 0;
+      }
+
+      Infra::Message::OutputFormatted(
+          Infra::Message::ESeverity::Info,
+          L"Watching \"%s\" and reloading runtime-tunable settings whenever it changes.",
+          Strings::GetHookshotConfigurationFilename().data());
+
+      while (WAIT_OBJECT_0 == Protected::Windows_WaitForSingleObject(changeNotification, INFINITE))
+      {
+        Protected::Windows_Sleep(kChangeSettleTimeMilliseconds);
+
+        TaskScheduler::STaskGroup reloadTasks;
+        TaskScheduler::Submit(ReloadConfigurationTask, nullptr, &reloadTasks);
+        TaskScheduler::Wait(reloadTasks);
+
+        if (0 == Protected::Windows_FindNextChangeNotification(changeNotification)) break;
+      }
+
+      return 0;
+    }
+
+    bool IsEnabled(void)
+    {
+      static const bool watchConfigurationFileEnabled =
+          Globals::GetConfigurationData()
+              [Infra::Configuration::kSectionNameGlobal]
+              [Strings::kStrConfigurationSettingNameWatchConfigurationFile]
+                  .ValueOr(false);
+
+      return watchConfigurationFileEnabled;
+    }
+
+    void StartWatching(void)
+    {
+      if (false == IsEnabled()) return;
+
+      static std::atomic<bool> watchingStarted = false;
+      if (true == watchingStarted.exchange(true)) return;
+
+      // The settings in effect were read from the configuration file as it was at startup.
+      GetConfigurationFileLastWriteTime(&configurationFileLastWriteTime);
+
+      const HANDLE watchThread = TaskScheduler::CreateBackgroundThread(WatchThreadProc, nullptr);
+      if (nullptr == watchThread)
+      {
+        Infra::Message::OutputFormatted(
+            Infra::Message::ESeverity::Warning,
+            L"Failed to start watching for configuration file changes: %s",
+            Infra::Strings::FromSystemErrorCode(Protected::Windows_GetLastError()).AsCString());
+        return;
+      }
+
+      Protected::Windows_CloseHandle(watchThread);
+    }
+  } // namespace ConfigurationReloader
+} // namespace Hookshot
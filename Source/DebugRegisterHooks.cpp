@@ -0,0 +1,312 @@
+/***************************************************************************************************
+ * Hookshot
+ *   General-purpose library for injecting DLLs and hooking function calls.
+ ***************************************************************************************************
+ * Authored by Samuel Grossman
+ * Copyright (c) 2019-2025
+ ***********************************************************************************************//**
+ * @file DebugRegisterHooks.cpp
+ *   Implementation of hooks implemented using hardware execution breakpoints, which can hook
+ *   functions that are too short to be patched.
+ **************************************************************************************************/
+
+#include "DebugRegisterHooks.h"
+
+#include <atomic>
+#include <cstdint>
+#include <cstring>
+#include <mutex>
+#include <vector>
+
+#include <Infra/Core/Message.h>
+
+#include "ApiWindows.h"
+#include "DependencyProtect.h"
+#include "HookStore.h"
+#include "HookshotTypes.h"
+
+namespace Hookshot
+{
+  namespace DebugRegisterHooks
+  {
+    /// Resume flag in the processor flags register. Suppresses instruction breakpoints for the
+    /// next instruction executed, after which the processor clears it automatically.
+    static constexpr DWORD kResumeFlag = 0x00010000;
+
+    /// Encoding of the breakpoint instruction, `int3`, with which bypass stubs are filled.
+    static constexpr uint8_t kBreakpointInstruction = 0xcc;
+
+    /// Number of bytes occupied by each bypass stub.
+    static constexpr size_t kBypassStubSizeBytes = 16;
+
+    /// Original functions of all debug register hooks, indexed by debug address register, or
+    /// `nullptr` for unused debug address registers. Read by the exception handler without any
+    /// locks, so each one is set after and cleared before the corresponding hook function.
+    static std::atomic<void*> originalFunctions[kMaxDebugRegisterHooks];
+
+    /// Hook functions of all debug register hooks, indexed by debug address register.
+    static std::atomic<const void*> hookFunctions[kMaxDebugRegisterHooks];
+
+    /// Enforces serialized modification of debug register hooks.
+    static std::mutex debugRegisterHooksMutex;
+
+    /// Retrieves the address of the executable memory that holds the bypass stubs, one per debug
+    /// address register, allocating it if needed. Executing a bypass stub raises a breakpoint
+    /// exception, which the exception handler services by transferring control to the original
+    /// function with instruction breakpoints suppressed for its first instruction. This is how the
+    /// original function is invoked without triggering its own hook, given that none of its code
+    /// can be moved elsewhere.
+    /// @return Address of the bypass stubs, or `nullptr` if they could not be allocated.
+    static const uint8_t* GetBypassStubs(void)
+    {
+      static const uint8_t* const bypassStubs = []() -> const uint8_t*
+      {
+        constexpr size_t kBypassStubsSizeBytes = kBypassStubSizeBytes * kMaxDebugRegisterHooks;
+
+        uint8_t* const stubs = reinterpret_cast<uint8_t*>(Protected::Windows_VirtualAlloc(
+            nullptr, kBypassStubsSizeBytes, MEM_RESERVE | MEM_COMMIT, PAGE_READWRITE));
+        if (nullptr == stubs) return nullptr;
+
+        std::memset(stubs, kBreakpointInstruction, kBypassStubsSizeBytes);
+
+        DWORD unusedOriginalProtection = 0;
+        if (0 ==
+            Protected::Windows_VirtualProtect(
+                stubs, kBypassStubsSizeBytes, PAGE_EXECUTE_READ, &unusedOriginalProtection))
+          return nullptr;
+
+        return stubs;
+      }();
+
+      return bypassStubs;
+    }
+
+    /// Retrieves the address of the bypass stub for the specified debug address register.
+    /// @param [in] index Index of the debug address register.
+    /// @return Address of the bypass stub, or `nullptr` if bypass stubs are not available.
+    static inline const void* BypassStubFor(unsigned int index)
+    {
+      const uint8_t* const bypassStubs = GetBypassStubs();
+      if (nullptr == bypassStubs) return nullptr;
+
+      return &bypassStubs[index * kBypassStubSizeBytes];
+    }
+
+    /// Vectored exception handler that implements debug register hooks. Execution breakpoints on
+    /// original functions are redirected to the hook functions, and breakpoints in bypass stubs are
+    /// redirected to the original functions.
+    /// @param [in,out] exceptionInfo Information about the exception being handled.
+    /// @return Whether execution should continue or other handlers should be searched.
+    static LONG CALLBACK DebugRegisterExceptionHandler(EXCEPTION_POINTERS* exceptionInfo)
+    {
+      const EXCEPTION_RECORD* const exceptionRecord = exceptionInfo->ExceptionRecord;
+      CONTEXT* const context = exceptionInfo->ContextRecord;
+
+      if ((EXCEPTION_SINGLE_STEP != exceptionRecord->ExceptionCode) &&
+          (EXCEPTION_BREAKPOINT != exceptionRecord->ExceptionCode))
+        return EXCEPTION_CONTINUE_SEARCH;
+
+      for (unsigned int i = 0; i < kMaxDebugRegisterHooks; ++i)
+      {
+        void* const originalFunc = originalFunctions[i];
+        if (nullptr == originalFunc) continue;
+
+        const void* newInstructionPointer = nullptr;
+
+        if ((EXCEPTION_SINGLE_STEP == exceptionRecord->ExceptionCode) &&
+            (originalFunc == exceptionRecord->ExceptionAddress))
+        {
+          newInstructionPointer = hookFunctions[i];
+        }
+        else if (
+            (EXCEPTION_BREAKPOINT == exceptionRecord->ExceptionCode) &&
+            (BypassStubFor(i) == exceptionRecord->ExceptionAddress))
+        {
+          newInstructionPointer = originalFunc;
+          context->EFlags |= kResumeFlag;
+        }
+
+        if (nullptr == newInstructionPointer) continue;
+
+#ifdef _WIN64
+        context->Rip = reinterpret_cast<DWORD64>(newInstructionPointer);
+#else
+        context->Eip = reinterpret_cast<DWORD>(newInstructionPointer);
+#endif
+        return EXCEPTION_CONTINUE_EXECUTION;
+      }
+
+      return EXCEPTION_CONTINUE_SEARCH;
+    }
+
+    /// Registers the exception handler that implements debug register hooks. Only attempted once,
+    /// no matter how many times it is invoked.
+    /// @return `true` if the exception handler is registered, `false` otherwise.
+    static bool RegisterExceptionHandler(void)
+    {
+      static const bool isRegistered =
+          (nullptr !=
+           Protected::Windows_AddVectoredExceptionHandler(1, &DebugRegisterExceptionHandler));
+      return isRegistered;
+    }
+
+    /// Loads the debug registers of the specified thread to match the current set of debug
+    /// register hooks. Debug address registers without hooks are disabled.
+    /// @param [in] thread Handle to the thread, which must either be suspended or be the calling
+    /// thread.
+    /// @return `true` on success, `false` on failure.
+    static bool ApplyToThread(HANDLE thread)
+    {
+      CONTEXT threadContext = {};
+      threadContext.ContextFlags = CONTEXT_DEBUG_REGISTERS;
+      if (0 == Protected::Windows_GetThreadContext(thread, &threadContext)) return false;
+
+      decltype(threadContext.Dr0)* const debugAddressRegisters[kMaxDebugRegisterHooks] = {
+          &threadContext.Dr0, &threadContext.Dr1, &threadContext.Dr2, &threadContext.Dr3};
+
+      // Each debug address register has a local enable bit in the debug control register, along
+      // with a 4-bit field that specifies the breakpoint condition and length. All zeroes in the
+      // latter means a breakpoint on instruction execution.
+      for (unsigned int i = 0; i < kMaxDebugRegisterHooks; ++i)
+      {
+        void* const originalFunc = originalFunctions[i];
+        const size_t enableBit = static_cast<size_t>(1) << (i * 2);
+        const size_t conditionBits = static_cast<size_t>(0xf) << (16 + (i * 4));
+
+        if (nullptr == originalFunc)
+        {
+          threadContext.Dr7 &= ~enableBit;
+        }
+        else
+        {
+          *debugAddressRegisters[i] =
+              static_cast<decltype(threadContext.Dr0)>(reinterpret_cast<size_t>(originalFunc));
+          threadContext.Dr7 = (threadContext.Dr7 & ~conditionBits) | enableBit;
+        }
+      }
+
+      return (0 != Protected::Windows_SetThreadContext(thread, &threadContext));
+    }
+
+    /// Loads the debug registers of every thread in the process, including the calling thread, to
+    /// match the current set of debug register hooks. Requires that the lock be held.
+    /// @return Number of threads whose debug registers could not be loaded.
+    static size_t ApplyToAllThreads(void)
+    {
+      size_t numFailedThreads = 0;
+
+      std::vector<HANDLE> suspendedThreads;
+      HookStore::SuspendOtherThreads(suspendedThreads);
+
+      for (const HANDLE thread : suspendedThreads)
+      {
+        if (false == ApplyToThread(thread)) numFailedThreads += 1;
+      }
+
+      HookStore::ResumeThreads(suspendedThreads);
+
+      if (false == ApplyToThread(GetCurrentThread())) numFailedThreads += 1;
+
+      return numFailedThreads;
+    }
+
+    /// Searches for an existing debug register hook.
+    /// @param [in] originalOrHookFunc Address of either the original function or the hook
+    /// function associated with the hook.
+    /// @return Index of the debug address register used by the hook, or #kMaxDebugRegisterHooks
+    /// if there is no matching hook.
+    static unsigned int FindDebugRegisterHook(const void* originalOrHookFunc)
+    {
+      for (unsigned int i = 0; i < kMaxDebugRegisterHooks; ++i)
+      {
+        const void* const originalFunc = originalFunctions[i];
+        if (nullptr == originalFunc) continue;
+
+        if ((originalOrHookFunc == originalFunc) || (originalOrHookFunc == hookFunctions[i]))
+          return i;
+      }
+
+      return kMaxDebugRegisterHooks;
+    }
+
+    void ApplyToCurrentThread(void)
+    {
+      for (unsigned int i = 0; i < kMaxDebugRegisterHooks; ++i)
+      {
+        if (nullptr != originalFunctions[i])
+        {
+          ApplyToThread(GetCurrentThread());
+          return;
+        }
+      }
+    }
+
+    EResult CreateDebugRegisterHook(void* originalFunc, const void* hookFunc)
+    {
+      if ((nullptr == originalFunc) || (nullptr == hookFunc) || (originalFunc == hookFunc))
+        return EResult::FailInvalidArgument;
+
+      std::unique_lock<std::mutex> lock(debugRegisterHooksMutex);
+
+      if ((kMaxDebugRegisterHooks != FindDebugRegisterHook(originalFunc)) ||
+          (kMaxDebugRegisterHooks != FindDebugRegisterHook(hookFunc)))
+        return EResult::FailDuplicate;
+
+      unsigned int index = 0;
+      while ((index < kMaxDebugRegisterHooks) && (nullptr != originalFunctions[index]))
+        index += 1;
+
+      if (kMaxDebugRegisterHooks == index) return EResult::FailAllocation;
+      if ((nullptr == GetBypassStubs()) || (false == RegisterExceptionHandler()))
+        return EResult::FailInternal;
+
+      hookFunctions[index] = hookFunc;
+      originalFunctions[index] = originalFunc;
+
+      const size_t numFailedThreads = ApplyToAllThreads();
+
+      lock.unlock();
+
+      if (0 != numFailedThreads)
+      {
+        Infra::Message::OutputFormatted(
+            Infra::Message::ESeverity::Warning,
+            L"Failed to load debug registers for hook on function at 0x%llx in %llu thread(s), which will not observe it.",
+            (long long)originalFunc,
+            (unsigned long long)numFailedThreads);
+      }
+
+      Infra::Message::OutputFormatted(
+          Infra::Message::ESeverity::Info,
+          L"Successfully hooked function at 0x%llx using debug address register %u.",
+          (long long)originalFunc,
+          index);
+
+      return EResult::Success;
+    }
+
+    const void* GetOriginalFunction(const void* originalOrHookFunc)
+    {
+      const unsigned int index = FindDebugRegisterHook(originalOrHookFunc);
+      if (kMaxDebugRegisterHooks == index) return nullptr;
+
+      return BypassStubFor(index);
+    }
+
+    EResult RemoveDebugRegisterHook(const void* originalOrHookFunc)
+    {
+      std::unique_lock<std::mutex> lock(debugRegisterHooksMutex);
+
+      const unsigned int index = FindDebugRegisterHook(originalOrHookFunc);
+      if (kMaxDebugRegisterHooks == index) return EResult::FailNotFound;
+
+      // The bypass stub stays valid, so a thread that obtained it before removal can still use it
+      // to reach the original function, but only until the debug address register is reused.
+      originalFunctions[index] = nullptr;
+      hookFunctions[index] = nullptr;
+
+      ApplyToAllThreads();
+      return EResult::Success;
+    }
+  } // namespace DebugRegisterHooks
+} // namespace Hookshot
@@ -0,0 +1,345 @@
+/***************************************************************************************************
+ * Hookshot
+ *   General-purpose library for injecting DLLs and hooking function calls.
+ ***************************************************************************************************
+ * Authored by Samuel Grossman
+ * Copyright (c) 2019-2025
+ ***********************************************************************************************//**
+ * @file DeferredHooks.cpp
+ *   Implementation of hooks on functions exported by modules that might not yet be loaded, which
+ *   are installed as soon as the loader maps those modules.
+ **************************************************************************************************/
+
+#include "DeferredHooks.h"
+
+#include <mutex>
+#include <string>
+#include <string_view>
+#include <utility>
+#include <vector>
+
+#include <Infra/Core/Message.h>
+#include <Infra/Core/Strings.h>
+
+#include "ApiWindows.h"
+#include "DependencyProtect.h"
+#include "ExportResolver.h"
+#include "HookStore.h"
+#include "HookshotTypes.h"
+
+namespace Hookshot
+{
+  namespace DeferredHooks
+  {
+    /// Notification reason passed to the loader notification callback when a module is loaded.
+    /// This and the following types are documented, but internal, and are not exposed by any of
+    /// the Windows header files. See
+    /// https://learn.microsoft.com/en-us/windows/win32/devnotes/ldrdllnotification for details.
+    static constexpr ULONG kLdrDllNotificationReasonLoaded = 1;
+
+    /// Counted string, as used by the loader.
+    struct SLdrUnicodeString
+    {
+      USHORT length;
+      USHORT maximumLength;
+      PWSTR buffer;
+    };
+
+    /// Information about a module passed to the loader notification callback. Identical for
+    /// modules being loaded and modules being unloaded.
+    struct SLdrDllNotificationData
+    {
+      ULONG flags;
+      const SLdrUnicodeString* fullDllName;
+      const SLdrUnicodeString* baseDllName;
+      void* dllBase;
+      ULONG sizeOfImage;
+    };
+
+    /// Function signature for the loader notification callback.
+    using TLdrDllNotificationFunction =
+        VOID(CALLBACK*)(ULONG reason, const SLdrDllNotificationData* data, PVOID context);
+
+    /// Function signature for `LdrRegisterDllNotification`, exported by ntdll.
+    using TLdrRegisterDllNotification = NTSTATUS(NTAPI*)(
+        ULONG flags,
+        TLdrDllNotificationFunction notificationFunction,
+        PVOID context,
+        PVOID* cookie);
+
+    /// Holds a hook that should be created once the module that exports its original function is
+    /// loaded.
+    struct SDeferredHook
+    {
+      /// Base name of the module that exports the original function.
+      std::wstring moduleName;
+
+      /// Name of the exported original function.
+      std::string exportName;
+
+      /// Hook function that should be invoked instead of the original function, or `nullptr` if
+      /// the hook is a call trace hook.
+      const void* hookFunc;
+    };
+
+    /// Holds an action that should be performed once a module is loaded.
+    struct SDeferredAction
+    {
+      /// Base name of the module whose loading triggers the action.
+      std::wstring moduleName;
+
+      /// Function that performs the action.
+      TDeferredActionProc actionProc;
+
+      /// Value to pass to the action function.
+      void* context;
+    };
+
+    /// Enforces serialized access to the deferred hooks and actions, which can be registered by any
+    /// thread and are taken by whichever thread is loading a module.
+    static std::mutex deferredHooksMutex;
+
+    /// All deferred hooks whose modules have not yet been loaded.
+    static std::vector<SDeferredHook> deferredHooks;
+
+    /// All deferred actions whose modules have not yet been loaded.
+    static std::vector<SDeferredAction> deferredActions;
+
+    /// Removes and returns all deferred items, either hooks or actions, that are waiting for the
+    /// specified module to be loaded.
+    /// @tparam DeferredItemType Type of deferred item, which identifies its module by base name.
+    /// @param [in, out] deferredItems Deferred items from which to remove those taken.
+    /// @param [in] moduleName Base name of the module of interest.
+    /// @return Deferred items that were removed, which are now the caller's responsibility.
+    template <typename DeferredItemType> static std::vector<DeferredItemType> TakeForModule(
+        std::vector<DeferredItemType>& deferredItems, std::wstring_view moduleName)
+    {
+      std::vector<DeferredItemType> takenDeferredItems;
+
+      std::unique_lock<std::mutex> lock(deferredHooksMutex);
+
+      for (auto deferredItemIter = deferredItems.begin(); deferredItemIter != deferredItems.end();)
+      {
+        if (true ==
+            Infra::Strings::EqualsCaseInsensitive(
+                std::wstring_view(deferredItemIter->moduleName), moduleName))
+        {
+          takenDeferredItems.push_back(std::move(*deferredItemIter));
+          deferredItemIter = deferredItems.erase(deferredItemIter);
+        }
+        else
+        {
+          ++deferredItemIter;
+        }
+      }
+
+      return takenDeferredItems;
+    }
+
+    /// Creates a deferred hook now that the module that exports its original function is loaded,
+    /// and outputs a message indicating the outcome.
+    /// @param [in] moduleHandle Handle of the loaded module.
+    /// @param [in] deferredHook Deferred hook to create.
+    /// @return Result of the operation.
+    static EResult InstallDeferredHook(HMODULE moduleHandle, const SDeferredHook& deferredHook)
+    {
+      void* const originalFunc =
+          ExportResolver::GetLocalProcAddress(moduleHandle, deferredHook.exportName);
+      EResult result = EResult::FailNotFound;
+      if (nullptr != originalFunc)
+      {
+        result =
+            ((nullptr == deferredHook.hookFunc)
+                 ? HookStore::CreateCallTraceHookInternal(originalFunc)
+                 : HookStore::CreateHookInternal(
+                       originalFunc, deferredHook.hookFunc, false, nullptr));
+      }
+
+      if (true == SuccessfulResult(result))
+      {
+        Infra::Message::OutputFormatted(
+            Infra::Message::ESeverity::Info,
+            L"%s!%s - Successfully created deferred hook now that the module is loaded.",
+            deferredHook.moduleName.c_str(),
+            Infra::Strings::ConvertNarrowToWide(deferredHook.exportName.c_str()).AsCString());
+      }
+      else
+      {
+        Infra::Message::OutputFormatted(
+            Infra::Message::ESeverity::Warning,
+            L"%s!%s - Failed to create deferred hook now that the module is loaded (EResult = %u).",
+            deferredHook.moduleName.c_str(),
+            Infra::Strings::ConvertNarrowToWide(deferredHook.exportName.c_str()).AsCString(),
+            (unsigned int)result);
+      }
+
+      return result;
+    }
+
+    /// Loader notification callback. Invoked with the loader lock held whenever a module is loaded
+    /// or unloaded. Newly-loaded modules are mapped but none of their code has run yet.
+    /// @param [in] reason Reason for the notification.
+    /// @param [in] data Information about the module.
+    /// @param [in] context Unused.
+    static VOID CALLBACK LoaderNotification(
+        ULONG reason, const SLdrDllNotificationData* data, PVOID context)
+    {
+      if ((kLdrDllNotificationReasonLoaded != reason) || (nullptr == data) ||
+          (nullptr == data->baseDllName) || (nullptr == data->baseDllName->buffer))
+        return;
+
+      const std::wstring_view moduleName(
+          data->baseDllName->buffer, data->baseDllName->length / sizeof(wchar_t));
+      const std::vector<SDeferredHook> takenDeferredHooks =
+          TakeForModule(deferredHooks, moduleName);
+
+      for (const auto& deferredHook : takenDeferredHooks)
+        InstallDeferredHook(reinterpret_cast<HMODULE>(data->dllBase), deferredHook);
+
+      for (const auto& deferredAction : TakeForModule(deferredActions, moduleName))
+        deferredAction.actionProc(deferredAction.context);
+    }
+
+    /// Registers for loader notifications. Only attempted once, no matter how many times it is
+    /// invoked.
+    /// @return `true` if loader notifications are registered, `false` otherwise.
+    static bool RegisterLoaderNotification(void)
+    {
+      static const bool isRegistered = []() -> bool
+      {
+        HMODULE ntdllModule = nullptr;
+        if (0 ==
+            Protected::Windows_GetModuleHandleEx(
+                GET_MODULE_HANDLE_EX_FLAG_UNCHANGED_REFCOUNT, L"ntdll.dll", &ntdllModule))
+          return false;
+
+        const TLdrRegisterDllNotification ldrRegisterDllNotificationProc =
+            (TLdrRegisterDllNotification)Protected::Windows_GetProcAddress(
+                ntdllModule, "LdrRegisterDllNotification");
+        if (nullptr == ldrRegisterDllNotificationProc) return false;
+
+        // The cookie is only needed for unregistering, which never happens.
+        PVOID cookie = nullptr;
+        if (0 != ldrRegisterDllNotificationProc(0, &LoaderNotification, nullptr, &cookie))
+          return false;
+
+        return true;
+      }();
+
+      if (false == isRegistered)
+        Infra::Message::Output(
+            Infra::Message::ESeverity::Error,
+            L"Failed to register for loader notifications, so deferred hooks cannot be created.");
+
+      return isRegistered;
+    }
+
+    /// Registers a deferred hook and, if the module that exports its original function is already
+    /// loaded, creates it right away. Implements both #CreateDeferredHook and
+    /// #CreateDeferredCallTraceHook.
+    /// @param [in] newDeferredHook Deferred hook to register.
+    /// @return Result of the operation.
+    static EResult RegisterDeferredHook(SDeferredHook&& newDeferredHook)
+    {
+      if (false == RegisterLoaderNotification()) return EResult::FailInternal;
+
+      const std::wstring moduleName = newDeferredHook.moduleName;
+      const std::string exportName = newDeferredHook.exportName;
+      const void* const hookFunc = newDeferredHook.hookFunc;
+
+      // Call trace hooks have no hook function of their own, so they are identified instead by the
+      // function they trace.
+      auto isSameDeferredHook = [&moduleName, &exportName, hookFunc](
+                                    const SDeferredHook& deferredHook) -> bool
+      {
+        if (nullptr != hookFunc) return (hookFunc == deferredHook.hookFunc);
+
+        return (
+            (nullptr == deferredHook.hookFunc) && (exportName == deferredHook.exportName) &&
+            (true ==
+             Infra::Strings::EqualsCaseInsensitive(
+                 std::wstring_view(deferredHook.moduleName), std::wstring_view(moduleName))));
+      };
+
+      do
+      {
+        std::unique_lock<std::mutex> lock(deferredHooksMutex);
+
+        for (const auto& deferredHook : deferredHooks)
+        {
+          if (true == isSameDeferredHook(deferredHook)) return EResult::FailDuplicate;
+        }
+
+        deferredHooks.push_back(std::move(newDeferredHook));
+      } while (false);
+
+      // The deferred hook is registered before checking whether the module is already loaded, so
+      // that a concurrent load of the module cannot be missed. Whichever of this thread and the
+      // loading thread takes the deferred hook first creates it.
+      HMODULE moduleHandle = nullptr;
+      if (0 ==
+          Protected::Windows_GetModuleHandleEx(
+              GET_MODULE_HANDLE_EX_FLAG_UNCHANGED_REFCOUNT, moduleName.c_str(), &moduleHandle))
+        return EResult::Success;
+
+      // Other threads might have registered deferred hooks on the same module concurrently, in
+      // which case they are created here too.
+      const std::vector<SDeferredHook> takenDeferredHooks =
+          TakeForModule(deferredHooks, moduleName);
+      EResult result = EResult::Success;
+
+      for (const auto& deferredHook : takenDeferredHooks)
+      {
+        const EResult installResult = InstallDeferredHook(moduleHandle, deferredHook);
+        if (true == isSameDeferredHook(deferredHook)) result = installResult;
+      }
+
+      return result;
+    }
+
+    EResult CreateDeferredHook(
+        const wchar_t* moduleName, const char* exportName, const void* hookFunc)
+    {
+      if ((nullptr == moduleName) || (nullptr == exportName) || (nullptr == hookFunc))
+        return EResult::FailInvalidArgument;
+
+      return RegisterDeferredHook(
+          {.moduleName = moduleName, .exportName = exportName, .hookFunc = hookFunc});
+    }
+
+    bool CreateDeferredAction(
+        const wchar_t* moduleName, TDeferredActionProc actionProc, void* context)
+    {
+      if ((nullptr == moduleName) || (nullptr == actionProc)) return false;
+      if (false == RegisterLoaderNotification()) return false;
+
+      do
+      {
+        std::unique_lock<std::mutex> lock(deferredHooksMutex);
+        deferredActions.push_back(
+            {.moduleName = moduleName, .actionProc = actionProc, .context = context});
+      } while (false);
+
+      // Just like with deferred hooks, whichever of this thread and the loading thread takes the
+      // deferred action first performs it.
+      HMODULE moduleHandle = nullptr;
+      if (0 ==
+          Protected::Windows_GetModuleHandleEx(
+              GET_MODULE_HANDLE_EX_FLAG_UNCHANGED_REFCOUNT, moduleName, &moduleHandle))
+        return true;
+
+      for (const auto& deferredAction : TakeForModule(deferredActions, moduleName))
+        deferredAction.actionProc(deferredAction.context);
+
+      return true;
+    }
+
+    EResult CreateDeferredCallTraceHook(const wchar_t* moduleName, const char* exportName)
+    {
+      if ((nullptr == moduleName) || (nullptr == exportName)) return EResult::FailInvalidArgument;
+
+      return RegisterDeferredHook(
+          {.moduleName = moduleName, .exportName = exportName, .hookFunc = nullptr});
+    }
+  } // namespace DeferredHooks
+} // namespace Hookshot
@@ -13,8 +13,10 @@
 
 #include <intrin.h>
 
+#include <algorithm>
+#include <array>
+#include <cstddef>
 #include <cstdint>
-#include <unordered_map>
 
 #include <Infra/Core/DebugAssert.h>
 
@@ -22,30 +24,131 @@
 
 namespace Hookshot
 {
-  /// Registry of all protected dependencies. Key is the current known address of the protected
-  /// dependency. Value is the address of the protected dependency pointer.
-  static std::unordered_map<const void*, const void* volatile*> protectedDependencies;
+  /// Maximum number of protected dependencies that can be registered.
+  static constexpr size_t kMaxProtectedDependencies = 128;
+
+  /// Single entry in the registry of protected dependencies.
+  struct SProtectedDependency
+  {
+    /// Current known address of the protected dependency.
+    const void* address;
+
+    /// Address of the protected dependency pointer.
+    const void* volatile* pointer;
+
+    /// Base name of the protected dependency function, without any scoping qualifiers.
+    const char* name;
+  };
+
+  /// Registry of all protected dependencies. Filled in declaration order during static
+  /// initialization without allocating any memory, then sorted by address so that lookups can use
+  /// binary search. Kept sorted thereafter.
+  static std::array<SProtectedDependency, kMaxProtectedDependencies> protectedDependencies;
+
+  /// Number of valid elements in the registry of protected dependencies.
+  static size_t numProtectedDependencies = 0;
+
+  /// Locates a protected dependency by its current known address. Requires that the registry be
+  /// sorted.
+  /// @param [in] address Address of the protected dependency to locate.
+  /// @return Pointer to the registry entry, or `nullptr` if the address does not belong to a
+  /// protected dependency.
+  static SProtectedDependency* FindProtectedDependency(const void* address)
+  {
+    SProtectedDependency* const begin = protectedDependencies.data();
+    SProtectedDependency* const end = begin + numProtectedDependencies;
+
+    SProtectedDependency* const entry = std::lower_bound(
+        begin,
+        end,
+        address,
+        [](const SProtectedDependency& entry, const void* value) -> bool
+        {
+          return (entry.address < value);
+        });
+
+    if ((end == entry) || (entry->address != address)) return nullptr;
+    return entry;
+  }
 
   /// Initializes a protected dependency pointer.
   /// Returns the address passed in after registering the protected dependency in the registry.
   /// @param [in] address Initial address of the protected dependency function.
   /// @param [in] protectedDependencyPointer Address of the protected dependency function pointer.
+  /// @param [in] funcBaseName Base name of the function without any scoping qualifiers.
   static const void* InitializeProtectedDependencyAddress(
-      const void* address, const void* volatile* protectedDependencyPointer)
+      const void* address,
+      const void* volatile* protectedDependencyPointer,
+      const char* const funcBaseName)
   {
     DebugAssert(
-        0 == protectedDependencies.count(address),
-        "Initializing a protected dependency that already exists.");
+        numProtectedDependencies < protectedDependencies.size(),
+        "Too many protected dependencies.");
+
+    if (numProtectedDependencies < protectedDependencies.size())
+    {
+      protectedDependencies[numProtectedDependencies] = {
+          .address = address, .pointer = protectedDependencyPointer, .name = funcBaseName};
+      numProtectedDependencies += 1;
+    }
 
-    protectedDependencies[address] = protectedDependencyPointer;
     return address;
   }
 
+  /// Resolves the addresses of all registered protected dependencies in the lower-level binaries
+  /// that implement them and updates the protected dependency pointers accordingly. Every
+  /// protected dependency is a Windows API function, so all of them are resolved together, which
+  /// locates and validates each export table once rather than once per function.
+  static void ResolveProtectedDependencies(void)
+  {
+    std::array<const char*, kMaxProtectedDependencies> funcNames;
+    std::array<void*, kMaxProtectedDependencies> funcAddresses;
+
+    for (size_t i = 0; i < numProtectedDependencies; ++i)
+    {
+      funcNames[i] = protectedDependencies[i].name;
+      funcAddresses[i] = const_cast<void*>(protectedDependencies[i].address);
+    }
+
+    GetWindowsApiFunctionAddresses(
+        funcNames.data(), funcAddresses.data(), numProtectedDependencies);
+
+    for (size_t i = 0; i < numProtectedDependencies; ++i)
+    {
+      protectedDependencies[i].address = funcAddresses[i];
+      *protectedDependencies[i].pointer = funcAddresses[i];
+    }
+  }
+
+  /// Resolves and then sorts the registry of protected dependencies by address. Invoked once
+  /// during static initialization after all of the protected dependency pointers have been
+  /// initialized.
+  /// @return `true` after sorting is complete.
+  static bool SortProtectedDependencies(void)
+  {
+    ResolveProtectedDependencies();
+
+    std::sort(
+        protectedDependencies.begin(),
+        protectedDependencies.begin() + numProtectedDependencies,
+        [](const SProtectedDependency& a, const SProtectedDependency& b) -> bool
+        {
+          return (a.address < b.address);
+        });
+
+    for (size_t i = 1; i < numProtectedDependencies; ++i)
+      DebugAssert(
+          protectedDependencies[i - 1].address != protectedDependencies[i].address,
+          "Initializing a protected dependency that already exists.");
+
+    return true;
+  }
+
   /// Retrieves a protected dependency pointer for Windows protected dependency functions.
   /// Many Windows API functions have been moved to lower-level binaries.
   /// See https://docs.microsoft.com/en-us/windows/win32/win7appqual/new-low-level-binaries for more
-  /// information. If possible, use the address in the lower-level binary as the original function,
-  /// otherwise just use the static address.
+  /// information. The static address is used initially, and the address in the lower-level binary
+  /// is resolved for all protected dependencies at once after they have all been registered.
   /// @param [in] funcQualifiedName Fully-qualified function name.
   /// @param [in] funcBaseName Base name of the function without any scoping qualifiers.
   /// @param [in] funcStaticAddress Static address of the function.
@@ -55,7 +158,7 @@ namespace Hookshot
       const char* const funcBaseName,
       void* const funcStaticAddress)
   {
-    return GetWindowsApiFunctionAddress(funcBaseName, funcStaticAddress);
+    return funcStaticAddress;
   }
 } // namespace Hookshot
 
@@ -69,7 +172,8 @@ namespace Hookshot
   extern const volatile decltype(&qualpath::func) nspace##_##func =                                \
       (decltype(&qualpath::func))InitializeProtectedDependencyAddress(                             \
           GetInitialAddress_##nspace(#qualpath "::" #func, #func, &qualpath::func),                \
-          (const void* volatile*)&nspace##_##func)
+          (const void* volatile*)&nspace##_##func,                                                 \
+          #func)
 
 // Variables are imported from "DependencyProtect.h" and defined.
 
@@ -77,21 +181,41 @@ namespace Hookshot
 
 namespace Hookshot
 {
+  // Dynamic initialization within a single translation unit happens in order of definition, so
+  // this runs after every protected dependency pointer above has been registered. Until then, each
+  // protected dependency pointer holds the static address of its function.
+  static const bool kProtectedDependenciesAreSorted = SortProtectedDependencies();
+
   void UpdateProtectedDependencyAddress(const void* oldAddress, const void* newAddress)
   {
-    if (0 != protectedDependencies.count(oldAddress))
-    {
-      DebugAssert(
-          0 == protectedDependencies.count(newAddress),
-          "New protected dependency address already exists.");
+    SProtectedDependency* const entry = FindProtectedDependency(oldAddress);
+    if (nullptr == entry) return;
 
-      const void* volatile* const pointerToUpdate = protectedDependencies.at(oldAddress);
-
-      protectedDependencies.erase(oldAddress);
-      protectedDependencies.insert({newAddress, pointerToUpdate});
-
-      *pointerToUpdate = newAddress;
-      _mm_mfence();
-    }
+    DebugAssert(
+        nullptr == FindProtectedDependency(newAddress),
+        "New protected dependency address already exists.");
+
+    const void* volatile* const pointerToUpdate = entry->pointer;
+
+    // Only the updated entry can be out of order, so it is moved to the end of the registry and
+    // then inserted where it now belongs.
+    SProtectedDependency* const begin = protectedDependencies.data();
+    SProtectedDependency* const end = begin + numProtectedDependencies;
+    SProtectedDependency* const last = end - 1;
+    std::rotate(entry, entry + 1, end);
+    last->address = newAddress;
+
+    SProtectedDependency* const position = std::lower_bound(
+        begin,
+        last,
+        newAddress,
+        [](const SProtectedDependency& other, const void* value) -> bool
+        {
+          return (other.address < value);
+        });
+    std::rotate(position, last, end);
+
+    *pointerToUpdate = newAddress;
+    _mm_mfence();
   }
 } // namespace Hookshot
@@ -9,17 +9,24 @@
  *   Entry points for the injected library.
  **************************************************************************************************/
 
+#include <cstdint>
 #include <string_view>
 
 #include <Infra/Core/Message.h>
 #include <Infra/Core/ProcessInfo.h>
 
+#include "CallTracing.h"
+#include "DebugRegisterHooks.h"
 #include "DependencyProtect.h"
+#include "ExitSummary.h"
 #include "Globals.h"
 #include "HookshotTypes.h"
-#include "InjectLanding.h"
 #include "LibraryInterface.h"
 
+#ifndef HOOKSHOT_CORE_LIBRARY
+#include "InjectLanding.h"
+#endif
+
 using namespace Hookshot;
 
 /// Performs library initialization and teardown functions. Invoked automatically by the operating
@@ -37,12 +44,18 @@ extern "C" BOOL WINAPI DllMain(HINSTANCE hinstDLL, DWORD fdwReason, LPVOID lpvRe
       break;
 
     case DLL_PROCESS_DETACH:
+      // A non-null reserved parameter means the process is exiting rather than this library being
+      // unloaded, which is the last chance to summarize anything about the process.
+      if (nullptr != lpvReserved) ExitSummary::Write();
       break;
 
     case DLL_THREAD_ATTACH:
+      DebugRegisterHooks::ApplyToCurrentThread();
+      CallTracing::AttachCurrentThread();
       break;
 
     case DLL_THREAD_DETACH:
+      CallTracing::DetachCurrentThread();
       break;
 
     default:
@@ -52,6 +65,7 @@ extern "C" BOOL WINAPI DllMain(HINSTANCE hinstDLL, DWORD fdwReason, LPVOID lpvRe
   return TRUE;
 }
 
+#ifndef HOOKSHOT_CORE_LIBRARY
 /// Invoked by injection code to perform additional initialization functions, especially those not
 /// safe to perform in the main DLL entry point. Success or failure of this function determines the
 /// overall success or failure of the injection process. The injecting process is still waiting on
@@ -75,6 +89,7 @@ extern "C" __declspec(dllexport) void* __fastcall HookshotInjectInitialize(void)
     return nullptr;
   }
 }
+#endif
 
 /// Invoked when Hookshot is loaded as a library. See "HookshotFunctions.h" for more information.
 /// @return Hookshot interface pointer, or `nullptr` on failure.
@@ -95,3 +110,11 @@ extern "C" __declspec(dllexport) IHookshot* __fastcall HookshotLibraryInitialize
     return nullptr;
   }
 }
+
+/// Invoked by hook modules and by applications that load Hookshot at runtime to determine which
+/// interface versions are available. See "HookshotFunctions.h" for more information.
+/// @return Highest interface version offered by this build.
+extern "C" __declspec(dllexport) uint32_t __fastcall HookshotInterfaceVersion(void)
+{
+  return kInterfaceVersionLatest;
+}
@@ -9,8 +9,13 @@
  *   Entry point for the bootstrap executable.
  **************************************************************************************************/
 
-#include <sstream>
+#include <intrin.h>
+
+#include <chrono>
+#include <cstdint>
 #include <string>
+#include <string_view>
+#include <vector>
 
 #include <Infra/Core/Message.h>
 #include <Infra/Core/ProcessInfo.h>
@@ -18,13 +23,355 @@
 #include <Infra/Core/TemporaryBuffer.h>
 
 #include "ApiWindows.h"
+#include "BatchLaunch.h"
+#include "CallTraceReader.h"
+#include "CallTracing.h"
 #include "Globals.h"
+#include "InjectionBenchmark.h"
 #include "InjectResult.h"
+#include "InjectorDaemon.h"
 #include "ProcessInjector.h"
+#include "SharedStatistics.h"
+#include "SharedStatisticsReader.h"
 #include "Strings.h"
 
 using namespace Hookshot;
 
+/// Displays the hook statistics published by another process. Two snapshots are taken one publish
+/// interval apart so that per-hook call rates can be computed.
+/// @param [in] processId Identifier of the process whose hook statistics should be displayed.
+/// @return Exit code from this program.
+static int DisplayHookStatistics(DWORD processId)
+{
+  const SharedStatistics::SHeader* const header =
+      SharedStatisticsReader::MapSection(static_cast<uint32_t>(processId));
+  if (nullptr == header)
+  {
+    Infra::Message::OutputFormatted(
+        Infra::Message::ESeverity::ForcedInteractiveError,
+        L"Process %u is not publishing hook statistics (%s).",
+        (unsigned int)processId,
+        Infra::Strings::FromSystemErrorCode(GetLastError()).AsCString());
+    return __LINE__;
+  }
+
+  SharedStatisticsReader::SSnapshot previousSnapshot = {};
+  SharedStatisticsReader::SSnapshot currentSnapshot = {};
+  bool snapshotsAreValid = SharedStatisticsReader::ReadSnapshot(header, &previousSnapshot);
+  if (true == snapshotsAreValid)
+  {
+    Sleep(SharedStatistics::kPublishIntervalMilliseconds);
+    snapshotsAreValid = SharedStatisticsReader::ReadSnapshot(header, &currentSnapshot);
+  }
+
+  SharedStatisticsReader::UnmapSection(header);
+
+  if (false == snapshotsAreValid)
+  {
+    Infra::Message::OutputFormatted(
+        Infra::Message::ESeverity::ForcedInteractiveError,
+        L"Hook statistics published by process %u could not be read.",
+        (unsigned int)processId);
+    return __LINE__;
+  }
+
+  const std::vector<uint64_t> callsPerSecond =
+      SharedStatisticsReader::ComputeCallsPerSecond(previousSnapshot, currentSnapshot);
+
+  for (size_t recordIndex = 0; recordIndex < currentSnapshot.records.size(); ++recordIndex)
+  {
+    const auto& record = currentSnapshot.records[recordIndex];
+
+    if (0 == (record.flags & SharedStatistics::kRecordFlagInstrumented))
+    {
+      Infra::Message::OutputFormatted(
+          Infra::Message::ESeverity::Info,
+          L"Hook 0x%llx -> 0x%llx: not instrumented.",
+          (long long)record.originalFunc,
+          (long long)record.hookFunc);
+      continue;
+    }
+
+    Infra::Message::OutputFormatted(
+        Infra::Message::ESeverity::Info,
+        L"Hook 0x%llx -> 0x%llx: %llu calls total, %llu calls per second.",
+        (long long)record.originalFunc,
+        (long long)record.hookFunc,
+        (unsigned long long)record.callCount,
+        (unsigned long long)callsPerSecond[recordIndex]);
+
+    if ((0 != (record.flags & SharedStatistics::kRecordFlagSampled)) &&
+        (0 != record.numSampledCalls) && (0 != currentSnapshot.ticksPerMicrosecond))
+      Infra::Message::OutputFormatted(
+          Infra::Message::ESeverity::Info,
+          L"Hook 0x%llx -> 0x%llx: %llu calls sampled, 99th percentile at least %llu us.",
+          (long long)record.originalFunc,
+          (long long)record.hookFunc,
+          (unsigned long long)record.numSampledCalls,
+          (unsigned long long)(record.sampledLatencyTicks / currentSnapshot.ticksPerMicrosecond));
+  }
+
+  Infra::Message::OutputFormatted(
+      Infra::Message::ESeverity::ForcedInteractiveInfo,
+      L"Process %u has %u hook(s), %u of which are listed in the log, and %u failed attempt(s) to create hooks.",
+      (unsigned int)processId,
+      currentSnapshot.numHooks,
+      (unsigned int)currentSnapshot.records.size(),
+      currentSnapshot.numInstallFailures);
+
+  if (0 != currentSnapshot.numPatchRepairs)
+    Infra::Message::OutputFormatted(
+        Infra::Message::ESeverity::ForcedInteractiveInfo,
+        L"Process %u has had %u overwritten hook redirection(s) repaired.",
+        (unsigned int)processId,
+        currentSnapshot.numPatchRepairs);
+
+  if (0 != currentSnapshot.numStartupPhases)
+  {
+    std::wstring phaseDurations;
+    for (uint32_t i = 0; i < currentSnapshot.numStartupPhases; ++i)
+    {
+      if (0 != i) phaseDurations += L", ";
+      phaseDurations += std::to_wstring(currentSnapshot.startupPhaseMicroseconds[i]);
+    }
+
+    Infra::Message::OutputFormatted(
+        Infra::Message::ESeverity::ForcedInteractiveInfo,
+        L"Process %u took %lld us to initialize Hookshot, with phase durations (us): %s.",
+        (unsigned int)processId,
+        (long long)currentSnapshot.startupTotalMicroseconds,
+        phaseDurations.c_str());
+  }
+
+  return 0;
+}
+
+/// Maps a read-only view of the call trace section of another process. Neither opens nor otherwise
+/// interferes with the process itself.
+/// @param [in] processId Identifier of the process whose section should be mapped.
+/// @return Header at the beginning of the mapped view, or `nullptr` if the process is not tracing
+/// calls, in which case the system error code is available.
+static const CallTracing::SHeader* MapCallTraceSection(uint32_t processId)
+{
+  const HANDLE section = OpenFileMapping(
+      FILE_MAP_READ, FALSE, Strings::CallTraceSectionName(processId).AsCString());
+  if (nullptr == section) return nullptr;
+
+  const CallTracing::SHeader* const header = reinterpret_cast<const CallTracing::SHeader*>(
+      MapViewOfFile(section, FILE_MAP_READ, 0, 0, CallTracing::kSectionSizeBytes));
+
+  const DWORD mapViewError = GetLastError();
+  CloseHandle(section);
+  SetLastError(mapViewError);
+
+  return header;
+}
+
+/// Drains and displays the calls that call trace hooks record in another process, until that
+/// process exits. Timestamps are displayed relative to the first call drained. They are converted
+/// using a time stamp counter rate measured by this program, which works because the counter is
+/// the same in every process.
+/// @param [in] processId Identifier of the process whose traced calls should be displayed.
+/// @return Exit code from this program.
+static int DrainCallTrace(DWORD processId)
+{
+  constexpr DWORD kDrainIntervalMilliseconds = 100;
+
+  const uint64_t startTimestamp = __rdtsc();
+  const auto startTime = std::chrono::steady_clock::now();
+
+  const CallTracing::SHeader* const header = MapCallTraceSection(static_cast<uint32_t>(processId));
+  if (nullptr == header)
+  {
+    Infra::Message::OutputFormatted(
+        Infra::Message::ESeverity::ForcedInteractiveError,
+        L"Process %u is not tracing calls (%s).",
+        (unsigned int)processId,
+        Infra::Strings::FromSystemErrorCode(GetLastError()).AsCString());
+    return __LINE__;
+  }
+
+  // The process is opened only so that this program can wait for it to exit. If that is not
+  // allowed, the section is drained just once.
+  const HANDLE process = OpenProcess(SYNCHRONIZE, FALSE, processId);
+
+  CallTraceReader::SDrainState drainState = {};
+  std::vector<CallTraceReader::SDrainedRecord> drainedRecords;
+  uint64_t firstRecordTimestamp = 0;
+  uint64_t numRecordsDrained = 0;
+  bool drainSucceeded = true;
+
+  while (true)
+  {
+    const bool processHasExited =
+        ((nullptr == process) ||
+         (WAIT_TIMEOUT != WaitForSingleObject(process, kDrainIntervalMilliseconds)));
+
+    drainSucceeded = CallTraceReader::DrainRecords(header, &drainState, &drainedRecords);
+    if (false == drainSucceeded) break;
+
+    if ((0 == numRecordsDrained) && (false == drainedRecords.empty()))
+      firstRecordTimestamp = drainedRecords.front().record.timestamp;
+
+    const uint64_t elapsedMicroseconds = static_cast<uint64_t>(
+        std::chrono::duration_cast<std::chrono::microseconds>(
+            std::chrono::steady_clock::now() - startTime)
+            .count());
+    const uint64_t ticksPerMicrosecond =
+        ((0 == elapsedMicroseconds) ? 0 : ((__rdtsc() - startTimestamp) / elapsedMicroseconds));
+
+    for (const auto& drainedRecord : drainedRecords)
+    {
+      const CallTracing::SRecord& record = drainedRecord.record;
+      const uint64_t elapsedTicks = record.timestamp - firstRecordTimestamp;
+
+      Infra::Message::OutputFormatted(
+          Infra::Message::ESeverity::Info,
+          L"Thread %u called 0x%llx from 0x%llx at +%llu %s with arguments 0x%llx, 0x%llx, 0x%llx, 0x%llx.",
+          drainedRecord.threadId,
+          (long long)record.originalFunc,
+          (long long)record.returnAddress,
+          (unsigned long long)(
+              (0 == ticksPerMicrosecond) ? elapsedTicks : (elapsedTicks / ticksPerMicrosecond)),
+          ((0 == ticksPerMicrosecond) ? L"ticks" : L"us"),
+          (long long)record.arguments[0],
+          (long long)record.arguments[1],
+          (long long)record.arguments[2],
+          (long long)record.arguments[3]);
+    }
+
+    numRecordsDrained += drainedRecords.size();
+    if (true == processHasExited) break;
+  }
+
+  const uint32_t numThreadsWithoutBuffers =
+      header->numThreadsWithoutBuffers.load(std::memory_order_relaxed);
+
+  UnmapViewOfFile(header);
+  if (nullptr != process) CloseHandle(process);
+
+  if (false == drainSucceeded)
+  {
+    Infra::Message::OutputFormatted(
+        Infra::Message::ESeverity::ForcedInteractiveError,
+        L"Calls traced by process %u could not be read.",
+        (unsigned int)processId);
+    return __LINE__;
+  }
+
+  Infra::Message::OutputFormatted(
+      Infra::Message::ESeverity::ForcedInteractiveInfo,
+      L"Drained %llu traced call(s) from process %u. %llu call(s) were overwritten before they could be drained, and %u thread(s) could not record calls.",
+      (unsigned long long)numRecordsDrained,
+      (unsigned int)processId,
+      (unsigned long long)drainState.numRecordsLost,
+      numThreadsWithoutBuffers);
+
+  return 0;
+}
+
+/// Injects processes that are already running, in parallel, and reports the result of each.
+/// @param [in] processIds Identifiers of the processes to inject.
+/// @return Exit code from this program.
+static int InjectRunningProcesses(const std::vector<DWORD>& processIds)
+{
+  const std::vector<ProcessInjector::SRunningProcessInjectResult> results =
+      ProcessInjector::InjectRunningProcesses(processIds, (IsDebuggerPresent() ? true : false));
+
+  unsigned int numFailed = 0;
+  for (const auto& result : results)
+  {
+    if (EInjectResult::Success == result.result)
+    {
+      Infra::Message::OutputFormatted(
+          Infra::Message::ESeverity::Info,
+          L"Successfully injected process %u.",
+          (unsigned int)result.processId);
+    }
+    else
+    {
+      Infra::Message::OutputFormatted(
+          Infra::Message::ESeverity::Error,
+          L"Failed to inject process %u: %s (%s)",
+          (unsigned int)result.processId,
+          InjectResultString(result.result).data(),
+          Infra::Strings::FromSystemErrorCode(result.systemErrorCode).AsCString());
+      numFailed += 1;
+    }
+  }
+
+  if (0 != numFailed)
+  {
+    Infra::Message::OutputFormatted(
+        Infra::Message::ESeverity::ForcedInteractiveError,
+        L"%.*s failed to inject %u of %u running process(es). See the log for details.",
+        static_cast<int>(Infra::ProcessInfo::GetProductName().length()),
+        Infra::ProcessInfo::GetProductName().data(),
+        numFailed,
+        (unsigned int)results.size());
+    return __LINE__;
+  }
+
+  return 0;
+}
+
+/// Combines command-line arguments into a single string buffer, suitable for passing to
+/// CreateProcessW. Each individual argument is placed in quotes (to preserve spaces within), and
+/// each quote character in the argument is escaped. Characters are written directly into the
+/// buffer, leaving room for a terminating null character. Displays an error message if the
+/// command line does not fit.
+/// @param [in] firstArgIndex Index of the first command-line argument to include, which should be
+/// the executable to launch.
+/// @param [out] commandLine Buffer to be filled with the null-terminated command line.
+/// @param [out] commandLineLength Filled with the length of the command line, not including the
+/// terminating null character.
+/// @return `true` if the command line fits in the buffer, `false` otherwise.
+static bool AssembleCommandLine(
+    int firstArgIndex, Infra::TemporaryBuffer<wchar_t>& commandLine, size_t* commandLineLength)
+{
+  const size_t commandLineMaxLength = static_cast<size_t>(commandLine.Capacity()) - 1;
+  size_t length = 0;
+  auto appendToCommandLine = [&commandLine, commandLineMaxLength, &length](
+                                 wchar_t commandLineChar) -> void
+  {
+    if (length < commandLineMaxLength)
+      commandLine[static_cast<unsigned int>(length)] = commandLineChar;
+
+    length += 1;
+  };
+
+  for (size_t argIndex = (size_t)firstArgIndex; argIndex < (size_t)__argc; ++argIndex)
+  {
+    const wchar_t* const argString = __wargv[argIndex];
+    const size_t argLen = wcslen(argString);
+
+    appendToCommandLine(L'\"');
+
+    for (size_t i = 0; i < argLen; ++i)
+    {
+      if (L'\"' == argString[i]) appendToCommandLine(L'\\');
+
+      appendToCommandLine(argString[i]);
+    }
+
+    appendToCommandLine(L'\"');
+    appendToCommandLine(L' ');
+  }
+
+  if (length > commandLineMaxLength)
+  {
+    Infra::Message::OutputFormatted(
+        Infra::Message::ESeverity::ForcedInteractiveError,
+        L"Specified command line exceeds the limit of %u characters.",
+        commandLine.Capacity());
+    return false;
+  }
+
+  commandLine[static_cast<unsigned int>(length)] = L'\0';
+  *commandLineLength = length;
+  return true;
+}
+
 /// Program entry point.
 /// @param [in] hInstance Instance handle for this executable.
 /// @param [in] hPrevInstance Unused, always `nullptr`.
@@ -48,15 +395,106 @@ int WINAPI wWinMain(HINSTANCE hInstance, HINSTANCE hPrevInstance, PWSTR lpCmdLin
     return __LINE__;
   }
 
+  if ((2 == __argc) && (Strings::kCharCmdlineIndicatorHookStatisticsProcessId == __wargv[1][0]))
+  {
+    // A process identifier was specified.
+    // This program was invoked to display the hook statistics that another process publishes in
+    // shared memory. The other process is neither attached to nor paused.
+    wchar_t* parseEnd;
+    const DWORD processId = static_cast<DWORD>(wcstoul(&__wargv[1][1], &parseEnd, 10));
+    if ((L'\0' != *parseEnd) || (&__wargv[1][1] == parseEnd)) return __LINE__;
+
+    return DisplayHookStatistics(processId);
+  }
+
+  if ((2 == __argc) && (Strings::kCharCmdlineIndicatorCallTraceProcessId == __wargv[1][0]))
+  {
+    // A process identifier was specified.
+    // This program was invoked to drain and display the calls that call trace hooks record in
+    // another process, until that process exits. The other process is neither attached to nor
+    // paused.
+    wchar_t* parseEnd;
+    const DWORD processId = static_cast<DWORD>(wcstoul(&__wargv[1][1], &parseEnd, 10));
+    if ((L'\0' != *parseEnd) || (&__wargv[1][1] == parseEnd)) return __LINE__;
+
+    return DrainCallTrace(processId);
+  }
+
+  if (Strings::kCharCmdlineIndicatorInjectProcessId == __wargv[1][0])
+  {
+    // One or more process identifiers were specified.
+    // This program was invoked to inject processes that are already running rather than to create
+    // a new one. Every argument must identify a process.
+    std::vector<DWORD> processIds;
+    for (int argIndex = 1; argIndex < __argc; ++argIndex)
+    {
+      if (Strings::kCharCmdlineIndicatorInjectProcessId != __wargv[argIndex][0]) return __LINE__;
+
+      wchar_t* parseEnd;
+      const DWORD processId = static_cast<DWORD>(wcstoul(&__wargv[argIndex][1], &parseEnd, 10));
+      if ((L'\0' != *parseEnd) || (&__wargv[argIndex][1] == parseEnd)) return __LINE__;
+
+      processIds.push_back(processId);
+    }
+
+    return InjectRunningProcesses(processIds);
+  }
+
+  if ((3 <= __argc) && (Strings::kCharCmdlineIndicatorInjectionBenchmark == __wargv[1][0]))
+  {
+    // A number of launches was specified, followed by an executable.
+    // This program was invoked to measure how long it takes to create and inject the executable,
+    // rather than to launch it just once.
+    wchar_t* parseEnd;
+    const unsigned long numLaunches = wcstoul(&__wargv[1][1], &parseEnd, 10);
+    if ((L'\0' != *parseEnd) || (&__wargv[1][1] == parseEnd) || (0 == numLaunches))
+      return __LINE__;
+
+    Infra::TemporaryBuffer<wchar_t> commandLine;
+    size_t commandLineLength = 0;
+    if (false == AssembleCommandLine(2, commandLine, &commandLineLength)) return __LINE__;
+
+    return InjectionBenchmark::Run(
+        static_cast<unsigned int>(numLaunches),
+        std::wstring_view(commandLine.Data(), commandLineLength));
+  }
+
+  if ((3 == __argc) && (Strings::kCharCmdlineIndicatorBatchLaunch == __wargv[1][0]))
+  {
+    // A manifest file was specified, optionally preceded by a concurrency limit.
+    // This program was invoked to launch and inject every command line listed in the manifest,
+    // rather than just one, so that the cost of starting this program is paid only once. Without
+    // a limit, as many programs run at a time as there are logical processors.
+    unsigned long maxConcurrentLaunches = GetActiveProcessorCount(ALL_PROCESSOR_GROUPS);
+    if (L'\0' != __wargv[1][1])
+    {
+      wchar_t* parseEnd;
+      maxConcurrentLaunches = wcstoul(&__wargv[1][1], &parseEnd, 10);
+      if ((L'\0' != *parseEnd) || (0 == maxConcurrentLaunches)) return __LINE__;
+    }
+
+    return BatchLaunch::Run(static_cast<unsigned int>(maxConcurrentLaunches), __wargv[2]);
+  }
+
+  if ((2 == __argc) && (Strings::kCharCmdlineIndicatorInjectorDaemon == __wargv[1][0]) &&
+      (L'\0' == __wargv[1][1]))
+  {
+    // The injector daemon was requested.
+    // This program stays alive to create and inject processes on behalf of other instances of the
+    // Hookshot executable and of the Hookshot Launcher, until it has been idle for a while.
+    return (false == ProcessInjector::ServeInjectorDaemon() ? __LINE__ : 0);
+  }
+
   if ((2 == __argc) && (Strings::kCharCmdlineIndicatorFileMappingHandle == __wargv[1][0]))
   {
     // A file mapping handle was specified.
-    // This is a special situation, in which this program was invoked to assist with injecting an
-    // already-created process. Such a situation occurs when Hookshot created a new process whose
+    // This is a special situation, in which this program was invoked to assist with injecting
+    // already-created processes. Such a situation occurs when Hookshot created a new process whose
     // target architecture does not match (i.e. 32-bit Hookshot spawning a 64-bit program, or vice
     // versa). When this is detected, Hookshot will additionally spawn a matching version of the
     // Hookshot executable to inject the target program. Communication between both instances of
-    // Hookshot occurs by means of shared memory accessed via a file mapping object.
+    // Hookshot occurs by means of shared memory accessed via a file mapping object. This instance
+    // acts as a broker that stays alive to serve every subsequent request from the same instance.
 
     if (wcslen(&__wargv[1][1]) > (2 * sizeof(size_t))) return __LINE__;
 
@@ -72,15 +510,15 @@ int WINAPI wWinMain(HINSTANCE hInstance, HINSTANCE hPrevInstance, PWSTR lpCmdLin
 
     if (L'\0' != *parseEnd) return __LINE__;
 
-    RemoteProcessInjector::SInjectRequest* const remoteInjectionData =
-        reinterpret_cast<RemoteProcessInjector::SInjectRequest*>(
+    RemoteProcessInjector::SInjectBrokerChannel* const brokerChannel =
+        reinterpret_cast<RemoteProcessInjector::SInjectBrokerChannel*>(
             MapViewOfFile(sharedMemoryHandle, FILE_MAP_ALL_ACCESS, 0, 0, 0));
-    if (nullptr == remoteInjectionData) return __LINE__;
+    if (nullptr == brokerChannel) return __LINE__;
 
     const bool remoteInjectionResult =
-        ProcessInjector::PerformRequestedRemoteInjection(remoteInjectionData);
+        ProcessInjector::ServeRemoteInjectionRequests(brokerChannel);
 
-    UnmapViewOfFile(remoteInjectionData);
+    UnmapViewOfFile(brokerChannel);
     CloseHandle(sharedMemoryHandle);
 
     return (false == remoteInjectionResult ? __LINE__ : 0);
@@ -92,60 +530,81 @@ int WINAPI wWinMain(HINSTANCE hInstance, HINSTANCE hPrevInstance, PWSTR lpCmdLin
 
     // First step is to combine all the command-line arguments into a single mutable string buffer,
     // including the executable to launch. Mutability is required per documentation of
-    // CreateProcessW. Each individual argument must be placed in quotes (to preserve spaces
-    // within), and each quote character in the argument must be escaped.
-    std::wstringstream commandLineStream;
-    for (size_t argIndex = 1; argIndex < (size_t)__argc; ++argIndex)
-    {
-      const wchar_t* const argString = __wargv[argIndex];
-      const size_t argLen = wcslen(argString);
-
-      commandLineStream << L'\"';
-
-      for (size_t i = 0; i < argLen; ++i)
-      {
-        if (L'\"' == argString[i]) commandLineStream << L'\\';
-
-        commandLineStream << argString[i];
-      }
-
-      commandLineStream << L"\" ";
-    }
-
+    // CreateProcessW.
     Infra::TemporaryBuffer<wchar_t> commandLine;
-    if (0 != wcscpy_s(commandLine.Data(), commandLine.Capacity(), commandLineStream.str().c_str()))
+    size_t commandLineLength = 0;
+    if (false == AssembleCommandLine(1, commandLine, &commandLineLength)) return __LINE__;
+
+    // Second step is to create and inject the new process using the assembled command line string.
+    // If child processes are to be injected by way of a job object, the new process is left
+    // suspended so that it can be placed into the job before it creates any of them.
+    ProcessInjector::SInjectionJob injectionJob = {};
+    bool injectUsingJob = false;
+    if (true == ProcessInjector::ShouldInjectChildProcessesUsingJob())
     {
-      Infra::Message::OutputFormatted(
-          Infra::Message::ESeverity::ForcedInteractiveError,
-          L"Specified command line exceeds the limit of %u characters.",
-          commandLine.Capacity());
-      return __LINE__;
+      injectUsingJob = ProcessInjector::CreateInjectionJob(&injectionJob);
+      if (false == injectUsingJob)
+        Infra::Message::OutputFormatted(
+            Infra::Message::ESeverity::Warning,
+            L"Failed to create a job object for injecting child processes (%s). Child processes will be injected by their parents instead.",
+            Infra::Strings::FromSystemErrorCode(GetLastError()).AsCString());
     }
 
-    // Second step is to create and inject the new process using the assembled command line string.
     STARTUPINFO startupInfo;
     PROCESS_INFORMATION processInfo;
 
     memset(reinterpret_cast<void*>(&startupInfo), 0, sizeof(startupInfo));
     memset(reinterpret_cast<void*>(&processInfo), 0, sizeof(processInfo));
 
-    const EInjectResult result = ProcessInjector::CreateInjectedProcess(
-        nullptr,
-        commandLine.Data(),
-        nullptr,
-        nullptr,
-        FALSE,
-        0,
-        nullptr,
-        nullptr,
-        &startupInfo,
-        &processInfo);
+    // The injector daemon, if enabled, creates and injects the new process on behalf of this
+    // process. It cannot place the new process into a job object owned by this process, so it is
+    // not used in that case.
+    EInjectResult result = EInjectResult::Failure;
+    const bool createdByInjectorDaemon =
+        ((false == injectUsingJob) && (true == InjectorDaemon::IsEnabled()) &&
+         (true ==
+          InjectorDaemon::CreateInjectedProcess(
+              std::wstring_view(commandLine.Data(), commandLineLength),
+              &result,
+              &processInfo.hProcess)));
+
+    if (false == createdByInjectorDaemon)
+    {
+      result = ProcessInjector::CreateInjectedProcess(
+          nullptr,
+          commandLine.Data(),
+          nullptr,
+          nullptr,
+          FALSE,
+          ((true == injectUsingJob) ? CREATE_SUSPENDED : 0),
+          nullptr,
+          nullptr,
+          &startupInfo,
+          &processInfo);
+    }
+
+    if ((true == injectUsingJob) && (EInjectResult::Success != result))
+    {
+      CloseHandle(injectionJob.completionPortHandle);
+      CloseHandle(injectionJob.jobHandle);
+    }
 
     switch (result)
     {
       case EInjectResult::Success:
         Infra::Message::OutputFormatted(
             Infra::Message::ESeverity::Info, L"Successfully injected %s.", __wargv[1]);
+
+        if (true == injectUsingJob)
+        {
+          // This process stays alive as a broker, injecting every process that joins the job.
+          if (false == ProcessInjector::ServeInjectionJob(injectionJob, processInfo))
+            Infra::Message::OutputFormatted(
+                Infra::Message::ESeverity::Warning,
+                L"Failed to place %s into a job object (%s). Child processes will be injected by their parents instead.",
+                __wargv[1],
+                Infra::Strings::FromSystemErrorCode(GetLastError()).AsCString());
+        }
         return 0;
 
       case EInjectResult::ErrorCreateProcess:
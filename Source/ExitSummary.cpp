@@ -0,0 +1,420 @@
+/***************************************************************************************************
+ * Hookshot
+ *   General-purpose library for injecting DLLs and hooking function calls.
+ ***************************************************************************************************
+ * Authored by Samuel Grossman
+ * Copyright (c) 2019-2025
+ ***********************************************************************************************//**
+ * @file ExitSummary.cpp
+ *   Implementation of summarizing hook statistics and install timings when the process exits.
+ **************************************************************************************************/
+
+#include "ExitSummary.h"
+
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <intrin.h>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include <Infra/Core/Configuration.h>
+#include <Infra/Core/ProcessInfo.h>
+#include <Infra/Core/Strings.h>
+
+#include "ApiWindows.h"
+#include "DependencyProtect.h"
+#include "Globals.h"
+#include "HookStore.h"
+#include "HookshotTypes.h"
+#include "SharedStatistics.h"
+#include "Strings.h"
+
+#ifndef HOOKSHOT_CORE_LIBRARY
+#include "StartupProfile.h"
+#endif
+
+namespace Hookshot
+{
+  namespace ExitSummary
+  {
+    /// Number of distinct result codes, each of which has its own failure count.
+    static constexpr size_t kNumResults = static_cast<size_t>(EResult::UpperBoundValue);
+
+    /// Number of hooks successfully created.
+    static std::atomic<uint32_t> numHooksInstalled;
+
+    /// Number of failed attempts to create a hook, for each result code.
+    static std::atomic<uint32_t> numInstallFailures[kNumResults];
+
+    /// Total amount of time spent creating hooks, in microseconds. A batch counts once.
+    static std::atomic<uint64_t> installTotalMicroseconds;
+
+    /// Longest amount of time spent on a single attempt to create hooks, in microseconds. A batch
+    /// counts as a single attempt.
+    static std::atomic<uint64_t> installMaxMicroseconds;
+
+    /// Pairs a reading of the processor time stamp counter with a reading of the steady clock, so
+    /// that the rate of the former can be measured when the summary is written.
+    struct SClockReference
+    {
+      uint64_t timestamp;
+      std::chrono::steady_clock::time_point time;
+    };
+
+    /// Retrieves the clock reference, taking it the first time this function is invoked. Sampled
+    /// latencies are in time stamp counter ticks, and short-lived processes do not necessarily live
+    /// long enough for any other part of Hookshot to have measured its rate, so the reference is
+    /// taken as early as the first hook creation.
+    /// @return Clock reference.
+    static const SClockReference& GetClockReference(void)
+    {
+      static const SClockReference clockReference = {
+          .timestamp = __rdtsc(), .time = std::chrono::steady_clock::now()};
+      return clockReference;
+    }
+
+    /// Measures the rate of the processor time stamp counter since the clock reference was taken.
+    /// @return Ticks per microsecond, or 0 if too little time has passed to measure it.
+    static uint64_t MeasureTicksPerMicrosecond(void)
+    {
+      const SClockReference& clockReference = GetClockReference();
+      const uint64_t elapsedMicroseconds = static_cast<uint64_t>(
+          std::chrono::duration_cast<std::chrono::microseconds>(
+              std::chrono::steady_clock::now() - clockReference.time)
+              .count());
+      if (0 == elapsedMicroseconds) return 0;
+
+      return ((__rdtsc() - clockReference.timestamp) / elapsedMicroseconds);
+    }
+
+    /// Retrieves the name of a result code, as it appears in the summary.
+    /// @param [in] result Result code.
+    /// @return Name of the result code.
+    static std::wstring_view ResultName(EResult result)
+    {
+      switch (result)
+      {
+        case EResult::Success:
+          return L"Success";
+        case EResult::NoEffect:
+          return L"NoEffect";
+        case EResult::FailAllocation:
+          return L"FailAllocation";
+        case EResult::FailBadState:
+          return L"FailBadState";
+        case EResult::FailCannotSetHook:
+          return L"FailCannotSetHook";
+        case EResult::FailDuplicate:
+          return L"FailDuplicate";
+        case EResult::FailInvalidArgument:
+          return L"FailInvalidArgument";
+        case EResult::FailInternal:
+          return L"FailInternal";
+        case EResult::FailNotFound:
+          return L"FailNotFound";
+        case EResult::FailCancelled:
+          return L"FailCancelled";
+        default:
+          return L"Unknown";
+      }
+    }
+
+    /// Counts the outcome of an attempt to create a single hook.
+    /// @param [in] result Result of the attempt.
+    static void CountResult(EResult result)
+    {
+      if (EResult::Success == result)
+      {
+        numHooksInstalled.fetch_add(1, std::memory_order_relaxed);
+      }
+      else if (false == SuccessfulResult(result))
+      {
+        const size_t resultIndex = static_cast<size_t>(result);
+        if (resultIndex < kNumResults)
+          numInstallFailures[resultIndex].fetch_add(1, std::memory_order_relaxed);
+      }
+    }
+
+    /// Adds the amount of time since the start of an attempt to create hooks to the install
+    /// timings.
+    /// @param [in] startTime Point in time at which the attempt started.
+    static void AddInstallDuration(std::chrono::steady_clock::time_point startTime)
+    {
+      const uint64_t microseconds = static_cast<uint64_t>(
+          std::chrono::duration_cast<std::chrono::microseconds>(
+              std::chrono::steady_clock::now() - startTime)
+              .count());
+
+      installTotalMicroseconds.fetch_add(microseconds, std::memory_order_relaxed);
+
+      uint64_t maxMicroseconds = installMaxMicroseconds.load(std::memory_order_relaxed);
+      while (microseconds > maxMicroseconds)
+      {
+        if (true ==
+            installMaxMicroseconds.compare_exchange_weak(
+                maxMicroseconds, microseconds, std::memory_order_relaxed))
+          break;
+      }
+    }
+
+    /// Generates the contents of the summary for this process. Every line starts with the type of
+    /// row and the process identifier, so that rows from concurrently-exiting processes can be
+    /// told apart even though each process appends all of its rows at once.
+    /// process,(pid),(executable),(UTC time),(startup us),(hooks installed),(install failures),
+    ///   (total install us),(longest install us),(existing hooks),(hooks omitted)
+    /// failure,(pid),(result),(count)
+    /// hook,(pid),(original function),(hook function),(calls),(sampled calls),(sampled p99 us)
+    /// Counts that were not collected are left empty.
+    /// @return Summary contents.
+    static std::wstring GenerateSummary(void)
+    {
+      const unsigned int processId =
+          static_cast<unsigned int>(Protected::Windows_GetCurrentProcessId());
+
+      std::vector<SharedStatistics::SRecord> records(SharedStatistics::kMaxRecords);
+      uint32_t numHooks = 0;
+      uint32_t numRecords = 0;
+      const bool statisticsCollected = HookStore::TryCollectStatistics(
+          records.data(), SharedStatistics::kMaxRecords, &numHooks, &numRecords);
+
+      uint32_t numFailures = 0;
+      for (size_t i = 0; i < kNumResults; ++i)
+        numFailures += numInstallFailures[i].load(std::memory_order_relaxed);
+
+      SYSTEMTIME currentTime;
+      GetSystemTime(&currentTime);
+
+      // Hookshot only goes through its initialization phases when it is injected or loaded as a
+      // library, not when it is linked directly into an application.
+#ifndef HOOKSHOT_CORE_LIBRARY
+      const int64_t startupMicroseconds = StartupProfile::GetTotalMicroseconds();
+#else
+      const int64_t startupMicroseconds = -1;
+#endif
+
+      std::wstring summary;
+      summary += Infra::Strings::Format(L"process,%u,", processId).AsStringView();
+      summary += Infra::ProcessInfo::GetExecutableBaseName();
+      summary += Infra::Strings::Format(
+                     L",%04u-%02u-%02uT%02u:%02u:%02uZ,%lld,%u,%u,%llu,%llu,",
+                     (unsigned int)currentTime.wYear,
+                     (unsigned int)currentTime.wMonth,
+                     (unsigned int)currentTime.wDay,
+                     (unsigned int)currentTime.wHour,
+                     (unsigned int)currentTime.wMinute,
+                     (unsigned int)currentTime.wSecond,
+                     (long long)startupMicroseconds,
+                     (unsigned int)numHooksInstalled.load(std::memory_order_relaxed),
+                     (unsigned int)numFailures,
+                     (unsigned long long)installTotalMicroseconds.load(std::memory_order_relaxed),
+                     (unsigned long long)installMaxMicroseconds.load(std::memory_order_relaxed))
+                     .AsStringView();
+      if (true == statisticsCollected)
+        summary += Infra::Strings::Format(
+                       L"%u,%u", (unsigned int)numHooks, (unsigned int)(numHooks - numRecords))
+                       .AsStringView();
+      else
+        summary += L",";
+      summary += L"\r\n";
+
+      for (size_t i = 0; i < kNumResults; ++i)
+      {
+        const uint32_t numFailuresForResult = numInstallFailures[i].load(std::memory_order_relaxed);
+        if (0 == numFailuresForResult) continue;
+
+        summary += Infra::Strings::Format(
+                       L"failure,%u,%.*s,%u\r\n",
+                       processId,
+                       static_cast<int>(ResultName(static_cast<EResult>(i)).length()),
+                       ResultName(static_cast<EResult>(i)).data(),
+                       (unsigned int)numFailuresForResult)
+                       .AsStringView();
+      }
+
+      if (false == statisticsCollected) return summary;
+
+      const uint64_t ticksPerMicrosecond = MeasureTicksPerMicrosecond();
+
+      for (uint32_t i = 0; i < numRecords; ++i)
+      {
+        const SharedStatistics::SRecord& record = records[i];
+
+        summary += Infra::Strings::Format(
+                       L"hook,%u,0x%llx,0x%llx,",
+                       processId,
+                       (unsigned long long)record.originalFunc,
+                       (unsigned long long)record.hookFunc)
+                       .AsStringView();
+        if (0 != (record.flags & SharedStatistics::kRecordFlagInstrumented))
+          summary +=
+              Infra::Strings::Format(L"%llu", (unsigned long long)record.callCount).AsStringView();
+        summary += L",";
+
+        if (0 != (record.flags & SharedStatistics::kRecordFlagSampled))
+        {
+          summary += Infra::Strings::Format(L"%llu,", (unsigned long long)record.numSampledCalls)
+                         .AsStringView();
+          if ((0 != record.numSampledCalls) && (0 != ticksPerMicrosecond))
+            summary += Infra::Strings::Format(
+                           L"%llu",
+                           (unsigned long long)(record.sampledLatencyTicks / ticksPerMicrosecond))
+                           .AsStringView();
+        }
+        else
+        {
+          summary += L",";
+        }
+        summary += L"\r\n";
+      }
+
+      return summary;
+    }
+
+    /// Opens the summary file for appending, first renaming it if it has grown too large.
+    /// @param [in] filename Name of the summary file.
+    /// @return Handle to the summary file, opened for overlapped I/O, or `INVALID_HANDLE_VALUE` on
+    /// failure.
+    static HANDLE OpenSummaryFile(std::wstring_view filename)
+    {
+      constexpr DWORD kShareMode = (FILE_SHARE_READ | FILE_SHARE_WRITE | FILE_SHARE_DELETE);
+
+      HANDLE summaryFile = CreateFile(
+          filename.data(),
+          (FILE_APPEND_DATA | FILE_READ_ATTRIBUTES),
+          kShareMode,
+          nullptr,
+          OPEN_ALWAYS,
+          (FILE_ATTRIBUTE_NORMAL | FILE_FLAG_OVERLAPPED),
+          nullptr);
+      if (INVALID_HANDLE_VALUE == summaryFile) return INVALID_HANDLE_VALUE;
+
+      LARGE_INTEGER summaryFileSize = {};
+      if ((FALSE == GetFileSizeEx(summaryFile, &summaryFileSize)) ||
+          (summaryFileSize.QuadPart <= kMaxFileSizeBytes))
+        return summaryFile;
+
+      // Another exiting process might rename the file at the same time, in which case one of the
+      // two renamed files is lost. That is acceptable for a file that only holds recent history.
+      Protected::Windows_CloseHandle(summaryFile);
+
+      Infra::TemporaryString oldSummaryFilename;
+      oldSummaryFilename << filename << L".old";
+      MoveFileEx(filename.data(), oldSummaryFilename.AsCString(), MOVEFILE_REPLACE_EXISTING);
+
+      return CreateFile(
+          filename.data(),
+          (FILE_APPEND_DATA | FILE_READ_ATTRIBUTES),
+          kShareMode,
+          nullptr,
+          OPEN_ALWAYS,
+          (FILE_ATTRIBUTE_NORMAL | FILE_FLAG_OVERLAPPED),
+          nullptr);
+    }
+
+    bool IsEnabled(void)
+    {
+      static const bool exitSummaryEnabled =
+          Globals::GetConfigurationData()
+              [Infra::Configuration::kSectionNameGlobal]
+              [Strings::kStrConfigurationSettingNameWriteExitSummary]
+                  .ValueOr(false);
+
+      return exitSummaryEnabled;
+    }
+
+    void RecordInstall(EResult result, std::chrono::steady_clock::time_point startTime)
+    {
+      if (false == IsEnabled()) return;
+
+      GetClockReference();
+      AddInstallDuration(startTime);
+      CountResult(result);
+    }
+
+    void RecordInstallBatch(
+        const EResult* results, size_t numResults, std::chrono::steady_clock::time_point startTime)
+    {
+      if (false == IsEnabled()) return;
+
+      GetClockReference();
+      AddInstallDuration(startTime);
+      for (size_t i = 0; i < numResults; ++i)
+        CountResult(results[i]);
+    }
+
+    void Write(void)
+    {
+      if (false == IsEnabled()) return;
+
+      const std::wstring summary = GenerateSummary();
+
+      const int summaryUtf8Length = WideCharToMultiByte(
+          CP_UTF8,
+          0,
+          summary.data(),
+          static_cast<int>(summary.length()),
+          nullptr,
+          0,
+          nullptr,
+          nullptr);
+      if (summaryUtf8Length <= 0) return;
+
+      std::string summaryUtf8(static_cast<size_t>(summaryUtf8Length), '\0');
+      WideCharToMultiByte(
+          CP_UTF8,
+          0,
+          summary.data(),
+          static_cast<int>(summary.length()),
+          summaryUtf8.data(),
+          summaryUtf8Length,
+          nullptr,
+          nullptr);
+
+      const Infra::TemporaryString summaryFilename = Strings::ExitSummaryFilename();
+      const HANDLE summaryFile = OpenSummaryFile(summaryFilename.AsStringView());
+      if (INVALID_HANDLE_VALUE == summaryFile) return;
+
+      const HANDLE writeCompleteEvent =
+          Protected::Windows_CreateEvent(nullptr, TRUE, FALSE, nullptr);
+      if (nullptr == writeCompleteEvent)
+      {
+        Protected::Windows_CloseHandle(summaryFile);
+        return;
+      }
+
+      // Both offsets set to all ones means the data are appended to the end of the file, which
+      // keeps all of the rows from this process together even if other processes are also
+      // appending to the same file.
+      OVERLAPPED overlapped = {};
+      overlapped.Offset = 0xffffffff;
+      overlapped.OffsetHigh = 0xffffffff;
+      overlapped.hEvent = writeCompleteEvent;
+
+      DWORD numBytesWritten = 0;
+      if ((FALSE ==
+           WriteFile(
+               summaryFile,
+               summaryUtf8.data(),
+               static_cast<DWORD>(summaryUtf8.length()),
+               nullptr,
+               &overlapped)) &&
+          (ERROR_IO_PENDING == GetLastError()))
+      {
+        // The write is abandoned rather than allowed to hold up process exit. It must still be
+        // waited for after being cancelled, since the buffer and the overlapped structure have to
+        // remain valid until then.
+        if (WAIT_OBJECT_0 !=
+            Protected::Windows_WaitForSingleObject(writeCompleteEvent, kWriteTimeoutMilliseconds))
+          CancelIoEx(summaryFile, &overlapped);
+
+        GetOverlappedResult(summaryFile, &overlapped, &numBytesWritten, TRUE);
+      }
+
+      Protected::Windows_CloseHandle(writeCompleteEvent);
+      Protected::Windows_CloseHandle(summaryFile);
+    }
+  } // namespace ExitSummary
+} // namespace Hookshot
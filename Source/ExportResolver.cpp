@@ -0,0 +1,462 @@
+/***************************************************************************************************
+ * Hookshot
+ *   General-purpose library for injecting DLLs and hooking function calls.
+ ***************************************************************************************************
+ * Authored by Samuel Grossman
+ * Copyright (c) 2019-2025
+ ***********************************************************************************************//**
+ * @file ExportResolver.cpp
+ *   Implementation of resolving procedures exported by modules.
+ **************************************************************************************************/
+
+#include "ExportResolver.h"
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <string_view>
+#include <vector>
+
+#include "ApiWindows.h"
+#include "DependencyProtect.h"
+
+namespace Hookshot
+{
+  namespace ExportResolver
+  {
+    /// Translates a range of relative virtual addresses into a pointer within viewed memory.
+    /// @param [in] exportTableView View of the export table.
+    /// @param [in] relativeAddress Relative virtual address of the beginning of the range.
+    /// @param [in] size Size of the range, in bytes.
+    /// @return Pointer to the beginning of the range, or `nullptr` if any part of the range lies
+    /// outside of viewed memory.
+    static const uint8_t* TranslateRelativeAddress(
+        const SExportTableView& exportTableView, const DWORD relativeAddress, const size_t size)
+    {
+      if (relativeAddress < exportTableView.dataRelativeAddress) return nullptr;
+
+      const size_t offset =
+          static_cast<size_t>(relativeAddress - exportTableView.dataRelativeAddress);
+      if ((offset > exportTableView.dataSize) || (size > (exportTableView.dataSize - offset)))
+        return nullptr;
+
+      return &exportTableView.data[offset];
+    }
+
+    /// Retrieves an export name from viewed memory.
+    /// @param [in] exportTableView View of the export table.
+    /// @param [in] nameRelativeAddress Relative virtual address of the name string.
+    /// @return View of the name string, which is empty if it lies outside of viewed memory.
+    static std::string_view ExportNameAt(
+        const SExportTableView& exportTableView, const DWORD nameRelativeAddress)
+    {
+      const char* const name = reinterpret_cast<const char*>(
+          TranslateRelativeAddress(exportTableView, nameRelativeAddress, 1));
+      if (nullptr == name) return std::string_view();
+
+      const size_t maxLength = static_cast<size_t>(
+          &exportTableView.data[exportTableView.dataSize] - reinterpret_cast<const uint8_t*>(name));
+      const void* const terminator = memchr(name, '\0', maxLength);
+      if (nullptr == terminator) return std::string_view();
+
+      return std::string_view(name, static_cast<const char*>(terminator) - name);
+    }
+
+    /// Determines if the relative virtual address of an exported procedure identifies a forwarder
+    /// string, which names a procedure in some other module, rather than the procedure itself.
+    /// Forwarder strings are located within the export directory.
+    /// @param [in] exportTableView View of the export table.
+    /// @param [in] procRelativeAddress Relative virtual address of the exported procedure.
+    /// @return `true` if the address identifies a forwarder string, `false` otherwise.
+    static inline bool IsForwarderRelativeAddress(
+        const SExportTableView& exportTableView, const DWORD procRelativeAddress)
+    {
+      return (
+          (procRelativeAddress >= exportTableView.exportDirectoryRelativeAddress) &&
+          (procRelativeAddress <
+           (exportTableView.exportDirectoryRelativeAddress + exportTableView.exportDirectorySize)));
+    }
+
+    bool CreateLocalExportTableView(HMODULE moduleHandle, SExportTableView* exportTableView)
+    {
+      if (nullptr == moduleHandle) return false;
+
+      const uint8_t* const moduleBase = reinterpret_cast<const uint8_t*>(moduleHandle);
+      const IMAGE_DOS_HEADER* const dosHeader =
+          reinterpret_cast<const IMAGE_DOS_HEADER*>(moduleBase);
+      if (IMAGE_DOS_SIGNATURE != dosHeader->e_magic) return false;
+
+      const IMAGE_NT_HEADERS* const ntHeaders =
+          reinterpret_cast<const IMAGE_NT_HEADERS*>(&moduleBase[dosHeader->e_lfanew]);
+      if (IMAGE_NT_SIGNATURE != ntHeaders->Signature) return false;
+
+      const IMAGE_DATA_DIRECTORY& exportDataDirectory =
+          ntHeaders->OptionalHeader.DataDirectory[IMAGE_DIRECTORY_ENTRY_EXPORT];
+      if ((0 == exportDataDirectory.VirtualAddress) || (0 == exportDataDirectory.Size))
+        return false;
+
+      *exportTableView = {
+          .data = moduleBase,
+          .dataRelativeAddress = 0,
+          .dataSize = ntHeaders->OptionalHeader.SizeOfImage,
+          .exportDirectoryRelativeAddress = exportDataDirectory.VirtualAddress,
+          .exportDirectorySize = exportDataDirectory.Size};
+      return true;
+    }
+
+    size_t ResolveExports(
+        const SExportTableView& exportTableView,
+        const std::string_view* procNames,
+        size_t numProcNames,
+        DWORD* procRelativeAddresses,
+        std::string_view* forwarders)
+    {
+      for (size_t i = 0; i < numProcNames; ++i)
+        procRelativeAddresses[i] = 0;
+
+      if (nullptr != forwarders)
+      {
+        for (size_t i = 0; i < numProcNames; ++i)
+          forwarders[i] = std::string_view();
+      }
+
+      // The export directory contains pointers to three arrays: (1) An array of export function
+      // names (each element being a 4-byte relative virtual address of the beginning of the name
+      // string), sorted lexically so that it can be binary searched (2) An array of name ordinals
+      // (each element being a 2-byte index into the array below) (3) An array of export function
+      // relative virtual addresses (each element being a 4-byte relative virtual address of the
+      // starting location of the function). All three are validated once for the whole batch.
+      const IMAGE_EXPORT_DIRECTORY* const exportDirectory =
+          reinterpret_cast<const IMAGE_EXPORT_DIRECTORY*>(TranslateRelativeAddress(
+              exportTableView,
+              exportTableView.exportDirectoryRelativeAddress,
+              sizeof(IMAGE_EXPORT_DIRECTORY)));
+      if (nullptr == exportDirectory) return 0;
+
+      const DWORD* const exportFunctionNameArray =
+          reinterpret_cast<const DWORD*>(TranslateRelativeAddress(
+              exportTableView,
+              exportDirectory->AddressOfNames,
+              sizeof(DWORD) * static_cast<size_t>(exportDirectory->NumberOfNames)));
+      const WORD* const exportFunctionNameOrdinalArray =
+          reinterpret_cast<const WORD*>(TranslateRelativeAddress(
+              exportTableView,
+              exportDirectory->AddressOfNameOrdinals,
+              sizeof(WORD) * static_cast<size_t>(exportDirectory->NumberOfNames)));
+      const DWORD* const exportFunctionAddressArray =
+          reinterpret_cast<const DWORD*>(TranslateRelativeAddress(
+              exportTableView,
+              exportDirectory->AddressOfFunctions,
+              sizeof(DWORD) * static_cast<size_t>(exportDirectory->NumberOfFunctions)));
+      if ((nullptr == exportFunctionNameArray) || (nullptr == exportFunctionNameOrdinalArray) ||
+          (nullptr == exportFunctionAddressArray))
+        return 0;
+
+      size_t numResolved = 0;
+
+      for (size_t i = 0; i < numProcNames; ++i)
+      {
+        size_t searchBegin = 0;
+        size_t searchEnd = static_cast<size_t>(exportDirectory->NumberOfNames);
+
+        while (searchBegin < searchEnd)
+        {
+          const size_t searchMiddle = searchBegin + ((searchEnd - searchBegin) / 2);
+          const int comparison =
+              ExportNameAt(exportTableView, exportFunctionNameArray[searchMiddle])
+                  .compare(procNames[i]);
+
+          if (comparison < 0)
+          {
+            searchBegin = searchMiddle + 1;
+          }
+          else if (comparison > 0)
+          {
+            searchEnd = searchMiddle;
+          }
+          else
+          {
+            const WORD ordinal = exportFunctionNameOrdinalArray[searchMiddle];
+            if (ordinal >= exportDirectory->NumberOfFunctions) break;
+
+            const DWORD procRelativeAddress = exportFunctionAddressArray[ordinal];
+            if (true == IsForwarderRelativeAddress(exportTableView, procRelativeAddress))
+            {
+              if (nullptr != forwarders)
+                forwarders[i] = ExportNameAt(exportTableView, procRelativeAddress);
+              break;
+            }
+
+            procRelativeAddresses[i] = procRelativeAddress;
+            numResolved += 1;
+            break;
+          }
+        }
+      }
+
+      return numResolved;
+    }
+
+    /// Maximum number of forwarders followed when resolving a single procedure. Forwarders can be
+    /// chained, such as from an API set contract to a compatibility module to the module that
+    /// actually implements the procedure, but never deeply, so a longer chain is most likely a
+    /// cycle.
+    static constexpr unsigned int kMaxForwardersFollowed = 4;
+
+    static void* ResolveLocalForwarder(
+        std::string_view forwarder, unsigned int numForwardersFollowed);
+
+    /// Locates the module named by a forwarder string in the current process. Forwarder strings
+    /// generally omit the module's file extension, in which case it is assumed to be ".dll", just
+    /// as the loader does. Modules are never loaded, only found if they are already loaded.
+    /// @param [in] moduleName Module name portion of the forwarder string.
+    /// @return Handle of the module, or `nullptr` if it is not loaded.
+    static HMODULE FindForwarderTargetModule(std::string_view moduleName)
+    {
+      static constexpr std::wstring_view kDefaultExtension = L".dll";
+
+      const bool needsExtension = (std::string_view::npos == moduleName.find('.'));
+      const size_t moduleNameLength =
+          moduleName.length() + ((true == needsExtension) ? kDefaultExtension.length() : 0);
+      if ((true == moduleName.empty()) || (moduleNameLength >= MAX_PATH)) return nullptr;
+
+      // Export tables are ASCII, so widening each character is a complete conversion.
+      wchar_t moduleNameWide[MAX_PATH];
+      for (size_t i = 0; i < moduleName.length(); ++i)
+      {
+        if (static_cast<unsigned char>(moduleName[i]) > 0x7f) return nullptr;
+        moduleNameWide[i] = static_cast<wchar_t>(moduleName[i]);
+      }
+
+      if (true == needsExtension)
+        kDefaultExtension.copy(&moduleNameWide[moduleName.length()], kDefaultExtension.length());
+
+      moduleNameWide[moduleNameLength] = L'\0';
+
+      HMODULE moduleHandle = nullptr;
+      if (FALSE ==
+          Protected::Windows_GetModuleHandleEx(
+              GET_MODULE_HANDLE_EX_FLAG_UNCHANGED_REFCOUNT, moduleNameWide, &moduleHandle))
+        return nullptr;
+
+      return moduleHandle;
+    }
+
+    /// Computes the address of a procedure exported by a module loaded in the current process from
+    /// its relative virtual address, following it if it identifies a forwarder string.
+    /// @param [in] moduleHandle Handle of the module that exports the procedure.
+    /// @param [in] exportTableView View of the module's export table.
+    /// @param [in] procRelativeAddress Relative virtual address of the exported procedure.
+    /// @param [in] numForwardersFollowed Number of forwarders already followed to reach the module.
+    /// @return Address of the procedure, or `nullptr` if it could not be resolved.
+    static void* LocalProcAddressFromRelativeAddress(
+        HMODULE moduleHandle,
+        const SExportTableView& exportTableView,
+        const DWORD procRelativeAddress,
+        unsigned int numForwardersFollowed)
+    {
+      if (0 == procRelativeAddress) return nullptr;
+
+      if (true == IsForwarderRelativeAddress(exportTableView, procRelativeAddress))
+        return ResolveLocalForwarder(
+            ExportNameAt(exportTableView, procRelativeAddress), numForwardersFollowed);
+
+      return reinterpret_cast<void*>(
+          reinterpret_cast<size_t>(moduleHandle) + static_cast<size_t>(procRelativeAddress));
+    }
+
+    /// Retrieves the address of a procedure exported by ordinal from a module loaded in the current
+    /// process, following forwarders.
+    /// @param [in] moduleHandle Handle of the module that exports the procedure.
+    /// @param [in] ordinal Ordinal of the exported procedure, which includes the ordinal base.
+    /// @param [in] numForwardersFollowed Number of forwarders already followed to reach the module.
+    /// @return Address of the procedure, or `nullptr` if it could not be resolved.
+    static void* GetLocalProcAddressByOrdinal(
+        HMODULE moduleHandle, const DWORD ordinal, unsigned int numForwardersFollowed)
+    {
+      SExportTableView exportTableView;
+      if (false == CreateLocalExportTableView(moduleHandle, &exportTableView)) return nullptr;
+
+      const IMAGE_EXPORT_DIRECTORY* const exportDirectory =
+          reinterpret_cast<const IMAGE_EXPORT_DIRECTORY*>(TranslateRelativeAddress(
+              exportTableView,
+              exportTableView.exportDirectoryRelativeAddress,
+              sizeof(IMAGE_EXPORT_DIRECTORY)));
+      if (nullptr == exportDirectory) return nullptr;
+
+      if ((ordinal < exportDirectory->Base) ||
+          ((ordinal - exportDirectory->Base) >= exportDirectory->NumberOfFunctions))
+        return nullptr;
+
+      const DWORD* const exportFunctionAddressArray =
+          reinterpret_cast<const DWORD*>(TranslateRelativeAddress(
+              exportTableView,
+              exportDirectory->AddressOfFunctions,
+              sizeof(DWORD) * static_cast<size_t>(exportDirectory->NumberOfFunctions)));
+      if (nullptr == exportFunctionAddressArray) return nullptr;
+
+      return LocalProcAddressFromRelativeAddress(
+          moduleHandle,
+          exportTableView,
+          exportFunctionAddressArray[ordinal - exportDirectory->Base],
+          numForwardersFollowed);
+    }
+
+    /// Retrieves the address of a procedure exported by name from a module loaded in the current
+    /// process, following forwarders.
+    /// @param [in] moduleHandle Handle of the module that exports the procedure.
+    /// @param [in] procName Name of the exported procedure.
+    /// @param [in] numForwardersFollowed Number of forwarders already followed to reach the module.
+    /// @return Address of the procedure, or `nullptr` if it could not be resolved.
+    static void* GetLocalProcAddressByName(
+        HMODULE moduleHandle, std::string_view procName, unsigned int numForwardersFollowed)
+    {
+      SExportTableView exportTableView;
+      if (false == CreateLocalExportTableView(moduleHandle, &exportTableView)) return nullptr;
+
+      DWORD procRelativeAddress = 0;
+      std::string_view forwarder;
+      if (1 == ResolveExports(exportTableView, &procName, 1, &procRelativeAddress, &forwarder))
+        return reinterpret_cast<void*>(
+            reinterpret_cast<size_t>(moduleHandle) + static_cast<size_t>(procRelativeAddress));
+
+      if (true == forwarder.empty()) return nullptr;
+      return ResolveLocalForwarder(forwarder, numForwardersFollowed);
+    }
+
+    /// Resolves a forwarder string to the address of the procedure it names, following any
+    /// further forwarders along the way. Forwarder strings have the form `Module.ProcName` or
+    /// `Module.#Ordinal`. Module names can themselves contain periods but procedure names cannot,
+    /// so the last period separates the two.
+    /// @param [in] forwarder Forwarder string to resolve.
+    /// @param [in] numForwardersFollowed Number of forwarders already followed to reach it.
+    /// @return Address of the procedure, or `nullptr` if it could not be resolved.
+    static void* ResolveLocalForwarder(
+        std::string_view forwarder, unsigned int numForwardersFollowed)
+    {
+      if (numForwardersFollowed >= kMaxForwardersFollowed) return nullptr;
+
+      const size_t separatorPosition = forwarder.rfind('.');
+      if ((std::string_view::npos == separatorPosition) || (0 == separatorPosition))
+        return nullptr;
+
+      const HMODULE targetModule =
+          FindForwarderTargetModule(forwarder.substr(0, separatorPosition));
+      if (nullptr == targetModule) return nullptr;
+
+      const std::string_view targetProcName = forwarder.substr(separatorPosition + 1);
+      if (true == targetProcName.empty()) return nullptr;
+
+      if ('#' == targetProcName[0])
+      {
+        DWORD ordinal = 0;
+        for (const char digit : targetProcName.substr(1))
+        {
+          if ((digit < '0') || (digit > '9') || (ordinal > 0xffff)) return nullptr;
+          ordinal = (ordinal * 10) + static_cast<DWORD>(digit - '0');
+        }
+
+        return GetLocalProcAddressByOrdinal(targetModule, ordinal, numForwardersFollowed + 1);
+      }
+
+      return GetLocalProcAddressByName(targetModule, targetProcName, numForwardersFollowed + 1);
+    }
+
+    void* GetLocalProcAddress(HMODULE moduleHandle, std::string_view procName)
+    {
+      return GetLocalProcAddressByName(moduleHandle, procName, 0);
+    }
+
+    size_t GetLocalProcAddresses(
+        HMODULE moduleHandle,
+        const std::string_view* procNames,
+        size_t numProcNames,
+        void** procAddresses)
+    {
+      for (size_t i = 0; i < numProcNames; ++i)
+        procAddresses[i] = nullptr;
+
+      SExportTableView exportTableView;
+      if (false == CreateLocalExportTableView(moduleHandle, &exportTableView)) return 0;
+
+      std::vector<DWORD> procRelativeAddresses(numProcNames, 0);
+      std::vector<std::string_view> forwarders(numProcNames);
+      ResolveExports(
+          exportTableView,
+          procNames,
+          numProcNames,
+          procRelativeAddresses.data(),
+          forwarders.data());
+
+      size_t numResolved = 0;
+      for (size_t i = 0; i < numProcNames; ++i)
+      {
+        if (0 != procRelativeAddresses[i])
+          procAddresses[i] = LocalProcAddressFromRelativeAddress(
+              moduleHandle, exportTableView, procRelativeAddresses[i], 0);
+        else if (false == forwarders[i].empty())
+          procAddresses[i] = ResolveLocalForwarder(forwarders[i], 0);
+
+        if (nullptr != procAddresses[i]) numResolved += 1;
+      }
+
+      return numResolved;
+    }
+
+    std::vector<void*> GetLocalCodeExports(HMODULE moduleHandle)
+    {
+      std::vector<void*> codeExports;
+
+      SExportTableView exportTableView;
+      if (false == CreateLocalExportTableView(moduleHandle, &exportTableView)) return codeExports;
+
+      const IMAGE_EXPORT_DIRECTORY* const exportDirectory =
+          reinterpret_cast<const IMAGE_EXPORT_DIRECTORY*>(TranslateRelativeAddress(
+              exportTableView,
+              exportTableView.exportDirectoryRelativeAddress,
+              sizeof(IMAGE_EXPORT_DIRECTORY)));
+      if (nullptr == exportDirectory) return codeExports;
+
+      const DWORD* const exportFunctionAddressArray =
+          reinterpret_cast<const DWORD*>(TranslateRelativeAddress(
+              exportTableView,
+              exportDirectory->AddressOfFunctions,
+              sizeof(DWORD) * static_cast<size_t>(exportDirectory->NumberOfFunctions)));
+      if (nullptr == exportFunctionAddressArray) return codeExports;
+
+      // The view was created from the module image, so its headers are known to be valid.
+      const uint8_t* const moduleBase = reinterpret_cast<const uint8_t*>(moduleHandle);
+      const IMAGE_NT_HEADERS* const ntHeaders = reinterpret_cast<const IMAGE_NT_HEADERS*>(
+          &moduleBase[reinterpret_cast<const IMAGE_DOS_HEADER*>(moduleBase)->e_lfanew]);
+      const IMAGE_SECTION_HEADER* const sectionHeaders = IMAGE_FIRST_SECTION(ntHeaders);
+      const WORD numSections = ntHeaders->FileHeader.NumberOfSections;
+
+      codeExports.reserve(static_cast<size_t>(exportDirectory->NumberOfFunctions));
+
+      for (DWORD i = 0; i < exportDirectory->NumberOfFunctions; ++i)
+      {
+        const DWORD procRelativeAddress = exportFunctionAddressArray[i];
+        if ((0 == procRelativeAddress) ||
+            (true == IsForwarderRelativeAddress(exportTableView, procRelativeAddress)))
+          continue;
+
+        for (WORD j = 0; j < numSections; ++j)
+        {
+          if ((0 == (sectionHeaders[j].Characteristics & IMAGE_SCN_MEM_EXECUTE)) ||
+              (procRelativeAddress < sectionHeaders[j].VirtualAddress) ||
+              ((procRelativeAddress - sectionHeaders[j].VirtualAddress) >=
+               sectionHeaders[j].Misc.VirtualSize))
+            continue;
+
+          codeExports.push_back(const_cast<uint8_t*>(&moduleBase[procRelativeAddress]));
+          break;
+        }
+      }
+
+      std::sort(codeExports.begin(), codeExports.end());
+      codeExports.erase(std::unique(codeExports.begin(), codeExports.end()), codeExports.end());
+      return codeExports;
+    }
+  } // namespace ExportResolver
+} // namespace Hookshot
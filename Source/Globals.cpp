@@ -22,10 +22,16 @@
 #ifndef HOOKSHOT_SKIP_CONFIG
 #include <Infra/Core/Configuration.h>
 
+#include "ConfigurationCache.h"
 #include "HookshotConfigReader.h"
+#include "MappedLog.h"
 #include "Strings.h"
 #endif
 
+#include <algorithm>
+#include <atomic>
+#include <cstdint>
+#include <deque>
 #include <mutex>
 #include <string_view>
 
@@ -65,6 +71,25 @@ namespace Hookshot
     };
 
 #ifndef HOOKSHOT_SKIP_CONFIG
+#ifdef HOOKSHOT_CORE_LIBRARY
+    const Infra::Configuration::ConfigurationData& GetConfigurationData(void)
+    {
+      // The core library never reads a configuration file, so every setting has its default value.
+      static Infra::Configuration::ConfigurationData configData;
+      return configData;
+    }
+
+    const SPerformanceProfile& GetPerformanceProfile(void)
+    {
+      // Without a configuration file, every setting in the profile has its default value.
+      static const SPerformanceProfile performanceProfile = {};
+      return performanceProfile;
+    }
+#else
+    /// Set once the log file has been created, after which it remains open for the lifetime of
+    /// the process.
+    static std::atomic<bool> logEnabled = false;
+
     /// Enables the log if it is not already enabled.
     /// Regardless, the minimum severity for output is set based on the parameter.
     /// @param [in] logLevel Logging level to configure as the minimum severity for output.
@@ -76,18 +101,14 @@ namespace Hookshot
           [logLevel]() -> void
           {
             Infra::Message::CreateAndEnableLogFile();
+            logEnabled = true;
           });
 
       Infra::Message::SetMinimumSeverityForOutput(logLevel);
     }
 
-    /// Enables the log, if it is configured in the configuration file.
-    static void EnableLogIfConfigured(void)
+    void ApplyLogLevel(int64_t logLevel)
     {
-      const int64_t logLevel = GetConfigurationData()[Infra::Configuration::kSectionNameGlobal]
-                                                     [Strings::kStrConfigurationSettingNameLogLevel]
-                                                         .ValueOr(0);
-
       if (logLevel > 0)
       {
         // Offset the requested severity so that 0 = disabled, 1 = error, 2 = warning, etc.
@@ -96,6 +117,37 @@ namespace Hookshot
             static_cast<int64_t>(Infra::Message::ESeverity::LowerBoundConfigurableValue));
         EnableLog(configuredSeverity);
       }
+      else if (true == logEnabled)
+      {
+        Infra::Message::SetMinimumSeverityForOutput(Infra::Message::ESeverity::Error);
+      }
+    }
+
+    /// Enables the log, if it is configured in the configuration file.
+    static void EnableLogIfConfigured(void)
+    {
+      const int64_t logLevel = GetRuntimeSettings().logLevel;
+
+      if (logLevel > 0)
+      {
+        ApplyLogLevel(logLevel);
+
+        // Messages not specifically directed to the ring file still go to the log file.
+        const bool logToMappedFile =
+            GetConfigurationData()[Infra::Configuration::kSectionNameGlobal]
+                                  [Strings::kStrConfigurationSettingNameLogToMappedFile]
+                                      .ValueOr(false);
+        const bool shareMappedLogWithChildProcesses =
+            GetConfigurationData()
+                [Infra::Configuration::kSectionNameGlobal]
+                [Strings::kStrConfigurationSettingNameShareMappedLogWithChildProcesses]
+                    .ValueOr(false);
+        if ((true == logToMappedFile) &&
+            (false == MappedLog::Enable(shareMappedLogWithChildProcesses)))
+          Infra::Message::Output(
+              Infra::Message::ESeverity::Warning,
+              L"Failed to create the memory-mapped log file. Messages will be written to the log file instead.");
+      }
     }
 
     const Infra::Configuration::ConfigurationData& GetConfigurationData(void)
@@ -107,6 +159,28 @@ namespace Hookshot
           readConfigFlag,
           []() -> void
           {
+            // Parsing the configuration file is skipped entirely if an up-to-date binary snapshot
+            // of it is available.
+            if (true == ConfigurationCache::ReadConfigurationCache(&configData)) return;
+
+            do
+            {
+              HookshotConfigReader cacheGeneratingConfigReader;
+              cacheGeneratingConfigReader.EnableValueCapture();
+
+              configData = cacheGeneratingConfigReader.ReadConfigurationFile();
+              if (false == cacheGeneratingConfigReader.HasErrorMessages())
+              {
+                ConfigurationCache::WriteConfigurationCache(
+                    cacheGeneratingConfigReader.CapturedValues());
+                return;
+              }
+            }
+            while (false);
+
+            // Sections for other executables are read when generating a snapshot, so errors found
+            // while doing so might not apply to this executable. Reading again in the normal way
+            // ensures that the configuration is only rejected because of relevant errors.
             HookshotConfigReader configReader;
 
             configData = configReader.ReadConfigurationFile();
@@ -133,6 +207,75 @@ namespace Hookshot
 
       return configData;
     }
+
+    const SPerformanceProfile& GetPerformanceProfile(void)
+    {
+      static const SPerformanceProfile performanceProfile =
+          HookshotConfigReader::ReadPerformanceProfile(GetConfigurationData());
+
+      return performanceProfile;
+    }
+#endif
+
+    /// Every version of the runtime-tunable settings ever published. Versions are never freed, so
+    /// a reference obtained from GetRuntimeSettings remains valid even if a newer version is
+    /// published while it is in use. Reloads are rare, so the memory cost is negligible.
+    static std::deque<SRuntimeSettings> runtimeSettingsVersions;
+
+    /// Guards publication of new versions of the runtime-tunable settings.
+    static std::mutex runtimeSettingsMutex;
+
+    /// Most recently published version of the runtime-tunable settings, or `nullptr` if none has
+    /// been published yet.
+    static std::atomic<const SRuntimeSettings*> currentRuntimeSettings = nullptr;
+
+    const SRuntimeSettings& GetRuntimeSettings(void)
+    {
+      const SRuntimeSettings* runtimeSettings = currentRuntimeSettings.load();
+      if (nullptr != runtimeSettings) return *runtimeSettings;
+
+      std::scoped_lock lock(runtimeSettingsMutex);
+
+      runtimeSettings = currentRuntimeSettings.load();
+      if (nullptr != runtimeSettings) return *runtimeSettings;
+
+      runtimeSettingsVersions.push_back(
+          ResolveRuntimeSettings(GetConfigurationData(), GetPerformanceProfile()));
+      currentRuntimeSettings = &runtimeSettingsVersions.back();
+      return runtimeSettingsVersions.back();
+    }
+
+    void PublishRuntimeSettings(const SRuntimeSettings& runtimeSettings)
+    {
+      std::scoped_lock lock(runtimeSettingsMutex);
+
+      runtimeSettingsVersions.push_back(runtimeSettings);
+      currentRuntimeSettings = &runtimeSettingsVersions.back();
+    }
+
+    SRuntimeSettings ResolveRuntimeSettings(
+        const Infra::Configuration::ConfigurationData& configData,
+        const SPerformanceProfile& performanceProfile)
+    {
+      const int64_t logLevel = configData[Infra::Configuration::kSectionNameGlobal]
+                                         [Strings::kStrConfigurationSettingNameLogLevel]
+                                             .ValueOr(0);
+
+      // The countdown in each sampled timing stub and sampled hook stub is a signed 32-bit value.
+      const int64_t sampleInterval = performanceProfile.hookTimingSampleInterval;
+      const int64_t sampledHookInterval = performanceProfile.sampledHookInterval;
+      const int64_t latencyBudget = performanceProfile.hookLatencyBudgetMicroseconds;
+
+      return {
+          .logLevel = std::max<int64_t>(logLevel, 0),
+          .instrumentHooks = performanceProfile.instrumentHooks,
+          .hookTimingSampleInterval =
+              static_cast<uint32_t>(std::clamp<int64_t>(sampleInterval, 0, INT32_MAX)),
+          .sampledHookInterval =
+              static_cast<uint32_t>(std::clamp<int64_t>(sampledHookInterval, 0, INT32_MAX)),
+          .hookLatencyBudgetMicroseconds =
+              static_cast<uint32_t>(std::clamp<int64_t>(latencyBudget, 0, UINT32_MAX))};
+    }
 #endif
 
     ELoadMethod GetHookshotLoadMethod(void)
@@ -162,7 +305,7 @@ namespace Hookshot
     {
       GlobalData::GetInstance().gLoadMethod = loadMethod;
 
-#ifndef HOOKSHOT_SKIP_CONFIG
+#if !defined(HOOKSHOT_SKIP_CONFIG) && !defined(HOOKSHOT_CORE_LIBRARY)
       EnableLogIfConfigured();
 #endif
     }
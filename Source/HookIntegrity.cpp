@@ -0,0 +1,142 @@
+/***************************************************************************************************
+ * Hookshot
+ *   General-purpose library for injecting DLLs and hooking function calls.
+ ***************************************************************************************************
+ * Authored by Samuel Grossman
+ * Copyright (c) 2019-2025
+ ***********************************************************************************************//**
+ * @file HookIntegrity.cpp
+ *   Implementation of detecting and repairing overwritten hook redirections.
+ **************************************************************************************************/
+
+#include "HookIntegrity.h"
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <immintrin.h>
+#include <vector>
+
+#include <Infra/Core/Message.h>
+
+#include "Globals.h"
+#include "HookStore.h"
+#include "SharedStatistics.h"
+#include "TaskScheduler.h"
+
+namespace Hookshot
+{
+  namespace HookIntegrity
+  {
+    /// Reads the current contents of a window.
+    /// @param [in] window Address of the first byte of the window.
+    /// @return Contents of the window.
+    static inline uint64_t ReadWindow(const uint8_t* window)
+    {
+      uint64_t windowBytes = 0;
+      std::memcpy(&windowBytes, window, sizeof(windowBytes));
+      return windowBytes;
+    }
+
+    /// Task that checks every patch site once, counts the repairs, and then schedules the next
+    /// check. Only one check is ever scheduled at a time, so checks never overlap.
+    /// @param [in] context Unused.
+    static void CheckPatchSitesTask(void* context)
+    {
+      const size_t numRepairs = HookStore::RepairOverwrittenPatches();
+      if (0 != numRepairs) SharedStatistics::CountPatchRepairs(static_cast<uint32_t>(numRepairs));
+
+      TaskScheduler::SubmitAfter(kCheckIntervalMilliseconds, CheckPatchSitesTask, nullptr);
+    }
+
+    bool WindowForPatchedRange(
+        size_t patchedBegin,
+        size_t patchedEnd,
+        size_t pageSize,
+        const uint8_t** window,
+        uint64_t* mask)
+    {
+      if ((patchedEnd <= patchedBegin) || ((patchedEnd - patchedBegin) > kWindowSizeBytes))
+        return false;
+
+      // The window normally starts at the first modified byte. If that would make it extend into
+      // the next page, it instead ends at the last modified byte.
+      size_t windowBegin = patchedBegin;
+      if (((patchedBegin + kWindowSizeBytes - 1) & ~(pageSize - 1)) >
+          ((patchedEnd - 1) & ~(pageSize - 1)))
+        windowBegin = patchedEnd - kWindowSizeBytes;
+
+      uint64_t windowMask = 0;
+      for (size_t i = (patchedBegin - windowBegin); i < (patchedEnd - windowBegin); ++i)
+        windowMask |= (0xffull << (i * 8));
+
+      *window = reinterpret_cast<const uint8_t*>(windowBegin);
+      *mask = windowMask;
+      return true;
+    }
+
+    void FindMismatchedPatchSites(const SPatchSites& patchSites, std::vector<size_t>& mismatches)
+    {
+      const size_t numPatchSites = patchSites.windows.size();
+
+      // Each pair of windows is compared with a single 16-byte comparison. The bytes of each
+      // window that do not belong to its patch site are masked away, so they always compare equal.
+      size_t i = 0;
+      for (; (i + 2) <= numPatchSites; i += 2)
+      {
+        const __m128i actualBytes = _mm_set_epi64x(
+            static_cast<long long>(ReadWindow(patchSites.windows[i + 1])),
+            static_cast<long long>(ReadWindow(patchSites.windows[i])));
+        const __m128i expectedBytes =
+            _mm_loadu_si128(reinterpret_cast<const __m128i*>(&patchSites.expectedBytes[i]));
+        const __m128i masks =
+            _mm_loadu_si128(reinterpret_cast<const __m128i*>(&patchSites.masks[i]));
+
+        const int equalBytes = _mm_movemask_epi8(_mm_cmpeq_epi8(
+            _mm_and_si128(_mm_xor_si128(actualBytes, expectedBytes), masks),
+            _mm_setzero_si128()));
+        if (0xffff == equalBytes) continue;
+
+        if (0x00ff != (equalBytes & 0x00ff)) mismatches.push_back(i);
+        if (0xff00 != (equalBytes & 0xff00)) mismatches.push_back(i + 1);
+      }
+
+      if ((i < numPatchSites) &&
+          (0 !=
+           ((ReadWindow(patchSites.windows[i]) ^ patchSites.expectedBytes[i]) &
+            patchSites.masks[i])))
+        mismatches.push_back(i);
+    }
+
+    bool IsEnabled(void)
+    {
+      static const bool hookIntegrityMonitorEnabled =
+          Globals::GetPerformanceProfile().monitorHookIntegrity;
+
+      return hookIntegrityMonitorEnabled;
+    }
+
+    void StartMonitor(void)
+    {
+      if (false == IsEnabled()) return;
+
+      static std::atomic<bool> monitorStarted = false;
+      if (true == monitorStarted.exchange(true)) return;
+
+      if (false ==
+          TaskScheduler::SubmitAfter(kCheckIntervalMilliseconds, CheckPatchSitesTask, nullptr))
+      {
+        Infra::Message::Output(
+            Infra::Message::ESeverity::Warning,
+            L"Hook integrity will not be monitored because no background task can be scheduled.");
+        return;
+      }
+
+      Infra::Message::OutputFormatted(
+          Infra::Message::ESeverity::Info,
+          L"Checking hook integrity every %u milliseconds.",
+          kCheckIntervalMilliseconds);
+    }
+  } // namespace HookIntegrity
+} // namespace Hookshot
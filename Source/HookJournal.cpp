@@ -0,0 +1,74 @@
+/***************************************************************************************************
+ * Hookshot
+ *   General-purpose library for injecting DLLs and hooking function calls.
+ ***************************************************************************************************
+ * Authored by Samuel Grossman
+ * Copyright (c) 2019-2025
+ ***********************************************************************************************//**
+ * @file HookJournal.cpp
+ *   Implementation of a compact journal of trampoline set-up operations.
+ **************************************************************************************************/
+
+#include "HookJournal.h"
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+
+#include <Infra/Core/Message.h>
+
+namespace Hookshot
+{
+  namespace HookJournal
+  {
+    /// Severity at which journal records are formatted and output as messages.
+    static constexpr Infra::Message::ESeverity kRecordSeverity = Infra::Message::ESeverity::Info;
+
+    /// Ring buffer holding the most recent journal records. Zero-initialized, so it is usable even
+    /// during dynamic initialization. Retained records can be inspected using a debugger or in a
+    /// crash dump even if they were never output as messages.
+    static SRecord records[kCapacity];
+
+    /// Total number of records ever reserved. Each record goes into the slot identified by the
+    /// low-order bits of the value reserved for it.
+    static std::atomic<uint64_t> numRecordsAppended = 0;
+
+    /// Formats the specified record and outputs it as a message.
+    /// @param [in] record Record to output.
+    static void OutputRecord(const SRecord& record)
+    {
+      switch (record.operation)
+      {
+        case EOperation::SetHookFunction:
+          Infra::Message::OutputFormatted(
+              kRecordSeverity,
+              L"Trampoline at 0x%llx was set up with hook function 0x%llx.",
+              (long long)record.trampoline,
+              (long long)record.hookFunc);
+          break;
+
+        case EOperation::SetOriginalFunction:
+          Infra::Message::OutputFormatted(
+              kRecordSeverity,
+              L"Trampoline at 0x%llx %s set up with original function 0x%llx after decoding %d byte(s)%s.",
+              (long long)record.trampoline,
+              ((true == record.succeeded) ? L"was" : L"could not be"),
+              (long long)record.originalFunc,
+              static_cast<int>(record.numDecodedBytes),
+              ((true == record.usedJumpAssist) ? L" using a jump assist" : L""));
+          break;
+
+        default:
+          break;
+      }
+    }
+
+    void Record(const SRecord& record)
+    {
+      const uint64_t recordIndex = numRecordsAppended.fetch_add(1, std::memory_order_relaxed);
+      records[recordIndex & (kCapacity - 1)] = record;
+
+      if (Infra::Message::WillOutputMessageOfSeverity(kRecordSeverity)) OutputRecord(record);
+    }
+  } // namespace HookJournal
+} // namespace Hookshot
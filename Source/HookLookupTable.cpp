@@ -0,0 +1,288 @@
+/***************************************************************************************************
+ * Hookshot
+ *   General-purpose library for injecting DLLs and hooking function calls.
+ ***************************************************************************************************
+ * Authored by Samuel Grossman
+ * Copyright (c) 2019-2025
+ ***********************************************************************************************//**
+ * @file HookLookupTable.cpp
+ *   Data structure implementation for lock-free lookup of trampolines by function address.
+ **************************************************************************************************/
+
+#include "HookLookupTable.h"
+
+#include <algorithm>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <numeric>
+#include <vector>
+
+namespace Hookshot
+{
+  HookLookupTable::HookLookupTable(void)
+      : currentTable(nullptr), allTables(), currentSealedTable(nullptr), allSealedTables()
+  {}
+
+  Trampoline* HookLookupTable::Find(const void* func) const
+  {
+    if (nullptr == func) return nullptr;
+
+    // A sealed table holds every entry, so whatever its one candidate slot holds is the answer.
+    const SSealedTable* const sealedTable = currentSealedTable.load(std::memory_order_acquire);
+    if (nullptr != sealedTable)
+    {
+      const SSealedSlot& sealedSlot = sealedTable->slots[SealedSlotIndexForKey(*sealedTable, func)];
+      return ((sealedSlot.key == func) ? sealedSlot.value : nullptr);
+    }
+
+    const STable* const table = currentTable.load(std::memory_order_acquire);
+    if (nullptr == table) return nullptr;
+
+    for (size_t probe = 0, index = SlotIndexForKey(func, table->capacity); probe < table->capacity;
+         ++probe, index = (index + 1) & (table->capacity - 1))
+    {
+      const void* const slotKey = table->slots[index].key.load(std::memory_order_acquire);
+
+      if (slotKey == func) return table->slots[index].value.load(std::memory_order_acquire);
+      if (nullptr == slotKey) return nullptr;
+    }
+
+    return nullptr;
+  }
+
+  void HookLookupTable::Insert(const void* func, Trampoline* trampoline)
+  {
+    if (nullptr == func) return;
+
+    Unseal();
+
+    // Tables are created lazily to avoid allocating during library static initialization.
+    // Growth happens before the table reaches 75% occupancy, tombstones included, which keeps
+    // probe sequences short and guarantees that every probe sequence eventually hits an empty slot.
+    STable* table = currentTable.load(std::memory_order_relaxed);
+    if ((nullptr == table) || (((table->numOccupied + 1) * 4) > (table->capacity * 3)))
+    {
+      Grow();
+      table = currentTable.load(std::memory_order_relaxed);
+    }
+
+    for (size_t index = SlotIndexForKey(func, table->capacity);;
+         index = (index + 1) & (table->capacity - 1))
+    {
+      SSlot& slot = table->slots[index];
+      const void* const slotKey = slot.key.load(std::memory_order_relaxed);
+
+      if (slotKey == func)
+      {
+        slot.value.store(trampoline, std::memory_order_release);
+        return;
+      }
+
+      if (nullptr == slotKey)
+      {
+        // Value must be visible before the key, otherwise a concurrent reader could match the key
+        // and read a stale value.
+        slot.value.store(trampoline, std::memory_order_relaxed);
+        slot.key.store(func, std::memory_order_release);
+        table->numOccupied += 1;
+        return;
+      }
+    }
+  }
+
+  void HookLookupTable::Erase(const void* func)
+  {
+    if (nullptr == func) return;
+
+    Unseal();
+
+    STable* const table = currentTable.load(std::memory_order_relaxed);
+    if (nullptr == table) return;
+
+    for (size_t probe = 0, index = SlotIndexForKey(func, table->capacity); probe < table->capacity;
+         ++probe, index = (index + 1) & (table->capacity - 1))
+    {
+      SSlot& slot = table->slots[index];
+      const void* const slotKey = slot.key.load(std::memory_order_relaxed);
+
+      if (slotKey == func)
+      {
+        slot.value.store(nullptr, std::memory_order_release);
+        return;
+      }
+
+      if (nullptr == slotKey) return;
+    }
+  }
+
+  size_t HookLookupTable::HeapBytes(void) const
+  {
+    size_t heapBytes = allTables.capacity() * sizeof(allTables[0]);
+    for (const auto& table : allTables)
+      heapBytes += sizeof(STable) + (table->capacity * sizeof(SSlot));
+
+    heapBytes += allSealedTables.capacity() * sizeof(allSealedTables[0]);
+    for (const auto& sealedTable : allSealedTables)
+      heapBytes += sizeof(SSealedTable) + (sealedTable->numBuckets * sizeof(uint32_t)) +
+          (sealedTable->capacity * sizeof(SSealedSlot));
+
+    return heapBytes;
+  }
+
+  bool HookLookupTable::Seal(void)
+  {
+    std::vector<SSealedSlot> entries;
+
+    const STable* const table = currentTable.load(std::memory_order_relaxed);
+    if (nullptr != table)
+    {
+      entries.reserve(table->numOccupied);
+      for (size_t index = 0; index < table->capacity; ++index)
+      {
+        const void* const key = table->slots[index].key.load(std::memory_order_relaxed);
+        Trampoline* const value = table->slots[index].value.load(std::memory_order_relaxed);
+        if ((nullptr == key) || (nullptr == value)) continue;
+
+        entries.push_back({.key = key, .value = value});
+      }
+    }
+
+    // Keeping the table at most half full makes it very likely that every bucket quickly finds a
+    // seed that works. Failure is just as likely to be overcome by more space as by more seeds.
+    size_t capacity = 1;
+    while (capacity < (entries.size() * 2))
+      capacity *= 2;
+
+    for (int i = 0; i <= kSealedMaxCapacityDoublings; ++i, capacity *= 2)
+    {
+      std::unique_ptr<SSealedTable> sealedTable = BuildSealedTable(entries, capacity);
+      if (nullptr == sealedTable) continue;
+
+      currentSealedTable.store(sealedTable.get(), std::memory_order_release);
+      allSealedTables.push_back(std::move(sealedTable));
+      return true;
+    }
+
+    return false;
+  }
+
+  std::unique_ptr<HookLookupTable::SSealedTable> HookLookupTable::BuildSealedTable(
+      const std::vector<SSealedSlot>& entries, size_t capacity)
+  {
+    auto sealedTable = std::make_unique<SSealedTable>();
+    sealedTable->capacity = capacity;
+    sealedTable->numBuckets = 1;
+    while ((sealedTable->numBuckets * kSealedKeysPerBucket) < entries.size())
+      sealedTable->numBuckets *= 2;
+    sealedTable->bucketSeeds = std::make_unique<uint32_t[]>(sealedTable->numBuckets);
+    sealedTable->slots = std::make_unique<SSealedSlot[]>(sealedTable->capacity);
+
+    // Entries are grouped by bucket, and buckets are then placed from largest to smallest, because
+    // large buckets are the hardest to place and it is easiest to do so while the table is empty.
+    std::vector<size_t> bucketBegin(sealedTable->numBuckets + 1, 0);
+    for (const SSealedSlot& entry : entries)
+      bucketBegin[1 + (static_cast<size_t>(SealedHashForKey(entry.key, 0)) &
+                       (sealedTable->numBuckets - 1))] += 1;
+    for (size_t bucketIndex = 0; bucketIndex < sealedTable->numBuckets; ++bucketIndex)
+      bucketBegin[bucketIndex + 1] += bucketBegin[bucketIndex];
+
+    std::vector<size_t> groupedEntries(entries.size());
+    std::vector<size_t> bucketFill(bucketBegin.begin(), bucketBegin.end() - 1);
+    for (size_t entryIndex = 0; entryIndex < entries.size(); ++entryIndex)
+    {
+      const size_t bucketIndex = static_cast<size_t>(SealedHashForKey(entries[entryIndex].key, 0)) &
+          (sealedTable->numBuckets - 1);
+      groupedEntries[bucketFill[bucketIndex]++] = entryIndex;
+    }
+
+    std::vector<size_t> bucketOrder(sealedTable->numBuckets);
+    std::iota(bucketOrder.begin(), bucketOrder.end(), 0);
+    std::stable_sort(
+        bucketOrder.begin(),
+        bucketOrder.end(),
+        [&bucketBegin](const size_t bucketA, const size_t bucketB) -> bool
+        {
+          return ((bucketBegin[bucketA + 1] - bucketBegin[bucketA]) >
+                  (bucketBegin[bucketB + 1] - bucketBegin[bucketB]));
+        });
+
+    std::vector<size_t> candidateSlots;
+    for (const size_t bucketIndex : bucketOrder)
+    {
+      const size_t bucketSize = bucketBegin[bucketIndex + 1] - bucketBegin[bucketIndex];
+      if (0 == bucketSize) break;
+
+      bool bucketPlaced = false;
+      for (uint32_t seed = 0; (false == bucketPlaced) && (seed < kSealedMaxSeedsPerBucket); ++seed)
+      {
+        candidateSlots.clear();
+        for (size_t i = bucketBegin[bucketIndex]; i < bucketBegin[bucketIndex + 1]; ++i)
+        {
+          const size_t slotIndex = static_cast<size_t>(SealedHashForKey(
+                                       entries[groupedEntries[i]].key,
+                                       1 + static_cast<uint64_t>(seed))) &
+              (sealedTable->capacity - 1);
+          if ((nullptr != sealedTable->slots[slotIndex].key) ||
+              (candidateSlots.end() !=
+               std::find(candidateSlots.begin(), candidateSlots.end(), slotIndex)))
+            break;
+
+          candidateSlots.push_back(slotIndex);
+        }
+
+        if (bucketSize != candidateSlots.size()) continue;
+
+        for (size_t i = 0; i < bucketSize; ++i)
+        {
+          const size_t entryIndex = groupedEntries[bucketBegin[bucketIndex] + i];
+          sealedTable->slots[candidateSlots[i]] = entries[entryIndex];
+        }
+        sealedTable->bucketSeeds[bucketIndex] = seed;
+        bucketPlaced = true;
+      }
+
+      if (false == bucketPlaced) return nullptr;
+    }
+
+    return sealedTable;
+  }
+
+  void HookLookupTable::Unseal(void)
+  {
+    currentSealedTable.store(nullptr, std::memory_order_release);
+  }
+
+  void HookLookupTable::Grow(void)
+  {
+    const STable* const oldTable = currentTable.load(std::memory_order_relaxed);
+
+    auto newTable = std::make_unique<STable>();
+    newTable->capacity = ((nullptr == oldTable) ? kInitialCapacity : (oldTable->capacity * 2));
+    newTable->numOccupied = 0;
+    newTable->slots = std::make_unique<SSlot[]>(newTable->capacity);
+
+    if (nullptr != oldTable)
+    {
+      // Tombstones are dropped during the move, which is the only way they are ever reclaimed.
+      for (size_t oldIndex = 0; oldIndex < oldTable->capacity; ++oldIndex)
+      {
+        const void* const key = oldTable->slots[oldIndex].key.load(std::memory_order_relaxed);
+        Trampoline* const value = oldTable->slots[oldIndex].value.load(std::memory_order_relaxed);
+        if ((nullptr == key) || (nullptr == value)) continue;
+
+        size_t newIndex = SlotIndexForKey(key, newTable->capacity);
+        while (nullptr != newTable->slots[newIndex].key.load(std::memory_order_relaxed))
+          newIndex = (newIndex + 1) & (newTable->capacity - 1);
+
+        newTable->slots[newIndex].key.store(key, std::memory_order_relaxed);
+        newTable->slots[newIndex].value.store(value, std::memory_order_relaxed);
+        newTable->numOccupied += 1;
+      }
+    }
+
+    currentTable.store(newTable.get(), std::memory_order_release);
+    allTables.push_back(std::move(newTable));
+  }
+} // namespace Hookshot
@@ -0,0 +1,621 @@
+/***************************************************************************************************
+ * Hookshot
+ *   General-purpose library for injecting DLLs and hooking function calls.
+ ***************************************************************************************************
+ * Authored by Samuel Grossman
+ * Copyright (c) 2019-2025
+ ***********************************************************************************************//**
+ * @file HookModuleBundle.cpp
+ *   Implementation of loading hook modules from hook module bundle files.
+ **************************************************************************************************/
+
+#include "HookModuleBundle.h"
+
+#include <algorithm>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <cwctype>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include <Infra/Core/Message.h>
+
+#include "ApiWindows.h"
+#include "DependencyProtect.h"
+
+namespace Hookshot
+{
+  namespace HookModuleBundle
+  {
+#ifdef _WIN64
+    /// Function signature for the entry point of a hook module.
+    using TDllEntryProc = BOOL(WINAPI*)(HINSTANCE, DWORD, LPVOID);
+
+    /// Single hook module held by a mapped hook module bundle file.
+    struct SBundledHookModule
+    {
+      /// File name of the hook module, which points into the mapped file.
+      std::wstring_view name;
+
+      /// Address of the hook module image within the mapped file.
+      uint8_t* imageBase;
+
+      /// Ensures the hook module is loaded only once.
+      std::once_flag loadOnce;
+
+      /// Handle of the loaded hook module, or `nullptr` if it has not been loaded or if loading it
+      /// failed.
+      std::atomic<HMODULE> loadedModule;
+
+      /// System error code that identifies the reason loading the hook module failed.
+      DWORD loadErrorCode;
+    };
+
+    /// Hook module bundle file that is mapped into memory.
+    struct SMappedBundle
+    {
+      /// Name of the hook module bundle file, as supplied by the first caller that opened it.
+      std::wstring filename;
+
+      /// Hook modules held by the bundle, in the order in which they are stored.
+      std::unique_ptr<SBundledHookModule[]> hookModules;
+
+      /// Number of elements in the hook module array.
+      size_t numHookModules;
+    };
+
+    /// Enforces concurrency control over the list of mapped hook module bundle files.
+    static std::mutex mappedBundleMutex;
+
+    /// Hook module bundle files that have been mapped into memory. They remain mapped for the
+    /// lifetime of the process, and each element is allocated separately so that its address never
+    /// changes.
+    static std::vector<SMappedBundle*> mappedBundles;
+
+    /// Determines whether or not two file names are the same, ignoring case.
+    /// @param [in] a First file name.
+    /// @param [in] b Second file name.
+    /// @return `true` if so, `false` if not.
+    static bool FilenamesAreEqual(std::wstring_view a, std::wstring_view b)
+    {
+      return std::equal(
+          a.begin(),
+          a.end(),
+          b.begin(),
+          b.end(),
+          [](wchar_t charA, wchar_t charB) -> bool
+          {
+            return (std::towlower(charA) == std::towlower(charB));
+          });
+    }
+
+    /// Removes the directory, if any, from a file name.
+    /// @param [in] fileName File name, which can include a directory.
+    /// @return File name without any directory.
+    static std::wstring_view FileNameWithoutDirectory(std::wstring_view fileName)
+    {
+      const size_t lastSeparatorPosition = fileName.find_last_of(L"\\/");
+      if (std::wstring_view::npos == lastSeparatorPosition) return fileName;
+
+      return fileName.substr(lastSeparatorPosition + 1);
+    }
+
+    /// Locates the headers of a hook module image that is already laid out in memory and checks
+    /// that they describe a 64-bit library whose size matches its module entry.
+    /// @param [in] imageBase Address of the hook module image.
+    /// @param [in] imageSizeBytes Size of the hook module image, from its module entry.
+    /// @return Headers of the hook module image, or `nullptr` if they are not valid.
+    static IMAGE_NT_HEADERS64* ImageHeaders(uint8_t* imageBase, uint32_t imageSizeBytes)
+    {
+      if (imageSizeBytes < sizeof(IMAGE_DOS_HEADER)) return nullptr;
+
+      const IMAGE_DOS_HEADER* const dosHeader = reinterpret_cast<IMAGE_DOS_HEADER*>(imageBase);
+      if ((IMAGE_DOS_SIGNATURE != dosHeader->e_magic) || (dosHeader->e_lfanew < 0) ||
+          ((static_cast<uint64_t>(dosHeader->e_lfanew) + sizeof(IMAGE_NT_HEADERS64)) >
+           imageSizeBytes))
+        return nullptr;
+
+      IMAGE_NT_HEADERS64* const ntHeaders =
+          reinterpret_cast<IMAGE_NT_HEADERS64*>(&imageBase[dosHeader->e_lfanew]);
+      if ((IMAGE_NT_SIGNATURE != ntHeaders->Signature) ||
+          (IMAGE_FILE_MACHINE_AMD64 != ntHeaders->FileHeader.Machine) ||
+          (IMAGE_NT_OPTIONAL_HDR64_MAGIC != ntHeaders->OptionalHeader.Magic) ||
+          (0 == (ntHeaders->FileHeader.Characteristics & IMAGE_FILE_DLL)) ||
+          (imageSizeBytes != ntHeaders->OptionalHeader.SizeOfImage))
+        return nullptr;
+
+      return ntHeaders;
+    }
+
+    /// Locates a data directory within a hook module image and checks that it lies entirely within
+    /// the image.
+    /// @param [in] ntHeaders Headers of the hook module image.
+    /// @param [in] directoryIndex Index of the data directory to locate.
+    /// @param [out] dataDirectory Filled with the data directory, if it is present and valid.
+    /// @return `true` if the data directory is present and valid, `false` otherwise.
+    static bool ImageDataDirectory(
+        const IMAGE_NT_HEADERS64* ntHeaders,
+        const DWORD directoryIndex,
+        IMAGE_DATA_DIRECTORY* dataDirectory)
+    {
+      if (directoryIndex >= ntHeaders->OptionalHeader.NumberOfRvaAndSizes) return false;
+
+      *dataDirectory = ntHeaders->OptionalHeader.DataDirectory[directoryIndex];
+      return (
+          (0 != dataDirectory->VirtualAddress) && (0 != dataDirectory->Size) &&
+          ((static_cast<uint64_t>(dataDirectory->VirtualAddress) + dataDirectory->Size) <=
+           ntHeaders->OptionalHeader.SizeOfImage));
+    }
+
+    /// Adjusts every absolute address in a hook module image by the difference between the
+    /// address at which the image is located and the address for which it was relocated.
+    /// @param [in] imageBase Address of the hook module image.
+    /// @param [in] ntHeaders Headers of the hook module image.
+    /// @return `true` if the image was relocated, `false` if it cannot be relocated.
+    static bool ApplyRelocations(uint8_t* imageBase, IMAGE_NT_HEADERS64* ntHeaders)
+    {
+      const uint64_t delta =
+          reinterpret_cast<uint64_t>(imageBase) - ntHeaders->OptionalHeader.ImageBase;
+      if (0 == delta) return true;
+
+      IMAGE_DATA_DIRECTORY relocationDirectory{};
+      if (false ==
+          ImageDataDirectory(ntHeaders, IMAGE_DIRECTORY_ENTRY_BASERELOC, &relocationDirectory))
+        return false;
+
+      const uint32_t imageSizeBytes = ntHeaders->OptionalHeader.SizeOfImage;
+      uint32_t blockOffset = 0;
+
+      while ((relocationDirectory.Size - blockOffset) >= sizeof(IMAGE_BASE_RELOCATION))
+      {
+        const IMAGE_BASE_RELOCATION* const block = reinterpret_cast<IMAGE_BASE_RELOCATION*>(
+            &imageBase[relocationDirectory.VirtualAddress + blockOffset]);
+        if ((block->SizeOfBlock < sizeof(IMAGE_BASE_RELOCATION)) ||
+            (block->SizeOfBlock > (relocationDirectory.Size - blockOffset)))
+          return false;
+
+        const WORD* const entries = reinterpret_cast<const WORD*>(&block[1]);
+        const size_t numEntries =
+            (block->SizeOfBlock - sizeof(IMAGE_BASE_RELOCATION)) / sizeof(WORD);
+
+        for (size_t i = 0; i < numEntries; ++i)
+        {
+          const uint64_t fixupOffset =
+              static_cast<uint64_t>(block->VirtualAddress) + (entries[i] & 0x0fff);
+
+          switch (entries[i] >> 12)
+          {
+            case IMAGE_REL_BASED_ABSOLUTE:
+              break;
+
+            case IMAGE_REL_BASED_DIR64:
+              if ((fixupOffset + sizeof(uint64_t)) > imageSizeBytes) return false;
+              *reinterpret_cast<uint64_t*>(&imageBase[fixupOffset]) += delta;
+              break;
+
+            case IMAGE_REL_BASED_HIGHLOW:
+              if ((fixupOffset + sizeof(uint32_t)) > imageSizeBytes) return false;
+              *reinterpret_cast<uint32_t*>(&imageBase[fixupOffset]) +=
+                  static_cast<uint32_t>(delta);
+              break;
+
+            default:
+              return false;
+          }
+        }
+
+        blockOffset += block->SizeOfBlock;
+      }
+
+      ntHeaders->OptionalHeader.ImageBase = reinterpret_cast<uint64_t>(imageBase);
+      return true;
+    }
+
+    /// Loads the libraries that a hook module image imports and fills its import address table
+    /// with the addresses of the imported procedures.
+    /// @param [in] imageBase Address of the hook module image.
+    /// @param [in] ntHeaders Headers of the hook module image.
+    /// @return `ERROR_SUCCESS` if all imports were resolved, or a system error code otherwise.
+    static DWORD ResolveImports(uint8_t* imageBase, const IMAGE_NT_HEADERS64* ntHeaders)
+    {
+      IMAGE_DATA_DIRECTORY importDirectory{};
+      if (false == ImageDataDirectory(ntHeaders, IMAGE_DIRECTORY_ENTRY_IMPORT, &importDirectory))
+        return ERROR_SUCCESS;
+
+      const IMAGE_IMPORT_DESCRIPTOR* const importDescriptors =
+          reinterpret_cast<IMAGE_IMPORT_DESCRIPTOR*>(&imageBase[importDirectory.VirtualAddress]);
+      const size_t maxImportDescriptors = importDirectory.Size / sizeof(IMAGE_IMPORT_DESCRIPTOR);
+
+      for (size_t i = 0; (i < maxImportDescriptors) && (0 != importDescriptors[i].Name); ++i)
+      {
+        const IMAGE_IMPORT_DESCRIPTOR& importDescriptor = importDescriptors[i];
+
+        // Library names are always ASCII.
+        const std::string_view importedLibraryNameNarrow(
+            reinterpret_cast<const char*>(&imageBase[importDescriptor.Name]));
+        const std::wstring importedLibraryName(
+            importedLibraryNameNarrow.begin(), importedLibraryNameNarrow.end());
+
+        const HMODULE importedLibrary =
+            Protected::Windows_LoadLibrary(importedLibraryName.c_str());
+        if (nullptr == importedLibrary) return Protected::Windows_GetLastError();
+
+        // Bound imports are never trusted, so procedure names and ordinals are always read from
+        // the lookup table if there is one.
+        const IMAGE_THUNK_DATA64* lookupThunk = reinterpret_cast<IMAGE_THUNK_DATA64*>(
+            &imageBase
+                [(0 != importDescriptor.OriginalFirstThunk) ? importDescriptor.OriginalFirstThunk
+                                                             : importDescriptor.FirstThunk]);
+        IMAGE_THUNK_DATA64* addressThunk =
+            reinterpret_cast<IMAGE_THUNK_DATA64*>(&imageBase[importDescriptor.FirstThunk]);
+
+        for (; 0 != lookupThunk->u1.AddressOfData; ++lookupThunk, ++addressThunk)
+        {
+          const char* const procName =
+              ((true == IMAGE_SNAP_BY_ORDINAL64(lookupThunk->u1.Ordinal))
+                   ? MAKEINTRESOURCEA(IMAGE_ORDINAL64(lookupThunk->u1.Ordinal))
+                   : reinterpret_cast<IMAGE_IMPORT_BY_NAME*>(
+                         &imageBase[lookupThunk->u1.AddressOfData])
+                         ->Name);
+
+          const FARPROC procAddress = Protected::Windows_GetProcAddress(importedLibrary, procName);
+          if (nullptr == procAddress) return ERROR_PROC_NOT_FOUND;
+
+          addressThunk->u1.Function = reinterpret_cast<ULONGLONG>(procAddress);
+        }
+      }
+
+      return ERROR_SUCCESS;
+    }
+
+    /// Determines the memory protection that a section of a hook module image should have. Pages
+    /// that can be written are copy-on-write, because they belong to a mapped file.
+    /// @param [in] characteristics Characteristics of the section, from its section header.
+    /// @return Memory protection constant.
+    static DWORD SectionProtection(const DWORD characteristics)
+    {
+      const bool canExecute = (0 != (characteristics & IMAGE_SCN_MEM_EXECUTE));
+      const bool canRead = (0 != (characteristics & IMAGE_SCN_MEM_READ));
+      const bool canWrite = (0 != (characteristics & IMAGE_SCN_MEM_WRITE));
+
+      if (true == canExecute)
+      {
+        if (true == canWrite) return PAGE_EXECUTE_WRITECOPY;
+        if (true == canRead) return PAGE_EXECUTE_READ;
+        return PAGE_EXECUTE;
+      }
+
+      if (true == canWrite) return PAGE_WRITECOPY;
+      if (true == canRead) return PAGE_READONLY;
+      return PAGE_NOACCESS;
+    }
+
+    /// Applies the memory protection that the headers and each section of a hook module image
+    /// should have, replacing the copy-on-write and executable protection with which the whole
+    /// hook module bundle file is mapped.
+    /// @param [in] imageBase Address of the hook module image.
+    /// @param [in] ntHeaders Headers of the hook module image.
+    /// @return `true` on success, `false` on failure.
+    static bool ProtectSections(uint8_t* imageBase, const IMAGE_NT_HEADERS64* ntHeaders)
+    {
+      const uint32_t sectionAlignment = ntHeaders->OptionalHeader.SectionAlignment;
+      DWORD unusedOldProtection = 0;
+
+      if (FALSE ==
+          Protected::Windows_VirtualProtect(
+              imageBase,
+              ntHeaders->OptionalHeader.SizeOfHeaders,
+              PAGE_READONLY,
+              &unusedOldProtection))
+        return false;
+
+      const IMAGE_SECTION_HEADER* const sectionHeaders = IMAGE_FIRST_SECTION(ntHeaders);
+      for (WORD i = 0; i < ntHeaders->FileHeader.NumberOfSections; ++i)
+      {
+        const IMAGE_SECTION_HEADER& sectionHeader = sectionHeaders[i];
+        const uint32_t sectionSizeBytes =
+            std::max(sectionHeader.Misc.VirtualSize, sectionHeader.SizeOfRawData);
+        if (0 == sectionSizeBytes) continue;
+
+        const uint32_t alignedSectionSizeBytes =
+            ((sectionSizeBytes + sectionAlignment - 1) / sectionAlignment) * sectionAlignment;
+        if (FALSE ==
+            Protected::Windows_VirtualProtect(
+                &imageBase[sectionHeader.VirtualAddress],
+                std::min(
+                    alignedSectionSizeBytes,
+                    ntHeaders->OptionalHeader.SizeOfImage - sectionHeader.VirtualAddress),
+                SectionProtection(sectionHeader.Characteristics),
+                &unusedOldProtection))
+          return false;
+      }
+
+      return true;
+    }
+
+    /// Loads a single hook module from its image within a mapped hook module bundle file, which
+    /// was validated when the bundle was opened.
+    /// @param [in] imageBase Address of the hook module image.
+    /// @return `ERROR_SUCCESS` if the hook module was loaded, or a system error code otherwise.
+    static DWORD LoadHookModuleImage(uint8_t* imageBase)
+    {
+      IMAGE_NT_HEADERS64* const ntHeaders = reinterpret_cast<IMAGE_NT_HEADERS64*>(
+          &imageBase[reinterpret_cast<IMAGE_DOS_HEADER*>(imageBase)->e_lfanew]);
+
+      // Implicit thread-local storage is set up only by the system loader.
+      IMAGE_DATA_DIRECTORY tlsDirectory{};
+      if (true == ImageDataDirectory(ntHeaders, IMAGE_DIRECTORY_ENTRY_TLS, &tlsDirectory))
+        return ERROR_NOT_SUPPORTED;
+
+      if (false == ApplyRelocations(imageBase, ntHeaders)) return ERROR_BAD_EXE_FORMAT;
+
+      const DWORD resolveImportsResult = ResolveImports(imageBase, ntHeaders);
+      if (ERROR_SUCCESS != resolveImportsResult) return resolveImportsResult;
+
+      if (false == ProtectSections(imageBase, ntHeaders)) return Protected::Windows_GetLastError();
+
+      Protected::Windows_FlushInstructionCache(
+          GetCurrentProcess(), imageBase, ntHeaders->OptionalHeader.SizeOfImage);
+
+      // Without registering its unwind information, exceptions thrown by the hook module would
+      // terminate the process.
+      IMAGE_DATA_DIRECTORY exceptionDirectory{};
+      if (true ==
+          ImageDataDirectory(ntHeaders, IMAGE_DIRECTORY_ENTRY_EXCEPTION, &exceptionDirectory))
+      {
+        if (FALSE ==
+            Protected::Windows_RtlAddFunctionTable(
+                reinterpret_cast<PRUNTIME_FUNCTION>(
+                    &imageBase[exceptionDirectory.VirtualAddress]),
+                static_cast<DWORD>(exceptionDirectory.Size / sizeof(RUNTIME_FUNCTION)),
+                reinterpret_cast<DWORD64>(imageBase)))
+          return ERROR_NOT_ENOUGH_MEMORY;
+      }
+
+      if (0 != ntHeaders->OptionalHeader.AddressOfEntryPoint)
+      {
+        const TDllEntryProc entryProc = reinterpret_cast<TDllEntryProc>(
+            &imageBase[ntHeaders->OptionalHeader.AddressOfEntryPoint]);
+        if (FALSE ==
+            entryProc(reinterpret_cast<HINSTANCE>(imageBase), DLL_PROCESS_ATTACH, nullptr))
+          return ERROR_DLL_INIT_FAILED;
+      }
+
+      return ERROR_SUCCESS;
+    }
+
+    /// Checks that the contents of a mapped hook module bundle file are consistent and, if so,
+    /// creates an object to represent it.
+    /// @param [in] bundleFileName Name of the hook module bundle file.
+    /// @param [in] bundleView Address at which the hook module bundle file is mapped.
+    /// @param [in] fileSizeBytes Size of the hook module bundle file, in bytes.
+    /// @return Mapped hook module bundle, which the caller owns, or `nullptr` if the file is not
+    /// valid.
+    static SMappedBundle* CreateMappedBundle(
+        std::wstring_view bundleFileName, uint8_t* bundleView, const uint64_t fileSizeBytes)
+    {
+      const SFileHeader* const fileHeader = reinterpret_cast<const SFileHeader*>(bundleView);
+      if ((sizeof(SFileHeader) +
+           (static_cast<uint64_t>(fileHeader->numModules) * sizeof(SModuleEntry))) > fileSizeBytes)
+        return nullptr;
+
+      const SModuleEntry* const moduleEntries =
+          reinterpret_cast<const SModuleEntry*>(&bundleView[sizeof(SFileHeader)]);
+
+      SMappedBundle* const mappedBundle = new SMappedBundle{
+          .filename = std::wstring(bundleFileName),
+          .hookModules = std::make_unique<SBundledHookModule[]>(fileHeader->numModules),
+          .numHookModules = fileHeader->numModules};
+
+      for (uint32_t i = 0; i < fileHeader->numModules; ++i)
+      {
+        const SModuleEntry& moduleEntry = moduleEntries[i];
+        const size_t nameLength =
+            std::wstring_view(moduleEntry.name, kMaxHookModuleNameChars).find(L'\0');
+
+        if ((0 != (moduleEntry.imageOffset % kImageAlignmentBytes)) ||
+            (moduleEntry.imageOffset > fileSizeBytes) ||
+            (moduleEntry.imageSizeBytes > (fileSizeBytes - moduleEntry.imageOffset)) ||
+            (0 == nameLength) || (std::wstring_view::npos == nameLength) ||
+            (nullptr ==
+             ImageHeaders(&bundleView[moduleEntry.imageOffset], moduleEntry.imageSizeBytes)))
+        {
+          delete mappedBundle;
+          return nullptr;
+        }
+
+        mappedBundle->hookModules[i].name = std::wstring_view(moduleEntry.name, nameLength);
+        mappedBundle->hookModules[i].imageBase = &bundleView[moduleEntry.imageOffset];
+      }
+
+      return mappedBundle;
+    }
+
+    /// Locates a hook module within the hook module bundle files that have been opened.
+    /// @param [in] hookModuleFileName File name of the hook module, which can include a directory.
+    /// @return Hook module, or `nullptr` if no opened bundle holds it.
+    static SBundledHookModule* FindBundledHookModule(std::wstring_view hookModuleFileName)
+    {
+      const std::wstring_view hookModuleName = FileNameWithoutDirectory(hookModuleFileName);
+      std::scoped_lock lock(mappedBundleMutex);
+
+      for (SMappedBundle* mappedBundle : mappedBundles)
+      {
+        for (size_t i = 0; i < mappedBundle->numHookModules; ++i)
+        {
+          if (true == FilenamesAreEqual(mappedBundle->hookModules[i].name, hookModuleName))
+            return &mappedBundle->hookModules[i];
+        }
+      }
+
+      return nullptr;
+    }
+
+    bool OpenBundle(std::wstring_view bundleFileName, std::vector<std::wstring>* hookModuleNames)
+    {
+      std::scoped_lock lock(mappedBundleMutex);
+
+      const SMappedBundle* mappedBundle = nullptr;
+      for (const SMappedBundle* existingMappedBundle : mappedBundles)
+      {
+        if (true == FilenamesAreEqual(existingMappedBundle->filename, bundleFileName))
+        {
+          mappedBundle = existingMappedBundle;
+          break;
+        }
+      }
+
+      if (nullptr == mappedBundle)
+      {
+        const HANDLE bundleFile = CreateFile(
+            std::wstring(bundleFileName).c_str(),
+            GENERIC_READ | GENERIC_EXECUTE,
+            FILE_SHARE_READ | FILE_SHARE_DELETE,
+            nullptr,
+            OPEN_EXISTING,
+            FILE_ATTRIBUTE_NORMAL,
+            nullptr);
+        if (INVALID_HANDLE_VALUE == bundleFile) return false;
+
+        // The header is read ahead of mapping the file, because it specifies where to map it.
+        SFileHeader fileHeader{};
+        DWORD numBytesRead = 0;
+        LARGE_INTEGER bundleFileSize{};
+        const bool fileHeaderIsValid =
+            ((FALSE !=
+              ReadFile(bundleFile, &fileHeader, sizeof(fileHeader), &numBytesRead, nullptr)) &&
+             (sizeof(fileHeader) == numBytesRead) && (kSignature == fileHeader.signature) &&
+             (kVersion == fileHeader.version) &&
+             (IMAGE_FILE_MACHINE_AMD64 == fileHeader.machine) &&
+             (0 == (fileHeader.preferredBaseAddress % kImageAlignmentBytes)) &&
+             (FALSE != GetFileSizeEx(bundleFile, &bundleFileSize)) &&
+             (static_cast<uint64_t>(bundleFileSize.QuadPart) == fileHeader.fileSizeBytes));
+
+        const HANDLE bundleMapping =
+            ((true == fileHeaderIsValid)
+                 ? Protected::Windows_CreateFileMapping(
+                       bundleFile, nullptr, PAGE_EXECUTE_WRITECOPY, 0, 0, nullptr)
+                 : nullptr);
+        Protected::Windows_CloseHandle(bundleFile);
+
+        if (false == fileHeaderIsValid)
+        {
+          Protected::Windows_SetLastError(ERROR_BAD_FORMAT);
+          return false;
+        }
+
+        if (nullptr == bundleMapping) return false;
+
+        // If the preferred base address is taken, the bundle is mapped wherever there is room, and
+        // each hook module is relocated as it is loaded.
+        uint8_t* bundleView = reinterpret_cast<uint8_t*>(Protected::Windows_MapViewOfFileEx(
+            bundleMapping,
+            FILE_MAP_COPY | FILE_MAP_EXECUTE,
+            0,
+            0,
+            0,
+            reinterpret_cast<void*>(fileHeader.preferredBaseAddress)));
+        if (nullptr == bundleView)
+          bundleView = reinterpret_cast<uint8_t*>(Protected::Windows_MapViewOfFileEx(
+              bundleMapping, FILE_MAP_COPY | FILE_MAP_EXECUTE, 0, 0, 0, nullptr));
+        Protected::Windows_CloseHandle(bundleMapping);
+        if (nullptr == bundleView) return false;
+
+        SMappedBundle* const newMappedBundle =
+            CreateMappedBundle(bundleFileName, bundleView, fileHeader.fileSizeBytes);
+        if (nullptr == newMappedBundle)
+        {
+          Protected::Windows_UnmapViewOfFile(bundleView);
+          Protected::Windows_SetLastError(ERROR_BAD_FORMAT);
+          return false;
+        }
+
+        if (reinterpret_cast<uint64_t>(bundleView) != fileHeader.preferredBaseAddress)
+        {
+          Infra::Message::OutputFormatted(
+              Infra::Message::ESeverity::Info,
+              L"%.*s - Hook module bundle could not be mapped at its preferred base address, so "
+              L"its hook modules will be relocated.",
+              static_cast<int>(bundleFileName.length()),
+              bundleFileName.data());
+        }
+
+        mappedBundles.push_back(newMappedBundle);
+        mappedBundle = newMappedBundle;
+      }
+
+      hookModuleNames->clear();
+      for (size_t i = 0; i < mappedBundle->numHookModules; ++i)
+        hookModuleNames->emplace_back(mappedBundle->hookModules[i].name);
+
+      return true;
+    }
+
+    bool IsBundledHookModule(std::wstring_view hookModuleFileName)
+    {
+      return (nullptr != FindBundledHookModule(hookModuleFileName));
+    }
+
+    HMODULE LoadHookModule(std::wstring_view hookModuleFileName)
+    {
+      SBundledHookModule* const bundledHookModule = FindBundledHookModule(hookModuleFileName);
+      if (nullptr == bundledHookModule)
+      {
+        Protected::Windows_SetLastError(ERROR_MOD_NOT_FOUND);
+        return nullptr;
+      }
+
+      std::call_once(
+          bundledHookModule->loadOnce,
+          [bundledHookModule]() -> void
+          {
+            bundledHookModule->loadErrorCode = LoadHookModuleImage(bundledHookModule->imageBase);
+            if (ERROR_SUCCESS == bundledHookModule->loadErrorCode)
+              bundledHookModule->loadedModule =
+                  reinterpret_cast<HMODULE>(bundledHookModule->imageBase);
+          });
+
+      const HMODULE loadedModule = bundledHookModule->loadedModule;
+      if (nullptr == loadedModule)
+        Protected::Windows_SetLastError(bundledHookModule->loadErrorCode);
+
+      return loadedModule;
+    }
+
+    bool IsBundledHookModuleLoaded(std::wstring_view hookModuleFileName)
+    {
+      const SBundledHookModule* const bundledHookModule =
+          FindBundledHookModule(hookModuleFileName);
+
+      return ((nullptr != bundledHookModule) && (nullptr != bundledHookModule->loadedModule));
+    }
+#else
+    bool OpenBundle(std::wstring_view bundleFileName, std::vector<std::wstring>* hookModuleNames)
+    {
+      hookModuleNames->clear();
+      Protected::Windows_SetLastError(ERROR_NOT_SUPPORTED);
+      return false;
+    }
+
+    bool IsBundledHookModule(std::wstring_view hookModuleFileName)
+    {
+      return false;
+    }
+
+    HMODULE LoadHookModule(std::wstring_view hookModuleFileName)
+    {
+      Protected::Windows_SetLastError(ERROR_NOT_SUPPORTED);
+      return nullptr;
+    }
+
+    bool IsBundledHookModuleLoaded(std::wstring_view hookModuleFileName)
+    {
+      return false;
+    }
+#endif
+  } // namespace HookModuleBundle
+} // namespace Hookshot
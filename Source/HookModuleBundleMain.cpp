@@ -0,0 +1,467 @@
+/***************************************************************************************************
+ * Hookshot
+ *   General-purpose library for injecting DLLs and hooking function calls.
+ ***************************************************************************************************
+ * Authored by Samuel Grossman
+ * Copyright (c) 2019-2025
+ ***********************************************************************************************//**
+ * @file HookModuleBundleMain.cpp
+ *   Entry point for the hook module bundling tool, which packs several hook modules ahead of time
+ *   into a single hook module bundle file that Hookshot can map into memory in one step.
+ **************************************************************************************************/
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <cwchar>
+#include <cwctype>
+#include <string_view>
+#include <utility>
+#include <vector>
+
+#include "ApiWindows.h"
+#include "HookModuleBundle.h"
+
+using namespace Hookshot;
+
+/// Base address for which hook modules are relocated unless another is specified. Chosen to be
+/// far away from where the system usually places executables, libraries, and heaps.
+static constexpr uint64_t kDefaultPreferredBaseAddress = 0x00007e0000000000ull;
+
+/// Command-line option that specifies the base address for which hook modules are relocated.
+static constexpr std::wstring_view kOptionBaseAddress = L"--base=";
+
+/// Single hook module laid out the way it appears in memory once loaded.
+struct SLaidOutHookModule
+{
+  /// File name of the hook module, without any directory.
+  std::wstring_view name;
+
+  /// Image of the hook module, whose size is the size of image from its header.
+  std::vector<uint8_t> image;
+};
+
+/// Reads an entire file into memory.
+/// @param [in] filename Name of the file to read.
+/// @param [out] contents Filled with the contents of the file.
+/// @return `true` if the file was read, `false` otherwise.
+static bool ReadEntireFile(const wchar_t* filename, std::vector<uint8_t>* contents)
+{
+  const HANDLE file = CreateFile(
+      filename,
+      GENERIC_READ,
+      FILE_SHARE_READ,
+      nullptr,
+      OPEN_EXISTING,
+      FILE_ATTRIBUTE_NORMAL | FILE_FLAG_SEQUENTIAL_SCAN,
+      nullptr);
+  if (INVALID_HANDLE_VALUE == file) return false;
+
+  LARGE_INTEGER fileSize{};
+  bool readSucceeded =
+      ((FALSE != GetFileSizeEx(file, &fileSize)) && (fileSize.QuadPart <= MAXDWORD));
+  if (true == readSucceeded)
+  {
+    DWORD numBytesRead = 0;
+    contents->resize(static_cast<size_t>(fileSize.QuadPart));
+    readSucceeded =
+        ((FALSE !=
+          ReadFile(
+              file,
+              contents->data(),
+              static_cast<DWORD>(contents->size()),
+              &numBytesRead,
+              nullptr)) &&
+         (numBytesRead == contents->size()));
+  }
+
+  CloseHandle(file);
+  return readSucceeded;
+}
+
+/// Adjusts every absolute address in a hook module image so that it is correct if the image is
+/// loaded at the specified base address.
+/// @param [in,out] image Hook module image to relocate.
+/// @param [in] ntHeaders Headers of the hook module image, which point into the image.
+/// @param [in] baseAddress Base address for which to relocate the image.
+/// @return `true` if the image was relocated, `false` if it cannot be relocated.
+static bool RelocateImage(
+    std::vector<uint8_t>& image, IMAGE_NT_HEADERS64* ntHeaders, const uint64_t baseAddress)
+{
+  const uint64_t delta = baseAddress - ntHeaders->OptionalHeader.ImageBase;
+  const IMAGE_DATA_DIRECTORY& relocationDirectory =
+      ntHeaders->OptionalHeader.DataDirectory[IMAGE_DIRECTORY_ENTRY_BASERELOC];
+
+  uint32_t blockOffset = 0;
+  while ((relocationDirectory.Size - blockOffset) >= sizeof(IMAGE_BASE_RELOCATION))
+  {
+    IMAGE_BASE_RELOCATION block{};
+    std::memcpy(&block, &image[relocationDirectory.VirtualAddress + blockOffset], sizeof(block));
+    if ((block.SizeOfBlock < sizeof(IMAGE_BASE_RELOCATION)) ||
+        (block.SizeOfBlock > (relocationDirectory.Size - blockOffset)))
+      return false;
+
+    const size_t numEntries = (block.SizeOfBlock - sizeof(IMAGE_BASE_RELOCATION)) / sizeof(WORD);
+    for (size_t i = 0; i < numEntries; ++i)
+    {
+      WORD entry = 0;
+      std::memcpy(
+          &entry,
+          &image
+              [relocationDirectory.VirtualAddress + blockOffset + sizeof(IMAGE_BASE_RELOCATION) +
+               (i * sizeof(WORD))],
+          sizeof(entry));
+
+      const uint64_t fixupOffset = static_cast<uint64_t>(block.VirtualAddress) + (entry & 0x0fff);
+      switch (entry >> 12)
+      {
+        case IMAGE_REL_BASED_ABSOLUTE:
+          break;
+
+        case IMAGE_REL_BASED_DIR64:
+        {
+          if ((fixupOffset + sizeof(uint64_t)) > image.size()) return false;
+
+          uint64_t value = 0;
+          std::memcpy(&value, &image[fixupOffset], sizeof(value));
+          value += delta;
+          std::memcpy(&image[fixupOffset], &value, sizeof(value));
+          break;
+        }
+
+        default:
+          return false;
+      }
+    }
+
+    blockOffset += block.SizeOfBlock;
+  }
+
+  ntHeaders->OptionalHeader.ImageBase = baseAddress;
+  return true;
+}
+
+/// Reads a hook module file and lays it out the way it appears in memory once loaded, relocated
+/// for the specified base address. Hook modules that cannot be loaded from a hook module bundle
+/// are rejected.
+/// @param [in] hookModuleFilename Name of the hook module file.
+/// @param [in] baseAddress Base address for which to relocate the hook module.
+/// @param [out] laidOutHookModule Filled with the laid-out hook module.
+/// @return `true` if the hook module was laid out, `false` otherwise.
+static bool LayOutHookModule(
+    const wchar_t* hookModuleFilename,
+    const uint64_t baseAddress,
+    SLaidOutHookModule* laidOutHookModule)
+{
+  std::vector<uint8_t> fileContents;
+  if (false == ReadEntireFile(hookModuleFilename, &fileContents))
+  {
+    fwprintf(
+        stderr, L"%s: Failed to read file (error %u).\n", hookModuleFilename, GetLastError());
+    return false;
+  }
+
+  const IMAGE_DOS_HEADER* const dosHeader =
+      reinterpret_cast<const IMAGE_DOS_HEADER*>(fileContents.data());
+  if ((fileContents.size() < sizeof(IMAGE_DOS_HEADER)) ||
+      (IMAGE_DOS_SIGNATURE != dosHeader->e_magic) || (dosHeader->e_lfanew < 0) ||
+      ((static_cast<uint64_t>(dosHeader->e_lfanew) + sizeof(IMAGE_NT_HEADERS64)) >
+       fileContents.size()))
+  {
+    fwprintf(stderr, L"%s: Not an executable file.\n", hookModuleFilename);
+    return false;
+  }
+
+  const IMAGE_NT_HEADERS64* const fileNtHeaders =
+      reinterpret_cast<const IMAGE_NT_HEADERS64*>(&fileContents[dosHeader->e_lfanew]);
+  const IMAGE_OPTIONAL_HEADER64& optionalHeader = fileNtHeaders->OptionalHeader;
+  if ((IMAGE_NT_SIGNATURE != fileNtHeaders->Signature) ||
+      (IMAGE_FILE_MACHINE_AMD64 != fileNtHeaders->FileHeader.Machine) ||
+      (IMAGE_NT_OPTIONAL_HDR64_MAGIC != optionalHeader.Magic) ||
+      (0 == (fileNtHeaders->FileHeader.Characteristics & IMAGE_FILE_DLL)))
+  {
+    fwprintf(stderr, L"%s: Not a 64-bit library.\n", hookModuleFilename);
+    return false;
+  }
+
+  if (optionalHeader.SectionAlignment < 4096)
+  {
+    fwprintf(stderr, L"%s: Sections are not page-aligned.\n", hookModuleFilename);
+    return false;
+  }
+
+  if ((optionalHeader.NumberOfRvaAndSizes <= IMAGE_DIRECTORY_ENTRY_TLS) ||
+      (0 != optionalHeader.DataDirectory[IMAGE_DIRECTORY_ENTRY_TLS].Size))
+  {
+    fwprintf(stderr, L"%s: Uses implicit thread-local storage.\n", hookModuleFilename);
+    return false;
+  }
+
+  const IMAGE_DATA_DIRECTORY& relocationDirectory =
+      optionalHeader.DataDirectory[IMAGE_DIRECTORY_ENTRY_BASERELOC];
+  if ((0 != (fileNtHeaders->FileHeader.Characteristics & IMAGE_FILE_RELOCS_STRIPPED)) ||
+      (0 == relocationDirectory.Size) ||
+      ((static_cast<uint64_t>(relocationDirectory.VirtualAddress) + relocationDirectory.Size) >
+       optionalHeader.SizeOfImage))
+  {
+    fwprintf(stderr, L"%s: Cannot be relocated.\n", hookModuleFilename);
+    return false;
+  }
+
+  std::vector<uint8_t>& image = laidOutHookModule->image;
+  image.assign(optionalHeader.SizeOfImage, 0);
+
+  if ((optionalHeader.SizeOfHeaders > image.size()) ||
+      (optionalHeader.SizeOfHeaders > fileContents.size()))
+  {
+    fwprintf(stderr, L"%s: Headers are malformed.\n", hookModuleFilename);
+    return false;
+  }
+  std::memcpy(image.data(), fileContents.data(), optionalHeader.SizeOfHeaders);
+
+  const IMAGE_SECTION_HEADER* const sectionHeaders = IMAGE_FIRST_SECTION(fileNtHeaders);
+  for (WORD i = 0; i < fileNtHeaders->FileHeader.NumberOfSections; ++i)
+  {
+    const IMAGE_SECTION_HEADER& sectionHeader = sectionHeaders[i];
+    const uint32_t numBytesToCopy = ((0 == sectionHeader.Misc.VirtualSize)
+                                         ? sectionHeader.SizeOfRawData
+                                         : std::min(
+                                               sectionHeader.SizeOfRawData,
+                                               sectionHeader.Misc.VirtualSize));
+    if (0 == numBytesToCopy) continue;
+
+    if (((static_cast<uint64_t>(sectionHeader.VirtualAddress) + numBytesToCopy) > image.size()) ||
+        ((static_cast<uint64_t>(sectionHeader.PointerToRawData) + numBytesToCopy) >
+         fileContents.size()))
+    {
+      fwprintf(stderr, L"%s: Section data is malformed.\n", hookModuleFilename);
+      return false;
+    }
+
+    std::memcpy(
+        &image[sectionHeader.VirtualAddress],
+        &fileContents[sectionHeader.PointerToRawData],
+        numBytesToCopy);
+  }
+
+  IMAGE_NT_HEADERS64* const imageNtHeaders =
+      reinterpret_cast<IMAGE_NT_HEADERS64*>(&image[dosHeader->e_lfanew]);
+  if (false == RelocateImage(image, imageNtHeaders, baseAddress))
+  {
+    fwprintf(stderr, L"%s: Relocation data is malformed.\n", hookModuleFilename);
+    return false;
+  }
+
+  const std::wstring_view hookModuleFilenameView(hookModuleFilename);
+  const size_t lastSeparatorPosition = hookModuleFilenameView.find_last_of(L"\\/");
+  laidOutHookModule->name =
+      ((std::wstring_view::npos == lastSeparatorPosition)
+           ? hookModuleFilenameView
+           : hookModuleFilenameView.substr(lastSeparatorPosition + 1));
+  if (laidOutHookModule->name.length() >= HookModuleBundle::kMaxHookModuleNameChars)
+  {
+    fwprintf(stderr, L"%s: File name is too long.\n", hookModuleFilename);
+    return false;
+  }
+
+  return true;
+}
+
+/// Rounds a size or an offset up to the alignment of hook module images within a hook module
+/// bundle file.
+/// @param [in] value Value to round.
+/// @return Rounded value.
+static inline uint64_t AlignToImageBoundary(const uint64_t value)
+{
+  return (
+      ((value + HookModuleBundle::kImageAlignmentBytes - 1) /
+       HookModuleBundle::kImageAlignmentBytes) *
+      HookModuleBundle::kImageAlignmentBytes);
+}
+
+/// Writes a hook module bundle file that holds the specified hook modules.
+/// @param [in] bundleFilename Name of the hook module bundle file to write.
+/// @param [in] preferredBaseAddress Base address for which the hook modules were relocated.
+/// @param [in] laidOutHookModules Hook modules to include, in the order in which they are loaded.
+/// @return `true` if the file was written, `false` otherwise.
+static bool WriteHookModuleBundleFile(
+    const wchar_t* bundleFilename,
+    const uint64_t preferredBaseAddress,
+    const std::vector<SLaidOutHookModule>& laidOutHookModules)
+{
+  std::vector<HookModuleBundle::SModuleEntry> moduleEntries(laidOutHookModules.size());
+  uint64_t nextImageOffset = AlignToImageBoundary(
+      sizeof(HookModuleBundle::SFileHeader) +
+      (laidOutHookModules.size() * sizeof(HookModuleBundle::SModuleEntry)));
+
+  for (size_t i = 0; i < laidOutHookModules.size(); ++i)
+  {
+    moduleEntries[i].imageOffset = nextImageOffset;
+    moduleEntries[i].imageSizeBytes = static_cast<uint32_t>(laidOutHookModules[i].image.size());
+    laidOutHookModules[i].name.copy(
+        moduleEntries[i].name, HookModuleBundle::kMaxHookModuleNameChars - 1);
+
+    nextImageOffset =
+        AlignToImageBoundary(moduleEntries[i].imageOffset + moduleEntries[i].imageSizeBytes);
+  }
+
+  const uint64_t fileSizeBytes = ((true == moduleEntries.empty())
+                                      ? nextImageOffset
+                                      : (moduleEntries.back().imageOffset +
+                                         moduleEntries.back().imageSizeBytes));
+  const HookModuleBundle::SFileHeader fileHeader = {
+      .signature = HookModuleBundle::kSignature,
+      .version = HookModuleBundle::kVersion,
+      .machine = IMAGE_FILE_MACHINE_AMD64,
+      .numModules = static_cast<uint32_t>(moduleEntries.size()),
+      .preferredBaseAddress = preferredBaseAddress,
+      .fileSizeBytes = fileSizeBytes};
+
+  std::vector<uint8_t> bundleContents(static_cast<size_t>(fileSizeBytes), 0);
+  std::memcpy(bundleContents.data(), &fileHeader, sizeof(fileHeader));
+  std::memcpy(
+      &bundleContents[sizeof(fileHeader)],
+      moduleEntries.data(),
+      moduleEntries.size() * sizeof(HookModuleBundle::SModuleEntry));
+  for (size_t i = 0; i < laidOutHookModules.size(); ++i)
+  {
+    std::memcpy(
+        &bundleContents[moduleEntries[i].imageOffset],
+        laidOutHookModules[i].image.data(),
+        laidOutHookModules[i].image.size());
+  }
+
+  const HANDLE bundleFile = CreateFile(
+      bundleFilename,
+      GENERIC_WRITE,
+      0,
+      nullptr,
+      CREATE_ALWAYS,
+      FILE_ATTRIBUTE_NORMAL | FILE_FLAG_SEQUENTIAL_SCAN,
+      nullptr);
+  if (INVALID_HANDLE_VALUE == bundleFile)
+  {
+    fwprintf(stderr, L"%s: Failed to create file (error %u).\n", bundleFilename, GetLastError());
+    return false;
+  }
+
+  DWORD numBytesWritten = 0;
+  const bool writeSucceeded =
+      ((FALSE !=
+        WriteFile(
+            bundleFile,
+            bundleContents.data(),
+            static_cast<DWORD>(bundleContents.size()),
+            &numBytesWritten,
+            nullptr)) &&
+       (static_cast<DWORD>(bundleContents.size()) == numBytesWritten));
+
+  CloseHandle(bundleFile);
+
+  if (false == writeSucceeded)
+  {
+    fwprintf(stderr, L"%s: Failed to write file (error %u).\n", bundleFilename, GetLastError());
+    DeleteFile(bundleFilename);
+    return false;
+  }
+
+  wprintf(
+      L"%s: Wrote %u hook modules relocated for base address 0x%016llx, %llu bytes in total.\n",
+      bundleFilename,
+      (unsigned int)laidOutHookModules.size(),
+      (unsigned long long)preferredBaseAddress,
+      (unsigned long long)fileSizeBytes);
+  return true;
+}
+
+/// Prints usage information.
+static void PrintUsage(void)
+{
+  wprintf(
+      L"Usage: HookshotBundle [--base=<address>] <bundle file> <hook module>...\n\n"
+      L"Packs 64-bit hook modules into a single hook module bundle file, which Hookshot maps into\n"
+      L"memory in one step when it is named by the HookModuleBundle configuration setting. Each\n"
+      L"hook module is laid out the way it appears in memory once loaded and is relocated ahead\n"
+      L"of time for the specified hexadecimal base address, which must be a multiple of 64 KB.\n"
+      L"Hook modules are loaded in the order given here. Hook modules that use implicit\n"
+      L"thread-local storage or that cannot be relocated are rejected. The bundle file must be\n"
+      L"recreated whenever any of the hook modules changes.\n");
+}
+
+int wmain(int argc, wchar_t* argv[])
+{
+  uint64_t preferredBaseAddress = kDefaultPreferredBaseAddress;
+  int argIndex = 1;
+
+  if ((argIndex < argc) &&
+      (true == std::wstring_view(argv[argIndex]).starts_with(kOptionBaseAddress)))
+  {
+    preferredBaseAddress = wcstoull(&argv[argIndex][kOptionBaseAddress.length()], nullptr, 16);
+    argIndex += 1;
+  }
+
+  if (((argc - argIndex) < 2) || (0 == preferredBaseAddress) ||
+      (0 != (preferredBaseAddress % HookModuleBundle::kImageAlignmentBytes)))
+  {
+    PrintUsage();
+    return __LINE__;
+  }
+
+  const wchar_t* const bundleFilename = argv[argIndex];
+  std::vector<SLaidOutHookModule> laidOutHookModules;
+  uint64_t nextImageOffset = AlignToImageBoundary(
+      sizeof(HookModuleBundle::SFileHeader) +
+      (static_cast<uint64_t>(argc - argIndex - 1) * sizeof(HookModuleBundle::SModuleEntry)));
+  bool allHookModulesLaidOut = true;
+
+  for (argIndex += 1; argIndex < argc; ++argIndex)
+  {
+    SLaidOutHookModule laidOutHookModule;
+    if (false ==
+        LayOutHookModule(
+            argv[argIndex], preferredBaseAddress + nextImageOffset, &laidOutHookModule))
+    {
+      allHookModulesLaidOut = false;
+      continue;
+    }
+
+    const bool isDuplicate = std::any_of(
+        laidOutHookModules.begin(),
+        laidOutHookModules.end(),
+        [&laidOutHookModule](const SLaidOutHookModule& existing) -> bool
+        {
+          return std::equal(
+              existing.name.begin(),
+              existing.name.end(),
+              laidOutHookModule.name.begin(),
+              laidOutHookModule.name.end(),
+              [](wchar_t charA, wchar_t charB) -> bool
+              {
+                return (std::towlower(charA) == std::towlower(charB));
+              });
+        });
+    if (true == isDuplicate)
+    {
+      fwprintf(stderr, L"%s: Same file name as an earlier hook module.\n", argv[argIndex]);
+      allHookModulesLaidOut = false;
+      continue;
+    }
+
+    wprintf(
+        L"%s: Laid out %u bytes.\n",
+        argv[argIndex],
+        (unsigned int)laidOutHookModule.image.size());
+    nextImageOffset = AlignToImageBoundary(nextImageOffset + laidOutHookModule.image.size());
+    laidOutHookModules.push_back(std::move(laidOutHookModule));
+  }
+
+  if (false == allHookModulesLaidOut) return __LINE__;
+
+  if (false ==
+      WriteHookModuleBundleFile(bundleFilename, preferredBaseAddress, laidOutHookModules))
+    return __LINE__;
+
+  return 0;
+}
@@ -0,0 +1,316 @@
+/***************************************************************************************************
+ * Hookshot
+ *   General-purpose library for injecting DLLs and hooking function calls.
+ ***************************************************************************************************
+ * Authored by Samuel Grossman
+ * Copyright (c) 2019-2025
+ ***********************************************************************************************//**
+ * @file HookModuleManifest.cpp
+ *   Implementation of the cached list of hook modules present in a directory.
+ **************************************************************************************************/
+
+#include "HookModuleManifest.h"
+
+#include <cstddef>
+#include <cstdint>
+#include <cwctype>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include <Infra/Core/Configuration.h>
+#include <Infra/Core/ProcessInfo.h>
+#include <Infra/Core/Strings.h>
+#include <Infra/Core/TemporaryBuffer.h>
+
+#include "ApiWindows.h"
+#include "Globals.h"
+#include "Strings.h"
+
+namespace Hookshot
+{
+  namespace HookModuleManifest
+  {
+    /// Signature that identifies a hook module manifest file. Spells "HSMM" in a hex dump.
+    static constexpr uint32_t kHookModuleManifestSignature = 0x4d4d5348;
+
+    /// Version of the hook module manifest file format. Must be incremented whenever the format
+    /// changes.
+    static constexpr uint32_t kHookModuleManifestVersion = 1;
+
+    /// File extension for a hook module manifest file.
+    static constexpr std::wstring_view kStrHookModuleManifestFileExtension = L".HookModuleManifest";
+
+    /// Alignment, in bytes, of each entry within a hook module manifest file.
+    static constexpr size_t kHookModuleManifestEntryAlignment = 8;
+
+    /// Header at the very beginning of a hook module manifest file.
+    struct SHookModuleManifestFileHeader
+    {
+      /// Must be equal to #kHookModuleManifestSignature.
+      uint32_t signature;
+
+      /// Must be equal to #kHookModuleManifestVersion.
+      uint32_t version;
+
+      /// Last-modified time of the directory from which the manifest was generated.
+      uint64_t directoryLastWriteTime;
+
+      /// Number of entries that follow the header.
+      uint32_t numEntries;
+
+      /// Unused, for alignment only.
+      uint32_t reserved;
+    };
+
+    /// Header for a single entry in a hook module manifest file. Immediately followed by the full
+    /// path of the hook module, which is not null-terminated. The next entry begins at the next
+    /// multiple of #kHookModuleManifestEntryAlignment.
+    struct SHookModuleManifestFileEntry
+    {
+      /// Number of characters in the full path of the hook module.
+      uint32_t fileNameLength;
+
+      /// Unused, for alignment only.
+      uint32_t reserved;
+    };
+
+    static_assert(
+        0 == (sizeof(SHookModuleManifestFileHeader) % kHookModuleManifestEntryAlignment),
+        "Hook module manifest file header size must preserve entry alignment.");
+    static_assert(
+        0 == (sizeof(SHookModuleManifestFileEntry) % kHookModuleManifestEntryAlignment),
+        "Hook module manifest file entry header size must preserve entry alignment.");
+
+    /// Rounds an offset within a hook module manifest file up to the next entry boundary.
+    /// @param [in] offset Offset to round.
+    /// @return Rounded offset.
+    static inline size_t AlignToEntryBoundary(size_t offset)
+    {
+      return (offset + (kHookModuleManifestEntryAlignment - 1)) &
+          ~(kHookModuleManifestEntryAlignment - 1);
+    }
+
+    /// Determines the name of the manifest file for a hook module directory. It is placed in the
+    /// temporary directory, because the hook module directory might not be writable, and is named
+    /// using a hash of the hook module directory's path so that each directory has its own.
+    /// @param [in] directoryName Full path of the directory that contains the hook modules.
+    /// @return Hook module manifest file name, or an empty string if it could not be determined.
+    static Infra::TemporaryString GetHookModuleManifestFilename(std::wstring_view directoryName)
+    {
+      Infra::TemporaryString temporaryDirectory;
+      temporaryDirectory.UnsafeSetSize(
+          GetTempPath(temporaryDirectory.Capacity(), temporaryDirectory.Data()));
+      if (true == temporaryDirectory.Empty()) return Infra::TemporaryString();
+
+      uint64_t directoryNameHash = 14695981039346656037ull;
+      for (wchar_t c : directoryName)
+      {
+        directoryNameHash ^= static_cast<uint64_t>(std::towlower(c));
+        directoryNameHash *= 1099511628211ull;
+      }
+
+      Infra::TemporaryString filename;
+      filename << temporaryDirectory.AsStringView() << Infra::ProcessInfo::GetProductName()
+               << L"."
+               << Infra::Strings::Format(L"%016llx", (long long)directoryNameHash).AsStringView()
+               << kStrHookModuleManifestFileExtension;
+      return filename;
+    }
+
+    /// Parses the contents of a hook module manifest file.
+    /// @param [in] manifestData Contents of the hook module manifest file.
+    /// @param [in] manifestSize Size of the hook module manifest file, in bytes.
+    /// @param [in] directoryLastWriteTime Last-modified time of the hook module directory.
+    /// @param [out] hookModuleFileNames Filled with the full path of each hook module.
+    /// @return `true` if the manifest file is valid and matches the directory, `false` otherwise.
+    static bool ParseHookModuleManifest(
+        const uint8_t* manifestData,
+        size_t manifestSize,
+        uint64_t directoryLastWriteTime,
+        std::vector<std::wstring>* hookModuleFileNames)
+    {
+      if (manifestSize < sizeof(SHookModuleManifestFileHeader)) return false;
+
+      const SHookModuleManifestFileHeader* const fileHeader =
+          reinterpret_cast<const SHookModuleManifestFileHeader*>(manifestData);
+      if ((kHookModuleManifestSignature != fileHeader->signature) ||
+          (kHookModuleManifestVersion != fileHeader->version) ||
+          (directoryLastWriteTime != fileHeader->directoryLastWriteTime))
+        return false;
+
+      std::vector<std::wstring> parsedHookModuleFileNames;
+      parsedHookModuleFileNames.reserve(fileHeader->numEntries);
+      size_t offset = sizeof(SHookModuleManifestFileHeader);
+
+      for (uint32_t i = 0; i < fileHeader->numEntries; ++i)
+      {
+        if ((manifestSize - offset) < sizeof(SHookModuleManifestFileEntry)) return false;
+
+        const SHookModuleManifestFileEntry* const fileEntry =
+            reinterpret_cast<const SHookModuleManifestFileEntry*>(&manifestData[offset]);
+        offset += sizeof(SHookModuleManifestFileEntry);
+
+        const size_t numStringBytes =
+            sizeof(wchar_t) * static_cast<size_t>(fileEntry->fileNameLength);
+        if ((manifestSize - offset) < numStringBytes) return false;
+
+        parsedHookModuleFileNames.emplace_back(
+            reinterpret_cast<const wchar_t*>(&manifestData[offset]), fileEntry->fileNameLength);
+
+        offset = AlignToEntryBoundary(offset + numStringBytes);
+        if (offset > manifestSize) return false;
+      }
+
+      *hookModuleFileNames = std::move(parsedHookModuleFileNames);
+      return true;
+    }
+
+    bool IsEnabled(void)
+    {
+      static const bool hookModuleManifestEnabled =
+          Globals::GetConfigurationData()
+              [Infra::Configuration::kSectionNameGlobal]
+              [Strings::kStrConfigurationSettingNameCacheHookModuleManifest]
+                  .ValueOr(false);
+
+      return hookModuleManifestEnabled;
+    }
+
+    bool GetDirectoryLastWriteTime(std::wstring_view directoryName, uint64_t* lastWriteTime)
+    {
+      WIN32_FILE_ATTRIBUTE_DATA directoryAttributes{};
+      if (FALSE ==
+          GetFileAttributesEx(
+              std::wstring(directoryName).c_str(), GetFileExInfoStandard, &directoryAttributes))
+        return false;
+
+      if (0 == (directoryAttributes.dwFileAttributes & FILE_ATTRIBUTE_DIRECTORY)) return false;
+
+      *lastWriteTime =
+          (static_cast<uint64_t>(directoryAttributes.ftLastWriteTime.dwHighDateTime) << 32) |
+          static_cast<uint64_t>(directoryAttributes.ftLastWriteTime.dwLowDateTime);
+      return true;
+    }
+
+    bool ReadHookModuleManifest(
+        std::wstring_view directoryName, std::vector<std::wstring>* hookModuleFileNames)
+    {
+      uint64_t directoryLastWriteTime = 0;
+      if (false == GetDirectoryLastWriteTime(directoryName, &directoryLastWriteTime)) return false;
+
+      const Infra::TemporaryString manifestFilename = GetHookModuleManifestFilename(directoryName);
+      if (true == manifestFilename.Empty()) return false;
+
+      const HANDLE manifestFile = CreateFile(
+          manifestFilename.AsCString(),
+          GENERIC_READ,
+          FILE_SHARE_READ | FILE_SHARE_DELETE,
+          nullptr,
+          OPEN_EXISTING,
+          FILE_ATTRIBUTE_NORMAL,
+          nullptr);
+      if (INVALID_HANDLE_VALUE == manifestFile) return false;
+
+      bool manifestIsValid = false;
+
+      LARGE_INTEGER manifestSize{};
+      if ((FALSE != GetFileSizeEx(manifestFile, &manifestSize)) && (manifestSize.QuadPart > 0) &&
+          (manifestSize.QuadPart <= static_cast<LONGLONG>(UINT32_MAX)))
+      {
+        std::vector<uint8_t> manifestData(static_cast<size_t>(manifestSize.QuadPart));
+
+        DWORD numBytesRead = 0;
+        if ((FALSE !=
+             ReadFile(
+                 manifestFile,
+                 manifestData.data(),
+                 static_cast<DWORD>(manifestData.size()),
+                 &numBytesRead,
+                 nullptr)) &&
+            (static_cast<DWORD>(manifestData.size()) == numBytesRead))
+          manifestIsValid = ParseHookModuleManifest(
+              manifestData.data(),
+              manifestData.size(),
+              directoryLastWriteTime,
+              hookModuleFileNames);
+      }
+
+      CloseHandle(manifestFile);
+      return manifestIsValid;
+    }
+
+    void WriteHookModuleManifest(
+        std::wstring_view directoryName,
+        uint64_t directoryLastWriteTime,
+        const std::vector<std::wstring>& hookModuleFileNames)
+    {
+      const Infra::TemporaryString manifestFilename = GetHookModuleManifestFilename(directoryName);
+      if (true == manifestFilename.Empty()) return;
+
+      std::vector<uint8_t> manifestData(sizeof(SHookModuleManifestFileHeader), 0);
+      *reinterpret_cast<SHookModuleManifestFileHeader*>(manifestData.data()) = {
+          .signature = kHookModuleManifestSignature,
+          .version = kHookModuleManifestVersion,
+          .directoryLastWriteTime = directoryLastWriteTime,
+          .numEntries = static_cast<uint32_t>(hookModuleFileNames.size()),
+          .reserved = 0};
+
+      for (const auto& hookModuleFileName : hookModuleFileNames)
+      {
+        const SHookModuleManifestFileEntry fileEntry = {
+            .fileNameLength = static_cast<uint32_t>(hookModuleFileName.length()), .reserved = 0};
+
+        const uint8_t* const fileEntryBytes = reinterpret_cast<const uint8_t*>(&fileEntry);
+        manifestData.insert(
+            manifestData.end(), fileEntryBytes, &fileEntryBytes[sizeof(fileEntry)]);
+
+        const uint8_t* const stringBytes =
+            reinterpret_cast<const uint8_t*>(hookModuleFileName.data());
+        manifestData.insert(
+            manifestData.end(),
+            stringBytes,
+            &stringBytes[sizeof(wchar_t) * hookModuleFileName.length()]);
+
+        manifestData.resize(AlignToEntryBoundary(manifestData.size()), 0);
+      }
+
+      // Multiple processes might try to generate the manifest at the same time, so each one writes
+      // to its own temporary file and then atomically replaces whatever manifest file is present.
+      Infra::TemporaryString temporaryManifestFilename;
+      temporaryManifestFilename << manifestFilename.AsStringView() << L"."
+                                << Infra::Strings::Format(L"%u", GetCurrentProcessId())
+                                       .AsStringView();
+
+      const HANDLE manifestFile = CreateFile(
+          temporaryManifestFilename.AsCString(),
+          GENERIC_WRITE,
+          0,
+          nullptr,
+          CREATE_ALWAYS,
+          FILE_ATTRIBUTE_TEMPORARY,
+          nullptr);
+      if (INVALID_HANDLE_VALUE == manifestFile) return;
+
+      DWORD numBytesWritten = 0;
+      const bool writeSucceeded =
+          ((FALSE !=
+            WriteFile(
+                manifestFile,
+                manifestData.data(),
+                static_cast<DWORD>(manifestData.size()),
+                &numBytesWritten,
+                nullptr)) &&
+           (static_cast<DWORD>(manifestData.size()) == numBytesWritten));
+      CloseHandle(manifestFile);
+
+      if ((false == writeSucceeded) ||
+          (FALSE ==
+           MoveFileEx(
+               temporaryManifestFilename.AsCString(),
+               manifestFilename.AsCString(),
+               MOVEFILE_REPLACE_EXISTING)))
+        DeleteFile(temporaryManifestFilename.AsCString());
+    }
+  } // namespace HookModuleManifest
+} // namespace Hookshot
@@ -0,0 +1,857 @@
+/***************************************************************************************************
+ * Hookshot
+ *   General-purpose library for injecting DLLs and hooking function calls.
+ ***************************************************************************************************
+ * Authored by Samuel Grossman
+ * Copyright (c) 2019-2025
+ ***********************************************************************************************//**
+ * @file HookModuleReloader.cpp
+ *   Implementation of reloading hook modules whenever their files change, without restarting the
+ *   process.
+ **************************************************************************************************/
+
+#include "HookModuleReloader.h"
+
+#include <atomic>
+#include <cstddef>
+#include <mutex>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+
+#include <Infra/Core/Configuration.h>
+#include <Infra/Core/Message.h>
+#include <Infra/Core/Strings.h>
+
+#include "ApiWindows.h"
+#include "DependencyProtect.h"
+#include "ExportResolver.h"
+#include "Globals.h"
+#include "HookStore.h"
+#include "HookTable.h"
+#include "HookshotTypes.h"
+#include "LibraryInterface.h"
+#include "Strings.h"
+#include "TaskScheduler.h"
+
+namespace Hookshot
+{
+  namespace HookModuleReloader
+  {
+    /// Function signature for the hook module initialization function.
+    using THookModuleInitProc = void(__fastcall*)(IHookshot*);
+
+    /// Amount of time to wait after a change is detected before checking hook module files, in
+    /// milliseconds. Build tools typically write a file in several steps.
+    static constexpr DWORD kChangeSettleTimeMilliseconds = 500;
+
+    /// Maximum number of times to check whether the previous version of a reloaded hook module can
+    /// be unloaded before giving up and leaving it loaded.
+    static constexpr int kMaxUnloadAttempts = 50;
+
+    /// Amount of time to wait between checks for whether the previous version of a reloaded hook
+    /// module can be unloaded, in milliseconds.
+    static constexpr DWORD kUnloadRetryIntervalMilliseconds = 100;
+
+    /// Holds information about a hook module that is tracked for changes.
+    struct SWatchedHookModule
+    {
+      /// File name of the hook module itself.
+      std::wstring fileName;
+
+      /// File name of the copy from which the currently-loaded version was loaded.
+      std::wstring loadedCopyFileName;
+
+      /// Handle of the currently-loaded version.
+      HMODULE loadedModule;
+
+      /// Last-write time of the hook module file when the currently-loaded version was copied.
+      FILETIME lastWriteTime;
+
+      /// Number of times the hook module has been reloaded. Used to name each copy uniquely.
+      unsigned int generation;
+    };
+
+    /// Enforces serialized access to the tracked hook modules, which can be loaded in parallel.
+    static std::mutex watchedHookModulesMutex;
+
+    /// All hook modules that are tracked for changes.
+    static std::vector<SWatchedHookModule> watchedHookModules;
+
+    /// Identifier of the thread that is initializing a new version of a hook module, or 0 if no
+    /// hook module is being reloaded.
+    static std::atomic<DWORD> reloadingThreadId = 0;
+
+    /// Maps from original function address to the hook functions of the previous version of the
+    /// hook module being reloaded that have not yet been replaced. Only accessed by the thread
+    /// identified by #reloadingThreadId.
+    static std::unordered_multimap<const void*, const void*> replaceableHookFunctions;
+
+    /// Determines the file name of the copy of a hook module for a particular generation.
+    /// @param [in] hookModuleFileName File name of the hook module itself.
+    /// @param [in] generation Number of times the hook module has been reloaded.
+    /// @return File name of the copy.
+    static std::wstring CopyFileNameForGeneration(
+        std::wstring_view hookModuleFileName, unsigned int generation)
+    {
+      std::wstring copyFileName(hookModuleFileName);
+      copyFileName += L".reload";
+      copyFileName += std::to_wstring(generation);
+      return copyFileName;
+    }
+
+    /// Retrieves the last-write time of a file.
+    /// @param [in] fileName Name of the file of interest.
+    /// @param [out] lastWriteTime Filled with the last-write time on success.
+    /// @return `true` on success, `false` on failure.
+    static bool GetLastWriteTime(const std::wstring& fileName, FILETIME* lastWriteTime)
+    {
+      WIN32_FILE_ATTRIBUTE_DATA fileAttributes = {};
+      if (0 ==
+          Protected::Windows_GetFileAttributesEx(
+              fileName.c_str(), GetFileExInfoStandard, &fileAttributes))
+        return false;
+
+      *lastWriteTime = fileAttributes.ftLastWriteTime;
+      return true;
+    }
+
+    /// Copies a hook module file and loads the copy.
+    /// @param [in] hookModuleFileName File name of the hook module itself.
+    /// @param [in] copyFileName File name to use for the copy.
+    /// @return Handle of the loaded copy, or `nullptr` on failure.
+    static HMODULE LoadHookModuleCopy(
+        const std::wstring& hookModuleFileName, const std::wstring& copyFileName)
+    {
+      if (0 == Protected::Windows_CopyFile(hookModuleFileName.c_str(), copyFileName.c_str(), FALSE))
+        return nullptr;
+
+      const HMODULE hookModule = Protected::Windows_LoadLibrary(copyFileName.c_str());
+      if (nullptr == hookModule) Protected::Windows_DeleteFile(copyFileName.c_str());
+
+      return hookModule;
+    }
+
+    /// Determines the range of addresses occupied by the image of a loaded module.
+    /// @param [in] moduleHandle Handle of the module of interest.
+    /// @param [out] begin Filled with the lowest address in the range.
+    /// @param [out] end Filled with one past the highest address in the range.
+    /// @return `true` on success, `false` if the module's headers do not describe a valid image.
+    static bool GetModuleAddressRange(HMODULE moduleHandle, const void** begin, const void** end)
+    {
+      const IMAGE_DOS_HEADER* const dosHeader =
+          reinterpret_cast<const IMAGE_DOS_HEADER*>(moduleHandle);
+      if (IMAGE_DOS_SIGNATURE != dosHeader->e_magic) return false;
+
+      const IMAGE_NT_HEADERS* const ntHeader = reinterpret_cast<const IMAGE_NT_HEADERS*>(
+          reinterpret_cast<size_t>(dosHeader) + static_cast<size_t>(dosHeader->e_lfanew));
+      if (IMAGE_NT_SIGNATURE != ntHeader->Signature) return false;
+
+      *begin = moduleHandle;
+      *end = reinterpret_cast<const void*>(
+          reinterpret_cast<size_t>(moduleHandle) +
+          static_cast<size_t>(ntHeader->OptionalHeader.SizeOfImage));
+      return true;
+    }
+
+    /// Hookshot interface given to new versions of reloaded hook modules. Forwards everything to
+    /// the main Hookshot interface, except that while a new version is being initialized, hooks it
+    /// creates on original functions hooked by the previous version replace the previous version's
+    /// hook functions instead of being chained onto them. New versions hold onto this interface
+    /// for as long as they are loaded.
+    class HookModuleReloadInterface : public IHookshot,
+                                      public IHookshot10,
+                                      public IHookshot12
+    {
+    public:
+
+      // IHookshot
+      EResult __fastcall CreateHook(void* originalFunc, const void* hookFunc) override
+      {
+        const void* replacedHookFunc = nullptr;
+        if (true == TakeReplaceableHookFunction(originalFunc, &replacedHookFunc))
+          return Target()->ReplaceHookFunction(replacedHookFunc, hookFunc);
+
+        return Target()->CreateHook(originalFunc, hookFunc);
+      }
+
+      EResult __fastcall DisableHookFunction(const void* originalOrHookFunc) override
+      {
+        return Target()->DisableHookFunction(originalOrHookFunc);
+      }
+
+      const void* __fastcall GetOriginalFunction(const void* originalOrHookFunc) override
+      {
+        return Target()->GetOriginalFunction(originalOrHookFunc);
+      }
+
+      EResult __fastcall ReplaceHookFunction(
+          const void* originalOrHookFunc, const void* newHookFunc) override
+      {
+        return Target()->ReplaceHookFunction(originalOrHookFunc, newHookFunc);
+      }
+
+      EResult __fastcall CreateHooks(
+          const SHookSpec* hookSpecs, size_t numHookSpecs, EResult* results) override
+      {
+        if ((Protected::Windows_GetCurrentThreadId() != reloadingThreadId) ||
+            (nullptr == hookSpecs))
+          return Target()->CreateHooks(hookSpecs, numHookSpecs, results);
+
+        std::vector<EResult> localResults;
+        if (nullptr == results)
+        {
+          localResults.resize(numHookSpecs);
+          results = localResults.data();
+        }
+
+        // Replacements are done individually, and everything else still goes through as a batch.
+        std::vector<SHookSpec> remainingHookSpecs;
+        std::vector<size_t> remainingHookSpecIndices;
+        for (size_t i = 0; i < numHookSpecs; ++i)
+        {
+          const void* replacedHookFunc = nullptr;
+          if (true == TakeReplaceableHookFunction(hookSpecs[i].originalFunc, &replacedHookFunc))
+          {
+            results[i] = Target()->ReplaceHookFunction(replacedHookFunc, hookSpecs[i].hookFunc);
+          }
+          else
+          {
+            remainingHookSpecs.push_back(hookSpecs[i]);
+            remainingHookSpecIndices.push_back(i);
+          }
+        }
+
+        std::vector<EResult> remainingResults(remainingHookSpecs.size(), EResult::NoEffect);
+        Target()->CreateHooks(
+            remainingHookSpecs.data(), remainingHookSpecs.size(), remainingResults.data());
+        for (size_t i = 0; i < remainingHookSpecIndices.size(); ++i)
+          results[remainingHookSpecIndices[i]] = remainingResults[i];
+
+        for (size_t i = 0; i < numHookSpecs; ++i)
+        {
+          if (false == SuccessfulResult(results[i])) return results[i];
+        }
+
+        return EResult::Success;
+      }
+
+      EResult __fastcall BeginTransaction(void) override
+      {
+        return Target()->BeginTransaction();
+      }
+
+      EResult __fastcall CommitTransaction(void) override
+      {
+        return Target()->CommitTransaction();
+      }
+
+      EResult __fastcall GetHookStatistics(
+          const void* originalOrHookFunc, SHookStatistics* statistics) override
+      {
+        return Target()->GetHookStatistics(originalOrHookFunc, statistics);
+      }
+
+      EResult __fastcall RemoveHook(const void* originalOrHookFunc) override
+      {
+        return Target()->RemoveHook(originalOrHookFunc);
+      }
+
+      EResult __fastcall CreateDeferredHook(
+          const wchar_t* moduleName, const char* exportName, const void* hookFunc) override
+      {
+        // A deferred hook on a module that is already loaded might need to replace a hook function
+        // of the previous version, just like any other hook.
+        HMODULE moduleHandle = nullptr;
+        if ((Protected::Windows_GetCurrentThreadId() == reloadingThreadId) &&
+            (nullptr != moduleName) && (nullptr != exportName) &&
+            (0 !=
+             Protected::Windows_GetModuleHandleEx(
+                 GET_MODULE_HANDLE_EX_FLAG_UNCHANGED_REFCOUNT, moduleName, &moduleHandle)))
+        {
+          void* const originalFunc = ExportResolver::GetLocalProcAddress(moduleHandle, exportName);
+          if (nullptr != originalFunc) return CreateHook(originalFunc, hookFunc);
+        }
+
+        return Target()->CreateDeferredHook(moduleName, exportName, hookFunc);
+      }
+
+      EResult __fastcall CreateHooksByExportName(
+          void* moduleHandle,
+          const char* const* exportNames,
+          const void* const* hookFuncs,
+          size_t numHooks,
+          EResult* results) override
+      {
+        // Hooks go through this interface so that they can replace those of the previous version.
+        return HookStore::CreateHooksByExportNameInternal(
+            this, moduleHandle, exportNames, hookFuncs, numHooks, results);
+      }
+
+      EResult __fastcall CreateHookWithKind(
+          EHookKind hookKind,
+          void* originalFunc,
+          const void* hookFunc,
+          void* importingModule) override
+      {
+        if (EHookKind::Inline == hookKind) return CreateHook(originalFunc, hookFunc);
+        return Target()->CreateHookWithKind(hookKind, originalFunc, hookFunc, importingModule);
+      }
+
+      EResult __fastcall CreateVirtualTableHooks(
+          void* virtualTable,
+          const size_t* slotIndices,
+          const void* const* hookFuncs,
+          size_t numHooks,
+          EResult* results) override
+      {
+        return Target()->CreateVirtualTableHooks(
+            virtualTable, slotIndices, hookFuncs, numHooks, results);
+      }
+
+      EResult __fastcall SetHookReentrancyGuard(
+          const void* originalOrHookFunc, bool enabled) override
+      {
+        return Target()->SetHookReentrancyGuard(originalOrHookFunc, enabled);
+      }
+
+      size_t __fastcall GetReentrancyGuardDepthOffset(void) override
+      {
+        return Target()->GetReentrancyGuardDepthOffset();
+      }
+
+      EResult __fastcall SetHookCallerFilter(
+          const void* originalOrHookFunc,
+          const void* const* callerModules,
+          size_t numCallerModules) override
+      {
+        return Target()->SetHookCallerFilter(originalOrHookFunc, callerModules, numCallerModules);
+      }
+
+      EResult __fastcall CreateCallTraceHook(void* originalFunc) override
+      {
+        return Target()->CreateCallTraceHook(originalFunc);
+      }
+
+      EResult __fastcall GetHookTimingHistogram(
+          const void* originalOrHookFunc, SHookTimingHistogram* histogram) override
+      {
+        return Target()->GetHookTimingHistogram(originalOrHookFunc, histogram);
+      }
+
+      EResult __fastcall ReserveHooks(
+          size_t numHooks, const void* const* targetModules, size_t numTargetModules) override
+      {
+        return Target()->ReserveHooks(numHooks, targetModules, numTargetModules);
+      }
+
+      EResult __fastcall SnapshotHooks(
+          SHookInfo* hookInfo, size_t maxHookInfo, size_t* numHooks) override
+      {
+        return Target()->SnapshotHooks(hookInfo, maxHookInfo, numHooks);
+      }
+
+      EResult __fastcall SetHookGroup(const void* originalOrHookFunc, uint32_t groupId) override
+      {
+        return Target()->SetHookGroup(originalOrHookFunc, groupId);
+      }
+
+      EResult __fastcall SetHookGroupEnabled(uint32_t groupId, bool enabled) override
+      {
+        return Target()->SetHookGroupEnabled(groupId, enabled);
+      }
+
+      EResult __fastcall BeginCreateHooksAsync(
+          const SHookSpec* hookSpecs,
+          size_t numHookSpecs,
+          THookInstallProgressCallback progressCallback,
+          void* progressCallbackContext,
+          SHookInstallOperation** operation) override
+      {
+        return Target()->BeginCreateHooksAsync(
+            hookSpecs, numHookSpecs, progressCallback, progressCallbackContext, operation);
+      }
+
+      EResult __fastcall CancelHookInstall(SHookInstallOperation* operation) override
+      {
+        return Target()->CancelHookInstall(operation);
+      }
+
+      EResult __fastcall WaitForHookInstall(
+          SHookInstallOperation* operation, EResult* results) override
+      {
+        return Target()->WaitForHookInstall(operation, results);
+      }
+
+      EResult __fastcall CreateCallbackHook(
+          void* originalFunc,
+          TCallbackHookPre preCallback,
+          TCallbackHookPost postCallback,
+          void* context) override
+      {
+        return Target()->CreateCallbackHook(originalFunc, preCallback, postCallback, context);
+      }
+
+      EResult __fastcall CreateContextHook(
+          void* originalFunc, const void* hookFunc, void* context) override
+      {
+        return Target()->CreateContextHook(originalFunc, hookFunc, context);
+      }
+
+      size_t __fastcall GetHookContextOffset(void) override
+      {
+        return Target()->GetHookContextOffset();
+      }
+
+      EResult __fastcall CreateProbe(void* address, TProbeCallback callback, void* context) override
+      {
+        return Target()->CreateProbe(address, callback, context);
+      }
+
+      EResult __fastcall FindPatterns(
+          void* moduleHandle,
+          const SBytePattern* patterns,
+          size_t numPatterns,
+          void** results) override
+      {
+        return Target()->FindPatterns(moduleHandle, patterns, numPatterns, results);
+      }
+
+      EResult __fastcall CreateHotSwapHook(
+          void* originalFunc, const void* hookFunc, SHotSwapSlot** slot) override
+      {
+        return Target()->CreateHotSwapHook(originalFunc, hookFunc, slot);
+      }
+
+      EResult __fastcall HotSwapHookFunction(SHotSwapSlot* slot, const void* newHookFunc) override
+      {
+        return Target()->HotSwapHookFunction(slot, newHookFunc);
+      }
+
+      EResult __fastcall SetThreadHookOverride(
+          const void* originalOrHookFunc, const void* overrideFunc) override
+      {
+        return Target()->SetThreadHookOverride(originalOrHookFunc, overrideFunc);
+      }
+
+      EResult __fastcall SetHookLatencyBudget(
+          const void* originalOrHookFunc, uint32_t budgetMicroseconds) override
+      {
+        return Target()->SetHookLatencyBudget(originalOrHookFunc, budgetMicroseconds);
+      }
+
+      EResult __fastcall GetMemoryFootprint(SMemoryFootprint* footprint) override
+      {
+        return Target()->GetMemoryFootprint(footprint);
+      }
+
+      EResult __fastcall GetTrampolineStoreFootprints(
+          STrampolineStoreFootprint* storeFootprints,
+          size_t maxStoreFootprints,
+          size_t* numStores) override
+      {
+        return Target()->GetTrampolineStoreFootprints(
+            storeFootprints, maxStoreFootprints, numStores);
+      }
+
+      EResult __fastcall GetModuleFootprints(
+          SModuleFootprint* moduleFootprints,
+          size_t maxModuleFootprints,
+          size_t* numModules) override
+      {
+        return Target()->GetModuleFootprints(moduleFootprints, maxModuleFootprints, numModules);
+      }
+
+      void* __fastcall QueryInterface(uint32_t version) override
+      {
+        // Only creating hooks involves replacing those of the previous version. Of the other
+        // interface versions, only the tenth and twelfth create ordinary hooks, and the tenth is
+        // the one the hook templates use, so the rest are offered without going through here.
+        switch (version)
+        {
+          case kInterfaceVersion1:
+            return static_cast<IHookshot*>(this);
+
+          case kInterfaceVersion10:
+            return ((nullptr != Target()->QueryInterface(kInterfaceVersion10))
+                        ? static_cast<IHookshot10*>(this)
+                        : nullptr);
+
+          case kInterfaceVersion12:
+            return ((nullptr != Target()->QueryInterface(kInterfaceVersion12))
+                        ? static_cast<IHookshot12*>(this)
+                        : nullptr);
+
+          default:
+            return Target()->QueryInterface(version);
+        }
+      }
+
+      // IHookshot10
+      EResult __fastcall CreateHookEx(
+          void* originalFunc,
+          const void* hookFunc,
+          const void** originalFuncOut,
+          HookHandle* handleOut) override
+      {
+        const void* replacedHookFunc = nullptr;
+        if (false == TakeReplaceableHookFunction(originalFunc, &replacedHookFunc))
+          return TargetInterface<IHookshot10>(kInterfaceVersion10)
+              ->CreateHookEx(originalFunc, hookFunc, originalFuncOut, handleOut);
+
+        const EResult result = Target()->ReplaceHookFunction(replacedHookFunc, hookFunc);
+        if (true == SuccessfulResult(result))
+        {
+          if (nullptr != originalFuncOut)
+            *originalFuncOut = Target()->GetOriginalFunction(hookFunc);
+
+          IHookshot11* const hookshot11 = TargetInterface<IHookshot11>(kInterfaceVersion11);
+          if ((nullptr != handleOut) &&
+              ((nullptr == hookshot11) ||
+               (false == SuccessfulResult(hookshot11->GetHookHandle(hookFunc, handleOut)))))
+            *handleOut = kInvalidHookHandle;
+        }
+
+        return result;
+      }
+
+      // IHookshot12
+      EResult __fastcall CreateHooksBySymbol(
+          const wchar_t* symbolIndexFilename,
+          void* moduleHandle,
+          const char* const* symbolNames,
+          const void* const* hookFuncs,
+          size_t numHooks,
+          EResult* results) override
+      {
+        // Hooks go through this interface so that they can replace those of the previous version.
+        return HookStore::CreateHooksBySymbolInternal(
+            this, symbolIndexFilename, moduleHandle, symbolNames, hookFuncs, numHooks, results);
+      }
+
+    private:
+
+      /// Retrieves the main Hookshot interface, to which everything is forwarded.
+      /// @return Main Hookshot interface object pointer.
+      static inline IHookshot* Target(void)
+      {
+        return LibraryInterface::GetHookshotInterfacePointer();
+      }
+
+      /// Retrieves a later version of the main Hookshot interface.
+      /// @tparam InterfaceType Type of the interface to retrieve.
+      /// @param [in] version Version number of the interface to retrieve.
+      /// @return Interface object pointer, or `nullptr` if the version is not offered.
+      template <typename InterfaceType>
+      static inline InterfaceType* TargetInterface(const uint32_t version)
+      {
+        return reinterpret_cast<InterfaceType*>(Target()->QueryInterface(version));
+      }
+
+      /// Determines whether or not a hook on the specified original function should replace a hook
+      /// function of the previous version of the hook module being reloaded, and if so, stops
+      /// tracking that hook function as replaceable.
+      /// @param [in] originalFunc Address of the function being hooked.
+      /// @param [out] replacedHookFunc Filled with the hook function to be replaced, if any.
+      /// @return `true` if a hook function should be replaced, `false` otherwise.
+      static bool TakeReplaceableHookFunction(
+          const void* originalFunc, const void** replacedHookFunc)
+      {
+        if (Protected::Windows_GetCurrentThreadId() != reloadingThreadId) return false;
+
+        const auto replaceableIter = replaceableHookFunctions.find(originalFunc);
+        if (replaceableHookFunctions.end() == replaceableIter) return false;
+
+        *replacedHookFunc = replaceableIter->second;
+        replaceableHookFunctions.erase(replaceableIter);
+        return true;
+      }
+    };
+
+    /// Single Hookshot interface object given to new versions of reloaded hook modules.
+    static HookModuleReloadInterface hookModuleReloadInterface;
+
+    /// Waits for no other thread to be using the specified version of a hook module and then
+    /// unloads it and deletes the copy from which it was loaded.
+    /// @param [in] hookModuleFileName File name of the hook module, for logging purposes.
+    /// @param [in] hookModule Handle of the version to unload.
+    /// @param [in] copyFileName File name of the copy from which the version was loaded.
+    /// @return `true` if the version was unloaded, `false` if it is still loaded.
+    static bool UnloadPreviousVersion(
+        const std::wstring& hookModuleFileName, HMODULE hookModule, const std::wstring& copyFileName)
+    {
+      const void* moduleBegin = nullptr;
+      const void* moduleEnd = nullptr;
+      if (false == GetModuleAddressRange(hookModule, &moduleBegin, &moduleEnd)) return false;
+
+      for (int attempt = 0; attempt < kMaxUnloadAttempts; ++attempt)
+      {
+        if (false == HookStore::IsAddressRangeInUseByOtherThreads(moduleBegin, moduleEnd))
+        {
+          Protected::Windows_FreeLibrary(hookModule);
+          Protected::Windows_DeleteFile(copyFileName.c_str());
+          return true;
+        }
+
+        Protected::Windows_Sleep(kUnloadRetryIntervalMilliseconds);
+      }
+
+      Infra::Message::OutputFormatted(
+          Infra::Message::ESeverity::Warning,
+          L"%s - Previous version of reloaded hook module remains loaded because other threads are still using it.",
+          hookModuleFileName.c_str());
+      return false;
+    }
+
+    /// Loads and initializes a new version of a tracked hook module, moves hooks over from the
+    /// previous version, and then unloads the previous version.
+    /// @param [in,out] watchedHookModule Tracked hook module to reload.
+    /// @param [in] newLastWriteTime Last-write time of the new version of the hook module file.
+    static void ReloadHookModule(
+        SWatchedHookModule& watchedHookModule, const FILETIME& newLastWriteTime)
+    {
+      const std::wstring& hookModuleFileName = watchedHookModule.fileName;
+
+      Infra::Message::OutputFormatted(
+          Infra::Message::ESeverity::Info,
+          L"%s - Hook module file changed, attempting to reload it.",
+          hookModuleFileName.c_str());
+
+      // The file might still be in the middle of being written, in which case another change will
+      // be detected once it is done.
+      const std::wstring newCopyFileName =
+          CopyFileNameForGeneration(hookModuleFileName, watchedHookModule.generation + 1);
+      const HMODULE newModule = LoadHookModuleCopy(hookModuleFileName, newCopyFileName);
+      if (nullptr == newModule)
+      {
+        Infra::Message::OutputFormatted(
+            Infra::Message::ESeverity::Warning,
+            L"%s - Failed to load new version of hook module: %s",
+            hookModuleFileName.c_str(),
+            Infra::Strings::FromSystemErrorCode(Protected::Windows_GetLastError()).AsCString());
+        return;
+      }
+
+      // A new version that cannot be initialized is not retried until the file changes again.
+      watchedHookModule.lastWriteTime = newLastWriteTime;
+
+      const THookModuleInitProc initProc = (THookModuleInitProc)Protected::Windows_GetProcAddress(
+          newModule, Strings::kStrHookLibraryInitFuncName.data());
+      HookTable::SHookModuleHookTable hookTable = {
+          .hookModuleFileName = hookModuleFileName.c_str()};
+      const bool hasHookTable =
+          HookTable::LocateHookTable(newModule, &hookTable.entries, &hookTable.numEntries);
+      const void* oldModuleBegin = nullptr;
+      const void* oldModuleEnd = nullptr;
+      if (((nullptr == initProc) && (false == hasHookTable)) ||
+          (false ==
+           GetModuleAddressRange(watchedHookModule.loadedModule, &oldModuleBegin, &oldModuleEnd)))
+      {
+        Infra::Message::OutputFormatted(
+            Infra::Message::ESeverity::Warning,
+            L"%s - Failed to locate required procedure in new version of hook module.",
+            hookModuleFileName.c_str());
+
+        Protected::Windows_FreeLibrary(newModule);
+        Protected::Windows_DeleteFile(newCopyFileName.c_str());
+        return;
+      }
+
+      const std::vector<HookStore::SHookInRange> oldHooks =
+          HookStore::HooksWithHookFunctionsInRange(oldModuleBegin, oldModuleEnd);
+
+      replaceableHookFunctions.clear();
+      for (const auto& oldHook : oldHooks)
+        replaceableHookFunctions.insert({oldHook.originalFunc, oldHook.hookFunc});
+
+      // Hooks that are new in this version all go live together once initialization is done.
+      // Replaced hooks take effect immediately, whether or not a transaction is open.
+      IHookshot* const hookshot = LibraryInterface::GetHookshotInterfacePointer();
+      const bool isTransactionOpen = SuccessfulResult(hookshot->BeginTransaction());
+
+      reloadingThreadId = Protected::Windows_GetCurrentThreadId();
+      if (0 != hookTable.numEntries)
+        HookTable::InstallHookTables(&hookModuleReloadInterface, &hookTable, 1);
+      if (nullptr != initProc) initProc(&hookModuleReloadInterface);
+      reloadingThreadId = 0;
+
+      if (true == isTransactionOpen) hookshot->CommitTransaction();
+
+      const size_t numHooksMoved = oldHooks.size() - replaceableHookFunctions.size();
+
+      // Whatever was not replaced would otherwise continue to reference the previous version. Hooks
+      // that are part of a chain are just disabled, since removing them would remove the whole
+      // chain.
+      size_t numHooksRemoved = 0;
+      for (const auto& oldHook : oldHooks)
+      {
+        bool wasReplaced = true;
+        const auto replaceableRange = replaceableHookFunctions.equal_range(oldHook.originalFunc);
+        for (auto replaceableIter = replaceableRange.first;
+             replaceableIter != replaceableRange.second;
+             ++replaceableIter)
+        {
+          if (oldHook.hookFunc == replaceableIter->second) wasReplaced = false;
+        }
+
+        if (true == wasReplaced) continue;
+
+        const EResult removeResult =
+            ((true == oldHook.isChained) ? hookshot->DisableHookFunction(oldHook.hookFunc)
+                                         : hookshot->RemoveHook(oldHook.hookFunc));
+        if (true == SuccessfulResult(removeResult)) numHooksRemoved += 1;
+      }
+
+      replaceableHookFunctions.clear();
+
+      Infra::Message::OutputFormatted(
+          Infra::Message::ESeverity::Info,
+          L"%s - Successfully reloaded hook module, moving %llu hook(s) from the previous version and removing %llu.",
+          hookModuleFileName.c_str(),
+          (unsigned long long)numHooksMoved,
+          (unsigned long long)numHooksRemoved);
+
+      // The previous version is only unloaded if none of its hooks could still transfer control to
+      // it. Otherwise it simply stays loaded.
+      if (false == HookStore::HooksWithHookFunctionsInRange(oldModuleBegin, oldModuleEnd).empty())
+      {
+        Infra::Message::OutputFormatted(
+            Infra::Message::ESeverity::Warning,
+            L"%s - Previous version of reloaded hook module remains loaded because some of its hooks could not be moved or removed.",
+            hookModuleFileName.c_str());
+      }
+      else
+      {
+        UnloadPreviousVersion(
+            hookModuleFileName,
+            watchedHookModule.loadedModule,
+            watchedHookModule.loadedCopyFileName);
+      }
+
+      watchedHookModule.loadedCopyFileName = newCopyFileName;
+      watchedHookModule.loadedModule = newModule;
+      watchedHookModule.generation += 1;
+    }
+
+    /// Checks every tracked hook module for changes to its file and reloads those that changed.
+    static void ReloadChangedHookModules(void)
+    {
+      std::unique_lock<std::mutex> lock(watchedHookModulesMutex);
+
+      for (auto& watchedHookModule : watchedHookModules)
+      {
+        FILETIME lastWriteTime = {};
+        if (false == GetLastWriteTime(watchedHookModule.fileName, &lastWriteTime)) continue;
+        if (0 == CompareFileTime(&lastWriteTime, &watchedHookModule.lastWriteTime)) continue;
+
+        ReloadHookModule(watchedHookModule, lastWriteTime);
+      }
+    }
+
+    /// Thread procedure that watches a directory for changes and reloads tracked hook modules.
+    /// @param [in] parameter Pointer to a string holding the name of the directory to watch, whose
+    /// ownership is transferred to this function.
+    /// @return Exit code, which is always 0.
+    static DWORD WINAPI WatchThreadProc(LPVOID parameter)
+    {
+      const std::wstring directoryName(*reinterpret_cast<std::wstring*>(parameter));
+      delete reinterpret_cast<std::wstring*>(parameter);
+
+      const HANDLE changeNotification = Protected::Windows_FindFirstChangeNotification(
+          directoryName.c_str(),
+          FALSE,
+          FILE_NOTIFY_CHANGE_FILE_NAME | FILE_NOTIFY_CHANGE_LAST_WRITE);
+      if (INVALID_HANDLE_VALUE == changeNotification)
+      {
+        Infra::Message::OutputFormatted(
+            Infra::Message::ESeverity::Warning,
+            L"Failed to watch \"%s\" for hook module changes: %s",
+            directoryName.c_str(),
+            Infra::Strings::FromSystemErrorCode(Protected::Windows_GetLastError()).AsCString());
+        return 0;
+      }
+
+      Infra::Message::OutputFormatted(
+          Infra::Message::ESeverity::Info,
+          L"Watching \"%s\" and reloading hook modules whenever they change.",
+          directoryName.c_str());
+
+      while (WAIT_OBJECT_0 == Protected::Windows_WaitForSingleObject(changeNotification, INFINITE))
+      {
+        Protected::Windows_Sleep(kChangeSettleTimeMilliseconds);
+        ReloadChangedHookModules();
+
+        if (0 == Protected::Windows_FindNextChangeNotification(changeNotification)) break;
+      }
+
+      return 0;
+    }
+
+    bool IsHotReloadEnabled(void)
+    {
+      static const bool hotReloadEnabled =
+          Globals::GetConfigurationData()
+              [Infra::Configuration::kSectionNameGlobal]
+              [Strings::kStrConfigurationSettingNameHotReloadHookModules]
+                  .ValueOr(false);
+
+      return hotReloadEnabled;
+    }
+
+    HMODULE LoadHookModule(std::wstring_view hookModuleFileName)
+    {
+      SWatchedHookModule watchedHookModule = {
+          .fileName = std::wstring(hookModuleFileName),
+          .loadedCopyFileName = CopyFileNameForGeneration(hookModuleFileName, 0),
+          .loadedModule = nullptr,
+          .lastWriteTime = {},
+          .generation = 0};
+
+      if (true == GetLastWriteTime(watchedHookModule.fileName, &watchedHookModule.lastWriteTime))
+        watchedHookModule.loadedModule = LoadHookModuleCopy(
+            watchedHookModule.fileName, watchedHookModule.loadedCopyFileName);
+
+      if (nullptr == watchedHookModule.loadedModule)
+      {
+        Infra::Message::OutputFormatted(
+            Infra::Message::ESeverity::Warning,
+            L"%s - Hook module cannot be reloaded because a copy of it could not be loaded.",
+            watchedHookModule.fileName.c_str());
+        return Protected::Windows_LoadLibrary(watchedHookModule.fileName.c_str());
+      }
+
+      const HMODULE hookModule = watchedHookModule.loadedModule;
+
+      std::unique_lock<std::mutex> lock(watchedHookModulesMutex);
+      watchedHookModules.push_back(std::move(watchedHookModule));
+
+      return hookModule;
+    }
+
+    void StartWatching(std::wstring_view directoryName)
+    {
+      do
+      {
+        std::unique_lock<std::mutex> lock(watchedHookModulesMutex);
+        if (true == watchedHookModules.empty()) return;
+      }
+      while (false);
+
+      std::wstring* const watchThreadParameter = new std::wstring(directoryName);
+      const HANDLE watchThread =
+          TaskScheduler::CreateBackgroundThread(WatchThreadProc, watchThreadParameter);
+      if (nullptr == watchThread)
+      {
+        delete watchThreadParameter;
+        Infra::Message::OutputFormatted(
+            Infra::Message::ESeverity::Warning,
+            L"Failed to start watching for hook module changes: %s",
+            Infra::Strings::FromSystemErrorCode(Protected::Windows_GetLastError()).AsCString());
+        return;
+      }
+
+      Protected::Windows_CloseHandle(watchThread);
+    }
+  } // namespace HookModuleReloader
+} // namespace Hookshot
@@ -0,0 +1,750 @@
+/***************************************************************************************************
+ * Hookshot
+ *   General-purpose library for injecting DLLs and hooking function calls.
+ ***************************************************************************************************
+ * Authored by Samuel Grossman
+ * Copyright (c) 2019-2025
+ ***********************************************************************************************//**
+ * @file HookPlanCache.cpp
+ *   Implementation of the persistent cache of precomputed hook plans.
+ **************************************************************************************************/
+
+#include "HookPlanCache.h"
+
+#include <algorithm>
+#include <atomic>
+#include <cctype>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <iterator>
+#include <mutex>
+#include <shared_mutex>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include <Infra/Core/Configuration.h>
+#include <Infra/Core/ProcessInfo.h>
+#include <Infra/Core/Strings.h>
+#include <Infra/Core/TemporaryBuffer.h>
+
+#include "ApiWindows.h"
+#include "DependencyProtect.h"
+#include "Globals.h"
+#include "Strings.h"
+#include "Trampoline.h"
+#include "X86Instruction.h"
+
+namespace Hookshot
+{
+  namespace HookPlanCache
+  {
+    /// Signature that identifies a hook plan cache file. Spells "HSHP" in a hex dump.
+    static constexpr uint32_t kHookPlanCacheSignature = 0x50485348;
+
+    /// Version of the hook plan cache file format. Must be incremented whenever the format or the
+    /// way in which hook plans are generated changes.
+    static constexpr uint32_t kHookPlanCacheVersion = 1;
+
+    /// File extension for a hook plan cache file.
+    static constexpr std::wstring_view kStrHookPlanCacheFileExtension = L".HookPlanCache";
+
+    /// Maximum number of hook plans that a hook plan cache file can hold, which bounds its size.
+    /// If merging would exceed this number, only the hook plans recorded by the current process are
+    /// kept.
+    static constexpr size_t kMaxHookPlanCacheEntries = 65536;
+
+    /// Header at the very beginning of a hook plan cache file.
+    struct SHookPlanCacheFileHeader
+    {
+      /// Must be equal to #kHookPlanCacheSignature.
+      uint32_t signature;
+
+      /// Must be equal to #kHookPlanCacheVersion.
+      uint32_t version;
+
+      /// Size, in bytes, of each entry that follows the header.
+      uint32_t entrySizeBytes;
+
+      /// Number of entries that follow the header. Entries are sorted by key.
+      uint32_t numEntries;
+    };
+
+    /// Identifies the original function to which a hook plan belongs.
+    struct SHookPlanKey
+    {
+      /// Hash of the base name of the module that contains the original function.
+      uint64_t moduleNameHash;
+
+      /// Timestamp from the header of the module that contains the original function.
+      uint32_t moduleTimeDateStamp;
+
+      /// Offset of the original function from the base address of its module.
+      uint32_t rva;
+
+      inline bool operator==(const SHookPlanKey& other) const
+      {
+        return (moduleNameHash == other.moduleNameHash) &&
+            (moduleTimeDateStamp == other.moduleTimeDateStamp) && (rva == other.rva);
+      }
+
+      inline bool operator<(const SHookPlanKey& other) const
+      {
+        if (moduleNameHash != other.moduleNameHash) return (moduleNameHash < other.moduleNameHash);
+        if (moduleTimeDateStamp != other.moduleTimeDateStamp)
+          return (moduleTimeDateStamp < other.moduleTimeDateStamp);
+        return (rva < other.rva);
+      }
+    };
+
+    /// Single hook plan, as held both in memory and in a hook plan cache file.
+    struct SHookPlanCacheEntry
+    {
+      /// Original function to which the hook plan belongs.
+      SHookPlanKey key;
+
+      /// Number of valid elements in #planInstructions.
+      uint8_t numInstructions;
+
+      /// Number of original function bytes occupied by the instructions.
+      uint8_t numDecodedBytes;
+
+      /// Number of valid elements in #examinedBytes.
+      uint8_t numExaminedBytes;
+
+      /// Unused, for alignment only.
+      uint8_t reserved;
+
+      /// Original function bytes from which the hook plan was generated. The hook plan is only
+      /// valid for an original function that still begins with exactly these bytes.
+      uint8_t examinedBytes[Trampoline::kMaxOriginalFunctionBytesExamined];
+
+      /// Descriptions of the instructions to be transplanted.
+      Trampoline::SHookPlanInstruction
+          planInstructions[X86Instruction::kJumpInstructionLengthBytes];
+    };
+
+    static_assert(
+        0 == (sizeof(SHookPlanCacheFileHeader) % alignof(SHookPlanCacheEntry)),
+        "Hook plan cache file header size must preserve entry alignment.");
+
+    /// Enforces concurrency control over the hook plans held by this process.
+    static std::shared_mutex hookPlanCacheMutex;
+
+    /// Hook plans read from the hook plan cache file, in sorted order, or `nullptr` if either
+    /// there are none or they have been moved into #hookPlanCacheEntries.
+    static const SHookPlanCacheEntry* mappedHookPlanCacheEntries = nullptr;
+
+    /// Number of elements in #mappedHookPlanCacheEntries.
+    static size_t numMappedHookPlanCacheEntries = 0;
+
+    /// Beginning of the memory-mapped view of the hook plan cache file, if it is mapped.
+    static const void* mappedHookPlanCacheView = nullptr;
+
+    /// Hook plans held in memory by this process, in sorted order. These include all of the hook
+    /// plans recorded by this process, and after the hook plan cache file is written, also all of
+    /// the hook plans previously read from it.
+    static std::vector<SHookPlanCacheEntry> hookPlanCacheEntries;
+
+    /// Whether or not any hook plan was recorded since the hook plan cache file was last written.
+    static bool hookPlanCacheModified = false;
+
+    /// Number of times a hook plan was sought for an original function.
+    static std::atomic<uint64_t> numHookPlanLookups = 0;
+
+    /// Number of times a hook plan was found and used instead of decoding an original function.
+    static std::atomic<uint64_t> numHookPlanHits = 0;
+
+    /// Number of hook plans recorded by this process.
+    static std::atomic<uint64_t> numHookPlansRecorded = 0;
+
+    /// Number of slots in the shared hook plan segment. Each slot holds at most one hook plan, and
+    /// once the segment is full, newly-generated hook plans are simply not shared.
+    static constexpr size_t kNumSharedHookPlanSlots = 8192;
+
+    /// Maximum number of slots examined when inserting or looking up a hook plan in the shared hook
+    /// plan segment, starting with the slot identified by the hash of its key.
+    static constexpr size_t kMaxSharedHookPlanProbes = 32;
+
+    /// Possible states of a slot in the shared hook plan segment. Slots only ever move forward
+    /// through these states, so a hook plan, once published, never changes.
+    enum class ESharedHookPlanSlotState : uint32_t
+    {
+      /// Slot does not hold a hook plan. Every slot starts in this state because shared memory
+      /// sections are zero-filled when created.
+      Empty = 0,
+
+      /// Slot has been claimed by a process that is in the middle of writing a hook plan into it.
+      Writing = 1,
+
+      /// Slot holds a complete hook plan.
+      Ready = 2,
+    };
+
+    /// Single slot in the shared hook plan segment, which is an open-addressed hash table of hook
+    /// plans that any number of processes insert into and look up concurrently without locks.
+    struct SSharedHookPlanSlot
+    {
+      /// Current state of the slot. Hook plans are only read once this is observed to be ready.
+      std::atomic<ESharedHookPlanSlotState> state;
+
+      /// Unused, for alignment only.
+      uint32_t reserved;
+
+      /// Hook plan held in the slot. Valid only once the slot is ready.
+      SHookPlanCacheEntry entry;
+    };
+
+    static_assert(
+        std::atomic<ESharedHookPlanSlotState>::is_always_lock_free,
+        "Shared hook plan slot states must be lock-free so they can be shared between processes.");
+
+    /// Total size, in bytes, of the shared hook plan segment.
+    static constexpr size_t kSharedHookPlanSegmentSizeBytes =
+        sizeof(SSharedHookPlanSlot) * kNumSharedHookPlanSlots;
+
+    /// Determines the name of the hook plan cache file. It is placed in the temporary directory,
+    /// where it can be shared by every process, and its name identifies the processor architecture
+    /// because hook plans are only meaningful for the architecture that generated them.
+    /// @return Hook plan cache file name.
+    static std::wstring_view GetHookPlanCacheFilename(void)
+    {
+      static const std::wstring hookPlanCacheFilename = []() -> std::wstring
+      {
+        Infra::TemporaryString temporaryDirectory;
+        temporaryDirectory.UnsafeSetSize(
+            GetTempPath(temporaryDirectory.Capacity(), temporaryDirectory.Data()));
+        if (true == temporaryDirectory.Empty()) return std::wstring();
+
+        Infra::TemporaryString filename;
+        filename << temporaryDirectory.AsStringView() << Infra::ProcessInfo::GetProductName()
+                 << Infra::Strings::Format(L".%u", (unsigned int)(8 * sizeof(void*))).AsStringView()
+                 << kStrHookPlanCacheFileExtension;
+        return std::wstring(filename.AsStringView());
+      }();
+
+      return hookPlanCacheFilename;
+    }
+
+    /// Identifies the original function at the specified address for the purpose of finding its
+    /// hook plan. Only original functions that are part of a loaded module can be identified. The
+    /// module is located and named using only its in-memory image, without involving the loader,
+    /// because this can happen while locks are held.
+    /// @param [in] originalFunc Original function address.
+    /// @param [out] key Filled with the key that identifies the original function, if the
+    /// operation succeeds.
+    /// @return `true` if the original function was identified, `false` otherwise.
+    static bool GetHookPlanKey(const void* originalFunc, SHookPlanKey* key)
+    {
+      MEMORY_BASIC_INFORMATION virtualMemoryInfo;
+      if ((sizeof(virtualMemoryInfo) !=
+           Protected::Windows_VirtualQuery(
+               originalFunc, &virtualMemoryInfo, sizeof(virtualMemoryInfo))) ||
+          (MEM_IMAGE != virtualMemoryInfo.Type))
+        return false;
+
+      const size_t moduleBaseAddress = reinterpret_cast<size_t>(virtualMemoryInfo.AllocationBase);
+      const IMAGE_DOS_HEADER* const dosHeader =
+          reinterpret_cast<const IMAGE_DOS_HEADER*>(moduleBaseAddress);
+      if (IMAGE_DOS_SIGNATURE != dosHeader->e_magic) return false;
+
+      const IMAGE_NT_HEADERS* const ntHeader = reinterpret_cast<const IMAGE_NT_HEADERS*>(
+          moduleBaseAddress + static_cast<size_t>(dosHeader->e_lfanew));
+      if (IMAGE_NT_SIGNATURE != ntHeader->Signature) return false;
+
+      // The module name is the one recorded in its export directory, which does not depend on where
+      // the module was loaded from. Modules without exports, which are usually executables, are
+      // identified by their timestamps alone.
+      uint64_t moduleNameHash = 14695981039346656037ull;
+      const IMAGE_DATA_DIRECTORY& exportDataDirectory =
+          ntHeader->OptionalHeader.DataDirectory[IMAGE_DIRECTORY_ENTRY_EXPORT];
+      if ((0 != exportDataDirectory.VirtualAddress) &&
+          (exportDataDirectory.Size >= sizeof(IMAGE_EXPORT_DIRECTORY)))
+      {
+        const IMAGE_EXPORT_DIRECTORY* const exportDirectory =
+            reinterpret_cast<const IMAGE_EXPORT_DIRECTORY*>(
+                moduleBaseAddress + static_cast<size_t>(exportDataDirectory.VirtualAddress));
+        if (0 != exportDirectory->Name)
+        {
+          const char* const moduleName = reinterpret_cast<const char*>(
+              moduleBaseAddress + static_cast<size_t>(exportDirectory->Name));
+          for (size_t i = 0; (i < MAX_PATH) && ('\0' != moduleName[i]); ++i)
+          {
+            moduleNameHash ^=
+                static_cast<uint64_t>(std::tolower(static_cast<unsigned char>(moduleName[i])));
+            moduleNameHash *= 1099511628211ull;
+          }
+        }
+      }
+
+      *key = {
+          .moduleNameHash = moduleNameHash,
+          .moduleTimeDateStamp = static_cast<uint32_t>(ntHeader->FileHeader.TimeDateStamp),
+          .rva = static_cast<uint32_t>(reinterpret_cast<size_t>(originalFunc) - moduleBaseAddress)};
+      return true;
+    }
+
+    /// Determines whether or not the contents of the specified hook plan are internally consistent.
+    /// Hook plans come from a file that could have been damaged, so this check is what makes it
+    /// safe to use them.
+    /// @param [in] entry Hook plan to check.
+    /// @return `true` if the hook plan is consistent, `false` otherwise.
+    static bool IsHookPlanConsistent(const SHookPlanCacheEntry& entry)
+    {
+      if ((entry.numInstructions < 1) ||
+          (entry.numInstructions > _countof(entry.planInstructions)) ||
+          (entry.numExaminedBytes > _countof(entry.examinedBytes)) ||
+          (entry.numDecodedBytes > entry.numExaminedBytes) ||
+          (entry.numExaminedBytes <
+           std::max<int>(entry.numDecodedBytes, X86Instruction::kJumpInstructionLengthBytes)))
+        return false;
+
+      int numInstructionBytes = 0;
+      for (int i = 0; i < entry.numInstructions; ++i)
+      {
+        const Trampoline::SHookPlanInstruction& planInstruction = entry.planInstructions[i];
+        if ((0 == planInstruction.lengthBytes) ||
+            (planInstruction.lengthBytes > X86Instruction::kMaxInstructionLengthBytes))
+          return false;
+
+        switch (planInstruction.displacementWidthBytes)
+        {
+          case 0:
+            break;
+
+          case sizeof(int8_t):
+          case sizeof(int16_t):
+          case sizeof(int32_t):
+            if ((planInstruction.displacementOffsetBytes +
+                 planInstruction.displacementWidthBytes) > planInstruction.lengthBytes)
+              return false;
+            break;
+
+          default:
+            return false;
+        }
+
+        // Only the last instruction can be terminal, since decoding stops there.
+        if ((true == planInstruction.isTerminal) && (i != (entry.numInstructions - 1)))
+          return false;
+
+        numInstructionBytes += planInstruction.lengthBytes;
+      }
+
+      return (numInstructionBytes == entry.numDecodedBytes);
+    }
+
+    /// Maps the hook plan cache file into memory, if it exists and is valid. Invoked once, the
+    /// first time a hook plan is needed.
+    static void MapHookPlanCacheFile(void)
+    {
+      const std::wstring_view hookPlanCacheFilename = GetHookPlanCacheFilename();
+      if (true == hookPlanCacheFilename.empty()) return;
+
+      const HANDLE hookPlanCacheFile = CreateFile(
+          hookPlanCacheFilename.data(),
+          GENERIC_READ,
+          FILE_SHARE_READ | FILE_SHARE_DELETE,
+          nullptr,
+          OPEN_EXISTING,
+          FILE_ATTRIBUTE_NORMAL,
+          nullptr);
+      if (INVALID_HANDLE_VALUE == hookPlanCacheFile) return;
+
+      LARGE_INTEGER hookPlanCacheSize{};
+      const HANDLE hookPlanCacheMapping =
+          (((FALSE != GetFileSizeEx(hookPlanCacheFile, &hookPlanCacheSize)) &&
+            (static_cast<uint64_t>(hookPlanCacheSize.QuadPart) >=
+             sizeof(SHookPlanCacheFileHeader)))
+               ? CreateFileMapping(hookPlanCacheFile, nullptr, PAGE_READONLY, 0, 0, nullptr)
+               : nullptr);
+      CloseHandle(hookPlanCacheFile);
+      if (nullptr == hookPlanCacheMapping) return;
+
+      const void* const hookPlanCacheView =
+          MapViewOfFile(hookPlanCacheMapping, FILE_MAP_READ, 0, 0, 0);
+      CloseHandle(hookPlanCacheMapping);
+      if (nullptr == hookPlanCacheView) return;
+
+      const SHookPlanCacheFileHeader* const fileHeader =
+          reinterpret_cast<const SHookPlanCacheFileHeader*>(hookPlanCacheView);
+      const uint64_t numAvailableEntryBytes =
+          static_cast<uint64_t>(hookPlanCacheSize.QuadPart) - sizeof(SHookPlanCacheFileHeader);
+
+      if ((kHookPlanCacheSignature != fileHeader->signature) ||
+          (kHookPlanCacheVersion != fileHeader->version) ||
+          (sizeof(SHookPlanCacheEntry) != fileHeader->entrySizeBytes) ||
+          ((static_cast<uint64_t>(fileHeader->numEntries) * sizeof(SHookPlanCacheEntry)) >
+           numAvailableEntryBytes))
+      {
+        UnmapViewOfFile(hookPlanCacheView);
+        return;
+      }
+
+      mappedHookPlanCacheView = hookPlanCacheView;
+      mappedHookPlanCacheEntries = reinterpret_cast<const SHookPlanCacheEntry*>(
+          reinterpret_cast<const uint8_t*>(hookPlanCacheView) + sizeof(SHookPlanCacheFileHeader));
+      numMappedHookPlanCacheEntries = static_cast<size_t>(fileHeader->numEntries);
+    }
+
+    /// Ensures that an attempt was made to map the hook plan cache file into memory. Only the first
+    /// invocation has any effect.
+    static void EnsureHookPlanCacheFileMapped(void)
+    {
+      static std::once_flag mapFlag;
+      std::call_once(mapFlag, MapHookPlanCacheFile);
+    }
+
+    /// Searches for the hook plan with the specified key within a sorted range of hook plans.
+    /// @param [in] begin Beginning of the range.
+    /// @param [in] end End of the range.
+    /// @param [in] key Key to find.
+    /// @return Pointer to the matching hook plan, or `nullptr` if there is none.
+    static const SHookPlanCacheEntry* FindHookPlan(
+        const SHookPlanCacheEntry* begin, const SHookPlanCacheEntry* end, const SHookPlanKey& key)
+    {
+      const SHookPlanCacheEntry* const position = std::lower_bound(
+          begin,
+          end,
+          key,
+          [](const SHookPlanCacheEntry& entry, const SHookPlanKey& value) -> bool
+          {
+            return (entry.key < value);
+          });
+      if ((end == position) || (false == (position->key == key))) return nullptr;
+
+      return position;
+    }
+
+    /// Retrieves the slots of the shared hook plan segment, creating the segment if no other
+    /// process has done so yet. Only attempted once, no matter how many times it is invoked. The
+    /// segment's name identifies the processor architecture and the layout of its contents, so any
+    /// segment with the same name can be used as-is. The segment is deliberately held open and
+    /// mapped for the lifetime of the process, so that processes started later can find it.
+    /// @return Slots of the shared hook plan segment, or `nullptr` if it could not be mapped.
+    static SSharedHookPlanSlot* GetSharedHookPlanSlots(void)
+    {
+      static SSharedHookPlanSlot* const sharedHookPlanSlots = []() -> SSharedHookPlanSlot*
+      {
+        Infra::TemporaryString segmentName;
+        segmentName << L"Local\\" << Infra::ProcessInfo::GetProductName()
+                    << Infra::Strings::Format(
+                           L".HookPlans.%u.%u.%u",
+                           (unsigned int)(8 * sizeof(void*)),
+                           (unsigned int)kHookPlanCacheVersion,
+                           (unsigned int)sizeof(SSharedHookPlanSlot))
+                           .AsStringView();
+
+        const HANDLE segment = CreateFileMapping(
+            INVALID_HANDLE_VALUE,
+            nullptr,
+            PAGE_READWRITE,
+            0,
+            static_cast<DWORD>(kSharedHookPlanSegmentSizeBytes),
+            segmentName.AsCString());
+        if (nullptr == segment) return nullptr;
+
+        SSharedHookPlanSlot* const slots =
+            reinterpret_cast<SSharedHookPlanSlot*>(MapViewOfFile(segment, FILE_MAP_WRITE, 0, 0, 0));
+        if (nullptr == slots) CloseHandle(segment);
+
+        return slots;
+      }();
+
+      return sharedHookPlanSlots;
+    }
+
+    /// Determines the first slot in the shared hook plan segment that could hold the hook plan
+    /// with the specified key.
+    /// @param [in] key Key of interest.
+    /// @return Index of the first slot to examine.
+    static size_t SharedHookPlanSlotIndex(const SHookPlanKey& key)
+    {
+      uint64_t hash = key.moduleNameHash;
+      hash ^= (static_cast<uint64_t>(key.moduleTimeDateStamp) << 32);
+      hash ^= static_cast<uint64_t>(key.rva);
+      hash *= 0x9e3779b97f4a7c15ull;
+      return static_cast<size_t>(hash >> 32) % kNumSharedHookPlanSlots;
+    }
+
+    /// Searches the shared hook plan segment for the hook plan with the specified key.
+    /// @param [in] key Key to find.
+    /// @param [out] entry Filled with a copy of the matching hook plan, if there is one.
+    /// @return `true` if a matching hook plan was found, `false` otherwise.
+    static bool FindSharedHookPlan(const SHookPlanKey& key, SHookPlanCacheEntry* entry)
+    {
+      const SSharedHookPlanSlot* const slots = GetSharedHookPlanSlots();
+      if (nullptr == slots) return false;
+
+      const size_t firstSlotIndex = SharedHookPlanSlotIndex(key);
+      for (size_t i = 0; i < kMaxSharedHookPlanProbes; ++i)
+      {
+        const SSharedHookPlanSlot& slot = slots[(firstSlotIndex + i) % kNumSharedHookPlanSlots];
+
+        // Slots are claimed in probe order, so an empty slot ends the search. A slot still being
+        // written could hold the same key, but it is skipped rather than waited for.
+        const ESharedHookPlanSlotState state = slot.state.load(std::memory_order_acquire);
+        if (ESharedHookPlanSlotState::Empty == state) return false;
+        if ((ESharedHookPlanSlotState::Ready != state) || (false == (slot.entry.key == key)))
+          continue;
+
+        *entry = slot.entry;
+        return true;
+      }
+
+      return false;
+    }
+
+    /// Publishes a hook plan in the shared hook plan segment, unless a hook plan with the same key
+    /// is already there. Hook plans from other processes are never trusted without checking their
+    /// consistency and the original function bytes, so a slot that another process claims and
+    /// never finishes writing only costs that slot.
+    /// @param [in] entry Hook plan to publish.
+    static void PublishSharedHookPlan(const SHookPlanCacheEntry& entry)
+    {
+      SSharedHookPlanSlot* const slots = GetSharedHookPlanSlots();
+      if (nullptr == slots) return;
+
+      const size_t firstSlotIndex = SharedHookPlanSlotIndex(entry.key);
+      for (size_t i = 0; i < kMaxSharedHookPlanProbes; ++i)
+      {
+        SSharedHookPlanSlot& slot = slots[(firstSlotIndex + i) % kNumSharedHookPlanSlots];
+
+        ESharedHookPlanSlotState state = slot.state.load(std::memory_order_acquire);
+        if ((ESharedHookPlanSlotState::Empty == state) &&
+            (true ==
+             slot.state.compare_exchange_strong(
+                 state, ESharedHookPlanSlotState::Writing, std::memory_order_acquire)))
+        {
+          slot.entry = entry;
+          slot.state.store(ESharedHookPlanSlotState::Ready, std::memory_order_release);
+          return;
+        }
+
+        // Losing the race to claim the slot leaves the winner's state in the local copy.
+        if ((ESharedHookPlanSlotState::Ready == state) && (slot.entry.key == entry.key)) return;
+      }
+    }
+
+    bool IsEnabled(void)
+    {
+      static const bool hookPlanCacheEnabled =
+          Globals::GetConfigurationData()[Infra::Configuration::kSectionNameGlobal]
+                                         [Strings::kStrConfigurationSettingNameCacheHookPlans]
+                                             .ValueOr(false);
+
+      return hookPlanCacheEnabled;
+    }
+
+    void GetStatistics(SHookPlanCacheStatistics* statistics)
+    {
+      statistics->numLookups = numHookPlanLookups.load(std::memory_order_relaxed);
+      statistics->numHits = numHookPlanHits.load(std::memory_order_relaxed);
+      statistics->numRecorded = numHookPlansRecorded.load(std::memory_order_relaxed);
+    }
+
+    bool LookupHookPlan(const void* originalFunc, Trampoline::SDecodedOriginalFunction* decoded)
+    {
+      if (false == IsEnabled()) return false;
+
+      numHookPlanLookups.fetch_add(1, std::memory_order_relaxed);
+
+      SHookPlanKey key;
+      if (false == GetHookPlanKey(originalFunc, &key)) return false;
+
+      EnsureHookPlanCacheFileMapped();
+
+      SHookPlanCacheEntry entry;
+
+      do
+      {
+        std::shared_lock<std::shared_mutex> lock(hookPlanCacheMutex);
+
+        const SHookPlanCacheEntry* matchingEntry = FindHookPlan(
+            hookPlanCacheEntries.data(),
+            hookPlanCacheEntries.data() + hookPlanCacheEntries.size(),
+            key);
+        if (nullptr == matchingEntry)
+          matchingEntry = FindHookPlan(
+              mappedHookPlanCacheEntries,
+              mappedHookPlanCacheEntries + numMappedHookPlanCacheEntries,
+              key);
+
+        if (nullptr != matchingEntry)
+          entry = *matchingEntry;
+        else if (false == FindSharedHookPlan(key, &entry))
+          return false;
+      }
+      while (false);
+
+      if (false == IsHookPlanConsistent(entry)) return false;
+
+      // The module might have been patched in memory since the hook plan was generated, or the
+      // original function might already be hooked.
+      if (0 != std::memcmp(entry.examinedBytes, originalFunc, entry.numExaminedBytes)) return false;
+
+      decoded->originalFunc = originalFunc;
+      decoded->isHotPatchable = false;
+      decoded->isSyscallStub = false;
+      decoded->numInstructions = static_cast<int>(entry.numInstructions);
+      decoded->numDecodedBytes = static_cast<int>(entry.numDecodedBytes);
+      decoded->numExaminedBytes = static_cast<int>(entry.numExaminedBytes);
+      std::memcpy(decoded->examinedBytes, entry.examinedBytes, entry.numExaminedBytes);
+      std::copy(
+          &entry.planInstructions[0],
+          &entry.planInstructions[entry.numInstructions],
+          decoded->planInstructions);
+      decoded->hasHookPlan = true;
+      decoded->isFromHookPlan = true;
+
+      numHookPlanHits.fetch_add(1, std::memory_order_relaxed);
+      return true;
+    }
+
+    void RecordHookPlan(const Trampoline::SDecodedOriginalFunction& decoded)
+    {
+      if (false == IsEnabled()) return;
+      if ((false == decoded.hasHookPlan) || (true == decoded.isHotPatchable)) return;
+
+      SHookPlanCacheEntry entry{};
+      if (false == GetHookPlanKey(decoded.originalFunc, &entry.key)) return;
+
+      entry.numInstructions = static_cast<uint8_t>(decoded.numInstructions);
+      entry.numDecodedBytes = static_cast<uint8_t>(decoded.numDecodedBytes);
+      entry.numExaminedBytes = static_cast<uint8_t>(decoded.numExaminedBytes);
+      std::memcpy(entry.examinedBytes, decoded.examinedBytes, decoded.numExaminedBytes);
+      std::copy(
+          &decoded.planInstructions[0],
+          &decoded.planInstructions[decoded.numInstructions],
+          entry.planInstructions);
+
+      if (false == IsHookPlanConsistent(entry)) return;
+
+      PublishSharedHookPlan(entry);
+
+      std::unique_lock<std::shared_mutex> lock(hookPlanCacheMutex);
+
+      auto insertPosition = std::lower_bound(
+          hookPlanCacheEntries.begin(),
+          hookPlanCacheEntries.end(),
+          entry.key,
+          [](const SHookPlanCacheEntry& existingEntry, const SHookPlanKey& value) -> bool
+          {
+            return (existingEntry.key < value);
+          });
+      if ((hookPlanCacheEntries.end() != insertPosition) && (insertPosition->key == entry.key))
+        *insertPosition = entry;
+      else
+        hookPlanCacheEntries.insert(insertPosition, entry);
+
+      hookPlanCacheModified = true;
+      numHookPlansRecorded.fetch_add(1, std::memory_order_relaxed);
+    }
+
+    void WriteHookPlanCache(void)
+    {
+      if (false == IsEnabled()) return;
+
+      EnsureHookPlanCacheFileMapped();
+
+      std::vector<SHookPlanCacheEntry> entriesToWrite;
+
+      do
+      {
+        std::unique_lock<std::shared_mutex> lock(hookPlanCacheMutex);
+
+        // The hook plan cache file cannot be replaced while it is mapped, so any hook plans read
+        // from it are moved into memory and the mapping is released. Hook plans recorded by this
+        // process take precedence over those read from the file.
+        if (nullptr != mappedHookPlanCacheView)
+        {
+          std::vector<SHookPlanCacheEntry> mergedEntries;
+          mergedEntries.reserve(hookPlanCacheEntries.size() + numMappedHookPlanCacheEntries);
+          std::set_union(
+              hookPlanCacheEntries.cbegin(),
+              hookPlanCacheEntries.cend(),
+              mappedHookPlanCacheEntries,
+              mappedHookPlanCacheEntries + numMappedHookPlanCacheEntries,
+              std::back_inserter(mergedEntries),
+              [](const SHookPlanCacheEntry& a, const SHookPlanCacheEntry& b) -> bool
+              {
+                return (a.key < b.key);
+              });
+
+          if (mergedEntries.size() <= kMaxHookPlanCacheEntries)
+            hookPlanCacheEntries = std::move(mergedEntries);
+
+          UnmapViewOfFile(mappedHookPlanCacheView);
+          mappedHookPlanCacheView = nullptr;
+          mappedHookPlanCacheEntries = nullptr;
+          numMappedHookPlanCacheEntries = 0;
+        }
+
+        if (false == hookPlanCacheModified) return;
+        hookPlanCacheModified = false;
+
+        if (hookPlanCacheEntries.size() > kMaxHookPlanCacheEntries) return;
+        entriesToWrite = hookPlanCacheEntries;
+      }
+      while (false);
+
+      const std::wstring_view hookPlanCacheFilename = GetHookPlanCacheFilename();
+      if (true == hookPlanCacheFilename.empty()) return;
+
+      const SHookPlanCacheFileHeader fileHeader = {
+          .signature = kHookPlanCacheSignature,
+          .version = kHookPlanCacheVersion,
+          .entrySizeBytes = static_cast<uint32_t>(sizeof(SHookPlanCacheEntry)),
+          .numEntries = static_cast<uint32_t>(entriesToWrite.size())};
+
+      // Multiple processes might try to write the cache at the same time, so each one writes to
+      // its own temporary file and then atomically replaces whatever cache file is present.
+      Infra::TemporaryString temporaryHookPlanCacheFilename;
+      temporaryHookPlanCacheFilename
+          << hookPlanCacheFilename << L"."
+          << Infra::Strings::Format(L"%u", GetCurrentProcessId()).AsStringView();
+
+      const HANDLE hookPlanCacheFile = CreateFile(
+          temporaryHookPlanCacheFilename.AsCString(),
+          GENERIC_WRITE,
+          0,
+          nullptr,
+          CREATE_ALWAYS,
+          FILE_ATTRIBUTE_TEMPORARY,
+          nullptr);
+      if (INVALID_HANDLE_VALUE == hookPlanCacheFile) return;
+
+      const DWORD numEntryBytes =
+          static_cast<DWORD>(entriesToWrite.size() * sizeof(SHookPlanCacheEntry));
+      DWORD numHeaderBytesWritten = 0;
+      DWORD numEntryBytesWritten = 0;
+      const bool writeSucceeded =
+          ((FALSE !=
+            WriteFile(
+                hookPlanCacheFile,
+                &fileHeader,
+                static_cast<DWORD>(sizeof(fileHeader)),
+                &numHeaderBytesWritten,
+                nullptr)) &&
+           (static_cast<DWORD>(sizeof(fileHeader)) == numHeaderBytesWritten) &&
+           (FALSE !=
+            WriteFile(
+                hookPlanCacheFile,
+                entriesToWrite.data(),
+                numEntryBytes,
+                &numEntryBytesWritten,
+                nullptr)) &&
+           (numEntryBytes == numEntryBytesWritten));
+      CloseHandle(hookPlanCacheFile);
+
+      if ((false == writeSucceeded) ||
+          (FALSE ==
+           MoveFileEx(
+               temporaryHookPlanCacheFilename.AsCString(),
+               hookPlanCacheFilename.data(),
+               MOVEFILE_REPLACE_EXISTING)))
+        DeleteFile(temporaryHookPlanCacheFilename.AsCString());
+    }
+  } // namespace HookPlanCache
+} // namespace Hookshot
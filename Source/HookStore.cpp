@@ -11,26 +11,373 @@
 
 #include "HookStore.h"
 
+#include <algorithm>
+#include <array>
+#include <chrono>
+#include <cstdint>
+#include <cstring>
+#include <intrin.h>
+#include <list>
+#include <map>
+#include <memory>
+#include <mutex>
 #include <shared_mutex>
+#include <string_view>
+#include <unordered_map>
+#include <unordered_set>
+#include <utility>
+#include <vector>
 
 #include <Infra/Core/Message.h>
 #include <Infra/Core/ProcessInfo.h>
+#include <Infra/Core/SystemInfo.h>
 #include <Infra/Core/TemporaryBuffer.h>
 
+#include "AddressTableHooks.h"
+#include "AsyncHookInstall.h"
+#include "CallbackHooks.h"
+#include "CallTracing.h"
+#include "CodeCaves.h"
+#include "CodeRelocation.h"
+#include "DebugRegisterHooks.h"
+#include "DeferredHooks.h"
 #include "DependencyProtect.h"
+#include "ExitSummary.h"
+#include "ExportResolver.h"
 #include "Globals.h"
+#include "HookPlanCache.h"
+#include "HotSwap.h"
+#include "InjectionWindow.h"
+#include "LatencyBudget.h"
+#include "MappedLog.h"
+#include "ModuleIndex.h"
+#include "OneShotHooks.h"
+#include "PatternScanner.h"
+#include "Probes.h"
+#include "SampledTiming.h"
+#include "SharedStatistics.h"
+#include "Strings.h"
+#include "SymbolIndex.h"
+#include "TaskScheduler.h"
+#include "Tracing.h"
 #include "X86Instruction.h"
 
 namespace Hookshot
 {
   std::shared_mutex HookStore::hookStoreMutex;
-  std::unordered_map<const void*, Trampoline*> HookStore::functionToTrampoline;
-  std::unordered_map<Trampoline*, const void*> HookStore::trampolineToOriginalFunction;
+  FlatPointerMap<const void*, Trampoline*> HookStore::functionToTrampoline;
+  HookLookupTable HookStore::functionToTrampolineLookup;
+  std::unordered_map<const Trampoline*, Trampoline*> HookStore::trampolineToInstrumentationStub;
+  std::unordered_map<const void*, HookStore::SExportCounterStub> HookStore::exportCounterStubs;
+  std::unordered_map<const Trampoline*, HookStore::SSampledTiming>
+      HookStore::trampolineToSampledTiming;
+  std::unordered_map<const Trampoline*, HookStore::SLatencyBudget>
+      HookStore::trampolineToLatencyBudget;
+  std::unordered_map<const Trampoline*, HookStore::SReentrancyGuard>
+      HookStore::trampolineToReentrancyGuard;
+  std::unordered_map<const Trampoline*, HookStore::SCallerFilter>
+      HookStore::trampolineToCallerFilter;
+  std::unordered_map<const Trampoline*, HookStore::SThreadOverride>
+      HookStore::trampolineToThreadOverride;
+  size_t HookStore::numThreadOverrides = 0;
+  std::unordered_map<const void*, Trampoline*> HookStore::callTraceStubs;
+  std::list<CallbackHooks::SDescriptor> HookStore::callbackHookDescriptors;
+  std::unordered_map<const void*, HookStore::SOneShotHook> HookStore::oneShotHooks;
+  std::list<long> HookStore::oneShotFiredFlags;
+  std::unordered_map<const void*, HookStore::SSampledHook> HookStore::sampledHooks;
+  std::unordered_map<const void*, std::vector<HookStore::SChainedHook>> HookStore::hookChains;
+  std::unordered_set<const void*> HookStore::directlyRedirectedFunctions;
+  FlatPointerMap<const void*, std::array<uint8_t, HookStore::kOriginalFunctionPrologueSizeBytes>>
+      HookStore::originalFunctionPrologues;
+#ifdef _WIN64
+  FlatPointerMap<const void*, std::array<uint8_t, HookStore::kAbsoluteJumpPrologueSizeBytes>>
+      HookStore::absoluteJumpPrologues;
+#endif
+  std::unordered_set<const void*> HookStore::unhookedFunctions;
+  std::unordered_map<const Trampoline*, HookStore::SHookGroupMember>
+      HookStore::trampolineToHookGroup;
+  std::unordered_set<const void*> HookStore::hotPatchedFunctions;
+  std::unordered_set<const void*> HookStore::reservedFunctions;
+  std::unordered_map<const void*, const void*> HookStore::jumpThunkTargets;
+  std::unordered_map<const Trampoline*, Trampoline::UHookCode*> HookStore::trampolineToHookStub;
+#ifdef _WIN64
+  std::unordered_map<const Trampoline*, void*> HookStore::trampolineToCodeCaveStub;
+#endif
+  std::vector<HookStore::SRetiredTrampoline> HookStore::retiredTrampolines;
+  uint64_t HookStore::reclamationEpoch = 0;
   std::vector<TrampolineStore> HookStore::trampolines;
+  FlatPointerMap<const void*, size_t> HookStore::trampolineStoreIndices;
+  uint32_t HookStore::lastHookGeneration = 0;
+  DWORD HookStore::transactionThreadId = 0;
+  std::vector<HookStore::SPendingRedirect> HookStore::transactionRedirects;
+  HookIntegrity::SPatchSites HookStore::patchSites;
+  std::vector<HookStore::SPendingRedirect> HookStore::patchSiteRedirects;
+  std::vector<HMODULE> HookStore::patchSiteModules;
+#ifdef _WIN64
+  FlatPointerMap<void*, HookStore::SNearModuleStores> HookStore::trampolineStoreMap;
+  std::vector<int> HookStore::farStoreIndices;
+  HookStore::SFreeSpaceCursor HookStore::farStoreFreeSpaceCursor;
+#else
+  HookStore::SFreeSpaceCursor HookStore::trampolineStoreFreeSpaceCursor;
+#endif
+
+  /// Offset within the thread environment block of the array of thread-local storage slots that are
+  /// held directly in it. Each slot holds one pointer-sized value, and the array has
+  /// `TLS_MINIMUM_AVAILABLE` elements.
+#ifdef _WIN64
+  static constexpr size_t kThreadEnvironmentBlockTlsSlotsOffset = 0x1480;
+#else
+  static constexpr size_t kThreadEnvironmentBlockTlsSlotsOffset = 0xe10;
+#endif
+
+  /// Set whenever the bytes of any original function are modified, which only ever happens with
+  /// the hook store lock held exclusively. Indicates that the patch sites monitored for integrity
+  /// need to be identified again before they can next be checked.
+  static bool patchSitesModified = true;
+
+  /// Total number of bytes allocated for the invocation counter shards of instrumentation stubs,
+  /// which only ever happens with the hook store lock held exclusively. Shards are never freed
+  /// because a thread could still be executing the stub that increments them.
+  static size_t instrumentationCounterShardBytes = 0;
+
+  /// Determines whether or not newly-created hooks should be instrumented to count the number of
+  /// times they are invoked. Can change if the configuration file is reloaded.
+  /// @return `true` if so, `false` otherwise.
+  static bool IsHookInstrumentationEnabled(void)
+  {
+    return Globals::GetRuntimeSettings().instrumentHooks;
+  }
+
+  /// Determines how often newly-created hooks should time the calls that pass through them. Can
+  /// change if the configuration file is reloaded.
+  /// @return Number of calls per timed call, or 0 if hook timing should not be sampled.
+  static uint32_t GetHookTimingSampleInterval(void)
+  {
+    return Globals::GetRuntimeSettings().hookTimingSampleInterval;
+  }
+
+  /// Determines the sample interval that should be used for every sampled hook in place of the
+  /// one requested when it was created. Can change if the configuration file is reloaded.
+  /// @return Number of calls per hook function invocation, or 0 if requested intervals are used.
+  static uint32_t GetSampledHookIntervalOverride(void)
+  {
+    return Globals::GetRuntimeSettings().sampledHookInterval;
+  }
+
+  /// Determines the latency budget that newly-created hooks whose timing is sampled should be
+  /// given. Can change if the configuration file is reloaded.
+  /// @return Latency budget in microseconds, or 0 if hooks should not be given latency budgets.
+  static uint32_t GetHookLatencyBudgetMicroseconds(void)
+  {
+    return Globals::GetRuntimeSettings().hookLatencyBudgetMicroseconds;
+  }
+
+  /// Reads the timing histogram buckets of a sample block. Buckets are written without
+  /// synchronization by whichever thread is timing a call, so each one is read exactly once.
+  /// @param [in] sampleBlock Sample block to read.
+  /// @param [out] buckets Filled with #kHookTimingHistogramNumBuckets bucket values.
+  static void ReadSampleBlockBuckets(
+      const SampledTiming::SSampleBlock* sampleBlock, uint64_t* buckets)
+  {
+    for (size_t i = 0; i < kHookTimingHistogramNumBuckets; ++i)
+      buckets[i] = *reinterpret_cast<volatile const uint64_t*>(&sampleBlock->buckets[i]);
+  }
+
+  /// Determines whether or not newly-created hooks should, where possible, redirect execution from
+  /// their original functions directly to their hook functions instead of to their trampolines.
+  /// @return `true` if so, `false` otherwise.
+  static bool IsDirectHookJumpEnabled(void)
+  {
+    static const bool directHookJumpEnabled = Globals::GetPerformanceProfile().directHookJumps;
+
+    return directHookJumpEnabled;
+  }
+
+  /// Determines whether or not newly-created hooks should transfer control to their hook functions
+  /// using hook stubs kept apart from their trampolines.
+  /// @return `true` if so, `false` otherwise.
+  static bool IsHookStubSegregationEnabled(void)
+  {
+    static const bool hookStubSegregationEnabled =
+        Globals::GetPerformanceProfile().segregateHookStubs;
+
+    return hookStubSegregationEnabled;
+  }
+
+  /// Maximum number of consecutive jump thunks followed when determining which function to hook.
+  /// Chains of thunks are short in practice, and the limit guarantees that a cycle of jumps cannot
+  /// cause an infinite loop.
+  static constexpr int kMaxJumpThunksFollowed = 4;
+
+  /// Determines whether or not hooks requested for jump thunks should instead be placed on the
+  /// functions to which the thunks ultimately jump.
+  /// @return `true` if so, `false` otherwise.
+  static bool IsJumpThunkFollowingEnabled(void)
+  {
+    static const bool jumpThunkFollowingEnabled = Globals::GetPerformanceProfile().followJumpThunks;
+
+    return jumpThunkFollowingEnabled;
+  }
+
+  /// Determines whether or not hooks created in a batch should be placed in import address tables
+  /// whenever redirecting their original functions would make otherwise-untouched pages private.
+  /// @return `true` if so, `false` otherwise.
+  static bool IsImportHookPreferenceEnabled(void)
+  {
+    static const bool importHookPreferenceEnabled =
+        Globals::GetPerformanceProfile().preferImportHooksForIsolatedPages;
+
+    return importHookPreferenceEnabled;
+  }
+
+  /// Combines the results of an operation performed on each element of an array.
+  /// @param [in] results Array of results, one per element.
+  /// @param [in] numResults Number of elements in the array.
+  /// @return Success if every result indicates success, otherwise the first result that does not.
+  static EResult OverallResult(const EResult* results, size_t numResults)
+  {
+    for (size_t i = 0; i < numResults; ++i)
+    {
+      if (false == SuccessfulResult(results[i])) return results[i];
+    }
+
+    return EResult::Success;
+  }
+
+  /// Determines which loaded module contains an address. The module index answers this without
+  /// any system calls, so the system is asked only if the index is unavailable.
+  /// @param [in] address Address of interest.
+  /// @return Handle of the module that contains the address, or `nullptr` if no loaded module
+  /// contains it.
+  static HMODULE ModuleForAddress(const void* address)
+  {
+    HMODULE moduleHandle = nullptr;
+    if (true == ModuleIndex::FindModuleForAddress(address, &moduleHandle)) return moduleHandle;
+
+    if (0 ==
+        Protected::Windows_GetModuleHandleEx(
+            GET_MODULE_HANDLE_EX_FLAG_FROM_ADDRESS | GET_MODULE_HANDLE_EX_FLAG_UNCHANGED_REFCOUNT,
+            (LPCWSTR)address,
+            &moduleHandle))
+      return nullptr;
+
+    return moduleHandle;
+  }
+
+  /// Acquires a reference to each of the specified modules, which prevents them from being unloaded
+  /// until the references are released. Stops at the first module that is no longer loaded.
+  /// @param [in] moduleHandles Handles of the modules to reference, in increasing order.
+  /// @param [out] moduleReferences Appended with each reference acquired, in the same order, all
+  /// of which must be released using FreeLibrary.
+  /// @return `true` if every module is still loaded at the same address, `false` otherwise.
+  static bool AcquireModuleReferences(
+      const std::vector<HMODULE>& moduleHandles, std::vector<HMODULE>& moduleReferences)
+  {
+    for (const HMODULE moduleHandle : moduleHandles)
+    {
+      HMODULE moduleReference = nullptr;
+      if (0 ==
+          Protected::Windows_GetModuleHandleEx(
+              GET_MODULE_HANDLE_EX_FLAG_FROM_ADDRESS, (LPCWSTR)moduleHandle, &moduleReference))
+        return false;
+
+      // Another module might have been loaded where an unloaded one used to be.
+      if (moduleReference != moduleHandle)
+      {
+        Protected::Windows_FreeLibrary(moduleReference);
+        return false;
+      }
+
+      moduleReferences.push_back(moduleReference);
+    }
+
+    return true;
+  }
+
+  /// Visits every value held by a suspended thread that could be the address of code it is either
+  /// executing or will eventually return into. These are its instruction pointer, its integer
+  /// registers, and every pointer-sized value on the live part of its stack, which together hold
+  /// every return address even for code that has no unwind data. Unwind data is deliberately not
+  /// used, because looking up dynamic function tables takes a lock that another suspended thread
+  /// might hold. The result is therefore conservative. Does not allocate memory.
+  /// @tparam AddressVisitor Type of callable object that is passed each value and returns `true`
+  /// to stop visiting any further values.
+  /// @param [in] thread Handle to a suspended thread.
+  /// @param [in] visitor Callable object to be passed each value.
+  /// @return `true` if the state of the thread was retrieved, `false` otherwise, in which case the
+  /// thread might be using any address at all.
+  template <typename AddressVisitor>
+  static bool VisitPossibleCodeAddressesOfThread(const HANDLE thread, AddressVisitor visitor)
+  {
+    CONTEXT threadContext = {};
+    threadContext.ContextFlags = (CONTEXT_CONTROL | CONTEXT_INTEGER);
+    if (0 == Protected::Windows_GetThreadContext(thread, &threadContext)) return false;
+
 #ifdef _WIN64
-  std::unordered_map<void*, std::vector<int>> HookStore::trampolineStoreMap;
+    const size_t stackPointer = static_cast<size_t>(threadContext.Rsp);
+    const DWORD64 registerValues[] = {
+        threadContext.Rip,
+        threadContext.Rax,
+        threadContext.Rbx,
+        threadContext.Rcx,
+        threadContext.Rdx,
+        threadContext.Rsi,
+        threadContext.Rdi,
+        threadContext.Rbp,
+        threadContext.R8,
+        threadContext.R9,
+        threadContext.R10,
+        threadContext.R11,
+        threadContext.R12,
+        threadContext.R13,
+        threadContext.R14,
+        threadContext.R15};
+#else
+    const size_t stackPointer = static_cast<size_t>(threadContext.Esp);
+    const DWORD registerValues[] = {
+        threadContext.Eip,
+        threadContext.Eax,
+        threadContext.Ebx,
+        threadContext.Ecx,
+        threadContext.Edx,
+        threadContext.Esi,
+        threadContext.Edi,
+        threadContext.Ebp};
 #endif
 
+    for (const auto registerValue : registerValues)
+    {
+      if (true == visitor(static_cast<size_t>(registerValue))) return true;
+    }
+
+    // The live part of the stack extends from the stack pointer to the end of the committed
+    // region that contains it, which is the base of the stack.
+    MEMORY_BASIC_INFORMATION stackMemoryInfo = {};
+    if ((sizeof(stackMemoryInfo) !=
+         Protected::Windows_VirtualQuery(
+             reinterpret_cast<LPCVOID>(stackPointer), &stackMemoryInfo, sizeof(stackMemoryInfo))) ||
+        (MEM_COMMIT != stackMemoryInfo.State))
+      return false;
+
+    const size_t* const stackEnd = reinterpret_cast<const size_t*>(
+        reinterpret_cast<size_t>(stackMemoryInfo.BaseAddress) + stackMemoryInfo.RegionSize);
+    for (const size_t* stackSlot =
+             reinterpret_cast<const size_t*>(stackPointer & ~(sizeof(size_t) - 1));
+         stackSlot < stackEnd;
+         ++stackSlot)
+    {
+      if (true == visitor(*stackSlot)) return true;
+    }
+
+    return true;
+  }
+
+  /// Size, in bytes, of the windows into which code that is not part of any loaded module is
+  /// divided when determining where to place its trampolines. Such code is usually generated at
+  /// runtime, and code generators tend to reserve large allocations whose bases can be far away
+  /// from the functions within them.
+  static constexpr size_t kNonModuleCodeWindowSizeBytes = static_cast<size_t>(64) * 1024 * 1024;
+
   /// Determines the base address of the memory region associated with the target function.
   /// @param [in] originalFunc Address of the function that is being hooked.
   /// @return Base address of the associated memory region, or `nullptr` if it cannot be determined.
@@ -38,26 +385,169 @@ namespace Hookshot
   {
     // If the target function is part of a loaded module, the base address of the region is the base
     // address of that module.
-    HMODULE moduleHandle;
-    if (0 !=
-        Protected::Windows_GetModuleHandleEx(
-            GET_MODULE_HANDLE_EX_FLAG_FROM_ADDRESS | GET_MODULE_HANDLE_EX_FLAG_UNCHANGED_REFCOUNT,
-            (LPCWSTR)originalFunc,
-            &moduleHandle))
-      return moduleHandle;
+    const HMODULE moduleHandle = ModuleForAddress(originalFunc);
+    if (nullptr != moduleHandle) return moduleHandle;
 
     // If the target function is not part of a loaded module, the base address of the region needs
-    // to be queried.
+    // to be queried. Trampolines are placed backward from the base address, so for a large
+    // allocation the region is narrowed down to the window that holds the target function, which
+    // keeps its trampolines close to it rather than to the beginning of the allocation.
     MEMORY_BASIC_INFORMATION virtualMemoryInfo;
     if (sizeof(virtualMemoryInfo) ==
         Protected::Windows_VirtualQuery(
             (LPCVOID)originalFunc, &virtualMemoryInfo, sizeof(virtualMemoryInfo)))
-      return virtualMemoryInfo.AllocationBase;
+    {
+      const size_t windowBase =
+          reinterpret_cast<size_t>(originalFunc) & ~(kNonModuleCodeWindowSizeBytes - 1);
+      return reinterpret_cast<void*>(
+          std::max(reinterpret_cast<size_t>(virtualMemoryInfo.AllocationBase), windowBase));
+    }
 
     // At this point the base address cannot be determined.
     return nullptr;
   }
 
+  /// Number of shards into which hook creation is divided. Modules are assigned to shards by base
+  /// address, and hooks into modules assigned to different shards can be created concurrently.
+  static constexpr size_t kNumHookCreationShards = 16;
+
+  /// Enforces serialized creation of hooks into modules assigned to the same shard. Always acquired
+  /// before the hook store lock.
+  static std::mutex hookCreationShardMutexes[kNumHookCreationShards];
+
+  /// Identifies the shard to which the module containing the specified original function belongs.
+  /// @param [in] originalFunc Address of the function that is being hooked.
+  /// @return Mutex that serializes hook creation within the shard.
+  static std::mutex& HookCreationShardMutexForOriginalFunc(const void* originalFunc)
+  {
+    // Module base addresses are aligned to the allocation granularity, so the low-order bits carry
+    // no information.
+    const size_t baseAddress = reinterpret_cast<size_t>(BaseAddressForOriginalFunc(originalFunc));
+    return hookCreationShardMutexes[(baseAddress >> 16) % kNumHookCreationShards];
+  }
+
+  /// Sets the original function of the specified trampoline, transplanting instructions that were
+  /// decoded ahead of time if they are available and the original function has not changed since
+  /// they were decoded. Otherwise the original function is decoded again.
+  /// @param [in] trampoline Trampoline whose original function is to be set.
+  /// @param [in] originalFunc Address of the function that is being hooked.
+  /// @param [in] decoded Original function instructions decoded ahead of time, or `nullptr` if
+  /// they are not available.
+  /// @param [out] sizeBytesUsed Filled with the number of bytes of the trampoline in use.
+  /// @return `true` if successful, `false` otherwise.
+  static bool SetTrampolineOriginalFunction(
+      Trampoline* trampoline,
+      const void* originalFunc,
+      const Trampoline::SDecodedOriginalFunction* decoded,
+      size_t* sizeBytesUsed)
+  {
+    if ((nullptr != decoded) && (true == Trampoline::IsDecodedOriginalFunctionCurrent(*decoded)))
+      return trampoline->SetOriginalFunction(*decoded, sizeBytesUsed);
+
+    return trampoline->SetOriginalFunction(originalFunc, sizeBytesUsed);
+  }
+
+  /// Number of original functions decoded by each task submitted to the task scheduler.
+  static constexpr size_t kDecodeTaskSize = 64;
+
+  /// Minimum number of original functions in a batch for decoding them to be divided among worker
+  /// threads. Smaller batches are decoded faster than tasks can be handed off, so they are decoded
+  /// entirely on the calling thread.
+  static constexpr size_t kParallelDecodeThreshold = 4 * kDecodeTaskSize;
+
+  /// Range of original functions in a batch that are decoded together by a single task.
+  struct SDecodeRange
+  {
+    /// Original function of each hook in the batch, or `nullptr` for those not to be decoded.
+    void* const* originalFuncs;
+
+    /// Decoded instructions of each original function in the batch.
+    Trampoline::SDecodedOriginalFunction* decodedOriginalFunctions;
+
+    /// Whether or not each original function in the batch was decoded successfully. One byte per
+    /// original function, so that tasks can fill adjacent elements concurrently.
+    uint8_t* isDecodedOriginalFunctionValid;
+
+    /// Index of the first original function in the range.
+    size_t begin;
+
+    /// Index one past the last original function in the range.
+    size_t end;
+  };
+
+  /// Decodes a range of original functions in a batch. Each decode keeps its own decoder state, so
+  /// ranges can be decoded concurrently.
+  /// @param [in] decodeRange Range of original functions to decode.
+  static void DecodeRange(const SDecodeRange& decodeRange)
+  {
+    for (size_t i = decodeRange.begin; i < decodeRange.end; ++i)
+    {
+      if (nullptr == decodeRange.originalFuncs[i]) continue;
+      decodeRange.isDecodedOriginalFunctionValid[i] =
+          ((true ==
+            Trampoline::DecodeOriginalFunction(
+                decodeRange.originalFuncs[i], &decodeRange.decodedOriginalFunctions[i]))
+               ? 1
+               : 0);
+    }
+  }
+
+  /// Task that decodes a range of original functions in a batch.
+  /// @param [in] context Decode range object.
+  static void DecodeRangeTask(void* context)
+  {
+    DecodeRange(*reinterpret_cast<const SDecodeRange*>(context));
+  }
+
+  /// Decodes the original functions of a batch of hooks ahead of time, dividing them among the task
+  /// scheduler's worker threads if there are enough of them. Decoding only reads the original
+  /// functions and fills the output arrays, so it requires no lock.
+  /// @param [in] originalFuncs Original function of each hook in the batch, or `nullptr` for those
+  /// not to be decoded.
+  /// @param [out] decodedOriginalFunctions Filled with the decoded instructions of each original
+  /// function. Must have the same number of elements as the original function array.
+  /// @param [out] isDecodedOriginalFunctionValid Filled with whether or not each original function
+  /// was decoded successfully. Must have the same number of elements as the original function
+  /// array and be initialized to 0.
+  static void DecodeOriginalFunctions(
+      const std::vector<void*>& originalFuncs,
+      std::vector<Trampoline::SDecodedOriginalFunction>& decodedOriginalFunctions,
+      std::vector<uint8_t>& isDecodedOriginalFunctionValid)
+  {
+    const SDecodeRange wholeBatch = {
+        .originalFuncs = originalFuncs.data(),
+        .decodedOriginalFunctions = decodedOriginalFunctions.data(),
+        .isDecodedOriginalFunctionValid = isDecodedOriginalFunctionValid.data(),
+        .begin = 0,
+        .end = originalFuncs.size()};
+
+    if (originalFuncs.size() < kParallelDecodeThreshold)
+    {
+      DecodeRange(wholeBatch);
+      return;
+    }
+
+    // The decoder tables are initialized on first use, which is done here so that worker threads
+    // do not all wait for one of them to do it.
+    X86Instruction::Initialize();
+
+    std::vector<SDecodeRange> decodeRanges;
+    decodeRanges.reserve((originalFuncs.size() + kDecodeTaskSize - 1) / kDecodeTaskSize);
+    for (size_t begin = 0; begin < originalFuncs.size(); begin += kDecodeTaskSize)
+    {
+      SDecodeRange decodeRange = wholeBatch;
+      decodeRange.begin = begin;
+      decodeRange.end = std::min(begin + kDecodeTaskSize, originalFuncs.size());
+      decodeRanges.push_back(decodeRange);
+    }
+
+    TaskScheduler::STaskGroup decodeTasks;
+    for (SDecodeRange& decodeRange : decodeRanges)
+      TaskScheduler::Submit(DecodeRangeTask, &decodeRange, &decodeTasks);
+
+    TaskScheduler::Wait(decodeTasks);
+  }
+
   /// Checks the specified hook for validity and safety.
   /// @param [in] originalFunc Address of the function that is being hooked.
   /// @param [in] hookFunc Address of the hook function.
@@ -75,230 +565,6038 @@ namespace Hookshot
           static_cast<size_t>(X86Instruction::kJumpInstructionLengthBytes))))
       return false;
 
-    // Hooking Hookshot itself is forbidden.
+#ifndef HOOKSHOT_STATIC_LIBRARY
+    // Hooking Hookshot itself is forbidden. When built as a static library, Hookshot is part of
+    // the application's own module, which can be hooked.
     if (BaseAddressForOriginalFunc(originalFunc) ==
         Infra::ProcessInfo::GetThisModuleInstanceHandle())
       return false;
+#endif
 
     return true;
   }
 
+  /// Determines the address of the jump instruction that redirects execution away from an original
+  /// function. For functions laid out for hot-patching, the jump is written into the padding that
+  /// precedes them, and their entry points hold short jumps to it.
+  /// @param [in] originalFunc Address of the original function.
+  /// @param [in] isHotPatch Whether or not the original function is laid out for hot-patching.
+  /// @return Address of the jump instruction.
+  static inline void* JumpSiteForOriginalFunction(const void* originalFunc, bool isHotPatch)
+  {
+    return reinterpret_cast<void*>(
+        reinterpret_cast<size_t>(originalFunc) -
+        ((true == isHotPatch) ? static_cast<size_t>(X86Instruction::kHotPatchPaddingLengthBytes)
+                              : 0));
+  }
+
+  /// Determines the range of bytes that are modified to redirect execution away from an original
+  /// function, including the entry point of a function laid out for hot-patching.
+  /// @param [in] originalFunc Address of the original function.
+  /// @param [in] isHotPatch Whether or not the original function is laid out for hot-patching.
+  /// @return Pair consisting of the first modified byte address and the address just past the last
+  /// modified byte.
+  static inline std::pair<size_t, size_t> PatchedRangeForOriginalFunction(
+      const void* originalFunc, bool isHotPatch)
+  {
+    const size_t jumpSite =
+        reinterpret_cast<size_t>(JumpSiteForOriginalFunction(originalFunc, isHotPatch));
+
+    if (true == isHotPatch)
+      return {
+          jumpSite,
+          reinterpret_cast<size_t>(originalFunc) +
+              static_cast<size_t>(X86Instruction::kHotPatchEntryLengthBytes)};
+
+    return {jumpSite, jumpSite + static_cast<size_t>(X86Instruction::kJumpInstructionLengthBytes)};
+  }
+
+  /// Writes the short jump over the entry point of a function laid out for hot-patching. A single
+  /// 2-byte store replaces the entire entry point instruction, so any other thread executing it
+  /// concurrently observes either the original instruction or the short jump. The jump in the
+  /// padding must already be written, and the memory must already be writable.
+  /// @param [in,out] originalFunc Address of the original function.
+  static inline void WriteHotPatchEntryJump(void* originalFunc)
+  {
+    uint16_t entryJump = 0;
+    std::memcpy(&entryJump, X86Instruction::kHotPatchEntryJumpInstruction, sizeof(entryJump));
+    *reinterpret_cast<volatile uint16_t*>(originalFunc) = entryJump;
+    patchSitesModified = true;
+  }
+
   /// Redirects the flow of execution from the specified address to the specified address.
   /// Accomplishes this task by overwriting some bytes of the source function with a jump that
-  /// targets the destination address.
+  /// targets the destination address. If the source function is laid out for hot-patching, the
+  /// jump is written into the padding before it, and only its first instruction is overwritten.
   /// @param [in,out] from Source function, part of which will be overwritten.
   /// @param [in] to Destination function.
   /// @return `true` on success, `false` on failure.
   static inline bool RedirectExecution(void* from, const void* to)
   {
+    // The destination might be trampoline memory whose instruction cache flush is still deferred,
+    // and it needs to be flushed before anything can reach it.
+    TrampolineStore::FlushDeferredInstructionCache();
+
+    // This is the same determination that the trampoline made when its original function was set,
+    // since the source function has not yet been modified.
+    const bool isHotPatch = X86Instruction::IsHotPatchable(from);
+    const auto patchedRange = PatchedRangeForOriginalFunction(from, isHotPatch);
+    void* const patchedBegin = reinterpret_cast<void*>(patchedRange.first);
+    const SIZE_T patchedSizeBytes = static_cast<SIZE_T>(patchedRange.second - patchedRange.first);
+
     DWORD originalProtection = 0;
     if (0 ==
         Protected::Windows_VirtualProtect(
-            from,
-            X86Instruction::kJumpInstructionLengthBytes,
-            PAGE_EXECUTE_READWRITE,
-            &originalProtection))
+            patchedBegin, patchedSizeBytes, PAGE_EXECUTE_READWRITE, &originalProtection))
       return false;
 
-    const bool writeJumpResult =
-        X86Instruction::WriteJumpInstruction(from, X86Instruction::kJumpInstructionLengthBytes, to);
+    const bool writeJumpResult = X86Instruction::WriteJumpInstruction(
+        JumpSiteForOriginalFunction(from, isHotPatch),
+        X86Instruction::kJumpInstructionLengthBytes,
+        to);
+    patchSitesModified = true;
+    if ((true == writeJumpResult) && (true == isHotPatch)) WriteHotPatchEntryJump(from);
 
     DWORD unusedOriginalProtection = 0;
     const bool restoreProtectionResult =
         (0 !=
          Protected::Windows_VirtualProtect(
-             from,
-             X86Instruction::kJumpInstructionLengthBytes,
-             originalProtection,
-             &unusedOriginalProtection));
+             patchedBegin, patchedSizeBytes, originalProtection, &unusedOriginalProtection));
     if (true == restoreProtectionResult)
       Protected::Windows_FlushInstructionCache(
-          Infra::ProcessInfo::GetCurrentProcessHandle(),
-          from,
-          static_cast<SIZE_T>(X86Instruction::kJumpInstructionLengthBytes));
+          Infra::ProcessInfo::GetCurrentProcessHandle(), patchedBegin, patchedSizeBytes);
 
     return (writeJumpResult && restoreProtectionResult);
   }
 
-  EResult HookStore::CreateHookInternal(
-      void* originalFunc,
-      const void* hookFunc,
-      const bool isInternal,
-      const void** originalFuncAfterHook)
+  /// Determines the size of the smallest aligned block of memory that contains an entire jump
+  /// instruction written at the specified address and can be replaced using a single atomic
+  /// compare-and-exchange operation. Such operations are available for 8-byte blocks on all
+  /// platforms and for 16-byte blocks on 64-bit platforms.
+  /// @param [in] where Address of the jump instruction.
+  /// @return Size of the block, in bytes, or 0 if there is no suitable block.
+  static inline size_t AtomicBlockSizeForJump(const void* where)
   {
-    if (false == IsHookSpecValid(originalFunc, hookFunc)) return EResult::FailInvalidArgument;
-
-    std::unique_lock<std::shared_mutex> lock(hookStoreMutex);
-
-    // Check for duplicates.
-    // If Hookshot has already set a hook that touches either the specified original or hook
-    // function, that is an error.
-    if (0 != functionToTrampoline.count(originalFunc) || 0 != functionToTrampoline.count(hookFunc))
-      return EResult::FailDuplicate;
-
 #ifdef _WIN64
-    // In 64-bit mode, trampolines are stored close to the target functions.
-    // Therefore, it is necessary to identify the TrampolineStore object that is correct for the
-    // given target function address. Because only one TrampolineStore object exists per base
-    // address, the number of allowed hooks per base address is limited.
-    void* const baseAddress = BaseAddressForOriginalFunc(originalFunc);
-    if (nullptr == baseAddress) return EResult::FailInternal;
-
-    // If this is the first target function for the specified base address, or all existing
-    // TrampolineStore objects for that base address are full, attempt to place a new
-    // TrampolineStore buffer. Do this by repeatedly moving backward in memory from the base address
-    // by the size of the TrampolineStore buffer until either too many attempts were made or a
-    // possible location is identified. Permissible addresses are aligned on a boundary equal to the
-    // size of a TrampolineStore buffer.
-    if (0 == trampolineStoreMap.count(baseAddress) ||
-        0 == trampolines[trampolineStoreMap.at(baseAddress).back()].FreeCount())
-    {
-      size_t proposedTrampolineStoreAddress =
-          (reinterpret_cast<size_t>(baseAddress) -
-           static_cast<size_t>(TrampolineStore::kTrampolineStoreSizeBytes)) &
-          ~(static_cast<size_t>(TrampolineStore::kTrampolineStoreSizeBytes) - 1);
-      const size_t numAddressesAlreadyTried = (0 == trampolineStoreMap.count(baseAddress))
-          ? (0)
-          : (1 +
-             ((proposedTrampolineStoreAddress - (size_t) &
-               (trampolines[trampolineStoreMap.at(baseAddress).back()][0])) /
-              TrampolineStore::kTrampolineStoreSizeBytes));
-
-      proposedTrampolineStoreAddress -=
-          (numAddressesAlreadyTried * TrampolineStore::kTrampolineStoreSizeBytes);
-
-      for (int i = static_cast<int>(numAddressesAlreadyTried);
-           i < ((INT_MAX / TrampolineStore::kTrampolineStoreSizeBytes) / 4);
-           ++i)
-      {
-        TrampolineStore newTrampolineStore(reinterpret_cast<void*>(proposedTrampolineStoreAddress));
-        if (true == newTrampolineStore.IsInitialized())
-        {
-          trampolineStoreMap[baseAddress].push_back(static_cast<int>(trampolines.size()));
-          trampolines.push_back(std::move(newTrampolineStore));
-          break;
-        }
+    constexpr size_t kBlockSizes[] = {sizeof(uint64_t), 2 * sizeof(uint64_t)};
+#else
+    constexpr size_t kBlockSizes[] = {sizeof(uint64_t)};
+#endif
 
-        proposedTrampolineStoreAddress -= TrampolineStore::kTrampolineStoreSizeBytes;
-      }
+    for (const size_t blockSize : kBlockSizes)
+    {
+      if (((reinterpret_cast<size_t>(where) % blockSize) +
+           static_cast<size_t>(X86Instruction::kJumpInstructionLengthBytes)) <= blockSize)
+        return blockSize;
     }
 
-    if (0 == trampolineStoreMap.count(baseAddress)) return EResult::FailAllocation;
+    return 0;
+  }
 
-    const size_t trampolineStoreIndex = trampolineStoreMap.at(baseAddress).back();
-#else
-    // In 32-bit mode, all trampolines are stored in a central location.
-    // Therefore, it is sufficient to keep appending new TrampolineStore objects as existing ones
-    // fill up.
-    if (0 == trampolines.size()) trampolines.emplace_back();
+  /// Overwrites the bytes at the location of a jump instruction in a way that is atomic with
+  /// respect to any other thread executing them, by replacing the entire aligned block of memory
+  /// that contains them with a single atomic compare-and-exchange operation.
+  /// @param [in,out] where Address at which to write, which must be suitable for writing a jump
+  /// instruction atomically.
+  /// @param [in] codeBytes Bytes to be written, exactly the length of a jump instruction.
+  /// @return `true` on success, `false` on failure.
+  static bool WriteJumpBytesAtomically(void* where, const uint8_t* codeBytes)
+  {
+    TrampolineStore::FlushDeferredInstructionCache();
 
-    if (0 == trampolines.back().FreeCount()) trampolines.emplace_back();
+    const size_t blockSize = AtomicBlockSizeForJump(where);
+    if (0 == blockSize) return false;
 
-    const size_t trampolineStoreIndex = trampolines.size() - 1;
-#endif
+    volatile LONG64* const block =
+        reinterpret_cast<volatile LONG64*>(reinterpret_cast<size_t>(where) & ~(blockSize - 1));
+    const size_t writeOffset = reinterpret_cast<size_t>(where) - reinterpret_cast<size_t>(block);
 
-    TrampolineStore& trampolineStore = trampolines[trampolineStoreIndex];
-    if (false == trampolineStore.IsInitialized()) return EResult::FailInternal;
+    DWORD originalProtection = 0;
+    if (0 ==
+        Protected::Windows_VirtualProtect(
+            const_cast<LONG64*>(block), blockSize, PAGE_EXECUTE_READWRITE, &originalProtection))
+      return false;
 
-    const int allocatedIndex = trampolineStore.Allocate();
-    if (allocatedIndex < 0) return EResult::FailAllocation;
+    // The rest of the block is preserved. Retrying the compare-and-exchange covers the possibility
+    // of another thread, perhaps outside of Hookshot, modifying a different part of the same block.
+    alignas(16) LONG64 expectedBlock[2] = {
+        block[0], ((sizeof(uint64_t) == blockSize) ? 0 : block[1])};
+    alignas(16) LONG64 desiredBlock[2] = {};
+    patchSitesModified = true;
 
-    Trampoline& trampoline = trampolineStore[allocatedIndex];
-    trampoline.SetHookFunction(hookFunc);
-    if (false == trampoline.SetOriginalFunction(originalFunc))
+    while (true)
     {
-      Infra::Message::OutputFormatted(
-          Infra::Message::ESeverity::Info,
-          L"Failed to set up a trampoline for original function at 0x%llx.",
-          (long long)originalFunc);
+      std::memcpy(desiredBlock, expectedBlock, sizeof(desiredBlock));
+      std::memcpy(
+          &reinterpret_cast<uint8_t*>(desiredBlock)[writeOffset],
+          codeBytes,
+          static_cast<size_t>(X86Instruction::kJumpInstructionLengthBytes));
 
-      trampolineStore.Deallocate();
-      return EResult::FailCannotSetHook;
-    }
-
-    UpdateProtectedDependencyAddress(originalFunc, trampoline.GetOriginalFunction());
+#ifdef _WIN64
+      if (2 * sizeof(uint64_t) == blockSize)
+      {
+        if (0 !=
+            InterlockedCompareExchange128(
+                block, desiredBlock[1], desiredBlock[0], expectedBlock))
+          break;
 
-    if (false == RedirectExecution(originalFunc, trampoline.GetHookFunction()))
-    {
-      Infra::Message::OutputFormatted(
-          Infra::Message::ESeverity::Info,
-          L"Failed to redirect execution from 0x%llx to 0x%llx.",
-          (long long)originalFunc,
-          (long long)trampoline.GetHookFunction());
+        continue;
+      }
+#endif
 
-      trampolineStore.Deallocate();
-      return EResult::FailCannotSetHook;
-    }
+      const LONG64 previousBlock =
+          InterlockedCompareExchange64(block, desiredBlock[0], expectedBlock[0]);
+      if (previousBlock == expectedBlock[0]) break;
 
-    // Internal hooks are intended to be invisible to the Hookshot API user.
-    // Therefore, they are not inserted into Hookshot data structures.
-    // However, this means that methods like GetOriginalFunction are not available, hence the need
-    // to save out the address of the trampoline's "original" region immediately.
-    if (false == isInternal)
-    {
-      functionToTrampoline[originalFunc] = &trampolineStore[allocatedIndex];
-      functionToTrampoline[hookFunc] = &trampolineStore[allocatedIndex];
-      trampolineToOriginalFunction[&trampoline] = originalFunc;
-    }
-    else
-    {
-      if (nullptr != originalFuncAfterHook)
-        *originalFuncAfterHook = trampoline.GetOriginalFunction();
+      expectedBlock[0] = previousBlock;
     }
 
-    return EResult::Success;
-  }
+    DWORD unusedOriginalProtection = 0;
+    const bool restoreProtectionResult =
+        (0 !=
+         Protected::Windows_VirtualProtect(
+             const_cast<LONG64*>(block), blockSize, originalProtection, &unusedOriginalProtection));
+    Protected::Windows_FlushInstructionCache(
+        Infra::ProcessInfo::GetCurrentProcessHandle(),
+        const_cast<LONG64*>(block),
+        static_cast<SIZE_T>(blockSize));
 
-  EResult HookStore::CreateHook(void* originalFunc, const void* hookFunc)
-  {
-    return CreateHookInternal(originalFunc, hookFunc, false, nullptr);
+    return restoreProtectionResult;
   }
 
-  EResult HookStore::DisableHookFunction(const void* originalOrHookFunc)
+  /// Encodes the bytes of a jump instruction as they would need to appear at the specified address.
+  /// @param [in] where Address at which the jump instruction would be written.
+  /// @param [in] to Target address of the jump instruction.
+  /// @param [out] jumpBytes Filled with the encoded jump instruction, which is exactly the length
+  /// of a jump instruction.
+  /// @return `true` on success, `false` if the target is too far away.
+  static bool EncodeJumpBytes(const void* where, const void* to, uint8_t* jumpBytes)
   {
-    return ReplaceHookFunction(originalOrHookFunc, GetOriginalFunction(originalOrHookFunc));
-  }
+    if (false == X86Instruction::CanWriteJumpInstruction(where, to)) return false;
 
-  const void* HookStore::GetOriginalFunction(const void* originalOrHookFunc)
-  {
-    std::shared_lock<std::shared_mutex> lock(hookStoreMutex);
+    const int32_t displacement = static_cast<int32_t>(
+        reinterpret_cast<int64_t>(to) -
+        (reinterpret_cast<int64_t>(where) +
+         static_cast<int64_t>(X86Instruction::kJumpInstructionLengthBytes)));
 
-    if (0 == functionToTrampoline.count(originalOrHookFunc)) return nullptr;
+    std::memcpy(
+        &jumpBytes[0],
+        X86Instruction::kJumpInstructionPreamble,
+        sizeof(X86Instruction::kJumpInstructionPreamble));
+    std::memcpy(
+        &jumpBytes[sizeof(X86Instruction::kJumpInstructionPreamble)],
+        &displacement,
+        sizeof(displacement));
 
-    return functionToTrampoline.at(originalOrHookFunc)->GetOriginalFunction();
+    return true;
   }
 
-  EResult HookStore::ReplaceHookFunction(const void* originalOrHookFunc, const void* newHookFunc)
+  /// Changes the target of a jump instruction previously written by #RedirectExecution, such that
+  /// any thread executing the jump instruction concurrently observes either the old target or the
+  /// new target. Can also be used to write a new jump instruction over the original bytes of a
+  /// function that was restored to its unhooked state.
+  /// @param [in,out] from Source function, whose jump instruction must be suitable for writing
+  /// atomically.
+  /// @param [in] to New destination function.
+  /// @param [in] isHotPatch Whether or not the source function is laid out for hot-patching, in
+  /// which case the jump instruction is in the padding before it and its entry point is made to
+  /// jump there if it does not already.
+  /// @return `true` on success, `false` on failure.
+  static bool RedirectExecutionAtomically(void* from, const void* to, bool isHotPatch)
   {
-    std::unique_lock<std::shared_mutex> lock(hookStoreMutex);
-
-    // If this fails, the specified hook does not exist.
-    if (0 == functionToTrampoline.count(originalOrHookFunc)) return EResult::FailNotFound;
+    TrampolineStore::FlushDeferredInstructionCache();
 
-    Trampoline* const trampoline = functionToTrampoline.at(originalOrHookFunc);
+    void* const jumpSite = JumpSiteForOriginalFunction(from, isHotPatch);
 
-    // If this fails, internal data structures are inconsistent.
-    if (0 == trampolineToOriginalFunction.count(trampoline)) return EResult::FailInternal;
+    uint8_t jumpBytes[X86Instruction::kJumpInstructionLengthBytes];
+    if (false == EncodeJumpBytes(jumpSite, to, jumpBytes)) return false;
 
-    const void* const originalFunc = trampolineToOriginalFunction.at(trampoline);
-    const void* const oldHookFunc = trampoline->GetHookTrampolineTarget();
-    if (oldHookFunc == newHookFunc) return EResult::NoEffect;
+    if (false == isHotPatch) return WriteJumpBytesAtomically(jumpSite, jumpBytes);
 
-    // If this fails, internal data structures are inconsistent.
-    if (0 == functionToTrampoline.count(originalFunc) ||
-        0 == functionToTrampoline.count(oldHookFunc))
-      return EResult::FailInternal;
+    // The jump in the padding of a function laid out for hot-patching is not modified while its
+    // hook is disabled, so when it is enabled again the jump might already be correct.
+    if ((0 != std::memcmp(jumpSite, jumpBytes, sizeof(jumpBytes))) &&
+        (false == WriteJumpBytesAtomically(jumpSite, jumpBytes)))
+      return false;
 
-    // If this fails, the replacement hook function is already involved in a different hook.
-    if (0 != functionToTrampoline.count(newHookFunc)) return EResult::FailDuplicate;
+    // The entry point already holds the short jump unless the hook was disabled, which restores it.
+    if (0 ==
+        std::memcmp(
+            from,
+            X86Instruction::kHotPatchEntryJumpInstruction,
+            sizeof(X86Instruction::kHotPatchEntryJumpInstruction)))
+      return true;
+
+    DWORD originalProtection = 0;
+    if (0 ==
+        Protected::Windows_VirtualProtect(
+            from,
+            X86Instruction::kHotPatchEntryLengthBytes,
+            PAGE_EXECUTE_READWRITE,
+            &originalProtection))
+      return false;
+
+    WriteHotPatchEntryJump(from);
+
+    DWORD unusedOriginalProtection = 0;
+    const bool restoreProtectionResult =
+        (0 !=
+         Protected::Windows_VirtualProtect(
+             from,
+             X86Instruction::kHotPatchEntryLengthBytes,
+             originalProtection,
+             &unusedOriginalProtection));
+    Protected::Windows_FlushInstructionCache(
+        Infra::ProcessInfo::GetCurrentProcessHandle(),
+        from,
+        static_cast<SIZE_T>(X86Instruction::kHotPatchEntryLengthBytes));
+
+    return restoreProtectionResult;
+  }
+
+  /// Overwrites the bytes at the location of a jump instruction without any guarantee of atomicity.
+  /// Only safe if no other thread can be executing them, such as when all other threads are
+  /// suspended.
+  /// @param [in,out] where Address at which to write.
+  /// @param [in] codeBytes Bytes to be written, exactly the specified number of them.
+  /// @param [in] numBytes Number of bytes to write, which is usually the length of a relative jump
+  /// instruction but is the length of an absolute jump instruction for original functions
+  /// redirected using one.
+  /// @return `true` on success, `false` on failure.
+  static bool WriteJumpBytes(
+      void* where,
+      const uint8_t* codeBytes,
+      size_t numBytes = static_cast<size_t>(X86Instruction::kJumpInstructionLengthBytes))
+  {
+    TrampolineStore::FlushDeferredInstructionCache();
+
+    DWORD originalProtection = 0;
+    if (0 ==
+        Protected::Windows_VirtualProtect(
+            where, static_cast<SIZE_T>(numBytes), PAGE_EXECUTE_READWRITE, &originalProtection))
+      return false;
+
+    std::memcpy(where, codeBytes, numBytes);
+    patchSitesModified = true;
+
+    DWORD unusedOriginalProtection = 0;
+    const bool restoreProtectionResult =
+        (0 !=
+         Protected::Windows_VirtualProtect(
+             where, static_cast<SIZE_T>(numBytes), originalProtection, &unusedOriginalProtection));
+    Protected::Windows_FlushInstructionCache(
+        Infra::ProcessInfo::GetCurrentProcessHandle(), where, static_cast<SIZE_T>(numBytes));
+
+    return restoreProtectionResult;
+  }
+
+  /// Writes the calling thread's pointer to its table of hook overrides.
+  /// @param [in] tableOffset Offset of the table pointer within the thread environment block.
+  /// @param [in] table Table of hook overrides, or `nullptr` if the thread has none.
+  static inline void WriteThreadOverrideTablePointer(size_t tableOffset, const void* const* table)
+  {
+#ifdef _WIN64
+    __writegsqword(
+        static_cast<unsigned long>(tableOffset),
+        static_cast<unsigned __int64>(reinterpret_cast<size_t>(table)));
+#else
+    __writefsdword(
+        static_cast<unsigned long>(tableOffset),
+        static_cast<unsigned long>(reinterpret_cast<size_t>(table)));
+#endif
+  }
+
+  /// Owns the calling thread's table of hook overrides, which is created the first time the thread
+  /// overrides any hook. When the thread exits, the table pointer is cleared before the table is
+  /// freed, so that hooked functions invoked later during thread exit see no overrides.
+  struct SThreadOverrideTableOwner
+  {
+    /// Offset of the table pointer within the thread environment block. Valid only if the table
+    /// exists.
+    size_t tableOffset;
+
+    /// Table of hook overrides, indexed by thread override stub.
+    std::unique_ptr<const void*[]> table;
+
+    ~SThreadOverrideTableOwner(void)
+    {
+      if (nullptr != table) WriteThreadOverrideTablePointer(tableOffset, nullptr);
+    }
+  };
+
+  /// Calling thread's table of hook overrides.
+  static thread_local SThreadOverrideTableOwner threadOverrideTableOwner;
+
+  /// Estimates the number of bytes of heap memory held by a standard hash table, which allocates
+  /// one node per element, linked into a list, along with an array that holds the first and last
+  /// node of each bucket.
+  /// @tparam HashTableType Type of standard hash table.
+  /// @param [in] hashTable Hash table of interest.
+  /// @return Number of bytes.
+  template <typename HashTableType> static size_t HashTableHeapBytes(const HashTableType& hashTable)
+  {
+    return (hashTable.bucket_count() * 2 * sizeof(void*)) +
+        (hashTable.size() * (sizeof(typename HashTableType::value_type) + (2 * sizeof(void*))));
+  }
+
+  /// Computes the number of bytes of heap memory held by a flat pointer map, which allocates one
+  /// entry and one control tag per slot.
+  /// @tparam KeyType Pointer type used as the key.
+  /// @tparam ValueType Type of the mapped value.
+  /// @param [in] hashTable Flat pointer map of interest.
+  /// @return Number of bytes.
+  template <typename KeyType, typename ValueType>
+  static size_t HashTableHeapBytes(const FlatPointerMap<KeyType, ValueType>& hashTable)
+  {
+    return hashTable.bucket_count() *
+        (sizeof(typename FlatPointerMap<KeyType, ValueType>::value_type) + sizeof(int8_t));
+  }
+
+  /// Computes the number of bytes of heap memory held by a vector, including unused capacity.
+  /// @tparam ElementType Type of vector element.
+  /// @param [in] vector Vector of interest.
+  /// @return Number of bytes.
+  template <typename ElementType>
+  static size_t VectorHeapBytes(const std::vector<ElementType>& vector)
+  {
+    return vector.capacity() * sizeof(ElementType);
+  }
+
+  /// Measures the memory used by a single trampoline store.
+  /// @param [in] trampolineStore Trampoline store of interest.
+  /// @param [in] moduleBase Base address of the module or memory region near which the trampoline
+  /// store was placed, or `nullptr` if it was not placed near any of them.
+  /// @return Memory footprint of the trampoline store.
+  static STrampolineStoreFootprint FootprintForTrampolineStore(
+      const TrampolineStore& trampolineStore, const void* moduleBase)
+  {
+    return {
+        .baseAddress = trampolineStore.BaseAddress(),
+        .moduleBase = moduleBase,
+        .reservedBytes = static_cast<size_t>(TrampolineStore::kTrampolineStoreSizeBytes),
+        .committedBytes = static_cast<size_t>(trampolineStore.CommittedBytes()),
+        .numWastedSlots =
+            static_cast<size_t>(trampolineStore.WastedBytes()) / kTrampolineSlotSizeBytes};
+  }
+
+  void HookStore::SuspendOtherThreads(std::vector<HANDLE>& threads)
+  {
+    const DWORD currentProcessId = Protected::Windows_GetCurrentProcessId();
+    const DWORD currentThreadId = Protected::Windows_GetCurrentThreadId();
+
+    const HANDLE threadSnapshot =
+        Protected::Windows_CreateToolhelp32Snapshot(TH32CS_SNAPTHREAD, 0);
+    if (INVALID_HANDLE_VALUE == threadSnapshot) return;
+
+    THREADENTRY32 threadEntry = {.dwSize = sizeof(threadEntry)};
+    for (BOOL threadEntryValid = Protected::Windows_Thread32First(threadSnapshot, &threadEntry);
+         0 != threadEntryValid;
+         threadEntryValid = Protected::Windows_Thread32Next(threadSnapshot, &threadEntry))
+    {
+      if ((currentProcessId != threadEntry.th32OwnerProcessID) ||
+          (currentThreadId == threadEntry.th32ThreadID))
+        continue;
+
+      const HANDLE thread = Protected::Windows_OpenThread(
+          THREAD_SUSPEND_RESUME | THREAD_GET_CONTEXT | THREAD_SET_CONTEXT,
+          FALSE,
+          threadEntry.th32ThreadID);
+      if (nullptr != thread) threads.push_back(thread);
+    }
+
+    Protected::Windows_CloseHandle(threadSnapshot);
+
+    // Threads that cannot be suspended, most likely because they exited after being enumerated,
+    // are dropped. Shrinking the vector does not allocate.
+    size_t numSuspendedThreads = 0;
+    for (size_t i = 0; i < threads.size(); ++i)
+    {
+      if (static_cast<DWORD>(-1) == Protected::Windows_SuspendThread(threads[i]))
+        Protected::Windows_CloseHandle(threads[i]);
+      else
+        threads[numSuspendedThreads++] = threads[i];
+    }
+
+    threads.resize(numSuspendedThreads);
+  }
+
+  void HookStore::ResumeThreads(const std::vector<HANDLE>& threads)
+  {
+    for (const HANDLE thread : threads)
+    {
+      Protected::Windows_ResumeThread(thread);
+      Protected::Windows_CloseHandle(thread);
+    }
+  }
+
+  void HookStore::PlanRedirectExecutionBatch(
+      std::vector<SPendingRedirect>& redirects, std::vector<SAffectedPage>& affectedPages)
+  {
+    const size_t pageSize =
+        static_cast<size_t>(Infra::SystemInfo::GetPlatformAndArchitectureInfo().dwPageSize);
+
+    std::sort(
+        redirects.begin(),
+        redirects.end(),
+        [](const SPendingRedirect& a, const SPendingRedirect& b) -> bool
+        {
+          return (a.from < b.from);
+        });
+
+    // Because the redirections are now sorted by address, the pages they touch are almost always
+    // identified in increasing order with duplicates appearing consecutively. Redirections of
+    // functions laid out for hot-patching begin in the padding before them, though, so each page is
+    // inserted wherever it belongs.
+    affectedPages.clear();
+    for (const auto& redirect : redirects)
+    {
+      const auto patchedRange = PatchedRangeForOriginalFunction(
+          redirect.from, (0 != hotPatchedFunctions.count(redirect.from)));
+      for (size_t pageAddress = (patchedRange.first & ~(pageSize - 1));
+           pageAddress < patchedRange.second;
+           pageAddress += pageSize)
+      {
+        auto insertPosition = std::lower_bound(
+            affectedPages.begin(),
+            affectedPages.end(),
+            pageAddress,
+            [](const SAffectedPage& page, size_t value) -> bool
+            {
+              return (page.address < value);
+            });
+        if ((affectedPages.end() != insertPosition) && (insertPosition->address == pageAddress))
+          continue;
+
+        affectedPages.insert(
+            insertPosition,
+            {.address = pageAddress,
+             .originalProtection = 0,
+             .unprotected = false,
+             .restored = false});
+      }
+    }
+  }
+
+  void HookStore::ApplyRedirectExecutionBatch(
+      std::vector<SPendingRedirect>& redirects, std::vector<SAffectedPage>& affectedPages)
+  {
+    if (true == redirects.empty()) return;
+    patchSitesModified = true;
+
+    // All of the trampolines prepared for the batch were flushed together when their flushes were
+    // deferred, and they need to be flushed before any original function can reach them.
+    TrampolineStore::FlushDeferredInstructionCache();
+
+    const size_t pageSize =
+        static_cast<size_t>(Infra::SystemInfo::GetPlatformAndArchitectureInfo().dwPageSize);
+
+    for (auto& affectedPage : affectedPages)
+      affectedPage.unprotected =
+          (0 !=
+           Protected::Windows_VirtualProtect(
+               reinterpret_cast<void*>(affectedPage.address),
+               pageSize,
+               PAGE_EXECUTE_READWRITE,
+               &affectedPage.originalProtection));
+
+    // For each redirection, locate the range of affected pages it touches. These ranges are also
+    // in increasing order, so a single cursor is sufficient, although it might need to move back by
+    // a page for a function laid out for hot-patching.
+    auto pageRangeForRedirect = [&affectedPages, pageSize](
+                                    const SPendingRedirect& redirect,
+                                    size_t& pageCursor) -> std::pair<size_t, size_t>
+    {
+      const auto patchedRange = PatchedRangeForOriginalFunction(
+          redirect.from, (0 != hotPatchedFunctions.count(redirect.from)));
+      const size_t redirectBegin = patchedRange.first;
+      const size_t redirectEnd = patchedRange.second;
+
+      while ((pageCursor > 0) && (affectedPages[pageCursor].address > redirectBegin))
+        pageCursor -= 1;
+      while ((affectedPages[pageCursor].address + pageSize) <= redirectBegin)
+        pageCursor += 1;
+
+      size_t pageRangeEnd = pageCursor;
+      while ((pageRangeEnd < affectedPages.size()) &&
+             (affectedPages[pageRangeEnd].address < redirectEnd))
+        pageRangeEnd += 1;
+
+      return {pageCursor, pageRangeEnd};
+    };
+
+    size_t pageCursor = 0;
+    size_t previousRedirectEnd = 0;
+    for (auto& redirect : redirects)
+    {
+      const auto pageRange = pageRangeForRedirect(redirect, pageCursor);
+      redirect.succeeded = false;
+
+      if (true == redirect.skipped) continue;
+
+      // Two redirections whose modified bytes would overlap cannot both be written, so the one at
+      // the higher address is rejected.
+      const bool isHotPatch = (0 != hotPatchedFunctions.count(redirect.from));
+      const auto patchedRange = PatchedRangeForOriginalFunction(redirect.from, isHotPatch);
+      if (patchedRange.first < previousRedirectEnd) continue;
+
+      bool allPagesUnprotected = true;
+      for (size_t i = pageRange.first; i < pageRange.second; ++i)
+        allPagesUnprotected = (allPagesUnprotected && affectedPages[i].unprotected);
+      if (false == allPagesUnprotected) continue;
+
+      redirect.succeeded = X86Instruction::WriteJumpInstruction(
+          JumpSiteForOriginalFunction(redirect.from, isHotPatch),
+          X86Instruction::kJumpInstructionLengthBytes,
+          redirect.to);
+      if (true == redirect.succeeded)
+      {
+        if (true == isHotPatch) WriteHotPatchEntryJump(redirect.from);
+        previousRedirectEnd = patchedRange.second;
+      }
+    }
+
+    for (auto& affectedPage : affectedPages)
+    {
+      if (false == affectedPage.unprotected) continue;
+
+      DWORD unusedOriginalProtection = 0;
+      affectedPage.restored =
+          (0 !=
+           Protected::Windows_VirtualProtect(
+               reinterpret_cast<void*>(affectedPage.address),
+               pageSize,
+               affectedPage.originalProtection,
+               &unusedOriginalProtection));
+    }
+
+    // As with single redirections, failing to restore the original protection is treated as a
+    // failure. Successful redirections are then coalesced into ranges of contiguous pages, and the
+    // instruction cache is flushed once per range.
+    size_t flushRangeBegin = 0;
+    size_t flushRangeEnd = 0;
+    pageCursor = 0;
+    for (auto& redirect : redirects)
+    {
+      const auto pageRange = pageRangeForRedirect(redirect, pageCursor);
+      if (false == redirect.succeeded) continue;
+
+      for (size_t i = pageRange.first; i < pageRange.second; ++i)
+        redirect.succeeded = (redirect.succeeded && affectedPages[i].restored);
+      if (false == redirect.succeeded) continue;
+
+      const size_t redirectPagesBegin = affectedPages[pageRange.first].address;
+      const size_t redirectPagesEnd = affectedPages[pageRange.second - 1].address + pageSize;
+      if ((flushRangeEnd != 0) && (redirectPagesBegin <= flushRangeEnd))
+      {
+        flushRangeEnd = redirectPagesEnd;
+        continue;
+      }
+
+      if (0 != flushRangeEnd)
+        Protected::Windows_FlushInstructionCache(
+            Infra::ProcessInfo::GetCurrentProcessHandle(),
+            reinterpret_cast<void*>(flushRangeBegin),
+            static_cast<SIZE_T>(flushRangeEnd - flushRangeBegin));
+
+      flushRangeBegin = redirectPagesBegin;
+      flushRangeEnd = redirectPagesEnd;
+    }
+
+    if (0 != flushRangeEnd)
+      Protected::Windows_FlushInstructionCache(
+          Infra::ProcessInfo::GetCurrentProcessHandle(),
+          reinterpret_cast<void*>(flushRangeBegin),
+          static_cast<SIZE_T>(flushRangeEnd - flushRangeBegin));
+  }
+
+  void HookStore::RedirectExecutionBatch(std::vector<SPendingRedirect>& redirects)
+  {
+    std::vector<SAffectedPage> affectedPages;
+    PlanRedirectExecutionBatch(redirects, affectedPages);
+    ApplyRedirectExecutionBatch(redirects, affectedPages);
+  }
+
+  bool HookStore::CanRedirectWithoutSuspendingThreads(
+      const std::vector<SPendingRedirect>& redirects)
+  {
+    for (const auto& redirect : redirects)
+    {
+      if (true == InjectionWindow::IsLoaderCode(redirect.from)) return false;
+    }
+
+    return InjectionWindow::IsOnlyLoaderRunning();
+  }
+
+  size_t HookStore::RelocateSuspendedThreads(
+      const std::vector<HANDLE>& threads, std::vector<SPendingRedirect>& redirects)
+  {
+    size_t numRelocatedThreads = 0;
+
+    for (const HANDLE thread : threads)
+    {
+      // Retrieving the context of a suspended thread also guarantees that the thread has actually
+      // stopped running, since suspension itself is asynchronous. A thread whose context cannot be
+      // retrieved is left alone.
+      CONTEXT threadContext = {};
+      threadContext.ContextFlags = CONTEXT_CONTROL;
+      if (0 == Protected::Windows_GetThreadContext(thread, &threadContext)) continue;
+
+#ifdef _WIN64
+      const size_t instructionPointer = static_cast<size_t>(threadContext.Rip);
+#else
+      const size_t instructionPointer = static_cast<size_t>(threadContext.Eip);
+#endif
+
+      // Redirections are sorted by address, so the only candidate is the last one that starts at
+      // or before the instruction pointer. A thread stopped exactly at the start of an original
+      // function will simply follow the hook once it resumes.
+      auto redirect = std::upper_bound(
+          redirects.begin(),
+          redirects.end(),
+          instructionPointer,
+          [](const size_t address, const SPendingRedirect& redirect) -> bool
+          {
+            return (address < reinterpret_cast<size_t>(redirect.from));
+          });
+      if (redirects.begin() == redirect) continue;
+      --redirect;
+
+      // Functions laid out for hot-patching only have their first instruction overwritten, and the
+      // padding before them is never executed, so threads stopped in them never need relocation.
+      const size_t redirectBegin = reinterpret_cast<size_t>(redirect->from);
+      const bool isHotPatch = (0 != hotPatchedFunctions.count(redirect->from));
+      const size_t redirectEnd = PatchedRangeForOriginalFunction(redirect->from, isHotPatch).second;
+      if ((instructionPointer <= redirectBegin) || (instructionPointer >= redirectEnd)) continue;
+
+      const void* const relocatedInstructionPointer =
+          redirect->trampoline->TranslateOriginalFunctionAddress(
+              redirect->from, reinterpret_cast<const void*>(instructionPointer));
+      if (nullptr == relocatedInstructionPointer)
+      {
+        redirect->skipped = true;
+        continue;
+      }
+
+#ifdef _WIN64
+      threadContext.Rip = reinterpret_cast<DWORD64>(relocatedInstructionPointer);
+#else
+      threadContext.Eip = reinterpret_cast<DWORD>(relocatedInstructionPointer);
+#endif
+
+      if (0 == Protected::Windows_SetThreadContext(thread, &threadContext))
+      {
+        redirect->skipped = true;
+        continue;
+      }
+
+      numRelocatedThreads += 1;
+    }
+
+    return numRelocatedThreads;
+  }
+
+  EResult HookStore::AllocateTrampoline(
+      void* originalFunc,
+      TrampolineStore** trampolineStoreOut,
+      Trampoline** trampolineOut,
+      const bool canUseFarTrampoline)
+  {
+#ifdef _WIN64
+    // In 64-bit mode, trampolines are stored close to the target functions.
+    // Therefore, it is necessary to identify the TrampolineStore object that is correct for the
+    // given target function address. Because only one TrampolineStore object exists per base
+    // address, the number of allowed hooks per base address is limited.
+    void* const baseAddress = BaseAddressForOriginalFunc(originalFunc);
+    if (nullptr == baseAddress) return EResult::FailInternal;
+
+    // If this is the first target function for the specified base address, or all existing
+    // TrampolineStore objects for that base address are full, attempt to place a new
+    // TrampolineStore buffer. Do this by repeatedly moving backward in memory from the base address
+    // by the size of the TrampolineStore buffer until either too many attempts were made or a
+    // possible location is identified. Permissible addresses are aligned on a boundary equal to the
+    // size of a TrampolineStore buffer. The search resumes from wherever the previous search for
+    // the same base address stopped, so no location is ever probed twice.
+    // Space given back by removed hooks is reused before any new store is placed. Stores already
+    // known to be full are skipped, so the cost of finding space does not grow with the number of
+    // stores. Modules loaded near each other can share stores, so space in a store placed for a
+    // nearby module is also used before placing a new one.
+    SNearModuleStores& nearModuleStores = trampolineStoreMap[baseAddress];
+    size_t trampolineStoreIndex = FindTrampolineStoreWithFreeSpace(
+        nearModuleStores.storeIndices.data(),
+        nearModuleStores.storeIndices.size(),
+        nearModuleStores.freeSpaceCursor);
+
+    if (trampolines.size() == trampolineStoreIndex)
+      trampolineStoreIndex =
+          FindSharedTrampolineStoreWithFreeSpace(originalFunc, baseAddress, nearModuleStores);
+
+    if (trampolines.size() == trampolineStoreIndex)
+    {
+      const int newStoreIndex = PlaceTrampolineStoreNear(
+          baseAddress,
+          nearModuleStores,
+          ((true == canUseFarTrampoline) ? kMaxLocationsProbedBeforeFarTrampoline : INT_MAX));
+      if (newStoreIndex < 0) return EResult::FailAllocation;
+
+      trampolineStoreIndex = static_cast<size_t>(newStoreIndex);
+    }
+#else
+    // In 32-bit mode, all trampolines are stored in a central location.
+    // Therefore, it is sufficient to keep appending new TrampolineStore objects as existing ones
+    // fill up. Space given back by removed hooks is reused first.
+    size_t trampolineStoreIndex = FindTrampolineStoreWithFreeSpace(
+        nullptr, trampolines.size(), trampolineStoreFreeSpaceCursor);
+
+    if (trampolines.size() == trampolineStoreIndex)
+    {
+      trampolines.emplace_back();
+      if (true == trampolines.back().IsInitialized())
+        trampolineStoreIndices[trampolines.back().BaseAddress()] = trampolineStoreIndex;
+    }
+#endif
+
+    TrampolineStore& trampolineStore = trampolines[trampolineStoreIndex];
+    if (false == trampolineStore.IsInitialized()) return EResult::FailInternal;
+
+    Trampoline* const allocatedTrampoline = trampolineStore.Allocate();
+    if (nullptr == allocatedTrampoline) return EResult::FailAllocation;
+
+    *trampolineStoreOut = &trampolineStore;
+    *trampolineOut = allocatedTrampoline;
+    return EResult::Success;
+  }
+
+#ifdef _WIN64
+  EResult HookStore::AllocateFarTrampoline(
+      TrampolineStore** trampolineStoreOut, Trampoline** trampolineOut)
+  {
+    // Trampoline stores placed anywhere in memory are shared by all original functions redirected
+    // using absolute jumps, no matter where they are, so that there are as few of them as possible.
+    size_t trampolineStoreIndex = FindTrampolineStoreWithFreeSpace(
+        farStoreIndices.data(), farStoreIndices.size(), farStoreFreeSpaceCursor);
+
+    if (trampolines.size() == trampolineStoreIndex)
+    {
+      TrampolineStore newTrampolineStore;
+      if (false == newTrampolineStore.IsInitialized()) return EResult::FailAllocation;
+
+      farStoreIndices.push_back(static_cast<int>(trampolines.size()));
+      trampolineStoreIndices[newTrampolineStore.BaseAddress()] = trampolines.size();
+      trampolines.push_back(std::move(newTrampolineStore));
+    }
+
+    TrampolineStore& trampolineStore = trampolines[trampolineStoreIndex];
+    Trampoline* const allocatedTrampoline = trampolineStore.Allocate();
+    if (nullptr == allocatedTrampoline) return EResult::FailAllocation;
+
+    *trampolineStoreOut = &trampolineStore;
+    *trampolineOut = allocatedTrampoline;
+    return EResult::Success;
+  }
+
+  size_t HookStore::FindSharedTrampolineStoreWithFreeSpace(
+      const void* originalFunc, void* baseAddress, SNearModuleStores& nearModuleStores)
+  {
+    // Stores within reach of the memory region are within reach of almost every function in it,
+    // but a function near the end of a very large module might still be out of reach.
+    const auto isWithinReachOfOriginalFunc = [originalFunc](const TrampolineStore& store) -> bool
+    {
+      const uint8_t* const storeBegin = reinterpret_cast<const uint8_t*>(store.BaseAddress());
+      return (
+          (true == X86Instruction::CanWriteJumpInstruction(originalFunc, storeBegin)) &&
+          (true ==
+           X86Instruction::CanWriteJumpInstruction(
+               originalFunc, &storeBegin[TrampolineStore::kTrampolineStoreSizeBytes - 1])));
+    };
+
+    const size_t sharedStoreIndex = FindTrampolineStoreWithFreeSpace(
+        nearModuleStores.sharedStoreIndices.data(),
+        nearModuleStores.sharedStoreIndices.size(),
+        nearModuleStores.sharedFreeSpaceCursor);
+    if ((trampolines.size() != sharedStoreIndex) &&
+        (true == isWithinReachOfOriginalFunc(trampolines[sharedStoreIndex])))
+      return sharedStoreIndex;
+
+    for (const auto& baseAddressAndStores : trampolineStoreMap)
+    {
+      if (baseAddress == baseAddressAndStores.first) continue;
+
+      for (const int storeIndex : baseAddressAndStores.second.storeIndices)
+      {
+        const TrampolineStore& trampolineStore = trampolines[static_cast<size_t>(storeIndex)];
+        if ((false == trampolineStore.HasFreeSpace()) ||
+            (false == IsTrampolineStoreNear(trampolineStore, baseAddress)) ||
+            (false == isWithinReachOfOriginalFunc(trampolineStore)))
+          continue;
+
+        if (nearModuleStores.sharedStoreIndices.cend() ==
+            std::find(
+                nearModuleStores.sharedStoreIndices.cbegin(),
+                nearModuleStores.sharedStoreIndices.cend(),
+                storeIndex))
+          nearModuleStores.sharedStoreIndices.push_back(storeIndex);
+
+        return static_cast<size_t>(storeIndex);
+      }
+    }
+
+    return trampolines.size();
+  }
+
+  bool HookStore::IsTrampolineStoreNear(const TrampolineStore& trampolineStore, void* baseAddress)
+  {
+    const size_t storeBegin = reinterpret_cast<size_t>(trampolineStore.BaseAddress());
+    const size_t storeEnd =
+        storeBegin + static_cast<size_t>(TrampolineStore::kTrampolineStoreSizeBytes);
+    const size_t regionBase = reinterpret_cast<size_t>(baseAddress);
+
+    // Stores before the memory region are measured from their beginning, just as when a store is
+    // placed for it, and stores after it are measured from their end, so that every byte of the
+    // store is within the same distance either way.
+    const size_t distance =
+        ((storeEnd <= regionBase) ? (regionBase - storeBegin) : (storeEnd - regionBase));
+    return (distance <= kMaxTrampolineStoreDistanceBytes);
+  }
+
+  int HookStore::PlaceTrampolineStoreNear(
+      void* baseAddress, SNearModuleStores& nearModuleStores, int maxLocationsToProbe)
+  {
+    if (nullptr != nearModuleStores.suggestedStoreAddress)
+    {
+      TrampolineStore suggestedTrampolineStore(nearModuleStores.suggestedStoreAddress);
+      nearModuleStores.suggestedStoreAddress = nullptr;
+
+      if (true == suggestedTrampolineStore.IsInitialized())
+      {
+        const int newStoreIndex = static_cast<int>(trampolines.size());
+        nearModuleStores.storeIndices.push_back(newStoreIndex);
+        trampolineStoreIndices[suggestedTrampolineStore.BaseAddress()] = trampolines.size();
+        trampolines.push_back(std::move(suggestedTrampolineStore));
+        return newStoreIndex;
+      }
+    }
+
+    const int maxLocationsToTry = static_cast<int>(
+        kMaxTrampolineStoreDistanceBytes / TrampolineStore::kTrampolineStoreSizeBytes);
+
+    const size_t firstProposedTrampolineStoreAddress =
+        (reinterpret_cast<size_t>(baseAddress) -
+         static_cast<size_t>(TrampolineStore::kTrampolineStoreSizeBytes)) &
+        ~(static_cast<size_t>(TrampolineStore::kTrampolineStoreSizeBytes) - 1);
+
+    int numLocationsProbed = 0;
+
+    while ((nearModuleStores.numLocationsTried < maxLocationsToTry) &&
+           (numLocationsProbed < maxLocationsToProbe))
+    {
+      numLocationsProbed += 1;
+
+      const size_t proposedTrampolineStoreAddress = firstProposedTrampolineStoreAddress -
+          (static_cast<size_t>(nearModuleStores.numLocationsTried) *
+           static_cast<size_t>(TrampolineStore::kTrampolineStoreSizeBytes));
+      nearModuleStores.numLocationsTried += 1;
+
+      // Address space near modules tends to be crowded, so rather than attempting a reservation at
+      // every candidate location, the state of the address space is queried first. An occupied
+      // location is part of an allocation that extends at least down to its allocation base, so
+      // every candidate location in between is skipped at once.
+      MEMORY_BASIC_INFORMATION memoryInfo = {};
+      if (0 !=
+          Protected::Windows_VirtualQuery(
+              reinterpret_cast<const void*>(proposedTrampolineStoreAddress),
+              &memoryInfo,
+              sizeof(memoryInfo)))
+      {
+        if (MEM_FREE != memoryInfo.State)
+        {
+          const size_t allocationBase = reinterpret_cast<size_t>(memoryInfo.AllocationBase);
+          if ((0 != allocationBase) && (allocationBase < proposedTrampolineStoreAddress))
+          {
+            const size_t numOccupiedLocations =
+                (proposedTrampolineStoreAddress - allocationBase) /
+                static_cast<size_t>(TrampolineStore::kTrampolineStoreSizeBytes);
+            nearModuleStores.numLocationsTried += static_cast<int>(std::min(
+                numOccupiedLocations, static_cast<size_t>(maxLocationsToTry)));
+          }
+
+          continue;
+        }
+
+        const size_t freeRegionEnd =
+            reinterpret_cast<size_t>(memoryInfo.BaseAddress) + memoryInfo.RegionSize;
+        if ((proposedTrampolineStoreAddress +
+             static_cast<size_t>(TrampolineStore::kTrampolineStoreSizeBytes)) > freeRegionEnd)
+          continue;
+      }
+
+      TrampolineStore newTrampolineStore(reinterpret_cast<void*>(proposedTrampolineStoreAddress));
+      if (true == newTrampolineStore.IsInitialized())
+      {
+        const int newStoreIndex = static_cast<int>(trampolines.size());
+        nearModuleStores.storeIndices.push_back(newStoreIndex);
+        trampolineStoreIndices[newTrampolineStore.BaseAddress()] = trampolines.size();
+        trampolines.push_back(std::move(newTrampolineStore));
+        return newStoreIndex;
+      }
+    }
+
+    return -1;
+  }
+
+  void HookStore::SuggestTrampolineStoreLocation(
+      const void* originalFunc, void* trampolineStoreAddress)
+  {
+    void* const baseAddress = BaseAddressForOriginalFunc(originalFunc);
+    if (nullptr == baseAddress) return;
+
+    // A trampoline store at the suggested location must be able to reach the original function,
+    // just like one placed by searching backward from the module's base address.
+    const size_t storeAddress = reinterpret_cast<size_t>(trampolineStoreAddress);
+    if ((storeAddress >= reinterpret_cast<size_t>(baseAddress)) ||
+        ((reinterpret_cast<size_t>(baseAddress) - storeAddress) > kMaxTrampolineStoreDistanceBytes))
+      return;
+
+    std::unique_lock<std::shared_mutex> lock(hookStoreMutex);
+
+    SNearModuleStores& nearModuleStores = trampolineStoreMap[baseAddress];
+    if (false == nearModuleStores.storeIndices.empty()) return;
+
+    nearModuleStores.suggestedStoreAddress = trampolineStoreAddress;
+  }
+#endif
+
+  size_t HookStore::FindTrampolineStoreWithFreeSpace(
+      const int* storeIndices, size_t numStores, SFreeSpaceCursor& cursor)
+  {
+    while (true)
+    {
+      for (; cursor.position < numStores; ++cursor.position)
+      {
+        const size_t storeIndex =
+            ((nullptr == storeIndices) ? cursor.position
+                                       : static_cast<size_t>(storeIndices[cursor.position]));
+        if (true == trampolines[storeIndex].HasFreeSpace()) return storeIndex;
+      }
+
+      // Every store from the cursor onward is full. Earlier stores are worth looking at again only
+      // if space might have been given back to them since the last time.
+      const uint64_t deallocationCount = TrampolineStore::DeallocationCount();
+      if (deallocationCount == cursor.deallocationCount) break;
+
+      cursor.position = 0;
+      cursor.deallocationCount = deallocationCount;
+    }
+
+    return trampolines.size();
+  }
+
+  TrampolineStore* HookStore::FindTrampolineStore(const Trampoline* trampoline)
+  {
+    // Trampoline store buffers are reserved at multiples of their own size, so the base address
+    // of the buffer that holds any trampoline is obtained by masking its address.
+    const void* const storeBaseAddress = reinterpret_cast<const void*>(
+        reinterpret_cast<size_t>(trampoline) &
+        ~(static_cast<size_t>(TrampolineStore::kTrampolineStoreSizeBytes) - 1));
+
+    const auto storeIndexIter = trampolineStoreIndices.find(storeBaseAddress);
+    if (trampolineStoreIndices.end() == storeIndexIter) return nullptr;
+
+    return &trampolines[storeIndexIter->second];
+  }
+
+  const void* HookStore::OriginalFunctionForTrampoline(const Trampoline* trampoline)
+  {
+    const TrampolineStore* const trampolineStore = FindTrampolineStore(trampoline);
+    if (nullptr == trampolineStore) return nullptr;
+
+    return trampolineStore->SlotMetadata(trampoline).originalFunc;
+  }
+
+  void HookStore::SetOriginalFunctionForTrampoline(
+      const Trampoline* trampoline, const void* originalFunc)
+  {
+    TrampolineStore* const trampolineStore = FindTrampolineStore(trampoline);
+    if (nullptr == trampolineStore) return;
+
+    // A hook keeps its generation, and therefore its handle, for as long as it is registered.
+    TrampolineStore::SSlotMetadata& slotMetadata = trampolineStore->SlotMetadata(trampoline);
+    if ((nullptr == slotMetadata.originalFunc) && (nullptr != originalFunc))
+    {
+      lastHookGeneration += 1;
+      if (0 == lastHookGeneration) lastHookGeneration = 1;
+      slotMetadata.hookGeneration = lastHookGeneration;
+    }
+
+    slotMetadata.originalFunc = originalFunc;
+  }
+
+  HookHandle HookStore::HookHandleForTrampoline(const Trampoline* trampoline)
+  {
+    const TrampolineStore* const trampolineStore = FindTrampolineStore(trampoline);
+    if (nullptr == trampolineStore) return kInvalidHookHandle;
+
+    const TrampolineStore::SSlotMetadata& slotMetadata = trampolineStore->SlotMetadata(trampoline);
+    if (nullptr == slotMetadata.originalFunc) return kInvalidHookHandle;
+
+    const size_t storeIndex = static_cast<size_t>(trampolineStore - &trampolines[0]);
+    if (storeIndex >= kHookHandleMaxStores) return kInvalidHookHandle;
+
+    const size_t slotIndex = static_cast<size_t>(
+        (reinterpret_cast<const uint8_t*>(trampoline) -
+         reinterpret_cast<const uint8_t*>(trampolineStore->BaseAddress())) /
+        TrampolineStore::kTrampolineStoreAlignmentBytes);
+    if (slotIndex >= kHookHandleMaxSlots) return kInvalidHookHandle;
+
+    // Store indices are offset by 1 so that no valid handle is equal to the invalid handle.
+    return (
+        (static_cast<HookHandle>(slotMetadata.hookGeneration) << 32) |
+        (static_cast<HookHandle>(storeIndex + 1) << 16) | static_cast<HookHandle>(slotIndex));
+  }
+
+  Trampoline* HookStore::TrampolineForHookHandle(HookHandle handle)
+  {
+    const size_t storeIndexPlusOne = static_cast<size_t>((handle >> 16) & 0xffff);
+    const size_t slotIndex = static_cast<size_t>(handle & 0xffff);
+    const uint32_t hookGeneration = static_cast<uint32_t>(handle >> 32);
+
+    if ((0 == storeIndexPlusOne) || (storeIndexPlusOne > trampolines.size())) return nullptr;
+
+    const size_t slotOffset = slotIndex * TrampolineStore::kTrampolineStoreAlignmentBytes;
+    if ((slotOffset + sizeof(Trampoline)) >
+        static_cast<size_t>(TrampolineStore::kTrampolineStoreSizeBytes))
+      return nullptr;
+
+    const TrampolineStore& trampolineStore = trampolines[storeIndexPlusOne - 1];
+    if (false == trampolineStore.IsInitialized()) return nullptr;
+
+    Trampoline* const trampoline = reinterpret_cast<Trampoline*>(
+        reinterpret_cast<size_t>(trampolineStore.BaseAddress()) + slotOffset);
+
+    const TrampolineStore::SSlotMetadata& slotMetadata = trampolineStore.SlotMetadata(trampoline);
+    if ((nullptr == slotMetadata.originalFunc) || (hookGeneration != slotMetadata.hookGeneration))
+      return nullptr;
+
+    return trampoline;
+  }
+
+  void HookStore::DeallocateTrampoline(Trampoline* trampoline)
+  {
+    const auto stubIter = trampolineToInstrumentationStub.find(trampoline);
+    if (trampolineToInstrumentationStub.end() != stubIter)
+    {
+      TrampolineStore* const stubStore = FindTrampolineStore(stubIter->second);
+      if (nullptr != stubStore) stubStore->Deallocate(stubIter->second);
+
+      trampolineToInstrumentationStub.erase(stubIter);
+    }
+
+    // Sample blocks are never freed, so only the sampled timing stub itself is deallocated.
+    const auto sampledTimingIter = trampolineToSampledTiming.find(trampoline);
+    if (trampolineToSampledTiming.end() != sampledTimingIter)
+    {
+      TrampolineStore* const stubStore = FindTrampolineStore(sampledTimingIter->second.stub);
+      if (nullptr != stubStore) stubStore->Deallocate(sampledTimingIter->second.stub);
+
+      trampolineToSampledTiming.erase(sampledTimingIter);
+    }
+
+    trampolineToLatencyBudget.erase(trampoline);
+
+    const auto reentrancyGuardIter = trampolineToReentrancyGuard.find(trampoline);
+    if (trampolineToReentrancyGuard.end() != reentrancyGuardIter)
+    {
+      TrampolineStore* const stubStore = FindTrampolineStore(reentrancyGuardIter->second.stub);
+      if (nullptr != stubStore) stubStore->Deallocate(reentrancyGuardIter->second.stub);
+
+      trampolineToReentrancyGuard.erase(reentrancyGuardIter);
+    }
+
+    const auto callerFilterIter = trampolineToCallerFilter.find(trampoline);
+    if (trampolineToCallerFilter.end() != callerFilterIter)
+    {
+      TrampolineStore* const stubStore = FindTrampolineStore(callerFilterIter->second.stub);
+      if (nullptr != stubStore) stubStore->Deallocate(callerFilterIter->second.stub);
+
+      trampolineToCallerFilter.erase(callerFilterIter);
+    }
+
+    // Thread override stubs are never deallocated because threads might still be executing them.
+    trampolineToThreadOverride.erase(trampoline);
+
+#ifdef _WIN64
+    const auto codeCaveStubIter = trampolineToCodeCaveStub.find(trampoline);
+    if (trampolineToCodeCaveStub.end() != codeCaveStubIter)
+    {
+      CodeCaves::Deallocate(codeCaveStubIter->second);
+      trampolineToCodeCaveStub.erase(codeCaveStubIter);
+    }
+#endif
+
+    TrampolineStore* const trampolineStore = FindTrampolineStore(trampoline);
+    if (nullptr != trampolineStore)
+    {
+      const auto hookStubIter = trampolineToHookStub.find(trampoline);
+      if (trampolineToHookStub.end() != hookStubIter)
+      {
+        trampolineStore->DeallocateHookStub(hookStubIter->second);
+        trampolineToHookStub.erase(hookStubIter);
+      }
+
+      trampolineStore->Deallocate(trampoline);
+    }
+  }
+
+  void HookStore::SegregateHookStub(Trampoline* trampoline)
+  {
+    TrampolineStore* const trampolineStore = FindTrampolineStore(trampoline);
+    if (nullptr == trampolineStore) return;
+
+    Trampoline::UHookCode* const hookStub = trampolineStore->AllocateHookStub();
+    if (nullptr == hookStub)
+    {
+      MappedLog::OutputFormatted(
+          Infra::Message::ESeverity::Debug,
+          L"Trampoline at 0x%llx is used directly because a hook stub could not be allocated.",
+          (long long)trampoline);
+      return;
+    }
+
+    Trampoline::SetHookCodeTarget(hookStub, trampoline->GetHookTrampolineTarget());
+    trampolineToHookStub[trampoline] = hookStub;
+  }
+
+  const void* HookStore::HookEntryForTrampoline(const Trampoline* trampoline)
+  {
+#ifdef _WIN64
+    const auto codeCaveStubIter = trampolineToCodeCaveStub.find(trampoline);
+    if (trampolineToCodeCaveStub.end() != codeCaveStubIter) return codeCaveStubIter->second;
+#endif
+
+    const auto hookStubIter = trampolineToHookStub.find(trampoline);
+    if (trampolineToHookStub.end() != hookStubIter) return hookStubIter->second;
+
+    return trampoline->GetHookFunction();
+  }
+
+  Trampoline::SInstrumentationCounterShard* HookStore::AllocateInstrumentationCounterShards(void)
+  {
+    const size_t numCounterShards = Trampoline::GetNumInstrumentationCounterShards();
+    instrumentationCounterShardBytes +=
+        (numCounterShards * sizeof(Trampoline::SInstrumentationCounterShard));
+
+    return new Trampoline::SInstrumentationCounterShard[numCounterShards]();
+  }
+
+  void HookStore::InstrumentTrampoline(
+      void* originalFunc, const void* hookFunc, Trampoline* trampoline)
+  {
+    TrampolineStore* stubStore = nullptr;
+    Trampoline* stub = nullptr;
+
+    if (false == SuccessfulResult(AllocateTrampoline(originalFunc, &stubStore, &stub)))
+    {
+      Infra::Message::OutputFormatted(
+          Infra::Message::ESeverity::Warning,
+          L"Hook for original function at 0x%llx is not instrumented because an instrumentation stub could not be allocated.",
+          (long long)originalFunc);
+      return;
+    }
+
+    stub->SetInstrumentationStub(hookFunc, AllocateInstrumentationCounterShards());
+    trampoline->SetHookFunction(stub->GetHookFunction());
+    trampolineToInstrumentationStub[trampoline] = stub;
+  }
+
+  void HookStore::SampleTrampoline(
+      void* originalFunc, const void* hookFunc, Trampoline* trampoline, uint32_t sampleInterval)
+  {
+    const void* const sampler = SampledTiming::GetSampler();
+    if (nullptr == sampler) return;
+
+    TrampolineStore* stubStore = nullptr;
+    Trampoline* stub = nullptr;
+
+    if (false == SuccessfulResult(AllocateTrampoline(originalFunc, &stubStore, &stub)))
+    {
+      Infra::Message::OutputFormatted(
+          Infra::Message::ESeverity::Warning,
+          L"Hook for original function at 0x%llx is not timed because a sampled timing stub could not be allocated.",
+          (long long)originalFunc);
+      return;
+    }
+
+    SampledTiming::SSampleBlock* const sampleBlock = SampledTiming::AllocateSampleBlock();
+    stub->SetSampledTimingStub(sampler, sampleInterval, sampleBlock, hookFunc);
+    trampoline->SetHookFunction(stub->GetHookFunction());
+    trampolineToSampledTiming[trampoline] = {
+        .stub = stub, .sampleBlock = sampleBlock, .sampleInterval = sampleInterval};
+
+    const uint32_t hookLatencyBudgetMicroseconds = GetHookLatencyBudgetMicroseconds();
+    if (0 != hookLatencyBudgetMicroseconds)
+    {
+      trampolineToLatencyBudget[trampoline] = {
+          .budgetMicroseconds = hookLatencyBudgetMicroseconds, .numChecksOverBudget = 0};
+      LatencyBudget::ScheduleCheck();
+    }
+  }
+
+  const void* HookStore::HookFunctionForTrampoline(Trampoline* trampoline)
+  {
+    // Within a chain, the innermost trampoline transfers control to the outermost hook function,
+    // so the chain itself is the only record of which hook function belongs to which trampoline.
+    if (false == hookChains.empty())
+    {
+      const void* const originalFunc = OriginalFunctionForTrampoline(trampoline);
+      if (nullptr != originalFunc)
+      {
+        const auto chainIter = hookChains.find(originalFunc);
+        if (hookChains.end() != chainIter)
+        {
+          for (const auto& chainedHook : chainIter->second)
+          {
+            if (trampoline == chainedHook.trampoline) return chainedHook.hookFunc;
+          }
+        }
+      }
+    }
+
+    const auto threadOverrideIter = trampolineToThreadOverride.find(trampoline);
+    if (trampolineToThreadOverride.end() != threadOverrideIter)
+      return threadOverrideIter->second.stub->GetThreadOverrideStubHookTarget();
+
+    const auto sampledTimingIter = trampolineToSampledTiming.find(trampoline);
+    if (trampolineToSampledTiming.end() != sampledTimingIter)
+      return sampledTimingIter->second.stub->GetSampledTimingStubTarget();
+
+    const auto stubIter = trampolineToInstrumentationStub.find(trampoline);
+    if (trampolineToInstrumentationStub.end() != stubIter)
+      return stubIter->second->GetInstrumentationStubTarget();
+
+    const auto callerFilterIter = trampolineToCallerFilter.find(trampoline);
+    if (trampolineToCallerFilter.end() != callerFilterIter)
+      return callerFilterIter->second.stub->GetCallerFilterStubHookTarget();
+
+    const auto reentrancyGuardIter = trampolineToReentrancyGuard.find(trampoline);
+    if (trampolineToReentrancyGuard.end() != reentrancyGuardIter)
+      return reentrancyGuardIter->second.stub->GetReentrancyGuardStubHookTarget();
+
+    return trampoline->GetHookTrampolineTarget();
+  }
+
+  bool HookStore::RetargetTrampoline(Trampoline* trampoline, const void* hookFunc)
+  {
+    // Instrumented hooks keep their instrumentation stubs and therefore their invocation counts,
+    // and timed hooks likewise keep their histograms. Reentrancy guard stubs, caller filter stubs,
+    // and instrumentation stubs sit in front of sampled timing stubs, in that order, so only the
+    // one closest to the hook function needs to be changed. Thread override stubs sit behind all of
+    // them, so if there is one, it is the only one that needs to be changed.
+    const auto threadOverrideIter = trampolineToThreadOverride.find(trampoline);
+    if (trampolineToThreadOverride.end() != threadOverrideIter)
+    {
+      if (false == TrampolineStore::MakeWritable(threadOverrideIter->second.stub)) return false;
+      threadOverrideIter->second.stub->SetThreadOverrideStubTarget(hookFunc);
+      return true;
+    }
+
+    const auto sampledTimingIter = trampolineToSampledTiming.find(trampoline);
+    const auto stubIter = trampolineToInstrumentationStub.find(trampoline);
+    const auto callerFilterIter = trampolineToCallerFilter.find(trampoline);
+    const auto reentrancyGuardIter = trampolineToReentrancyGuard.find(trampoline);
+    if (trampolineToSampledTiming.end() != sampledTimingIter)
+    {
+      if (false == TrampolineStore::MakeWritable(sampledTimingIter->second.stub)) return false;
+      sampledTimingIter->second.stub->SetSampledTimingStubTarget(hookFunc);
+    }
+    else if (trampolineToInstrumentationStub.end() != stubIter)
+    {
+      if (false == TrampolineStore::MakeWritable(stubIter->second)) return false;
+      stubIter->second->SetInstrumentationStubTarget(hookFunc);
+    }
+    else if (trampolineToCallerFilter.end() != callerFilterIter)
+    {
+      if (false == UpdateCallerFilterStub(trampoline, callerFilterIter->second, hookFunc))
+        return false;
+    }
+    else if (trampolineToReentrancyGuard.end() != reentrancyGuardIter)
+    {
+      if (false == UpdateReentrancyGuardStub(trampoline, reentrancyGuardIter->second, hookFunc))
+        return false;
+    }
+    else
+    {
+      if (false == TrampolineStore::MakeWritable(trampoline)) return false;
+      trampoline->SetHookFunction(hookFunc);
+
+      // The hook stub, if there is one, is what actually executes, but it always mirrors the hook
+      // region of the trampoline.
+      const auto hookStubIter = trampolineToHookStub.find(trampoline);
+      if (trampolineToHookStub.end() != hookStubIter)
+      {
+        if (false == TrampolineStore::MakeWritable(hookStubIter->second)) return false;
+        Trampoline::SetHookCodeTarget(hookStubIter->second, hookFunc);
+      }
+    }
+
+    return true;
+  }
+
+  bool HookStore::UpdateReentrancyGuardStub(
+      const Trampoline* trampoline,
+      const SReentrancyGuard& reentrancyGuard,
+      const void* hookFunc)
+  {
+    if (false == TrampolineStore::MakeWritable(reentrancyGuard.stub)) return false;
+
+    reentrancyGuard.stub->SetReentrancyGuardStubTargets(
+        hookFunc,
+        ((true == reentrancyGuard.enabled) ? trampoline->GetOriginalFunction() : hookFunc));
+    return true;
+  }
+
+  bool HookStore::UpdateCallerFilterStub(
+      const Trampoline* trampoline, const SCallerFilter& callerFilter, const void* hookFunc)
+  {
+    if (false == TrampolineStore::MakeWritable(callerFilter.stub)) return false;
+
+    callerFilter.stub->SetCallerFilterStubTargets(
+        hookFunc, ((true == callerFilter.enabled) ? trampoline->GetOriginalFunction() : hookFunc));
+    return true;
+  }
+
+  const void* HookStore::RedirectTargetForHook(
+      const void* originalFunc, const void* hookFunc, Trampoline* trampoline)
+  {
+    // Instrumented, timed, reentrancy-guarded, caller-filtered, and thread-overridden hooks need
+    // execution to pass through their stubs, and hooks created within a transaction can be
+    // replaced before their original functions are modified.
+    // Otherwise, the only requirements are that the jump can reach the hook function and can later
+    // be changed atomically.
+    const void* const jumpSite =
+        JumpSiteForOriginalFunction(originalFunc, (0 != hotPatchedFunctions.count(originalFunc)));
+    if ((false == IsDirectHookJumpEnabled()) ||
+        (0 != trampolineToInstrumentationStub.count(trampoline)) ||
+        (0 != trampolineToSampledTiming.count(trampoline)) ||
+        (0 != trampolineToReentrancyGuard.count(trampoline)) ||
+        (0 != trampolineToCallerFilter.count(trampoline)) ||
+        (0 != trampolineToThreadOverride.count(trampoline)) ||
+        (true == IsTransactionOwnedByCurrentThread()) ||
+        (0 == AtomicBlockSizeForJump(jumpSite)) ||
+        (false == X86Instruction::CanWriteJumpInstruction(jumpSite, hookFunc)))
+      return HookEntryForTrampoline(trampoline);
+
+    return hookFunc;
+  }
+
+  bool HookStore::RetargetHook(
+      const void* originalFunc, Trampoline* trampoline, const void* hookFunc)
+  {
+    if (false == RetargetTrampoline(trampoline, hookFunc)) return false;
+
+    // Original functions belonging to hooks in the open transaction have not yet been modified.
+    // Once they are, they will jump to the trampolines that were just retargeted.
+    if (true == IsRedirectPending(originalFunc)) return true;
+
+    void* const from = const_cast<void*>(originalFunc);
+
+    // Targeting the trampoline's own original function region means the hook is being disabled.
+    // Restoring the original function instead removes the trampoline from the path entirely. If
+    // this is not possible, the trampoline that was just retargeted still works.
+    if (hookFunc == trampoline->GetOriginalFunction())
+    {
+      const auto prologueIter = originalFunctionPrologues.find(originalFunc);
+      if ((originalFunctionPrologues.end() != prologueIter) &&
+          (true == WriteJumpBytesAtomically(from, prologueIter->second.data())))
+      {
+        directlyRedirectedFunctions.erase(originalFunc);
+        unhookedFunctions.insert(originalFunc);
+        return true;
+      }
+    }
+
+    const bool wasUnhooked = (0 != unhookedFunctions.count(originalFunc));
+    const bool wasDirectlyRedirected = (0 != directlyRedirectedFunctions.count(originalFunc));
+    if ((false == wasUnhooked) && (false == wasDirectlyRedirected)) return true;
+
+    const bool isHotPatch = (0 != hotPatchedFunctions.count(originalFunc));
+    const void* const redirectTarget = RedirectTargetForHook(originalFunc, hookFunc, trampoline);
+    if (false == RedirectExecutionAtomically(from, redirectTarget, isHotPatch))
+    {
+      if (true == wasUnhooked) return false;
+
+      // If the new hook function is out of range, the original function goes back to jumping to
+      // the trampoline.
+      directlyRedirectedFunctions.erase(originalFunc);
+      return RedirectExecutionAtomically(from, HookEntryForTrampoline(trampoline), isHotPatch);
+    }
+
+    unhookedFunctions.erase(originalFunc);
+    if (hookFunc == redirectTarget)
+      directlyRedirectedFunctions.insert(originalFunc);
+    else
+      directlyRedirectedFunctions.erase(originalFunc);
+
+    return true;
+  }
+
+  bool HookStore::IsRedirectPending(const void* originalFunc)
+  {
+    for (const auto& transactionRedirect : transactionRedirects)
+    {
+      if (originalFunc == transactionRedirect.from) return true;
+    }
+
+    return false;
+  }
+
+  void HookStore::SaveOriginalFunctionPrologue(const void* originalFunc)
+  {
+    static_assert(
+        kOriginalFunctionPrologueSizeBytes ==
+            static_cast<size_t>(X86Instruction::kJumpInstructionLengthBytes),
+        "Original function prologue size must match the jump instruction length.");
+
+    std::memcpy(
+        originalFunctionPrologues[originalFunc].data(),
+        originalFunc,
+        kOriginalFunctionPrologueSizeBytes);
+
+    if (true == X86Instruction::IsHotPatchable(originalFunc))
+      hotPatchedFunctions.insert(originalFunc);
+  }
+
+  bool HookStore::IsHookedOriginalFunction(const void* func)
+  {
+    const auto trampolineIter = functionToTrampoline.find(func);
+    if (functionToTrampoline.end() == trampolineIter) return false;
+
+    return (func == OriginalFunctionForTrampoline(trampolineIter->second));
+  }
+
+  void* HookStore::ResolveJumpThunks(void* originalFunc)
+  {
+    if (false == IsJumpThunkFollowingEnabled()) return originalFunc;
+
+    void* resolvedFunc = originalFunc;
+    for (int i = 0; i < kMaxJumpThunksFollowed; ++i)
+    {
+      if ((0 != functionToTrampoline.count(resolvedFunc)) ||
+          (0 != reservedFunctions.count(resolvedFunc)))
+        break;
+
+      void* const thunkTarget = X86Instruction::GetJumpThunkTarget(resolvedFunc);
+      if (nullptr == thunkTarget) break;
+
+      // Import address table entries redirected by address table hooks point to hook functions.
+      if (nullptr != AddressTableHooks::GetOriginalFunction(thunkTarget)) break;
+
+#ifndef HOOKSHOT_STATIC_LIBRARY
+      // Nothing in Hookshot itself can be hooked.
+      if (BaseAddressForOriginalFunc(thunkTarget) ==
+          Infra::ProcessInfo::GetThisModuleInstanceHandle())
+        break;
+#endif
+
+      resolvedFunc = thunkTarget;
+    }
+
+    return resolvedFunc;
+  }
+
+  const void* HookStore::ResolveJumpThunkAlias(const void* func)
+  {
+    if (true == jumpThunkTargets.empty()) return func;
+
+    const auto thunkTargetIter = jumpThunkTargets.find(func);
+    if (jumpThunkTargets.end() == thunkTargetIter) return func;
+
+    return thunkTargetIter->second;
+  }
+
+  bool HookStore::BindCallTraceStub(const void* hookFunc, const Trampoline* trampoline)
+  {
+    if (true == callTraceStubs.empty()) return true;
+
+    const auto stubIter = callTraceStubs.find(hookFunc);
+    if (callTraceStubs.end() == stubIter) return true;
+
+    if (false == TrampolineStore::MakeWritable(stubIter->second)) return false;
+    stubIter->second->SetCallTraceStubTarget(trampoline->GetOriginalFunction());
+    return true;
+  }
+
+  bool HookStore::BindOneShotStub(const void* hookFunc, const Trampoline* trampoline)
+  {
+    if (true == oneShotHooks.empty()) return true;
+
+    const auto oneShotHookIter = oneShotHooks.find(hookFunc);
+    if (oneShotHooks.end() == oneShotHookIter) return true;
+
+    Trampoline* const stub = oneShotHookIter->second.stub;
+    if (false == TrampolineStore::MakeWritable(stub)) return false;
+    stub->SetOneShotStubBypass(trampoline->GetOriginalFunction());
+    return true;
+  }
+
+  bool HookStore::BindSampledHookStub(const void* hookFunc, const Trampoline* trampoline)
+  {
+    if (true == sampledHooks.empty()) return true;
+
+    const auto sampledHookIter = sampledHooks.find(hookFunc);
+    if (sampledHooks.end() == sampledHookIter) return true;
+
+    Trampoline* const stub = sampledHookIter->second.stub;
+    if (false == TrampolineStore::MakeWritable(stub)) return false;
+    stub->SetSampledHookStubBypass(trampoline->GetOriginalFunction());
+    return true;
+  }
+
+  EResult HookStore::ChainHook(void* originalFunc, const void* hookFunc)
+  {
+    // Only original functions can have hooks chained onto them. Hooking a hook function is not
+    // allowed, chained or otherwise.
+    if (false == IsHookedOriginalFunction(originalFunc)) return EResult::FailDuplicate;
+    if (true == IsFunctionInUse(hookFunc)) return EResult::FailDuplicate;
+
+    // Export counter stubs only get their targets when they become the instrumentation stubs of
+    // innermost trampolines, so exports that are already hooked cannot be instrumented.
+    if (0 != exportCounterStubs.count(hookFunc)) return EResult::FailDuplicate;
+
+    Trampoline* const innermostTrampoline = functionToTrampoline.at(originalFunc);
+    const auto chainIter = hookChains.find(originalFunc);
+    const void* const outermostHookFunc = ((hookChains.end() != chainIter)
+                                               ? chainIter->second.front().hookFunc
+                                               : HookFunctionForTrampoline(innermostTrampoline));
+
+    TrampolineStore* trampolineStore = nullptr;
+    Trampoline* trampoline = nullptr;
+
+    // Chained trampolines only ever jump using absolute addresses, so they can be placed anywhere
+    // if there is no space near the original function.
+    EResult allocateResult = AllocateTrampoline(originalFunc, &trampolineStore, &trampoline, true);
+#ifdef _WIN64
+    if (EResult::FailAllocation == allocateResult)
+      allocateResult = AllocateFarTrampoline(&trampolineStore, &trampoline);
+#endif
+    if (false == SuccessfulResult(allocateResult)) return allocateResult;
+
+    // The new trampoline's hook region is never executed because the innermost trampoline is the
+    // one that the original function jumps to. It is set anyway for consistency.
+    trampoline->SetHookFunction(hookFunc);
+    trampoline->SetChainTarget(outermostHookFunc);
+    if ((false == BindCallTraceStub(hookFunc, trampoline)) ||
+        (false == BindOneShotStub(hookFunc, trampoline)) ||
+        (false == BindSampledHookStub(hookFunc, trampoline)))
+    {
+      trampolineStore->Deallocate(trampoline);
+      return EResult::FailInternal;
+    }
+
+    RegisterTrampolineCallTargets();
+
+    // This is the step that makes the new hook live. Everything it depends on is already written.
+    if (false == RetargetHook(originalFunc, innermostTrampoline, hookFunc))
+    {
+      trampolineStore->Deallocate(trampoline);
+      return EResult::FailInternal;
+    }
+
+    std::vector<SChainedHook>& chain = hookChains[originalFunc];
+    if (true == chain.empty())
+      chain.push_back({.hookFunc = outermostHookFunc, .trampoline = innermostTrampoline});
+    chain.insert(chain.begin(), {.hookFunc = hookFunc, .trampoline = trampoline});
+
+    functionToTrampoline[hookFunc] = trampoline;
+    SetOriginalFunctionForTrampoline(trampoline, originalFunc);
+    functionToTrampolineLookup.Insert(hookFunc, trampoline);
+
+    Infra::Message::OutputFormatted(
+        Infra::Message::ESeverity::Info,
+        L"Chained hook function 0x%llx onto original function 0x%llx, which now has %llu hooks.",
+        (long long)hookFunc,
+        (long long)originalFunc,
+        (unsigned long long)chain.size());
+
+    return EResult::Success;
+  }
+
+  EResult HookStore::PrepareTrampoline(
+      void* originalFunc,
+      const void* hookFunc,
+      const Trampoline::SDecodedOriginalFunction* decoded,
+      TrampolineStore** trampolineStoreOut,
+      Trampoline** trampolineOut,
+      const bool canUseFarTrampoline)
+  {
+    TrampolineStore* trampolineStore = nullptr;
+    Trampoline* trampoline = nullptr;
+
+    const EResult allocateResult =
+        AllocateTrampoline(originalFunc, &trampolineStore, &trampoline, canUseFarTrampoline);
+    if (false == SuccessfulResult(allocateResult)) return allocateResult;
+
+    trampoline->SetHookFunction(hookFunc);
+
+    size_t trampolineSizeBytesUsed = 0;
+    if (false ==
+        SetTrampolineOriginalFunction(trampoline, originalFunc, decoded, &trampolineSizeBytesUsed))
+    {
+      Infra::Message::OutputFormatted(
+          Infra::Message::ESeverity::Info,
+          L"Failed to set up a trampoline for original function at 0x%llx.",
+          (long long)originalFunc);
+
+      trampolineStore->Deallocate(trampoline);
+      return EResult::FailCannotSetHook;
+    }
+
+    *trampolineStoreOut =
+        CompleteTrampoline(originalFunc, hookFunc, trampoline, trampolineSizeBytesUsed);
+    *trampolineOut = trampoline;
+    return EResult::Success;
+  }
+
+  TrampolineStore* HookStore::CompleteTrampoline(
+      void* originalFunc,
+      const void* hookFunc,
+      Trampoline* trampoline,
+      size_t trampolineSizeBytesUsed)
+  {
+    // Most transplanted code is much shorter than the space available for it, so the rest of the
+    // trampoline is given back to its store.
+    TrampolineStore* trampolineStore = FindTrampolineStore(trampoline);
+    trampolineStore->Compact(trampoline, trampolineSizeBytesUsed);
+
+#ifdef _WIN64
+    // Profilers and exception dispatch walk the stack through trampolines, which they can only do
+    // quickly and correctly if the trampolines are in a function table. Transplanted prologue
+    // instructions in particular change the stack before the original function's own unwind
+    // information takes over.
+    trampolineStore->RegisterUnwindInfo(trampoline, originalFunc, trampolineSizeBytesUsed);
+#endif
+
+    // An export counter stub is the hook function of an instrumented export only until now. From
+    // here on it is the instrumentation stub, and what it forwards to is the original function
+    // region of the trampoline, so calls reach the original function once they are counted.
+    uint32_t hookTimingSampleInterval = GetHookTimingSampleInterval();
+    Trampoline* exportCounterStub = nullptr;
+
+    const auto exportCounterStubIter = exportCounterStubs.find(hookFunc);
+    if (exportCounterStubs.end() != exportCounterStubIter)
+    {
+      exportCounterStub = exportCounterStubIter->second.stub;
+      if (0 != exportCounterStubIter->second.sampleInterval)
+        hookTimingSampleInterval = exportCounterStubIter->second.sampleInterval;
+      exportCounterStubs.erase(exportCounterStubIter);
+
+      hookFunc = trampoline->GetOriginalFunction();
+      trampoline->SetHookFunction(hookFunc);
+    }
+
+    // Allocating a sampled timing stub or an instrumentation stub can add a new trampoline store,
+    // which in turn can move all of the existing ones. The sampled timing stub is closest to the
+    // hook function, so an instrumentation stub targets whatever the trampoline targets by then.
+    if (0 != hookTimingSampleInterval)
+    {
+      SampleTrampoline(originalFunc, hookFunc, trampoline, hookTimingSampleInterval);
+      trampolineStore = FindTrampolineStore(trampoline);
+    }
+
+    if (nullptr != exportCounterStub)
+    {
+      if (true == TrampolineStore::MakeWritable(exportCounterStub))
+      {
+        exportCounterStub->SetInstrumentationStubTarget(trampoline->GetHookTrampolineTarget());
+        trampoline->SetHookFunction(exportCounterStub->GetHookFunction());
+        trampolineToInstrumentationStub[trampoline] = exportCounterStub;
+      }
+      else
+      {
+        Infra::Message::OutputFormatted(
+            Infra::Message::ESeverity::Warning,
+            L"Export at 0x%llx is not instrumented because its export counter stub could not be made writable.",
+            (long long)originalFunc);
+      }
+    }
+    else if (true == IsHookInstrumentationEnabled())
+    {
+      InstrumentTrampoline(originalFunc, trampoline->GetHookTrampolineTarget(), trampoline);
+      trampolineStore = FindTrampolineStore(trampoline);
+    }
+
+    // The hook stub is set up last so that it can mirror the final contents of the hook region of
+    // the trampoline, which might target an instrumentation stub.
+    if (true == IsHookStubSegregationEnabled()) SegregateHookStub(trampoline);
+
+    return trampolineStore;
+  }
+
+  void HookStore::RegisterHook(
+      const void* originalFunc,
+      const void* hookFunc,
+      Trampoline* trampoline,
+      const void* redirectTarget)
+  {
+    if (hookFunc == redirectTarget) directlyRedirectedFunctions.insert(originalFunc);
+
+    functionToTrampoline[originalFunc] = trampoline;
+    functionToTrampoline[hookFunc] = trampoline;
+    SetOriginalFunctionForTrampoline(trampoline, originalFunc);
+
+    functionToTrampolineLookup.Insert(originalFunc, trampoline);
+    functionToTrampolineLookup.Insert(hookFunc, trampoline);
+  }
+
+  void HookStore::RegisterTrampolineCallTargets(void)
+  {
+    // Only stores that actually have something to register are visited, so that the cost of
+    // creating a hook does not grow with the number of stores.
+    for (const void* const storeBaseAddress : TrampolineStore::TakeBuffersWithPendingCallTargets())
+    {
+      const auto storeIndexIter = trampolineStoreIndices.find(storeBaseAddress);
+      if (trampolineStoreIndices.end() != storeIndexIter)
+        trampolines[storeIndexIter->second].RegisterCallTargets();
+    }
+  }
+
+  void HookStore::UnregisterHook(Trampoline* trampoline)
+  {
+    const void* const originalFunc = OriginalFunctionForTrampoline(trampoline);
+    if (nullptr == originalFunc) return;
+
+    directlyRedirectedFunctions.erase(originalFunc);
+    originalFunctionPrologues.erase(originalFunc);
+#ifdef _WIN64
+    absoluteJumpPrologues.erase(originalFunc);
+#endif
+    unhookedFunctions.erase(originalFunc);
+    hotPatchedFunctions.erase(originalFunc);
+
+    if (false == jumpThunkTargets.empty())
+      std::erase_if(
+          jumpThunkTargets,
+          [originalFunc](const auto& thunkAndTarget) -> bool
+          { return (originalFunc == thunkAndTarget.second); });
+
+    const auto chainIter = hookChains.find(originalFunc);
+    if (hookChains.end() != chainIter)
+    {
+      for (const auto& chainedHook : chainIter->second)
+      {
+        trampolineToHookGroup.erase(chainedHook.trampoline);
+        functionToTrampoline.erase(chainedHook.hookFunc);
+        SetOriginalFunctionForTrampoline(chainedHook.trampoline, nullptr);
+        functionToTrampolineLookup.Erase(chainedHook.hookFunc);
+      }
+
+      hookChains.erase(chainIter);
+      functionToTrampoline.erase(originalFunc);
+      functionToTrampolineLookup.Erase(originalFunc);
+      return;
+    }
+
+    const void* const hookFunc = HookFunctionForTrampoline(trampoline);
+
+    trampolineToHookGroup.erase(trampoline);
+    functionToTrampoline.erase(originalFunc);
+    functionToTrampoline.erase(hookFunc);
+    SetOriginalFunctionForTrampoline(trampoline, nullptr);
+
+    functionToTrampolineLookup.Erase(originalFunc);
+    functionToTrampolineLookup.Erase(hookFunc);
+  }
+
+  void HookStore::RetireTrampolines(const std::vector<SChainedHook>& chainedHooks)
+  {
+    for (const auto& chainedHook : chainedHooks)
+    {
+      const auto stubIter = trampolineToInstrumentationStub.find(chainedHook.trampoline);
+      const auto sampledTimingIter = trampolineToSampledTiming.find(chainedHook.trampoline);
+      const auto reentrancyGuardIter = trampolineToReentrancyGuard.find(chainedHook.trampoline);
+      const auto callerFilterIter = trampolineToCallerFilter.find(chainedHook.trampoline);
+      const auto hookStubIter = trampolineToHookStub.find(chainedHook.trampoline);
+#ifdef _WIN64
+      const auto codeCaveStubIter = trampolineToCodeCaveStub.find(chainedHook.trampoline);
+      const void* const codeCaveStub =
+          ((trampolineToCodeCaveStub.end() != codeCaveStubIter) ? codeCaveStubIter->second
+                                                                : nullptr);
+#else
+      const void* const codeCaveStub = nullptr;
+#endif
+
+      retiredTrampolines.push_back(
+          {.trampoline = chainedHook.trampoline,
+           .instrumentationStub =
+               ((trampolineToInstrumentationStub.end() != stubIter) ? stubIter->second : nullptr),
+           .sampledTimingStub =
+               ((trampolineToSampledTiming.end() != sampledTimingIter)
+                    ? sampledTimingIter->second.stub
+                    : nullptr),
+           .reentrancyGuardStub =
+               ((trampolineToReentrancyGuard.end() != reentrancyGuardIter)
+                    ? reentrancyGuardIter->second.stub
+                    : nullptr),
+           .callerFilterStub =
+               ((trampolineToCallerFilter.end() != callerFilterIter)
+                    ? callerFilterIter->second.stub
+                    : nullptr),
+           .hookStub =
+               ((trampolineToHookStub.end() != hookStubIter) ? hookStubIter->second : nullptr),
+           .codeCaveStub = codeCaveStub,
+           .retiredEpoch = reclamationEpoch,
+           .executing = false});
+    }
+  }
+
+  void HookStore::MarkExecutingRetiredTrampolines(const std::vector<HANDLE>& threads)
+  {
+    for (auto& retiredTrampoline : retiredTrampolines)
+      retiredTrampoline.executing = false;
+
+    auto isWithin = [](const size_t address, const void* begin, const size_t sizeBytes) -> bool
+    {
+      return (
+          (nullptr != begin) && (address >= reinterpret_cast<size_t>(begin)) &&
+          (address < (reinterpret_cast<size_t>(begin) + sizeBytes)));
+    };
+
+    // A thread still needs a retired trampoline not only while executing it but also while it can
+    // return into it. Transplanted relative calls, as well as the reentrancy guard and caller
+    // filter stubs, leave return addresses within trampolines on the stack while the code they
+    // call runs.
+    auto markRetiredTrampolinesInUseAt = [&isWithin](const size_t address) -> bool
+    {
+      const bool isWithinSampler = SampledTiming::IsWithinSampler(address);
+      for (auto& retiredTrampoline : retiredTrampolines)
+      {
+        if (retiredTrampoline.retiredEpoch >= reclamationEpoch) continue;
+
+        if (isWithin(address, retiredTrampoline.trampoline, sizeof(Trampoline)) ||
+            isWithin(address, retiredTrampoline.instrumentationStub, sizeof(Trampoline)) ||
+            isWithin(address, retiredTrampoline.sampledTimingStub, sizeof(Trampoline)) ||
+            ((nullptr != retiredTrampoline.sampledTimingStub) && (true == isWithinSampler)) ||
+            isWithin(address, retiredTrampoline.reentrancyGuardStub, sizeof(Trampoline)) ||
+            isWithin(address, retiredTrampoline.callerFilterStub, sizeof(Trampoline)) ||
+            isWithin(address, retiredTrampoline.hookStub, sizeof(Trampoline::UHookCode)) ||
+            isWithin(address, retiredTrampoline.codeCaveStub, CodeCaves::kCaveSizeBytes))
+          retiredTrampoline.executing = true;
+      }
+
+      return false;
+    };
+
+    for (const HANDLE thread : threads)
+    {
+      // A thread whose state cannot be retrieved might be anywhere, so it is assumed to be using
+      // all of the retired trampolines.
+      if (false == VisitPossibleCodeAddressesOfThread(thread, markRetiredTrampolinesInUseAt))
+      {
+        for (auto& retiredTrampoline : retiredTrampolines)
+          retiredTrampoline.executing = true;
+      }
+    }
+  }
+
+  size_t HookStore::ReclaimRetiredTrampolines(void)
+  {
+    size_t numReclaimed = 0;
+    size_t numRemaining = 0;
+
+    for (size_t i = 0; i < retiredTrampolines.size(); ++i)
+    {
+      const SRetiredTrampoline& retiredTrampoline = retiredTrampolines[i];
+      if ((retiredTrampoline.retiredEpoch < reclamationEpoch) &&
+          (false == retiredTrampoline.executing))
+      {
+        DeallocateTrampoline(retiredTrampoline.trampoline);
+        numReclaimed += 1;
+      }
+      else
+      {
+        retiredTrampolines[numRemaining++] = retiredTrampoline;
+      }
+    }
+
+    retiredTrampolines.resize(numRemaining);
+    return numReclaimed;
+  }
+
+  void HookStore::IdentifyPatchSites(void)
+  {
+    const size_t pageSize =
+        static_cast<size_t>(Infra::SystemInfo::GetPlatformAndArchitectureInfo().dwPageSize);
+
+    patchSites.windows.clear();
+    patchSites.expectedBytes.clear();
+    patchSites.masks.clear();
+    patchSiteRedirects.clear();
+    patchSiteModules.clear();
+
+    for (const auto& functionAndTrampoline : functionToTrampoline)
+    {
+      // Original functions map to their innermost trampolines, which are the ones they jump to.
+      // Disabled hooks and hooks in the open transaction have nothing written to check.
+      void* const originalFunc = const_cast<void*>(functionAndTrampoline.first);
+      Trampoline* const trampoline = functionAndTrampoline.second;
+      if ((originalFunc != OriginalFunctionForTrampoline(trampoline)) ||
+          (0 != unhookedFunctions.count(originalFunc)) || (true == IsRedirectPending(originalFunc)))
+        continue;
+
+#ifdef _WIN64
+      // Absolute jumps do not fit in a window, so they are not monitored.
+      if (0 != absoluteJumpPrologues.count(originalFunc)) continue;
+#endif
+
+      // Memory outside of any loaded module could be freed at any time without notice.
+      const HMODULE moduleHandle = ModuleForAddress(originalFunc);
+      if (nullptr == moduleHandle) continue;
+
+      const bool isHotPatch = (0 != hotPatchedFunctions.count(originalFunc));
+      const auto patchedRange = PatchedRangeForOriginalFunction(originalFunc, isHotPatch);
+
+      const uint8_t* window = nullptr;
+      uint64_t mask = 0;
+      if (false ==
+          HookIntegrity::WindowForPatchedRange(
+              patchedRange.first, patchedRange.second, pageSize, &window, &mask))
+        continue;
+
+      // A direct redirection targets whatever the trampoline itself would transfer control to.
+      const void* const redirectTarget =
+          ((0 != directlyRedirectedFunctions.count(originalFunc))
+               ? trampoline->GetHookFunction()
+               : HookEntryForTrampoline(trampoline));
+
+      uint8_t patchedBytes[HookIntegrity::kWindowSizeBytes] = {};
+      if (false ==
+          EncodeJumpBytes(
+              JumpSiteForOriginalFunction(originalFunc, isHotPatch), redirectTarget, patchedBytes))
+        continue;
+      if (true == isHotPatch)
+        std::memcpy(
+            &patchedBytes[reinterpret_cast<size_t>(originalFunc) - patchedRange.first],
+            X86Instruction::kHotPatchEntryJumpInstruction,
+            sizeof(X86Instruction::kHotPatchEntryJumpInstruction));
+
+      uint64_t expectedBytes = 0;
+      std::memcpy(
+          &reinterpret_cast<uint8_t*>(
+              &expectedBytes)[patchedRange.first - reinterpret_cast<size_t>(window)],
+          patchedBytes,
+          patchedRange.second - patchedRange.first);
+
+      patchSites.windows.push_back(window);
+      patchSites.expectedBytes.push_back(expectedBytes);
+      patchSites.masks.push_back(mask);
+      patchSiteRedirects.push_back(
+          {.from = originalFunc,
+           .to = redirectTarget,
+           .hookSpecIndex = 0,
+           .trampoline = trampoline,
+           .skipped = false,
+           .succeeded = false});
+      patchSiteModules.push_back(moduleHandle);
+    }
+
+    std::sort(patchSiteModules.begin(), patchSiteModules.end());
+    patchSiteModules.erase(
+        std::unique(patchSiteModules.begin(), patchSiteModules.end()), patchSiteModules.end());
+
+    patchSitesModified = false;
+  }
+
+  bool HookStore::ArePatchSiteModulesHeld(const std::vector<HMODULE>& moduleReferences)
+  {
+    return std::includes(
+        moduleReferences.cbegin(),
+        moduleReferences.cend(),
+        patchSiteModules.cbegin(),
+        patchSiteModules.cend());
+  }
+
+  bool HookStore::IsTransactionOwnedByCurrentThread(void)
+  {
+    return ((0 != transactionThreadId) &&
+            (Protected::Windows_GetCurrentThreadId() == transactionThreadId));
+  }
+
+  size_t HookStore::HookStoreHeapBytes(void)
+  {
+    size_t heapBytes = HashTableHeapBytes(functionToTrampoline) +
+        functionToTrampolineLookup.HeapBytes() +
+        HashTableHeapBytes(trampolineToInstrumentationStub) +
+        HashTableHeapBytes(exportCounterStubs) + HashTableHeapBytes(trampolineToSampledTiming) +
+        HashTableHeapBytes(trampolineToLatencyBudget) +
+        HashTableHeapBytes(trampolineToReentrancyGuard) +
+        HashTableHeapBytes(trampolineToCallerFilter) +
+        HashTableHeapBytes(trampolineToThreadOverride) + HashTableHeapBytes(callTraceStubs) +
+        (callbackHookDescriptors.size() *
+         (sizeof(CallbackHooks::SDescriptor) + (2 * sizeof(void*)))) +
+        HashTableHeapBytes(oneShotHooks) +
+        (oneShotFiredFlags.size() * (sizeof(long) + (2 * sizeof(void*)))) +
+        HashTableHeapBytes(sampledHooks) +
+        HashTableHeapBytes(hookChains) + HashTableHeapBytes(directlyRedirectedFunctions) +
+        HashTableHeapBytes(originalFunctionPrologues) + HashTableHeapBytes(unhookedFunctions) +
+        HashTableHeapBytes(trampolineToHookGroup) + HashTableHeapBytes(hotPatchedFunctions) +
+        HashTableHeapBytes(reservedFunctions) + HashTableHeapBytes(jumpThunkTargets) +
+        HashTableHeapBytes(trampolineToHookStub) + VectorHeapBytes(retiredTrampolines) +
+        VectorHeapBytes(trampolines) + HashTableHeapBytes(trampolineStoreIndices) +
+        VectorHeapBytes(transactionRedirects) + VectorHeapBytes(patchSites.windows) +
+        VectorHeapBytes(patchSites.expectedBytes) + VectorHeapBytes(patchSites.masks) +
+        VectorHeapBytes(patchSiteRedirects) + VectorHeapBytes(patchSiteModules) +
+        instrumentationCounterShardBytes;
+
+    for (const auto& hookChain : hookChains)
+      heapBytes += VectorHeapBytes(hookChain.second);
+
+#ifdef _WIN64
+    heapBytes += HashTableHeapBytes(absoluteJumpPrologues) +
+        HashTableHeapBytes(trampolineToCodeCaveStub) + HashTableHeapBytes(trampolineStoreMap) +
+        VectorHeapBytes(farStoreIndices);
+
+    for (const auto& baseAddressAndStores : trampolineStoreMap)
+      heapBytes += VectorHeapBytes(baseAddressAndStores.second.storeIndices) +
+          VectorHeapBytes(baseAddressAndStores.second.sharedStoreIndices);
+#endif
+
+    return heapBytes;
+  }
+
+  std::vector<std::pair<const void*, size_t>> HookStore::PatchedPages(void)
+  {
+    const size_t pageSize =
+        static_cast<size_t>(Infra::SystemInfo::GetPlatformAndArchitectureInfo().dwPageSize);
+
+    std::vector<std::pair<const void*, size_t>> patchedPages;
+
+    for (const auto& functionAndTrampoline : functionToTrampoline)
+    {
+      // Original functions map to their innermost trampolines, which are the ones that modified
+      // them. Hooks in the open transaction have not modified anything yet, but disabled hooks
+      // have, and restoring an original function does not make its pages shared again.
+      const void* const originalFunc = functionAndTrampoline.first;
+      if ((originalFunc != OriginalFunctionForTrampoline(functionAndTrampoline.second)) ||
+          (true == IsRedirectPending(originalFunc)))
+        continue;
+
+      auto patchedRange = PatchedRangeForOriginalFunction(
+          originalFunc, (0 != hotPatchedFunctions.count(originalFunc)));
+#ifdef _WIN64
+      if (0 != absoluteJumpPrologues.count(originalFunc))
+        patchedRange = {
+            reinterpret_cast<size_t>(originalFunc),
+            reinterpret_cast<size_t>(originalFunc) + kAbsoluteJumpPrologueSizeBytes};
+#endif
+
+      const void* const moduleBase = BaseAddressForOriginalFunc(originalFunc);
+      for (size_t pageAddress = (patchedRange.first & ~(pageSize - 1));
+           pageAddress < patchedRange.second;
+           pageAddress += pageSize)
+        patchedPages.emplace_back(moduleBase, pageAddress);
+    }
+
+    std::sort(patchedPages.begin(), patchedPages.end());
+    patchedPages.erase(std::unique(patchedPages.begin(), patchedPages.end()), patchedPages.end());
+
+    return patchedPages;
+  }
+
+  std::vector<bool> HookStore::FindIsolatedPatchSites(
+      const std::vector<void*>& originalFuncs, const EResult* results)
+  {
+    const size_t pageSize =
+        static_cast<size_t>(Infra::SystemInfo::GetPlatformAndArchitectureInfo().dwPageSize);
+
+    std::unordered_set<size_t> privatePages;
+    for (const auto& patchedPage : PatchedPages())
+      privatePages.insert(patchedPage.second);
+
+    // Hooks chained onto original functions that are already hooked do not modify anything.
+    std::vector<std::pair<size_t, size_t>> patchedRanges(originalFuncs.size(), {0, 0});
+    std::unordered_map<size_t, size_t> numPatchesOnPage;
+    for (size_t i = 0; i < originalFuncs.size(); ++i)
+    {
+      if ((false == SuccessfulResult(results[i])) ||
+          (0 != functionToTrampoline.count(originalFuncs[i])))
+        continue;
+
+      patchedRanges[i] = PatchedRangeForOriginalFunction(
+          originalFuncs[i], X86Instruction::IsHotPatchable(originalFuncs[i]));
+      for (size_t pageAddress = (patchedRanges[i].first & ~(pageSize - 1));
+           pageAddress < patchedRanges[i].second;
+           pageAddress += pageSize)
+        numPatchesOnPage[pageAddress] += 1;
+    }
+
+    std::vector<bool> isIsolated(originalFuncs.size(), false);
+    for (size_t i = 0; i < originalFuncs.size(); ++i)
+    {
+      if (patchedRanges[i].first == patchedRanges[i].second) continue;
+
+      isIsolated[i] = true;
+      for (size_t pageAddress = (patchedRanges[i].first & ~(pageSize - 1));
+           pageAddress < patchedRanges[i].second;
+           pageAddress += pageSize)
+      {
+        if ((0 != privatePages.count(pageAddress)) || (1 != numPatchesOnPage[pageAddress]))
+        {
+          isIsolated[i] = false;
+          break;
+        }
+      }
+    }
+
+    return isIsolated;
+  }
+
+  /// Cost, per call, of passing through a jump written over the beginning of an original function.
+  /// Passing through the hook entry of a trampoline on the way to the hook function costs double.
+  static constexpr uint32_t kHookCostPerInlineJump = 1;
+
+  /// Cost, per call, of dispatching the exception raised by a hardware execution breakpoint, which
+  /// involves a round trip through the kernel.
+  static constexpr uint32_t kHookCostPerDebugRegisterException = 400;
+
+  /// Cost of each page that becomes private to this process because a hook modifies it.
+  static constexpr uint32_t kHookCostPerPrivatePage = 16;
+
+  /// Cost of placing and committing a new trampoline store because none near the original function
+  /// has any free space.
+  static constexpr uint32_t kHookCostNewTrampolineStore = 8;
+
+  /// Cost of installing an inline hook, which rewrites a few bytes atomically.
+  static constexpr uint32_t kHookCostInstallInline = 4;
+
+  /// Cost of installing an import address table hook, which searches the import address tables of
+  /// every loaded module.
+  static constexpr uint32_t kHookCostInstallImportAddressTable = 6;
+
+  /// Cost of installing an export address table hook, which rewrites a single entry.
+  static constexpr uint32_t kHookCostInstallExportAddressTable = 2;
+
+  /// Cost of installing a debug register hook, which updates the context of every thread.
+  static constexpr uint32_t kHookCostInstallDebugRegister = 12;
+
+  /// Cost of the risk that an import address table hook misses calls, namely those made from
+  /// within the exporting module and through addresses obtained using `GetProcAddress`.
+  static constexpr uint32_t kHookCostMissedCallsImportAddressTable = 12;
+
+  /// Cost of the risk that an export address table hook misses calls, namely all of those made by
+  /// callers that resolved the original function before the hook was created.
+  static constexpr uint32_t kHookCostMissedCallsExportAddressTable = 64;
+
+  std::vector<HookStore::SHookKindCost> HookStore::EstimateHookKindCosts(
+      void* originalFunc, const void* hookFunc, SHookFeasibility* feasibility)
+  {
+    std::vector<SHookKindCost> hookKindCosts;
+
+    // Inline hooks are placed on the function to which any jump thunk leads, exactly as if created
+    // using CreateHook. They are possible if the original function is already hooked, in which case
+    // the new hook is chained, or if its first instructions can be transplanted.
+    void* const inlineOriginalFunc =
+        ((true == IsJumpThunkFollowingEnabled()) ? ResolveJumpThunks(originalFunc) : originalFunc);
+    const bool isAlreadyHooked = (0 != functionToTrampoline.count(inlineOriginalFunc));
+    if (nullptr != feasibility) feasibility->isAlreadyHooked = isAlreadyHooked;
+
+    Trampoline::SDecodedOriginalFunction decodedOriginalFunction;
+    if ((true == isAlreadyHooked) ||
+        (true == Trampoline::DecodeOriginalFunction(inlineOriginalFunc, &decodedOriginalFunction)))
+    {
+      if ((nullptr != feasibility) && (false == isAlreadyHooked))
+      {
+        int numRelocations = 0;
+        int numJumpAssists = 0;
+        Trampoline::CountOriginalFunctionRelocations(
+            decodedOriginalFunction, &numRelocations, &numJumpAssists);
+
+        feasibility->numTransplantedBytes =
+            static_cast<uint32_t>(decodedOriginalFunction.numDecodedBytes);
+        feasibility->numTransplantedInstructions =
+            static_cast<uint32_t>(decodedOriginalFunction.numInstructions);
+        feasibility->numRelocations = static_cast<uint32_t>(numRelocations);
+        feasibility->numJumpAssists = static_cast<uint32_t>(numJumpAssists);
+      }
+
+      // A hook that is not chained can jump straight to its hook function if that is enabled and
+      // the jump can reach it. Otherwise every call also passes through the trampoline.
+      const void* const jumpSite = JumpSiteForOriginalFunction(
+          inlineOriginalFunc, X86Instruction::IsHotPatchable(inlineOriginalFunc));
+      const bool isDirectJump =
+          ((nullptr != hookFunc) && (false == isAlreadyHooked) &&
+           (true == IsDirectHookJumpEnabled()) &&
+           (false == IsTransactionOwnedByCurrentThread()) &&
+           (0 != AtomicBlockSizeForJump(jumpSite)) &&
+           (true == X86Instruction::CanWriteJumpInstruction(jumpSite, hookFunc)));
+
+      uint32_t inlineCost = kHookCostInstallInline +
+          ((true == isDirectJump) ? kHookCostPerInlineJump : (2 * kHookCostPerInlineJump));
+
+      const EResult inlineResult = EResult::Success;
+      if (true == FindIsolatedPatchSites({inlineOriginalFunc}, &inlineResult)[0])
+        inlineCost += kHookCostPerPrivatePage;
+
+#ifdef _WIN64
+      // Placing a new trampoline store involves probing for free memory near the original function.
+      if (false == isAlreadyHooked)
+      {
+        bool hasFreeTrampoline = false;
+        const auto nearModuleStoresIter =
+            trampolineStoreMap.find(BaseAddressForOriginalFunc(inlineOriginalFunc));
+        if (trampolineStoreMap.end() != nearModuleStoresIter)
+        {
+          for (const int storeIndex : nearModuleStoresIter->second.storeIndices)
+            hasFreeTrampoline = hasFreeTrampoline || trampolines[storeIndex].HasFreeSpace();
+          for (const int storeIndex : nearModuleStoresIter->second.sharedStoreIndices)
+            hasFreeTrampoline = hasFreeTrampoline || trampolines[storeIndex].HasFreeSpace();
+        }
+
+        if (false == hasFreeTrampoline) inlineCost += kHookCostNewTrampolineStore;
+        if (nullptr != feasibility) feasibility->needsNewTrampolineStore = !hasFreeTrampoline;
+      }
+#else
+      if ((nullptr != feasibility) && (false == isAlreadyHooked))
+      {
+        bool hasFreeTrampoline = false;
+        for (const auto& trampolineStore : trampolines)
+          hasFreeTrampoline = hasFreeTrampoline || trampolineStore.HasFreeSpace();
+
+        feasibility->needsNewTrampolineStore = !hasFreeTrampoline;
+      }
+#endif
+
+      hookKindCosts.push_back({.hookKind = EHookKind::Inline, .cost = inlineCost});
+    }
+
+    // Only inline hooks can be created within a transaction without taking effect immediately.
+    if (true == IsTransactionOwnedByCurrentThread()) return hookKindCosts;
+
+    // Address table hooks require the original function to be part of a loaded module. They modify
+    // address tables that the loader has already written, so no additional pages become private.
+    if (nullptr != ModuleForAddress(originalFunc))
+    {
+      hookKindCosts.push_back(
+          {.hookKind = EHookKind::ImportAddressTable,
+           .cost = kHookCostInstallImportAddressTable + kHookCostMissedCallsImportAddressTable});
+      hookKindCosts.push_back(
+          {.hookKind = EHookKind::ExportAddressTable,
+           .cost = kHookCostInstallExportAddressTable + kHookCostMissedCallsExportAddressTable});
+    }
+
+    // Debug register hooks trigger on the first instruction of the original function, which for an
+    // inline hook has already been replaced.
+    if (false == isAlreadyHooked)
+    {
+      hookKindCosts.push_back(
+          {.hookKind = EHookKind::DebugRegister,
+           .cost = kHookCostInstallDebugRegister + kHookCostPerDebugRegisterException});
+    }
+
+    std::stable_sort(
+        hookKindCosts.begin(),
+        hookKindCosts.end(),
+        [](const SHookKindCost& a, const SHookKindCost& b) -> bool
+        {
+          return (a.cost < b.cost);
+        });
+
+    return hookKindCosts;
+  }
+
+  std::vector<const void*> HookStore::TrampolineStoreModuleBases(void)
+  {
+    std::vector<const void*> moduleBases(trampolines.size(), nullptr);
+
+#ifdef _WIN64
+    for (const auto& baseAddressAndStores : trampolineStoreMap)
+    {
+      for (const int storeIndex : baseAddressAndStores.second.storeIndices)
+        moduleBases[static_cast<size_t>(storeIndex)] = baseAddressAndStores.first;
+    }
+#endif
+
+    return moduleBases;
+  }
+
+  size_t HookStore::AllocateThreadEnvironmentBlockSlot(void)
+  {
+    // Only the first few thread-local storage slots are held directly in the thread environment
+    // block, at an offset that generated code can use. The rest are held in a separately allocated
+    // array that would need an extra memory access to reach.
+    const DWORD tlsIndex = Protected::Windows_TlsAlloc();
+    if ((TLS_OUT_OF_INDEXES == tlsIndex) || (tlsIndex >= TLS_MINIMUM_AVAILABLE))
+    {
+      if (TLS_OUT_OF_INDEXES != tlsIndex) Protected::Windows_TlsFree(tlsIndex);
+      return 0;
+    }
+
+    return kThreadEnvironmentBlockTlsSlotsOffset + (static_cast<size_t>(tlsIndex) * sizeof(void*));
+  }
+
+  EResult HookStore::CreateHookInternal(
+      void* originalFunc,
+      const void* hookFunc,
+      const bool isInternal,
+      const void** originalFuncAfterHook)
+  {
+    if (false == IsHookSpecValid(originalFunc, hookFunc)) return EResult::FailInvalidArgument;
+
+    // If the requested function is a jump thunk, the hook is placed on the function to which it
+    // jumps, and everything else operates on that function instead.
+    void* const requestedFunc = originalFunc;
+    if ((false == isInternal) && (true == IsJumpThunkFollowingEnabled()))
+    {
+      std::shared_lock<std::shared_mutex> lock(hookStoreMutex);
+      originalFunc = ResolveJumpThunks(requestedFunc);
+    }
+
+    if ((requestedFunc != originalFunc) && (false == IsHookSpecValid(originalFunc, hookFunc)))
+      return EResult::FailInvalidArgument;
+
+    // Decoding the original function does not involve any shared state, so it is done before any
+    // locks are taken. If the original function changes in the meantime, for example because
+    // another thread hooks it first, then it is just decoded again while holding the lock.
+    Trampoline::SDecodedOriginalFunction decodedOriginalFunction;
+    const Trampoline::SDecodedOriginalFunction* const decoded =
+        ((true == Trampoline::DecodeOriginalFunction(originalFunc, &decodedOriginalFunction))
+             ? &decodedOriginalFunction
+             : nullptr);
+
+    // Opening a trampoline write window affects every trampoline store, so hooks can only be
+    // created concurrently if trampolines are never write-protected in the first place.
+    if ((false == isInternal) && (false == TrampolineStore::IsWriteProtectionEnabled()))
+    {
+      const EResult result = CreateHookInShard(originalFunc, hookFunc, decoded);
+      if ((requestedFunc != originalFunc) && (true == SuccessfulResult(result)))
+      {
+        std::unique_lock<std::shared_mutex> lock(hookStoreMutex);
+        jumpThunkTargets[requestedFunc] = originalFunc;
+      }
+
+      return result;
+    }
+
+    std::unique_lock<std::shared_mutex> lock(hookStoreMutex);
+    const EResult result = CreateHookWithLockHeld(
+        originalFunc, hookFunc, isInternal, originalFuncAfterHook, decoded);
+    if ((requestedFunc != originalFunc) && (true == SuccessfulResult(result)))
+      jumpThunkTargets[requestedFunc] = originalFunc;
+
+    return result;
+  }
+
+  EResult HookStore::CreateHookWithLockHeld(
+      void* originalFunc,
+      const void* hookFunc,
+      const bool isInternal,
+      const void** originalFuncAfterHook,
+      const Trampoline::SDecodedOriginalFunction* decoded)
+  {
+    TrampolineStore::WriteWindow trampolineWriteWindow;
+
+    // Check for duplicates.
+    // If Hookshot has already set a hook that touches the specified hook function, that is an
+    // error. The same goes for the specified original function, unless it is the original function
+    // of an existing hook, in which case the new hook is chained onto it.
+    if (true == IsFunctionInUse(hookFunc)) return EResult::FailDuplicate;
+    if (0 != reservedFunctions.count(originalFunc)) return EResult::FailDuplicate;
+
+    if (0 != functionToTrampoline.count(originalFunc))
+    {
+      if (true == isInternal) return EResult::FailDuplicate;
+      return ChainHook(originalFunc, hookFunc);
+    }
+
+    TrampolineStore* trampolineStore = nullptr;
+    Trampoline* trampoline = nullptr;
+
+    // Redirection within a transaction is deferred and always uses a relative jump, so only hooks
+    // created outside of one can fall back to an absolute jump.
+    const bool canUseFarTrampoline = (false == IsTransactionOwnedByCurrentThread());
+    const EResult prepareResult = PrepareTrampoline(
+        originalFunc, hookFunc, decoded, &trampolineStore, &trampoline, canUseFarTrampoline);
+#ifdef _WIN64
+    if ((EResult::FailAllocation == prepareResult) && (true == canUseFarTrampoline))
+      return CreateFarHookWithLockHeld(originalFunc, hookFunc, isInternal, originalFuncAfterHook);
+#endif
+    if (false == SuccessfulResult(prepareResult)) return prepareResult;
+
+    if ((false == BindCallTraceStub(hookFunc, trampoline)) ||
+        (false == BindOneShotStub(hookFunc, trampoline)) ||
+        (false == BindSampledHookStub(hookFunc, trampoline)))
+    {
+      DeallocateTrampoline(trampoline);
+      return EResult::FailInternal;
+    }
+
+    RegisterTrampolineCallTargets();
+    UpdateProtectedDependencyAddress(originalFunc, trampoline->GetOriginalFunction());
+
+    // Internal hooks are never replaced or disabled, so there is no benefit to having them jump
+    // directly or to being able to restore their original functions.
+    if (false == isInternal) SaveOriginalFunctionPrologue(originalFunc);
+    const void* const redirectTarget =
+        ((true == isInternal) ? HookEntryForTrampoline(trampoline)
+                              : RedirectTargetForHook(originalFunc, hookFunc, trampoline));
+
+    // Within a transaction, the hook is registered right away so that it can be queried, but the
+    // original function is not modified until the transaction is committed.
+    if ((false == isInternal) && (true == IsTransactionOwnedByCurrentThread()))
+    {
+      RegisterHook(originalFunc, hookFunc, trampoline, redirectTarget);
+      transactionRedirects.push_back(
+          {.from = originalFunc,
+           .to = redirectTarget,
+           .hookSpecIndex = transactionRedirects.size(),
+           .trampoline = trampoline,
+           .skipped = false,
+           .succeeded = false});
+      return EResult::Success;
+    }
+
+    if (false == RedirectExecution(originalFunc, redirectTarget))
+    {
+      Infra::Message::OutputFormatted(
+          Infra::Message::ESeverity::Info,
+          L"Failed to redirect execution from 0x%llx to 0x%llx.",
+          (long long)originalFunc,
+          (long long)redirectTarget);
+
+      originalFunctionPrologues.erase(originalFunc);
+      hotPatchedFunctions.erase(originalFunc);
+      DeallocateTrampoline(trampoline);
+      return EResult::FailCannotSetHook;
+    }
+
+    // Internal hooks are intended to be invisible to the Hookshot API user.
+    // Therefore, they are not inserted into Hookshot data structures.
+    // However, this means that methods like GetOriginalFunction are not available, hence the need
+    // to save out the address of the trampoline's "original" region immediately.
+    if (false == isInternal)
+    {
+      RegisterHook(originalFunc, hookFunc, trampoline, redirectTarget);
+    }
+    else
+    {
+      if (nullptr != originalFuncAfterHook)
+        *originalFuncAfterHook = trampoline->GetOriginalFunction();
+    }
+
+    return EResult::Success;
+  }
+
+#ifdef _WIN64
+  EResult HookStore::CreateFarHookWithLockHeld(
+      void* originalFunc,
+      const void* hookFunc,
+      const bool isInternal,
+      const void** originalFuncAfterHook)
+  {
+    TrampolineStore::WriteWindow trampolineWriteWindow;
+
+    TrampolineStore* trampolineStore = nullptr;
+    Trampoline* trampoline = nullptr;
+
+    const EResult allocateResult = AllocateFarTrampoline(&trampolineStore, &trampoline);
+    if (false == SuccessfulResult(allocateResult)) return allocateResult;
+
+    trampoline->SetHookFunction(hookFunc);
+
+    // A code cave within reach of the original function lets it be redirected using a relative
+    // jump like any other hook, which overwrites fewer of its bytes and does not require other
+    // threads to be suspended. The code cave holds the absolute jump instead.
+    void* const codeCave = CodeCaves::Allocate(
+        JumpSiteForOriginalFunction(originalFunc, X86Instruction::IsHotPatchable(originalFunc)));
+    const int minOriginalFunctionBytes =
+        ((nullptr != codeCave) ? X86Instruction::kJumpInstructionLengthBytes
+                               : X86Instruction::kAbsoluteJumpInstructionLengthBytes);
+
+    // Failing here means the original function cannot be hooked at all, which is ultimately
+    // because there is no space near it.
+    size_t trampolineSizeBytesUsed = 0;
+    if (false ==
+        trampoline->SetOriginalFunctionFar(
+            originalFunc, &trampolineSizeBytesUsed, minOriginalFunctionBytes))
+    {
+      Infra::Message::OutputFormatted(
+          Infra::Message::ESeverity::Info,
+          L"Failed to set up a trampoline for original function at 0x%llx, which has no space nearby and cannot be redirected using an absolute jump.",
+          (long long)originalFunc);
+
+      if (nullptr != codeCave) CodeCaves::Deallocate(codeCave);
+      trampolineStore->Deallocate(trampoline);
+      return EResult::FailAllocation;
+    }
+
+    CompleteTrampoline(originalFunc, hookFunc, trampoline, trampolineSizeBytesUsed);
+    if ((false == BindCallTraceStub(hookFunc, trampoline)) ||
+        (false == BindOneShotStub(hookFunc, trampoline)) ||
+        (false == BindSampledHookStub(hookFunc, trampoline)))
+    {
+      if (nullptr != codeCave) CodeCaves::Deallocate(codeCave);
+      DeallocateTrampoline(trampoline);
+      return EResult::FailInternal;
+    }
+
+    RegisterTrampolineCallTargets();
+    UpdateProtectedDependencyAddress(originalFunc, trampoline->GetOriginalFunction());
+
+    const void* redirectTarget = nullptr;
+    if (nullptr != codeCave)
+    {
+      // The code cave always targets the trampoline, so it never changes once written. Once it is
+      // associated with the trampoline, deallocating the trampoline also deallocates it.
+      uint8_t codeCaveBytes[CodeCaves::kCaveSizeBytes];
+      X86Instruction::WriteAbsoluteJumpInstruction(
+          codeCaveBytes, sizeof(codeCaveBytes), HookEntryForTrampoline(trampoline));
+      if (false ==
+          WriteJumpBytes(
+              codeCave,
+              codeCaveBytes,
+              static_cast<size_t>(X86Instruction::kAbsoluteJumpInstructionLengthBytes)))
+      {
+        CodeCaves::Deallocate(codeCave);
+        DeallocateTrampoline(trampoline);
+        return EResult::FailCannotSetHook;
+      }
+
+      trampolineToCodeCaveStub[trampoline] = codeCave;
+      if (false == isInternal) SaveOriginalFunctionPrologue(originalFunc);
+      redirectTarget = codeCave;
+
+      if (false == RedirectExecution(originalFunc, redirectTarget))
+      {
+        Infra::Message::OutputFormatted(
+            Infra::Message::ESeverity::Info,
+            L"Failed to redirect execution from 0x%llx to 0x%llx.",
+            (long long)originalFunc,
+            (long long)redirectTarget);
+
+        originalFunctionPrologues.erase(originalFunc);
+        hotPatchedFunctions.erase(originalFunc);
+        DeallocateTrampoline(trampoline);
+        return EResult::FailCannotSetHook;
+      }
+
+      Infra::Message::OutputFormatted(
+          Infra::Message::ESeverity::Info,
+          L"Original function at 0x%llx has no space nearby for a trampoline, so it is redirected by way of a code cave at 0x%llx instead.",
+          (long long)originalFunc,
+          (long long)codeCave);
+    }
+    else
+    {
+      // Absolute jumps cannot be changed atomically, so they always target the trampoline, and
+      // replacing or disabling the hook only ever changes the trampoline.
+      if (false == isInternal)
+        std::memcpy(
+            absoluteJumpPrologues[originalFunc].data(),
+            originalFunc,
+            kAbsoluteJumpPrologueSizeBytes);
+      redirectTarget = HookEntryForTrampoline(trampoline);
+
+      if (false == RedirectExecutionAbsolute(originalFunc, redirectTarget, trampoline))
+      {
+        Infra::Message::OutputFormatted(
+            Infra::Message::ESeverity::Info,
+            L"Failed to redirect execution from 0x%llx to 0x%llx.",
+            (long long)originalFunc,
+            (long long)redirectTarget);
+
+        absoluteJumpPrologues.erase(originalFunc);
+        DeallocateTrampoline(trampoline);
+        return EResult::FailCannotSetHook;
+      }
+
+      Infra::Message::OutputFormatted(
+          Infra::Message::ESeverity::Warning,
+          L"Original function at 0x%llx has no space nearby for a trampoline, so it is redirected using an absolute jump instead.",
+          (long long)originalFunc);
+    }
+
+    if (false == isInternal)
+    {
+      RegisterHook(originalFunc, hookFunc, trampoline, redirectTarget);
+    }
+    else
+    {
+      if (nullptr != originalFuncAfterHook)
+        *originalFuncAfterHook = trampoline->GetOriginalFunction();
+    }
+
+    return EResult::Success;
+  }
+
+  bool HookStore::RedirectExecutionAbsolute(
+      void* from, const void* to, const Trampoline* trampoline)
+  {
+    uint8_t jumpBytes[kAbsoluteJumpPrologueSizeBytes];
+    static_assert(
+        sizeof(jumpBytes) ==
+            static_cast<size_t>(X86Instruction::kAbsoluteJumpInstructionLengthBytes),
+        "Absolute jump prologue size must match the absolute jump instruction length.");
+    X86Instruction::WriteAbsoluteJumpInstruction(jumpBytes, sizeof(jumpBytes), to);
+
+    // Unlike a relative jump, an absolute jump spans several instructions and cannot be written
+    // atomically, so no other thread can be allowed to run while it is written. While hook modules
+    // are loaded during injection, the only other threads might be loader worker threads, which
+    // never run outside of the loader.
+    std::vector<HANDLE> suspendedThreads;
+    if ((true == InjectionWindow::IsLoaderCode(from)) ||
+        (false == InjectionWindow::IsOnlyLoaderRunning()))
+      SuspendOtherThreads(suspendedThreads);
+
+    for (const HANDLE thread : suspendedThreads)
+    {
+      CONTEXT threadContext = {};
+      threadContext.ContextFlags = CONTEXT_CONTROL;
+      if (0 == Protected::Windows_GetThreadContext(thread, &threadContext)) continue;
+
+      // A thread stopped exactly at the start of the original function will simply follow the
+      // hook once it resumes.
+      const size_t offset = static_cast<size_t>(threadContext.Rip) - reinterpret_cast<size_t>(from);
+      if ((0 == offset) || (offset >= sizeof(jumpBytes))) continue;
+
+      threadContext.Rip = reinterpret_cast<DWORD64>(trampoline->GetOriginalFunction()) +
+          static_cast<DWORD64>(offset);
+      Protected::Windows_SetThreadContext(thread, &threadContext);
+    }
+
+    const bool writeJumpResult = WriteJumpBytes(from, jumpBytes, sizeof(jumpBytes));
+
+    ResumeThreads(suspendedThreads);
+    return writeJumpResult;
+  }
+#endif
+
+  void HookStore::CreateInternalHooks(
+      const SHookSpec* hookSpecs,
+      size_t numHookSpecs,
+      const void** const* originalFuncsAfterHook,
+      EResult* results)
+  {
+    for (size_t i = 0; i < numHookSpecs; ++i)
+      results[i] = (true == IsHookSpecValid(hookSpecs[i].originalFunc, hookSpecs[i].hookFunc))
+          ? EResult::Success
+          : EResult::FailInvalidArgument;
+
+    std::vector<Trampoline::SDecodedOriginalFunction> decodedOriginalFunctions(numHookSpecs);
+    std::vector<bool> isDecodedOriginalFunctionValid(numHookSpecs, false);
+    for (size_t i = 0; i < numHookSpecs; ++i)
+    {
+      if (false == SuccessfulResult(results[i])) continue;
+      isDecodedOriginalFunctionValid[i] = Trampoline::DecodeOriginalFunction(
+          hookSpecs[i].originalFunc, &decodedOriginalFunctions[i]);
+    }
+
+    std::vector<SPendingRedirect> pendingRedirects;
+    pendingRedirects.reserve(numHookSpecs);
+
+    std::unique_lock<std::shared_mutex> lock(hookStoreMutex);
+    TrampolineStore::WriteWindow trampolineWriteWindow;
+
+    std::unordered_set<const void*> functionsInBatch;
+    functionsInBatch.reserve(numHookSpecs * 2);
+
+    for (size_t i = 0; i < numHookSpecs; ++i)
+    {
+      if (false == SuccessfulResult(results[i])) continue;
+
+      void* const originalFunc = hookSpecs[i].originalFunc;
+      const void* const hookFunc = hookSpecs[i].hookFunc;
+
+      // Internal hooks are never chained, so any existing hook on the same original function is
+      // also a duplicate.
+      if ((true == IsFunctionInUse(hookFunc)) || (0 != reservedFunctions.count(originalFunc)) ||
+          (0 != functionToTrampoline.count(originalFunc)) ||
+          (0 != functionsInBatch.count(originalFunc)) || (0 != functionsInBatch.count(hookFunc)))
+      {
+        results[i] = EResult::FailDuplicate;
+        continue;
+      }
+
+      TrampolineStore* trampolineStore = nullptr;
+      Trampoline* trampoline = nullptr;
+
+      results[i] = PrepareTrampoline(
+          originalFunc,
+          hookFunc,
+          ((true == isDecodedOriginalFunctionValid[i]) ? &decodedOriginalFunctions[i] : nullptr),
+          &trampolineStore,
+          &trampoline,
+          false);
+      if (false == SuccessfulResult(results[i])) continue;
+
+      functionsInBatch.insert(originalFunc);
+      functionsInBatch.insert(hookFunc);
+
+      pendingRedirects.push_back(
+          {.from = originalFunc,
+           .to = HookEntryForTrampoline(trampoline),
+           .hookSpecIndex = i,
+           .trampoline = trampoline,
+           .skipped = false,
+           .succeeded = false});
+    }
+
+    RegisterTrampolineCallTargets();
+    for (const auto& pendingRedirect : pendingRedirects)
+      UpdateProtectedDependencyAddress(
+          pendingRedirect.from, pendingRedirect.trampoline->GetOriginalFunction());
+
+    RedirectExecutionBatch(pendingRedirects);
+
+    // As with individually-created internal hooks, nothing is registered, so the addresses for
+    // invoking the original functions are saved out immediately.
+    for (const auto& pendingRedirect : pendingRedirects)
+    {
+      if (true == pendingRedirect.succeeded)
+      {
+        const void** const originalFuncAfterHook =
+            originalFuncsAfterHook[pendingRedirect.hookSpecIndex];
+        if (nullptr != originalFuncAfterHook)
+          *originalFuncAfterHook = pendingRedirect.trampoline->GetOriginalFunction();
+      }
+      else
+      {
+        results[pendingRedirect.hookSpecIndex] = EResult::FailCannotSetHook;
+      }
+    }
+  }
+
+  EResult HookStore::CreateHookInShard(
+      void* originalFunc, const void* hookFunc, const Trampoline::SDecodedOriginalFunction* decoded)
+  {
+    std::lock_guard<std::mutex> shardLock(HookCreationShardMutexForOriginalFunc(originalFunc));
+
+    Trampoline* trampoline = nullptr;
+
+    // First the hook is checked for duplicates and a trampoline is allocated for it, with both of
+    // its functions reserved so that no other hook can be created using them in the meantime.
+    do
+    {
+      std::unique_lock<std::shared_mutex> lock(hookStoreMutex);
+
+      // Redirection is deferred within a transaction, and the pending redirects are protected by
+      // the hook store lock, so hooks created within a transaction are created while holding it.
+      if (true == IsTransactionOwnedByCurrentThread())
+        return CreateHookWithLockHeld(originalFunc, hookFunc, false, nullptr, decoded);
+
+      if (true == IsFunctionInUse(hookFunc)) return EResult::FailDuplicate;
+
+      // No other hook onto the same original function can be in the middle of being created,
+      // because it would be in the same shard, so a reservation means it is some other hook's hook
+      // function.
+      if (0 != functionToTrampoline.count(originalFunc)) return ChainHook(originalFunc, hookFunc);
+      if (0 != reservedFunctions.count(originalFunc)) return EResult::FailDuplicate;
+
+      TrampolineStore* trampolineStore = nullptr;
+      const EResult allocateResult =
+          AllocateTrampoline(originalFunc, &trampolineStore, &trampoline, true);
+#ifdef _WIN64
+      if (EResult::FailAllocation == allocateResult)
+        return CreateFarHookWithLockHeld(originalFunc, hookFunc, false, nullptr);
+#endif
+      if (false == SuccessfulResult(allocateResult)) return allocateResult;
+
+      trampoline->SetHookFunction(hookFunc);
+
+      reservedFunctions.insert(originalFunc);
+      reservedFunctions.insert(hookFunc);
+    } while (false);
+
+    // Transplanting the original function only touches the newly-allocated trampoline and reads
+    // the original function, neither of which anything else can access while the reservation is
+    // held. Trampoline stores can move when new ones are added, but the trampolines they hold do
+    // not.
+    size_t trampolineSizeBytesUsed = 0;
+    const bool originalFunctionSet =
+        SetTrampolineOriginalFunction(trampoline, originalFunc, decoded, &trampolineSizeBytesUsed);
+
+    // Everything else modifies data structures shared by all hooks.
+    std::unique_lock<std::shared_mutex> lock(hookStoreMutex);
+
+    reservedFunctions.erase(originalFunc);
+    reservedFunctions.erase(hookFunc);
+
+    if (false == originalFunctionSet)
+    {
+      Infra::Message::OutputFormatted(
+          Infra::Message::ESeverity::Info,
+          L"Failed to set up a trampoline for original function at 0x%llx.",
+          (long long)originalFunc);
+
+      DeallocateTrampoline(trampoline);
+      return EResult::FailCannotSetHook;
+    }
+
+    CompleteTrampoline(originalFunc, hookFunc, trampoline, trampolineSizeBytesUsed);
+    RegisterTrampolineCallTargets();
+    UpdateProtectedDependencyAddress(originalFunc, trampoline->GetOriginalFunction());
+
+    SaveOriginalFunctionPrologue(originalFunc);
+    const void* const redirectTarget = RedirectTargetForHook(originalFunc, hookFunc, trampoline);
+
+    if (false == RedirectExecution(originalFunc, redirectTarget))
+    {
+      Infra::Message::OutputFormatted(
+          Infra::Message::ESeverity::Info,
+          L"Failed to redirect execution from 0x%llx to 0x%llx.",
+          (long long)originalFunc,
+          (long long)redirectTarget);
+
+      originalFunctionPrologues.erase(originalFunc);
+      hotPatchedFunctions.erase(originalFunc);
+      DeallocateTrampoline(trampoline);
+      return EResult::FailCannotSetHook;
+    }
+
+    RegisterHook(originalFunc, hookFunc, trampoline, redirectTarget);
+    return EResult::Success;
+  }
+
+  EResult HookStore::CreateHooksByExportNameInternal(
+      IHookshot* hookshot,
+      void* moduleHandle,
+      const char* const* exportNames,
+      const void* const* hookFuncs,
+      size_t numHooks,
+      EResult* results)
+  {
+    if ((nullptr == moduleHandle) ||
+        (((nullptr == exportNames) || (nullptr == hookFuncs)) && (0 != numHooks)))
+      return EResult::FailInvalidArgument;
+    if (0 == numHooks) return EResult::NoEffect;
+
+    std::vector<EResult> localResults;
+    if (nullptr == results)
+    {
+      localResults.resize(numHooks);
+      results = localResults.data();
+    }
+
+    std::vector<std::string_view> procNames(numHooks);
+    for (size_t i = 0; i < numHooks; ++i)
+    {
+      if (nullptr != exportNames[i]) procNames[i] = exportNames[i];
+    }
+
+    std::vector<void*> originalFuncs(numHooks, nullptr);
+    ExportResolver::GetLocalProcAddresses(
+        reinterpret_cast<HMODULE>(moduleHandle), procNames.data(), numHooks, originalFuncs.data());
+
+    std::vector<SHookSpec> hookSpecs(numHooks);
+    for (size_t i = 0; i < numHooks; ++i)
+      hookSpecs[i] = {.originalFunc = originalFuncs[i], .hookFunc = hookFuncs[i]};
+
+    hookshot->CreateHooks(hookSpecs.data(), numHooks, results);
+
+    // Exports that could not be resolved are reported as missing rather than as invalid.
+    for (size_t i = 0; i < numHooks; ++i)
+    {
+      if ((nullptr != exportNames[i]) && (nullptr == originalFuncs[i]))
+        results[i] = EResult::FailNotFound;
+    }
+
+    for (size_t i = 0; i < numHooks; ++i)
+    {
+      if (false == SuccessfulResult(results[i])) return results[i];
+    }
+
+    return EResult::Success;
+  }
+
+  EResult HookStore::CreateHooksBySymbolInternal(
+      IHookshot* hookshot,
+      const wchar_t* symbolIndexFilename,
+      void* moduleHandle,
+      const char* const* symbolNames,
+      const void* const* hookFuncs,
+      size_t numHooks,
+      EResult* results)
+  {
+    if ((nullptr == symbolIndexFilename) || (nullptr == moduleHandle) ||
+        (((nullptr == symbolNames) || (nullptr == hookFuncs)) && (0 != numHooks)))
+      return EResult::FailInvalidArgument;
+    if (0 == numHooks) return EResult::NoEffect;
+
+    std::vector<EResult> localResults;
+    if (nullptr == results)
+    {
+      localResults.resize(numHooks);
+      results = localResults.data();
+    }
+
+    std::vector<uint32_t> symbolRelativeAddresses(numHooks, 0);
+    SymbolIndex::LookupSymbols(
+        symbolIndexFilename,
+        reinterpret_cast<HMODULE>(moduleHandle),
+        symbolNames,
+        numHooks,
+        symbolRelativeAddresses.data());
+
+    std::vector<SHookSpec> hookSpecs(numHooks);
+    for (size_t i = 0; i < numHooks; ++i)
+    {
+      hookSpecs[i] = {
+          .originalFunc = ((0 == symbolRelativeAddresses[i])
+                               ? nullptr
+                               : &reinterpret_cast<uint8_t*>(
+                                     moduleHandle)[symbolRelativeAddresses[i]]),
+          .hookFunc = hookFuncs[i]};
+    }
+
+    hookshot->CreateHooks(hookSpecs.data(), numHooks, results);
+
+    // Symbols that could not be found are reported as missing rather than as invalid.
+    for (size_t i = 0; i < numHooks; ++i)
+    {
+      if ((nullptr != symbolNames[i]) && (0 == symbolRelativeAddresses[i]))
+        results[i] = EResult::FailNotFound;
+    }
+
+    for (size_t i = 0; i < numHooks; ++i)
+    {
+      if (false == SuccessfulResult(results[i])) return results[i];
+    }
+
+    return EResult::Success;
+  }
+
+  std::vector<HookStore::SHookInRange> HookStore::HooksWithHookFunctionsInRange(
+      const void* begin, const void* end)
+  {
+    std::vector<SHookInRange> hooksInRange;
+
+    std::shared_lock<std::shared_mutex> lock(hookStoreMutex);
+
+    // Every hook function, chained or otherwise, is a key of this map. Original functions are also
+    // keys, but they are never hook functions.
+    for (const auto& functionAndTrampoline : functionToTrampoline)
+    {
+      const void* const func = functionAndTrampoline.first;
+      if ((func < begin) || (func >= end)) continue;
+
+      const void* const originalFunc = OriginalFunctionForTrampoline(functionAndTrampoline.second);
+      if ((nullptr == originalFunc) || (func == originalFunc)) continue;
+
+      hooksInRange.push_back(
+          {.originalFunc = const_cast<void*>(originalFunc),
+           .hookFunc = func,
+           .isChained = (0 != hookChains.count(originalFunc))});
+    }
+
+    return hooksInRange;
+  }
+
+  bool HookStore::IsAddressRangeInUseByOtherThreads(const void* begin, const void* end)
+  {
+    const size_t rangeBegin = reinterpret_cast<size_t>(begin);
+    const size_t rangeEnd = reinterpret_cast<size_t>(end);
+
+    std::vector<HANDLE> suspendedThreads;
+    SuspendOtherThreads(suspendedThreads);
+
+    bool isInUse = false;
+    for (const HANDLE thread : suspendedThreads)
+    {
+      // A thread whose state cannot be retrieved might be anywhere.
+      const bool threadStateRetrieved = VisitPossibleCodeAddressesOfThread(
+          thread,
+          [rangeBegin, rangeEnd, &isInUse](const size_t address) -> bool
+          {
+            isInUse = ((address >= rangeBegin) && (address < rangeEnd));
+            return isInUse;
+          });
+
+      if ((false == threadStateRetrieved) || (true == isInUse))
+      {
+        isInUse = true;
+        break;
+      }
+    }
+
+    ResumeThreads(suspendedThreads);
+    return isInUse;
+  }
+
+  EResult HookStore::CreateHook(void* originalFunc, const void* hookFunc)
+  {
+    const auto installStartTime = std::chrono::steady_clock::now();
+    Tracing::CreateHookStart(originalFunc, hookFunc);
+    const EResult result = CreateHookInternal(originalFunc, hookFunc, false, nullptr);
+    Tracing::CreateHookStop(originalFunc, hookFunc, result);
+    ExitSummary::RecordInstall(result, installStartTime);
+
+    if (false == SuccessfulResult(result)) SharedStatistics::CountInstallFailure();
+
+    return result;
+  }
+
+  EResult HookStore::CreateHooks(
+      const SHookSpec* hookSpecs, size_t numHookSpecs, EResult* results)
+  {
+    if ((nullptr == hookSpecs) && (0 != numHookSpecs)) return EResult::FailInvalidArgument;
+    if (0 == numHookSpecs) return EResult::NoEffect;
+
+    const auto installStartTime = std::chrono::steady_clock::now();
+    Tracing::CreateHooksStart(numHookSpecs);
+
+    std::vector<EResult> localResults;
+    if (nullptr == results)
+    {
+      localResults.resize(numHookSpecs);
+      results = localResults.data();
+    }
+
+    // Validation does not require any shared state, so it is done up front without the lock.
+    for (size_t i = 0; i < numHookSpecs; ++i)
+      results[i] = (true == IsHookSpecValid(hookSpecs[i].originalFunc, hookSpecs[i].hookFunc))
+          ? EResult::Success
+          : EResult::FailInvalidArgument;
+
+    // Requested functions that are jump thunks are replaced with the functions to which they jump,
+    // which are the functions actually hooked.
+    std::vector<void*> originalFuncs(numHookSpecs);
+    for (size_t i = 0; i < numHookSpecs; ++i)
+      originalFuncs[i] = hookSpecs[i].originalFunc;
+
+    if (true == IsJumpThunkFollowingEnabled())
+    {
+      std::shared_lock<std::shared_mutex> lock(hookStoreMutex);
+
+      for (size_t i = 0; i < numHookSpecs; ++i)
+      {
+        if (false == SuccessfulResult(results[i])) continue;
+
+        originalFuncs[i] = ResolveJumpThunks(hookSpecs[i].originalFunc);
+        if ((hookSpecs[i].originalFunc != originalFuncs[i]) &&
+            (false == IsHookSpecValid(originalFuncs[i], hookSpecs[i].hookFunc)))
+          results[i] = EResult::FailInvalidArgument;
+      }
+    }
+
+    // Each page of a module that is modified becomes private to this process, so if so configured,
+    // any hook that would be the only modification to an otherwise-untouched page is instead placed
+    // in the import address tables of all loaded modules. Transactions are excluded because such
+    // hooks take effect immediately. If there is no import to modify, the hook is created inline
+    // after all.
+    std::vector<bool> isImportHook(numHookSpecs, false);
+    size_t numImportHooks = 0;
+
+    if (true == IsImportHookPreferenceEnabled())
+    {
+      std::vector<bool> isIsolatedPatchSite;
+
+      do
+      {
+        std::shared_lock<std::shared_mutex> lock(hookStoreMutex);
+        if (false == IsTransactionOwnedByCurrentThread())
+          isIsolatedPatchSite = FindIsolatedPatchSites(originalFuncs, results);
+
+        // Export counter stubs need trampolines, so their hooks are always created inline.
+        for (size_t i = 0; i < isIsolatedPatchSite.size(); ++i)
+        {
+          if (0 != exportCounterStubs.count(hookSpecs[i].hookFunc)) isIsolatedPatchSite[i] = false;
+        }
+      } while (false);
+
+      for (size_t i = 0; i < isIsolatedPatchSite.size(); ++i)
+      {
+        if (false == isIsolatedPatchSite[i]) continue;
+
+        // Import address tables refer to the requested function, not to any function to which it
+        // jumps.
+        if (true ==
+            SuccessfulResult(CreateHookWithKind(
+                EHookKind::ImportAddressTable,
+                hookSpecs[i].originalFunc,
+                hookSpecs[i].hookFunc,
+                nullptr)))
+        {
+          isImportHook[i] = true;
+          originalFuncs[i] = hookSpecs[i].originalFunc;
+          numImportHooks += 1;
+        }
+      }
+    }
+
+    // Neither is decoding original functions, so that is also done up front, and for large
+    // batches it is spread across worker threads. Any original function that changes in the
+    // meantime is decoded again while holding the lock.
+    std::vector<void*> originalFuncsToDecode(numHookSpecs, nullptr);
+    for (size_t i = 0; i < numHookSpecs; ++i)
+    {
+      if ((false == SuccessfulResult(results[i])) || (true == isImportHook[i])) continue;
+      originalFuncsToDecode[i] = originalFuncs[i];
+    }
+
+    std::vector<Trampoline::SDecodedOriginalFunction> decodedOriginalFunctions(numHookSpecs);
+    std::vector<uint8_t> isDecodedOriginalFunctionValid(numHookSpecs, 0);
+    DecodeOriginalFunctions(
+        originalFuncsToDecode, decodedOriginalFunctions, isDecodedOriginalFunctionValid);
+
+    std::vector<SPendingRedirect> pendingRedirects;
+    pendingRedirects.reserve(numHookSpecs);
+
+    std::unique_lock<std::shared_mutex> lock(hookStoreMutex);
+    TrampolineStore::WriteWindow trampolineWriteWindow;
+
+    // Duplicate checks must consider both existing hooks and hooks that appear earlier in the same
+    // batch, since the latter are not yet registered.
+    std::unordered_set<const void*> functionsInBatch;
+    functionsInBatch.reserve(numHookSpecs * 2);
+
+    // Each hook adds up to two function addresses, so reserving space for all of them up front
+    // avoids repeatedly rehashing while the batch is registered.
+    functionToTrampoline.reserve(functionToTrampoline.size() + (numHookSpecs * 2));
+
+    size_t numHooksChained = 0;
+
+    for (size_t i = 0; i < numHookSpecs; ++i)
+    {
+      if ((false == SuccessfulResult(results[i])) || (true == isImportHook[i])) continue;
+
+      void* const originalFunc = originalFuncs[i];
+      const void* const hookFunc = hookSpecs[i].hookFunc;
+
+      if ((true == IsFunctionInUse(hookFunc)) || (0 != reservedFunctions.count(originalFunc)) ||
+          (0 != functionsInBatch.count(originalFunc)) || (0 != functionsInBatch.count(hookFunc)))
+      {
+        results[i] = EResult::FailDuplicate;
+        continue;
+      }
+
+      // Original functions that were already hooked before this batch can have hooks chained onto
+      // them right away because doing so does not require any redirection.
+      if (0 != functionToTrampoline.count(originalFunc))
+      {
+        results[i] = ChainHook(originalFunc, hookFunc);
+        if (true == SuccessfulResult(results[i]))
+        {
+          functionsInBatch.insert(hookFunc);
+          numHooksChained += 1;
+        }
+
+        continue;
+      }
+
+      TrampolineStore* trampolineStore = nullptr;
+      Trampoline* trampoline = nullptr;
+
+      results[i] = PrepareTrampoline(
+          originalFunc,
+          hookFunc,
+          ((0 != isDecodedOriginalFunctionValid[i]) ? &decodedOriginalFunctions[i] : nullptr),
+          &trampolineStore,
+          &trampoline,
+          false);
+      if (false == SuccessfulResult(results[i])) continue;
+
+      functionsInBatch.insert(originalFunc);
+      functionsInBatch.insert(hookFunc);
+
+      SaveOriginalFunctionPrologue(originalFunc);
+
+      pendingRedirects.push_back(
+          {.from = originalFunc,
+           .to = RedirectTargetForHook(originalFunc, hookFunc, trampoline),
+           .hookSpecIndex = i,
+           .trampoline = trampoline,
+           .skipped = false,
+           .succeeded = false});
+    }
+
+    // Protected dependencies are only redirected through their trampolines once the trampolines
+    // are valid call targets, and all of the trampolines in the batch are registered together.
+    RegisterTrampolineCallTargets();
+    for (const auto& pendingRedirect : pendingRedirects)
+      UpdateProtectedDependencyAddress(
+          pendingRedirect.from, pendingRedirect.trampoline->GetOriginalFunction());
+
+    const bool isTransactionOpen = IsTransactionOwnedByCurrentThread();
+    size_t numHooksCreated = numHooksChained + numImportHooks;
+
+    if (true == isTransactionOpen)
+    {
+      // Within a transaction, hooks are registered right away, but the original functions are not
+      // modified until the transaction is committed.
+      for (auto& pendingRedirect : pendingRedirects)
+      {
+        RegisterHook(
+            originalFuncs[pendingRedirect.hookSpecIndex],
+            hookSpecs[pendingRedirect.hookSpecIndex].hookFunc,
+            pendingRedirect.trampoline,
+            pendingRedirect.to);
+
+        pendingRedirect.hookSpecIndex = transactionRedirects.size();
+        transactionRedirects.push_back(pendingRedirect);
+        numHooksCreated += 1;
+      }
+    }
+    else
+    {
+      // Trampolines whose redirections fail cannot be deallocated because they are not necessarily
+      // the most recently allocated in their respective stores. They remain valid but unused.
+      RedirectExecutionBatch(pendingRedirects);
+
+      for (const auto& pendingRedirect : pendingRedirects)
+      {
+        if (true == pendingRedirect.succeeded)
+        {
+          RegisterHook(
+              originalFuncs[pendingRedirect.hookSpecIndex],
+              hookSpecs[pendingRedirect.hookSpecIndex].hookFunc,
+              pendingRedirect.trampoline,
+              pendingRedirect.to);
+          numHooksCreated += 1;
+        }
+        else
+        {
+          originalFunctionPrologues.erase(pendingRedirect.from);
+          hotPatchedFunctions.erase(pendingRedirect.from);
+          results[pendingRedirect.hookSpecIndex] = EResult::FailCannotSetHook;
+        }
+      }
+    }
+
+    for (size_t i = 0; i < numHookSpecs; ++i)
+    {
+      if ((hookSpecs[i].originalFunc != originalFuncs[i]) && (true == SuccessfulResult(results[i])))
+        jumpThunkTargets[hookSpecs[i].originalFunc] = originalFuncs[i];
+    }
+
+    lock.unlock();
+
+    Infra::Message::OutputFormatted(
+        Infra::Message::ESeverity::Info,
+        ((true == isTransactionOpen)
+             ? L"Prepared %llu of %llu requested hooks in a batch for the open transaction."
+             : L"Created %llu of %llu requested hooks in a batch."),
+        (unsigned long long)numHooksCreated,
+        (unsigned long long)numHookSpecs);
+
+    if (0 != numImportHooks)
+      Infra::Message::OutputFormatted(
+          Infra::Message::ESeverity::Info,
+          L"Placed %llu hook(s) in the batch in import address tables to avoid making otherwise-untouched pages private.",
+          (unsigned long long)numImportHooks);
+
+    EResult overallResult = EResult::Success;
+    for (size_t i = 0; i < numHookSpecs; ++i)
+    {
+      if (false == SuccessfulResult(results[i]))
+      {
+        if (true == SuccessfulResult(overallResult)) overallResult = results[i];
+        SharedStatistics::CountInstallFailure();
+      }
+    }
+
+    ExitSummary::RecordInstallBatch(results, numHookSpecs, installStartTime);
+    Tracing::CreateHooksStop(numHookSpecs, overallResult);
+    return overallResult;
+  }
+
+  EResult HookStore::BeginTransaction(void)
+  {
+    std::unique_lock<std::shared_mutex> lock(hookStoreMutex);
+
+    if (0 != transactionThreadId) return EResult::FailBadState;
+
+    transactionThreadId = Protected::Windows_GetCurrentThreadId();
+    return EResult::Success;
+  }
+
+  EResult HookStore::CommitTransaction(void)
+  {
+    std::unique_lock<std::shared_mutex> lock(hookStoreMutex);
+
+    if (false == IsTransactionOwnedByCurrentThread()) return EResult::FailBadState;
+
+    std::vector<SPendingRedirect> redirects = std::move(transactionRedirects);
+    transactionRedirects.clear();
+    transactionThreadId = 0;
+
+    if (true == redirects.empty()) return EResult::NoEffect;
+
+    // Everything that allocates memory needs to be done before other threads are suspended, since
+    // any one of them could be holding a heap lock at the time. For the same reason, no messages
+    // are output until the other threads are resumed.
+    std::vector<SAffectedPage> affectedPages;
+    PlanRedirectExecutionBatch(redirects, affectedPages);
+
+    std::vector<HANDLE> suspendedThreads;
+    if (false == CanRedirectWithoutSuspendingThreads(redirects))
+      SuspendOtherThreads(suspendedThreads);
+
+    const size_t numRelocatedThreads = RelocateSuspendedThreads(suspendedThreads, redirects);
+    ApplyRedirectExecutionBatch(redirects, affectedPages);
+
+    ResumeThreads(suspendedThreads);
+
+    // Hooks that did not go live were already registered when they were created and so need to be
+    // unregistered. As with batch hook creation, their trampolines remain valid but unused.
+    size_t numHooksCommitted = 0;
+    for (const auto& redirect : redirects)
+    {
+      if (true == redirect.succeeded)
+        numHooksCommitted += 1;
+      else
+        UnregisterHook(redirect.trampoline);
+    }
+
+    lock.unlock();
+
+    Infra::Message::OutputFormatted(
+        Infra::Message::ESeverity::Info,
+        L"Committed %llu of %llu pending hooks in a transaction with %llu other thread(s) suspended and %llu relocated.",
+        (unsigned long long)numHooksCommitted,
+        (unsigned long long)redirects.size(),
+        (unsigned long long)suspendedThreads.size(),
+        (unsigned long long)numRelocatedThreads);
+
+    return ((redirects.size() == numHooksCommitted) ? EResult::Success
+                                                    : EResult::FailCannotSetHook);
+  }
+
+  EResult HookStore::DisableHookFunction(const void* originalOrHookFunc)
+  {
+    return ReplaceHookFunction(originalOrHookFunc, GetOriginalFunction(originalOrHookFunc));
+  }
+
+  const void* HookStore::GetOriginalFunction(const void* originalOrHookFunc)
+  {
+    // This is by far the most frequently-invoked method, often from hot paths on many threads at
+    // once, so it deliberately does not take the hook store lock.
+    const Trampoline* const trampoline = functionToTrampolineLookup.Find(originalOrHookFunc);
+    if (nullptr != trampoline) return trampoline->GetOriginalFunction();
+
+    // Jump thunks whose hooks were placed on their targets are not keys of the lookup table, so
+    // they require the lock.
+    if (true == IsJumpThunkFollowingEnabled())
+    {
+      std::shared_lock<std::shared_mutex> lock(hookStoreMutex);
+
+      const void* const thunkTarget = ResolveJumpThunkAlias(originalOrHookFunc);
+      if (thunkTarget != originalOrHookFunc)
+      {
+        const Trampoline* const thunkTargetTrampoline =
+            functionToTrampolineLookup.Find(thunkTarget);
+        if (nullptr != thunkTargetTrampoline) return thunkTargetTrampoline->GetOriginalFunction();
+      }
+    }
+
+    const void* const addressTableOriginalFunc =
+        AddressTableHooks::GetOriginalFunction(originalOrHookFunc);
+    if (nullptr != addressTableOriginalFunc) return addressTableOriginalFunc;
+
+    return DebugRegisterHooks::GetOriginalFunction(originalOrHookFunc);
+  }
+
+  EResult HookStore::ReplaceHookFunction(const void* originalOrHookFunc, const void* newHookFunc)
+  {
+    std::unique_lock<std::shared_mutex> lock(hookStoreMutex);
+    TrampolineStore::WriteWindow trampolineWriteWindow;
+
+    return ReplaceHookFunctionWithLockHeld(originalOrHookFunc, newHookFunc);
+  }
+
+  EResult HookStore::ReplaceHookFunctionWithLockHeld(
+      const void* originalOrHookFunc, const void* newHookFunc)
+  {
+    // If this fails, the specified hook does not exist.
+    originalOrHookFunc = ResolveJumpThunkAlias(originalOrHookFunc);
+    if (0 == functionToTrampoline.count(originalOrHookFunc)) return EResult::FailNotFound;
+
+    return ReplaceHookFunctionForTrampolineWithLockHeld(
+        functionToTrampoline.at(originalOrHookFunc), newHookFunc);
+  }
+
+  EResult HookStore::ReplaceHookFunctionForTrampolineWithLockHeld(
+      Trampoline* trampoline, const void* newHookFunc)
+  {
+    // If this fails, internal data structures are inconsistent.
+    const void* const originalFunc = OriginalFunctionForTrampoline(trampoline);
+    if (nullptr == originalFunc) return EResult::FailInternal;
+
+    const void* const oldHookFunc = HookFunctionForTrampoline(trampoline);
+    if (oldHookFunc == newHookFunc) return EResult::NoEffect;
+
+    // If this fails, internal data structures are inconsistent.
+    if (0 == functionToTrampoline.count(originalFunc) ||
+        0 == functionToTrampoline.count(oldHookFunc))
+      return EResult::FailInternal;
+
+    // If this fails, the replacement hook function is already involved in a different hook.
+    if (true == IsFunctionInUse(newHookFunc)) return EResult::FailDuplicate;
 
     // If this fails, the specified hook cannot be set.
     if (false == IsHookSpecValid(originalFunc, newHookFunc)) return EResult::FailInvalidArgument;
 
-    trampoline->SetHookFunction(newHookFunc);
-    functionToTrampoline.erase(oldHookFunc);
-    functionToTrampoline[newHookFunc] = trampoline;
+    // Within a chain, whatever transfers control to the old hook function needs to be changed. For
+    // the outermost hook, that is the innermost trampoline, and for every other hook, that is the
+    // original function region of the trampoline of the next outer hook.
+    const auto chainIter = hookChains.find(originalFunc);
+    if (hookChains.end() != chainIter)
+    {
+      std::vector<SChainedHook>& chain = chainIter->second;
+
+      size_t chainIndex = 0;
+      while ((chainIndex < chain.size()) && (trampoline != chain[chainIndex].trampoline))
+        chainIndex += 1;
+
+      // If this fails, internal data structures are inconsistent.
+      if (chainIndex == chain.size()) return EResult::FailInternal;
+
+      if (0 == chainIndex)
+      {
+        if (false == RetargetHook(originalFunc, chain.back().trampoline, newHookFunc))
+          return EResult::FailInternal;
+      }
+      else
+      {
+        Trampoline* const outerTrampoline = chain[chainIndex - 1].trampoline;
+        if (false == TrampolineStore::MakeWritable(outerTrampoline)) return EResult::FailInternal;
+        outerTrampoline->SetChainTarget(newHookFunc);
+      }
+
+      chain[chainIndex].hookFunc = newHookFunc;
+    }
+    else
+    {
+      if (false == RetargetHook(originalFunc, trampoline, newHookFunc))
+        return EResult::FailInternal;
+    }
+
+    functionToTrampoline.erase(oldHookFunc);
+    functionToTrampoline[newHookFunc] = trampoline;
+
+    functionToTrampolineLookup.Erase(oldHookFunc);
+    functionToTrampolineLookup.Insert(newHookFunc, trampoline);
+
+    return EResult::Success;
+  }
+
+  EResult HookStore::GetHookStatistics(
+      const void* originalOrHookFunc, SHookStatistics* statistics)
+  {
+    if (nullptr == statistics) return EResult::FailInvalidArgument;
+
+    std::shared_lock<std::shared_mutex> lock(hookStoreMutex);
+    return GetHookStatisticsWithLockHeld(originalOrHookFunc, statistics);
+  }
+
+  EResult HookStore::GetHookStatisticsWithLockHeld(
+      const void* originalOrHookFunc, SHookStatistics* statistics)
+  {
+    // If this fails, the specified hook does not exist.
+    originalOrHookFunc = ResolveJumpThunkAlias(originalOrHookFunc);
+    if (0 == functionToTrampoline.count(originalOrHookFunc)) return EResult::FailNotFound;
+
+    return GetHookStatisticsForTrampolineWithLockHeld(
+        functionToTrampoline.at(originalOrHookFunc), statistics);
+  }
+
+  EResult HookStore::GetHookStatisticsForTrampolineWithLockHeld(
+      Trampoline* trampoline, SHookStatistics* statistics)
+  {
+    // All of the hooks chained onto the same original function share the instrumentation stub of
+    // the innermost trampoline, which is the one that the original function jumps to.
+    const void* const originalFunc = OriginalFunctionForTrampoline(trampoline);
+    if (nullptr != originalFunc) trampoline = functionToTrampoline.at(originalFunc);
+
+    // If this fails, the specified hook exists but is not instrumented.
+    const auto stubIter = trampolineToInstrumentationStub.find(trampoline);
+    if (trampolineToInstrumentationStub.end() == stubIter) return EResult::NoEffect;
+
+    *statistics = {.callCount = stubIter->second->GetInstrumentationStubCallCount()};
+    return EResult::Success;
+  }
+
+  void HookStore::CollectStatistics(
+      SharedStatistics::SRecord* records,
+      uint32_t maxRecords,
+      uint32_t* numHooks,
+      uint32_t* numRecords)
+  {
+    std::shared_lock<std::shared_mutex> lock(hookStoreMutex);
+    CollectStatisticsWithLockHeld(records, maxRecords, numHooks, numRecords);
+  }
+
+  bool HookStore::TryCollectStatistics(
+      SharedStatistics::SRecord* records,
+      uint32_t maxRecords,
+      uint32_t* numHooks,
+      uint32_t* numRecords)
+  {
+    std::shared_lock<std::shared_mutex> lock(hookStoreMutex, std::try_to_lock);
+    if (false == lock.owns_lock()) return false;
+
+    CollectStatisticsWithLockHeld(records, maxRecords, numHooks, numRecords);
+    return true;
+  }
+
+  void HookStore::CollectStatisticsWithLockHeld(
+      SharedStatistics::SRecord* records,
+      uint32_t maxRecords,
+      uint32_t* numHooks,
+      uint32_t* numRecords)
+  {
+    uint32_t numHooksFound = 0;
+    uint32_t recordIndex = 0;
+
+    // Every hook function, chained or otherwise, is a key of this map, and each one identifies a
+    // distinct trampoline. Original functions are also keys, but they are skipped.
+    for (const auto& functionAndTrampoline : functionToTrampoline)
+    {
+      const void* const originalFunc = OriginalFunctionForTrampoline(functionAndTrampoline.second);
+      if ((nullptr == originalFunc) || (functionAndTrampoline.first == originalFunc)) continue;
+
+      numHooksFound += 1;
+      if (recordIndex >= maxRecords) continue;
+
+      // Chained hooks share the instrumentation stub and the sampled timing stub of the innermost
+      // trampoline, exactly as for individual statistics and timing queries.
+      const Trampoline* const innermostTrampoline = functionToTrampoline.at(originalFunc);
+      const auto stubIter = trampolineToInstrumentationStub.find(innermostTrampoline);
+      const bool isInstrumented = (trampolineToInstrumentationStub.end() != stubIter);
+
+      records[recordIndex] = {
+          .originalFunc = static_cast<uint64_t>(reinterpret_cast<size_t>(originalFunc)),
+          .hookFunc = static_cast<uint64_t>(
+              reinterpret_cast<size_t>(HookFunctionForTrampoline(functionAndTrampoline.second))),
+          .callCount =
+              ((true == isInstrumented) ? stubIter->second->GetInstrumentationStubCallCount() : 0),
+          .flags = ((true == isInstrumented) ? SharedStatistics::kRecordFlagInstrumented : 0),
+          .numTopCallerSamples = 0,
+          .numSampledCalls = 0,
+          .sampledLatencyTicks = 0,
+          .topCaller = 0};
+
+      const auto sampledTimingIter = trampolineToSampledTiming.find(innermostTrampoline);
+      if (trampolineToSampledTiming.end() != sampledTimingIter)
+      {
+        SharedStatistics::SRecord& record = records[recordIndex];
+        const SampledTiming::SSampleBlock* const sampleBlock =
+            sampledTimingIter->second.sampleBlock;
+
+        uint64_t buckets[kHookTimingHistogramNumBuckets];
+        ReadSampleBlockBuckets(sampleBlock, buckets);
+        record.sampledLatencyTicks =
+            LatencyBudget::EstimatePercentile99Ticks(buckets, &record.numSampledCalls);
+        record.flags |= SharedStatistics::kRecordFlagSampled;
+
+        if (true == SampledTiming::IsCallerRecordingEnabled())
+        {
+          // Caller slots are written without synchronization by whichever thread is timing a call,
+          // so each one is read exactly once. There are few enough of them that counting each
+          // one's occurrences directly is cheaper than building a map.
+          uint64_t callers[SampledTiming::kNumCallerSlots];
+          for (size_t i = 0; i < SampledTiming::kNumCallerSlots; ++i)
+            callers[i] = *reinterpret_cast<volatile const uint64_t*>(&sampleBlock->callers[i]);
+
+          for (size_t i = 0; i < SampledTiming::kNumCallerSlots; ++i)
+          {
+            if (0 == callers[i]) continue;
+
+            uint32_t numOccurrences = 0;
+            for (size_t j = 0; j < SampledTiming::kNumCallerSlots; ++j)
+              if (callers[i] == callers[j]) numOccurrences += 1;
+
+            if (numOccurrences > record.numTopCallerSamples)
+            {
+              record.topCaller = callers[i];
+              record.numTopCallerSamples = numOccurrences;
+            }
+          }
+
+          record.flags |= SharedStatistics::kRecordFlagCallersRecorded;
+        }
+      }
+
+      recordIndex += 1;
+    }
+
+    *numHooks = numHooksFound;
+    *numRecords = recordIndex;
+  }
+
+  size_t HookStore::EnforceLatencyBudgets(uint64_t ticksPerMicrosecond)
+  {
+    /// Describes a hook that has exceeded its latency budget for too many checks in a row.
+    struct SExceededBudget
+    {
+      const void* originalFunc;
+      const void* hookFunc;
+      uint64_t percentile99Microseconds;
+      uint32_t budgetMicroseconds;
+      EResult result;
+    };
+
+    std::vector<SExceededBudget> exceededBudgets;
+
+    std::unique_lock<std::shared_mutex> lock(hookStoreMutex);
+
+    for (auto latencyBudgetIter = trampolineToLatencyBudget.begin();
+         latencyBudgetIter != trampolineToLatencyBudget.end();)
+    {
+      Trampoline* const trampoline = const_cast<Trampoline*>(latencyBudgetIter->first);
+      SLatencyBudget& latencyBudget = latencyBudgetIter->second;
+
+      const auto sampledTimingIter = trampolineToSampledTiming.find(trampoline);
+      if (trampolineToSampledTiming.end() == sampledTimingIter)
+      {
+        ++latencyBudgetIter;
+        continue;
+      }
+
+      uint64_t buckets[kHookTimingHistogramNumBuckets];
+      ReadSampleBlockBuckets(sampledTimingIter->second.sampleBlock, buckets);
+
+      uint64_t checkBuckets[kHookTimingHistogramNumBuckets];
+      for (size_t i = 0; i < kHookTimingHistogramNumBuckets; ++i)
+      {
+        checkBuckets[i] = buckets[i] - latencyBudget.previousBuckets[i];
+        latencyBudget.previousBuckets[i] = buckets[i];
+      }
+
+      uint64_t numSamples = 0;
+      const uint64_t percentile99Ticks =
+          LatencyBudget::EstimatePercentile99Ticks(checkBuckets, &numSamples);
+      if (numSamples < LatencyBudget::kMinSamplesPerCheck)
+      {
+        ++latencyBudgetIter;
+        continue;
+      }
+
+      if (percentile99Ticks <=
+          (static_cast<uint64_t>(latencyBudget.budgetMicroseconds) * ticksPerMicrosecond))
+      {
+        latencyBudget.numChecksOverBudget = 0;
+        ++latencyBudgetIter;
+        continue;
+      }
+
+      latencyBudget.numChecksOverBudget += 1;
+      if (latencyBudget.numChecksOverBudget < LatencyBudget::kNumChecksBeforeDisable)
+      {
+        ++latencyBudgetIter;
+        continue;
+      }
+
+      // The sampled durations of an innermost trampoline include every hook chained onto the same
+      // original function, so all of them are disabled together. Disabling a hook replaces its
+      // hook function with the original function region of its own trampoline, exactly as for
+      // hook groups, so a hook group that is enabled again restores it.
+      const void* const originalFunc = OriginalFunctionForTrampoline(trampoline);
+      std::vector<SChainedHook> hooksToDisable;
+      const auto chainIter = hookChains.find(originalFunc);
+      if ((hookChains.end() != chainIter) && (trampoline == functionToTrampoline.at(originalFunc)))
+        hooksToDisable = chainIter->second;
+      else
+        hooksToDisable.push_back({.hookFunc = HookFunctionForTrampoline(trampoline),
+                                  .trampoline = trampoline});
+
+      EResult disableResult = EResult::Success;
+
+      do
+      {
+        TrampolineStore::WriteWindow trampolineWriteWindow;
+
+        for (const SChainedHook& hookToDisable : hooksToDisable)
+        {
+          const void* const disabledHookFunc = hookToDisable.trampoline->GetOriginalFunction();
+          if (hookToDisable.hookFunc == disabledHookFunc) continue;
+
+          const EResult result =
+              ReplaceHookFunctionWithLockHeld(hookToDisable.hookFunc, disabledHookFunc);
+          if (EResult::Success == result)
+          {
+            const auto hookGroupIter = trampolineToHookGroup.find(hookToDisable.trampoline);
+            if (trampolineToHookGroup.end() != hookGroupIter)
+              hookGroupIter->second.enabledHookFunc = hookToDisable.hookFunc;
+          }
+          else if (EResult::Success == disableResult)
+          {
+            disableResult = result;
+          }
+        }
+      } while (false);
+
+      exceededBudgets.push_back(
+          {.originalFunc = originalFunc,
+           .hookFunc = hooksToDisable.front().hookFunc,
+           .percentile99Microseconds = percentile99Ticks / ticksPerMicrosecond,
+           .budgetMicroseconds = latencyBudget.budgetMicroseconds,
+           .result = disableResult});
+
+      latencyBudgetIter = trampolineToLatencyBudget.erase(latencyBudgetIter);
+    }
+
+    const size_t numRemainingBudgets = trampolineToLatencyBudget.size();
+    lock.unlock();
+
+    for (const SExceededBudget& exceededBudget : exceededBudgets)
+    {
+      Tracing::HookLatencyBudgetExceeded(
+          exceededBudget.originalFunc,
+          exceededBudget.hookFunc,
+          exceededBudget.percentile99Microseconds,
+          exceededBudget.budgetMicroseconds);
+
+      Infra::Message::OutputFormatted(
+          Infra::Message::ESeverity::Warning,
+          L"Hook for original function at 0x%llx exceeded its latency budget of %u microseconds with a 99th percentile duration of at least %llu microseconds. %s",
+          (long long)exceededBudget.originalFunc,
+          static_cast<unsigned int>(exceededBudget.budgetMicroseconds),
+          static_cast<unsigned long long>(exceededBudget.percentile99Microseconds),
+          ((EResult::Success == exceededBudget.result) ? L"The hook has been disabled."
+                                                       : L"The hook could not be disabled."));
+    }
+
+    return numRemainingBudgets;
+  }
+
+  size_t HookStore::RemoveFiredOneShotHooks(void)
+  {
+    std::vector<const void*> firedStubs;
+
+    // Almost every check finds nothing to remove, and checking modifies nothing, so it is done
+    // without excluding anything else that only reads the hook store. Hooks that were removed by
+    // other means are also picked up so that their entries can be discarded.
+    do
+    {
+      std::shared_lock<std::shared_mutex> lock(hookStoreMutex);
+
+      for (const auto& oneShotHook : oneShotHooks)
+      {
+        if ((0 != *oneShotHook.second.firedFlag) ||
+            (0 == functionToTrampoline.count(oneShotHook.first)))
+          firedStubs.push_back(oneShotHook.first);
+      }
+    } while (false);
+
+    // The lock is taken separately for each hook so that threads waiting for it are never kept
+    // waiting for more than one removal at a time.
+    for (const void* const firedStub : firedStubs)
+    {
+      std::unique_lock<std::shared_mutex> lock(hookStoreMutex);
+
+      oneShotHooks.erase(firedStub);
+      if (0 == functionToTrampoline.count(firedStub)) continue;
+
+      Trampoline* const trampoline = functionToTrampoline.at(firedStub);
+      const void* const originalFunc = OriginalFunctionForTrampoline(trampoline);
+
+      // Removing a hook also removes every other hook chained onto the same original function, so
+      // a one-shot hook that is part of a chain is disabled instead, which takes its stub out of
+      // the path of every call just the same.
+      EResult result = EResult::Success;
+      if (0 == hookChains.count(originalFunc))
+      {
+        result = RemoveInlineHookWithLockHeld(lock, firedStub, true);
+      }
+      else
+      {
+        TrampolineStore::WriteWindow trampolineWriteWindow;
+        result = ReplaceHookFunctionWithLockHeld(firedStub, trampoline->GetOriginalFunction());
+      }
+
+      if (EResult::Success == result) continue;
+
+      Infra::Message::OutputFormatted(
+          Infra::Message::ESeverity::Warning,
+          L"Failed to remove the one-shot hook for original function at 0x%llx after its first call.",
+          (long long)originalFunc);
+    }
+
+    std::shared_lock<std::shared_mutex> lock(hookStoreMutex);
+    return oneShotHooks.size();
+  }
+
+  size_t HookStore::SetHookTimingSampleIntervals(uint32_t sampleInterval)
+  {
+    std::unique_lock<std::shared_mutex> lock(hookStoreMutex);
+    TrampolineStore::WriteWindow trampolineWriteWindow;
+
+    size_t numChanged = 0;
+    for (auto& sampledTiming : trampolineToSampledTiming)
+    {
+      if (sampleInterval == sampledTiming.second.sampleInterval) continue;
+      if (false == TrampolineStore::MakeWritable(sampledTiming.second.stub)) continue;
+
+      sampledTiming.second.stub->SetSampledTimingStubInterval(sampleInterval);
+      sampledTiming.second.sampleInterval = sampleInterval;
+      numChanged += 1;
+    }
+
+    return numChanged;
+  }
+
+  size_t HookStore::SetSampledHookIntervals(uint32_t sampleInterval)
+  {
+    std::unique_lock<std::shared_mutex> lock(hookStoreMutex);
+    TrampolineStore::WriteWindow trampolineWriteWindow;
+
+    size_t numChanged = 0;
+    for (auto& sampledHook : sampledHooks)
+    {
+      if (sampleInterval == sampledHook.second.sampleInterval) continue;
+      if (0 == functionToTrampoline.count(sampledHook.first)) continue;
+      if (false == TrampolineStore::MakeWritable(sampledHook.second.stub)) continue;
+
+      sampledHook.second.stub->SetSampledHookStubInterval(sampleInterval);
+      sampledHook.second.sampleInterval = sampleInterval;
+      numChanged += 1;
+    }
+
+    return numChanged;
+  }
+
+  size_t HookStore::RepairOverwrittenPatches(void)
+  {
+    std::vector<HMODULE> moduleReferences;
+    const size_t numRepairs = RepairOverwrittenPatchesInternal(moduleReferences);
+
+    // Releasing the last reference to a module unloads it, which can invoke code that uses the
+    // hook store, so references are only released once the hook store lock is no longer held.
+    for (const HMODULE moduleReference : moduleReferences)
+      Protected::Windows_FreeLibrary(moduleReference);
+
+    return numRepairs;
+  }
+
+  size_t HookStore::RepairOverwrittenPatchesInternal(std::vector<HMODULE>& moduleReferences)
+  {
+    std::vector<HMODULE> moduleHandles;
+    bool patchSitesCurrent = false;
+
+    do
+    {
+      std::shared_lock<std::shared_mutex> lock(hookStoreMutex);
+
+      patchSitesCurrent = (false == patchSitesModified);
+      if (true == patchSitesCurrent) moduleHandles = patchSiteModules;
+    } while (false);
+
+    if (false == patchSitesCurrent)
+    {
+      std::unique_lock<std::shared_mutex> lock(hookStoreMutex);
+
+      IdentifyPatchSites();
+      moduleHandles = patchSiteModules;
+    }
+
+    // Nothing stops another thread from unloading a module while its patch sites are being read,
+    // so a reference to every such module is held for the rest of the check. Acquiring references
+    // can require the loader lock, which a thread creating hooks might hold while it waits for the
+    // hook store lock, so they are acquired without holding the hook store lock.
+    if (false == AcquireModuleReferences(moduleHandles, moduleReferences))
+    {
+      // Patch sites in modules that have been unloaded stop being monitored once the patch sites
+      // are identified again.
+      std::unique_lock<std::shared_mutex> lock(hookStoreMutex);
+
+      IdentifyPatchSites();
+      return 0;
+    }
+
+    std::vector<size_t> mismatches;
+
+    // Almost every check finds nothing to repair, and checking modifies nothing, so it is done
+    // without excluding anything else that only reads the hook store.
+    do
+    {
+      std::shared_lock<std::shared_mutex> lock(hookStoreMutex);
+
+      if ((true == patchSitesModified) || (false == ArePatchSiteModulesHeld(moduleReferences)))
+        break;
+
+      HookIntegrity::FindMismatchedPatchSites(patchSites, mismatches);
+      if (true == mismatches.empty()) return 0;
+    } while (false);
+
+    std::vector<SPendingRedirect> redirects;
+
+    do
+    {
+      std::unique_lock<std::shared_mutex> lock(hookStoreMutex);
+
+      // Patch sites are identified from the redirections that Hookshot itself would write, so any
+      // that are already overwritten when they are identified are found by the comparison below.
+      if (true == patchSitesModified) IdentifyPatchSites();
+
+      // Patch sites in any module that was not held when the check began are checked next time.
+      if (false == ArePatchSiteModulesHeld(moduleReferences)) return 0;
+
+      mismatches.clear();
+      HookIntegrity::FindMismatchedPatchSites(patchSites, mismatches);
+      if (true == mismatches.empty()) return 0;
+
+      redirects.reserve(mismatches.size());
+      for (const size_t mismatch : mismatches)
+        redirects.push_back(patchSiteRedirects[mismatch]);
+
+      // Repairs are written exactly as a committed transaction is written. Whatever overwrote a
+      // redirection almost always restored the original function's own bytes, which is what makes
+      // relocating threads stopped within them to the trampoline correct.
+      std::vector<SAffectedPage> affectedPages;
+      PlanRedirectExecutionBatch(redirects, affectedPages);
+
+      std::vector<HANDLE> suspendedThreads;
+      SuspendOtherThreads(suspendedThreads);
+
+      RelocateSuspendedThreads(suspendedThreads, redirects);
+      ApplyRedirectExecutionBatch(redirects, affectedPages);
+
+      ResumeThreads(suspendedThreads);
+    } while (false);
+
+    size_t numRepairs = 0;
+    for (const auto& redirect : redirects)
+    {
+      if (true == redirect.succeeded)
+      {
+        numRepairs += 1;
+        Infra::Message::OutputFormatted(
+            Infra::Message::ESeverity::Warning,
+            L"Redirection of original function at 0x%llx was overwritten and has been written again.",
+            (long long)redirect.from);
+      }
+      else
+      {
+        Infra::Message::OutputFormatted(
+            Infra::Message::ESeverity::Warning,
+            L"Redirection of original function at 0x%llx was overwritten and could not be written again.",
+            (long long)redirect.from);
+      }
+    }
+
+    return numRepairs;
+  }
+
+  EResult HookStore::RemoveHook(const void* originalOrHookFunc)
+  {
+    std::unique_lock<std::shared_mutex> lock(hookStoreMutex);
+
+    // If this fails, the specified hook is not an inline hook, but it might be an address table
+    // hook or a debug register hook.
+    originalOrHookFunc = ResolveJumpThunkAlias(originalOrHookFunc);
+    if (0 == functionToTrampoline.count(originalOrHookFunc))
+    {
+      lock.unlock();
+
+      const EResult addressTableResult =
+          AddressTableHooks::RemoveAddressTableHook(originalOrHookFunc);
+      if (EResult::FailNotFound != addressTableResult) return addressTableResult;
+
+      return DebugRegisterHooks::RemoveDebugRegisterHook(originalOrHookFunc);
+    }
+
+    return RemoveInlineHookWithLockHeld(lock, originalOrHookFunc, true);
+  }
+
+  EResult HookStore::RemoveInlineHookWithLockHeld(
+      std::unique_lock<std::shared_mutex>& lock,
+      const void* originalOrHookFunc,
+      bool restoreOriginalFunction)
+  {
+    // If this fails, internal data structures are inconsistent.
+    const void* const originalFunc =
+        OriginalFunctionForTrampoline(functionToTrampoline.at(originalOrHookFunc));
+    if (nullptr == originalFunc) return EResult::FailInternal;
+
+    Trampoline* const innermostTrampoline = functionToTrampoline.at(originalFunc);
+
+    std::vector<SChainedHook> removedHooks;
+    const auto chainIter = hookChains.find(originalFunc);
+    if (hookChains.end() != chainIter)
+      removedHooks = chainIter->second;
+    else
+      removedHooks.push_back(
+          {.hookFunc = HookFunctionForTrampoline(innermostTrampoline),
+           .trampoline = innermostTrampoline});
+
+    // Original functions whose hooks are pending in the open transaction or are disabled already
+    // hold their original bytes.
+    const bool isRedirectPending = IsRedirectPending(originalFunc);
+    const bool isRestoreNeeded = ((true == restoreOriginalFunction) &&
+        (false == isRedirectPending) && (0 == unhookedFunctions.count(originalFunc)));
+
+#ifdef _WIN64
+    const auto absoluteJumpPrologueIter = absoluteJumpPrologues.find(originalFunc);
+    const bool isAbsoluteJump = (absoluteJumpPrologues.end() != absoluteJumpPrologueIter);
+#else
+    constexpr bool isAbsoluteJump = false;
+#endif
+
+    std::array<uint8_t, kOriginalFunctionPrologueSizeBytes> originalFunctionPrologue = {};
+    if ((true == isRestoreNeeded) && (false == isAbsoluteJump))
+    {
+      // If this fails, internal data structures are inconsistent.
+      const auto prologueIter = originalFunctionPrologues.find(originalFunc);
+      if (originalFunctionPrologues.end() == prologueIter) return EResult::FailInternal;
+
+      originalFunctionPrologue = prologueIter->second;
+    }
+
+    // Everything that allocates memory needs to be done before other threads are suspended. Each
+    // removal begins a new reclamation epoch, and while other threads are suspended, any of them
+    // found to be executing, or able to return into, a trampoline retired during an earlier epoch
+    // keep it from being reclaimed. Those that are not have passed a quiescent point with respect
+    // to it.
+    reclamationEpoch += 1;
+    retiredTrampolines.reserve(retiredTrampolines.size() + removedHooks.size());
+
+    std::vector<HANDLE> suspendedThreads;
+    SuspendOtherThreads(suspendedThreads);
+
+    void* const from = const_cast<void*>(originalFunc);
+    bool restoreResult = true;
+    if (true == isRestoreNeeded)
+    {
+#ifdef _WIN64
+      if (true == isAbsoluteJump)
+        restoreResult = WriteJumpBytes(
+            from,
+            absoluteJumpPrologueIter->second.data(),
+            absoluteJumpPrologueIter->second.size());
+      else
+#endif
+        restoreResult =
+            ((0 != AtomicBlockSizeForJump(from))
+                 ? WriteJumpBytesAtomically(from, originalFunctionPrologue.data())
+                 : WriteJumpBytes(from, originalFunctionPrologue.data()));
+    }
+
+    // A thread might have taken the short jump at the entry point of a function laid out for
+    // hot-patching without yet taking the jump in the padding, which would then lead it to a
+    // trampoline that is about to be retired. That jump is therefore pointed at the instruction
+    // after the entry point and left behind, where it is harmless and is still recognized as
+    // hot-patch padding if the function is hooked again.
+    if ((true == restoreResult) && (true == restoreOriginalFunction) &&
+        (false == isRedirectPending) && (0 != hotPatchedFunctions.count(originalFunc)))
+    {
+      void* const jumpSite = JumpSiteForOriginalFunction(from, true);
+      uint8_t jumpBytes[X86Instruction::kJumpInstructionLengthBytes];
+      if (true ==
+          EncodeJumpBytes(
+              jumpSite,
+              &reinterpret_cast<const uint8_t*>(
+                  originalFunc)[X86Instruction::kHotPatchEntryLengthBytes],
+              jumpBytes))
+      {
+        if (0 != AtomicBlockSizeForJump(jumpSite))
+          WriteJumpBytesAtomically(jumpSite, jumpBytes);
+        else
+          WriteJumpBytes(jumpSite, jumpBytes);
+      }
+    }
+
+    if (true == restoreResult) MarkExecutingRetiredTrampolines(suspendedThreads);
+
+    ResumeThreads(suspendedThreads);
+
+    // If this fails, the original function cannot be modified, so the hook remains exactly as it
+    // was.
+    if (false == restoreResult) return EResult::FailInternal;
+
+    if (true == isRedirectPending)
+    {
+      transactionRedirects.erase(std::remove_if(
+          transactionRedirects.begin(),
+          transactionRedirects.end(),
+          [originalFunc](const SPendingRedirect& transactionRedirect) -> bool
+          {
+            return (originalFunc == transactionRedirect.from);
+          }),
+          transactionRedirects.end());
+    }
+
+    UpdateProtectedDependencyAddress(innermostTrampoline->GetOriginalFunction(), originalFunc);
+    UnregisterHook(innermostTrampoline);
+    RetireTrampolines(removedHooks);
+
+    const size_t numReclaimed = ReclaimRetiredTrampolines();
+    const size_t numRetired = retiredTrampolines.size();
+
+    lock.unlock();
+
+    Infra::Message::OutputFormatted(
+        Infra::Message::ESeverity::Info,
+        L"Removed %llu hook(s) from original function 0x%llx with %llu other thread(s) suspended, reclaiming %llu trampoline(s) and leaving %llu awaiting reclamation.",
+        (unsigned long long)removedHooks.size(),
+        (long long)originalFunc,
+        (unsigned long long)suspendedThreads.size(),
+        (unsigned long long)numReclaimed,
+        (unsigned long long)numRetired);
+
+    return EResult::Success;
+  }
+
+  EResult HookStore::InvalidateCodeRange(const void* rangeBase, size_t rangeSizeBytes)
+  {
+    const size_t rangeBegin = reinterpret_cast<size_t>(rangeBase);
+    const size_t rangeEnd = rangeBegin + rangeSizeBytes;
+    if ((nullptr == rangeBase) || (0 == rangeSizeBytes) || (rangeEnd < rangeBegin))
+      return EResult::FailInvalidArgument;
+
+    std::vector<const void*> invalidatedFuncs;
+
+    do
+    {
+      std::shared_lock<std::shared_mutex> lock(hookStoreMutex);
+
+      for (const auto& functionAndTrampoline : functionToTrampoline)
+      {
+        const size_t func = reinterpret_cast<size_t>(functionAndTrampoline.first);
+        if ((func < rangeBegin) || (func >= rangeEnd)) continue;
+
+        if (functionAndTrampoline.first ==
+            OriginalFunctionForTrampoline(functionAndTrampoline.second))
+          invalidatedFuncs.push_back(functionAndTrampoline.first);
+      }
+    } while (false);
+
+    if (true == invalidatedFuncs.empty()) return EResult::NoEffect;
+
+    // The code in the range is about to be discarded or reused, so the original functions are not
+    // restored, but their trampolines still go through reclamation because other threads might be
+    // executing them. The lock is taken separately for each hook, as it is for any other removal.
+    size_t numInvalidated = 0;
+    EResult result = EResult::Success;
+    for (const void* const invalidatedFunc : invalidatedFuncs)
+    {
+      std::unique_lock<std::shared_mutex> lock(hookStoreMutex);
+      if (0 == functionToTrampoline.count(invalidatedFunc)) continue;
+
+      const EResult removeResult = RemoveInlineHookWithLockHeld(lock, invalidatedFunc, false);
+      if (EResult::Success == removeResult)
+        numInvalidated += 1;
+      else if (EResult::Success == result)
+        result = removeResult;
+    }
+
+    Infra::Message::OutputFormatted(
+        Infra::Message::ESeverity::Info,
+        L"Invalidated %llu of %llu hook(s) in the code range 0x%llx to 0x%llx.",
+        (unsigned long long)numInvalidated,
+        (unsigned long long)invalidatedFuncs.size(),
+        (long long)rangeBegin,
+        (long long)rangeEnd);
+
+    return result;
+  }
+
+  EResult HookStore::CreateDeferredHook(
+      const wchar_t* moduleName, const char* exportName, const void* hookFunc)
+  {
+    return DeferredHooks::CreateDeferredHook(moduleName, exportName, hookFunc);
+  }
+
+  EResult HookStore::CreateHooksByExportName(
+      void* moduleHandle,
+      const char* const* exportNames,
+      const void* const* hookFuncs,
+      size_t numHooks,
+      EResult* results)
+  {
+    return CreateHooksByExportNameInternal(
+        this, moduleHandle, exportNames, hookFuncs, numHooks, results);
+  }
+
+  EResult HookStore::CreateHookWithKind(
+      EHookKind hookKind, void* originalFunc, const void* hookFunc, void* importingModule)
+  {
+    if (EHookKind::Inline == hookKind) return CreateHook(originalFunc, hookFunc);
+
+    // Virtual function table hooks identify what to hook by table entry rather than by function.
+    if (EHookKind::VirtualFunctionTable == hookKind) return EResult::FailInvalidArgument;
+
+    // A hook function that is also an inline hook function would make it ambiguous which hook is
+    // being identified.
+    do
+    {
+      std::shared_lock<std::shared_mutex> lock(hookStoreMutex);
+      if (true == IsFunctionInUse(hookFunc)) return EResult::FailDuplicate;
+
+      // Debug register hooks also trigger on the first instruction of the original function, which
+      // for an inline hook has already been replaced.
+      if ((EHookKind::DebugRegister == hookKind) && (0 != functionToTrampoline.count(originalFunc)))
+        return EResult::FailDuplicate;
+    } while (false);
+
+    if (EHookKind::DebugRegister == hookKind)
+      return DebugRegisterHooks::CreateDebugRegisterHook(originalFunc, hookFunc);
+
+    return AddressTableHooks::CreateAddressTableHook(
+        hookKind, originalFunc, hookFunc, reinterpret_cast<HMODULE>(importingModule));
+  }
+
+  EResult HookStore::CreateVirtualTableHooks(
+      void* virtualTable,
+      const size_t* slotIndices,
+      const void* const* hookFuncs,
+      size_t numHooks,
+      EResult* results)
+  {
+    if ((nullptr == virtualTable) ||
+        (((nullptr == slotIndices) || (nullptr == hookFuncs)) && (0 != numHooks)))
+      return EResult::FailInvalidArgument;
+    if (0 == numHooks) return EResult::NoEffect;
+
+    std::vector<EResult> localResults;
+    if (nullptr == results)
+    {
+      localResults.resize(numHooks);
+      results = localResults.data();
+    }
+
+    // Hook functions of inline hooks are rejected up front, just like in the other direction.
+    do
+    {
+      std::shared_lock<std::shared_mutex> lock(hookStoreMutex);
+      for (size_t i = 0; i < numHooks; ++i)
+        results[i] =
+            ((true == IsFunctionInUse(hookFuncs[i])) ? EResult::FailDuplicate : EResult::Success);
+    } while (false);
+
+    return AddressTableHooks::CreateVirtualTableHooks(
+        virtualTable, slotIndices, hookFuncs, numHooks, results);
+  }
+
+  EResult HookStore::SetHookReentrancyGuard(const void* originalOrHookFunc, bool enabled)
+  {
+    const size_t depthOffset = GetReentrancyGuardDepthOffset();
+    if ((true == enabled) && (0 == depthOffset)) return EResult::FailAllocation;
+
+    std::unique_lock<std::shared_mutex> lock(hookStoreMutex);
+
+    // If this fails, the specified hook does not exist or is not an inline hook.
+    originalOrHookFunc = ResolveJumpThunkAlias(originalOrHookFunc);
+    if (0 == functionToTrampoline.count(originalOrHookFunc)) return EResult::FailNotFound;
+
+    // If this fails, internal data structures are inconsistent.
+    void* const originalFunc = const_cast<void*>(
+        OriginalFunctionForTrampoline(functionToTrampoline.at(originalOrHookFunc)));
+    if (nullptr == originalFunc) return EResult::FailInternal;
+
+    // All of the hooks chained onto the same original function share the reentrancy guard of the
+    // innermost trampoline, which is the one that the original function jumps to, so a guarded
+    // thread bypasses the entire chain.
+    Trampoline* const trampoline = functionToTrampoline.at(originalFunc);
+
+    TrampolineStore::WriteWindow trampolineWriteWindow;
+
+    const auto reentrancyGuardIter = trampolineToReentrancyGuard.find(trampoline);
+    if (trampolineToReentrancyGuard.end() != reentrancyGuardIter)
+    {
+      SReentrancyGuard& reentrancyGuard = reentrancyGuardIter->second;
+      if (enabled == reentrancyGuard.enabled) return EResult::NoEffect;
+
+      reentrancyGuard.enabled = enabled;
+      if (false ==
+          UpdateReentrancyGuardStub(
+              trampoline,
+              reentrancyGuard,
+              reentrancyGuard.stub->GetReentrancyGuardStubHookTarget()))
+      {
+        reentrancyGuard.enabled = !enabled;
+        return EResult::FailInternal;
+      }
+
+      return EResult::Success;
+    }
+
+    if (false == enabled) return EResult::NoEffect;
+
+    TrampolineStore* stubStore = nullptr;
+    Trampoline* stub = nullptr;
+
+    const EResult allocateResult = AllocateTrampoline(originalFunc, &stubStore, &stub);
+    if (false == SuccessfulResult(allocateResult)) return allocateResult;
+
+    // Threads that are allowed to enter go wherever the trampoline currently goes, which might be
+    // the hook function, the outermost hook function of a chain, or any of the stubs that can sit
+    // in front of them.
+    const void* const previousHookTarget = trampoline->GetHookTrampolineTarget();
+    stub->SetReentrancyGuardStub(
+        depthOffset, previousHookTarget, trampoline->GetOriginalFunction());
+    RegisterTrampolineCallTargets();
+
+    const auto hookStubIter = trampolineToHookStub.find(trampoline);
+    const bool hasHookStub = (trampolineToHookStub.end() != hookStubIter);
+    if ((false == TrampolineStore::MakeWritable(trampoline)) ||
+        ((true == hasHookStub) && (false == TrampolineStore::MakeWritable(hookStubIter->second))))
+    {
+      DeallocateTrampoline(stub);
+      return EResult::FailInternal;
+    }
+
+    trampoline->SetHookFunction(stub->GetHookFunction());
+    if (true == hasHookStub)
+      Trampoline::SetHookCodeTarget(hookStubIter->second, stub->GetHookFunction());
+
+    // An original function that jumps directly to its hook function would skip the reentrancy
+    // guard stub entirely, so it needs to go through the trampoline instead. Until it does, nothing
+    // executes the reentrancy guard stub, so on failure it can be removed right away.
+    if (0 != directlyRedirectedFunctions.count(originalFunc))
+    {
+      if (false ==
+          RedirectExecutionAtomically(
+              originalFunc,
+              HookEntryForTrampoline(trampoline),
+              (0 != hotPatchedFunctions.count(originalFunc))))
+      {
+        trampoline->SetHookFunction(previousHookTarget);
+        if (true == hasHookStub)
+          Trampoline::SetHookCodeTarget(hookStubIter->second, previousHookTarget);
+
+        DeallocateTrampoline(stub);
+        return EResult::FailCannotSetHook;
+      }
+
+      directlyRedirectedFunctions.erase(originalFunc);
+    }
+
+    trampolineToReentrancyGuard[trampoline] = {.stub = stub, .enabled = true};
+    return EResult::Success;
+  }
+
+  size_t HookStore::GetReentrancyGuardDepthOffset(void)
+  {
+    static const size_t depthOffset = []() -> size_t
+    {
+      const size_t slotOffset = AllocateThreadEnvironmentBlockSlot();
+      if (0 == slotOffset)
+      {
+        Infra::Message::Output(
+            Infra::Message::ESeverity::Warning,
+            L"Hook reentrancy guards are unavailable because no thread-local storage slot could be allocated in the thread environment block.");
+      }
+
+      return slotOffset;
+    }();
+
+    return depthOffset;
+  }
+
+  EResult HookStore::SetHookCallerFilter(
+      const void* originalOrHookFunc, const void* const* callerModules, size_t numCallerModules)
+  {
+    if ((0 != numCallerModules) && (nullptr == callerModules)) return EResult::FailInvalidArgument;
+
+    // Caller address ranges are computed from module headers before the lock is acquired. Ranges
+    // of modules loaded next to each other are merged, and the sentinel at the end guarantees that
+    // the caller filter stub always finds a range that ends after the return address.
+    std::vector<Trampoline::SCallerAddressRange> rangeTable;
+    rangeTable.reserve(numCallerModules + 1);
+
+    for (size_t i = 0; i < numCallerModules; ++i)
+    {
+      const IMAGE_DOS_HEADER* const dosHeader =
+          reinterpret_cast<const IMAGE_DOS_HEADER*>(callerModules[i]);
+      if ((nullptr == dosHeader) || (IMAGE_DOS_SIGNATURE != dosHeader->e_magic))
+        return EResult::FailInvalidArgument;
+
+      const IMAGE_NT_HEADERS* const ntHeader = reinterpret_cast<const IMAGE_NT_HEADERS*>(
+          reinterpret_cast<size_t>(dosHeader) + static_cast<size_t>(dosHeader->e_lfanew));
+      if (IMAGE_NT_SIGNATURE != ntHeader->Signature) return EResult::FailInvalidArgument;
+
+      rangeTable.push_back(
+          {.begin = reinterpret_cast<size_t>(dosHeader),
+           .end = reinterpret_cast<size_t>(dosHeader) +
+               static_cast<size_t>(ntHeader->OptionalHeader.SizeOfImage)});
+    }
+
+    std::sort(
+        rangeTable.begin(),
+        rangeTable.end(),
+        [](const Trampoline::SCallerAddressRange& a, const Trampoline::SCallerAddressRange& b)
+            -> bool
+        {
+          return (a.begin < b.begin);
+        });
+
+    size_t numMergedRanges = 0;
+    for (const auto& range : rangeTable)
+    {
+      if ((0 != numMergedRanges) && (range.begin <= rangeTable[numMergedRanges - 1].end))
+        rangeTable[numMergedRanges - 1].end =
+            std::max(rangeTable[numMergedRanges - 1].end, range.end);
+      else
+        rangeTable[numMergedRanges++] = range;
+    }
+
+    rangeTable.resize(numMergedRanges);
+    rangeTable.push_back({.begin = SIZE_MAX, .end = SIZE_MAX});
+
+    const bool enabled = (0 != numCallerModules);
+
+    std::unique_lock<std::shared_mutex> lock(hookStoreMutex);
+
+    // If this fails, the specified hook does not exist or is not an inline hook.
+    originalOrHookFunc = ResolveJumpThunkAlias(originalOrHookFunc);
+    if (0 == functionToTrampoline.count(originalOrHookFunc)) return EResult::FailNotFound;
+
+    // If this fails, internal data structures are inconsistent.
+    void* const originalFunc = const_cast<void*>(
+        OriginalFunctionForTrampoline(functionToTrampoline.at(originalOrHookFunc)));
+    if (nullptr == originalFunc) return EResult::FailInternal;
+
+    // All of the hooks chained onto the same original function share the caller filter of the
+    // innermost trampoline, exactly as for reentrancy guards.
+    Trampoline* const trampoline = functionToTrampoline.at(originalFunc);
+
+    TrampolineStore::WriteWindow trampolineWriteWindow;
+
+    const auto callerFilterIter = trampolineToCallerFilter.find(trampoline);
+    if (trampolineToCallerFilter.end() != callerFilterIter)
+    {
+      SCallerFilter& callerFilter = callerFilterIter->second;
+      if ((false == enabled) && (false == callerFilter.enabled)) return EResult::NoEffect;
+
+      if (false == TrampolineStore::MakeWritable(callerFilter.stub)) return EResult::FailInternal;
+
+      // The new table is published before the caller filter is enabled so that the caller filter
+      // stub never scans a table that has already been freed.
+      if (true == enabled)
+      {
+        callerFilter.rangeTables.push_back(std::move(rangeTable));
+        callerFilter.stub->SetCallerFilterStubRanges(callerFilter.rangeTables.back().data());
+      }
+
+      callerFilter.enabled = enabled;
+      if (false ==
+          UpdateCallerFilterStub(
+              trampoline, callerFilter, callerFilter.stub->GetCallerFilterStubHookTarget()))
+        return EResult::FailInternal;
+
+      return EResult::Success;
+    }
+
+    if (false == enabled) return EResult::NoEffect;
+
+    TrampolineStore* stubStore = nullptr;
+    Trampoline* stub = nullptr;
+
+    const EResult allocateResult = AllocateTrampoline(originalFunc, &stubStore, &stub);
+    if (false == SuccessfulResult(allocateResult)) return allocateResult;
+
+    SCallerFilter callerFilter = {.stub = stub, .rangeTables = {}, .enabled = true};
+    callerFilter.rangeTables.push_back(std::move(rangeTable));
+
+    // Caller filter stubs always sit behind reentrancy guard stubs, so a guarded hook gets its
+    // caller filter stub inserted between its reentrancy guard stub and wherever that currently
+    // goes. Since the reentrancy guard stub is already executing, nothing else needs to change.
+    const auto reentrancyGuardIter = trampolineToReentrancyGuard.find(trampoline);
+    if (trampolineToReentrancyGuard.end() != reentrancyGuardIter)
+    {
+      stub->SetCallerFilterStub(
+          callerFilter.rangeTables.back().data(),
+          reentrancyGuardIter->second.stub->GetReentrancyGuardStubHookTarget(),
+          trampoline->GetOriginalFunction());
+      RegisterTrampolineCallTargets();
+
+      if (false ==
+          UpdateReentrancyGuardStub(
+              trampoline, reentrancyGuardIter->second, stub->GetHookFunction()))
+      {
+        DeallocateTrampoline(stub);
+        return EResult::FailInternal;
+      }
+
+      trampolineToCallerFilter[trampoline] = std::move(callerFilter);
+      return EResult::Success;
+    }
+
+    // Calls that are accepted go wherever the trampoline currently goes, which might be the hook
+    // function, the outermost hook function of a chain, or any of the stubs that can sit in front
+    // of them.
+    const void* const previousHookTarget = trampoline->GetHookTrampolineTarget();
+    stub->SetCallerFilterStub(
+        callerFilter.rangeTables.back().data(),
+        previousHookTarget,
+        trampoline->GetOriginalFunction());
+    RegisterTrampolineCallTargets();
+
+    const auto hookStubIter = trampolineToHookStub.find(trampoline);
+    const bool hasHookStub = (trampolineToHookStub.end() != hookStubIter);
+    if ((false == TrampolineStore::MakeWritable(trampoline)) ||
+        ((true == hasHookStub) && (false == TrampolineStore::MakeWritable(hookStubIter->second))))
+    {
+      DeallocateTrampoline(stub);
+      return EResult::FailInternal;
+    }
+
+    trampoline->SetHookFunction(stub->GetHookFunction());
+    if (true == hasHookStub)
+      Trampoline::SetHookCodeTarget(hookStubIter->second, stub->GetHookFunction());
+
+    // An original function that jumps directly to its hook function would skip the caller filter
+    // stub entirely, so it needs to go through the trampoline instead, just like for reentrancy
+    // guards.
+    if (0 != directlyRedirectedFunctions.count(originalFunc))
+    {
+      if (false ==
+          RedirectExecutionAtomically(
+              originalFunc,
+              HookEntryForTrampoline(trampoline),
+              (0 != hotPatchedFunctions.count(originalFunc))))
+      {
+        trampoline->SetHookFunction(previousHookTarget);
+        if (true == hasHookStub)
+          Trampoline::SetHookCodeTarget(hookStubIter->second, previousHookTarget);
+
+        DeallocateTrampoline(stub);
+        return EResult::FailCannotSetHook;
+      }
+
+      directlyRedirectedFunctions.erase(originalFunc);
+    }
+
+    trampolineToCallerFilter[trampoline] = std::move(callerFilter);
+    return EResult::Success;
+  }
+
+  size_t HookStore::GetThreadOverrideTableOffset(void)
+  {
+    static const size_t tableOffset = []() -> size_t
+    {
+      const size_t slotOffset = AllocateThreadEnvironmentBlockSlot();
+      if (0 == slotOffset)
+      {
+        Infra::Message::Output(
+            Infra::Message::ESeverity::Warning,
+            L"Thread hook overrides are unavailable because no thread-local storage slot could be allocated in the thread environment block.");
+      }
+
+      return slotOffset;
+    }();
+
+    return tableOffset;
+  }
+
+  EResult HookStore::SetThreadHookOverride(
+      const void* originalOrHookFunc, const void* overrideFunc)
+  {
+    const size_t tableOffset = GetThreadOverrideTableOffset();
+    if (0 == tableOffset) return EResult::FailAllocation;
+
+    std::unique_lock<std::shared_mutex> lock(hookStoreMutex);
+
+    // If this fails, the specified hook does not exist or is not an inline hook.
+    originalOrHookFunc = ResolveJumpThunkAlias(originalOrHookFunc);
+    if (0 == functionToTrampoline.count(originalOrHookFunc)) return EResult::FailNotFound;
+
+    // If this fails, internal data structures are inconsistent.
+    void* const originalFunc = const_cast<void*>(
+        OriginalFunctionForTrampoline(functionToTrampoline.at(originalOrHookFunc)));
+    if (nullptr == originalFunc) return EResult::FailInternal;
+
+    // All of the hooks chained onto the same original function share the thread override of the
+    // innermost trampoline, so an override replaces the entire chain on the calling thread.
+    Trampoline* const trampoline = functionToTrampoline.at(originalFunc);
+
+    // Jumping to the original function would just re-enter the hook, so bypassing the hook is done
+    // by jumping to the original function region of the trampoline instead.
+    const void* const overrideTarget =
+        ((originalFunc == overrideFunc) ? trampoline->GetOriginalFunction() : overrideFunc);
+
+    auto threadOverrideIter = trampolineToThreadOverride.find(trampoline);
+    if (trampolineToThreadOverride.end() == threadOverrideIter)
+    {
+      if (nullptr == overrideFunc) return EResult::NoEffect;
+      if (kMaxThreadOverrides == numThreadOverrides) return EResult::FailAllocation;
+
+      TrampolineStore* stubStore = nullptr;
+      Trampoline* stub = nullptr;
+
+      const EResult allocateResult = AllocateTrampoline(originalFunc, &stubStore, &stub);
+      if (false == SuccessfulResult(allocateResult)) return allocateResult;
+
+      TrampolineStore::WriteWindow trampolineWriteWindow;
+
+      // Whatever currently transfers control to the hook function, which might be the trampoline
+      // or any of the stubs that can sit in front of the hook function, is pointed at the thread
+      // override stub instead. Within a chain, the innermost trampoline leads to the outermost
+      // hook function.
+      const auto chainIter = hookChains.find(originalFunc);
+      const void* const hookFunc =
+          ((hookChains.end() != chainIter) ? chainIter->second.front().hookFunc
+                                           : HookFunctionForTrampoline(trampoline));
+
+      stub->SetThreadOverrideStub(tableOffset, numThreadOverrides, hookFunc);
+      RegisterTrampolineCallTargets();
+
+      if (false == RetargetTrampoline(trampoline, stub->GetHookFunction()))
+      {
+        DeallocateTrampoline(stub);
+        return EResult::FailInternal;
+      }
+
+      // An original function that jumps directly to its hook function would skip the thread
+      // override stub entirely, so it needs to go through the trampoline instead, just like for
+      // caller filters.
+      if (0 != directlyRedirectedFunctions.count(originalFunc))
+      {
+        if (false ==
+            RedirectExecutionAtomically(
+                originalFunc,
+                HookEntryForTrampoline(trampoline),
+                (0 != hotPatchedFunctions.count(originalFunc))))
+        {
+          RetargetTrampoline(trampoline, hookFunc);
+          DeallocateTrampoline(stub);
+          return EResult::FailCannotSetHook;
+        }
+
+        directlyRedirectedFunctions.erase(originalFunc);
+      }
+
+      threadOverrideIter =
+          trampolineToThreadOverride
+              .insert({trampoline, {.stub = stub, .index = numThreadOverrides}})
+              .first;
+      numThreadOverrides += 1;
+    }
+
+    // Each thread only ever accesses its own table, so the table itself needs no synchronization.
+    if (nullptr == threadOverrideTableOwner.table)
+    {
+      if (nullptr == overrideFunc) return EResult::NoEffect;
+
+      threadOverrideTableOwner.tableOffset = tableOffset;
+      threadOverrideTableOwner.table = std::make_unique<const void*[]>(kMaxThreadOverrides);
+      WriteThreadOverrideTablePointer(tableOffset, threadOverrideTableOwner.table.get());
+    }
+
+    threadOverrideTableOwner.table[threadOverrideIter->second.index] = overrideTarget;
+    return EResult::Success;
+  }
+
+  EResult HookStore::CreateCallTraceHook(void* originalFunc)
+  {
+    return CreateCallTraceHookInternal(originalFunc);
+  }
+
+  EResult HookStore::CreateCallTraceHookInternal(void* originalFunc)
+  {
+    const void* const recorder = CallTracing::GetRecorder();
+    if (nullptr == recorder) return EResult::FailAllocation;
+    if (false == IsHookSpecValid(originalFunc, recorder)) return EResult::FailInvalidArgument;
+
+    Trampoline::SDecodedOriginalFunction decodedOriginalFunction;
+    const Trampoline::SDecodedOriginalFunction* const decoded =
+        ((true == Trampoline::DecodeOriginalFunction(originalFunc, &decodedOriginalFunction))
+             ? &decodedOriginalFunction
+             : nullptr);
+
+    std::unique_lock<std::shared_mutex> lock(hookStoreMutex);
+    TrampolineStore::WriteWindow trampolineWriteWindow;
+
+    TrampolineStore* stubStore = nullptr;
+    Trampoline* stub = nullptr;
+
+    const EResult allocateResult = AllocateTrampoline(originalFunc, &stubStore, &stub);
+    if (false == SuccessfulResult(allocateResult)) return allocateResult;
+
+    // The call trace stub is the hook function, so it gets its target only once the trampoline
+    // whose original function region it targets exists, which is before the hook can take effect.
+    stub->SetCallTraceStub(recorder, originalFunc);
+    callTraceStubs[stub->GetHookFunction()] = stub;
+
+    const auto installStartTime = std::chrono::steady_clock::now();
+    Tracing::CreateHookStart(originalFunc, stub->GetHookFunction());
+    const EResult result =
+        CreateHookWithLockHeld(originalFunc, stub->GetHookFunction(), false, nullptr, decoded);
+    Tracing::CreateHookStop(originalFunc, stub->GetHookFunction(), result);
+    ExitSummary::RecordInstall(result, installStartTime);
+
+    // Once the hook exists, the call trace stub is never deallocated, even if the hook is later
+    // removed, because threads might still be executing it.
+    if (false == SuccessfulResult(result))
+    {
+      callTraceStubs.erase(stub->GetHookFunction());
+      stubStore->Deallocate(stub);
+      SharedStatistics::CountInstallFailure();
+    }
+
+    return result;
+  }
+
+  EResult HookStore::GetHookTimingHistogram(
+      const void* originalOrHookFunc, SHookTimingHistogram* histogram)
+  {
+    if (nullptr == histogram) return EResult::FailInvalidArgument;
+
+    std::shared_lock<std::shared_mutex> lock(hookStoreMutex);
+
+    // If this fails, the specified hook does not exist.
+    originalOrHookFunc = ResolveJumpThunkAlias(originalOrHookFunc);
+    if (0 == functionToTrampoline.count(originalOrHookFunc)) return EResult::FailNotFound;
+
+    // All of the hooks chained onto the same original function share the sampled timing stub of
+    // the innermost trampoline, exactly as for statistics queries.
+    Trampoline* trampoline = functionToTrampoline.at(originalOrHookFunc);
+    const void* const originalFunc = OriginalFunctionForTrampoline(trampoline);
+    if (nullptr != originalFunc) trampoline = functionToTrampoline.at(originalFunc);
+
+    // If this fails, the specified hook exists but its timing is not sampled.
+    const auto sampledTimingIter = trampolineToSampledTiming.find(trampoline);
+    if (trampolineToSampledTiming.end() == sampledTimingIter) return EResult::NoEffect;
+
+    histogram->sampleInterval = sampledTimingIter->second.sampleInterval;
+    ReadSampleBlockBuckets(sampledTimingIter->second.sampleBlock, histogram->buckets);
+
+    return EResult::Success;
+  }
+
+  EResult HookStore::SetHookLatencyBudget(
+      const void* originalOrHookFunc, uint32_t budgetMicroseconds)
+  {
+    std::unique_lock<std::shared_mutex> lock(hookStoreMutex);
+
+    // If this fails, the specified hook does not exist.
+    originalOrHookFunc = ResolveJumpThunkAlias(originalOrHookFunc);
+    if (0 == functionToTrampoline.count(originalOrHookFunc)) return EResult::FailNotFound;
+
+    // Latency budgets apply to sampled durations, so they follow sampled timing stubs, which
+    // chained hooks share with the innermost trampoline.
+    Trampoline* trampoline = functionToTrampoline.at(originalOrHookFunc);
+    const void* const originalFunc = OriginalFunctionForTrampoline(trampoline);
+    if (nullptr != originalFunc) trampoline = functionToTrampoline.at(originalFunc);
+
+    if (0 == budgetMicroseconds)
+    {
+      return (
+          (0 != trampolineToLatencyBudget.erase(trampoline)) ? EResult::Success
+                                                             : EResult::NoEffect);
+    }
+
+    // If this fails, the specified hook exists but its timing is not sampled.
+    const auto sampledTimingIter = trampolineToSampledTiming.find(trampoline);
+    if (trampolineToSampledTiming.end() == sampledTimingIter) return EResult::NoEffect;
+
+    // Calls sampled before the budget was set do not count against it.
+    const auto latencyBudgetIter = trampolineToLatencyBudget.find(trampoline);
+    if (trampolineToLatencyBudget.end() == latencyBudgetIter)
+    {
+      SLatencyBudget& latencyBudget = trampolineToLatencyBudget[trampoline];
+      latencyBudget = {.budgetMicroseconds = budgetMicroseconds, .numChecksOverBudget = 0};
+      ReadSampleBlockBuckets(sampledTimingIter->second.sampleBlock, latencyBudget.previousBuckets);
+    }
+    else
+    {
+      latencyBudgetIter->second.budgetMicroseconds = budgetMicroseconds;
+    }
+
+    LatencyBudget::ScheduleCheck();
+
+    return EResult::Success;
+  }
+
+  EResult HookStore::ReserveHooks(
+      size_t numHooks, const void* const* targetModules, size_t numTargetModules)
+  {
+    if ((nullptr == targetModules) && (0 != numTargetModules)) return EResult::FailInvalidArgument;
+    if (0 == numHooks) return EResult::NoEffect;
+
+    std::unique_lock<std::shared_mutex> lock(hookStoreMutex);
+
+    functionToTrampoline.reserve(functionToTrampoline.size() + (numHooks * 2));
+    originalFunctionPrologues.reserve(originalFunctionPrologues.size() + numHooks);
+
+    // Placing trampoline stores appends to the vector that holds them, which moves all of the
+    // existing ones whenever it grows, so enough room is made for the worst case up front.
+    const size_t maxTrampolinesPerStore =
+        static_cast<size_t>(TrampolineStore::kTrampolineStoreSizeBytes) / sizeof(Trampoline);
+    trampolines.reserve(
+        trampolines.size() + (numHooks / maxTrampolinesPerStore) + numTargetModules + 1);
+
+    EResult result = EResult::Success;
+
+#ifdef _WIN64
+    const size_t numHooksPerModule =
+        ((0 == numTargetModules) ? 0 : ((numHooks + numTargetModules - 1) / numTargetModules));
+
+    for (size_t i = 0; i < numTargetModules; ++i)
+    {
+      void* const baseAddress = BaseAddressForOriginalFunc(targetModules[i]);
+      if (nullptr == baseAddress)
+      {
+        result = EResult::FailInvalidArgument;
+        continue;
+      }
+
+      SNearModuleStores& nearModuleStores = trampolineStoreMap[baseAddress];
+
+      size_t numFreeTrampolines = 0;
+      for (const int storeIndex : nearModuleStores.storeIndices)
+        numFreeTrampolines += static_cast<size_t>(trampolines[storeIndex].FreeCount());
+
+      while (numFreeTrampolines < numHooksPerModule)
+      {
+        const int newStoreIndex = PlaceTrampolineStoreNear(baseAddress, nearModuleStores, INT_MAX);
+        if (newStoreIndex < 0)
+        {
+          result = EResult::FailAllocation;
+          break;
+        }
+
+        numFreeTrampolines += static_cast<size_t>(trampolines[newStoreIndex].FreeCount());
+      }
+    }
+#else
+    size_t numFreeTrampolines = 0;
+    for (const auto& trampolineStore : trampolines)
+      numFreeTrampolines += static_cast<size_t>(trampolineStore.FreeCount());
+
+    while (numFreeTrampolines < numHooks)
+    {
+      trampolines.emplace_back();
+      if (false == trampolines.back().IsInitialized())
+      {
+        trampolines.pop_back();
+        result = EResult::FailAllocation;
+        break;
+      }
+
+      trampolineStoreIndices[trampolines.back().BaseAddress()] = trampolines.size() - 1;
+      numFreeTrampolines += static_cast<size_t>(trampolines.back().FreeCount());
+    }
+#endif
+
+    return result;
+  }
+
+  EResult HookStore::SnapshotHooks(SHookInfo* hookInfo, size_t maxHookInfo, size_t* numHooks)
+  {
+    if (nullptr == numHooks) return EResult::FailInvalidArgument;
+    if ((nullptr == hookInfo) && (0 != maxHookInfo)) return EResult::FailInvalidArgument;
+
+    std::shared_lock<std::shared_mutex> lock(hookStoreMutex);
+
+    size_t numHooksFound = 0;
+
+    // Every hook function, chained or otherwise, is a key of this map, and each one identifies a
+    // distinct trampoline. Original functions are also keys, but they are skipped.
+    for (const auto& functionAndTrampoline : functionToTrampoline)
+    {
+      const void* const originalFunc = OriginalFunctionForTrampoline(functionAndTrampoline.second);
+      if ((nullptr == originalFunc) || (functionAndTrampoline.first == originalFunc)) continue;
+
+      numHooksFound += 1;
+      if (numHooksFound > maxHookInfo) continue;
+
+      // Chained hooks share the instrumentation stub of the innermost trampoline, exactly as for
+      // individual statistics queries.
+      const Trampoline* const innermostTrampoline = functionToTrampoline.at(originalFunc);
+      const auto stubIter = trampolineToInstrumentationStub.find(innermostTrampoline);
+      const bool isInstrumented = (trampolineToInstrumentationStub.end() != stubIter);
+
+      uint32_t flags = 0;
+      if (0 != unhookedFunctions.count(originalFunc)) flags |= kHookInfoFlagDisabled;
+      if (true == IsRedirectPending(originalFunc)) flags |= kHookInfoFlagPending;
+      if (0 != hookChains.count(originalFunc)) flags |= kHookInfoFlagChained;
+      if (true == isInstrumented) flags |= kHookInfoFlagInstrumented;
+
+      hookInfo[numHooksFound - 1] = {
+          .originalFunc = originalFunc,
+          .hookFunc = functionAndTrampoline.first,
+          .originalFuncAfterHook = functionAndTrampoline.second->GetOriginalFunction(),
+          .callCount =
+              ((true == isInstrumented) ? stubIter->second->GetInstrumentationStubCallCount() : 0),
+          .flags = flags};
+    }
+
+    *numHooks = numHooksFound;
+    return EResult::Success;
+  }
+
+  EResult HookStore::SetHookGroup(const void* originalOrHookFunc, uint32_t groupId)
+  {
+    std::unique_lock<std::shared_mutex> lock(hookStoreMutex);
+
+    // If this fails, the specified hook does not exist.
+    originalOrHookFunc = ResolveJumpThunkAlias(originalOrHookFunc);
+    if (0 == functionToTrampoline.count(originalOrHookFunc)) return EResult::FailNotFound;
+
+    const Trampoline* const trampoline = functionToTrampoline.at(originalOrHookFunc);
+
+    // If this fails, internal data structures are inconsistent.
+    if (nullptr == OriginalFunctionForTrampoline(trampoline)) return EResult::FailInternal;
+
+    const auto memberIter = trampolineToHookGroup.find(trampoline);
+
+    if (kHookGroupNone == groupId)
+    {
+      if (trampolineToHookGroup.end() == memberIter) return EResult::NoEffect;
+
+      trampolineToHookGroup.erase(memberIter);
+      return EResult::Success;
+    }
+
+    if (trampolineToHookGroup.end() != memberIter)
+    {
+      if (groupId == memberIter->second.groupId) return EResult::NoEffect;
+
+      memberIter->second.groupId = groupId;
+      return EResult::Success;
+    }
+
+    // A hook that is currently disabled has no hook function of its own, so it stays disabled
+    // when its group is enabled, until it is given a hook function some other way.
+    trampolineToHookGroup[trampoline] = {
+        .groupId = groupId, .enabledHookFunc = HookFunctionForTrampoline(trampoline)};
+    return EResult::Success;
+  }
+
+  EResult HookStore::SetHookGroupEnabled(uint32_t groupId, bool enabled)
+  {
+    if (kHookGroupNone == groupId) return EResult::FailInvalidArgument;
+
+    std::unique_lock<std::shared_mutex> lock(hookStoreMutex);
+
+    EResult firstFailure = EResult::Success;
+    size_t numHooksChanged = 0;
+
+    do
+    {
+      TrampolineStore::WriteWindow trampolineWriteWindow;
+
+      for (auto& trampolineAndMember : trampolineToHookGroup)
+      {
+        SHookGroupMember& member = trampolineAndMember.second;
+        if (groupId != member.groupId) continue;
+
+        // Disabling a hook replaces its hook function with the original function region of its
+        // own trampoline, so that is how a disabled hook is recognized.
+        const Trampoline* const trampoline = trampolineAndMember.first;
+        const void* const disabledHookFunc = trampoline->GetOriginalFunction();
+        const void* const currentHookFunc = HookFunctionForTrampoline(trampoline);
+
+        const void* const newHookFunc =
+            ((true == enabled) ? member.enabledHookFunc : disabledHookFunc);
+        if (currentHookFunc == newHookFunc) continue;
+
+        const EResult result = ReplaceHookFunctionWithLockHeld(currentHookFunc, newHookFunc);
+        if (EResult::Success == result)
+        {
+          if (false == enabled) member.enabledHookFunc = currentHookFunc;
+          numHooksChanged += 1;
+        }
+        else if (EResult::Success == firstFailure)
+        {
+          firstFailure = result;
+        }
+      }
+    } while (false);
+
+    lock.unlock();
+
+    if (0 != numHooksChanged)
+    {
+      Infra::Message::OutputFormatted(
+          Infra::Message::ESeverity::Debug,
+          L"%s %llu hook(s) in hook group %u.",
+          ((true == enabled) ? L"Enabled" : L"Disabled"),
+          static_cast<unsigned long long>(numHooksChanged),
+          static_cast<unsigned int>(groupId));
+    }
+
+    if (EResult::Success != firstFailure) return firstFailure;
+    return ((0 != numHooksChanged) ? EResult::Success : EResult::NoEffect);
+  }
+
+  EResult HookStore::BeginCreateHooksAsync(
+      const SHookSpec* hookSpecs,
+      size_t numHookSpecs,
+      THookInstallProgressCallback progressCallback,
+      void* progressCallbackContext,
+      SHookInstallOperation** operation)
+  {
+    return AsyncHookInstall::Begin(
+        this, hookSpecs, numHookSpecs, progressCallback, progressCallbackContext, operation);
+  }
+
+  EResult HookStore::CancelHookInstall(SHookInstallOperation* operation)
+  {
+    return AsyncHookInstall::Cancel(operation);
+  }
+
+  EResult HookStore::WaitForHookInstall(SHookInstallOperation* operation, EResult* results)
+  {
+    return AsyncHookInstall::Wait(operation, results);
+  }
+
+  EResult HookStore::CreateCallbackHook(
+      void* originalFunc,
+      TCallbackHookPre preCallback,
+      TCallbackHookPost postCallback,
+      void* context)
+  {
+    if ((nullptr == preCallback) && (nullptr == postCallback)) return EResult::FailInvalidArgument;
+
+    const void* const dispatcher = CallbackHooks::GetDispatcher();
+    if (nullptr == dispatcher) return EResult::FailAllocation;
+    if (false == IsHookSpecValid(originalFunc, dispatcher)) return EResult::FailInvalidArgument;
+
+    Trampoline::SDecodedOriginalFunction decodedOriginalFunction;
+    const Trampoline::SDecodedOriginalFunction* const decoded =
+        ((true == Trampoline::DecodeOriginalFunction(originalFunc, &decodedOriginalFunction))
+             ? &decodedOriginalFunction
+             : nullptr);
+
+    std::unique_lock<std::shared_mutex> lock(hookStoreMutex);
+    TrampolineStore::WriteWindow trampolineWriteWindow;
+
+    TrampolineStore* stubStore = nullptr;
+    Trampoline* stub = nullptr;
+
+    const EResult allocateResult = AllocateTrampoline(originalFunc, &stubStore, &stub);
+    if (false == SuccessfulResult(allocateResult)) return allocateResult;
+
+    // A callback hook stub is a call trace stub that transfers control to the callback dispatch
+    // code instead of the call recording code and identifies a descriptor instead of a trace.
+    callbackHookDescriptors.push_front(
+        {.preCallback = preCallback,
+         .postCallback = postCallback,
+         .context = context,
+         .originalFunc = originalFunc});
+    stub->SetCallTraceStub(dispatcher, &callbackHookDescriptors.front());
+    callTraceStubs[stub->GetHookFunction()] = stub;
+
+    const auto installStartTime = std::chrono::steady_clock::now();
+    Tracing::CreateHookStart(originalFunc, stub->GetHookFunction());
+    const EResult result =
+        CreateHookWithLockHeld(originalFunc, stub->GetHookFunction(), false, nullptr, decoded);
+    Tracing::CreateHookStop(originalFunc, stub->GetHookFunction(), result);
+    ExitSummary::RecordInstall(result, installStartTime);
+
+    // Just like call trace stubs, callback hook stubs and their descriptors are never deallocated
+    // once the hook exists, because threads might still be executing the stubs.
+    if (false == SuccessfulResult(result))
+    {
+      callTraceStubs.erase(stub->GetHookFunction());
+      callbackHookDescriptors.pop_front();
+      stubStore->Deallocate(stub);
+      SharedStatistics::CountInstallFailure();
+    }
+
+    return result;
+  }
+
+  EResult HookStore::CreateContextHook(void* originalFunc, const void* hookFunc, void* context)
+  {
+    const size_t contextOffset = GetHookContextOffset();
+    if (0 == contextOffset) return EResult::FailAllocation;
+    if (false == IsHookSpecValid(originalFunc, hookFunc)) return EResult::FailInvalidArgument;
+
+    Trampoline::SDecodedOriginalFunction decodedOriginalFunction;
+    const Trampoline::SDecodedOriginalFunction* const decoded =
+        ((true == Trampoline::DecodeOriginalFunction(originalFunc, &decodedOriginalFunction))
+             ? &decodedOriginalFunction
+             : nullptr);
+
+    std::unique_lock<std::shared_mutex> lock(hookStoreMutex);
+    TrampolineStore::WriteWindow trampolineWriteWindow;
+
+    TrampolineStore* stubStore = nullptr;
+    Trampoline* stub = nullptr;
+
+    const EResult allocateResult = AllocateTrampoline(originalFunc, &stubStore, &stub);
+    if (false == SuccessfulResult(allocateResult)) return allocateResult;
+
+    stub->SetContextStub(contextOffset, context, hookFunc);
+
+    const auto installStartTime = std::chrono::steady_clock::now();
+    Tracing::CreateHookStart(originalFunc, stub->GetHookFunction());
+    const EResult result =
+        CreateHookWithLockHeld(originalFunc, stub->GetHookFunction(), false, nullptr, decoded);
+    Tracing::CreateHookStop(originalFunc, stub->GetHookFunction(), result);
+    ExitSummary::RecordInstall(result, installStartTime);
+
+    // Once the hook exists, the context stub is never deallocated, even if the hook is later
+    // removed, because threads might still be executing it.
+    if (false == SuccessfulResult(result))
+    {
+      stubStore->Deallocate(stub);
+      SharedStatistics::CountInstallFailure();
+    }
+
+    return result;
+  }
+
+  EResult HookStore::CreateOneShotHook(void* originalFunc, const void* hookFunc)
+  {
+    if (false == IsHookSpecValid(originalFunc, hookFunc)) return EResult::FailInvalidArgument;
+
+    Trampoline::SDecodedOriginalFunction decodedOriginalFunction;
+    const Trampoline::SDecodedOriginalFunction* const decoded =
+        ((true == Trampoline::DecodeOriginalFunction(originalFunc, &decodedOriginalFunction))
+             ? &decodedOriginalFunction
+             : nullptr);
+
+    std::unique_lock<std::shared_mutex> lock(hookStoreMutex);
+    TrampolineStore::WriteWindow trampolineWriteWindow;
+
+    TrampolineStore* stubStore = nullptr;
+    Trampoline* stub = nullptr;
+
+    const EResult allocateResult = AllocateTrampoline(originalFunc, &stubStore, &stub);
+    if (false == SuccessfulResult(allocateResult)) return allocateResult;
+
+    // The one-shot stub's bypass is set the same way as a call trace stub's target, once the
+    // trampoline that invokes the original function exists.
+    volatile long* const firedFlag = &oneShotFiredFlags.emplace_back(0);
+    stub->SetOneShotStub(firedFlag, hookFunc);
+    oneShotHooks[stub->GetHookFunction()] = {.stub = stub, .firedFlag = firedFlag};
+
+    const auto installStartTime = std::chrono::steady_clock::now();
+    Tracing::CreateHookStart(originalFunc, stub->GetHookFunction());
+    const EResult result =
+        CreateHookWithLockHeld(originalFunc, stub->GetHookFunction(), false, nullptr, decoded);
+    Tracing::CreateHookStop(originalFunc, stub->GetHookFunction(), result);
+    ExitSummary::RecordInstall(result, installStartTime);
+
+    // Once the hook exists, the one-shot stub and its flag are never deallocated, even after the
+    // hook is removed, because threads might still be executing it. Removal happens in a
+    // background task because the stub itself cannot safely restore the original function while
+    // other threads might be executing it.
+    if (false == SuccessfulResult(result))
+    {
+      oneShotHooks.erase(stub->GetHookFunction());
+      oneShotFiredFlags.pop_back();
+      stubStore->Deallocate(stub);
+      SharedStatistics::CountInstallFailure();
+      return result;
+    }
+
+    OneShotHooks::ScheduleCheck();
+    return result;
+  }
+
+  EResult HookStore::RelocateCode(
+      const void* src,
+      size_t minBytes,
+      void* dst,
+      size_t dstCapacity,
+      uint32_t options,
+      SRelocatedCode* relocated)
+  {
+    SRelocatedCode relocatedCode = {};
+    const EResult result =
+        CodeRelocation::RelocateCode(src, minBytes, dst, dstCapacity, options, &relocatedCode);
+
+    if ((EResult::Success == result) && (nullptr != relocated)) *relocated = relocatedCode;
+
+    return result;
+  }
+
+  EResult HookStore::CreateHookEx(
+      void* originalFunc,
+      const void* hookFunc,
+      const void** originalFuncOut,
+      HookHandle* handleOut)
+  {
+    const EResult result = CreateHook(originalFunc, hookFunc);
+    if (false == SuccessfulResult(result)) return result;
+
+    // The hook function always identifies the hook that was just created, even if it was chained
+    // or placed on the target of a jump thunk, and looking it up does not require the lock.
+    const Trampoline* const trampoline = functionToTrampolineLookup.Find(hookFunc);
+
+    if (nullptr != originalFuncOut)
+    {
+      *originalFuncOut =
+          ((nullptr != trampoline) ? trampoline->GetOriginalFunction()
+                                   : GetOriginalFunction(hookFunc));
+    }
+
+    if (nullptr != handleOut)
+    {
+      std::shared_lock<std::shared_mutex> lock(hookStoreMutex);
+      *handleOut =
+          ((nullptr != trampoline) ? HookHandleForTrampoline(trampoline) : kInvalidHookHandle);
+    }
+
+    return result;
+  }
+
+  EResult HookStore::GetHookHandle(const void* originalOrHookFunc, HookHandle* handle)
+  {
+    if (nullptr == handle) return EResult::FailInvalidArgument;
+
+    std::shared_lock<std::shared_mutex> lock(hookStoreMutex);
+
+    originalOrHookFunc = ResolveJumpThunkAlias(originalOrHookFunc);
+    const auto trampolineIter = functionToTrampoline.find(originalOrHookFunc);
+    if (functionToTrampoline.end() == trampolineIter) return EResult::FailNotFound;
+
+    // Hooks whose trampolines cannot be encoded in a handle still exist, but they can only be
+    // identified by function address.
+    const HookHandle hookHandle = HookHandleForTrampoline(trampolineIter->second);
+    if (kInvalidHookHandle == hookHandle) return EResult::FailInternal;
+
+    *handle = hookHandle;
+    return EResult::Success;
+  }
+
+  EResult HookStore::ReplaceHookFunctionByHandle(HookHandle handle, const void* newHookFunc)
+  {
+    std::unique_lock<std::shared_mutex> lock(hookStoreMutex);
+
+    Trampoline* const trampoline = TrampolineForHookHandle(handle);
+    if (nullptr == trampoline) return EResult::FailNotFound;
+
+    TrampolineStore::WriteWindow trampolineWriteWindow;
+    return ReplaceHookFunctionForTrampolineWithLockHeld(trampoline, newHookFunc);
+  }
+
+  EResult HookStore::DisableHookFunctionByHandle(HookHandle handle)
+  {
+    std::unique_lock<std::shared_mutex> lock(hookStoreMutex);
+
+    Trampoline* const trampoline = TrampolineForHookHandle(handle);
+    if (nullptr == trampoline) return EResult::FailNotFound;
+
+    // Disabling is the same as replacing the hook function with the trampoline's own original
+    // function region, which is exactly what #DisableHookFunction does.
+    TrampolineStore::WriteWindow trampolineWriteWindow;
+    return ReplaceHookFunctionForTrampolineWithLockHeld(
+        trampoline, trampoline->GetOriginalFunction());
+  }
+
+  EResult HookStore::GetHookStatisticsByHandle(HookHandle handle, SHookStatistics* statistics)
+  {
+    if (nullptr == statistics) return EResult::FailInvalidArgument;
+
+    std::shared_lock<std::shared_mutex> lock(hookStoreMutex);
+
+    Trampoline* const trampoline = TrampolineForHookHandle(handle);
+    if (nullptr == trampoline) return EResult::FailNotFound;
+
+    return GetHookStatisticsForTrampolineWithLockHeld(trampoline, statistics);
+  }
+
+  EResult HookStore::CreateHooksBySymbol(
+      const wchar_t* symbolIndexFilename,
+      void* moduleHandle,
+      const char* const* symbolNames,
+      const void* const* hookFuncs,
+      size_t numHooks,
+      EResult* results)
+  {
+    return CreateHooksBySymbolInternal(
+        this, symbolIndexFilename, moduleHandle, symbolNames, hookFuncs, numHooks, results);
+  }
+
+  EResult HookStore::CreateSampledHook(
+      void* originalFunc, const void* hookFunc, uint32_t sampleInterval)
+  {
+    // The countdown in each sampled hook stub is a signed 32-bit value.
+    if ((0 == sampleInterval) || (sampleInterval > INT32_MAX))
+      return EResult::FailInvalidArgument;
+    if (false == IsHookSpecValid(originalFunc, hookFunc)) return EResult::FailInvalidArgument;
+
+    const uint32_t sampleIntervalOverride = GetSampledHookIntervalOverride();
+    if (0 != sampleIntervalOverride) sampleInterval = sampleIntervalOverride;
+
+    Trampoline::SDecodedOriginalFunction decodedOriginalFunction;
+    const Trampoline::SDecodedOriginalFunction* const decoded =
+        ((true == Trampoline::DecodeOriginalFunction(originalFunc, &decodedOriginalFunction))
+             ? &decodedOriginalFunction
+             : nullptr);
+
+    std::unique_lock<std::shared_mutex> lock(hookStoreMutex);
+    TrampolineStore::WriteWindow trampolineWriteWindow;
+
+    TrampolineStore* stubStore = nullptr;
+    Trampoline* stub = nullptr;
+
+    const EResult allocateResult = AllocateTrampoline(originalFunc, &stubStore, &stub);
+    if (false == SuccessfulResult(allocateResult)) return allocateResult;
+
+    // The sampled hook stub's bypass is set the same way as a one-shot stub's bypass, once the
+    // trampoline that invokes the original function exists.
+    stub->SetSampledHookStub(sampleInterval, hookFunc);
+    sampledHooks[stub->GetHookFunction()] = {
+        .stub = stub, .originalFunc = originalFunc, .sampleInterval = sampleInterval};
+
+    const auto installStartTime = std::chrono::steady_clock::now();
+    Tracing::CreateHookStart(originalFunc, stub->GetHookFunction());
+    const EResult result =
+        CreateHookWithLockHeld(originalFunc, stub->GetHookFunction(), false, nullptr, decoded);
+    Tracing::CreateHookStop(originalFunc, stub->GetHookFunction(), result);
+    ExitSummary::RecordInstall(result, installStartTime);
+
+    // Once the hook exists, the sampled hook stub is never deallocated, even if the hook is later
+    // removed, because threads might still be executing it.
+    if (false == SuccessfulResult(result))
+    {
+      sampledHooks.erase(stub->GetHookFunction());
+      stubStore->Deallocate(stub);
+      SharedStatistics::CountInstallFailure();
+    }
+
+    return result;
+  }
+
+  EResult HookStore::SetSampledHookInterval(const void* originalFunc, uint32_t sampleInterval)
+  {
+    if ((0 == sampleInterval) || (sampleInterval > INT32_MAX))
+      return EResult::FailInvalidArgument;
+
+    std::unique_lock<std::shared_mutex> lock(hookStoreMutex);
+    TrampolineStore::WriteWindow trampolineWriteWindow;
+
+    originalFunc = ResolveJumpThunkAlias(originalFunc);
+
+    // Several sampled hooks can be chained onto the same original function, in which case all of
+    // them are changed.
+    bool sampledHookFound = false;
+    bool sampledHookChanged = false;
+
+    for (auto& sampledHook : sampledHooks)
+    {
+      if (originalFunc != ResolveJumpThunkAlias(sampledHook.second.originalFunc)) continue;
+      if (0 == functionToTrampoline.count(sampledHook.first)) continue;
+
+      sampledHookFound = true;
+      if (sampleInterval == sampledHook.second.sampleInterval) continue;
+      if (false == TrampolineStore::MakeWritable(sampledHook.second.stub))
+        return EResult::FailInternal;
+
+      sampledHook.second.stub->SetSampledHookStubInterval(sampleInterval);
+      sampledHook.second.sampleInterval = sampleInterval;
+      sampledHookChanged = true;
+    }
+
+    if (false == sampledHookFound) return EResult::FailNotFound;
+    return ((true == sampledHookChanged) ? EResult::Success : EResult::NoEffect);
+  }
+
+  EResult HookStore::CanHook(const void* originalFunc, SHookFeasibility* feasibility)
+  {
+    if ((nullptr == originalFunc) || (nullptr == feasibility)) return EResult::FailInvalidArgument;
+
+    *feasibility = {};
+
+    std::vector<SHookKindCost> hookKindCosts;
+
+    do
+    {
+      // Decoding the original function may record a hook plan, but that only makes the eventual
+      // creation of the hook cheaper. Nothing else is allocated or modified.
+      std::shared_lock<std::shared_mutex> lock(hookStoreMutex);
+      hookKindCosts =
+          EstimateHookKindCosts(const_cast<void*>(originalFunc), nullptr, feasibility);
+    }
+    while (false);
+
+    if (true == hookKindCosts.empty()) return EResult::FailCannotSetHook;
+
+    for (const auto& hookKindCost : hookKindCosts)
+      feasibility->possibleKinds |= (1u << static_cast<uint32_t>(hookKindCost.hookKind));
+
+    feasibility->cheapestKind = hookKindCosts.front().hookKind;
+    feasibility->cheapestCost = hookKindCosts.front().cost;
+    return EResult::Success;
+  }
+
+  EResult HookStore::GetHookPlanCacheStatistics(SHookPlanCacheStatistics* statistics)
+  {
+    if (nullptr == statistics) return EResult::FailInvalidArgument;
+
+    *statistics = {};
+    if (false == HookPlanCache::IsEnabled()) return EResult::NoEffect;
+
+    HookPlanCache::GetStatistics(statistics);
+    return EResult::Success;
+  }
+
+  size_t HookStore::GetHookContextOffset(void)
+  {
+    static const size_t contextOffset = []() -> size_t
+    {
+      const size_t slotOffset = AllocateThreadEnvironmentBlockSlot();
+      if (0 == slotOffset)
+      {
+        Infra::Message::Output(
+            Infra::Message::ESeverity::Warning,
+            L"Context hooks are unavailable because no thread-local storage slot could be allocated in the thread environment block.");
+      }
+
+      return slotOffset;
+    }();
+
+    return contextOffset;
+  }
+
+  EResult HookStore::CreateProbe(void* address, TProbeCallback callback, void* context)
+  {
+    if (nullptr == callback) return EResult::FailInvalidArgument;
+
+    const void* const dispatcher = Probes::GetDispatcher();
+    if (nullptr == dispatcher) return EResult::FailAllocation;
+    if (false == IsHookSpecValid(address, dispatcher)) return EResult::FailInvalidArgument;
+
+    // Transplanting the instructions at the probe address works the same way no matter where
+    // they are within a function, so a probe is just a hook whose hook function is a probe stub.
+    Trampoline::SDecodedOriginalFunction decodedOriginalFunction;
+    const Trampoline::SDecodedOriginalFunction* const decoded =
+        ((true == Trampoline::DecodeOriginalFunction(address, &decodedOriginalFunction))
+             ? &decodedOriginalFunction
+             : nullptr);
+
+    std::unique_lock<std::shared_mutex> lock(hookStoreMutex);
+    TrampolineStore::WriteWindow trampolineWriteWindow;
+
+    TrampolineStore* stubStore = nullptr;
+    Trampoline* stub = nullptr;
+
+    const EResult allocateResult = AllocateTrampoline(address, &stubStore, &stub);
+    if (false == SuccessfulResult(allocateResult)) return allocateResult;
+
+    // The probe stub's resume address is set the same way as a call trace stub's target, once the
+    // trampoline that holds the transplanted instructions exists.
+    stub->SetProbeStub(dispatcher, callback, context, address);
+    callTraceStubs[stub->GetHookFunction()] = stub;
+
+    const auto installStartTime = std::chrono::steady_clock::now();
+    Tracing::CreateHookStart(address, stub->GetHookFunction());
+    const EResult result =
+        CreateHookWithLockHeld(address, stub->GetHookFunction(), false, nullptr, decoded);
+    Tracing::CreateHookStop(address, stub->GetHookFunction(), result);
+    ExitSummary::RecordInstall(result, installStartTime);
+
+    // Once the probe exists, the probe stub is never deallocated, even if the probe is later
+    // removed, because threads might still be executing it.
+    if (false == SuccessfulResult(result))
+    {
+      callTraceStubs.erase(stub->GetHookFunction());
+      stubStore->Deallocate(stub);
+      SharedStatistics::CountInstallFailure();
+    }
+
+    return result;
+  }
+
+  EResult HookStore::FindPatterns(
+      void* moduleHandle, const SBytePattern* patterns, size_t numPatterns, void** results)
+  {
+    // Searching only reads module code, so it does not need to hold the hook store lock.
+    return PatternScanner::FindPatterns(
+        reinterpret_cast<HMODULE>(moduleHandle), patterns, numPatterns, results);
+  }
+
+  EResult HookStore::CreateHotSwapHook(
+      void* originalFunc, const void* hookFunc, SHotSwapSlot** slot)
+  {
+    if (nullptr == slot) return EResult::FailInvalidArgument;
+    if (false == IsHookSpecValid(originalFunc, hookFunc)) return EResult::FailInvalidArgument;
+
+    Trampoline::SDecodedOriginalFunction decodedOriginalFunction;
+    const Trampoline::SDecodedOriginalFunction* const decoded =
+        ((true == Trampoline::DecodeOriginalFunction(originalFunc, &decodedOriginalFunction))
+             ? &decodedOriginalFunction
+             : nullptr);
+
+    std::unique_lock<std::shared_mutex> lock(hookStoreMutex);
+    TrampolineStore::WriteWindow trampolineWriteWindow;
+
+    SHotSwapSlot* const hotSwapSlot = HotSwap::AllocateSlot(hookFunc);
+    if (nullptr == hotSwapSlot) return EResult::FailAllocation;
+
+    // A hot-swappable hook is just a hook whose hook function is a hot-swap stub, so everything
+    // else about the hook, including whatever stubs sit in front of it, works the usual way.
+    const void* const hotSwapStub = HotSwap::GetStub(hotSwapSlot);
+
+    const auto installStartTime = std::chrono::steady_clock::now();
+    Tracing::CreateHookStart(originalFunc, hotSwapStub);
+    const EResult result =
+        CreateHookWithLockHeld(originalFunc, hotSwapStub, false, nullptr, decoded);
+    Tracing::CreateHookStop(originalFunc, hotSwapStub, result);
+    ExitSummary::RecordInstall(result, installStartTime);
+
+    // Once the hook exists, the hot-swap stub and slot are never deallocated, even if the hook is
+    // later removed, because threads might still be executing the stub.
+    if (false == SuccessfulResult(result))
+    {
+      HotSwap::DeallocateSlot(hotSwapSlot);
+      SharedStatistics::CountInstallFailure();
+      return result;
+    }
+
+    *slot = hotSwapSlot;
+    return result;
+  }
+
+  EResult HookStore::HotSwapHookFunction(SHotSwapSlot* slot, const void* newHookFunc)
+  {
+    // This is meant to be invoked very frequently, so it deliberately does not take the hook store
+    // lock. The stub reads the slot as data, so no instruction cache flush is needed either.
+    if ((nullptr == slot) || (nullptr == newHookFunc)) return EResult::FailInvalidArgument;
+
+    HotSwap::SetHookFunction(slot, newHookFunc);
+    return EResult::Success;
+  }
+
+  EResult HookStore::GetMemoryFootprint(SMemoryFootprint* footprint)
+  {
+    if (nullptr == footprint) return EResult::FailInvalidArgument;
+
+    std::shared_lock<std::shared_mutex> lock(hookStoreMutex);
+
+    SMemoryFootprint memoryFootprint = {};
+    for (const TrampolineStore& trampolineStore : trampolines)
+    {
+      const STrampolineStoreFootprint storeFootprint =
+          FootprintForTrampolineStore(trampolineStore, nullptr);
+
+      memoryFootprint.numTrampolineStores += 1;
+      memoryFootprint.trampolineReservedBytes += storeFootprint.reservedBytes;
+      memoryFootprint.trampolineCommittedBytes += storeFootprint.committedBytes;
+      memoryFootprint.numWastedTrampolineSlots += storeFootprint.numWastedSlots;
+    }
+
+    memoryFootprint.hookStoreHeapBytes = HookStoreHeapBytes();
+    memoryFootprint.numPrivatePatchedPages = PatchedPages().size();
+
+    *footprint = memoryFootprint;
+    return EResult::Success;
+  }
+
+  EResult HookStore::GetTrampolineStoreFootprints(
+      STrampolineStoreFootprint* storeFootprints, size_t maxStoreFootprints, size_t* numStores)
+  {
+    if (nullptr == numStores) return EResult::FailInvalidArgument;
+    if ((nullptr == storeFootprints) && (0 != maxStoreFootprints))
+      return EResult::FailInvalidArgument;
+
+    std::shared_lock<std::shared_mutex> lock(hookStoreMutex);
+
+    const std::vector<const void*> moduleBases = TrampolineStoreModuleBases();
+    for (size_t i = 0; (i < trampolines.size()) && (i < maxStoreFootprints); ++i)
+      storeFootprints[i] = FootprintForTrampolineStore(trampolines[i], moduleBases[i]);
+
+    *numStores = trampolines.size();
+    return EResult::Success;
+  }
+
+  EResult HookStore::GetModuleFootprints(
+      SModuleFootprint* moduleFootprints, size_t maxModuleFootprints, size_t* numModules)
+  {
+    if (nullptr == numModules) return EResult::FailInvalidArgument;
+    if ((nullptr == moduleFootprints) && (0 != maxModuleFootprints))
+      return EResult::FailInvalidArgument;
+
+    std::shared_lock<std::shared_mutex> lock(hookStoreMutex);
+
+    // Ordered by base address, which is the order in which modules are reported.
+    std::map<const void*, SModuleFootprint> footprintsByModule;
+
+    const std::vector<const void*> moduleBases = TrampolineStoreModuleBases();
+    for (size_t i = 0; i < trampolines.size(); ++i)
+    {
+      if (nullptr == moduleBases[i]) continue;
+
+      const STrampolineStoreFootprint storeFootprint =
+          FootprintForTrampolineStore(trampolines[i], moduleBases[i]);
+
+      SModuleFootprint& moduleFootprint = footprintsByModule[moduleBases[i]];
+      moduleFootprint.moduleBase = moduleBases[i];
+      moduleFootprint.numTrampolineStores += 1;
+      moduleFootprint.trampolineReservedBytes += storeFootprint.reservedBytes;
+      moduleFootprint.trampolineCommittedBytes += storeFootprint.committedBytes;
+    }
+
+    for (const auto& patchedPage : PatchedPages())
+    {
+      SModuleFootprint& moduleFootprint = footprintsByModule[patchedPage.first];
+      moduleFootprint.moduleBase = patchedPage.first;
+      moduleFootprint.numPrivatePatchedPages += 1;
+    }
+
+    size_t numModulesFound = 0;
+    for (const auto& moduleAndFootprint : footprintsByModule)
+    {
+      if (numModulesFound < maxModuleFootprints)
+        moduleFootprints[numModulesFound] = moduleAndFootprint.second;
+      numModulesFound += 1;
+    }
+
+    *numModules = numModulesFound;
+    return EResult::Success;
+  }
+
+  void* HookStore::QueryInterface(uint32_t version)
+  {
+    switch (version)
+    {
+      case kInterfaceVersion1:
+        return static_cast<IHookshot*>(this);
+
+      case kInterfaceVersion2:
+        return static_cast<IHookshot2*>(this);
+
+      case kInterfaceVersion3:
+        return static_cast<IHookshot3*>(this);
+
+      case kInterfaceVersion4:
+        return static_cast<IHookshot4*>(this);
+
+      case kInterfaceVersion5:
+        return static_cast<IHookshot5*>(this);
+
+      case kInterfaceVersion6:
+        return static_cast<IHookshot6*>(this);
+
+      case kInterfaceVersion7:
+        return static_cast<IHookshot7*>(this);
+
+      case kInterfaceVersion8:
+        return static_cast<IHookshot8*>(this);
+
+      case kInterfaceVersion9:
+        return static_cast<IHookshot9*>(this);
+
+      case kInterfaceVersion10:
+        return static_cast<IHookshot10*>(this);
+
+      case kInterfaceVersion11:
+        return static_cast<IHookshot11*>(this);
+
+      case kInterfaceVersion12:
+        return static_cast<IHookshot12*>(this);
+
+      case kInterfaceVersion13:
+        return static_cast<IHookshot13*>(this);
+
+      case kInterfaceVersion14:
+        return static_cast<IHookshot14*>(this);
+
+      case kInterfaceVersion15:
+        return static_cast<IHookshot15*>(this);
+
+      default:
+        return nullptr;
+    }
+  }
+
+  EResult HookStore::GetOriginalFunctions(
+      const void* const* originalOrHookFuncs, size_t numFuncs, const void** originalFuncs)
+  {
+    if (((nullptr == originalOrHookFuncs) || (nullptr == originalFuncs)) && (0 != numFuncs))
+      return EResult::FailInvalidArgument;
+    if (0 == numFuncs) return EResult::NoEffect;
+
+    EResult overallResult = EResult::Success;
+    for (size_t i = 0; i < numFuncs; ++i)
+    {
+      originalFuncs[i] = GetOriginalFunction(originalOrHookFuncs[i]);
+      if (nullptr == originalFuncs[i]) overallResult = EResult::FailNotFound;
+    }
+
+    return overallResult;
+  }
+
+  EResult HookStore::ReplaceHookFunctions(
+      const void* const* originalOrHookFuncs,
+      const void* const* newHookFuncs,
+      size_t numFuncs,
+      EResult* results)
+  {
+    if (((nullptr == originalOrHookFuncs) || (nullptr == newHookFuncs)) && (0 != numFuncs))
+      return EResult::FailInvalidArgument;
+    if (0 == numFuncs) return EResult::NoEffect;
+
+    std::vector<EResult> localResults;
+    if (nullptr == results)
+    {
+      localResults.resize(numFuncs);
+      results = localResults.data();
+    }
+
+    std::unique_lock<std::shared_mutex> lock(hookStoreMutex);
+    TrampolineStore::WriteWindow trampolineWriteWindow;
+
+    for (size_t i = 0; i < numFuncs; ++i)
+      results[i] = ReplaceHookFunctionWithLockHeld(originalOrHookFuncs[i], newHookFuncs[i]);
+
+    return OverallResult(results, numFuncs);
+  }
+
+  EResult HookStore::DisableHookFunctions(
+      const void* const* originalOrHookFuncs, size_t numFuncs, EResult* results)
+  {
+    if ((nullptr == originalOrHookFuncs) && (0 != numFuncs)) return EResult::FailInvalidArgument;
+    if (0 == numFuncs) return EResult::NoEffect;
+
+    // Looking up the original functions does not require the lock, so it is done up front.
+    std::vector<const void*> originalFuncs(numFuncs, nullptr);
+    GetOriginalFunctions(originalOrHookFuncs, numFuncs, originalFuncs.data());
+
+    return ReplaceHookFunctions(originalOrHookFuncs, originalFuncs.data(), numFuncs, results);
+  }
+
+  EResult HookStore::GetHooksStatistics(
+      const void* const* originalOrHookFuncs,
+      size_t numFuncs,
+      SHookStatistics* statistics,
+      EResult* results)
+  {
+    if (((nullptr == originalOrHookFuncs) || (nullptr == statistics)) && (0 != numFuncs))
+      return EResult::FailInvalidArgument;
+    if (0 == numFuncs) return EResult::NoEffect;
+
+    std::vector<EResult> localResults;
+    if (nullptr == results)
+    {
+      localResults.resize(numFuncs);
+      results = localResults.data();
+    }
+
+    std::shared_lock<std::shared_mutex> lock(hookStoreMutex);
+
+    for (size_t i = 0; i < numFuncs; ++i)
+      results[i] = GetHookStatisticsWithLockHeld(originalOrHookFuncs[i], &statistics[i]);
+
+    return OverallResult(results, numFuncs);
+  }
+
+  EResult HookStore::RemoveHooks(
+      const void* const* originalOrHookFuncs, size_t numFuncs, EResult* results)
+  {
+    if ((nullptr == originalOrHookFuncs) && (0 != numFuncs)) return EResult::FailInvalidArgument;
+    if (0 == numFuncs) return EResult::NoEffect;
+
+    std::vector<EResult> localResults;
+    if (nullptr == results)
+    {
+      localResults.resize(numFuncs);
+      results = localResults.data();
+    }
+
+    // Removing a hook can involve other kinds of hooks and suspending other threads, each of which
+    // manages its own locking, so hooks are removed one at a time.
+    for (size_t i = 0; i < numFuncs; ++i)
+      results[i] = RemoveHook(originalOrHookFuncs[i]);
+
+    return OverallResult(results, numFuncs);
+  }
+
+  EResult HookStore::GetHookCallerHistogram(
+      const void* originalOrHookFunc, SHookCallerHistogram* histogram)
+  {
+    if (nullptr == histogram) return EResult::FailInvalidArgument;
+
+    static_assert(
+        SampledTiming::kNumCallerSlots <= kHookCallerHistogramMaxModules,
+        "Caller histograms cannot hold a different module for every caller slot.");
+
+    uint64_t callers[SampledTiming::kNumCallerSlots] = {};
+
+    do
+    {
+      std::shared_lock<std::shared_mutex> lock(hookStoreMutex);
+
+      // If this fails, the specified hook does not exist.
+      originalOrHookFunc = ResolveJumpThunkAlias(originalOrHookFunc);
+      if (0 == functionToTrampoline.count(originalOrHookFunc)) return EResult::FailNotFound;
+
+      // Callers are recorded by the sampled timing stub, which all of the hooks chained onto the
+      // same original function share with the innermost trampoline.
+      Trampoline* trampoline = functionToTrampoline.at(originalOrHookFunc);
+      const void* const originalFunc = OriginalFunctionForTrampoline(trampoline);
+      if (nullptr != originalFunc) trampoline = functionToTrampoline.at(originalFunc);
+
+      // If this fails, the specified hook exists but its callers are not recorded.
+      const auto sampledTimingIter = trampolineToSampledTiming.find(trampoline);
+      if ((trampolineToSampledTiming.end() == sampledTimingIter) ||
+          (false == SampledTiming::IsCallerRecordingEnabled()))
+        return EResult::NoEffect;
+
+      // Caller slots are written without synchronization by whichever thread is timing a call,
+      // so each one is read exactly once.
+      for (size_t i = 0; i < SampledTiming::kNumCallerSlots; ++i)
+        callers[i] = *reinterpret_cast<volatile const uint64_t*>(
+            &sampledTimingIter->second.sampleBlock->callers[i]);
+    }
+    while (false);
+
+    // Resolving callers to modules does not need the hook store lock, and the module index only
+    // falls back to asking the system if it is unavailable.
+    *histogram = {};
+    for (const uint64_t caller : callers)
+    {
+      if (0 == caller) continue;
+
+      const void* const callerModule =
+          ModuleForAddress(reinterpret_cast<const void*>(static_cast<size_t>(caller)));
+
+      uint32_t moduleIndex = 0;
+      while ((moduleIndex < histogram->numModules) &&
+             (callerModule != histogram->modules[moduleIndex]))
+        moduleIndex += 1;
+
+      if (moduleIndex == histogram->numModules)
+      {
+        histogram->modules[moduleIndex] = callerModule;
+        histogram->numModules += 1;
+      }
+
+      histogram->counts[moduleIndex] += 1;
+      histogram->numSamples += 1;
+    }
+
+    // Histograms hold at most a few dozen modules, so a simple insertion sort suffices.
+    for (uint32_t i = 1; i < histogram->numModules; ++i)
+    {
+      for (uint32_t j = i; (j > 0) && (histogram->counts[j - 1] < histogram->counts[j]); --j)
+      {
+        std::swap(histogram->modules[j - 1], histogram->modules[j]);
+        std::swap(histogram->counts[j - 1], histogram->counts[j]);
+      }
+    }
+
+    return EResult::Success;
+  }
+
+  EResult HookStore::InstrumentModuleExports(
+      void* moduleHandle, const SModuleInstrumentationOptions* options, size_t* numInstrumented)
+  {
+    if ((nullptr == moduleHandle) || (nullptr == options)) return EResult::FailInvalidArgument;
+    if (nullptr != numInstrumented) *numInstrumented = 0;
+
+    // The countdown in each sampled timing stub is a signed 32-bit value.
+    const uint32_t sampleInterval = std::min<uint32_t>(options->sampleInterval, INT32_MAX);
+
+    const std::vector<void*> codeExports =
+        ExportResolver::GetLocalCodeExports(reinterpret_cast<HMODULE>(moduleHandle));
+    if (true == codeExports.empty()) return EResult::NoEffect;
+
+    // Each export gets its own counting stub, allocated near it just like its trampoline will be.
+    // Exports for which no stub can be allocated are skipped.
+    std::vector<SHookSpec> hookSpecs;
+    hookSpecs.reserve(codeExports.size());
+
+    do
+    {
+      std::unique_lock<std::shared_mutex> lock(hookStoreMutex);
+      TrampolineStore::WriteWindow trampolineWriteWindow;
+
+      for (void* const codeExport : codeExports)
+      {
+        TrampolineStore* stubStore = nullptr;
+        Trampoline* stub = nullptr;
+        if (false == SuccessfulResult(AllocateTrampoline(codeExport, &stubStore, &stub))) continue;
+
+        stub->SetInstrumentationStub(codeExport, AllocateInstrumentationCounterShards());
+        exportCounterStubs[stub->GetHookFunction()] = {
+            .stub = stub, .sampleInterval = sampleInterval};
+        hookSpecs.push_back({.originalFunc = codeExport, .hookFunc = stub->GetHookFunction()});
+      }
+    }
+    while (false);
+
+    if (true == hookSpecs.empty()) return EResult::NoEffect;
+
+    std::vector<EResult> results(hookSpecs.size());
+    CreateHooks(hookSpecs.data(), hookSpecs.size(), results.data());
+
+    // Stubs whose exports could not be hooked, because they are already hooked or too short or
+    // for any other reason, are still waiting for trampolines and can be deallocated right away.
+    size_t numExportsInstrumented = 0;
+
+    do
+    {
+      std::unique_lock<std::shared_mutex> lock(hookStoreMutex);
+
+      for (size_t i = 0; i < hookSpecs.size(); ++i)
+      {
+        const auto exportCounterStubIter = exportCounterStubs.find(hookSpecs[i].hookFunc);
+        if (exportCounterStubs.end() != exportCounterStubIter)
+        {
+          TrampolineStore* const stubStore =
+              FindTrampolineStore(exportCounterStubIter->second.stub);
+          if (nullptr != stubStore) stubStore->Deallocate(exportCounterStubIter->second.stub);
+
+          exportCounterStubs.erase(exportCounterStubIter);
+        }
+
+        if (true == SuccessfulResult(results[i])) numExportsInstrumented += 1;
+      }
+    }
+    while (false);
+
+    Infra::Message::OutputFormatted(
+        Infra::Message::ESeverity::Info,
+        L"Instrumented %llu of %llu exported functions of the module at 0x%llx.",
+        (unsigned long long)numExportsInstrumented,
+        (unsigned long long)codeExports.size(),
+        (long long)moduleHandle);
+
+    if (nullptr != numInstrumented) *numInstrumented = numExportsInstrumented;
+    return ((0 != numExportsInstrumented) ? EResult::Success : EResult::NoEffect);
+  }
+
+  EResult HookStore::CreateHookAuto(
+      void* originalFunc, const void* hookFunc, EHookKind* chosenKind)
+  {
+    if (false == IsHookSpecValid(originalFunc, hookFunc)) return EResult::FailInvalidArgument;
+
+    std::vector<SHookKindCost> hookKindCosts;
+
+    do
+    {
+      std::shared_lock<std::shared_mutex> lock(hookStoreMutex);
+      hookKindCosts = EstimateHookKindCosts(originalFunc, hookFunc);
+    }
+    while (false);
+
+    // Estimates can be wrong, for example if there is no import to modify or every debug address
+    // register is in use, so each kind is attempted in turn until one succeeds.
+    EResult result = EResult::FailCannotSetHook;
+    for (const auto& hookKindCost : hookKindCosts)
+    {
+      result = CreateHookWithKind(hookKindCost.hookKind, originalFunc, hookFunc, nullptr);
+      if (false == SuccessfulResult(result)) continue;
+
+      Infra::Message::OutputFormatted(
+          Infra::Message::ESeverity::Debug,
+          L"Automatically selected hook kind %u, with estimated cost %u, for the function at 0x%llx.",
+          static_cast<unsigned int>(hookKindCost.hookKind),
+          static_cast<unsigned int>(hookKindCost.cost),
+          (long long)originalFunc);
+
+      if (nullptr != chosenKind) *chosenKind = hookKindCost.hookKind;
+      break;
+    }
+
+    return result;
+  }
+
+  EResult HookStore::Seal(void)
+  {
+    std::unique_lock<std::shared_mutex> lock(hookStoreMutex);
+
+    if (true == functionToTrampolineLookup.IsSealed()) return EResult::NoEffect;
+
+    // Every modification of the lookup table unseals it, which is why holding the hook store lock
+    // exclusively is enough to make sure the snapshot is complete.
+    if (false == functionToTrampolineLookup.Seal())
+    {
+      Infra::Message::OutputFormatted(
+          Infra::Message::ESeverity::Warning,
+          L"Failed to seal %llu hook lookup table entries.",
+          (unsigned long long)functionToTrampoline.size());
+      return EResult::FailInternal;
+    }
 
+    Infra::Message::OutputFormatted(
+        Infra::Message::ESeverity::Info,
+        L"Sealed %llu hook lookup table entries.",
+        (unsigned long long)functionToTrampoline.size());
     return EResult::Success;
   }
 } // namespace Hookshot
@@ -0,0 +1,152 @@
+/***************************************************************************************************
+ * Hookshot
+ *   General-purpose library for injecting DLLs and hooking function calls.
+ ***************************************************************************************************
+ * Authored by Samuel Grossman
+ * Copyright (c) 2019-2025
+ ***********************************************************************************************//**
+ * @file HookTable.cpp
+ *   Implementation of installing the hook tables exported by hook modules.
+ **************************************************************************************************/
+
+#include "HookTable.h"
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+#include <Infra/Core/Message.h>
+
+#include "ApiWindows.h"
+#include "DependencyProtect.h"
+#include "ExportResolver.h"
+#include "HookshotTypes.h"
+#include "Strings.h"
+
+namespace Hookshot
+{
+  namespace HookTable
+  {
+    /// Function signature for the hook module hook table accessor function.
+    using THookModuleHookTableProc = const SHookTableEntry*(__fastcall*)(size_t*);
+
+    /// Determines the address of the original function identified by a hook table entry.
+    /// @param [in] entry Hook table entry.
+    /// @return Address of the original function, or `nullptr` if it could not be determined.
+    static void* ResolveOriginalFunction(const SHookTableEntry& entry)
+    {
+      if ((nullptr == entry.moduleName) || (nullptr == entry.hookFunc)) return nullptr;
+
+      HMODULE moduleHandle = nullptr;
+      if (FALSE ==
+          Protected::Windows_GetModuleHandleEx(
+              GET_MODULE_HANDLE_EX_FLAG_UNCHANGED_REFCOUNT, entry.moduleName, &moduleHandle))
+        return nullptr;
+
+      if (nullptr != entry.exportName)
+        return ExportResolver::GetLocalProcAddress(moduleHandle, entry.exportName);
+
+      const IMAGE_DOS_HEADER* const dosHeader =
+          reinterpret_cast<const IMAGE_DOS_HEADER*>(moduleHandle);
+      if (IMAGE_DOS_SIGNATURE != dosHeader->e_magic) return nullptr;
+
+      const IMAGE_NT_HEADERS* const ntHeader = reinterpret_cast<const IMAGE_NT_HEADERS*>(
+          reinterpret_cast<size_t>(dosHeader) + static_cast<size_t>(dosHeader->e_lfanew));
+      if (IMAGE_NT_SIGNATURE != ntHeader->Signature) return nullptr;
+
+      if ((0 == entry.relativeAddress) ||
+          (entry.relativeAddress >= ntHeader->OptionalHeader.SizeOfImage))
+        return nullptr;
+
+      return reinterpret_cast<void*>(
+          reinterpret_cast<size_t>(moduleHandle) + static_cast<size_t>(entry.relativeAddress));
+    }
+
+    bool LocateHookTable(HMODULE hookModule, const SHookTableEntry** entries, size_t* numEntries)
+    {
+      *entries = nullptr;
+      *numEntries = 0;
+
+      // Hook modules loaded from hook module bundles are unknown to the system loader, so their
+      // export tables are searched directly.
+      const THookModuleHookTableProc hookTableProc =
+          (THookModuleHookTableProc)ExportResolver::GetLocalProcAddress(
+              hookModule, Strings::kStrHookLibraryHookTableFuncName);
+      if (nullptr == hookTableProc) return false;
+
+      *entries = hookTableProc(numEntries);
+      if (nullptr == *entries) *numEntries = 0;
+
+      return true;
+    }
+
+    size_t InstallHookTables(
+        IHookshot* hookshot, const SHookModuleHookTable* hookTables, size_t numHookTables)
+    {
+      std::vector<SHookSpec> hookSpecs;
+      std::vector<const SHookTableEntry*> hookSpecEntries;
+      std::vector<const SHookModuleHookTable*> hookSpecTables;
+
+      for (size_t tableIndex = 0; tableIndex < numHookTables; ++tableIndex)
+      {
+        const SHookModuleHookTable& hookTable = hookTables[tableIndex];
+
+        for (size_t entryIndex = 0; entryIndex < hookTable.numEntries; ++entryIndex)
+        {
+          const SHookTableEntry& entry = hookTable.entries[entryIndex];
+
+          void* const originalFunc = ResolveOriginalFunction(entry);
+          if (nullptr == originalFunc)
+          {
+            Infra::Message::OutputFormatted(
+                Infra::Message::ESeverity::Warning,
+                L"%s - Failed to locate the function to hook for hook table entry %d.",
+                hookTable.hookModuleFileName,
+                static_cast<int>(entryIndex));
+            continue;
+          }
+
+          hookSpecs.push_back({.originalFunc = originalFunc, .hookFunc = entry.hookFunc});
+          hookSpecEntries.push_back(&entry);
+          hookSpecTables.push_back(&hookTable);
+        }
+      }
+
+      if (true == hookSpecs.empty()) return 0;
+
+      std::vector<EResult> results(hookSpecs.size(), EResult::Success);
+      hookshot->CreateHooks(hookSpecs.data(), hookSpecs.size(), results.data());
+
+      size_t numHooksCreated = 0;
+
+      for (size_t i = 0; i < hookSpecs.size(); ++i)
+      {
+        if (false == SuccessfulResult(results[i]))
+        {
+          Infra::Message::OutputFormatted(
+              Infra::Message::ESeverity::Warning,
+              L"%s - Failed to create hook from hook table for function at 0x%llx (EResult = %u).",
+              hookSpecTables[i]->hookModuleFileName,
+              (long long)hookSpecs[i].originalFunc,
+              (unsigned int)results[i]);
+          continue;
+        }
+
+        if (nullptr != hookSpecEntries[i]->originalFuncOut)
+          *hookSpecEntries[i]->originalFuncOut =
+              hookshot->GetOriginalFunction(hookSpecs[i].hookFunc);
+
+        numHooksCreated += 1;
+      }
+
+      Infra::Message::OutputFormatted(
+          Infra::Message::ESeverity::Info,
+          L"Created %d of %d hook(s) listed in %d hook table(s).",
+          static_cast<int>(numHooksCreated),
+          static_cast<int>(hookSpecs.size()),
+          static_cast<int>(numHookTables));
+
+      return numHooksCreated;
+    }
+  } // namespace HookTable
+} // namespace Hookshot
@@ -34,8 +34,25 @@ namespace Hookshot
           {
               ConfigurationFileLayoutNameAndValueType(
                   Strings::kStrConfigurationSettingNameHookModule, EValueType::StringMultiValue),
+              ConfigurationFileLayoutNameAndValueType(
+                  Strings::kStrConfigurationSettingNameHookModuleBundle,
+                  EValueType::StringMultiValue),
               ConfigurationFileLayoutNameAndValueType(
                   Strings::kStrConfigurationSettingNameInject, EValueType::StringMultiValue),
+              ConfigurationFileLayoutNameAndValueType(
+                  Strings::kStrConfigurationSettingNameInjectDeferred,
+                  EValueType::StringMultiValue),
+              ConfigurationFileLayoutNameAndValueType(
+                  Strings::kStrConfigurationSettingNameTraceCall, EValueType::StringMultiValue),
+              ConfigurationFileLayoutNameAndValueType(
+                  Strings::kStrConfigurationSettingNamePreallocateTrampolinesNear,
+                  EValueType::StringMultiValue),
+              ConfigurationFileLayoutNameAndValueType(
+                  Strings::kStrConfigurationSettingNameAllowChildProcess,
+                  EValueType::StringMultiValue),
+              ConfigurationFileLayoutNameAndValueType(
+                  Strings::kStrConfigurationSettingNameDenyChildProcess,
+                  EValueType::StringMultiValue),
               ConfigurationFileLayoutNameAndValueType(
                   Strings::kStrConfigurationSettingNameLogLevel, EValueType::Integer),
               ConfigurationFileLayoutNameAndValueType(
@@ -44,9 +61,143 @@ namespace Hookshot
               ConfigurationFileLayoutNameAndValueType(
                   Strings::kStrConfigurationSettingNameLoadHookModulesFromHookshotDirectory,
                   EValueType::Boolean),
+              ConfigurationFileLayoutNameAndValueType(
+                  Strings::kStrConfigurationSettingNameRestrictHookModuleSearchPath,
+                  EValueType::Boolean),
+              ConfigurationFileLayoutNameAndValueType(
+                  Strings::kStrConfigurationSettingNameHookModuleSearchDirectory,
+                  EValueType::StringMultiValue),
+              ConfigurationFileLayoutNameAndValueType(
+                  Strings::kStrConfigurationSettingNameLoadHookModulesInParallel,
+                  EValueType::Boolean),
+              ConfigurationFileLayoutNameAndValueType(
+                  Strings::kStrConfigurationSettingNamePreserveHookModuleOrder,
+                  EValueType::Boolean),
+              ConfigurationFileLayoutNameAndValueType(
+                  Strings::kStrConfigurationSettingNameWriteProtectTrampolines,
+                  EValueType::Boolean),
+              ConfigurationFileLayoutNameAndValueType(
+                  Strings::kStrConfigurationSettingNameLockTrampolinePages, EValueType::Boolean),
+              ConfigurationFileLayoutNameAndValueType(
+                  Strings::kStrConfigurationSettingNameMonitorHookIntegrity, EValueType::Boolean),
+              ConfigurationFileLayoutNameAndValueType(
+                  Strings::kStrConfigurationSettingNameInjectChildProcessesAsynchronously,
+                  EValueType::Boolean),
+              ConfigurationFileLayoutNameAndValueType(
+                  Strings::kStrConfigurationSettingNameShareInternalHookLayoutWithChildProcesses,
+                  EValueType::Boolean),
+              ConfigurationFileLayoutNameAndValueType(
+                  Strings::kStrConfigurationSettingNameInstrumentHooks, EValueType::Boolean),
+              ConfigurationFileLayoutNameAndValueType(
+                  Strings::kStrConfigurationSettingNameHookTimingSampleInterval,
+                  EValueType::Integer),
+              ConfigurationFileLayoutNameAndValueType(
+                  Strings::kStrConfigurationSettingNameSampledHookInterval, EValueType::Integer),
+              ConfigurationFileLayoutNameAndValueType(
+                  Strings::kStrConfigurationSettingNameRecordHookCallers, EValueType::Boolean),
+              ConfigurationFileLayoutNameAndValueType(
+                  Strings::kStrConfigurationSettingNameHookLatencyBudgetMicroseconds,
+                  EValueType::Integer),
+              ConfigurationFileLayoutNameAndValueType(
+                  Strings::kStrConfigurationSettingNameDirectHookJumps, EValueType::Boolean),
+              ConfigurationFileLayoutNameAndValueType(
+                  Strings::kStrConfigurationSettingNameSegregateHookStubs, EValueType::Boolean),
+              ConfigurationFileLayoutNameAndValueType(
+                  Strings::kStrConfigurationSettingNameHotReloadHookModules, EValueType::Boolean),
+              ConfigurationFileLayoutNameAndValueType(
+                  Strings::kStrConfigurationSettingNamePublishHookStatistics, EValueType::Boolean),
+              ConfigurationFileLayoutNameAndValueType(
+                  Strings::kStrConfigurationSettingNameWriteExitSummary, EValueType::Boolean),
+              ConfigurationFileLayoutNameAndValueType(
+                  Strings::kStrConfigurationSettingNameLogToMappedFile, EValueType::Boolean),
+              ConfigurationFileLayoutNameAndValueType(
+                  Strings::kStrConfigurationSettingNameShareMappedLogWithChildProcesses,
+                  EValueType::Boolean),
+              ConfigurationFileLayoutNameAndValueType(
+                  Strings::kStrConfigurationSettingNameCacheHookPlans, EValueType::Boolean),
+              ConfigurationFileLayoutNameAndValueType(
+                  Strings::kStrConfigurationSettingNameCacheHookModuleManifest,
+                  EValueType::Boolean),
+              ConfigurationFileLayoutNameAndValueType(
+                  Strings::kStrConfigurationSettingNameShareInjectedCode, EValueType::Boolean),
+              ConfigurationFileLayoutNameAndValueType(
+                  Strings::kStrConfigurationSettingNamePinHookshotLibraryImage,
+                  EValueType::Boolean),
+              ConfigurationFileLayoutNameAndValueType(
+                  Strings::kStrConfigurationSettingNameInjectUsingApc, EValueType::Boolean),
+              ConfigurationFileLayoutNameAndValueType(
+                  Strings::kStrConfigurationSettingNameInjectChildProcessesUsingJob,
+                  EValueType::Boolean),
+              ConfigurationFileLayoutNameAndValueType(
+                  Strings::kStrConfigurationSettingNameProfileStartup, EValueType::Boolean),
+              ConfigurationFileLayoutNameAndValueType(
+                  Strings::kStrConfigurationSettingNameFollowJumpThunks, EValueType::Boolean),
+              ConfigurationFileLayoutNameAndValueType(
+                  Strings::kStrConfigurationSettingNameCachePatternSearches, EValueType::Boolean),
+              ConfigurationFileLayoutNameAndValueType(
+                  Strings::kStrConfigurationSettingNamePreferImportHooksForIsolatedPages,
+                  EValueType::Boolean),
+              ConfigurationFileLayoutNameAndValueType(
+                  Strings::kStrConfigurationSettingNamePreferEfficiencyCoresForBackgroundWork,
+                  EValueType::Boolean),
+              ConfigurationFileLayoutNameAndValueType(
+                  Strings::kStrConfigurationSettingNameLowerBackgroundWorkPriority,
+                  EValueType::Boolean),
+              ConfigurationFileLayoutNameAndValueType(
+                  Strings::kStrConfigurationSettingNamePerformanceProfile, EValueType::String),
+              ConfigurationFileLayoutNameAndValueType(
+                  Strings::kStrConfigurationSettingNameWatchConfigurationFile,
+                  EValueType::Boolean),
           }),
   };
 
+  /// Holds the layout of every performance profile section, which can contain any of the settings
+  /// that select the injection, hook installation, and instrumentation modes.
+  static const TConfigurationFileLayout::mapped_type performanceProfileSectionLayout = {
+      ConfigurationFileLayoutNameAndValueType(
+          Strings::kStrConfigurationSettingNameInjectChildProcessesAsynchronously,
+          EValueType::Boolean),
+      ConfigurationFileLayoutNameAndValueType(
+          Strings::kStrConfigurationSettingNameInjectChildProcessesUsingJob, EValueType::Boolean),
+      ConfigurationFileLayoutNameAndValueType(
+          Strings::kStrConfigurationSettingNameInjectUsingApc, EValueType::Boolean),
+      ConfigurationFileLayoutNameAndValueType(
+          Strings::kStrConfigurationSettingNameShareInjectedCode, EValueType::Boolean),
+      ConfigurationFileLayoutNameAndValueType(
+          Strings::kStrConfigurationSettingNameLoadHookModulesInParallel, EValueType::Boolean),
+      ConfigurationFileLayoutNameAndValueType(
+          Strings::kStrConfigurationSettingNameDirectHookJumps, EValueType::Boolean),
+      ConfigurationFileLayoutNameAndValueType(
+          Strings::kStrConfigurationSettingNameSegregateHookStubs, EValueType::Boolean),
+      ConfigurationFileLayoutNameAndValueType(
+          Strings::kStrConfigurationSettingNameWriteProtectTrampolines, EValueType::Boolean),
+      ConfigurationFileLayoutNameAndValueType(
+          Strings::kStrConfigurationSettingNameLockTrampolinePages, EValueType::Boolean),
+      ConfigurationFileLayoutNameAndValueType(
+          Strings::kStrConfigurationSettingNameFollowJumpThunks, EValueType::Boolean),
+      ConfigurationFileLayoutNameAndValueType(
+          Strings::kStrConfigurationSettingNamePreferImportHooksForIsolatedPages,
+          EValueType::Boolean),
+      ConfigurationFileLayoutNameAndValueType(
+          Strings::kStrConfigurationSettingNamePreferEfficiencyCoresForBackgroundWork,
+          EValueType::Boolean),
+      ConfigurationFileLayoutNameAndValueType(
+          Strings::kStrConfigurationSettingNameLowerBackgroundWorkPriority, EValueType::Boolean),
+      ConfigurationFileLayoutNameAndValueType(
+          Strings::kStrConfigurationSettingNameMonitorHookIntegrity, EValueType::Boolean),
+      ConfigurationFileLayoutNameAndValueType(
+          Strings::kStrConfigurationSettingNameInstrumentHooks, EValueType::Boolean),
+      ConfigurationFileLayoutNameAndValueType(
+          Strings::kStrConfigurationSettingNameRecordHookCallers, EValueType::Boolean),
+      ConfigurationFileLayoutNameAndValueType(
+          Strings::kStrConfigurationSettingNameHookTimingSampleInterval, EValueType::Integer),
+      ConfigurationFileLayoutNameAndValueType(
+          Strings::kStrConfigurationSettingNameSampledHookInterval, EValueType::Integer),
+      ConfigurationFileLayoutNameAndValueType(
+          Strings::kStrConfigurationSettingNameHookLatencyBudgetMicroseconds,
+          EValueType::Integer),
+  };
+
   /// Holds the section name for the per-executable settings. This is dynamically set to the name of
   /// the currently-running executable.
   std::wstring executableSpecificSectionName;
@@ -69,36 +220,167 @@ namespace Hookshot
           {
               ConfigurationFileLayoutNameAndValueType(
                   Strings::kStrConfigurationSettingNameHookModule, EValueType::StringMultiValue),
+              ConfigurationFileLayoutNameAndValueType(
+                  Strings::kStrConfigurationSettingNameHookModuleBundle,
+                  EValueType::StringMultiValue),
               ConfigurationFileLayoutNameAndValueType(
                   Strings::kStrConfigurationSettingNameInject, EValueType::StringMultiValue),
+              ConfigurationFileLayoutNameAndValueType(
+                  Strings::kStrConfigurationSettingNameInjectDeferred,
+                  EValueType::StringMultiValue),
+              ConfigurationFileLayoutNameAndValueType(
+                  Strings::kStrConfigurationSettingNameTraceCall, EValueType::StringMultiValue),
+              ConfigurationFileLayoutNameAndValueType(
+                  Strings::kStrConfigurationSettingNamePreallocateTrampolinesNear,
+                  EValueType::StringMultiValue),
+              ConfigurationFileLayoutNameAndValueType(
+                  Strings::kStrConfigurationSettingNameAllowChildProcess,
+                  EValueType::StringMultiValue),
+              ConfigurationFileLayoutNameAndValueType(
+                  Strings::kStrConfigurationSettingNameDenyChildProcess,
+                  EValueType::StringMultiValue),
+              ConfigurationFileLayoutNameAndValueType(
+                  Strings::kStrConfigurationSettingNamePerformanceProfile, EValueType::String),
           }));
 
       configurationFileLayoutIsComplete = true;
     }
   }
 
+  /// Determines whether or not the specified section defines a performance profile.
+  /// @param [in] section Section name.
+  /// @return `true` if so, `false` otherwise.
+  static inline bool IsPerformanceProfileSection(std::wstring_view section)
+  {
+    return section.starts_with(Strings::kStrConfigurationSectionPrefixPerformanceProfile);
+  }
+
+  /// Determines the name of the section that defines the performance profile assigned to the
+  /// currently-running executable.
+  /// @param [in] configData Configuration data that was read.
+  /// @return Section name, or an empty string if no performance profile is assigned.
+  static std::wstring PerformanceProfileSectionName(const ConfigurationData& configData)
+  {
+    const std::wstring_view sectionsByPrecedence[] = {
+        Infra::ProcessInfo::GetExecutableBaseName(), kSectionNameGlobal};
+
+    for (const std::wstring_view section : sectionsByPrecedence)
+    {
+      if (false ==
+          configData.Contains(section, Strings::kStrConfigurationSettingNamePerformanceProfile))
+        continue;
+
+      // The setting holds a single value, so the first one is the only one.
+      for (const auto& profileName :
+           configData[section][Strings::kStrConfigurationSettingNamePerformanceProfile].Values())
+        return std::wstring(Strings::kStrConfigurationSectionPrefixPerformanceProfile) +
+            std::wstring(std::wstring_view(profileName));
+    }
+
+    return std::wstring();
+  }
+
+  SPerformanceProfile HookshotConfigReader::ReadPerformanceProfile(
+      const ConfigurationData& configData)
+  {
+    const std::wstring profileSectionName = PerformanceProfileSectionName(configData);
+
+    // Each setting comes from the profile if it sets it, otherwise from the global section.
+    const auto settingValue = [&configData, &profileSectionName](
+                                  std::wstring_view settingName, auto defaultValue)
+    {
+      if ((false == profileSectionName.empty()) &&
+          (true == configData.Contains(profileSectionName, settingName)))
+        return configData[profileSectionName][settingName].ValueOr(defaultValue);
+
+      return configData[kSectionNameGlobal][settingName].ValueOr(defaultValue);
+    };
+
+    return {
+        .injectChildProcessesAsynchronously = settingValue(
+            Strings::kStrConfigurationSettingNameInjectChildProcessesAsynchronously, false),
+        .injectChildProcessesUsingJob =
+            settingValue(Strings::kStrConfigurationSettingNameInjectChildProcessesUsingJob, false),
+        .injectUsingApc = settingValue(Strings::kStrConfigurationSettingNameInjectUsingApc, false),
+        .shareInjectedCode =
+            settingValue(Strings::kStrConfigurationSettingNameShareInjectedCode, false),
+        .loadHookModulesInParallel =
+            settingValue(Strings::kStrConfigurationSettingNameLoadHookModulesInParallel, false),
+        .directHookJumps =
+            settingValue(Strings::kStrConfigurationSettingNameDirectHookJumps, false),
+        .segregateHookStubs =
+            settingValue(Strings::kStrConfigurationSettingNameSegregateHookStubs, false),
+        .writeProtectTrampolines =
+            settingValue(Strings::kStrConfigurationSettingNameWriteProtectTrampolines, false),
+        .lockTrampolinePages =
+            settingValue(Strings::kStrConfigurationSettingNameLockTrampolinePages, false),
+        .followJumpThunks =
+            settingValue(Strings::kStrConfigurationSettingNameFollowJumpThunks, false),
+        .preferImportHooksForIsolatedPages = settingValue(
+            Strings::kStrConfigurationSettingNamePreferImportHooksForIsolatedPages, false),
+        .preferEfficiencyCoresForBackgroundWork = settingValue(
+            Strings::kStrConfigurationSettingNamePreferEfficiencyCoresForBackgroundWork, false),
+        .lowerBackgroundWorkPriority = settingValue(
+            Strings::kStrConfigurationSettingNameLowerBackgroundWorkPriority, false),
+        .monitorHookIntegrity =
+            settingValue(Strings::kStrConfigurationSettingNameMonitorHookIntegrity, false),
+        .instrumentHooks =
+            settingValue(Strings::kStrConfigurationSettingNameInstrumentHooks, false),
+        .recordHookCallers =
+            settingValue(Strings::kStrConfigurationSettingNameRecordHookCallers, false),
+        .hookTimingSampleInterval = settingValue(
+            Strings::kStrConfigurationSettingNameHookTimingSampleInterval, TIntegerValue(0)),
+        .sampledHookInterval = settingValue(
+            Strings::kStrConfigurationSettingNameSampledHookInterval, TIntegerValue(0)),
+        .hookLatencyBudgetMicroseconds = settingValue(
+            Strings::kStrConfigurationSettingNameHookLatencyBudgetMicroseconds, TIntegerValue(0)),
+    };
+  }
+
   Action HookshotConfigReader::ActionForSection(std::wstring_view section)
   {
     if (0 != configurationFileLayout.count(section)) return Action::Process();
+    if (true == IsPerformanceProfileSection(section)) return Action::Process();
+
+    // Sections for other executables are needed when generating a configuration cache.
+    if (true == captureValues) return Action::Process();
+
     return Action::Skip();
   }
 
   Action HookshotConfigReader::ActionForValue(
       std::wstring_view section, std::wstring_view name, const TIntegerView value)
   {
-    if (value >= 0) return Action::Process();
+    if (value >= 0)
+    {
+      CaptureValue(
+          section,
+          name,
+          ConfigurationCache::EConfigurationCacheValueType::Integer,
+          static_cast<int64_t>(value),
+          std::wstring_view());
+      return Action::Process();
+    }
+
     return Action::Error();
   }
 
   Action HookshotConfigReader::ActionForValue(
       std::wstring_view section, std::wstring_view name, const TBooleanView value)
   {
+    CaptureValue(
+        section,
+        name,
+        ConfigurationCache::EConfigurationCacheValueType::Boolean,
+        ((true == value) ? 1 : 0),
+        std::wstring_view());
     return Action::Process();
   }
 
   Action HookshotConfigReader::ActionForValue(
       std::wstring_view section, std::wstring_view name, const TStringView value)
   {
+    CaptureValue(section, name, ConfigurationCache::EConfigurationCacheValueType::String, 0, value);
     return Action::Process();
   }
 
@@ -109,7 +391,21 @@ namespace Hookshot
 
   EValueType HookshotConfigReader::TypeForValue(std::wstring_view section, std::wstring_view name)
   {
+    if (true == IsPerformanceProfileSection(section))
+    {
+      auto settingInfo = performanceProfileSectionLayout.find(name);
+      if (performanceProfileSectionLayout.end() == settingInfo) return EValueType::Error;
+
+      return settingInfo->second;
+    }
+
     auto sectionLayout = configurationFileLayout.find(section);
+
+    // While capturing, sections for other executables support the same settings as the section
+    // for the currently-running executable.
+    if ((configurationFileLayout.end() == sectionLayout) && (true == captureValues))
+      sectionLayout = configurationFileLayout.find(Infra::ProcessInfo::GetExecutableBaseName());
+
     if (configurationFileLayout.end() == sectionLayout) return EValueType::Error;
 
     auto settingInfo = sectionLayout->second.find(name);
@@ -117,4 +413,21 @@ namespace Hookshot
 
     return settingInfo->second;
   }
+
+  void HookshotConfigReader::CaptureValue(
+      std::wstring_view section,
+      std::wstring_view name,
+      ConfigurationCache::EConfigurationCacheValueType type,
+      int64_t integerValue,
+      std::wstring_view stringValue)
+  {
+    if (false == captureValues) return;
+
+    capturedValues.push_back(
+        {.section = std::wstring(section),
+         .name = std::wstring(name),
+         .type = type,
+         .integerValue = integerValue,
+         .stringValue = std::wstring(stringValue)});
+  }
 } // namespace Hookshot
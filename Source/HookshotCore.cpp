@@ -0,0 +1,330 @@
+/***************************************************************************************************
+ * Hookshot
+ *   General-purpose library for injecting DLLs and hooking function calls.
+ ***************************************************************************************************
+ * Authored by Samuel Grossman
+ * Copyright (c) 2019-2025
+ ***********************************************************************************************//**
+ * @file HookshotCore.cpp
+ *   Implementation of the direct interface to Hookshot's static core library.
+ **************************************************************************************************/
+
+#include "HookshotCore.h"
+
+#include <cstddef>
+#include <cstdint>
+
+#include "CallTracing.h"
+#include "DebugRegisterHooks.h"
+#include "Globals.h"
+#include "HookshotTypes.h"
+#include "HookStore.h"
+#include "LibraryInterface.h"
+
+namespace Hookshot
+{
+  namespace Core
+  {
+    /// Retrieves the hook store as its concrete type. The hook store class is final, so calling
+    /// methods through the returned reference does not involve its virtual function table.
+    /// @return Hook store object.
+    static inline HookStore& GetHookStore(void)
+    {
+      return *static_cast<HookStore*>(LibraryInterface::GetHookshotInterfacePointer());
+    }
+
+    bool Initialize(void)
+    {
+      return LibraryInterface::Initialize(Globals::ELoadMethod::LibraryLoaded);
+    }
+
+    IHookshot* GetInterface(void)
+    {
+      return LibraryInterface::GetHookshotInterfacePointer();
+    }
+
+    void AttachCurrentThread(void)
+    {
+      DebugRegisterHooks::ApplyToCurrentThread();
+      CallTracing::AttachCurrentThread();
+    }
+
+    void DetachCurrentThread(void)
+    {
+      CallTracing::DetachCurrentThread();
+    }
+
+    EResult CreateHook(void* originalFunc, const void* hookFunc)
+    {
+      return GetHookStore().CreateHook(originalFunc, hookFunc);
+    }
+
+    EResult CreateHooks(const SHookSpec* hookSpecs, size_t numHookSpecs, EResult* results)
+    {
+      return GetHookStore().CreateHooks(hookSpecs, numHookSpecs, results);
+    }
+
+    EResult CreateHooksByExportName(
+        void* moduleHandle,
+        const char* const* exportNames,
+        const void* const* hookFuncs,
+        size_t numHooks,
+        EResult* results)
+    {
+      return GetHookStore().CreateHooksByExportName(
+          moduleHandle, exportNames, hookFuncs, numHooks, results);
+    }
+
+    EResult DisableHookFunction(const void* originalOrHookFunc)
+    {
+      return GetHookStore().DisableHookFunction(originalOrHookFunc);
+    }
+
+    const void* GetOriginalFunction(const void* originalOrHookFunc)
+    {
+      return GetHookStore().GetOriginalFunction(originalOrHookFunc);
+    }
+
+    EResult ReplaceHookFunction(const void* originalOrHookFunc, const void* newHookFunc)
+    {
+      return GetHookStore().ReplaceHookFunction(originalOrHookFunc, newHookFunc);
+    }
+
+    EResult RemoveHook(const void* originalOrHookFunc)
+    {
+      return GetHookStore().RemoveHook(originalOrHookFunc);
+    }
+
+    EResult BeginTransaction(void)
+    {
+      return GetHookStore().BeginTransaction();
+    }
+
+    EResult CommitTransaction(void)
+    {
+      return GetHookStore().CommitTransaction();
+    }
+
+    EResult GetHookStatistics(const void* originalOrHookFunc, SHookStatistics* statistics)
+    {
+      return GetHookStore().GetHookStatistics(originalOrHookFunc, statistics);
+    }
+
+    EResult SetHookGroup(const void* originalOrHookFunc, uint32_t groupId)
+    {
+      return GetHookStore().SetHookGroup(originalOrHookFunc, groupId);
+    }
+
+    EResult SetHookGroupEnabled(uint32_t groupId, bool enabled)
+    {
+      return GetHookStore().SetHookGroupEnabled(groupId, enabled);
+    }
+
+    EResult CreateCallbackHook(
+        void* originalFunc,
+        TCallbackHookPre preCallback,
+        TCallbackHookPost postCallback,
+        void* context)
+    {
+      return GetHookStore().CreateCallbackHook(originalFunc, preCallback, postCallback, context);
+    }
+
+    EResult CreateContextHook(void* originalFunc, const void* hookFunc, void* context)
+    {
+      return GetHookStore().CreateContextHook(originalFunc, hookFunc, context);
+    }
+
+    size_t GetHookContextOffset(void)
+    {
+      return GetHookStore().GetHookContextOffset();
+    }
+
+    EResult CreateProbe(void* address, TProbeCallback callback, void* context)
+    {
+      return GetHookStore().CreateProbe(address, callback, context);
+    }
+
+    EResult FindPatterns(
+        void* moduleHandle, const SBytePattern* patterns, size_t numPatterns, void** results)
+    {
+      return GetHookStore().FindPatterns(moduleHandle, patterns, numPatterns, results);
+    }
+
+    EResult CreateHotSwapHook(void* originalFunc, const void* hookFunc, SHotSwapSlot** slot)
+    {
+      return GetHookStore().CreateHotSwapHook(originalFunc, hookFunc, slot);
+    }
+
+    EResult HotSwapHookFunction(SHotSwapSlot* slot, const void* newHookFunc)
+    {
+      return GetHookStore().HotSwapHookFunction(slot, newHookFunc);
+    }
+
+    EResult SetThreadHookOverride(const void* originalOrHookFunc, const void* overrideFunc)
+    {
+      return GetHookStore().SetThreadHookOverride(originalOrHookFunc, overrideFunc);
+    }
+
+    EResult SetHookLatencyBudget(const void* originalOrHookFunc, uint32_t budgetMicroseconds)
+    {
+      return GetHookStore().SetHookLatencyBudget(originalOrHookFunc, budgetMicroseconds);
+    }
+
+    EResult GetMemoryFootprint(SMemoryFootprint* footprint)
+    {
+      return GetHookStore().GetMemoryFootprint(footprint);
+    }
+
+    EResult GetTrampolineStoreFootprints(
+        STrampolineStoreFootprint* storeFootprints, size_t maxStoreFootprints, size_t* numStores)
+    {
+      return GetHookStore().GetTrampolineStoreFootprints(
+          storeFootprints, maxStoreFootprints, numStores);
+    }
+
+    EResult GetModuleFootprints(
+        SModuleFootprint* moduleFootprints, size_t maxModuleFootprints, size_t* numModules)
+    {
+      return GetHookStore().GetModuleFootprints(moduleFootprints, maxModuleFootprints, numModules);
+    }
+
+    EResult GetOriginalFunctions(
+        const void* const* originalOrHookFuncs, size_t numFuncs, const void** originalFuncs)
+    {
+      return GetHookStore().GetOriginalFunctions(originalOrHookFuncs, numFuncs, originalFuncs);
+    }
+
+    EResult ReplaceHookFunctions(
+        const void* const* originalOrHookFuncs,
+        const void* const* newHookFuncs,
+        size_t numFuncs,
+        EResult* results)
+    {
+      return GetHookStore().ReplaceHookFunctions(
+          originalOrHookFuncs, newHookFuncs, numFuncs, results);
+    }
+
+    EResult DisableHookFunctions(
+        const void* const* originalOrHookFuncs, size_t numFuncs, EResult* results)
+    {
+      return GetHookStore().DisableHookFunctions(originalOrHookFuncs, numFuncs, results);
+    }
+
+    EResult GetHooksStatistics(
+        const void* const* originalOrHookFuncs,
+        size_t numFuncs,
+        SHookStatistics* statistics,
+        EResult* results)
+    {
+      return GetHookStore().GetHooksStatistics(originalOrHookFuncs, numFuncs, statistics, results);
+    }
+
+    EResult RemoveHooks(const void* const* originalOrHookFuncs, size_t numFuncs, EResult* results)
+    {
+      return GetHookStore().RemoveHooks(originalOrHookFuncs, numFuncs, results);
+    }
+
+    EResult GetHookCallerHistogram(const void* originalOrHookFunc, SHookCallerHistogram* histogram)
+    {
+      return GetHookStore().GetHookCallerHistogram(originalOrHookFunc, histogram);
+    }
+
+    EResult InstrumentModuleExports(
+        void* moduleHandle, const SModuleInstrumentationOptions* options, size_t* numInstrumented)
+    {
+      return GetHookStore().InstrumentModuleExports(moduleHandle, options, numInstrumented);
+    }
+
+    EResult CreateHookAuto(void* originalFunc, const void* hookFunc, EHookKind* chosenKind)
+    {
+      return GetHookStore().CreateHookAuto(originalFunc, hookFunc, chosenKind);
+    }
+
+    EResult Seal(void)
+    {
+      return GetHookStore().Seal();
+    }
+
+    EResult CreateOneShotHook(void* originalFunc, const void* hookFunc)
+    {
+      return GetHookStore().CreateOneShotHook(originalFunc, hookFunc);
+    }
+
+    EResult InvalidateCodeRange(const void* rangeBase, size_t rangeSizeBytes)
+    {
+      return GetHookStore().InvalidateCodeRange(rangeBase, rangeSizeBytes);
+    }
+
+    EResult RelocateCode(
+        const void* src,
+        size_t minBytes,
+        void* dst,
+        size_t dstCapacity,
+        uint32_t options,
+        SRelocatedCode* relocated)
+    {
+      return GetHookStore().RelocateCode(src, minBytes, dst, dstCapacity, options, relocated);
+    }
+
+    EResult CreateHookEx(
+        void* originalFunc,
+        const void* hookFunc,
+        const void** originalFuncOut,
+        HookHandle* handleOut)
+    {
+      return GetHookStore().CreateHookEx(originalFunc, hookFunc, originalFuncOut, handleOut);
+    }
+
+    EResult GetHookHandle(const void* originalOrHookFunc, HookHandle* handle)
+    {
+      return GetHookStore().GetHookHandle(originalOrHookFunc, handle);
+    }
+
+    EResult ReplaceHookFunctionByHandle(HookHandle handle, const void* newHookFunc)
+    {
+      return GetHookStore().ReplaceHookFunctionByHandle(handle, newHookFunc);
+    }
+
+    EResult DisableHookFunctionByHandle(HookHandle handle)
+    {
+      return GetHookStore().DisableHookFunctionByHandle(handle);
+    }
+
+    EResult GetHookStatisticsByHandle(HookHandle handle, SHookStatistics* statistics)
+    {
+      return GetHookStore().GetHookStatisticsByHandle(handle, statistics);
+    }
+
+    EResult CreateHooksBySymbol(
+        const wchar_t* symbolIndexFilename,
+        void* moduleHandle,
+        const char* const* symbolNames,
+        const void* const* hookFuncs,
+        size_t numHooks,
+        EResult* results)
+    {
+      return GetHookStore().CreateHooksBySymbol(
+          symbolIndexFilename, moduleHandle, symbolNames, hookFuncs, numHooks, results);
+    }
+
+    EResult CreateSampledHook(void* originalFunc, const void* hookFunc, uint32_t sampleInterval)
+    {
+      return GetHookStore().CreateSampledHook(originalFunc, hookFunc, sampleInterval);
+    }
+
+    EResult SetSampledHookInterval(const void* originalFunc, uint32_t sampleInterval)
+    {
+      return GetHookStore().SetSampledHookInterval(originalFunc, sampleInterval);
+    }
+
+    EResult CanHook(const void* originalFunc, SHookFeasibility* feasibility)
+    {
+      return GetHookStore().CanHook(originalFunc, feasibility);
+    }
+
+    EResult GetHookPlanCacheStatistics(SHookPlanCacheStatistics* statistics)
+    {
+      return GetHookStore().GetHookPlanCacheStatistics(statistics);
+    }
+  } // namespace Core
+} // namespace Hookshot
@@ -0,0 +1,148 @@
+/***************************************************************************************************
+ * Hookshot
+ *   General-purpose library for injecting DLLs and hooking function calls.
+ ***************************************************************************************************
+ * Authored by Samuel Grossman
+ * Copyright (c) 2019-2025
+ ***********************************************************************************************//**
+ * @file HotSwap.cpp
+ *   Implementation of the stubs and slots through which hot-swappable hooks reach their hook
+ *   functions.
+ **************************************************************************************************/
+
+#include "HotSwap.h"
+
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <new>
+#include <vector>
+
+#include <Infra/Core/ProcessInfo.h>
+#include <Infra/Core/SystemInfo.h>
+
+#include "ApiWindows.h"
+#include "DependencyProtect.h"
+
+namespace Hookshot
+{
+  namespace HotSwap
+  {
+    /// Size of each hot-swap stub, in bytes. Stubs are aligned to this size so that none of them
+    /// straddles a cache line.
+    static constexpr size_t kStubSizeBytes = 16;
+
+    /// Beginning of every hot-swap stub. In 64-bit mode the operand that follows is a displacement
+    /// from the end of the instruction to the slot, and in 32-bit mode it is the absolute address
+    /// of the slot. Either way the jump target is read from the slot as data, so changing the slot
+    /// never requires an instruction cache flush.
+    static constexpr uint8_t kStubCodePreamble[] = {
+        // jmp QWORD PTR [rip + disp32] in 64-bit mode, jmp DWORD PTR [abs32] in 32-bit mode
+        0xff,
+        0x25,
+    };
+
+    /// Fills the remainder of every hot-swap stub. This is the "int 3" instruction, which breaks
+    /// into the debugger if ever executed.
+    static constexpr uint8_t kStubCodePadding = 0xcc;
+
+    /// Slots that are ready to be handed out, in the order they should be handed out.
+    static std::vector<SHotSwapSlot*> freeSlots;
+
+    /// Retrieves the size of each code page and each data page, which is the system page size.
+    /// @return Page size in bytes.
+    static size_t PageSizeBytes(void)
+    {
+      return static_cast<size_t>(Infra::SystemInfo::GetPlatformAndArchitectureInfo().dwPageSize);
+    }
+
+    /// Writes the code for a single hot-swap stub.
+    /// @param [out] stub Location at which to write the stub.
+    /// @param [in] slot Slot through which the stub transfers control.
+    static void WriteStubCode(uint8_t* stub, const SHotSwapSlot* slot)
+    {
+      std::memset(stub, kStubCodePadding, kStubSizeBytes);
+      std::memcpy(stub, kStubCodePreamble, sizeof(kStubCodePreamble));
+
+#ifdef _WIN64
+      const int32_t operand = static_cast<int32_t>(
+          reinterpret_cast<const uint8_t*>(slot) -
+          &stub[sizeof(kStubCodePreamble) + sizeof(int32_t)]);
+#else
+      const uint32_t operand = reinterpret_cast<uint32_t>(slot);
+#endif
+
+      std::memcpy(&stub[sizeof(kStubCodePreamble)], &operand, sizeof(operand));
+    }
+
+    /// Places a new code page immediately followed by its data page, fills the code page with one
+    /// stub per slot, and makes all of the new slots available. The data page immediately follows
+    /// the code page, so in 64-bit mode every slot is well within reach of its stub.
+    /// @return `true` on success, `false` on failure.
+    static bool PlacePages(void)
+    {
+      const size_t pageSizeBytes = PageSizeBytes();
+      const size_t numSlots = pageSizeBytes / kStubSizeBytes;
+
+      uint8_t* const code = reinterpret_cast<uint8_t*>(Protected::Windows_VirtualAlloc(
+          nullptr, pageSizeBytes * 2, MEM_RESERVE | MEM_COMMIT, PAGE_READWRITE));
+      if (nullptr == code) return false;
+
+      SHotSwapSlot* const slots = reinterpret_cast<SHotSwapSlot*>(&code[pageSizeBytes]);
+      for (size_t i = 0; i < numSlots; ++i)
+      {
+        new (&slots[i]) SHotSwapSlot{.hookFunc = nullptr};
+        WriteStubCode(&code[i * kStubSizeBytes], &slots[i]);
+      }
+
+      DWORD unusedOldProtection = 0;
+      if (0 ==
+          Protected::Windows_VirtualProtect(
+              code, pageSizeBytes, PAGE_EXECUTE_READ, &unusedOldProtection))
+      {
+        Protected::Windows_VirtualFree(code, 0, MEM_RELEASE);
+        return false;
+      }
+
+      Protected::Windows_FlushInstructionCache(
+          Infra::ProcessInfo::GetCurrentProcessHandle(), code, pageSizeBytes);
+
+      // Slots are handed out from the back of the free list, so they are added in reverse order to
+      // keep consecutively-allocated stubs adjacent.
+      freeSlots.reserve(freeSlots.size() + numSlots);
+      for (size_t i = numSlots; i > 0; --i)
+        freeSlots.push_back(&slots[i - 1]);
+
+      return true;
+    }
+
+    SHotSwapSlot* AllocateSlot(const void* hookFunc)
+    {
+      if ((true == freeSlots.empty()) && (false == PlacePages())) return nullptr;
+
+      SHotSwapSlot* const slot = freeSlots.back();
+      freeSlots.pop_back();
+
+      SetHookFunction(slot, hookFunc);
+      return slot;
+    }
+
+    void DeallocateSlot(SHotSwapSlot* slot)
+    {
+      SetHookFunction(slot, nullptr);
+      freeSlots.push_back(slot);
+    }
+
+    const void* GetStub(const SHotSwapSlot* slot)
+    {
+      // Each data page immediately follows its code page, and stubs are in the same order as slots.
+      const size_t pageSizeBytes = PageSizeBytes();
+      const size_t slotAddress = reinterpret_cast<size_t>(slot);
+      const size_t dataPage = slotAddress & ~(pageSizeBytes - 1);
+      const size_t slotIndex = (slotAddress - dataPage) / sizeof(SHotSwapSlot);
+
+      return reinterpret_cast<const void*>(
+          (dataPage - pageSizeBytes) + (slotIndex * kStubSizeBytes));
+    }
+  } // namespace HotSwap
+} // namespace Hookshot
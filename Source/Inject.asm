@@ -37,7 +37,9 @@ injectTrampolineEnd:
 
 
 ; Injected into the code region of a process. Reserved bytes at the beginning are to be overwritten
-; with the address of the data region.
+; with the displacement from the start of the code region to the data region. Using a displacement
+; rather than an address keeps the code region identical across processes that place their code
+; and data regions the same distance apart.
 
 injectCodeStart:
 
@@ -66,12 +68,17 @@ injectCodeBegin:
     ; Fix up the stack.
     ; Ensure it is aligned on a 16-byte boundary.
     stackAlignPush
+
+    ; Set up the stack for API calls.
+    ; This is done before the first synchronization because signalling the sync event requires an API call.
+    stackStdCallShadowPush
     
     ; Get the address of the data region.
     call $next
   $next:
     pop sbp
-    mov sbp, SIZE_T PTR [sbp-($next-injectCodeStart)]
+    sub sbp, ($next-injectCodeStart)
+    add sbp, SIZE_T PTR [sbp]
 
     ; Initialize, then synchronize with the injecting process.
     injectSyncInit ssi, sdi
@@ -80,10 +87,8 @@ injectCodeBegin:
     ; Injecting process is filling in required structure values.
     ; Wait for it to finish.
     injectSync ssi, sdi, sbp
-    
-    ; Set up the stack for API calls.
-    stackStdCallShadowPush
-    
+
+  $loadLibrary:
     ; Load the library specified by the injecting process.
     mov scx, (SInjectData PTR [sbp]).strLibraryName
     mov sax, (SInjectData PTR [sbp]).funcLoadLibraryA
@@ -145,6 +150,46 @@ injectCodeBegin:
     mov (SInjectData PTR [sbp]).extendedInjectionResult, eax
     jmp $done
 
+
+; Alternative entry point within the main code, which runs as an asynchronous procedure call queued
+; to the main thread before it reaches the process entry point. The injecting process fills in all
+; required structure values before queueing it, so only the final synchronization is needed.
+; Upon completion, the landing code returns directly to whatever delivered the procedure call.
+
+injectApcBegin:
+
+    ; The procedure call parameter is not needed, so discard it.
+    ; Afterwards the stack holds only the return address, just like after the trampoline has run.
+    discard1ParamStdCall
+
+    ; Save all general-purpose registers in the same layout that the trampoline path produces.
+    ; Register sax is volatile and is saved only to preserve that layout.
+    push sax
+    push sbx
+    push scx
+    push sdx
+    push ssi
+    push sdi
+    push sbp
+
+    ; Fix up the stack.
+    ; Ensure it is aligned on a 16-byte boundary.
+    stackAlignPush
+
+    ; Set up the stack for API calls.
+    stackStdCallShadowPush
+
+    ; Get the address of the data region.
+    call $apcNext
+  $apcNext:
+    pop sbp
+    sub sbp, ($apcNext-injectCodeStart)
+    add sbp, SIZE_T PTR [sbp]
+
+    ; Initialize synchronization and proceed directly to loading the library.
+    injectSyncInit ssi, sdi
+    jmp $loadLibrary
+
 injectCodeEnd:
 
 
@@ -154,7 +199,7 @@ kStrInjectCodeSectionName                   ENDS
 kStrInjectMetaSectionName                   SEGMENT READ
 
 
-    SInjectMeta <kInjectionMetaMagicValue, 0, x1, x2, x3, x4, x5, x6>
+    SInjectMeta <kInjectionMetaMagicValue, 0, x1, x2, x3, x4, x5, x6, x7>
 
 
 kStrInjectMetaSectionName                   ENDS
@@ -166,6 +211,7 @@ x3 EQU (injectTrampolineEnd-injectTrampolineStart)
 x4 EQU (injectCodeStart-injectTrampolineStart)
 x5 EQU (injectCodeBegin-injectTrampolineStart)
 x6 EQU (injectCodeEnd-injectTrampolineStart)
+x7 EQU (injectApcBegin-injectTrampolineStart)
 
 
 END
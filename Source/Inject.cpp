@@ -43,58 +43,69 @@ namespace Hookshot
     DWORD offsetInjectCodeStart;
     DWORD offsetInjectCodeBegin;
     DWORD offsetInjectCodeEnd;
+    DWORD offsetInjectApcBegin;
   };
 
-  /// Obtains access to the binary data that contains the injection code.
+  /// Obtains access to the binary data that contains the injection code. Each resource is only
+  /// ever loaded once, by the single InjectInfo object that parses it.
+  /// @param [in] resourceId Identifier of the resource that holds the injection code.
   /// @param [out] baseAddress On success, filled with the base address of the injection code.
   /// @param [out] sizeBytes On success, filled with the size in bytes of the injection code.
   /// @return `true` on success, `false` on failure.
-  static bool LoadInjectCodeBinary(void** baseAddress, size_t* sizeBytes)
+  static bool LoadInjectCodeBinary(const WORD resourceId, void** baseAddress, size_t* sizeBytes)
   {
-    static void* injectCodeBinaryBaseAddress = nullptr;
-    static size_t injectCodeBinarySizeBytes = 0;
+    const HRSRC resourceInfoBlock = FindResource(
+        Infra::ProcessInfo::GetThisModuleInstanceHandle(), MAKEINTRESOURCE(resourceId), RT_RCDATA);
+    if (nullptr == resourceInfoBlock) return false;
 
-    if (nullptr == injectCodeBinaryBaseAddress)
-    {
-      const HRSRC resourceInfoBlock = FindResource(
-          Infra::ProcessInfo::GetThisModuleInstanceHandle(),
-          MAKEINTRESOURCE(IDR_HOOKSHOT_INJECT_CODE),
-          RT_RCDATA);
-      if (nullptr == resourceInfoBlock) return false;
+    const HGLOBAL resourceHandle =
+        LoadResource(Infra::ProcessInfo::GetThisModuleInstanceHandle(), resourceInfoBlock);
+    if (nullptr == resourceHandle) return false;
 
-      const HGLOBAL resourceHandle =
-          LoadResource(Infra::ProcessInfo::GetThisModuleInstanceHandle(), resourceInfoBlock);
-      if (nullptr == resourceHandle) return false;
+    void* const resourceBaseAddress = LockResource(resourceHandle);
+    if (nullptr == resourceBaseAddress) return false;
 
-      void* const resourceBaseAddress = LockResource(resourceHandle);
-      if (nullptr == resourceBaseAddress) return false;
+    size_t resourceSizeBytes = static_cast<size_t>(
+        SizeofResource(Infra::ProcessInfo::GetThisModuleInstanceHandle(), resourceInfoBlock));
+    if (0 == resourceSizeBytes) return false;
 
-      size_t resourceSizeBytes = static_cast<size_t>(
-          SizeofResource(Infra::ProcessInfo::GetThisModuleInstanceHandle(), resourceInfoBlock));
-      if (0 == resourceSizeBytes) return false;
+    *baseAddress = resourceBaseAddress;
+    *sizeBytes = resourceSizeBytes;
+    return true;
+  }
 
-      injectCodeBinaryBaseAddress = resourceBaseAddress;
-      injectCodeBinarySizeBytes = resourceSizeBytes;
-    }
+  const InjectInfo& InjectInfo::GetInstance(void)
+  {
+#ifdef _WIN64
+    static const InjectInfo injectInfo(IDR_HOOKSHOT_INJECT_CODE, IMAGE_FILE_MACHINE_AMD64);
+#else
+    static const InjectInfo injectInfo(IDR_HOOKSHOT_INJECT_CODE, IMAGE_FILE_MACHINE_I386);
+#endif
+    return injectInfo;
+  }
 
-    *baseAddress = injectCodeBinaryBaseAddress;
-    *sizeBytes = injectCodeBinarySizeBytes;
-    return true;
+#ifdef _WIN64
+  const InjectInfo& InjectInfo::GetWow64Instance(void)
+  {
+    static const InjectInfo injectInfo(IDR_HOOKSHOT_INJECT_CODE_WOW64, IMAGE_FILE_MACHINE_I386);
+    return injectInfo;
   }
+#endif
 
-  InjectInfo::InjectInfo(void)
+  InjectInfo::InjectInfo(const WORD resourceId, const WORD machine)
       : injectTrampolineStart(nullptr),
         injectTrampolineAddressMarker(nullptr),
         injectTrampolineEnd(nullptr),
         injectCodeStart(nullptr),
         injectCodeBegin(nullptr),
         injectCodeEnd(nullptr),
+        injectApcBegin(nullptr),
         initializationResult(EInjectResult::Failure)
   {
     void* injectBinaryBase = nullptr;
     size_t injectBinarySizeBytes = 0;
 
-    if (false == LoadInjectCodeBinary(&injectBinaryBase, &injectBinarySizeBytes))
+    if (false == LoadInjectCodeBinary(resourceId, &injectBinaryBase, &injectBinarySizeBytes))
     {
       initializationResult = EInjectResult::ErrorCannotLoadInjectCode;
       return;
@@ -127,23 +138,22 @@ namespace Hookshot
         return;
       }
 
-#ifdef _WIN64
-      if (IMAGE_FILE_MACHINE_AMD64 != ntHeader->FileHeader.Machine)
-#else
-      if (IMAGE_FILE_MACHINE_I386 != ntHeader->FileHeader.Machine)
-#endif
+      if (machine != ntHeader->FileHeader.Machine)
       {
         initializationResult = EInjectResult::ErrorMalformedInjectCodeFile;
         return;
       }
 
-      // Look through the section headers for the required code and metadata sections.
+      // Look through the section headers for the required code and metadata sections. They follow
+      // the optional header, whose size depends on the machine type of the binary.
       void* sectionCode = nullptr;
       SInjectMeta* sectionMeta = nullptr;
 
       {
         const IMAGE_SECTION_HEADER* const sectionHeader =
-            reinterpret_cast<const IMAGE_SECTION_HEADER*>(&ntHeader[1]);
+            reinterpret_cast<const IMAGE_SECTION_HEADER*>(
+                reinterpret_cast<size_t>(&ntHeader->OptionalHeader) +
+                static_cast<size_t>(ntHeader->FileHeader.SizeOfOptionalHeader));
 
         // For each section found, check if its name matches one of the required section.
         // Since each such section should only appear once, also verify uniqueness.
@@ -218,6 +228,9 @@ namespace Hookshot
       injectCodeEnd = reinterpret_cast<void*>(
           reinterpret_cast<size_t>(sectionCode) +
           static_cast<size_t>(sectionMeta->offsetInjectCodeEnd));
+      injectApcBegin = reinterpret_cast<void*>(
+          reinterpret_cast<size_t>(sectionCode) +
+          static_cast<size_t>(sectionMeta->offsetInjectApcBegin));
 
       // All operations completed successfully.
       initializationResult = EInjectResult::Success;
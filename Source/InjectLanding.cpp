@@ -18,9 +18,14 @@
 
 #include "ApiWindows.h"
 #include "DependencyProtect.h"
+#include "HookPlanCache.h"
 #include "Inject.h"
+#include "InjectionWindow.h"
 #include "LibraryInterface.h"
+#include "PatternCache.h"
+#include "StartupProfile.h"
 #include "Strings.h"
+#include "Tracing.h"
 
 using namespace Hookshot;
 
@@ -33,7 +38,16 @@ extern "C" void __fastcall InjectLandingCleanup(const SInjectData* const injectD
 
   for (size_t i = 0; i < _countof(cleanupBaseAddress); ++i)
   {
-    if (nullptr != cleanupBaseAddress[i])
+    if (nullptr == cleanupBaseAddress[i]) continue;
+
+    // Buffers are either allocated or, if the injected code is shared, mapped views of a section.
+    MEMORY_BASIC_INFORMATION cleanupBufferInfo;
+    if ((0 !=
+         Protected::Windows_VirtualQuery(
+             cleanupBaseAddress[i], &cleanupBufferInfo, sizeof(cleanupBufferInfo))) &&
+        (MEM_MAPPED == cleanupBufferInfo.Type))
+      Protected::Windows_UnmapViewOfFile(cleanupBaseAddress[i]);
+    else
       Protected::Windows_VirtualFree(cleanupBaseAddress[i], 0, MEM_RELEASE);
   }
 }
@@ -48,14 +62,35 @@ extern "C" void __fastcall InjectLandingLoadHookModules(const SInjectData* const
         Infra::ProcessInfo::GetExecutableBaseName().data(),
         Infra::ProcessInfo::GetCurrentProcessId());
 
+  StartupProfile::BeginPhase(Tracing::EStartupPhase::LoadHookModules);
+
+  // Until the program's own entry point runs, hooks can usually be written without suspending any
+  // other threads, which keeps hook creation during injection cheap.
+  InjectionWindow::Open();
+
   const int numHookModulesLoaded = LibraryInterface::LoadHookModules();
   const int numInjectOnlyLibrariesLoaded = LibraryInterface::LoadInjectOnlyLibraries();
+  const int numCallTraceHooksCreated = LibraryInterface::CreateConfiguredCallTraceHooks();
+
+  InjectionWindow::Close();
+
+  // Hook modules typically create all of their hooks while they are being loaded, so this is the
+  // right time to save the hook plans for whichever original functions they hooked, along with the
+  // locations of any byte patterns they searched for to find those functions.
+  HookPlanCache::WriteHookPlanCache();
+  PatternCache::WritePatternCache();
+
+  StartupProfile::EndPhase(Tracing::EStartupPhase::LoadHookModules);
 
   Infra::Message::OutputFormatted(
       Infra::Message::ESeverity::Info,
-      L"Loaded %d hook module%s and %d injection-only librar%s.",
+      L"Loaded %d hook module%s and %d injection-only librar%s, and created %d configured call trace hook%s.",
       numHookModulesLoaded,
       (1 == numHookModulesLoaded ? L"" : L"s"),
       numInjectOnlyLibrariesLoaded,
-      (1 == numInjectOnlyLibrariesLoaded ? L"y" : L"ies"));
+      (1 == numInjectOnlyLibrariesLoaded ? L"y" : L"ies"),
+      numCallTraceHooksCreated,
+      (1 == numCallTraceHooksCreated ? L"" : L"s"));
+
+  StartupProfile::Report();
 }
@@ -27,6 +27,8 @@ namespace Hookshot
         return L"Unknown error";
       case EInjectResult::ErrorCreateProcess:
         return L"Error creating a new process";
+      case EInjectResult::ErrorOpenProcess:
+        return L"Error opening an existing process";
       case EInjectResult::ErrorDetermineMachineProcess:
         return L"Error determining the new process architecture";
       case EInjectResult::ErrorArchitectureMismatch:
@@ -77,6 +79,10 @@ namespace Hookshot
         return L"Error writing memory during injection payload transfer";
       case EInjectResult::ErrorRunFailedResumeThread:
         return L"Error resuming the main thread in the new process";
+      case EInjectResult::ErrorRunFailedQueueApc:
+        return L"Error queueing injected code to run on the main thread in the new process";
+      case EInjectResult::ErrorCreateInjectionThread:
+        return L"Error creating a thread to run injected code in an existing process";
       case EInjectResult::ErrorRunFailedSync:
         return L"Error synchronizing with the injection payload code";
       case EInjectResult::ErrorRunFailedSuspendThread:
@@ -0,0 +1,122 @@
+/***************************************************************************************************
+ * Hookshot
+ *   General-purpose library for injecting DLLs and hooking function calls.
+ ***************************************************************************************************
+ * Authored by Samuel Grossman
+ * Copyright (c) 2019-2025
+ ***********************************************************************************************//**
+ * @file InjectionArena.cpp
+ *   Implementation of the fixed-capacity memory arena from which process injection obtains
+ *   buffers.
+ **************************************************************************************************/
+
+#include "InjectionArena.h"
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+
+#include <Infra/Core/SystemInfo.h>
+
+#include "ApiWindows.h"
+
+namespace Hookshot
+{
+  /// Alignment of every buffer allocated from an arena, which is sufficient for any data type.
+  static constexpr size_t kAllocationAlignment = MEMORY_ALLOCATION_ALIGNMENT;
+
+  /// Placed at the start of every region, which is always committed. Records how much of the
+  /// region is committed, so that a region that is re-used by a subsequent arena does not need to
+  /// be committed again.
+  struct SRegionHeader
+  {
+    /// Number of bytes at the start of the region that are committed.
+    size_t numBytesCommitted;
+  };
+
+  /// Region kept after its arena was destroyed, available for re-use by the next arena created.
+  static std::atomic<uint8_t*> spareRegion = nullptr;
+
+  /// Retrieves the system page size, which is the granularity with which memory is committed.
+  /// @return System page size, in bytes.
+  static inline size_t GetPageSize(void)
+  {
+    static const size_t pageSizeBytes =
+        static_cast<size_t>(Infra::SystemInfo::GetPlatformAndArchitectureInfo().dwPageSize);
+    return pageSizeBytes;
+  }
+
+  /// Obtains a region for a new arena, either by re-using the spare region or by reserving a new
+  /// one.
+  /// @return Base address of the region, or `nullptr` if one could not be reserved.
+  static uint8_t* AcquireRegion(void)
+  {
+    uint8_t* const reusedRegion = spareRegion.exchange(nullptr, std::memory_order_acquire);
+    if (nullptr != reusedRegion) return reusedRegion;
+
+    uint8_t* const newRegion = reinterpret_cast<uint8_t*>(
+        VirtualAlloc(nullptr, InjectionArena::kCapacityBytes, MEM_RESERVE, PAGE_READWRITE));
+    if (nullptr == newRegion) return nullptr;
+
+    if (nullptr == VirtualAlloc(newRegion, GetPageSize(), MEM_COMMIT, PAGE_READWRITE))
+    {
+      VirtualFree(newRegion, 0, MEM_RELEASE);
+      return nullptr;
+    }
+
+    reinterpret_cast<SRegionHeader*>(newRegion)->numBytesCommitted = GetPageSize();
+    return newRegion;
+  }
+
+  /// Gives up a region whose arena was destroyed, either by keeping it as the spare region or, if
+  /// there already is one, by releasing it.
+  /// @param [in] region Base address of the region.
+  static void ReleaseRegion(uint8_t* const region)
+  {
+    uint8_t* expectedSpareRegion = nullptr;
+    if (false ==
+        spareRegion.compare_exchange_strong(
+            expectedSpareRegion, region, std::memory_order_release, std::memory_order_relaxed))
+      VirtualFree(region, 0, MEM_RELEASE);
+  }
+
+  InjectionArena::InjectionArena(void)
+      : region(AcquireRegion()), numBytesUsed(sizeof(SRegionHeader))
+  {}
+
+  InjectionArena::~InjectionArena(void)
+  {
+    if (nullptr != region) ReleaseRegion(region);
+  }
+
+  void* InjectionArena::Allocate(size_t sizeBytes)
+  {
+    if (nullptr == region) return nullptr;
+
+    const size_t allocationBegin =
+        (numBytesUsed + kAllocationAlignment - 1) & ~(kAllocationAlignment - 1);
+    if ((sizeBytes > kCapacityBytes) || (allocationBegin > (kCapacityBytes - sizeBytes)))
+      return nullptr;
+
+    const size_t allocationEnd = allocationBegin + sizeBytes;
+
+    SRegionHeader* const regionHeader = reinterpret_cast<SRegionHeader*>(region);
+    if (allocationEnd > regionHeader->numBytesCommitted)
+    {
+      const size_t newNumBytesCommitted =
+          (allocationEnd + GetPageSize() - 1) & ~(GetPageSize() - 1);
+      if (nullptr ==
+          VirtualAlloc(
+              &region[regionHeader->numBytesCommitted],
+              newNumBytesCommitted - regionHeader->numBytesCommitted,
+              MEM_COMMIT,
+              PAGE_READWRITE))
+        return nullptr;
+
+      regionHeader->numBytesCommitted = newNumBytesCommitted;
+    }
+
+    numBytesUsed = allocationEnd;
+    return &region[allocationBegin];
+  }
+} // namespace Hookshot
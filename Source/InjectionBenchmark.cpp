@@ -0,0 +1,385 @@
+/***************************************************************************************************
+ * Hookshot
+ *   General-purpose library for injecting DLLs and hooking function calls.
+ ***************************************************************************************************
+ * Authored by Samuel Grossman
+ * Copyright (c) 2019-2025
+ ***********************************************************************************************//**
+ * @file InjectionBenchmark.cpp
+ *   Measurement of end-to-end injection latency by repeatedly launching a program.
+ **************************************************************************************************/
+
+#include "InjectionBenchmark.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include <Infra/Core/Message.h>
+
+#include "ApiWindows.h"
+#include "InjectResult.h"
+#include "ProcessInjector.h"
+#include "Strings.h"
+#include "Tracing.h"
+
+namespace Hookshot
+{
+  namespace InjectionBenchmark
+  {
+    /// Ways in which the program is launched, each of which is measured separately.
+    enum class ELaunchKind
+    {
+      /// Created without being injected, which serves as the baseline.
+      Uninjected,
+
+      /// Injected, but with the injected process directed not to load any hook modules.
+      InjectedWithoutHookModules,
+
+      /// Injected, with hook modules loaded as configured.
+      InjectedWithHookModules,
+    };
+
+    /// Measurements taken for a single launch of the program.
+    struct SLaunchTiming
+    {
+      /// Whether or not the program was launched, and injected if requested.
+      bool succeeded;
+
+      /// Time from process creation until the original entry point is about to run, in
+      /// microseconds.
+      int64_t entryPointMicroseconds;
+
+      /// Time from process creation until the program first waits for input, in microseconds, or
+      /// -1 if it does not do so.
+      int64_t inputIdleMicroseconds;
+
+      /// Durations of each injection phase.
+      Tracing::SInjectPhaseDurations phaseDurations;
+    };
+
+    /// Information structure to pass to each thread when launches happen all at once.
+    struct SConcurrentLaunch
+    {
+      /// Way in which the program is launched.
+      ELaunchKind launchKind;
+
+      /// Command line of the program to launch.
+      std::wstring_view commandLine;
+
+      /// Event that all threads wait on before launching, so that they launch together.
+      HANDLE startEvent;
+
+      /// Filled with the measurements taken for the launch.
+      SLaunchTiming timing;
+    };
+
+    /// Maximum amount of time to wait for a launched program to wait for input, in milliseconds.
+    static constexpr DWORD kInputIdleTimeoutMilliseconds = 30000;
+
+    /// Short names of each injection phase, indexed by Tracing::EInjectPhase.
+    static constexpr const wchar_t* kInjectPhaseNames[] = {
+        L"authorize",
+        L"verify architecture",
+        L"advance",
+        L"locate PEB",
+        L"locate entry point",
+        L"allocate",
+        L"set code",
+        L"run",
+        L"cleanup"};
+    static_assert(
+        Tracing::kNumInjectPhases == _countof(kInjectPhaseNames),
+        "Every injection phase must be named.");
+
+    /// Retrieves a short description of a launch kind, suitable for output.
+    /// @param [in] launchKind Launch kind of interest.
+    /// @return Description of the launch kind.
+    static const wchar_t* LaunchKindDescription(ELaunchKind launchKind)
+    {
+      switch (launchKind)
+      {
+        case ELaunchKind::Uninjected:
+          return L"uninjected";
+        case ELaunchKind::InjectedWithoutHookModules:
+          return L"injected without hook modules";
+        default:
+          return L"injected with hook modules";
+      }
+    }
+
+    /// Computes the number of microseconds that have elapsed since the specified time.
+    /// @param [in] startTime Time at which the interval began.
+    /// @return Number of microseconds elapsed.
+    static int64_t MicrosecondsSince(std::chrono::steady_clock::time_point startTime)
+    {
+      return static_cast<int64_t>(std::chrono::duration_cast<std::chrono::microseconds>(
+                                      std::chrono::steady_clock::now() - startTime)
+                                      .count());
+    }
+
+    /// Launches the program once, measures it, and terminates it.
+    /// @param [in] launchKind Way in which the program is launched.
+    /// @param [in] commandLine Command line of the program to launch.
+    /// @return Measurements taken for the launch.
+    static SLaunchTiming LaunchOnce(ELaunchKind launchKind, std::wstring_view commandLine)
+    {
+      SLaunchTiming timing = {
+          .succeeded = false, .entryPointMicroseconds = -1, .inputIdleMicroseconds = -1};
+      timing.phaseDurations.Clear();
+
+      // Process creation is allowed to modify the command line, so each launch has its own copy.
+      std::wstring mutableCommandLine(commandLine);
+      STARTUPINFO startupInfo = {.cb = sizeof(startupInfo)};
+      PROCESS_INFORMATION processInfo = {};
+
+      const auto startTime = std::chrono::steady_clock::now();
+      if (ELaunchKind::Uninjected == launchKind)
+      {
+        timing.succeeded =
+            (0 !=
+             CreateProcessW(
+                 nullptr,
+                 mutableCommandLine.data(),
+                 nullptr,
+                 nullptr,
+                 FALSE,
+                 0,
+                 nullptr,
+                 nullptr,
+                 &startupInfo,
+                 &processInfo));
+      }
+      else
+      {
+        timing.succeeded =
+            (EInjectResult::Success ==
+             ProcessInjector::CreateInjectedProcess(
+                 nullptr,
+                 mutableCommandLine.data(),
+                 nullptr,
+                 nullptr,
+                 FALSE,
+                 0,
+                 nullptr,
+                 nullptr,
+                 &startupInfo,
+                 &processInfo,
+                 &timing.phaseDurations));
+      }
+
+      if (true == timing.succeeded)
+      {
+        // An injected process is allowed to run only once its injected code has run, which is
+        // immediately before its original entry point.
+        timing.entryPointMicroseconds = MicrosecondsSince(startTime);
+
+        if (0 == WaitForInputIdle(processInfo.hProcess, kInputIdleTimeoutMilliseconds))
+          timing.inputIdleMicroseconds = MicrosecondsSince(startTime);
+
+        TerminateProcess(processInfo.hProcess, 0);
+        WaitForSingleObject(processInfo.hProcess, INFINITE);
+      }
+
+      if (nullptr != processInfo.hThread) CloseHandle(processInfo.hThread);
+      if (nullptr != processInfo.hProcess) CloseHandle(processInfo.hProcess);
+
+      return timing;
+    }
+
+    /// Executed by each thread when launches happen all at once.
+    /// @param [in] lpParameter Pointer to the thread's information structure.
+    /// @return Always 0.
+    static DWORD WINAPI ConcurrentLaunchThreadProc(LPVOID lpParameter)
+    {
+      SConcurrentLaunch& launch = *reinterpret_cast<SConcurrentLaunch*>(lpParameter);
+
+      WaitForSingleObject(launch.startEvent, INFINITE);
+      launch.timing = LaunchOnce(launch.launchKind, launch.commandLine);
+      return 0;
+    }
+
+    /// Launches the program the specified number of times, all at once.
+    /// @param [in] launchKind Way in which the program is launched.
+    /// @param [in] commandLine Command line of the program to launch.
+    /// @param [in] numLaunches Number of times to launch the program.
+    /// @return Measurements taken for each launch, including those that could not be attempted
+    /// because a thread could not be created.
+    static std::vector<SLaunchTiming> LaunchConcurrently(
+        ELaunchKind launchKind, std::wstring_view commandLine, unsigned int numLaunches)
+    {
+      const HANDLE startEvent = CreateEvent(nullptr, TRUE, FALSE, nullptr);
+      std::vector<SConcurrentLaunch> launches(
+          numLaunches,
+          {.launchKind = launchKind,
+           .commandLine = commandLine,
+           .startEvent = startEvent,
+           .timing = {.succeeded = false}});
+      std::vector<HANDLE> threadHandles;
+
+      for (auto& launch : launches)
+      {
+        const HANDLE threadHandle =
+            CreateThread(nullptr, 0, ConcurrentLaunchThreadProc, &launch, 0, nullptr);
+        if (nullptr != threadHandle) threadHandles.push_back(threadHandle);
+      }
+
+      SetEvent(startEvent);
+
+      // Waiting for multiple objects is limited in how many it can wait for at a time.
+      for (const HANDLE threadHandle : threadHandles)
+      {
+        WaitForSingleObject(threadHandle, INFINITE);
+        CloseHandle(threadHandle);
+      }
+
+      CloseHandle(startEvent);
+
+      std::vector<SLaunchTiming> timings;
+      for (const auto& launch : launches)
+        timings.push_back(launch.timing);
+
+      return timings;
+    }
+
+    /// Summarizes a set of measurements as percentiles and formats them for output.
+    /// @param [in] values Measurements, in microseconds. Negative values indicate that no
+    /// measurement was taken and are ignored.
+    /// @return Formatted summary of the measurements.
+    static std::wstring FormatDistribution(std::vector<int64_t> values)
+    {
+      std::erase_if(values, [](int64_t value) -> bool { return (value < 0); });
+      if (true == values.empty()) return L"not measured";
+
+      std::sort(values.begin(), values.end());
+      auto percentile = [&values](size_t percent) -> long long
+      {
+        return static_cast<long long>(
+            values[std::min(values.size() - 1, (values.size() * percent) / 100)]);
+      };
+
+      wchar_t formatted[128];
+      swprintf_s(
+          formatted,
+          L"p50 %lld us, p90 %lld us, p99 %lld us, max %lld us",
+          percentile(50),
+          percentile(90),
+          percentile(99),
+          static_cast<long long>(values.back()));
+      return formatted;
+    }
+
+    /// Outputs the distributions of a set of measurements to the log.
+    /// @param [in] description Description of the measurements.
+    /// @param [in] timings Measurements taken for each launch.
+    /// @param [out] summary String to which a single line describing the measurements is appended.
+    static void ReportTimings(
+        const wchar_t* description,
+        const std::vector<SLaunchTiming>& timings,
+        std::wstring& summary)
+    {
+      std::vector<int64_t> entryPointMicroseconds;
+      std::vector<int64_t> inputIdleMicroseconds;
+      unsigned int numSucceeded = 0;
+
+      for (const auto& timing : timings)
+      {
+        if (false == timing.succeeded) continue;
+
+        numSucceeded += 1;
+        entryPointMicroseconds.push_back(timing.entryPointMicroseconds);
+        inputIdleMicroseconds.push_back(timing.inputIdleMicroseconds);
+      }
+
+      const std::wstring entryPointDistribution = FormatDistribution(entryPointMicroseconds);
+      Infra::Message::OutputFormatted(
+          Infra::Message::ESeverity::Info,
+          L"Injection benchmark, %s: %u of %u launch(es) succeeded. Time to entry point: %s. Time to input idle: %s.",
+          description,
+          numSucceeded,
+          (unsigned int)timings.size(),
+          entryPointDistribution.c_str(),
+          FormatDistribution(inputIdleMicroseconds).c_str());
+
+      for (size_t phase = 0; phase < Tracing::kNumInjectPhases; ++phase)
+      {
+        std::vector<int64_t> phaseMicroseconds;
+        for (const auto& timing : timings)
+        {
+          if (true == timing.succeeded)
+            phaseMicroseconds.push_back(timing.phaseDurations.microseconds[phase]);
+        }
+
+        if (true == std::all_of(
+                        phaseMicroseconds.begin(),
+                        phaseMicroseconds.end(),
+                        [](int64_t value) -> bool { return (value < 0); }))
+          continue;
+
+        Infra::Message::OutputFormatted(
+            Infra::Message::ESeverity::Info,
+            L"Injection benchmark, %s, phase \"%s\": %s.",
+            description,
+            kInjectPhaseNames[phase],
+            FormatDistribution(phaseMicroseconds).c_str());
+      }
+
+      summary += description;
+      summary += L": ";
+      summary += entryPointDistribution;
+      summary += L"\n";
+    }
+
+    int Run(unsigned int numLaunches, std::wstring_view commandLine)
+    {
+      if (0 == numLaunches) return __LINE__;
+
+      std::wstring summary;
+      unsigned int numFailed = 0;
+
+      for (const ELaunchKind launchKind :
+           {ELaunchKind::Uninjected,
+            ELaunchKind::InjectedWithoutHookModules,
+            ELaunchKind::InjectedWithHookModules})
+      {
+        // Launched processes inherit the environment of this process.
+        SetEnvironmentVariable(
+            Strings::kStrSkipHookModulesEnvironmentVariableName.data(),
+            ((ELaunchKind::InjectedWithoutHookModules == launchKind) ? L"1" : nullptr));
+
+        std::vector<SLaunchTiming> seriesTimings;
+        for (unsigned int i = 0; i < numLaunches; ++i)
+          seriesTimings.push_back(LaunchOnce(launchKind, commandLine));
+
+        const std::vector<SLaunchTiming> concurrentTimings =
+            LaunchConcurrently(launchKind, commandLine, numLaunches);
+
+        for (const auto* timings : {&seriesTimings, &concurrentTimings})
+        {
+          numFailed += static_cast<unsigned int>(std::count_if(
+              timings->begin(),
+              timings->end(),
+              [](const SLaunchTiming& timing) -> bool { return (false == timing.succeeded); }));
+        }
+
+        const std::wstring description = LaunchKindDescription(launchKind);
+        ReportTimings((description + L", in series").c_str(), seriesTimings, summary);
+        ReportTimings((description + L", concurrently").c_str(), concurrentTimings, summary);
+      }
+
+      SetEnvironmentVariable(Strings::kStrSkipHookModulesEnvironmentVariableName.data(), nullptr);
+
+      Infra::Message::OutputFormatted(
+          Infra::Message::ESeverity::ForcedInteractiveInfo,
+          L"Time from process creation to entry point over %u launch(es) of each kind, with %u failed launch(es). See the log for input idle times and phase durations.\n\n%s",
+          numLaunches,
+          numFailed,
+          summary.c_str());
+
+      return ((0 == numFailed) ? 0 : __LINE__);
+    }
+  } // namespace InjectionBenchmark
+} // namespace Hookshot
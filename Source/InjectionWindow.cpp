@@ -0,0 +1,167 @@
+/***************************************************************************************************
+ * Hookshot
+ *   General-purpose library for injecting DLLs and hooking function calls.
+ ***************************************************************************************************
+ * Authored by Samuel Grossman
+ * Copyright (c) 2019-2025
+ ***********************************************************************************************//**
+ * @file InjectionWindow.cpp
+ *   Implementation of tracking the part of injection during which hook modules are loaded.
+ **************************************************************************************************/
+
+#include "InjectionWindow.h"
+
+#include <atomic>
+#include <cstddef>
+
+#include "ApiWindows.h"
+#include "DependencyProtect.h"
+
+namespace Hookshot
+{
+  namespace InjectionWindow
+  {
+    /// Thread information class that retrieves the address at which a thread started, as passed
+    /// to the function that created it. Not exposed by any of the Windows header files.
+    static constexpr ULONG kThreadQuerySetWin32StartAddress = 9;
+
+    /// Status code returned by `NtGetNextThread` once there are no more threads to enumerate.
+    static constexpr NTSTATUS kStatusNoMoreEntries = static_cast<NTSTATUS>(0x8000001A);
+
+    /// Function signature for `NtGetNextThread`, exported by ntdll.
+    using TNtGetNextThread = NTSTATUS(NTAPI*)(
+        HANDLE processHandle,
+        HANDLE threadHandle,
+        ACCESS_MASK desiredAccess,
+        ULONG handleAttributes,
+        ULONG flags,
+        PHANDLE newThreadHandle);
+
+    /// Function signature for `NtQueryInformationThread`, exported by ntdll.
+    using TNtQueryInformationThread = NTSTATUS(NTAPI*)(
+        HANDLE threadHandle,
+        ULONG threadInformationClass,
+        PVOID threadInformation,
+        ULONG threadInformationLength,
+        PULONG returnLength);
+
+    /// Holds the location of the loader and the functions it exports that are needed to check
+    /// other threads.
+    struct SLoader
+    {
+      /// Base address of the loader module.
+      size_t baseAddress;
+
+      /// Size of the loader module image, in bytes.
+      size_t sizeBytes;
+
+      /// Enumerates threads one at a time without taking a snapshot of the whole system.
+      TNtGetNextThread ntGetNextThread;
+
+      /// Retrieves the start address of a thread.
+      TNtQueryInformationThread ntQueryInformationThread;
+    };
+
+    /// Whether or not the window is open.
+    static std::atomic<bool> isWindowOpen = false;
+
+    /// Locates the loader. Only attempted once, no matter how many times it is invoked.
+    /// @return Loader location and functions, all of which are 0 or `nullptr` if it could not be
+    /// located.
+    static const SLoader& GetLoader(void)
+    {
+      static const SLoader loader = []() -> SLoader
+      {
+        HMODULE ntdllModule = nullptr;
+        if (0 ==
+            Protected::Windows_GetModuleHandleEx(
+                GET_MODULE_HANDLE_EX_FLAG_UNCHANGED_REFCOUNT, L"ntdll.dll", &ntdllModule))
+          return {};
+
+        const IMAGE_DOS_HEADER* const dosHeader =
+            reinterpret_cast<const IMAGE_DOS_HEADER*>(ntdllModule);
+        if (IMAGE_DOS_SIGNATURE != dosHeader->e_magic) return {};
+
+        const IMAGE_NT_HEADERS* const ntHeader = reinterpret_cast<const IMAGE_NT_HEADERS*>(
+            reinterpret_cast<size_t>(dosHeader) + static_cast<size_t>(dosHeader->e_lfanew));
+        if (IMAGE_NT_SIGNATURE != ntHeader->Signature) return {};
+
+        return {
+            .baseAddress = reinterpret_cast<size_t>(ntdllModule),
+            .sizeBytes = static_cast<size_t>(ntHeader->OptionalHeader.SizeOfImage),
+            .ntGetNextThread = reinterpret_cast<TNtGetNextThread>(
+                Protected::Windows_GetProcAddress(ntdllModule, "NtGetNextThread")),
+            .ntQueryInformationThread = reinterpret_cast<TNtQueryInformationThread>(
+                Protected::Windows_GetProcAddress(ntdllModule, "NtQueryInformationThread"))};
+      }();
+
+      return loader;
+    }
+
+    void Open(void)
+    {
+      // The loader is located ahead of time so that the first check does not pay for it.
+      GetLoader();
+      isWindowOpen.store(true, std::memory_order_release);
+    }
+
+    void Close(void)
+    {
+      isWindowOpen.store(false, std::memory_order_release);
+    }
+
+    bool IsLoaderCode(const void* address)
+    {
+      const SLoader& loader = GetLoader();
+      return (
+          (reinterpret_cast<size_t>(address) >= loader.baseAddress) &&
+          (reinterpret_cast<size_t>(address) < (loader.baseAddress + loader.sizeBytes)));
+    }
+
+    bool IsOnlyLoaderRunning(void)
+    {
+      if (false == isWindowOpen.load(std::memory_order_acquire)) return false;
+
+      const SLoader& loader = GetLoader();
+      if ((nullptr == loader.ntGetNextThread) || (nullptr == loader.ntQueryInformationThread))
+        return false;
+
+      const DWORD currentThreadId = Protected::Windows_GetCurrentThreadId();
+
+      HANDLE thread = nullptr;
+      HANDLE nextThread = nullptr;
+      NTSTATUS enumerateResult = 0;
+      bool isOnlyLoaderRunning = true;
+
+      while (true)
+      {
+        enumerateResult = loader.ntGetNextThread(
+            GetCurrentProcess(), thread, THREAD_QUERY_INFORMATION, 0, 0, &nextThread);
+        if (nullptr != thread) Protected::Windows_CloseHandle(thread);
+        if (0 != enumerateResult) break;
+
+        thread = nextThread;
+        if (currentThreadId == GetThreadId(thread)) continue;
+
+        void* startAddress = nullptr;
+        if ((0 !=
+             loader.ntQueryInformationThread(
+                 thread,
+                 kThreadQuerySetWin32StartAddress,
+                 &startAddress,
+                 sizeof(startAddress),
+                 nullptr)) ||
+            (false == IsLoaderCode(startAddress)))
+        {
+          Protected::Windows_CloseHandle(thread);
+          isOnlyLoaderRunning = false;
+          break;
+        }
+      }
+
+      // A thread that could not be opened stops enumeration early, and it might be running
+      // anything.
+      return ((true == isOnlyLoaderRunning) && (kStatusNoMoreEntries == enumerateResult));
+    }
+  } // namespace InjectionWindow
+} // namespace Hookshot
@@ -0,0 +1,274 @@
+/***************************************************************************************************
+ * Hookshot
+ *   General-purpose library for injecting DLLs and hooking function calls.
+ ***************************************************************************************************
+ * Authored by Samuel Grossman
+ * Copyright (c) 2019-2025
+ ***********************************************************************************************//**
+ * @file InjectorDaemon.cpp
+ *   Implementation of requesting process creation and injection from a long-lived injector
+ *   daemon.
+ **************************************************************************************************/
+
+#include "InjectorDaemon.h"
+
+#include <cstddef>
+#include <cstdint>
+#include <string_view>
+
+#include <Infra/Core/Strings.h>
+#include <Infra/Core/TemporaryBuffer.h>
+
+#include "ApiWindows.h"
+#include "InjectResult.h"
+#include "Strings.h"
+
+namespace Hookshot
+{
+  namespace InjectorDaemon
+  {
+    /// Amount of time, in milliseconds, to wait for the injector daemon to accept a connection,
+    /// including the time it takes to start if it is not already running.
+    static constexpr DWORD kConnectTimeoutMilliseconds = 5000;
+
+    /// Interval, in milliseconds, at which to retry connecting to an injector daemon that was just
+    /// started and has not yet created its named pipe.
+    static constexpr DWORD kConnectRetryIntervalMilliseconds = 10;
+
+    /// Starts a new instance of the Hookshot executable that acts as the injector daemon. It does
+    /// not inherit any handles and outlives this process.
+    /// @return `true` if the instance was started, `false` otherwise.
+    static bool StartDaemon(void)
+    {
+      Infra::TemporaryString commandLine;
+      commandLine << L'\"' << Strings::GetHookshotExecutableFilename() << L"\" "
+                  << Strings::kCharCmdlineIndicatorInjectorDaemon;
+
+      STARTUPINFO startupInfo;
+      PROCESS_INFORMATION processInfo;
+      memset(reinterpret_cast<void*>(&startupInfo), 0, sizeof(startupInfo));
+      memset(reinterpret_cast<void*>(&processInfo), 0, sizeof(processInfo));
+      startupInfo.cb = sizeof(startupInfo);
+
+      if (FALSE ==
+          CreateProcess(
+              nullptr,
+              commandLine.Data(),
+              nullptr,
+              nullptr,
+              FALSE,
+              DETACHED_PROCESS,
+              nullptr,
+              nullptr,
+              &startupInfo,
+              &processInfo))
+        return false;
+
+      CloseHandle(processInfo.hThread);
+      CloseHandle(processInfo.hProcess);
+      return true;
+    }
+
+    /// Connects to the injector daemon, starting it first if it is not already running.
+    /// @return Handle of the connected named pipe, or `nullptr` if the injector daemon could not be
+    /// reached.
+    static HANDLE ConnectToDaemon(void)
+    {
+      const Infra::TemporaryString pipeName = Strings::InjectorDaemonPipeName();
+      const ULONGLONG deadline = GetTickCount64() + kConnectTimeoutMilliseconds;
+      bool daemonStarted = false;
+
+      while (true)
+      {
+        const HANDLE pipeHandle = CreateFile(
+            pipeName.AsCString(),
+            GENERIC_READ | GENERIC_WRITE,
+            0,
+            nullptr,
+            OPEN_EXISTING,
+            0,
+            nullptr);
+        if (INVALID_HANDLE_VALUE != pipeHandle) return pipeHandle;
+
+        const DWORD connectError = GetLastError();
+        const ULONGLONG now = GetTickCount64();
+        if (now >= deadline) return nullptr;
+
+        switch (connectError)
+        {
+          case ERROR_PIPE_BUSY:
+            // Every instance of the named pipe is in use, but the injector daemon creates another
+            // as soon as it accepts a connection.
+            WaitNamedPipe(pipeName.AsCString(), static_cast<DWORD>(deadline - now));
+            break;
+
+          case ERROR_FILE_NOT_FOUND:
+            // The injector daemon is either not running or still starting.
+            if (false == daemonStarted)
+            {
+              if (false == StartDaemon()) return nullptr;
+              daemonStarted = true;
+            }
+            Sleep(kConnectRetryIntervalMilliseconds);
+            break;
+
+          default:
+            return nullptr;
+        }
+      }
+    }
+
+    bool IsEnabled(void)
+    {
+      static const bool isEnabled =
+          (0 !=
+           GetEnvironmentVariable(
+               Strings::kStrInjectorDaemonEnvironmentVariableName.data(), nullptr, 0));
+
+      return isEnabled;
+    }
+
+    bool ReadPipe(HANDLE pipeHandle, void* buffer, size_t numBytes)
+    {
+      const HANDLE completeEvent = CreateEvent(nullptr, TRUE, FALSE, nullptr);
+      if (nullptr == completeEvent) return false;
+
+      uint8_t* const bytes = reinterpret_cast<uint8_t*>(buffer);
+      size_t numBytesRead = 0;
+
+      while (numBytesRead < numBytes)
+      {
+        OVERLAPPED overlapped = {.hEvent = completeEvent};
+        DWORD numBytesTransferred = 0;
+
+        if ((FALSE ==
+             ReadFile(
+                 pipeHandle,
+                 &bytes[numBytesRead],
+                 static_cast<DWORD>(numBytes - numBytesRead),
+                 nullptr,
+                 &overlapped)) &&
+            (ERROR_IO_PENDING != GetLastError()))
+          break;
+
+        if ((FALSE == GetOverlappedResult(pipeHandle, &overlapped, &numBytesTransferred, TRUE)) ||
+            (0 == numBytesTransferred))
+          break;
+
+        numBytesRead += static_cast<size_t>(numBytesTransferred);
+      }
+
+      CloseHandle(completeEvent);
+      return (numBytesRead == numBytes);
+    }
+
+    bool WritePipe(HANDLE pipeHandle, const void* buffer, size_t numBytes)
+    {
+      const HANDLE completeEvent = CreateEvent(nullptr, TRUE, FALSE, nullptr);
+      if (nullptr == completeEvent) return false;
+
+      const uint8_t* const bytes = reinterpret_cast<const uint8_t*>(buffer);
+      size_t numBytesWritten = 0;
+
+      while (numBytesWritten < numBytes)
+      {
+        OVERLAPPED overlapped = {.hEvent = completeEvent};
+        DWORD numBytesTransferred = 0;
+
+        if ((FALSE ==
+             WriteFile(
+                 pipeHandle,
+                 &bytes[numBytesWritten],
+                 static_cast<DWORD>(numBytes - numBytesWritten),
+                 nullptr,
+                 &overlapped)) &&
+            (ERROR_IO_PENDING != GetLastError()))
+          break;
+
+        if ((FALSE == GetOverlappedResult(pipeHandle, &overlapped, &numBytesTransferred, TRUE)) ||
+            (0 == numBytesTransferred))
+          break;
+
+        numBytesWritten += static_cast<size_t>(numBytesTransferred);
+      }
+
+      CloseHandle(completeEvent);
+      return (numBytesWritten == numBytes);
+    }
+
+    bool CreateInjectedProcess(
+        std::wstring_view commandLine, EInjectResult* result, HANDLE* processHandle)
+    {
+      if ((true == commandLine.empty()) || (commandLine.length() > kMaxCommandLineLength))
+        return false;
+
+      Infra::TemporaryBuffer<wchar_t> currentDirectory;
+      DWORD currentDirectoryLength = GetCurrentDirectory(
+          static_cast<DWORD>(currentDirectory.Capacity()), currentDirectory.Data());
+      if ((currentDirectoryLength >= static_cast<DWORD>(currentDirectory.Capacity())) ||
+          (currentDirectoryLength > kMaxCurrentDirectoryLength))
+        currentDirectoryLength = 0;
+
+      // The environment block ends with two null characters, both of which are sent so that the
+      // injector daemon can pass it along unmodified.
+      const LPWCH environment = GetEnvironmentStrings();
+      size_t environmentLength = 0;
+      if (nullptr != environment)
+      {
+        while ((L'\0' != environment[environmentLength]) ||
+               (L'\0' != environment[environmentLength + 1]))
+          environmentLength += 1;
+
+        environmentLength += 2;
+        if (environmentLength > kMaxEnvironmentLength) environmentLength = 0;
+      }
+
+      const HANDLE pipeHandle = ConnectToDaemon();
+      if (nullptr == pipeHandle)
+      {
+        if (nullptr != environment) FreeEnvironmentStrings(environment);
+        return false;
+      }
+
+      const SRequestHeader requestHeader = {
+          .commandLineLength = static_cast<uint32_t>(commandLine.length()),
+          .currentDirectoryLength = static_cast<uint32_t>(currentDirectoryLength),
+          .environmentLength = static_cast<uint32_t>(environmentLength)};
+
+      const bool requestSubmitted =
+          (WritePipe(pipeHandle, &requestHeader, sizeof(requestHeader)) &&
+           WritePipe(pipeHandle, commandLine.data(), commandLine.length() * sizeof(wchar_t)) &&
+           WritePipe(
+               pipeHandle, currentDirectory.Data(), currentDirectoryLength * sizeof(wchar_t)) &&
+           WritePipe(pipeHandle, environment, environmentLength * sizeof(wchar_t)));
+      const DWORD submitError = GetLastError();
+
+      if (nullptr != environment) FreeEnvironmentStrings(environment);
+
+      if (false == requestSubmitted)
+      {
+        CloseHandle(pipeHandle);
+        SetLastError(submitError);
+        return false;
+      }
+
+      // Once the request is submitted the injector daemon may already have created the process, so
+      // failing to obtain a response cannot be handled by creating the process again.
+      SResponse response = {};
+      if (false == ReadPipe(pipeHandle, &response, sizeof(response)))
+      {
+        response.injectionResult =
+            static_cast<uint64_t>(EInjectResult::ErrorInterProcessCommunicationFailed);
+        response.extendedInjectionResult = static_cast<uint64_t>(GetLastError());
+        response.processHandle = 0;
+      }
+
+      CloseHandle(pipeHandle);
+
+      *result = static_cast<EInjectResult>(response.injectionResult);
+      *processHandle = reinterpret_cast<HANDLE>(response.processHandle);
+      SetLastError(static_cast<DWORD>(response.extendedInjectionResult));
+      return true;
+    }
+  } // namespace InjectorDaemon
+} // namespace Hookshot
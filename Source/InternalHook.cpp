@@ -11,17 +11,44 @@
 
 #include "InternalHook.h"
 
-#include <map>
-#include <string_view>
+#include <array>
+#include <cstddef>
+#include <cstdint>
 
 #include <Infra/Core/Message.h>
 
 #include "ApiWindows.h"
+#include "DependencyProtect.h"
+#include "Strings.h"
+#include "TrampolineStore.h"
 
 namespace Hookshot
 {
+  /// Layout of the internal hooks of a parent process, as published for one of its child processes.
+  /// Processes of either architecture can read the first two fields, but the rest of the layout is
+  /// only valid for processes whose pointers are of the size indicated.
+  struct SInternalHookLayout
+  {
+    /// Size, in bytes, of a pointer in the process that published the layout.
+    uint32_t pointerSizeBytes;
+
+    /// Number of valid elements in #internalHooks.
+    uint32_t numInternalHooks;
+
+    /// Location of the trampoline that implements each internal hook, by original function.
+    struct
+    {
+      /// Address of the original function.
+      const void* originalFunc;
+
+      /// Base address of the trampoline store that holds the trampoline.
+      void* trampolineStoreAddress;
+    } internalHooks[kMaxInternalHooks];
+  };
+
   /// Holds all registered internal hooks, and offers the ability to set them. Used to ensure
-  /// internal hooks are available during dynamic initialization. Implemented as a singleton object.
+  /// internal hooks are available during dynamic initialization. Storage is a fixed-size array so
+  /// that registration never allocates memory and is valid regardless of initialization order.
   class InternalHookRegistry
   {
   public:
@@ -37,23 +64,81 @@ namespace Hookshot
     /// Flag used to indicate if internal hooks have been specified.
     bool areInternalHooksSet;
 
+    /// Number of valid elements in the registry.
+    size_t numInternalHooks;
+
     /// Registry of all hooks that need to be set.
-    std::map<std::wstring_view, EResult (*)(void)> internalHooks;
+    std::array<SInternalHookRegistration, kMaxInternalHooks> internalHooks;
 
   private:
 
-    InternalHookRegistry(void) : areInternalHooksSet(false), internalHooks() {}
+    constexpr InternalHookRegistry(void)
+        : areInternalHooksSet(false), numInternalHooks(0), internalHooks()
+    {}
 
     InternalHookRegistry(const InternalHookRegistry& other) = delete;
   };
 
-  bool RegisterInternalHook(std::wstring_view hookName, EResult (*setHookFunc)(void))
+#ifdef _WIN64
+  /// Places the trampolines for internal hooks at the same locations as the parent process did for
+  /// its own, if the parent process published the layout of its internal hooks for this process.
+  /// Has no effect for any internal hook whose original function is at a different address in this
+  /// process than in the parent process.
+  /// @param [in] hookSpecs Internal hooks about to be created.
+  /// @param [in] numHookSpecs Number of internal hooks about to be created.
+  static void AdoptParentInternalHookLayout(const SHookSpec* hookSpecs, size_t numHookSpecs)
+  {
+    const HANDLE layoutSection = OpenFileMapping(
+        FILE_MAP_READ,
+        FALSE,
+        Strings::InternalHookLayoutSectionName(
+            static_cast<uint32_t>(Protected::Windows_GetCurrentProcessId()))
+            .AsCString());
+    if (nullptr == layoutSection) return;
+
+    const SInternalHookLayout* const layout = reinterpret_cast<const SInternalHookLayout*>(
+        Protected::Windows_MapViewOfFile(layoutSection, FILE_MAP_READ, 0, 0, 0));
+    Protected::Windows_CloseHandle(layoutSection);
+    if (nullptr == layout) return;
+
+    if ((sizeof(void*) == layout->pointerSizeBytes) &&
+        (layout->numInternalHooks <= kMaxInternalHooks))
+    {
+      size_t numLocationsAdopted = 0;
+
+      for (size_t i = 0; i < numHookSpecs; ++i)
+      {
+        for (size_t j = 0; j < layout->numInternalHooks; ++j)
+        {
+          if (hookSpecs[i].originalFunc != layout->internalHooks[j].originalFunc) continue;
+
+          HookStore::SuggestTrampolineStoreLocation(
+              hookSpecs[i].originalFunc, layout->internalHooks[j].trampolineStoreAddress);
+          numLocationsAdopted += 1;
+          break;
+        }
+      }
+
+      Infra::Message::OutputFormatted(
+          Infra::Message::ESeverity::Debug,
+          L"Adopted the parent process' trampoline locations for %llu of %llu internal hooks.",
+          (unsigned long long)numLocationsAdopted,
+          (unsigned long long)numHookSpecs);
+    }
+
+    Protected::Windows_UnmapViewOfFile(layout);
+  }
+#endif
+
+  bool RegisterInternalHook(const SInternalHookRegistration& registration)
   {
     InternalHookRegistry& registry = InternalHookRegistry::GetInstance();
 
     if (true == registry.areInternalHooksSet) return false;
+    if (registry.numInternalHooks >= registry.internalHooks.size()) return false;
 
-    registry.internalHooks[hookName] = setHookFunc;
+    registry.internalHooks[registry.numInternalHooks] = registration;
+    registry.numInternalHooks += 1;
 
     return true;
   }
@@ -63,24 +148,98 @@ namespace Hookshot
     InternalHookRegistry& registry = InternalHookRegistry::GetInstance();
 
     if (true == registry.areInternalHooksSet) return;
+    registry.areInternalHooksSet = true;
+
+    const size_t numInternalHooks = registry.numInternalHooks;
+    if (0 == numInternalHooks) return;
+
+    std::array<SHookSpec, kMaxInternalHooks> hookSpecs = {};
+    std::array<const void**, kMaxInternalHooks> originalFuncsAfterHook = {};
+    std::array<EResult, kMaxInternalHooks> results = {};
 
-    for (auto hook = registry.internalHooks.cbegin(); hook != registry.internalHooks.cend(); ++hook)
+    for (size_t i = 0; i < numInternalHooks; ++i)
     {
-      const EResult result = hook->second();
-
-      if (SuccessfulResult(result))
-        Infra::Message::OutputFormatted(
-            Infra::Message::ESeverity::Info,
-            L"Successfully set internal hook for %s.",
-            hook->first.data());
-      else
-        Infra::Message::OutputFormatted(
-            Infra::Message::ESeverity::Warning,
-            L"Failed to set internal hook for %s. Hookshot features that use this hook will not work.",
-            hook->first.data());
+      hookSpecs[i] = {
+          .originalFunc = registry.internalHooks[i].funcGetOriginalFunctionAddress(),
+          .hookFunc = registry.internalHooks[i].hookFunc};
+      originalFuncsAfterHook[i] = registry.internalHooks[i].originalFunctionOut;
     }
 
-    registry.areInternalHooksSet = true;
-    registry.internalHooks.clear();
+#ifdef _WIN64
+    AdoptParentInternalHookLayout(hookSpecs.data(), numInternalHooks);
+#endif
+
+    HookStore::CreateInternalHooks(
+        hookSpecs.data(), numInternalHooks, originalFuncsAfterHook.data(), results.data());
+
+    size_t numInternalHooksSet = 0;
+    for (size_t i = 0; i < numInternalHooks; ++i)
+    {
+      if (true == SuccessfulResult(results[i]))
+      {
+        numInternalHooksSet += 1;
+        continue;
+      }
+
+      Infra::Message::OutputFormatted(
+          Infra::Message::ESeverity::Warning,
+          L"Failed to set internal hook for %s. Hookshot features that use this hook will not work.",
+          registry.internalHooks[i].hookName);
+    }
+
+    Infra::Message::OutputFormatted(
+        Infra::Message::ESeverity::Info,
+        L"Set %llu of %llu internal hooks.",
+        (unsigned long long)numInternalHooksSet,
+        (unsigned long long)numInternalHooks);
+  }
+
+  HANDLE PublishInternalHookLayout(DWORD childProcessId)
+  {
+#ifdef _WIN64
+    InternalHookRegistry& registry = InternalHookRegistry::GetInstance();
+    if (false == registry.areInternalHooksSet) return nullptr;
+
+    const HANDLE layoutSection = Protected::Windows_CreateFileMapping(
+        INVALID_HANDLE_VALUE,
+        nullptr,
+        PAGE_READWRITE,
+        0,
+        static_cast<DWORD>(sizeof(SInternalHookLayout)),
+        Strings::InternalHookLayoutSectionName(static_cast<uint32_t>(childProcessId)).AsCString());
+    if (nullptr == layoutSection) return nullptr;
+
+    SInternalHookLayout* const layout = reinterpret_cast<SInternalHookLayout*>(
+        Protected::Windows_MapViewOfFile(layoutSection, FILE_MAP_WRITE, 0, 0, 0));
+    if (nullptr == layout)
+    {
+      Protected::Windows_CloseHandle(layoutSection);
+      return nullptr;
+    }
+
+    layout->pointerSizeBytes = static_cast<uint32_t>(sizeof(void*));
+    layout->numInternalHooks = 0;
+
+    // The address for invoking the original function is the beginning of the trampoline, so it
+    // also identifies the trampoline store that holds the trampoline. Internal hooks that could not
+    // be set have no trampoline and are left out.
+    for (size_t i = 0; i < registry.numInternalHooks; ++i)
+    {
+      const void* const originalFunctionAfterHook = *registry.internalHooks[i].originalFunctionOut;
+      if (nullptr == originalFunctionAfterHook) continue;
+
+      layout->internalHooks[layout->numInternalHooks] = {
+          .originalFunc = registry.internalHooks[i].funcGetOriginalFunctionAddress(),
+          .trampolineStoreAddress = reinterpret_cast<void*>(
+              reinterpret_cast<size_t>(originalFunctionAfterHook) &
+              ~(static_cast<size_t>(TrampolineStore::kTrampolineStoreSizeBytes) - 1))};
+      layout->numInternalHooks += 1;
+    }
+
+    Protected::Windows_UnmapViewOfFile(layout);
+    return layoutSection;
+#else
+    return nullptr;
+#endif
   }
 } // namespace Hookshot
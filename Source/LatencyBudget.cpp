@@ -0,0 +1,125 @@
+/***************************************************************************************************
+ * Hookshot
+ *   General-purpose library for injecting DLLs and hooking function calls.
+ ***************************************************************************************************
+ * Authored by Samuel Grossman
+ * Copyright (c) 2019-2025
+ ***********************************************************************************************//**
+ * @file LatencyBudget.cpp
+ *   Implementation of automatically disabling hooks whose sampled durations exceed their latency
+ *   budgets.
+ **************************************************************************************************/
+
+#include "LatencyBudget.h"
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <intrin.h>
+
+#include <Infra/Core/Message.h>
+
+#include "ApiWindows.h"
+#include "HookStore.h"
+#include "HookshotTypes.h"
+#include "TaskScheduler.h"
+
+namespace Hookshot
+{
+  namespace LatencyBudget
+  {
+    /// Processor time stamp counter and system tick count at a single point in time, against which
+    /// the rate of the time stamp counter is measured.
+    struct SCalibrationStart
+    {
+      /// Processor time stamp counter value.
+      uint64_t timestamp;
+
+      /// System tick count, in milliseconds.
+      ULONGLONG tickCount;
+    };
+
+    /// Whether or not the background task that checks latency budgets is currently scheduled.
+    static std::atomic<bool> checkScheduled = false;
+
+    /// Retrieves the point in time from which the rate of the processor time stamp counter is
+    /// measured, which is when the first check was scheduled. Durations are sampled in time stamp
+    /// counter ticks, whereas budgets are expressed in microseconds, so the rate is measured
+    /// against the system tick count over the entire time since then, becoming more precise with
+    /// every check.
+    /// @return Calibration starting point.
+    static const SCalibrationStart& GetCalibrationStart(void)
+    {
+      static const SCalibrationStart calibrationStart = {
+          .timestamp = __rdtsc(), .tickCount = GetTickCount64()};
+      return calibrationStart;
+    }
+
+    /// Task procedure that checks every latency budget and then schedules itself again if any
+    /// budgets remain configured.
+    /// @param [in] context Unused.
+    static void CheckTaskProc(void* context)
+    {
+      // Clearing the flag first means that a budget configured while the check is in progress
+      // either is seen by the check or schedules the next one itself.
+      checkScheduled = false;
+
+      const SCalibrationStart& calibrationStart = GetCalibrationStart();
+      const uint64_t elapsedMicroseconds =
+          static_cast<uint64_t>(GetTickCount64() - calibrationStart.tickCount) * 1000;
+      const uint64_t ticksPerMicrosecond =
+          ((0 == elapsedMicroseconds) ? 0
+                                      : ((__rdtsc() - calibrationStart.timestamp) /
+                                         elapsedMicroseconds));
+
+      // The rate cannot be measured until some time has passed, in which case budgets are left
+      // unchecked until the next time.
+      if (0 == ticksPerMicrosecond)
+      {
+        ScheduleCheck();
+        return;
+      }
+
+      if (0 != HookStore::EnforceLatencyBudgets(ticksPerMicrosecond)) ScheduleCheck();
+    }
+
+    uint64_t EstimatePercentile99Ticks(const uint64_t* buckets, uint64_t* numSamples)
+    {
+      uint64_t totalSamples = 0;
+      for (size_t i = 0; i < kHookTimingHistogramNumBuckets; ++i)
+        totalSamples += buckets[i];
+
+      *numSamples = totalSamples;
+      if (0 == totalSamples) return 0;
+
+      // The 99th percentile is in the first bucket, counting down from the longest durations, at
+      // which more than 1% of the calls have been seen.
+      const uint64_t numSlowestSamples = (totalSamples / 100) + 1;
+      uint64_t numSamplesSeen = 0;
+      for (size_t i = kHookTimingHistogramNumBuckets; i > 0; --i)
+      {
+        numSamplesSeen += buckets[i - 1];
+        if (numSamplesSeen >= numSlowestSamples) return ((1 == i) ? 0 : (1ull << (i - 1)));
+      }
+
+      return 0;
+    }
+
+    void ScheduleCheck(void)
+    {
+      GetCalibrationStart();
+
+      if (true == checkScheduled.exchange(true)) return;
+      if (true == TaskScheduler::SubmitAfter(kCheckIntervalMilliseconds, CheckTaskProc, nullptr))
+        return;
+
+      checkScheduled = false;
+
+      static std::atomic<bool> failureReported = false;
+      if (false == failureReported.exchange(true))
+        Infra::Message::Output(
+            Infra::Message::ESeverity::Warning,
+            L"Hook latency budgets will not be enforced because no background task can be scheduled.");
+    }
+  } // namespace LatencyBudget
+} // namespace Hookshot
@@ -20,6 +20,7 @@
 
 #include "ApiWindows.h"
 #include "Globals.h"
+#include "InjectorDaemon.h"
 #include "RemoteProcessInjector.h"
 #include "Strings.h"
 
@@ -337,7 +338,32 @@ int WINAPI wWinMain(HINSTANCE hInstance, HINSTANCE hPrevInstance, PWSTR lpCmdLin
 
       HANDLE launchedProcess = NULL;
 
-      if (0 ==
+      // The injector daemon, if enabled, creates and injects the target executable on behalf of
+      // this launcher. It cannot prompt for elevation, so a target executable that requires it is
+      // instead launched the usual way, which results in the prompt.
+      EInjectResult injectorDaemonResult = EInjectResult::Failure;
+      if ((true == InjectorDaemon::IsEnabled()) &&
+          (true ==
+           InjectorDaemon::CreateInjectedProcess(
+               commandLine.AsStringView(), &injectorDaemonResult, &launchedProcess)) &&
+          (false ==
+           ((EInjectResult::ErrorCreateProcess == injectorDaemonResult) &&
+            (ERROR_ELEVATION_REQUIRED == GetLastError()))))
+      {
+        if (EInjectResult::Success != injectorDaemonResult)
+        {
+          Infra::Message::OutputFormatted(
+              Infra::Message::ESeverity::ForcedInteractiveError,
+              L"%s\n\n%.*s failed to inject this executable.\n\n%s (%s).",
+              kExecutableToLaunch.c_str(),
+              static_cast<int>(Infra::ProcessInfo::GetProductName().length()),
+              Infra::ProcessInfo::GetProductName().data(),
+              InjectResultString(injectorDaemonResult).data(),
+              Infra::Strings::FromSystemErrorCode(GetLastError()).AsCString());
+          return __LINE__;
+        }
+      }
+      else if (0 ==
           CreateProcess(
               nullptr,
               commandLine.Data(),
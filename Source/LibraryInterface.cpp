@@ -11,8 +11,13 @@
 
 #include "LibraryInterface.h"
 
+#include <algorithm>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
 #include <memory>
 #include <mutex>
+#include <string>
 #include <string_view>
 #include <vector>
 
@@ -22,14 +27,25 @@
 #include <Infra/Core/Strings.h>
 #include <Infra/Core/TemporaryBuffer.h>
 
+#include "ConfigurationReloader.h"
+#include "DeferredHooks.h"
 #include "DependencyProtect.h"
+#include "ExportResolver.h"
 #include "Globals.h"
+#include "HookIntegrity.h"
+#include "HookModuleBundle.h"
+#include "HookModuleManifest.h"
+#include "HookModuleReloader.h"
 #include "HookshotTypes.h"
 #include "HookStore.h"
+#include "HookTable.h"
 #include "InjectLanding.h"
 #include "InternalHook.h"
+#include "SharedStatistics.h"
+#include "StartupProfile.h"
 #include "Strings.h"
-#include "X86Instruction.h"
+#include "TaskScheduler.h"
+#include "Tracing.h"
 
 namespace Hookshot
 {
@@ -58,6 +74,84 @@ namespace Hookshot
                                                : Infra::ProcessInfo::GetExecutableDirectoryName());
     }
 
+    /// Adds every configured hook module search directory to the set of directories searched by
+    /// loads that request it. Directories that cannot be added are skipped with a warning.
+    /// @return `true` if at least one directory was added, `false` otherwise.
+    static bool AddHookModuleSearchDirectories(void)
+    {
+      const auto& configData = Globals::GetConfigurationData();
+      if (false ==
+          configData.Contains(
+              Infra::Configuration::kSectionNameGlobal,
+              Strings::kStrConfigurationSettingNameHookModuleSearchDirectory))
+        return false;
+
+      bool anyDirectoryAdded = false;
+      for (const auto& searchDirectory :
+           configData[Infra::Configuration::kSectionNameGlobal]
+                     [Strings::kStrConfigurationSettingNameHookModuleSearchDirectory]
+                         .Values())
+      {
+        const std::wstring searchDirectoryName{std::wstring_view(searchDirectory)};
+        if (nullptr != Protected::Windows_AddDllDirectory(searchDirectoryName.c_str()))
+        {
+          anyDirectoryAdded = true;
+          continue;
+        }
+
+        Infra::Message::OutputFormatted(
+            Infra::Message::ESeverity::Warning,
+            L"%s - Failed to add hook module search directory: %s",
+            searchDirectoryName.c_str(),
+            Infra::Strings::FromSystemErrorCode(Protected::Windows_GetLastError()).AsCString());
+      }
+
+      return anyDirectoryAdded;
+    }
+
+    /// Determines whether or not a file name is an absolute path, either beginning with a drive
+    /// letter or identifying a network location.
+    /// @param [in] fileName File name to check.
+    /// @return `true` if so, `false` if not.
+    static bool IsAbsolutePath(std::wstring_view fileName)
+    {
+      return (
+          fileName.starts_with(L"\\\\") ||
+          ((fileName.length() >= 3) && (L':' == fileName[1]) && (L'\\' == fileName[2])));
+    }
+
+    /// Loads a hook module or an injection-only library. By default the full default search path
+    /// is used, as for any other library. If so configured, the search for the library and its
+    /// dependencies is restricted to the directory that contains the library, the system
+    /// directory, and any configured hook module search directories, which avoids probing the
+    /// current directory and every directory on the path, some of which might be on network
+    /// drives. A library identified by a relative path is looked for relative to the application
+    /// directory instead of its own directory, because the latter is only defined for an absolute
+    /// path.
+    /// @param [in] libraryFileName File name of the library to load.
+    /// @return Handle of the loaded library, or `nullptr` on failure.
+    static HMODULE LoadHookModuleOrLibrary(const wchar_t* libraryFileName)
+    {
+      static const bool restrictHookModuleSearchPath =
+          Globals::GetConfigurationData()
+              [Infra::Configuration::kSectionNameGlobal]
+              [Strings::kStrConfigurationSettingNameRestrictHookModuleSearchPath]
+                  .ValueOr(false);
+
+      if (false == restrictHookModuleSearchPath)
+        return Protected::Windows_LoadLibrary(libraryFileName);
+
+      static const DWORD searchDirectoryFlags = LOAD_LIBRARY_SEARCH_SYSTEM32 |
+          ((true == AddHookModuleSearchDirectories()) ? LOAD_LIBRARY_SEARCH_USER_DIRS : 0);
+
+      return Protected::Windows_LoadLibraryEx(
+          libraryFileName,
+          nullptr,
+          (searchDirectoryFlags |
+           ((true == IsAbsolutePath(libraryFileName)) ? LOAD_LIBRARY_SEARCH_DLL_LOAD_DIR
+                                                      : LOAD_LIBRARY_SEARCH_APPLICATION_DIR)));
+    }
+
     /// Obtains pointers to all of the relevant configuration settings for the currently-running
     /// executable. Currently, this function checks both the global section and the
     /// executable-specific section for configuration settings that match the specified name.
@@ -86,17 +180,75 @@ namespace Hookshot
       return relevantConfigSettings;
     }
 
-    /// Attempts to load and initialize the named hook module. Useful if hooks to be set are
-    /// contained in an external hook module.
-    /// @param [in] hookModuleFileName File name of the hook module to load and initialize.
-    /// @return `true` on success, `false` on failure.
-    static bool LoadHookModule(std::wstring_view hookModuleFileName)
+    /// Identifies a hook module that has been loaded but not yet initialized.
+    struct SLoadedHookModule
+    {
+      /// Handle of the hook module, or `nullptr` if it was not successfully loaded.
+      HMODULE hookModule;
+
+      /// Initialization function of the hook module, which is optional if it exports a hook table.
+      THookModuleInitProc initProc;
+
+      /// Entries in the hook table exported by the hook module, if any.
+      const SHookTableEntry* hookTableEntries;
+
+      /// Number of entries in the hook table exported by the hook module.
+      size_t numHookTableEntries;
+    };
+
+    /// Holds the state shared between threads that are loading a set of hook modules in parallel.
+    struct SParallelHookModuleLoad
+    {
+      /// File names of the hook modules to load, in priority order.
+      const std::vector<std::wstring>* hookModuleFileNames;
+
+      /// Hook modules that have been loaded but not yet initialized, indexed the same way as the
+      /// file names. Only used if initialization order is preserved.
+      std::vector<SLoadedHookModule> loadedHookModules;
+
+      /// Whether or not worker threads should also initialize the hook modules they load.
+      bool initializeOnWorkerThreads;
+
+      /// Enforces serialized access to the fields below.
+      std::mutex mutex;
+
+      /// Number of hook modules successfully loaded and, if applicable, initialized.
+      int numLoaded;
+    };
+
+    /// Identifies a single hook module within a set being loaded in parallel.
+    struct SParallelHookModuleLoadItem
+    {
+      /// State shared among all the hook modules in the set.
+      SParallelHookModuleLoad* parallelLoad;
+
+      /// Index of the hook module within the set.
+      size_t index;
+    };
+
+    /// Attempts to load the named hook module and locate its initialization function and hook
+    /// table, without invoking the former or installing the latter.
+    /// @param [in] hookModuleFileName File name of the hook module to load.
+    /// @return Loaded hook module, whose handle is `nullptr` on failure.
+    static SLoadedHookModule LoadHookModuleLibrary(std::wstring_view hookModuleFileName)
     {
       Infra::Message::OutputFormatted(
           Infra::Message::ESeverity::Info,
           L"%s - Attempting to load hook module.",
           hookModuleFileName.data());
-      const HMODULE hookModule = Protected::Windows_LoadLibrary(hookModuleFileName.data());
+
+      // Hook modules that can be reloaded are loaded from copies of their files, so that the files
+      // themselves can be replaced while the process is running. Hook modules held by hook module
+      // bundles can never be unloaded and are therefore never reloaded.
+      const bool isBundledHookModule = HookModuleBundle::IsBundledHookModule(hookModuleFileName);
+      const auto loadStartTime = std::chrono::steady_clock::now();
+      const HMODULE hookModule =
+          ((true == isBundledHookModule) ? HookModuleBundle::LoadHookModule(hookModuleFileName)
+           : (true == HookModuleReloader::IsHotReloadEnabled())
+               ? HookModuleReloader::LoadHookModule(hookModuleFileName)
+               : LoadHookModuleOrLibrary(hookModuleFileName.data()));
+      Tracing::HookModuleLoad(
+          hookModuleFileName, Tracing::MicrosecondsSince(loadStartTime), (nullptr != hookModule));
 
       if (nullptr == hookModule)
       {
@@ -105,29 +257,232 @@ namespace Hookshot
             L"%s - Failed to load hook module: %s",
             hookModuleFileName.data(),
             Infra::Strings::FromSystemErrorCode(Protected::Windows_GetLastError()).AsCString());
-        return false;
+        return {};
       }
 
-      const THookModuleInitProc initProc = (THookModuleInitProc)Protected::Windows_GetProcAddress(
-          hookModule, Strings::kStrHookLibraryInitFuncName.data());
+      // The system loader does not know about hook modules held by hook module bundles, so their
+      // export tables are searched directly.
+      SLoadedHookModule loadedHookModule = {
+          .hookModule = hookModule,
+          .initProc =
+              ((true == isBundledHookModule)
+                   ? (THookModuleInitProc)ExportResolver::GetLocalProcAddress(
+                         hookModule, Strings::kStrHookLibraryInitFuncName)
+                   : (THookModuleInitProc)Protected::Windows_GetProcAddress(
+                         hookModule, Strings::kStrHookLibraryInitFuncName.data()))};
+      const bool hasHookTable = HookTable::LocateHookTable(
+          hookModule, &loadedHookModule.hookTableEntries, &loadedHookModule.numHookTableEntries);
 
-      if (nullptr == initProc)
+      if ((nullptr == loadedHookModule.initProc) && (false == hasHookTable))
       {
         Infra::Message::OutputFormatted(
             Infra::Message::ESeverity::Warning,
             L"%s - Failed to locate required procedure in hook module: %s",
             hookModuleFileName.data(),
             Infra::Strings::FromSystemErrorCode(Protected::Windows_GetLastError()).AsCString());
-        return false;
+        return {};
       }
 
-      initProc(GetHookshotInterfacePointer());
+      return loadedHookModule;
+    }
+
+    /// Creates the hooks listed in the hook tables of a set of hook modules, all together in one
+    /// batch. Must be done before any of their initialization functions are invoked.
+    /// @param [in] hookModuleFileNames File names of the hook modules.
+    /// @param [in] loadedHookModules Loaded hook modules, indexed the same way as the file names.
+    /// @param [in] numHookModules Number of hook modules.
+    static void InstallHookModuleHookTables(
+        const std::wstring* hookModuleFileNames,
+        const SLoadedHookModule* loadedHookModules,
+        size_t numHookModules)
+    {
+      std::vector<HookTable::SHookModuleHookTable> hookTables;
+
+      for (size_t i = 0; i < numHookModules; ++i)
+      {
+        if (0 == loadedHookModules[i].numHookTableEntries) continue;
+
+        hookTables.push_back(
+            {.hookModuleFileName = hookModuleFileNames[i].c_str(),
+             .entries = loadedHookModules[i].hookTableEntries,
+             .numEntries = loadedHookModules[i].numHookTableEntries});
+      }
+
+      if (true == hookTables.empty()) return;
+
+      HookTable::InstallHookTables(
+          GetHookshotInterfacePointer(), hookTables.data(), hookTables.size());
+    }
+
+    /// Invokes the initialization function of a hook module that has already been loaded, if it
+    /// has one.
+    /// @param [in] hookModuleFileName File name of the hook module, for logging purposes.
+    /// @param [in] initProc Initialization function of the hook module, or `nullptr` if it has
+    /// none.
+    static void InitializeHookModule(
+        std::wstring_view hookModuleFileName, THookModuleInitProc initProc)
+    {
+      if (nullptr != initProc)
+      {
+        const auto initializeStartTime = std::chrono::steady_clock::now();
+        initProc(GetHookshotInterfacePointer());
+        Tracing::HookModuleInitialize(
+            hookModuleFileName, Tracing::MicrosecondsSince(initializeStartTime));
+      }
 
       Infra::Message::OutputFormatted(
           Infra::Message::ESeverity::Info,
           L"%s - Successfully loaded hook module.",
           hookModuleFileName.data());
-      return true;
+    }
+
+    /// Task that loads, and possibly also initializes, one hook module that is part of a set being
+    /// loaded in parallel.
+    /// @param [in] context Pointer to the SParallelHookModuleLoadItem object identifying the hook
+    /// module to load, whose ownership is transferred to this function.
+    static void LoadHookModuleTask(void* context)
+    {
+      SParallelHookModuleLoadItem* const item =
+          reinterpret_cast<SParallelHookModuleLoadItem*>(context);
+      SParallelHookModuleLoad* const parallelLoad = item->parallelLoad;
+      const std::wstring& hookModuleFileName = (*parallelLoad->hookModuleFileNames)[item->index];
+
+      // Hook modules initialized on worker threads run concurrently, so each one's hook table is
+      // installed as its own batch just before it is initialized.
+      const SLoadedHookModule loadedHookModule = LoadHookModuleLibrary(hookModuleFileName);
+      if ((nullptr != loadedHookModule.hookModule) &&
+          (true == parallelLoad->initializeOnWorkerThreads))
+      {
+        InstallHookModuleHookTables(&hookModuleFileName, &loadedHookModule, 1);
+        InitializeHookModule(hookModuleFileName, loadedHookModule.initProc);
+      }
+
+      do
+      {
+        std::unique_lock<std::mutex> lock(parallelLoad->mutex);
+
+        if (nullptr != loadedHookModule.hookModule)
+        {
+          if (true == parallelLoad->initializeOnWorkerThreads)
+            parallelLoad->numLoaded += 1;
+          else
+            parallelLoad->loadedHookModules[item->index] = loadedHookModule;
+        }
+      }
+      while (false);
+
+      delete item;
+    }
+
+    /// Loads and initializes a set of hook modules concurrently using the task scheduler. Returns
+    /// only once all of them have been loaded and initialized. If configured to preserve hook
+    /// module order, only loading happens concurrently, after which the hook tables of all the
+    /// hook modules are installed together and initialization functions are invoked on the
+    /// calling thread in priority order.
+    /// @param [in] hookModuleFileNames File names of the hook modules to load, in priority order.
+    /// @return Number of hook modules successfully loaded.
+    static int LoadHookModuleListInParallel(const std::vector<std::wstring>& hookModuleFileNames)
+    {
+      static const bool preserveHookModuleOrder =
+          Globals::GetConfigurationData()
+              [Infra::Configuration::kSectionNameGlobal]
+              [Strings::kStrConfigurationSettingNamePreserveHookModuleOrder]
+                  .ValueOr(false);
+
+      SParallelHookModuleLoad parallelLoad;
+      parallelLoad.hookModuleFileNames = &hookModuleFileNames;
+      parallelLoad.loadedHookModules.assign(hookModuleFileNames.size(), SLoadedHookModule{});
+      parallelLoad.initializeOnWorkerThreads = !preserveHookModuleOrder;
+      parallelLoad.numLoaded = 0;
+
+      TaskScheduler::STaskGroup loadTasks;
+      for (size_t i = 0; i < hookModuleFileNames.size(); ++i)
+        TaskScheduler::Submit(
+            LoadHookModuleTask,
+            new SParallelHookModuleLoadItem{.parallelLoad = &parallelLoad, .index = i},
+            &loadTasks);
+
+      TaskScheduler::Wait(loadTasks);
+
+      InstallHookModuleHookTables(
+          hookModuleFileNames.data(),
+          parallelLoad.loadedHookModules.data(),
+          parallelLoad.loadedHookModules.size());
+
+      for (size_t i = 0; i < hookModuleFileNames.size(); ++i)
+      {
+        if (nullptr == parallelLoad.loadedHookModules[i].hookModule) continue;
+
+        InitializeHookModule(hookModuleFileNames[i], parallelLoad.loadedHookModules[i].initProc);
+        parallelLoad.numLoaded += 1;
+      }
+
+      return parallelLoad.numLoaded;
+    }
+
+    /// Loads and initializes a set of hook modules, either one after another or in parallel as
+    /// configured. Unless hook modules are initialized in parallel, all of them are loaded first,
+    /// then the hooks listed in all of their hook tables are created together in one batch, and
+    /// then their initialization functions are invoked in priority order.
+    /// @param [in] hookModuleFileNames File names of the hook modules to load, in priority order.
+    /// @return Number of hook modules successfully loaded.
+    static int LoadHookModuleList(const std::vector<std::wstring>& hookModuleFileNames)
+    {
+      // Hook modules already loaded from hook module bundles are not loaded again, even if they
+      // are also configured individually or their files are also present.
+      if (true ==
+          std::any_of(
+              hookModuleFileNames.cbegin(),
+              hookModuleFileNames.cend(),
+              [](const std::wstring& hookModuleFileName) -> bool
+              {
+                return HookModuleBundle::IsBundledHookModuleLoaded(hookModuleFileName);
+              }))
+      {
+        std::vector<std::wstring> unbundledHookModuleFileNames;
+        for (const auto& hookModuleFileName : hookModuleFileNames)
+        {
+          if (false == HookModuleBundle::IsBundledHookModuleLoaded(hookModuleFileName))
+          {
+            unbundledHookModuleFileNames.push_back(hookModuleFileName);
+            continue;
+          }
+
+          Infra::Message::OutputFormatted(
+              Infra::Message::ESeverity::Info,
+              L"%s - Skipping hook module because it was already loaded from a hook module bundle.",
+              hookModuleFileName.c_str());
+        }
+
+        return LoadHookModuleList(unbundledHookModuleFileNames);
+      }
+
+      static const bool loadHookModulesInParallel =
+          Globals::GetPerformanceProfile().loadHookModulesInParallel;
+
+      if ((true == loadHookModulesInParallel) && (hookModuleFileNames.size() > 1))
+        return LoadHookModuleListInParallel(hookModuleFileNames);
+
+      std::vector<SLoadedHookModule> loadedHookModules;
+      loadedHookModules.reserve(hookModuleFileNames.size());
+
+      for (const auto& hookModuleFileName : hookModuleFileNames)
+        loadedHookModules.push_back(LoadHookModuleLibrary(hookModuleFileName));
+
+      InstallHookModuleHookTables(
+          hookModuleFileNames.data(), loadedHookModules.data(), loadedHookModules.size());
+
+      int numHookModulesLoaded = 0;
+
+      for (size_t i = 0; i < hookModuleFileNames.size(); ++i)
+      {
+        if (nullptr == loadedHookModules[i].hookModule) continue;
+
+        InitializeHookModule(hookModuleFileNames[i], loadedHookModules[i].initProc);
+        numHookModulesLoaded += 1;
+      }
+
+      return numHookModulesLoaded;
     }
 
     /// Attempts to load the specified library, which is not to be treated as a hook module.
@@ -139,7 +494,7 @@ namespace Hookshot
           Infra::Message::ESeverity::Info,
           L"%s - Attempting to load library.",
           injectOnlyLibraryFileName.data());
-      const HMODULE hookModule = Protected::Windows_LoadLibrary(injectOnlyLibraryFileName.data());
+      const HMODULE hookModule = LoadHookModuleOrLibrary(injectOnlyLibraryFileName.data());
 
       if (nullptr == hookModule)
       {
@@ -158,12 +513,177 @@ namespace Hookshot
       return true;
     }
 
+    /// Removes leading and trailing spaces from part of a configuration setting value.
+    /// @param [in] valuePart Part of a configuration setting value.
+    /// @return Same part without any leading or trailing spaces.
+    static std::wstring_view TrimSpaces(std::wstring_view valuePart)
+    {
+      while ((false == valuePart.empty()) && (L' ' == valuePart.front()))
+        valuePart.remove_prefix(1);
+      while ((false == valuePart.empty()) && (L' ' == valuePart.back()))
+        valuePart.remove_suffix(1);
+
+      return valuePart;
+    }
+
+    /// Task that loads and initializes a hook module whose trigger module was loaded.
+    /// @param [in] context Pointer to the file name of the hook module, whose ownership is
+    /// transferred to this function.
+    static void LoadTriggeredHookModuleTask(void* context)
+    {
+      const std::unique_ptr<std::wstring> hookModuleFileName(
+          reinterpret_cast<std::wstring*>(context));
+
+      Infra::Message::OutputFormatted(
+          Infra::Message::ESeverity::Info,
+          L"%s - Loading hook module now that its trigger module is loaded.",
+          hookModuleFileName->c_str());
+
+      LoadHookModuleList({*hookModuleFileName});
+    }
+
+    /// Deferred action performed once the trigger module of a hook module is loaded. The loader
+    /// lock is held at the time, so the hook module is instead loaded by a worker thread, which can
+    /// proceed as soon as the trigger module has finished loading.
+    /// @param [in] context Pointer to the file name of the hook module, whose ownership is
+    /// transferred to the task that loads it.
+    static void HookModuleTriggerLoaded(void* context)
+    {
+      TaskScheduler::Submit(LoadTriggeredHookModuleTask, context);
+    }
+
+    /// Task that loads injection-only libraries whose loading was deferred. Runs concurrently with
+    /// the executable's entry point, which therefore does not wait for them. Since the loader lock
+    /// is held throughout the load of each one, they are loaded one after another.
+    /// @param [in] context Pointer to a vector holding the file names of the libraries to load,
+    /// whose ownership is transferred to this function.
+    static void LoadDeferredInjectOnlyLibrariesTask(void* context)
+    {
+      const std::unique_ptr<std::vector<std::wstring>> injectOnlyLibraryFileNames(
+          reinterpret_cast<std::vector<std::wstring>*>(context));
+
+      int numInjectOnlyLibrariesLoaded = 0;
+      for (const auto& injectOnlyLibraryFileName : *injectOnlyLibraryFileNames)
+        if (true == LoadInjectOnlyLibrary(injectOnlyLibraryFileName))
+          numInjectOnlyLibrariesLoaded += 1;
+
+      Infra::Message::OutputFormatted(
+          Infra::Message::ESeverity::Info,
+          L"Loaded %d of %d deferred injection-only librar%s.",
+          numInjectOnlyLibrariesLoaded,
+          static_cast<int>(injectOnlyLibraryFileNames->size()),
+          ((1 == injectOnlyLibraryFileNames->size()) ? L"y" : L"ies"));
+    }
+
+    /// Task that reserves trampoline memory near each of a set of loaded modules, so that the first
+    /// hook created in each of them finds trampoline memory ready instead of searching for and
+    /// allocating it while holding the hook store lock. Modules that are not loaded are skipped.
+    /// @param [in] context Pointer to a vector holding the names of the modules, whose ownership is
+    /// transferred to this function.
+    static void PreallocateTrampolinesTask(void* context)
+    {
+      const std::unique_ptr<std::vector<std::wstring>> moduleNames(
+          reinterpret_cast<std::vector<std::wstring>*>(context));
+
+      for (const auto& moduleName : *moduleNames)
+      {
+        HMODULE module = nullptr;
+        if (0 ==
+            Protected::Windows_GetModuleHandleEx(
+                GET_MODULE_HANDLE_EX_FLAG_UNCHANGED_REFCOUNT, moduleName.c_str(), &module))
+          continue;
+
+        // Reserving room for a single hook is enough to cause a trampoline store to be placed
+        // near the module if there is not one already, and a single store holds many trampolines.
+        const void* const targetModule = reinterpret_cast<const void*>(module);
+        const EResult result = hookStore.ReserveHooks(1, &targetModule, 1);
+
+        if (false == SuccessfulResult(result))
+        {
+          Infra::Message::OutputFormatted(
+              Infra::Message::ESeverity::Warning,
+              L"%s - Failed to pre-allocate trampolines (EResult = %u).",
+              moduleName.c_str(),
+              (unsigned int)result);
+        }
+      }
+    }
+
+    /// Deferred action performed once a module listed for trampoline pre-allocation is loaded. The
+    /// loader lock is held at the time, so trampolines are instead pre-allocated by a worker
+    /// thread.
+    /// @param [in] context Pointer to a vector holding the name of the module, whose ownership is
+    /// transferred to the task that pre-allocates trampolines.
+    static void PreallocateTrampolinesModuleLoaded(void* context)
+    {
+      TaskScheduler::Submit(PreallocateTrampolinesTask, context);
+    }
+
+    /// Starts pre-allocating trampolines near whatever modules are specified in the configuration
+    /// file. Pre-allocation happens in the background while hook modules load, and modules that
+    /// are not yet loaded are handled once they are loaded.
+    static void PreallocateConfiguredTrampolines(void)
+    {
+      std::vector<std::wstring>* const loadedModuleNames = new std::vector<std::wstring>();
+      int numModulesDeferred = 0;
+
+      for (const auto& configuredModuleSource : RelevantConfigurationSettings(
+               Strings::kStrConfigurationSettingNamePreallocateTrampolinesNear))
+      {
+        for (const auto& configuredModule : configuredModuleSource->Values())
+        {
+          std::wstring moduleName(TrimSpaces(std::wstring_view(configuredModule)));
+          if (true == moduleName.empty()) continue;
+
+          HMODULE module = nullptr;
+          if (0 !=
+              Protected::Windows_GetModuleHandleEx(
+                  GET_MODULE_HANDLE_EX_FLAG_UNCHANGED_REFCOUNT, moduleName.c_str(), &module))
+          {
+            loadedModuleNames->push_back(std::move(moduleName));
+            continue;
+          }
+
+          std::vector<std::wstring>* const deferredModuleName =
+              new std::vector<std::wstring>({moduleName});
+          if (false ==
+              DeferredHooks::CreateDeferredAction(
+                  moduleName.c_str(), PreallocateTrampolinesModuleLoaded, deferredModuleName))
+          {
+            delete deferredModuleName;
+            continue;
+          }
+
+          numModulesDeferred += 1;
+        }
+      }
+
+      if ((true == loadedModuleNames->empty()) && (0 == numModulesDeferred))
+      {
+        delete loadedModuleNames;
+        return;
+      }
+
+      Infra::Message::OutputFormatted(
+          Infra::Message::ESeverity::Info,
+          L"Pre-allocating trampolines near %d loaded module(s) and %d module(s) not yet loaded.",
+          static_cast<int>(loadedModuleNames->size()),
+          numModulesDeferred);
+
+      if (true == loadedModuleNames->empty())
+        delete loadedModuleNames;
+      else
+        TaskScheduler::Submit(PreallocateTrampolinesTask, loadedModuleNames);
+    }
+
     /// Attempts to load and initialize whatever hook modules are specified in the configuration
-    /// file.
+    /// file. A hook module can be specified as "name @ trigger.dll", in which case it is only
+    /// loaded once the process loads the trigger module, which might be never.
     /// @return Number of hook modules successfully loaded.
     static int LoadConfiguredHookModules(void)
     {
-      int numHookModulesLoaded = 0;
+      std::vector<std::wstring> hookModuleFileNames;
+      int numHookModulesDeferred = 0;
 
       Infra::Message::Output(
           Infra::Message::ESeverity::Info,
@@ -174,13 +694,75 @@ namespace Hookshot
       {
         for (auto& hookModule : configuredHookModuleSource->Values())
         {
-          if (true ==
-              LoadHookModule(Strings::HookModuleFilename(hookModule, HookModuleDirectoryName())))
-            numHookModulesLoaded += 1;
+          const std::wstring_view hookModuleView(hookModule);
+          const size_t separatorPosition = hookModuleView.find(L'@');
+          const std::wstring_view hookModuleName =
+              TrimSpaces(hookModuleView.substr(0, separatorPosition));
+          std::wstring hookModuleFileName(
+              Strings::HookModuleFilename(hookModuleName, HookModuleDirectoryName())
+                  .AsStringView());
+
+          if (std::wstring_view::npos == separatorPosition)
+          {
+            hookModuleFileNames.push_back(std::move(hookModuleFileName));
+            continue;
+          }
+
+          const std::wstring triggerModuleName(
+              TrimSpaces(hookModuleView.substr(separatorPosition + 1)));
+          if ((true == hookModuleName.empty()) || (true == triggerModuleName.empty()))
+          {
+            Infra::Message::OutputFormatted(
+                Infra::Message::ESeverity::Warning,
+                L"%.*s - Ignoring hook module that is not of the form name @ trigger.",
+                static_cast<int>(hookModuleView.length()),
+                hookModuleView.data());
+            continue;
+          }
+
+          // Trigger modules that are already loaded do not need to wait, and their hook modules
+          // are loaded together with all the others.
+          HMODULE triggerModule = nullptr;
+          if (0 !=
+              Protected::Windows_GetModuleHandleEx(
+                  GET_MODULE_HANDLE_EX_FLAG_UNCHANGED_REFCOUNT,
+                  triggerModuleName.c_str(),
+                  &triggerModule))
+          {
+            hookModuleFileNames.push_back(std::move(hookModuleFileName));
+            continue;
+          }
+
+          // The deferred action takes ownership of its copy of the file name, and it might even
+          // run before registration completes if the trigger module is loaded concurrently.
+          std::wstring* const deferredHookModuleFileName = new std::wstring(hookModuleFileName);
+          if (false ==
+              DeferredHooks::CreateDeferredAction(
+                  triggerModuleName.c_str(), HookModuleTriggerLoaded, deferredHookModuleFileName))
+          {
+            // Without loader notifications, the hook module is loaded right away, just as if it
+            // had no trigger module.
+            delete deferredHookModuleFileName;
+            hookModuleFileNames.push_back(std::move(hookModuleFileName));
+            continue;
+          }
+
+          Infra::Message::OutputFormatted(
+              Infra::Message::ESeverity::Info,
+              L"%s - Deferring hook module until %s is loaded.",
+              hookModuleFileName.c_str(),
+              triggerModuleName.c_str());
+          numHookModulesDeferred += 1;
         }
       }
 
-      return numHookModulesLoaded;
+      if (0 != numHookModulesDeferred)
+        Infra::Message::OutputFormatted(
+            Infra::Message::ESeverity::Info,
+            L"Deferred %d hook module(s) until their trigger modules are loaded.",
+            numHookModulesDeferred);
+
+      return LoadHookModuleList(hookModuleFileNames);
     }
 
     /// Attempts to load and initialize hook modules according to default behavior (i.e. all hook
@@ -188,7 +770,7 @@ namespace Hookshot
     /// @return Number of hook modules successfully loaded.
     static int LoadDefaultHookModules(void)
     {
-      int numHookModulesLoaded = 0;
+      std::vector<std::wstring> hookModuleFileNames;
       const std::wstring_view hookModuleDirectory = HookModuleDirectoryName();
 
       Infra::Message::OutputFormatted(
@@ -197,6 +779,27 @@ namespace Hookshot
           static_cast<int>(hookModuleDirectory.size()),
           hookModuleDirectory.data());
 
+      const bool useHookModuleManifest = HookModuleManifest::IsEnabled();
+      if ((true == useHookModuleManifest) &&
+          (true ==
+           HookModuleManifest::ReadHookModuleManifest(hookModuleDirectory, &hookModuleFileNames)))
+      {
+        Infra::Message::OutputFormatted(
+            Infra::Message::ESeverity::Debug,
+            L"Using the hook module manifest, which lists %d hook module(s).",
+            static_cast<int>(hookModuleFileNames.size()));
+        return LoadHookModuleList(hookModuleFileNames);
+      }
+
+      // The directory's last-modified time is retrieved before its contents are enumerated, so
+      // that any change made during enumeration causes the manifest to be regenerated next time.
+      uint64_t hookModuleDirectoryLastWriteTime = 0;
+      bool canWriteHookModuleManifest =
+          ((true == useHookModuleManifest) &&
+           (true ==
+            HookModuleManifest::GetDirectoryLastWriteTime(
+                hookModuleDirectory, &hookModuleDirectoryLastWriteTime)));
+
       const Infra::TemporaryString hookModuleSearchString =
           Strings::HookModuleFilename(L"*", hookModuleDirectory);
       WIN32_FIND_DATA hookModuleFileData{};
@@ -209,20 +812,78 @@ namespace Hookshot
           0);
       BOOL moreHookModulesExist = (INVALID_HANDLE_VALUE != hookModuleFind);
 
+      // An empty manifest is only written if the directory really has no hook modules, as opposed
+      // to if it could not be searched.
+      if ((INVALID_HANDLE_VALUE == hookModuleFind) &&
+          (ERROR_FILE_NOT_FOUND != Protected::Windows_GetLastError()))
+        canWriteHookModuleManifest = false;
+
       Infra::TemporaryString hookModuleFileName;
 
       while (TRUE == moreHookModulesExist)
       {
         hookModuleFileName.Clear();
         hookModuleFileName << hookModuleDirectory << L"\\" << hookModuleFileData.cFileName;
-        if (true == LoadHookModule(hookModuleFileName.AsCString())) numHookModulesLoaded += 1;
+        hookModuleFileNames.emplace_back(hookModuleFileName.AsStringView());
 
         moreHookModulesExist = Protected::Windows_FindNextFile(hookModuleFind, &hookModuleFileData);
       }
 
       if (INVALID_HANDLE_VALUE != hookModuleFind) Protected::Windows_FindClose(hookModuleFind);
 
-      return numHookModulesLoaded;
+      if (true == canWriteHookModuleManifest)
+        HookModuleManifest::WriteHookModuleManifest(
+            hookModuleDirectory, hookModuleDirectoryLastWriteTime, hookModuleFileNames);
+
+      return LoadHookModuleList(hookModuleFileNames);
+    }
+
+    /// Opens whatever hook module bundle files are specified in the configuration file and loads
+    /// and initializes all of the hook modules they hold, in the order in which they are stored.
+    /// @return Number of hook modules successfully loaded.
+    static int LoadConfiguredHookModuleBundles(void)
+    {
+      std::vector<std::wstring> hookModuleFileNames;
+
+      for (const auto& configuredBundleSource :
+           RelevantConfigurationSettings(Strings::kStrConfigurationSettingNameHookModuleBundle))
+      {
+        for (const auto& configuredBundle : configuredBundleSource->Values())
+        {
+          const std::wstring_view bundleName = TrimSpaces(std::wstring_view(configuredBundle));
+          if (true == bundleName.empty()) continue;
+
+          std::wstring bundleFileName;
+          if (false == IsAbsolutePath(bundleName))
+            bundleFileName.append(HookModuleDirectoryName()).append(L"\\");
+          bundleFileName.append(bundleName);
+
+          std::vector<std::wstring> bundledHookModuleNames;
+          if (false == HookModuleBundle::OpenBundle(bundleFileName, &bundledHookModuleNames))
+          {
+            Infra::Message::OutputFormatted(
+                Infra::Message::ESeverity::Warning,
+                L"%s - Failed to open hook module bundle: %s",
+                bundleFileName.c_str(),
+                Infra::Strings::FromSystemErrorCode(Protected::Windows_GetLastError())
+                    .AsCString());
+            continue;
+          }
+
+          Infra::Message::OutputFormatted(
+              Infra::Message::ESeverity::Info,
+              L"%s - Opened hook module bundle, which holds %d hook module(s).",
+              bundleFileName.c_str(),
+              static_cast<int>(bundledHookModuleNames.size()));
+
+          for (auto& bundledHookModuleName : bundledHookModuleNames)
+            hookModuleFileNames.push_back(std::move(bundledHookModuleName));
+        }
+      }
+
+      if (true == hookModuleFileNames.empty()) return 0;
+
+      return LoadHookModuleList(hookModuleFileNames);
     }
 
     IHookshot* GetHookshotInterfacePointer(void)
@@ -239,10 +900,31 @@ namespace Hookshot
           initializeFlag,
           [loadMethod, &initializeResult]()
           {
+            StartupProfile::BeginPhase(Tracing::EStartupPhase::ReadConfiguration);
+            Globals::GetConfigurationData();
+            StartupProfile::EndPhase(Tracing::EStartupPhase::ReadConfiguration);
+
+            StartupProfile::BeginPhase(Tracing::EStartupPhase::InitializeGlobals);
             Globals::Initialize(loadMethod);
-            X86Instruction::Initialize();
+            StartupProfile::EndPhase(Tracing::EStartupPhase::InitializeGlobals);
+
+            // Instruction decoder tables are not initialized here. They are initialized on first
+            // use, which is skipped entirely if every hook is created from a cached hook plan or
+            // if no hooks are ever created, such as in processes that only load injection-only
+            // libraries or pass injection along to their children.
+            if (Globals::ELoadMethod::Injected == loadMethod)
+            {
+              StartupProfile::BeginPhase(Tracing::EStartupPhase::SetInternalHooks);
+              SetAllInternalHooks();
+              StartupProfile::EndPhase(Tracing::EStartupPhase::SetInternalHooks);
+            }
 
-            if (Globals::ELoadMethod::Injected == loadMethod) SetAllInternalHooks();
+            StartupProfile::BeginPhase(Tracing::EStartupPhase::StartPublishing);
+            SharedStatistics::StartPublishing();
+            StartupProfile::EndPhase(Tracing::EStartupPhase::StartPublishing);
+
+            HookIntegrity::StartMonitor();
+            ConfigurationReloader::StartWatching();
 
             initializeResult = true;
           });
@@ -252,6 +934,18 @@ namespace Hookshot
 
     int LoadHookModules(void)
     {
+      if (0 !=
+          Protected::Windows_GetEnvironmentVariable(
+              Strings::kStrSkipHookModulesEnvironmentVariableName.data(), nullptr, 0))
+      {
+        Infra::Message::Output(
+            Infra::Message::ESeverity::Info,
+            L"Not loading any hook modules because the environment requests that they be skipped.");
+        return 0;
+      }
+
+      PreallocateConfiguredTrampolines();
+
       const auto& configData = Globals::GetConfigurationData();
       bool useConfigurationFileHookModules = false;
 
@@ -265,10 +959,17 @@ namespace Hookshot
                           .ValueOr(true);
       }
 
-      if (true == useConfigurationFileHookModules)
-        return LoadConfiguredHookModules();
-      else
-        return LoadDefaultHookModules();
+      // Hook modules held by hook module bundles are loaded first so that any of them also present
+      // as separate files are skipped afterwards.
+      const int numBundledHookModulesLoaded = LoadConfiguredHookModuleBundles();
+      const int numHookModulesLoaded = numBundledHookModulesLoaded +
+          ((true == useConfigurationFileHookModules) ? LoadConfiguredHookModules()
+                                                     : LoadDefaultHookModules());
+
+      if (true == HookModuleReloader::IsHotReloadEnabled())
+        HookModuleReloader::StartWatching(HookModuleDirectoryName());
+
+      return numHookModulesLoaded;
     }
 
     int LoadInjectOnlyLibraries(void)
@@ -283,7 +984,82 @@ namespace Hookshot
           if (true == LoadInjectOnlyLibrary(injectOnlyLibrary)) numInjectOnlyLibrariesLoaded += 1;
       }
 
+      std::vector<std::wstring>* const deferredInjectOnlyLibraryFileNames =
+          new std::vector<std::wstring>();
+
+      for (const auto& configuredInjectOnlyLibrarySource :
+           RelevantConfigurationSettings(Strings::kStrConfigurationSettingNameInjectDeferred))
+      {
+        for (auto& injectOnlyLibrary : configuredInjectOnlyLibrarySource->Values())
+          deferredInjectOnlyLibraryFileNames->emplace_back(injectOnlyLibrary);
+      }
+
+      if (true == deferredInjectOnlyLibraryFileNames->empty())
+      {
+        delete deferredInjectOnlyLibraryFileNames;
+      }
+      else
+      {
+        Infra::Message::OutputFormatted(
+            Infra::Message::ESeverity::Info,
+            L"Deferring %d injection-only librar%s until after the entry point starts running.",
+            static_cast<int>(deferredInjectOnlyLibraryFileNames->size()),
+            ((1 == deferredInjectOnlyLibraryFileNames->size()) ? L"y" : L"ies"));
+        TaskScheduler::Submit(
+            LoadDeferredInjectOnlyLibrariesTask, deferredInjectOnlyLibraryFileNames);
+      }
+
       return numInjectOnlyLibrariesLoaded;
     }
+
+    int CreateConfiguredCallTraceHooks(void)
+    {
+      int numCallTraceHooksCreated = 0;
+
+      for (const auto& configuredTraceCallSource :
+           RelevantConfigurationSettings(Strings::kStrConfigurationSettingNameTraceCall))
+      {
+        for (const auto& traceCall : configuredTraceCallSource->Values())
+        {
+          const std::wstring_view traceCallView(traceCall);
+          const size_t separatorPosition = traceCallView.find(L'!');
+          if ((std::wstring_view::npos == separatorPosition) || (0 == separatorPosition) ||
+              ((traceCallView.length() - 1) == separatorPosition))
+          {
+            Infra::Message::OutputFormatted(
+                Infra::Message::ESeverity::Warning,
+                L"%.*s - Ignoring call trace hook that is not of the form module!export.",
+                static_cast<int>(traceCallView.length()),
+                traceCallView.data());
+            continue;
+          }
+
+          // Export names are always ASCII, so they are narrowed one character at a time.
+          const std::wstring moduleName(traceCallView.substr(0, separatorPosition));
+          std::string exportName;
+          for (const wchar_t exportNameChar : traceCallView.substr(separatorPosition + 1))
+            exportName.push_back(static_cast<char>(exportNameChar));
+
+          const EResult result =
+              DeferredHooks::CreateDeferredCallTraceHook(moduleName.c_str(), exportName.c_str());
+
+          if (true == SuccessfulResult(result))
+          {
+            numCallTraceHooksCreated += 1;
+          }
+          else
+          {
+            Infra::Message::OutputFormatted(
+                Infra::Message::ESeverity::Warning,
+                L"%.*s - Failed to create call trace hook (EResult = %u).",
+                static_cast<int>(traceCallView.length()),
+                traceCallView.data(),
+                (unsigned int)result);
+          }
+        }
+      }
+
+      return numCallTraceHooksCreated;
+    }
   } // namespace LibraryInterface
 } // namespace Hookshot
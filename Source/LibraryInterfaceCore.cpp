@@ -0,0 +1,53 @@
+/***************************************************************************************************
+ * Hookshot
+ *   General-purpose library for injecting DLLs and hooking function calls.
+ ***************************************************************************************************
+ * Authored by Samuel Grossman
+ * Copyright (c) 2019-2025
+ ***********************************************************************************************//**
+ * @file LibraryInterfaceCore.cpp
+ *   Implementation of support functionality for the library interface of Hookshot's core library,
+ *   which only supports hooking functions in the process that links with it.
+ **************************************************************************************************/
+
+#include "LibraryInterface.h"
+
+#include <mutex>
+
+#include "Globals.h"
+#include "HookshotTypes.h"
+#include "HookStore.h"
+
+namespace Hookshot
+{
+  namespace LibraryInterface
+  {
+    /// Single hook configuration interface object.
+    static HookStore hookStore;
+
+    IHookshot* GetHookshotInterfacePointer(void)
+    {
+      return &hookStore;
+    }
+
+    bool Initialize(Globals::ELoadMethod loadMethod)
+    {
+      bool initializeResult = false;
+
+      // The core library is never injected, so it has no internal hooks to set and no hook modules
+      // to load. It also never reads a configuration file, which leaves nothing else to do here.
+      if (Globals::ELoadMethod::LibraryLoaded != loadMethod) return false;
+
+      static std::once_flag initializeFlag;
+      std::call_once(
+          initializeFlag,
+          [loadMethod, &initializeResult]()
+          {
+            Globals::Initialize(loadMethod);
+            initializeResult = true;
+          });
+
+      return initializeResult;
+    }
+  } // namespace LibraryInterface
+} // namespace Hookshot
@@ -0,0 +1,380 @@
+/***************************************************************************************************
+ * Hookshot
+ *   General-purpose library for injecting DLLs and hooking function calls.
+ ***************************************************************************************************
+ * Authored by Samuel Grossman
+ * Copyright (c) 2019-2025
+ ***********************************************************************************************//**
+ * @file MappedLog.cpp
+ *   Implementation of a log sink that appends messages to a memory-mapped ring file without
+ *   taking locks or allocating memory.
+ **************************************************************************************************/
+
+#include "MappedLog.h"
+
+#include <winternl.h>
+
+#include <atomic>
+#include <cstdarg>
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <mutex>
+
+#include <Infra/Core/Message.h>
+
+#include "ApiWindows.h"
+#include "DependencyProtect.h"
+#include "Strings.h"
+
+namespace Hookshot
+{
+  namespace MappedLog
+  {
+    /// Value that identifies a ring file, stored at the very beginning of it.
+    static constexpr uint32_t kRingFileMagic = 0x474c4b48;
+
+    /// Beginning of the ring file, which is immediately followed by the message text. Messages are
+    /// stored as UTF-16 text, each on its own line, and wrap around to the beginning of the text
+    /// area when they reach the end. Because the mapping is backed by a file, messages written
+    /// shortly before the process terminates unexpectedly are still preserved.
+    struct SRingFileHeader
+    {
+      /// Always #kRingFileMagic.
+      uint32_t magic;
+
+      /// Size of this header, in bytes, which is also the offset of the text area.
+      uint32_t headerSizeBytes;
+
+      /// Capacity of the text area, in characters.
+      uint64_t capacityChars;
+
+      /// Total number of characters ever reserved. The next message goes at this value modulo the
+      /// capacity, and the oldest retained text begins there too once the text area has wrapped.
+      std::atomic<uint64_t> numCharsReserved;
+    };
+
+    static_assert(
+        std::atomic<uint64_t>::is_always_lock_free,
+        "Ring file reservations must be lock-free.");
+
+    /// Capacity of the text area of the ring file, in characters.
+    static constexpr size_t kCapacityChars =
+        (kFileSizeBytes - sizeof(SRingFileHeader)) / sizeof(wchar_t);
+
+    /// Header of the ring file, or `nullptr` if the ring file is not in use. Set once and never
+    /// cleared, since the mapping is held for the lifetime of the process.
+    static std::atomic<SRingFileHeader*> ringFileHeader = nullptr;
+
+    /// Whether or not the ring file is shared with other processes in the same process tree, in
+    /// which case every message identifies the process that output it. Set before the ring file
+    /// header and never modified afterwards.
+    static bool ringFileShared = false;
+
+    /// Handles to the shared memory sections through which the ring file in use is shared with
+    /// child processes. Deliberately held open for the lifetime of the process, because the names
+    /// of the sections disappear once no process holds them open.
+    static HANDLE ringFileSections[2] = {nullptr, nullptr};
+
+    /// Determines the identifier of the process that created this process.
+    /// @return Parent process identifier, or 0 if it could not be determined.
+    static uint32_t GetParentProcessId(void)
+    {
+      static const NTSTATUS(WINAPI * ntdllQueryInformationProcessProc)(
+          HANDLE, PROCESSINFOCLASS, PVOID, ULONG, PULONG) =
+          (decltype(ntdllQueryInformationProcessProc))Protected::Windows_GetProcAddress(
+              GetModuleHandle(L"ntdll.dll"), "NtQueryInformationProcess");
+      if (nullptr == ntdllQueryInformationProcessProc) return 0;
+
+      PROCESS_BASIC_INFORMATION processBasicInfo;
+      if (0 !=
+          ntdllQueryInformationProcessProc(
+              GetCurrentProcess(),
+              ProcessBasicInformation,
+              &processBasicInfo,
+              sizeof(processBasicInfo),
+              nullptr))
+        return 0;
+
+      // The last field of the documented structure is the identifier of the parent process.
+      return static_cast<uint32_t>(reinterpret_cast<size_t>(processBasicInfo.Reserved3));
+    }
+
+    /// Tells child processes which process created the ring file in use by this process, by
+    /// publishing its identifier in a shared memory section named after this process.
+    /// @param [in] rootProcessId Identifier of the process that created the ring file.
+    static void PublishRingFileLink(uint32_t rootProcessId)
+    {
+      const HANDLE linkSection = Protected::Windows_CreateFileMapping(
+          INVALID_HANDLE_VALUE,
+          nullptr,
+          PAGE_READWRITE,
+          0,
+          static_cast<DWORD>(sizeof(uint32_t)),
+          Strings::MappedLogLinkSectionName(
+              static_cast<uint32_t>(Protected::Windows_GetCurrentProcessId()))
+              .AsCString());
+      if (nullptr == linkSection) return;
+
+      uint32_t* const linkedProcessId = reinterpret_cast<uint32_t*>(
+          Protected::Windows_MapViewOfFile(linkSection, FILE_MAP_WRITE, 0, 0, 0));
+      if (nullptr == linkedProcessId)
+      {
+        Protected::Windows_CloseHandle(linkSection);
+        return;
+      }
+
+      *linkedProcessId = rootProcessId;
+      Protected::Windows_UnmapViewOfFile(linkedProcessId);
+
+      ringFileSections[1] = linkSection;
+    }
+
+    /// Attempts to map the ring file in use by the parent of this process, if the parent shares it.
+    /// @param [out] rootProcessId Filled with the identifier of the process that created the ring
+    /// file, if there is one to join.
+    /// @return Header of the parent's ring file, or `nullptr` if there is none to join.
+    static SRingFileHeader* JoinParentRingFile(uint32_t* rootProcessId)
+    {
+      const uint32_t parentProcessId = GetParentProcessId();
+      if (0 == parentProcessId) return nullptr;
+
+      const HANDLE linkSection = OpenFileMapping(
+          FILE_MAP_READ, FALSE, Strings::MappedLogLinkSectionName(parentProcessId).AsCString());
+      if (nullptr == linkSection) return nullptr;
+
+      const uint32_t* const linkedProcessId = reinterpret_cast<const uint32_t*>(
+          Protected::Windows_MapViewOfFile(linkSection, FILE_MAP_READ, 0, 0, 0));
+      Protected::Windows_CloseHandle(linkSection);
+      if (nullptr == linkedProcessId) return nullptr;
+
+      const uint32_t linkedRootProcessId = *linkedProcessId;
+      Protected::Windows_UnmapViewOfFile(linkedProcessId);
+
+      const HANDLE ringFileSection = OpenFileMapping(
+          FILE_MAP_WRITE, FALSE, Strings::MappedLogSectionName(linkedRootProcessId).AsCString());
+      if (nullptr == ringFileSection) return nullptr;
+
+      SRingFileHeader* const header = reinterpret_cast<SRingFileHeader*>(
+          Protected::Windows_MapViewOfFile(ringFileSection, FILE_MAP_WRITE, 0, 0, 0));
+      if (nullptr == header)
+      {
+        Protected::Windows_CloseHandle(ringFileSection);
+        return nullptr;
+      }
+
+      // Processes in the same tree can have different architectures, but the header layout is the
+      // same for all of them, and so is the capacity.
+      if ((kRingFileMagic != header->magic) ||
+          (sizeof(SRingFileHeader) != header->headerSizeBytes) ||
+          (kCapacityChars != header->capacityChars))
+      {
+        Protected::Windows_UnmapViewOfFile(header);
+        Protected::Windows_CloseHandle(ringFileSection);
+        return nullptr;
+      }
+
+      ringFileSections[0] = ringFileSection;
+      *rootProcessId = linkedRootProcessId;
+      return header;
+    }
+
+    /// Determines the single character used to identify a message's severity in the ring file.
+    /// @param [in] severity Severity of the message.
+    /// @return Severity identifier character.
+    static wchar_t SeverityCharacter(Infra::Message::ESeverity severity)
+    {
+      switch (severity)
+      {
+        case Infra::Message::ESeverity::Debug:
+          return L'D';
+
+        case Infra::Message::ESeverity::Info:
+        case Infra::Message::ESeverity::ForcedInteractiveInfo:
+          return L'I';
+
+        case Infra::Message::ESeverity::Warning:
+        case Infra::Message::ESeverity::ForcedInteractiveWarning:
+          return L'W';
+
+        case Infra::Message::ESeverity::Error:
+        case Infra::Message::ESeverity::ForcedInteractiveError:
+          return L'E';
+
+        default:
+          return L'?';
+      }
+    }
+
+    /// Appends an already-formatted message to the ring file.
+    /// @param [in] header Header of the ring file.
+    /// @param [in] message Message text, including line terminator.
+    /// @param [in] messageLengthChars Length of the message text, in characters.
+    static void AppendToRingFile(
+        SRingFileHeader* header, const wchar_t* message, size_t messageLengthChars)
+    {
+      wchar_t* const text = reinterpret_cast<wchar_t*>(&header[1]);
+
+      // Each thread reserves its own region of the text area, so threads never write to the same
+      // place unless the ring wraps all the way around while a message is still being copied.
+      const size_t beginIndex = static_cast<size_t>(
+          header->numCharsReserved.fetch_add(messageLengthChars, std::memory_order_relaxed) %
+          kCapacityChars);
+      const size_t numCharsBeforeWrap = kCapacityChars - beginIndex;
+
+      if (messageLengthChars <= numCharsBeforeWrap)
+      {
+        std::memcpy(&text[beginIndex], message, messageLengthChars * sizeof(wchar_t));
+      }
+      else
+      {
+        std::memcpy(&text[beginIndex], message, numCharsBeforeWrap * sizeof(wchar_t));
+        std::memcpy(
+            &text[0],
+            &message[numCharsBeforeWrap],
+            (messageLengthChars - numCharsBeforeWrap) * sizeof(wchar_t));
+      }
+    }
+
+    bool Enable(bool shareWithChildProcesses)
+    {
+      static std::once_flag enableFlag;
+      std::call_once(
+          enableFlag,
+          [shareWithChildProcesses]() -> void
+          {
+            if (true == shareWithChildProcesses)
+            {
+              uint32_t rootProcessId = 0;
+              SRingFileHeader* const parentHeader = JoinParentRingFile(&rootProcessId);
+              if (nullptr != parentHeader)
+              {
+                PublishRingFileLink(rootProcessId);
+
+                ringFileShared = true;
+                ringFileHeader = parentHeader;
+                return;
+              }
+            }
+
+            const HANDLE ringFile = CreateFile(
+                Strings::MappedLogFilename().AsCString(),
+                GENERIC_READ | GENERIC_WRITE,
+                FILE_SHARE_READ,
+                nullptr,
+                CREATE_ALWAYS,
+                FILE_ATTRIBUTE_NORMAL,
+                nullptr);
+            if (INVALID_HANDLE_VALUE == ringFile) return;
+
+            // A shared ring file is named after the process that created it, which is the root of
+            // the process tree that shares it.
+            const uint32_t currentProcessId =
+                static_cast<uint32_t>(Protected::Windows_GetCurrentProcessId());
+            const HANDLE ringFileMapping = Protected::Windows_CreateFileMapping(
+                ringFile,
+                nullptr,
+                PAGE_READWRITE,
+                0,
+                static_cast<DWORD>(kFileSizeBytes),
+                ((true == shareWithChildProcesses)
+                     ? Strings::MappedLogSectionName(currentProcessId).AsCString()
+                     : nullptr));
+            Protected::Windows_CloseHandle(ringFile);
+            if (nullptr == ringFileMapping) return;
+
+            SRingFileHeader* const header = reinterpret_cast<SRingFileHeader*>(
+                Protected::Windows_MapViewOfFile(ringFileMapping, FILE_MAP_WRITE, 0, 0, 0));
+            if (nullptr == header)
+            {
+              Protected::Windows_CloseHandle(ringFileMapping);
+              return;
+            }
+
+            header->headerSizeBytes = static_cast<uint32_t>(sizeof(SRingFileHeader));
+            header->capacityChars = kCapacityChars;
+            header->magic = kRingFileMagic;
+
+            if (true == shareWithChildProcesses)
+            {
+              ringFileSections[0] = ringFileMapping;
+              PublishRingFileLink(currentProcessId);
+              ringFileShared = true;
+            }
+            else
+            {
+              Protected::Windows_CloseHandle(ringFileMapping);
+            }
+
+            ringFileHeader = header;
+          });
+
+      return (nullptr != ringFileHeader);
+    }
+
+    void OutputFormatted(Infra::Message::ESeverity severity, const wchar_t* format, ...)
+    {
+      if ((false == kDebugMessagesCompiledIn) && (Infra::Message::ESeverity::Debug == severity))
+        return;
+      if (false == Infra::Message::WillOutputMessageOfSeverity(severity)) return;
+
+      SRingFileHeader* const header = ringFileHeader;
+
+      wchar_t message[kMaxMessageLengthChars];
+      int prefixLengthChars = 0;
+
+      // Messages in the ring file are not serialized, so each one identifies its thread, and if
+      // the ring file is shared by a process tree, its process too.
+      if (nullptr != header)
+      {
+        prefixLengthChars =
+            ((true == ringFileShared)
+                 ? _snwprintf_s(
+                       message,
+                       _countof(message),
+                       _TRUNCATE,
+                       L"[%5u:%5u] %c ",
+                       (unsigned int)Protected::Windows_GetCurrentProcessId(),
+                       (unsigned int)Protected::Windows_GetCurrentThreadId(),
+                       SeverityCharacter(severity))
+                 : _snwprintf_s(
+                       message,
+                       _countof(message),
+                       _TRUNCATE,
+                       L"[%5u] %c ",
+                       (unsigned int)Protected::Windows_GetCurrentThreadId(),
+                       SeverityCharacter(severity)));
+        if (prefixLengthChars < 0) prefixLengthChars = 0;
+      }
+
+      // Space is left for the line terminator, which is appended only for the ring file.
+      constexpr size_t kLineTerminatorLengthChars = 2;
+
+      va_list args;
+      va_start(args, format);
+      const int bodyLengthChars = _vsnwprintf_s(
+          &message[prefixLengthChars],
+          _countof(message) - prefixLengthChars - kLineTerminatorLengthChars,
+          _TRUNCATE,
+          format,
+          args);
+      va_end(args);
+
+      // Negative means the message was truncated, in which case the buffer is full.
+      const size_t messageLengthChars = ((bodyLengthChars < 0)
+                                             ? (_countof(message) - kLineTerminatorLengthChars - 1)
+                                             : (prefixLengthChars + bodyLengthChars));
+
+      if (nullptr == header)
+      {
+        Infra::Message::Output(severity, message);
+        return;
+      }
+
+      message[messageLengthChars] = L'\r';
+      message[messageLengthChars + 1] = L'\n';
+      AppendToRingFile(header, message, messageLengthChars + kLineTerminatorLengthChars);
+    }
+  } // namespace MappedLog
+} // namespace Hookshot
@@ -0,0 +1,401 @@
+/***************************************************************************************************
+ * Hookshot
+ *   General-purpose library for injecting DLLs and hooking function calls.
+ ***************************************************************************************************
+ * Authored by Samuel Grossman
+ * Copyright (c) 2019-2025
+ ***********************************************************************************************//**
+ * @file ModuleIndex.cpp
+ *   Implementation of the index of address ranges occupied by loaded modules.
+ **************************************************************************************************/
+
+#include "ModuleIndex.h"
+
+#include <algorithm>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+#include <Infra/Core/Message.h>
+#include <Infra/Core/ProcessInfo.h>
+#include <Infra/Core/TemporaryBuffer.h>
+
+#include "ApiWindows.h"
+#include "DependencyProtect.h"
+
+namespace Hookshot
+{
+  namespace ModuleIndex
+  {
+    /// Notification reason passed to the loader notification callback when a module is loaded.
+    /// This and the following types are documented, but internal, and are not exposed by any of
+    /// the Windows header files. See
+    /// https://learn.microsoft.com/en-us/windows/win32/devnotes/ldrdllnotification for details.
+    static constexpr ULONG kLdrDllNotificationReasonLoaded = 1;
+
+    /// Notification reason passed to the loader notification callback when a module is unloaded.
+    /// The module is still mapped while the callback runs.
+    static constexpr ULONG kLdrDllNotificationReasonUnloaded = 2;
+
+    /// Information about a module passed to the loader notification callback. Identical for
+    /// modules being loaded and modules being unloaded. Module names are not needed here.
+    struct SLdrDllNotificationData
+    {
+      ULONG flags;
+      const void* fullDllName;
+      const void* baseDllName;
+      void* dllBase;
+      ULONG sizeOfImage;
+    };
+
+    /// Function signature for the loader notification callback.
+    using TLdrDllNotificationFunction =
+        VOID(CALLBACK*)(ULONG reason, const SLdrDllNotificationData* data, PVOID context);
+
+    /// Function signature for `LdrRegisterDllNotification`, exported by ntdll.
+    using TLdrRegisterDllNotification = NTSTATUS(NTAPI*)(
+        ULONG flags,
+        TLdrDllNotificationFunction notificationFunction,
+        PVOID context,
+        PVOID* cookie);
+
+    /// Address range occupied by a single loaded module. Fields are atomic because lookups read
+    /// them while they might be concurrently modified, in which case the lookup is retried.
+    struct SModuleRange
+    {
+      /// Lowest address in the range, which is also the module handle.
+      std::atomic<size_t> begin;
+
+      /// One past the highest address in the range.
+      std::atomic<size_t> end;
+    };
+
+    /// Storage for module ranges, sorted by beginning address. Published as a unit.
+    struct STable
+    {
+      /// Number of elements in the range array. Never changes once the table is published.
+      size_t capacity;
+
+      /// Range storage.
+      std::unique_ptr<SModuleRange[]> ranges;
+    };
+
+    /// Initial number of ranges that the index can hold.
+    static constexpr size_t kInitialCapacity = 256;
+
+    /// Enforces serialized modification of the index. Lookups never acquire it.
+    static std::mutex modificationMutex;
+
+    /// Sequence number that is odd while the index is being modified and even otherwise. Lookups
+    /// that observe an odd value, or a different value after they finish, are retried.
+    static std::atomic<uint32_t> modificationSequence = 0;
+
+    /// Currently-published table. Lookups access it without taking any locks.
+    static std::atomic<STable*> currentTable = nullptr;
+
+    /// Number of valid ranges at the beginning of the current table.
+    static std::atomic<size_t> numModules = 0;
+
+    /// Owns all tables ever published, including the current one. Previous tables are retained
+    /// because concurrent lookups might still be reading them, but capacity doubles each time, so
+    /// the total amount of retained memory is bounded by the size of the current table.
+    static std::vector<std::unique_ptr<STable>> allTables;
+
+    /// Marks the beginning of a modification. Must be invoked with the modification lock held.
+    static inline void BeginModification(void)
+    {
+      modificationSequence.store(
+          modificationSequence.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+      std::atomic_thread_fence(std::memory_order_release);
+    }
+
+    /// Marks the end of a modification. Must be invoked with the modification lock held.
+    static inline void EndModification(void)
+    {
+      modificationSequence.store(
+          modificationSequence.load(std::memory_order_relaxed) + 1, std::memory_order_release);
+    }
+
+    /// Allocates a new table and copies the existing ranges into it. Must be invoked with the
+    /// modification lock held, but without having begun a modification, since the new table is
+    /// not visible to lookups until it is published.
+    /// @param [in] capacity Number of ranges the new table should be able to hold.
+    /// @return New table, which is owned by the list of all tables.
+    static STable* CreateTable(size_t capacity)
+    {
+      std::unique_ptr<STable> newTable = std::make_unique<STable>();
+      newTable->capacity = capacity;
+      newTable->ranges = std::make_unique<SModuleRange[]>(capacity);
+
+      const STable* const oldTable = currentTable.load(std::memory_order_relaxed);
+      const size_t count = numModules.load(std::memory_order_relaxed);
+      for (size_t i = 0; i < count; ++i)
+      {
+        newTable->ranges[i].begin.store(
+            oldTable->ranges[i].begin.load(std::memory_order_relaxed), std::memory_order_relaxed);
+        newTable->ranges[i].end.store(
+            oldTable->ranges[i].end.load(std::memory_order_relaxed), std::memory_order_relaxed);
+      }
+
+      allTables.push_back(std::move(newTable));
+      return allTables.back().get();
+    }
+
+    /// Determines the position of the first range that begins at or after an address. Must be
+    /// invoked with the modification lock held.
+    /// @param [in] table Table to search.
+    /// @param [in] count Number of valid ranges in the table.
+    /// @param [in] address Address of interest.
+    /// @return Index of the first such range, or the number of ranges if there is none.
+    static size_t LowerBound(const STable* table, size_t count, size_t address)
+    {
+      size_t low = 0;
+      size_t high = count;
+
+      while (low < high)
+      {
+        const size_t middle = low + ((high - low) / 2);
+        if (table->ranges[middle].begin.load(std::memory_order_relaxed) < address)
+          low = middle + 1;
+        else
+          high = middle;
+      }
+
+      return low;
+    }
+
+    /// Adds the address range occupied by a module to the index. Does nothing if the module is
+    /// already present. Must be invoked with the modification lock held.
+    /// @param [in] moduleBase Base address of the module.
+    /// @param [in] sizeOfImage Size of the module's image, in bytes.
+    static void InsertModuleWithLockHeld(size_t moduleBase, size_t sizeOfImage)
+    {
+      STable* const table = currentTable.load(std::memory_order_relaxed);
+      const size_t count = numModules.load(std::memory_order_relaxed);
+
+      const size_t position = LowerBound(table, count, moduleBase);
+      if ((position < count) &&
+          (moduleBase == table->ranges[position].begin.load(std::memory_order_relaxed)))
+        return;
+
+      // Growing is done before the modification begins, so lookups are blocked only while ranges
+      // are shifted.
+      STable* const targetTable =
+          ((count < table->capacity) ? table : CreateTable(2 * table->capacity));
+
+      BeginModification();
+
+      for (size_t i = count; i > position; --i)
+      {
+        targetTable->ranges[i].begin.store(
+            targetTable->ranges[i - 1].begin.load(std::memory_order_relaxed),
+            std::memory_order_relaxed);
+        targetTable->ranges[i].end.store(
+            targetTable->ranges[i - 1].end.load(std::memory_order_relaxed),
+            std::memory_order_relaxed);
+      }
+
+      targetTable->ranges[position].begin.store(moduleBase, std::memory_order_relaxed);
+      targetTable->ranges[position].end.store(moduleBase + sizeOfImage, std::memory_order_relaxed);
+
+      currentTable.store(targetTable, std::memory_order_relaxed);
+      numModules.store(count + 1, std::memory_order_relaxed);
+
+      EndModification();
+    }
+
+    /// Removes the address range occupied by a module from the index. Does nothing if the module
+    /// is not present. Must be invoked with the modification lock held.
+    /// @param [in] moduleBase Base address of the module.
+    static void RemoveModuleWithLockHeld(size_t moduleBase)
+    {
+      STable* const table = currentTable.load(std::memory_order_relaxed);
+      const size_t count = numModules.load(std::memory_order_relaxed);
+
+      const size_t position = LowerBound(table, count, moduleBase);
+      if ((position == count) ||
+          (moduleBase != table->ranges[position].begin.load(std::memory_order_relaxed)))
+        return;
+
+      BeginModification();
+
+      for (size_t i = position + 1; i < count; ++i)
+      {
+        table->ranges[i - 1].begin.store(
+            table->ranges[i].begin.load(std::memory_order_relaxed), std::memory_order_relaxed);
+        table->ranges[i - 1].end.store(
+            table->ranges[i].end.load(std::memory_order_relaxed), std::memory_order_relaxed);
+      }
+
+      numModules.store(count - 1, std::memory_order_relaxed);
+
+      EndModification();
+    }
+
+    /// Loader notification callback. Invoked with the loader lock held whenever a module is loaded
+    /// or unloaded. Modules are still mapped while unload notifications are delivered.
+    /// @param [in] reason Reason for the notification.
+    /// @param [in] data Information about the module.
+    /// @param [in] context Unused.
+    static VOID CALLBACK LoaderNotification(
+        ULONG reason, const SLdrDllNotificationData* data, PVOID context)
+    {
+      if ((nullptr == data) || (nullptr == data->dllBase)) return;
+
+      std::unique_lock<std::mutex> lock(modificationMutex);
+
+      switch (reason)
+      {
+        case kLdrDllNotificationReasonLoaded:
+          InsertModuleWithLockHeld(
+              reinterpret_cast<size_t>(data->dllBase), static_cast<size_t>(data->sizeOfImage));
+          break;
+
+        case kLdrDllNotificationReasonUnloaded:
+          RemoveModuleWithLockHeld(reinterpret_cast<size_t>(data->dllBase));
+          break;
+
+        default:
+          break;
+      }
+    }
+
+    /// Registers for loader notifications and then adds every module that is already loaded to
+    /// the index. Registration happens without the modification lock held, since the loader holds
+    /// its own locks while delivering notifications. Enumeration happens with the modification lock
+    /// held, so any loader notification for a module that is loaded or unloaded concurrently is
+    /// applied afterwards, and the index ends up consistent no matter how the two interleave.
+    /// Unloading a module waits for its notification to be delivered, so the headers of enumerated
+    /// modules remain readable.
+    /// @return `true` if the index was built, `false` otherwise.
+    static bool BuildIndex(void)
+    {
+      HMODULE ntdllModule = nullptr;
+      if (0 ==
+          Protected::Windows_GetModuleHandleEx(
+              GET_MODULE_HANDLE_EX_FLAG_UNCHANGED_REFCOUNT, L"ntdll.dll", &ntdllModule))
+        return false;
+
+      const TLdrRegisterDllNotification ldrRegisterDllNotificationProc =
+          (TLdrRegisterDllNotification)Protected::Windows_GetProcAddress(
+              ntdllModule, "LdrRegisterDllNotification");
+      if (nullptr == ldrRegisterDllNotificationProc) return false;
+
+      do
+      {
+        std::unique_lock<std::mutex> lock(modificationMutex);
+        currentTable.store(CreateTable(kInitialCapacity), std::memory_order_release);
+      } while (false);
+
+      // The cookie is only needed for unregistering, which never happens.
+      PVOID cookie = nullptr;
+      if (0 != ldrRegisterDllNotificationProc(0, &LoaderNotification, nullptr, &cookie))
+        return false;
+
+      std::unique_lock<std::mutex> lock(modificationMutex);
+
+      Infra::TemporaryBuffer<HMODULE> loadedModules;
+      DWORD numLoadedModulesBytes = 0;
+
+      if (FALSE ==
+          EnumProcessModules(
+              Infra::ProcessInfo::GetCurrentProcessHandle(),
+              loadedModules.Data(),
+              loadedModules.CapacityBytes(),
+              &numLoadedModulesBytes))
+        return false;
+
+      // An index that is missing modules would give wrong answers rather than merely slow ones.
+      if (numLoadedModulesBytes > loadedModules.CapacityBytes()) return false;
+
+      const DWORD numLoadedModules = numLoadedModulesBytes / sizeof(HMODULE);
+      for (DWORD i = 0; i < numLoadedModules; ++i)
+      {
+        const IMAGE_DOS_HEADER* const dosHeader =
+            reinterpret_cast<const IMAGE_DOS_HEADER*>(loadedModules[i]);
+        if (IMAGE_DOS_SIGNATURE != dosHeader->e_magic) continue;
+
+        const IMAGE_NT_HEADERS* const ntHeader = reinterpret_cast<const IMAGE_NT_HEADERS*>(
+            reinterpret_cast<size_t>(dosHeader) + static_cast<size_t>(dosHeader->e_lfanew));
+        if (IMAGE_NT_SIGNATURE != ntHeader->Signature) continue;
+
+        InsertModuleWithLockHeld(
+            reinterpret_cast<size_t>(loadedModules[i]),
+            static_cast<size_t>(ntHeader->OptionalHeader.SizeOfImage));
+      }
+
+      return true;
+    }
+
+    /// Determines whether or not the index is available, building it if needed. Only attempted
+    /// once, no matter how many times it is invoked.
+    /// @return `true` if the index is available, `false` otherwise.
+    static bool IsIndexAvailable(void)
+    {
+      static const bool isAvailable = []() -> bool
+      {
+        if (true == BuildIndex()) return true;
+
+        Infra::Message::Output(
+            Infra::Message::ESeverity::Warning,
+            L"Failed to build the loaded module index, so modules will be located using system calls.");
+        return false;
+      }();
+
+      return isAvailable;
+    }
+
+    bool FindModuleForAddress(const void* address, HMODULE* moduleHandle)
+    {
+      if (false == IsIndexAvailable()) return false;
+
+      const size_t addressValue = reinterpret_cast<size_t>(address);
+
+      while (true)
+      {
+        const uint32_t sequenceBefore = modificationSequence.load(std::memory_order_acquire);
+
+        if (0 == (sequenceBefore & 1))
+        {
+          // The count is clamped to the capacity of the table because the two might come from
+          // different modifications, in which case the result is discarded anyway.
+          const STable* const table = currentTable.load(std::memory_order_relaxed);
+          const size_t count =
+              std::min(numModules.load(std::memory_order_relaxed), table->capacity);
+
+          // Locates the last range that begins at or before the address.
+          size_t low = 0;
+          size_t high = count;
+          while (low < high)
+          {
+            const size_t middle = low + ((high - low) / 2);
+            if (table->ranges[middle].begin.load(std::memory_order_relaxed) <= addressValue)
+              low = middle + 1;
+            else
+              high = middle;
+          }
+
+          size_t containingModule = 0;
+          if (0 != low)
+          {
+            const size_t begin = table->ranges[low - 1].begin.load(std::memory_order_relaxed);
+            const size_t end = table->ranges[low - 1].end.load(std::memory_order_relaxed);
+            if (addressValue < end) containingModule = begin;
+          }
+
+          std::atomic_thread_fence(std::memory_order_acquire);
+          if (sequenceBefore == modificationSequence.load(std::memory_order_relaxed))
+          {
+            *moduleHandle = reinterpret_cast<HMODULE>(containingModule);
+            return true;
+          }
+        }
+
+        YieldProcessor();
+      }
+    }
+  } // namespace ModuleIndex
+} // namespace Hookshot
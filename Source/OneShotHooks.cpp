@@ -0,0 +1,55 @@
+/***************************************************************************************************
+ * Hookshot
+ *   General-purpose library for injecting DLLs and hooking function calls.
+ ***************************************************************************************************
+ * Authored by Samuel Grossman
+ * Copyright (c) 2019-2025
+ ***********************************************************************************************//**
+ * @file OneShotHooks.cpp
+ *   Implementation of removing one-shot hooks once their first calls have happened.
+ **************************************************************************************************/
+
+#include "OneShotHooks.h"
+
+#include <atomic>
+#include <cstdint>
+
+#include <Infra/Core/Message.h>
+
+#include "HookStore.h"
+#include "TaskScheduler.h"
+
+namespace Hookshot
+{
+  namespace OneShotHooks
+  {
+    /// Whether or not the background task that removes one-shot hooks is currently scheduled.
+    static std::atomic<bool> checkScheduled = false;
+
+    /// Task procedure that removes every one-shot hook whose first call has happened, and then
+    /// schedules itself again if any one-shot hooks remain.
+    /// @param [in] context Unused.
+    static void CheckTaskProc(void* context)
+    {
+      // Clearing the flag first means that a one-shot hook created while the check is in progress
+      // either is seen by the check or schedules the next one itself.
+      checkScheduled = false;
+      if (0 != HookStore::RemoveFiredOneShotHooks()) ScheduleCheck();
+    }
+
+    void ScheduleCheck(void)
+    {
+      if (true == checkScheduled.exchange(true)) return;
+      if (true == TaskScheduler::SubmitAfter(kCheckIntervalMilliseconds, CheckTaskProc, nullptr))
+        return;
+
+      checkScheduled = false;
+
+      static std::atomic<bool> failureReported = false;
+      if (false == failureReported.exchange(true))
+        Infra::Message::Output(
+            Infra::Message::ESeverity::Warning,
+            L"One-shot hooks will not be removed after their first calls because no background task can be scheduled.");
+    }
+  } // namespace OneShotHooks
+} // namespace Hookshot
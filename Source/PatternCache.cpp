@@ -0,0 +1,457 @@
+/***************************************************************************************************
+ * Hookshot
+ *   General-purpose library for injecting DLLs and hooking function calls.
+ ***************************************************************************************************
+ * Authored by Samuel Grossman
+ * Copyright (c) 2019-2025
+ ***********************************************************************************************//**
+ * @file PatternCache.cpp
+ *   Implementation of the persistent cache of byte pattern search results.
+ **************************************************************************************************/
+
+#include "PatternCache.h"
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <cwctype>
+#include <iterator>
+#include <mutex>
+#include <shared_mutex>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include <Infra/Core/Configuration.h>
+#include <Infra/Core/ProcessInfo.h>
+#include <Infra/Core/Strings.h>
+#include <Infra/Core/TemporaryBuffer.h>
+
+#include "ApiWindows.h"
+#include "Globals.h"
+#include "HookshotTypes.h"
+#include "Strings.h"
+
+namespace Hookshot
+{
+  namespace PatternCache
+  {
+    /// Signature that identifies a pattern cache file. Spells "HSPC" in a hex dump.
+    static constexpr uint32_t kPatternCacheSignature = 0x43505348;
+
+    /// Version of the pattern cache file format. Must be incremented whenever the format or the
+    /// way in which keys are generated changes.
+    static constexpr uint32_t kPatternCacheVersion = 1;
+
+    /// File extension for a pattern cache file.
+    static constexpr std::wstring_view kStrPatternCacheFileExtension = L".PatternCache";
+
+    /// Maximum number of locations that a pattern cache file can hold, which bounds its size. If
+    /// merging would exceed this number, only the locations recorded by the current process are
+    /// kept.
+    static constexpr size_t kMaxPatternCacheEntries = 65536;
+
+    /// Header at the very beginning of a pattern cache file.
+    struct SPatternCacheFileHeader
+    {
+      /// Must be equal to #kPatternCacheSignature.
+      uint32_t signature;
+
+      /// Must be equal to #kPatternCacheVersion.
+      uint32_t version;
+
+      /// Size, in bytes, of each entry that follows the header.
+      uint32_t entrySizeBytes;
+
+      /// Number of entries that follow the header. Entries are sorted by key.
+      uint32_t numEntries;
+    };
+
+    /// Identifies a pattern searched for within a particular module.
+    struct SPatternKey
+    {
+      /// Identity of the module that was searched.
+      SModuleIdentity module;
+
+      /// Hash of the pattern's length, bytes, and mask.
+      uint64_t patternHash;
+
+      inline bool operator==(const SPatternKey& other) const
+      {
+        return (module.pathHash == other.module.pathHash) &&
+            (module.timeDateStamp == other.module.timeDateStamp) &&
+            (module.sizeOfImage == other.module.sizeOfImage) &&
+            (patternHash == other.patternHash);
+      }
+
+      inline bool operator<(const SPatternKey& other) const
+      {
+        if (module.pathHash != other.module.pathHash)
+          return (module.pathHash < other.module.pathHash);
+        if (module.timeDateStamp != other.module.timeDateStamp)
+          return (module.timeDateStamp < other.module.timeDateStamp);
+        if (module.sizeOfImage != other.module.sizeOfImage)
+          return (module.sizeOfImage < other.module.sizeOfImage);
+        return (patternHash < other.patternHash);
+      }
+    };
+
+    /// Single location, as held both in memory and in a pattern cache file.
+    struct SPatternCacheEntry
+    {
+      /// Pattern and module to which the location belongs.
+      SPatternKey key;
+
+      /// Offset of the pattern from the base address of the module.
+      uint32_t rva;
+
+      /// Unused, for alignment only.
+      uint32_t reserved;
+    };
+
+    static_assert(
+        0 == (sizeof(SPatternCacheFileHeader) % alignof(SPatternCacheEntry)),
+        "Pattern cache file header size must preserve entry alignment.");
+
+    /// Enforces concurrency control over the locations held by this process.
+    static std::shared_mutex patternCacheMutex;
+
+    /// Locations read from the pattern cache file, in sorted order, or `nullptr` if either there
+    /// are none or they have been moved into #patternCacheEntries.
+    static const SPatternCacheEntry* mappedPatternCacheEntries = nullptr;
+
+    /// Number of elements in #mappedPatternCacheEntries.
+    static size_t numMappedPatternCacheEntries = 0;
+
+    /// Beginning of the memory-mapped view of the pattern cache file, if it is mapped.
+    static const void* mappedPatternCacheView = nullptr;
+
+    /// Locations held in memory by this process, in sorted order. These include all of the
+    /// locations recorded by this process, and after the pattern cache file is written, also all of
+    /// the locations previously read from it.
+    static std::vector<SPatternCacheEntry> patternCacheEntries;
+
+    /// Whether or not any location was recorded since the pattern cache file was last written.
+    static bool patternCacheModified = false;
+
+    /// Determines the name of the pattern cache file. It is placed next to the configuration file,
+    /// since the locations it holds are specific to the application's own modules, and its name
+    /// identifies the processor architecture because each architecture loads different modules.
+    /// @return Pattern cache file name.
+    static std::wstring_view GetPatternCacheFilename(void)
+    {
+      static const std::wstring patternCacheFilename = []() -> std::wstring
+      {
+        Infra::TemporaryString filename;
+        filename << Infra::ProcessInfo::GetThisModuleDirectoryName() << L"\\"
+                 << Infra::ProcessInfo::GetProductName()
+                 << Infra::Strings::Format(L".%u", (unsigned int)(8 * sizeof(void*))).AsStringView()
+                 << kStrPatternCacheFileExtension;
+        return std::wstring(filename.AsStringView());
+      }();
+
+      return patternCacheFilename;
+    }
+
+    /// Computes the hash that identifies a pattern. Bits excluded by the mask do not contribute,
+    /// so patterns that match exactly the same bytes have the same hash.
+    /// @param [in] pattern Pattern of interest.
+    /// @return Hash of the pattern.
+    static uint64_t HashPattern(const SBytePattern& pattern)
+    {
+      uint64_t patternHash = 14695981039346656037ull;
+
+      for (size_t i = 0; i < sizeof(pattern.length); ++i)
+      {
+        patternHash ^= static_cast<uint64_t>((pattern.length >> (8 * i)) & 0xff);
+        patternHash *= 1099511628211ull;
+      }
+
+      for (size_t i = 0; i < pattern.length; ++i)
+      {
+        const uint8_t mask = ((nullptr == pattern.mask) ? 0xff : pattern.mask[i]);
+
+        patternHash ^= static_cast<uint64_t>(mask);
+        patternHash *= 1099511628211ull;
+        patternHash ^= static_cast<uint64_t>(pattern.bytes[i] & mask);
+        patternHash *= 1099511628211ull;
+      }
+
+      return patternHash;
+    }
+
+    /// Maps the pattern cache file into memory, if it exists and is valid. Invoked once, the first
+    /// time a location is needed.
+    static void MapPatternCacheFile(void)
+    {
+      const HANDLE patternCacheFile = CreateFile(
+          GetPatternCacheFilename().data(),
+          GENERIC_READ,
+          FILE_SHARE_READ | FILE_SHARE_DELETE,
+          nullptr,
+          OPEN_EXISTING,
+          FILE_ATTRIBUTE_NORMAL,
+          nullptr);
+      if (INVALID_HANDLE_VALUE == patternCacheFile) return;
+
+      LARGE_INTEGER patternCacheSize{};
+      const HANDLE patternCacheMapping =
+          (((FALSE != GetFileSizeEx(patternCacheFile, &patternCacheSize)) &&
+            (static_cast<uint64_t>(patternCacheSize.QuadPart) >= sizeof(SPatternCacheFileHeader)))
+               ? CreateFileMapping(patternCacheFile, nullptr, PAGE_READONLY, 0, 0, nullptr)
+               : nullptr);
+      CloseHandle(patternCacheFile);
+      if (nullptr == patternCacheMapping) return;
+
+      const void* const patternCacheView =
+          MapViewOfFile(patternCacheMapping, FILE_MAP_READ, 0, 0, 0);
+      CloseHandle(patternCacheMapping);
+      if (nullptr == patternCacheView) return;
+
+      const SPatternCacheFileHeader* const fileHeader =
+          reinterpret_cast<const SPatternCacheFileHeader*>(patternCacheView);
+      const uint64_t numAvailableEntryBytes =
+          static_cast<uint64_t>(patternCacheSize.QuadPart) - sizeof(SPatternCacheFileHeader);
+
+      if ((kPatternCacheSignature != fileHeader->signature) ||
+          (kPatternCacheVersion != fileHeader->version) ||
+          (sizeof(SPatternCacheEntry) != fileHeader->entrySizeBytes) ||
+          ((static_cast<uint64_t>(fileHeader->numEntries) * sizeof(SPatternCacheEntry)) >
+           numAvailableEntryBytes))
+      {
+        UnmapViewOfFile(patternCacheView);
+        return;
+      }
+
+      mappedPatternCacheView = patternCacheView;
+      mappedPatternCacheEntries = reinterpret_cast<const SPatternCacheEntry*>(
+          reinterpret_cast<const uint8_t*>(patternCacheView) + sizeof(SPatternCacheFileHeader));
+      numMappedPatternCacheEntries = static_cast<size_t>(fileHeader->numEntries);
+    }
+
+    /// Ensures that an attempt was made to map the pattern cache file into memory. Only the first
+    /// invocation has any effect.
+    static void EnsurePatternCacheFileMapped(void)
+    {
+      static std::once_flag mapFlag;
+      std::call_once(mapFlag, MapPatternCacheFile);
+    }
+
+    /// Searches for the location with the specified key within a sorted range of locations.
+    /// @param [in] begin Beginning of the range.
+    /// @param [in] end End of the range.
+    /// @param [in] key Key to find.
+    /// @return Pointer to the matching location, or `nullptr` if there is none.
+    static const SPatternCacheEntry* FindLocation(
+        const SPatternCacheEntry* begin, const SPatternCacheEntry* end, const SPatternKey& key)
+    {
+      const SPatternCacheEntry* const position = std::lower_bound(
+          begin,
+          end,
+          key,
+          [](const SPatternCacheEntry& entry, const SPatternKey& value) -> bool
+          {
+            return (entry.key < value);
+          });
+      if ((end == position) || (false == (position->key == key))) return nullptr;
+
+      return position;
+    }
+
+    bool IsEnabled(void)
+    {
+      static const bool patternCacheEnabled =
+          Globals::GetConfigurationData()[Infra::Configuration::kSectionNameGlobal]
+                                         [Strings::kStrConfigurationSettingNameCachePatternSearches]
+                                             .ValueOr(false);
+
+      return patternCacheEnabled;
+    }
+
+    bool GetModuleIdentity(HMODULE moduleHandle, SModuleIdentity* moduleIdentity)
+    {
+      const uint8_t* const moduleBase = reinterpret_cast<const uint8_t*>(moduleHandle);
+      const IMAGE_DOS_HEADER* const dosHeader =
+          reinterpret_cast<const IMAGE_DOS_HEADER*>(moduleBase);
+      if (IMAGE_DOS_SIGNATURE != dosHeader->e_magic) return false;
+
+      const IMAGE_NT_HEADERS* const ntHeaders =
+          reinterpret_cast<const IMAGE_NT_HEADERS*>(&moduleBase[dosHeader->e_lfanew]);
+      if (IMAGE_NT_SIGNATURE != ntHeaders->Signature) return false;
+
+      Infra::TemporaryString modulePath;
+      modulePath.UnsafeSetSize(
+          GetModuleFileName(moduleHandle, modulePath.Data(), modulePath.Capacity()));
+      if (true == modulePath.Empty()) return false;
+
+      uint64_t pathHash = 14695981039346656037ull;
+      for (const wchar_t pathChar : modulePath.AsStringView())
+      {
+        pathHash ^= static_cast<uint64_t>(std::towlower(pathChar));
+        pathHash *= 1099511628211ull;
+      }
+
+      *moduleIdentity = {
+          .pathHash = pathHash,
+          .timeDateStamp = static_cast<uint32_t>(ntHeaders->FileHeader.TimeDateStamp),
+          .sizeOfImage = static_cast<uint32_t>(ntHeaders->OptionalHeader.SizeOfImage)};
+      return true;
+    }
+
+    bool LookupPattern(
+        const SModuleIdentity& moduleIdentity, const SBytePattern& pattern, uint32_t* rva)
+    {
+      if (false == IsEnabled()) return false;
+
+      const SPatternKey key = {.module = moduleIdentity, .patternHash = HashPattern(pattern)};
+
+      EnsurePatternCacheFileMapped();
+
+      std::shared_lock<std::shared_mutex> lock(patternCacheMutex);
+
+      const SPatternCacheEntry* matchingEntry = FindLocation(
+          patternCacheEntries.data(), patternCacheEntries.data() + patternCacheEntries.size(), key);
+      if (nullptr == matchingEntry)
+        matchingEntry = FindLocation(
+            mappedPatternCacheEntries,
+            mappedPatternCacheEntries + numMappedPatternCacheEntries,
+            key);
+      if (nullptr == matchingEntry) return false;
+
+      *rva = matchingEntry->rva;
+      return true;
+    }
+
+    void RecordPattern(
+        const SModuleIdentity& moduleIdentity, const SBytePattern& pattern, uint32_t rva)
+    {
+      if (false == IsEnabled()) return;
+
+      const SPatternCacheEntry entry = {
+          .key = {.module = moduleIdentity, .patternHash = HashPattern(pattern)},
+          .rva = rva,
+          .reserved = 0};
+
+      std::unique_lock<std::shared_mutex> lock(patternCacheMutex);
+
+      auto insertPosition = std::lower_bound(
+          patternCacheEntries.begin(),
+          patternCacheEntries.end(),
+          entry.key,
+          [](const SPatternCacheEntry& existingEntry, const SPatternKey& value) -> bool
+          {
+            return (existingEntry.key < value);
+          });
+      if ((patternCacheEntries.end() != insertPosition) && (insertPosition->key == entry.key))
+        *insertPosition = entry;
+      else
+        patternCacheEntries.insert(insertPosition, entry);
+
+      patternCacheModified = true;
+    }
+
+    void WritePatternCache(void)
+    {
+      if (false == IsEnabled()) return;
+
+      EnsurePatternCacheFileMapped();
+
+      std::vector<SPatternCacheEntry> entriesToWrite;
+
+      do
+      {
+        std::unique_lock<std::shared_mutex> lock(patternCacheMutex);
+
+        // The pattern cache file cannot be replaced while it is mapped, so any locations read from
+        // it are moved into memory and the mapping is released. Locations recorded by this process
+        // take precedence over those read from the file.
+        if (nullptr != mappedPatternCacheView)
+        {
+          std::vector<SPatternCacheEntry> mergedEntries;
+          mergedEntries.reserve(patternCacheEntries.size() + numMappedPatternCacheEntries);
+          std::set_union(
+              patternCacheEntries.cbegin(),
+              patternCacheEntries.cend(),
+              mappedPatternCacheEntries,
+              mappedPatternCacheEntries + numMappedPatternCacheEntries,
+              std::back_inserter(mergedEntries),
+              [](const SPatternCacheEntry& a, const SPatternCacheEntry& b) -> bool
+              {
+                return (a.key < b.key);
+              });
+
+          if (mergedEntries.size() <= kMaxPatternCacheEntries)
+            patternCacheEntries = std::move(mergedEntries);
+
+          UnmapViewOfFile(mappedPatternCacheView);
+          mappedPatternCacheView = nullptr;
+          mappedPatternCacheEntries = nullptr;
+          numMappedPatternCacheEntries = 0;
+        }
+
+        if (false == patternCacheModified) return;
+        patternCacheModified = false;
+
+        if (patternCacheEntries.size() > kMaxPatternCacheEntries) return;
+        entriesToWrite = patternCacheEntries;
+      }
+      while (false);
+
+      const std::wstring_view patternCacheFilename = GetPatternCacheFilename();
+
+      const SPatternCacheFileHeader fileHeader = {
+          .signature = kPatternCacheSignature,
+          .version = kPatternCacheVersion,
+          .entrySizeBytes = static_cast<uint32_t>(sizeof(SPatternCacheEntry)),
+          .numEntries = static_cast<uint32_t>(entriesToWrite.size())};
+
+      // Multiple processes might try to write the cache at the same time, so each one writes to
+      // its own temporary file and then atomically replaces whatever cache file is present.
+      Infra::TemporaryString temporaryPatternCacheFilename;
+      temporaryPatternCacheFilename
+          << patternCacheFilename << L"."
+          << Infra::Strings::Format(L"%u", GetCurrentProcessId()).AsStringView();
+
+      const HANDLE patternCacheFile = CreateFile(
+          temporaryPatternCacheFilename.AsCString(),
+          GENERIC_WRITE,
+          0,
+          nullptr,
+          CREATE_ALWAYS,
+          FILE_ATTRIBUTE_TEMPORARY,
+          nullptr);
+      if (INVALID_HANDLE_VALUE == patternCacheFile) return;
+
+      const DWORD numEntryBytes =
+          static_cast<DWORD>(entriesToWrite.size() * sizeof(SPatternCacheEntry));
+      DWORD numHeaderBytesWritten = 0;
+      DWORD numEntryBytesWritten = 0;
+      const bool writeSucceeded =
+          ((FALSE !=
+            WriteFile(
+                patternCacheFile,
+                &fileHeader,
+                static_cast<DWORD>(sizeof(fileHeader)),
+                &numHeaderBytesWritten,
+                nullptr)) &&
+           (static_cast<DWORD>(sizeof(fileHeader)) == numHeaderBytesWritten) &&
+           (FALSE !=
+            WriteFile(
+                patternCacheFile,
+                entriesToWrite.data(),
+                numEntryBytes,
+                &numEntryBytesWritten,
+                nullptr)) &&
+           (numEntryBytes == numEntryBytesWritten));
+      CloseHandle(patternCacheFile);
+
+      if ((false == writeSucceeded) ||
+          (FALSE ==
+           MoveFileEx(
+               temporaryPatternCacheFilename.AsCString(),
+               patternCacheFilename.data(),
+               MOVEFILE_REPLACE_EXISTING)))
+        DeleteFile(temporaryPatternCacheFilename.AsCString());
+    }
+  } // namespace PatternCache
+} // namespace Hookshot
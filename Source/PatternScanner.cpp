@@ -0,0 +1,506 @@
+/***************************************************************************************************
+ * Hookshot
+ *   General-purpose library for injecting DLLs and hooking function calls.
+ ***************************************************************************************************
+ * Authored by Samuel Grossman
+ * Copyright (c) 2019-2025
+ ***********************************************************************************************//**
+ * @file PatternScanner.cpp
+ *   Implementation of locating byte patterns in the executable code of loaded modules.
+ **************************************************************************************************/
+
+#include "PatternScanner.h"
+
+#include <algorithm>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <immintrin.h>
+#include <intrin.h>
+#include <memory>
+#include <vector>
+
+#include "ApiWindows.h"
+#include "HookshotTypes.h"
+#include "PatternCache.h"
+#include "TaskScheduler.h"
+
+namespace Hookshot
+{
+  namespace PatternScanner
+  {
+    /// Number of bytes searched for all patterns before moving on to the next bytes. Small enough
+    /// that the bytes remain in the processor's cache while every pattern is searched for.
+    static constexpr size_t kChunkSize = 64 * 1024;
+
+    /// Number of bytes searched by each task submitted to the task scheduler.
+    static constexpr size_t kTaskSize = 8 * kChunkSize;
+
+    /// Minimum total size, in bytes, of the executable sections of a module for the search to be
+    /// divided among worker threads. Smaller modules are searched faster than tasks can be handed
+    /// off, so they are searched entirely on the calling thread.
+    static constexpr size_t kParallelSearchThreshold = 4 * kTaskSize;
+
+    /// Pattern prepared for searching, along with the search results so far.
+    struct SPreparedPattern
+    {
+      /// Pattern being searched for.
+      const SBytePattern* pattern;
+
+      /// Offset within the pattern of the byte that is least likely to occur in code.
+      size_t firstAnchorOffset;
+
+      /// Offset within the pattern of the byte that is next least likely to occur in code. Same as
+      /// the first anchor offset if the pattern has only one byte that must match exactly.
+      size_t secondAnchorOffset;
+
+      /// Value of the byte at the first anchor offset.
+      uint8_t firstAnchor;
+
+      /// Value of the byte at the second anchor offset.
+      uint8_t secondAnchor;
+
+      /// Lowest address at which the pattern has been found so far, or `SIZE_MAX` if it has not
+      /// been found. Updated concurrently by all of the threads searching for the pattern.
+      std::atomic<size_t> lowestMatch;
+    };
+
+    /// Range of executable code to be searched for all patterns, either on the calling thread or
+    /// as a task submitted to the task scheduler.
+    struct SSearchRange
+    {
+      /// Patterns to search for.
+      SPreparedPattern* const* patterns;
+
+      /// Number of patterns to search for.
+      size_t numPatterns;
+
+      /// First address at which a pattern may begin.
+      const uint8_t* begin;
+
+      /// Number of addresses, starting with the first, at which a pattern may begin.
+      size_t length;
+
+      /// Address just past the end of the section that contains the range. Patterns that begin
+      /// within the range may extend past its end up to this address.
+      const uint8_t* sectionEnd;
+    };
+
+    /// Signature of a function that searches for the first occurrence of a single pattern.
+    /// @param [in] pattern Pattern to search for.
+    /// @param [in] first First address at which the pattern may begin.
+    /// @param [in] last Last address at which the pattern may begin.
+    /// @return First address at which the pattern occurs, or `nullptr` if it does not occur.
+    using TSearchFunc = const uint8_t* (*)(
+        const SPreparedPattern& pattern, const uint8_t* first, const uint8_t* last);
+
+    /// Estimates how often a byte value occurs in typical machine code, so that patterns can be
+    /// anchored on the bytes that produce the fewest candidate positions.
+    /// @param [in] value Byte value of interest.
+    /// @return Higher values for bytes that occur more often, lower values for rarer bytes.
+    static unsigned int ByteCommonness(uint8_t value)
+    {
+      switch (value)
+      {
+        case 0x00:
+        case 0x48:
+        case 0x89:
+        case 0x8b:
+        case 0xcc:
+        case 0xff:
+          return 2;
+
+        case 0x01:
+        case 0x0f:
+        case 0x24:
+        case 0x41:
+        case 0x44:
+        case 0x4c:
+        case 0x74:
+        case 0x75:
+        case 0x83:
+        case 0x85:
+        case 0x8d:
+        case 0x90:
+        case 0xc3:
+        case 0xe8:
+          return 1;
+
+        default:
+          return 0;
+      }
+    }
+
+    /// Determines if a byte of a pattern must match exactly, making it suitable as an anchor.
+    /// @param [in] pattern Pattern of interest.
+    /// @param [in] offset Offset of the byte of interest within the pattern.
+    /// @return `true` if all of the byte's bits are compared, `false` otherwise.
+    static inline bool IsExactByte(const SBytePattern& pattern, size_t offset)
+    {
+      return ((nullptr == pattern.mask) || (0xff == pattern.mask[offset]));
+    }
+
+    /// Determines if a pattern occurs at a particular address.
+    /// @param [in] pattern Pattern of interest.
+    /// @param [in] position Address to compare with the pattern.
+    /// @return `true` if the pattern occurs at the address, `false` otherwise.
+    static bool IsMatch(const SBytePattern& pattern, const uint8_t* position)
+    {
+      if (nullptr == pattern.mask)
+      {
+        for (size_t i = 0; i < pattern.length; ++i)
+          if (pattern.bytes[i] != position[i]) return false;
+      }
+      else
+      {
+        for (size_t i = 0; i < pattern.length; ++i)
+          if (0 != ((pattern.bytes[i] ^ position[i]) & pattern.mask[i])) return false;
+      }
+
+      return true;
+    }
+
+    /// Prepares a pattern for searching by selecting its anchor bytes.
+    /// @param [in] pattern Pattern to prepare.
+    /// @param [out] preparedPattern Filled with the prepared pattern.
+    /// @return `true` if the pattern is valid, `false` otherwise.
+    static bool PreparePattern(const SBytePattern& pattern, SPreparedPattern* preparedPattern)
+    {
+      if ((nullptr == pattern.bytes) || (0 == pattern.length)) return false;
+
+      size_t firstAnchorOffset = SIZE_MAX;
+      size_t secondAnchorOffset = SIZE_MAX;
+
+      for (size_t i = 0; i < pattern.length; ++i)
+      {
+        if (false == IsExactByte(pattern, i)) continue;
+
+        const unsigned int commonness = ByteCommonness(pattern.bytes[i]);
+        if ((SIZE_MAX == firstAnchorOffset) ||
+            (commonness < ByteCommonness(pattern.bytes[firstAnchorOffset])))
+        {
+          secondAnchorOffset = firstAnchorOffset;
+          firstAnchorOffset = i;
+        }
+        else if (
+            (SIZE_MAX == secondAnchorOffset) ||
+            (commonness < ByteCommonness(pattern.bytes[secondAnchorOffset])))
+        {
+          secondAnchorOffset = i;
+        }
+      }
+
+      if (SIZE_MAX == firstAnchorOffset) return false;
+      if (SIZE_MAX == secondAnchorOffset) secondAnchorOffset = firstAnchorOffset;
+
+      preparedPattern->pattern = &pattern;
+      preparedPattern->firstAnchorOffset = firstAnchorOffset;
+      preparedPattern->secondAnchorOffset = secondAnchorOffset;
+      preparedPattern->firstAnchor = pattern.bytes[firstAnchorOffset];
+      preparedPattern->secondAnchor = pattern.bytes[secondAnchorOffset];
+      preparedPattern->lowestMatch = SIZE_MAX;
+      return true;
+    }
+
+    /// Searches for the first occurrence of a single pattern one position at a time. Used for
+    /// positions that are too close to the end of a range to be filtered using vector instructions.
+    /// @param [in] pattern Pattern to search for.
+    /// @param [in] first First address at which the pattern may begin.
+    /// @param [in] last Last address at which the pattern may begin.
+    /// @return First address at which the pattern occurs, or `nullptr` if it does not occur.
+    static const uint8_t* SearchScalar(
+        const SPreparedPattern& pattern, const uint8_t* first, const uint8_t* last)
+    {
+      for (const uint8_t* position = first; position <= last; ++position)
+      {
+        if ((pattern.firstAnchor == position[pattern.firstAnchorOffset]) &&
+            (pattern.secondAnchor == position[pattern.secondAnchorOffset]) &&
+            (true == IsMatch(*pattern.pattern, position)))
+          return position;
+      }
+
+      return nullptr;
+    }
+
+    /// Searches for the first occurrence of a single pattern, comparing both anchor bytes at 16
+    /// positions at once using SSE2 instructions, which every supported processor has.
+    /// @param [in] pattern Pattern to search for.
+    /// @param [in] first First address at which the pattern may begin.
+    /// @param [in] last Last address at which the pattern may begin.
+    /// @return First address at which the pattern occurs, or `nullptr` if it does not occur.
+    static const uint8_t* SearchSse2(
+        const SPreparedPattern& pattern, const uint8_t* first, const uint8_t* last)
+    {
+      const __m128i firstAnchors = _mm_set1_epi8(static_cast<char>(pattern.firstAnchor));
+      const __m128i secondAnchors = _mm_set1_epi8(static_cast<char>(pattern.secondAnchor));
+
+      const uint8_t* position = first;
+      for (; (last - position) >= 15; position += 16)
+      {
+        const __m128i firstBytes = _mm_loadu_si128(
+            reinterpret_cast<const __m128i*>(&position[pattern.firstAnchorOffset]));
+        const __m128i secondBytes = _mm_loadu_si128(
+            reinterpret_cast<const __m128i*>(&position[pattern.secondAnchorOffset]));
+
+        unsigned long candidates = static_cast<unsigned long>(_mm_movemask_epi8(_mm_and_si128(
+            _mm_cmpeq_epi8(firstBytes, firstAnchors), _mm_cmpeq_epi8(secondBytes, secondAnchors))));
+
+        while (0 != candidates)
+        {
+          unsigned long candidateIndex = 0;
+          _BitScanForward(&candidateIndex, candidates);
+          if (true == IsMatch(*pattern.pattern, &position[candidateIndex]))
+            return &position[candidateIndex];
+
+          candidates &= (candidates - 1);
+        }
+      }
+
+      return SearchScalar(pattern, position, last);
+    }
+
+    /// Searches for the first occurrence of a single pattern, comparing both anchor bytes at 32
+    /// positions at once using AVX2 instructions. Only used if the processor supports them.
+    /// @param [in] pattern Pattern to search for.
+    /// @param [in] first First address at which the pattern may begin.
+    /// @param [in] last Last address at which the pattern may begin.
+    /// @return First address at which the pattern occurs, or `nullptr` if it does not occur.
+    static const uint8_t* SearchAvx2(
+        const SPreparedPattern& pattern, const uint8_t* first, const uint8_t* last)
+    {
+      const __m256i firstAnchors = _mm256_set1_epi8(static_cast<char>(pattern.firstAnchor));
+      const __m256i secondAnchors = _mm256_set1_epi8(static_cast<char>(pattern.secondAnchor));
+
+      const uint8_t* position = first;
+      for (; (last - position) >= 31; position += 32)
+      {
+        const __m256i firstBytes = _mm256_loadu_si256(
+            reinterpret_cast<const __m256i*>(&position[pattern.firstAnchorOffset]));
+        const __m256i secondBytes = _mm256_loadu_si256(
+            reinterpret_cast<const __m256i*>(&position[pattern.secondAnchorOffset]));
+
+        unsigned long candidates =
+            static_cast<unsigned long>(_mm256_movemask_epi8(_mm256_and_si256(
+                _mm256_cmpeq_epi8(firstBytes, firstAnchors),
+                _mm256_cmpeq_epi8(secondBytes, secondAnchors))));
+
+        while (0 != candidates)
+        {
+          unsigned long candidateIndex = 0;
+          _BitScanForward(&candidateIndex, candidates);
+          if (true == IsMatch(*pattern.pattern, &position[candidateIndex]))
+            return &position[candidateIndex];
+
+          candidates &= (candidates - 1);
+        }
+      }
+
+      return SearchSse2(pattern, position, last);
+    }
+
+    /// Determines if the processor and operating system both support AVX2 instructions.
+    /// @return `true` if AVX2 instructions can be used, `false` otherwise.
+    static bool IsAvx2Supported(void)
+    {
+      int cpuInfo[4] = {};
+
+      __cpuid(cpuInfo, 0);
+      if (cpuInfo[0] < 7) return false;
+
+      // The processor must support AVX and the operating system must save the upper halves of the
+      // vector registers on context switches, which is indicated by the XSAVE-enabled bit.
+      static constexpr int kOsxsaveAndAvxBits = ((1 << 27) | (1 << 28));
+      __cpuid(cpuInfo, 1);
+      if (kOsxsaveAndAvxBits != (cpuInfo[2] & kOsxsaveAndAvxBits)) return false;
+      if (0x6 != (_xgetbv(0) & 0x6)) return false;
+
+      __cpuidex(cpuInfo, 7, 0);
+      return (0 != (cpuInfo[1] & (1 << 5)));
+    }
+
+    /// Selects the fastest single-pattern search function that the processor supports. Only
+    /// determined once, no matter how many times it is invoked.
+    /// @return Search function to use.
+    static TSearchFunc GetSearchFunc(void)
+    {
+      static const TSearchFunc searchFunc =
+          ((true == IsAvx2Supported()) ? &SearchAvx2 : &SearchSse2);
+      return searchFunc;
+    }
+
+    /// Records that a pattern was found, unless it was already found at a lower address.
+    /// @param [in,out] pattern Pattern that was found.
+    /// @param [in] match Address at which the pattern was found.
+    static void RecordMatch(SPreparedPattern& pattern, const uint8_t* match)
+    {
+      const size_t matchAddress = reinterpret_cast<size_t>(match);
+      size_t lowestMatch = pattern.lowestMatch.load(std::memory_order_relaxed);
+
+      while (matchAddress < lowestMatch)
+      {
+        if (true == pattern.lowestMatch.compare_exchange_weak(lowestMatch, matchAddress)) break;
+      }
+    }
+
+    /// Searches a range of executable code for all patterns, one chunk at a time. Patterns already
+    /// found at lower addresses, possibly by other threads, are not searched for again.
+    /// @param [in] searchRange Range to search and patterns to search for.
+    static void SearchRange(const SSearchRange& searchRange)
+    {
+      const TSearchFunc searchFunc = GetSearchFunc();
+
+      for (size_t chunkOffset = 0; chunkOffset < searchRange.length; chunkOffset += kChunkSize)
+      {
+        const uint8_t* const chunk = &searchRange.begin[chunkOffset];
+        const size_t chunkLength = std::min(kChunkSize, searchRange.length - chunkOffset);
+        const size_t lengthToSectionEnd = static_cast<size_t>(searchRange.sectionEnd - chunk);
+
+        for (size_t i = 0; i < searchRange.numPatterns; ++i)
+        {
+          SPreparedPattern& pattern = *searchRange.patterns[i];
+
+          if (pattern.pattern->length > lengthToSectionEnd) continue;
+          const size_t lowestMatch = pattern.lowestMatch.load(std::memory_order_relaxed);
+          if (reinterpret_cast<size_t>(chunk) >= lowestMatch) continue;
+
+          const uint8_t* const last =
+              &chunk[std::min(chunkLength - 1, lengthToSectionEnd - pattern.pattern->length)];
+          const uint8_t* const match = searchFunc(pattern, chunk, last);
+          if (nullptr != match) RecordMatch(pattern, match);
+        }
+      }
+    }
+
+    /// Task that searches a range of executable code for all patterns.
+    /// @param [in] context Search range object.
+    static void SearchRangeTask(void* context)
+    {
+      SearchRange(*reinterpret_cast<const SSearchRange*>(context));
+    }
+
+    EResult FindPatterns(
+        HMODULE moduleHandle, const SBytePattern* patterns, size_t numPatterns, void** results)
+    {
+      if (nullptr == moduleHandle) return EResult::FailInvalidArgument;
+      if ((0 != numPatterns) && ((nullptr == patterns) || (nullptr == results)))
+        return EResult::FailInvalidArgument;
+
+      const uint8_t* const moduleBase = reinterpret_cast<const uint8_t*>(moduleHandle);
+      const IMAGE_DOS_HEADER* const dosHeader =
+          reinterpret_cast<const IMAGE_DOS_HEADER*>(moduleBase);
+      if (IMAGE_DOS_SIGNATURE != dosHeader->e_magic) return EResult::FailInvalidArgument;
+
+      const IMAGE_NT_HEADERS* const ntHeaders =
+          reinterpret_cast<const IMAGE_NT_HEADERS*>(&moduleBase[dosHeader->e_lfanew]);
+      if (IMAGE_NT_SIGNATURE != ntHeaders->Signature) return EResult::FailInvalidArgument;
+
+      if (0 == numPatterns) return EResult::Success;
+
+      std::unique_ptr<SPreparedPattern[]> preparedPatterns =
+          std::make_unique<SPreparedPattern[]>(numPatterns);
+      for (size_t i = 0; i < numPatterns; ++i)
+      {
+        if (false == PreparePattern(patterns[i], &preparedPatterns[i]))
+          return EResult::FailInvalidArgument;
+      }
+
+      // Patterns whose locations are cached, and still contain the pattern, need not be searched
+      // for at all. The cached location is the lowest one because the module is the same build.
+      PatternCache::SModuleIdentity moduleIdentity{};
+      const bool isPatternCacheUsable =
+          ((true == PatternCache::IsEnabled()) &&
+           (true == PatternCache::GetModuleIdentity(moduleHandle, &moduleIdentity)));
+
+      std::vector<SPreparedPattern*> patternsToSearch;
+      patternsToSearch.reserve(numPatterns);
+
+      for (size_t i = 0; i < numPatterns; ++i)
+      {
+        uint32_t cachedRva = 0;
+        if ((true == isPatternCacheUsable) &&
+            (true == PatternCache::LookupPattern(moduleIdentity, patterns[i], &cachedRva)) &&
+            (patterns[i].length <= moduleIdentity.sizeOfImage) &&
+            (cachedRva <= (moduleIdentity.sizeOfImage - patterns[i].length)) &&
+            (true == IsMatch(patterns[i], &moduleBase[cachedRva])))
+          preparedPatterns[i].lowestMatch = reinterpret_cast<size_t>(&moduleBase[cachedRva]);
+        else
+          patternsToSearch.push_back(&preparedPatterns[i]);
+      }
+
+      // Executable sections are divided into ranges up front, whether or not the search is
+      // divided among worker threads, so that every pattern is searched for in the same order.
+      std::vector<SSearchRange> searchRanges;
+      size_t totalLength = 0;
+
+      // If every pattern was found in the cache, the sections are not even enumerated.
+      const IMAGE_SECTION_HEADER* const sections = IMAGE_FIRST_SECTION(ntHeaders);
+      const WORD numSections =
+          ((true == patternsToSearch.empty()) ? 0 : ntHeaders->FileHeader.NumberOfSections);
+      for (WORD i = 0; i < numSections; ++i)
+      {
+        if (0 == (sections[i].Characteristics & IMAGE_SCN_MEM_EXECUTE)) continue;
+
+        const uint8_t* const sectionBegin = &moduleBase[sections[i].VirtualAddress];
+        const size_t sectionLength = static_cast<size_t>(
+            (0 != sections[i].Misc.VirtualSize) ? sections[i].Misc.VirtualSize
+                                                : sections[i].SizeOfRawData);
+
+        for (size_t offset = 0; offset < sectionLength; offset += kTaskSize)
+        {
+          searchRanges.push_back(
+              {.patterns = patternsToSearch.data(),
+               .numPatterns = patternsToSearch.size(),
+               .begin = &sectionBegin[offset],
+               .length = std::min(kTaskSize, sectionLength - offset),
+               .sectionEnd = &sectionBegin[sectionLength]});
+        }
+
+        totalLength += sectionLength;
+      }
+
+      if (totalLength < kParallelSearchThreshold)
+      {
+        for (const SSearchRange& searchRange : searchRanges)
+          SearchRange(searchRange);
+      }
+      else
+      {
+        TaskScheduler::STaskGroup searchTasks;
+        for (SSearchRange& searchRange : searchRanges)
+          TaskScheduler::Submit(SearchRangeTask, &searchRange, &searchTasks);
+
+        TaskScheduler::Wait(searchTasks);
+      }
+
+      if (true == isPatternCacheUsable)
+      {
+        for (const SPreparedPattern* searchedPattern : patternsToSearch)
+        {
+          const size_t lowestMatch = searchedPattern->lowestMatch.load();
+          if (SIZE_MAX != lowestMatch)
+            PatternCache::RecordPattern(
+                moduleIdentity,
+                *searchedPattern->pattern,
+                static_cast<uint32_t>(lowestMatch - reinterpret_cast<size_t>(moduleBase)));
+        }
+      }
+
+      EResult result = EResult::Success;
+      for (size_t i = 0; i < numPatterns; ++i)
+      {
+        const size_t lowestMatch = preparedPatterns[i].lowestMatch.load();
+        if (SIZE_MAX == lowestMatch)
+        {
+          results[i] = nullptr;
+          result = EResult::FailNotFound;
+        }
+        else
+        {
+          results[i] = reinterpret_cast<void*>(lowestMatch);
+        }
+      }
+
+      return result;
+    }
+  } // namespace PatternScanner
+} // namespace Hookshot
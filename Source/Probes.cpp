@@ -0,0 +1,502 @@
+/***************************************************************************************************
+ * Hookshot
+ *   General-purpose library for injecting DLLs and hooking function calls.
+ ***************************************************************************************************
+ * Authored by Samuel Grossman
+ * Copyright (c) 2019-2025
+ ***********************************************************************************************//**
+ * @file Probes.cpp
+ *   Implementation of the shared probe code that invokes the callbacks of probes.
+ **************************************************************************************************/
+
+#include "Probes.h"
+
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+
+#include <Infra/Core/Message.h>
+#include <Infra/Core/ProcessInfo.h>
+
+#include "ApiWindows.h"
+#include "DependencyProtect.h"
+#include "HookshotTypes.h"
+
+namespace Hookshot
+{
+  namespace Probes
+  {
+    /// Shared probe code, which every probe stub calls. Probes can be placed anywhere, so every
+    /// register is potentially live and nothing can be modified before it is saved. Pushes the
+    /// volatile general-purpose registers and the flags, followed by the stack pointer at the probe
+    /// and the probe address and context value, which are read from the probe stub relative to the
+    /// return address pushed by its call. Together these form the probe context object. Saves the
+    /// volatile vector registers and invokes the callback, then restores everything from the probe
+    /// context object, so that changes made by the callback take effect, and returns into the probe
+    /// stub, which jumps to the resume address. Every call is paired with a return to the address
+    /// it pushed, so the probe code works in processes that enforce shadow stacks. In 64-bit mode,
+    /// the stack is aligned dynamically using rbx to remember its original position, because a
+    /// probe can be reached with the stack in any alignment.
+    static constexpr uint8_t kDispatcherCode[] = {
+#ifdef _WIN64
+        // push r11
+        0x41,
+        0x53,
+
+        // push r10
+        0x41,
+        0x52,
+
+        // push r9
+        0x41,
+        0x51,
+
+        // push r8
+        0x41,
+        0x50,
+
+        // push rdx
+        0x52,
+
+        // push rcx
+        0x51,
+
+        // push rax
+        0x50,
+
+        // pushfq
+        0x9c,
+
+        // lea rax, [rsp+72]
+        0x48,
+        0x8d,
+        0x44,
+        0x24,
+        0x48,
+
+        // push rax
+        0x50,
+
+        // mov rax, QWORD PTR [rsp+72]
+        0x48,
+        0x8b,
+        0x44,
+        0x24,
+        0x48,
+
+        // push QWORD PTR [rax+50]
+        0xff,
+        0x70,
+        0x32,
+
+        // push QWORD PTR [rax+42]
+        0xff,
+        0x70,
+        0x2a,
+
+        // mov rcx, rsp
+        0x48,
+        0x89,
+        0xe1,
+
+        // push rbx
+        0x53,
+
+        // mov rbx, rsp
+        0x48,
+        0x89,
+        0xe3,
+
+        // and rsp, -16
+        0x48,
+        0x83,
+        0xe4,
+        0xf0,
+
+        // sub rsp, 128
+        0x48,
+        0x81,
+        0xec,
+        0x80,
+        0x00,
+        0x00,
+        0x00,
+
+        // movaps XMMWORD PTR [rsp+32], xmm0
+        0x0f,
+        0x29,
+        0x44,
+        0x24,
+        0x20,
+
+        // movaps XMMWORD PTR [rsp+48], xmm1
+        0x0f,
+        0x29,
+        0x4c,
+        0x24,
+        0x30,
+
+        // movaps XMMWORD PTR [rsp+64], xmm2
+        0x0f,
+        0x29,
+        0x54,
+        0x24,
+        0x40,
+
+        // movaps XMMWORD PTR [rsp+80], xmm3
+        0x0f,
+        0x29,
+        0x5c,
+        0x24,
+        0x50,
+
+        // movaps XMMWORD PTR [rsp+96], xmm4
+        0x0f,
+        0x29,
+        0x64,
+        0x24,
+        0x60,
+
+        // movaps XMMWORD PTR [rsp+112], xmm5
+        0x0f,
+        0x29,
+        0x6c,
+        0x24,
+        0x70,
+
+        // call QWORD PTR [rax+34]
+        0xff,
+        0x50,
+        0x22,
+
+        // movaps xmm0, XMMWORD PTR [rsp+32]
+        0x0f,
+        0x28,
+        0x44,
+        0x24,
+        0x20,
+
+        // movaps xmm1, XMMWORD PTR [rsp+48]
+        0x0f,
+        0x28,
+        0x4c,
+        0x24,
+        0x30,
+
+        // movaps xmm2, XMMWORD PTR [rsp+64]
+        0x0f,
+        0x28,
+        0x54,
+        0x24,
+        0x40,
+
+        // movaps xmm3, XMMWORD PTR [rsp+80]
+        0x0f,
+        0x28,
+        0x5c,
+        0x24,
+        0x50,
+
+        // movaps xmm4, XMMWORD PTR [rsp+96]
+        0x0f,
+        0x28,
+        0x64,
+        0x24,
+        0x60,
+
+        // movaps xmm5, XMMWORD PTR [rsp+112]
+        0x0f,
+        0x28,
+        0x6c,
+        0x24,
+        0x70,
+
+        // mov rsp, rbx
+        0x48,
+        0x89,
+        0xdc,
+
+        // pop rbx
+        0x5b,
+
+        // add rsp, 24
+        0x48,
+        0x83,
+        0xc4,
+        0x18,
+
+        // popfq
+        0x9d,
+
+        // pop rax
+        0x58,
+
+        // pop rcx
+        0x59,
+
+        // pop rdx
+        0x5a,
+
+        // pop r8
+        0x41,
+        0x58,
+
+        // pop r9
+        0x41,
+        0x59,
+
+        // pop r10
+        0x41,
+        0x5a,
+
+        // pop r11
+        0x41,
+        0x5b,
+
+        // ret
+        0xc3,
+#else
+        // push edx
+        0x52,
+
+        // push ecx
+        0x51,
+
+        // push eax
+        0x50,
+
+        // pushfd
+        0x9c,
+
+        // lea eax, [esp+20]
+        0x8d,
+        0x44,
+        0x24,
+        0x14,
+
+        // push eax
+        0x50,
+
+        // mov eax, DWORD PTR [esp+20]
+        0x8b,
+        0x44,
+        0x24,
+        0x14,
+
+        // push DWORD PTR [eax+51]
+        0xff,
+        0x70,
+        0x33,
+
+        // push DWORD PTR [eax+43]
+        0xff,
+        0x70,
+        0x2b,
+
+        // mov ecx, esp
+        0x89,
+        0xe1,
+
+        // sub esp, 128
+        0x81,
+        0xec,
+        0x80,
+        0x00,
+        0x00,
+        0x00,
+
+        // movups XMMWORD PTR [esp], xmm0
+        0x0f,
+        0x11,
+        0x04,
+        0x24,
+
+        // movups XMMWORD PTR [esp+16], xmm1
+        0x0f,
+        0x11,
+        0x4c,
+        0x24,
+        0x10,
+
+        // movups XMMWORD PTR [esp+32], xmm2
+        0x0f,
+        0x11,
+        0x54,
+        0x24,
+        0x20,
+
+        // movups XMMWORD PTR [esp+48], xmm3
+        0x0f,
+        0x11,
+        0x5c,
+        0x24,
+        0x30,
+
+        // movups XMMWORD PTR [esp+64], xmm4
+        0x0f,
+        0x11,
+        0x64,
+        0x24,
+        0x40,
+
+        // movups XMMWORD PTR [esp+80], xmm5
+        0x0f,
+        0x11,
+        0x6c,
+        0x24,
+        0x50,
+
+        // movups XMMWORD PTR [esp+96], xmm6
+        0x0f,
+        0x11,
+        0x74,
+        0x24,
+        0x60,
+
+        // movups XMMWORD PTR [esp+112], xmm7
+        0x0f,
+        0x11,
+        0x7c,
+        0x24,
+        0x70,
+
+        // call DWORD PTR [eax+35]
+        0xff,
+        0x50,
+        0x23,
+
+        // movups xmm0, XMMWORD PTR [esp]
+        0x0f,
+        0x10,
+        0x04,
+        0x24,
+
+        // movups xmm1, XMMWORD PTR [esp+16]
+        0x0f,
+        0x10,
+        0x4c,
+        0x24,
+        0x10,
+
+        // movups xmm2, XMMWORD PTR [esp+32]
+        0x0f,
+        0x10,
+        0x54,
+        0x24,
+        0x20,
+
+        // movups xmm3, XMMWORD PTR [esp+48]
+        0x0f,
+        0x10,
+        0x5c,
+        0x24,
+        0x30,
+
+        // movups xmm4, XMMWORD PTR [esp+64]
+        0x0f,
+        0x10,
+        0x64,
+        0x24,
+        0x40,
+
+        // movups xmm5, XMMWORD PTR [esp+80]
+        0x0f,
+        0x10,
+        0x6c,
+        0x24,
+        0x50,
+
+        // movups xmm6, XMMWORD PTR [esp+96]
+        0x0f,
+        0x10,
+        0x74,
+        0x24,
+        0x60,
+
+        // movups xmm7, XMMWORD PTR [esp+112]
+        0x0f,
+        0x10,
+        0x7c,
+        0x24,
+        0x70,
+
+        // add esp, 140
+        0x81,
+        0xc4,
+        0x8c,
+        0x00,
+        0x00,
+        0x00,
+
+        // popfd
+        0x9d,
+
+        // pop eax
+        0x58,
+
+        // pop ecx
+        0x59,
+
+        // pop edx
+        0x5a,
+
+        // ret
+        0xc3,
+#endif
+    };
+
+    // The probe code builds the probe context object by pushing its fields in reverse order and
+    // indexes it using fixed displacements, all of which assume this layout.
+    static_assert(
+        (0 == offsetof(SProbeContext, context)) &&
+            ((1 * sizeof(size_t)) == offsetof(SProbeContext, address)) &&
+            ((2 * sizeof(size_t)) == offsetof(SProbeContext, stackPointer)) &&
+            ((3 * sizeof(size_t)) == offsetof(SProbeContext, flags)) &&
+            ((4 * sizeof(size_t)) == offsetof(SProbeContext, registers)) &&
+            (((4 + kProbeNumRegisters) * sizeof(size_t)) == sizeof(SProbeContext)),
+        "Probe code assumes a different probe context layout.");
+
+    /// Places the probe code into executable memory.
+    /// @return Address of the probe code, or `nullptr` if it could not be placed.
+    static const void* CreateDispatcherCode(void)
+    {
+      uint8_t* const dispatcherCode = reinterpret_cast<uint8_t*>(Protected::Windows_VirtualAlloc(
+          nullptr, sizeof(kDispatcherCode), MEM_RESERVE | MEM_COMMIT, PAGE_READWRITE));
+      if (nullptr == dispatcherCode) return nullptr;
+
+      std::memcpy(dispatcherCode, kDispatcherCode, sizeof(kDispatcherCode));
+
+      DWORD unusedOldProtection = 0;
+      if (0 ==
+          Protected::Windows_VirtualProtect(
+              dispatcherCode, sizeof(kDispatcherCode), PAGE_EXECUTE_READ, &unusedOldProtection))
+      {
+        Protected::Windows_VirtualFree(dispatcherCode, 0, MEM_RELEASE);
+        return nullptr;
+      }
+
+      Protected::Windows_FlushInstructionCache(
+          Infra::ProcessInfo::GetCurrentProcessHandle(), dispatcherCode, sizeof(kDispatcherCode));
+      return dispatcherCode;
+    }
+
+    const void* GetDispatcher(void)
+    {
+      static const void* const dispatcher = []() -> const void*
+      {
+        const void* const dispatcherCode = CreateDispatcherCode();
+        if (nullptr == dispatcherCode)
+        {
+          Infra::Message::Output(
+              Infra::Message::ESeverity::Warning,
+              L"Probes are unavailable because the probe code could not be placed.");
+          return nullptr;
+        }
+
+        return dispatcherCode;
+      }();
+
+      return dispatcher;
+    }
+  } // namespace Probes
+} // namespace Hookshot
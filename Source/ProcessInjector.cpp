@@ -14,12 +14,24 @@
 #include <winnt.h>
 #include <winternl.h>
 
+#include <algorithm>
+#include <chrono>
+#include <condition_variable>
 #include <cstddef>
 #include <cstdint>
 #include <cstdio>
+#include <cstring>
+#include <functional>
+#include <mutex>
 #include <optional>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <unordered_set>
+#include <utility>
 #include <vector>
 
+#include <Infra/Core/Configuration.h>
 #include <Infra/Core/Message.h>
 #include <Infra/Core/ProcessInfo.h>
 #include <Infra/Core/Strings.h>
@@ -28,10 +40,17 @@
 
 #include "ApiWindows.h"
 #include "CodeInjector.h"
+#include "ExportResolver.h"
+#include "Globals.h"
+#include "HookshotConfigReader.h"
 #include "Inject.h"
 #include "InjectResult.h"
+#include "InjectionArena.h"
+#include "InjectorDaemon.h"
 #include "RemoteProcessInjector.h"
 #include "Strings.h"
+#include "Tracing.h"
+#include "Wow64Injector.h"
 
 namespace Hookshot
 {
@@ -40,11 +59,303 @@ namespace Hookshot
     /// System allocation granularity. Captured once and re-used as needed.
     static size_t systemAllocationGranularity = 0;
 
-    /// Advances the specified process' loader progress until it is ready to begin executing.
+    /// Identifies a procedure exported by a specific build of a module loaded at a specific base
+    /// address. Used to cache the results of remote export table parsing.
+    struct SRemoteProcAddressCacheEntry
+    {
+      /// Base address of the module in the address space of the process that loaded it.
+      size_t moduleBaseAddress;
+
+      /// Size of the module's image, from its optional header.
+      DWORD moduleSizeOfImage;
+
+      /// Timestamp of the module's export directory.
+      DWORD moduleExportTimeDateStamp;
+
+      /// Name of the exported procedure.
+      std::string procName;
+
+      /// Relative virtual address of the exported procedure within the module.
+      DWORD procRelativeAddress;
+    };
+
+    /// Enforces serialized access to the remote procedure address cache.
+    static std::mutex remoteProcAddressCacheMutex;
+
+    /// Remote procedure addresses that have already been resolved by parsing export tables. System
+    /// modules are loaded at the same base address in every process of the same architecture for
+    /// the duration of a boot session, and a given injector process only ever injects processes of
+    /// its own architecture, so entries can be re-used across injections.
+    static std::vector<SRemoteProcAddressCacheEntry> remoteProcAddressCache;
+
+    /// Hash function for strings keyed by path, which allows lookups using string views without
+    /// first constructing a string.
+    struct SPathHash
+    {
+      using is_transparent = void;
+
+      inline size_t operator()(std::wstring_view path) const
+      {
+        return std::hash<std::wstring_view>()(path);
+      }
+    };
+
+    /// Map keyed by path that can be searched using string views.
+    template <typename ValueType> using TPathMap =
+        std::unordered_map<std::wstring, ValueType, SPathHash, std::equal_to<>>;
+
+    /// Authorization decisions for executables that reside in a single directory. Both files that
+    /// can grant authorization to inject an executable reside in the same directory as the
+    /// executable itself, so a change notification on that directory is sufficient to detect when
+    /// any of these decisions might no longer be valid.
+    struct SAuthorizationCacheDirectory
+    {
+      /// Change notification handle that is signalled whenever a file in the directory is
+      /// created, deleted, or renamed.
+      HANDLE changeNotificationHandle;
+
+      /// Authorization decisions keyed by full executable path. Each value is the name of the file
+      /// that granted authorization, or empty if authorization was not granted.
+      TPathMap<std::wstring> authorizationFileByExecutablePath;
+    };
+
+    /// Enforces serialized access to the authorization cache.
+    static std::mutex authorizationCacheMutex;
+
+    /// Authorization decisions that have already been made, keyed by the directory that contains
+    /// the executables to which they apply. Allows processes that repeatedly create the same
+    /// executables to be injected without probing the filesystem each time.
+    static TPathMap<SAuthorizationCacheDirectory> authorizationCache;
+
+    /// Files to be read ahead of time on behalf of a single injection, so that they are already in
+    /// memory by the time the injected process loads them.
+    struct SPrefetchItem
+    {
+      /// Whether or not to prefetch the Hookshot library itself.
+      bool prefetchHookshotLibrary;
+
+      /// Directory whose hook modules are to be prefetched, or empty if none are.
+      std::wstring hookModuleDirectory;
+    };
+
+    /// Enforces serialized access to the record of files that have already been prefetched.
+    static std::mutex prefetchMutex;
+
+    /// Whether or not the Hookshot library has already been prefetched.
+    static bool hookshotLibraryPrefetched = false;
+
+    /// Directories whose hook modules have already been prefetched. Each directory is prefetched
+    /// at most once per injecting process, since after that its files are either already in memory
+    /// or were evicted because of memory pressure, in which case reading them again early would not
+    /// help.
+    static std::unordered_set<std::wstring> prefetchedHookModuleDirectories;
+
+    /// Reads memory from another process on behalf of a single injection. Every read is served from
+    /// whole pages that are read from the other process the first time they are needed and kept
+    /// locally afterwards, so the many small reads of headers and other structures needed to inject
+    /// a process only occasionally need a system call. The other process is expected to be
+    /// suspended, so its memory does not change while this object exists. Pages are kept in the
+    /// injection's arena, so reading never allocates from the heap.
+    class RemoteMemoryReader
+    {
+    public:
+
+      /// Maximum number of pages that can be kept locally. Reads that would exceed this limit are
+      /// still served, but without keeping any of the pages they read.
+      static constexpr unsigned int kMaxCachedPages = 256;
+
+      RemoteMemoryReader(const HANDLE processHandle, InjectionArena& arena)
+          : processHandle(processHandle),
+            arena(arena),
+            pageSizeBytes(Infra::SystemInfo::GetPlatformAndArchitectureInfo().dwPageSize),
+            cachedPages(),
+            numCachedPages(0),
+            numBytesRead(0),
+            numReadCalls(0)
+      {}
+
+      RemoteMemoryReader(const RemoteMemoryReader&) = delete;
+
+      /// Retrieves the number of bytes read from the other process so far, including whole pages
+      /// read in order to serve smaller reads.
+      /// @return Number of bytes read.
+      inline size_t GetNumBytesRead(void) const
+      {
+        return numBytesRead;
+      }
+
+      /// Retrieves the number of system calls made so far to read from the other process.
+      /// @return Number of read calls.
+      inline unsigned int GetNumReadCalls(void) const
+      {
+        return numReadCalls;
+      }
+
+      /// Retrieves the handle of the process from which this object reads.
+      /// @return Process handle.
+      inline HANDLE GetProcessHandle(void) const
+      {
+        return processHandle;
+      }
+
+      /// Retrieves the arena of the injection on whose behalf this object reads, from which any
+      /// other buffers needed while reading from the other process can also be obtained.
+      /// @return Injection arena.
+      inline InjectionArena& GetArena(void) const
+      {
+        return arena;
+      }
+
+      /// Reads memory from the other process. Pages not already held locally are read all at once
+      /// using a single system call.
+      /// @param [in] address Address to read, in the address space of the other process.
+      /// @param [out] buffer Buffer to be filled with the data read.
+      /// @param [in] sizeBytes Number of bytes to read.
+      /// @return `true` if all of the requested bytes were read, `false` otherwise.
+      bool Read(const void* const address, void* const buffer, const size_t sizeBytes)
+      {
+        const size_t readBegin = reinterpret_cast<size_t>(address);
+        const size_t readEnd = readBegin + sizeBytes;
+        if (readEnd <= readBegin) return (0 == sizeBytes);
+
+        const size_t pageMask = ~(pageSizeBytes - 1);
+        const size_t firstPage = readBegin & pageMask;
+        const size_t endPage = (readEnd + pageSizeBytes - 1) & pageMask;
+
+        size_t firstMissingPage = endPage;
+        size_t endMissingPage = firstPage;
+        size_t numMissingPages = 0;
+        for (size_t page = firstPage; page < endPage; page += pageSizeBytes)
+        {
+          if (nullptr != FindCachedPage(page)) continue;
+
+          firstMissingPage = std::min(firstMissingPage, page);
+          endMissingPage = page + pageSizeBytes;
+          numMissingPages += 1;
+        }
+
+        if (firstMissingPage < endMissingPage)
+        {
+          uint8_t* const missingPages = (numMissingPages <= (kMaxCachedPages - numCachedPages))
+              ? arena.AllocateArray<uint8_t>(endMissingPage - firstMissingPage)
+              : nullptr;
+
+          // The requested range might be readable even if some of the pages around it are not,
+          // and it can always be read even if there is no room to keep the pages around it. In
+          // either case it is read as-is without keeping anything.
+          if ((nullptr == missingPages) ||
+              (false ==
+               ReadDirect(
+                   reinterpret_cast<const void*>(firstMissingPage),
+                   missingPages,
+                   endMissingPage - firstMissingPage)))
+            return ReadDirect(address, buffer, sizeBytes);
+
+          for (size_t page = firstMissingPage; page < endMissingPage; page += pageSizeBytes)
+          {
+            if (nullptr != FindCachedPage(page)) continue;
+
+            cachedPages[numCachedPages] = {
+                .address = page, .data = &missingPages[page - firstMissingPage]};
+            numCachedPages += 1;
+          }
+        }
+
+        uint8_t* const bufferBytes = reinterpret_cast<uint8_t*>(buffer);
+        for (size_t page = firstPage; page < endPage; page += pageSizeBytes)
+        {
+          const size_t copyBegin = std::max(page, readBegin);
+          const size_t copyEnd = std::min(page + pageSizeBytes, readEnd);
+          std::memcpy(
+              &bufferBytes[copyBegin - readBegin],
+              &FindCachedPage(page)[copyBegin - page],
+              copyEnd - copyBegin);
+        }
+
+        return true;
+      }
+
+    private:
+
+      /// Page read from the other process and kept locally.
+      struct SCachedPage
+      {
+        /// Base address of the page in the address space of the other process.
+        size_t address;
+
+        /// Contents of the page, which reside in the injection's arena.
+        const uint8_t* data;
+      };
+
+      /// Locates a page that is already held locally.
+      /// @param [in] pageAddress Base address of the page in the address space of the other
+      /// process.
+      /// @return Contents of the page, or `nullptr` if it is not held locally.
+      const uint8_t* FindCachedPage(const size_t pageAddress) const
+      {
+        for (unsigned int i = 0; i < numCachedPages; ++i)
+        {
+          if (pageAddress == cachedPages[i].address) return cachedPages[i].data;
+        }
+
+        return nullptr;
+      }
+
+      /// Reads memory from the other process using a system call, without involving any locally
+      /// held pages.
+      /// @param [in] address Address to read, in the address space of the other process.
+      /// @param [out] buffer Buffer to be filled with the data read.
+      /// @param [in] sizeBytes Number of bytes to read.
+      /// @return `true` if all of the requested bytes were read, `false` otherwise.
+      bool ReadDirect(const void* const address, void* const buffer, const size_t sizeBytes)
+      {
+        SIZE_T numBytesReadThisCall = 0;
+        const BOOL readResult =
+            ReadProcessMemory(processHandle, address, buffer, sizeBytes, &numBytesReadThisCall);
+
+        numBytesRead += static_cast<size_t>(numBytesReadThisCall);
+        numReadCalls += 1;
+
+        return ((FALSE != readResult) && (sizeBytes == numBytesReadThisCall));
+      }
+
+      /// Handle of the process from which to read.
+      HANDLE processHandle;
+
+      /// Arena from which storage for pages is obtained.
+      InjectionArena& arena;
+
+      /// Size of a page of memory, in bytes. Pages are the unit in which memory is read and kept.
+      size_t pageSizeBytes;
+
+      /// Pages already read from the other process, in the order in which they were read. Only the
+      /// first #numCachedPages elements are valid.
+      SCachedPage cachedPages[kMaxCachedPages];
+
+      /// Number of pages already read from the other process and kept locally.
+      unsigned int numCachedPages;
+
+      /// Total number of bytes read from the other process.
+      size_t numBytesRead;
+
+      /// Total number of system calls made to read from the other process.
+      unsigned int numReadCalls;
+    };
+
+    /// Maximum amount of time, in milliseconds, to wait for the loader to initialize a process.
+    static constexpr DWORD kAdvanceProcessTimeoutMilliseconds = 10000;
+
+    /// Attempts to retrieve the handle for the `ntdll.dll` module which should be loaded in this
+    /// process and all created processes, even if suspended.
+    /// @return Handle of `ntdll.dll`, or `nullptr` in the event of a failure to locate it.
+    static HMODULE GetNtDllModule(void);
+
+    /// Advances the specified process' loader progress using the debugging interface. Used as a
+    /// fallback if a loader thread cannot be created.
     /// It is assumed and required that the specified process be newly-created and suspended.
     /// @param [in] processHandle Handle to the process to be advanced.
     /// @return Indicator of the result of the oepration.
-    static EInjectResult AdvanceProcess(const HANDLE processHandle)
+    static EInjectResult AdvanceProcessUsingDebugger(const HANDLE processHandle)
     {
       // This function attaches to the specified process as if debugging it and waits for it to
       // trigger the breakpoint that indicates the initial load process has completed. Windows will
@@ -70,8 +381,58 @@ namespace Hookshot
       return EInjectResult::Success;
     }
 
+    /// Retrieves the address of a thread start routine that immediately exits the thread. Because
+    /// `ntdll.dll` is mapped at the same address in every process of the same architecture, the
+    /// address is the same in any other process as it is here.
+    /// @return Address of the thread start routine, or `nullptr` if it could not be located.
+    static LPTHREAD_START_ROUTINE GetExitThreadStartRoutine(void)
+    {
+      static const LPTHREAD_START_ROUTINE exitThreadStartRoutine =
+          ((nullptr == GetNtDllModule())
+               ? nullptr
+               : reinterpret_cast<LPTHREAD_START_ROUTINE>(
+                     GetProcAddress(GetNtDllModule(), "RtlExitUserThread")));
+
+      return exitThreadStartRoutine;
+    }
+
+    /// Advances the specified process' loader progress until it is ready to begin executing.
+    /// It is assumed and required that the specified process be newly-created and suspended.
+    /// @param [in] processHandle Handle to the process to be advanced.
+    /// @return Indicator of the result of the oepration.
+    static EInjectResult AdvanceProcess(const HANDLE processHandle)
+    {
+      // The first thread to run in a new process initializes it, which includes loading all of the
+      // modules the executable needs, before executing its own start routine. Creating a
+      // short-lived thread whose start routine immediately exits therefore has the same effect as
+      // attaching a debugger and waiting for the initial breakpoint, but without the cost of the
+      // debugging interface. The main thread is unaffected and remains suspended.
+      const LPTHREAD_START_ROUTINE loaderThreadStartRoutine = GetExitThreadStartRoutine();
+
+      const HANDLE loaderThread = (nullptr == loaderThreadStartRoutine)
+          ? nullptr
+          : CreateRemoteThread(
+                processHandle, nullptr, 0, loaderThreadStartRoutine, nullptr, 0, nullptr);
+      if (nullptr == loaderThread)
+      {
+        Infra::Message::OutputFormatted(
+            Infra::Message::ESeverity::Warning,
+            L"Failed to create a loader thread (%s). Falling back to the debugging interface.",
+            Infra::Strings::FromSystemErrorCode(GetLastError()).AsCString());
+        return AdvanceProcessUsingDebugger(processHandle);
+      }
+
+      const DWORD waitResult =
+          WaitForSingleObject(loaderThread, kAdvanceProcessTimeoutMilliseconds);
+      CloseHandle(loaderThread);
+
+      if (WAIT_OBJECT_0 != waitResult) return EInjectResult::ErrorAdvanceProcessFailed;
+
+      return EInjectResult::Success;
+    }
+
     /// Attempts to read NT optional headers from a loaded module in a different process.
-    /// @param [in] processHandle Handle to the process that contains the module for which NT
+    /// @param [in] remoteMemory Reader for the process that contains the module for which NT
     /// optional headers are desired.
     /// @param [in] baseAddress Base image address of the loaded module, in the address space of the
     /// specified process, for which NT optional headers are desired.
@@ -79,43 +440,33 @@ namespace Hookshot
     /// operation is successful.
     /// @return Indicator of the result of the operation.
     static EInjectResult FillNtOptionalHeader(
-        const HANDLE processHandle,
+        RemoteMemoryReader& remoteMemory,
         const void* const baseAddress,
         IMAGE_OPTIONAL_HEADER* optionalHeader)
     {
-      size_t numBytesRead = 0;
       decltype(IMAGE_DOS_HEADER::e_lfanew) ntHeadersOffset = 0;
 
-      if ((FALSE ==
-           ReadProcessMemory(
-               processHandle,
-               reinterpret_cast<LPCVOID>(
-                   reinterpret_cast<size_t>(baseAddress) +
-                   static_cast<size_t>(offsetof(IMAGE_DOS_HEADER, e_lfanew))),
-               reinterpret_cast<LPVOID>(&ntHeadersOffset),
-               sizeof(ntHeadersOffset),
-               reinterpret_cast<SIZE_T*>(&numBytesRead))) ||
-          (sizeof(ntHeadersOffset) != numBytesRead))
+      if (false ==
+          remoteMemory.Read(
+              reinterpret_cast<LPCVOID>(
+                  reinterpret_cast<size_t>(baseAddress) +
+                  static_cast<size_t>(offsetof(IMAGE_DOS_HEADER, e_lfanew))),
+              &ntHeadersOffset,
+              sizeof(ntHeadersOffset)))
         return EInjectResult::ErrorReadDOSHeadersFailed;
 
-      if ((FALSE ==
-           ReadProcessMemory(
-               processHandle,
-               reinterpret_cast<LPCVOID>(
-                   reinterpret_cast<size_t>(baseAddress) + static_cast<size_t>(ntHeadersOffset) +
-                   static_cast<size_t>(offsetof(IMAGE_NT_HEADERS, OptionalHeader))),
-               reinterpret_cast<LPVOID>(optionalHeader),
-               sizeof(IMAGE_OPTIONAL_HEADER),
-               reinterpret_cast<SIZE_T*>(&numBytesRead))) ||
-          (sizeof(IMAGE_OPTIONAL_HEADER) != numBytesRead))
+      if (false ==
+          remoteMemory.Read(
+              reinterpret_cast<LPCVOID>(
+                  reinterpret_cast<size_t>(baseAddress) + static_cast<size_t>(ntHeadersOffset) +
+                  static_cast<size_t>(offsetof(IMAGE_NT_HEADERS, OptionalHeader))),
+              optionalHeader,
+              sizeof(IMAGE_OPTIONAL_HEADER)))
         return EInjectResult::ErrorReadNTHeadersFailed;
 
       return EInjectResult::Success;
     }
 
-    /// Attempts to retrieve the handle for the `ntdll.dll` module which should be loaded in this
-    /// process and all created processes, even if suspended.
-    /// @return Handle of `ntdll.dll`, or `nullptr` in the event of a failure to locate it.
     static HMODULE GetNtDllModule(void)
     {
       static const HMODULE ntdllModuleHandle =
@@ -165,98 +516,114 @@ namespace Hookshot
 
     /// Retrieves a pointer to an exported procedure in another process.
     /// Similar to `GetProcAddress` but not limited to the currently running process.
-    /// The returned pointer is in the address space of the other process.
-    /// @param [in] processHandle Handle to the process for which a procedure pointer is requested.
+    /// The returned pointer is in the address space of the other process. Results are cached, keyed
+    /// by module base address and build, so that repeated lookups only need to read the module's
+    /// headers rather than its entire export table.
+    /// @param [in] remoteMemory Reader for the process for which a procedure pointer is requested.
     /// @param [in] moduleHandle Handle to the module, which must be loaded in the specified
     /// process, that is to be searched for an exported procedure.
     /// @param [in] procName Name of the exported procedure for which a pointer is requested.
     /// @return Handle of the specified module in the specified process, or `nullptr` if the
     /// operation failed.
     static FARPROC GetRemoteProcAddress(
-        HANDLE processHandle, HMODULE moduleHandle, std::string_view procName)
+        RemoteMemoryReader& remoteMemory, HMODULE moduleHandle, std::string_view procName)
     {
       size_t moduleExportTableRelativeBaseAddress = 0;
-      std::vector<uint8_t> moduleExportTable;
+      uint8_t* moduleExportTable = nullptr;
+      IMAGE_OPTIONAL_HEADER optionalHeader;
+      IMAGE_EXPORT_DIRECTORY moduleExportDirectoryHeader;
 
       do
       {
-        IMAGE_OPTIONAL_HEADER optionalHeader;
         EInjectResult operationResult =
-            FillNtOptionalHeader(processHandle, moduleHandle, &optionalHeader);
+            FillNtOptionalHeader(remoteMemory, moduleHandle, &optionalHeader);
         if (EInjectResult::Success != operationResult) return nullptr;
 
+        // Reading just the export directory is enough to identify the module build, which in turn
+        // allows previously-resolved procedures to be served from the cache.
+        if ((optionalHeader.DataDirectory[0].Size < sizeof(moduleExportDirectoryHeader)) ||
+            (false ==
+             remoteMemory.Read(
+                 reinterpret_cast<LPCVOID>(
+                     reinterpret_cast<size_t>(moduleHandle) +
+                     static_cast<size_t>(optionalHeader.DataDirectory[0].VirtualAddress)),
+                 &moduleExportDirectoryHeader,
+                 sizeof(moduleExportDirectoryHeader))))
+          return nullptr;
+
+        std::unique_lock<std::mutex> lock(remoteProcAddressCacheMutex);
+        for (const auto& cacheEntry : remoteProcAddressCache)
+        {
+          if ((reinterpret_cast<size_t>(moduleHandle) == cacheEntry.moduleBaseAddress) &&
+              (optionalHeader.SizeOfImage == cacheEntry.moduleSizeOfImage) &&
+              (moduleExportDirectoryHeader.TimeDateStamp == cacheEntry.moduleExportTimeDateStamp) &&
+              (procName == cacheEntry.procName))
+            return reinterpret_cast<FARPROC>(
+                reinterpret_cast<size_t>(moduleHandle) +
+                static_cast<size_t>(cacheEntry.procRelativeAddress));
+        }
+      }
+      while (false);
+
+      do
+      {
         // Index 0 in the data directory table contains export table information.
         // See
         // https://learn.microsoft.com/en-us/windows/win32/debug/pe-format#optional-header-data-directories-image-only
         // for more information. Read the entire export address table, including all function names
-        // and pointers, into a vector. Keeping the relative base address allows relative virtual
-        // addresses in the export table directory to be converted to vector byte indices.
+        // and pointers, into a buffer. Keeping the relative base address allows relative virtual
+        // addresses in the export table directory to be converted to buffer byte indices.
 
         moduleExportTableRelativeBaseAddress = optionalHeader.DataDirectory[0].VirtualAddress;
-        moduleExportTable = std::vector<uint8_t>(optionalHeader.DataDirectory[0].Size, 0);
+        moduleExportTable =
+            remoteMemory.GetArena().AllocateArray<uint8_t>(optionalHeader.DataDirectory[0].Size);
+        if (nullptr == moduleExportTable)
+        {
+          SetLastError(ERROR_NOT_ENOUGH_MEMORY);
+          return nullptr;
+        }
 
-        size_t numBytesRead = 0;
-        if ((FALSE ==
-             ReadProcessMemory(
-                 processHandle,
-                 reinterpret_cast<LPCVOID>(
-                     reinterpret_cast<size_t>(moduleHandle) + moduleExportTableRelativeBaseAddress),
-                 reinterpret_cast<LPVOID>(moduleExportTable.data()),
-                 static_cast<SIZE_T>(moduleExportTable.size()),
-                 reinterpret_cast<SIZE_T*>(&numBytesRead))) ||
-            (moduleExportTable.size() != numBytesRead))
+        if (false ==
+            remoteMemory.Read(
+                reinterpret_cast<LPCVOID>(
+                    reinterpret_cast<size_t>(moduleHandle) + moduleExportTableRelativeBaseAddress),
+                moduleExportTable,
+                optionalHeader.DataDirectory[0].Size))
           return nullptr;
       }
       while (false);
 
-      // The entire export address table is stored in a vector, and the very beginning of it is a
-      // directory. From the directory we obtain pointers to three arrays: (1) An array of export
-      // function names (each element being a 4-byte relative virtual address of the beginning of
-      // the name string) (2) An array of name ordinals (each element being a 2-byte index into the
-      // array below) (3) An array of export function relative virtual addresses (each element being
-      // a 4-byte relative virtual address of the starting location of the function)
-      const IMAGE_EXPORT_DIRECTORY* moduleExportDirectory =
-          reinterpret_cast<const IMAGE_EXPORT_DIRECTORY*>(moduleExportTable.data());
-      const DWORD* exportFunctionNameArray = reinterpret_cast<DWORD*>(
-          reinterpret_cast<size_t>(moduleExportTable.data()) +
-          static_cast<size_t>(moduleExportDirectory->AddressOfNames) -
-          moduleExportTableRelativeBaseAddress);
-      const WORD* exportFunctionNameOrdinalArray = reinterpret_cast<WORD*>(
-          reinterpret_cast<size_t>(moduleExportTable.data()) +
-          static_cast<size_t>(moduleExportDirectory->AddressOfNameOrdinals) -
-          moduleExportTableRelativeBaseAddress);
-      const DWORD* exportFunctionAddressArray = reinterpret_cast<DWORD*>(
-          reinterpret_cast<size_t>(moduleExportTable.data()) +
-          static_cast<size_t>(moduleExportDirectory->AddressOfFunctions) -
-          moduleExportTableRelativeBaseAddress);
-
-      // For each name, we need to compare it with the requested procedure name.
-      // If it is a match, its index in the array of function names is used as an index into the
-      // ordinal array, which in turn gives an index into the function address array.
-      std::optional<WORD> requestedProcOrdinal = std::nullopt;
-
-      for (unsigned int procIndex = 0; (procIndex < moduleExportDirectory->NumberOfNames) &&
-           (false == requestedProcOrdinal.has_value());
-           ++procIndex)
-      {
-        std::string_view exportFunctionName = reinterpret_cast<const char*>(
-            reinterpret_cast<size_t>(moduleExportTable.data()) +
-            static_cast<size_t>(exportFunctionNameArray[procIndex]) -
-            moduleExportTableRelativeBaseAddress);
-
-        if (exportFunctionName == procName)
-          requestedProcOrdinal = exportFunctionNameOrdinalArray[procIndex];
-      }
-
-      if (false == requestedProcOrdinal.has_value())
+      // Only the export table was read, so the view covers exactly the export directory.
+      const DWORD moduleExportTableRelativeAddress =
+          static_cast<DWORD>(moduleExportTableRelativeBaseAddress);
+      const ExportResolver::SExportTableView exportTableView = {
+          .data = moduleExportTable,
+          .dataRelativeAddress = moduleExportTableRelativeAddress,
+          .dataSize = optionalHeader.DataDirectory[0].Size,
+          .exportDirectoryRelativeAddress = moduleExportTableRelativeAddress,
+          .exportDirectorySize = optionalHeader.DataDirectory[0].Size};
+
+      DWORD procRelativeAddress = 0;
+      if (1 != ExportResolver::ResolveExports(exportTableView, &procName, 1, &procRelativeAddress))
       {
         SetLastError(ERROR_PROC_NOT_FOUND);
         return nullptr;
       }
 
+      do
+      {
+        std::unique_lock<std::mutex> lock(remoteProcAddressCacheMutex);
+        remoteProcAddressCache.push_back(
+            {.moduleBaseAddress = reinterpret_cast<size_t>(moduleHandle),
+             .moduleSizeOfImage = optionalHeader.SizeOfImage,
+             .moduleExportTimeDateStamp = moduleExportDirectoryHeader.TimeDateStamp,
+             .procName = std::string(procName),
+             .procRelativeAddress = procRelativeAddress});
+      }
+      while (false);
+
       return reinterpret_cast<FARPROC>(
-          reinterpret_cast<size_t>(moduleHandle) +
-          static_cast<size_t>(exportFunctionAddressArray[requestedProcOrdinal.value()]));
+          reinterpret_cast<size_t>(moduleHandle) + static_cast<size_t>(procRelativeAddress));
     }
 
     /// Attempts to determine the address of the entry point of the given process by locating the
@@ -266,19 +633,18 @@ namespace Hookshot
     /// entry point contained in the process' own header. See
     /// https://learn.microsoft.com/en-us/dotnet/framework/unmanaged-api/hosting/corexemain-function
     /// for more information.
-    /// @param [in] processHandle Handle to the process for which information is requested.
-    /// @param [in] processEnvironmentBlock Read-only reference to the process environment block
-    /// which has already been read from the process of interest.
+    /// @param [in] remoteMemory Reader for the process for which information is requested.
     /// @param [out] entryPoint Address of the pointer that receives the entry point address.
     /// @return Indicator of the result of the operation.
     static EInjectResult GetClrEntryPointAddress(
-        const HANDLE processHandle, void** const entryPoint)
+        RemoteMemoryReader& remoteMemory, void** const entryPoint)
     {
-      const HMODULE clrModuleHandle = GetRemoteModuleHandle(processHandle, L"mscoree.dll");
+      const HMODULE clrModuleHandle =
+          GetRemoteModuleHandle(remoteMemory.GetProcessHandle(), L"mscoree.dll");
       if (nullptr == clrModuleHandle) return EInjectResult::ErrorGetModuleHandleClrLibraryFailed;
 
       void* clrEntryPoint = reinterpret_cast<void*>(
-          GetRemoteProcAddress(processHandle, clrModuleHandle, "_CorExeMain"));
+          GetRemoteProcAddress(remoteMemory, clrModuleHandle, "_CorExeMain"));
       if (nullptr == clrEntryPoint) return EInjectResult::ErrorGetProcAddressClrEntryPointFailed;
 
       *entryPoint = clrEntryPoint;
@@ -287,16 +653,16 @@ namespace Hookshot
 
     /// Attempts to determine the address of the entry point of the given process.
     /// All addresses used by this method are in the virtual address space of the target process.
-    /// @param [in] processHandle Handle to the process for which information is requested.
+    /// @param [in] remoteMemory Reader for the process for which information is requested.
     /// @param [in] baseAddress Base address of the process' executable image.
     /// @param [out] entryPoint Address of the pointer that receives the entry point address.
     /// @return Indicator of the result of the operation.
     static EInjectResult GetProcessEntryPointAddress(
-        const HANDLE processHandle, const void* const baseAddress, void** const entryPoint)
+        RemoteMemoryReader& remoteMemory, const void* const baseAddress, void** const entryPoint)
     {
       IMAGE_OPTIONAL_HEADER optionalHeader;
       EInjectResult operationResult =
-          FillNtOptionalHeader(processHandle, baseAddress, &optionalHeader);
+          FillNtOptionalHeader(remoteMemory, baseAddress, &optionalHeader);
       if (EInjectResult::Success != operationResult) return operationResult;
 
       // Index 14 in the data directory table contains CLR metadata.
@@ -309,7 +675,7 @@ namespace Hookshot
         Infra::Message::Output(
             Infra::Message::ESeverity::Info,
             L"Process appears to be managed by the CLR. Using the CLR library's entry point address.");
-        return GetClrEntryPointAddress(processHandle, entryPoint);
+        return GetClrEntryPointAddress(remoteMemory, entryPoint);
       }
       else
       {
@@ -324,12 +690,12 @@ namespace Hookshot
     }
 
     /// Attempts to read the process environment block from the specified process.
-    /// @param [in] processHandle Handle to the process for which information is requested.
+    /// @param [in] remoteMemory Reader for the process for which information is requested.
     /// @param [out] processEnvironmentBlock Pointer to a buffer to be filled with the contents of
     /// the process environment block from the requested process.
     /// @return Indicator of the result of the operation.
     static EInjectResult GetProcessEnvironmentBlock(
-        const HANDLE processHandle, PEB* processEnvironmentBlock)
+        RemoteMemoryReader& remoteMemory, PEB* processEnvironmentBlock)
     {
       // This function uses the documented, but internal, Windows API function
       // NtQueryInformationProcess. See
@@ -355,7 +721,7 @@ namespace Hookshot
 
       if (0 !=
           ntdllQueryInformationProcessProc(
-              processHandle,
+              remoteMemory.GetProcessHandle(),
               ProcessBasicInformation,
               &processBasicInfo,
               sizeof(processBasicInfo),
@@ -363,15 +729,8 @@ namespace Hookshot
         return EInjectResult::ErrorNtQueryInformationProcessFailed;
 
       // Read the entire PEB from the process' address space.
-      size_t numBytesRead = 0;
-      if ((FALSE ==
-           ReadProcessMemory(
-               processHandle,
-               reinterpret_cast<LPCVOID>(processBasicInfo.PebBaseAddress),
-               reinterpret_cast<LPVOID>(processEnvironmentBlock),
-               sizeof(PEB),
-               reinterpret_cast<SIZE_T*>(&numBytesRead))) ||
-          (sizeof(PEB) != numBytesRead))
+      if (false ==
+          remoteMemory.Read(processBasicInfo.PebBaseAddress, processEnvironmentBlock, sizeof(PEB)))
         return EInjectResult::ErrorReadProcessPEBFailed;
 
       return EInjectResult::Success;
@@ -404,6 +763,291 @@ namespace Hookshot
       return EInjectResult::Success;
     }
 
+    /// Allocates contiguous code and data regions in the specified process for injected code to
+    /// use. Code comes first, then data. Both are initially writable so that they can be filled
+    /// with a single write, after which the code region is made executable.
+    /// @param [in] processHandle Handle to the process in which to allocate.
+    /// @param [in] regionSize Size of each region, in bytes.
+    /// @param [out] codeBase Filled with the base address of the code region.
+    /// @param [out] dataBase Filled with the base address of the data region.
+    /// @return Indicator of the result of the operation.
+    static EInjectResult AllocateInjectRegions(
+        const HANDLE processHandle, const size_t regionSize, void** codeBase, void** dataBase)
+    {
+      // Both regions start out writable. The code region is made executable once the injected
+      // code has been written into it.
+      void* const injectedCodeBase = VirtualAllocEx(
+          processHandle,
+          nullptr,
+          (static_cast<SIZE_T>(regionSize) * 2),
+          MEM_RESERVE | MEM_COMMIT,
+          PAGE_READWRITE);
+      if (nullptr == injectedCodeBase) return EInjectResult::ErrorVirtualAllocFailed;
+
+      void* const injectedDataBase =
+          reinterpret_cast<void*>(reinterpret_cast<size_t>(injectedCodeBase) + regionSize);
+
+      *codeBase = injectedCodeBase;
+      *dataBase = injectedDataBase;
+      return EInjectResult::Success;
+    }
+
+    /// Maps code and data regions into the specified process for injected code to use, as a view of
+    /// the section shared by all injected processes. Code comes first, then data. Physical pages
+    /// that hold the code region are shared with every other injected process, and pages in the
+    /// data region are copied privately into the specified process the first time each is written.
+    /// @param [in] processHandle Handle to the process in which to map.
+    /// @param [in] regionSize Size of each region, in bytes.
+    /// @param [out] codeBase Filled with the base address of the code region.
+    /// @param [out] dataBase Filled with the base address of the data region.
+    /// @return Indicator of the result of the operation.
+    static EInjectResult MapSharedInjectRegions(
+        const HANDLE processHandle, const size_t regionSize, void** codeBase, void** dataBase)
+    {
+      // Value of the `SECTION_INHERIT` enumerator that prevents the view from being inherited.
+      static constexpr DWORD kSectionInheritViewUnmap = 2;
+
+      using TNtMapViewOfSection = NTSTATUS(NTAPI*)(
+          HANDLE SectionHandle,
+          HANDLE ProcessHandle,
+          PVOID* BaseAddress,
+          ULONG_PTR ZeroBits,
+          SIZE_T CommitSize,
+          PLARGE_INTEGER SectionOffset,
+          PSIZE_T ViewSize,
+          DWORD InheritDisposition,
+          ULONG AllocationType,
+          ULONG Win32Protect);
+
+      static const TNtMapViewOfSection ntdllMapViewOfSectionProc =
+          ((nullptr == GetNtDllModule())
+               ? nullptr
+               : reinterpret_cast<TNtMapViewOfSection>(
+                     GetProcAddress(GetNtDllModule(), "NtMapViewOfSection")));
+      if (nullptr == ntdllMapViewOfSectionProc) return EInjectResult::ErrorVirtualAllocFailed;
+
+      const HANDLE sharedCodeSection = CodeInjector::GetSharedCodeSection(regionSize, regionSize);
+      if (nullptr == sharedCodeSection) return EInjectResult::ErrorVirtualAllocFailed;
+
+      void* injectedCodeBase = nullptr;
+      SIZE_T viewSize = 0;
+      if (0 !=
+          ntdllMapViewOfSectionProc(
+              sharedCodeSection,
+              processHandle,
+              &injectedCodeBase,
+              0,
+              0,
+              nullptr,
+              &viewSize,
+              kSectionInheritViewUnmap,
+              0,
+              PAGE_EXECUTE_WRITECOPY))
+        return EInjectResult::ErrorVirtualAllocFailed;
+
+      *codeBase = injectedCodeBase;
+      *dataBase =
+          reinterpret_cast<void*>(reinterpret_cast<size_t>(injectedCodeBase) + regionSize);
+      return EInjectResult::Success;
+    }
+
+    /// Retrieves the configuration data. The executable does not maintain the configuration data
+    /// that the library does, so when building it the configuration file is read directly, once,
+    /// on first use.
+    /// @return Configuration data, which is empty if the configuration file contains errors.
+    static const Infra::Configuration::ConfigurationData& GetConfigurationData(void)
+    {
+#ifdef HOOKSHOT_SKIP_CONFIG
+      static const Infra::Configuration::ConfigurationData configData = []()
+      {
+        HookshotConfigReader configReader;
+        Infra::Configuration::ConfigurationData readConfigData =
+            configReader.ReadConfigurationFile();
+
+        if (true == configReader.HasErrorMessages())
+          return Infra::Configuration::ConfigurationData();
+
+        return readConfigData;
+      }();
+
+      return configData;
+#else
+      return Globals::GetConfigurationData();
+#endif
+    }
+
+    /// Retrieves the value of a Boolean setting from the global section of the configuration
+    /// file.
+    /// @param [in] settingName Name of the setting to retrieve.
+    /// @return Configured value of the setting, or `false` if it is absent or the configuration
+    /// file contains errors.
+    static bool GetGlobalConfigurationFlag(std::wstring_view settingName)
+    {
+      const Infra::Configuration::ConfigurationData& configData = GetConfigurationData();
+      return configData[Infra::Configuration::kSectionNameGlobal][settingName].ValueOr(false);
+    }
+
+    /// Retrieves the performance profile that applies to the injection settings, resolving it on
+    /// first use.
+    /// @return Resolved performance profile.
+    static const SPerformanceProfile& GetPerformanceProfile(void)
+    {
+      static const SPerformanceProfile performanceProfile =
+          HookshotConfigReader::ReadPerformanceProfile(GetConfigurationData());
+
+      return performanceProfile;
+    }
+
+    /// Determines whether or not the injected code should be mapped into injected processes from a
+    /// section shared by all of them, as configured.
+    /// @return `true` if so, `false` otherwise.
+    static bool ShouldShareInjectedCode(void)
+    {
+      static const bool shareInjectedCode = GetPerformanceProfile().shareInjectedCode;
+
+      return shareInjectedCode;
+    }
+
+    /// Determines whether or not the injected code should run as an asynchronous procedure call on
+    /// the main thread of each injected process, as configured.
+    /// @return `true` if so, `false` otherwise.
+    static bool ShouldInjectUsingApc(void)
+    {
+      static const bool injectUsingApc = GetPerformanceProfile().injectUsingApc;
+
+      return injectUsingApc;
+    }
+
+    /// Computes the size of each of the code and data regions that are placed into a process to be
+    /// injected.
+    /// @return Size of each region, in bytes.
+    static size_t GetInjectRegionSize(void)
+    {
+      const size_t allocationGranularity =
+          Infra::SystemInfo::GetPlatformAndArchitectureInfo().dwPageSize;
+
+      return ((InjectInfo::kMaxInjectBinaryFileSize < allocationGranularity)
+                  ? allocationGranularity
+                  : InjectInfo::kMaxInjectBinaryFileSize);
+    }
+
+    /// Places code and data regions into the specified process for injected code to use, preferably
+    /// by mapping them from the shared section if so configured and otherwise by allocating them.
+    /// @param [in] processHandle Handle to the process in which to place the regions.
+    /// @param [in] regionSize Size of each region, in bytes.
+    /// @param [out] codeBase Filled with the base address of the code region.
+    /// @param [out] dataBase Filled with the base address of the data region.
+    /// @param [out] regionsShared Filled with `true` if the regions were mapped from the shared
+    /// section, `false` if they were allocated.
+    /// @return Indicator of the result of the operation.
+    static EInjectResult PlaceInjectRegions(
+        const HANDLE processHandle,
+        const size_t regionSize,
+        void** codeBase,
+        void** dataBase,
+        bool* regionsShared)
+    {
+      *regionsShared = false;
+
+      if (true == ShouldShareInjectedCode())
+      {
+        if (EInjectResult::Success ==
+            MapSharedInjectRegions(processHandle, regionSize, codeBase, dataBase))
+        {
+          *regionsShared = true;
+          return EInjectResult::Success;
+        }
+
+        Infra::Message::Output(
+            Infra::Message::ESeverity::Warning,
+            L"Failed to map shared injected code. Falling back to allocating it.");
+      }
+
+      return AllocateInjectRegions(processHandle, regionSize, codeBase, dataBase);
+    }
+
+    /// Extracts the directory portion of an executable path, without a trailing backslash.
+    /// @param [in] executablePath Full path of the executable.
+    /// @return Directory that contains the executable, or an empty string if it cannot be
+    /// determined.
+    static std::wstring_view ExecutableDirectory(std::wstring_view executablePath)
+    {
+      const size_t lastBackslashPos = executablePath.find_last_of(L"\\");
+      if (std::wstring_view::npos == lastBackslashPos) return std::wstring_view();
+
+      return executablePath.substr(0, lastBackslashPos);
+    }
+
+    /// Looks up a previously-made authorization decision for the specified executable. Decisions
+    /// for all executables in a directory are discarded whenever a file in that directory is
+    /// created, deleted, or renamed. If no decision is available, the directory is watched for
+    /// changes from this point forward, so that a decision subsequently made by probing the
+    /// filesystem can safely be cached.
+    /// @param [in] executablePath Full path of the executable.
+    /// @param [out] authorizationFile Filled with the name of the file that granted authorization,
+    /// or cleared if authorization was not granted. Only filled if a decision was found.
+    /// @return `true` if a cached decision was found, `false` otherwise.
+    static bool LookupCachedAuthorization(
+        std::wstring_view executablePath, Infra::TemporaryString& authorizationFile)
+    {
+      const std::wstring_view executableDirectory = ExecutableDirectory(executablePath);
+      if (true == executableDirectory.empty()) return false;
+
+      std::unique_lock<std::mutex> lock(authorizationCacheMutex);
+
+      auto directoryIter = authorizationCache.find(executableDirectory);
+      if (authorizationCache.end() == directoryIter)
+      {
+        const HANDLE changeNotificationHandle = FindFirstChangeNotification(
+            std::wstring(executableDirectory).c_str(), FALSE, FILE_NOTIFY_CHANGE_FILE_NAME);
+        if (INVALID_HANDLE_VALUE == changeNotificationHandle) return false;
+
+        authorizationCache.emplace(
+            std::wstring(executableDirectory),
+            SAuthorizationCacheDirectory{.changeNotificationHandle = changeNotificationHandle});
+        return false;
+      }
+
+      SAuthorizationCacheDirectory& cacheDirectory = directoryIter->second;
+      if (WAIT_OBJECT_0 == WaitForSingleObject(cacheDirectory.changeNotificationHandle, 0))
+      {
+        cacheDirectory.authorizationFileByExecutablePath.clear();
+        if (FALSE == FindNextChangeNotification(cacheDirectory.changeNotificationHandle))
+        {
+          FindCloseChangeNotification(cacheDirectory.changeNotificationHandle);
+          authorizationCache.erase(directoryIter);
+        }
+        return false;
+      }
+
+      auto executableIter = cacheDirectory.authorizationFileByExecutablePath.find(executablePath);
+      if (cacheDirectory.authorizationFileByExecutablePath.end() == executableIter) return false;
+
+      authorizationFile.Clear();
+      authorizationFile << executableIter->second;
+      return true;
+    }
+
+    /// Records an authorization decision for the specified executable, but only if its directory
+    /// is being watched for changes.
+    /// @param [in] executablePath Full path of the executable.
+    /// @param [in] authorizationFile Name of the file that granted authorization, or empty if
+    /// authorization was not granted.
+    static void CacheAuthorization(
+        std::wstring_view executablePath, std::wstring_view authorizationFile)
+    {
+      const std::wstring_view executableDirectory = ExecutableDirectory(executablePath);
+      if (true == executableDirectory.empty()) return;
+
+      std::unique_lock<std::mutex> lock(authorizationCacheMutex);
+
+      auto directoryIter = authorizationCache.find(executableDirectory);
+      if (authorizationCache.end() == directoryIter) return;
+
+      directoryIter->second.authorizationFileByExecutablePath.insert_or_assign(
+          std::wstring(executablePath), std::wstring(authorizationFile));
+    }
+
     /// Verifies that Hookshot was given explicit authorization from the end user to inject the
     /// specified process.
     /// @param [in] processHandle Handle to the process to check.
@@ -419,6 +1063,26 @@ namespace Hookshot
         return EInjectResult::ErrorCannotDetermineAuthorization;
       processExecutablePath.UnsafeSetSize(static_cast<unsigned int>(processExecutablePathLength));
 
+      Infra::TemporaryString cachedAuthorizationFile;
+      if (true == LookupCachedAuthorization(
+              processExecutablePath.AsStringView(), cachedAuthorizationFile))
+      {
+        if (true == cachedAuthorizationFile.Empty())
+        {
+          Infra::Message::OutputFormatted(
+              Infra::Message::ESeverity::Warning,
+              L"Authorization not granted to inject %s, based on a previous check.",
+              processExecutablePath.AsCString());
+          return EInjectResult::ErrorNotAuthorized;
+        }
+
+        Infra::Message::OutputFormatted(
+            Infra::Message::ESeverity::Info,
+            L"Authorization granted by presence of file %s, based on a previous check.",
+            cachedAuthorizationFile.AsCString());
+        return EInjectResult::Success;
+      }
+
       Infra::TemporaryString authorizationFileName =
           Strings::AuthorizationFilenameApplicationSpecific(processExecutablePath.Data());
       if (FALSE == PathFileExists(authorizationFileName.AsCString()))
@@ -436,6 +1100,7 @@ namespace Hookshot
               Infra::Message::ESeverity::Warning,
               L"Authorization not granted, cannot open directory-wide file %s.",
               authorizationFileName.AsCString());
+          CacheAuthorization(processExecutablePath.AsStringView(), std::wstring_view());
           return EInjectResult::ErrorNotAuthorized;
         }
       }
@@ -444,6 +1109,8 @@ namespace Hookshot
           Infra::Message::ESeverity::Info,
           L"Authorization granted by presence of file %s.",
           authorizationFileName.AsCString());
+      CacheAuthorization(
+          processExecutablePath.AsStringView(), authorizationFileName.AsStringView());
       return EInjectResult::Success;
     }
 
@@ -468,118 +1135,1139 @@ namespace Hookshot
         return EInjectResult::ErrorArchitectureMismatch;
     }
 
-    /// Attempts to inject a process with Hookshot code.
-    /// @param [in] processHandle Handle to the process to inject.
-    /// @param [in] threadHandle Handle to the main thread of the process to inject.
-    /// @param [in] enableDebugFeatures If `true`, signals to the injected process that a debugger
-    /// is present, so certain debug features should be enabled.
-    /// @return Indicator of the result of the operation.
-    static EInjectResult InjectProcess(
-        const HANDLE processHandle, const HANDLE threadHandle, const bool enableDebugFeatures)
+    /// Determines the size of a view of a mapped file, including an image. Views of images consist
+    /// of multiple regions with different protections, so the size of the view is determined by
+    /// adding up all of the regions that belong to it.
+    /// @param [in] viewBase Base address of the view.
+    /// @return Size of the view, in bytes, or 0 if it cannot be determined.
+    static size_t ViewSize(const void* viewBase)
     {
-      // Verify that Hookshot is authorized to act on the process.
-      EInjectResult operationResult = VerifyAuthorizedToInjectProcess(processHandle);
+      size_t viewSize = 0;
+      MEMORY_BASIC_INFORMATION memoryInfo{};
+      while (sizeof(memoryInfo) ==
+             VirtualQuery(
+                 reinterpret_cast<const uint8_t*>(viewBase) + viewSize,
+                 &memoryInfo,
+                 sizeof(memoryInfo)))
+      {
+        if (viewBase != memoryInfo.AllocationBase) break;
+        viewSize += memoryInfo.RegionSize;
+      }
 
-      // Make sure the architectures match between this process and the process being injected.
-      if (EInjectResult::Success == operationResult)
-        operationResult = VerifyMatchingProcessArchitecture(processHandle);
+      return viewSize;
+    }
 
-      switch (operationResult)
-      {
-        case EInjectResult::Success:
-          break;
+    /// Reads into memory every page of a view of a mapped file that is not already there.
+    /// @param [in] viewBase Base address of the view.
+    /// @param [in] viewSize Size of the view, in bytes.
+    /// @return `true` if the view was prefetched, `false` otherwise.
+    static bool PrefetchView(void* viewBase, size_t viewSize)
+    {
+      WIN32_MEMORY_RANGE_ENTRY viewRange = {.VirtualAddress = viewBase, .NumberOfBytes = viewSize};
+      return (
+          (0 != viewSize) &&
+          (FALSE != PrefetchVirtualMemory(GetCurrentProcess(), 1, &viewRange, 0)));
+    }
 
-        case EInjectResult::ErrorArchitectureMismatch:
-          return RemoteProcessInjector::InjectProcess(
-              processHandle, threadHandle, true, enableDebugFeatures);
+    /// Reads the entire contents of a file into memory without keeping it mapped. Executable
+    /// images are mapped as images where possible, so that the pages read are the same ones the
+    /// loader subsequently uses when it maps the file itself. Pages read this way remain in memory
+    /// on the standby list after the view is unmapped.
+    /// @param [in] fileName Full path of the file to prefetch.
+    /// @return `true` if the file was prefetched, `false` otherwise.
+    static bool PrefetchFile(const wchar_t* fileName)
+    {
+      const HANDLE fileHandle = CreateFile(
+          fileName,
+          GENERIC_READ,
+          FILE_SHARE_READ | FILE_SHARE_DELETE,
+          nullptr,
+          OPEN_EXISTING,
+          FILE_ATTRIBUTE_NORMAL,
+          nullptr);
+      if (INVALID_HANDLE_VALUE == fileHandle) return false;
 
-        default:
-          return operationResult;
-      }
+      HANDLE mappingHandle =
+          CreateFileMapping(fileHandle, nullptr, (PAGE_READONLY | SEC_IMAGE), 0, 0, nullptr);
+      if (nullptr == mappingHandle)
+        mappingHandle = CreateFileMapping(fileHandle, nullptr, PAGE_READONLY, 0, 0, nullptr);
 
-      const size_t allocationGranularity =
-          Infra::SystemInfo::GetPlatformAndArchitectureInfo().dwPageSize;
-      const size_t effectiveInjectRegionSize =
-          (InjectInfo::kMaxInjectBinaryFileSize < allocationGranularity)
-          ? allocationGranularity
-          : InjectInfo::kMaxInjectBinaryFileSize;
-      void* processBaseAddress = nullptr;
-      void* processEntryPoint = nullptr;
+      CloseHandle(fileHandle);
+      if (nullptr == mappingHandle) return false;
+
+      void* const viewBase = MapViewOfFile(mappingHandle, FILE_MAP_READ, 0, 0, 0);
+      CloseHandle(mappingHandle);
+      if (nullptr == viewBase) return false;
+
+      const bool prefetchSucceeded = PrefetchView(viewBase, ViewSize(viewBase));
+
+      UnmapViewOfFile(viewBase);
+      return prefetchSucceeded;
+    }
+
+    /// Range of virtual addresses occupied by an image of the Hookshot library.
+    struct SLibraryImageRange
+    {
+      /// Base address of the image, or `nullptr` if there is no image.
+      void* baseAddress;
+
+      /// Size of the image, in bytes.
+      size_t sizeBytes;
+    };
+
+    /// Keeps an image of the Hookshot library mapped in this process for as long as it runs, if
+    /// the configuration file asks for it. The system randomizes the base address of an image only
+    /// when nothing has it mapped, so as long as this process holds it, every process it injects
+    /// maps the library at that same base address and shares the physical pages that hold it,
+    /// just as for system libraries, instead of possibly relocating it into private pages. The
+    /// pages also stay resident, so injected processes do not have to read the file again. If
+    /// this process has itself loaded the library, that copy already holds the image and nothing
+    /// else is mapped. Only attempted once, no matter how many times it is invoked.
+    /// @return Range of the pinned image, which is empty if pinning is disabled or failed.
+    static const SLibraryImageRange& GetPinnedLibraryImage(void)
+    {
+      static const SLibraryImageRange pinnedLibraryImage = []() -> SLibraryImageRange
+      {
+        if (false ==
+            GetGlobalConfigurationFlag(
+                Strings::kStrConfigurationSettingNamePinHookshotLibraryImage))
+          return {};
+
+        const wchar_t* const libraryFilename =
+            Strings::GetHookshotDynamicLinkLibraryFilename().data();
+        void* imageBase = reinterpret_cast<void*>(GetModuleHandle(libraryFilename));
+
+        if (nullptr == imageBase)
+        {
+          const HANDLE fileHandle = CreateFile(
+              libraryFilename,
+              GENERIC_READ,
+              FILE_SHARE_READ | FILE_SHARE_DELETE,
+              nullptr,
+              OPEN_EXISTING,
+              FILE_ATTRIBUTE_NORMAL,
+              nullptr);
+          if (INVALID_HANDLE_VALUE != fileHandle)
+          {
+            const HANDLE mappingHandle = CreateFileMapping(
+                fileHandle, nullptr, (PAGE_READONLY | SEC_IMAGE), 0, 0, nullptr);
+            CloseHandle(fileHandle);
+
+            if (nullptr != mappingHandle)
+            {
+              imageBase = MapViewOfFile(mappingHandle, FILE_MAP_READ, 0, 0, 0);
+              CloseHandle(mappingHandle);
+            }
+          }
+        }
+
+        if (nullptr == imageBase)
+        {
+          Infra::Message::OutputFormatted(
+              Infra::Message::ESeverity::Warning,
+              L"Failed to pin the Hookshot library image: %s",
+              Infra::Strings::FromSystemErrorCode(GetLastError()).AsCString());
+          return {};
+        }
+
+        const SLibraryImageRange imageRange = {
+            .baseAddress = imageBase, .sizeBytes = ViewSize(imageBase)};
+        PrefetchView(imageRange.baseAddress, imageRange.sizeBytes);
+
+        Infra::Message::OutputFormatted(
+            Infra::Message::ESeverity::Info,
+            L"Pinned the Hookshot library image at base address 0x%llx.",
+            (unsigned long long)reinterpret_cast<size_t>(imageRange.baseAddress));
+        return imageRange;
+      }();
+
+      return pinnedLibraryImage;
+    }
+
+    /// Checks whether or not the Hookshot library can be loaded at the base address of its pinned
+    /// image in a process that is about to be injected, and writes a warning to the log if not.
+    /// In that case the library is relocated in that process, so none of its modified pages are
+    /// shared with other processes. Has no effect if the library image is not pinned.
+    /// @param [in] processHandle Handle to the process being injected.
+    static void CheckPinnedLibraryImageRangeIsFree(const HANDLE processHandle)
+    {
+      const SLibraryImageRange& pinnedLibraryImage = GetPinnedLibraryImage();
+      if (nullptr == pinnedLibraryImage.baseAddress) return;
+
+      MEMORY_BASIC_INFORMATION memoryInfo{};
+      if (sizeof(memoryInfo) !=
+          VirtualQueryEx(
+              processHandle, pinnedLibraryImage.baseAddress, &memoryInfo, sizeof(memoryInfo)))
+        return;
+
+      if ((MEM_FREE == memoryInfo.State) &&
+          (memoryInfo.RegionSize >= pinnedLibraryImage.sizeBytes))
+        return;
+
+      Infra::Message::OutputFormatted(
+          Infra::Message::ESeverity::Warning,
+          L"Process %u already occupies the base address 0x%llx of the pinned Hookshot library image, so the library will be relocated in that process.",
+          (unsigned int)GetProcessId(processHandle),
+          (unsigned long long)reinterpret_cast<size_t>(pinnedLibraryImage.baseAddress));
+    }
+
+    /// Thread pool callback that prefetches the files that an injected process is about to load.
+    /// Takes ownership of the work item.
+    /// @param [in] instance Callback instance. Not used.
+    /// @param [in] context Work item, of type #SPrefetchItem.
+    static void CALLBACK PrefetchInjectedFilesCallback(
+        PTP_CALLBACK_INSTANCE instance, PVOID context)
+    {
+      SPrefetchItem* const item = reinterpret_cast<SPrefetchItem*>(context);
+      int numFilesPrefetched = 0;
+
+      if (true == item->prefetchHookshotLibrary)
+      {
+        // A pinned image is already mapped, so there is no need to open the file again. Any of its
+        // pages evicted since the previous injection are read back in.
+        const SLibraryImageRange& pinnedLibraryImage = GetPinnedLibraryImage();
+        const bool libraryPrefetched = (nullptr != pinnedLibraryImage.baseAddress)
+            ? PrefetchView(pinnedLibraryImage.baseAddress, pinnedLibraryImage.sizeBytes)
+            : PrefetchFile(Strings::GetHookshotDynamicLinkLibraryFilename().data());
+        if (true == libraryPrefetched) numFilesPrefetched += 1;
+      }
+
+      if (false == item->hookModuleDirectory.empty())
+      {
+        const Infra::TemporaryString hookModuleSearchString =
+            Strings::HookModuleFilename(L"*", item->hookModuleDirectory);
+        WIN32_FIND_DATA hookModuleFileData{};
+        const HANDLE hookModuleFind = FindFirstFileEx(
+            hookModuleSearchString.AsCString(),
+            FindExInfoBasic,
+            &hookModuleFileData,
+            FindExSearchNameMatch,
+            NULL,
+            0);
+
+        if (INVALID_HANDLE_VALUE != hookModuleFind)
+        {
+          Infra::TemporaryString hookModuleFileName;
+
+          do
+          {
+            hookModuleFileName.Clear();
+            hookModuleFileName << item->hookModuleDirectory << L"\\"
+                               << hookModuleFileData.cFileName;
+            if (true == PrefetchFile(hookModuleFileName.AsCString())) numFilesPrefetched += 1;
+          }
+          while (FALSE != FindNextFile(hookModuleFind, &hookModuleFileData));
+
+          FindClose(hookModuleFind);
+        }
+      }
+
+      Infra::Message::OutputFormatted(
+          Infra::Message::ESeverity::Debug,
+          L"Prefetched %d file(s) to be loaded by an injected process.",
+          numFilesPrefetched);
+
+      delete item;
+    }
+
+    /// Starts reading, in the background, the Hookshot library and all of the hook modules that the
+    /// specified process is expected to load once injected. Doing so allows disk reads to overlap
+    /// with the rest of the injection process rather than all taking place once the process is
+    /// allowed to run. Configured hook modules always reside in the same directory as the hook
+    /// modules that are loaded by default, so all hook modules in that directory are prefetched.
+    /// Files already prefetched by this process are skipped, except for a pinned image of the
+    /// Hookshot library, which costs nothing to prefetch again while it is still resident.
+    /// @param [in] processHandle Handle to the process being injected.
+    static void PrefetchInjectedFiles(const HANDLE processHandle)
+    {
+      static const bool loadHookModulesFromHookshotDirectory = GetGlobalConfigurationFlag(
+          Strings::kStrConfigurationSettingNameLoadHookModulesFromHookshotDirectory);
+
+      std::wstring hookModuleDirectory;
+      if (true == loadHookModulesFromHookshotDirectory)
+      {
+        hookModuleDirectory = Infra::ProcessInfo::GetThisModuleDirectoryName();
+      }
+      else
+      {
+        Infra::TemporaryString processExecutablePath;
+        DWORD processExecutablePathLength = processExecutablePath.Capacity();
+
+        if (0 !=
+            QueryFullProcessImageName(
+                processHandle, 0, processExecutablePath.Data(), &processExecutablePathLength))
+        {
+          processExecutablePath.UnsafeSetSize(
+              static_cast<unsigned int>(processExecutablePathLength));
+          hookModuleDirectory = ExecutableDirectory(processExecutablePath.AsStringView());
+        }
+      }
+
+      SPrefetchItem* const item = new SPrefetchItem{
+          .prefetchHookshotLibrary = false, .hookModuleDirectory = std::move(hookModuleDirectory)};
+
+      do
+      {
+        std::unique_lock<std::mutex> lock(prefetchMutex);
+
+        item->prefetchHookshotLibrary = ((false == hookshotLibraryPrefetched) ||
+                                         (nullptr != GetPinnedLibraryImage().baseAddress));
+        hookshotLibraryPrefetched = true;
+
+        if ((false == item->hookModuleDirectory.empty()) &&
+            (false == prefetchedHookModuleDirectories.insert(item->hookModuleDirectory).second))
+          item->hookModuleDirectory.clear();
+      }
+      while (false);
+
+      if ((false == item->prefetchHookshotLibrary) && (true == item->hookModuleDirectory.empty()))
+      {
+        delete item;
+        return;
+      }
+
+      // Prefetching only helps if it runs concurrently with injection, so it is skipped entirely
+      // if a worker thread cannot be obtained.
+      if (FALSE == TrySubmitThreadpoolCallback(PrefetchInjectedFilesCallback, item, nullptr))
+        delete item;
+    }
+
+    /// Attempts to inject a process with Hookshot code.
+    /// @param [in] processHandle Handle to the process to inject.
+    /// @param [in] threadHandle Handle to the main thread of the process to inject.
+    /// @param [in] enableDebugFeatures If `true`, signals to the injected process that a debugger
+    /// is present, so certain debug features should be enabled.
+    /// @param [out] phaseDurations Filled with the durations of each injection phase. Phases that
+    /// did not run are marked accordingly.
+    /// @return Indicator of the result of the operation.
+    static EInjectResult InjectProcess(
+        const HANDLE processHandle,
+        const HANDLE threadHandle,
+        const bool enableDebugFeatures,
+        Tracing::SInjectPhaseDurations& phaseDurations)
+    {
+      const DWORD processId = GetProcessId(processHandle);
+      phaseDurations.Clear();
+
+      // Measures the phase that started at the most recent phase start time, then records and
+      // reports it.
+      auto phaseStartTime = std::chrono::steady_clock::now();
+      auto completePhase = [processId, &phaseDurations, &phaseStartTime](
+                               Tracing::EInjectPhase phase, EInjectResult result) -> void
+      {
+        const long long durationMicroseconds = Tracing::MicrosecondsSince(phaseStartTime);
+        phaseDurations.Record(phase, durationMicroseconds);
+        Tracing::InjectProcessPhase(processId, phase, durationMicroseconds, result);
+      };
+
+      // Verify that Hookshot is authorized to act on the process.
+      EInjectResult operationResult = VerifyAuthorizedToInjectProcess(processHandle);
+      completePhase(Tracing::EInjectPhase::Authorize, operationResult);
+      if (EInjectResult::Success != operationResult) return operationResult;
+
+      // Make sure the architectures match between this process and the process being injected.
+      phaseStartTime = std::chrono::steady_clock::now();
+      operationResult = VerifyMatchingProcessArchitecture(processHandle);
+      completePhase(Tracing::EInjectPhase::VerifyArchitecture, operationResult);
+
+      switch (operationResult)
+      {
+        case EInjectResult::Success:
+          break;
+
+        case EInjectResult::ErrorArchitectureMismatch:
+        {
+#ifdef _WIN64
+          // A 32-bit process can usually be injected directly, which avoids starting another
+          // instance. If that fails before the process is modified, the other instance can still
+          // inject it.
+          bool retryPossible = false;
+          operationResult = Wow64Injector::InjectProcess(
+              processHandle, threadHandle, enableDebugFeatures, phaseDurations, &retryPossible);
+          if ((EInjectResult::Success == operationResult) || (false == retryPossible))
+            return operationResult;
+
+          Infra::Message::OutputFormatted(
+              Infra::Message::ESeverity::Warning,
+              L"Failed to inject a 32-bit process directly (%s). Falling back to the 32-bit form of Hookshot.",
+              InjectResultString(operationResult).data());
+#endif
+
+          // The other instance reports its own durations for all of the phases it performs, but
+          // the phases already performed here are kept.
+          Tracing::SInjectPhaseDurations remotePhaseDurations;
+          operationResult = RemoteProcessInjector::InjectProcess(
+              processHandle, threadHandle, true, enableDebugFeatures, &remotePhaseDurations);
+
+          for (size_t i = static_cast<size_t>(Tracing::EInjectPhase::Advance);
+               i < Tracing::kNumInjectPhases;
+               ++i)
+            phaseDurations.microseconds[i] = remotePhaseDurations.microseconds[i];
+
+          return operationResult;
+        }
+
+        default:
+          return operationResult;
+      }
+
+      // The files the process loads once it is allowed to run are read while it is being injected.
+      PrefetchInjectedFiles(processHandle);
+
+      const size_t effectiveInjectRegionSize = GetInjectRegionSize();
+      void* processBaseAddress = nullptr;
+      void* processEntryPoint = nullptr;
       void* injectedCodeBase = nullptr;
       void* injectedDataBase = nullptr;
 
       // Advance the process so that the loader thread finishes loading any modules needed.
+      phaseStartTime = std::chrono::steady_clock::now();
       operationResult = AdvanceProcess(processHandle);
+      completePhase(Tracing::EInjectPhase::Advance, operationResult);
       if (EInjectResult::Success != operationResult) return operationResult;
 
+      // Everything the process loads before the injected code runs has now been loaded, so
+      // whatever occupies the base address of the pinned library image by now is still there once
+      // the library is loaded.
+      CheckPinnedLibraryImageRangeIsFree(processHandle);
+
+      phaseStartTime = std::chrono::steady_clock::now();
+
+      // All buffers needed from here on come from an arena rather than from the heap. The process
+      // is suspended from here on, so memory read from it stays valid.
+      InjectionArena arena;
+      RemoteMemoryReader remoteMemory(processHandle, arena);
+
       // Attempt to obtain the process environment block for the new process.
       PEB processEnvironmentBlock;
-      operationResult = GetProcessEnvironmentBlock(processHandle, &processEnvironmentBlock);
-      if (EInjectResult::Success != operationResult) return operationResult;
+      operationResult = GetProcessEnvironmentBlock(remoteMemory, &processEnvironmentBlock);
 
       // Attempt to obtain the base address of the executable image of the new process.
-      operationResult = GetProcessImageBaseAddress(processEnvironmentBlock, &processBaseAddress);
+      if (EInjectResult::Success == operationResult)
+        operationResult =
+            GetProcessImageBaseAddress(processEnvironmentBlock, &processBaseAddress);
+
+      completePhase(Tracing::EInjectPhase::LocateProcessEnvironmentBlock, operationResult);
       if (EInjectResult::Success != operationResult) return operationResult;
 
       // Attempt to obtain the entry point address of the new process.
+      phaseStartTime = std::chrono::steady_clock::now();
       operationResult =
-          GetProcessEntryPointAddress(processHandle, processBaseAddress, &processEntryPoint);
+          GetProcessEntryPointAddress(remoteMemory, processBaseAddress, &processEntryPoint);
+      completePhase(Tracing::EInjectPhase::LocateEntryPoint, operationResult);
       if (EInjectResult::Success != operationResult) return operationResult;
 
-      // Allocate code and data areas in the target process.
-      // Code first, then data.
-      injectedCodeBase = VirtualAllocEx(
-          processHandle,
-          nullptr,
-          (static_cast<SIZE_T>(effectiveInjectRegionSize) * 2),
-          MEM_RESERVE | MEM_COMMIT,
-          PAGE_NOACCESS);
-      injectedDataBase = reinterpret_cast<void*>(
-          reinterpret_cast<size_t>(injectedCodeBase) + effectiveInjectRegionSize);
-
-      if (nullptr == injectedCodeBase) return EInjectResult::ErrorVirtualAllocFailed;
+      Infra::Message::OutputFormatted(
+          Infra::Message::ESeverity::Info,
+          L"Read %llu byte(s) of process memory using %u system call(s) to locate the entry point.",
+          static_cast<unsigned long long>(remoteMemory.GetNumBytesRead()),
+          remoteMemory.GetNumReadCalls());
 
-      // Set appropriate protection values onto the new areas individually.
-      {
-        DWORD unusedOldProtect = 0;
+      phaseStartTime = std::chrono::steady_clock::now();
 
-        if (FALSE ==
-            VirtualProtectEx(
-                processHandle,
-                injectedCodeBase,
-                effectiveInjectRegionSize,
-                PAGE_EXECUTE_READ,
-                &unusedOldProtect))
-          return EInjectResult::ErrorVirtualProtectFailed;
+      // Allocate code and data areas in the target process, preferably by mapping them from the
+      // shared section if so configured.
+      bool injectRegionsShared = false;
+      operationResult = PlaceInjectRegions(
+          processHandle,
+          effectiveInjectRegionSize,
+          &injectedCodeBase,
+          &injectedDataBase,
+          &injectRegionsShared);
 
-        if (FALSE ==
-            VirtualProtectEx(
-                processHandle,
-                injectedDataBase,
-                effectiveInjectRegionSize,
-                PAGE_READWRITE,
-                &unusedOldProtect))
-          return EInjectResult::ErrorVirtualProtectFailed;
-      }
+      completePhase(Tracing::EInjectPhase::Allocate, operationResult);
+      if (EInjectResult::Success != operationResult) return operationResult;
 
       // Inject code and data.
       // Only mark the code buffer as requiring cleanup because both code and data buffers are from
-      // the same single allocation.
+      // the same single allocation or view.
       CodeInjector injector(
           injectedCodeBase,
           injectedDataBase,
           true,
           false,
+          injectRegionsShared,
           processEntryPoint,
           effectiveInjectRegionSize,
           effectiveInjectRegionSize,
           processHandle,
-          threadHandle);
-      operationResult = injector.SetAndRun(enableDebugFeatures);
+          threadHandle,
+          arena);
+      return injector.SetAndRun(enableDebugFeatures, ShouldInjectUsingApc(), phaseDurations);
+    }
+
+    /// Access rights needed on a process handle in order to inject a process that is already
+    /// running.
+    static constexpr DWORD kRunningProcessAccessRights = PROCESS_CREATE_THREAD |
+        PROCESS_DUP_HANDLE | PROCESS_QUERY_INFORMATION | PROCESS_VM_OPERATION | PROCESS_VM_READ |
+        PROCESS_VM_WRITE;
+
+    /// Locations in a running process into which code and data are injected, along with the thread
+    /// on which the injected code runs.
+    struct SRunningProcessInjectionSite
+    {
+      /// Base address of the injected code region.
+      void* injectedCodeBase;
+
+      /// Base address of the injected data region.
+      void* injectedDataBase;
+
+      /// Whether or not the injected regions are shared with other processes.
+      bool injectRegionsShared;
+
+      /// Size of each of the injected regions, in bytes.
+      size_t injectRegionSize;
+
+      /// Start routine of the injection thread, to which it continues once the injected code is
+      /// done.
+      LPTHREAD_START_ROUTINE injectionThreadStartRoutine;
+
+      /// Handle of the injection thread, which is created suspended.
+      HANDLE injectionThread;
+    };
+
+    /// Performs all of the steps needed to inject a process that is already running up to the
+    /// point at which code and data are set into it. Verifies that the process can be injected,
+    /// allocates the injected regions, and creates a suspended thread on which the injected code
+    /// will run.
+    /// @param [in] processHandle Handle to the process to inject.
+    /// @param [out] phaseDurations Filled with the durations of each injection phase. Phases that
+    /// did not run are marked accordingly.
+    /// @param [out] site Filled with the locations into which code and data are to be injected.
+    /// Only valid if this function succeeds, in which case the caller owns the injection thread.
+    /// @return Indicator of the result of the operation.
+    static EInjectResult PrepareRunningProcessInjection(
+        const HANDLE processHandle,
+        Tracing::SInjectPhaseDurations& phaseDurations,
+        SRunningProcessInjectionSite* const site)
+    {
+      const DWORD processId = GetProcessId(processHandle);
+      phaseDurations.Clear();
+
+      auto phaseStartTime = std::chrono::steady_clock::now();
+      auto completePhase = [processId, &phaseDurations, &phaseStartTime](
+                               Tracing::EInjectPhase phase, EInjectResult result) -> void
+      {
+        const long long durationMicroseconds = Tracing::MicrosecondsSince(phaseStartTime);
+        phaseDurations.Record(phase, durationMicroseconds);
+        Tracing::InjectProcessPhase(processId, phase, durationMicroseconds, result);
+      };
+
+      // Verify that Hookshot is authorized to act on the process.
+      EInjectResult operationResult = VerifyAuthorizedToInjectProcess(processHandle);
+      completePhase(Tracing::EInjectPhase::Authorize, operationResult);
+      if (EInjectResult::Success != operationResult) return operationResult;
+
+      // Requests to another instance of Hookshot assume a newly-created process whose main thread
+      // is suspended, so a running process can only be injected by a Hookshot executable of the
+      // same architecture.
+      phaseStartTime = std::chrono::steady_clock::now();
+      operationResult = VerifyMatchingProcessArchitecture(processHandle);
+      completePhase(Tracing::EInjectPhase::VerifyArchitecture, operationResult);
+      if (EInjectResult::Success != operationResult) return operationResult;
+
+      // Allocate code and data areas in the target process.
+      phaseStartTime = std::chrono::steady_clock::now();
+
+      const size_t effectiveInjectRegionSize = GetInjectRegionSize();
+      void* injectedCodeBase = nullptr;
+      void* injectedDataBase = nullptr;
+      bool injectRegionsShared = false;
+      operationResult = PlaceInjectRegions(
+          processHandle,
+          effectiveInjectRegionSize,
+          &injectedCodeBase,
+          &injectedDataBase,
+          &injectRegionsShared);
+
+      // Create the thread on which the injected code will run. It remains suspended until the
+      // injected code is ready to run.
+      const LPTHREAD_START_ROUTINE injectionThreadStartRoutine = GetExitThreadStartRoutine();
+      HANDLE injectionThread = nullptr;
+      if (EInjectResult::Success == operationResult)
+      {
+        if (nullptr != injectionThreadStartRoutine)
+          injectionThread = CreateRemoteThread(
+              processHandle,
+              nullptr,
+              0,
+              injectionThreadStartRoutine,
+              nullptr,
+              CREATE_SUSPENDED,
+              nullptr);
+
+        if (nullptr == injectionThread)
+        {
+          const DWORD systemErrorCode = GetLastError();
+          if (false == injectRegionsShared)
+            VirtualFreeEx(processHandle, injectedCodeBase, 0, MEM_RELEASE);
+          SetLastError(systemErrorCode);
+
+          operationResult = EInjectResult::ErrorCreateInjectionThread;
+        }
+      }
+
+      completePhase(Tracing::EInjectPhase::Allocate, operationResult);
+      if (EInjectResult::Success != operationResult) return operationResult;
+
+      *site = {
+          .injectedCodeBase = injectedCodeBase,
+          .injectedDataBase = injectedDataBase,
+          .injectRegionsShared = injectRegionsShared,
+          .injectRegionSize = effectiveInjectRegionSize,
+          .injectionThreadStartRoutine = injectionThreadStartRoutine,
+          .injectionThread = injectionThread};
+      return EInjectResult::Success;
+    }
+
+    /// Allows a suspended injection thread to run to completion, whether or not injection
+    /// succeeded, and closes its handle. If the injected code never ran then the thread just
+    /// exits. Preserves the last system error code.
+    /// @param [in] injectionThread Handle of the injection thread.
+    static void ReleaseInjectionThread(const HANDLE injectionThread)
+    {
+      const DWORD systemErrorCode = GetLastError();
+      ResumeThread(injectionThread);
+      CloseHandle(injectionThread);
+      SetLastError(systemErrorCode);
+    }
+
+    /// Injects a process that is already running. The injected code runs as an asynchronous
+    /// procedure call on a new thread created for that purpose, which a new thread always runs
+    /// during its own initialization before reaching its start routine. The start routine simply
+    /// exits the thread, so no existing thread is interrupted and no existing code is modified.
+    /// @param [in] processHandle Handle to the process to inject.
+    /// @param [in] enableDebugFeatures If `true`, signals to the injected process that a debugger
+    /// is present, so certain debug features should be enabled.
+    /// @param [out] phaseDurations Filled with the durations of each injection phase. Phases that
+    /// did not run are marked accordingly.
+    /// @return Indicator of the result of the operation.
+    static EInjectResult InjectRunningProcessUsingHandle(
+        const HANDLE processHandle,
+        const bool enableDebugFeatures,
+        Tracing::SInjectPhaseDurations& phaseDurations)
+    {
+      SRunningProcessInjectionSite site;
+      EInjectResult operationResult =
+          PrepareRunningProcessInjection(processHandle, phaseDurations, &site);
+      if (EInjectResult::Success != operationResult) return operationResult;
+
+      // Inject code and data. The thread start routine serves as the entry point, to which the
+      // thread continues once the injected code finishes.
+      InjectionArena arena;
+      CodeInjector injector(
+          site.injectedCodeBase,
+          site.injectedDataBase,
+          true,
+          false,
+          site.injectRegionsShared,
+          reinterpret_cast<void*>(site.injectionThreadStartRoutine),
+          site.injectRegionSize,
+          site.injectRegionSize,
+          processHandle,
+          site.injectionThread,
+          arena);
+      operationResult = injector.SetAndRun(enableDebugFeatures, true, phaseDurations);
 
+      ReleaseInjectionThread(site.injectionThread);
       return operationResult;
     }
 
+    /// Completion key used to post notifications that an asynchronous injection can make progress
+    /// to the completion port of an injection job. Job objects post their own notifications using
+    /// the job handle as the completion key, and handle values are always multiples of four, so
+    /// this value cannot be mistaken for a job notification.
+    static constexpr ULONG_PTR kAsyncInjectionCompletionKey = 1;
+
+    /// Injection of a running process that proceeds without blocking the thread that drives it.
+    /// Each time the injected code reaches a synchronization barrier, a thread pool wait posts a
+    /// notification to a completion port, so a single thread can advance any number of injections
+    /// concurrently.
+    struct SAsyncInjection
+    {
+      /// Identifier of the process being injected.
+      DWORD processId;
+
+      /// Handle to the process being injected.
+      HANDLE processHandle;
+
+      /// Completion port to which progress notifications are posted.
+      HANDLE completionPortHandle;
+
+      /// Event that the injected code signals whenever it reaches a synchronization barrier.
+      HANDLE syncEvent;
+
+      /// Thread pool wait on the sync event.
+      PTP_WAIT syncWait;
+
+      /// Locations into which code and data are injected.
+      SRunningProcessInjectionSite site;
+
+      /// Durations of each injection phase.
+      Tracing::SInjectPhaseDurations phaseDurations;
+
+      /// Arena from which the code injector obtains its buffers. Must outlive the code injector.
+      InjectionArena arena;
+
+      /// Code injector that performs the injection.
+      std::optional<CodeInjector> injector;
+    };
+
+    /// Arms the thread pool wait of an asynchronous injection so that a progress notification is
+    /// posted the next time the injected code reaches a synchronization barrier.
+    /// @param [in] injection Asynchronous injection.
+    static void ArmAsyncInjectionWait(SAsyncInjection* const injection)
+    {
+      // Negative due times are relative and expressed in 100-nanosecond units. Timing out bounds
+      // the delay if a signal is missed, just like waiting for synchronous injection does.
+      ULARGE_INTEGER timeout = {
+          .QuadPart = static_cast<ULONGLONG>(
+              -(static_cast<LONGLONG>(kInjectSyncEventTimeoutMilliseconds) * 10000))};
+      FILETIME dueTime = {.dwLowDateTime = timeout.LowPart, .dwHighDateTime = timeout.HighPart};
+      SetThreadpoolWait(injection->syncWait, injection->syncEvent, &dueTime);
+    }
+
+    /// Thread pool wait callback that posts a progress notification for an asynchronous injection.
+    /// Invoked whenever the sync event is signalled or the wait times out, the latter serving as a
+    /// fallback in case a signal is missed.
+    /// @param [in] instance Callback instance. Not used.
+    /// @param [in] context Asynchronous injection, of type #SAsyncInjection.
+    /// @param [in] wait Thread pool wait that invoked this callback. Not used.
+    /// @param [in] waitResult Reason for invoking this callback. Not used.
+    static void CALLBACK AsyncInjectionSyncWaitCallback(
+        PTP_CALLBACK_INSTANCE instance, PVOID context, PTP_WAIT wait, TP_WAIT_RESULT waitResult)
+    {
+      SAsyncInjection* const injection = reinterpret_cast<SAsyncInjection*>(context);
+      if (FALSE ==
+          PostQueuedCompletionStatus(
+              injection->completionPortHandle,
+              0,
+              kAsyncInjectionCompletionKey,
+              reinterpret_cast<LPOVERLAPPED>(injection)))
+        ArmAsyncInjectionWait(injection);
+    }
+
+    /// Completes an asynchronous injection, whether or not it succeeded. Releases the injection
+    /// thread, outputs the phase durations, and destroys the injection object. Preserves the last
+    /// system error code.
+    /// @param [in] injection Asynchronous injection, which is no longer valid once this function
+    /// returns.
+    static void CompleteAsyncInjection(SAsyncInjection* const injection)
+    {
+      const DWORD systemErrorCode = GetLastError();
+
+      if (nullptr != injection->syncWait)
+      {
+        SetThreadpoolWait(injection->syncWait, nullptr, nullptr);
+        WaitForThreadpoolWaitCallbacks(injection->syncWait, TRUE);
+        CloseThreadpoolWait(injection->syncWait);
+      }
+
+      if (nullptr != injection->site.injectionThread)
+        ReleaseInjectionThread(injection->site.injectionThread);
+
+      Tracing::OutputInjectPhaseDurations(
+          Infra::Message::ESeverity::Info, injection->processId, injection->phaseDurations);
+
+      injection->injector.reset();
+      if (nullptr != injection->syncEvent) CloseHandle(injection->syncEvent);
+      CloseHandle(injection->processHandle);
+      delete injection;
+
+      SetLastError(systemErrorCode);
+    }
+
+    /// Starts injecting a process that is already running without waiting for the injected code
+    /// to finish. See #InjectRunningProcessUsingHandle for more information on how a running
+    /// process is injected. If the injection cannot proceed asynchronously, it is completed
+    /// synchronously instead.
+    /// @param [in] processId Identifier of the process to inject.
+    /// @param [in] enableDebugFeatures If `true`, signals to the injected process that a debugger
+    /// is present, so certain debug features should be enabled.
+    /// @param [in] completionPortHandle Completion port to which progress notifications are posted
+    /// using #kAsyncInjectionCompletionKey as the completion key.
+    /// @param [out] completedResult Filled with the result of the injection if it completed before
+    /// this function returns.
+    /// @return Asynchronous injection object, which must be passed to #ContinueAsyncInjection each
+    /// time a progress notification identifies it, or `nullptr` if the injection already
+    /// completed.
+    static SAsyncInjection* StartAsyncInjection(
+        const DWORD processId,
+        const bool enableDebugFeatures,
+        const HANDLE completionPortHandle,
+        EInjectResult* const completedResult)
+    {
+      const HANDLE processHandle = OpenProcess(kRunningProcessAccessRights, FALSE, processId);
+      if (nullptr == processHandle)
+      {
+        *completedResult = EInjectResult::ErrorOpenProcess;
+        return nullptr;
+      }
+
+      SAsyncInjection* const injection = new SAsyncInjection();
+      injection->processId = processId;
+      injection->processHandle = processHandle;
+      injection->completionPortHandle = completionPortHandle;
+
+      EInjectResult operationResult = PrepareRunningProcessInjection(
+          processHandle, injection->phaseDurations, &injection->site);
+      if (EInjectResult::Success != operationResult)
+      {
+        injection->site.injectionThread = nullptr;
+        *completedResult = operationResult;
+        CompleteAsyncInjection(injection);
+        return nullptr;
+      }
+
+      injection->injector.emplace(
+          injection->site.injectedCodeBase,
+          injection->site.injectedDataBase,
+          true,
+          false,
+          injection->site.injectRegionsShared,
+          reinterpret_cast<void*>(injection->site.injectionThreadStartRoutine),
+          injection->site.injectRegionSize,
+          injection->site.injectRegionSize,
+          processHandle,
+          injection->site.injectionThread,
+          injection->arena);
+
+      injection->syncEvent = CreateEvent(nullptr, FALSE, FALSE, nullptr);
+      if (nullptr != injection->syncEvent)
+        injection->syncWait =
+            CreateThreadpoolWait(AsyncInjectionSyncWaitCallback, injection, nullptr);
+
+      // Without a thread pool wait there is no way to be notified of progress, so the injection
+      // is completed synchronously instead.
+      if (nullptr == injection->syncWait)
+      {
+        *completedResult =
+            injection->injector->SetAndRun(enableDebugFeatures, true, injection->phaseDurations);
+        CompleteAsyncInjection(injection);
+        return nullptr;
+      }
+
+      operationResult = injection->injector->SetAndStartRun(
+          enableDebugFeatures, true, injection->syncEvent, injection->phaseDurations);
+      if (EInjectResult::Success != operationResult)
+      {
+        *completedResult = operationResult;
+        CompleteAsyncInjection(injection);
+        return nullptr;
+      }
+
+      ArmAsyncInjectionWait(injection);
+      return injection;
+    }
+
+    /// Advances an asynchronous injection after a progress notification identifies it. Either the
+    /// injected code is done, in which case the injection is completed, or it is not, in which case
+    /// the injection waits for the next notification.
+    /// @param [in] injection Asynchronous injection, which is no longer valid if the injection
+    /// completes.
+    /// @param [out] completedResult Filled with the result of the injection if it completed.
+    /// @return `true` if the injection completed, `false` if it is still in progress.
+    static bool ContinueAsyncInjection(
+        SAsyncInjection* const injection, EInjectResult* const completedResult)
+    {
+      bool runFinished = false;
+      EInjectResult operationResult = injection->injector->CheckRunFinished(&runFinished);
+      if ((EInjectResult::Success == operationResult) && (false == runFinished))
+      {
+        ArmAsyncInjectionWait(injection);
+        return false;
+      }
+
+      if (EInjectResult::Success == operationResult)
+        operationResult = injection->injector->FinishStartedRun(injection->phaseDurations);
+
+      *completedResult = operationResult;
+      CompleteAsyncInjection(injection);
+      return true;
+    }
+
+    /// Outputs a message describing the result of injecting a process that joined an injection
+    /// job.
+    /// @param [in] processId Identifier of the injected process.
+    /// @param [in] result Result of the injection.
+    static void OutputInjectionJobResult(const DWORD processId, const EInjectResult result)
+    {
+      if (EInjectResult::Success == result)
+        Infra::Message::OutputFormatted(
+            Infra::Message::ESeverity::Info,
+            L"Successfully injected process %u after it joined the injection job.",
+            static_cast<unsigned int>(processId));
+      else
+        Infra::Message::OutputFormatted(
+            Infra::Message::ESeverity::Warning,
+            L"Failed to inject process %u after it joined the injection job: %s (%s)",
+            static_cast<unsigned int>(processId),
+            InjectResultString(result).data(),
+            Infra::Strings::FromSystemErrorCode(GetLastError()).AsCString());
+    }
+
+    /// Thread pool work item for injecting one of several running processes in parallel.
+    struct SParallelInjectItem
+    {
+      /// Result to be filled in for the process to inject.
+      SRunningProcessInjectResult* result;
+
+      /// Whether or not to enable debug features in the injected process.
+      bool enableDebugFeatures;
+
+      /// Enforces serialized access to the number of work items remaining.
+      std::mutex* mutex;
+
+      /// Notified each time a work item completes.
+      std::condition_variable* completed;
+
+      /// Number of work items that have not yet completed.
+      size_t* numRemaining;
+    };
+
+    /// Thread pool callback that injects a single running process on behalf of a parallel
+    /// injection. Takes ownership of the work item.
+    /// @param [in] instance Callback instance, or `nullptr` if invoked directly. Not used.
+    /// @param [in] context Work item, of type #SParallelInjectItem.
+    static void CALLBACK InjectRunningProcessCallback(PTP_CALLBACK_INSTANCE instance, PVOID context)
+    {
+      SParallelInjectItem* const item = reinterpret_cast<SParallelInjectItem*>(context);
+
+      item->result->result = InjectRunningProcess(
+          item->result->processId, item->enableDebugFeatures, &item->result->phaseDurations);
+      item->result->systemErrorCode = GetLastError();
+
+      do
+      {
+        std::unique_lock<std::mutex> lock(*item->mutex);
+        *item->numRemaining -= 1;
+      }
+      while (false);
+      item->completed->notify_all();
+
+      delete item;
+    }
+
+    /// Thread pool work item for serving one connection to the injector daemon.
+    struct SInjectorDaemonConnection
+    {
+      /// Handle of the connected instance of the named pipe, opened for overlapped I/O.
+      HANDLE pipeHandle;
+
+      /// Enforces serialized access to the number of connections being served.
+      std::mutex* mutex;
+
+      /// Notified each time a connection has been served.
+      std::condition_variable* completed;
+
+      /// Number of connections that are still being served.
+      size_t* numInProgress;
+    };
+
+    /// Creates an instance of the named pipe through which the injector daemon accepts requests.
+    /// Only processes running on the same computer can connect.
+    /// @param [in] pipeName Name of the named pipe.
+    /// @param [in] firstInstance Whether or not this is the first instance, in which case creation
+    /// fails if another process already created the named pipe.
+    /// @return Handle of the new instance, or `INVALID_HANDLE_VALUE` on failure.
+    static HANDLE CreateInjectorDaemonPipe(const wchar_t* pipeName, bool firstInstance)
+    {
+      return CreateNamedPipe(
+          pipeName,
+          PIPE_ACCESS_DUPLEX | FILE_FLAG_OVERLAPPED |
+              ((true == firstInstance) ? FILE_FLAG_FIRST_PIPE_INSTANCE : 0),
+          PIPE_TYPE_BYTE | PIPE_READMODE_BYTE | PIPE_WAIT | PIPE_REJECT_REMOTE_CLIENTS,
+          PIPE_UNLIMITED_INSTANCES,
+          static_cast<DWORD>(sizeof(InjectorDaemon::SResponse)),
+          0,
+          0,
+          nullptr);
+    }
+
+    /// Reads a string of the specified length from a connection to the injector daemon.
+    /// @param [in] pipeHandle Handle of the connected instance of the named pipe.
+    /// @param [in] length Number of characters to read.
+    /// @param [out] str Filled with the characters that were read, followed by a null character.
+    /// @return `true` if successful, `false` otherwise.
+    static bool ReadInjectorDaemonString(HANDLE pipeHandle, uint32_t length, std::wstring& str)
+    {
+      str.assign(static_cast<size_t>(length), L'\0');
+      return InjectorDaemon::ReadPipe(pipeHandle, str.data(), str.length() * sizeof(wchar_t));
+    }
+
+    /// Serves a single request submitted through a connection to the injector daemon by creating
+    /// and injecting the requested process and then giving the requesting process a handle to it.
+    /// @param [in] pipeHandle Handle of the connected instance of the named pipe.
+    static void ServeInjectorDaemonRequest(HANDLE pipeHandle)
+    {
+      InjectorDaemon::SRequestHeader requestHeader = {};
+      std::wstring commandLine;
+      std::wstring currentDirectory;
+      std::wstring environment;
+
+      if ((false == InjectorDaemon::ReadPipe(pipeHandle, &requestHeader, sizeof(requestHeader))) ||
+          (0 == requestHeader.commandLineLength) ||
+          (requestHeader.commandLineLength > InjectorDaemon::kMaxCommandLineLength) ||
+          (requestHeader.currentDirectoryLength > InjectorDaemon::kMaxCurrentDirectoryLength) ||
+          (requestHeader.environmentLength > InjectorDaemon::kMaxEnvironmentLength) ||
+          (1 == requestHeader.environmentLength))
+        return;
+
+      if ((false ==
+           ReadInjectorDaemonString(pipeHandle, requestHeader.commandLineLength, commandLine)) ||
+          (false ==
+           ReadInjectorDaemonString(
+               pipeHandle, requestHeader.currentDirectoryLength, currentDirectory)) ||
+          (false ==
+           ReadInjectorDaemonString(pipeHandle, requestHeader.environmentLength, environment)))
+        return;
+
+      // An environment block must end with two null characters, otherwise it cannot be used.
+      if ((false == environment.empty()) &&
+          ((L'\0' != environment[environment.length() - 1]) ||
+           (L'\0' != environment[environment.length() - 2])))
+        return;
+
+      InjectorDaemon::SResponse response = {
+          .injectionResult = static_cast<uint64_t>(EInjectResult::Failure),
+          .extendedInjectionResult = 0ull,
+          .processHandle = 0ull};
+
+      ULONG requestingProcessId = 0;
+      const HANDLE requestingProcessHandle =
+          ((FALSE != GetNamedPipeClientProcessId(pipeHandle, &requestingProcessId))
+               ? OpenProcess(PROCESS_DUP_HANDLE, FALSE, static_cast<DWORD>(requestingProcessId))
+               : nullptr);
+
+      if (nullptr == requestingProcessHandle)
+      {
+        response.injectionResult =
+            static_cast<uint64_t>(EInjectResult::ErrorInterProcessCommunicationFailed);
+        response.extendedInjectionResult = static_cast<uint64_t>(GetLastError());
+      }
+      else
+      {
+        STARTUPINFO startupInfo;
+        PROCESS_INFORMATION processInfo;
+        memset(reinterpret_cast<void*>(&startupInfo), 0, sizeof(startupInfo));
+        memset(reinterpret_cast<void*>(&processInfo), 0, sizeof(processInfo));
+        startupInfo.cb = sizeof(startupInfo);
+
+        const EInjectResult result = CreateInjectedProcess(
+            nullptr,
+            commandLine.data(),
+            nullptr,
+            nullptr,
+            FALSE,
+            CREATE_UNICODE_ENVIRONMENT,
+            ((true == environment.empty()) ? nullptr : environment.data()),
+            ((true == currentDirectory.empty()) ? nullptr : currentDirectory.c_str()),
+            &startupInfo,
+            &processInfo);
+        response.injectionResult = static_cast<uint64_t>(result);
+        response.extendedInjectionResult = static_cast<uint64_t>(GetLastError());
+
+        if (EInjectResult::Success == result)
+        {
+          Infra::Message::OutputFormatted(
+              Infra::Message::ESeverity::Info,
+              L"Injector daemon successfully injected process %u on behalf of process %u.",
+              (unsigned int)processInfo.dwProcessId,
+              (unsigned int)requestingProcessId);
+
+          HANDLE processHandleForRequester = nullptr;
+          if (FALSE !=
+              DuplicateHandle(
+                  GetCurrentProcess(),
+                  processInfo.hProcess,
+                  requestingProcessHandle,
+                  &processHandleForRequester,
+                  SYNCHRONIZE | PROCESS_QUERY_LIMITED_INFORMATION,
+                  FALSE,
+                  0))
+            response.processHandle = reinterpret_cast<uint64_t>(processHandleForRequester);
+        }
+        else
+        {
+          Infra::Message::OutputFormatted(
+              Infra::Message::ESeverity::Error,
+              L"Injector daemon failed to inject a process on behalf of process %u: %s (%s)",
+              (unsigned int)requestingProcessId,
+              InjectResultString(result).data(),
+              Infra::Strings::FromSystemErrorCode(
+                  static_cast<DWORD>(response.extendedInjectionResult))
+                  .AsCString());
+        }
+
+        if (nullptr != processInfo.hThread) CloseHandle(processInfo.hThread);
+        if (nullptr != processInfo.hProcess) CloseHandle(processInfo.hProcess);
+        CloseHandle(requestingProcessHandle);
+      }
+
+      if (true == InjectorDaemon::WritePipe(pipeHandle, &response, sizeof(response)))
+        FlushFileBuffers(pipeHandle);
+    }
+
+    /// Thread pool callback that serves a single connection to the injector daemon. Takes ownership
+    /// of the work item and of the named pipe instance it identifies.
+    /// @param [in] instance Callback instance, or `nullptr` if invoked directly. Not used.
+    /// @param [in] context Work item, of type #SInjectorDaemonConnection.
+    static void CALLBACK ServeInjectorDaemonConnectionCallback(
+        PTP_CALLBACK_INSTANCE instance, PVOID context)
+    {
+      SInjectorDaemonConnection* const connection =
+          reinterpret_cast<SInjectorDaemonConnection*>(context);
+
+      ServeInjectorDaemonRequest(connection->pipeHandle);
+      DisconnectNamedPipe(connection->pipeHandle);
+      CloseHandle(connection->pipeHandle);
+
+      do
+      {
+        std::unique_lock<std::mutex> lock(*connection->mutex);
+        *connection->numInProgress -= 1;
+      }
+      while (false);
+      connection->completed->notify_all();
+
+      delete connection;
+    }
+
+    /// Waits for a client to connect to an instance of the injector daemon's named pipe.
+    /// @param [in] pipeHandle Handle of the named pipe instance, opened for overlapped I/O.
+    /// @param [in] connectEvent Manual-reset event to use for waiting.
+    /// @return `true` if a client connected, `false` if none did before the idle timeout elapsed
+    /// or if waiting failed.
+    static bool WaitForInjectorDaemonConnection(HANDLE pipeHandle, HANDLE connectEvent)
+    {
+      OVERLAPPED overlapped = {.hEvent = connectEvent};
+      ResetEvent(connectEvent);
+
+      if (FALSE != ConnectNamedPipe(pipeHandle, &overlapped)) return true;
+
+      switch (GetLastError())
+      {
+        case ERROR_PIPE_CONNECTED:
+          return true;
+
+        case ERROR_IO_PENDING:
+          break;
+
+        default:
+          return false;
+      }
+
+      DWORD numBytesTransferred = 0;
+      if (WAIT_OBJECT_0 ==
+          WaitForSingleObject(connectEvent, InjectorDaemon::kIdleTimeoutMilliseconds))
+        return (FALSE != GetOverlappedResult(pipeHandle, &overlapped, &numBytesTransferred, FALSE));
+
+      // A client could connect between the wait timing out and the connection attempt being
+      // cancelled, in which case the connection attempt still succeeds.
+      CancelIo(pipeHandle);
+      return (FALSE != GetOverlappedResult(pipeHandle, &overlapped, &numBytesTransferred, TRUE));
+    }
+
     EInjectResult CreateInjectedProcess(
         LPCWSTR lpApplicationName,
         LPWSTR lpCommandLine,
@@ -590,7 +2278,8 @@ namespace Hookshot
         LPVOID lpEnvironment,
         LPCWSTR lpCurrentDirectory,
         LPSTARTUPINFOW lpStartupInfo,
-        LPPROCESS_INFORMATION lpProcessInformation)
+        LPPROCESS_INFORMATION lpProcessInformation,
+        Tracing::SInjectPhaseDurations* phaseDurations)
     {
       // This method creates processes in suspended state as part of injection functionality.
       // It will allow the new process to run, unless the caller requested a suspended process.
@@ -614,8 +2303,19 @@ namespace Hookshot
 
       *lpProcessInformation = processInfo;
 
+      Tracing::SInjectPhaseDurations localPhaseDurations;
+      if (nullptr == phaseDurations) phaseDurations = &localPhaseDurations;
+
       const EInjectResult result = InjectProcess(
-          processInfo.hProcess, processInfo.hThread, (IsDebuggerPresent() ? true : false));
+          processInfo.hProcess,
+          processInfo.hThread,
+          (IsDebuggerPresent() ? true : false),
+          *phaseDurations);
+
+      const DWORD injectSystemErrorCode = GetLastError();
+      Tracing::OutputInjectPhaseDurations(
+          Infra::Message::ESeverity::Info, processInfo.dwProcessId, *phaseDurations);
+      SetLastError(injectSystemErrorCode);
 
       if (EInjectResult::Success == result)
       {
@@ -631,21 +2331,325 @@ namespace Hookshot
       return result;
     }
 
+    bool ShouldInjectChildProcessesUsingJob(void)
+    {
+      static const bool injectChildProcessesUsingJob =
+          GetPerformanceProfile().injectChildProcessesUsingJob;
+
+      return injectChildProcessesUsingJob;
+    }
+
+    bool CreateInjectionJob(SInjectionJob* injectionJob)
+    {
+      const Infra::TemporaryString jobName =
+          Strings::InjectionJobObjectName(static_cast<uint32_t>(GetCurrentProcessId()));
+
+      const HANDLE jobHandle = CreateJobObject(nullptr, jobName.AsCString());
+      if (nullptr == jobHandle) return false;
+
+      const HANDLE completionPortHandle =
+          CreateIoCompletionPort(INVALID_HANDLE_VALUE, nullptr, 0, 1);
+      if (nullptr == completionPortHandle)
+      {
+        CloseHandle(jobHandle);
+        return false;
+      }
+
+      JOBOBJECT_ASSOCIATE_COMPLETION_PORT associateCompletionPort = {
+          .CompletionKey = jobHandle, .CompletionPort = completionPortHandle};
+      if ((FALSE ==
+           SetInformationJobObject(
+               jobHandle,
+               JobObjectAssociateCompletionPortInformation,
+               &associateCompletionPort,
+               sizeof(associateCompletionPort))) ||
+          (FALSE ==
+           SetEnvironmentVariable(
+               Strings::kStrInjectionJobEnvironmentVariableName.data(), jobName.AsCString())))
+      {
+        CloseHandle(completionPortHandle);
+        CloseHandle(jobHandle);
+        return false;
+      }
+
+      *injectionJob = {.jobHandle = jobHandle, .completionPortHandle = completionPortHandle};
+      return true;
+    }
+
+    bool ServeInjectionJob(
+        const SInjectionJob& injectionJob, const PROCESS_INFORMATION& rootProcessInfo)
+    {
+      const bool rootProcessAssigned =
+          (FALSE != AssignProcessToJobObject(injectionJob.jobHandle, rootProcessInfo.hProcess));
+      ResumeThread(rootProcessInfo.hThread);
+
+      if (true == rootProcessAssigned)
+      {
+        const bool enableDebugFeatures = (IsDebuggerPresent() ? true : false);
+
+        // Injections proceed concurrently, so the job is served until it has no more processes
+        // and every injection in progress has completed.
+        bool jobHasProcesses = true;
+        size_t numAsyncInjectionsInProgress = 0;
+
+        while ((true == jobHasProcesses) || (0 != numAsyncInjectionsInProgress))
+        {
+          DWORD message = 0;
+          ULONG_PTR completionKey = 0;
+          LPOVERLAPPED messageData = nullptr;
+
+          if (FALSE ==
+              GetQueuedCompletionStatus(
+                  injectionJob.completionPortHandle,
+                  &message,
+                  &completionKey,
+                  &messageData,
+                  INFINITE))
+            break;
+
+          if (kAsyncInjectionCompletionKey == completionKey)
+          {
+            SAsyncInjection* const injection = reinterpret_cast<SAsyncInjection*>(messageData);
+            const DWORD processId = injection->processId;
+
+            EInjectResult result = EInjectResult::Failure;
+            if (true == ContinueAsyncInjection(injection, &result))
+            {
+              numAsyncInjectionsInProgress -= 1;
+              OutputInjectionJobResult(processId, result);
+            }
+
+            continue;
+          }
+
+          if (JOB_OBJECT_MSG_ACTIVE_PROCESS_ZERO == message)
+          {
+            jobHasProcesses = false;
+            continue;
+          }
+
+          if (JOB_OBJECT_MSG_NEW_PROCESS != message) continue;
+
+          // For job notifications the overlapped pointer holds the identifier of the process.
+          const DWORD processId = static_cast<DWORD>(reinterpret_cast<size_t>(messageData));
+          if (rootProcessInfo.dwProcessId == processId) continue;
+
+          EInjectResult result = EInjectResult::Failure;
+          if (nullptr !=
+              StartAsyncInjection(
+                  processId, enableDebugFeatures, injectionJob.completionPortHandle, &result))
+            numAsyncInjectionsInProgress += 1;
+          else
+            OutputInjectionJobResult(processId, result);
+        }
+      }
+
+      CloseHandle(injectionJob.completionPortHandle);
+      CloseHandle(injectionJob.jobHandle);
+
+      return rootProcessAssigned;
+    }
+
+    EInjectResult InjectRunningProcess(
+        const DWORD processId,
+        const bool enableDebugFeatures,
+        Tracing::SInjectPhaseDurations* phaseDurations)
+    {
+      Tracing::SInjectPhaseDurations localPhaseDurations;
+      if (nullptr == phaseDurations) phaseDurations = &localPhaseDurations;
+
+      phaseDurations->Clear();
+
+      const HANDLE processHandle = OpenProcess(kRunningProcessAccessRights, FALSE, processId);
+      if (nullptr == processHandle) return EInjectResult::ErrorOpenProcess;
+
+      const EInjectResult result =
+          InjectRunningProcessUsingHandle(processHandle, enableDebugFeatures, *phaseDurations);
+
+      const DWORD systemErrorCode = GetLastError();
+      Tracing::OutputInjectPhaseDurations(
+          Infra::Message::ESeverity::Info, processId, *phaseDurations);
+      CloseHandle(processHandle);
+      SetLastError(systemErrorCode);
+
+      return result;
+    }
+
+    std::vector<SRunningProcessInjectResult> InjectRunningProcesses(
+        const std::vector<DWORD>& processIds, const bool enableDebugFeatures)
+    {
+      std::vector<SRunningProcessInjectResult> results(processIds.size());
+
+      std::mutex mutex;
+      std::condition_variable completed;
+      size_t numRemaining = processIds.size();
+
+      for (size_t i = 0; i < processIds.size(); ++i)
+      {
+        results[i].processId = processIds[i];
+        results[i].result = EInjectResult::Failure;
+        results[i].systemErrorCode = 0;
+
+        SParallelInjectItem* const item = new SParallelInjectItem{
+            .result = &results[i],
+            .enableDebugFeatures = enableDebugFeatures,
+            .mutex = &mutex,
+            .completed = &completed,
+            .numRemaining = &numRemaining};
+
+        // If a worker thread cannot be obtained, the process is injected on this thread instead.
+        if (FALSE == TrySubmitThreadpoolCallback(InjectRunningProcessCallback, item, nullptr))
+          InjectRunningProcessCallback(nullptr, item);
+      }
+
+      do
+      {
+        std::unique_lock<std::mutex> lock(mutex);
+        completed.wait(lock, [&numRemaining]() -> bool { return (0 == numRemaining); });
+      }
+      while (false);
+
+      return results;
+    }
+
     bool PerformRequestedRemoteInjection(
         RemoteProcessInjector::SInjectRequest* const remoteInjectionData)
     {
       EInjectResult operationResult = InjectProcess(
           reinterpret_cast<HANDLE>(remoteInjectionData->processHandle),
           reinterpret_cast<HANDLE>(remoteInjectionData->threadHandle),
-          remoteInjectionData->enableDebugFeatures);
+          remoteInjectionData->enableDebugFeatures,
+          remoteInjectionData->phaseDurations);
 
       remoteInjectionData->injectionResult = static_cast<uint64_t>(operationResult);
       remoteInjectionData->extendedInjectionResult = static_cast<uint64_t>(GetLastError());
 
+      Tracing::OutputInjectPhaseDurations(
+          Infra::Message::ESeverity::Info,
+          GetProcessId(reinterpret_cast<HANDLE>(remoteInjectionData->processHandle)),
+          remoteInjectionData->phaseDurations);
+
       CloseHandle(reinterpret_cast<HANDLE>(remoteInjectionData->processHandle));
       CloseHandle(reinterpret_cast<HANDLE>(remoteInjectionData->threadHandle));
 
       return true;
     }
+
+    bool ServeInjectorDaemon(void)
+    {
+      const Infra::TemporaryString pipeName = Strings::InjectorDaemonPipeName();
+
+      HANDLE pipeHandle = CreateInjectorDaemonPipe(pipeName.AsCString(), true);
+      if (INVALID_HANDLE_VALUE == pipeHandle)
+      {
+        // Another injector daemon is already serving requests, so there is nothing to do.
+        return (ERROR_ACCESS_DENIED == GetLastError());
+      }
+
+      const HANDLE connectEvent = CreateEvent(nullptr, TRUE, FALSE, nullptr);
+      if (nullptr == connectEvent)
+      {
+        CloseHandle(pipeHandle);
+        return false;
+      }
+
+      Infra::Message::OutputFormatted(
+          Infra::Message::ESeverity::Info,
+          L"Injector daemon is serving requests at %s.",
+          pipeName.AsCString());
+
+      std::mutex mutex;
+      std::condition_variable completed;
+      size_t numInProgress = 0;
+      bool serveResult = true;
+
+      while (true == WaitForInjectorDaemonConnection(pipeHandle, connectEvent))
+      {
+        // Another instance of the named pipe is created before the connected one is served, so
+        // that requests are accepted without interruption and served concurrently.
+        const HANDLE nextPipeHandle = CreateInjectorDaemonPipe(pipeName.AsCString(), false);
+
+        do
+        {
+          std::unique_lock<std::mutex> lock(mutex);
+          numInProgress += 1;
+        }
+        while (false);
+
+        SInjectorDaemonConnection* const connection = new SInjectorDaemonConnection{
+            .pipeHandle = pipeHandle,
+            .mutex = &mutex,
+            .completed = &completed,
+            .numInProgress = &numInProgress};
+
+        // If a worker thread cannot be obtained, the request is served on this thread instead.
+        if (FALSE ==
+            TrySubmitThreadpoolCallback(ServeInjectorDaemonConnectionCallback, connection, nullptr))
+          ServeInjectorDaemonConnectionCallback(nullptr, connection);
+
+        pipeHandle = nextPipeHandle;
+        if (INVALID_HANDLE_VALUE == pipeHandle)
+        {
+          serveResult = false;
+          break;
+        }
+      }
+
+      if (INVALID_HANDLE_VALUE != pipeHandle) CloseHandle(pipeHandle);
+      CloseHandle(connectEvent);
+
+      // Processes created on behalf of requests that are still being served would otherwise be
+      // left suspended and uninjected.
+      do
+      {
+        std::unique_lock<std::mutex> lock(mutex);
+        completed.wait(lock, [&numInProgress]() -> bool { return (0 == numInProgress); });
+      }
+      while (false);
+
+      if (true == serveResult)
+        Infra::Message::Output(
+            Infra::Message::ESeverity::Info,
+            L"Injector daemon is exiting because it has been idle.");
+
+      return serveResult;
+    }
+
+    bool ServeRemoteInjectionRequests(
+        RemoteProcessInjector::SInjectBrokerChannel* const brokerChannel)
+    {
+      const HANDLE requestReadyEvent = reinterpret_cast<HANDLE>(brokerChannel->requestReadyEvent);
+      const HANDLE requestCompleteEvent =
+          reinterpret_cast<HANDLE>(brokerChannel->requestCompleteEvent);
+      const HANDLE requestingProcessHandle =
+          reinterpret_cast<HANDLE>(brokerChannel->requestingProcessHandle);
+      const HANDLE waitHandles[] = {requestReadyEvent, requestingProcessHandle};
+
+      bool serveResult = true;
+
+      while (true == serveResult)
+      {
+        const DWORD waitResult =
+            WaitForMultipleObjects(_countof(waitHandles), waitHandles, FALSE, INFINITE);
+
+        if (WAIT_OBJECT_0 == waitResult)
+        {
+          serveResult = PerformRequestedRemoteInjection(&brokerChannel->request) &&
+              (FALSE != SetEvent(requestCompleteEvent));
+        }
+        else
+        {
+          // The requesting process terminated, which is the normal way for a broker to exit.
+          if ((WAIT_OBJECT_0 + 1) != waitResult) serveResult = false;
+          break;
+        }
+      }
+
+      CloseHandle(requestReadyEvent);
+      CloseHandle(requestCompleteEvent);
+      CloseHandle(requestingProcessHandle);
+
+      return serveResult;
+    }
   } // namespace ProcessInjector
 } // namespace Hookshot
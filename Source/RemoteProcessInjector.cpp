@@ -11,7 +11,9 @@
 
 #include "RemoteProcessInjector.h"
 
-#include <sstream>
+#include <cstdint>
+#include <cstdio>
+#include <mutex>
 #include <string_view>
 
 #include <Infra/Core/ProcessInfo.h>
@@ -24,99 +26,205 @@ namespace Hookshot
 {
   namespace RemoteProcessInjector
   {
-    EInjectResult InjectProcess(
-        const HANDLE processHandle,
-        const HANDLE threadHandle,
-        const bool switchArchitecture,
-        const bool enableDebugFeatures)
+    /// Maximum amount of time, in milliseconds, to wait for a broker to complete one request.
+    static constexpr DWORD kBrokerRequestTimeoutMilliseconds = 10000;
+
+    /// Holds the state of a broker instance of Hookshot from the perspective of the requesting
+    /// instance. All handles are valid in the requesting process.
+    struct SBroker
+    {
+      /// Handle of the broker process, or `nullptr` if no broker is running.
+      HANDLE processHandle;
+
+      /// Handle of the file mapping object that backs the broker channel.
+      HANDLE sharedMemoryHandle;
+
+      /// Mapped view of the broker channel.
+      SInjectBrokerChannel* channel;
+
+      /// Event signalled to submit a request to the broker.
+      HANDLE requestReadyEvent;
+
+      /// Event signalled by the broker when a request is complete.
+      HANDLE requestCompleteEvent;
+    };
+
+    /// Enforces serialized access to the broker state and therefore to the broker channels.
+    static std::mutex brokerMutex;
+
+    /// Brokers for same-architecture and other-architecture injection, in that order.
+    static SBroker brokers[2];
+
+    /// Releases all resources associated with a broker and resets its state. If the broker process
+    /// is still running, it is terminated.
+    /// @param [in,out] broker Broker to destroy.
+    static void DestroyBroker(SBroker& broker)
+    {
+      if (nullptr != broker.processHandle)
+      {
+        Protected::Windows_TerminateProcess(broker.processHandle, ~(0u));
+        Protected::Windows_CloseHandle(broker.processHandle);
+      }
+
+      if (nullptr != broker.channel) Protected::Windows_UnmapViewOfFile(broker.channel);
+      if (nullptr != broker.sharedMemoryHandle)
+        Protected::Windows_CloseHandle(broker.sharedMemoryHandle);
+      if (nullptr != broker.requestReadyEvent)
+        Protected::Windows_CloseHandle(broker.requestReadyEvent);
+      if (nullptr != broker.requestCompleteEvent)
+        Protected::Windows_CloseHandle(broker.requestCompleteEvent);
+
+      broker = {};
+    }
+
+    /// Duplicates a handle from this process into a broker process.
+    /// @param [in] brokerProcessHandle Handle of the broker process.
+    /// @param [in] handle Handle to duplicate.
+    /// @param [out] duplicateHandle Filled with the handle value that is valid in the broker.
+    /// @return `true` on success, `false` on failure.
+    static bool DuplicateHandleIntoBroker(
+        const HANDLE brokerProcessHandle, const HANDLE handle, uint64_t* const duplicateHandle)
+    {
+      HANDLE duplicate = nullptr;
+      if (FALSE ==
+          Protected::Windows_DuplicateHandle(
+              Infra::ProcessInfo::GetCurrentProcessHandle(),
+              handle,
+              brokerProcessHandle,
+              &duplicate,
+              0,
+              FALSE,
+              DUPLICATE_SAME_ACCESS))
+        return false;
+
+      *duplicateHandle = reinterpret_cast<uint64_t>(duplicate);
+      return true;
+    }
+
+    /// Spawns a broker instance of the Hookshot executable and sets up the channel through which
+    /// it receives requests. On failure, the broker state is left empty.
+    /// @param [in] switchArchitecture If `true`, the broker targets the other processor
+    /// architecture.
+    /// @param [out] broker Filled with the state of the new broker.
+    /// @return Indicator of the result of the operation.
+    static EInjectResult StartBroker(const bool switchArchitecture, SBroker& broker)
     {
       // Obtain the name of the Hookshot executable to spawn.
-      // Hold both the application name and the command-line arguments, enclosing the application
-      // name in quotes. At most the argument needs to represent a 64-bit integer in hexadecimal, so
-      // two characters per byte, plus a space, an indicator character and a null character.
       const std::wstring_view executableFileName =
           (switchArchitecture ? Strings::GetHookshotExecutableOtherArchitectureFilename()
                               : Strings::GetHookshotExecutableFilename());
-      const size_t executableArgumentMaxCount = 3 + (2 * sizeof(uint64_t));
-      const size_t executableCommandLineMaxCount =
-          3 + executableFileName.length() + executableArgumentMaxCount;
-
-      std::wstringstream executableCommandLine;
-      executableCommandLine << L'\"' << executableFileName << L'\"';
-
-      // Create an anonymous file mapping object backed by the system paging file, and ensure it can
-      // be inherited by child processes. This has the effect of creating an anonymous shared memory
-      // object. The resulting handle must be passed to the new instance of Hookshot that is
-      // spawned.
-      SECURITY_ATTRIBUTES sharedMemorySecurityAttributes{
-          .nLength = sizeof(sharedMemorySecurityAttributes),
-          .lpSecurityDescriptor = nullptr,
-          .bInheritHandle = TRUE};
-
-      HANDLE sharedMemoryHandle = Protected::Windows_CreateFileMapping(
+
+      // Create an anonymous file mapping object backed by the system paging file. This has the
+      // effect of creating an anonymous shared memory object. The resulting handle must be passed
+      // to the new instance of Hookshot that is spawned, and it is the only handle that the new
+      // instance inherits. It is only made inheritable while the new instance is being created, so
+      // that child processes this process creates for its own purposes never inherit it.
+      broker.sharedMemoryHandle = Protected::Windows_CreateFileMapping(
           INVALID_HANDLE_VALUE,
-          &sharedMemorySecurityAttributes,
+          nullptr,
           PAGE_READWRITE,
           0,
-          sizeof(RemoteProcessInjector::SInjectRequest),
+          sizeof(SInjectBrokerChannel),
           nullptr);
+      if (nullptr == broker.sharedMemoryHandle)
+        return EInjectResult::ErrorInterProcessCommunicationFailed;
 
-      if (nullptr == sharedMemoryHandle) return EInjectResult::ErrorInterProcessCommunicationFailed;
-
-      RemoteProcessInjector::SInjectRequest* const sharedInfo =
-          reinterpret_cast<RemoteProcessInjector::SInjectRequest*>(
-              Protected::Windows_MapViewOfFile(sharedMemoryHandle, FILE_MAP_ALL_ACCESS, 0, 0, 0));
-
-      if (nullptr == sharedInfo)
+      broker.channel = reinterpret_cast<SInjectBrokerChannel*>(Protected::Windows_MapViewOfFile(
+          broker.sharedMemoryHandle, FILE_MAP_ALL_ACCESS, 0, 0, 0));
+      broker.requestReadyEvent = Protected::Windows_CreateEvent(nullptr, FALSE, FALSE, nullptr);
+      broker.requestCompleteEvent = Protected::Windows_CreateEvent(nullptr, FALSE, FALSE, nullptr);
+      if ((nullptr == broker.channel) || (nullptr == broker.requestReadyEvent) ||
+          (nullptr == broker.requestCompleteEvent))
       {
         const DWORD extendedResult = Protected::Windows_GetLastError();
-        Protected::Windows_CloseHandle(sharedMemoryHandle);
+        DestroyBroker(broker);
         Protected::Windows_SetLastError(extendedResult);
         return EInjectResult::ErrorInterProcessCommunicationFailed;
       }
 
-      // Append the command-line argument to pass to the new Hookshot instance and convert to a
-      // mutable string, as required by CreateProcess.
-      executableCommandLine << L' ' << Strings::kCharCmdlineIndicatorFileMappingHandle << std::hex
-                            << reinterpret_cast<uint64_t>(sharedMemoryHandle);
-
+      // Build the command line directly in a mutable string, as required by CreateProcess. It holds
+      // both the application name, enclosed in quotes, and the command-line argument to pass to the
+      // new Hookshot instance. At most the argument needs to represent a 64-bit integer in
+      // hexadecimal, so two characters per byte, plus a space, an indicator character and a null
+      // character.
       Infra::TemporaryBuffer<wchar_t> executableCommandLineMutableString;
-      if (0 !=
-          wcscpy_s(
+      if (0 >
+          _snwprintf_s(
               executableCommandLineMutableString.Data(),
               executableCommandLineMutableString.Capacity(),
-              executableCommandLine.str().c_str()))
+              _TRUNCATE,
+              L"\"%.*s\" %c%llx",
+              static_cast<int>(executableFileName.length()),
+              executableFileName.data(),
+              Strings::kCharCmdlineIndicatorFileMappingHandle,
+              static_cast<unsigned long long>(
+                  reinterpret_cast<uint64_t>(broker.sharedMemoryHandle))))
       {
         const DWORD extendedResult = Protected::Windows_GetLastError();
-        Protected::Windows_UnmapViewOfFile(sharedInfo);
-        Protected::Windows_CloseHandle(sharedMemoryHandle);
+        DestroyBroker(broker);
         Protected::Windows_SetLastError(extendedResult);
         return EInjectResult::ErrorCannotGenerateExecutableFilename;
       }
 
+      // Restrict handle inheritance to just the file mapping object. The broker is long-lived, so
+      // inheriting arbitrary handles from this process could keep them open well past when this
+      // process closes them.
+      Infra::TemporaryBuffer<uint8_t> attributeListBuffer;
+      SIZE_T attributeListSize = static_cast<SIZE_T>(attributeListBuffer.CapacityBytes());
+      LPPROC_THREAD_ATTRIBUTE_LIST attributeList =
+          reinterpret_cast<LPPROC_THREAD_ATTRIBUTE_LIST>(attributeListBuffer.Data());
+
+      if ((FALSE ==
+           Protected::Windows_InitializeProcThreadAttributeList(
+               attributeList, 1, 0, &attributeListSize)) ||
+          (FALSE ==
+           Protected::Windows_UpdateProcThreadAttribute(
+               attributeList,
+               0,
+               PROC_THREAD_ATTRIBUTE_HANDLE_LIST,
+               &broker.sharedMemoryHandle,
+               sizeof(broker.sharedMemoryHandle),
+               nullptr,
+               nullptr)))
+      {
+        const DWORD extendedResult = Protected::Windows_GetLastError();
+        DestroyBroker(broker);
+        Protected::Windows_SetLastError(extendedResult);
+        return EInjectResult::ErrorInterProcessCommunicationFailed;
+      }
+
       // Create the new instance of Hookshot.
-      STARTUPINFO startupInfo;
+      STARTUPINFOEX startupInfo;
       PROCESS_INFORMATION processInfo;
       memset(reinterpret_cast<void*>(&startupInfo), 0, sizeof(startupInfo));
       memset(reinterpret_cast<void*>(&processInfo), 0, sizeof(processInfo));
+      startupInfo.StartupInfo.cb = sizeof(startupInfo);
+      startupInfo.lpAttributeList = attributeList;
 
-      if (FALSE ==
-          Protected::Windows_CreateProcess(
-              nullptr,
-              executableCommandLineMutableString.Data(),
-              nullptr,
-              nullptr,
-              TRUE,
-              CREATE_SUSPENDED,
-              nullptr,
-              nullptr,
-              &startupInfo,
-              &processInfo))
+      BOOL createProcessResult = Protected::Windows_SetHandleInformation(
+          broker.sharedMemoryHandle, HANDLE_FLAG_INHERIT, HANDLE_FLAG_INHERIT);
+      if (FALSE != createProcessResult)
       {
-        const DWORD extendedResult = Protected::Windows_GetLastError();
-        Protected::Windows_UnmapViewOfFile(sharedInfo);
-        Protected::Windows_CloseHandle(sharedMemoryHandle);
-        Protected::Windows_SetLastError(extendedResult);
+        createProcessResult = Protected::Windows_CreateProcess(
+            nullptr,
+            executableCommandLineMutableString.Data(),
+            nullptr,
+            nullptr,
+            TRUE,
+            CREATE_SUSPENDED | EXTENDED_STARTUPINFO_PRESENT,
+            nullptr,
+            nullptr,
+            &startupInfo.StartupInfo,
+            &processInfo);
+      }
+      const DWORD createProcessExtendedResult = Protected::Windows_GetLastError();
+      Protected::Windows_SetHandleInformation(broker.sharedMemoryHandle, HANDLE_FLAG_INHERIT, 0);
+      Protected::Windows_DeleteProcThreadAttributeList(attributeList);
+
+      if (FALSE == createProcessResult)
+      {
+        DestroyBroker(broker);
+        Protected::Windows_SetLastError(createProcessExtendedResult);
 
         if (true == switchArchitecture)
           return EInjectResult::ErrorCreateHookshotOtherArchitectureProcessFailed;
@@ -124,81 +232,100 @@ namespace Hookshot
           return EInjectResult::ErrorCreateHookshotProcessFailed;
       }
 
-      // Fill in the required inputs to the new instance of Hookshot.
-      HANDLE duplicateProcessHandle = INVALID_HANDLE_VALUE;
-      HANDLE duplicateThreadHandle = INVALID_HANDLE_VALUE;
+      broker.processHandle = processInfo.hProcess;
 
-      if ((FALSE ==
-           Protected::Windows_DuplicateHandle(
+      // Fill in the handles the new instance of Hookshot needs to serve requests.
+      if ((false ==
+           DuplicateHandleIntoBroker(
+               broker.processHandle,
+               broker.requestReadyEvent,
+               &broker.channel->requestReadyEvent)) ||
+          (false ==
+           DuplicateHandleIntoBroker(
+               broker.processHandle,
+               broker.requestCompleteEvent,
+               &broker.channel->requestCompleteEvent)) ||
+          (false ==
+           DuplicateHandleIntoBroker(
+               broker.processHandle,
                Infra::ProcessInfo::GetCurrentProcessHandle(),
-               processHandle,
-               processInfo.hProcess,
-               &duplicateProcessHandle,
-               0,
-               FALSE,
-               DUPLICATE_SAME_ACCESS)) ||
-          (FALSE ==
-           Protected::Windows_DuplicateHandle(
-               Infra::ProcessInfo::GetCurrentProcessHandle(),
-               threadHandle,
-               processInfo.hProcess,
-               &duplicateThreadHandle,
-               0,
-               FALSE,
-               DUPLICATE_SAME_ACCESS)))
+               &broker.channel->requestingProcessHandle)))
       {
         const DWORD extendedResult = Protected::Windows_GetLastError();
-        Protected::Windows_TerminateProcess(processInfo.hProcess, (UINT)-1);
-        Protected::Windows_CloseHandle(processInfo.hProcess);
         Protected::Windows_CloseHandle(processInfo.hThread);
-        Protected::Windows_UnmapViewOfFile(sharedInfo);
-        Protected::Windows_CloseHandle(sharedMemoryHandle);
+        DestroyBroker(broker);
         Protected::Windows_SetLastError(extendedResult);
         return EInjectResult::ErrorInterProcessCommunicationFailed;
       }
 
-      sharedInfo->processHandle = reinterpret_cast<uint64_t>(duplicateProcessHandle);
-      sharedInfo->threadHandle = reinterpret_cast<uint64_t>(duplicateThreadHandle);
-      sharedInfo->enableDebugFeatures = enableDebugFeatures;
-      sharedInfo->injectionResult = static_cast<uint64_t>(EInjectResult::Failure);
-      sharedInfo->extendedInjectionResult = 0ull;
-
-      // Let the new instance of Hookshot run and wait for it to finish.
       Protected::Windows_ResumeThread(processInfo.hThread);
+      Protected::Windows_CloseHandle(processInfo.hThread);
+      return EInjectResult::Success;
+    }
+
+    EInjectResult InjectProcess(
+        const HANDLE processHandle,
+        const HANDLE threadHandle,
+        const bool switchArchitecture,
+        const bool enableDebugFeatures,
+        Tracing::SInjectPhaseDurations* phaseDurations)
+    {
+      if (nullptr != phaseDurations) phaseDurations->Clear();
+
+      std::unique_lock<std::mutex> lock(brokerMutex);
+      SBroker& broker = brokers[(true == switchArchitecture) ? 1 : 0];
+
+      // A broker that has exited for any reason needs to be replaced.
+      if ((nullptr != broker.processHandle) &&
+          (WAIT_TIMEOUT != Protected::Windows_WaitForSingleObject(broker.processHandle, 0)))
+        DestroyBroker(broker);
 
-      if (WAIT_OBJECT_0 != Protected::Windows_WaitForSingleObject(processInfo.hProcess, 10000))
+      if (nullptr == broker.processHandle)
+      {
+        const EInjectResult startResult = StartBroker(switchArchitecture, broker);
+        if (EInjectResult::Success != startResult) return startResult;
+      }
+
+      // Fill in the required inputs to the broker. Handles duplicated into the broker are closed by
+      // the broker once it has processed the request.
+      SInjectRequest& request = broker.channel->request;
+
+      if ((false ==
+           DuplicateHandleIntoBroker(
+               broker.processHandle, processHandle, &request.processHandle)) ||
+          (false ==
+           DuplicateHandleIntoBroker(broker.processHandle, threadHandle, &request.threadHandle)))
       {
         const DWORD extendedResult = Protected::Windows_GetLastError();
-        Protected::Windows_TerminateProcess(processInfo.hProcess, ~(0u));
-        Protected::Windows_CloseHandle(processInfo.hProcess);
-        Protected::Windows_CloseHandle(processInfo.hThread);
-        Protected::Windows_UnmapViewOfFile(sharedInfo);
-        Protected::Windows_CloseHandle(sharedMemoryHandle);
+        DestroyBroker(broker);
         Protected::Windows_SetLastError(extendedResult);
         return EInjectResult::ErrorInterProcessCommunicationFailed;
       }
 
-      // Obtain results from the new instance of Hookshot, clean up, and return.
-      DWORD injectExitCode = 0;
-      if ((FALSE == Protected::Windows_GetExitCodeProcess(processInfo.hProcess, &injectExitCode)) ||
-          (0 != injectExitCode))
+      request.enableDebugFeatures = enableDebugFeatures;
+      request.injectionResult = static_cast<uint64_t>(EInjectResult::Failure);
+      request.extendedInjectionResult = 0ull;
+      request.phaseDurations.Clear();
+
+      // Submit the request and wait for the broker to finish it. If the broker exits or takes too
+      // long, it is discarded so that the next request starts a fresh one.
+      const HANDLE waitHandles[] = {broker.requestCompleteEvent, broker.processHandle};
+
+      Protected::Windows_SetEvent(broker.requestReadyEvent);
+      if (WAIT_OBJECT_0 !=
+          Protected::Windows_WaitForMultipleObjects(
+              _countof(waitHandles), waitHandles, FALSE, kBrokerRequestTimeoutMilliseconds))
       {
         const DWORD extendedResult = Protected::Windows_GetLastError();
-        Protected::Windows_CloseHandle(processInfo.hProcess);
-        Protected::Windows_CloseHandle(processInfo.hThread);
-        Protected::Windows_UnmapViewOfFile(sharedInfo);
-        Protected::Windows_CloseHandle(sharedMemoryHandle);
+        DestroyBroker(broker);
         Protected::Windows_SetLastError(extendedResult);
         return EInjectResult::ErrorInterProcessCommunicationFailed;
       }
 
-      EInjectResult operationResult = static_cast<EInjectResult>(sharedInfo->injectionResult);
-      DWORD extendedResult = static_cast<DWORD>(sharedInfo->extendedInjectionResult);
-      Protected::Windows_CloseHandle(processInfo.hProcess);
-      Protected::Windows_CloseHandle(processInfo.hThread);
-      Protected::Windows_UnmapViewOfFile(sharedInfo);
-      Protected::Windows_CloseHandle(sharedMemoryHandle);
-      Protected::Windows_SetLastError(extendedResult);
+      // Obtain results from the broker and return.
+      EInjectResult operationResult = static_cast<EInjectResult>(request.injectionResult);
+      Protected::Windows_SetLastError(static_cast<DWORD>(request.extendedInjectionResult));
+      if (nullptr != phaseDurations) *phaseDurations = request.phaseDurations;
 
       // Some errors are architecture-specific as a way of helping the user understand the issue.
       if (true == switchArchitecture)
@@ -0,0 +1,816 @@
+/***************************************************************************************************
+ * Hookshot
+ *   General-purpose library for injecting DLLs and hooking function calls.
+ ***************************************************************************************************
+ * Authored by Samuel Grossman
+ * Copyright (c) 2019-2025
+ ***********************************************************************************************//**
+ * @file SampledTiming.cpp
+ *   Implementation of timing a sample of the calls that pass through sampled timing stubs.
+ **************************************************************************************************/
+
+#include "SampledTiming.h"
+
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <deque>
+#include <intrin.h>
+
+#include <Infra/Core/Message.h>
+#include <Infra/Core/ProcessInfo.h>
+
+#include "ApiWindows.h"
+#include "DependencyProtect.h"
+#include "Globals.h"
+#include "HookStore.h"
+#include "Strings.h"
+
+namespace Hookshot
+{
+  namespace SampledTiming
+  {
+    /// Shared sampling code, to which every sampled timing stub jumps after loading its own address
+    /// whenever its countdown runs out. Resets the countdown and then, unless the calling thread is
+    /// already timing a call or another thread is already timing a call through the same stub,
+    /// takes ownership of the stub's sample block, moves the return address into the sample block,
+    /// reads the time stamp counter, and calls the address held in the stub. Otherwise, it jumps to
+    /// the address held in the stub. The second half runs when the call returns. It reads the time
+    /// stamp counter again, adds the call to the histogram, releases the sample block, and returns
+    /// to the original return address. The sample block in use is found through a thread-local
+    /// storage slot held directly in the thread environment block. In 64-bit mode, the stub's
+    /// address arrives in r11, and the parameter registers that reading the time stamp counter
+    /// overwrites are saved in the sample block. Every call is paired with a return to the address
+    /// it pushed, so the sampling code works in processes that enforce shadow stacks, and the
+    /// called function sees exactly the stack it would have seen without sampling. In 32-bit mode,
+    /// where shadow stacks are not enforced, the stub's address arrives on the top of the stack,
+    /// the return address is replaced with the address of the second half, and every register that
+    /// is used is saved and restored. Return values are preserved, and the flags are modified. If
+    /// caller recording is enabled, the second half also stores the original return address in the
+    /// next caller slot of the sample block. Otherwise, it jumps over the instructions that do so.
+    static constexpr uint8_t kSamplerCode[] = {
+#ifdef _WIN64
+        // mov eax, DWORD PTR [r11+52]
+        0x41,
+        0x8b,
+        0x43,
+        0x34,
+
+
+        // mov DWORD PTR [r11+48], eax
+        0x41,
+        0x89,
+        0x43,
+        0x30,
+
+
+        // mov r10, QWORD PTR gs:[<sample slot offset>]
+        0x65,
+        0x4c,
+        0x8b,
+        0x14,
+        0x25,
+        0x00,
+        0x00,
+        0x00,
+        0x00,
+
+
+        // test r10, r10
+        0x4d,
+        0x85,
+        0xd2,
+
+
+        // jnz $+19
+        0x75,
+        0x11,
+
+
+        // mov r10, QWORD PTR [r11+56]
+        0x4d,
+        0x8b,
+        0x53,
+        0x38,
+
+
+        // mov eax, 1
+        0xb8,
+        0x01,
+        0x00,
+        0x00,
+        0x00,
+
+
+        // xchg DWORD PTR [r10+16], eax
+        0x41,
+        0x87,
+        0x42,
+        0x10,
+
+
+        // test eax, eax
+        0x85,
+        0xc0,
+
+
+        // jz $+6
+        0x74,
+        0x04,
+
+
+        // jmp QWORD PTR [r11+32]
+        0x41,
+        0xff,
+        0x63,
+        0x20,
+
+
+        // mov QWORD PTR [r10+24], rcx
+        0x49,
+        0x89,
+        0x4a,
+        0x18,
+
+
+        // mov QWORD PTR [r10+32], rdx
+        0x49,
+        0x89,
+        0x52,
+        0x20,
+
+
+        // pop QWORD PTR [r10]
+        0x41,
+        0x8f,
+        0x02,
+
+
+        // mov QWORD PTR gs:[<sample slot offset>], r10
+        0x65,
+        0x4c,
+        0x89,
+        0x14,
+        0x25,
+        0x00,
+        0x00,
+        0x00,
+        0x00,
+
+
+        // rdtscp
+        0x0f,
+        0x01,
+        0xf9,
+
+
+        // shl rdx, 32
+        0x48,
+        0xc1,
+        0xe2,
+        0x20,
+
+
+        // or rax, rdx
+        0x48,
+        0x09,
+        0xd0,
+
+
+        // mov QWORD PTR [r10+8], rax
+        0x49,
+        0x89,
+        0x42,
+        0x08,
+
+
+        // mov rcx, QWORD PTR [r10+24]
+        0x49,
+        0x8b,
+        0x4a,
+        0x18,
+
+
+        // mov rdx, QWORD PTR [r10+32]
+        0x49,
+        0x8b,
+        0x52,
+        0x20,
+
+
+        // call QWORD PTR [r11+32]
+        0x41,
+        0xff,
+        0x53,
+        0x20,
+
+
+        // mov r9, rax
+        0x49,
+        0x89,
+        0xc1,
+
+
+        // rdtscp
+        0x0f,
+        0x01,
+        0xf9,
+
+
+        // shl rdx, 32
+        0x48,
+        0xc1,
+        0xe2,
+        0x20,
+
+
+        // or rax, rdx
+        0x48,
+        0x09,
+        0xd0,
+
+
+        // mov r10, QWORD PTR gs:[<sample slot offset>]
+        0x65,
+        0x4c,
+        0x8b,
+        0x14,
+        0x25,
+        0x00,
+        0x00,
+        0x00,
+        0x00,
+
+
+        // sub rax, QWORD PTR [r10+8]
+        0x49,
+        0x2b,
+        0x42,
+        0x08,
+
+
+        // or rax, 1
+        0x48,
+        0x83,
+        0xc8,
+        0x01,
+
+
+        // bsr rcx, rax
+        0x48,
+        0x0f,
+        0xbd,
+        0xc8,
+
+
+        // inc QWORD PTR [r10+rcx*8+64]
+        0x49,
+        0xff,
+        0x44,
+        0xca,
+        0x40,
+
+
+        // mov rcx, QWORD PTR [r10]
+        0x49,
+        0x8b,
+        0x0a,
+
+
+        // jmp $+21
+        0xeb,
+        0x13,
+
+
+        // mov eax, DWORD PTR [r10+20]
+        0x41,
+        0x8b,
+        0x42,
+        0x14,
+
+
+        // inc DWORD PTR [r10+20]
+        0x41,
+        0xff,
+        0x42,
+        0x14,
+
+
+        // and eax, <number of caller slots - 1>
+        0x83,
+        0xe0,
+        0x1f,
+
+
+        // mov QWORD PTR [r10+rax*8+576], rcx
+        0x49,
+        0x89,
+        0x8c,
+        0xc2,
+        0x40,
+        0x02,
+        0x00,
+        0x00,
+
+
+        // xor edx, edx
+        0x31,
+        0xd2,
+
+
+        // mov QWORD PTR gs:[<sample slot offset>], rdx
+        0x65,
+        0x48,
+        0x89,
+        0x14,
+        0x25,
+        0x00,
+        0x00,
+        0x00,
+        0x00,
+
+
+        // mov DWORD PTR [r10+16], edx
+        0x41,
+        0x89,
+        0x52,
+        0x10,
+
+
+        // mov rax, r9
+        0x4c,
+        0x89,
+        0xc8,
+
+
+        // push rcx
+        0x51,
+
+
+        // ret
+        0xc3,
+#else
+        // push eax
+        0x50,
+
+        // push ecx
+        0x51,
+
+        // push edx
+        0x52,
+
+        // mov eax, DWORD PTR [esp+12]
+        0x8b,
+        0x44,
+        0x24,
+        0x0c,
+
+        // mov ecx, DWORD PTR [eax+52]
+        0x8b,
+        0x48,
+        0x34,
+
+        // mov DWORD PTR [eax+48], ecx
+        0x89,
+        0x48,
+        0x30,
+
+        // mov ecx, DWORD PTR fs:[<sample slot offset>]
+        0x64,
+        0x8b,
+        0x0d,
+        0x00,
+        0x00,
+        0x00,
+        0x00,
+
+        // test ecx, ecx
+        0x85,
+        0xc9,
+
+        // jnz $+54
+        0x75,
+        0x34,
+
+        // mov ecx, DWORD PTR [eax+56]
+        0x8b,
+        0x48,
+        0x38,
+
+        // mov edx, 1
+        0xba,
+        0x01,
+        0x00,
+        0x00,
+        0x00,
+
+        // xchg DWORD PTR [ecx+16], edx
+        0x87,
+        0x51,
+        0x10,
+
+        // test edx, edx
+        0x85,
+        0xd2,
+
+        // jnz $+39
+        0x75,
+        0x25,
+
+        // mov edx, DWORD PTR [esp+16]
+        0x8b,
+        0x54,
+        0x24,
+        0x10,
+
+        // mov DWORD PTR [ecx], edx
+        0x89,
+        0x11,
+
+        // mov DWORD PTR [esp+16], <epilogue>
+        0xc7,
+        0x44,
+        0x24,
+        0x10,
+        0x00,
+        0x00,
+        0x00,
+        0x00,
+
+        // mov DWORD PTR fs:[<sample slot offset>], ecx
+        0x64,
+        0x89,
+        0x0d,
+        0x00,
+        0x00,
+        0x00,
+        0x00,
+
+        // rdtscp
+        0x0f,
+        0x01,
+        0xf9,
+
+        // mov ecx, DWORD PTR fs:[<sample slot offset>]
+        0x64,
+        0x8b,
+        0x0d,
+        0x00,
+        0x00,
+        0x00,
+        0x00,
+
+        // mov DWORD PTR [ecx+8], eax
+        0x89,
+        0x41,
+        0x08,
+
+        // mov DWORD PTR [ecx+12], edx
+        0x89,
+        0x51,
+        0x0c,
+
+        // mov eax, DWORD PTR [esp+12]
+        0x8b,
+        0x44,
+        0x24,
+        0x0c,
+
+        // mov eax, DWORD PTR [eax+32]
+        0x8b,
+        0x40,
+        0x20,
+
+        // mov DWORD PTR [esp+12], eax
+        0x89,
+        0x44,
+        0x24,
+        0x0c,
+
+        // pop edx
+        0x5a,
+
+        // pop ecx
+        0x59,
+
+        // pop eax
+        0x58,
+
+        // ret
+        0xc3,
+
+        // push eax
+        0x50,
+
+        // push edx
+        0x52,
+
+        // rdtscp
+        0x0f,
+        0x01,
+        0xf9,
+
+        // mov ecx, DWORD PTR fs:[<sample slot offset>]
+        0x64,
+        0x8b,
+        0x0d,
+        0x00,
+        0x00,
+        0x00,
+        0x00,
+
+        // sub eax, DWORD PTR [ecx+8]
+        0x2b,
+        0x41,
+        0x08,
+
+        // sbb edx, DWORD PTR [ecx+12]
+        0x1b,
+        0x51,
+        0x0c,
+
+        // test edx, edx
+        0x85,
+        0xd2,
+
+        // jz $+10
+        0x74,
+        0x08,
+
+        // bsr eax, edx
+        0x0f,
+        0xbd,
+        0xc2,
+
+        // add eax, 32
+        0x83,
+        0xc0,
+        0x20,
+
+        // jmp $+8
+        0xeb,
+        0x06,
+
+        // or eax, 1
+        0x83,
+        0xc8,
+        0x01,
+
+        // bsr eax, eax
+        0x0f,
+        0xbd,
+        0xc0,
+
+        // add DWORD PTR [ecx+eax*8+64], 1
+        0x83,
+        0x44,
+        0xc1,
+        0x40,
+        0x01,
+
+        // adc DWORD PTR [ecx+eax*8+68], 0
+        0x83,
+        0x54,
+        0xc1,
+        0x44,
+        0x00,
+
+        // mov eax, DWORD PTR [ecx]
+        0x8b,
+        0x01,
+
+        // jmp $+18
+        0xeb,
+        0x10,
+
+        // mov edx, DWORD PTR [ecx+20]
+        0x8b,
+        0x51,
+        0x14,
+
+        // inc DWORD PTR [ecx+20]
+        0xff,
+        0x41,
+        0x14,
+
+        // and edx, <number of caller slots - 1>
+        0x83,
+        0xe2,
+        0x1f,
+
+        // mov DWORD PTR [ecx+edx*8+576], eax
+        0x89,
+        0x84,
+        0xd1,
+        0x40,
+        0x02,
+        0x00,
+        0x00,
+
+        // xor edx, edx
+        0x31,
+        0xd2,
+
+        // mov DWORD PTR fs:[<sample slot offset>], edx
+        0x64,
+        0x89,
+        0x15,
+        0x00,
+        0x00,
+        0x00,
+        0x00,
+
+        // mov DWORD PTR [ecx+16], edx
+        0x89,
+        0x51,
+        0x10,
+
+        // mov ecx, eax
+        0x89,
+        0xc1,
+
+        // pop edx
+        0x5a,
+
+        // pop eax
+        0x58,
+
+        // jmp ecx
+        0xff,
+        0xe1,
+#endif
+    };
+
+#ifdef _WIN64
+    /// Byte offsets within the sampling code of the thread environment block offset of the sample
+    /// slot, which is an operand of each instruction that reads or writes it.
+    static constexpr size_t kSamplerSlotOperandOffsets[] = {13, 59, 107, 159};
+
+    /// Byte offset within the sampling code of the second half, which runs when a timed call
+    /// returns. Immediately follows the instruction that calls the address held in the stub, so
+    /// nothing needs to be filled in.
+    static constexpr size_t kSamplerEpilogueOffset = 89;
+
+    /// Byte offset within the sampling code of the short jump over the instructions that record
+    /// the caller of a timed call.
+    static constexpr size_t kSamplerCallerRecordingOffset = 131;
+#else
+    /// Byte offsets within the sampling code of the thread environment block offset of the sample
+    /// slot, which is an operand of each instruction that reads or writes it.
+    static constexpr size_t kSamplerSlotOperandOffsets[] = {16, 56, 66, 99, 162};
+
+    /// Byte offset within the sampling code of the second half, which runs when a timed call
+    /// returns.
+    static constexpr size_t kSamplerEpilogueOffset = 91;
+
+    /// Byte offset within the sampling code of the absolute address of the second half, which is an
+    /// operand of the instruction that replaces the return address with it.
+    static constexpr size_t kSamplerEpilogueOperandOffset = 49;
+
+    /// Byte offset within the sampling code of the short jump over the instructions that record
+    /// the caller of a timed call.
+    static constexpr size_t kSamplerCallerRecordingOffset = 139;
+#endif
+
+    /// Two-byte `nop` instruction, which replaces the short jump over the instructions that record
+    /// the caller of a timed call when caller recording is enabled.
+    static constexpr uint8_t kSamplerCallerRecordingEnabledCode[] = {0x66, 0x90};
+
+    // The sampling code addresses the fields of the sample block using 8-bit displacements, all of
+    // which assume this layout.
+    static_assert(
+        (0x08 == offsetof(SSampleBlock, startTimestamp)) &&
+            (0x10 == offsetof(SSampleBlock, busy)) &&
+            (0x14 == offsetof(SSampleBlock, nextCallerSlot)) &&
+            (0x18 == offsetof(SSampleBlock, savedRegisters)) &&
+            (0x40 == offsetof(SSampleBlock, buckets)) &&
+            (0x240 == offsetof(SSampleBlock, callers)),
+        "Sampling code assumes a different sample block layout.");
+    static_assert(
+        32 == kNumCallerSlots, "Sampling code assumes a different number of caller slots.");
+    static_assert(
+        64 == kHookTimingHistogramNumBuckets,
+        "Sampling code assumes one histogram bucket per bit of the time stamp counter.");
+
+    /// Sample blocks allocated so far. Elements are never removed, and a deque never moves its
+    /// existing elements when adding new ones to the end.
+    static std::deque<SSampleBlock> sampleBlocks;
+
+    /// Address of the shared sampling code, or `nullptr` if sampled timing is unavailable or has
+    /// not yet been started.
+    static const uint8_t* samplerCode = nullptr;
+
+    /// Determines whether or not the processor supports the `rdtscp` instruction, which the
+    /// sampling code uses so that the time stamp counter is read only after all earlier
+    /// instructions have completed.
+    /// @return `true` if so, `false` otherwise.
+    static bool IsRdtscpSupported(void)
+    {
+      int cpuInfo[4] = {};
+
+      __cpuid(cpuInfo, 0x80000000);
+      if (static_cast<unsigned int>(cpuInfo[0]) < 0x80000001) return false;
+
+      __cpuid(cpuInfo, 0x80000001);
+      return (0 != (cpuInfo[3] & (1 << 27)));
+    }
+
+    /// Places the sampling code into executable memory, filling in its operands.
+    /// @param [in] slotOffset Offset of the sample slot within the thread environment block.
+    /// @param [in] recordCallers Whether or not the sampling code should record the caller of each
+    /// timed call.
+    /// @return Address of the sampling code, or `nullptr` if it could not be placed.
+    static const uint8_t* CreateSamplerCode(size_t slotOffset, bool recordCallers)
+    {
+      uint8_t* const code = reinterpret_cast<uint8_t*>(Protected::Windows_VirtualAlloc(
+          nullptr, sizeof(kSamplerCode), MEM_RESERVE | MEM_COMMIT, PAGE_READWRITE));
+      if (nullptr == code) return nullptr;
+
+      std::memcpy(code, kSamplerCode, sizeof(kSamplerCode));
+
+      const uint32_t slotOperand = static_cast<uint32_t>(slotOffset);
+      for (const size_t operandOffset : kSamplerSlotOperandOffsets)
+        std::memcpy(&code[operandOffset], &slotOperand, sizeof(slotOperand));
+
+#ifndef _WIN64
+      const uint32_t epilogueOperand =
+          static_cast<uint32_t>(reinterpret_cast<size_t>(&code[kSamplerEpilogueOffset]));
+      std::memcpy(&code[kSamplerEpilogueOperandOffset], &epilogueOperand, sizeof(epilogueOperand));
+#endif
+
+      if (true == recordCallers)
+        std::memcpy(
+            &code[kSamplerCallerRecordingOffset],
+            kSamplerCallerRecordingEnabledCode,
+            sizeof(kSamplerCallerRecordingEnabledCode));
+
+      DWORD unusedOldProtection = 0;
+      if (0 ==
+          Protected::Windows_VirtualProtect(
+              code, sizeof(kSamplerCode), PAGE_EXECUTE_READ, &unusedOldProtection))
+      {
+        Protected::Windows_VirtualFree(code, 0, MEM_RELEASE);
+        return nullptr;
+      }
+
+      Protected::Windows_FlushInstructionCache(
+          Infra::ProcessInfo::GetCurrentProcessHandle(), code, sizeof(kSamplerCode));
+      return code;
+    }
+
+    const void* GetSampler(void)
+    {
+      static const void* const sampler = []() -> const void*
+      {
+        if (false == IsRdtscpSupported())
+        {
+          Infra::Message::Output(
+              Infra::Message::ESeverity::Warning,
+              L"Sampled hook timing is unavailable because the processor does not support the rdtscp instruction.");
+          return nullptr;
+        }
+
+        const size_t slotOffset = HookStore::AllocateThreadEnvironmentBlockSlot();
+        if (0 == slotOffset)
+        {
+          Infra::Message::Output(
+              Infra::Message::ESeverity::Warning,
+              L"Sampled hook timing is unavailable because no thread-local storage slot could be allocated in the thread environment block.");
+          return nullptr;
+        }
+
+        samplerCode = CreateSamplerCode(slotOffset, IsCallerRecordingEnabled());
+        if (nullptr == samplerCode)
+        {
+          Infra::Message::Output(
+              Infra::Message::ESeverity::Warning,
+              L"Sampled hook timing is unavailable because the sampling code could not be placed.");
+          return nullptr;
+        }
+
+        return samplerCode;
+      }();
+
+      return sampler;
+    }
+
+    bool IsCallerRecordingEnabled(void)
+    {
+      static const bool callerRecordingEnabled = Globals::GetPerformanceProfile().recordHookCallers;
+
+      return callerRecordingEnabled;
+    }
+
+    bool IsWithinSampler(size_t address)
+    {
+      return (
+          (nullptr != samplerCode) && (address >= reinterpret_cast<size_t>(samplerCode)) &&
+          (address < (reinterpret_cast<size_t>(samplerCode) + sizeof(kSamplerCode))));
+    }
+
+    SSampleBlock* AllocateSampleBlock(void)
+    {
+      return &sampleBlocks.emplace_back();
+    }
+  } // namespace SampledTiming
+} // namespace Hookshot
@@ -0,0 +1,205 @@
+/***************************************************************************************************
+ * Hookshot
+ *   General-purpose library for injecting DLLs and hooking function calls.
+ ***************************************************************************************************
+ * Authored by Samuel Grossman
+ * Copyright (c) 2019-2025
+ ***********************************************************************************************//**
+ * @file SharedStatistics.cpp
+ *   Implementation of publishing hook statistics through a named shared memory section.
+ **************************************************************************************************/
+
+#include "SharedStatistics.h"
+
+#include <atomic>
+#include <cstdint>
+#include <intrin.h>
+
+#include <Infra/Core/Configuration.h>
+#include <Infra/Core/Message.h>
+#include <Infra/Core/Strings.h>
+
+#include "ApiWindows.h"
+#include "DependencyProtect.h"
+#include "Globals.h"
+#include "HookStore.h"
+#include "Strings.h"
+#include "TaskScheduler.h"
+
+namespace Hookshot
+{
+  namespace SharedStatistics
+  {
+    /// Retrieves the header of the hook statistics section for this process, creating and
+    /// initializing the section if needed. Only attempted once, no matter how many times it is
+    /// invoked. The section is deliberately held open and mapped for the lifetime of the process.
+    /// @return Header at the beginning of the section, or `nullptr` if it could not be created.
+    static SHeader* GetSectionHeader(void)
+    {
+      static SHeader* const sectionHeader = []() -> SHeader*
+      {
+        const DWORD processId = Protected::Windows_GetCurrentProcessId();
+
+        const HANDLE section = Protected::Windows_CreateFileMapping(
+            INVALID_HANDLE_VALUE,
+            nullptr,
+            PAGE_READWRITE,
+            0,
+            static_cast<DWORD>(kSectionSizeBytes),
+            Strings::HookStatisticsSectionName(static_cast<uint32_t>(processId)).AsCString());
+        if (nullptr == section)
+        {
+          Infra::Message::OutputFormatted(
+              Infra::Message::ESeverity::Warning,
+              L"Failed to create the hook statistics section: %s",
+              Infra::Strings::FromSystemErrorCode(Protected::Windows_GetLastError()).AsCString());
+          return nullptr;
+        }
+
+        SHeader* const header = reinterpret_cast<SHeader*>(
+            Protected::Windows_MapViewOfFile(section, FILE_MAP_WRITE, 0, 0, 0));
+        if (nullptr == header)
+        {
+          Protected::Windows_CloseHandle(section);
+          return nullptr;
+        }
+
+        // Newly-created sections are zero-filled, so the sequence number and the install failure
+        // and patch repair counts already start at 0. Readers check the magic value last.
+        header->version = kSectionVersion;
+        header->processId = static_cast<uint32_t>(processId);
+        header->maxRecords = kMaxRecords;
+        std::atomic_thread_fence(std::memory_order_release);
+        header->magic = kSectionMagic;
+
+        return header;
+      }();
+
+      return sectionHeader;
+    }
+
+    /// Refreshes the contents of the hook statistics section using the current hooks.
+    /// @param [in,out] header Header at the beginning of the section.
+    /// @param [in] ticksPerMicrosecond Measured rate of the processor time stamp counter, or 0 if
+    /// it has not yet been measured.
+    static void PublishRecords(SHeader* header, uint64_t ticksPerMicrosecond)
+    {
+      const uint32_t sequence = header->sequence.load(std::memory_order_relaxed);
+      header->sequence.store(sequence + 1, std::memory_order_relaxed);
+      std::atomic_thread_fence(std::memory_order_release);
+
+      HookStore::CollectStatistics(
+          RecordsForHeader(header), kMaxRecords, &header->numHooks, &header->numRecords);
+      header->publishTimestamp = static_cast<uint64_t>(GetTickCount64());
+      header->ticksPerMicrosecond = ticksPerMicrosecond;
+
+      header->sequence.store(sequence + 2, std::memory_order_release);
+    }
+
+    /// Thread procedure that periodically refreshes the contents of the hook statistics section.
+    /// Only ever reads hook state, under a shared lock, so it never delays hooked functions.
+    /// Sampled latencies are published in processor time stamp counter ticks, so the rate of the
+    /// time stamp counter is measured against the system tick count over the entire lifetime of
+    /// the thread and published alongside them.
+    /// @param [in] parameter Header at the beginning of the section.
+    /// @return Exit code, which is always 0.
+    static DWORD WINAPI PublishThreadProc(LPVOID parameter)
+    {
+      SHeader* const header = reinterpret_cast<SHeader*>(parameter);
+
+      const uint64_t startTimestamp = __rdtsc();
+      const ULONGLONG startTickCount = GetTickCount64();
+
+      while (true)
+      {
+        const uint64_t elapsedMicroseconds =
+            static_cast<uint64_t>(GetTickCount64() - startTickCount) * 1000;
+        const uint64_t ticksPerMicrosecond =
+            ((0 == elapsedMicroseconds) ? 0 : ((__rdtsc() - startTimestamp) / elapsedMicroseconds));
+
+        PublishRecords(header, ticksPerMicrosecond);
+        Protected::Windows_Sleep(kPublishIntervalMilliseconds);
+      }
+
+      return 0;
+    }
+
+    bool IsPublishingEnabled(void)
+    {
+      static const bool publishingEnabled =
+          Globals::GetConfigurationData()
+              [Infra::Configuration::kSectionNameGlobal]
+              [Strings::kStrConfigurationSettingNamePublishHookStatistics]
+                  .ValueOr(false);
+
+      return publishingEnabled;
+    }
+
+    void CountInstallFailure(void)
+    {
+      if (false == IsPublishingEnabled()) return;
+
+      SHeader* const header = GetSectionHeader();
+      if (nullptr == header) return;
+
+      header->numInstallFailures.fetch_add(1, std::memory_order_relaxed);
+    }
+
+    void CountPatchRepairs(uint32_t numRepairs)
+    {
+      if (false == IsPublishingEnabled()) return;
+
+      SHeader* const header = GetSectionHeader();
+      if (nullptr == header) return;
+
+      header->numPatchRepairs.fetch_add(numRepairs, std::memory_order_relaxed);
+    }
+
+    void PublishStartupProfile(
+        const int64_t* phaseMicroseconds, size_t numPhases, int64_t totalMicroseconds)
+    {
+      if (false == IsPublishingEnabled()) return;
+
+      SHeader* const header = GetSectionHeader();
+      if (nullptr == header) return;
+      if (0 != header->numStartupPhases.load(std::memory_order_relaxed)) return;
+
+      const uint32_t numPhasesToPublish =
+          static_cast<uint32_t>((numPhases < kMaxStartupPhases) ? numPhases : kMaxStartupPhases);
+      for (uint32_t i = 0; i < numPhasesToPublish; ++i)
+        header->startupPhaseMicroseconds[i] = phaseMicroseconds[i];
+      header->startupTotalMicroseconds = totalMicroseconds;
+
+      header->numStartupPhases.store(numPhasesToPublish, std::memory_order_release);
+    }
+
+    void StartPublishing(void)
+    {
+      if (false == IsPublishingEnabled()) return;
+
+      static std::atomic<bool> publishingStarted = false;
+      if (true == publishingStarted.exchange(true)) return;
+
+      SHeader* const header = GetSectionHeader();
+      if (nullptr == header) return;
+
+      const HANDLE publishThread =
+          TaskScheduler::CreateBackgroundThread(PublishThreadProc, header);
+      if (nullptr == publishThread)
+      {
+        Infra::Message::OutputFormatted(
+            Infra::Message::ESeverity::Warning,
+            L"Failed to start publishing hook statistics: %s",
+            Infra::Strings::FromSystemErrorCode(Protected::Windows_GetLastError()).AsCString());
+        return;
+      }
+
+      Protected::Windows_CloseHandle(publishThread);
+
+      Infra::Message::OutputFormatted(
+          Infra::Message::ESeverity::Info,
+          L"Publishing hook statistics every %u milliseconds.",
+          kPublishIntervalMilliseconds);
+    }
+  } // namespace SharedStatistics
+} // namespace Hookshot
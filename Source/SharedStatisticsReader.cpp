@@ -0,0 +1,169 @@
+/***************************************************************************************************
+ * Hookshot
+ *   General-purpose library for injecting DLLs and hooking function calls.
+ ***************************************************************************************************
+ * Authored by Samuel Grossman
+ * Copyright (c) 2019-2025
+ ***********************************************************************************************//**
+ * @file SharedStatisticsReader.cpp
+ *   Implementation of reading the hook statistics that other processes publish through their
+ *   named shared memory sections.
+ **************************************************************************************************/
+
+#include "SharedStatisticsReader.h"
+
+#include <algorithm>
+#include <atomic>
+#include <cstdint>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include "ApiWindows.h"
+#include "SharedStatistics.h"
+#include "Strings.h"
+
+namespace Hookshot
+{
+  namespace SharedStatisticsReader
+  {
+    const SharedStatistics::SHeader* MapSection(uint32_t processId)
+    {
+      const HANDLE section = OpenFileMapping(
+          FILE_MAP_READ, FALSE, Strings::HookStatisticsSectionName(processId).AsCString());
+      if (nullptr == section) return nullptr;
+
+      const SharedStatistics::SHeader* const header =
+          reinterpret_cast<const SharedStatistics::SHeader*>(
+              MapViewOfFile(section, FILE_MAP_READ, 0, 0, SharedStatistics::kSectionSizeBytes));
+
+      const DWORD mapViewError = GetLastError();
+      CloseHandle(section);
+      SetLastError(mapViewError);
+
+      return header;
+    }
+
+    void UnmapSection(const SharedStatistics::SHeader* header)
+    {
+      UnmapViewOfFile(header);
+    }
+
+    bool ReadSnapshot(const SharedStatistics::SHeader* header, SSnapshot* snapshot)
+    {
+      constexpr int kMaxAttempts = 100;
+
+      if ((SharedStatistics::kSectionMagic != header->magic) ||
+          (SharedStatistics::kSectionVersion != header->version))
+        return false;
+
+      for (int attempt = 0; attempt < kMaxAttempts; ++attempt)
+      {
+        const uint32_t sequenceBefore = header->sequence.load(std::memory_order_acquire);
+        if (0 != (sequenceBefore & 1))
+        {
+          Sleep(1);
+          continue;
+        }
+
+        const uint32_t numRecords = header->numRecords;
+        if (numRecords > SharedStatistics::kMaxRecords) return false;
+
+        snapshot->numHooks = header->numHooks;
+        snapshot->publishTimestamp = header->publishTimestamp;
+        snapshot->ticksPerMicrosecond = header->ticksPerMicrosecond;
+        snapshot->records.assign(
+            SharedStatistics::RecordsForHeader(header),
+            SharedStatistics::RecordsForHeader(header) + numRecords);
+
+        std::atomic_thread_fence(std::memory_order_acquire);
+        if (sequenceBefore == header->sequence.load(std::memory_order_relaxed))
+        {
+          snapshot->numInstallFailures = header->numInstallFailures.load(std::memory_order_relaxed);
+          snapshot->numPatchRepairs = header->numPatchRepairs.load(std::memory_order_relaxed);
+
+          snapshot->numStartupPhases = header->numStartupPhases.load(std::memory_order_acquire);
+          if (snapshot->numStartupPhases > SharedStatistics::kMaxStartupPhases)
+            snapshot->numStartupPhases = 0;
+          snapshot->startupTotalMicroseconds = header->startupTotalMicroseconds;
+          for (uint32_t i = 0; i < snapshot->numStartupPhases; ++i)
+            snapshot->startupPhaseMicroseconds[i] = header->startupPhaseMicroseconds[i];
+
+          return true;
+        }
+      }
+
+      return false;
+    }
+
+    std::vector<uint64_t> ComputeCallsPerSecond(
+        const SSnapshot& previousSnapshot, const SSnapshot& currentSnapshot)
+    {
+      std::unordered_map<uint64_t, uint64_t> previousCallCounts;
+      for (const auto& record : previousSnapshot.records)
+        previousCallCounts[record.hookFunc] = record.callCount;
+
+      const uint64_t elapsedMilliseconds =
+          currentSnapshot.publishTimestamp - previousSnapshot.publishTimestamp;
+
+      std::vector<uint64_t> callsPerSecond;
+      callsPerSecond.reserve(currentSnapshot.records.size());
+
+      for (const auto& record : currentSnapshot.records)
+      {
+        const auto previousIter = previousCallCounts.find(record.hookFunc);
+        if ((0 == elapsedMilliseconds) || (previousCallCounts.end() == previousIter) ||
+            (previousIter->second > record.callCount) ||
+            (0 == (record.flags & SharedStatistics::kRecordFlagInstrumented)))
+        {
+          callsPerSecond.push_back(0);
+          continue;
+        }
+
+        callsPerSecond.push_back(
+            ((record.callCount - previousIter->second) * 1000) / elapsedMilliseconds);
+      }
+
+      return callsPerSecond;
+    }
+
+    std::vector<SPublishingProcess> EnumeratePublishingProcesses(void)
+    {
+      std::vector<SPublishingProcess> publishingProcesses;
+
+      const HANDLE processSnapshot = CreateToolhelp32Snapshot(TH32CS_SNAPPROCESS, 0);
+      if (INVALID_HANDLE_VALUE == processSnapshot) return publishingProcesses;
+
+      PROCESSENTRY32W processEntry = {.dwSize = sizeof(processEntry)};
+      for (BOOL moreProcesses = Process32FirstW(processSnapshot, &processEntry);
+           FALSE != moreProcesses;
+           moreProcesses = Process32NextW(processSnapshot, &processEntry))
+      {
+        // Opening the section only checks whether or not it exists. Nothing is mapped.
+        const HANDLE section = OpenFileMapping(
+            FILE_MAP_READ,
+            FALSE,
+            Strings::HookStatisticsSectionName(static_cast<uint32_t>(processEntry.th32ProcessID))
+                .AsCString());
+        if (nullptr == section) continue;
+
+        CloseHandle(section);
+        publishingProcesses.push_back(
+            {.processId = static_cast<uint32_t>(processEntry.th32ProcessID),
+             .executableName = processEntry.szExeFile});
+      }
+
+      CloseHandle(processSnapshot);
+
+      std::sort(
+          publishingProcesses.begin(),
+          publishingProcesses.end(),
+          [](const SPublishingProcess& a, const SPublishingProcess& b) -> bool
+          {
+            return (a.processId < b.processId);
+          });
+
+      return publishingProcesses;
+    }
+  } // namespace SharedStatisticsReader
+} // namespace Hookshot
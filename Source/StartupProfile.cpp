@@ -0,0 +1,115 @@
+/***************************************************************************************************
+ * Hookshot
+ *   General-purpose library for injecting DLLs and hooking function calls.
+ ***************************************************************************************************
+ * Authored by Samuel Grossman
+ * Copyright (c) 2019-2025
+ ***********************************************************************************************//**
+ * @file StartupProfile.cpp
+ *   Implementation of measuring how long each phase of Hookshot initialization takes.
+ **************************************************************************************************/
+
+#include "StartupProfile.h"
+
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <optional>
+
+#include <Infra/Core/Configuration.h>
+#include <Infra/Core/Message.h>
+
+#include "Globals.h"
+#include "SharedStatistics.h"
+#include "Strings.h"
+#include "Tracing.h"
+
+namespace Hookshot
+{
+  namespace StartupProfile
+  {
+    /// Start time of each initialization phase, present only if the phase has started.
+    static std::optional<std::chrono::steady_clock::time_point>
+        phaseStartTimes[Tracing::kNumStartupPhases];
+
+    /// End time of each initialization phase, present only if the phase has ended.
+    static std::optional<std::chrono::steady_clock::time_point>
+        phaseEndTimes[Tracing::kNumStartupPhases];
+
+    /// Computes the number of microseconds between two points in time.
+    /// @param [in] start Earlier point in time.
+    /// @param [in] end Later point in time.
+    /// @return Number of microseconds elapsed.
+    static int64_t MicrosecondsBetween(
+        std::chrono::steady_clock::time_point start, std::chrono::steady_clock::time_point end)
+    {
+      return static_cast<int64_t>(
+          std::chrono::duration_cast<std::chrono::microseconds>(end - start).count());
+    }
+
+    /// Computes the duration of each initialization phase from the recorded timestamps.
+    /// @return Duration of each phase, and of initialization as a whole, in microseconds, or -1 for
+    /// any that did not both start and end.
+    static Tracing::SStartupPhaseDurations ComputePhaseDurations(void)
+    {
+      Tracing::SStartupPhaseDurations phaseDurations = {.totalMicroseconds = -1};
+      std::optional<std::chrono::steady_clock::time_point> firstStartTime;
+      std::optional<std::chrono::steady_clock::time_point> lastEndTime;
+
+      for (size_t i = 0; i < Tracing::kNumStartupPhases; ++i)
+      {
+        if ((false == phaseStartTimes[i].has_value()) || (false == phaseEndTimes[i].has_value()))
+        {
+          phaseDurations.microseconds[i] = -1;
+          continue;
+        }
+
+        phaseDurations.microseconds[i] =
+            MicrosecondsBetween(*phaseStartTimes[i], *phaseEndTimes[i]);
+
+        if ((false == firstStartTime.has_value()) || (*phaseStartTimes[i] < *firstStartTime))
+          firstStartTime = phaseStartTimes[i];
+        if ((false == lastEndTime.has_value()) || (*phaseEndTimes[i] > *lastEndTime))
+          lastEndTime = phaseEndTimes[i];
+      }
+
+      if ((true == firstStartTime.has_value()) && (true == lastEndTime.has_value()))
+        phaseDurations.totalMicroseconds = MicrosecondsBetween(*firstStartTime, *lastEndTime);
+
+      return phaseDurations;
+    }
+
+    void BeginPhase(Tracing::EStartupPhase phase)
+    {
+      phaseStartTimes[static_cast<size_t>(phase)] = std::chrono::steady_clock::now();
+    }
+
+    void EndPhase(Tracing::EStartupPhase phase)
+    {
+      phaseEndTimes[static_cast<size_t>(phase)] = std::chrono::steady_clock::now();
+    }
+
+    void Report(void)
+    {
+      const bool profileStartup = Globals::GetConfigurationData()
+                                      [Infra::Configuration::kSectionNameGlobal]
+                                      [Strings::kStrConfigurationSettingNameProfileStartup]
+                                          .ValueOr(false);
+      if (false == profileStartup) return;
+
+      const Tracing::SStartupPhaseDurations phaseDurations = ComputePhaseDurations();
+
+      Tracing::StartupProfile(phaseDurations);
+      Tracing::OutputStartupPhaseDurations(Infra::Message::ESeverity::Info, phaseDurations);
+      SharedStatistics::PublishStartupProfile(
+          phaseDurations.microseconds,
+          Tracing::kNumStartupPhases,
+          phaseDurations.totalMicroseconds);
+    }
+
+    int64_t GetTotalMicroseconds(void)
+    {
+      return ComputePhaseDurations().totalMicroseconds;
+    }
+  } // namespace StartupProfile
+} // namespace Hookshot
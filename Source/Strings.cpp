@@ -17,11 +17,13 @@
 #include <cctype>
 #include <cstdlib>
 #include <cwctype>
+#include <functional>
 #include <mutex>
 #include <string>
 #include <string_view>
 
 #include <Infra/Core/ProcessInfo.h>
+#include <Infra/Core/Strings.h>
 #include <Infra/Core/TemporaryBuffer.h>
 
 #include "ApiWindows.h"
@@ -38,6 +40,16 @@ namespace Hookshot
     static constexpr std::wstring_view kStrHookshotDynamicLinkLibraryExtension = L".32.dll";
 #endif
 
+    /// File extension of the dynamic-link library form of Hookshot but targeting the opposite
+    /// processor architecture.
+#ifdef _WIN64
+    static constexpr std::wstring_view kStrHookshotDynamicLinkLibraryOtherArchitectureExtension =
+        L".32.dll";
+#else
+    static constexpr std::wstring_view kStrHookshotDynamicLinkLibraryOtherArchitectureExtension =
+        L".64.dll";
+#endif
+
     /// File extension of the executable form of Hookshot.
 #ifdef _WIN64
     static constexpr std::wstring_view kStrHookshotExecutableExtension = L".64.exe";
@@ -61,6 +73,9 @@ namespace Hookshot
     /// File extension for a Hookshot log file.
     static constexpr std::wstring_view kStrHookshotLogFileExtension = L".log";
 
+    /// Suffix appended to the product name to form the name of the exit summary file.
+    static constexpr std::wstring_view kStrExitSummaryFileSuffix = L".ExitSummary.csv";
+
     /// File extension for all hook modules.
 #ifdef _WIN64
     static constexpr std::wstring_view kStrHookModuleExtension = L".HookModule.64.dll";
@@ -100,6 +115,62 @@ namespace Hookshot
       return initString;
     }
 
+    std::wstring_view GetHookshotDynamicLinkLibraryOtherArchitectureFilename(void)
+    {
+      static std::wstring initString;
+      static std::once_flag initFlag;
+
+      std::call_once(
+          initFlag,
+          []() -> void
+          {
+            std::wstring_view pieces[] = {
+                Infra::ProcessInfo::GetThisModuleDirectoryName(),
+                L"\\",
+                Infra::ProcessInfo::GetProductName(),
+                kStrHookshotDynamicLinkLibraryOtherArchitectureExtension};
+
+            size_t totalLength = 0;
+            for (int i = 0; i < _countof(pieces); ++i)
+              totalLength += pieces[i].length();
+
+            initString.reserve(1 + totalLength);
+
+            for (int i = 0; i < _countof(pieces); ++i)
+              initString.append(pieces[i]);
+          });
+
+      return initString;
+    }
+
+    std::wstring_view GetHookshotConfigurationFilename(void)
+    {
+      static std::wstring initString;
+      static std::once_flag initFlag;
+
+      std::call_once(
+          initFlag,
+          []() -> void
+          {
+            std::wstring_view pieces[] = {
+                Infra::ProcessInfo::GetThisModuleDirectoryName(),
+                L"\\",
+                Infra::ProcessInfo::GetProductName(),
+                kStrHookshotConfigurationFileExtension};
+
+            size_t totalLength = 0;
+            for (int i = 0; i < _countof(pieces); ++i)
+              totalLength += pieces[i].length();
+
+            initString.reserve(1 + totalLength);
+
+            for (int i = 0; i < _countof(pieces); ++i)
+              initString.append(pieces[i]);
+          });
+
+      return initString;
+    }
+
     std::wstring_view GetHookshotExecutableFilename(void)
     {
       static std::wstring initString;
@@ -185,6 +256,15 @@ namespace Hookshot
       return authorizationFilename;
     }
 
+    Infra::TemporaryString CallTraceSectionName(uint32_t processId)
+    {
+      Infra::TemporaryString sectionName;
+      sectionName << L"Local\\Hookshot.CallTrace."
+                  << Infra::Strings::Format(L"%u", processId).AsStringView();
+
+      return sectionName;
+    }
+
     Infra::TemporaryString HookModuleFilename(
         std::wstring_view moduleName, std::wstring_view directoryName)
     {
@@ -198,5 +278,97 @@ namespace Hookshot
 
       return hookModuleFilename;
     }
+
+    Infra::TemporaryString HookStatisticsSectionName(uint32_t processId)
+    {
+      Infra::TemporaryString sectionName;
+      sectionName << L"Local\\Hookshot.HookStatistics."
+                  << Infra::Strings::Format(L"%u", processId).AsStringView();
+
+      return sectionName;
+    }
+
+    Infra::TemporaryString InjectionJobObjectName(uint32_t brokerProcessId)
+    {
+      Infra::TemporaryString jobName;
+      jobName << L"Local\\Hookshot.InjectionJob."
+              << Infra::Strings::Format(L"%u", brokerProcessId).AsStringView();
+
+      return jobName;
+    }
+
+    Infra::TemporaryString InjectorDaemonPipeName(void)
+    {
+      DWORD sessionId = 0;
+      if (FALSE == ProcessIdToSessionId(GetCurrentProcessId(), &sessionId)) sessionId = 0;
+
+      wchar_t userName[256 + 1] = L"";
+      DWORD userNameLength = _countof(userName);
+      if (FALSE == GetUserName(userName, &userNameLength)) userName[0] = L'\0';
+
+      // Identifying the Hookshot executable by a hash of its full path keeps different copies of
+      // Hookshot, including those targeting the other processor architecture, from sharing a daemon.
+      Infra::TemporaryString pipeName;
+      pipeName << L"\\\\.\\pipe\\Hookshot.InjectorDaemon."
+               << Infra::Strings::Format(L"%u", (unsigned int)sessionId).AsStringView() << L'.'
+               << userName << L'.'
+               << Infra::Strings::Format(
+                      L"%llx",
+                      (unsigned long long)std::hash<std::wstring_view>()(
+                          GetHookshotExecutableFilename()))
+                      .AsStringView();
+
+      return pipeName;
+    }
+
+    Infra::TemporaryString MappedLogFilename(void)
+    {
+      Infra::TemporaryString mappedLogFilename;
+      mappedLogFilename << Infra::ProcessInfo::GetThisModuleDirectoryName() << L"\\"
+                        << Infra::ProcessInfo::GetProductName() << L"_"
+                        << Infra::ProcessInfo::GetExecutableBaseName() << L"_"
+                        << Infra::Strings::Format(
+                               L"%u", (unsigned int)Infra::ProcessInfo::GetCurrentProcessId())
+                               .AsStringView()
+                        << kStrHookshotLogFileExtension;
+
+      return mappedLogFilename;
+    }
+
+    Infra::TemporaryString ExitSummaryFilename(void)
+    {
+      Infra::TemporaryString exitSummaryFilename;
+      exitSummaryFilename << Infra::ProcessInfo::GetThisModuleDirectoryName() << L"\\"
+                          << Infra::ProcessInfo::GetProductName() << kStrExitSummaryFileSuffix;
+
+      return exitSummaryFilename;
+    }
+
+    Infra::TemporaryString MappedLogSectionName(uint32_t rootProcessId)
+    {
+      Infra::TemporaryString sectionName;
+      sectionName << L"Local\\Hookshot.MappedLog."
+                  << Infra::Strings::Format(L"%u", rootProcessId).AsStringView();
+
+      return sectionName;
+    }
+
+    Infra::TemporaryString MappedLogLinkSectionName(uint32_t processId)
+    {
+      Infra::TemporaryString sectionName;
+      sectionName << L"Local\\Hookshot.MappedLogLink."
+                  << Infra::Strings::Format(L"%u", processId).AsStringView();
+
+      return sectionName;
+    }
+
+    Infra::TemporaryString InternalHookLayoutSectionName(uint32_t processId)
+    {
+      Infra::TemporaryString sectionName;
+      sectionName << L"Local\\Hookshot.InternalHookLayout."
+                  << Infra::Strings::Format(L"%u", processId).AsStringView();
+
+      return sectionName;
+    }
   } // namespace Strings
 } // namespace Hookshot
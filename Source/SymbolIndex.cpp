@@ -0,0 +1,254 @@
+/***************************************************************************************************
+ * Hookshot
+ *   General-purpose library for injecting DLLs and hooking function calls.
+ ***************************************************************************************************
+ * Authored by Samuel Grossman
+ * Copyright (c) 2019-2025
+ ***********************************************************************************************//**
+ * @file SymbolIndex.cpp
+ *   Implementation of looking up symbols in symbol index files.
+ **************************************************************************************************/
+
+#include "SymbolIndex.h"
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <cwctype>
+#include <mutex>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include "ApiWindows.h"
+
+namespace Hookshot
+{
+  namespace SymbolIndex
+  {
+    /// Read-only view of a valid symbol index file that is mapped into memory.
+    struct SMappedSymbolIndex
+    {
+      /// Name of the symbol index file, as supplied by the first caller that used it.
+      std::wstring filename;
+
+      /// Module entries, in sorted order.
+      const SModuleEntry* modules;
+
+      /// Number of elements in the module entry array.
+      uint32_t numModules;
+
+      /// Symbol entries, grouped by module and sorted by name within each group.
+      const SSymbolEntry* symbols;
+
+      /// Number of elements in the symbol entry array.
+      uint32_t numSymbols;
+
+      /// String table that holds the names of all of the symbols.
+      const char* stringTable;
+
+      /// Size of the string table, in bytes.
+      uint32_t stringTableSizeBytes;
+    };
+
+    /// Enforces concurrency control over the list of mapped symbol index files.
+    static std::mutex mappedSymbolIndexMutex;
+
+    /// Symbol index files that have been mapped into memory. They remain mapped for the lifetime
+    /// of the process, and each element is allocated separately so that its address never changes.
+    static std::vector<const SMappedSymbolIndex*> mappedSymbolIndexes;
+
+    /// Determines whether or not two file names are the same, ignoring case.
+    /// @param [in] a First file name.
+    /// @param [in] b Second file name.
+    /// @return `true` if so, `false` if not.
+    static bool FilenamesAreEqual(std::wstring_view a, std::wstring_view b)
+    {
+      return std::equal(
+          a.begin(),
+          a.end(),
+          b.begin(),
+          b.end(),
+          [](wchar_t charA, wchar_t charB) -> bool
+          {
+            return (std::towlower(charA) == std::towlower(charB));
+          });
+    }
+
+    /// Maps a symbol index file into memory and checks that its contents are consistent.
+    /// @param [in] symbolIndexFilename Name of the symbol index file.
+    /// @return Mapped symbol index file, which the caller owns, or `nullptr` if it does not exist
+    /// or is not valid.
+    static SMappedSymbolIndex* MapSymbolIndexFile(std::wstring_view symbolIndexFilename)
+    {
+      const HANDLE symbolIndexFile = CreateFile(
+          std::wstring(symbolIndexFilename).c_str(),
+          GENERIC_READ,
+          FILE_SHARE_READ | FILE_SHARE_DELETE,
+          nullptr,
+          OPEN_EXISTING,
+          FILE_ATTRIBUTE_NORMAL,
+          nullptr);
+      if (INVALID_HANDLE_VALUE == symbolIndexFile) return nullptr;
+
+      LARGE_INTEGER symbolIndexSize{};
+      const HANDLE symbolIndexMapping =
+          (((FALSE != GetFileSizeEx(symbolIndexFile, &symbolIndexSize)) &&
+            (static_cast<uint64_t>(symbolIndexSize.QuadPart) >= sizeof(SFileHeader)))
+               ? CreateFileMapping(symbolIndexFile, nullptr, PAGE_READONLY, 0, 0, nullptr)
+               : nullptr);
+      CloseHandle(symbolIndexFile);
+      if (nullptr == symbolIndexMapping) return nullptr;
+
+      const uint8_t* const symbolIndexView = reinterpret_cast<const uint8_t*>(
+          MapViewOfFile(symbolIndexMapping, FILE_MAP_READ, 0, 0, 0));
+      CloseHandle(symbolIndexMapping);
+      if (nullptr == symbolIndexView) return nullptr;
+
+      const SFileHeader* const fileHeader = reinterpret_cast<const SFileHeader*>(symbolIndexView);
+      const uint64_t requiredSizeBytes = sizeof(SFileHeader) +
+          (static_cast<uint64_t>(fileHeader->numModules) * sizeof(SModuleEntry)) +
+          (static_cast<uint64_t>(fileHeader->numSymbols) * sizeof(SSymbolEntry)) +
+          static_cast<uint64_t>(fileHeader->stringTableSizeBytes);
+
+      if ((kSignature != fileHeader->signature) || (kVersion != fileHeader->version) ||
+          (requiredSizeBytes > static_cast<uint64_t>(symbolIndexSize.QuadPart)))
+      {
+        UnmapViewOfFile(symbolIndexView);
+        return nullptr;
+      }
+
+      const SModuleEntry* const modules =
+          reinterpret_cast<const SModuleEntry*>(&symbolIndexView[sizeof(SFileHeader)]);
+      const SSymbolEntry* const symbols =
+          reinterpret_cast<const SSymbolEntry*>(&modules[fileHeader->numModules]);
+
+      // Module entries are few, so they are checked up front. Symbol entries are checked only as
+      // they are visited, so that looking up a few names does not touch the entire file.
+      for (uint32_t i = 0; i < fileHeader->numModules; ++i)
+      {
+        if ((modules[i].firstSymbol > fileHeader->numSymbols) ||
+            (modules[i].numSymbols > (fileHeader->numSymbols - modules[i].firstSymbol)))
+        {
+          UnmapViewOfFile(symbolIndexView);
+          return nullptr;
+        }
+      }
+
+      return new SMappedSymbolIndex{
+          .filename = std::wstring(symbolIndexFilename),
+          .modules = modules,
+          .numModules = fileHeader->numModules,
+          .symbols = symbols,
+          .numSymbols = fileHeader->numSymbols,
+          .stringTable = reinterpret_cast<const char*>(&symbols[fileHeader->numSymbols]),
+          .stringTableSizeBytes = fileHeader->stringTableSizeBytes};
+    }
+
+    /// Retrieves a mapped symbol index file, mapping it into memory if this is the first time it
+    /// is used. Files that do not exist or are not valid are not remembered, so that they can be
+    /// created later.
+    /// @param [in] symbolIndexFilename Name of the symbol index file.
+    /// @return Mapped symbol index file, or `nullptr` if it does not exist or is not valid.
+    static const SMappedSymbolIndex* GetMappedSymbolIndex(std::wstring_view symbolIndexFilename)
+    {
+      std::scoped_lock lock(mappedSymbolIndexMutex);
+
+      for (const SMappedSymbolIndex* mappedSymbolIndex : mappedSymbolIndexes)
+      {
+        if (true == FilenamesAreEqual(mappedSymbolIndex->filename, symbolIndexFilename))
+          return mappedSymbolIndex;
+      }
+
+      const SMappedSymbolIndex* const mappedSymbolIndex = MapSymbolIndexFile(symbolIndexFilename);
+      if (nullptr != mappedSymbolIndex) mappedSymbolIndexes.push_back(mappedSymbolIndex);
+
+      return mappedSymbolIndex;
+    }
+
+    /// Retrieves the name of a symbol from the string table.
+    /// @param [in] mappedSymbolIndex Symbol index file to which the symbol belongs.
+    /// @param [in] symbol Symbol entry of interest.
+    /// @return Name of the symbol, which is empty if the symbol entry is not valid.
+    static inline std::string_view SymbolName(
+        const SMappedSymbolIndex& mappedSymbolIndex, const SSymbolEntry& symbol)
+    {
+      if ((symbol.nameOffset > mappedSymbolIndex.stringTableSizeBytes) ||
+          (symbol.nameLength > (mappedSymbolIndex.stringTableSizeBytes - symbol.nameOffset)))
+        return std::string_view();
+
+      return std::string_view(
+          &mappedSymbolIndex.stringTable[symbol.nameOffset], symbol.nameLength);
+    }
+
+    bool GetModuleIdentity(HMODULE moduleHandle, SModuleIdentity* moduleIdentity)
+    {
+      const uint8_t* const moduleBase = reinterpret_cast<const uint8_t*>(moduleHandle);
+      const IMAGE_DOS_HEADER* const dosHeader =
+          reinterpret_cast<const IMAGE_DOS_HEADER*>(moduleBase);
+      if (IMAGE_DOS_SIGNATURE != dosHeader->e_magic) return false;
+
+      const IMAGE_NT_HEADERS* const ntHeaders =
+          reinterpret_cast<const IMAGE_NT_HEADERS*>(&moduleBase[dosHeader->e_lfanew]);
+      if (IMAGE_NT_SIGNATURE != ntHeaders->Signature) return false;
+
+      *moduleIdentity = {
+          .timeDateStamp = static_cast<uint32_t>(ntHeaders->FileHeader.TimeDateStamp),
+          .sizeOfImage = static_cast<uint32_t>(ntHeaders->OptionalHeader.SizeOfImage)};
+      return true;
+    }
+
+    bool LookupSymbols(
+        std::wstring_view symbolIndexFilename,
+        HMODULE moduleHandle,
+        const char* const* symbolNames,
+        size_t numSymbolNames,
+        uint32_t* symbolRelativeAddresses)
+    {
+      std::fill(symbolRelativeAddresses, symbolRelativeAddresses + numSymbolNames, 0);
+
+      SModuleIdentity moduleIdentity{};
+      if (false == GetModuleIdentity(moduleHandle, &moduleIdentity)) return false;
+
+      const SMappedSymbolIndex* const mappedSymbolIndex =
+          GetMappedSymbolIndex(symbolIndexFilename);
+      if (nullptr == mappedSymbolIndex) return false;
+
+      const SModuleEntry* const modulesEnd =
+          mappedSymbolIndex->modules + mappedSymbolIndex->numModules;
+      const SModuleEntry* const module = std::lower_bound(
+          mappedSymbolIndex->modules,
+          modulesEnd,
+          moduleIdentity,
+          [](const SModuleEntry& entry, const SModuleIdentity& value) -> bool
+          {
+            return (entry.identity < value);
+          });
+      if ((modulesEnd == module) || (false == (module->identity == moduleIdentity))) return false;
+
+      const SSymbolEntry* const symbolsBegin = &mappedSymbolIndex->symbols[module->firstSymbol];
+      const SSymbolEntry* const symbolsEnd = symbolsBegin + module->numSymbols;
+
+      for (size_t i = 0; i < numSymbolNames; ++i)
+      {
+        if (nullptr == symbolNames[i]) continue;
+
+        const std::string_view symbolName(symbolNames[i]);
+        const SSymbolEntry* const symbol = std::lower_bound(
+            symbolsBegin,
+            symbolsEnd,
+            symbolName,
+            [mappedSymbolIndex](const SSymbolEntry& entry, std::string_view value) -> bool
+            {
+              return (SymbolName(*mappedSymbolIndex, entry) < value);
+            });
+
+        if ((symbolsEnd != symbol) && (SymbolName(*mappedSymbolIndex, *symbol) == symbolName) &&
+            (symbol->rva < moduleIdentity.sizeOfImage))
+          symbolRelativeAddresses[i] = symbol->rva;
+      }
+
+      return true;
+    }
+  } // namespace SymbolIndex
+} // namespace Hookshot
@@ -0,0 +1,386 @@
+/***************************************************************************************************
+ * Hookshot
+ *   General-purpose library for injecting DLLs and hooking function calls.
+ ***************************************************************************************************
+ * Authored by Samuel Grossman
+ * Copyright (c) 2019-2025
+ ***********************************************************************************************//**
+ * @file SymbolIndexMain.cpp
+ *   Entry point for the symbol indexing tool, which reads the debugging symbols of modules ahead
+ *   of time and writes the relative virtual address of each named function to a symbol index file
+ *   that hook modules can use to hook functions that are not exported.
+ **************************************************************************************************/
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+#include <string>
+#include <string_view>
+#include <utility>
+#include <vector>
+
+#include "ApiWindows.h"
+
+#include <dbghelp.h>
+
+#include "Globals.h"
+#include "SymbolIndex.h"
+
+using namespace Hookshot;
+
+/// Symbol tag that identifies a function, from the DIA SDK, which is not part of the Windows SDK.
+static constexpr ULONG kSymTagFunction = 5;
+
+/// Symbol tag that identifies a public symbol, from the DIA SDK, which is not part of the Windows
+/// SDK.
+static constexpr ULONG kSymTagPublicSymbol = 10;
+
+/// Single named function found in the debugging symbols of a module.
+struct SCollectedSymbol
+{
+  /// Name of the function, encoded as UTF-8.
+  std::string name;
+
+  /// Offset of the function from the base address of its module.
+  uint32_t rva;
+};
+
+/// All of the named functions found in the debugging symbols of a single module.
+struct SCollectedModule
+{
+  /// Build of the module to which the functions belong.
+  SymbolIndex::SModuleIdentity identity;
+
+  /// Named functions, sorted by name, with each name appearing only once.
+  std::vector<SCollectedSymbol> symbols;
+};
+
+/// Information passed to the symbol enumeration callback.
+struct SEnumerateContext
+{
+  /// Base address at which the module was loaded for symbol enumeration.
+  DWORD64 moduleBase;
+
+  /// Size of the module's image, in bytes.
+  DWORD moduleSize;
+
+  /// Filled with the named functions found so far.
+  std::vector<SCollectedSymbol>* symbols;
+};
+
+/// Invoked once per symbol in a module. Keeps functions and public code symbols, which are the
+/// only symbols that can be hooked, and discards everything else.
+/// @param [in] symbolInfo Description of the symbol.
+/// @param [in] symbolSize Size of the symbol, in bytes.
+/// @param [in] userContext Pointer to the enumeration context structure.
+/// @return `TRUE` to continue enumerating.
+static BOOL CALLBACK CollectSymbol(PSYMBOL_INFOW symbolInfo, ULONG symbolSize, PVOID userContext)
+{
+  SEnumerateContext& context = *reinterpret_cast<SEnumerateContext*>(userContext);
+
+  const bool isFunction = ((kSymTagFunction == symbolInfo->Tag) ||
+                           ((kSymTagPublicSymbol == symbolInfo->Tag) &&
+                            (0 != (symbolInfo->Flags & SYMFLAG_PUBLIC_CODE))));
+  if ((false == isFunction) || (0 == symbolInfo->NameLen)) return TRUE;
+
+  // A relative virtual address of 0 refers to the module's header, never to a function.
+  if ((symbolInfo->Address <= context.moduleBase) ||
+      (symbolInfo->Address >= (context.moduleBase + context.moduleSize)))
+    return TRUE;
+
+  const int nameLength = WideCharToMultiByte(
+      CP_UTF8,
+      0,
+      symbolInfo->Name,
+      static_cast<int>(symbolInfo->NameLen),
+      nullptr,
+      0,
+      nullptr,
+      nullptr);
+  if (nameLength <= 0) return TRUE;
+
+  std::string name(static_cast<size_t>(nameLength), '\0');
+  WideCharToMultiByte(
+      CP_UTF8,
+      0,
+      symbolInfo->Name,
+      static_cast<int>(symbolInfo->NameLen),
+      name.data(),
+      nameLength,
+      nullptr,
+      nullptr);
+
+  context.symbols->push_back(
+      {.name = std::move(name),
+       .rva = static_cast<uint32_t>(symbolInfo->Address - context.moduleBase)});
+  return TRUE;
+}
+
+/// Reads the debugging symbols of a module and collects all of its named functions. Names that
+/// refer to more than one function, such as those of overloads whose symbols are not decorated,
+/// are dropped because they cannot identify a single function.
+/// @param [in] process Pseudo-handle used to identify the symbol handler session.
+/// @param [in] moduleFilename Name of the module file.
+/// @param [out] collectedModule Filled with the module's identity and named functions.
+/// @return `true` if the module's symbols were read, `false` otherwise.
+static bool CollectModule(
+    HANDLE process, const wchar_t* moduleFilename, SCollectedModule* collectedModule)
+{
+  const DWORD64 moduleBase =
+      SymLoadModuleExW(process, nullptr, moduleFilename, nullptr, 0, 0, nullptr, 0);
+  if (0 == moduleBase)
+  {
+    fwprintf(stderr, L"%s: Failed to load module (error %u).\n", moduleFilename, GetLastError());
+    return false;
+  }
+
+  IMAGEHLP_MODULEW64 moduleInfo = {.SizeOfStruct = sizeof(moduleInfo)};
+  if ((FALSE == SymGetModuleInfoW64(process, moduleBase, &moduleInfo)) ||
+      (SymPdb != moduleInfo.SymType))
+  {
+    fwprintf(stderr, L"%s: No matching PDB symbols were found.\n", moduleFilename);
+    SymUnloadModule64(process, moduleBase);
+    return false;
+  }
+
+  std::vector<SCollectedSymbol> symbols;
+  SEnumerateContext context = {
+      .moduleBase = moduleBase, .moduleSize = moduleInfo.ImageSize, .symbols = &symbols};
+  const BOOL enumerateResult = SymEnumSymbolsW(process, moduleBase, L"*", CollectSymbol, &context);
+  SymUnloadModule64(process, moduleBase);
+
+  if (FALSE == enumerateResult)
+  {
+    fwprintf(
+        stderr, L"%s: Failed to enumerate symbols (error %u).\n", moduleFilename, GetLastError());
+    return false;
+  }
+
+  std::sort(
+      symbols.begin(),
+      symbols.end(),
+      [](const SCollectedSymbol& a, const SCollectedSymbol& b) -> bool
+      {
+        if (a.name != b.name) return (a.name < b.name);
+        return (a.rva < b.rva);
+      });
+  symbols.erase(
+      std::unique(
+          symbols.begin(),
+          symbols.end(),
+          [](const SCollectedSymbol& a, const SCollectedSymbol& b) -> bool
+          {
+            return ((a.name == b.name) && (a.rva == b.rva));
+          }),
+      symbols.end());
+
+  collectedModule->identity = {
+      .timeDateStamp = static_cast<uint32_t>(moduleInfo.TimeDateStamp),
+      .sizeOfImage = static_cast<uint32_t>(moduleInfo.ImageSize)};
+  collectedModule->symbols.clear();
+
+  size_t numAmbiguousNames = 0;
+  for (size_t i = 0; i < symbols.size();)
+  {
+    size_t numWithSameName = 1;
+    while (((i + numWithSameName) < symbols.size()) &&
+           (symbols[i + numWithSameName].name == symbols[i].name))
+      numWithSameName += 1;
+
+    if (1 == numWithSameName)
+      collectedModule->symbols.push_back(std::move(symbols[i]));
+    else
+      numAmbiguousNames += 1;
+
+    i += numWithSameName;
+  }
+
+  wprintf(
+      L"%s: %u functions indexed, %u ambiguous names skipped.\n",
+      moduleFilename,
+      (unsigned int)collectedModule->symbols.size(),
+      (unsigned int)numAmbiguousNames);
+  return true;
+}
+
+/// Writes a symbol index file that holds all of the named functions of the specified modules.
+/// @param [in] symbolIndexFilename Name of the symbol index file to write.
+/// @param [in] collectedModules Modules to include, sorted by identity.
+/// @return `true` if the file was written, `false` otherwise.
+static bool WriteSymbolIndexFile(
+    const wchar_t* symbolIndexFilename, const std::vector<SCollectedModule>& collectedModules)
+{
+  std::vector<SymbolIndex::SModuleEntry> moduleEntries;
+  std::vector<SymbolIndex::SSymbolEntry> symbolEntries;
+  std::string stringTable;
+
+  for (const SCollectedModule& collectedModule : collectedModules)
+  {
+    moduleEntries.push_back(
+        {.identity = collectedModule.identity,
+         .firstSymbol = static_cast<uint32_t>(symbolEntries.size()),
+         .numSymbols = static_cast<uint32_t>(collectedModule.symbols.size())});
+
+    for (const SCollectedSymbol& symbol : collectedModule.symbols)
+    {
+      symbolEntries.push_back(
+          {.nameOffset = static_cast<uint32_t>(stringTable.size()),
+           .nameLength = static_cast<uint32_t>(symbol.name.size()),
+           .rva = symbol.rva});
+      stringTable.append(symbol.name);
+    }
+  }
+
+  if ((symbolEntries.size() > UINT32_MAX) || (stringTable.size() > UINT32_MAX))
+  {
+    fwprintf(stderr, L"%s: Too many symbols to index.\n", symbolIndexFilename);
+    return false;
+  }
+
+  const SymbolIndex::SFileHeader fileHeader = {
+      .signature = SymbolIndex::kSignature,
+      .version = SymbolIndex::kVersion,
+      .numModules = static_cast<uint32_t>(moduleEntries.size()),
+      .numSymbols = static_cast<uint32_t>(symbolEntries.size()),
+      .stringTableSizeBytes = static_cast<uint32_t>(stringTable.size()),
+      .reserved = 0};
+
+  const HANDLE symbolIndexFile = CreateFile(
+      symbolIndexFilename,
+      GENERIC_WRITE,
+      0,
+      nullptr,
+      CREATE_ALWAYS,
+      FILE_ATTRIBUTE_NORMAL | FILE_FLAG_SEQUENTIAL_SCAN,
+      nullptr);
+  if (INVALID_HANDLE_VALUE == symbolIndexFile)
+  {
+    fwprintf(
+        stderr, L"%s: Failed to create file (error %u).\n", symbolIndexFilename, GetLastError());
+    return false;
+  }
+
+  const std::string_view fileParts[] = {
+      std::string_view(reinterpret_cast<const char*>(&fileHeader), sizeof(fileHeader)),
+      std::string_view(
+          reinterpret_cast<const char*>(moduleEntries.data()),
+          moduleEntries.size() * sizeof(SymbolIndex::SModuleEntry)),
+      std::string_view(
+          reinterpret_cast<const char*>(symbolEntries.data()),
+          symbolEntries.size() * sizeof(SymbolIndex::SSymbolEntry)),
+      std::string_view(stringTable)};
+
+  bool writeSucceeded = true;
+  for (const std::string_view filePart : fileParts)
+  {
+    DWORD numBytesWritten = 0;
+    if ((FALSE ==
+         WriteFile(
+             symbolIndexFile,
+             filePart.data(),
+             static_cast<DWORD>(filePart.size()),
+             &numBytesWritten,
+             nullptr)) ||
+        (static_cast<DWORD>(filePart.size()) != numBytesWritten))
+    {
+      writeSucceeded = false;
+      break;
+    }
+  }
+
+  CloseHandle(symbolIndexFile);
+
+  if (false == writeSucceeded)
+  {
+    fwprintf(
+        stderr, L"%s: Failed to write file (error %u).\n", symbolIndexFilename, GetLastError());
+    DeleteFile(symbolIndexFilename);
+    return false;
+  }
+
+  wprintf(
+      L"%s: Wrote %u modules and %u functions.\n",
+      symbolIndexFilename,
+      (unsigned int)moduleEntries.size(),
+      (unsigned int)symbolEntries.size());
+  return true;
+}
+
+/// Prints usage information.
+static void PrintUsage(void)
+{
+  wprintf(
+      L"Usage: HookshotSymbolIndex <symbol index file> <module>...\n\n"
+      L"Reads the PDB symbols of each module and writes the relative virtual address of every\n"
+      L"named function to a symbol index file, which hook modules can pass to\n"
+      L"CreateHooksBySymbol to hook functions that are not exported without loading any symbols\n"
+      L"into the hooked process. Symbols are located using the _NT_SYMBOL_PATH environment\n"
+      L"variable and the directory of each module, and they must exactly match the module.\n"
+      L"Entries are specific to each build of a module, so the symbol index file must be\n"
+      L"recreated whenever a module changes. It may hold any number of builds of any number of\n"
+      L"modules.\n");
+}
+
+int wmain(int argc, wchar_t* argv[])
+{
+  Hookshot::Globals::Initialize(Hookshot::Globals::ELoadMethod::Executed);
+
+  if (argc < 3)
+  {
+    PrintUsage();
+    return __LINE__;
+  }
+
+  const HANDLE process = GetCurrentProcess();
+  SymSetOptions(SYMOPT_EXACT_SYMBOLS | SYMOPT_FAIL_CRITICAL_ERRORS | SYMOPT_NO_PROMPTS);
+  if (FALSE == SymInitializeW(process, nullptr, FALSE))
+  {
+    fwprintf(stderr, L"Failed to initialize the symbol handler (error %u).\n", GetLastError());
+    return __LINE__;
+  }
+
+  std::vector<SCollectedModule> collectedModules;
+  bool allModulesCollected = true;
+
+  for (int argIndex = 2; argIndex < argc; ++argIndex)
+  {
+    SCollectedModule collectedModule;
+    if (false == CollectModule(process, argv[argIndex], &collectedModule))
+    {
+      allModulesCollected = false;
+      continue;
+    }
+
+    const bool isDuplicate = std::any_of(
+        collectedModules.begin(),
+        collectedModules.end(),
+        [&collectedModule](const SCollectedModule& existing) -> bool
+        {
+          return (existing.identity == collectedModule.identity);
+        });
+    if (true == isDuplicate)
+    {
+      wprintf(L"%s: Same build as an earlier module, skipped.\n", argv[argIndex]);
+      continue;
+    }
+
+    collectedModules.push_back(std::move(collectedModule));
+  }
+
+  SymCleanup(process);
+
+  if (false == allModulesCollected) return __LINE__;
+
+  std::sort(
+      collectedModules.begin(),
+      collectedModules.end(),
+      [](const SCollectedModule& a, const SCollectedModule& b) -> bool
+      {
+        return (a.identity < b.identity);
+      });
+
+  if (false == WriteSymbolIndexFile(argv[1], collectedModules)) return __LINE__;
+
+  return 0;
+}
@@ -0,0 +1,550 @@
+/***************************************************************************************************
+ * Hookshot
+ *   General-purpose library for injecting DLLs and hooking function calls.
+ ***************************************************************************************************
+ * Authored by Samuel Grossman
+ * Copyright (c) 2019-2025
+ ***********************************************************************************************//**
+ * @file TaskScheduler.cpp
+ *   Implementation of the scheduler that runs all of Hookshot's background work.
+ **************************************************************************************************/
+
+#include "TaskScheduler.h"
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <iterator>
+#include <mutex>
+#include <vector>
+
+#include <Infra/Core/Message.h>
+#include <Infra/Core/Strings.h>
+#include <Infra/Core/SystemInfo.h>
+
+#include "ApiWindows.h"
+#include "DependencyProtect.h"
+#include "Globals.h"
+
+namespace Hookshot
+{
+  namespace TaskScheduler
+  {
+    /// Maximum number of worker threads, regardless of how many processors are available.
+    /// Hookshot runs inside of other applications, so its background work should never occupy
+    /// more than a small share of the system.
+    static constexpr size_t kMaxWorkerThreads = 4;
+
+    /// Task that has been submitted but not yet started.
+    struct STask
+    {
+      /// Function that implements the task.
+      TTaskProc taskProc;
+
+      /// Value to pass to the task function.
+      void* context;
+
+      /// Group of which the task is a part, or `nullptr` if none.
+      STaskGroup* group;
+    };
+
+    /// Task that has been submitted to run after a delay but is not yet due.
+    struct SDelayedTask
+    {
+      /// Time at which the task becomes due.
+      std::chrono::steady_clock::time_point dueTime;
+
+      /// Task to run once it is due.
+      STask task;
+
+      /// Orders delayed tasks such that a heap built with this comparison keeps the task that is
+      /// due soonest at the front.
+      /// @param [in] other Delayed task with which to compare.
+      /// @return `true` if this task is due later than the other, `false` otherwise.
+      bool operator>(const SDelayedTask& other) const
+      {
+        return (dueTime > other.dueTime);
+      }
+    };
+
+    /// Queue of tasks that belongs to a single worker thread. The owning worker thread takes tasks
+    /// from the back, which keeps recently-submitted work on the thread that submitted it, whereas
+    /// other worker threads steal from the front.
+    struct SWorkerQueue
+    {
+      /// Enforces serialized access to the tasks.
+      std::mutex mutex;
+
+      /// Tasks waiting to be run.
+      std::deque<STask> tasks;
+    };
+
+    /// Complete state of the scheduler, created when the first task is submitted.
+    struct SScheduler
+    {
+      /// Queues of tasks, one per worker thread.
+      SWorkerQueue queues[kMaxWorkerThreads];
+
+      /// Number of worker threads that were successfully created.
+      size_t numWorkerThreads;
+
+      /// Used to distribute tasks submitted by threads other than worker threads.
+      std::atomic<size_t> nextQueueIndex;
+
+      /// Total number of tasks waiting in all of the queues. Only incremented while holding the
+      /// idle mutex, so that idle worker threads cannot miss a newly-submitted task.
+      std::atomic<size_t> numQueuedTasks;
+
+      /// Enforces serialized access for the purpose of idle worker threads waiting for tasks.
+      std::mutex idleMutex;
+
+      /// Notified whenever a task is submitted.
+      std::condition_variable taskAvailable;
+
+      /// Tasks submitted to run after a delay, organized as a heap with the task that is due soonest
+      /// at the front. Protected by the idle mutex.
+      std::vector<SDelayedTask> delayedTasks;
+    };
+
+    /// Placement and priority policy for background threads, determined once from the performance
+    /// profile.
+    struct SBackgroundThreadPolicy
+    {
+      /// Function for restricting a thread to a set of CPU sets, or `nullptr` if background
+      /// threads are not restricted.
+      decltype(&SetThreadSelectedCpuSets) setThreadSelectedCpuSets;
+
+      /// CPU sets to which background threads are restricted.
+      std::vector<ULONG> cpuSetIds;
+
+      /// Whether or not background threads run at below-normal priority.
+      bool lowerPriority;
+
+      /// Function for requesting power-efficient execution of a thread, or `nullptr` if that is
+      /// not requested or not supported.
+      decltype(&SetThreadInformation) setThreadInformation;
+    };
+
+    /// Index of the worker thread on which code is running, or a value no less than
+    /// #kMaxWorkerThreads for threads that are not worker threads.
+    static thread_local size_t currentWorkerIndex = kMaxWorkerThreads;
+
+    static SScheduler& GetScheduler(void);
+
+    /// Identifies the CPU sets that belong to the most power-efficient cores of a hybrid processor.
+    /// @param [in] getSystemCpuSetInformation Function for enumerating CPU sets.
+    /// @return Identifiers of the CPU sets, or an empty vector if every core is equally efficient
+    /// or if the CPU sets could not be enumerated.
+    static std::vector<ULONG> FindEfficiencyCoreCpuSets(
+        decltype(&GetSystemCpuSetInformation) getSystemCpuSetInformation)
+    {
+      ULONG bufferSizeBytes = 0;
+      getSystemCpuSetInformation(nullptr, 0, &bufferSizeBytes, GetCurrentProcess(), 0);
+      if (0 == bufferSizeBytes) return {};
+
+      std::vector<uint8_t> buffer(bufferSizeBytes);
+      if (FALSE ==
+          getSystemCpuSetInformation(
+              reinterpret_cast<PSYSTEM_CPU_SET_INFORMATION>(buffer.data()),
+              bufferSizeBytes,
+              &bufferSizeBytes,
+              GetCurrentProcess(),
+              0))
+        return {};
+
+      // Lower efficiency classes identify more power-efficient cores, and on processors that are
+      // not hybrid every core has the same efficiency class.
+      std::vector<ULONG> cpuSetIds;
+      BYTE minEfficiencyClass = UINT8_MAX;
+      BYTE maxEfficiencyClass = 0;
+
+      for (ULONG offset = 0; offset < bufferSizeBytes;)
+      {
+        const SYSTEM_CPU_SET_INFORMATION* const cpuSetInfo =
+            reinterpret_cast<const SYSTEM_CPU_SET_INFORMATION*>(&buffer[offset]);
+        if (0 == cpuSetInfo->Size) break;
+        offset += cpuSetInfo->Size;
+
+        if (CpuSetInformation != cpuSetInfo->Type) continue;
+        if (0 != cpuSetInfo->CpuSet.RealTime) continue;
+
+        const BYTE efficiencyClass = cpuSetInfo->CpuSet.EfficiencyClass;
+        if (efficiencyClass > maxEfficiencyClass) maxEfficiencyClass = efficiencyClass;
+        if (efficiencyClass < minEfficiencyClass)
+        {
+          minEfficiencyClass = efficiencyClass;
+          cpuSetIds.clear();
+        }
+
+        if (efficiencyClass == minEfficiencyClass) cpuSetIds.push_back(cpuSetInfo->CpuSet.Id);
+      }
+
+      if (minEfficiencyClass >= maxEfficiencyClass) return {};
+      return cpuSetIds;
+    }
+
+    /// Retrieves the background thread policy, determining it on first invocation. The functions
+    /// involved are resolved at runtime so that Hookshot still works on versions of Windows that
+    /// do not offer them.
+    /// @return Background thread policy.
+    static const SBackgroundThreadPolicy& GetBackgroundThreadPolicy(void)
+    {
+      static const SBackgroundThreadPolicy backgroundThreadPolicy = []() -> SBackgroundThreadPolicy
+      {
+        const auto& performanceProfile = Globals::GetPerformanceProfile();
+        SBackgroundThreadPolicy policy = {
+            .setThreadSelectedCpuSets = nullptr,
+            .cpuSetIds = {},
+            .lowerPriority = performanceProfile.lowerBackgroundWorkPriority,
+            .setThreadInformation = nullptr};
+
+        if ((false == performanceProfile.preferEfficiencyCoresForBackgroundWork) &&
+            (false == performanceProfile.lowerBackgroundWorkPriority))
+          return policy;
+
+        HMODULE kernel32 = nullptr;
+        Protected::Windows_GetModuleHandleEx(
+            GET_MODULE_HANDLE_EX_FLAG_UNCHANGED_REFCOUNT, L"kernel32.dll", &kernel32);
+        if (nullptr == kernel32) return policy;
+
+        if (true == performanceProfile.preferEfficiencyCoresForBackgroundWork)
+        {
+          const auto getSystemCpuSetInformation =
+              reinterpret_cast<decltype(&GetSystemCpuSetInformation)>(
+                  Protected::Windows_GetProcAddress(kernel32, "GetSystemCpuSetInformation"));
+          const auto setThreadSelectedCpuSets =
+              reinterpret_cast<decltype(&SetThreadSelectedCpuSets)>(
+                  Protected::Windows_GetProcAddress(kernel32, "SetThreadSelectedCpuSets"));
+
+          if ((nullptr != getSystemCpuSetInformation) && (nullptr != setThreadSelectedCpuSets))
+          {
+            policy.cpuSetIds = FindEfficiencyCoreCpuSets(getSystemCpuSetInformation);
+            if (false == policy.cpuSetIds.empty())
+              policy.setThreadSelectedCpuSets = setThreadSelectedCpuSets;
+          }
+
+          if (nullptr == policy.setThreadSelectedCpuSets)
+            Infra::Message::Output(
+                Infra::Message::ESeverity::Info,
+                L"Background threads are not restricted to efficiency cores because the processor does not have any or the system does not support CPU sets.");
+          else
+            Infra::Message::OutputFormatted(
+                Infra::Message::ESeverity::Info,
+                L"Background threads are restricted to %u efficiency core CPU set(s).",
+                static_cast<unsigned int>(policy.cpuSetIds.size()));
+        }
+
+        if (true == performanceProfile.lowerBackgroundWorkPriority)
+          policy.setThreadInformation = reinterpret_cast<decltype(&SetThreadInformation)>(
+              Protected::Windows_GetProcAddress(kernel32, "SetThreadInformation"));
+
+        return policy;
+      }();
+
+      return backgroundThreadPolicy;
+    }
+
+    /// Applies the background thread placement and priority policy selected by the performance
+    /// profile to a thread that performs background work.
+    /// @param [in] thread Handle of the thread, which must have permission to set information.
+    static void ApplyBackgroundThreadPolicy(HANDLE thread)
+    {
+      const SBackgroundThreadPolicy& policy = GetBackgroundThreadPolicy();
+
+      // Every part of the policy is only a preference, so failures are not reported. A thread
+      // that keeps running wherever and however the system chooses is still correct.
+      if (nullptr != policy.setThreadSelectedCpuSets)
+        policy.setThreadSelectedCpuSets(
+            thread, policy.cpuSetIds.data(), static_cast<ULONG>(policy.cpuSetIds.size()));
+
+      if (true == policy.lowerPriority)
+        Protected::Windows_SetThreadPriority(thread, THREAD_PRIORITY_BELOW_NORMAL);
+
+      if (nullptr != policy.setThreadInformation)
+      {
+        THREAD_POWER_THROTTLING_STATE powerThrottlingState = {
+            .Version = THREAD_POWER_THROTTLING_CURRENT_VERSION,
+            .ControlMask = THREAD_POWER_THROTTLING_EXECUTION_SPEED,
+            .StateMask = THREAD_POWER_THROTTLING_EXECUTION_SPEED};
+        policy.setThreadInformation(
+            thread, ThreadPowerThrottling, &powerThrottlingState, sizeof(powerThrottlingState));
+      }
+    }
+
+    /// Removes and retrieves the first task from a queue that satisfies a condition.
+    /// @tparam Predicate Type of the condition, which is invoked with a task.
+    /// @param [in] queue Queue from which to take a task.
+    /// @param [in] fromBack Whether to search from the back of the queue rather than the front.
+    /// @param [in] predicate Condition that the task must satisfy.
+    /// @param [out] task Filled with the task that was taken.
+    /// @return `true` if a task was taken, `false` otherwise.
+    template <typename Predicate> static bool TakeTaskFromQueue(
+        SWorkerQueue& queue, bool fromBack, Predicate predicate, STask* task)
+    {
+      std::scoped_lock lock(queue.mutex);
+
+      if (true == fromBack)
+      {
+        for (auto taskIter = queue.tasks.rbegin(); taskIter != queue.tasks.rend(); ++taskIter)
+        {
+          if (false == predicate(*taskIter)) continue;
+
+          *task = *taskIter;
+          queue.tasks.erase(std::next(taskIter).base());
+          GetScheduler().numQueuedTasks -= 1;
+          return true;
+        }
+      }
+      else
+      {
+        for (auto taskIter = queue.tasks.begin(); taskIter != queue.tasks.end(); ++taskIter)
+        {
+          if (false == predicate(*taskIter)) continue;
+
+          *task = *taskIter;
+          queue.tasks.erase(taskIter);
+          GetScheduler().numQueuedTasks -= 1;
+          return true;
+        }
+      }
+
+      return false;
+    }
+
+    /// Runs a task and, if it is part of a group, records its completion.
+    /// @param [in] task Task to run.
+    static void RunTask(const STask& task)
+    {
+      task.taskProc(task.context);
+
+      if (nullptr != task.group)
+      {
+        std::scoped_lock lock(task.group->mutex);
+
+        task.group->numOutstanding -= 1;
+        if (0 == task.group->numOutstanding) task.group->completed.notify_all();
+      }
+    }
+
+    /// Retrieves the next task for a worker thread to run, first from its own queue and then by
+    /// stealing from the queues of the other worker threads.
+    /// @param [in] workerIndex Index of the worker thread.
+    /// @param [out] task Filled with the task that was taken.
+    /// @return `true` if a task was taken, `false` if all of the queues are empty.
+    static bool TakeTaskForWorker(size_t workerIndex, STask* task)
+    {
+      SScheduler& scheduler = GetScheduler();
+      auto anyTask = [](const STask&) -> bool
+      {
+        return true;
+      };
+
+      if (true == TakeTaskFromQueue(scheduler.queues[workerIndex], true, anyTask, task))
+        return true;
+
+      for (size_t offset = 1; offset < scheduler.numWorkerThreads; ++offset)
+      {
+        const size_t victimIndex = (workerIndex + offset) % scheduler.numWorkerThreads;
+        if (true == TakeTaskFromQueue(scheduler.queues[victimIndex], false, anyTask, task))
+          return true;
+      }
+
+      return false;
+    }
+
+    /// Entry point for each worker thread, which runs tasks for the lifetime of the process. A
+    /// worker thread with nothing queued runs the delayed task that is due soonest, if it is due,
+    /// and otherwise sleeps until either a task is submitted or a delayed task becomes due.
+    /// @param [in] parameter Index of the worker thread.
+    /// @return Never returns.
+    static DWORD WINAPI WorkerThreadProc(LPVOID parameter)
+    {
+      SScheduler& scheduler = GetScheduler();
+      const size_t workerIndex = reinterpret_cast<size_t>(parameter);
+      currentWorkerIndex = workerIndex;
+
+      while (true)
+      {
+        STask task;
+        if (true == TakeTaskForWorker(workerIndex, &task))
+        {
+          RunTask(task);
+          continue;
+        }
+
+        std::unique_lock<std::mutex> lock(scheduler.idleMutex);
+        if (0 != scheduler.numQueuedTasks) continue;
+
+        if (true == scheduler.delayedTasks.empty())
+        {
+          scheduler.taskAvailable.wait(lock);
+          continue;
+        }
+
+        const auto dueTime = scheduler.delayedTasks.front().dueTime;
+        if (dueTime > std::chrono::steady_clock::now())
+        {
+          scheduler.taskAvailable.wait_until(lock, dueTime);
+          continue;
+        }
+
+        std::pop_heap(
+            scheduler.delayedTasks.begin(),
+            scheduler.delayedTasks.end(),
+            std::greater<SDelayedTask>());
+        task = scheduler.delayedTasks.back().task;
+        scheduler.delayedTasks.pop_back();
+
+        lock.unlock();
+        RunTask(task);
+      }
+
+      return 0;
+    }
+
+    /// Retrieves the scheduler, creating it and its worker threads on first invocation. One
+    /// processor is left for the application, up to the maximum number of worker threads.
+    /// @return Scheduler state.
+    static SScheduler& GetScheduler(void)
+    {
+      static SScheduler* const scheduler = []() -> SScheduler*
+      {
+        SScheduler* const newScheduler = new SScheduler();
+
+        const size_t numProcessors = static_cast<size_t>(
+            Infra::SystemInfo::GetPlatformAndArchitectureInfo().dwNumberOfProcessors);
+        size_t numDesiredWorkerThreads = ((numProcessors > 1) ? (numProcessors - 1) : 1);
+        if (numDesiredWorkerThreads > kMaxWorkerThreads)
+          numDesiredWorkerThreads = kMaxWorkerThreads;
+
+        // Worker threads begin by retrieving the scheduler, which blocks them until it is fully
+        // initialized.
+        for (size_t i = 0; i < numDesiredWorkerThreads; ++i)
+        {
+          const HANDLE workerThread =
+              CreateBackgroundThread(WorkerThreadProc, reinterpret_cast<LPVOID>(i));
+          if (nullptr == workerThread)
+          {
+            Infra::Message::OutputFormatted(
+                Infra::Message::ESeverity::Warning,
+                L"Failed to create a task scheduler worker thread: %s",
+                Infra::Strings::FromSystemErrorCode(Protected::Windows_GetLastError())
+                    .AsCString());
+            break;
+          }
+
+          Protected::Windows_CloseHandle(workerThread);
+          newScheduler->numWorkerThreads += 1;
+        }
+
+        return newScheduler;
+      }();
+
+      return *scheduler;
+    }
+
+    void Submit(TTaskProc taskProc, void* context, STaskGroup* group)
+    {
+      if (nullptr != group)
+      {
+        std::scoped_lock lock(group->mutex);
+        group->numOutstanding += 1;
+      }
+
+      const STask task = {.taskProc = taskProc, .context = context, .group = group};
+
+      SScheduler& scheduler = GetScheduler();
+      if (0 == scheduler.numWorkerThreads)
+      {
+        RunTask(task);
+        return;
+      }
+
+      // Worker threads submit to their own queues, whereas all other threads spread their tasks
+      // across all of the queues.
+      const size_t queueIndex =
+          ((currentWorkerIndex < scheduler.numWorkerThreads)
+               ? currentWorkerIndex
+               : (scheduler.nextQueueIndex++ % scheduler.numWorkerThreads));
+
+      do
+      {
+        std::scoped_lock lock(scheduler.idleMutex);
+        scheduler.numQueuedTasks += 1;
+      }
+      while (false);
+
+      do
+      {
+        std::scoped_lock lock(scheduler.queues[queueIndex].mutex);
+        scheduler.queues[queueIndex].tasks.push_back(task);
+      }
+      while (false);
+
+      scheduler.taskAvailable.notify_one();
+    }
+
+    bool SubmitAfter(uint32_t delayMilliseconds, TTaskProc taskProc, void* context)
+    {
+      SScheduler& scheduler = GetScheduler();
+      if (0 == scheduler.numWorkerThreads) return false;
+
+      const SDelayedTask delayedTask = {
+          .dueTime =
+              std::chrono::steady_clock::now() + std::chrono::milliseconds(delayMilliseconds),
+          .task = {.taskProc = taskProc, .context = context, .group = nullptr}};
+
+      do
+      {
+        std::scoped_lock lock(scheduler.idleMutex);
+        scheduler.delayedTasks.push_back(delayedTask);
+        std::push_heap(
+            scheduler.delayedTasks.begin(),
+            scheduler.delayedTasks.end(),
+            std::greater<SDelayedTask>());
+      }
+      while (false);
+
+      // Whichever idle worker thread wakes up will sleep again until the new task is due, if it is
+      // due before every other delayed task.
+      scheduler.taskAvailable.notify_one();
+      return true;
+    }
+
+    void Wait(STaskGroup& group)
+    {
+      SScheduler& scheduler = GetScheduler();
+      auto isTaskInGroup = [&group](const STask& task) -> bool
+      {
+        return (&group == task.group);
+      };
+
+      for (size_t i = 0; i < scheduler.numWorkerThreads; ++i)
+      {
+        STask task;
+        while (true == TakeTaskFromQueue(scheduler.queues[i], false, isTaskInGroup, &task))
+          RunTask(task);
+      }
+
+      std::unique_lock<std::mutex> lock(group.mutex);
+      group.completed.wait(lock, [&group]() -> bool { return (0 == group.numOutstanding); });
+    }
+
+    HANDLE CreateBackgroundThread(LPTHREAD_START_ROUTINE threadProc, LPVOID parameter)
+    {
+      // The thread starts suspended so that none of its work happens outside of the policy.
+      const HANDLE thread = Protected::Windows_CreateThread(
+          nullptr, 0, threadProc, parameter, CREATE_SUSPENDED, nullptr);
+      if (nullptr == thread) return nullptr;
+
+      ApplyBackgroundThreadPolicy(thread);
+      Protected::Windows_ResumeThread(thread);
+      return thread;
+    }
+  } // namespace TaskScheduler
+} // namespace Hookshot
@@ -11,35 +11,325 @@
 
 #include <windows.h>
 
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <thread>
+#include <vector>
+
 #include <Infra/Test/Utilities.h>
 
+#include "Arm64Instruction.h"
+#include "CallTraceReader.h"
+#include "CallTracing.h"
+#include "CodeCaves.h"
+#include "FunctionGenerator.h"
+#include "HookIntegrity.h"
 #include "Hookshot.h"
 #include "TestGlobals.h"
 #include "TestPattern.h"
-
-/// Generates a new function using FunctionGenerator and returns a pointer to it.
-/// A maximum of one instance of this macro can exist on each source code line.
-#define GENERATE_FUNCTION()               &FunctionGenerator<__LINE__>
-
-/// Generates a new function using FunctionGenerator and creates a pointer to it, using the
-/// specified name as the variable name. A maximum of one instance of this macro can exist on each
-/// source code line.
-#define GENERATE_AND_ASSIGN_FUNCTION(var) const auto var = GENERATE_FUNCTION()
+#include "X86Instruction.h"
 
 namespace HookshotTest
 {
-  /// Pointer-to-function type for the FunctionGenerator function template.
-  using TGeneratedTestFunction = int (*)(void);
+  /// Progress callback for asynchronous hook installation tests. Records the most recent report.
+  /// @param [in] context Pointer to a two-element array to receive the number of hooks processed
+  /// and the total number of hooks.
+  /// @param [in] numHooksProcessed Number of hooks whose creation has been attempted so far.
+  /// @param [in] numHooksTotal Total number of hooks in the operation.
+  static void __fastcall RecordHookInstallProgress(
+      void* context, size_t numHooksProcessed, size_t numHooksTotal)
+  {
+    size_t* const progress = reinterpret_cast<size_t*>(context);
+    progress[0] = numHooksProcessed;
+    progress[1] = numHooksTotal;
+  }
+
+  /// Pre callback for callback hook tests. Counts the call and marks it for the post callback.
+  /// @param [in,out] call Information about the intercepted call, whose context is a pointer to a
+  /// three-element array holding the number of pre callbacks, the number of post callbacks, and
+  /// the most recent return value.
+  static void __fastcall CountCallbackHookPre(Hookshot::SCallbackHookCall* call)
+  {
+    size_t* const counts = reinterpret_cast<size_t*>(call->context);
+    counts[0] += 1;
+    call->userData = counts[0];
+  }
+
+  /// Post callback for callback hook tests. Counts the call, if it was marked by the pre callback,
+  /// and records the return value.
+  /// @param [in,out] call Information about the intercepted call, with the same context as for
+  /// the pre callback.
+  /// @param [in] returnValue Value returned by the original function.
+  static void __fastcall CountCallbackHookPost(
+      Hookshot::SCallbackHookCall* call, size_t returnValue)
+  {
+    size_t* const counts = reinterpret_cast<size_t*>(call->context);
+    if (counts[0] == call->userData) counts[1] += 1;
+    counts[2] = returnValue;
+  }
+
+  /// Probe callback for probe tests. Counts the number of times execution reaches the probe.
+  /// @param [in,out] probeContext State of the processor at the probe, whose context is a pointer
+  /// to the count.
+  static void __fastcall CountProbe(Hookshot::SProbeContext* probeContext)
+  {
+    *reinterpret_cast<size_t*>(probeContext->context) += 1;
+  }
+
+  /// Offset of the hook context slot, retrieved before any context hooks are created so that the
+  /// generic context hook function can read its context value without invoking any functions.
+  static size_t hookContextOffset = 0;
+
+  /// Generic hook function for context hook tests.
+  /// @return Context value of the context hook that invoked this function.
+  static int GenericContextHookFunc(void)
+  {
+    return static_cast<int>(
+        reinterpret_cast<intptr_t>(Hookshot::ReadHookContext(hookContextOffset)));
+  }
+
+  // Relocates ARM64 instructions of every position-dependent form, both to a nearby location and
+  // to one beyond their reach, and verifies the encodings that result. Addresses are synthetic
+  // because nothing executes, which is what allows this test to run on any architecture.
+  HOOKSHOT_CUSTOM_TEST(Arm64InstructionRelocation)
+  {
+    constexpr uintptr_t kOriginalAddress = 0x10000000;
+    constexpr uintptr_t kNearAddress = kOriginalAddress + 0x1000;
+    constexpr uintptr_t kFarAddress = kOriginalAddress + 0x20000000;
+    constexpr uintptr_t kTargetAddress = kOriginalAddress + 0x100;
+
+    constexpr uint32_t kAddInstruction = 0x91000420;
+    constexpr uint32_t kBranchInstruction = 0x14000040;
+    constexpr uint32_t kBranchWithLinkInstruction = 0x94000040;
+    constexpr uint32_t kBranchIfNotEqualInstruction = 0x54000801;
+    constexpr uint32_t kCompareAndBranchIfZeroInstruction = 0xb4000801;
+    constexpr uint32_t kTestAndBranchIfZeroInstruction = 0x36180802;
+    constexpr uint32_t kAdrInstruction = 0x10000803;
+    constexpr uint32_t kLoadLiteralGprInstruction = 0x58000806;
+    constexpr uint32_t kLoadLiteralSimdInstruction = 0x9c00080b;
+    constexpr uint32_t kPrefetchLiteralInstruction = 0xd8000800;
+
+    constexpr uint32_t kLoadBranchScratchLiteralInstruction = 0x58000050;
+    constexpr uint32_t kBranchToScratchInstruction = 0xd61f0200;
+
+    uint32_t relocated[Hookshot::Arm64Instruction::kMaxRelocatedLengthBytes / sizeof(uint32_t)];
+
+    auto relocate = [&relocated](uint32_t encoding, uintptr_t executionAddress) -> int
+    {
+      Hookshot::Arm64Instruction instruction;
+      if (false == instruction.DecodeInstruction(
+          encoding, reinterpret_cast<const void*>(kOriginalAddress)))
+        return 0;
+
+      std::memset(relocated, 0, sizeof(relocated));
+      return instruction.EncodeInstruction(
+          relocated,
+          static_cast<int>(sizeof(relocated)),
+          reinterpret_cast<const void*>(executionAddress));
+    };
+
+    auto relocatedTargetAt = [&relocated](size_t index, uintptr_t executionAddress) -> uintptr_t
+    {
+      Hookshot::Arm64Instruction instruction;
+      if (false == instruction.DecodeInstruction(
+          relocated[index],
+          reinterpret_cast<const void*>(executionAddress + (index * sizeof(uint32_t)))))
+        return 0;
+
+      return reinterpret_cast<uintptr_t>(instruction.GetAbsoluteMemoryReferenceTarget());
+    };
+
+    auto relocatedLiteralAt = [&relocated](size_t index) -> uint64_t
+    {
+      uint64_t literal = 0;
+      std::memcpy(&literal, &relocated[index], sizeof(literal));
+      return literal;
+    };
+
+    // Instructions that do not depend on their position are copied.
+    TEST_ASSERT(4 == relocate(kAddInstruction, kFarAddress));
+    TEST_ASSERT(kAddInstruction == relocated[0]);
+
+    // Within reach, every position-dependent instruction is re-encoded in place.
+    const uint32_t positionDependentInstructions[] = {
+        kBranchInstruction,
+        kBranchWithLinkInstruction,
+        kBranchIfNotEqualInstruction,
+        kCompareAndBranchIfZeroInstruction,
+        kTestAndBranchIfZeroInstruction,
+        kAdrInstruction,
+        kLoadLiteralGprInstruction,
+        kLoadLiteralSimdInstruction,
+        kPrefetchLiteralInstruction};
+
+    for (const uint32_t encoding : positionDependentInstructions)
+    {
+      TEST_ASSERT(4 == relocate(encoding, kNearAddress));
+      TEST_ASSERT(kTargetAddress == relocatedTargetAt(0, kNearAddress));
+    }
 
-  /// Not intended ever to be called, but can be used to generate original and hook functions.
-  template <int n> HOOKSHOT_TEST_HELPER_FUNCTION int FunctionGenerator(void)
+    // Out of reach, an unconditional branch becomes an absolute jump through `x16`.
+    TEST_ASSERT(16 == relocate(kBranchInstruction, kFarAddress));
+    TEST_ASSERT(kLoadBranchScratchLiteralInstruction == relocated[0]);
+    TEST_ASSERT(kBranchToScratchInstruction == relocated[1]);
+    TEST_ASSERT(kTargetAddress == relocatedLiteralAt(2));
+
+    // A call becomes `blr x16` followed by a branch over the literal.
+    TEST_ASSERT(20 == relocate(kBranchWithLinkInstruction, kFarAddress));
+    TEST_ASSERT(0x58000070 == relocated[0]);
+    TEST_ASSERT(0xd63f0200 == relocated[1]);
+    TEST_ASSERT(0x14000003 == relocated[2]);
+    TEST_ASSERT(kTargetAddress == relocatedLiteralAt(3));
+
+    // Conditional branches invert their condition to skip over an absolute jump.
+    TEST_ASSERT(20 == relocate(kBranchIfNotEqualInstruction, kFarAddress));
+    TEST_ASSERT(0x540000a0 == relocated[0]);
+    TEST_ASSERT(kLoadBranchScratchLiteralInstruction == relocated[1]);
+    TEST_ASSERT(kTargetAddress == relocatedLiteralAt(3));
+
+    TEST_ASSERT(20 == relocate(kCompareAndBranchIfZeroInstruction, kFarAddress));
+    TEST_ASSERT(0xb50000a1 == relocated[0]);
+    TEST_ASSERT(kTargetAddress == relocatedLiteralAt(3));
+
+    TEST_ASSERT(20 == relocate(kTestAndBranchIfZeroInstruction, kFarAddress));
+    TEST_ASSERT(0x371800a2 == relocated[0]);
+    TEST_ASSERT(kTargetAddress == relocatedLiteralAt(3));
+
+    // An address computation becomes `adrp` and `add`.
+    TEST_ASSERT(8 == relocate(kAdrInstruction, kFarAddress));
+    TEST_ASSERT((kTargetAddress & ~0xfffull) == relocatedTargetAt(0, kFarAddress));
+    TEST_ASSERT(0x91040063 == relocated[1]);
+
+    // A load from a literal loads the address of the literal into its own destination register,
+    // or into `x17` if the destination is a SIMD register, and then loads through it.
+    TEST_ASSERT(20 == relocate(kLoadLiteralGprInstruction, kFarAddress));
+    TEST_ASSERT(0x58000066 == relocated[0]);
+    TEST_ASSERT(0xf94000c6 == relocated[1]);
+    TEST_ASSERT(0x14000003 == relocated[2]);
+    TEST_ASSERT(kTargetAddress == relocatedLiteralAt(3));
+
+    TEST_ASSERT(20 == relocate(kLoadLiteralSimdInstruction, kFarAddress));
+    TEST_ASSERT(0x58000071 == relocated[0]);
+    TEST_ASSERT(0x3dc0022b == relocated[1]);
+    TEST_ASSERT(kTargetAddress == relocatedLiteralAt(3));
+
+    // A prefetch is only a hint, so it is dropped.
+    TEST_ASSERT(4 == relocate(kPrefetchLiteralInstruction, kFarAddress));
+    TEST_ASSERT(Hookshot::Arm64Instruction::kNopInstruction == relocated[0]);
+
+#ifdef _WIN64
+    // Beyond the 4 GB reach of `adrp`, an address computation loads its result from a literal.
+    constexpr uintptr_t kVeryFarAddress = kOriginalAddress + 0x200000000;
+    TEST_ASSERT(16 == relocate(kAdrInstruction, kVeryFarAddress));
+    TEST_ASSERT(0x58000043 == relocated[0]);
+    TEST_ASSERT(0x14000003 == relocated[1]);
+    TEST_ASSERT(kTargetAddress == relocatedLiteralAt(2));
+#endif
+
+    // Relocation fails instead of writing a partial sequence if the buffer is too small.
+    Hookshot::Arm64Instruction branchInstruction;
+    TEST_ASSERT(true == branchInstruction.DecodeInstruction(
+        kBranchInstruction, reinterpret_cast<const void*>(kOriginalAddress)));
+    TEST_ASSERT(0 == branchInstruction.EncodeInstruction(
+        relocated, 8, reinterpret_cast<const void*>(kFarAddress)));
+
+    // Transplanting code relocates whole instructions and then jumps back to the rest.
+    const uint32_t originalCode[] = {kAddInstruction, 0x54000041, kAddInstruction};
+    uint32_t transplantedCode[16] = {};
+    int numRelocatedBytes = 0;
+    TEST_ASSERT(12 == Hookshot::Arm64Instruction::TransplantInstructions(
+        originalCode,
+        8,
+        transplantedCode,
+        static_cast<int>(sizeof(transplantedCode)),
+        &numRelocatedBytes));
+    TEST_ASSERT(8 == numRelocatedBytes);
+    TEST_ASSERT(kAddInstruction == transplantedCode[0]);
+
+    Hookshot::Arm64Instruction transplantedInstruction;
+    TEST_ASSERT(true == transplantedInstruction.DecodeInstruction(&transplantedCode[1]));
+    TEST_ASSERT(&originalCode[3] == transplantedInstruction.GetAbsoluteMemoryReferenceTarget());
+    TEST_ASSERT(true == transplantedInstruction.DecodeInstruction(&transplantedCode[2]));
+    TEST_ASSERT(&originalCode[2] == transplantedInstruction.GetAbsoluteMemoryReferenceTarget());
+  }
+
+  // Creates multiple hooks asynchronously and waits for them to be created.
+  // Verifies that progress is reported and that the hooks are created as if by a batch.
+  HOOKSHOT_CUSTOM_TEST(AsyncCreateHooks)
+  {
+    GENERATE_AND_ASSIGN_FUNCTION(originalFuncA);
+    GENERATE_AND_ASSIGN_FUNCTION(hookFuncA);
+    GENERATE_AND_ASSIGN_FUNCTION(originalFuncB);
+    GENERATE_AND_ASSIGN_FUNCTION(hookFuncB);
+
+    const Hookshot::SHookSpec hookSpecs[] = {
+        {.originalFunc = originalFuncA, .hookFunc = hookFuncA},
+        {.originalFunc = nullptr, .hookFunc = hookFuncB},
+        {.originalFunc = originalFuncB, .hookFunc = hookFuncB}};
+
+    size_t progress[2] = {};
+    Hookshot::SHookInstallOperation* operation = nullptr;
+    TEST_ASSERT(Hookshot::SuccessfulResult(HookshotInterface()->BeginCreateHooksAsync(
+        hookSpecs, _countof(hookSpecs), RecordHookInstallProgress, progress, &operation)));
+    TEST_ASSERT(nullptr != operation);
+
+    Hookshot::EResult results[_countof(hookSpecs)];
+    TEST_ASSERT(
+        Hookshot::EResult::FailInvalidArgument ==
+        HookshotInterface()->WaitForHookInstall(operation, results));
+
+    TEST_ASSERT(Hookshot::SuccessfulResult(results[0]));
+    TEST_ASSERT(Hookshot::EResult::FailInvalidArgument == results[1]);
+    TEST_ASSERT(Hookshot::SuccessfulResult(results[2]));
+    TEST_ASSERT(_countof(hookSpecs) == progress[0]);
+    TEST_ASSERT(_countof(hookSpecs) == progress[1]);
+
+    TEST_ASSERT(hookFuncA() == originalFuncA());
+    TEST_ASSERT(hookFuncB() == originalFuncB());
+  }
+
+  // Starts creating multiple hooks asynchronously and immediately cancels the operation.
+  // Verifies that, depending on whether the cancellation arrived in time, either all of the hooks
+  // are created or none of them remain.
+  HOOKSHOT_CUSTOM_TEST(AsyncCreateHooksCancel)
   {
-    const int val = 100 * n;
+    GENERATE_AND_ASSIGN_FUNCTION(originalFuncA);
+    GENERATE_AND_ASSIGN_FUNCTION(hookFuncA);
+    GENERATE_AND_ASSIGN_FUNCTION(originalFuncB);
+    GENERATE_AND_ASSIGN_FUNCTION(hookFuncB);
+
+    const auto originalFuncAResult = originalFuncA();
+    const auto originalFuncBResult = originalFuncB();
+
+    const Hookshot::SHookSpec hookSpecs[] = {
+        {.originalFunc = originalFuncA, .hookFunc = hookFuncA},
+        {.originalFunc = originalFuncB, .hookFunc = hookFuncB}};
+
+    Hookshot::SHookInstallOperation* operation = nullptr;
+    TEST_ASSERT(Hookshot::SuccessfulResult(HookshotInterface()->BeginCreateHooksAsync(
+        hookSpecs, _countof(hookSpecs), nullptr, nullptr, &operation)));
+    TEST_ASSERT(Hookshot::SuccessfulResult(HookshotInterface()->CancelHookInstall(operation)));
 
-    for (int i = 0; i < (val / 10); ++i)
-      srand(static_cast<unsigned int>(val + i));
+    Hookshot::EResult results[_countof(hookSpecs)];
+    const Hookshot::EResult overallResult =
+        HookshotInterface()->WaitForHookInstall(operation, results);
 
-    return val;
+    if (Hookshot::EResult::FailCancelled == overallResult)
+    {
+      TEST_ASSERT(Hookshot::EResult::FailCancelled == results[0]);
+      TEST_ASSERT(Hookshot::EResult::FailCancelled == results[1]);
+      TEST_ASSERT(originalFuncAResult == originalFuncA());
+      TEST_ASSERT(originalFuncBResult == originalFuncB());
+      TEST_ASSERT(nullptr == HookshotInterface()->GetOriginalFunction(originalFuncA));
+      TEST_ASSERT(nullptr == HookshotInterface()->GetOriginalFunction(originalFuncB));
+    }
+    else
+    {
+      TEST_ASSERT(Hookshot::EResult::Success == overallResult);
+      TEST_ASSERT(hookFuncA() == originalFuncA());
+      TEST_ASSERT(hookFuncB() == originalFuncB());
+    }
   }
 
   // Creates a hook chain going backwards.
@@ -54,6 +344,307 @@ namespace HookshotTest
     TEST_ASSERT(Hookshot::EResult::FailDuplicate == HookshotInterface()->CreateHook(funcA, funcB));
   }
 
+  // Creates multiple hooks in a single batch, some of which are invalid.
+  // Verifies that valid hooks are created and invalid hooks are individually rejected.
+  HOOKSHOT_CUSTOM_TEST(BatchCreateHooks)
+  {
+    GENERATE_AND_ASSIGN_FUNCTION(originalFuncA);
+    GENERATE_AND_ASSIGN_FUNCTION(hookFuncA);
+    GENERATE_AND_ASSIGN_FUNCTION(originalFuncB);
+    GENERATE_AND_ASSIGN_FUNCTION(hookFuncB);
+    GENERATE_AND_ASSIGN_FUNCTION(originalFuncC);
+    GENERATE_AND_ASSIGN_FUNCTION(hookFuncC);
+
+    const auto originalFuncAResult = originalFuncA();
+    const auto originalFuncBResult = originalFuncB();
+    const auto hookFuncAResult = hookFuncA();
+    const auto hookFuncBResult = hookFuncB();
+    const auto hookFuncCResult = hookFuncC();
+
+    const Hookshot::SHookSpec hookSpecs[] = {
+        {.originalFunc = originalFuncA, .hookFunc = hookFuncA},
+        {.originalFunc = nullptr, .hookFunc = hookFuncC},
+        {.originalFunc = originalFuncB, .hookFunc = hookFuncB},
+        {.originalFunc = originalFuncA, .hookFunc = hookFuncC},
+        {.originalFunc = hookFuncB, .hookFunc = hookFuncC},
+        {.originalFunc = originalFuncC, .hookFunc = hookFuncC}};
+
+    Hookshot::EResult results[_countof(hookSpecs)];
+    TEST_ASSERT(
+        Hookshot::EResult::FailInvalidArgument ==
+        HookshotInterface()->CreateHooks(hookSpecs, _countof(hookSpecs), results));
+
+    TEST_ASSERT(Hookshot::SuccessfulResult(results[0]));
+    TEST_ASSERT(Hookshot::EResult::FailInvalidArgument == results[1]);
+    TEST_ASSERT(Hookshot::SuccessfulResult(results[2]));
+    TEST_ASSERT(Hookshot::EResult::FailDuplicate == results[3]);
+    TEST_ASSERT(Hookshot::EResult::FailDuplicate == results[4]);
+    TEST_ASSERT(Hookshot::SuccessfulResult(results[5]));
+
+    TEST_ASSERT(hookFuncAResult == originalFuncA());
+    TEST_ASSERT(hookFuncBResult == originalFuncB());
+    TEST_ASSERT(hookFuncCResult == originalFuncC());
+    TEST_ASSERT(
+        originalFuncAResult ==
+        ((decltype(originalFuncA))HookshotInterface()->GetOriginalFunction(hookFuncA))());
+    TEST_ASSERT(
+        originalFuncBResult ==
+        ((decltype(originalFuncB))HookshotInterface()->GetOriginalFunction(originalFuncB))());
+  }
+
+  // Creates multiple hooks by export name in a single batch, none of which can be created.
+  // Verifies that exports that do not exist are reported as such and that no hooks are created.
+  HOOKSHOT_CUSTOM_TEST(BatchCreateHooksByExportName)
+  {
+    GENERATE_AND_ASSIGN_FUNCTION(hookFuncA);
+    GENERATE_AND_ASSIGN_FUNCTION(hookFuncB);
+
+    const HMODULE moduleHandle = GetModuleHandle(L"kernel32.dll");
+    TEST_ASSERT(nullptr != moduleHandle);
+
+    const char* const exportNames[] = {"HookshotTestExportThatDoesNotExist", nullptr};
+    const void* const hookFuncs[] = {hookFuncA, hookFuncB};
+
+    Hookshot::EResult results[_countof(exportNames)];
+    TEST_ASSERT(
+        Hookshot::EResult::FailNotFound ==
+        HookshotInterface()->CreateHooksByExportName(
+            moduleHandle, exportNames, hookFuncs, _countof(exportNames), results));
+
+    TEST_ASSERT(Hookshot::EResult::FailNotFound == results[0]);
+    TEST_ASSERT(Hookshot::EResult::FailInvalidArgument == results[1]);
+    TEST_ASSERT(nullptr == HookshotInterface()->GetOriginalFunction(hookFuncA));
+    TEST_ASSERT(nullptr == HookshotInterface()->GetOriginalFunction(hookFuncB));
+
+    TEST_ASSERT(
+        Hookshot::EResult::FailInvalidArgument ==
+        HookshotInterface()->CreateHooksByExportName(
+            nullptr, exportNames, hookFuncs, _countof(exportNames), nullptr));
+    TEST_ASSERT(
+        Hookshot::EResult::NoEffect ==
+        HookshotInterface()->CreateHooksByExportName(moduleHandle, nullptr, nullptr, 0, nullptr));
+  }
+
+  // Creates multiple hooks by symbol name in a single batch using a symbol index file that does
+  // not exist. Verifies that every name is reported as not found and that no hooks are created.
+  HOOKSHOT_CUSTOM_TEST(BatchCreateHooksBySymbol)
+  {
+    Hookshot::IHookshot12* const hookshot12 = reinterpret_cast<Hookshot::IHookshot12*>(
+        HookshotInterface()->QueryInterface(Hookshot::kInterfaceVersion12));
+    TEST_ASSERT(nullptr != hookshot12);
+
+    GENERATE_AND_ASSIGN_FUNCTION(hookFuncA);
+    GENERATE_AND_ASSIGN_FUNCTION(hookFuncB);
+
+    const HMODULE moduleHandle = GetModuleHandle(nullptr);
+    TEST_ASSERT(nullptr != moduleHandle);
+
+    constexpr wchar_t kSymbolIndexFilename[] = L"HookshotTestFileThatDoesNotExist.SymbolIndex";
+    const char* const symbolNames[] = {"HookshotTestSymbolThatDoesNotExist", nullptr};
+    const void* const hookFuncs[] = {hookFuncA, hookFuncB};
+
+    Hookshot::EResult results[_countof(symbolNames)];
+    TEST_ASSERT(
+        Hookshot::EResult::FailNotFound ==
+        hookshot12->CreateHooksBySymbol(
+            kSymbolIndexFilename,
+            moduleHandle,
+            symbolNames,
+            hookFuncs,
+            _countof(symbolNames),
+            results));
+
+    TEST_ASSERT(Hookshot::EResult::FailNotFound == results[0]);
+    TEST_ASSERT(Hookshot::EResult::FailInvalidArgument == results[1]);
+    TEST_ASSERT(nullptr == HookshotInterface()->GetOriginalFunction(hookFuncA));
+    TEST_ASSERT(nullptr == HookshotInterface()->GetOriginalFunction(hookFuncB));
+
+    TEST_ASSERT(
+        Hookshot::EResult::FailInvalidArgument ==
+        hookshot12->CreateHooksBySymbol(
+            nullptr, moduleHandle, symbolNames, hookFuncs, _countof(symbolNames), nullptr));
+    TEST_ASSERT(
+        Hookshot::EResult::NoEffect ==
+        hookshot12->CreateHooksBySymbol(
+            kSymbolIndexFilename, moduleHandle, nullptr, nullptr, 0, nullptr));
+  }
+
+  // Looks up original functions on multiple threads while hooks are being created and replaced.
+  // Verifies that lock-free lookups only ever observe fully-constructed hooks.
+  // Information structure to pass to each thread.
+  struct SConcurrentLookupsTestData
+  {
+    Hookshot::IHookshot* hookshot;
+
+    volatile LONG stopFlag;
+
+    TGeneratedTestFunction* originalFuncs;
+    int* originalFuncResults;
+    int numFuncs;
+  };
+
+  // Executed by each thread. Returns the number of lookups that produced a wrong result.
+  DWORD WINAPI ConcurrentLookupsTestThreadProc(LPVOID lpParameter)
+  {
+    SConcurrentLookupsTestData& testData =
+        *reinterpret_cast<SConcurrentLookupsTestData*>(lpParameter);
+    DWORD numFailures = 0;
+
+    while (0 == InterlockedCompareExchange(&testData.stopFlag, 0, 0))
+    {
+      for (int i = 0; i < testData.numFuncs; ++i)
+      {
+        const auto originalFunc = reinterpret_cast<TGeneratedTestFunction>(
+            testData.hookshot->GetOriginalFunction(testData.originalFuncs[i]));
+        if ((nullptr != originalFunc) && (testData.originalFuncResults[i] != originalFunc()))
+          numFailures += 1;
+      }
+    }
+
+    return numFailures;
+  }
+
+  // Main test case logic.
+  HOOKSHOT_CUSTOM_TEST(ConcurrentLookups)
+  {
+    // Each generated function must appear on its own line.
+
+    // clang-format off
+
+    TGeneratedTestFunction originalFuncs[] = {
+        GENERATE_FUNCTION(),
+        GENERATE_FUNCTION(),
+        GENERATE_FUNCTION(),
+        GENERATE_FUNCTION(),
+        GENERATE_FUNCTION(),
+        GENERATE_FUNCTION(),
+        GENERATE_FUNCTION(),
+        GENERATE_FUNCTION()};
+
+    TGeneratedTestFunction hookFuncs[] = {
+        GENERATE_FUNCTION(),
+        GENERATE_FUNCTION(),
+        GENERATE_FUNCTION(),
+        GENERATE_FUNCTION(),
+        GENERATE_FUNCTION(),
+        GENERATE_FUNCTION(),
+        GENERATE_FUNCTION(),
+        GENERATE_FUNCTION()};
+
+    TGeneratedTestFunction replacementHookFuncs[] = {
+        GENERATE_FUNCTION(),
+        GENERATE_FUNCTION(),
+        GENERATE_FUNCTION(),
+        GENERATE_FUNCTION(),
+        GENERATE_FUNCTION(),
+        GENERATE_FUNCTION(),
+        GENERATE_FUNCTION(),
+        GENERATE_FUNCTION()};
+
+    // clang-format on
+
+    static_assert(
+        (_countof(originalFuncs) == _countof(hookFuncs)) &&
+            (_countof(originalFuncs) == _countof(replacementHookFuncs)),
+        "ConcurrentLookups Test: number of original and hook functions must match.");
+
+    int originalFuncResults[_countof(originalFuncs)];
+    for (int i = 0; i < _countof(originalFuncs); ++i)
+      originalFuncResults[i] = originalFuncs[i]();
+
+    SConcurrentLookupsTestData testData{
+        .hookshot = HookshotInterface(),
+        .stopFlag = 0,
+        .originalFuncs = originalFuncs,
+        .originalFuncResults = originalFuncResults,
+        .numFuncs = _countof(originalFuncs)};
+
+    constexpr int kNumThreads = 4;
+    HANDLE threadHandles[kNumThreads];
+    for (int i = 0; i < kNumThreads; ++i)
+    {
+      threadHandles[i] =
+          CreateThread(nullptr, 0, ConcurrentLookupsTestThreadProc, &testData, 0, nullptr);
+      TEST_ASSERT(nullptr != threadHandles[i]);
+    }
+
+    for (int i = 0; i < _countof(originalFuncs); ++i)
+    {
+      TEST_ASSERT(Hookshot::SuccessfulResult(
+          HookshotInterface()->CreateHook(originalFuncs[i], hookFuncs[i])));
+      TEST_ASSERT(Hookshot::SuccessfulResult(
+          HookshotInterface()->ReplaceHookFunction(originalFuncs[i], replacementHookFuncs[i])));
+    }
+
+    InterlockedExchange(&testData.stopFlag, 1);
+    TEST_ASSERT(WAIT_OBJECT_0 == WaitForMultipleObjects(kNumThreads, threadHandles, TRUE, 10000));
+
+    for (int i = 0; i < kNumThreads; ++i)
+    {
+      DWORD thisThreadNumFailures = 0;
+      TEST_ASSERT(0 != GetExitCodeThread(threadHandles[i], &thisThreadNumFailures));
+      TEST_ASSERT(0 == thisThreadNumFailures);
+
+      CloseHandle(threadHandles[i]);
+    }
+
+    for (int i = 0; i < _countof(originalFuncs); ++i)
+    {
+      TEST_ASSERT(replacementHookFuncs[i]() == originalFuncs[i]());
+      TEST_ASSERT(nullptr == HookshotInterface()->GetOriginalFunction(hookFuncs[i]));
+      TEST_ASSERT(
+          HookshotInterface()->GetOriginalFunction(originalFuncs[i]) ==
+          HookshotInterface()->GetOriginalFunction(replacementHookFuncs[i]));
+    }
+  }
+
+  // Creates multiple hooks for the same original function, which are chained together.
+  // Verifies that each hook's original function leads to the next hook in the chain and that hooks
+  // in the chain can be individually disabled and replaced.
+  HOOKSHOT_CUSTOM_TEST(ChainedHooks)
+  {
+    GENERATE_AND_ASSIGN_FUNCTION(originalFunc);
+    GENERATE_AND_ASSIGN_FUNCTION(hookFuncA);
+    GENERATE_AND_ASSIGN_FUNCTION(hookFuncB);
+    GENERATE_AND_ASSIGN_FUNCTION(hookFuncC);
+
+    const auto originalFuncResult = originalFunc();
+    const auto hookFuncAResult = hookFuncA();
+    const auto hookFuncBResult = hookFuncB();
+    const auto hookFuncCResult = hookFuncC();
+
+    TEST_ASSERT(
+        Hookshot::SuccessfulResult(HookshotInterface()->CreateHook(originalFunc, hookFuncA)));
+    TEST_ASSERT(
+        Hookshot::SuccessfulResult(HookshotInterface()->CreateHook(originalFunc, hookFuncB)));
+    TEST_ASSERT(
+        Hookshot::EResult::FailDuplicate ==
+        HookshotInterface()->CreateHook(originalFunc, hookFuncA));
+
+    TEST_ASSERT(hookFuncBResult == originalFunc());
+    TEST_ASSERT(
+        hookFuncAResult ==
+        ((decltype(originalFunc))HookshotInterface()->GetOriginalFunction(hookFuncB))());
+    TEST_ASSERT(
+        originalFuncResult ==
+        ((decltype(originalFunc))HookshotInterface()->GetOriginalFunction(hookFuncA))());
+    TEST_ASSERT(
+        originalFuncResult ==
+        ((decltype(originalFunc))HookshotInterface()->GetOriginalFunction(originalFunc))());
+
+    TEST_ASSERT(
+        Hookshot::SuccessfulResult(HookshotInterface()->DisableHookFunction(hookFuncB)));
+    TEST_ASSERT(hookFuncAResult == originalFunc());
+
+    TEST_ASSERT(Hookshot::SuccessfulResult(
+        HookshotInterface()->ReplaceHookFunction(hookFuncA, hookFuncC)));
+    TEST_ASSERT(hookFuncCResult == originalFunc());
+    TEST_ASSERT(nullptr == HookshotInterface()->GetOriginalFunction(hookFuncA));
+    TEST_ASSERT(
+        originalFuncResult ==
+        ((decltype(originalFunc))HookshotInterface()->GetOriginalFunction(hookFuncC))());
+  }
+
   // Attempts to set the same hook twice.
   // Expected result is a failure due to the hook already existing.
   HOOKSHOT_CUSTOM_TEST(DuplicateHook)
@@ -104,37 +695,374 @@ namespace HookshotTest
         ((decltype(originalFunc))HookshotInterface()->GetOriginalFunction(originalFunc))());
   }
 
-  // Creates a hook chain going forwards.
-  // Function A hooks function B (OK), then function B hooks function C (error).
-  HOOKSHOT_CUSTOM_TEST(ForwardHookChain)
+  // Disables and re-enables a hook while checking the bytes at the start of the original function.
+  // Verifies that disabling restores the original function exactly, whenever the jump that Hookshot
+  // writes there lies within a block of memory that can be replaced with a single atomic operation.
+  HOOKSHOT_CUSTOM_TEST(DisableHookRestoresOriginalFunction)
   {
-    GENERATE_AND_ASSIGN_FUNCTION(funcA);
-    GENERATE_AND_ASSIGN_FUNCTION(funcB);
-    GENERATE_AND_ASSIGN_FUNCTION(funcC);
+    GENERATE_AND_ASSIGN_FUNCTION(originalFunc);
+    GENERATE_AND_ASSIGN_FUNCTION(hookFunc);
 
-    TEST_ASSERT(Hookshot::SuccessfulResult(HookshotInterface()->CreateHook(funcA, funcB)));
-    TEST_ASSERT(Hookshot::EResult::FailDuplicate == HookshotInterface()->CreateHook(funcB, funcC));
+    constexpr size_t kJumpLengthBytes = 5;
+#ifdef _WIN64
+    constexpr size_t kAtomicBlockSizeBytes = 16;
+#else
+    constexpr size_t kAtomicBlockSizeBytes = 8;
+#endif
+
+    const uint8_t* const originalFuncBytes = reinterpret_cast<const uint8_t*>(originalFunc);
+    const bool canRestoreOriginalFunc =
+        (((reinterpret_cast<size_t>(originalFunc) % kAtomicBlockSizeBytes) + kJumpLengthBytes) <=
+         kAtomicBlockSizeBytes);
+
+    uint8_t unhookedBytes[kJumpLengthBytes] = {};
+    memcpy(unhookedBytes, originalFuncBytes, sizeof(unhookedBytes));
+
+    const auto originalFuncResult = originalFunc();
+    const auto hookFuncResult = hookFunc();
+
+    TEST_ASSERT(
+        Hookshot::SuccessfulResult(HookshotInterface()->CreateHook(originalFunc, hookFunc)));
+    TEST_ASSERT(0 != memcmp(unhookedBytes, originalFuncBytes, sizeof(unhookedBytes)));
+
+    TEST_ASSERT(Hookshot::SuccessfulResult(HookshotInterface()->DisableHookFunction(originalFunc)));
+    TEST_ASSERT(originalFuncResult == originalFunc());
+    if (true == canRestoreOriginalFunc)
+      TEST_ASSERT(0 == memcmp(unhookedBytes, originalFuncBytes, sizeof(unhookedBytes)));
+
+    TEST_ASSERT(Hookshot::SuccessfulResult(
+        HookshotInterface()->ReplaceHookFunction(originalFunc, hookFunc)));
+    TEST_ASSERT(hookFuncResult == originalFunc());
+    TEST_ASSERT(0 != memcmp(unhookedBytes, originalFuncBytes, sizeof(unhookedBytes)));
+    TEST_ASSERT(
+        originalFuncResult ==
+        ((decltype(originalFunc))HookshotInterface()->GetOriginalFunction(originalFunc))());
   }
 
-  // Creates a hook cycle.
-  // Function A hooks function B (OK), then function B hooks function A (error).
-  HOOKSHOT_CUSTOM_TEST(HookCycle)
+  // Assigns several hooks to a hook group, then disables and re-enables the whole group at once.
+  // Verifies that only the members of the group are affected and that removed hooks leave it.
+  HOOKSHOT_CUSTOM_TEST(HookGroup)
   {
-    GENERATE_AND_ASSIGN_FUNCTION(funcA);
-    GENERATE_AND_ASSIGN_FUNCTION(funcB);
+    GENERATE_AND_ASSIGN_FUNCTION(originalFunc1);
+    GENERATE_AND_ASSIGN_FUNCTION(hookFunc1);
+    GENERATE_AND_ASSIGN_FUNCTION(originalFunc2);
+    GENERATE_AND_ASSIGN_FUNCTION(hookFunc2);
+    GENERATE_AND_ASSIGN_FUNCTION(originalFunc3);
+    GENERATE_AND_ASSIGN_FUNCTION(hookFunc3);
 
-    TEST_ASSERT(Hookshot::SuccessfulResult(HookshotInterface()->CreateHook(funcA, funcB)));
-    TEST_ASSERT(Hookshot::EResult::FailDuplicate == HookshotInterface()->CreateHook(funcB, funcA));
+    constexpr uint32_t kGroupId = 1;
+    constexpr uint32_t kOtherGroupId = 2;
+
+    TEST_ASSERT(
+        Hookshot::SuccessfulResult(HookshotInterface()->CreateHook(originalFunc1, hookFunc1)));
+    TEST_ASSERT(
+        Hookshot::SuccessfulResult(HookshotInterface()->CreateHook(originalFunc2, hookFunc2)));
+    TEST_ASSERT(
+        Hookshot::SuccessfulResult(HookshotInterface()->CreateHook(originalFunc3, hookFunc3)));
+
+    TEST_ASSERT(
+        Hookshot::SuccessfulResult(HookshotInterface()->SetHookGroup(hookFunc1, kGroupId)));
+    TEST_ASSERT(
+        Hookshot::SuccessfulResult(HookshotInterface()->SetHookGroup(originalFunc2, kGroupId)));
+    TEST_ASSERT(
+        Hookshot::SuccessfulResult(HookshotInterface()->SetHookGroup(hookFunc3, kOtherGroupId)));
+    TEST_ASSERT(
+        Hookshot::EResult::NoEffect == HookshotInterface()->SetHookGroup(hookFunc1, kGroupId));
+
+    TEST_ASSERT(
+        Hookshot::SuccessfulResult(HookshotInterface()->SetHookGroupEnabled(kGroupId, false)));
+    TEST_ASSERT(
+        Hookshot::EResult::NoEffect == HookshotInterface()->SetHookGroupEnabled(kGroupId, false));
+    TEST_ASSERT(originalFunc1() != hookFunc1());
+    TEST_ASSERT(originalFunc2() != hookFunc2());
+    TEST_ASSERT(originalFunc3() == hookFunc3());
+    TEST_ASSERT(nullptr == HookshotInterface()->GetOriginalFunction(hookFunc1));
+
+    TEST_ASSERT(
+        Hookshot::SuccessfulResult(HookshotInterface()->SetHookGroupEnabled(kGroupId, true)));
+    TEST_ASSERT(originalFunc1() == hookFunc1());
+    TEST_ASSERT(originalFunc2() == hookFunc2());
+    TEST_ASSERT(originalFunc3() == hookFunc3());
+
+    TEST_ASSERT(Hookshot::SuccessfulResult(HookshotInterface()->RemoveHook(originalFunc2)));
+    TEST_ASSERT(Hookshot::SuccessfulResult(
+        HookshotInterface()->SetHookGroup(hookFunc1, Hookshot::kHookGroupNone)));
+    TEST_ASSERT(
+        Hookshot::EResult::NoEffect == HookshotInterface()->SetHookGroupEnabled(kGroupId, false));
+    TEST_ASSERT(originalFunc1() == hookFunc1());
   }
 
-  // Attempts to hook a Hookshot function.
-  // Expected result is Hookshot rejects the input arguments as invalid.
-  HOOKSHOT_CUSTOM_TEST(HookHookshot)
+  // Creates deferred hooks on functions exported by modules that are and are not loaded. Verifies
+  // that hooks on modules that are not loaded are deferred and that invalid requests are rejected.
+  HOOKSHOT_CUSTOM_TEST(DeferredHook)
   {
     GENERATE_AND_ASSIGN_FUNCTION(hookFunc);
+
+    constexpr wchar_t kUnloadedModuleName[] = L"HookshotTestModuleThatIsNeverLoaded.dll";
+    constexpr char kExportName[] = "HookshotTestExportThatDoesNotExist";
+
     TEST_ASSERT(
         Hookshot::EResult::FailInvalidArgument ==
-        HookshotInterface()->CreateHook(HookshotLibraryInitialize, hookFunc));
+        HookshotInterface()->CreateDeferredHook(nullptr, kExportName, hookFunc));
+    TEST_ASSERT(
+        Hookshot::EResult::FailInvalidArgument ==
+        HookshotInterface()->CreateDeferredHook(kUnloadedModuleName, nullptr, hookFunc));
+    TEST_ASSERT(
+        Hookshot::EResult::FailInvalidArgument ==
+        HookshotInterface()->CreateDeferredHook(kUnloadedModuleName, kExportName, nullptr));
+
+    TEST_ASSERT(
+        Hookshot::EResult::FailNotFound ==
+        HookshotInterface()->CreateDeferredHook(L"kernel32.dll", kExportName, hookFunc));
+
+    TEST_ASSERT(Hookshot::SuccessfulResult(
+        HookshotInterface()->CreateDeferredHook(kUnloadedModuleName, kExportName, hookFunc)));
+    TEST_ASSERT(nullptr == HookshotInterface()->GetOriginalFunction(hookFunc));
+    TEST_ASSERT(
+        Hookshot::EResult::FailDuplicate ==
+        HookshotInterface()->CreateDeferredHook(kUnloadedModuleName, kExportName, hookFunc));
+  }
+
+  // Creates a hook, removes it, and then creates it again. Verifies that removal restores the
+  // original function exactly and that Hookshot forgets about the hook entirely.
+  HOOKSHOT_CUSTOM_TEST(RemoveHook)
+  {
+    GENERATE_AND_ASSIGN_FUNCTION(originalFunc);
+    GENERATE_AND_ASSIGN_FUNCTION(hookFunc);
+
+    constexpr size_t kJumpLengthBytes = 5;
+
+    const uint8_t* const originalFuncBytes = reinterpret_cast<const uint8_t*>(originalFunc);
+    uint8_t unhookedBytes[kJumpLengthBytes] = {};
+    memcpy(unhookedBytes, originalFuncBytes, sizeof(unhookedBytes));
+
+    const auto originalFuncResult = originalFunc();
+    const auto hookFuncResult = hookFunc();
+
+    TEST_ASSERT(
+        Hookshot::SuccessfulResult(HookshotInterface()->CreateHook(originalFunc, hookFunc)));
+    TEST_ASSERT(hookFuncResult == originalFunc());
+
+    TEST_ASSERT(Hookshot::SuccessfulResult(HookshotInterface()->RemoveHook(hookFunc)));
+    TEST_ASSERT(originalFuncResult == originalFunc());
+    TEST_ASSERT(0 == memcmp(unhookedBytes, originalFuncBytes, sizeof(unhookedBytes)));
+    TEST_ASSERT(nullptr == HookshotInterface()->GetOriginalFunction(originalFunc));
+    TEST_ASSERT(nullptr == HookshotInterface()->GetOriginalFunction(hookFunc));
+    TEST_ASSERT(Hookshot::EResult::FailNotFound == HookshotInterface()->RemoveHook(originalFunc));
+
+    TEST_ASSERT(
+        Hookshot::SuccessfulResult(HookshotInterface()->CreateHook(originalFunc, hookFunc)));
+    TEST_ASSERT(hookFuncResult == originalFunc());
+    TEST_ASSERT(
+        originalFuncResult ==
+        ((decltype(originalFunc))HookshotInterface()->GetOriginalFunction(originalFunc))());
+
+    TEST_ASSERT(Hookshot::SuccessfulResult(HookshotInterface()->RemoveHook(originalFunc)));
+    TEST_ASSERT(originalFuncResult == originalFunc());
+  }
+
+  // Chains two hooks onto the same original function and then removes one of them. Verifies that
+  // the whole chain is removed.
+  HOOKSHOT_CUSTOM_TEST(RemoveHookChain)
+  {
+    GENERATE_AND_ASSIGN_FUNCTION(originalFunc);
+    GENERATE_AND_ASSIGN_FUNCTION(innerHookFunc);
+    GENERATE_AND_ASSIGN_FUNCTION(outerHookFunc);
+
+    const auto originalFuncResult = originalFunc();
+    const auto outerHookFuncResult = outerHookFunc();
+
+    TEST_ASSERT(
+        Hookshot::SuccessfulResult(HookshotInterface()->CreateHook(originalFunc, innerHookFunc)));
+    TEST_ASSERT(
+        Hookshot::SuccessfulResult(HookshotInterface()->CreateHook(originalFunc, outerHookFunc)));
+    TEST_ASSERT(outerHookFuncResult == originalFunc());
+
+    TEST_ASSERT(Hookshot::SuccessfulResult(HookshotInterface()->RemoveHook(innerHookFunc)));
+    TEST_ASSERT(originalFuncResult == originalFunc());
+    TEST_ASSERT(nullptr == HookshotInterface()->GetOriginalFunction(originalFunc));
+    TEST_ASSERT(nullptr == HookshotInterface()->GetOriginalFunction(innerHookFunc));
+    TEST_ASSERT(nullptr == HookshotInterface()->GetOriginalFunction(outerHookFunc));
+  }
+
+  // Hooks a function in a module that the test loads itself, and then repeatedly unloads and loads
+  // the module again for longer than the interval between hook integrity checks, so that whenever
+  // the hook integrity monitor is running some of the unloads happen while it checks patch sites.
+  // Expected result is that the process keeps running and that the module can still be loaded.
+  HOOKSHOT_CUSTOM_TEST(UnloadHookedModuleDuringIntegrityCheck)
+  {
+    GENERATE_AND_ASSIGN_FUNCTION(hookFunc);
+
+    constexpr wchar_t kModuleName[] = L"wtsapi32.dll";
+    constexpr char kExportName[] = "WTSFreeMemory";
+
+    // Unloading the module is only possible if nothing else has loaded it.
+    if (nullptr != GetModuleHandle(kModuleName)) return;
+
+    HMODULE moduleHandle = LoadLibrary(kModuleName);
+    TEST_ASSERT(nullptr != moduleHandle);
+
+    void* const originalFunc =
+        reinterpret_cast<void*>(GetProcAddress(moduleHandle, kExportName));
+    TEST_ASSERT(nullptr != originalFunc);
+    TEST_ASSERT(
+        Hookshot::SuccessfulResult(HookshotInterface()->CreateHook(originalFunc, hookFunc)));
+
+    const ULONGLONG endTime =
+        GetTickCount64() + (3 * Hookshot::HookIntegrity::kCheckIntervalMilliseconds);
+    while (GetTickCount64() < endTime)
+    {
+      TEST_ASSERT(FALSE != FreeLibrary(moduleHandle));
+      moduleHandle = LoadLibrary(kModuleName);
+      TEST_ASSERT(nullptr != moduleHandle);
+    }
+
+    TEST_ASSERT(FALSE != FreeLibrary(moduleHandle));
+  }
+
+  // Creates hooks on multiple entries of a virtual function table in a single batch, some of which
+  // are invalid, and then removes them. Verifies that only the table entries are rewritten and that
+  // removal restores them.
+  HOOKSHOT_CUSTOM_TEST(VirtualTableHooks)
+  {
+    GENERATE_AND_ASSIGN_FUNCTION(originalFuncA);
+    GENERATE_AND_ASSIGN_FUNCTION(originalFuncB);
+    GENERATE_AND_ASSIGN_FUNCTION(hookFuncA);
+    GENERATE_AND_ASSIGN_FUNCTION(hookFuncB);
+
+    const auto originalFuncAResult = originalFuncA();
+    const auto originalFuncBResult = originalFuncB();
+    const auto hookFuncAResult = hookFuncA();
+    const auto hookFuncBResult = hookFuncB();
+
+    const void* virtualTable[] = {originalFuncA, nullptr, originalFuncB};
+    const size_t slotIndices[] = {0, 1, 2, 0};
+    const void* const hookFuncs[] = {hookFuncA, hookFuncB, hookFuncB, hookFuncB};
+
+    Hookshot::EResult results[_countof(slotIndices)];
+    TEST_ASSERT(
+        Hookshot::EResult::FailInvalidArgument ==
+        HookshotInterface()->CreateVirtualTableHooks(
+            virtualTable, slotIndices, hookFuncs, _countof(slotIndices), results));
+
+    TEST_ASSERT(Hookshot::SuccessfulResult(results[0]));
+    TEST_ASSERT(Hookshot::EResult::FailInvalidArgument == results[1]);
+    TEST_ASSERT(Hookshot::SuccessfulResult(results[2]));
+    TEST_ASSERT(Hookshot::EResult::FailDuplicate == results[3]);
+
+    TEST_ASSERT(hookFuncAResult == ((TGeneratedTestFunction)virtualTable[0])());
+    TEST_ASSERT(hookFuncBResult == ((TGeneratedTestFunction)virtualTable[2])());
+    TEST_ASSERT(originalFuncAResult == originalFuncA());
+    TEST_ASSERT(originalFuncBResult == originalFuncB());
+    TEST_ASSERT(originalFuncA == HookshotInterface()->GetOriginalFunction(hookFuncA));
+    TEST_ASSERT(originalFuncB == HookshotInterface()->GetOriginalFunction(hookFuncB));
+
+    TEST_ASSERT(Hookshot::SuccessfulResult(HookshotInterface()->RemoveHook(hookFuncA)));
+    TEST_ASSERT(Hookshot::SuccessfulResult(HookshotInterface()->RemoveHook(originalFuncB)));
+    TEST_ASSERT(originalFuncA == virtualTable[0]);
+    TEST_ASSERT(originalFuncB == virtualTable[2]);
+    TEST_ASSERT(nullptr == HookshotInterface()->GetOriginalFunction(hookFuncA));
+    TEST_ASSERT(nullptr == HookshotInterface()->GetOriginalFunction(hookFuncB));
+  }
+
+  // Creates a hook chain going forwards.
+  // Function A hooks function B (OK), then function B hooks function C (error).
+  HOOKSHOT_CUSTOM_TEST(ForwardHookChain)
+  {
+    GENERATE_AND_ASSIGN_FUNCTION(funcA);
+    GENERATE_AND_ASSIGN_FUNCTION(funcB);
+    GENERATE_AND_ASSIGN_FUNCTION(funcC);
+
+    TEST_ASSERT(Hookshot::SuccessfulResult(HookshotInterface()->CreateHook(funcA, funcB)));
+    TEST_ASSERT(Hookshot::EResult::FailDuplicate == HookshotInterface()->CreateHook(funcB, funcC));
+  }
+
+  // Creates a hook cycle.
+  // Function A hooks function B (OK), then function B hooks function A (error).
+  HOOKSHOT_CUSTOM_TEST(HookCycle)
+  {
+    GENERATE_AND_ASSIGN_FUNCTION(funcA);
+    GENERATE_AND_ASSIGN_FUNCTION(funcB);
+
+    TEST_ASSERT(Hookshot::SuccessfulResult(HookshotInterface()->CreateHook(funcA, funcB)));
+    TEST_ASSERT(Hookshot::EResult::FailDuplicate == HookshotInterface()->CreateHook(funcB, funcA));
+  }
+
+  // Attempts to hook a Hookshot function.
+  // Expected result is Hookshot rejects the input arguments as invalid.
+  HOOKSHOT_CUSTOM_TEST(HookHookshot)
+  {
+    GENERATE_AND_ASSIGN_FUNCTION(hookFunc);
+    TEST_ASSERT(
+        Hookshot::EResult::FailInvalidArgument ==
+        HookshotInterface()->CreateHook(HookshotLibraryInitialize, hookFunc));
+  }
+
+  // Hooks a Windows API function imported by the test executable by rewriting its import address
+  // table entry, and then removes the hook. Verifies that calls through the import address table
+  // reach the hook function while the hook exists and that the original function is untouched.
+  // Hook function, which returns a process ID that no real process ever has.
+  DWORD WINAPI ImportAddressTableHookGetCurrentProcessId(void)
+  {
+    return 0;
+  }
+
+  // Main test case logic.
+  HOOKSHOT_CUSTOM_TEST(ImportAddressTableHook)
+  {
+    void* const originalFunc = reinterpret_cast<void*>(&GetCurrentProcessId);
+    const void* const hookFunc =
+        reinterpret_cast<const void*>(&ImportAddressTableHookGetCurrentProcessId);
+    const DWORD currentProcessId = GetCurrentProcessId();
+
+    TEST_ASSERT(Hookshot::SuccessfulResult(HookshotInterface()->CreateHookWithKind(
+        Hookshot::EHookKind::ImportAddressTable,
+        originalFunc,
+        hookFunc,
+        GetModuleHandle(nullptr))));
+    TEST_ASSERT(0 == GetCurrentProcessId());
+    TEST_ASSERT(originalFunc == HookshotInterface()->GetOriginalFunction(hookFunc));
+    TEST_ASSERT(
+        currentProcessId ==
+        ((decltype(&GetCurrentProcessId))HookshotInterface()->GetOriginalFunction(hookFunc))());
+
+    TEST_ASSERT(Hookshot::SuccessfulResult(HookshotInterface()->RemoveHook(hookFunc)));
+    TEST_ASSERT(currentProcessId == GetCurrentProcessId());
+    TEST_ASSERT(nullptr == HookshotInterface()->GetOriginalFunction(hookFunc));
+  }
+
+  // Hooks a function using a hardware execution breakpoint, and then removes the hook. Verifies
+  // that the original function is redirected without being modified and that it remains reachable
+  // while the hook exists.
+  HOOKSHOT_CUSTOM_TEST(DebugRegisterHook)
+  {
+    GENERATE_AND_ASSIGN_FUNCTION(originalFunc);
+    GENERATE_AND_ASSIGN_FUNCTION(hookFunc);
+
+    constexpr size_t kJumpLengthBytes = 5;
+
+    const uint8_t* const originalFuncBytes = reinterpret_cast<const uint8_t*>(originalFunc);
+    uint8_t unhookedBytes[kJumpLengthBytes] = {};
+    memcpy(unhookedBytes, originalFuncBytes, sizeof(unhookedBytes));
+
+    const auto originalFuncResult = originalFunc();
+    const auto hookFuncResult = hookFunc();
+
+    TEST_ASSERT(Hookshot::SuccessfulResult(HookshotInterface()->CreateHookWithKind(
+        Hookshot::EHookKind::DebugRegister, originalFunc, hookFunc, nullptr)));
+    TEST_ASSERT(
+        Hookshot::EResult::FailDuplicate ==
+        HookshotInterface()->CreateHookWithKind(
+            Hookshot::EHookKind::DebugRegister, originalFunc, hookFunc, nullptr));
+    TEST_ASSERT(hookFuncResult == originalFunc());
+    TEST_ASSERT(0 == memcmp(unhookedBytes, originalFuncBytes, sizeof(unhookedBytes)));
+    TEST_ASSERT(
+        originalFuncResult ==
+        ((decltype(originalFunc))HookshotInterface()->GetOriginalFunction(hookFunc))());
+
+    TEST_ASSERT(Hookshot::SuccessfulResult(HookshotInterface()->RemoveHook(originalFunc)));
+    TEST_ASSERT(originalFuncResult == originalFunc());
+    TEST_ASSERT(nullptr == HookshotInterface()->GetOriginalFunction(hookFunc));
   }
 
   // Attempts to set a very high number of hooks.
@@ -481,160 +1409,1908 @@ namespace HookshotTest
     Infra::Test::PrintFormatted(L"%d total successful hook set operations.", totalNumSuccesses);
     TEST_ASSERT(_countof(originalFuncs) == totalNumSuccesses);
 
-    for (int i = 0; i < _countof(originalFuncs); ++i)
+    for (int i = 0; i < _countof(originalFuncs); ++i)
+    {
+      const int actualValue = originalFuncs[i]();
+      Infra::Test::PrintFormatted(
+          L"Hook %d: %s: expected %d, got %d.",
+          i,
+          (actualValue == expectedValues[i] ? L"OK" : L"BAD"),
+          expectedValues[i],
+          actualValue);
+      TEST_ASSERT(actualValue == expectedValues[i]);
+    }
+
+    CloseHandle(testData.syncEventPhase1);
+    CloseHandle(testData.syncEventPhase2);
+  }
+
+  // Hookshot is presented with two null pointers.
+  // Expected result is Hookshot rejects the input arguments as invalid.
+  HOOKSHOT_CUSTOM_TEST(NullPointerBoth)
+  {
+    TEST_ASSERT(
+        Hookshot::EResult::FailInvalidArgument ==
+        HookshotInterface()->CreateHook(nullptr, nullptr));
+  }
+
+  // Hookshot is presented with a null pointer for the hook function.
+  // Expected result is Hookshot rejects the input arguments as invalid.
+  HOOKSHOT_CUSTOM_TEST(NullPointerHook)
+  {
+    GENERATE_AND_ASSIGN_FUNCTION(func);
+    TEST_ASSERT(
+        Hookshot::EResult::FailInvalidArgument == HookshotInterface()->CreateHook(func, nullptr));
+  }
+
+  // Hookshot is presented with a null pointer for the original function.
+  // Expected result is Hookshot rejects the input arguments as invalid.
+  HOOKSHOT_CUSTOM_TEST(NullPointerOriginal)
+  {
+    GENERATE_AND_ASSIGN_FUNCTION(func);
+    TEST_ASSERT(
+        Hookshot::EResult::FailInvalidArgument == HookshotInterface()->CreateHook(nullptr, func));
+  }
+
+  // Hookshot is presented with equal non-null pointers for both original and hook functions.
+  // Expected result is Hookshot rejects the input arguments as invalid.
+  HOOKSHOT_CUSTOM_TEST(SelfHook)
+  {
+    GENERATE_AND_ASSIGN_FUNCTION(func);
+    TEST_ASSERT(
+        Hookshot::EResult::FailInvalidArgument == HookshotInterface()->CreateHook(func, func));
+  }
+
+  // Attempts to replace a valid hook's hook function with one that is already involved in another
+  // hook. Expected result is a failure due to a duplicate hook being detected.
+  HOOKSHOT_CUSTOM_TEST(ReplaceHookDuplicate)
+  {
+    GENERATE_AND_ASSIGN_FUNCTION(originalFunc1);
+    GENERATE_AND_ASSIGN_FUNCTION(hookFunc1);
+    TEST_ASSERT(
+        Hookshot::SuccessfulResult(HookshotInterface()->CreateHook(originalFunc1, hookFunc1)));
+
+    GENERATE_AND_ASSIGN_FUNCTION(originalFunc2);
+    GENERATE_AND_ASSIGN_FUNCTION(hookFunc2);
+    TEST_ASSERT(
+        Hookshot::SuccessfulResult(HookshotInterface()->CreateHook(originalFunc2, hookFunc2)));
+
+    TEST_ASSERT(
+        Hookshot::EResult::FailDuplicate ==
+        HookshotInterface()->ReplaceHookFunction(originalFunc1, hookFunc2));
+    TEST_ASSERT(
+        Hookshot::EResult::FailDuplicate ==
+        HookshotInterface()->ReplaceHookFunction(hookFunc1, hookFunc2));
+    TEST_ASSERT(
+        Hookshot::EResult::FailDuplicate ==
+        HookshotInterface()->ReplaceHookFunction(originalFunc2, hookFunc1));
+    TEST_ASSERT(
+        Hookshot::EResult::FailDuplicate ==
+        HookshotInterface()->ReplaceHookFunction(hookFunc2, hookFunc1));
+  }
+
+  // Attempts to replace a non-existent hook's hook function.
+  // Expected result is Hookshot rejects the hook as not found.
+  HOOKSHOT_CUSTOM_TEST(ReplaceHookNonExistent)
+  {
+    GENERATE_AND_ASSIGN_FUNCTION(funcA);
+    GENERATE_AND_ASSIGN_FUNCTION(funcB);
+
+    TEST_ASSERT(
+        Hookshot::EResult::FailNotFound == HookshotInterface()->ReplaceHookFunction(funcA, funcA));
+    TEST_ASSERT(
+        Hookshot::EResult::FailNotFound == HookshotInterface()->ReplaceHookFunction(funcA, funcB));
+    TEST_ASSERT(
+        Hookshot::EResult::FailNotFound == HookshotInterface()->ReplaceHookFunction(funcB, funcA));
+    TEST_ASSERT(
+        Hookshot::EResult::FailNotFound == HookshotInterface()->ReplaceHookFunction(funcB, funcB));
+  }
+
+  // Attempts to replace a valid hook's hook function with another valid hook function.
+  // Verifies that Hookshot performs this operation both successfully and correctly.
+  HOOKSHOT_CUSTOM_TEST(ReplaceHookValid)
+  {
+    GENERATE_AND_ASSIGN_FUNCTION(originalFunc);
+    GENERATE_AND_ASSIGN_FUNCTION(hookFunc);
+    GENERATE_AND_ASSIGN_FUNCTION(replacementHookFunc);
+
+    const auto originalFuncResult = originalFunc();
+    const auto hookFuncResult = hookFunc();
+    const auto replacementHookFuncResult = replacementHookFunc();
+
+    TEST_ASSERT(
+        Hookshot::SuccessfulResult(HookshotInterface()->CreateHook(originalFunc, hookFunc)));
+    TEST_ASSERT(hookFuncResult == originalFunc());
+    TEST_ASSERT(
+        originalFuncResult ==
+        ((decltype(originalFunc))HookshotInterface()->GetOriginalFunction(originalFunc))());
+    TEST_ASSERT(nullptr != HookshotInterface()->GetOriginalFunction(hookFunc));
+
+    TEST_ASSERT(Hookshot::SuccessfulResult(
+        HookshotInterface()->ReplaceHookFunction(hookFunc, replacementHookFunc)));
+    TEST_ASSERT(replacementHookFuncResult == originalFunc());
+    TEST_ASSERT(
+        originalFuncResult ==
+        ((decltype(originalFunc))HookshotInterface()->GetOriginalFunction(originalFunc))());
+    TEST_ASSERT(nullptr == HookshotInterface()->GetOriginalFunction(hookFunc));
+    TEST_ASSERT(nullptr != HookshotInterface()->GetOriginalFunction(replacementHookFunc));
+  }
+
+  // Attempts to replace a valid hook's hook function with another valid hook function.
+  // Expected result is success, even though the operation should have no effect.
+  HOOKSHOT_CUSTOM_TEST(ReplaceHookWithSelf)
+  {
+    GENERATE_AND_ASSIGN_FUNCTION(originalFunc);
+    GENERATE_AND_ASSIGN_FUNCTION(hookFunc);
+
+    const auto originalFuncResult = originalFunc();
+    const auto hookFuncResult = hookFunc();
+
+    TEST_ASSERT(
+        Hookshot::SuccessfulResult(HookshotInterface()->CreateHook(originalFunc, hookFunc)));
+    TEST_ASSERT(hookFuncResult == originalFunc());
+    TEST_ASSERT(
+        originalFuncResult ==
+        ((decltype(originalFunc))HookshotInterface()->GetOriginalFunction(originalFunc))());
+    TEST_ASSERT(nullptr != HookshotInterface()->GetOriginalFunction(hookFunc));
+
+    TEST_ASSERT(Hookshot::SuccessfulResult(
+        HookshotInterface()->ReplaceHookFunction(originalFunc, hookFunc)));
+    TEST_ASSERT(
+        Hookshot::SuccessfulResult(HookshotInterface()->ReplaceHookFunction(hookFunc, hookFunc)));
+    TEST_ASSERT(hookFuncResult == originalFunc());
+    TEST_ASSERT(
+        originalFuncResult ==
+        ((decltype(originalFunc))HookshotInterface()->GetOriginalFunction(originalFunc))());
+    TEST_ASSERT(nullptr != HookshotInterface()->GetOriginalFunction(hookFunc));
+  }
+
+  // Enables and disables the reentrancy guard of a hook and invokes the original function with and
+  // without the per-thread depth incremented. Expected result is that the hook function is bypassed
+  // only while the depth is non-zero and the reentrancy guard is enabled.
+  HOOKSHOT_CUSTOM_TEST(ReentrancyGuard)
+  {
+    GENERATE_AND_ASSIGN_FUNCTION(originalFunc);
+    GENERATE_AND_ASSIGN_FUNCTION(hookFunc);
+    GENERATE_AND_ASSIGN_FUNCTION(unhookedFunc);
+
+    const auto originalFuncResult = originalFunc();
+    const auto hookFuncResult = hookFunc();
+
+    const size_t depthOffset = HookshotInterface()->GetReentrancyGuardDepthOffset();
+    TEST_ASSERT(0 != depthOffset);
+
+    TEST_ASSERT(
+        Hookshot::EResult::FailNotFound ==
+        HookshotInterface()->SetHookReentrancyGuard(unhookedFunc, true));
+    TEST_ASSERT(
+        Hookshot::SuccessfulResult(HookshotInterface()->CreateHook(originalFunc, hookFunc)));
+    TEST_ASSERT(
+        Hookshot::EResult::NoEffect ==
+        HookshotInterface()->SetHookReentrancyGuard(originalFunc, false));
+    TEST_ASSERT(Hookshot::SuccessfulResult(
+        HookshotInterface()->SetHookReentrancyGuard(hookFunc, true)));
+    TEST_ASSERT(
+        Hookshot::EResult::NoEffect ==
+        HookshotInterface()->SetHookReentrancyGuard(originalFunc, true));
+    TEST_ASSERT(hookFuncResult == originalFunc());
+
+    do
+    {
+      Hookshot::ScopedReentrancyGuard reentrancyGuard(depthOffset);
+      TEST_ASSERT(originalFuncResult == originalFunc());
+
+      Hookshot::ScopedReentrancyGuard nestedReentrancyGuard(depthOffset);
+      TEST_ASSERT(originalFuncResult == originalFunc());
+    } while (false);
+
+    TEST_ASSERT(0 == Hookshot::ScopedReentrancyGuard::ReadDepth(depthOffset));
+    TEST_ASSERT(hookFuncResult == originalFunc());
+
+    TEST_ASSERT(Hookshot::SuccessfulResult(
+        HookshotInterface()->SetHookReentrancyGuard(originalFunc, false)));
+
+    do
+    {
+      Hookshot::ScopedReentrancyGuard reentrancyGuard(depthOffset);
+      TEST_ASSERT(hookFuncResult == originalFunc());
+    } while (false);
+  }
+
+  // Restricts a hook to calls from a module that does not make them, then to calls from the module
+  // that does, and then removes the restriction. Expected result is that the hook function is
+  // invoked only while the calling module is accepted by the caller filter.
+  HOOKSHOT_CUSTOM_TEST(CallerFilter)
+  {
+    GENERATE_AND_ASSIGN_FUNCTION(originalFunc);
+    GENERATE_AND_ASSIGN_FUNCTION(hookFunc);
+    GENERATE_AND_ASSIGN_FUNCTION(unhookedFunc);
+
+    const auto originalFuncResult = originalFunc();
+    const auto hookFuncResult = hookFunc();
+
+    const void* const otherModule = GetModuleHandle(L"kernel32.dll");
+    const void* const callingModule = GetModuleHandle(nullptr);
+    TEST_ASSERT(nullptr != otherModule);
+    TEST_ASSERT(nullptr != callingModule);
+
+    TEST_ASSERT(
+        Hookshot::EResult::FailNotFound ==
+        HookshotInterface()->SetHookCallerFilter(unhookedFunc, &callingModule, 1));
+    TEST_ASSERT(
+        Hookshot::SuccessfulResult(HookshotInterface()->CreateHook(originalFunc, hookFunc)));
+    TEST_ASSERT(
+        Hookshot::EResult::NoEffect ==
+        HookshotInterface()->SetHookCallerFilter(originalFunc, nullptr, 0));
+    TEST_ASSERT(
+        Hookshot::EResult::FailInvalidArgument ==
+        HookshotInterface()->SetHookCallerFilter(originalFunc, nullptr, 1));
+
+    TEST_ASSERT(Hookshot::SuccessfulResult(
+        HookshotInterface()->SetHookCallerFilter(hookFunc, &otherModule, 1)));
+    TEST_ASSERT(originalFuncResult == originalFunc());
+
+    const void* const bothModules[] = {otherModule, callingModule};
+    TEST_ASSERT(Hookshot::SuccessfulResult(HookshotInterface()->SetHookCallerFilter(
+        originalFunc, bothModules, _countof(bothModules))));
+    TEST_ASSERT(hookFuncResult == originalFunc());
+
+    TEST_ASSERT(Hookshot::SuccessfulResult(
+        HookshotInterface()->SetHookCallerFilter(originalFunc, &otherModule, 1)));
+    TEST_ASSERT(originalFuncResult == originalFunc());
+
+    TEST_ASSERT(Hookshot::SuccessfulResult(
+        HookshotInterface()->SetHookCallerFilter(originalFunc, nullptr, 0)));
+    TEST_ASSERT(hookFuncResult == originalFunc());
+  }
+
+  // Writes records into the ring buffers of a call trace section the same way call trace hooks do,
+  // and then drains them. Expected result is that completely-written records are read back in
+  // timestamp order exactly once, that the most recent record of a running thread is held back
+  // until it is complete, and that records overwritten before being drained are counted as lost.
+  HOOKSHOT_CUSTOM_TEST(CallTraceDrain)
+  {
+    using namespace Hookshot::CallTracing;
+
+    std::vector<uint64_t> sectionStorage(kSectionSizeBytes / sizeof(uint64_t));
+    SHeader* const header = reinterpret_cast<SHeader*>(sectionStorage.data());
+    SThreadBuffer* const threadBuffers = ThreadBuffersForHeader(header);
+
+    Hookshot::CallTraceReader::SDrainState drainState = {};
+    std::vector<Hookshot::CallTraceReader::SDrainedRecord> drainedRecords;
+    TEST_ASSERT(
+        false ==
+        Hookshot::CallTraceReader::DrainRecords(header, &drainState, &drainedRecords));
+
+    header->magic = kSectionMagic;
+    header->version = kSectionVersion;
+    header->maxThreadBuffers = kMaxThreadBuffers;
+    header->recordsPerThreadBuffer = kRecordsPerThreadBuffer;
+    header->recordSizeBytes = static_cast<uint32_t>(sizeof(SRecord));
+
+    // Each record identifies its ring buffer and its position within the sequence of records
+    // written into that buffer.
+    uint64_t timestamp = 0;
+    auto writeRecord = [threadBuffers, &timestamp](uint32_t bufferIndex) -> void
+    {
+      SThreadBuffer& threadBuffer = threadBuffers[bufferIndex];
+      const uint64_t recordOffset = threadBuffer.header.writeOffset;
+      threadBuffer.header.writeOffset = recordOffset + sizeof(SRecord);
+
+      SRecord& record = threadBuffer.records[(recordOffset / sizeof(SRecord)) %
+                                             kRecordsPerThreadBuffer];
+      record.arguments[0] = bufferIndex;
+      record.arguments[1] = recordOffset / sizeof(SRecord);
+      record.timestamp = ++timestamp;
+    };
+
+    // Buffer 0 belongs to a running thread, and buffer 1 to a thread that has already exited.
+    threadBuffers[0].header.threadId = 100;
+    writeRecord(0);
+    writeRecord(1);
+    writeRecord(0);
+    writeRecord(1);
+    writeRecord(0);
+
+    TEST_ASSERT(
+        true == Hookshot::CallTraceReader::DrainRecords(header, &drainState, &drainedRecords));
+    TEST_ASSERT(4 == drainedRecords.size());
+    for (size_t i = 0; i < drainedRecords.size(); ++i)
+    {
+      TEST_ASSERT((i + 1) == drainedRecords[i].record.timestamp);
+      TEST_ASSERT((i % 2) == drainedRecords[i].threadBufferIndex);
+      TEST_ASSERT((i % 2) == drainedRecords[i].record.arguments[0]);
+      TEST_ASSERT((i / 2) == drainedRecords[i].record.arguments[1]);
+      TEST_ASSERT(((0 == (i % 2)) ? 100u : 0u) == drainedRecords[i].threadId);
+    }
+
+    TEST_ASSERT(
+        true == Hookshot::CallTraceReader::DrainRecords(header, &drainState, &drainedRecords));
+    TEST_ASSERT(true == drainedRecords.empty());
+
+    // Another record completes the one that was held back.
+    writeRecord(0);
+    TEST_ASSERT(
+        true == Hookshot::CallTraceReader::DrainRecords(header, &drainState, &drainedRecords));
+    TEST_ASSERT(1 == drainedRecords.size());
+    TEST_ASSERT(2 == drainedRecords[0].record.arguments[1]);
+    TEST_ASSERT(0 == drainState.numRecordsLost);
+
+    // Wrapping around the ring without draining overwrites the oldest records. The most recent
+    // record, which is held back, is also overwriting the oldest one that remains.
+    constexpr uint32_t kNumRecordsWrapped = 10;
+    for (uint32_t i = 0; i < (kRecordsPerThreadBuffer + kNumRecordsWrapped); ++i)
+      writeRecord(0);
+
+    TEST_ASSERT(
+        true == Hookshot::CallTraceReader::DrainRecords(header, &drainState, &drainedRecords));
+    TEST_ASSERT((kRecordsPerThreadBuffer - 1) == drainedRecords.size());
+    TEST_ASSERT((kNumRecordsWrapped + 1) == drainState.numRecordsLost);
+    TEST_ASSERT((4 + kNumRecordsWrapped) == drainedRecords.front().record.arguments[1]);
+    for (size_t i = 1; i < drainedRecords.size(); ++i)
+    {
+      TEST_ASSERT(
+          (drainedRecords[i - 1].record.arguments[1] + 1) ==
+          drainedRecords[i].record.arguments[1]);
+    }
+  }
+
+  // Traces calls to a function and then chains an ordinary hook onto it. Expected result is that
+  // the call trace hook behaves exactly like the original function and does not interfere with
+  // other hooks on the same function. Skipped if call tracing is unavailable.
+  HOOKSHOT_CUSTOM_TEST(CallTraceHook)
+  {
+    GENERATE_AND_ASSIGN_FUNCTION(originalFunc);
+    GENERATE_AND_ASSIGN_FUNCTION(hookFunc);
+
+    const auto originalFuncResult = originalFunc();
+    const auto hookFuncResult = hookFunc();
+
+    const Hookshot::EResult traceResult = HookshotInterface()->CreateCallTraceHook(originalFunc);
+    if (Hookshot::EResult::FailAllocation == traceResult) return;
+
+    TEST_ASSERT(Hookshot::SuccessfulResult(traceResult));
+    TEST_ASSERT(originalFuncResult == originalFunc());
+
+    TEST_ASSERT(
+        Hookshot::SuccessfulResult(HookshotInterface()->CreateHook(originalFunc, hookFunc)));
+    TEST_ASSERT(hookFuncResult == originalFunc());
+  }
+
+  // Creates callback hooks with only a pre callback and with both callbacks on two functions.
+  // Expected result is that the hooked functions behave exactly like the original functions and
+  // that the callbacks are invoked around every call with the original function's return value.
+  // Skipped if callback hooks are unavailable.
+  HOOKSHOT_CUSTOM_TEST(CallbackHook)
+  {
+    GENERATE_AND_ASSIGN_FUNCTION(preOnlyFunc);
+    GENERATE_AND_ASSIGN_FUNCTION(prePostFunc);
+
+    const auto preOnlyFuncResult = preOnlyFunc();
+    const auto prePostFuncResult = prePostFunc();
+
+    size_t preOnlyCounts[3] = {};
+    size_t prePostCounts[3] = {};
+
+    TEST_ASSERT(
+        Hookshot::EResult::FailInvalidArgument ==
+        HookshotInterface()->CreateCallbackHook(preOnlyFunc, nullptr, nullptr, preOnlyCounts));
+
+    const Hookshot::EResult preOnlyResult = HookshotInterface()->CreateCallbackHook(
+        preOnlyFunc, CountCallbackHookPre, nullptr, preOnlyCounts);
+    if (Hookshot::EResult::FailAllocation == preOnlyResult) return;
+
+    TEST_ASSERT(Hookshot::SuccessfulResult(preOnlyResult));
+    TEST_ASSERT(Hookshot::SuccessfulResult(HookshotInterface()->CreateCallbackHook(
+        prePostFunc, CountCallbackHookPre, CountCallbackHookPost, prePostCounts)));
+
+    TEST_ASSERT(preOnlyFuncResult == preOnlyFunc());
+    TEST_ASSERT(preOnlyFuncResult == preOnlyFunc());
+    TEST_ASSERT(2 == preOnlyCounts[0]);
+    TEST_ASSERT(0 == preOnlyCounts[1]);
+
+    TEST_ASSERT(prePostFuncResult == prePostFunc());
+    TEST_ASSERT(prePostFuncResult == prePostFunc());
+    TEST_ASSERT(2 == prePostCounts[0]);
+    TEST_ASSERT(2 == prePostCounts[1]);
+    TEST_ASSERT(static_cast<int>(prePostCounts[2]) == prePostFuncResult);
+  }
+
+  // Creates context hooks on two functions, both of which use the same hook function but have
+  // different context values. Expected result is that each original function returns its own
+  // context value. Skipped if context hooks are unavailable.
+  HOOKSHOT_CUSTOM_TEST(ContextHook)
+  {
+    GENERATE_AND_ASSIGN_FUNCTION(originalFuncA);
+    GENERATE_AND_ASSIGN_FUNCTION(originalFuncB);
+
+    hookContextOffset = HookshotInterface()->GetHookContextOffset();
+    if (0 == hookContextOffset) return;
+
+    TEST_ASSERT(Hookshot::SuccessfulResult(HookshotInterface()->CreateContextHook(
+        originalFuncA, GenericContextHookFunc, reinterpret_cast<void*>(1111))));
+    TEST_ASSERT(Hookshot::SuccessfulResult(HookshotInterface()->CreateContextHook(
+        originalFuncB, GenericContextHookFunc, reinterpret_cast<void*>(2222))));
+
+    TEST_ASSERT(1111 == originalFuncA());
+    TEST_ASSERT(2222 == originalFuncB());
+    TEST_ASSERT(1111 == originalFuncA());
+  }
+
+  // Places a probe at the first instruction of a function, which is an instruction boundary just
+  // like any other. Expected result is that the function behaves exactly as before and that the
+  // probe callback is invoked every time the function runs. Skipped if probes are unavailable.
+  HOOKSHOT_CUSTOM_TEST(Probe)
+  {
+    GENERATE_AND_ASSIGN_FUNCTION(originalFunc);
+
+    const auto originalFuncResult = originalFunc();
+    size_t probeCount = 0;
+
+    TEST_ASSERT(
+        Hookshot::EResult::FailInvalidArgument ==
+        HookshotInterface()->CreateProbe(originalFunc, nullptr, &probeCount));
+
+    const Hookshot::EResult probeResult =
+        HookshotInterface()->CreateProbe(originalFunc, CountProbe, &probeCount);
+    if (Hookshot::EResult::FailAllocation == probeResult) return;
+
+    TEST_ASSERT(Hookshot::SuccessfulResult(probeResult));
+    TEST_ASSERT(originalFuncResult == originalFunc());
+    TEST_ASSERT(originalFuncResult == originalFunc());
+    TEST_ASSERT(2 == probeCount);
+  }
+
+  // Searches the test executable for the bytes at the beginning of one of its own functions, once
+  // exactly and once with wildcards, along with a pattern made entirely of wildcards. Expected
+  // result is that both valid patterns are found at or before the function, wherever the same bytes
+  // first occur, and that the pattern made entirely of wildcards is rejected.
+  HOOKSHOT_CUSTOM_TEST(FindPatterns)
+  {
+    constexpr size_t kPatternLength = 16;
+
+    const uint8_t* const functionBytes = reinterpret_cast<const uint8_t*>(&CountProbe);
+    const uint8_t wildcardMask[kPatternLength] = {
+        0xff, 0xff, 0xff, 0xff, 0x00, 0x00, 0xff, 0xff,
+        0xff, 0x00, 0xff, 0xff, 0xff, 0xff, 0x0f, 0xf0};
+    const uint8_t allWildcardMask[kPatternLength] = {};
+
+    const Hookshot::SBytePattern patterns[] = {
+        {.bytes = functionBytes, .mask = nullptr, .length = kPatternLength},
+        {.bytes = functionBytes, .mask = wildcardMask, .length = kPatternLength}};
+    void* results[_countof(patterns)] = {};
+
+    TEST_ASSERT(
+        Hookshot::EResult::Success ==
+        HookshotInterface()->FindPatterns(
+            GetModuleHandle(nullptr), patterns, _countof(patterns), results));
+
+    for (size_t i = 0; i < _countof(patterns); ++i)
+    {
+      TEST_ASSERT(nullptr != results[i]);
+      TEST_ASSERT(reinterpret_cast<size_t>(results[i]) <= reinterpret_cast<size_t>(functionBytes));
+    }
+
+    TEST_ASSERT(0 == std::memcmp(results[0], functionBytes, kPatternLength));
+
+    const Hookshot::SBytePattern invalidPattern = {
+        .bytes = functionBytes, .mask = allWildcardMask, .length = kPatternLength};
+    void* invalidResult = nullptr;
+
+    TEST_ASSERT(
+        Hookshot::EResult::FailInvalidArgument ==
+        HookshotInterface()->FindPatterns(
+            GetModuleHandle(nullptr), &invalidPattern, 1, &invalidResult));
+  }
+
+  // Creates a hot-swappable hook and swaps its hook function back and forth. Expected result is
+  // that every swap takes effect immediately and that the original function remains accessible
+  // throughout.
+  HOOKSHOT_CUSTOM_TEST(HotSwapHook)
+  {
+    GENERATE_AND_ASSIGN_FUNCTION(originalFunc);
+    GENERATE_AND_ASSIGN_FUNCTION(hookFuncA);
+    GENERATE_AND_ASSIGN_FUNCTION(hookFuncB);
+
+    const auto originalFuncResult = originalFunc();
+    const auto hookFuncAResult = hookFuncA();
+    const auto hookFuncBResult = hookFuncB();
+
+    Hookshot::SHotSwapSlot* slot = nullptr;
+    TEST_ASSERT(Hookshot::SuccessfulResult(
+        HookshotInterface()->CreateHotSwapHook(originalFunc, hookFuncA, &slot)));
+    TEST_ASSERT(nullptr != slot);
+    TEST_ASSERT(hookFuncAResult == originalFunc());
+
+    for (int i = 0; i < 4; ++i)
+    {
+      TEST_ASSERT(Hookshot::SuccessfulResult(
+          HookshotInterface()->HotSwapHookFunction(slot, hookFuncB)));
+      TEST_ASSERT(hookFuncBResult == originalFunc());
+
+      TEST_ASSERT(Hookshot::SuccessfulResult(
+          HookshotInterface()->HotSwapHookFunction(slot, hookFuncA)));
+      TEST_ASSERT(hookFuncAResult == originalFunc());
+    }
+
+    TEST_ASSERT(
+        originalFuncResult ==
+        ((decltype(originalFunc))HookshotInterface()->GetOriginalFunction(originalFunc))());
+  }
+
+  // Overrides a hook on the calling thread, then bypasses it, then clears the override. Expected
+  // result is that each change takes effect on the calling thread but that other threads always
+  // reach the hook function.
+  HOOKSHOT_CUSTOM_TEST(ThreadHookOverride)
+  {
+    GENERATE_AND_ASSIGN_FUNCTION(originalFunc);
+    GENERATE_AND_ASSIGN_FUNCTION(hookFunc);
+    GENERATE_AND_ASSIGN_FUNCTION(overrideFunc);
+
+    const auto originalFuncResult = originalFunc();
+    const auto hookFuncResult = hookFunc();
+    const auto overrideFuncResult = overrideFunc();
+
+    TEST_ASSERT(
+        Hookshot::EResult::FailNotFound ==
+        HookshotInterface()->SetThreadHookOverride(originalFunc, overrideFunc));
+
+    TEST_ASSERT(
+        Hookshot::SuccessfulResult(HookshotInterface()->CreateHook(originalFunc, hookFunc)));
+    TEST_ASSERT(hookFuncResult == originalFunc());
+
+    const Hookshot::EResult overrideResult =
+        HookshotInterface()->SetThreadHookOverride(hookFunc, overrideFunc);
+    if (Hookshot::EResult::FailAllocation == overrideResult) return;
+
+    TEST_ASSERT(Hookshot::SuccessfulResult(overrideResult));
+    TEST_ASSERT(overrideFuncResult == originalFunc());
+
+    auto otherThreadResult = hookFuncResult;
+    std::thread([originalFunc, &otherThreadResult]() -> void
+                { otherThreadResult = originalFunc(); })
+        .join();
+    TEST_ASSERT(hookFuncResult == otherThreadResult);
+
+    TEST_ASSERT(Hookshot::SuccessfulResult(
+        HookshotInterface()->SetThreadHookOverride(originalFunc, originalFunc)));
+    TEST_ASSERT(originalFuncResult == originalFunc());
+
+    TEST_ASSERT(Hookshot::SuccessfulResult(
+        HookshotInterface()->SetThreadHookOverride(originalFunc, nullptr)));
+    TEST_ASSERT(hookFuncResult == originalFunc());
+  }
+
+  // Queries hook statistics for a valid hook and for a function that is not hooked. Expected
+  // result is that statistics are either unavailable because hook instrumentation is not enabled
+  // or that they account for every invocation of the original function.
+  HOOKSHOT_CUSTOM_TEST(QueryHookStatistics)
+  {
+    GENERATE_AND_ASSIGN_FUNCTION(originalFunc);
+    GENERATE_AND_ASSIGN_FUNCTION(hookFunc);
+
+    const auto hookFuncResult = hookFunc();
+
+    Hookshot::SHookStatistics hookStatistics = {};
+    TEST_ASSERT(
+        Hookshot::EResult::FailNotFound ==
+        HookshotInterface()->GetHookStatistics(originalFunc, &hookStatistics));
+
+    TEST_ASSERT(
+        Hookshot::SuccessfulResult(HookshotInterface()->CreateHook(originalFunc, hookFunc)));
+    TEST_ASSERT(hookFuncResult == originalFunc());
+    TEST_ASSERT(hookFuncResult == originalFunc());
+    TEST_ASSERT(
+        Hookshot::EResult::FailInvalidArgument ==
+        HookshotInterface()->GetHookStatistics(originalFunc, nullptr));
+
+    const Hookshot::EResult statisticsResult =
+        HookshotInterface()->GetHookStatistics(hookFunc, &hookStatistics);
+    TEST_ASSERT(Hookshot::SuccessfulResult(statisticsResult));
+    if (Hookshot::EResult::Success == statisticsResult)
+    {
+      TEST_ASSERT(2 == hookStatistics.callCount);
+    }
+  }
+
+  // Queries the timing histogram for a valid hook and for a function that is not hooked. Expected
+  // result is that the histogram is either unavailable because sampled hook timing is not enabled
+  // or that it accounts for no more calls than could have been sampled.
+  HOOKSHOT_CUSTOM_TEST(QueryHookTimingHistogram)
+  {
+    GENERATE_AND_ASSIGN_FUNCTION(originalFunc);
+    GENERATE_AND_ASSIGN_FUNCTION(hookFunc);
+
+    const auto hookFuncResult = hookFunc();
+
+    Hookshot::SHookTimingHistogram hookTimingHistogram = {};
+    TEST_ASSERT(
+        Hookshot::EResult::FailNotFound ==
+        HookshotInterface()->GetHookTimingHistogram(originalFunc, &hookTimingHistogram));
+
+    TEST_ASSERT(
+        Hookshot::SuccessfulResult(HookshotInterface()->CreateHook(originalFunc, hookFunc)));
+    TEST_ASSERT(hookFuncResult == originalFunc());
+    TEST_ASSERT(hookFuncResult == originalFunc());
+    TEST_ASSERT(
+        Hookshot::EResult::FailInvalidArgument ==
+        HookshotInterface()->GetHookTimingHistogram(originalFunc, nullptr));
+
+    const Hookshot::EResult histogramResult =
+        HookshotInterface()->GetHookTimingHistogram(hookFunc, &hookTimingHistogram);
+    TEST_ASSERT(Hookshot::SuccessfulResult(histogramResult));
+    if (Hookshot::EResult::Success == histogramResult)
+    {
+      uint64_t numSampledCalls = 0;
+      for (const uint64_t bucket : hookTimingHistogram.buckets)
+        numSampledCalls += bucket;
+
+      TEST_ASSERT(0 != hookTimingHistogram.sampleInterval);
+      TEST_ASSERT(numSampledCalls <= (2 / hookTimingHistogram.sampleInterval));
+    }
+  }
+
+  // Calls a hooked function enough times for some of the calls to be timed if sampled hook timing
+  // is enabled, and then calls a function with a probe placed at its first instruction. Both paths
+  // must pair every call with a return to the address it pushed, which is enforced whenever the
+  // test executable runs with hardware-enforced stack protection because it is marked as compatible
+  // with shadow stacks. Expected result is that every call returns normally with the expected
+  // result, that timed calls are accounted for in the histogram, and that the probe callback is
+  // invoked every time. Sampling and probes are each skipped if unavailable.
+  HOOKSHOT_CUSTOM_TEST(ShadowStackCompatibility)
+  {
+    constexpr uint64_t kNumCalls = 1000;
+
+    GENERATE_AND_ASSIGN_FUNCTION(originalFunc);
+    GENERATE_AND_ASSIGN_FUNCTION(hookFunc);
+    GENERATE_AND_ASSIGN_FUNCTION(probedFunc);
+
+    const auto hookFuncResult = hookFunc();
+    const auto probedFuncResult = probedFunc();
+
+    TEST_ASSERT(
+        Hookshot::SuccessfulResult(HookshotInterface()->CreateHook(originalFunc, hookFunc)));
+    for (uint64_t i = 0; i < kNumCalls; ++i)
+      TEST_ASSERT(hookFuncResult == originalFunc());
+
+    Hookshot::SHookTimingHistogram hookTimingHistogram = {};
+    if (Hookshot::EResult::Success ==
+        HookshotInterface()->GetHookTimingHistogram(hookFunc, &hookTimingHistogram))
+    {
+      uint64_t numSampledCalls = 0;
+      for (const uint64_t bucket : hookTimingHistogram.buckets)
+        numSampledCalls += bucket;
+
+      TEST_ASSERT(0 != hookTimingHistogram.sampleInterval);
+      TEST_ASSERT(numSampledCalls <= (kNumCalls / hookTimingHistogram.sampleInterval));
+      if (hookTimingHistogram.sampleInterval <= kNumCalls) TEST_ASSERT(0 != numSampledCalls);
+    }
+
+    size_t probeCount = 0;
+    const Hookshot::EResult probeResult =
+        HookshotInterface()->CreateProbe(probedFunc, CountProbe, &probeCount);
+    if (Hookshot::EResult::FailAllocation == probeResult) return;
+
+    TEST_ASSERT(Hookshot::SuccessfulResult(probeResult));
+    for (uint64_t i = 0; i < kNumCalls; ++i)
+      TEST_ASSERT(probedFuncResult == probedFunc());
+    TEST_ASSERT(kNumCalls == probeCount);
+  }
+
+  // Sets and removes a latency budget for a valid hook and for a function that is not hooked.
+  // Expected result is that the budget is either rejected because sampled hook timing is not
+  // enabled or that it can be set, changed, and removed, and that a generous budget never disables
+  // the hook.
+  HOOKSHOT_CUSTOM_TEST(SetHookLatencyBudget)
+  {
+    GENERATE_AND_ASSIGN_FUNCTION(originalFunc);
+    GENERATE_AND_ASSIGN_FUNCTION(hookFunc);
+
+    const auto hookFuncResult = hookFunc();
+
+    TEST_ASSERT(
+        Hookshot::EResult::FailNotFound ==
+        HookshotInterface()->SetHookLatencyBudget(originalFunc, 1000000));
+
+    TEST_ASSERT(
+        Hookshot::SuccessfulResult(HookshotInterface()->CreateHook(originalFunc, hookFunc)));
+    TEST_ASSERT(hookFuncResult == originalFunc());
+
+    const Hookshot::EResult budgetResult =
+        HookshotInterface()->SetHookLatencyBudget(hookFunc, 1000000);
+    TEST_ASSERT(Hookshot::SuccessfulResult(budgetResult));
+    if (Hookshot::EResult::Success == budgetResult)
+    {
+      TEST_ASSERT(
+          Hookshot::EResult::Success ==
+          HookshotInterface()->SetHookLatencyBudget(originalFunc, 2000000));
+      TEST_ASSERT(hookFuncResult == originalFunc());
+
+      TEST_ASSERT(
+          Hookshot::EResult::Success ==
+          HookshotInterface()->SetHookLatencyBudget(originalFunc, 0));
+      TEST_ASSERT(
+          Hookshot::EResult::NoEffect ==
+          HookshotInterface()->SetHookLatencyBudget(originalFunc, 0));
+    }
+
+    TEST_ASSERT(hookFuncResult == originalFunc());
+  }
+
+  // Reserves capacity for a batch of hooks and then creates a hook. Expected result is that invalid
+  // reservations are rejected, a valid reservation succeeds, and hook creation is unaffected.
+  HOOKSHOT_CUSTOM_TEST(ReserveHooks)
+  {
+    GENERATE_AND_ASSIGN_FUNCTION(originalFunc);
+    GENERATE_AND_ASSIGN_FUNCTION(hookFunc);
+
+    const auto hookFuncResult = hookFunc();
+    const void* const targetModule = GetModuleHandle(nullptr);
+
+    TEST_ASSERT(
+        Hookshot::EResult::FailInvalidArgument ==
+        HookshotInterface()->ReserveHooks(16, nullptr, 1));
+    TEST_ASSERT(
+        Hookshot::EResult::NoEffect == HookshotInterface()->ReserveHooks(0, &targetModule, 1));
+    TEST_ASSERT(
+        Hookshot::EResult::Success == HookshotInterface()->ReserveHooks(256, &targetModule, 1));
+
+    TEST_ASSERT(
+        Hookshot::SuccessfulResult(HookshotInterface()->CreateHook(originalFunc, hookFunc)));
+    TEST_ASSERT(hookFuncResult == originalFunc());
+  }
+
+  // Captures a snapshot of all hooks before and after creating a hook. Expected result is that the
+  // new hook appears in the second snapshot exactly once and matches what individual queries
+  // report.
+  HOOKSHOT_CUSTOM_TEST(SnapshotHooks)
+  {
+    GENERATE_AND_ASSIGN_FUNCTION(originalFunc);
+    GENERATE_AND_ASSIGN_FUNCTION(hookFunc);
+
+    size_t numHooksBefore = 0;
+    TEST_ASSERT(
+        Hookshot::EResult::FailInvalidArgument ==
+        HookshotInterface()->SnapshotHooks(nullptr, 0, nullptr));
+    TEST_ASSERT(
+        Hookshot::EResult::FailInvalidArgument ==
+        HookshotInterface()->SnapshotHooks(nullptr, 1, &numHooksBefore));
+    TEST_ASSERT(
+        Hookshot::EResult::Success ==
+        HookshotInterface()->SnapshotHooks(nullptr, 0, &numHooksBefore));
+
+    TEST_ASSERT(
+        Hookshot::SuccessfulResult(HookshotInterface()->CreateHook(originalFunc, hookFunc)));
+
+    std::vector<Hookshot::SHookInfo> hookInfo(numHooksBefore + 1);
+    size_t numHooksAfter = 0;
+    TEST_ASSERT(
+        Hookshot::EResult::Success ==
+        HookshotInterface()->SnapshotHooks(hookInfo.data(), hookInfo.size(), &numHooksAfter));
+    TEST_ASSERT((numHooksBefore + 1) == numHooksAfter);
+
+    size_t numMatchingHooks = 0;
+    for (const auto& hook : hookInfo)
+    {
+      if (hook.hookFunc != hookFunc) continue;
+
+      TEST_ASSERT(hook.originalFunc == originalFunc);
+      TEST_ASSERT(hook.originalFuncAfterHook == HookshotInterface()->GetOriginalFunction(hookFunc));
+      TEST_ASSERT(0 == (hook.flags & Hookshot::kHookInfoFlagDisabled));
+      numMatchingHooks += 1;
+    }
+
+    TEST_ASSERT(1 == numMatchingHooks);
+  }
+
+  // Measures memory footprint before and after creating a hook. Expected result is that invalid
+  // arguments are rejected, that the hook is accounted for by at least one trampoline store and one
+  // modified page, and that the per-store and per-module measurements agree with the totals.
+  HOOKSHOT_CUSTOM_TEST(GetMemoryFootprint)
+  {
+    GENERATE_AND_ASSIGN_FUNCTION(originalFunc);
+    GENERATE_AND_ASSIGN_FUNCTION(hookFunc);
+
+    size_t numStores = 0;
+    size_t numModules = 0;
+    TEST_ASSERT(
+        Hookshot::EResult::FailInvalidArgument == HookshotInterface()->GetMemoryFootprint(nullptr));
+    TEST_ASSERT(
+        Hookshot::EResult::FailInvalidArgument ==
+        HookshotInterface()->GetTrampolineStoreFootprints(nullptr, 0, nullptr));
+    TEST_ASSERT(
+        Hookshot::EResult::FailInvalidArgument ==
+        HookshotInterface()->GetTrampolineStoreFootprints(nullptr, 1, &numStores));
+    TEST_ASSERT(
+        Hookshot::EResult::FailInvalidArgument ==
+        HookshotInterface()->GetModuleFootprints(nullptr, 0, nullptr));
+    TEST_ASSERT(
+        Hookshot::EResult::FailInvalidArgument ==
+        HookshotInterface()->GetModuleFootprints(nullptr, 1, &numModules));
+
+    TEST_ASSERT(
+        Hookshot::SuccessfulResult(HookshotInterface()->CreateHook(originalFunc, hookFunc)));
+
+    Hookshot::SMemoryFootprint footprint = {};
+    TEST_ASSERT(Hookshot::EResult::Success == HookshotInterface()->GetMemoryFootprint(&footprint));
+    TEST_ASSERT(footprint.numTrampolineStores > 0);
+    TEST_ASSERT(footprint.trampolineCommittedBytes > 0);
+    TEST_ASSERT(footprint.trampolineReservedBytes >= footprint.trampolineCommittedBytes);
+    TEST_ASSERT(footprint.hookStoreHeapBytes > 0);
+    TEST_ASSERT(footprint.numPrivatePatchedPages > 0);
+
+    TEST_ASSERT(
+        Hookshot::EResult::Success ==
+        HookshotInterface()->GetTrampolineStoreFootprints(nullptr, 0, &numStores));
+    TEST_ASSERT(footprint.numTrampolineStores == numStores);
+
+    std::vector<Hookshot::STrampolineStoreFootprint> storeFootprints(numStores);
+    TEST_ASSERT(
+        Hookshot::EResult::Success ==
+        HookshotInterface()->GetTrampolineStoreFootprints(
+            storeFootprints.data(), storeFootprints.size(), &numStores));
+    TEST_ASSERT(storeFootprints.size() == numStores);
+
+    size_t storeCommittedBytes = 0;
+    for (const auto& storeFootprint : storeFootprints)
+    {
+      TEST_ASSERT(nullptr != storeFootprint.baseAddress);
+      TEST_ASSERT(storeFootprint.reservedBytes >= storeFootprint.committedBytes);
+      storeCommittedBytes += storeFootprint.committedBytes;
+    }
+    TEST_ASSERT(footprint.trampolineCommittedBytes == storeCommittedBytes);
+
+    TEST_ASSERT(
+        Hookshot::EResult::Success ==
+        HookshotInterface()->GetModuleFootprints(nullptr, 0, &numModules));
+    TEST_ASSERT(numModules > 0);
+
+    std::vector<Hookshot::SModuleFootprint> moduleFootprints(numModules);
+    TEST_ASSERT(
+        Hookshot::EResult::Success ==
+        HookshotInterface()->GetModuleFootprints(
+            moduleFootprints.data(), moduleFootprints.size(), &numModules));
+    TEST_ASSERT(moduleFootprints.size() == numModules);
+
+    size_t modulePatchedPages = 0;
+    for (const auto& moduleFootprint : moduleFootprints)
+      modulePatchedPages += moduleFootprint.numPrivatePatchedPages;
+    TEST_ASSERT(footprint.numPrivatePatchedPages == modulePatchedPages);
+  }
+
+  // Obtains the second version of the Hookshot interface and uses it to operate on two hooks at
+  // once. Expected result is that unknown versions are rejected, that lookups and disabling work
+  // for both hooks together, and that a function that is not hooked is reported individually.
+  HOOKSHOT_CUSTOM_TEST(QueryInterfaceVersion2)
+  {
+    GENERATE_AND_ASSIGN_FUNCTION(originalFuncA);
+    GENERATE_AND_ASSIGN_FUNCTION(hookFuncA);
+    GENERATE_AND_ASSIGN_FUNCTION(originalFuncB);
+    GENERATE_AND_ASSIGN_FUNCTION(hookFuncB);
+    GENERATE_AND_ASSIGN_FUNCTION(unhookedFunc);
+
+    const auto originalFuncAResult = originalFuncA();
+    const auto originalFuncBResult = originalFuncB();
+
+    TEST_ASSERT(nullptr == HookshotInterface()->QueryInterface(0));
+    TEST_ASSERT(
+        nullptr == HookshotInterface()->QueryInterface(Hookshot::kInterfaceVersionLatest + 1));
+
+    Hookshot::IHookshot2* const hookshot2 = reinterpret_cast<Hookshot::IHookshot2*>(
+        HookshotInterface()->QueryInterface(Hookshot::kInterfaceVersion2));
+    TEST_ASSERT(nullptr != hookshot2);
+
+    const Hookshot::SHookSpec hookSpecs[] = {
+        {.originalFunc = originalFuncA, .hookFunc = hookFuncA},
+        {.originalFunc = originalFuncB, .hookFunc = hookFuncB}};
+    TEST_ASSERT(
+        Hookshot::SuccessfulResult(
+            HookshotInterface()->CreateHooks(hookSpecs, _countof(hookSpecs), nullptr)));
+
+    const void* const funcs[] = {hookFuncA, originalFuncB, unhookedFunc};
+    const void* originalFuncs[_countof(funcs)] = {};
+    TEST_ASSERT(
+        Hookshot::EResult::FailNotFound ==
+        hookshot2->GetOriginalFunctions(funcs, _countof(funcs), originalFuncs));
+    TEST_ASSERT(originalFuncAResult == ((decltype(originalFuncA))originalFuncs[0])());
+    TEST_ASSERT(originalFuncBResult == ((decltype(originalFuncB))originalFuncs[1])());
+    TEST_ASSERT(nullptr == originalFuncs[2]);
+
+    Hookshot::EResult results[_countof(funcs)];
+    TEST_ASSERT(
+        Hookshot::EResult::FailNotFound ==
+        hookshot2->DisableHookFunctions(funcs, _countof(funcs), results));
+    TEST_ASSERT(Hookshot::SuccessfulResult(results[0]));
+    TEST_ASSERT(Hookshot::SuccessfulResult(results[1]));
+    TEST_ASSERT(Hookshot::EResult::FailNotFound == results[2]);
+
+    TEST_ASSERT(originalFuncAResult == originalFuncA());
+    TEST_ASSERT(originalFuncBResult == originalFuncB());
+  }
+
+  // Obtains the third version of the Hookshot interface and queries the caller histogram for a
+  // valid hook and for a function that is not hooked. Expected result is that the histogram is
+  // either unavailable because caller recording is not enabled or that it accounts for no more
+  // calls than could have been sampled, all of them made from this module.
+  HOOKSHOT_CUSTOM_TEST(QueryHookCallerHistogram)
+  {
+    GENERATE_AND_ASSIGN_FUNCTION(originalFunc);
+    GENERATE_AND_ASSIGN_FUNCTION(hookFunc);
+
+    const auto hookFuncResult = hookFunc();
+
+    Hookshot::IHookshot3* const hookshot3 = reinterpret_cast<Hookshot::IHookshot3*>(
+        HookshotInterface()->QueryInterface(Hookshot::kInterfaceVersion3));
+    TEST_ASSERT(nullptr != hookshot3);
+
+    Hookshot::SHookCallerHistogram hookCallerHistogram = {};
+    TEST_ASSERT(
+        Hookshot::EResult::FailNotFound ==
+        hookshot3->GetHookCallerHistogram(originalFunc, &hookCallerHistogram));
+
+    TEST_ASSERT(
+        Hookshot::SuccessfulResult(HookshotInterface()->CreateHook(originalFunc, hookFunc)));
+    TEST_ASSERT(hookFuncResult == originalFunc());
+    TEST_ASSERT(hookFuncResult == originalFunc());
+    TEST_ASSERT(
+        Hookshot::EResult::FailInvalidArgument ==
+        hookshot3->GetHookCallerHistogram(originalFunc, nullptr));
+
+    const Hookshot::EResult histogramResult =
+        hookshot3->GetHookCallerHistogram(hookFunc, &hookCallerHistogram);
+    TEST_ASSERT(Hookshot::SuccessfulResult(histogramResult));
+    if ((Hookshot::EResult::Success == histogramResult) && (0 != hookCallerHistogram.numSamples))
+    {
+      TEST_ASSERT(hookCallerHistogram.numSamples <= 2);
+      TEST_ASSERT(1 == hookCallerHistogram.numModules);
+      TEST_ASSERT(hookCallerHistogram.numSamples == hookCallerHistogram.counts[0]);
+      TEST_ASSERT(GetModuleHandle(nullptr) == hookCallerHistogram.modules[0]);
+    }
+  }
+
+  // Obtains the fourth version of the Hookshot interface and attempts to instrument the exports of
+  // a module without specifying one of the required parameters. Expected result is that the
+  // attempts fail without touching any module or the output parameter.
+  HOOKSHOT_CUSTOM_TEST(InstrumentModuleExportsInvalid)
+  {
+    Hookshot::IHookshot4* const hookshot4 = reinterpret_cast<Hookshot::IHookshot4*>(
+        HookshotInterface()->QueryInterface(Hookshot::kInterfaceVersion4));
+    TEST_ASSERT(nullptr != hookshot4);
+
+    const HMODULE moduleHandle = GetModuleHandle(L"kernel32.dll");
+    TEST_ASSERT(nullptr != moduleHandle);
+
+    const Hookshot::SModuleInstrumentationOptions options = {.sampleInterval = 0};
+    size_t numInstrumented = 1;
+
+    TEST_ASSERT(
+        Hookshot::EResult::FailInvalidArgument ==
+        hookshot4->InstrumentModuleExports(nullptr, &options, &numInstrumented));
+    TEST_ASSERT(
+        Hookshot::EResult::FailInvalidArgument ==
+        hookshot4->InstrumentModuleExports(moduleHandle, nullptr, &numInstrumented));
+    TEST_ASSERT(1 == numInstrumented);
+  }
+
+  // Obtains the fifth version of the Hookshot interface and hooks a function without specifying
+  // the kind of hook. Generated functions are not part of any module, so no address table can refer
+  // to them, and the cheapest kind of hook for them is an inline hook. Expected result is that an
+  // inline hook is created and reported.
+  HOOKSHOT_CUSTOM_TEST(CreateHookAuto)
+  {
+    Hookshot::IHookshot5* const hookshot5 = reinterpret_cast<Hookshot::IHookshot5*>(
+        HookshotInterface()->QueryInterface(Hookshot::kInterfaceVersion5));
+    TEST_ASSERT(nullptr != hookshot5);
+
+    GENERATE_AND_ASSIGN_FUNCTION(originalFunc);
+    GENERATE_AND_ASSIGN_FUNCTION(hookFunc);
+
+    const auto originalFuncResult = originalFunc();
+    const auto hookFuncResult = hookFunc();
+
+    Hookshot::EHookKind chosenKind = Hookshot::EHookKind::DebugRegister;
+    TEST_ASSERT(
+        Hookshot::EResult::FailInvalidArgument ==
+        hookshot5->CreateHookAuto(nullptr, hookFunc, &chosenKind));
+    TEST_ASSERT(Hookshot::EHookKind::DebugRegister == chosenKind);
+
+    TEST_ASSERT(
+        Hookshot::SuccessfulResult(hookshot5->CreateHookAuto(originalFunc, hookFunc, &chosenKind)));
+    TEST_ASSERT(Hookshot::EHookKind::Inline == chosenKind);
+    TEST_ASSERT(hookFuncResult == originalFunc());
+    TEST_ASSERT(
+        originalFuncResult ==
+        ((decltype(originalFunc))HookshotInterface()->GetOriginalFunction(hookFunc))());
+  }
+
+  // Seals the hooks and verifies that lookups still find every hook, that sealing twice has no
+  // effect, and that hooks created afterwards are found both before and after sealing again.
+  HOOKSHOT_CUSTOM_TEST(Seal)
+  {
+    Hookshot::IHookshot6* const hookshot6 = reinterpret_cast<Hookshot::IHookshot6*>(
+        HookshotInterface()->QueryInterface(Hookshot::kInterfaceVersion6));
+    TEST_ASSERT(nullptr != hookshot6);
+
+    GENERATE_AND_ASSIGN_FUNCTION(originalFuncA);
+    GENERATE_AND_ASSIGN_FUNCTION(hookFuncA);
+    GENERATE_AND_ASSIGN_FUNCTION(originalFuncB);
+    GENERATE_AND_ASSIGN_FUNCTION(hookFuncB);
+
+    const auto originalFuncResultA = originalFuncA();
+    const auto originalFuncResultB = originalFuncB();
+
+    TEST_ASSERT(
+        Hookshot::SuccessfulResult(HookshotInterface()->CreateHook(originalFuncA, hookFuncA)));
+
+    TEST_ASSERT(Hookshot::EResult::Success == hookshot6->Seal());
+    TEST_ASSERT(Hookshot::EResult::NoEffect == hookshot6->Seal());
+    TEST_ASSERT(
+        HookshotInterface()->GetOriginalFunction(originalFuncA) ==
+        HookshotInterface()->GetOriginalFunction(hookFuncA));
+    TEST_ASSERT(
+        originalFuncResultA ==
+        ((decltype(originalFuncA))HookshotInterface()->GetOriginalFunction(hookFuncA))());
+    TEST_ASSERT(nullptr == HookshotInterface()->GetOriginalFunction(originalFuncB));
+
+    TEST_ASSERT(
+        Hookshot::SuccessfulResult(HookshotInterface()->CreateHook(originalFuncB, hookFuncB)));
+    TEST_ASSERT(
+        originalFuncResultB ==
+        ((decltype(originalFuncB))HookshotInterface()->GetOriginalFunction(hookFuncB))());
+
+    TEST_ASSERT(Hookshot::EResult::Success == hookshot6->Seal());
+    TEST_ASSERT(
+        originalFuncResultA ==
+        ((decltype(originalFuncA))HookshotInterface()->GetOriginalFunction(hookFuncA))());
+    TEST_ASSERT(
+        originalFuncResultB ==
+        ((decltype(originalFuncB))HookshotInterface()->GetOriginalFunction(originalFuncB))());
+  }
+
+  // Creates a one-shot hook and verifies that only the first call reaches the hook function and
+  // that every later call reaches the original function.
+  HOOKSHOT_CUSTOM_TEST(CreateOneShotHook)
+  {
+    Hookshot::IHookshot7* const hookshot7 = reinterpret_cast<Hookshot::IHookshot7*>(
+        HookshotInterface()->QueryInterface(Hookshot::kInterfaceVersion7));
+    TEST_ASSERT(nullptr != hookshot7);
+
+    GENERATE_AND_ASSIGN_FUNCTION(originalFunc);
+    GENERATE_AND_ASSIGN_FUNCTION(hookFunc);
+
+    const auto originalFuncResult = originalFunc();
+    const auto hookFuncResult = hookFunc();
+    TEST_ASSERT(originalFuncResult != hookFuncResult);
+
+    TEST_ASSERT(Hookshot::SuccessfulResult(hookshot7->CreateOneShotHook(originalFunc, hookFunc)));
+    TEST_ASSERT(hookFuncResult == originalFunc());
+    TEST_ASSERT(originalFuncResult == originalFunc());
+    TEST_ASSERT(originalFuncResult == originalFunc());
+  }
+
+  // Creates a sampled hook and verifies that only one out of every so many calls reaches the hook
+  // function, that the interval can be changed, and that the hook can be removed.
+  HOOKSHOT_CUSTOM_TEST(CreateSampledHook)
+  {
+    Hookshot::IHookshot13* const hookshot13 = reinterpret_cast<Hookshot::IHookshot13*>(
+        HookshotInterface()->QueryInterface(Hookshot::kInterfaceVersion13));
+    TEST_ASSERT(nullptr != hookshot13);
+
+    GENERATE_AND_ASSIGN_FUNCTION(originalFunc);
+    GENERATE_AND_ASSIGN_FUNCTION(hookFunc);
+
+    const auto originalFuncResult = originalFunc();
+    const auto hookFuncResult = hookFunc();
+    TEST_ASSERT(originalFuncResult != hookFuncResult);
+
+    TEST_ASSERT(
+        Hookshot::EResult::FailInvalidArgument ==
+        hookshot13->CreateSampledHook(originalFunc, hookFunc, 0));
+    TEST_ASSERT(
+        Hookshot::EResult::FailNotFound == hookshot13->SetSampledHookInterval(originalFunc, 3));
+
+    TEST_ASSERT(
+        Hookshot::SuccessfulResult(hookshot13->CreateSampledHook(originalFunc, hookFunc, 3)));
+    TEST_ASSERT(nullptr != HookshotInterface()->GetOriginalFunction(originalFunc));
+
+    for (int i = 0; i < 2; ++i)
+    {
+      TEST_ASSERT(originalFuncResult == originalFunc());
+      TEST_ASSERT(originalFuncResult == originalFunc());
+      TEST_ASSERT(hookFuncResult == originalFunc());
+    }
+
+    TEST_ASSERT(
+        Hookshot::EResult::FailInvalidArgument ==
+        hookshot13->SetSampledHookInterval(originalFunc, 0));
+    TEST_ASSERT(Hookshot::EResult::NoEffect == hookshot13->SetSampledHookInterval(originalFunc, 3));
+    TEST_ASSERT(Hookshot::EResult::Success == hookshot13->SetSampledHookInterval(originalFunc, 1));
+    TEST_ASSERT(hookFuncResult == originalFunc());
+    TEST_ASSERT(hookFuncResult == originalFunc());
+
+    TEST_ASSERT(Hookshot::SuccessfulResult(HookshotInterface()->RemoveHook(originalFunc)));
+    TEST_ASSERT(originalFuncResult == originalFunc());
+    TEST_ASSERT(
+        Hookshot::EResult::FailNotFound == hookshot13->SetSampledHookInterval(originalFunc, 2));
+  }
+
+  // Queries whether a function can be hooked, both before and after hooking it, and verifies that
+  // the query itself does not hook the function or otherwise modify it.
+  HOOKSHOT_CUSTOM_TEST(CanHook)
+  {
+    Hookshot::IHookshot14* const hookshot14 = reinterpret_cast<Hookshot::IHookshot14*>(
+        HookshotInterface()->QueryInterface(Hookshot::kInterfaceVersion14));
+    TEST_ASSERT(nullptr != hookshot14);
+
+    GENERATE_AND_ASSIGN_FUNCTION(originalFunc);
+    GENERATE_AND_ASSIGN_FUNCTION(hookFunc);
+
+    const auto originalFuncResult = originalFunc();
+    const auto hookFuncResult = hookFunc();
+
+    Hookshot::SHookFeasibility feasibility{};
+    TEST_ASSERT(
+        Hookshot::EResult::FailInvalidArgument == hookshot14->CanHook(nullptr, &feasibility));
+    TEST_ASSERT(
+        Hookshot::EResult::FailInvalidArgument == hookshot14->CanHook(originalFunc, nullptr));
+
+    TEST_ASSERT(Hookshot::SuccessfulResult(hookshot14->CanHook(originalFunc, &feasibility)));
+    TEST_ASSERT(0 != (feasibility.possibleKinds &
+                      (1u << static_cast<uint32_t>(Hookshot::EHookKind::Inline))));
+    TEST_ASSERT(false == feasibility.isAlreadyHooked);
+    TEST_ASSERT(feasibility.numTransplantedBytes >= 5);
+    TEST_ASSERT(0 != feasibility.numTransplantedInstructions);
+    TEST_ASSERT(nullptr == HookshotInterface()->GetOriginalFunction(originalFunc));
+    TEST_ASSERT(originalFuncResult == originalFunc());
+
+    TEST_ASSERT(
+        Hookshot::SuccessfulResult(HookshotInterface()->CreateHook(originalFunc, hookFunc)));
+    TEST_ASSERT(hookFuncResult == originalFunc());
+
+    TEST_ASSERT(Hookshot::SuccessfulResult(hookshot14->CanHook(originalFunc, &feasibility)));
+    TEST_ASSERT(true == feasibility.isAlreadyHooked);
+    TEST_ASSERT(0 == feasibility.numTransplantedBytes);
+  }
+
+  // Creates a hook, removes it, and then creates the same hook again. If the hook plan cache is
+  // enabled, the first creation records a hook plan for the original function, and the second
+  // creation is expected to find that plan in the cache instead of decoding the function again.
+  HOOKSHOT_CUSTOM_TEST(HookPlanCacheHit)
+  {
+    Hookshot::IHookshot15* const hookshot15 = reinterpret_cast<Hookshot::IHookshot15*>(
+        HookshotInterface()->QueryInterface(Hookshot::kInterfaceVersion15));
+    TEST_ASSERT(nullptr != hookshot15);
+
+    GENERATE_AND_ASSIGN_FUNCTION(originalFunc);
+    GENERATE_AND_ASSIGN_FUNCTION(hookFunc);
+
+    const auto originalFuncResult = originalFunc();
+    const auto hookFuncResult = hookFunc();
+
+    TEST_ASSERT(
+        Hookshot::EResult::FailInvalidArgument == hookshot15->GetHookPlanCacheStatistics(nullptr));
+
+    Hookshot::SHookPlanCacheStatistics statisticsBefore{};
+    const Hookshot::EResult statisticsResult =
+        hookshot15->GetHookPlanCacheStatistics(&statisticsBefore);
+    TEST_ASSERT(Hookshot::SuccessfulResult(statisticsResult));
+
+    TEST_ASSERT(
+        Hookshot::SuccessfulResult(HookshotInterface()->CreateHook(originalFunc, hookFunc)));
+    TEST_ASSERT(hookFuncResult == originalFunc());
+    TEST_ASSERT(Hookshot::SuccessfulResult(HookshotInterface()->RemoveHook(originalFunc)));
+    TEST_ASSERT(originalFuncResult == originalFunc());
+
+    Hookshot::SHookPlanCacheStatistics statisticsAfterFirst{};
+    TEST_ASSERT(
+        statisticsResult == hookshot15->GetHookPlanCacheStatistics(&statisticsAfterFirst));
+
+    TEST_ASSERT(
+        Hookshot::SuccessfulResult(HookshotInterface()->CreateHook(originalFunc, hookFunc)));
+    TEST_ASSERT(hookFuncResult == originalFunc());
+    TEST_ASSERT(
+        originalFuncResult ==
+        ((decltype(originalFunc))HookshotInterface()->GetOriginalFunction(originalFunc))());
+
+    Hookshot::SHookPlanCacheStatistics statisticsAfterSecond{};
+    TEST_ASSERT(
+        statisticsResult == hookshot15->GetHookPlanCacheStatistics(&statisticsAfterSecond));
+
+    if (Hookshot::EResult::Success == statisticsResult)
     {
-      const int actualValue = originalFuncs[i]();
-      Infra::Test::PrintFormatted(
-          L"Hook %d: %s: expected %d, got %d.",
-          i,
-          (actualValue == expectedValues[i] ? L"OK" : L"BAD"),
-          expectedValues[i],
-          actualValue);
-      TEST_ASSERT(actualValue == expectedValues[i]);
+      // A hook plan written to the hook plan cache file by an earlier run can be found even the
+      // first time, in which case there is nothing new to record.
+      TEST_ASSERT(
+          (statisticsAfterFirst.numRecorded + statisticsAfterFirst.numHits) >
+          (statisticsBefore.numRecorded + statisticsBefore.numHits));
+      TEST_ASSERT(statisticsAfterSecond.numLookups > statisticsAfterFirst.numLookups);
+      TEST_ASSERT(statisticsAfterSecond.numHits > statisticsAfterFirst.numHits);
+    }
+    else
+    {
+      TEST_ASSERT(0 == statisticsAfterSecond.numLookups);
+      TEST_ASSERT(0 == statisticsAfterSecond.numHits);
+      TEST_ASSERT(0 == statisticsAfterSecond.numRecorded);
     }
 
-    CloseHandle(testData.syncEventPhase1);
-    CloseHandle(testData.syncEventPhase2);
+    TEST_ASSERT(Hookshot::SuccessfulResult(HookshotInterface()->RemoveHook(originalFunc)));
+    TEST_ASSERT(originalFuncResult == originalFunc());
   }
 
-  // Hookshot is presented with two null pointers.
-  // Expected result is Hookshot rejects the input arguments as invalid.
-  HOOKSHOT_CUSTOM_TEST(NullPointerBoth)
+  // Creates a hook and invalidates the code range that holds its original function, as would be
+  // done for code generated at runtime that is about to be discarded. Verifies that the hook no
+  // longer exists and that invalidating the same range again has no effect. The original function
+  // is not invoked afterwards because invalidation leaves its code as it was while hooked.
+  HOOKSHOT_CUSTOM_TEST(InvalidateCodeRange)
   {
+    Hookshot::IHookshot8* const hookshot8 = reinterpret_cast<Hookshot::IHookshot8*>(
+        HookshotInterface()->QueryInterface(Hookshot::kInterfaceVersion8));
+    TEST_ASSERT(nullptr != hookshot8);
+
+    GENERATE_AND_ASSIGN_FUNCTION(originalFunc);
+    GENERATE_AND_ASSIGN_FUNCTION(hookFunc);
+
     TEST_ASSERT(
-        Hookshot::EResult::FailInvalidArgument ==
-        HookshotInterface()->CreateHook(nullptr, nullptr));
-  }
+        Hookshot::EResult::FailInvalidArgument == hookshot8->InvalidateCodeRange(originalFunc, 0));
 
-  // Hookshot is presented with a null pointer for the hook function.
-  // Expected result is Hookshot rejects the input arguments as invalid.
-  HOOKSHOT_CUSTOM_TEST(NullPointerHook)
-  {
-    GENERATE_AND_ASSIGN_FUNCTION(func);
     TEST_ASSERT(
-        Hookshot::EResult::FailInvalidArgument == HookshotInterface()->CreateHook(func, nullptr));
+        Hookshot::SuccessfulResult(HookshotInterface()->CreateHook(originalFunc, hookFunc)));
+    TEST_ASSERT(nullptr != HookshotInterface()->GetOriginalFunction(hookFunc));
+
+    TEST_ASSERT(Hookshot::EResult::Success == hookshot8->InvalidateCodeRange(originalFunc, 1));
+    TEST_ASSERT(nullptr == HookshotInterface()->GetOriginalFunction(originalFunc));
+    TEST_ASSERT(nullptr == HookshotInterface()->GetOriginalFunction(hookFunc));
+    TEST_ASSERT(Hookshot::EResult::NoEffect == hookshot8->InvalidateCodeRange(originalFunc, 1));
   }
 
-  // Hookshot is presented with a null pointer for the original function.
-  // Expected result is Hookshot rejects the input arguments as invalid.
-  HOOKSHOT_CUSTOM_TEST(NullPointerOriginal)
+  // Relocates the beginning of a function into a buffer within the same module, so that it is
+  // within reach of the rest of the function, and invokes the relocated code. Verifies that it
+  // behaves the same as the function itself and that invalid arguments are rejected.
+  HOOKSHOT_CUSTOM_TEST(RelocateCode)
   {
-    GENERATE_AND_ASSIGN_FUNCTION(func);
+    Hookshot::IHookshot9* const hookshot9 = reinterpret_cast<Hookshot::IHookshot9*>(
+        HookshotInterface()->QueryInterface(Hookshot::kInterfaceVersion9));
+    TEST_ASSERT(nullptr != hookshot9);
+
+    alignas(16) static uint8_t relocationBuffer[64];
+    DWORD oldProtection = 0;
     TEST_ASSERT(
-        Hookshot::EResult::FailInvalidArgument == HookshotInterface()->CreateHook(nullptr, func));
+        FALSE !=
+        VirtualProtect(
+            relocationBuffer, sizeof(relocationBuffer), PAGE_EXECUTE_READWRITE, &oldProtection));
+
+    GENERATE_AND_ASSIGN_FUNCTION(originalFunc);
+
+    TEST_ASSERT(
+        Hookshot::EResult::FailInvalidArgument ==
+        hookshot9->RelocateCode(
+            originalFunc, 0, relocationBuffer, sizeof(relocationBuffer), 0, nullptr));
+    TEST_ASSERT(
+        Hookshot::EResult::FailInvalidArgument ==
+        hookshot9->RelocateCode(originalFunc, 5, relocationBuffer, 4, 0, nullptr));
+
+    Hookshot::SRelocatedCode relocated = {};
+    TEST_ASSERT(
+        Hookshot::EResult::Success ==
+        hookshot9->RelocateCode(
+            originalFunc, 5, relocationBuffer, sizeof(relocationBuffer), 0, &relocated));
+    TEST_ASSERT(0 != relocated.numInstructions);
+    TEST_ASSERT(0 != relocated.numCodeBytes);
+    TEST_ASSERT(
+        (relocated.numCodeBytes + relocated.numTailBytes) <= sizeof(relocationBuffer));
+
+    const TGeneratedTestFunction relocatedFunc =
+        reinterpret_cast<TGeneratedTestFunction>(&relocationBuffer[0]);
+    TEST_ASSERT(originalFunc() == relocatedFunc());
   }
 
-  // Hookshot is presented with equal non-null pointers for both original and hook functions.
-  // Expected result is Hookshot rejects the input arguments as invalid.
-  HOOKSHOT_CUSTOM_TEST(SelfHook)
+  // Creates a hook and then chains a second hook onto the same original function, both at once
+  // with obtaining their original function addresses and handles. Verifies that each original
+  // function address is the one that the hook should invoke and that each handle identifies its
+  // hook.
+  HOOKSHOT_CUSTOM_TEST(CreateHookEx)
   {
-    GENERATE_AND_ASSIGN_FUNCTION(func);
+    Hookshot::IHookshot10* const hookshot10 = reinterpret_cast<Hookshot::IHookshot10*>(
+        HookshotInterface()->QueryInterface(Hookshot::kInterfaceVersion10));
+    TEST_ASSERT(nullptr != hookshot10);
+    Hookshot::IHookshot11* const hookshot11 = reinterpret_cast<Hookshot::IHookshot11*>(
+        HookshotInterface()->QueryInterface(Hookshot::kInterfaceVersion11));
+    TEST_ASSERT(nullptr != hookshot11);
+
+    GENERATE_AND_ASSIGN_FUNCTION(originalFunc);
+    GENERATE_AND_ASSIGN_FUNCTION(hookFunc1);
+    GENERATE_AND_ASSIGN_FUNCTION(hookFunc2);
+
+    const auto originalFuncResult = originalFunc();
+    const auto hookFunc1Result = hookFunc1();
+    const auto hookFunc2Result = hookFunc2();
+    TEST_ASSERT(originalFuncResult != hookFunc1Result);
+    TEST_ASSERT(hookFunc1Result != hookFunc2Result);
+
+    const void* originalFuncAfterHook1 = nullptr;
+    Hookshot::HookHandle hookHandle1 = nullptr;
+    TEST_ASSERT(Hookshot::SuccessfulResult(
+        hookshot10->CreateHookEx(originalFunc, hookFunc1, &originalFuncAfterHook1, &hookHandle1)));
+    TEST_ASSERT(originalFuncAfterHook1 == HookshotInterface()->GetOriginalFunction(hookFunc1));
+    TEST_ASSERT(originalFuncResult == ((decltype(originalFunc))originalFuncAfterHook1)());
+    TEST_ASSERT(Hookshot::kInvalidHookHandle != hookHandle1);
+
+    const void* originalFuncAfterHook2 = nullptr;
+    Hookshot::HookHandle hookHandle2 = nullptr;
+    TEST_ASSERT(Hookshot::SuccessfulResult(
+        hookshot10->CreateHookEx(originalFunc, hookFunc2, &originalFuncAfterHook2, &hookHandle2)));
+    TEST_ASSERT(hookFunc2Result == originalFunc());
+    TEST_ASSERT(hookFunc1Result == ((decltype(originalFunc))originalFuncAfterHook2)());
+    TEST_ASSERT(Hookshot::kInvalidHookHandle != hookHandle2);
+    TEST_ASSERT(hookHandle1 != hookHandle2);
+
+    Hookshot::HookHandle retrievedHookHandle = Hookshot::kInvalidHookHandle;
     TEST_ASSERT(
-        Hookshot::EResult::FailInvalidArgument == HookshotInterface()->CreateHook(func, func));
+        Hookshot::EResult::Success == hookshot11->GetHookHandle(hookFunc1, &retrievedHookHandle));
+    TEST_ASSERT(hookHandle1 == retrievedHookHandle);
+    TEST_ASSERT(
+        Hookshot::EResult::Success == hookshot11->GetHookHandle(hookFunc2, &retrievedHookHandle));
+    TEST_ASSERT(hookHandle2 == retrievedHookHandle);
   }
 
-  // Attempts to replace a valid hook's hook function with one that is already involved in another
-  // hook. Expected result is a failure due to a duplicate hook being detected.
-  HOOKSHOT_CUSTOM_TEST(ReplaceHookDuplicate)
+  // Creates a hook, obtains its handle, and then disables, re-enables, and replaces its hook
+  // function using only the handle. Verifies that the handle keeps identifying the hook
+  // throughout and that it is no longer accepted once the hook is removed.
+  HOOKSHOT_CUSTOM_TEST(HookHandle)
   {
-    GENERATE_AND_ASSIGN_FUNCTION(originalFunc1);
+    Hookshot::IHookshot10* const hookshot10 = reinterpret_cast<Hookshot::IHookshot10*>(
+        HookshotInterface()->QueryInterface(Hookshot::kInterfaceVersion10));
+    TEST_ASSERT(nullptr != hookshot10);
+    Hookshot::IHookshot11* const hookshot11 = reinterpret_cast<Hookshot::IHookshot11*>(
+        HookshotInterface()->QueryInterface(Hookshot::kInterfaceVersion11));
+    TEST_ASSERT(nullptr != hookshot11);
+
+    GENERATE_AND_ASSIGN_FUNCTION(originalFunc);
     GENERATE_AND_ASSIGN_FUNCTION(hookFunc1);
+    GENERATE_AND_ASSIGN_FUNCTION(hookFunc2);
+
+    const auto originalFuncResult = originalFunc();
+    const auto hookFunc1Result = hookFunc1();
+    const auto hookFunc2Result = hookFunc2();
+
+    Hookshot::HookHandle hookHandle = Hookshot::kInvalidHookHandle;
     TEST_ASSERT(
-        Hookshot::SuccessfulResult(HookshotInterface()->CreateHook(originalFunc1, hookFunc1)));
+        Hookshot::EResult::FailNotFound == hookshot11->GetHookHandle(originalFunc, &hookHandle));
+    TEST_ASSERT(
+        Hookshot::EResult::FailNotFound ==
+        hookshot11->DisableHookFunctionByHandle(Hookshot::kInvalidHookHandle));
+
+    TEST_ASSERT(Hookshot::SuccessfulResult(
+        hookshot10->CreateHookEx(originalFunc, hookFunc1, nullptr, &hookHandle)));
+    TEST_ASSERT(hookFunc1Result == originalFunc());
+
+    TEST_ASSERT(Hookshot::EResult::Success == hookshot11->DisableHookFunctionByHandle(hookHandle));
+    TEST_ASSERT(originalFuncResult == originalFunc());
 
-    GENERATE_AND_ASSIGN_FUNCTION(originalFunc2);
-    GENERATE_AND_ASSIGN_FUNCTION(hookFunc2);
     TEST_ASSERT(
-        Hookshot::SuccessfulResult(HookshotInterface()->CreateHook(originalFunc2, hookFunc2)));
+        Hookshot::EResult::Success ==
+        hookshot11->ReplaceHookFunctionByHandle(hookHandle, hookFunc1));
+    TEST_ASSERT(hookFunc1Result == originalFunc());
 
     TEST_ASSERT(
-        Hookshot::EResult::FailDuplicate ==
-        HookshotInterface()->ReplaceHookFunction(originalFunc1, hookFunc2));
+        Hookshot::EResult::Success ==
+        hookshot11->ReplaceHookFunctionByHandle(hookHandle, hookFunc2));
+    TEST_ASSERT(hookFunc2Result == originalFunc());
     TEST_ASSERT(
-        Hookshot::EResult::FailDuplicate ==
-        HookshotInterface()->ReplaceHookFunction(hookFunc1, hookFunc2));
+        Hookshot::EResult::NoEffect ==
+        hookshot11->ReplaceHookFunctionByHandle(hookHandle, hookFunc2));
+
+    Hookshot::SHookStatistics statistics = {};
     TEST_ASSERT(
-        Hookshot::EResult::FailDuplicate ==
-        HookshotInterface()->ReplaceHookFunction(originalFunc2, hookFunc1));
+        Hookshot::EResult::FailNotFound ==
+        hookshot11->GetHookStatisticsByHandle(Hookshot::kInvalidHookHandle, &statistics));
+    TEST_ASSERT(Hookshot::SuccessfulResult(
+        hookshot11->GetHookStatisticsByHandle(hookHandle, &statistics)));
+
+    TEST_ASSERT(Hookshot::SuccessfulResult(HookshotInterface()->RemoveHook(originalFunc)));
     TEST_ASSERT(
-        Hookshot::EResult::FailDuplicate ==
-        HookshotInterface()->ReplaceHookFunction(hookFunc2, hookFunc1));
+        Hookshot::EResult::FailNotFound == hookshot11->DisableHookFunctionByHandle(hookHandle));
   }
 
-  // Attempts to replace a non-existent hook's hook function.
-  // Expected result is Hookshot rejects the hook as not found.
-  HOOKSHOT_CUSTOM_TEST(ReplaceHookNonExistent)
+#ifdef _WIN64
+  // Generates a function whose first instruction loads a value using a RIP-relative displacement
+  // from exactly 2 GB beyond the beginning of its code region, hooks it, and invokes both the hook
+  // and the original function. The trampoline is placed below the code region, so the transplanted
+  // load cannot reach the value with a displacement and must be rewritten to use an absolute
+  // address instead. Verifies that the original function still loads the correct value. Skipped
+  // if the memory beyond the code region is not available.
+  HOOKSHOT_CUSTOM_TEST(HookRipRelativeLoadOutOfReach)
   {
-    GENERATE_AND_ASSIGN_FUNCTION(funcA);
-    GENERATE_AND_ASSIGN_FUNCTION(funcB);
+    constexpr size_t kCodeRegionSizeBytes = 0x101000;
+    constexpr size_t kFunctionOffset = 0x100000;
+    constexpr size_t kDataOffset = 0x80000000;
+    constexpr int kDataValue = 0x5a5a1234;
+
+    uint8_t* const codeRegion = reinterpret_cast<uint8_t*>(VirtualAlloc(
+        nullptr, kCodeRegionSizeBytes, MEM_RESERVE | MEM_COMMIT, PAGE_EXECUTE_READWRITE));
+    TEST_ASSERT(nullptr != codeRegion);
+
+    int* const data = reinterpret_cast<int*>(VirtualAlloc(
+        &codeRegion[kDataOffset], sizeof(int), MEM_RESERVE | MEM_COMMIT, PAGE_READWRITE));
+    if (nullptr == data)
+    {
+      VirtualFree(codeRegion, 0, MEM_RELEASE);
+      return;
+    }
+    *data = kDataValue;
+
+    // mov eax, dword ptr [rip+disp32]
+    // ret
+    uint8_t* const originalFuncBytes = &codeRegion[kFunctionOffset];
+    const int32_t displacement = static_cast<int32_t>(kDataOffset - (kFunctionOffset + 6));
+    originalFuncBytes[0] = 0x8b;
+    originalFuncBytes[1] = 0x05;
+    memcpy(&originalFuncBytes[2], &displacement, sizeof(displacement));
+    originalFuncBytes[6] = 0xc3;
+    FlushInstructionCache(GetCurrentProcess(), originalFuncBytes, 7);
+
+    const TGeneratedTestFunction originalFunc =
+        reinterpret_cast<TGeneratedTestFunction>(originalFuncBytes);
+    GENERATE_AND_ASSIGN_FUNCTION(hookFunc);
+    TEST_ASSERT(kDataValue == originalFunc());
 
     TEST_ASSERT(
-        Hookshot::EResult::FailNotFound == HookshotInterface()->ReplaceHookFunction(funcA, funcA));
+        Hookshot::SuccessfulResult(HookshotInterface()->CreateHook(originalFunc, hookFunc)));
+    TEST_ASSERT(hookFunc() == originalFunc());
     TEST_ASSERT(
-        Hookshot::EResult::FailNotFound == HookshotInterface()->ReplaceHookFunction(funcA, funcB));
+        kDataValue ==
+        ((TGeneratedTestFunction)HookshotInterface()->GetOriginalFunction(originalFunc))());
+
+    TEST_ASSERT(Hookshot::SuccessfulResult(HookshotInterface()->RemoveHook(originalFunc)));
+    VirtualFree(data, 0, MEM_RELEASE);
+    VirtualFree(codeRegion, 0, MEM_RELEASE);
+  }
+
+  // Generates a function in the middle of a reservation so large that no trampoline can be placed
+  // within reach of a relative jump from it, hooks it, and invokes both the hook and the original
+  // function. Verifies that the function is redirected using an absolute jump to a trampoline
+  // placed out of reach, that the original function still behaves as it did, and that removing
+  // the hook restores every overwritten byte. Skipped if the address space cannot be reserved.
+  HOOKSHOT_CUSTOM_TEST(FarTrampolineHook)
+  {
+    constexpr size_t kReservationSizeBytes = 0x140000000;
+    constexpr size_t kFunctionOffset = 0xa0000000;
+    constexpr uint8_t kOriginalFuncBytes[] = {
+        0xb8, 0x78, 0x56, 0x34, 0x12, // mov eax, 0x12345678
+        0x05, 0x01, 0x00, 0x00, 0x00, // add eax, 1
+        0x05, 0x02, 0x00, 0x00, 0x00, // add eax, 2
+        0xc3                          // ret
+    };
+    constexpr int kOriginalFuncResult = 0x1234567b;
+
+    uint8_t* const reservation = reinterpret_cast<uint8_t*>(
+        VirtualAlloc(nullptr, kReservationSizeBytes, MEM_RESERVE, PAGE_NOACCESS));
+    if (nullptr == reservation) return;
+
+    uint8_t* const originalFuncBytes = reinterpret_cast<uint8_t*>(VirtualAlloc(
+        &reservation[kFunctionOffset],
+        sizeof(kOriginalFuncBytes),
+        MEM_COMMIT,
+        PAGE_EXECUTE_READWRITE));
+    TEST_ASSERT(nullptr != originalFuncBytes);
+    memcpy(originalFuncBytes, kOriginalFuncBytes, sizeof(kOriginalFuncBytes));
+    FlushInstructionCache(GetCurrentProcess(), originalFuncBytes, sizeof(kOriginalFuncBytes));
+
+    const TGeneratedTestFunction originalFunc =
+        reinterpret_cast<TGeneratedTestFunction>(originalFuncBytes);
+    GENERATE_AND_ASSIGN_FUNCTION(hookFunc);
+    TEST_ASSERT(kOriginalFuncResult == originalFunc());
+
     TEST_ASSERT(
-        Hookshot::EResult::FailNotFound == HookshotInterface()->ReplaceHookFunction(funcB, funcA));
+        Hookshot::SuccessfulResult(HookshotInterface()->CreateHook(originalFunc, hookFunc)));
     TEST_ASSERT(
-        Hookshot::EResult::FailNotFound == HookshotInterface()->ReplaceHookFunction(funcB, funcB));
+        0 ==
+        memcmp(
+            originalFuncBytes,
+            Hookshot::X86Instruction::kAbsoluteJumpInstructionPreamble,
+            sizeof(Hookshot::X86Instruction::kAbsoluteJumpInstructionPreamble)));
+
+    const void* const trampolineOriginalFunc =
+        HookshotInterface()->GetOriginalFunction(originalFunc);
+    TEST_ASSERT(nullptr != trampolineOriginalFunc);
+    TEST_ASSERT(
+        false ==
+        Hookshot::X86Instruction::CanWriteJumpInstruction(originalFunc, trampolineOriginalFunc));
+
+    TEST_ASSERT(hookFunc() == originalFunc());
+    TEST_ASSERT(kOriginalFuncResult == ((TGeneratedTestFunction)trampolineOriginalFunc)());
+
+    TEST_ASSERT(Hookshot::SuccessfulResult(HookshotInterface()->RemoveHook(originalFunc)));
+    TEST_ASSERT(0 == memcmp(originalFuncBytes, kOriginalFuncBytes, sizeof(kOriginalFuncBytes)));
+    TEST_ASSERT(kOriginalFuncResult == originalFunc());
+
+    VirtualFree(reservation, 0, MEM_RELEASE);
   }
 
-  // Attempts to replace a valid hook's hook function with another valid hook function.
-  // Verifies that Hookshot performs this operation both successfully and correctly.
-  HOOKSHOT_CUSTOM_TEST(ReplaceHookValid)
+  // Lays out a minimal module whose only executable section holds a function followed by a run of
+  // `int 3` padding, in the middle of a reservation so large that no trampoline can be placed
+  // within reach of a relative jump from it, and then hooks the function. Verifies that the
+  // function is redirected using a relative jump to an absolute jump placed in the padding, that
+  // both the hook and the original function behave as they should, and that removing the hook
+  // restores every overwritten byte. Skipped if the address space cannot be laid out this way.
+  HOOKSHOT_CUSTOM_TEST(CodeCaveHook)
   {
-    GENERATE_AND_ASSIGN_FUNCTION(originalFunc);
-    GENERATE_AND_ASSIGN_FUNCTION(hookFunc);
-    GENERATE_AND_ASSIGN_FUNCTION(replacementHookFunc);
+    constexpr size_t kReservationSizeBytes = 0x140000000;
+    constexpr size_t kModuleOffset = 0xa0000000;
+    constexpr size_t kModuleSizeBytes = 0x10000;
+    constexpr DWORD kSectionRva = 0x1000;
+    constexpr DWORD kSectionSizeBytes = 0x1000;
+    constexpr size_t kPaddingSizeBytes = 3 * Hookshot::CodeCaves::kCaveSizeBytes;
+    constexpr uint8_t kOriginalFuncBytes[] = {
+        0xb8, 0x78, 0x56, 0x34, 0x12, // mov eax, 0x12345678
+        0x05, 0x01, 0x00, 0x00, 0x00, // add eax, 1
+        0x05, 0x02, 0x00, 0x00, 0x00, // add eax, 2
+        0xc3                          // ret
+    };
+    constexpr int kOriginalFuncResult = 0x1234567b;
+
+    // The address space is reserved all at once to find a place for it, and then released and
+    // reserved again in pieces, so that the module is surrounded by reserved address space.
+    uint8_t* const reservation = reinterpret_cast<uint8_t*>(
+        VirtualAlloc(nullptr, kReservationSizeBytes, MEM_RESERVE, PAGE_NOACCESS));
+    if (nullptr == reservation) return;
+    VirtualFree(reservation, 0, MEM_RELEASE);
+
+    void* const lowerReservation =
+        VirtualAlloc(reservation, kModuleOffset, MEM_RESERVE, PAGE_NOACCESS);
+    uint8_t* const moduleBase = reinterpret_cast<uint8_t*>(VirtualAlloc(
+        &reservation[kModuleOffset],
+        kModuleSizeBytes,
+        MEM_RESERVE | MEM_COMMIT,
+        PAGE_EXECUTE_READWRITE));
+    void* const upperReservation = VirtualAlloc(
+        &reservation[kModuleOffset + kModuleSizeBytes],
+        kReservationSizeBytes - (kModuleOffset + kModuleSizeBytes),
+        MEM_RESERVE,
+        PAGE_NOACCESS);
+
+    if ((nullptr == lowerReservation) || (nullptr == moduleBase) || (nullptr == upperReservation))
+    {
+      if (nullptr != lowerReservation) VirtualFree(lowerReservation, 0, MEM_RELEASE);
+      if (nullptr != moduleBase) VirtualFree(moduleBase, 0, MEM_RELEASE);
+      if (nullptr != upperReservation) VirtualFree(upperReservation, 0, MEM_RELEASE);
+      return;
+    }
 
-    const auto originalFuncResult = originalFunc();
-    const auto hookFuncResult = hookFunc();
-    const auto replacementHookFuncResult = replacementHookFunc();
+    // Headers are just complete enough to describe the executable section. Everything else in the
+    // section is zero, so the padding after the function is the only place a code cave can be.
+    IMAGE_DOS_HEADER* const dosHeader = reinterpret_cast<IMAGE_DOS_HEADER*>(moduleBase);
+    dosHeader->e_magic = IMAGE_DOS_SIGNATURE;
+    dosHeader->e_lfanew = sizeof(IMAGE_DOS_HEADER);
+
+    IMAGE_NT_HEADERS* const ntHeaders =
+        reinterpret_cast<IMAGE_NT_HEADERS*>(&moduleBase[dosHeader->e_lfanew]);
+    ntHeaders->Signature = IMAGE_NT_SIGNATURE;
+    ntHeaders->FileHeader.Machine = IMAGE_FILE_MACHINE_AMD64;
+    ntHeaders->FileHeader.NumberOfSections = 1;
+    // Identifies this module as different from any laid out at the same address by an earlier run.
+    ntHeaders->FileHeader.TimeDateStamp = static_cast<DWORD>(GetTickCount());
+    ntHeaders->FileHeader.SizeOfOptionalHeader = sizeof(IMAGE_OPTIONAL_HEADER);
+    ntHeaders->OptionalHeader.Magic = IMAGE_NT_OPTIONAL_HDR_MAGIC;
+    ntHeaders->OptionalHeader.SizeOfImage = static_cast<DWORD>(kModuleSizeBytes);
+
+    IMAGE_SECTION_HEADER* const sectionHeader = IMAGE_FIRST_SECTION(ntHeaders);
+    sectionHeader->VirtualAddress = kSectionRva;
+    sectionHeader->Misc.VirtualSize = kSectionSizeBytes;
+    sectionHeader->Characteristics =
+        (IMAGE_SCN_CNT_CODE | IMAGE_SCN_MEM_EXECUTE | IMAGE_SCN_MEM_READ);
+
+    uint8_t* const originalFuncBytes = &moduleBase[kSectionRva];
+    uint8_t* const paddingBytes = &originalFuncBytes[sizeof(kOriginalFuncBytes)];
+    memcpy(originalFuncBytes, kOriginalFuncBytes, sizeof(kOriginalFuncBytes));
+    memset(paddingBytes, 0xcc, kPaddingSizeBytes);
+    FlushInstructionCache(GetCurrentProcess(), originalFuncBytes, kSectionSizeBytes);
+
+    const TGeneratedTestFunction originalFunc =
+        reinterpret_cast<TGeneratedTestFunction>(originalFuncBytes);
+    GENERATE_AND_ASSIGN_FUNCTION(hookFunc);
+    TEST_ASSERT(kOriginalFuncResult == originalFunc());
 
     TEST_ASSERT(
         Hookshot::SuccessfulResult(HookshotInterface()->CreateHook(originalFunc, hookFunc)));
-    TEST_ASSERT(hookFuncResult == originalFunc());
+    TEST_ASSERT(0xe9 == originalFuncBytes[0]);
+
+    int32_t jumpDisplacement = 0;
+    memcpy(&jumpDisplacement, &originalFuncBytes[1], sizeof(jumpDisplacement));
+    const uint8_t* const codeCave = &originalFuncBytes[
+        static_cast<ptrdiff_t>(Hookshot::X86Instruction::kJumpInstructionLengthBytes) +
+        static_cast<ptrdiff_t>(jumpDisplacement)];
+    TEST_ASSERT(codeCave >= paddingBytes);
     TEST_ASSERT(
-        originalFuncResult ==
-        ((decltype(originalFunc))HookshotInterface()->GetOriginalFunction(originalFunc))());
-    TEST_ASSERT(nullptr != HookshotInterface()->GetOriginalFunction(hookFunc));
+        (codeCave + Hookshot::CodeCaves::kCaveSizeBytes) <= (paddingBytes + kPaddingSizeBytes));
+    TEST_ASSERT(
+        0 ==
+        memcmp(
+            codeCave,
+            Hookshot::X86Instruction::kAbsoluteJumpInstructionPreamble,
+            sizeof(Hookshot::X86Instruction::kAbsoluteJumpInstructionPreamble)));
+
+    const void* const trampolineOriginalFunc =
+        HookshotInterface()->GetOriginalFunction(originalFunc);
+    TEST_ASSERT(nullptr != trampolineOriginalFunc);
+    TEST_ASSERT(
+        false ==
+        Hookshot::X86Instruction::CanWriteJumpInstruction(originalFunc, trampolineOriginalFunc));
+
+    TEST_ASSERT(hookFunc() == originalFunc());
+    TEST_ASSERT(kOriginalFuncResult == ((TGeneratedTestFunction)trampolineOriginalFunc)());
+
+    TEST_ASSERT(Hookshot::SuccessfulResult(HookshotInterface()->RemoveHook(originalFunc)));
+    TEST_ASSERT(0 == memcmp(originalFuncBytes, kOriginalFuncBytes, sizeof(kOriginalFuncBytes)));
+    TEST_ASSERT(kOriginalFuncResult == originalFunc());
+
+    VirtualFree(upperReservation, 0, MEM_RELEASE);
+    VirtualFree(moduleBase, 0, MEM_RELEASE);
+    VirtualFree(lowerReservation, 0, MEM_RELEASE);
+  }
+
+  // Generates functions in a code region surrounded by reservations so large that exactly one
+  // trampoline store can be placed within reach of them, hooks them until that store is full, and
+  // then removes a few of those hooks and hooks another function. Verifies that the space given
+  // back by the removed hooks is reused for the new hook, rather than a new trampoline store being
+  // placed. The functions are too short to be hooked using an absolute jump to a trampoline placed
+  // out of reach. Skipped if the address space cannot be laid out this way.
+  HOOKSHOT_CUSTOM_TEST(ReuseFreedTrampolineSlot)
+  {
+    constexpr size_t kReservationSizeBytes = 0x140000000;
+    constexpr size_t kStoreSizeBytes = 0x10000;
+    constexpr size_t kCodeRegionOffset = 0xa0000000;
+    constexpr size_t kStoreGapOffset = kCodeRegionOffset - kStoreSizeBytes;
+    constexpr size_t kCodeRegionSizeBytes = 0x10000;
+    constexpr size_t kFunctionStrideBytes = 16;
+    constexpr size_t kNumFunctions = kCodeRegionSizeBytes / kFunctionStrideBytes;
+    constexpr size_t kNumHooksRemoved = 8;
+
+    Hookshot::IHookshot8* const hookshot8 = reinterpret_cast<Hookshot::IHookshot8*>(
+        HookshotInterface()->QueryInterface(Hookshot::kInterfaceVersion8));
+    TEST_ASSERT(nullptr != hookshot8);
+
+    // The address space is reserved all at once to find a place for it, and then released and
+    // reserved again in pieces, leaving a gap just large enough for a single trampoline store.
+    uint8_t* const reservation = reinterpret_cast<uint8_t*>(
+        VirtualAlloc(nullptr, kReservationSizeBytes, MEM_RESERVE, PAGE_NOACCESS));
+    if (nullptr == reservation) return;
+    VirtualFree(reservation, 0, MEM_RELEASE);
+
+    void* const lowerReservation =
+        VirtualAlloc(reservation, kStoreGapOffset, MEM_RESERVE, PAGE_NOACCESS);
+    uint8_t* const codeRegion = reinterpret_cast<uint8_t*>(VirtualAlloc(
+        &reservation[kCodeRegionOffset],
+        kCodeRegionSizeBytes,
+        MEM_RESERVE | MEM_COMMIT,
+        PAGE_EXECUTE_READWRITE));
+    void* const upperReservation = VirtualAlloc(
+        &reservation[kCodeRegionOffset + kCodeRegionSizeBytes],
+        kReservationSizeBytes - (kCodeRegionOffset + kCodeRegionSizeBytes),
+        MEM_RESERVE,
+        PAGE_NOACCESS);
+    uint8_t* const hookRegion = reinterpret_cast<uint8_t*>(VirtualAlloc(
+        nullptr, kCodeRegionSizeBytes, MEM_RESERVE | MEM_COMMIT, PAGE_EXECUTE_READWRITE));
+
+    if ((nullptr == lowerReservation) || (nullptr == codeRegion) ||
+        (nullptr == upperReservation) || (nullptr == hookRegion))
+    {
+      if (nullptr != lowerReservation) VirtualFree(lowerReservation, 0, MEM_RELEASE);
+      if (nullptr != codeRegion) VirtualFree(codeRegion, 0, MEM_RELEASE);
+      if (nullptr != upperReservation) VirtualFree(upperReservation, 0, MEM_RELEASE);
+      if (nullptr != hookRegion) VirtualFree(hookRegion, 0, MEM_RELEASE);
+      return;
+    }
+
+    // mov eax, imm32
+    // ret
+    // int 3 (padding)
+    auto writeFunction = [](uint8_t* funcBytes, int32_t result) -> TGeneratedTestFunction
+    {
+      memset(funcBytes, 0xcc, kFunctionStrideBytes);
+      funcBytes[0] = 0xb8;
+      memcpy(&funcBytes[1], &result, sizeof(result));
+      funcBytes[5] = 0xc3;
+      return reinterpret_cast<TGeneratedTestFunction>(funcBytes);
+    };
+
+    std::vector<TGeneratedTestFunction> originalFuncs(kNumFunctions);
+    std::vector<TGeneratedTestFunction> hookFuncs(kNumFunctions);
+    for (size_t i = 0; i < kNumFunctions; ++i)
+    {
+      originalFuncs[i] =
+          writeFunction(&codeRegion[i * kFunctionStrideBytes], static_cast<int32_t>(i));
+      hookFuncs[i] = writeFunction(&hookRegion[i * kFunctionStrideBytes], ~static_cast<int32_t>(i));
+    }
+    FlushInstructionCache(GetCurrentProcess(), codeRegion, kCodeRegionSizeBytes);
+    FlushInstructionCache(GetCurrentProcess(), hookRegion, kCodeRegionSizeBytes);
+
+    size_t numHooked = 0;
+    while ((numHooked < kNumFunctions) &&
+           (true ==
+            Hookshot::SuccessfulResult(HookshotInterface()->CreateHook(
+                originalFuncs[numHooked], hookFuncs[numHooked]))))
+      numHooked += 1;
+
+    TEST_ASSERT(numHooked > kNumHooksRemoved);
+    TEST_ASSERT(numHooked < kNumFunctions);
+
+    const size_t storeBaseAddress =
+        reinterpret_cast<size_t>(HookshotInterface()->GetOriginalFunction(originalFuncs[0])) &
+        ~(kStoreSizeBytes - 1);
+    TEST_ASSERT(reinterpret_cast<size_t>(&reservation[kStoreGapOffset]) == storeBaseAddress);
+
+    Hookshot::SMemoryFootprint footprintWhenFull = {};
+    TEST_ASSERT(
+        Hookshot::EResult::Success == HookshotInterface()->GetMemoryFootprint(&footprintWhenFull));
+
+    for (size_t i = 0; i < kNumHooksRemoved; ++i)
+      TEST_ASSERT(Hookshot::SuccessfulResult(HookshotInterface()->RemoveHook(originalFuncs[i])));
 
     TEST_ASSERT(Hookshot::SuccessfulResult(
-        HookshotInterface()->ReplaceHookFunction(hookFunc, replacementHookFunc)));
-    TEST_ASSERT(replacementHookFuncResult == originalFunc());
+        HookshotInterface()->CreateHook(originalFuncs[numHooked], hookFuncs[numHooked])));
+    TEST_ASSERT(hookFuncs[numHooked]() == originalFuncs[numHooked]());
+
+    const void* const reusedOriginalFunc =
+        HookshotInterface()->GetOriginalFunction(originalFuncs[numHooked]);
     TEST_ASSERT(
-        originalFuncResult ==
-        ((decltype(originalFunc))HookshotInterface()->GetOriginalFunction(originalFunc))());
-    TEST_ASSERT(nullptr == HookshotInterface()->GetOriginalFunction(hookFunc));
-    TEST_ASSERT(nullptr != HookshotInterface()->GetOriginalFunction(replacementHookFunc));
+        storeBaseAddress ==
+        (reinterpret_cast<size_t>(reusedOriginalFunc) & ~(kStoreSizeBytes - 1)));
+    TEST_ASSERT(
+        static_cast<int>(numHooked) == ((TGeneratedTestFunction)reusedOriginalFunc)());
+
+    Hookshot::SMemoryFootprint footprintAfterReuse = {};
+    TEST_ASSERT(
+        Hookshot::EResult::Success ==
+        HookshotInterface()->GetMemoryFootprint(&footprintAfterReuse));
+    TEST_ASSERT(footprintWhenFull.numTrampolineStores == footprintAfterReuse.numTrampolineStores);
+
+    TEST_ASSERT(
+        Hookshot::EResult::Success ==
+        hookshot8->InvalidateCodeRange(codeRegion, kCodeRegionSizeBytes));
+    VirtualFree(hookRegion, 0, MEM_RELEASE);
+    VirtualFree(upperReservation, 0, MEM_RELEASE);
+    VirtualFree(codeRegion, 0, MEM_RELEASE);
+    VirtualFree(lowerReservation, 0, MEM_RELEASE);
   }
 
-  // Attempts to replace a valid hook's hook function with another valid hook function.
-  // Expected result is success, even though the operation should have no effect.
-  HOOKSHOT_CUSTOM_TEST(ReplaceHookWithSelf)
+  // Hooks a system call stub exported by ntdll, then invokes it. Verifies that the original
+  // functionality is reached through a complete copy of the stub rather than through transplanted
+  // instructions followed by a jump back to the rest of it.
+  // Signature of NtYieldExecution, which is a harmless system call with no parameters.
+  using TNtYieldExecution = LONG(NTAPI*)(void);
+
+  // Number of times the hook function has been invoked.
+  static volatile LONG numNtYieldExecutionHookCalls = 0;
+
+  // Hook version of NtYieldExecution. Counts the invocation and invokes the original function.
+  static LONG NTAPI HookNtYieldExecution(void)
   {
-    GENERATE_AND_ASSIGN_FUNCTION(originalFunc);
-    GENERATE_AND_ASSIGN_FUNCTION(hookFunc);
+    InterlockedIncrement(&numNtYieldExecutionHookCalls);
+    return ((TNtYieldExecution)HookshotInterface()->GetOriginalFunction(&HookNtYieldExecution))();
+  }
 
-    const auto originalFuncResult = originalFunc();
-    const auto hookFuncResult = hookFunc();
+  // Main test case logic.
+  HOOKSHOT_CUSTOM_TEST(SyscallStubHook)
+  {
+    constexpr uint8_t kSyscallStubBeginning[] = {0x4c, 0x8b, 0xd1, 0xb8};
+    constexpr size_t kNumSyscallStubBytesCompared = 11;
+    constexpr LONG kStatusNoYieldPerformed = 0x40000024;
+
+    const TNtYieldExecution ntYieldExecution = reinterpret_cast<TNtYieldExecution>(
+        GetProcAddress(GetModuleHandle(L"ntdll.dll"), "NtYieldExecution"));
+    TEST_ASSERT(nullptr != ntYieldExecution);
+
+    // Something else, such as security software, might already have modified the stub.
+    uint8_t unhookedBytes[kNumSyscallStubBytesCompared] = {};
+    memcpy(unhookedBytes, reinterpret_cast<const void*>(ntYieldExecution), sizeof(unhookedBytes));
+    if (0 != memcmp(unhookedBytes, kSyscallStubBeginning, sizeof(kSyscallStubBeginning))) return;
+
+    TEST_ASSERT(Hookshot::SuccessfulResult(HookshotInterface()->CreateHook(
+        reinterpret_cast<void*>(ntYieldExecution), &HookNtYieldExecution)));
 
+    const void* const trampolineOriginalFunc =
+        HookshotInterface()->GetOriginalFunction(&HookNtYieldExecution);
+    TEST_ASSERT(nullptr != trampolineOriginalFunc);
+    TEST_ASSERT(0 == memcmp(unhookedBytes, trampolineOriginalFunc, sizeof(unhookedBytes)));
+
+    const LONG numHookCallsBefore = numNtYieldExecutionHookCalls;
+    const LONG result = ntYieldExecution();
+    TEST_ASSERT((0 == result) || (kStatusNoYieldPerformed == result));
+    TEST_ASSERT((numHookCallsBefore + 1) == numNtYieldExecutionHookCalls);
+
+    TEST_ASSERT(Hookshot::SuccessfulResult(
+        HookshotInterface()->RemoveHook(reinterpret_cast<void*>(ntYieldExecution))));
+  }
+#endif
+
+  // Creates hooks inside a transaction while another thread repeatedly invokes one of the original
+  // functions. Verifies that hooks only take effect once the transaction is committed and that the
+  // other thread only ever observes either the original or the hook behavior.
+  // Information structure to pass to the other thread.
+  struct STransactionTestData
+  {
+    volatile LONG stopFlag;
+
+    TGeneratedTestFunction func;
+    int originalFuncResult;
+    int hookFuncResult;
+  };
+
+  // Executed by the other thread. Returns the number of invocations that produced a wrong result.
+  DWORD WINAPI TransactionTestThreadProc(LPVOID lpParameter)
+  {
+    STransactionTestData& testData = *reinterpret_cast<STransactionTestData*>(lpParameter);
+    DWORD numFailures = 0;
+
+    while (0 == InterlockedCompareExchange(&testData.stopFlag, 0, 0))
+    {
+      const int result = testData.func();
+      if ((testData.originalFuncResult != result) && (testData.hookFuncResult != result))
+        numFailures += 1;
+    }
+
+    return numFailures;
+  }
+
+  // Main test case logic.
+  HOOKSHOT_CUSTOM_TEST(Transaction)
+  {
+    GENERATE_AND_ASSIGN_FUNCTION(originalFuncA);
+    GENERATE_AND_ASSIGN_FUNCTION(hookFuncA);
+    GENERATE_AND_ASSIGN_FUNCTION(originalFuncB);
+    GENERATE_AND_ASSIGN_FUNCTION(hookFuncB);
+
+    const auto originalFuncAResult = originalFuncA();
+    const auto originalFuncBResult = originalFuncB();
+    const auto hookFuncAResult = hookFuncA();
+    const auto hookFuncBResult = hookFuncB();
+
+    STransactionTestData testData = {
+        .stopFlag = 0,
+        .func = originalFuncA,
+        .originalFuncResult = originalFuncAResult,
+        .hookFuncResult = hookFuncAResult};
+
+    HANDLE threadHandle =
+        CreateThread(nullptr, 0, TransactionTestThreadProc, &testData, 0, nullptr);
+    TEST_ASSERT(nullptr != threadHandle);
+
+    TEST_ASSERT(Hookshot::EResult::FailBadState == HookshotInterface()->CommitTransaction());
+    TEST_ASSERT(Hookshot::SuccessfulResult(HookshotInterface()->BeginTransaction()));
+    TEST_ASSERT(Hookshot::EResult::FailBadState == HookshotInterface()->BeginTransaction());
+
+    const Hookshot::SHookSpec hookSpec = {.originalFunc = originalFuncB, .hookFunc = hookFuncB};
     TEST_ASSERT(
-        Hookshot::SuccessfulResult(HookshotInterface()->CreateHook(originalFunc, hookFunc)));
-    TEST_ASSERT(hookFuncResult == originalFunc());
+        Hookshot::SuccessfulResult(HookshotInterface()->CreateHook(originalFuncA, hookFuncA)));
     TEST_ASSERT(
-        originalFuncResult ==
-        ((decltype(originalFunc))HookshotInterface()->GetOriginalFunction(originalFunc))());
-    TEST_ASSERT(nullptr != HookshotInterface()->GetOriginalFunction(hookFunc));
+        Hookshot::SuccessfulResult(HookshotInterface()->CreateHooks(&hookSpec, 1, nullptr)));
+    TEST_ASSERT(
+        Hookshot::EResult::FailDuplicate ==
+        HookshotInterface()->CreateHook(originalFuncA, hookFuncB));
 
-    TEST_ASSERT(Hookshot::SuccessfulResult(
-        HookshotInterface()->ReplaceHookFunction(originalFunc, hookFunc)));
+    TEST_ASSERT(originalFuncAResult == originalFuncA());
+    TEST_ASSERT(originalFuncBResult == originalFuncB());
     TEST_ASSERT(
-        Hookshot::SuccessfulResult(HookshotInterface()->ReplaceHookFunction(hookFunc, hookFunc)));
-    TEST_ASSERT(hookFuncResult == originalFunc());
+        originalFuncAResult ==
+        ((decltype(originalFuncA))HookshotInterface()->GetOriginalFunction(hookFuncA))());
+
+    TEST_ASSERT(Hookshot::SuccessfulResult(HookshotInterface()->CommitTransaction()));
+    TEST_ASSERT(Hookshot::EResult::FailBadState == HookshotInterface()->CommitTransaction());
+
+    InterlockedExchange(&testData.stopFlag, 1);
+    TEST_ASSERT(WAIT_OBJECT_0 == WaitForSingleObject(threadHandle, 10000));
+
+    DWORD numFailures = 0;
+    TEST_ASSERT(0 != GetExitCodeThread(threadHandle, &numFailures));
+    TEST_ASSERT(0 == numFailures);
+    CloseHandle(threadHandle);
+
+    TEST_ASSERT(hookFuncAResult == originalFuncA());
+    TEST_ASSERT(hookFuncBResult == originalFuncB());
     TEST_ASSERT(
-        originalFuncResult ==
-        ((decltype(originalFunc))HookshotInterface()->GetOriginalFunction(originalFunc))());
-    TEST_ASSERT(nullptr != HookshotInterface()->GetOriginalFunction(hookFunc));
+        originalFuncBResult ==
+        ((decltype(originalFuncB))HookshotInterface()->GetOriginalFunction(originalFuncB))());
   }
 
   // Hookshot is presented with a valid original function but a hook function whose address is
@@ -694,4 +3370,213 @@ namespace HookshotTest
         originalFuncResult ==
         ((decltype(originalFunc))HookshotInterface()->GetOriginalFunction(originalFunc))());
   }
+
+  // Determines whether the fast path recognizes the instruction at the specified address and, if
+  // so, whether the layout it determines is exactly the layout the decoder determines.
+  // Returns `false` if the fast path recognizes the instruction but the layouts differ.
+  static bool CommonInstructionLayoutMatchesDecoder(
+      const uint8_t* instructionBytes, bool* isRecognized)
+  {
+    Hookshot::X86Instruction::SInstructionLayout layout = {};
+    *isRecognized = Hookshot::X86Instruction::ClassifyCommonInstruction(instructionBytes, &layout);
+    if (false == *isRecognized) return true;
+
+    Hookshot::X86Instruction instruction;
+    if (false == instruction.DecodeInstruction(instructionBytes)) return false;
+
+    const int displacementWidthBytes = instruction.GetMemoryDisplacementWidthBits() / 8;
+    if ((layout.lengthBytes != instruction.GetLengthBytes()) ||
+        (layout.displacementWidthBytes != displacementWidthBytes) ||
+        (layout.isRelativeBranch != instruction.HasRelativeBranchDisplacement()) ||
+        (layout.isTerminal != instruction.IsTerminal()))
+      return false;
+
+    return (
+        (0 == displacementWidthBytes) ||
+        (layout.displacementOffsetBytes == instruction.GetMemoryDisplacementOffsetBytes()));
+  }
+
+  // Compares the layouts that the fast path determines without decoding with those that the
+  // decoder determines, first for a table of instructions drawn from the one-byte, 0F, 0F38, and
+  // 0F3A opcode maps, with and without prefixes and in VEX and EVEX encodings, and then for every
+  // opcode in each of those maps combined with several prefixes and ModRM forms. Verifies that
+  // every instruction the fast path recognizes has exactly the layout the decoder determines, that
+  // the table instructions expected to be recognized are, and that nothing outside the one-byte
+  // and 0F maps or with an unsupported prefix is recognized.
+  HOOKSHOT_CUSTOM_TEST(X86InstructionClassification)
+  {
+#ifdef _WIN64
+    constexpr bool kIsCommonWithRex = true;
+#else
+    // REX prefixes do not exist in 32-bit mode, where those bytes are instructions of their own.
+    constexpr bool kIsCommonWithRex = false;
+#endif
+
+    struct SInstructionTestCase
+    {
+      uint8_t bytes[Hookshot::X86Instruction::kMaxInstructionLengthBytes];
+      bool isCommon;
+    };
+
+    const SInstructionTestCase kInstructionTestCases[] = {
+        // One-byte opcode map
+        {{0x55}, true},                                                // push rbp
+        {{0x89, 0xe5}, true},                                          // mov ebp, esp
+        {{0x48, 0x89, 0xe5}, kIsCommonWithRex},                        // mov rbp, rsp
+        {{0x48, 0x83, 0xec, 0x28}, kIsCommonWithRex},                  // sub rsp, 0x28
+        {{0x48, 0x81, 0xec, 0x00, 0x01, 0x00, 0x00}, kIsCommonWithRex}, // sub rsp, 0x100
+        {{0x48, 0x89, 0x5c, 0x24, 0x08}, kIsCommonWithRex},            // mov [rsp+8], rbx
+        {{0x8b, 0x85, 0x78, 0x56, 0x34, 0x12}, true},                  // mov eax, [rbp+disp32]
+        {{0x8b, 0x04, 0x25, 0x78, 0x56, 0x34, 0x12}, true},            // mov eax, [disp32]
+        {{0x8b, 0x05, 0x78, 0x56, 0x34, 0x12}, true},                  // mov eax, [rip+disp32]
+        {{0x48, 0x8d, 0x0d, 0x78, 0x56, 0x34, 0x12}, kIsCommonWithRex}, // lea rcx, [rip+disp32]
+        {{0x8d, 0xc1}, false},                                         // lea with a register
+        {{0xc7, 0x44, 0x24, 0x08, 0x01, 0x00, 0x00, 0x00}, true},      // mov dword [rsp+8], 1
+        {{0xc7, 0xc8, 0x01, 0x00, 0x00, 0x00}, false},                 // c7 /1
+        {{0xc6, 0x05, 0x78, 0x56, 0x34, 0x12, 0x01}, true},            // mov byte [rip+disp32], 1
+        {{0x66, 0x89, 0x45, 0xf8}, true},                              // mov [rbp-8], ax
+        {{0x66, 0x81, 0xc1, 0x01, 0x00}, false},                       // add cx, 1
+        {{0x6a, 0x01}, true},                                          // push 1
+        {{0x68, 0x78, 0x56, 0x34, 0x12}, true},                        // push 0x12345678
+        {{0x74, 0x10}, true},                                          // je rel8
+        {{0xe8, 0x78, 0x56, 0x34, 0x12}, true},                        // call rel32
+        {{0x66, 0xe8, 0x34, 0x12}, false},                             // call rel16
+        {{0xe9, 0x78, 0x56, 0x34, 0x12}, true},                        // jmp rel32
+        {{0xeb, 0x10}, true},                                          // jmp rel8
+        {{0xc3}, true},                                                // ret
+        {{0xc2, 0x08, 0x00}, true},                                    // ret 8
+        {{0xff, 0x15, 0x78, 0x56, 0x34, 0x12}, true},                  // call [rip+disp32]
+        {{0xff, 0x25, 0x78, 0x56, 0x34, 0x12}, true},                  // jmp [rip+disp32]
+        {{0xff, 0x74, 0x24, 0x08}, true},                              // push [rsp+8]
+        {{0xff, 0xc0}, false},                                         // inc eax
+        {{0x90}, true},                                                // nop
+        {{0xcc}, false},                                               // int 3
+
+        // 0F opcode map
+        {{0x0f, 0x1f, 0x44, 0x00, 0x00}, true},                        // nop [rax+rax+0]
+        {{0x66, 0x0f, 0x1f, 0x84, 0x00, 0x00, 0x00, 0x00, 0x00}, true}, // nop [rax+rax+0]
+        {{0x0f, 0x84, 0x78, 0x56, 0x34, 0x12}, true},                  // je rel32
+        {{0x0f, 0xb6, 0xc0}, true},                                    // movzx eax, al
+        {{0x48, 0x0f, 0xbf, 0x05, 0x78, 0x56, 0x34, 0x12}, kIsCommonWithRex}, // movsx rax, [rip]
+        {{0x0f, 0x29, 0x74, 0x24, 0x20}, true},                        // movaps [rsp+0x20], xmm6
+        {{0x66, 0x0f, 0x28, 0x05, 0x78, 0x56, 0x34, 0x12}, true},      // movapd xmm0, [rip]
+        {{0x0f, 0x05}, false},                                         // syscall
+        {{0x0f, 0xa2}, false},                                         // cpuid
+
+        // 0F38 opcode map
+        {{0x66, 0x0f, 0x38, 0x00, 0xc1}, false},                       // pshufb xmm0, xmm1
+        {{0x0f, 0x38, 0xf0, 0x05, 0x78, 0x56, 0x34, 0x12}, false},     // movbe eax, [rip]
+
+        // 0F3A opcode map
+        {{0x66, 0x0f, 0x3a, 0x0f, 0xc1, 0x08}, false},                 // palignr xmm0, xmm1, 8
+        {{0x66, 0x0f, 0x3a, 0x16, 0x05, 0x78, 0x56, 0x34, 0x12, 0x01}, false}, // pextrd [rip]
+
+        // Prefixes other than a single operand size override or REX prefix
+        {{0xf3, 0x0f, 0x1e, 0xfa}, false},                             // endbr64
+        {{0xf2, 0x0f, 0x10, 0x05, 0x78, 0x56, 0x34, 0x12}, false},     // movsd xmm0, [rip]
+        {{0x2e, 0x0f, 0x1f, 0x84, 0x00, 0x00, 0x00, 0x00, 0x00}, false}, // cs nop
+        {{0xf0, 0x0f, 0xb1, 0x0a}, false},                             // lock cmpxchg [rdx], ecx
+        {{0x65, 0x8b, 0x04, 0x25, 0x30, 0x00, 0x00, 0x00}, false},     // mov eax, gs:[0x30]
+        {{0x67, 0x8b, 0x00}, false},                                   // mov eax, [eax]
+        {{0x66, 0x66, 0x0f, 0x1f, 0x84, 0x00, 0x00, 0x00, 0x00, 0x00}, false}, // nop
+        {{0xf3, 0xc3}, false},                                         // rep ret
+
+        // VEX encodings
+        {{0xc5, 0xf8, 0x77}, false},                                   // vzeroupper
+        {{0xc5, 0xfc, 0x28, 0x05, 0x78, 0x56, 0x34, 0x12}, false},     // vmovaps ymm0, [rip]
+        {{0xc4, 0xe2, 0x7d, 0x18, 0x05, 0x78, 0x56, 0x34, 0x12}, false}, // vbroadcastss ymm0
+        {{0xc4, 0xe3, 0x7d, 0x18, 0xc1, 0x01}, false},                 // vinsertf128 ymm0
+
+        // EVEX encodings
+        {{0x62, 0xf1, 0x7c, 0x48, 0x28, 0x05, 0x78, 0x56, 0x34, 0x12}, false}, // vmovaps zmm0
+        {{0x62, 0xf2, 0x7d, 0x48, 0x18, 0x05, 0x78, 0x56, 0x34, 0x12}, false}, // vbroadcastss
+        {{0x62, 0xf3, 0x7d, 0x48, 0x19, 0xc1, 0x01}, false},           // vextractf32x4 xmm1
+    };
+
+    for (const SInstructionTestCase& testCase : kInstructionTestCases)
+    {
+      bool isRecognized = false;
+      TEST_ASSERT(true == CommonInstructionLayoutMatchesDecoder(testCase.bytes, &isRecognized));
+      TEST_ASSERT(testCase.isCommon == isRecognized);
+    }
+
+    // Every opcode is swept with every combination of the following. Bytes that are not part of an
+    // instruction's prefixes, opcode, or ModRM form are arbitrary but fixed.
+    struct SByteSequence
+    {
+      uint8_t lengthBytes;
+      uint8_t bytes[4];
+      bool canBeCommon;
+    };
+
+    const SByteSequence kPrefixes[] = {
+        {0, {}, true},
+        {1, {0x66}, true},
+        {1, {0x48}, true},
+        {1, {0x41}, true},
+        {2, {0x66, 0x48}, true},
+        {1, {0xf2}, false},
+        {1, {0xf3}, false},
+        {1, {0x2e}, false},
+        {1, {0x64}, false},
+        {1, {0x67}, false},
+    };
+
+    const SByteSequence kOpcodeMaps[] = {
+        {0, {}, true},
+        {1, {0x0f}, true},
+        {2, {0x0f, 0x38}, false},
+        {2, {0x0f, 0x3a}, false},
+        {2, {0xc5, 0xf8}, false},
+        {3, {0xc4, 0xe2, 0x7d}, false},
+        {3, {0xc4, 0xe3, 0x7d}, false},
+        {4, {0x62, 0xf1, 0x7c, 0x48}, false},
+        {4, {0x62, 0xf2, 0x7d, 0x48}, false},
+    };
+
+    const SByteSequence kModrmForms[] = {
+        {1, {0xc1}, true},                   // register
+        {1, {0xf8}, true},                   // register, reg field 7
+        {1, {0x05}, true},                   // [rip+disp32], or [disp32] in 32-bit mode
+        {1, {0x3d}, true},                   // [rip+disp32], reg field 7
+        {2, {0x04, 0x24}, true},             // [rsp]
+        {2, {0x04, 0x25}, true},             // [disp32] through a SIB byte
+        {3, {0x44, 0x24, 0x08}, true},       // [rsp+disp8]
+        {2, {0x45, 0xf8}, true},             // [rbp+disp8]
+        {3, {0x84, 0x24, 0x80}, true},       // [rsp+disp32]
+        {1, {0x10}, true},                   // [rax], reg field 2
+        {1, {0x30}, true},                   // [rax], reg field 6
+    };
+
+    constexpr uint8_t kFillerByte = 0x11;
+
+    for (const SByteSequence& prefix : kPrefixes)
+    {
+      for (const SByteSequence& opcodeMap : kOpcodeMaps)
+      {
+        for (int opcode = 0; opcode <= 0xff; ++opcode)
+        {
+          for (const SByteSequence& modrmForm : kModrmForms)
+          {
+            uint8_t instructionBytes[Hookshot::X86Instruction::kMaxInstructionLengthBytes];
+            memset(instructionBytes, kFillerByte, sizeof(instructionBytes));
+
+            uint8_t position = 0;
+            memcpy(&instructionBytes[position], prefix.bytes, prefix.lengthBytes);
+            position += prefix.lengthBytes;
+            memcpy(&instructionBytes[position], opcodeMap.bytes, opcodeMap.lengthBytes);
+            position += opcodeMap.lengthBytes;
+            instructionBytes[position++] = static_cast<uint8_t>(opcode);
+            memcpy(&instructionBytes[position], modrmForm.bytes, modrmForm.lengthBytes);
+
+            bool isRecognized = false;
+            TEST_ASSERT(
+                true == CommonInstructionLayoutMatchesDecoder(instructionBytes, &isRecognized));
+            if ((false == prefix.canBeCommon) || (false == opcodeMap.canBeCommon))
+              TEST_ASSERT(false == isRecognized);
+          }
+        }
+      }
+    }
+  }
 } // namespace HookshotTest
@@ -18,6 +18,7 @@ namespace HookshotTest
 
   HOOKSHOT_HOOK_SET_SUCCESS_TEST(BasicFunction);
   HOOKSHOT_HOOK_SET_SUCCESS_TEST(CallSubroutine);
+  HOOKSHOT_HOOK_SET_SUCCESS_TEST(HotPatchFunction);
   HOOKSHOT_HOOK_SET_SUCCESS_TEST(JumpAbsolutePositionRelative);
   HOOKSHOT_HOOK_SET_SUCCESS_TEST_CONDITIONAL(
       JumpAbsolutePositionRelativeRexW, CpuInfo::Is64BitLongModeEnabled());
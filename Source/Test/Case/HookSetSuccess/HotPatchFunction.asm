@@ -0,0 +1,50 @@
+;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;
+; Hookshot
+;   General-purpose library for injecting DLLs and hooking function calls.
+;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;
+; Authored by Samuel Grossman
+; Copyright (c) 2019-2025
+;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;
+
+INCLUDE TestDefinitions.inc
+
+
+; Tests a function laid out for hot-patching, meaning it begins with a 2-byte instruction that does
+; nothing and is preceded by 5 bytes of padding. In 32-bit mode, Hookshot should write its jump into
+; the padding and overwrite only the first instruction with a short jump to it, leaving the rest of
+; the original function untouched. In 64-bit mode this layout is not used for hot-patching, so the
+; original function is hooked by transplanting its instructions as usual. The hook function comes
+; first so that the padding can be placed at its end, directly in front of the original function.
+
+
+_TEXT                                       SEGMENT
+
+
+BEGIN_HOOKSHOT_TEST_FUNCTION                HotPatchFunction_Hook
+    mov sax, scx
+    shl sax, 1
+    ret
+
+    REPEAT 5
+        int 3
+    ENDM
+END_HOOKSHOT_TEST_FUNCTION                  HotPatchFunction_Hook
+
+
+BEGIN_HOOKSHOT_TEST_FUNCTION                HotPatchFunction_Original
+IFDEF _WIN64
+    ; xchg ax, ax
+    BYTE 066h, 090h
+ELSE
+    ; mov edi, edi
+    BYTE 08bh, 0ffh
+ENDIF
+    mov sax, scx
+    ret
+END_HOOKSHOT_TEST_FUNCTION                  HotPatchFunction_Original
+
+
+_TEXT                                       ENDS
+
+
+END
@@ -0,0 +1,403 @@
+/***************************************************************************************************
+ * Hookshot
+ *   General-purpose library for injecting DLLs and hooking function calls.
+ ***************************************************************************************************
+ * Authored by Samuel Grossman
+ * Copyright (c) 2019-2025
+ ***********************************************************************************************//**
+ * @file ParallelRunner.cpp
+ *   Implementation of functionality for running test cases in parallel across worker processes.
+ **************************************************************************************************/
+
+#include "ParallelRunner.h"
+
+#include <windows.h>
+
+#include <algorithm>
+#include <cstdint>
+#include <cstdio>
+#include <string>
+#include <string_view>
+#include <vector>
+
+namespace HookshotTest
+{
+  namespace ParallelRunner
+  {
+    /// Exit code recorded for a unit of work whose worker process could not be started.
+    static constexpr DWORD kExitCodeWorkerNotStarted = static_cast<DWORD>(-1);
+
+    /// Describes one unit of work, which is a single run of a worker process.
+    struct SWorkItem
+    {
+      /// Prefix passed to the worker process, which selects the test cases it runs.
+      std::wstring_view prefix;
+
+      /// Repetition to which this unit of work belongs, counting from 0.
+      unsigned int repetition;
+
+      /// Handle of the worker process. Valid only while it is running.
+      HANDLE processHandle;
+
+      /// Handle of the temporary file that captures the output of the worker process. Valid from
+      /// when the worker process is started until its output is printed.
+      HANDLE outputFileHandle;
+
+      /// Time at which the worker process was started, in milliseconds.
+      ULONGLONG startTimeMilliseconds;
+
+      /// Amount of time the worker process took to run, in milliseconds.
+      ULONGLONG durationMilliseconds;
+
+      /// Exit code of the worker process, which is non-zero if any of its test cases failed.
+      DWORD exitCode;
+
+      /// Whether or not the worker process has finished running or could not be started.
+      bool isComplete;
+    };
+
+    /// Retrieves the names of all registered test cases. Implemented as a function-local static
+    /// object so that it is constructed before any of the registrars that fill it.
+    /// @return Mutable reference to the registered test case names.
+    static std::vector<std::wstring_view>& RegisteredTestCaseNames(void)
+    {
+      static std::vector<std::wstring_view> testCaseNames;
+      return testCaseNames;
+    }
+
+    /// Determines the prefixes to pass to worker processes so that every registered test case that
+    /// matches the specified prefix runs exactly once. The test harness runs every test case whose
+    /// name begins with the prefix it is given, so any test case whose name begins with the name of
+    /// another one is covered by the worker process that runs the other one.
+    /// @param [in] prefix Prefix that test case names must match to be run.
+    /// @return Prefixes to pass to worker processes, one per worker process, in sorted order.
+    static std::vector<std::wstring_view> SelectWorkerPrefixes(std::wstring_view prefix)
+    {
+      std::vector<std::wstring_view> matchingNames;
+      for (const std::wstring_view testCaseName : RegisteredTestCaseNames())
+      {
+        if (true == testCaseName.starts_with(prefix)) matchingNames.push_back(testCaseName);
+      }
+
+      // After sorting, every name that begins with another name immediately follows it or another
+      // name that also begins with it.
+      std::sort(matchingNames.begin(), matchingNames.end());
+      matchingNames.erase(
+          std::unique(matchingNames.begin(), matchingNames.end()), matchingNames.end());
+
+      std::vector<std::wstring_view> workerPrefixes;
+      for (const std::wstring_view testCaseName : matchingNames)
+      {
+        if ((false == workerPrefixes.empty()) &&
+            (true == testCaseName.starts_with(workerPrefixes.back())))
+          continue;
+
+        workerPrefixes.push_back(testCaseName);
+      }
+
+      return workerPrefixes;
+    }
+
+    /// Starts a worker process for the specified unit of work, with its output redirected to a
+    /// temporary file that is deleted automatically once it is closed. Only the output file handle
+    /// is inherited, so that worker processes running concurrently do not keep each other's output
+    /// files open.
+    /// @param [in] executablePath Path of the test executable, which is run as the worker process.
+    /// @param [in,out] workItem Unit of work for which to start a worker process. Filled with the
+    /// process and output file handles on success.
+    /// @return `true` if the worker process was started, `false` otherwise.
+    static bool StartWorker(const std::wstring& executablePath, SWorkItem& workItem)
+    {
+      wchar_t tempDirectory[MAX_PATH] = L"";
+      wchar_t tempFileName[MAX_PATH] = L"";
+      if ((0 == GetTempPathW(_countof(tempDirectory), tempDirectory)) ||
+          (0 == GetTempFileNameW(tempDirectory, L"hst", 0, tempFileName)))
+        return false;
+
+      SECURITY_ATTRIBUTES inheritableSecurityAttributes = {
+          .nLength = sizeof(SECURITY_ATTRIBUTES),
+          .lpSecurityDescriptor = nullptr,
+          .bInheritHandle = TRUE};
+      const HANDLE outputFileHandle = CreateFileW(
+          tempFileName,
+          GENERIC_READ | GENERIC_WRITE,
+          FILE_SHARE_READ | FILE_SHARE_WRITE | FILE_SHARE_DELETE,
+          &inheritableSecurityAttributes,
+          CREATE_ALWAYS,
+          FILE_ATTRIBUTE_TEMPORARY | FILE_FLAG_DELETE_ON_CLOSE,
+          nullptr);
+      if (INVALID_HANDLE_VALUE == outputFileHandle)
+      {
+        DeleteFileW(tempFileName);
+        return false;
+      }
+
+      SIZE_T attributeListSizeBytes = 0;
+      InitializeProcThreadAttributeList(nullptr, 1, 0, &attributeListSizeBytes);
+      std::vector<uint8_t> attributeListBuffer(attributeListSizeBytes);
+      const LPPROC_THREAD_ATTRIBUTE_LIST attributeList =
+          reinterpret_cast<LPPROC_THREAD_ATTRIBUTE_LIST>(attributeListBuffer.data());
+
+      HANDLE inheritedHandles[] = {outputFileHandle};
+      if (FALSE == InitializeProcThreadAttributeList(attributeList, 1, 0, &attributeListSizeBytes))
+      {
+        CloseHandle(outputFileHandle);
+        return false;
+      }
+
+      bool workerStarted = false;
+      do
+      {
+        if (FALSE ==
+            UpdateProcThreadAttribute(
+                attributeList,
+                0,
+                PROC_THREAD_ATTRIBUTE_HANDLE_LIST,
+                inheritedHandles,
+                sizeof(inheritedHandles),
+                nullptr,
+                nullptr))
+          break;
+
+        STARTUPINFOEXW startupInfo = {};
+        startupInfo.StartupInfo.cb = sizeof(startupInfo);
+        startupInfo.StartupInfo.dwFlags = STARTF_USESTDHANDLES;
+        startupInfo.StartupInfo.hStdInput = nullptr;
+        startupInfo.StartupInfo.hStdOutput = outputFileHandle;
+        startupInfo.StartupInfo.hStdError = outputFileHandle;
+        startupInfo.lpAttributeList = attributeList;
+
+        std::wstring commandLine = L"\"" + executablePath + L"\" " + std::wstring(workItem.prefix);
+
+        PROCESS_INFORMATION processInfo = {};
+        workItem.startTimeMilliseconds = GetTickCount64();
+        if (FALSE ==
+            CreateProcessW(
+                executablePath.c_str(),
+                commandLine.data(),
+                nullptr,
+                nullptr,
+                TRUE,
+                EXTENDED_STARTUPINFO_PRESENT,
+                nullptr,
+                nullptr,
+                &startupInfo.StartupInfo,
+                &processInfo))
+          break;
+
+        CloseHandle(processInfo.hThread);
+        workItem.processHandle = processInfo.hProcess;
+        workItem.outputFileHandle = outputFileHandle;
+        workerStarted = true;
+      }
+      while (false);
+
+      DeleteProcThreadAttributeList(attributeList);
+      if (false == workerStarted) CloseHandle(outputFileHandle);
+
+      return workerStarted;
+    }
+
+    /// Prints the captured output and the result of a completed unit of work, and then closes its
+    /// output file, which deletes it.
+    /// @param [in,out] workItem Completed unit of work to print.
+    /// @param [in] numRepetitions Total number of repetitions, used to decide whether or not the
+    /// repetition is worth identifying.
+    static void PrintWorkItem(SWorkItem& workItem, unsigned int numRepetitions)
+    {
+      if (numRepetitions > 1)
+        wprintf(
+            L"\n===== %.*s (repetition %u) =====\n",
+            static_cast<int>(workItem.prefix.length()),
+            workItem.prefix.data(),
+            workItem.repetition + 1);
+      else
+        wprintf(
+            L"\n===== %.*s =====\n",
+            static_cast<int>(workItem.prefix.length()),
+            workItem.prefix.data());
+
+      if (nullptr != workItem.outputFileHandle)
+      {
+        // Worker output is copied byte-for-byte, so the standard output stream must be flushed
+        // first to keep it in order.
+        fflush(stdout);
+
+        const HANDLE standardOutputHandle = GetStdHandle(STD_OUTPUT_HANDLE);
+        const LARGE_INTEGER fileStart = {};
+        SetFilePointerEx(workItem.outputFileHandle, fileStart, nullptr, FILE_BEGIN);
+
+        uint8_t buffer[4096];
+        DWORD numBytesRead = 0;
+        while (
+            (FALSE !=
+             ReadFile(workItem.outputFileHandle, buffer, sizeof(buffer), &numBytesRead, nullptr)) &&
+            (0 != numBytesRead))
+        {
+          DWORD numBytesWritten = 0;
+          WriteFile(standardOutputHandle, buffer, numBytesRead, &numBytesWritten, nullptr);
+        }
+
+        CloseHandle(workItem.outputFileHandle);
+        workItem.outputFileHandle = nullptr;
+      }
+
+      if (kExitCodeWorkerNotStarted == workItem.exitCode)
+        wprintf(L"===== FAILED: worker process could not be started =====\n");
+      else if (0 != workItem.exitCode)
+        wprintf(
+            L"===== FAILED: exit code %d after %llu ms =====\n",
+            static_cast<int>(workItem.exitCode),
+            static_cast<unsigned long long>(workItem.durationMilliseconds));
+      else
+        wprintf(
+            L"===== PASSED after %llu ms =====\n",
+            static_cast<unsigned long long>(workItem.durationMilliseconds));
+    }
+
+    TestCaseNameRegistrar::TestCaseNameRegistrar(std::wstring_view testCaseName)
+    {
+      RegisteredTestCaseNames().push_back(testCaseName);
+    }
+
+    int RunTestsWithMatchingPrefix(
+        std::wstring_view prefix, unsigned int numWorkers, unsigned int numRepetitions)
+    {
+      const std::vector<std::wstring_view> workerPrefixes = SelectWorkerPrefixes(prefix);
+      if (true == workerPrefixes.empty())
+      {
+        wprintf(
+            L"No test cases match the prefix \"%.*s\".\n",
+            static_cast<int>(prefix.length()),
+            prefix.data());
+        return 1;
+      }
+
+      wchar_t executablePathBuffer[MAX_PATH] = L"";
+      const DWORD executablePathLength =
+          GetModuleFileNameW(nullptr, executablePathBuffer, _countof(executablePathBuffer));
+      if ((0 == executablePathLength) || (_countof(executablePathBuffer) == executablePathLength))
+      {
+        wprintf(L"Unable to determine the path of the test executable.\n");
+        return 1;
+      }
+      const std::wstring executablePath(executablePathBuffer, executablePathLength);
+
+      numWorkers = std::clamp(numWorkers, 1u, static_cast<unsigned int>(MAXIMUM_WAIT_OBJECTS));
+      numRepetitions = std::max(numRepetitions, 1u);
+
+      std::vector<SWorkItem> workItems;
+      workItems.reserve(workerPrefixes.size() * numRepetitions);
+      for (unsigned int repetition = 0; repetition < numRepetitions; ++repetition)
+      {
+        for (const std::wstring_view workerPrefix : workerPrefixes)
+          workItems.push_back(
+              {.prefix = workerPrefix,
+               .repetition = repetition,
+               .processHandle = nullptr,
+               .outputFileHandle = nullptr,
+               .startTimeMilliseconds = 0,
+               .durationMilliseconds = 0,
+               .exitCode = 0,
+               .isComplete = false});
+      }
+
+      wprintf(
+          L"Running %llu worker process(es) for %llu test case group(s), up to %u at a time.\n",
+          static_cast<unsigned long long>(workItems.size()),
+          static_cast<unsigned long long>(workerPrefixes.size()),
+          numWorkers);
+
+      const ULONGLONG startTimeMilliseconds = GetTickCount64();
+      std::vector<size_t> runningWorkItemIndices;
+      std::vector<HANDLE> runningProcessHandles;
+      std::vector<size_t> failedWorkItemIndices;
+      size_t nextWorkItemToStart = 0;
+      size_t nextWorkItemToPrint = 0;
+
+      while (nextWorkItemToPrint < workItems.size())
+      {
+        while ((runningWorkItemIndices.size() < numWorkers) &&
+               (nextWorkItemToStart < workItems.size()))
+        {
+          SWorkItem& workItem = workItems[nextWorkItemToStart];
+          if (true == StartWorker(executablePath, workItem))
+          {
+            runningWorkItemIndices.push_back(nextWorkItemToStart);
+            runningProcessHandles.push_back(workItem.processHandle);
+          }
+          else
+          {
+            workItem.exitCode = kExitCodeWorkerNotStarted;
+            workItem.isComplete = true;
+          }
+
+          nextWorkItemToStart += 1;
+        }
+
+        if (false == runningProcessHandles.empty())
+        {
+          const DWORD waitResult = WaitForMultipleObjects(
+              static_cast<DWORD>(runningProcessHandles.size()),
+              runningProcessHandles.data(),
+              FALSE,
+              INFINITE);
+          const size_t completedPosition = static_cast<size_t>(waitResult - WAIT_OBJECT_0);
+          if (completedPosition >= runningProcessHandles.size())
+          {
+            wprintf(L"Failed to wait for worker processes, error %u.\n", GetLastError());
+
+            for (const HANDLE processHandle : runningProcessHandles)
+            {
+              TerminateProcess(processHandle, kExitCodeWorkerNotStarted);
+              CloseHandle(processHandle);
+            }
+            return 1;
+          }
+
+          SWorkItem& workItem = workItems[runningWorkItemIndices[completedPosition]];
+          workItem.durationMilliseconds = GetTickCount64() - workItem.startTimeMilliseconds;
+          if (FALSE == GetExitCodeProcess(workItem.processHandle, &workItem.exitCode))
+            workItem.exitCode = kExitCodeWorkerNotStarted;
+          CloseHandle(workItem.processHandle);
+          workItem.processHandle = nullptr;
+          workItem.isComplete = true;
+
+          runningWorkItemIndices.erase(runningWorkItemIndices.begin() + completedPosition);
+          runningProcessHandles.erase(runningProcessHandles.begin() + completedPosition);
+        }
+
+        // Output is printed in the same order every time, regardless of the order in which worker
+        // processes finish, so that the results of different runs can be compared directly.
+        while ((nextWorkItemToPrint < workItems.size()) &&
+               (true == workItems[nextWorkItemToPrint].isComplete))
+        {
+          PrintWorkItem(workItems[nextWorkItemToPrint], numRepetitions);
+          if (0 != workItems[nextWorkItemToPrint].exitCode)
+            failedWorkItemIndices.push_back(nextWorkItemToPrint);
+
+          nextWorkItemToPrint += 1;
+        }
+      }
+
+      wprintf(
+          L"\nRan %llu worker process(es) in %llu ms: %llu passed, %llu failed.\n",
+          static_cast<unsigned long long>(workItems.size()),
+          static_cast<unsigned long long>(GetTickCount64() - startTimeMilliseconds),
+          static_cast<unsigned long long>(workItems.size() - failedWorkItemIndices.size()),
+          static_cast<unsigned long long>(failedWorkItemIndices.size()));
+
+      for (const size_t failedWorkItemIndex : failedWorkItemIndices)
+      {
+        const SWorkItem& workItem = workItems[failedWorkItemIndex];
+        wprintf(
+            L"    FAILED: %.*s (repetition %u)\n",
+            static_cast<int>(workItem.prefix.length()),
+            workItem.prefix.data(),
+            workItem.repetition + 1);
+      }
+
+      return static_cast<int>(failedWorkItemIndices.size());
+    }
+  } // namespace ParallelRunner
+} // namespace HookshotTest
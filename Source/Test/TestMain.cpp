@@ -9,9 +9,90 @@
  *   Entry point for the test executable.
  **************************************************************************************************/
 
+#include <windows.h>
+
+#include <cwchar>
+#include <string>
+#include <string_view>
+
 #include <Infra/Test/Harness.h>
 
+#include "ParallelRunner.h"
+
+/// Command-line option that runs test cases in parallel worker processes. May be followed by an
+/// equals sign and the maximum number of worker processes, which otherwise defaults to the number
+/// of processors.
+static constexpr std::wstring_view kOptionParallel = L"--parallel";
+
+/// Command-line option, followed by an equals sign and a count, that runs every test case the
+/// specified number of times, each time in a new worker process.
+static constexpr std::wstring_view kOptionRepeat = L"--repeat=";
+
+/// Parses the numeric value that follows a command-line option.
+/// @param [in] value Text of the value.
+/// @return Parsed value, or 0 if it is not a valid number.
+static unsigned int ParseOptionValue(std::wstring_view value)
+{
+  const std::wstring valueString(value);
+  wchar_t* valueEnd = nullptr;
+  const unsigned long parsedValue = wcstoul(valueString.c_str(), &valueEnd, 10);
+  return (((true == valueString.empty()) || (L'\0' != *valueEnd))
+              ? 0
+              : static_cast<unsigned int>(parsedValue));
+}
+
 int wmain(int argc, const wchar_t* argv[])
 {
-  return Infra::Test::Harness::RunTestsWithMatchingPrefix(((argc > 1) ? argv[1] : L""));
+  const wchar_t* prefix = L"";
+  bool runInWorkerProcesses = false;
+  unsigned int numWorkers =
+      static_cast<unsigned int>(GetActiveProcessorCount(ALL_PROCESSOR_GROUPS));
+  unsigned int numRepetitions = 1;
+
+  for (int i = 1; i < argc; ++i)
+  {
+    const std::wstring_view arg = argv[i];
+
+    if (kOptionParallel == arg)
+    {
+      runInWorkerProcesses = true;
+    }
+    else if (true == arg.starts_with(std::wstring(kOptionParallel) + L"="))
+    {
+      runInWorkerProcesses = true;
+      numWorkers = ParseOptionValue(arg.substr(kOptionParallel.length() + 1));
+      if (0 == numWorkers)
+      {
+        wprintf(L"Invalid number of worker processes: %s\n", argv[i]);
+        return 1;
+      }
+    }
+    else if (true == arg.starts_with(kOptionRepeat))
+    {
+      numRepetitions = ParseOptionValue(arg.substr(kOptionRepeat.length()));
+      if (0 == numRepetitions)
+      {
+        wprintf(L"Invalid number of repetitions: %s\n", argv[i]);
+        return 1;
+      }
+    }
+    else
+    {
+      prefix = argv[i];
+    }
+  }
+
+  // Repetitions always run in worker processes, since hooks cannot be removed within a process.
+  // Without the parallel option they run one at a time.
+  if (numRepetitions > 1)
+  {
+    if (false == runInWorkerProcesses) numWorkers = 1;
+    runInWorkerProcesses = true;
+  }
+
+  if (true == runInWorkerProcesses)
+    return HookshotTest::ParallelRunner::RunTestsWithMatchingPrefix(
+        prefix, numWorkers, numRepetitions);
+
+  return Infra::Test::Harness::RunTestsWithMatchingPrefix(prefix);
 }
@@ -0,0 +1,433 @@
+/***************************************************************************************************
+ * Hookshot
+ *   General-purpose library for injecting DLLs and hooking function calls.
+ ***************************************************************************************************
+ * Authored by Samuel Grossman
+ * Copyright (c) 2019-2025
+ ***********************************************************************************************//**
+ * @file TopMain.cpp
+ *   Entry point for the hook statistics viewer, which continuously displays the hook statistics
+ *   published by injected processes, much like `top` displays processes.
+ **************************************************************************************************/
+
+#include <algorithm>
+#include <conio.h>
+#include <cstdint>
+#include <cstdio>
+#include <cwchar>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include "ApiWindows.h"
+#include "Globals.h"
+#include "SharedStatistics.h"
+#include "SharedStatisticsReader.h"
+
+using namespace Hookshot;
+
+/// Enumerates the orders in which hooks can be listed.
+enum class ESortOrder
+{
+  /// Highest call rate first.
+  CallRate,
+
+  /// Highest sampled 99th percentile duration first.
+  Latency,
+
+  /// Grouped by top caller, with the most frequently called hooks first within each group.
+  Caller
+};
+
+/// State kept for each process whose hook statistics are being displayed.
+struct SWatchedProcess
+{
+  /// File name of the executable that the process is running.
+  std::wstring executableName;
+
+  /// Header at the beginning of a read-only view of the process's hook statistics section.
+  const SharedStatistics::SHeader* header;
+
+  /// Most recent snapshot of the section.
+  SharedStatisticsReader::SSnapshot snapshot;
+
+  /// Whether or not the most recent snapshot is valid.
+  bool snapshotIsValid;
+
+  /// Calls per second for each record in the most recent snapshot.
+  std::vector<uint64_t> callsPerSecond;
+};
+
+/// One line of the hook listing.
+struct SHookRow
+{
+  /// Identifier of the process that owns the hook.
+  uint32_t processId;
+
+  /// Record that describes the hook.
+  const SharedStatistics::SRecord* record;
+
+  /// Rate at which the hook is being called.
+  uint64_t callsPerSecond;
+
+  /// Estimated 99th percentile duration of the sampled calls, in microseconds, or 0 if unknown.
+  uint64_t latencyMicroseconds;
+};
+
+/// Number of console lines used by everything other than the hook listing.
+static constexpr unsigned int kNumFixedLines = 4;
+
+/// Interval, in milliseconds, at which the keyboard is checked while waiting for the next refresh.
+static constexpr DWORD kKeyboardPollIntervalMilliseconds = 50;
+
+/// Retrieves a short name for a sort order, suitable for display.
+/// @param [in] sortOrder Sort order of interest.
+/// @return Name of the sort order.
+static const wchar_t* SortOrderName(ESortOrder sortOrder)
+{
+  switch (sortOrder)
+  {
+    case ESortOrder::CallRate:
+      return L"call rate";
+    case ESortOrder::Latency:
+      return L"sampled latency";
+    case ESortOrder::Caller:
+      return L"top caller";
+    default:
+      return L"unknown";
+  }
+}
+
+/// Parses a sort order from a command-line argument or key press.
+/// @param [in] sortOrderChar First character of the argument, or the character typed.
+/// @param [out] sortOrder Filled with the parsed sort order, if successful.
+/// @return `true` if the character identifies a sort order, `false` otherwise.
+static bool ParseSortOrder(wchar_t sortOrderChar, ESortOrder* sortOrder)
+{
+  switch (towlower(sortOrderChar))
+  {
+    case L'r':
+      *sortOrder = ESortOrder::CallRate;
+      return true;
+    case L'l':
+      *sortOrder = ESortOrder::Latency;
+      return true;
+    case L'c':
+      *sortOrder = ESortOrder::Caller;
+      return true;
+    default:
+      return false;
+  }
+}
+
+/// Brings the set of watched processes up to date and takes a new snapshot of each one. Processes
+/// that have stopped publishing are dropped, and newly-publishing processes are added, limited to
+/// the requested processes if any were requested.
+/// @param [in] requestedProcessIds Processes requested on the command line, or empty to watch every
+/// publishing process.
+/// @param [in,out] watchedProcesses Watched processes, keyed by process identifier.
+static void RefreshWatchedProcesses(
+    const std::vector<uint32_t>& requestedProcessIds,
+    std::unordered_map<uint32_t, SWatchedProcess>& watchedProcesses)
+{
+  std::vector<SharedStatisticsReader::SPublishingProcess> publishingProcesses =
+      SharedStatisticsReader::EnumeratePublishingProcesses();
+
+  std::unordered_map<uint32_t, SWatchedProcess> refreshedProcesses;
+  for (auto& publishingProcess : publishingProcesses)
+  {
+    if ((false == requestedProcessIds.empty()) &&
+        (requestedProcessIds.end() ==
+         std::find(
+             requestedProcessIds.begin(), requestedProcessIds.end(), publishingProcess.processId)))
+      continue;
+
+    auto watchedIter = watchedProcesses.find(publishingProcess.processId);
+    if (watchedProcesses.end() == watchedIter)
+    {
+      const SharedStatistics::SHeader* const header =
+          SharedStatisticsReader::MapSection(publishingProcess.processId);
+      if (nullptr == header) continue;
+
+      watchedIter = watchedProcesses
+                        .emplace(
+                            publishingProcess.processId,
+                            SWatchedProcess{
+                                .executableName = std::move(publishingProcess.executableName),
+                                .header = header,
+                                .snapshot = {},
+                                .snapshotIsValid = false,
+                                .callsPerSecond = {}})
+                        .first;
+    }
+
+    refreshedProcesses.emplace(publishingProcess.processId, std::move(watchedIter->second));
+    watchedProcesses.erase(watchedIter);
+  }
+
+  // Anything left over is no longer publishing, most likely because it has exited.
+  for (const auto& stoppedProcess : watchedProcesses)
+    SharedStatisticsReader::UnmapSection(stoppedProcess.second.header);
+
+  watchedProcesses = std::move(refreshedProcesses);
+
+  for (auto& watchedProcess : watchedProcesses)
+  {
+    SWatchedProcess& process = watchedProcess.second;
+
+    SharedStatisticsReader::SSnapshot snapshot = {};
+    if (false == SharedStatisticsReader::ReadSnapshot(process.header, &snapshot))
+    {
+      process.snapshotIsValid = false;
+      continue;
+    }
+
+    process.callsPerSecond =
+        ((true == process.snapshotIsValid)
+             ? SharedStatisticsReader::ComputeCallsPerSecond(process.snapshot, snapshot)
+             : std::vector<uint64_t>(snapshot.records.size(), 0));
+    process.snapshot = std::move(snapshot);
+    process.snapshotIsValid = true;
+  }
+}
+
+/// Builds the hook listing from the most recent snapshots and sorts it.
+/// @param [in] watchedProcesses Watched processes, keyed by process identifier.
+/// @param [in] sortOrder Order in which to list the hooks.
+/// @return Sorted hook listing, which refers to records owned by the watched processes.
+static std::vector<SHookRow> BuildHookRows(
+    const std::unordered_map<uint32_t, SWatchedProcess>& watchedProcesses, ESortOrder sortOrder)
+{
+  std::vector<SHookRow> hookRows;
+
+  for (const auto& watchedProcess : watchedProcesses)
+  {
+    const SWatchedProcess& process = watchedProcess.second;
+    if (false == process.snapshotIsValid) continue;
+
+    for (size_t i = 0; i < process.snapshot.records.size(); ++i)
+    {
+      const SharedStatistics::SRecord& record = process.snapshot.records[i];
+      const bool latencyIsKnown = ((0 != (record.flags & SharedStatistics::kRecordFlagSampled)) &&
+                                   (0 != process.snapshot.ticksPerMicrosecond));
+
+      hookRows.push_back(
+          {.processId = watchedProcess.first,
+           .record = &record,
+           .callsPerSecond = process.callsPerSecond[i],
+           .latencyMicroseconds =
+               ((true == latencyIsKnown)
+                    ? (record.sampledLatencyTicks / process.snapshot.ticksPerMicrosecond)
+                    : 0)});
+    }
+  }
+
+  std::sort(
+      hookRows.begin(),
+      hookRows.end(),
+      [sortOrder](const SHookRow& a, const SHookRow& b) -> bool
+      {
+        switch (sortOrder)
+        {
+          case ESortOrder::Latency:
+            if (a.latencyMicroseconds != b.latencyMicroseconds)
+              return (a.latencyMicroseconds > b.latencyMicroseconds);
+            break;
+
+          case ESortOrder::Caller:
+            // Hooks without a recorded caller go last.
+            if (a.record->topCaller != b.record->topCaller)
+            {
+              if (0 == a.record->topCaller) return false;
+              if (0 == b.record->topCaller) return true;
+              return (a.record->topCaller < b.record->topCaller);
+            }
+            break;
+
+          default:
+            break;
+        }
+
+        if (a.callsPerSecond != b.callsPerSecond) return (a.callsPerSecond > b.callsPerSecond);
+        return (a.record->callCount > b.record->callCount);
+      });
+
+  return hookRows;
+}
+
+/// Redraws the entire console window with the current hook statistics.
+/// @param [in] watchedProcesses Watched processes, keyed by process identifier.
+/// @param [in] sortOrder Order in which to list the hooks.
+static void Render(
+    const std::unordered_map<uint32_t, SWatchedProcess>& watchedProcesses, ESortOrder sortOrder)
+{
+  unsigned int consoleHeight = 25;
+  CONSOLE_SCREEN_BUFFER_INFO screenBufferInfo = {};
+  if (0 != GetConsoleScreenBufferInfo(GetStdHandle(STD_OUTPUT_HANDLE), &screenBufferInfo))
+    consoleHeight =
+        static_cast<unsigned int>(screenBufferInfo.srWindow.Bottom - screenBufferInfo.srWindow.Top);
+
+  const std::vector<SHookRow> hookRows = BuildHookRows(watchedProcesses, sortOrder);
+
+  uint64_t totalHooks = 0;
+  uint64_t totalInstallFailures = 0;
+  uint64_t totalCallsPerSecond = 0;
+  for (const auto& watchedProcess : watchedProcesses)
+  {
+    totalHooks += watchedProcess.second.snapshot.numHooks;
+    totalInstallFailures += watchedProcess.second.snapshot.numInstallFailures;
+  }
+  for (const auto& hookRow : hookRows)
+    totalCallsPerSecond += hookRow.callsPerSecond;
+
+  // Move the cursor to the top left and clear the screen.
+  wprintf(L"\x1b[H\x1b[J");
+  wprintf(
+      L"HookshotTop - %u process(es), %llu hook(s), %llu failed install(s), %llu calls/s total\n",
+      static_cast<unsigned int>(watchedProcesses.size()),
+      static_cast<unsigned long long>(totalHooks),
+      static_cast<unsigned long long>(totalInstallFailures),
+      static_cast<unsigned long long>(totalCallsPerSecond));
+  wprintf(
+      L"Sorted by %s. Press R, L, or C to sort by call rate, latency, or caller. Press Q to quit.\n",
+      SortOrderName(sortOrder));
+  wprintf(
+      L"%7s  %-20s  %-18s  %-18s  %12s  %16s  %10s  %-18s\n",
+      L"PID",
+      L"Process",
+      L"Original",
+      L"Hook",
+      L"Calls/s",
+      L"Calls",
+      L"P99 (us)",
+      L"Top caller");
+
+  const size_t maxRows =
+      ((consoleHeight > kNumFixedLines) ? (consoleHeight - kNumFixedLines) : 1);
+  for (size_t i = 0; (i < hookRows.size()) && (i < maxRows); ++i)
+  {
+    const SHookRow& hookRow = hookRows[i];
+    const SharedStatistics::SRecord& record = *hookRow.record;
+
+    wchar_t callsPerSecondText[24] = L"-";
+    wchar_t callCountText[24] = L"-";
+    if (0 != (record.flags & SharedStatistics::kRecordFlagInstrumented))
+    {
+      swprintf_s(callsPerSecondText, L"%llu", (unsigned long long)hookRow.callsPerSecond);
+      swprintf_s(callCountText, L"%llu", (unsigned long long)record.callCount);
+    }
+
+    wchar_t latencyText[24] = L"-";
+    if ((0 != (record.flags & SharedStatistics::kRecordFlagSampled)) &&
+        (0 != record.numSampledCalls))
+      swprintf_s(latencyText, L"%llu", (unsigned long long)hookRow.latencyMicroseconds);
+
+    wchar_t topCallerText[40] = L"-";
+    if (0 != record.topCaller)
+      swprintf_s(
+          topCallerText,
+          L"0x%llx (%u)",
+          (unsigned long long)record.topCaller,
+          record.numTopCallerSamples);
+
+    wprintf(
+        L"%7u  %-20.20s  0x%016llx  0x%016llx  %12s  %16s  %10s  %-18s\n",
+        hookRow.processId,
+        watchedProcesses.at(hookRow.processId).executableName.c_str(),
+        (unsigned long long)record.originalFunc,
+        (unsigned long long)record.hookFunc,
+        callsPerSecondText,
+        callCountText,
+        latencyText,
+        topCallerText);
+  }
+
+  fflush(stdout);
+}
+
+/// Displays usage information.
+static void PrintUsage(void)
+{
+  wprintf(
+      L"Usage: HookshotTop [-r | -l | -c] [<process ID>...]\n\n"
+      L"Continuously displays the hook statistics published by injected processes in the current\n"
+      L"session, which must have PublishHookStatistics enabled. Only reads the shared memory that\n"
+      L"those processes publish, so it neither injects nor otherwise affects them.\n\n"
+      L"  -r  Sort hooks by call rate (default).\n"
+      L"  -l  Sort hooks by sampled 99th percentile latency.\n"
+      L"  -c  Group hooks by the caller that most often appears among their recorded callers.\n\n"
+      L"If process IDs are specified, only those processes are displayed.\n");
+}
+
+int wmain(int argc, wchar_t* argv[])
+{
+  Hookshot::Globals::Initialize(Hookshot::Globals::ELoadMethod::Executed);
+
+  ESortOrder sortOrder = ESortOrder::CallRate;
+  std::vector<uint32_t> requestedProcessIds;
+
+  for (int argIndex = 1; argIndex < argc; ++argIndex)
+  {
+    const wchar_t* const arg = argv[argIndex];
+
+    if (((L'-' == arg[0]) || (L'/' == arg[0])) && (L'\0' != arg[1]) && (L'\0' == arg[2]) &&
+        (true == ParseSortOrder(arg[1], &sortOrder)))
+      continue;
+
+    wchar_t* parseEnd;
+    const unsigned long processId = wcstoul(arg, &parseEnd, 10);
+    if ((L'\0' != *parseEnd) || (arg == parseEnd))
+    {
+      PrintUsage();
+      return __LINE__;
+    }
+
+    requestedProcessIds.push_back(static_cast<uint32_t>(processId));
+  }
+
+  // Escape sequences are used to redraw the screen in place. If they cannot be enabled, output is
+  // still readable, just without being cleared in between refreshes.
+  const HANDLE consoleOutput = GetStdHandle(STD_OUTPUT_HANDLE);
+  DWORD consoleMode = 0;
+  if (0 != GetConsoleMode(consoleOutput, &consoleMode))
+    SetConsoleMode(consoleOutput, consoleMode | ENABLE_VIRTUAL_TERMINAL_PROCESSING);
+
+  std::unordered_map<uint32_t, SWatchedProcess> watchedProcesses;
+  bool quitRequested = false;
+
+  while (false == quitRequested)
+  {
+    RefreshWatchedProcesses(requestedProcessIds, watchedProcesses);
+    Render(watchedProcesses, sortOrder);
+
+    // Publishing processes refresh their sections at a fixed interval, so refreshing the display
+    // any more often would only show the same values again.
+    for (DWORD waited = 0; waited < SharedStatistics::kPublishIntervalMilliseconds;
+         waited += kKeyboardPollIntervalMilliseconds)
+    {
+      if (0 != _kbhit())
+      {
+        const wchar_t key = static_cast<wchar_t>(_getwch());
+        if ((L'q' == towlower(key)) || (L'\x1b' == key))
+        {
+          quitRequested = true;
+          break;
+        }
+
+        if (true == ParseSortOrder(key, &sortOrder))
+        {
+          Render(watchedProcesses, sortOrder);
+          continue;
+        }
+      }
+
+      Sleep(kKeyboardPollIntervalMilliseconds);
+    }
+  }
+
+  for (const auto& watchedProcess : watchedProcesses)
+    SharedStatisticsReader::UnmapSection(watchedProcess.second.header);
+
+  wprintf(L"\n");
+  return 0;
+}
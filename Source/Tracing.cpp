@@ -0,0 +1,290 @@
+/***************************************************************************************************
+ * Hookshot
+ *   General-purpose library for injecting DLLs and hooking function calls.
+ ***************************************************************************************************
+ * Authored by Samuel Grossman
+ * Copyright (c) 2019-2025
+ ***********************************************************************************************//**
+ * @file Tracing.cpp
+ *   Implementation of emitting structured events using Event Tracing for Windows.
+ **************************************************************************************************/
+
+#include "Tracing.h"
+
+#include <TraceLoggingProvider.h>
+#include <winmeta.h>
+
+#include <cstddef>
+#include <cstdint>
+#include <string_view>
+
+#include <Infra/Core/Message.h>
+
+#include "ApiWindows.h"
+#include "HookshotTypes.h"
+#include "InjectResult.h"
+
+namespace Hookshot
+{
+  namespace Tracing
+  {
+    // Provider identifier is derived from the provider name using the standard hashing algorithm,
+    // so tools that accept a provider name instead of an identifier can be used with "Hookshot".
+    // {c3ac04da-acf2-5208-10fa-9081402607d6}
+    TRACELOGGING_DEFINE_PROVIDER(
+        hookshotTraceLoggingProvider,
+        "Hookshot",
+        (0xc3ac04da, 0xacf2, 0x5208, 0x10, 0xfa, 0x90, 0x81, 0x40, 0x26, 0x07, 0xd6));
+
+    /// Keyword for events related to creating hooks.
+    static constexpr uint64_t kKeywordHooks = 0x0000000000000001ull;
+
+    /// Keyword for events related to injecting processes.
+    static constexpr uint64_t kKeywordInjection = 0x0000000000000002ull;
+
+    /// Keyword for events related to loading hook modules.
+    static constexpr uint64_t kKeywordHookModules = 0x0000000000000004ull;
+
+    /// Registers the provider when constructed and unregisters it when destroyed. Writing events
+    /// using an unregistered provider has no effect, so nothing is lost if registration fails.
+    class ProviderRegistration
+    {
+    public:
+
+      ProviderRegistration(void)
+      {
+        TraceLoggingRegister(hookshotTraceLoggingProvider);
+      }
+
+      ProviderRegistration(const ProviderRegistration&) = delete;
+
+      ~ProviderRegistration(void)
+      {
+        TraceLoggingUnregister(hookshotTraceLoggingProvider);
+      }
+    };
+
+    /// Retrieves the provider handle to use for writing events, registering the provider the
+    /// first time it is needed. When no trace session is listening, writing an event costs about
+    /// as much as checking a flag.
+    /// @return Provider handle.
+    static TraceLoggingHProvider Provider(void)
+    {
+      static ProviderRegistration providerRegistration;
+      return hookshotTraceLoggingProvider;
+    }
+
+    /// Produces a human-readable name for the specified injection phase.
+    /// @param [in] phase Injection phase.
+    /// @return Name of the injection phase.
+    static const wchar_t* InjectPhaseName(EInjectPhase phase)
+    {
+      switch (phase)
+      {
+        case EInjectPhase::Authorize:
+          return L"Authorize";
+        case EInjectPhase::VerifyArchitecture:
+          return L"VerifyArchitecture";
+        case EInjectPhase::Advance:
+          return L"Advance";
+        case EInjectPhase::LocateProcessEnvironmentBlock:
+          return L"LocateProcessEnvironmentBlock";
+        case EInjectPhase::LocateEntryPoint:
+          return L"LocateEntryPoint";
+        case EInjectPhase::Allocate:
+          return L"Allocate";
+        case EInjectPhase::SetInjectedCode:
+          return L"SetInjectedCode";
+        case EInjectPhase::RunInjectedCode:
+          return L"RunInjectedCode";
+        case EInjectPhase::Cleanup:
+          return L"Cleanup";
+        default:
+          return L"(unknown)";
+      }
+    }
+
+    void CreateHookStart(const void* originalFunc, const void* hookFunc)
+    {
+      TraceLoggingWrite(
+          Provider(),
+          "CreateHook",
+          TraceLoggingOpcode(WINEVENT_OPCODE_START),
+          TraceLoggingLevel(WINEVENT_LEVEL_VERBOSE),
+          TraceLoggingKeyword(kKeywordHooks),
+          TraceLoggingPointer(originalFunc, "OriginalFunction"),
+          TraceLoggingPointer(hookFunc, "HookFunction"));
+    }
+
+    void CreateHookStop(const void* originalFunc, const void* hookFunc, EResult result)
+    {
+      TraceLoggingWrite(
+          Provider(),
+          "CreateHook",
+          TraceLoggingOpcode(WINEVENT_OPCODE_STOP),
+          TraceLoggingLevel(WINEVENT_LEVEL_VERBOSE),
+          TraceLoggingKeyword(kKeywordHooks),
+          TraceLoggingPointer(originalFunc, "OriginalFunction"),
+          TraceLoggingPointer(hookFunc, "HookFunction"),
+          TraceLoggingInt32(static_cast<int32_t>(result), "Result"));
+    }
+
+    void CreateHooksStart(size_t numHookSpecs)
+    {
+      TraceLoggingWrite(
+          Provider(),
+          "CreateHooks",
+          TraceLoggingOpcode(WINEVENT_OPCODE_START),
+          TraceLoggingLevel(WINEVENT_LEVEL_INFO),
+          TraceLoggingKeyword(kKeywordHooks),
+          TraceLoggingUInt64(static_cast<uint64_t>(numHookSpecs), "NumHookSpecs"));
+    }
+
+    void CreateHooksStop(size_t numHookSpecs, EResult result)
+    {
+      TraceLoggingWrite(
+          Provider(),
+          "CreateHooks",
+          TraceLoggingOpcode(WINEVENT_OPCODE_STOP),
+          TraceLoggingLevel(WINEVENT_LEVEL_INFO),
+          TraceLoggingKeyword(kKeywordHooks),
+          TraceLoggingUInt64(static_cast<uint64_t>(numHookSpecs), "NumHookSpecs"),
+          TraceLoggingInt32(static_cast<int32_t>(result), "Result"));
+    }
+
+    void InjectProcessPhase(
+        DWORD processId, EInjectPhase phase, long long durationMicroseconds, EInjectResult result)
+    {
+      TraceLoggingWrite(
+          Provider(),
+          "InjectProcessPhase",
+          TraceLoggingLevel(WINEVENT_LEVEL_INFO),
+          TraceLoggingKeyword(kKeywordInjection),
+          TraceLoggingUInt32(processId, "ProcessId"),
+          TraceLoggingWideString(InjectPhaseName(phase), "Phase"),
+          TraceLoggingInt64(durationMicroseconds, "DurationMicroseconds"),
+          TraceLoggingCountedWideString(
+              InjectResultString(result).data(),
+              static_cast<USHORT>(InjectResultString(result).length()),
+              "Result"));
+    }
+
+    void OutputInjectPhaseDurations(
+        Infra::Message::ESeverity severity,
+        DWORD processId,
+        const SInjectPhaseDurations& phaseDurations)
+    {
+      static_assert(9 == kNumInjectPhases, "Message format must list every injection phase.");
+      if (false == Infra::Message::WillOutputMessageOfSeverity(severity)) return;
+
+      auto duration = [&phaseDurations](EInjectPhase phase) -> long long
+      {
+        return static_cast<long long>(phaseDurations.microseconds[static_cast<size_t>(phase)]);
+      };
+
+      Infra::Message::OutputFormatted(
+          severity,
+          L"Injection phase durations for process %u: authorize %lld us, verify architecture %lld us, advance %lld us, locate PEB %lld us, locate entry point %lld us, allocate %lld us, set code %lld us, run %lld us, cleanup %lld us.",
+          static_cast<unsigned int>(processId),
+          duration(EInjectPhase::Authorize),
+          duration(EInjectPhase::VerifyArchitecture),
+          duration(EInjectPhase::Advance),
+          duration(EInjectPhase::LocateProcessEnvironmentBlock),
+          duration(EInjectPhase::LocateEntryPoint),
+          duration(EInjectPhase::Allocate),
+          duration(EInjectPhase::SetInjectedCode),
+          duration(EInjectPhase::RunInjectedCode),
+          duration(EInjectPhase::Cleanup));
+    }
+
+    void StartupProfile(const SStartupPhaseDurations& phaseDurations)
+    {
+      static_assert(5 == kNumStartupPhases, "Event must list every startup phase.");
+
+      auto duration = [&phaseDurations](EStartupPhase phase) -> int64_t
+      {
+        return phaseDurations.microseconds[static_cast<size_t>(phase)];
+      };
+
+      TraceLoggingWrite(
+          Provider(),
+          "StartupProfile",
+          TraceLoggingLevel(WINEVENT_LEVEL_INFO),
+          TraceLoggingKeyword(kKeywordInjection),
+          TraceLoggingInt64(duration(EStartupPhase::ReadConfiguration), "ReadConfiguration"),
+          TraceLoggingInt64(duration(EStartupPhase::InitializeGlobals), "InitializeGlobals"),
+          TraceLoggingInt64(duration(EStartupPhase::SetInternalHooks), "SetInternalHooks"),
+          TraceLoggingInt64(duration(EStartupPhase::StartPublishing), "StartPublishing"),
+          TraceLoggingInt64(duration(EStartupPhase::LoadHookModules), "LoadHookModules"),
+          TraceLoggingInt64(phaseDurations.totalMicroseconds, "TotalMicroseconds"));
+    }
+
+    void OutputStartupPhaseDurations(
+        Infra::Message::ESeverity severity, const SStartupPhaseDurations& phaseDurations)
+    {
+      static_assert(5 == kNumStartupPhases, "Message format must list every startup phase.");
+
+      auto duration = [&phaseDurations](EStartupPhase phase) -> long long
+      {
+        return static_cast<long long>(phaseDurations.microseconds[static_cast<size_t>(phase)]);
+      };
+
+      Infra::Message::OutputFormatted(
+          severity,
+          L"Startup phase durations: read configuration %lld us, initialize globals %lld us, set internal hooks %lld us, start publishing %lld us, load hook modules %lld us, total %lld us.",
+          duration(EStartupPhase::ReadConfiguration),
+          duration(EStartupPhase::InitializeGlobals),
+          duration(EStartupPhase::SetInternalHooks),
+          duration(EStartupPhase::StartPublishing),
+          duration(EStartupPhase::LoadHookModules),
+          static_cast<long long>(phaseDurations.totalMicroseconds));
+    }
+
+    void HookModuleLoad(
+        std::wstring_view hookModuleFileName, long long durationMicroseconds, bool succeeded)
+    {
+      TraceLoggingWrite(
+          Provider(),
+          "HookModuleLoad",
+          TraceLoggingLevel(WINEVENT_LEVEL_INFO),
+          TraceLoggingKeyword(kKeywordHookModules),
+          TraceLoggingCountedWideString(
+              hookModuleFileName.data(),
+              static_cast<USHORT>(hookModuleFileName.length()),
+              "FileName"),
+          TraceLoggingInt64(durationMicroseconds, "DurationMicroseconds"),
+          TraceLoggingBool(succeeded, "Succeeded"));
+    }
+
+    void HookModuleInitialize(std::wstring_view hookModuleFileName, long long durationMicroseconds)
+    {
+      TraceLoggingWrite(
+          Provider(),
+          "HookModuleInitialize",
+          TraceLoggingLevel(WINEVENT_LEVEL_INFO),
+          TraceLoggingKeyword(kKeywordHookModules),
+          TraceLoggingCountedWideString(
+              hookModuleFileName.data(),
+              static_cast<USHORT>(hookModuleFileName.length()),
+              "FileName"),
+          TraceLoggingInt64(durationMicroseconds, "DurationMicroseconds"));
+    }
+
+    void HookLatencyBudgetExceeded(
+        const void* originalFunc,
+        const void* hookFunc,
+        uint64_t percentile99Microseconds,
+        uint32_t budgetMicroseconds)
+    {
+      TraceLoggingWrite(
+          Provider(),
+          "HookLatencyBudgetExceeded",
+          TraceLoggingLevel(WINEVENT_LEVEL_WARNING),
+          TraceLoggingKeyword(kKeywordHooks),
+          TraceLoggingPointer(originalFunc, "OriginalFunction"),
+          TraceLoggingPointer(hookFunc, "HookFunction"),
+          TraceLoggingUInt64(percentile99Microseconds, "Percentile99Microseconds"),
+          TraceLoggingUInt32(budgetMicroseconds, "BudgetMicroseconds"));
+    }
+  } // namespace Tracing
+} // namespace Hookshot
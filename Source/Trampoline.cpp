@@ -11,16 +11,22 @@
 
 #include "Trampoline.h"
 
+#include <algorithm>
 #include <cstddef>
 #include <cstdint>
+#include <cstring>
 #include <string_view>
-#include <vector>
 
 #include <Infra/Core/Message.h>
-#include <Infra/Core/ProcessInfo.h>
+#include <Infra/Core/SystemInfo.h>
 #include <Infra/Core/TemporaryBuffer.h>
 
+#include "CodeRelocation.h"
 #include "DependencyProtect.h"
+#include "HookJournal.h"
+#include "HookPlanCache.h"
+#include "MappedLog.h"
+#include "TrampolineStore.h"
 #include "X86Instruction.h"
 
 namespace Hookshot
@@ -83,111 +89,2522 @@ namespace Hookshot
   /// into the debugger when executed.
   static constexpr uint8_t kTrampolineCodeDefault = 0xcc;
 
+  /// Loaded into the beginning of a trampoline that is used as an instrumentation stub. Atomically
+  /// increments the 64-bit invocation counter shard that belongs to the current processor and then
+  /// jumps to the hook function. The processor number is the same one that
+  /// `GetCurrentProcessorNumber` reads from the limit of a per-processor segment descriptor. If
+  /// that segment is unavailable the `lsl` instruction fails without modifying its destination,
+  /// which then selects the first shard, so counting remains correct albeit contended. Neither the
+  /// stack nor any argument-carrying registers are touched, so the hook function sees exactly the
+  /// same call as it would had it been invoked directly. Only the flags and the accumulator are
+  /// modified, and neither is preserved across function calls or used to pass arguments.
+  static constexpr uint8_t kInstrumentationStubCode[] = {
+#ifdef _WIN64
+      // mov eax, 0x53
+      0xb8,
+      0x53,
+      0x00,
+      0x00,
+      0x00,
+
+      // lsl eax, eax
+      0x0f,
+      0x03,
+      0xc0,
+
+      // shr eax, 14
+      0xc1,
+      0xe8,
+      0x0e,
+
+      // and eax, <number of invocation counter shards - 1>
+      0x83,
+      0xe0,
+      0x00,
+
+      // shl eax, 6
+      0xc1,
+      0xe0,
+      0x06,
+
+      // add rax, QWORD PTR [rip+24]
+      0x48,
+      0x03,
+      0x05,
+      0x18,
+      0x00,
+      0x00,
+      0x00,
+
+      // lock inc QWORD PTR [rax]
+      0xf0,
+      0x48,
+      0xff,
+      0x00,
+
+      // jmp QWORD PTR [rip+6]
+      0xff,
+      0x25,
+      0x06,
+      0x00,
+      0x00,
+      0x00,
+#else
+      // mov eax, 0x53
+      0xb8,
+      0x53,
+      0x00,
+      0x00,
+      0x00,
+
+      // lsl eax, eax
+      0x0f,
+      0x03,
+      0xc0,
+
+      // shr eax, 14
+      0xc1,
+      0xe8,
+      0x0e,
+
+      // and eax, <number of invocation counter shards - 1>
+      0x83,
+      0xe0,
+      0x00,
+
+      // shl eax, 6
+      0xc1,
+      0xe0,
+      0x06,
+
+      // add eax, <address of invocation counter shards>
+      0x05,
+      0x00,
+      0x00,
+      0x00,
+      0x00,
+
+      // lock add DWORD PTR [eax], 1
+      0xf0,
+      0x83,
+      0x00,
+      0x01,
+
+      // lock adc DWORD PTR [eax+4], 0
+      0xf0,
+      0x83,
+      0x50,
+      0x04,
+      0x00,
+
+      // jmp rel32
+      0xe9,
+#endif
+  };
+
+  /// Byte offset within an instrumentation stub of the mask that selects an invocation counter
+  /// shard using the processor number, which is an 8-bit immediate operand.
+  static constexpr size_t kInstrumentationStubShardMaskOffset = 13;
+
+#ifdef _WIN64
+  /// Byte offset within an instrumentation stub of the absolute hook function address.
+  static constexpr size_t kInstrumentationStubTargetOffset = 40;
+
+  /// Byte offset within an instrumentation stub of the absolute address of its invocation counter
+  /// shards.
+  static constexpr size_t kInstrumentationStubShardsOffset = 48;
+
+  // Used to verify that the instrumentation stub code is laid out as the offsets expect. Neither
+  // address may overlap the code, and both must be naturally aligned.
+  static_assert(
+      sizeof(kInstrumentationStubCode) <= kInstrumentationStubTargetOffset,
+      "Instrumentation stub code overlaps the hook function address.");
+  static_assert(
+      kInstrumentationStubTargetOffset + sizeof(void*) <= kInstrumentationStubShardsOffset,
+      "Instrumentation stub hook function address overlaps the invocation counter shards address.");
+  static_assert(
+      0 == kInstrumentationStubShardsOffset % sizeof(void*),
+      "Instrumentation stub invocation counter shards address is misaligned.");
+  static_assert(
+      kInstrumentationStubShardsOffset + sizeof(void*) <= Trampoline::kTrampolineSizeBytes,
+      "Instrumentation stub does not fit into a trampoline.");
+#else
+  /// Byte offset within an instrumentation stub of the rel32 displacement to the hook function.
+  static constexpr size_t kInstrumentationStubTargetOffset = sizeof(kInstrumentationStubCode);
+
+  /// Byte offset within an instrumentation stub of the absolute address of its invocation counter
+  /// shards, which is an immediate operand of the instruction that selects a shard.
+  static constexpr size_t kInstrumentationStubShardsOffset = 18;
+
+  static_assert(
+      kInstrumentationStubTargetOffset + sizeof(void*) <= Trampoline::kTrampolineSizeBytes,
+      "Instrumentation stub does not fit into a trampoline.");
+#endif
+
+  static_assert(
+      sizeof(Trampoline::SInstrumentationCounterShard) == (1 << 6),
+      "Instrumentation stub shard selection assumes a different invocation counter shard size.");
+  static_assert(
+      Trampoline::kMaxInstrumentationCounterShards <= 0x80,
+      "Instrumentation stub shard mask does not fit into a sign-extended 8-bit immediate.");
+
+  /// Loaded into the beginning of a trampoline that is used as a reentrancy guard stub. Compares
+  /// the per-thread depth value in the thread environment block with zero and then jumps to the
+  /// bypass function if it is non-zero or to the hook function otherwise. As with instrumentation
+  /// stubs, only the flags are modified. Both jump targets are naturally aligned so that each of
+  /// them can be changed using a single store.
+  static constexpr uint8_t kReentrancyGuardStubCode[] = {
+#ifdef _WIN64
+      // cmp QWORD PTR gs:[<depth offset>], 0
+      0x65,
+      0x48,
+      0x83,
+      0x3c,
+      0x25,
+      0x00,
+      0x00,
+      0x00,
+      0x00,
+      0x00,
+
+      // jne $+8
+      0x75,
+      0x06,
+
+      // jmp QWORD PTR [rip+6]
+      0xff,
+      0x25,
+      0x06,
+      0x00,
+      0x00,
+      0x00,
+
+      // jmp QWORD PTR [rip+8]
+      0xff,
+      0x25,
+      0x08,
+      0x00,
+      0x00,
+      0x00,
+#else
+      // cmp DWORD PTR fs:[<depth offset>], 0
+      0x64,
+      0x83,
+      0x3d,
+      0x00,
+      0x00,
+      0x00,
+      0x00,
+      0x00,
+
+      // nop
+      0x66,
+      0x90,
+
+      // jne rel32
+      0x0f,
+      0x85,
+      0x00,
+      0x00,
+      0x00,
+      0x00,
+
+      // nop
+      0x0f,
+      0x1f,
+      0x00,
+
+      // jmp rel32
+      0xe9,
+#endif
+  };
+
+#ifdef _WIN64
+  /// Byte offset within a reentrancy guard stub of the thread environment block offset of the
+  /// per-thread depth value, which is an operand of the comparison instruction.
+  static constexpr size_t kReentrancyGuardStubDepthOperandOffset = 5;
+
+  /// Byte offset within a reentrancy guard stub of the absolute hook function address.
+  static constexpr size_t kReentrancyGuardStubHookTargetOffset = 24;
+
+  /// Byte offset within a reentrancy guard stub of the absolute bypass function address.
+  static constexpr size_t kReentrancyGuardStubBypassTargetOffset = 32;
+#else
+  /// Byte offset within a reentrancy guard stub of the thread environment block offset of the
+  /// per-thread depth value, which is an operand of the comparison instruction.
+  static constexpr size_t kReentrancyGuardStubDepthOperandOffset = 3;
+
+  /// Byte offset within a reentrancy guard stub of the rel32 displacement to the hook function.
+  static constexpr size_t kReentrancyGuardStubHookTargetOffset = sizeof(kReentrancyGuardStubCode);
+
+  /// Byte offset within a reentrancy guard stub of the rel32 displacement to the bypass function.
+  static constexpr size_t kReentrancyGuardStubBypassTargetOffset = 12;
+#endif
+
+  // Used to verify that the reentrancy guard stub code is laid out as the offsets expect. Jump
+  // targets must be naturally aligned so that they can be changed atomically.
+  static_assert(
+      0 == kReentrancyGuardStubHookTargetOffset % sizeof(size_t),
+      "Reentrancy guard stub hook function address is misaligned.");
+  static_assert(
+      0 == kReentrancyGuardStubBypassTargetOffset % sizeof(size_t),
+      "Reentrancy guard stub bypass function address is misaligned.");
+  static_assert(
+      kReentrancyGuardStubHookTargetOffset + sizeof(size_t) <= Trampoline::kTrampolineSizeBytes,
+      "Reentrancy guard stub does not fit into a trampoline.");
+  static_assert(
+      kReentrancyGuardStubBypassTargetOffset + sizeof(size_t) <= Trampoline::kTrampolineSizeBytes,
+      "Reentrancy guard stub does not fit into a trampoline.");
+
+  /// Loaded into the beginning of a trampoline that is used as a caller filter stub. Reads the
+  /// return address from the top of the stack and scans a table of caller address ranges, sorted by
+  /// beginning address and terminated by a sentinel range that ends at the highest possible
+  /// address, for the first range that ends after it. Jumps to the hook function if that range
+  /// contains the return address or to the bypass function otherwise. In 64-bit mode, registers
+  /// r10 and r11 are used as scratch because they are volatile and never hold parameters. In 32-bit
+  /// mode, every register that is used is saved and restored because some calling conventions pass
+  /// parameters in registers. Either way, the flags are also modified. The table address and both
+  /// jump targets are naturally aligned so that each of them can be changed using a single store.
+  static constexpr uint8_t kCallerFilterStubCode[] = {
+#ifdef _WIN64
+      // mov r10, QWORD PTR [rsp]
+      0x4c,
+      0x8b,
+      0x14,
+      0x24,
+
+      // mov r11, QWORD PTR [rip+29]
+      0x4c,
+      0x8b,
+      0x1d,
+      0x1d,
+      0x00,
+      0x00,
+      0x00,
+
+      // cmp r10, QWORD PTR [r11+8]
+      0x4d,
+      0x3b,
+      0x53,
+      0x08,
+
+      // jb $+8
+      0x72,
+      0x06,
+
+      // add r11, 16
+      0x49,
+      0x83,
+      0xc3,
+      0x10,
+
+      // jmp $-10
+      0xeb,
+      0xf4,
+
+      // cmp r10, QWORD PTR [r11]
+      0x4d,
+      0x3b,
+      0x13,
+
+      // jb $+8
+      0x72,
+      0x06,
+
+      // jmp QWORD PTR [rip+14]
+      0xff,
+      0x25,
+      0x0e,
+      0x00,
+      0x00,
+      0x00,
+
+      // jmp QWORD PTR [rip+16]
+      0xff,
+      0x25,
+      0x10,
+      0x00,
+      0x00,
+      0x00,
+#else
+      // push eax
+      0x50,
+
+      // push ecx
+      0x51,
+
+      // mov eax, DWORD PTR [esp+8]
+      0x8b,
+      0x44,
+      0x24,
+      0x08,
+
+      // mov ecx, DWORD PTR [<table address operand>]
+      0x8b,
+      0x0d,
+      0x00,
+      0x00,
+      0x00,
+      0x00,
+
+      // cmp eax, DWORD PTR [ecx+4]
+      0x3b,
+      0x41,
+      0x04,
+
+      // jb $+7
+      0x72,
+      0x05,
+
+      // add ecx, 8
+      0x83,
+      0xc1,
+      0x08,
+
+      // jmp $-8
+      0xeb,
+      0xf6,
+
+      // cmp eax, DWORD PTR [ecx]
+      0x3b,
+      0x01,
+
+      // pop ecx
+      0x59,
+
+      // pop eax
+      0x58,
+
+      // jb rel32
+      0x0f,
+      0x82,
+      0x00,
+      0x00,
+      0x00,
+      0x00,
+
+      // nop
+      0x0f,
+      0x1f,
+      0x00,
+
+      // jmp rel32
+      0xe9,
+#endif
+  };
+
+#ifdef _WIN64
+  /// Byte offset within a caller filter stub of the absolute hook function address.
+  static constexpr size_t kCallerFilterStubHookTargetOffset = 48;
+
+  /// Byte offset within a caller filter stub of the absolute bypass function address.
+  static constexpr size_t kCallerFilterStubBypassTargetOffset = 56;
+#else
+  /// Byte offset within a caller filter stub of the absolute address of the table address, which
+  /// is an operand of the instruction that loads it.
+  static constexpr size_t kCallerFilterStubTableOperandOffset = 8;
+
+  /// Byte offset within a caller filter stub of the rel32 displacement to the hook function.
+  static constexpr size_t kCallerFilterStubHookTargetOffset = sizeof(kCallerFilterStubCode);
+
+  /// Byte offset within a caller filter stub of the rel32 displacement to the bypass function.
+  static constexpr size_t kCallerFilterStubBypassTargetOffset = 28;
+#endif
+
+  /// Byte offset within a caller filter stub of the address of the caller address range table.
+  static constexpr size_t kCallerFilterStubTableOffset = 40;
+
+  // Used to verify that the caller filter stub code is laid out as the offsets expect. The table
+  // address and the jump targets must be naturally aligned so that they can be changed atomically.
+  static_assert(
+      sizeof(kCallerFilterStubCode) <= kCallerFilterStubTableOffset,
+      "Caller filter stub code overlaps the table address.");
+  static_assert(
+      0 == kCallerFilterStubTableOffset % sizeof(size_t),
+      "Caller filter stub table address is misaligned.");
+  static_assert(
+      0 == kCallerFilterStubHookTargetOffset % sizeof(size_t),
+      "Caller filter stub hook function address is misaligned.");
+  static_assert(
+      0 == kCallerFilterStubBypassTargetOffset % sizeof(size_t),
+      "Caller filter stub bypass function address is misaligned.");
+  static_assert(
+      kCallerFilterStubBypassTargetOffset + sizeof(size_t) <= Trampoline::kTrampolineSizeBytes,
+      "Caller filter stub does not fit into a trampoline.");
+  static_assert(
+      kCallerFilterStubHookTargetOffset + sizeof(size_t) <= Trampoline::kTrampolineSizeBytes,
+      "Caller filter stub does not fit into a trampoline.");
+
+  /// Loaded into the beginning of a trampoline that is used as a call trace stub. Passes the
+  /// address of the call trace stub itself to the shared call recording code and jumps to it. The
+  /// call recording code records the call and then jumps to the target address held in the call
+  /// trace stub. In 64-bit mode, the address is passed in r11, and in 32-bit mode it is pushed onto
+  /// the stack, from which the call recording code removes it.
+  static constexpr uint8_t kCallTraceStubCode[] = {
+#ifdef _WIN64
+      // lea r11, [rip-7]
+      0x4c,
+      0x8d,
+      0x1d,
+      0xf9,
+      0xff,
+      0xff,
+      0xff,
+
+      // jmp QWORD PTR [rip+3]
+      0xff,
+      0x25,
+      0x03,
+      0x00,
+      0x00,
+      0x00,
+#else
+      // push <call trace stub address>
+      0x68,
+      0x00,
+      0x00,
+      0x00,
+      0x00,
+
+      // nop
+      0x66,
+      0x0f,
+      0x1f,
+      0x44,
+      0x00,
+      0x00,
+
+      // jmp rel32
+      0xe9,
+#endif
+  };
+
+#ifdef _WIN64
+  /// Byte offset within a call trace stub of the absolute address of the call recording code.
+  static constexpr size_t kCallTraceStubRecorderOffset = 16;
+#else
+  /// Byte offset within a call trace stub of the absolute address of the call trace stub itself,
+  /// which is an operand of the instruction that pushes it.
+  static constexpr size_t kCallTraceStubAddressOperandOffset = 1;
+
+  /// Byte offset within a call trace stub of the rel32 displacement to the call recording code.
+  static constexpr size_t kCallTraceStubRecorderOffset = sizeof(kCallTraceStubCode);
+#endif
+
+  /// Byte offset within a call trace stub of the absolute target address, which the call recording
+  /// code reads in both 64-bit and 32-bit modes.
+  static constexpr size_t kCallTraceStubTargetOffset = 24;
+
+  /// Byte offset within a call trace stub of the value that identifies it in recorded calls, which
+  /// the call recording code reads in both 64-bit and 32-bit modes.
+  static constexpr size_t kCallTraceStubTraceIdOffset = 32;
+
+  // Used to verify that the call trace stub code is laid out as the offsets expect. The call
+  // recording code assumes the offsets of the target address and the identifying value, and the
+  // target address must be naturally aligned so that it can be changed atomically.
+  static_assert(
+      kCallTraceStubRecorderOffset + sizeof(size_t) <= kCallTraceStubTargetOffset,
+      "Call trace stub code overlaps the target address.");
+  static_assert(
+      (24 == kCallTraceStubTargetOffset) && (32 == kCallTraceStubTraceIdOffset),
+      "Call trace stub layout does not match what the call recording code expects.");
+  static_assert(
+      kCallTraceStubTraceIdOffset + sizeof(size_t) <= Trampoline::kTrampolineSizeBytes,
+      "Call trace stub does not fit into a trampoline.");
+
+  /// Loaded into the beginning of a trampoline that is used as a context stub. Stores the context
+  /// value held in the context stub into a thread-local storage slot held directly in the thread
+  /// environment block and then jumps to the hook function. In 64-bit mode, r11 is used as scratch
+  /// because it is volatile and never holds parameters, and in 32-bit mode no register is modified.
+  static constexpr uint8_t kContextStubCode[] = {
+#ifdef _WIN64
+      // mov r11, QWORD PTR [rip+17]
+      0x4c,
+      0x8b,
+      0x1d,
+      0x11,
+      0x00,
+      0x00,
+      0x00,
+
+      // mov QWORD PTR gs:[<context slot offset>], r11
+      0x65,
+      0x4c,
+      0x89,
+      0x1c,
+      0x25,
+      0x00,
+      0x00,
+      0x00,
+      0x00,
+
+      // jmp QWORD PTR [rip+10]
+      0xff,
+      0x25,
+      0x0a,
+      0x00,
+      0x00,
+      0x00,
+#else
+      // mov DWORD PTR fs:[<context slot offset>], <context value>
+      0x64,
+      0xc7,
+      0x05,
+      0x00,
+      0x00,
+      0x00,
+      0x00,
+      0x00,
+      0x00,
+      0x00,
+      0x00,
+
+      // jmp rel32
+      0xe9,
+#endif
+  };
+
+#ifdef _WIN64
+  /// Byte offset within a context stub of the thread environment block offset of the context slot,
+  /// which is an operand of the instruction that stores into it.
+  static constexpr size_t kContextStubSlotOperandOffset = 12;
+
+  /// Byte offset within a context stub of the context value.
+  static constexpr size_t kContextStubContextOffset = 24;
+
+  /// Byte offset within a context stub of the absolute address of the hook function.
+  static constexpr size_t kContextStubHookTargetOffset = 32;
+#else
+  /// Byte offset within a context stub of the thread environment block offset of the context slot,
+  /// which is an operand of the instruction that stores into it.
+  static constexpr size_t kContextStubSlotOperandOffset = 3;
+
+  /// Byte offset within a context stub of the context value, which is an operand of the
+  /// instruction that stores it.
+  static constexpr size_t kContextStubContextOffset = 7;
+
+  /// Byte offset within a context stub of the rel32 displacement to the hook function.
+  static constexpr size_t kContextStubHookTargetOffset = sizeof(kContextStubCode);
+#endif
+
+  // Used to verify that the context stub code is laid out as the offsets expect.
+  static_assert(
+      kContextStubHookTargetOffset + sizeof(size_t) <= Trampoline::kTrampolineSizeBytes,
+      "Context stub does not fit into a trampoline.");
+
+  /// Loaded into the beginning of a trampoline that is used as a probe stub. Calls the shared probe
+  /// code, without modifying any register or flag, because a probe can be reached with any of them
+  /// live. The probe code locates the rest of the probe stub using the return address pushed by
+  /// the call and returns to it, after which the probe stub jumps to the resume address. Calls and
+  /// returns therefore always pair up, which keeps probes compatible with shadow stacks.
+  static constexpr uint8_t kProbeStubCode[] = {
+#ifdef _WIN64
+      // call QWORD PTR [rip+10]
+      0xff,
+      0x15,
+      0x0a,
+      0x00,
+      0x00,
+      0x00,
+
+      // jmp QWORD PTR [rip+12]
+      0xff,
+      0x25,
+      0x0c,
+      0x00,
+      0x00,
+      0x00,
+#else
+      // call rel32
+      0xe8,
+      0x00,
+      0x00,
+      0x00,
+      0x00,
+
+      // jmp DWORD PTR [<resume address location>]
+      0xff,
+      0x25,
+      0x00,
+      0x00,
+      0x00,
+      0x00,
+#endif
+  };
+
+#ifdef _WIN64
+  /// Byte offset within a probe stub of the absolute address of the probe code.
+  static constexpr size_t kProbeStubDispatcherOffset = 16;
+
+  /// Byte offset within a probe stub of the return address pushed by its call to the probe code.
+  static constexpr size_t kProbeStubReturnOffset = 6;
+#else
+  /// Byte offset within a probe stub of the rel32 displacement to the probe code, which is an
+  /// operand of the instruction that calls it.
+  static constexpr size_t kProbeStubDispatcherOffset = 1;
+
+  /// Byte offset within a probe stub of the return address pushed by its call to the probe code.
+  static constexpr size_t kProbeStubReturnOffset = 5;
+
+  /// Byte offset within a probe stub of the absolute address of the resume address, which is an
+  /// operand of the instruction that jumps to it.
+  static constexpr size_t kProbeStubResumeOperandOffset = 7;
+#endif
+
+  /// Byte offset within a probe stub of the absolute resume address, which the probe code reads in
+  /// both 64-bit and 32-bit modes. Shared with call trace stubs so that both kinds of stubs have
+  /// their targets set the same way.
+  static constexpr size_t kProbeStubTargetOffset = kCallTraceStubTargetOffset;
+
+  /// Byte offset within a probe stub of the absolute callback address, which the probe code reads.
+  static constexpr size_t kProbeStubCallbackOffset = 40;
+
+  /// Byte offset within a probe stub of the context value, which the probe code reads.
+  static constexpr size_t kProbeStubContextOffset = 48;
+
+  /// Byte offset within a probe stub of the probe address, which the probe code reads.
+  static constexpr size_t kProbeStubProbeAddressOffset = 56;
+
+  // Used to verify that the probe stub code is laid out as the offsets expect. The probe code
+  // assumes the offsets of everything it reads, relative to the return address of the call.
+  static_assert(
+      (sizeof(kProbeStubCode) <= kProbeStubTargetOffset) &&
+          (kProbeStubDispatcherOffset + sizeof(size_t) <= kProbeStubTargetOffset),
+      "Probe stub code overlaps the resume address.");
+  static_assert(
+      (24 == kProbeStubTargetOffset) && (40 == kProbeStubCallbackOffset) &&
+          (48 == kProbeStubContextOffset) && (56 == kProbeStubProbeAddressOffset),
+      "Probe stub layout does not match what the probe code expects.");
+#ifdef _WIN64
+  static_assert(6 == kProbeStubReturnOffset, "Probe code expects a different return address.");
+#else
+  static_assert(5 == kProbeStubReturnOffset, "Probe code expects a different return address.");
+#endif
+  static_assert(
+      kProbeStubProbeAddressOffset + sizeof(size_t) <= Trampoline::kTrampolineSizeBytes,
+      "Probe stub does not fit into a trampoline.");
+
+  /// Loaded into the beginning of a trampoline that is used as a sampled timing stub. Decrements
+  /// the countdown and jumps to the target if it is still positive. Otherwise, passes the address
+  /// of the sampled timing stub itself to the shared sampling code and jumps to it, and the
+  /// sampling code resets the countdown. The countdown is not decremented atomically because
+  /// losing the occasional decrement only makes the interval between samples slightly longer, and
+  /// testing for a non-positive value rather than zero means that a decrement that races with the
+  /// reset cannot stop sampling. In 64-bit mode, the address is passed in r11, and in 32-bit mode
+  /// it is pushed onto the stack, from which the sampling code removes it. Only the flags are
+  /// modified.
+  static constexpr uint8_t kSampledTimingStubCode[] = {
+#ifdef _WIN64
+      // dec DWORD PTR [rip+42]
+      0xff,
+      0x0d,
+      0x2a,
+      0x00,
+      0x00,
+      0x00,
+
+      // jle $+8
+      0x7e,
+      0x06,
+
+      // jmp QWORD PTR [rip+18]
+      0xff,
+      0x25,
+      0x12,
+      0x00,
+      0x00,
+      0x00,
+
+      // lea r11, [rip-21]
+      0x4c,
+      0x8d,
+      0x1d,
+      0xeb,
+      0xff,
+      0xff,
+      0xff,
+
+      // jmp QWORD PTR [rip+13]
+      0xff,
+      0x25,
+      0x0d,
+      0x00,
+      0x00,
+      0x00,
+#else
+      // dec DWORD PTR [<countdown>]
+      0xff,
+      0x0d,
+      0x00,
+      0x00,
+      0x00,
+      0x00,
+
+      // jle $+8
+      0x7e,
+      0x06,
+
+      // jmp DWORD PTR [<target>]
+      0xff,
+      0x25,
+      0x00,
+      0x00,
+      0x00,
+      0x00,
+
+      // push <sampled timing stub>
+      0x68,
+      0x00,
+      0x00,
+      0x00,
+      0x00,
+
+      // jmp rel32
+      0xe9,
+#endif
+  };
+
+#ifdef _WIN64
+  /// Byte offset within a sampled timing stub of the absolute address of the sampling code.
+  static constexpr size_t kSampledTimingStubSamplerOffset = 40;
+#else
+  /// Byte offset within a sampled timing stub of the absolute address of the countdown, which is
+  /// an operand of the instruction that decrements it.
+  static constexpr size_t kSampledTimingStubCountdownOperandOffset = 2;
+
+  /// Byte offset within a sampled timing stub of the absolute address of the target address, which
+  /// is an operand of the instruction that jumps through it.
+  static constexpr size_t kSampledTimingStubTargetOperandOffset = 10;
+
+  /// Byte offset within a sampled timing stub of the absolute address of the sampled timing stub
+  /// itself, which is an operand of the instruction that pushes it.
+  static constexpr size_t kSampledTimingStubAddressOperandOffset = 15;
+
+  /// Byte offset within a sampled timing stub of the rel32 displacement to the sampling code.
+  static constexpr size_t kSampledTimingStubSamplerOffset = sizeof(kSampledTimingStubCode);
+#endif
+
+  /// Byte offset within a sampled timing stub of the absolute target address, which both the stub
+  /// and the sampling code read in both 64-bit and 32-bit modes.
+  static constexpr size_t kSampledTimingStubTargetOffset = 32;
+
+  /// Byte offset within a sampled timing stub of the signed 32-bit countdown to the next sample.
+  static constexpr size_t kSampledTimingStubCountdownOffset = 48;
+
+  /// Byte offset within a sampled timing stub of the 32-bit value to which the sampling code resets
+  /// the countdown.
+  static constexpr size_t kSampledTimingStubIntervalOffset = 52;
+
+  /// Byte offset within a sampled timing stub of the address of its sample block, which the
+  /// sampling code reads in both 64-bit and 32-bit modes.
+  static constexpr size_t kSampledTimingStubSampleBlockOffset = 56;
+
+  // Used to verify that the sampled timing stub code is laid out as the offsets expect. The
+  // sampling code assumes the offsets of everything it reads and writes, and the target address
+  // must be naturally aligned so that it can be changed atomically.
+#ifdef _WIN64
+  static_assert(
+      sizeof(kSampledTimingStubCode) <= kSampledTimingStubTargetOffset,
+      "Sampled timing stub code overlaps the target address.");
+  static_assert(
+      40 == kSampledTimingStubSamplerOffset,
+      "Sampled timing stub code assumes a different sampling code address location.");
+#else
+  static_assert(
+      kSampledTimingStubSamplerOffset + sizeof(size_t) <= kSampledTimingStubTargetOffset,
+      "Sampled timing stub code overlaps the target address.");
+#endif
+  static_assert(
+      (32 == kSampledTimingStubTargetOffset) && (48 == kSampledTimingStubCountdownOffset) &&
+          (52 == kSampledTimingStubIntervalOffset) && (56 == kSampledTimingStubSampleBlockOffset),
+      "Sampled timing stub layout does not match what the sampling code expects.");
+  static_assert(
+      kSampledTimingStubSampleBlockOffset + sizeof(size_t) <= Trampoline::kTrampolineSizeBytes,
+      "Sampled timing stub does not fit into a trampoline.");
+
+  /// Loaded into the beginning of a trampoline that is used as a thread override stub. Reads the
+  /// calling thread's override table pointer from the thread environment block and, if there is a
+  /// table and its entry for this stub is non-null, transfers control to that entry. Otherwise
+  /// transfers control to the hook function. Threads without overrides pay for one load, one test,
+  /// and one predictable branch. In 64-bit mode the only register modified is r11, which is
+  /// volatile and never used to pass parameters. In 32-bit mode no register is modified because eax
+  /// is saved on the stack, and the override is reached by pushing it and returning in a way that
+  /// also discards the saved value of eax.
+  static constexpr uint8_t kThreadOverrideStubCode[] = {
+#ifdef _WIN64
+      // mov r11, QWORD PTR gs:[<table offset>]
+      0x65,
+      0x4c,
+      0x8b,
+      0x1c,
+      0x25,
+      0x00,
+      0x00,
+      0x00,
+      0x00,
+      // test r11, r11
+      0x4d,
+      0x85,
+      0xdb,
+      // je $+17
+      0x74,
+      0x0f,
+      // mov r11, QWORD PTR [r11+<entry offset>]
+      0x4d,
+      0x8b,
+      0x9b,
+      0x00,
+      0x00,
+      0x00,
+      0x00,
+      // test r11, r11
+      0x4d,
+      0x85,
+      0xdb,
+      // je $+5
+      0x74,
+      0x03,
+      // jmp r11
+      0x41,
+      0xff,
+      0xe3,
+      // jmp QWORD PTR [rip+5]
+      0xff,
+      0x25,
+      0x05,
+      0x00,
+      0x00,
+      0x00,
+#else
+      // push eax
+      0x50,
+      // mov eax, DWORD PTR fs:[<table offset>]
+      0x64,
+      0xa1,
+      0x00,
+      0x00,
+      0x00,
+      0x00,
+      // test eax, eax
+      0x85,
+      0xc0,
+      // je $+20
+      0x74,
+      0x12,
+      // mov eax, DWORD PTR [eax+<entry offset>]
+      0x8b,
+      0x80,
+      0x00,
+      0x00,
+      0x00,
+      0x00,
+      // test eax, eax
+      0x85,
+      0xc0,
+      // je $+10
+      0x74,
+      0x08,
+      // push eax
+      0x50,
+      // mov eax, DWORD PTR [esp+4]
+      0x8b,
+      0x44,
+      0x24,
+      0x04,
+      // ret 4
+      0xc2,
+      0x04,
+      0x00,
+      // pop eax
+      0x58,
+      // nop
+      0x90,
+      // jmp rel32
+      0xe9,
+#endif
+  };
+
+#ifdef _WIN64
+  /// Byte offset within a thread override stub of the thread environment block offset of the
+  /// per-thread table pointer, which is an operand of the instruction that loads it.
+  static constexpr size_t kThreadOverrideStubTableOperandOffset = 5;
+
+  /// Byte offset within a thread override stub of the byte offset of its entry within each
+  /// per-thread table, which is the displacement operand of the instruction that loads it.
+  static constexpr size_t kThreadOverrideStubEntryOperandOffset = 17;
+
+  /// Byte offset within a thread override stub of the absolute hook function address.
+  static constexpr size_t kThreadOverrideStubHookTargetOffset = 40;
+#else
+  /// Byte offset within a thread override stub of the thread environment block offset of the
+  /// per-thread table pointer, which is an operand of the instruction that loads it.
+  static constexpr size_t kThreadOverrideStubTableOperandOffset = 3;
+
+  /// Byte offset within a thread override stub of the byte offset of its entry within each
+  /// per-thread table, which is the displacement operand of the instruction that loads it.
+  static constexpr size_t kThreadOverrideStubEntryOperandOffset = 13;
+
+  /// Byte offset within a thread override stub of the rel32 displacement to the hook function.
+  static constexpr size_t kThreadOverrideStubHookTargetOffset = sizeof(kThreadOverrideStubCode);
+#endif
+
+  // Used to verify that the thread override stub code is laid out as the offsets expect. The jump
+  // target must be naturally aligned so that it can be changed atomically.
+  static_assert(
+      0 == kThreadOverrideStubHookTargetOffset % sizeof(size_t),
+      "Thread override stub hook function address is misaligned.");
+  static_assert(
+      kThreadOverrideStubHookTargetOffset + sizeof(size_t) <= Trampoline::kTrampolineSizeBytes,
+      "Thread override stub does not fit into a trampoline.");
+
+  /// Loaded into the beginning of a trampoline that is used as a one-shot stub. Atomically sets the
+  /// lowest bit of a flag and transfers control to the hook function if that bit was previously
+  /// clear, or to the bypass function otherwise, so that exactly one call reaches the hook function
+  /// no matter how many threads make it at once. In 64-bit mode the only register modified is rax,
+  /// which is volatile and never used to pass parameters. In 32-bit mode no register is modified
+  /// because the flag is addressed directly.
+  static constexpr uint8_t kOneShotStubCode[] = {
+#ifdef _WIN64
+      // mov rax, QWORD PTR [rip+0x19]
+      0x48,
+      0x8b,
+      0x05,
+      0x19,
+      0x00,
+      0x00,
+      0x00,
+      // lock bts DWORD PTR [rax], 0
+      0xf0,
+      0x0f,
+      0xba,
+      0x28,
+      0x00,
+      // jc +6
+      0x72,
+      0x06,
+      // jmp QWORD PTR [rip+0x14]
+      0xff,
+      0x25,
+      0x14,
+      0x00,
+      0x00,
+      0x00,
+      // jmp QWORD PTR [rip+0x16]
+      0xff,
+      0x25,
+      0x16,
+      0x00,
+      0x00,
+      0x00,
+#else
+      // lock bts DWORD PTR [<flag address>], 0
+      0xf0,
+      0x0f,
+      0xba,
+      0x2d,
+      0x00,
+      0x00,
+      0x00,
+      0x00,
+      0x00,
+      // nop
+      0x90,
+      // jc rel32
+      0x0f,
+      0x82,
+      0x00,
+      0x00,
+      0x00,
+      0x00,
+      // nop DWORD PTR [eax]
+      0x0f,
+      0x1f,
+      0x00,
+      // jmp rel32
+      0xe9,
+#endif
+  };
+
+#ifdef _WIN64
+  /// Byte offset within a one-shot stub of the absolute address of its flag.
+  static constexpr size_t kOneShotStubFlagOperandOffset = 32;
+
+  /// Byte offset within a one-shot stub of the absolute hook function address.
+  static constexpr size_t kOneShotStubHookTargetOffset = 40;
+
+  /// Byte offset within a one-shot stub of the absolute bypass function address.
+  static constexpr size_t kOneShotStubBypassTargetOffset = 48;
+#else
+  /// Byte offset within a one-shot stub of the absolute address of its flag, which is the memory
+  /// operand of the instruction that sets it.
+  static constexpr size_t kOneShotStubFlagOperandOffset = 4;
+
+  /// Byte offset within a one-shot stub of the rel32 displacement to the hook function.
+  static constexpr size_t kOneShotStubHookTargetOffset = sizeof(kOneShotStubCode);
+
+  /// Byte offset within a one-shot stub of the rel32 displacement to the bypass function.
+  static constexpr size_t kOneShotStubBypassTargetOffset = 12;
+#endif
+
+  // Used to verify that the one-shot stub code is laid out as the offsets expect. Both jump targets
+  // must be naturally aligned so that they can be changed atomically.
+  static_assert(
+      (0 == kOneShotStubHookTargetOffset % sizeof(size_t)) &&
+          (0 == kOneShotStubBypassTargetOffset % sizeof(size_t)),
+      "One-shot stub jump target is misaligned.");
+  static_assert(
+      kOneShotStubBypassTargetOffset + sizeof(size_t) <= Trampoline::kTrampolineSizeBytes,
+      "One-shot stub does not fit into a trampoline.");
+
+  /// Loaded into the beginning of a trampoline that is used as a sampled hook stub. Decrements the
+  /// countdown and transfers control to the bypass function if it is still positive. Otherwise,
+  /// resets the countdown to the interval and transfers control to the hook function. As with a
+  /// sampled timing stub, the countdown is not modified atomically because losing the occasional
+  /// decrement only makes the interval between samples slightly longer, and testing for a
+  /// non-positive value means that a race with the reset cannot stop sampling. In 64-bit mode the
+  /// only register modified is rax, which is volatile and never used to pass parameters. In 32-bit
+  /// mode eax is preserved on the stack while it is used, so no register is modified. The flags are
+  /// modified in both modes.
+  static constexpr uint8_t kSampledHookStubCode[] = {
+#ifdef _WIN64
+      // dec DWORD PTR [rip+50]
+      0xff,
+      0x0d,
+      0x32,
+      0x00,
+      0x00,
+      0x00,
+      // jle $+8
+      0x7e,
+      0x06,
+      // jmp QWORD PTR [rip+34]
+      0xff,
+      0x25,
+      0x22,
+      0x00,
+      0x00,
+      0x00,
+      // mov eax, DWORD PTR [rip+40]
+      0x8b,
+      0x05,
+      0x28,
+      0x00,
+      0x00,
+      0x00,
+      // mov DWORD PTR [rip+30], eax
+      0x89,
+      0x05,
+      0x1e,
+      0x00,
+      0x00,
+      0x00,
+      // jmp QWORD PTR [rip+8]
+      0xff,
+      0x25,
+      0x08,
+      0x00,
+      0x00,
+      0x00,
+#else
+      // dec DWORD PTR [<countdown>]
+      0xff,
+      0x0d,
+      0x00,
+      0x00,
+      0x00,
+      0x00,
+      // jle $+8
+      0x7e,
+      0x06,
+      // jmp DWORD PTR [<bypass>]
+      0xff,
+      0x25,
+      0x00,
+      0x00,
+      0x00,
+      0x00,
+      // push eax
+      0x50,
+      // mov eax, DWORD PTR [<interval>]
+      0xa1,
+      0x00,
+      0x00,
+      0x00,
+      0x00,
+      // mov DWORD PTR [<countdown>], eax
+      0xa3,
+      0x00,
+      0x00,
+      0x00,
+      0x00,
+      // pop eax
+      0x58,
+      // jmp DWORD PTR [<hook>]
+      0xff,
+      0x25,
+      0x00,
+      0x00,
+      0x00,
+      0x00,
+#endif
+  };
+
+#ifndef _WIN64
+  /// Byte offsets within a sampled hook stub of the absolute addresses of the countdown, which are
+  /// operands of the instructions that decrement and reset it.
+  static constexpr size_t kSampledHookStubCountdownOperandOffsets[] = {2, 21};
+
+  /// Byte offset within a sampled hook stub of the absolute address of the bypass function address,
+  /// which is an operand of the instruction that jumps through it.
+  static constexpr size_t kSampledHookStubBypassOperandOffset = 10;
+
+  /// Byte offset within a sampled hook stub of the absolute address of the interval, which is an
+  /// operand of the instruction that loads it.
+  static constexpr size_t kSampledHookStubIntervalOperandOffset = 16;
+
+  /// Byte offset within a sampled hook stub of the absolute address of the hook function address,
+  /// which is an operand of the instruction that jumps through it.
+  static constexpr size_t kSampledHookStubHookOperandOffset = 28;
+#endif
+
+  /// Byte offset within a sampled hook stub of the absolute hook function address, which is stored
+  /// as an absolute address in both 64-bit and 32-bit modes.
+  static constexpr size_t kSampledHookStubHookTargetOffset = 40;
+
+  /// Byte offset within a sampled hook stub of the absolute bypass function address, which is
+  /// stored as an absolute address in both 64-bit and 32-bit modes.
+  static constexpr size_t kSampledHookStubBypassTargetOffset = 48;
+
+  /// Byte offset within a sampled hook stub of the signed 32-bit countdown to the next sample.
+  static constexpr size_t kSampledHookStubCountdownOffset = 56;
+
+  /// Byte offset within a sampled hook stub of the 32-bit value to which the countdown is reset.
+  static constexpr size_t kSampledHookStubIntervalOffset = 60;
+
+  // Used to verify that the sampled hook stub code is laid out as the offsets expect. Both jump
+  // targets must be naturally aligned so that they can be changed atomically.
+  static_assert(
+      sizeof(kSampledHookStubCode) <= kSampledHookStubHookTargetOffset,
+      "Sampled hook stub code overlaps the hook function address.");
+  static_assert(
+      (0 == kSampledHookStubHookTargetOffset % sizeof(size_t)) &&
+          (0 == kSampledHookStubBypassTargetOffset % sizeof(size_t)),
+      "Sampled hook stub jump target is misaligned.");
+  static_assert(
+      kSampledHookStubIntervalOffset + sizeof(uint32_t) <= Trampoline::kTrampolineSizeBytes,
+      "Sampled hook stub does not fit into a trampoline.");
+
+  /// Reads a jump target from a stub, which is stored as an absolute address in 64-bit mode and as
+  /// a rel32 displacement from the end of the jump instruction in 32-bit mode.
+  /// @param [in] stubBytes Stub code.
+  /// @param [in] targetOffset Byte offset within the stub of the jump target.
+  /// @return Absolute jump target address.
+  static inline const void* ReadStubJumpTarget(const uint8_t* stubBytes, size_t targetOffset)
+  {
+    size_t targetValue = 0;
+    std::memcpy(&targetValue, &stubBytes[targetOffset], sizeof(targetValue));
+
+#ifdef _WIN64
+    return reinterpret_cast<const void*>(targetValue);
+#else
+    return reinterpret_cast<const void*>(
+        reinterpret_cast<size_t>(&stubBytes[targetOffset + sizeof(size_t)]) + targetValue);
+#endif
+  }
+
+  /// Writes a jump target into a stub using a single naturally-aligned store, so that another
+  /// thread executing the stub concurrently observes either the old target or the new target.
+  /// @param [in,out] stubBytes Stub code.
+  /// @param [in] targetOffset Byte offset within the stub of the jump target.
+  /// @param [in] target Absolute jump target address.
+  static inline void WriteStubJumpTarget(
+      uint8_t* stubBytes, size_t targetOffset, const void* target)
+  {
+#ifdef _WIN64
+    const size_t targetValue = reinterpret_cast<size_t>(target);
+#else
+    const size_t targetValue = reinterpret_cast<size_t>(target) -
+        reinterpret_cast<size_t>(&stubBytes[targetOffset + sizeof(size_t)]);
+#endif
+
+    *reinterpret_cast<volatile size_t*>(&stubBytes[targetOffset]) = targetValue;
+  }
+
+#ifdef _WIN64
+  /// Writes a jump to the specified target into a 16-byte region of trampoline code laid out like
+  /// the hook region, with the hook code preamble in the first 8 bytes and an absolute target
+  /// address in the last 8 bytes. If the target is within range, the preamble's indirect jump is
+  /// replaced with a direct relative jump, which avoids a data load and an indirect branch every
+  /// time the code is executed. Either way, the absolute target address is always written so that
+  /// it can be read back. The first 8 bytes are aligned and written using a single store, after the
+  /// absolute target address, so another thread executing the code concurrently always observes
+  /// either the old jump or the new jump, never a mixture of the two.
+  /// @param [in,out] jumpCode Region of trampoline code to be written, as an array of 2 quadwords.
+  /// @param [in] target Jump target address.
+  static void WriteJumpCode(uint64_t* const jumpCode, const void* const target)
+  {
+    static_assert(sizeof(kHookCodePreamble) == sizeof(uint64_t), "Unexpected preamble size.");
+
+    uint64_t jumpCodeHead = 0;
+
+    if (true == X86Instruction::CanWriteJumpInstruction(jumpCode, target))
+    {
+      // jmp rel32, followed by padding
+      const uint32_t displacement = static_cast<uint32_t>(
+          reinterpret_cast<size_t>(target) -
+          (reinterpret_cast<size_t>(jumpCode) +
+           static_cast<size_t>(X86Instruction::kJumpInstructionLengthBytes)));
+
+      uint8_t jumpCodeHeadBytes[sizeof(jumpCodeHead)];
+      for (int i = 0; i < _countof(jumpCodeHeadBytes); ++i)
+        jumpCodeHeadBytes[i] = kTrampolineCodeDefault;
+
+      std::memcpy(
+          &jumpCodeHeadBytes[0],
+          X86Instruction::kJumpInstructionPreamble,
+          sizeof(X86Instruction::kJumpInstructionPreamble));
+      std::memcpy(
+          &jumpCodeHeadBytes[sizeof(X86Instruction::kJumpInstructionPreamble)],
+          &displacement,
+          sizeof(displacement));
+      std::memcpy(&jumpCodeHead, jumpCodeHeadBytes, sizeof(jumpCodeHead));
+    }
+    else
+    {
+      std::memcpy(&jumpCodeHead, kHookCodePreamble, sizeof(jumpCodeHead));
+    }
+
+    jumpCode[1] = reinterpret_cast<uint64_t>(target);
+    *reinterpret_cast<volatile uint64_t*>(&jumpCode[0]) = jumpCodeHead;
+  }
+#endif
+
+  /// Index of the pointer-sized element of the original function region that holds the jump target
+  /// when the original function region is set to jump to the next function in a hook chain. The
+  /// hook code preamble is re-used at the beginning of the original function region, so the
+  /// layout there matches the layout of the hook function region.
+  static constexpr size_t kChainTargetIndex =
+      (Trampoline::kTrampolineSizeHookFunctionBytes / sizeof(size_t)) - 1;
+
   Trampoline::Trampoline(void) : code()
   {
-    Reset();
+    Reset();
+  }
+
+  const void* Trampoline::GetCallerFilterStubHookTarget(void) const
+  {
+    return ReadStubJumpTarget(
+        reinterpret_cast<const uint8_t*>(&code), kCallerFilterStubHookTargetOffset);
+  }
+
+  const void* Trampoline::GetChainTarget(void) const
+  {
+#ifdef _WIN64
+    return reinterpret_cast<const void*>(code.original.ptr[kChainTargetIndex]);
+#else
+    return reinterpret_cast<const void*>(
+        reinterpret_cast<size_t>(&code.original.ptr[kChainTargetIndex + 1]) +
+        code.original.ptr[kChainTargetIndex]);
+#endif
+  }
+
+  uint64_t Trampoline::GetInstrumentationStubCallCount(void) const
+  {
+    const SInstrumentationCounterShard* counterShards = nullptr;
+    std::memcpy(
+        &counterShards,
+        &reinterpret_cast<const uint8_t*>(&code)[kInstrumentationStubShardsOffset],
+        sizeof(counterShards));
+
+    const size_t numCounterShards = GetNumInstrumentationCounterShards();
+    uint64_t callCount = 0;
+
+    for (size_t i = 0; i < numCounterShards; ++i)
+    {
+      const volatile uint64_t* const counter =
+          reinterpret_cast<const volatile uint64_t*>(&counterShards[i].count);
+
+#ifdef _WIN64
+      callCount += *counter;
+#else
+      // The two halves of each shard are updated by separate instructions, so a carry into the
+      // high half might be observed in between reading the two halves. Retry until the high half
+      // is stable, which guarantees the low half belongs with it.
+      const volatile uint32_t* const counterHalves =
+          reinterpret_cast<const volatile uint32_t*>(counter);
+
+      uint32_t counterHigh = 0;
+      uint32_t counterLow = 0;
+
+      do
+      {
+        counterHigh = counterHalves[1];
+        counterLow = counterHalves[0];
+      }
+      while (counterHigh != counterHalves[1]);
+
+      callCount += ((static_cast<uint64_t>(counterHigh) << 32) | static_cast<uint64_t>(counterLow));
+#endif
+    }
+
+    return callCount;
+  }
+
+  const void* Trampoline::GetInstrumentationStubTarget(void) const
+  {
+    const uint8_t* const stubBytes = reinterpret_cast<const uint8_t*>(&code);
+
+    size_t targetValue = 0;
+    std::memcpy(&targetValue, &stubBytes[kInstrumentationStubTargetOffset], sizeof(targetValue));
+
+#ifdef _WIN64
+    return reinterpret_cast<const void*>(targetValue);
+#else
+    return reinterpret_cast<const void*>(
+        reinterpret_cast<size_t>(&stubBytes[kInstrumentationStubTargetOffset + sizeof(size_t)]) +
+        targetValue);
+#endif
+  }
+
+  size_t Trampoline::GetNumInstrumentationCounterShards(void)
+  {
+    static const size_t numCounterShards = []() -> size_t
+    {
+      const size_t numProcessors = static_cast<size_t>(
+          Infra::SystemInfo::GetPlatformAndArchitectureInfo().dwNumberOfProcessors);
+
+      size_t numShards = 1;
+      while ((numShards < numProcessors) && (numShards < kMaxInstrumentationCounterShards))
+        numShards <<= 1;
+
+      return numShards;
+    }();
+
+    return numCounterShards;
+  }
+
+  const void* Trampoline::GetReentrancyGuardStubHookTarget(void) const
+  {
+    return ReadStubJumpTarget(
+        reinterpret_cast<const uint8_t*>(&code), kReentrancyGuardStubHookTargetOffset);
+  }
+
+  const void* Trampoline::GetSampledTimingStubTarget(void) const
+  {
+    size_t targetValue = 0;
+    std::memcpy(
+        &targetValue,
+        &reinterpret_cast<const uint8_t*>(&code)[kSampledTimingStubTargetOffset],
+        sizeof(targetValue));
+    return reinterpret_cast<const void*>(targetValue);
+  }
+
+  const void* Trampoline::GetThreadOverrideStubHookTarget(void) const
+  {
+    return ReadStubJumpTarget(
+        reinterpret_cast<const uint8_t*>(&code), kThreadOverrideStubHookTargetOffset);
+  }
+
+  void Trampoline::Reset(void)
+  {
+    static_assert(
+        sizeof(kHookCodePreamble[0]) == sizeof(code.hook.byte[0]),
+        L"Hook code preamble element size mismatch.");
+    static_assert(
+        sizeof(kTrampolineCodeDefault) == sizeof(code.hook.byte[0]),
+        L"Default instruction size mismatch.");
+
+    for (int i = 0; i < _countof(kHookCodePreamble); ++i)
+      code.hook.byte[i] = kHookCodePreamble[i];
+
+    for (int i = _countof(kHookCodePreamble); i < _countof(code.hook.byte); ++i)
+      code.hook.byte[i] = kTrampolineCodeDefault;
+
+    for (int i = 0; i < _countof(code.original.byte); ++i)
+      code.original.byte[i] = kTrampolineCodeDefault;
+  }
+
+  void Trampoline::SetCallerFilterStub(
+      const SCallerAddressRange* ranges, const void* hookFunc, const void* bypassFunc)
+  {
+    uint8_t* const stubBytes = reinterpret_cast<uint8_t*>(&code);
+
+    for (int i = 0; i < _countof(kCallerFilterStubCode); ++i)
+      stubBytes[i] = kCallerFilterStubCode[i];
+
+    for (int i = _countof(kCallerFilterStubCode); i < kTrampolineSizeBytes; ++i)
+      stubBytes[i] = kTrampolineCodeDefault;
+
+#ifndef _WIN64
+    // In 32-bit mode the table address is loaded by absolute address.
+    const size_t tableAddress = reinterpret_cast<size_t>(&stubBytes[kCallerFilterStubTableOffset]);
+    std::memcpy(
+        &stubBytes[kCallerFilterStubTableOperandOffset], &tableAddress, sizeof(tableAddress));
+#endif
+
+    SetCallerFilterStubRanges(ranges);
+    SetCallerFilterStubTargets(hookFunc, bypassFunc);
+  }
+
+  void Trampoline::SetCallerFilterStubRanges(const SCallerAddressRange* ranges)
+  {
+    uint8_t* const stubBytes = reinterpret_cast<uint8_t*>(&code);
+
+    *reinterpret_cast<volatile size_t*>(&stubBytes[kCallerFilterStubTableOffset]) =
+        reinterpret_cast<size_t>(ranges);
+  }
+
+  void Trampoline::SetCallerFilterStubTargets(const void* hookFunc, const void* bypassFunc)
+  {
+    uint8_t* const stubBytes = reinterpret_cast<uint8_t*>(&code);
+
+    WriteStubJumpTarget(stubBytes, kCallerFilterStubHookTargetOffset, hookFunc);
+    WriteStubJumpTarget(stubBytes, kCallerFilterStubBypassTargetOffset, bypassFunc);
+    TrampolineStore::FlushInstructionCache(&code, sizeof(code));
+
+    HookJournal::Record(
+        {.trampoline = this,
+         .originalFunc = nullptr,
+         .hookFunc = hookFunc,
+         .operation = HookJournal::EOperation::SetHookFunction,
+         .numDecodedBytes = 0,
+         .usedJumpAssist = false,
+         .succeeded = true});
+  }
+
+  void Trampoline::SetCallTraceStub(const void* recorder, const void* traceId)
+  {
+    uint8_t* const stubBytes = reinterpret_cast<uint8_t*>(&code);
+
+    for (int i = 0; i < _countof(kCallTraceStubCode); ++i)
+      stubBytes[i] = kCallTraceStubCode[i];
+
+    for (int i = _countof(kCallTraceStubCode); i < kTrampolineSizeBytes; ++i)
+      stubBytes[i] = kTrampolineCodeDefault;
+
+#ifndef _WIN64
+    // In 32-bit mode the call trace stub pushes its own absolute address.
+    const size_t stubAddress = reinterpret_cast<size_t>(stubBytes);
+    std::memcpy(
+        &stubBytes[kCallTraceStubAddressOperandOffset], &stubAddress, sizeof(stubAddress));
+#endif
+
+    const size_t traceIdValue = reinterpret_cast<size_t>(traceId);
+    std::memcpy(&stubBytes[kCallTraceStubTraceIdOffset], &traceIdValue, sizeof(traceIdValue));
+
+    WriteStubJumpTarget(stubBytes, kCallTraceStubRecorderOffset, recorder);
+  }
+
+  void Trampoline::SetCallTraceStubTarget(const void* targetFunc)
+  {
+    uint8_t* const stubBytes = reinterpret_cast<uint8_t*>(&code);
+
+    *reinterpret_cast<volatile size_t*>(&stubBytes[kCallTraceStubTargetOffset]) =
+        reinterpret_cast<size_t>(targetFunc);
+    TrampolineStore::FlushInstructionCache(&code, sizeof(code));
+
+    HookJournal::Record(
+        {.trampoline = this,
+         .originalFunc = nullptr,
+         .hookFunc = targetFunc,
+         .operation = HookJournal::EOperation::SetHookFunction,
+         .numDecodedBytes = 0,
+         .usedJumpAssist = false,
+         .succeeded = true});
+  }
+
+  void Trampoline::SetProbeStub(
+      const void* dispatcher, const void* callback, const void* context, const void* address)
+  {
+    uint8_t* const stubBytes = reinterpret_cast<uint8_t*>(&code);
+
+    for (int i = 0; i < _countof(kProbeStubCode); ++i)
+      stubBytes[i] = kProbeStubCode[i];
+
+    for (int i = _countof(kProbeStubCode); i < kTrampolineSizeBytes; ++i)
+      stubBytes[i] = kTrampolineCodeDefault;
+
+#ifndef _WIN64
+    const size_t resumeOperand = reinterpret_cast<size_t>(&stubBytes[kProbeStubTargetOffset]);
+    std::memcpy(&stubBytes[kProbeStubResumeOperandOffset], &resumeOperand, sizeof(resumeOperand));
+#endif
+
+    const size_t callbackValue = reinterpret_cast<size_t>(callback);
+    std::memcpy(&stubBytes[kProbeStubCallbackOffset], &callbackValue, sizeof(callbackValue));
+
+    const size_t contextValue = reinterpret_cast<size_t>(context);
+    std::memcpy(&stubBytes[kProbeStubContextOffset], &contextValue, sizeof(contextValue));
+
+    const size_t addressValue = reinterpret_cast<size_t>(address);
+    std::memcpy(&stubBytes[kProbeStubProbeAddressOffset], &addressValue, sizeof(addressValue));
+
+    WriteStubJumpTarget(stubBytes, kProbeStubDispatcherOffset, dispatcher);
+  }
+
+  void Trampoline::SetContextStub(size_t slotOffset, const void* context, const void* hookFunc)
+  {
+    uint8_t* const stubBytes = reinterpret_cast<uint8_t*>(&code);
+
+    for (int i = 0; i < _countof(kContextStubCode); ++i)
+      stubBytes[i] = kContextStubCode[i];
+
+    for (int i = _countof(kContextStubCode); i < kTrampolineSizeBytes; ++i)
+      stubBytes[i] = kTrampolineCodeDefault;
+
+    const uint32_t slotOperand = static_cast<uint32_t>(slotOffset);
+    std::memcpy(&stubBytes[kContextStubSlotOperandOffset], &slotOperand, sizeof(slotOperand));
+
+    const size_t contextValue = reinterpret_cast<size_t>(context);
+    std::memcpy(&stubBytes[kContextStubContextOffset], &contextValue, sizeof(contextValue));
+
+    WriteStubJumpTarget(stubBytes, kContextStubHookTargetOffset, hookFunc);
+    TrampolineStore::FlushInstructionCache(&code, sizeof(code));
+
+    HookJournal::Record(
+        {.trampoline = this,
+         .originalFunc = nullptr,
+         .hookFunc = hookFunc,
+         .operation = HookJournal::EOperation::SetHookFunction,
+         .numDecodedBytes = 0,
+         .usedJumpAssist = false,
+         .succeeded = true});
+  }
+
+  void Trampoline::SetChainTarget(const void* nextFunc)
+  {
+#ifndef _WIN64
+    for (int i = 0; i < _countof(kHookCodePreamble); ++i)
+      code.original.byte[i] = kHookCodePreamble[i];
+#endif
+
+    // The preamble is immediately followed by the jump target, which must not be disturbed in case
+    // this is a change to a live hook chain, so filling starts after it.
+    for (int i = kTrampolineSizeHookFunctionBytes; i < _countof(code.original.byte); ++i)
+      code.original.byte[i] = kTrampolineCodeDefault;
+
+#ifdef _WIN64
+    WriteJumpCode(code.original.qword, nextFunc);
+#else
+    code.original.ptr[kChainTargetIndex] =
+        ComputeJumpDisplacement(&code.original.ptr[kChainTargetIndex + 1], nextFunc);
+#endif
+
+    TrampolineStore::FlushInstructionCache(&code.original, sizeof(code.original));
+  }
+
+  void Trampoline::SetHookCodeTarget(UHookCode* hookCode, const void* hookFunc)
+  {
+#ifdef _WIN64
+    WriteJumpCode(hookCode->qword, hookFunc);
+#else
+    // Rewriting the preamble is harmless if it is already there because the bytes are identical.
+    for (int i = 0; i < _countof(kHookCodePreamble); ++i)
+      hookCode->byte[i] = kHookCodePreamble[i];
+
+    hookCode->ptr[_countof(hookCode->ptr) - 1] =
+        ComputeJumpDisplacement(&hookCode->ptr[_countof(hookCode->ptr)], hookFunc);
+#endif
+    TrampolineStore::FlushInstructionCache(hookCode, sizeof(*hookCode));
+  }
+
+  void Trampoline::SetHookFunction(const void* hookFunc)
+  {
+    SetHookCodeTarget(&code.hook, hookFunc);
+
+    HookJournal::Record(
+        {.trampoline = this,
+         .originalFunc = nullptr,
+         .hookFunc = hookFunc,
+         .operation = HookJournal::EOperation::SetHookFunction,
+         .numDecodedBytes = 0,
+         .usedJumpAssist = false,
+         .succeeded = true});
+  }
+
+  void Trampoline::SetInstrumentationStub(
+      const void* hookFunc, SInstrumentationCounterShard* counterShards)
+  {
+    uint8_t* const stubBytes = reinterpret_cast<uint8_t*>(&code);
+
+    for (int i = 0; i < _countof(kInstrumentationStubCode); ++i)
+      stubBytes[i] = kInstrumentationStubCode[i];
+
+    for (int i = _countof(kInstrumentationStubCode); i < kTrampolineSizeBytes; ++i)
+      stubBytes[i] = kTrampolineCodeDefault;
+
+    stubBytes[kInstrumentationStubShardMaskOffset] =
+        static_cast<uint8_t>(GetNumInstrumentationCounterShards() - 1);
+    std::memcpy(
+        &stubBytes[kInstrumentationStubShardsOffset], &counterShards, sizeof(counterShards));
+
+    SetInstrumentationStubTarget(hookFunc);
+  }
+
+  void Trampoline::SetInstrumentationStubTarget(const void* hookFunc)
+  {
+    uint8_t* const stubBytes = reinterpret_cast<uint8_t*>(&code);
+
+#ifdef _WIN64
+    const size_t targetValue = reinterpret_cast<size_t>(hookFunc);
+#else
+    const size_t targetValue = ComputeJumpDisplacement(
+        &stubBytes[kInstrumentationStubTargetOffset + sizeof(size_t)], hookFunc);
+#endif
+
+    std::memcpy(&stubBytes[kInstrumentationStubTargetOffset], &targetValue, sizeof(targetValue));
+    TrampolineStore::FlushInstructionCache(&code, sizeof(code));
+
+    HookJournal::Record(
+        {.trampoline = this,
+         .originalFunc = nullptr,
+         .hookFunc = hookFunc,
+         .operation = HookJournal::EOperation::SetHookFunction,
+         .numDecodedBytes = 0,
+         .usedJumpAssist = false,
+         .succeeded = true});
+  }
+
+  void Trampoline::SetReentrancyGuardStub(
+      size_t depthOffset, const void* hookFunc, const void* bypassFunc)
+  {
+    uint8_t* const stubBytes = reinterpret_cast<uint8_t*>(&code);
+
+    for (int i = 0; i < _countof(kReentrancyGuardStubCode); ++i)
+      stubBytes[i] = kReentrancyGuardStubCode[i];
+
+    for (int i = _countof(kReentrancyGuardStubCode); i < kTrampolineSizeBytes; ++i)
+      stubBytes[i] = kTrampolineCodeDefault;
+
+    const uint32_t depthOperand = static_cast<uint32_t>(depthOffset);
+    std::memcpy(
+        &stubBytes[kReentrancyGuardStubDepthOperandOffset], &depthOperand, sizeof(depthOperand));
+
+    SetReentrancyGuardStubTargets(hookFunc, bypassFunc);
+  }
+
+  void Trampoline::SetReentrancyGuardStubTargets(const void* hookFunc, const void* bypassFunc)
+  {
+    uint8_t* const stubBytes = reinterpret_cast<uint8_t*>(&code);
+
+    WriteStubJumpTarget(stubBytes, kReentrancyGuardStubHookTargetOffset, hookFunc);
+    WriteStubJumpTarget(stubBytes, kReentrancyGuardStubBypassTargetOffset, bypassFunc);
+    TrampolineStore::FlushInstructionCache(&code, sizeof(code));
+
+    HookJournal::Record(
+        {.trampoline = this,
+         .originalFunc = nullptr,
+         .hookFunc = hookFunc,
+         .operation = HookJournal::EOperation::SetHookFunction,
+         .numDecodedBytes = 0,
+         .usedJumpAssist = false,
+         .succeeded = true});
+  }
+
+  void Trampoline::SetSampledTimingStub(
+      const void* sampler, uint32_t sampleInterval, void* sampleBlock, const void* hookFunc)
+  {
+    uint8_t* const stubBytes = reinterpret_cast<uint8_t*>(&code);
+
+    for (int i = 0; i < _countof(kSampledTimingStubCode); ++i)
+      stubBytes[i] = kSampledTimingStubCode[i];
+
+    for (int i = _countof(kSampledTimingStubCode); i < kTrampolineSizeBytes; ++i)
+      stubBytes[i] = kTrampolineCodeDefault;
+
+#ifndef _WIN64
+    // In 32-bit mode the sampled timing stub refers to its own fields and pushes its own address
+    // using absolute addresses.
+    const size_t countdownAddress =
+        reinterpret_cast<size_t>(&stubBytes[kSampledTimingStubCountdownOffset]);
+    std::memcpy(
+        &stubBytes[kSampledTimingStubCountdownOperandOffset],
+        &countdownAddress,
+        sizeof(countdownAddress));
+
+    const size_t targetAddress =
+        reinterpret_cast<size_t>(&stubBytes[kSampledTimingStubTargetOffset]);
+    std::memcpy(
+        &stubBytes[kSampledTimingStubTargetOperandOffset], &targetAddress, sizeof(targetAddress));
+
+    const size_t stubAddress = reinterpret_cast<size_t>(stubBytes);
+    std::memcpy(
+        &stubBytes[kSampledTimingStubAddressOperandOffset], &stubAddress, sizeof(stubAddress));
+#endif
+
+    const int32_t countdown = static_cast<int32_t>(sampleInterval);
+    std::memcpy(&stubBytes[kSampledTimingStubCountdownOffset], &countdown, sizeof(countdown));
+    std::memcpy(
+        &stubBytes[kSampledTimingStubIntervalOffset], &sampleInterval, sizeof(sampleInterval));
+
+    const size_t sampleBlockValue = reinterpret_cast<size_t>(sampleBlock);
+    std::memcpy(
+        &stubBytes[kSampledTimingStubSampleBlockOffset],
+        &sampleBlockValue,
+        sizeof(sampleBlockValue));
+
+    WriteStubJumpTarget(stubBytes, kSampledTimingStubSamplerOffset, sampler);
+    SetSampledTimingStubTarget(hookFunc);
+  }
+
+  void Trampoline::SetSampledTimingStubTarget(const void* hookFunc)
+  {
+    uint8_t* const stubBytes = reinterpret_cast<uint8_t*>(&code);
+
+    *reinterpret_cast<volatile size_t*>(&stubBytes[kSampledTimingStubTargetOffset]) =
+        reinterpret_cast<size_t>(hookFunc);
+    TrampolineStore::FlushInstructionCache(&code, sizeof(code));
+
+    HookJournal::Record(
+        {.trampoline = this,
+         .originalFunc = nullptr,
+         .hookFunc = hookFunc,
+         .operation = HookJournal::EOperation::SetHookFunction,
+         .numDecodedBytes = 0,
+         .usedJumpAssist = false,
+         .succeeded = true});
+  }
+
+  void Trampoline::SetSampledTimingStubInterval(uint32_t sampleInterval)
+  {
+    uint8_t* const stubBytes = reinterpret_cast<uint8_t*>(&code);
+
+    *reinterpret_cast<volatile uint32_t*>(&stubBytes[kSampledTimingStubIntervalOffset]) =
+        sampleInterval;
+  }
+
+  void Trampoline::SetThreadOverrideStub(
+      size_t tableOffset, size_t overrideIndex, const void* hookFunc)
+  {
+    uint8_t* const stubBytes = reinterpret_cast<uint8_t*>(&code);
+
+    for (int i = 0; i < _countof(kThreadOverrideStubCode); ++i)
+      stubBytes[i] = kThreadOverrideStubCode[i];
+
+    for (int i = _countof(kThreadOverrideStubCode); i < kTrampolineSizeBytes; ++i)
+      stubBytes[i] = kTrampolineCodeDefault;
+
+    const uint32_t tableOperand = static_cast<uint32_t>(tableOffset);
+    std::memcpy(
+        &stubBytes[kThreadOverrideStubTableOperandOffset], &tableOperand, sizeof(tableOperand));
+
+    const uint32_t entryOperand = static_cast<uint32_t>(overrideIndex * sizeof(void*));
+    std::memcpy(
+        &stubBytes[kThreadOverrideStubEntryOperandOffset], &entryOperand, sizeof(entryOperand));
+
+    SetThreadOverrideStubTarget(hookFunc);
+  }
+
+  void Trampoline::SetThreadOverrideStubTarget(const void* hookFunc)
+  {
+    uint8_t* const stubBytes = reinterpret_cast<uint8_t*>(&code);
+
+    WriteStubJumpTarget(stubBytes, kThreadOverrideStubHookTargetOffset, hookFunc);
+    TrampolineStore::FlushInstructionCache(&code, sizeof(code));
+
+    HookJournal::Record(
+        {.trampoline = this,
+         .originalFunc = nullptr,
+         .hookFunc = hookFunc,
+         .operation = HookJournal::EOperation::SetHookFunction,
+         .numDecodedBytes = 0,
+         .usedJumpAssist = false,
+         .succeeded = true});
+  }
+
+  void Trampoline::SetOneShotStub(volatile long* firedFlag, const void* hookFunc)
+  {
+    uint8_t* const stubBytes = reinterpret_cast<uint8_t*>(&code);
+
+    for (int i = 0; i < _countof(kOneShotStubCode); ++i)
+      stubBytes[i] = kOneShotStubCode[i];
+
+    for (int i = _countof(kOneShotStubCode); i < kTrampolineSizeBytes; ++i)
+      stubBytes[i] = kTrampolineCodeDefault;
+
+    const size_t flagOperand = reinterpret_cast<size_t>(firedFlag);
+    std::memcpy(&stubBytes[kOneShotStubFlagOperandOffset], &flagOperand, sizeof(flagOperand));
+
+    WriteStubJumpTarget(stubBytes, kOneShotStubHookTargetOffset, hookFunc);
+    TrampolineStore::FlushInstructionCache(&code, sizeof(code));
+
+    HookJournal::Record(
+        {.trampoline = this,
+         .originalFunc = nullptr,
+         .hookFunc = hookFunc,
+         .operation = HookJournal::EOperation::SetHookFunction,
+         .numDecodedBytes = 0,
+         .usedJumpAssist = false,
+         .succeeded = true});
+  }
+
+  void Trampoline::SetOneShotStubBypass(const void* bypassFunc)
+  {
+    uint8_t* const stubBytes = reinterpret_cast<uint8_t*>(&code);
+
+    WriteStubJumpTarget(stubBytes, kOneShotStubBypassTargetOffset, bypassFunc);
+    TrampolineStore::FlushInstructionCache(&code, sizeof(code));
+  }
+
+  void Trampoline::SetSampledHookStub(uint32_t sampleInterval, const void* hookFunc)
+  {
+    uint8_t* const stubBytes = reinterpret_cast<uint8_t*>(&code);
+
+    for (int i = 0; i < _countof(kSampledHookStubCode); ++i)
+      stubBytes[i] = kSampledHookStubCode[i];
+
+    for (int i = _countof(kSampledHookStubCode); i < kTrampolineSizeBytes; ++i)
+      stubBytes[i] = kTrampolineCodeDefault;
+
+#ifndef _WIN64
+    const auto writeOperand = [stubBytes](size_t operandOffset, size_t dataOffset) -> void
+    {
+      const size_t operand = reinterpret_cast<size_t>(&stubBytes[dataOffset]);
+      std::memcpy(&stubBytes[operandOffset], &operand, sizeof(operand));
+    };
+
+    for (const size_t countdownOperandOffset : kSampledHookStubCountdownOperandOffsets)
+      writeOperand(countdownOperandOffset, kSampledHookStubCountdownOffset);
+
+    writeOperand(kSampledHookStubBypassOperandOffset, kSampledHookStubBypassTargetOffset);
+    writeOperand(kSampledHookStubIntervalOperandOffset, kSampledHookStubIntervalOffset);
+    writeOperand(kSampledHookStubHookOperandOffset, kSampledHookStubHookTargetOffset);
+#endif
+
+    const size_t hookTargetValue = reinterpret_cast<size_t>(hookFunc);
+    std::memcpy(
+        &stubBytes[kSampledHookStubHookTargetOffset], &hookTargetValue, sizeof(hookTargetValue));
+
+    SetSampledHookStubInterval(sampleInterval);
+    TrampolineStore::FlushInstructionCache(&code, sizeof(code));
+
+    HookJournal::Record(
+        {.trampoline = this,
+         .originalFunc = nullptr,
+         .hookFunc = hookFunc,
+         .operation = HookJournal::EOperation::SetHookFunction,
+         .numDecodedBytes = 0,
+         .usedJumpAssist = false,
+         .succeeded = true});
+  }
+
+  void Trampoline::SetSampledHookStubBypass(const void* bypassFunc)
+  {
+    uint8_t* const stubBytes = reinterpret_cast<uint8_t*>(&code);
+
+    *reinterpret_cast<volatile size_t*>(&stubBytes[kSampledHookStubBypassTargetOffset]) =
+        reinterpret_cast<size_t>(bypassFunc);
+    TrampolineStore::FlushInstructionCache(&code, sizeof(code));
+  }
+
+  void Trampoline::SetSampledHookStubInterval(uint32_t sampleInterval)
+  {
+    uint8_t* const stubBytes = reinterpret_cast<uint8_t*>(&code);
+
+    // The countdown is reset as well so that a much shorter interval takes effect immediately
+    // rather than after the remainder of the previous interval.
+    *reinterpret_cast<volatile uint32_t*>(&stubBytes[kSampledHookStubIntervalOffset]) =
+        sampleInterval;
+    *reinterpret_cast<volatile uint32_t*>(&stubBytes[kSampledHookStubCountdownOffset]) =
+        sampleInterval;
+  }
+
+  /// Determines how many bytes of the original function region of a trampoline hold the
+  /// transplanted form of an instruction from the original function. This is normally the length
+  /// of a single instruction, but an instruction with a RIP-relative operand that was rewritten to
+  /// use an absolute address is transplanted as a load of its destination register from an address
+  /// slot followed by the instruction itself, which is recognized by the load referring to
+  /// something other than the original target.
+  /// @param [in] originalInstruction Decoded instruction from the original function.
+  /// @param [in] transplantedInstruction Decoded instruction at the corresponding location in the
+  /// trampoline.
+  /// @return Number of bytes, or -1 if the transplanted form could not be decoded.
+  static int TransplantedInstructionLengthBytes(
+      X86Instruction& originalInstruction, X86Instruction& transplantedInstruction)
+  {
+    if ((false == originalInstruction.HasPositionDependentMemoryReference()) ||
+        (true == originalInstruction.HasRelativeBranchDisplacement()) ||
+        (transplantedInstruction.GetAbsoluteMemoryReferenceTarget() ==
+         originalInstruction.GetAbsoluteMemoryReferenceTarget()))
+      return transplantedInstruction.GetLengthBytes();
+
+    const uint8_t* const sequenceBytes =
+        reinterpret_cast<const uint8_t*>(transplantedInstruction.GetAddress());
+    const int loadLengthBytes = transplantedInstruction.GetLengthBytes();
+
+    X86Instruction rewrittenInstruction;
+    if (false == rewrittenInstruction.DecodeInstruction(&sequenceBytes[loadLengthBytes]))
+      return -1;
+
+    return loadLengthBytes + rewrittenInstruction.GetLengthBytes();
+  }
+
+  /// Reads a position-dependent displacement value directly from the binary representation of an
+  /// instruction.
+  /// @param [in] displacementBytes Location of the displacement within the instruction.
+  /// @param [in] displacementWidthBytes Width of the displacement, in bytes.
+  /// @return Sign-extended displacement value, or X86Instruction::kInvalidMemoryDisplacement if the
+  /// width is not supported.
+  static int64_t ReadDisplacement(const uint8_t* displacementBytes, int displacementWidthBytes)
+  {
+    switch (displacementWidthBytes)
+    {
+      case sizeof(int8_t):
+        return static_cast<int64_t>(static_cast<int8_t>(displacementBytes[0]));
+
+      case sizeof(int16_t):
+      {
+        int16_t displacement = 0;
+        std::memcpy(&displacement, displacementBytes, sizeof(displacement));
+        return static_cast<int64_t>(displacement);
+      }
+
+      case sizeof(int32_t):
+      {
+        int32_t displacement = 0;
+        std::memcpy(&displacement, displacementBytes, sizeof(displacement));
+        return static_cast<int64_t>(displacement);
+      }
+
+      default:
+        return X86Instruction::kInvalidMemoryDisplacement;
+    }
+  }
+
+  /// Writes a position-dependent displacement value directly into the binary representation of an
+  /// instruction, provided that it fits.
+  /// @param [out] displacementBytes Location of the displacement within the instruction.
+  /// @param [in] displacementWidthBytes Width of the displacement, in bytes.
+  /// @param [in] displacement Displacement value to write.
+  /// @return `true` if the displacement was written, `false` if it does not fit.
+  static bool WriteDisplacement(
+      uint8_t* displacementBytes, int displacementWidthBytes, int64_t displacement)
+  {
+    switch (displacementWidthBytes)
+    {
+      case sizeof(int8_t):
+        if ((displacement < INT8_MIN) || (displacement > INT8_MAX)) return false;
+        displacementBytes[0] = static_cast<uint8_t>(static_cast<int8_t>(displacement));
+        return true;
+
+      case sizeof(int16_t):
+      {
+        if ((displacement < INT16_MIN) || (displacement > INT16_MAX)) return false;
+        const int16_t narrowDisplacement = static_cast<int16_t>(displacement);
+        std::memcpy(displacementBytes, &narrowDisplacement, sizeof(narrowDisplacement));
+        return true;
+      }
+
+      case sizeof(int32_t):
+      {
+        if ((displacement < INT32_MIN) || (displacement > INT32_MAX)) return false;
+        const int32_t narrowDisplacement = static_cast<int32_t>(displacement);
+        std::memcpy(displacementBytes, &narrowDisplacement, sizeof(narrowDisplacement));
+        return true;
+      }
+
+      default:
+        return false;
+    }
+  }
+
+  /// Fills a position-independent description of the specified decoded instruction for inclusion
+  /// in a hook plan.
+  /// @param [in] instruction Decoded instruction to describe.
+  /// @param [out] planInstruction Filled with the description.
+  /// @return `true` if the instruction can be described, `false` if its displacement cannot be
+  /// located with certainty.
+  static bool DescribeInstructionForHookPlan(
+      X86Instruction& instruction, Trampoline::SHookPlanInstruction* planInstruction)
+  {
+    *planInstruction = {
+        .lengthBytes = static_cast<uint8_t>(instruction.GetLengthBytes()),
+        .displacementOffsetBytes = 0,
+        .displacementWidthBytes = 0,
+        .isRelativeBranch = false,
+        .isTerminal = instruction.IsTerminal()};
+
+    if (false == instruction.HasPositionDependentMemoryReference()) return true;
+
+    const int displacementWidthBytes = instruction.GetMemoryDisplacementWidthBits() / 8;
+    const int displacementOffsetBytes = instruction.GetMemoryDisplacementOffsetBytes();
+    if ((displacementOffsetBytes < 0) ||
+        ((displacementOffsetBytes + displacementWidthBytes) > instruction.GetLengthBytes()))
+      return false;
+
+    // A hook plan is applied by patching the displacement where it is expected to be, so it had
+    // better actually be there.
+    if (instruction.GetMemoryDisplacement() !=
+        ReadDisplacement(
+            &reinterpret_cast<const uint8_t*>(instruction.GetAddress())[displacementOffsetBytes],
+            displacementWidthBytes))
+      return false;
+
+    planInstruction->displacementOffsetBytes = static_cast<uint8_t>(displacementOffsetBytes);
+    planInstruction->displacementWidthBytes = static_cast<uint8_t>(displacementWidthBytes);
+    planInstruction->isRelativeBranch = instruction.HasRelativeBranchDisplacement();
+    return true;
+  }
+
+#ifdef _WIN64
+  /// Unwind information flag indicating that it continues in another function table entry, which
+  /// means that it describes only part of a function.
+  static constexpr uint8_t kUnwindFlagChainInfo = 0x04;
+
+  /// Function table entry flag, set in the unwind data offset, indicating that the entry refers to
+  /// another function table entry rather than to unwind information.
+  static constexpr DWORD kRuntimeFunctionIndirect = 0x00000001;
+
+  /// Unwind operation codes used in x64 unwind information.
+  enum class EUnwindOp : uint8_t
+  {
+    PushNonvol = 0,
+    AllocLarge = 1,
+    AllocSmall = 2,
+    SetFpreg = 3,
+    SaveNonvol = 4,
+    SaveNonvolFar = 5,
+    Epilog = 6,
+    SaveXmm128 = 8,
+    SaveXmm128Far = 9,
+    PushMachframe = 10
+  };
+
+  /// Looks up the function table entry that covers the specified address. Function table entries
+  /// come from the `.pdata` section of the module that contains the address, or from function
+  /// tables registered at runtime. Leaf functions that do not touch the stack have none.
+  /// @param [in] address Address to look up.
+  /// @param [out] imageBase Filled with the base address relative to which the function table
+  /// entry is expressed.
+  /// @return Function table entry, or `nullptr` if no function table entry covers the address.
+  static const RUNTIME_FUNCTION* LookupFunctionEntry(const void* address, DWORD64* imageBase)
+  {
+    return Protected::Windows_RtlLookupFunctionEntry(
+        reinterpret_cast<DWORD64>(address), imageBase, nullptr);
+  }
+
+  /// Determines how many bytes of the function that contains the specified address remain, from
+  /// that address to the end of the function, according to the function table.
+  /// @param [in] address Address within the function.
+  /// @return Number of bytes remaining, or -1 if the function table does not cover the address.
+  static int FunctionBytesRemaining(const void* address)
+  {
+    DWORD64 imageBase = 0;
+    const RUNTIME_FUNCTION* const functionEntry = LookupFunctionEntry(address, &imageBase);
+    if (nullptr == functionEntry) return -1;
+
+    return static_cast<int>(
+        (imageBase + functionEntry->EndAddress) - reinterpret_cast<DWORD64>(address));
+  }
+
+  /// Determines whether the function table shows that the function at the specified address is
+  /// too short to hold a jump instruction because another function begins before enough bytes are
+  /// available. No amount of decoding or padding can make such a function hookable.
+  /// @param [in] originalFunc Original function address.
+  /// @return `true` if so, `false` if not or if the function table does not say.
+  static bool IsFunctionTooShortForJump(const void* originalFunc)
+  {
+    const int numFunctionBytesRemaining = FunctionBytesRemaining(originalFunc);
+    if ((numFunctionBytesRemaining < 0) ||
+        (numFunctionBytesRemaining >= X86Instruction::kJumpInstructionLengthBytes))
+      return false;
+
+    const uint8_t* const originalFunctionBytes = reinterpret_cast<const uint8_t*>(originalFunc);
+    for (int i = numFunctionBytesRemaining; i < X86Instruction::kJumpInstructionLengthBytes; ++i)
+    {
+      DWORD64 unusedImageBase = 0;
+      if (nullptr != LookupFunctionEntry(&originalFunctionBytes[i], &unusedImageBase)) return true;
+    }
+
+    return false;
+  }
+
+  /// Determines the number of slots occupied by an unwind code, based on its operation.
+  /// @param [in] unwindCode First slot of the unwind code.
+  /// @param [in] unwindInfoVersion Version of the unwind information that contains the code.
+  /// @return Number of slots, or 0 if the unwind code is not recognized.
+  static int UnwindCodeSlotCount(uint16_t unwindCode, uint8_t unwindInfoVersion)
+  {
+    const EUnwindOp unwindOp = static_cast<EUnwindOp>((unwindCode >> 8) & 0x0f);
+    const uint8_t unwindOpInfo = static_cast<uint8_t>(unwindCode >> 12);
+
+    switch (unwindOp)
+    {
+      case EUnwindOp::PushNonvol:
+      case EUnwindOp::AllocSmall:
+      case EUnwindOp::SetFpreg:
+      case EUnwindOp::PushMachframe:
+        return 1;
+
+      case EUnwindOp::AllocLarge:
+        return ((0 == unwindOpInfo) ? 2 : 3);
+
+      case EUnwindOp::SaveNonvol:
+      case EUnwindOp::SaveXmm128:
+        return 2;
+
+      case EUnwindOp::SaveNonvolFar:
+      case EUnwindOp::SaveXmm128Far:
+        return 3;
+
+      case EUnwindOp::Epilog:
+        // Epilogue descriptors only exist starting with version 2. In version 1, the same
+        // operation code had a different meaning and is no longer produced.
+        return ((unwindInfoVersion >= 2) ? 1 : 0);
+
+      default:
+        return 0;
+    }
+  }
+
+  bool Trampoline::BuildOriginalFunctionUnwindInfo(
+      const void* originalFunc, size_t sizeBytesUsed, SUnwindInfo* unwindInfo) const
+  {
+    // Unwind codes describe the prologue relative to the beginning of the function, so nothing can
+    // be adapted unless the hook is placed exactly there.
+    DWORD64 imageBase = 0;
+    const RUNTIME_FUNCTION* const functionEntry = LookupFunctionEntry(originalFunc, &imageBase);
+    if (nullptr == functionEntry) return false;
+    if ((imageBase + functionEntry->BeginAddress) != reinterpret_cast<DWORD64>(originalFunc))
+      return false;
+    if (0 != (functionEntry->UnwindData & kRuntimeFunctionIndirect)) return false;
+
+    const uint8_t* const originalUnwindInfo =
+        reinterpret_cast<const uint8_t*>(imageBase + functionEntry->UnwindData);
+    const uint8_t originalVersion = originalUnwindInfo[0] & 0x07;
+    const uint8_t originalFlags = originalUnwindInfo[0] >> 3;
+    const int numOriginalCodeSlots = originalUnwindInfo[2];
+    const uint16_t* const originalUnwindCodes =
+        reinterpret_cast<const uint16_t*>(&originalUnwindInfo[4]);
+
+    if ((originalVersion < 1) || (originalVersion > 2)) return false;
+    if (0 != (originalFlags & kUnwindFlagChainInfo)) return false;
+
+    // Unwind codes identify prologue instructions by the offset of the byte that follows them, so
+    // every instruction boundary within the transplanted code is needed both in the original
+    // function and in this trampoline. Lengths can differ if any instructions were re-encoded or
+    // rewritten, so both instruction streams are decoded in lockstep.
+    int originalBoundaries[X86Instruction::kJumpInstructionLengthBytes + 1] = {};
+    int trampolineBoundaries[X86Instruction::kJumpInstructionLengthBytes + 1] = {};
+    int numBoundaries = 1;
+
+    const uint8_t* const originalFunctionBytes = reinterpret_cast<const uint8_t*>(originalFunc);
+    while (originalBoundaries[numBoundaries - 1] < X86Instruction::kJumpInstructionLengthBytes)
+    {
+      X86Instruction originalInstruction;
+      if (false ==
+          originalInstruction.DecodeInstruction(
+              &originalFunctionBytes[originalBoundaries[numBoundaries - 1]]))
+        return false;
+
+      X86Instruction transplantedInstruction;
+      if (false ==
+          transplantedInstruction.DecodeInstruction(
+              &code.original.byte[trampolineBoundaries[numBoundaries - 1]]))
+        return false;
+
+      const int transplantedLengthBytes =
+          TransplantedInstructionLengthBytes(originalInstruction, transplantedInstruction);
+      if (transplantedLengthBytes < 0) return false;
+
+      originalBoundaries[numBoundaries] =
+          originalBoundaries[numBoundaries - 1] + originalInstruction.GetLengthBytes();
+      trampolineBoundaries[numBoundaries] =
+          trampolineBoundaries[numBoundaries - 1] + transplantedLengthBytes;
+      numBoundaries += 1;
+
+      if (true == originalInstruction.IsTerminal()) break;
+    }
+
+    const int numTransplantedBytes = originalBoundaries[numBoundaries - 1];
+
+    // Only unwind codes for transplanted instructions are kept. The rest describe instructions that
+    // execute in the original function after the trampoline jumps back to it.
+    *unwindInfo = {};
+    int numCodeSlots = 0;
+    bool hasFrameRegister = false;
+
+    for (int i = 0; i < numOriginalCodeSlots;)
+    {
+      const uint16_t originalUnwindCode = originalUnwindCodes[i];
+      const int numSlots = UnwindCodeSlotCount(originalUnwindCode, originalVersion);
+      if ((0 == numSlots) || ((i + numSlots) > numOriginalCodeSlots)) return false;
+
+      const EUnwindOp unwindOp = static_cast<EUnwindOp>((originalUnwindCode >> 8) & 0x0f);
+      const int codeOffset = originalUnwindCode & 0xff;
+
+      if ((EUnwindOp::Epilog != unwindOp) && (codeOffset <= numTransplantedBytes))
+      {
+        const int boundaryIndex = static_cast<int>(
+            std::find(&originalBoundaries[0], &originalBoundaries[numBoundaries], codeOffset) -
+            &originalBoundaries[0]);
+        if (numBoundaries == boundaryIndex) return false;
+        if ((numCodeSlots + numSlots) > kMaxUnwindCodeSlots) return false;
+
+        unwindInfo->unwindCode[numCodeSlots] = static_cast<uint16_t>(
+            (originalUnwindCode & 0xff00) | trampolineBoundaries[boundaryIndex]);
+        for (int j = 1; j < numSlots; ++j)
+          unwindInfo->unwindCode[numCodeSlots + j] = originalUnwindCodes[i + j];
+
+        numCodeSlots += numSlots;
+        if (EUnwindOp::SetFpreg == unwindOp) hasFrameRegister = true;
+      }
+
+      i += numSlots;
+    }
+
+    // Nothing transplanted touches the stack, so this trampoline unwinds correctly as a leaf
+    // function, which is what the operating system assumes of code without unwind information.
+    if (0 == numCodeSlots) return false;
+
+    // The whole original function region, including the jump back to the original function and any
+    // jump assists, is presented as prologue. Unwind codes are then applied based only on how far
+    // execution has progressed, and the jump back is never mistaken for part of an epilogue.
+    unwindInfo->versionAndFlags = 1;
+    unwindInfo->sizeOfPrologBytes =
+        static_cast<uint8_t>(sizeBytesUsed - kTrampolineSizeHookFunctionBytes);
+    unwindInfo->countOfCodes = static_cast<uint8_t>(numCodeSlots);
+    unwindInfo->frameRegisterAndOffset = ((true == hasFrameRegister) ? originalUnwindInfo[3] : 0);
+    return true;
   }
+#endif
 
-  void Trampoline::Reset(void)
+  void Trampoline::CountOriginalFunctionRelocations(
+      const SDecodedOriginalFunction& decoded, int* numRelocations, int* numJumpAssists)
   {
-    static_assert(
-        sizeof(kHookCodePreamble[0]) == sizeof(code.hook.byte[0]),
-        L"Hook code preamble element size mismatch.");
-    static_assert(
-        sizeof(kTrampolineCodeDefault) == sizeof(code.hook.byte[0]),
-        L"Default instruction size mismatch.");
+    *numRelocations = 0;
+    *numJumpAssists = 0;
 
-    for (int i = 0; i < _countof(kHookCodePreamble); ++i)
-      code.hook.byte[i] = kHookCodePreamble[i];
+    int numOriginalFunctionBytesExamined = 0;
+    for (int i = 0; i < decoded.numInstructions; ++i)
+    {
+      int instructionLengthBytes = 0;
+      int displacementWidthBytes = 0;
+      int64_t displacement = 0;
+      bool isRelativeBranch = false;
 
-    for (int i = _countof(kHookCodePreamble); i < _countof(code.hook.byte); ++i)
-      code.hook.byte[i] = kTrampolineCodeDefault;
+      if (true == decoded.hasHookPlan)
+      {
+        const SHookPlanInstruction& planInstruction = decoded.planInstructions[i];
+        instructionLengthBytes = static_cast<int>(planInstruction.lengthBytes);
+        displacementWidthBytes = static_cast<int>(planInstruction.displacementWidthBytes);
+        isRelativeBranch = planInstruction.isRelativeBranch;
+        if (0 != displacementWidthBytes)
+          displacement = ReadDisplacement(
+              &decoded.examinedBytes
+                   [numOriginalFunctionBytesExamined + planInstruction.displacementOffsetBytes],
+              displacementWidthBytes);
+      }
+      else
+      {
+        // Querying the position-dependent memory reference is not a const operation, so the
+        // decoded instruction is copied.
+        X86Instruction instruction = decoded.instructions[i];
+        instructionLengthBytes = instruction.GetLengthBytes();
+        if (true == instruction.HasPositionDependentMemoryReference())
+        {
+          displacementWidthBytes = instruction.GetMemoryDisplacementWidthBits() / 8;
+          displacement = instruction.GetMemoryDisplacement();
+          isRelativeBranch = instruction.HasRelativeBranchDisplacement();
+        }
+      }
 
-    for (int i = 0; i < _countof(code.original.byte); ++i)
-      code.original.byte[i] = kTrampolineCodeDefault;
+      numOriginalFunctionBytesExamined += instructionLengthBytes;
+      if (0 == displacementWidthBytes) continue;
+
+      // Same rule as when transplanting: displacements that refer to another transplanted
+      // instruction do not need to be modified.
+      const int64_t minForwardDisplacementNeedingModification =
+          static_cast<int64_t>(decoded.numDecodedBytes - numOriginalFunctionBytesExamined);
+      const int64_t minBackwardDisplacementNotNeedingModification =
+          static_cast<int64_t>(-1 * numOriginalFunctionBytesExamined);
+      if ((displacement < minForwardDisplacementNeedingModification) &&
+          (displacement >= minBackwardDisplacementNotNeedingModification))
+        continue;
+
+      *numRelocations += 1;
+      if ((true == isRelativeBranch) &&
+          (displacementWidthBytes < static_cast<int>(sizeof(int32_t))))
+        *numJumpAssists += 1;
+    }
   }
 
-  void Trampoline::SetHookFunction(const void* hookFunc)
+  bool Trampoline::DecodeOriginalFunction(
+      const void* originalFunc, SDecodedOriginalFunction* decoded)
   {
-    Infra::Message::OutputFormatted(
-        Infra::Message::ESeverity::Info,
-        L"Trampoline at 0x%llx is being set up with hook function 0x%llx.",
-        (long long)this,
-        (long long)hookFunc);
-    code.hook.ptr[_countof(code.hook.ptr) - 1] = ValueForHookAddress(hookFunc);
-    Protected::Windows_FlushInstructionCache(
-        Infra::ProcessInfo::GetCurrentProcessHandle(), &code.hook, sizeof(code.hook));
+    decoded->originalFunc = originalFunc;
+    decoded->isHotPatchable = X86Instruction::IsHotPatchable(originalFunc);
+    decoded->isSyscallStub = false;
+    decoded->numInstructions = 0;
+    decoded->numDecodedBytes = 0;
+    decoded->numExaminedBytes = 0;
+    decoded->hasHookPlan = false;
+    decoded->isFromHookPlan = false;
+
+    // Nothing is transplanted from functions laid out for hot-patching, so there is nothing to
+    // decode either.
+    if (true == decoded->isHotPatchable)
+    {
+      decoded->numDecodedBytes = X86Instruction::kHotPatchEntryLengthBytes;
+      return true;
+    }
+
+    // System call stubs differ only in their system call numbers, so nothing needs to be decoded to
+    // generate a copy. The whole stub is examined, as far as possible, so that a stub modified in
+    // the meantime is not mistaken for an unmodified one.
+    if (true == X86Instruction::DecodeSyscallStub(originalFunc, &decoded->syscallStub))
+    {
+      decoded->isSyscallStub = true;
+      decoded->numDecodedBytes = X86Instruction::kSyscallStubPrologueLengthBytes;
+      decoded->numExaminedBytes =
+          std::min(decoded->syscallStub.lengthBytes, kMaxOriginalFunctionBytesExamined);
+      std::memcpy(decoded->examinedBytes, originalFunc, decoded->numExaminedBytes);
+
+      if (true == MappedLog::IsDebugOutputLive())
+        MappedLog::OutputFormatted(
+            Infra::Message::ESeverity::Debug,
+            L"Recognized a %d-byte system call stub for system call 0x%x at 0x%llx.",
+            decoded->syscallStub.lengthBytes,
+            (unsigned int)decoded->syscallStub.syscallNumber,
+            (long long)originalFunc);
+      return true;
+    }
+
+#ifdef _WIN64
+    if (true == IsFunctionTooShortForJump(originalFunc))
+    {
+      if (true == MappedLog::IsDebugOutputLive())
+        MappedLog::OutputFormatted(
+            Infra::Message::ESeverity::Debug,
+            L"Function table shows that the function at 0x%llx is followed by another function before there is space for a jump. Bailing.",
+            (long long)originalFunc);
+      return false;
+    }
+#endif
+
+    if (true == HookPlanCache::LookupHookPlan(originalFunc, decoded))
+    {
+      if (true == MappedLog::IsDebugOutputLive())
+        MappedLog::OutputFormatted(
+            Infra::Message::ESeverity::Debug,
+            L"Using a cached hook plan for 0x%llx, which covers %d instruction(s) in %d byte(s).",
+            (long long)originalFunc,
+            decoded->numInstructions,
+            decoded->numDecodedBytes);
+      return true;
+    }
+
+    if (true == DecodeOriginalFunctionCommonPrologue(originalFunc, decoded))
+    {
+      if (true == MappedLog::IsDebugOutputLive())
+        MappedLog::OutputFormatted(
+            Infra::Message::ESeverity::Debug,
+            L"Recognized a common prologue at 0x%llx, which covers %d instruction(s) in %d byte(s).",
+            (long long)originalFunc,
+            decoded->numInstructions,
+            decoded->numDecodedBytes);
+      return true;
+    }
+
+    if (false == DecodeOriginalFunctionInstructions(originalFunc, decoded)) return false;
+
+    if (true == decoded->hasHookPlan) HookPlanCache::RecordHookPlan(*decoded);
+
+    return true;
   }
 
-  bool Trampoline::SetOriginalFunction(const void* originalFunc)
+  bool Trampoline::DecodeOriginalFunctionCommonPrologue(
+      const void* originalFunc, SDecodedOriginalFunction* decoded)
   {
-    Infra::Message::OutputFormatted(
-        Infra::Message::ESeverity::Info,
-        L"Trampoline at 0x%llx is being set up with original function 0x%llx.",
-        (long long)this,
-        (long long)originalFunc);
+    const uint8_t* const originalFunctionBytes = reinterpret_cast<const uint8_t*>(originalFunc);
+    int numOriginalFunctionBytes = 0;
+    int instructionIndex = 0;
 
-    // Sanity check. Make sure the original function is not too far away from this trampoline.
-    if (false == X86Instruction::CanWriteJumpInstruction(originalFunc, &code.hook))
+    while (numOriginalFunctionBytes < X86Instruction::kJumpInstructionLengthBytes)
     {
-      Infra::Message::OutputFormatted(
-          Infra::Message::ESeverity::Warning,
-          L"Set hook failed for function %llx because it is too far from the trampoline.",
-          (long long)originalFunc);
-      return false;
+      SHookPlanInstruction& planInstruction = decoded->planInstructions[instructionIndex];
+      if (false ==
+          X86Instruction::ClassifyCommonInstruction(
+              &originalFunctionBytes[numOriginalFunctionBytes], &planInstruction))
+        return false;
+
+      numOriginalFunctionBytes += planInstruction.lengthBytes;
+      instructionIndex += 1;
+
+      if (true == planInstruction.isTerminal) break;
     }
 
-    // This operation requires transplanting code from the location of the original function into
-    // the original function part of the trampoline. This is done in several sub-parts, and more
-    // details will be provided while executing each sub-part.
+    // Determining whether the bytes after a terminal instruction are padding is left to the
+    // decoder, so a terminal instruction is only acceptable if there is already enough space.
+    if (numOriginalFunctionBytes < X86Instruction::kJumpInstructionLengthBytes) return false;
 
-    // First, read and decode instructions until either enough bytes worth of instructions are
-    // decoded to hold an unconditional jump or a terminal instruction is hit. If the latter happens
-    // strictly before the former, and no extra padding space can be found, then setting this hook
-    // failed due to there not being enough bytes of function to transplant.
+    decoded->numInstructions = instructionIndex;
+    decoded->numDecodedBytes = numOriginalFunctionBytes;
+    decoded->numExaminedBytes = numOriginalFunctionBytes;
+    std::memcpy(decoded->examinedBytes, originalFunctionBytes, numOriginalFunctionBytes);
+    decoded->hasHookPlan = true;
+    decoded->isFromHookPlan = true;
+    return true;
+  }
 
-    // Second, iterate through all the decoded instructions and check for position-dependent memory
-    // references. Update the displacements as needed for any such decoded instructions. If that is
-    // not possible for even one instruction, then setting this hook failed.
+  bool Trampoline::DecodeOriginalFunctionInstructions(
+      const void* originalFunc, SDecodedOriginalFunction* decoded)
+  {
+    const bool debugOutputLive = MappedLog::IsDebugOutputLive();
 
-    // Third, encode the decoded instructions into this trampoline's original function region. If
-    // needed (i.e. the last of the decoded instructions is non-terminal), append an unconditional
-    // jump instruction to the correct address within the original function. This will be completed
-    // at the same time as the second sub-part.
+    decoded->originalFunc = originalFunc;
+    decoded->isHotPatchable = false;
+    decoded->isSyscallStub = false;
+    decoded->numInstructions = 0;
+    decoded->numDecodedBytes = 0;
+    decoded->numExaminedBytes = 0;
+    decoded->hasHookPlan = true;
+    decoded->isFromHookPlan = false;
 
-    // First sub-part.
+    // Read and decode instructions until either enough bytes worth of instructions are decoded to
+    // hold an unconditional jump or a terminal instruction is hit. If the latter happens strictly
+    // before the former, and no extra padding space can be found, then setting this hook failed
+    // due to there not being enough bytes of function to transplant.
     const uint8_t* originalFunctionBytes = reinterpret_cast<const uint8_t*>(originalFunc);
     constexpr int numOriginalFunctionBytesNeeded = X86Instruction::kJumpInstructionLengthBytes;
     int numOriginalFunctionBytes = 0;
     int instructionIndex = 0;
-    std::vector<X86Instruction> originalInstructions;
 
-    Infra::Message::OutputFormatted(
-        Infra::Message::ESeverity::Debug,
-        L"Starting to decode instructions at 0x%llx, need %d bytes.",
-        (long long)originalFunc,
-        numOriginalFunctionBytesNeeded);
+    // The decoded instructions are held in a fixed-capacity buffer, which avoids any heap
+    // allocation.
+    X86Instruction* const originalInstructions = decoded->instructions;
+
+    if (true == debugOutputLive)
+      MappedLog::OutputFormatted(
+          Infra::Message::ESeverity::Debug,
+          L"Starting to decode instructions at 0x%llx, need %d bytes.",
+          (long long)originalFunc,
+          numOriginalFunctionBytesNeeded);
 
     while (numOriginalFunctionBytes < numOriginalFunctionBytesNeeded)
     {
-      X86Instruction& decodedInstruction = originalInstructions.emplace_back();
+      X86Instruction& decodedInstruction = originalInstructions[instructionIndex];
       decodedInstruction.DecodeInstruction(&originalFunctionBytes[numOriginalFunctionBytes]);
 
       if (false == decodedInstruction.IsValid())
       {
-        Infra::Message::OutputFormatted(
-            Infra::Message::ESeverity::Debug,
-            L"Instruction %d - Invalid instruction.",
-            instructionIndex);
+        if (true == debugOutputLive)
+          MappedLog::OutputFormatted(
+              Infra::Message::ESeverity::Debug,
+              L"Instruction %d - Invalid instruction.",
+              instructionIndex);
         return false;
       }
 
-      if (Infra::Message::WillOutputMessageOfSeverity(Infra::Message::ESeverity::Debug))
+      if (true == decoded->hasHookPlan)
+        decoded->hasHookPlan = DescribeInstructionForHookPlan(
+            decodedInstruction, &decoded->planInstructions[instructionIndex]);
+
+      if (true == debugOutputLive)
       {
         Infra::TemporaryBuffer<wchar_t> disassembly;
         const bool disassemblyResult =
             decodedInstruction.PrintDisassembly(disassembly.Data(), disassembly.Capacity());
-        Infra::Message::OutputFormatted(
+        MappedLog::OutputFormatted(
             Infra::Message::ESeverity::Debug,
             L"Instruction %d - Decoded %d-byte instruction \"%s\"",
             instructionIndex,
@@ -195,7 +2612,7 @@ namespace Hookshot
             ((true == disassemblyResult) ? &disassembly[0] : kDisassemblyFailedString.data()));
 
         if (decodedInstruction.IsTerminal())
-          Infra::Message::OutputFormatted(
+          MappedLog::OutputFormatted(
               Infra::Message::ESeverity::Debug,
               L"Instruction %d - This is a terminal instruction.",
               instructionIndex);
@@ -203,10 +2620,13 @@ namespace Hookshot
 
       numOriginalFunctionBytes += decodedInstruction.GetLengthBytes();
       instructionIndex += 1;
+      decoded->numDecodedBytes = numOriginalFunctionBytes;
 
       if (decodedInstruction.IsTerminal()) break;
     }
 
+    decoded->numInstructions = instructionIndex;
+
     if (numOriginalFunctionBytes < numOriginalFunctionBytesNeeded)
     {
       // Unable to decode a sufficient number of bytes worth of original function instructions. The
@@ -217,18 +2637,28 @@ namespace Hookshot
 
       const int numBytesShort = numOriginalFunctionBytesNeeded - numOriginalFunctionBytes;
 
+      // Bytes that the function table shows to be part of the function are never padding, even if
+      // they look like it, because other parts of the function might branch to them.
+#ifdef _WIN64
+      const bool isFunctionContinuing =
+          (FunctionBytesRemaining(originalFunc) > numOriginalFunctionBytes);
+#else
+      constexpr bool isFunctionContinuing = false;
+#endif
+
       X86Instruction hopefullyPaddingInstruction;
       hopefullyPaddingInstruction.DecodeInstruction(
           &originalFunctionBytes[numOriginalFunctionBytes]);
 
-      if (hopefullyPaddingInstruction.IsPaddingWithLengthAtLeast(numBytesShort))
+      if ((false == isFunctionContinuing) &&
+          (hopefullyPaddingInstruction.IsPaddingWithLengthAtLeast(numBytesShort)))
       {
-        if (Infra::Message::WillOutputMessageOfSeverity(Infra::Message::ESeverity::Debug))
+        if (true == debugOutputLive)
         {
           Infra::TemporaryBuffer<wchar_t> disassembly;
           const bool disassemblyResult = hopefullyPaddingInstruction.PrintDisassembly(
               disassembly.Data(), disassembly.Capacity());
-          Infra::Message::OutputFormatted(
+          MappedLog::OutputFormatted(
               Infra::Message::ESeverity::Debug,
               L"Decoded a total of %d byte(s), needed %d. This is insufficient, but at least %d byte(s) of padding instruction \"%s\" are available. Proceeding.",
               numOriginalFunctionBytes,
@@ -239,212 +2669,470 @@ namespace Hookshot
       }
       else
       {
-        Infra::Message::OutputFormatted(
+        if (true == debugOutputLive)
+          MappedLog::OutputFormatted(
+              Infra::Message::ESeverity::Debug,
+              L"Decoded a total of %d byte(s), needed %d. This is insufficient, and padding bytes could not be used. Bailing.",
+              numOriginalFunctionBytes,
+              numOriginalFunctionBytesNeeded);
+        return false;
+      }
+    }
+    else
+    {
+      if (true == debugOutputLive)
+        MappedLog::OutputFormatted(
             Infra::Message::ESeverity::Debug,
-            L"Decoded a total of %d byte(s), needed %d. This is insufficient, and padding bytes could not be used. Bailing.",
+            L"Decoded a total of %d byte(s), needed %d. This is sufficient. Proceeding.",
             numOriginalFunctionBytes,
             numOriginalFunctionBytesNeeded);
-        return false;
+    }
+
+    // Everything up to the end of the space needed for a jump instruction is examined, either as
+    // part of an instruction or as padding, along with anything beyond it that is part of the last
+    // instruction.
+    decoded->numExaminedBytes = std::max(numOriginalFunctionBytes, numOriginalFunctionBytesNeeded);
+    std::memcpy(decoded->examinedBytes, originalFunctionBytes, decoded->numExaminedBytes);
+
+    return true;
+  }
+
+  bool Trampoline::IsDecodedOriginalFunctionCurrent(const SDecodedOriginalFunction& decoded)
+  {
+    if (decoded.isHotPatchable != X86Instruction::IsHotPatchable(decoded.originalFunc))
+      return false;
+
+    if (true == decoded.isHotPatchable) return true;
+
+    return (
+        0 == std::memcmp(decoded.examinedBytes, decoded.originalFunc, decoded.numExaminedBytes));
+  }
+
+  bool Trampoline::SetOriginalFunction(const void* originalFunc, size_t* sizeBytesUsed)
+  {
+    SDecodedOriginalFunction decoded;
+    if (false == DecodeOriginalFunction(originalFunc, &decoded))
+    {
+      HookJournal::Record(
+          {.trampoline = this,
+           .originalFunc = originalFunc,
+           .hookFunc = nullptr,
+           .operation = HookJournal::EOperation::SetOriginalFunction,
+           .numDecodedBytes = static_cast<uint8_t>(decoded.numDecodedBytes),
+           .usedJumpAssist = false,
+           .succeeded = false});
+      return false;
+    }
+
+    return SetOriginalFunction(decoded, sizeBytesUsed);
+  }
+
+  bool Trampoline::SetOriginalFunction(
+      const SDecodedOriginalFunction& decoded, size_t* sizeBytesUsed)
+  {
+    bool usedJumpAssist = false;
+    int numTrampolineBytesUsed = 0;
+    const bool transplantResult =
+        TransplantOriginalFunction(decoded, &usedJumpAssist, &numTrampolineBytesUsed);
+
+    HookJournal::Record(
+        {.trampoline = this,
+         .originalFunc = decoded.originalFunc,
+         .hookFunc = nullptr,
+         .operation = HookJournal::EOperation::SetOriginalFunction,
+         .numDecodedBytes = static_cast<uint8_t>(decoded.numDecodedBytes),
+         .usedJumpAssist = usedJumpAssist,
+         .succeeded = transplantResult});
+
+    if ((true == transplantResult) && (nullptr != sizeBytesUsed))
+      *sizeBytesUsed = sizeof(code.hook) + static_cast<size_t>(numTrampolineBytesUsed);
+
+    return transplantResult;
+  }
+
+#ifdef _WIN64
+  bool Trampoline::SetOriginalFunctionFar(
+      const void* originalFunc, size_t* sizeBytesUsed, int minLengthBytes)
+  {
+    static_assert(
+        static_cast<size_t>(
+            X86Instruction::kAbsoluteJumpInstructionLengthBytes - 1 +
+            X86Instruction::kMaxInstructionLengthBytes +
+            X86Instruction::kAbsoluteJumpInstructionLengthBytes) <= sizeof(code.original),
+        "Original function region is too small to hold code copied for an absolute jump.");
+
+    const bool debugOutputLive = MappedLog::IsDebugOutputLive();
+    const uint8_t* const originalFunctionBytes = reinterpret_cast<const uint8_t*>(originalFunc);
+
+    // The function table is consulted first, since functions shorter than the absolute jump are
+    // common enough and decoding them would be a waste.
+    const int numFunctionBytesRemaining = FunctionBytesRemaining(originalFunc);
+    bool setResult =
+        ((minLengthBytes <= X86Instruction::kAbsoluteJumpInstructionLengthBytes) &&
+         ((numFunctionBytesRemaining < 0) || (numFunctionBytesRemaining >= minLengthBytes)));
+
+    // Instructions are copied as they are, so they must neither refer to anything relative to
+    // their own position nor end the function before there is space for the absolute jump. No
+    // attempt is made to use padding after a terminal instruction, because the absolute jump is
+    // long enough that the padding would rarely suffice.
+    int numOriginalFunctionBytes = 0;
+    bool isLastInstructionTerminal = false;
+    while ((true == setResult) && (numOriginalFunctionBytes < minLengthBytes))
+    {
+      X86Instruction originalInstruction;
+      const bool decodeResult =
+          originalInstruction.DecodeInstruction(&originalFunctionBytes[numOriginalFunctionBytes]);
+      if ((false == decodeResult) ||
+          (true == originalInstruction.HasPositionDependentMemoryReference()))
+      {
+        if (true == debugOutputLive)
+          MappedLog::OutputFormatted(
+              Infra::Message::ESeverity::Debug,
+              L"Instruction at offset %d of 0x%llx cannot be copied for an absolute jump. Bailing.",
+              numOriginalFunctionBytes,
+              (long long)originalFunc);
+        setResult = false;
+        break;
       }
+
+      numOriginalFunctionBytes += originalInstruction.GetLengthBytes();
+      isLastInstructionTerminal = originalInstruction.IsTerminal();
+      if (true == isLastInstructionTerminal) break;
     }
-    else
+
+    if (numOriginalFunctionBytes < minLengthBytes) setResult = false;
+
+    if (true == setResult)
+    {
+      std::memcpy(&code.original.byte[0], originalFunctionBytes, numOriginalFunctionBytes);
+
+      int numTrampolineBytesUsed = numOriginalFunctionBytes;
+      if (false == isLastInstructionTerminal)
+      {
+        X86Instruction::WriteAbsoluteJumpInstruction(
+            &code.original.byte[numOriginalFunctionBytes],
+            sizeof(code.original) - numOriginalFunctionBytes,
+            &originalFunctionBytes[numOriginalFunctionBytes]);
+        numTrampolineBytesUsed += X86Instruction::kAbsoluteJumpInstructionLengthBytes;
+      }
+
+      if (nullptr != sizeBytesUsed)
+        *sizeBytesUsed = sizeof(code.hook) + static_cast<size_t>(numTrampolineBytesUsed);
+
+      TrampolineStore::FlushInstructionCache(&code.original, sizeof(code.original));
+    }
+
+    HookJournal::Record(
+        {.trampoline = this,
+         .originalFunc = originalFunc,
+         .hookFunc = nullptr,
+         .operation = HookJournal::EOperation::SetOriginalFunction,
+         .numDecodedBytes = static_cast<uint8_t>(numOriginalFunctionBytes),
+         .usedJumpAssist = false,
+         .succeeded = setResult});
+
+    return setResult;
+  }
+#endif
+
+  bool Trampoline::TransplantOriginalFunction(
+      const SDecodedOriginalFunction& decoded, bool* usedJumpAssist, int* numTrampolineBytesUsed)
+  {
+    // Diagnostic messages are output for every instruction of every hook, so whether or not they
+    // would go anywhere is determined just once.
+    const bool debugOutputLive = MappedLog::IsDebugOutputLive();
+    const void* const originalFunc = decoded.originalFunc;
+
+    // Sanity check. Make sure the original function is not too far away from this trampoline.
+    if (false == X86Instruction::CanWriteJumpInstruction(originalFunc, &code.hook))
     {
       Infra::Message::OutputFormatted(
-          Infra::Message::ESeverity::Debug,
-          L"Decoded a total of %d byte(s), needed %d. This is sufficient. Proceeding.",
-          numOriginalFunctionBytes,
-          numOriginalFunctionBytesNeeded);
+          Infra::Message::ESeverity::Warning,
+          L"Set hook failed for function %llx because it is too far from the trampoline.",
+          (long long)originalFunc);
+      return false;
+    }
+
+    // Functions laid out for hot-patching begin with an instruction that does nothing, and the jump
+    // to the hook function is written into the padding in front of them instead of over them. The
+    // original functionality is therefore reached just by skipping the first instruction, so no
+    // code needs to be transplanted.
+    if (true == decoded.isHotPatchable)
+    {
+      const void* const originalFuncAfterEntry = &reinterpret_cast<const uint8_t*>(
+          originalFunc)[X86Instruction::kHotPatchEntryLengthBytes];
+
+      if (true == debugOutputLive)
+        MappedLog::OutputFormatted(
+            Infra::Message::ESeverity::Debug,
+            L"Function at 0x%llx is laid out for hot-patching, so adding a jump to 0x%llx instead of transplanting any instructions.",
+            (long long)originalFunc,
+            (long long)originalFuncAfterEntry);
+
+      if (false ==
+          X86Instruction::WriteJumpInstruction(
+              &code.original.byte[0], sizeof(code.original), originalFuncAfterEntry))
+        return false;
+
+      *numTrampolineBytesUsed = X86Instruction::kJumpInstructionLengthBytes;
+
+      TrampolineStore::FlushInstructionCache(&code.original, sizeof(code.original));
+      return true;
+    }
+
+    // A system call stub is reproduced in its entirety from its system call number, rather than
+    // transplanting its first instructions and jumping back to the rest of it. This needs neither
+    // the decoder nor the encoder, and the original functionality is reached without any jump.
+    if (true == decoded.isSyscallStub)
+    {
+      const int numSyscallStubBytes = X86Instruction::WriteSyscallStub(
+          &code.original.byte[0], sizeof(code.original), decoded.syscallStub);
+      if (0 == numSyscallStubBytes) return false;
+
+      *numTrampolineBytesUsed = numSyscallStubBytes;
+
+      TrampolineStore::FlushInstructionCache(&code.original, sizeof(code.original));
+      return true;
+    }
+
+    // Instructions described by a hook plan are transplanted by copying their bytes and patching
+    // their displacements in place, which avoids the encoder entirely. This is possible whether or
+    // not they were actually decoded. If it fails, which only happens if some displacement no
+    // longer fits within its instruction, they are re-encoded the usual way, which first requires
+    // decoding them if that has not already happened.
+    if (true == decoded.hasHookPlan)
+    {
+      if (true == ApplyHookPlan(decoded, usedJumpAssist, numTrampolineBytesUsed)) return true;
+
+      *usedJumpAssist = false;
+
+      if (true == debugOutputLive)
+        MappedLog::OutputFormatted(
+            Infra::Message::ESeverity::Debug,
+            L"Unable to apply the hook plan for 0x%llx, re-encoding instead.",
+            (long long)originalFunc);
+
+      if (true == decoded.isFromHookPlan)
+      {
+        SDecodedOriginalFunction decodedInstructions;
+        if (false == DecodeOriginalFunctionInstructions(originalFunc, &decodedInstructions))
+          return false;
+
+        // Only re-encoding is left to try.
+        decodedInstructions.hasHookPlan = false;
+        return TransplantOriginalFunction(
+            decodedInstructions, usedJumpAssist, numTrampolineBytesUsed);
+      }
     }
 
-    // Second and third sub-parts.
+    // This operation requires transplanting code from the location of the original function into
+    // the original function part of the trampoline. Instructions are read and decoded until either
+    // enough bytes worth of instructions are decoded to hold an unconditional jump or a terminal
+    // instruction is hit. This does not depend on the trampoline at all, so it is done separately
+    // by DecodeOriginalFunction. The decoded instructions are then relocated into this trampoline's
+    // original function region, followed by a jump to the rest of the original function unless the
+    // last of them is terminal, which is done by the same engine that relocates code on behalf of
+    // hook modules.
+    const int numOriginalInstructions = decoded.numInstructions;
+
+    // Displacements are modified in place, so the decoded instructions are copied.
+    X86Instruction originalInstructions[_countof(decoded.instructions)];
+    std::copy(
+        &decoded.instructions[0],
+        &decoded.instructions[numOriginalInstructions],
+        originalInstructions);
+
+    SRelocatedCode relocated = {};
+    if (false ==
+        CodeRelocation::RelocateInstructions(
+            originalInstructions,
+            numOriginalInstructions,
+            decoded.examinedBytes,
+            &code.original.byte[0],
+            static_cast<int>(sizeof(code.original)),
+            0,
+            &relocated))
+      return false;
+
+    // Jump assists and absolute address slots are written at the very end of the original function
+    // region, so if there are any then the whole region is in use.
+    *usedJumpAssist = (0 != relocated.numJumpAssists);
+    *numTrampolineBytesUsed =
+        ((0 == relocated.numTailBytes) ? static_cast<int>(relocated.numCodeBytes)
+                                       : static_cast<int>(sizeof(code.original)));
+
+    TrampolineStore::FlushInstructionCache(&code.original, sizeof(code.original));
+    return true;
+  }
+
+  bool Trampoline::ApplyHookPlan(
+      const SDecodedOriginalFunction& decoded, bool* usedJumpAssist, int* numTrampolineBytesUsed)
+  {
+    // Instructions are copied rather than re-encoded, so each one occupies the same number of bytes
+    // in the trampoline as it does in the original function. The same offset therefore locates an
+    // instruction in both places.
+    const uint8_t* const originalFunctionBytes =
+        reinterpret_cast<const uint8_t*>(decoded.originalFunc);
+    const int numOriginalFunctionBytes = decoded.numDecodedBytes;
+    const int numOriginalInstructions = decoded.numInstructions;
+
     int numTrampolineBytesWritten = 0;
     int numExtraTrampolineBytesUsed = 0;
 
-    for (int i = 0; i < static_cast<int>(originalInstructions.size()); ++i)
+    for (int i = 0; i < numOriginalInstructions; ++i)
     {
+      const SHookPlanInstruction& planInstruction = decoded.planInstructions[i];
+      const int instructionLengthBytes = static_cast<int>(planInstruction.lengthBytes);
       const int numTrampolineBytesLeft =
           sizeof(code.original) - numTrampolineBytesWritten - numExtraTrampolineBytesUsed;
-      void* const nextTrampolineAddressToWrite = &code.original.byte[numTrampolineBytesWritten];
+      if (instructionLengthBytes > numTrampolineBytesLeft) return false;
 
-      // Second sub-part. Handle any position-dependent memory references.
-      if (originalInstructions[i].HasPositionDependentMemoryReference())
+      uint8_t* const nextTrampolineAddressToWrite = &code.original.byte[numTrampolineBytesWritten];
+      std::memcpy(
+          nextTrampolineAddressToWrite,
+          &decoded.examinedBytes[numTrampolineBytesWritten],
+          instructionLengthBytes);
+
+      if (0 != planInstruction.displacementWidthBytes)
       {
-        const int64_t originalDisplacement = originalInstructions[i].GetMemoryDisplacement();
-        Infra::Message::OutputFormatted(
-            Infra::Message::ESeverity::Debug,
-            L"Instruction %d - Has a position-dependent memory reference with displacement 0x%llx.",
-            i,
-            (long long)originalDisplacement);
+        uint8_t* const displacementBytes =
+            &nextTrampolineAddressToWrite[planInstruction.displacementOffsetBytes];
+        const int64_t originalDisplacement =
+            ReadDisplacement(displacementBytes, planInstruction.displacementWidthBytes);
 
-        // If the displacement is so small that it refers to another instruction that is also being
-        // transplanted, then there is no need to modify it. Note the need to check both forwards
-        // (positive) and backwards (negative) displacement directions.
+        // Same rule as when transplanting decoded instructions: displacements that refer to
+        // another transplanted instruction do not need to be modified.
         const int64_t minForwardDisplacementNeedingModification = static_cast<int64_t>(
-            numOriginalFunctionBytes -
-            (numTrampolineBytesWritten + originalInstructions[i].GetLengthBytes()));
-        const int64_t minBackwardDisplacementNotNeedingMofification = static_cast<int64_t>(
-            -1 * (numTrampolineBytesWritten + originalInstructions[i].GetLengthBytes()));
+            numOriginalFunctionBytes - (numTrampolineBytesWritten + instructionLengthBytes));
+        const int64_t minBackwardDisplacementNotNeedingMofification =
+            static_cast<int64_t>(-1 * (numTrampolineBytesWritten + instructionLengthBytes));
 
         if (originalDisplacement >= minForwardDisplacementNeedingModification ||
             originalDisplacement < minBackwardDisplacementNotNeedingMofification)
         {
-          // There are no changes to the length of the instruction, so the change to the
-          // displacement value is just the difference in its new and original locations in memory.
+          const intptr_t originalInstructionAddress =
+              reinterpret_cast<intptr_t>(&originalFunctionBytes[numTrampolineBytesWritten]);
           const intptr_t newDisplacementValue =
-              (reinterpret_cast<intptr_t>(originalInstructions[i].GetAddress()) -
+              (originalInstructionAddress -
                reinterpret_cast<intptr_t>(nextTrampolineAddressToWrite)) +
               static_cast<intptr_t>(originalDisplacement);
-          Infra::Message::OutputFormatted(
-              Infra::Message::ESeverity::Debug,
-              L"Instruction %d - Transplanting from 0x%llx to 0x%llx, absolute target is 0x%llx, new displacement is 0x%llx.",
-              i,
-              reinterpret_cast<long long>(originalInstructions[i].GetAddress()),
-              reinterpret_cast<long long>(nextTrampolineAddressToWrite),
-              reinterpret_cast<long long>(
-                  originalInstructions[i].GetAbsoluteMemoryReferenceTarget()),
-              static_cast<long long>(newDisplacementValue));
-
-          // Try to replace the displacement in the original instruction. If this fails, perhaps
-          // using a 32-bit unconditional jump as an assist will help, especially if the original
-          // instruction uses an 8-bit or 16-bit relative displacement. However, an assist like this
-          // is only possible if the original instruction has a relative branch displacement, not a
-          // position-relative data access displacement. Note that the latter case, RIP-relative
-          // addressing, is only supported in 64-bit mode.
+
           if (false ==
-              originalInstructions[i].SetMemoryDisplacement(
+              WriteDisplacement(
+                  displacementBytes,
+                  planInstruction.displacementWidthBytes,
                   static_cast<int64_t>(newDisplacementValue)))
           {
-            if (true == originalInstructions[i].HasRelativeBranchDisplacement())
-            {
-              // The way a jump assist works is by allocating space at the end of the trampoline for
-              // an unconditional jump instruction that targets the same address targetted by the
-              // original instruction. Variable numExtraTrampolineBytesUsed stores the number of
-              // such bytes already allocated at the end of the trampoline. Then, replace the
-              // displacement in the original instruction with a displacement value that takes it to
-              // the jump assist instruction. This solution works for any instruction that uses rel8
-              // and rel16 branch displacements (such as loop, xbegin, etc.), not just conditional
-              // and unconditional jumps.
-
-              numExtraTrampolineBytesUsed += X86Instruction::kJumpInstructionLengthBytes;
-
-              void* const jumpAssistAddress = reinterpret_cast<void*>(
-                  reinterpret_cast<size_t>(&code.original.byte[_countof(code.original.byte)]) -
-                  static_cast<size_t>(numExtraTrampolineBytesUsed));
-              void* const jumpAssistTargetAddress =
-                  originalInstructions[i].GetAbsoluteMemoryReferenceTarget();
-              const intptr_t displacementValueToJumpAssist =
-                  reinterpret_cast<intptr_t>(jumpAssistAddress) -
-                  (reinterpret_cast<intptr_t>(nextTrampolineAddressToWrite) +
-                   static_cast<intptr_t>(originalInstructions[i].GetLengthBytes()));
-
-              Infra::Message::OutputFormatted(
-                  Infra::Message::ESeverity::Debug,
-                  L"Instruction %d - Failed to set new displacement, but will attempt to use a jump assist (from=0x%llx, to=0x%llx, disp=0x%llx, target=0x%llx) instead.",
-                  i,
-                  reinterpret_cast<long long>(nextTrampolineAddressToWrite),
-                  reinterpret_cast<long long>(jumpAssistAddress),
-                  static_cast<long long>(displacementValueToJumpAssist),
-                  reinterpret_cast<long long>(jumpAssistTargetAddress));
-
-              if (false ==
-                  originalInstructions[i].SetMemoryDisplacement(
-                      static_cast<int64_t>(displacementValueToJumpAssist)))
-              {
-                Infra::Message::OutputFormatted(
-                    Infra::Message::ESeverity::Debug,
-                    L"Instruction %d - Jump assist failed, unable to set original instruction displacement.",
-                    i);
-                return false;
-              }
-
-              if (false ==
-                  X86Instruction::WriteJumpInstruction(
-                      jumpAssistAddress,
-                      X86Instruction::kJumpInstructionLengthBytes,
-                      jumpAssistTargetAddress))
-              {
-                Infra::Message::OutputFormatted(
-                    Infra::Message::ESeverity::Debug,
-                    L"Instruction %d - Jump assist failed, unable write jump assist instruction.",
-                    i);
-                return false;
-              }
-
-              Infra::Message::OutputFormatted(
-                  Infra::Message::ESeverity::Debug,
-                  L"Instruction %d - Jump assist succeeded, encoded %d extra bytes at 0x%llx.",
-                  i,
-                  X86Instruction::kJumpInstructionLengthBytes,
-                  (long long)jumpAssistAddress);
-            }
-            else
-            {
-              Infra::Message::OutputFormatted(
-                  Infra::Message::ESeverity::Debug,
-                  L"Instruction %d - Failed to set new displacement, and cannot use a jump assist.",
-                  i);
+            if (false == planInstruction.isRelativeBranch) return false;
+            if ((instructionLengthBytes + X86Instruction::kJumpInstructionLengthBytes) >
+                numTrampolineBytesLeft)
               return false;
-            }
-          }
-        }
-        else
-          Infra::Message::OutputFormatted(
-              Infra::Message::ESeverity::Debug,
-              L"Instruction %d - Displacement is short enough, no modification required.",
-              i);
-      }
 
-      // Third sub-part. Re-encode the instruction.
-      int numEncodedBytes = originalInstructions[i].EncodeInstruction(
-          nextTrampolineAddressToWrite, numTrampolineBytesLeft);
+            numExtraTrampolineBytesUsed += X86Instruction::kJumpInstructionLengthBytes;
+            *usedJumpAssist = true;
 
-      if (0 == numEncodedBytes)
-      {
-        Infra::Message::OutputFormatted(
-            Infra::Message::ESeverity::Debug,
-            L"Instruction %d - Failed to encode at 0x%llx.",
-            i,
-            (long long)nextTrampolineAddressToWrite);
-        return false;
+            void* const jumpAssistAddress = reinterpret_cast<void*>(
+                reinterpret_cast<size_t>(&code.original.byte[_countof(code.original.byte)]) -
+                static_cast<size_t>(numExtraTrampolineBytesUsed));
+            const void* const jumpAssistTargetAddress = reinterpret_cast<const void*>(
+                originalInstructionAddress + static_cast<intptr_t>(instructionLengthBytes) +
+                static_cast<intptr_t>(originalDisplacement));
+            const intptr_t displacementValueToJumpAssist =
+                reinterpret_cast<intptr_t>(jumpAssistAddress) -
+                (reinterpret_cast<intptr_t>(nextTrampolineAddressToWrite) +
+                 static_cast<intptr_t>(instructionLengthBytes));
+
+            if (false ==
+                WriteDisplacement(
+                    displacementBytes,
+                    planInstruction.displacementWidthBytes,
+                    static_cast<int64_t>(displacementValueToJumpAssist)))
+              return false;
+
+            if (false ==
+                X86Instruction::WriteJumpInstruction(
+                    jumpAssistAddress,
+                    X86Instruction::kJumpInstructionLengthBytes,
+                    jumpAssistTargetAddress))
+              return false;
+          }
+        }
       }
 
-      Infra::Message::OutputFormatted(
-          Infra::Message::ESeverity::Debug,
-          L"Instruction %d - Encoded %d byte(s) at 0x%llx.",
-          i,
-          numEncodedBytes,
-          (long long)nextTrampolineAddressToWrite);
-      numTrampolineBytesWritten += numEncodedBytes;
+      numTrampolineBytesWritten += instructionLengthBytes;
     }
 
-    // If the last transplanted instruction is terminal, then the entirety of the original function
-    // was transplanted, so there is no need to jump to an address in the original function.
-    // Otherwise, there are more instructions left in the original function, so make sure to jump to
-    // them after executing the trasnplanted instructions.
-    if (false == originalInstructions.back().IsTerminal())
+    if (false == decoded.planInstructions[numOriginalInstructions - 1].isTerminal)
     {
       const int numTrampolineBytesLeft =
           sizeof(code.original) - numTrampolineBytesWritten - numExtraTrampolineBytesUsed;
-      Infra::Message::OutputFormatted(
-          Infra::Message::ESeverity::Debug,
-          L"Final encoded instruction is non-terminal, so adding a jump to 0x%llx with %d byte(s) free in the trampoline.",
-          (long long)&originalFunctionBytes[numOriginalFunctionBytes],
-          numTrampolineBytesLeft);
-
       if (false ==
           X86Instruction::WriteJumpInstruction(
               &code.original.byte[numTrampolineBytesWritten],
               numTrampolineBytesLeft,
               &originalFunctionBytes[numOriginalFunctionBytes]))
-      {
-        Infra::Message::OutputFormatted(
-            Infra::Message::ESeverity::Debug, L"Failed to write terminal jump instruction.");
         return false;
-      }
+
+      numTrampolineBytesWritten += X86Instruction::kJumpInstructionLengthBytes;
     }
 
-    Protected::Windows_FlushInstructionCache(
-        Infra::ProcessInfo::GetCurrentProcessHandle(), &code.original, sizeof(code.original));
+    *numTrampolineBytesUsed =
+        ((0 == numExtraTrampolineBytesUsed) ? numTrampolineBytesWritten
+                                             : static_cast<int>(sizeof(code.original)));
+
+    if (true == MappedLog::IsDebugOutputLive())
+      MappedLog::OutputFormatted(
+          Infra::Message::ESeverity::Debug,
+          L"Applied the hook plan for 0x%llx, using %d trampoline byte(s).",
+          (long long)decoded.originalFunc,
+          *numTrampolineBytesUsed);
+
+    TrampolineStore::FlushInstructionCache(&code.original, sizeof(code.original));
     return true;
   }
+
+  const void* Trampoline::TranslateOriginalFunctionAddress(
+      const void* originalFunc, const void* address) const
+  {
+    // Transplanted instructions appear in the trampoline in the same order as they appear in the
+    // original function, although their lengths might differ if any of them were re-encoded or
+    // rewritten. Both instruction streams are therefore decoded in lockstep until the requested
+    // address is found.
+    // No messages are output here because this method is intended to be invoked while other
+    // threads are suspended, and they might be holding locks that message output requires.
+    // Nothing is transplanted from functions laid out for hot-patching, and their only modified
+    // instruction is replaced in its entirety, so no address within them needs to be translated.
+    if (true == X86Instruction::IsHotPatchable(originalFunc)) return nullptr;
+
+    const uint8_t* const originalFunctionBytes = reinterpret_cast<const uint8_t*>(originalFunc);
+    int numOriginalFunctionBytes = 0;
+    int numTrampolineBytes = 0;
+
+    while (numOriginalFunctionBytes < X86Instruction::kJumpInstructionLengthBytes)
+    {
+      if (address == &originalFunctionBytes[numOriginalFunctionBytes])
+        return &code.original.byte[numTrampolineBytes];
+
+      X86Instruction originalInstruction;
+      if (false ==
+          originalInstruction.DecodeInstruction(&originalFunctionBytes[numOriginalFunctionBytes]))
+        return nullptr;
+
+      X86Instruction transplantedInstruction;
+      if (false ==
+          transplantedInstruction.DecodeInstruction(&code.original.byte[numTrampolineBytes]))
+        return nullptr;
+
+      const int transplantedLengthBytes =
+          TransplantedInstructionLengthBytes(originalInstruction, transplantedInstruction);
+      if (transplantedLengthBytes < 0) return nullptr;
+
+      numOriginalFunctionBytes += originalInstruction.GetLengthBytes();
+      numTrampolineBytes += transplantedLengthBytes;
+
+      if (true == originalInstruction.IsTerminal()) break;
+    }
+
+    return nullptr;
+  }
 } // namespace Hookshot
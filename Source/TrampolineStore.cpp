@@ -11,58 +11,1148 @@
 
 #include "TrampolineStore.h"
 
+#include <algorithm>
+#include <array>
+#include <cstring>
+#include <map>
+#include <memory>
+#include <unordered_map>
+#include <vector>
+
+#include <Infra/Core/Configuration.h>
+#include <Infra/Core/Message.h>
+#include <Infra/Core/ProcessInfo.h>
 #include <Infra/Core/SystemInfo.h>
 
 #include "DependencyProtect.h"
+#include "Globals.h"
+#include "Strings.h"
 
 namespace Hookshot
 {
   const int TrampolineStore::kTrampolineStoreSizeBytes =
+      Infra::SystemInfo::GetPlatformAndArchitectureInfo().dwAllocationGranularity;
+  const int TrampolineStore::kTrampolineStoreCommitSizeBytes =
       Infra::SystemInfo::GetPlatformAndArchitectureInfo().dwPageSize;
-  const int TrampolineStore::kTrampolineStoreCount = kTrampolineStoreSizeBytes / sizeof(Trampoline);
 
-  /// Allocates a buffer suitable for holding Trampoline objects optionally using a specified base
-  /// address.
+  static_assert(
+      0 == sizeof(Trampoline) % TrampolineStore::kTrampolineStoreAlignmentBytes,
+      "Trampoline size must be a multiple of the trampoline store alignment.");
+
+  /// Base addresses of pages of trampoline memory that have been made writable during the current
+  /// write window and need to be write-protected again once it ends.
+  static std::vector<void*> writablePages;
+
+  /// Range of trampoline memory whose instruction cache flush has been deferred until the end of
+  /// the current write window.
+  struct SDeferredFlushRange
+  {
+    /// Start address of the range.
+    size_t begin;
+
+    /// End address of the range, exclusive.
+    size_t end;
+  };
+
+  /// Maximum number of distinct deferred flush ranges. Trampolines are allocated mostly
+  /// sequentially, so flushes coalesce well and this limit is rarely reached. If it is, the
+  /// deferred flushes are simply performed early.
+  static constexpr size_t kMaxDeferredFlushRanges = 16;
+
+  /// Number of write windows that currently exist. Only the outermost one has any effect.
+  static unsigned int writeWindowDepth = 0;
+
+  /// Instruction cache flushes deferred until the end of the current write window. Fixed in size
+  /// so that deferring a flush never allocates memory.
+  static std::array<SDeferredFlushRange, kMaxDeferredFlushRanges> deferredFlushRanges;
+
+  /// Number of elements of #deferredFlushRanges that are in use.
+  static size_t numDeferredFlushRanges = 0;
+
+  /// Number of trampoline objects deallocated from any trampoline store so far.
+  static uint64_t numDeallocations = 0;
+
+  /// Base addresses of the buffers of trampoline stores that have entry points awaiting
+  /// registration as valid Control Flow Guard call targets. Tracked by address rather than by
+  /// object because trampoline stores can move.
+  static std::vector<const void*> buffersWithPendingCallTargets;
+
+  /// Function signature for `SetProcessValidCallTargets`, which is exported by kernelbase starting
+  /// with Windows 10.
+  using TSetProcessValidCallTargets = BOOL(WINAPI*)(
+      HANDLE process,
+      PVOID virtualAddress,
+      SIZE_T regionSize,
+      ULONG numberOfOffsets,
+      PCFG_CALL_TARGET_INFO offsetInformation);
+
+  /// Locates the entry point for registering valid Control Flow Guard call targets, but only if the
+  /// current process is actually protected by Control Flow Guard. Otherwise there is no call target
+  /// bitmap to maintain. Only attempted once, no matter how many times it is invoked.
+  /// @return Entry point, or `nullptr` if call targets should not be registered.
+  static TSetProcessValidCallTargets GetSetProcessValidCallTargets(void)
+  {
+    static const TSetProcessValidCallTargets setProcessValidCallTargets =
+        []() -> TSetProcessValidCallTargets
+    {
+      HMODULE kernelbaseModule = nullptr;
+      if (0 ==
+          Protected::Windows_GetModuleHandleEx(
+              GET_MODULE_HANDLE_EX_FLAG_UNCHANGED_REFCOUNT, L"kernelbase.dll", &kernelbaseModule))
+        return nullptr;
+
+      using TGetProcessMitigationPolicy = BOOL(WINAPI*)(
+          HANDLE process, PROCESS_MITIGATION_POLICY policy, PVOID buffer, SIZE_T bufferSize);
+      const TGetProcessMitigationPolicy getProcessMitigationPolicy =
+          (TGetProcessMitigationPolicy)Protected::Windows_GetProcAddress(
+              kernelbaseModule, "GetProcessMitigationPolicy");
+      if (nullptr == getProcessMitigationPolicy) return nullptr;
+
+      PROCESS_MITIGATION_CONTROL_FLOW_GUARD_POLICY controlFlowGuardPolicy = {};
+      if ((0 ==
+           getProcessMitigationPolicy(
+               GetCurrentProcess(),
+               ProcessControlFlowGuardPolicy,
+               &controlFlowGuardPolicy,
+               sizeof(controlFlowGuardPolicy))) ||
+          (0 == controlFlowGuardPolicy.EnableControlFlowGuard))
+        return nullptr;
+
+      return (TSetProcessValidCallTargets)Protected::Windows_GetProcAddress(
+          kernelbaseModule, "SetProcessValidCallTargets");
+    }();
+
+    return setProcessValidCallTargets;
+  }
+
+  /// Determines whether or not trampoline entry points are individually registered as valid
+  /// Control Flow Guard call targets.
+  /// @return `true` if so, `false` if not.
+  static inline bool IsCallTargetRegistrationEnabled(void)
+  {
+    return (nullptr != GetSetProcessValidCallTargets());
+  }
+
+  /// Determines the protection that a page of committed trampoline memory currently has, not
+  /// including any Control Flow Guard flags.
+  /// @param [in] page Base address of the page.
+  /// @return Protection flags that are suitable for passing to VirtualProtect.
+  static inline DWORD CurrentTrampolinePageProtection(const void* page)
+  {
+    if (false == TrampolineStore::IsWriteProtectionEnabled()) return PAGE_EXECUTE_READWRITE;
+    return (
+        (std::find(writablePages.cbegin(), writablePages.cend(), page) != writablePages.cend())
+            ? PAGE_EXECUTE_READWRITE
+            : PAGE_EXECUTE_READ);
+  }
+
+  /// Determines the protection flags to use for newly-committed trampoline memory. If entry points
+  /// are registered individually, then nothing on the page starts out as a valid call target.
+  /// @return Protection flags that are suitable for passing to VirtualAlloc.
+  static inline DWORD CommittedTrampolineProtection(void)
+  {
+    return (
+        ((true == TrampolineStore::IsWriteProtectionEnabled()) ? PAGE_EXECUTE_READ
+                                                                : PAGE_EXECUTE_READWRITE) |
+        ((true == IsCallTargetRegistrationEnabled()) ? PAGE_TARGETS_INVALID : 0));
+  }
+
+  /// Determines the additional flags to use when changing the protection of committed trampoline
+  /// memory. Without them, making a page executable would make every location on it a valid call
+  /// target and undo the individual registrations.
+  /// @return Flags that are suitable for combining with protection flags passed to VirtualProtect.
+  static inline DWORD TrampolineProtectionChangeFlags(void)
+  {
+    return ((true == IsCallTargetRegistrationEnabled()) ? PAGE_TARGETS_NO_UPDATE : 0);
+  }
+
+  /// Keeps a newly-committed trampoline page resident, if configured to do so. Committed memory is
+  /// not backed by a physical page until first touched, and it can later be trimmed from the
+  /// working set under memory pressure. Either way, the next call through a hook would take a hard
+  /// page fault. Failure is not fatal, since the page is still usable.
+  /// @param [in] page Base address of the newly-committed page.
+  static void KeepPageResident(void* page)
+  {
+    if (false == TrampolineStore::IsPageLockingEnabled()) return;
+
+    // Reading a byte faults in the page, and locking it keeps it in the working set thereafter.
+    static_cast<void>(*reinterpret_cast<const volatile uint8_t*>(page));
+    if (0 != Protected::Windows_VirtualLock(page, TrampolineStore::kTrampolineStoreCommitSizeBytes))
+      return;
+
+    // The number of pages a process can lock is limited by its minimum working set size. Growing
+    // both limits by one page makes room for this one.
+    if (ERROR_WORKING_SET_QUOTA == Protected::Windows_GetLastError())
+    {
+      SIZE_T minimumWorkingSetSize = 0;
+      SIZE_T maximumWorkingSetSize = 0;
+      if ((0 !=
+           Protected::Windows_GetProcessWorkingSetSize(
+               GetCurrentProcess(), &minimumWorkingSetSize, &maximumWorkingSetSize)) &&
+          (0 !=
+           Protected::Windows_SetProcessWorkingSetSize(
+               GetCurrentProcess(),
+               minimumWorkingSetSize + TrampolineStore::kTrampolineStoreCommitSizeBytes,
+               maximumWorkingSetSize + TrampolineStore::kTrampolineStoreCommitSizeBytes)) &&
+          (0 !=
+           Protected::Windows_VirtualLock(
+               page, TrampolineStore::kTrampolineStoreCommitSizeBytes)))
+        return;
+    }
+
+    Infra::Message::OutputFormatted(
+        Infra::Message::ESeverity::Warning,
+        L"Failed to lock trampoline page at 0x%llx into the working set (system error %u). The first call through a hook on it might take a page fault.",
+        (unsigned long long)reinterpret_cast<size_t>(page),
+        (unsigned int)Protected::Windows_GetLastError());
+  }
+
+  /// Computes the base address of the page that contains the specified address.
+  /// @param [in] address Address for which the containing page is desired.
+  /// @return Base address of the containing page.
+  static inline void* PageBaseAddress(const void* address)
+  {
+    return reinterpret_cast<void*>(
+        reinterpret_cast<size_t>(address) &
+        ~(static_cast<size_t>(TrampolineStore::kTrampolineStoreCommitSizeBytes) - 1));
+  }
+
+#ifdef _WIN64
+  /// Entry points for growable function tables, which are exported by ntdll starting with Windows
+  /// 8. Older systems only support function tables that cannot change once registered.
+  struct SGrowableFunctionTableApi
+  {
+    /// Function signature for `RtlAddGrowableFunctionTable`.
+    using TRtlAddGrowableFunctionTable = NTSTATUS(NTAPI*)(
+        PVOID* dynamicTable,
+        PRUNTIME_FUNCTION functionTable,
+        DWORD entryCount,
+        DWORD maximumEntryCount,
+        ULONG_PTR rangeBase,
+        ULONG_PTR rangeEnd);
+
+    /// Function signature for `RtlGrowFunctionTable`.
+    using TRtlGrowFunctionTable = VOID(NTAPI*)(PVOID dynamicTable, DWORD newEntryCount);
+
+    /// Function signature for `RtlDeleteGrowableFunctionTable`.
+    using TRtlDeleteGrowableFunctionTable = VOID(NTAPI*)(PVOID dynamicTable);
+
+    /// Registers a growable function table.
+    TRtlAddGrowableFunctionTable addGrowableFunctionTable;
+
+    /// Informs the operating system that entries were appended to a growable function table.
+    TRtlGrowFunctionTable growFunctionTable;
+
+    /// Removes a growable function table registration.
+    TRtlDeleteGrowableFunctionTable deleteGrowableFunctionTable;
+
+    /// Determines whether or not growable function tables are supported.
+    /// @return `true` if so, `false` if not.
+    inline bool IsAvailable(void) const
+    {
+      return (
+          (nullptr != addGrowableFunctionTable) && (nullptr != growFunctionTable) &&
+          (nullptr != deleteGrowableFunctionTable));
+    }
+  };
+
+  /// Locates the growable function table entry points. Only attempted once, no matter how many
+  /// times it is invoked.
+  /// @return Growable function table entry points, any of which might be `nullptr`.
+  static const SGrowableFunctionTableApi& GetGrowableFunctionTableApi(void)
+  {
+    static const SGrowableFunctionTableApi growableFunctionTableApi =
+        []() -> SGrowableFunctionTableApi
+    {
+      HMODULE ntdllModule = nullptr;
+      if (0 ==
+          Protected::Windows_GetModuleHandleEx(
+              GET_MODULE_HANDLE_EX_FLAG_UNCHANGED_REFCOUNT, L"ntdll.dll", &ntdllModule))
+        return {};
+
+      return {
+          .addGrowableFunctionTable =
+              (SGrowableFunctionTableApi::TRtlAddGrowableFunctionTable)
+                  Protected::Windows_GetProcAddress(ntdllModule, "RtlAddGrowableFunctionTable"),
+          .growFunctionTable = (SGrowableFunctionTableApi::TRtlGrowFunctionTable)
+              Protected::Windows_GetProcAddress(ntdllModule, "RtlGrowFunctionTable"),
+          .deleteGrowableFunctionTable =
+              (SGrowableFunctionTableApi::TRtlDeleteGrowableFunctionTable)
+                  Protected::Windows_GetProcAddress(ntdllModule, "RtlDeleteGrowableFunctionTable")};
+    }();
+
+    return growableFunctionTableApi;
+  }
+#endif
+
+  /// Reserves, but does not commit, a buffer suitable for holding Trampoline objects optionally
+  /// using a specified base address.
   /// @param [in] baseAddress Desired base address for the buffer.
-  /// @return Pointer to the allocated buffer, or `nullptr` on failure.
-  static inline Trampoline* AllocateTrampolineBuffer(void* baseAddress = nullptr)
+  /// @return Pointer to the reserved buffer, or `nullptr` on failure.
+  static inline Trampoline* ReserveTrampolineBuffer(void* baseAddress = nullptr)
   {
     return reinterpret_cast<Trampoline*>(Protected::Windows_VirtualAlloc(
         baseAddress,
         TrampolineStore::kTrampolineStoreSizeBytes,
-        MEM_RESERVE | MEM_COMMIT,
+        MEM_RESERVE,
         PAGE_EXECUTE_READWRITE));
   }
 
-  TrampolineStore::TrampolineStore(void) : count(0), trampolines(AllocateTrampolineBuffer()) {}
+#ifndef _WIN64
+  /// Number of trampoline store buffers carved out of each shared reservation in 32-bit builds.
+  static constexpr int kTrampolineStoresPerSharedReservation = 16;
+
+  /// Reserves a buffer suitable for holding Trampoline objects by carving it out of a larger
+  /// reservation shared with other trampoline store buffers, which keeps trampolines contiguous
+  /// and the number of separate allocations low. A new shared reservation is made only when the
+  /// previous one is used up. Falls back to an individual reservation if a shared reservation
+  /// cannot be made.
+  /// @param [out] ownsReservation Set to `true` if the returned buffer is an individual
+  /// reservation that can be released on its own, or `false` if it is part of a shared one.
+  /// @return Pointer to the reserved buffer, or `nullptr` on failure.
+  static Trampoline* ReserveSharedTrampolineBuffer(bool& ownsReservation)
+  {
+    static uint8_t* nextBuffer = nullptr;
+    static int numBuffersRemaining = 0;
+
+    if (0 == numBuffersRemaining)
+    {
+      nextBuffer = reinterpret_cast<uint8_t*>(Protected::Windows_VirtualAlloc(
+          nullptr,
+          static_cast<SIZE_T>(TrampolineStore::kTrampolineStoreSizeBytes) *
+              kTrampolineStoresPerSharedReservation,
+          MEM_RESERVE,
+          PAGE_EXECUTE_READWRITE));
+
+      if (nullptr == nextBuffer)
+      {
+        ownsReservation = true;
+        return ReserveTrampolineBuffer();
+      }
+
+      numBuffersRemaining = kTrampolineStoresPerSharedReservation;
+    }
+
+    Trampoline* const buffer = reinterpret_cast<Trampoline*>(nextBuffer);
+    nextBuffer += TrampolineStore::kTrampolineStoreSizeBytes;
+    numBuffersRemaining -= 1;
+
+    ownsReservation = false;
+    return buffer;
+  }
+#endif
+
+  TrampolineStore::TrampolineStore(void)
+      : count(0),
+        numUsedBytes(0),
+        numCommittedBytes(0),
+        freeRanges(),
+        numHookStubUsedBytes(0),
+        numHookStubCommittedBytes(0),
+        hookStubFreeList(),
+        compactedSizes(),
+        pendingCallTargetOffsets(),
+#ifdef _WIN64
+        functionEntries(),
+        unwindInfoOffsets(),
+        leafUnwindInfoOffset(-1),
+        registeredFunctionEntries(),
+        registeredFunctionTable(nullptr),
+#endif
+        slotMetadata(),
+        ownsReservation(true),
+#ifdef _WIN64
+        trampolines(ReserveTrampolineBuffer())
+#else
+        trampolines(ReserveSharedTrampolineBuffer(ownsReservation))
+#endif
+  {
+    if (nullptr != trampolines)
+      slotMetadata = std::make_unique<SSlotMetadata[]>(
+          kTrampolineStoreSizeBytes / kTrampolineStoreAlignmentBytes);
+  }
 
   TrampolineStore::TrampolineStore(void* baseAddress)
-      : count(0), trampolines(AllocateTrampolineBuffer(baseAddress))
-  {}
+      : count(0),
+        numUsedBytes(0),
+        numCommittedBytes(0),
+        freeRanges(),
+        numHookStubUsedBytes(0),
+        numHookStubCommittedBytes(0),
+        hookStubFreeList(),
+        compactedSizes(),
+        pendingCallTargetOffsets(),
+#ifdef _WIN64
+        functionEntries(),
+        unwindInfoOffsets(),
+        leafUnwindInfoOffset(-1),
+        registeredFunctionEntries(),
+        registeredFunctionTable(nullptr),
+#endif
+        slotMetadata(),
+        ownsReservation(true),
+        trampolines(ReserveTrampolineBuffer(baseAddress))
+  {
+    if (nullptr != trampolines)
+      slotMetadata = std::make_unique<SSlotMetadata[]>(
+          kTrampolineStoreSizeBytes / kTrampolineStoreAlignmentBytes);
+  }
 
   TrampolineStore::~TrampolineStore(void)
   {
-    if (nullptr != trampolines && 0 == Count())
+#ifdef _WIN64
+    // The function table refers to memory owned by this object, so it cannot outlive it even if the
+    // buffer itself is intentionally leaked.
+    UnregisterFunctionTable();
+#endif
+
+    if ((nullptr != trampolines) && (true == ownsReservation) && (0 == Count()))
       Protected::Windows_VirtualFree(trampolines, 0, MEM_RELEASE);
   }
 
   TrampolineStore::TrampolineStore(TrampolineStore&& other) noexcept
-      : count(other.count), trampolines(other.trampolines)
+      : count(other.count),
+        numUsedBytes(other.numUsedBytes),
+        numCommittedBytes(other.numCommittedBytes),
+        freeRanges(std::move(other.freeRanges)),
+        numHookStubUsedBytes(other.numHookStubUsedBytes),
+        numHookStubCommittedBytes(other.numHookStubCommittedBytes),
+        hookStubFreeList(std::move(other.hookStubFreeList)),
+        compactedSizes(std::move(other.compactedSizes)),
+        pendingCallTargetOffsets(std::move(other.pendingCallTargetOffsets)),
+#ifdef _WIN64
+        functionEntries(std::move(other.functionEntries)),
+        unwindInfoOffsets(std::move(other.unwindInfoOffsets)),
+        leafUnwindInfoOffset(other.leafUnwindInfoOffset),
+        registeredFunctionEntries(std::move(other.registeredFunctionEntries)),
+        registeredFunctionTable(other.registeredFunctionTable),
+#endif
+        slotMetadata(std::move(other.slotMetadata)),
+        ownsReservation(other.ownsReservation),
+        trampolines(other.trampolines)
   {
     other.count = 0;
+    other.numUsedBytes = 0;
+    other.numCommittedBytes = 0;
+    other.freeRanges.clear();
+    other.numHookStubUsedBytes = 0;
+    other.numHookStubCommittedBytes = 0;
+    other.hookStubFreeList.clear();
+    other.compactedSizes.clear();
+    other.pendingCallTargetOffsets.clear();
+#ifdef _WIN64
+    other.functionEntries.clear();
+    other.unwindInfoOffsets.clear();
+    other.leafUnwindInfoOffset = -1;
+    other.registeredFunctionEntries.clear();
+    other.registeredFunctionTable = nullptr;
+#endif
     other.trampolines = nullptr;
   }
 
-  int TrampolineStore::Allocate(void)
+  TrampolineStore::WriteWindow::WriteWindow(void)
+  {
+    writeWindowDepth += 1;
+  }
+
+  TrampolineStore::WriteWindow::~WriteWindow(void)
+  {
+    writeWindowDepth -= 1;
+    if (0 != writeWindowDepth) return;
+
+    FlushDeferredInstructionCache();
+
+    for (void* const page : writablePages)
+    {
+      DWORD unusedOriginalProtection = 0;
+      Protected::Windows_VirtualProtect(
+          page,
+          kTrampolineStoreCommitSizeBytes,
+          PAGE_EXECUTE_READ | TrampolineProtectionChangeFlags(),
+          &unusedOriginalProtection);
+    }
+
+    writablePages.clear();
+  }
+
+  void TrampolineStore::FlushInstructionCache(const void* address, size_t sizeBytes)
+  {
+    if (0 == writeWindowDepth)
+    {
+      Protected::Windows_FlushInstructionCache(
+          Infra::ProcessInfo::GetCurrentProcessHandle(), address, sizeBytes);
+      return;
+    }
+
+    // Flushing a few unmodified bytes costs far less than an extra flush, so ranges separated by
+    // less than a page are merged.
+    const size_t begin = reinterpret_cast<size_t>(address);
+    const size_t end = begin + sizeBytes;
+    const size_t mergeDistance = static_cast<size_t>(kTrampolineStoreCommitSizeBytes);
+
+    for (size_t i = 0; i < numDeferredFlushRanges; ++i)
+    {
+      SDeferredFlushRange& range = deferredFlushRanges[i];
+      if ((begin <= (range.end + mergeDistance)) && (range.begin <= (end + mergeDistance)))
+      {
+        range.begin = std::min(range.begin, begin);
+        range.end = std::max(range.end, end);
+        return;
+      }
+    }
+
+    if (numDeferredFlushRanges == deferredFlushRanges.size()) FlushDeferredInstructionCache();
+
+    deferredFlushRanges[numDeferredFlushRanges] = {.begin = begin, .end = end};
+    numDeferredFlushRanges += 1;
+  }
+
+  void TrampolineStore::FlushDeferredInstructionCache(void)
+  {
+    for (size_t i = 0; i < numDeferredFlushRanges; ++i)
+    {
+      Protected::Windows_FlushInstructionCache(
+          Infra::ProcessInfo::GetCurrentProcessHandle(),
+          reinterpret_cast<const void*>(deferredFlushRanges[i].begin),
+          deferredFlushRanges[i].end - deferredFlushRanges[i].begin);
+    }
+
+    numDeferredFlushRanges = 0;
+  }
+
+  bool TrampolineStore::IsWriteProtectionEnabled(void)
+  {
+    static const bool writeProtectionEnabled =
+        Globals::GetPerformanceProfile().writeProtectTrampolines;
+
+    return writeProtectionEnabled;
+  }
+
+  bool TrampolineStore::IsPageLockingEnabled(void)
+  {
+    static const bool pageLockingEnabled = Globals::GetPerformanceProfile().lockTrampolinePages;
+
+    return pageLockingEnabled;
+  }
+
+  bool TrampolineStore::MakeWritable(const void* trampoline)
   {
-    if ((nullptr == trampolines) || (count >= kTrampolineStoreCount)) return -1;
+    if (false == IsWriteProtectionEnabled()) return true;
+
+    // Trampolines are allocated mostly sequentially, so the most likely match is the page that was
+    // most recently made writable.
+    void* const page = PageBaseAddress(trampoline);
+    if (std::find(writablePages.crbegin(), writablePages.crend(), page) != writablePages.crend())
+      return true;
+
+    // Other threads may be executing trampolines on this page at the same time, so it must remain
+    // executable while it is writable.
+    DWORD unusedOriginalProtection = 0;
+    if (0 ==
+        Protected::Windows_VirtualProtect(
+            page,
+            kTrampolineStoreCommitSizeBytes,
+            PAGE_EXECUTE_READWRITE | TrampolineProtectionChangeFlags(),
+            &unusedOriginalProtection))
+      return false;
 
-    new (&trampolines[count]) Trampoline();
-    return count++;
+    writablePages.push_back(page);
+    return true;
   }
 
-  void TrampolineStore::Deallocate(void)
+  Trampoline* TrampolineStore::Allocate(void)
+  {
+    if (nullptr == trampolines) return nullptr;
+
+    uint8_t* const buffer = reinterpret_cast<uint8_t*>(trampolines);
+
+    // Free ranges are all within already-committed memory. The first one that fits is used, and
+    // whatever is left over on either side stays free.
+    for (auto freeRangeIter = freeRanges.begin(); freeRangeIter != freeRanges.end();
+         ++freeRangeIter)
+    {
+      const int rangeOffset = freeRangeIter->first;
+      const int rangeEndOffset = freeRangeIter->first + freeRangeIter->second;
+      const int reusedOffset = AllocationOffsetWithinRange(rangeOffset, freeRangeIter->second);
+      if (reusedOffset < 0) continue;
+
+      Trampoline* const reusedTrampoline = reinterpret_cast<Trampoline*>(&buffer[reusedOffset]);
+      if (false == MakeWritable(reusedTrampoline)) return nullptr;
+
+      const int reusedEndOffset = reusedOffset + static_cast<int>(sizeof(Trampoline));
+      freeRanges.erase(freeRangeIter);
+      if (reusedOffset > rangeOffset) freeRanges[rangeOffset] = reusedOffset - rangeOffset;
+      if (rangeEndOffset > reusedEndOffset)
+        freeRanges[reusedEndOffset] = rangeEndOffset - reusedEndOffset;
+
+      count += 1;
+
+      Trampoline* const constructedTrampoline = new (reusedTrampoline) Trampoline();
+      AddPendingCallTarget(constructedTrampoline->GetHookFunction());
+      AddPendingCallTarget(constructedTrampoline->GetOriginalFunction());
+      return constructedTrampoline;
+    }
+
+    const int allocationOffset = NextAllocationOffset();
+    const int allocationEndOffset = allocationOffset + static_cast<int>(sizeof(Trampoline));
+    if (allocationEndOffset > TrampolineAreaEndOffset()) return nullptr;
+
+    // Pages are committed one at a time as needed. Trampoline objects never straddle a page
+    // boundary, so a single trampoline never straddles the boundary between committed and
+    // uncommitted memory.
+    if (allocationEndOffset > numCommittedBytes)
+    {
+      if (nullptr ==
+          Protected::Windows_VirtualAlloc(
+              &buffer[numCommittedBytes],
+              kTrampolineStoreCommitSizeBytes,
+              MEM_COMMIT,
+              CommittedTrampolineProtection()))
+        return nullptr;
+
+      KeepPageResident(&buffer[numCommittedBytes]);
+      numCommittedBytes += kTrampolineStoreCommitSizeBytes;
+    }
+
+    Trampoline* const newTrampoline = reinterpret_cast<Trampoline*>(&buffer[allocationOffset]);
+    if (false == MakeWritable(newTrampoline)) return nullptr;
+
+    numUsedBytes = allocationEndOffset;
+    count += 1;
+
+    Trampoline* const constructedTrampoline = new (newTrampoline) Trampoline();
+    AddPendingCallTarget(constructedTrampoline->GetHookFunction());
+    AddPendingCallTarget(constructedTrampoline->GetOriginalFunction());
+    return constructedTrampoline;
+  }
+
+  Trampoline::UHookCode* TrampolineStore::AllocateHookStub(void)
+  {
+    Trampoline::UHookCode* const hookStub = AllocateHookStubSlot();
+    if (nullptr != hookStub) AddPendingCallTarget(hookStub);
+
+#ifdef _WIN64
+    if (nullptr != hookStub)
+    {
+      const int offset = static_cast<int>(
+          reinterpret_cast<const uint8_t*>(hookStub) - reinterpret_cast<uint8_t*>(trampolines));
+      AddFunctionEntry(
+          offset, offset + static_cast<int>(sizeof(Trampoline::UHookCode)), LeafUnwindInfoOffset());
+      UpdateFunctionTable();
+    }
+#endif
+
+    return hookStub;
+  }
+
+  Trampoline::UHookCode* TrampolineStore::AllocateHookStubSlot(void)
+  {
+    if (nullptr == trampolines) return nullptr;
+
+    uint8_t* const buffer = reinterpret_cast<uint8_t*>(trampolines);
+
+    if (false == hookStubFreeList.empty())
+    {
+      Trampoline::UHookCode* const reusedHookStub =
+          reinterpret_cast<Trampoline::UHookCode*>(&buffer[hookStubFreeList.back()]);
+      if (false == MakeWritable(reusedHookStub)) return nullptr;
+
+      hookStubFreeList.pop_back();
+      count += 1;
+
+      return reusedHookStub;
+    }
+
+    // Hook stubs grow downwards from the end of the buffer one page at a time, and the page they
+    // need must not already be committed for trampoline objects.
+    const int allocationOffset = kTrampolineStoreSizeBytes - numHookStubUsedBytes -
+        static_cast<int>(sizeof(Trampoline::UHookCode));
+    if (allocationOffset < TrampolineAreaEndOffset())
+    {
+      const int newPageOffset = TrampolineAreaEndOffset() - kTrampolineStoreCommitSizeBytes;
+      if (newPageOffset < numCommittedBytes) return nullptr;
+
+      if (nullptr ==
+          Protected::Windows_VirtualAlloc(
+              &buffer[newPageOffset],
+              kTrampolineStoreCommitSizeBytes,
+              MEM_COMMIT,
+              CommittedTrampolineProtection()))
+        return nullptr;
+
+      KeepPageResident(&buffer[newPageOffset]);
+      numHookStubCommittedBytes += kTrampolineStoreCommitSizeBytes;
+    }
+
+    Trampoline::UHookCode* const newHookStub =
+        reinterpret_cast<Trampoline::UHookCode*>(&buffer[allocationOffset]);
+    if (false == MakeWritable(newHookStub)) return nullptr;
+
+    numHookStubUsedBytes += static_cast<int>(sizeof(Trampoline::UHookCode));
+    count += 1;
+
+    return newHookStub;
+  }
+
+  void TrampolineStore::Compact(const Trampoline* trampoline, size_t sizeBytes)
+  {
+    if (false == Contains(trampoline)) return;
+
+    const int offset = static_cast<int>(
+        reinterpret_cast<const uint8_t*>(trampoline) - reinterpret_cast<uint8_t*>(trampolines));
+    if (0 != compactedSizes.count(offset)) return;
+
+    const int compactedSizeBytes = static_cast<int>(
+        (std::min(sizeBytes, sizeof(Trampoline)) + (kTrampolineStoreAlignmentBytes - 1)) &
+        ~static_cast<size_t>(kTrampolineStoreAlignmentBytes - 1));
+    if (static_cast<int>(sizeof(Trampoline)) == compactedSizeBytes) return;
+
+    compactedSizes[offset] = compactedSizeBytes;
+    AddFreeRange(
+        offset + compactedSizeBytes, static_cast<int>(sizeof(Trampoline)) - compactedSizeBytes);
+  }
+
+  void TrampolineStore::Deallocate(const Trampoline* trampoline)
+  {
+    if (false == Contains(trampoline)) return;
+
+    const int offset = static_cast<int>(
+        reinterpret_cast<const uint8_t*>(trampoline) - reinterpret_cast<uint8_t*>(trampolines));
+
+#ifdef _WIN64
+    RemoveFunctionEntry(offset);
+    RemoveFunctionEntry(offset + static_cast<int>(Trampoline::kTrampolineSizeHookFunctionBytes));
+
+    const auto unwindInfoOffsetIter = unwindInfoOffsets.find(offset);
+    if (unwindInfoOffsets.end() != unwindInfoOffsetIter)
+    {
+      DeallocateHookStubSlot(unwindInfoOffsetIter->second);
+      unwindInfoOffsets.erase(unwindInfoOffsetIter);
+    }
+
+    UpdateFunctionTable();
+#endif
+
+    slotMetadata[offset / kTrampolineStoreAlignmentBytes] = {};
+    numDeallocations += 1;
+
+    int sizeBytes = static_cast<int>(sizeof(Trampoline));
+    const auto compactedSizeIter = compactedSizes.find(offset);
+    if (compactedSizes.end() != compactedSizeIter)
+    {
+      sizeBytes = compactedSizeIter->second;
+      compactedSizes.erase(compactedSizeIter);
+    }
+
+    count -= 1;
+
+    // The memory occupied by a compacted trampoline object is usually too small to hold a new
+    // full-size one by itself, but once coalesced with its neighbors it generally is not.
+    AddFreeRange(offset, sizeBytes);
+  }
+
+  void TrampolineStore::DeallocateHookStub(const Trampoline::UHookCode* hookStub)
+  {
+    if (false == Contains(hookStub)) return;
+
+    const int offset = static_cast<int>(
+        reinterpret_cast<const uint8_t*>(hookStub) - reinterpret_cast<uint8_t*>(trampolines));
+
+#ifdef _WIN64
+    RemoveFunctionEntry(offset);
+#endif
+
+    DeallocateHookStubSlot(offset);
+
+#ifdef _WIN64
+    UpdateFunctionTable();
+#endif
+  }
+
+  void TrampolineStore::DeallocateHookStubSlot(int offset)
   {
     count -= 1;
+
+    if ((kTrampolineStoreSizeBytes - numHookStubUsedBytes) == offset)
+      numHookStubUsedBytes -= static_cast<int>(sizeof(Trampoline::UHookCode));
+    else
+      hookStubFreeList.push_back(offset);
+  }
+
+  int TrampolineStore::FreeCount(void) const
+  {
+    if (nullptr == trampolines) return 0;
+
+    int numFreeTrampolines = 0;
+    for (const auto& freeRange : freeRanges)
+    {
+      int rangeOffset = freeRange.first;
+      int rangeSizeBytes = freeRange.second;
+
+      for (int allocationOffset = AllocationOffsetWithinRange(rangeOffset, rangeSizeBytes);
+           allocationOffset >= 0;
+           allocationOffset = AllocationOffsetWithinRange(rangeOffset, rangeSizeBytes))
+      {
+        const int allocationEndOffset = allocationOffset + static_cast<int>(sizeof(Trampoline));
+        rangeSizeBytes -= (allocationEndOffset - rangeOffset);
+        rangeOffset = allocationEndOffset;
+        numFreeTrampolines += 1;
+      }
+    }
+
+    const int numUnusedBytes = TrampolineAreaEndOffset() - NextAllocationOffset();
+    return (
+        numFreeTrampolines + std::max(0, numUnusedBytes / static_cast<int>(sizeof(Trampoline))));
+  }
+
+  bool TrampolineStore::HasFreeSpace(void) const
+  {
+    if (nullptr == trampolines) return false;
+
+    if ((NextAllocationOffset() + static_cast<int>(sizeof(Trampoline))) <=
+        TrampolineAreaEndOffset())
+      return true;
+
+    for (const auto& freeRange : freeRanges)
+    {
+      if (AllocationOffsetWithinRange(freeRange.first, freeRange.second) >= 0) return true;
+    }
+
+    return false;
+  }
+
+  uint64_t TrampolineStore::DeallocationCount(void)
+  {
+    return numDeallocations;
+  }
+
+  std::vector<const void*> TrampolineStore::TakeBuffersWithPendingCallTargets(void)
+  {
+    std::vector<const void*> buffers;
+    buffers.swap(buffersWithPendingCallTargets);
+    return buffers;
+  }
+
+  int TrampolineStore::WastedBytes(void) const
+  {
+    int numWastedBytes = static_cast<int>(hookStubFreeList.size() * sizeof(Trampoline::UHookCode));
+    for (const auto& freeRange : freeRanges)
+      numWastedBytes += freeRange.second;
+
+    return numWastedBytes;
+  }
+
+  bool TrampolineStore::RegisterCallTargets(void)
+  {
+    if (true == pendingCallTargetOffsets.empty()) return true;
+
+    std::vector<CFG_CALL_TARGET_INFO> callTargets;
+    callTargets.reserve(pendingCallTargetOffsets.size());
+    for (const int offset : pendingCallTargetOffsets)
+      callTargets.push_back(
+          {.Offset = static_cast<ULONG_PTR>(offset), .Flags = CFG_CALL_TARGET_VALID});
+
+    // Offsets are relative to the beginning of the reservation, so every entry point in this
+    // buffer can be registered with a single call no matter how many pages they span.
+    const bool callTargetsRegistered =
+        (0 !=
+         GetSetProcessValidCallTargets()(
+             GetCurrentProcess(),
+             trampolines,
+             static_cast<SIZE_T>(kTrampolineStoreSizeBytes),
+             static_cast<ULONG>(callTargets.size()),
+             callTargets.data()));
+
+    if (false == callTargetsRegistered)
+    {
+      // Changing the protection of a page without any Control Flow Guard flags makes every
+      // location on it a valid call target, which is less strict but at least keeps the entry
+      // points reachable.
+      uint8_t* const buffer = reinterpret_cast<uint8_t*>(trampolines);
+      const void* previousPage = nullptr;
+      for (const int offset : pendingCallTargetOffsets)
+      {
+        void* const page = PageBaseAddress(&buffer[offset]);
+        if (page == previousPage) continue;
+
+        DWORD unusedOriginalProtection = 0;
+        Protected::Windows_VirtualProtect(
+            page,
+            kTrampolineStoreCommitSizeBytes,
+            CurrentTrampolinePageProtection(page),
+            &unusedOriginalProtection);
+        previousPage = page;
+      }
+
+      Infra::Message::OutputFormatted(
+          Infra::Message::ESeverity::Warning,
+          L"Failed to register %llu trampoline entry points as valid call targets (system error %u). Their pages are now entirely valid call targets instead.",
+          (unsigned long long)pendingCallTargetOffsets.size(),
+          (unsigned int)Protected::Windows_GetLastError());
+    }
+
+    pendingCallTargetOffsets.clear();
+    return callTargetsRegistered;
+  }
+
+#ifdef _WIN64
+  bool TrampolineStore::RegisterUnwindInfo(
+      const Trampoline* trampoline, const void* originalFunc, size_t sizeBytes)
+  {
+    if (false == Contains(trampoline)) return false;
+
+    const int offset = static_cast<int>(
+        reinterpret_cast<const uint8_t*>(trampoline) - reinterpret_cast<uint8_t*>(trampolines));
+    if (0 != functionEntries.count(offset)) return false;
+
+    const int sharedUnwindInfoOffset = LeafUnwindInfoOffset();
+    if (sharedUnwindInfoOffset < 0) return false;
+
+    const int endOffset = offset + static_cast<int>(sizeBytes);
+
+    // Function table entries refer to unwind information by its offset from a base address, which
+    // cannot be negative, so the unwind information has to be held within the buffer itself. It is
+    // exactly the size of a hook stub, so it is allocated the same way.
+    Trampoline::SUnwindInfo unwindInfo;
+    Trampoline::UHookCode* unwindInfoSlot = nullptr;
+    if (true == trampoline->BuildOriginalFunctionUnwindInfo(originalFunc, sizeBytes, &unwindInfo))
+    {
+      unwindInfoSlot = AllocateHookStubSlot();
+      if (nullptr != unwindInfoSlot) std::memcpy(unwindInfoSlot, &unwindInfo, sizeof(unwindInfo));
+    }
+
+    if (nullptr == unwindInfoSlot)
+    {
+      // Nothing transplanted touches the stack, so both regions unwind as a leaf function.
+      AddFunctionEntry(offset, endOffset, sharedUnwindInfoOffset);
+    }
+    else
+    {
+      // The hook region is entered before any transplanted prologue instructions execute, so it
+      // needs its own entry even though it is contiguous with the original function region.
+      const int unwindInfoOffset = static_cast<int>(
+          reinterpret_cast<const uint8_t*>(unwindInfoSlot) -
+          reinterpret_cast<uint8_t*>(trampolines));
+      const int originalOffset =
+          offset + static_cast<int>(Trampoline::kTrampolineSizeHookFunctionBytes);
+
+      AddFunctionEntry(offset, originalOffset, sharedUnwindInfoOffset);
+      AddFunctionEntry(originalOffset, endOffset, unwindInfoOffset);
+      unwindInfoOffsets[offset] = unwindInfoOffset;
+    }
+
+    UpdateFunctionTable();
+    return (nullptr != registeredFunctionTable);
+  }
+#endif
+
+  void TrampolineStore::AddFreeRange(int offset, int sizeBytes)
+  {
+    if (sizeBytes <= 0) return;
+
+    const auto nextRangeIter = freeRanges.find(offset + sizeBytes);
+    if (freeRanges.end() != nextRangeIter)
+    {
+      sizeBytes += nextRangeIter->second;
+      freeRanges.erase(nextRangeIter);
+    }
+
+    auto previousRangeIter = freeRanges.lower_bound(offset);
+    if (freeRanges.begin() != previousRangeIter)
+    {
+      --previousRangeIter;
+      if ((previousRangeIter->first + previousRangeIter->second) == offset)
+      {
+        offset = previousRangeIter->first;
+        sizeBytes += previousRangeIter->second;
+        freeRanges.erase(previousRangeIter);
+      }
+    }
+
+    if ((offset + sizeBytes) == numUsedBytes)
+      numUsedBytes = offset;
+    else
+      freeRanges[offset] = sizeBytes;
+  }
+
+  void TrampolineStore::AddPendingCallTarget(const void* callTarget)
+  {
+    if (false == IsCallTargetRegistrationEnabled()) return;
+
+    if (true == pendingCallTargetOffsets.empty())
+      buffersWithPendingCallTargets.push_back(trampolines);
+    pendingCallTargetOffsets.push_back(static_cast<int>(
+        reinterpret_cast<const uint8_t*>(callTarget) - reinterpret_cast<uint8_t*>(trampolines)));
+  }
+
+  int TrampolineStore::AllocationOffsetWithinRange(int offset, int sizeBytes)
+  {
+    int allocationOffset = offset;
+
+    const int offsetWithinPage = allocationOffset % kTrampolineStoreCommitSizeBytes;
+    if ((offsetWithinPage + static_cast<int>(sizeof(Trampoline))) >
+        kTrampolineStoreCommitSizeBytes)
+      allocationOffset += (kTrampolineStoreCommitSizeBytes - offsetWithinPage);
+
+    if ((allocationOffset + static_cast<int>(sizeof(Trampoline))) > (offset + sizeBytes))
+      return -1;
+
+    return allocationOffset;
+  }
+
+  int TrampolineStore::NextAllocationOffset(void) const
+  {
+    const int offsetWithinPage = numUsedBytes % kTrampolineStoreCommitSizeBytes;
+    if ((offsetWithinPage + static_cast<int>(sizeof(Trampoline))) <=
+        kTrampolineStoreCommitSizeBytes)
+      return numUsedBytes;
+
+    return (numUsedBytes - offsetWithinPage + kTrampolineStoreCommitSizeBytes);
+  }
+
+#ifdef _WIN64
+  void TrampolineStore::AddFunctionEntry(int beginOffset, int endOffset, int unwindInfoOffset)
+  {
+    if (unwindInfoOffset < 0) return;
+
+    RUNTIME_FUNCTION& functionEntry = functionEntries[beginOffset];
+    functionEntry.BeginAddress = static_cast<DWORD>(beginOffset);
+    functionEntry.EndAddress = static_cast<DWORD>(endOffset);
+    functionEntry.UnwindData = static_cast<DWORD>(unwindInfoOffset);
+  }
+
+  int TrampolineStore::LeafUnwindInfoOffset(void)
+  {
+    if (leafUnwindInfoOffset >= 0) return leafUnwindInfoOffset;
+
+    Trampoline::UHookCode* const unwindInfoSlot = AllocateHookStubSlot();
+    if (nullptr == unwindInfoSlot) return -1;
+
+    // Version 1 with no flags, no prologue, and no unwind codes, which describes code that does not
+    // touch the stack and returns using whatever is on top of it.
+    const Trampoline::SUnwindInfo leafUnwindInfo = {.versionAndFlags = 1};
+    std::memcpy(unwindInfoSlot, &leafUnwindInfo, sizeof(leafUnwindInfo));
+
+    leafUnwindInfoOffset = static_cast<int>(
+        reinterpret_cast<const uint8_t*>(unwindInfoSlot) - reinterpret_cast<uint8_t*>(trampolines));
+    return leafUnwindInfoOffset;
+  }
+
+  void TrampolineStore::RemoveFunctionEntry(int beginOffset)
+  {
+    functionEntries.erase(beginOffset);
+  }
+
+  void TrampolineStore::UnregisterFunctionTable(void)
+  {
+    if (nullptr == registeredFunctionTable) return;
+
+    const SGrowableFunctionTableApi& growableFunctionTableApi = GetGrowableFunctionTableApi();
+    if (true == growableFunctionTableApi.IsAvailable())
+      growableFunctionTableApi.deleteGrowableFunctionTable(registeredFunctionTable);
+    else
+      Protected::Windows_RtlDeleteFunctionTable(registeredFunctionEntries.data());
+
+    registeredFunctionTable = nullptr;
+    registeredFunctionEntries.clear();
+  }
+
+  void TrampolineStore::UpdateFunctionTable(void)
+  {
+    if (true == functionEntries.empty())
+    {
+      // Once nothing else is left in the buffer, the leaf unwind information is given back so that
+      // the buffer can be released.
+      UnregisterFunctionTable();
+      if (leafUnwindInfoOffset >= 0)
+      {
+        DeallocateHookStubSlot(leafUnwindInfoOffset);
+        leafUnwindInfoOffset = -1;
+      }
+      return;
+    }
+
+    const SGrowableFunctionTableApi& growableFunctionTableApi = GetGrowableFunctionTableApi();
+
+    // Trampoline objects are mostly allocated in increasing address order, so the common case is
+    // that the only change is some new entries at the end. A growable function table can just be
+    // told about them, as long as there is space for them.
+    if (nullptr != registeredFunctionTable)
+    {
+      auto functionEntryIter = functionEntries.cbegin();
+      size_t numUnchangedFunctionEntries = 0;
+      for (; (numUnchangedFunctionEntries < registeredFunctionEntries.size()) &&
+           (functionEntries.cend() != functionEntryIter);
+           ++numUnchangedFunctionEntries, ++functionEntryIter)
+      {
+        const RUNTIME_FUNCTION& registeredFunctionEntry =
+            registeredFunctionEntries[numUnchangedFunctionEntries];
+        const RUNTIME_FUNCTION& functionEntry = functionEntryIter->second;
+        if ((registeredFunctionEntry.BeginAddress != functionEntry.BeginAddress) ||
+            (registeredFunctionEntry.EndAddress != functionEntry.EndAddress) ||
+            (registeredFunctionEntry.UnwindData != functionEntry.UnwindData))
+          break;
+      }
+
+      if (numUnchangedFunctionEntries == registeredFunctionEntries.size())
+      {
+        if (functionEntries.size() == registeredFunctionEntries.size()) return;
+
+        if ((true == growableFunctionTableApi.IsAvailable()) &&
+            (functionEntries.size() <= registeredFunctionEntries.capacity()))
+        {
+          for (; functionEntries.cend() != functionEntryIter; ++functionEntryIter)
+            registeredFunctionEntries.push_back(functionEntryIter->second);
+
+          growableFunctionTableApi.growFunctionTable(
+              registeredFunctionTable, static_cast<DWORD>(registeredFunctionEntries.size()));
+          return;
+        }
+      }
+    }
+
+    // Otherwise a new function table replaces the old one. The new one is registered before the old
+    // one is removed so that stack walks in progress on other threads always find one of them.
+    // Space is reserved for growth so that subsequent additions at the end are cheap, up to the
+    // most entries the buffer could ever need, given that each one covers at least one aligned
+    // unit.
+    std::vector<RUNTIME_FUNCTION> newFunctionEntries;
+    newFunctionEntries.reserve(std::min(
+        functionEntries.size() * 2,
+        static_cast<size_t>(kTrampolineStoreSizeBytes / kTrampolineStoreAlignmentBytes)));
+    for (const auto& functionEntry : functionEntries)
+      newFunctionEntries.push_back(functionEntry.second);
+
+    void* newFunctionTable = nullptr;
+    if (true == growableFunctionTableApi.IsAvailable())
+    {
+      if (0 !=
+          growableFunctionTableApi.addGrowableFunctionTable(
+              &newFunctionTable,
+              newFunctionEntries.data(),
+              static_cast<DWORD>(newFunctionEntries.size()),
+              static_cast<DWORD>(newFunctionEntries.capacity()),
+              reinterpret_cast<ULONG_PTR>(trampolines),
+              reinterpret_cast<ULONG_PTR>(trampolines) + kTrampolineStoreSizeBytes))
+        return;
+    }
+    else
+    {
+      if (FALSE ==
+          Protected::Windows_RtlAddFunctionTable(
+              newFunctionEntries.data(),
+              static_cast<DWORD>(newFunctionEntries.size()),
+              reinterpret_cast<DWORD64>(trampolines)))
+        return;
+
+      newFunctionTable = newFunctionEntries.data();
+    }
+
+    UnregisterFunctionTable();
+
+    // Moving a vector transfers ownership of its storage, so the registered entries stay put.
+    registeredFunctionEntries = std::move(newFunctionEntries);
+    registeredFunctionTable = newFunctionTable;
   }
+#endif
 } // namespace Hookshot
@@ -0,0 +1,844 @@
+/***************************************************************************************************
+ * Hookshot
+ *   General-purpose library for injecting DLLs and hooking function calls.
+ ***************************************************************************************************
+ * Authored by Samuel Grossman
+ * Copyright (c) 2019-2025
+ ***********************************************************************************************//**
+ * @file Wow64Injector.cpp
+ *   Implementation of injecting 32-bit processes directly from 64-bit Hookshot.
+ **************************************************************************************************/
+
+#include "Wow64Injector.h"
+
+#include <winternl.h>
+
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include <Infra/Core/Message.h>
+#include <Infra/Core/Strings.h>
+#include <Infra/Core/SystemInfo.h>
+#include <Infra/Core/TemporaryBuffer.h>
+
+#include "ApiWindows.h"
+#include "CodeInjector.h"
+#include "ExportResolver.h"
+#include "Inject.h"
+#include "InjectResult.h"
+#include "Strings.h"
+#include "Tracing.h"
+
+#ifdef _WIN64
+
+namespace Hookshot
+{
+  namespace Wow64Injector
+  {
+    /// Layout of SInjectData as the 32-bit injected code sees it, in which every pointer-sized
+    /// field is 32 bits wide. Addresses and handles in a 32-bit process always fit.
+    struct SInjectData32
+    {
+      uint32_t sync;
+      uint32_t enableDebugFeatures;
+      uint32_t unused1[(128 / sizeof(uint32_t)) - 2];
+      uint32_t injectionResultCodeSuccess;
+      uint32_t injectionResultCodeLoadLibraryFailed;
+      uint32_t injectionResultCodeGetProcAddressFailed;
+      uint32_t injectionResultCodeInitializationFailed;
+      uint32_t unused3[(128 / sizeof(uint32_t)) - 4];
+      uint32_t injectionResult;
+      uint32_t extendedInjectionResult;
+      uint32_t unused4[(128 / sizeof(uint32_t)) - 2];
+      uint32_t funcGetLastError;
+      uint32_t funcGetProcAddress;
+      uint32_t funcLoadLibraryA;
+      uint32_t strLibraryName;
+      uint32_t strProcName;
+      uint32_t cleanupBaseAddress[5];
+      uint32_t funcSetEvent;
+      uint32_t syncEvent;
+      uint32_t unused5[(128 / sizeof(uint32_t)) - 12];
+    };
+
+    static_assert(
+        sizeof(SInjectData32) == sizeof(SInjectData),
+        "32-bit injected data must consist of the same 128-byte blocks as native injected data.");
+
+    /// Addresses at or above this value cannot be used by 32-bit code.
+    static constexpr size_t kAddressLimit32 = 0x100000000ull;
+
+    /// Maximum amount of time, in milliseconds, to wait for the loader to initialize a process.
+    static constexpr DWORD kAdvanceProcessTimeoutMilliseconds = 10000;
+
+    /// Byte offset of the `ImageBaseAddress` field within the 32-bit process environment block.
+    static constexpr uint32_t kByteOffsetPeb32ImageBaseAddress = 8;
+
+    /// Converts an address in the 32-bit view of another process into a pointer that can be
+    /// passed to functions that access the memory of other processes.
+    /// @param [in] address Address to convert.
+    /// @return Converted address.
+    static inline void* RemotePointer(const uint32_t address)
+    {
+      return reinterpret_cast<void*>(static_cast<size_t>(address));
+    }
+
+    /// Reads memory from another process.
+    /// @param [in] processHandle Handle of the process from which to read.
+    /// @param [in] address Address to read, in the address space of the other process.
+    /// @param [out] buffer Buffer to be filled with the data read.
+    /// @param [in] sizeBytes Number of bytes to read.
+    /// @return `true` if all of the requested bytes were read, `false` otherwise.
+    static bool ReadRemoteMemory(
+        const HANDLE processHandle,
+        const uint32_t address,
+        void* const buffer,
+        const size_t sizeBytes)
+    {
+      return injectDataFieldReadImpl(processHandle, RemotePointer(address), buffer, sizeBytes);
+    }
+
+    /// Reads the NT headers of a 32-bit module loaded in another process.
+    /// @param [in] processHandle Handle of the process in which the module is loaded.
+    /// @param [in] moduleBase Base address of the module in the other process.
+    /// @param [out] ntHeaders Filled with the NT headers of the module, if successful.
+    /// @return `true` if the headers were read and describe a 32-bit module, `false` otherwise.
+    static bool ReadRemoteNtHeaders32(
+        const HANDLE processHandle, const uint32_t moduleBase, IMAGE_NT_HEADERS32* ntHeaders)
+    {
+      IMAGE_DOS_HEADER dosHeader;
+      if ((false == ReadRemoteMemory(processHandle, moduleBase, &dosHeader, sizeof(dosHeader))) ||
+          (IMAGE_DOS_SIGNATURE != dosHeader.e_magic))
+        return false;
+
+      if (false ==
+          ReadRemoteMemory(
+              processHandle,
+              moduleBase + static_cast<uint32_t>(dosHeader.e_lfanew),
+              ntHeaders,
+              sizeof(*ntHeaders)))
+        return false;
+
+      return (
+          (IMAGE_NT_SIGNATURE == ntHeaders->Signature) &&
+          (IMAGE_FILE_MACHINE_I386 == ntHeaders->FileHeader.Machine) &&
+          (IMAGE_NT_OPTIONAL_HDR32_MAGIC == ntHeaders->OptionalHeader.Magic));
+    }
+
+    /// Retrieves the base address of a 32-bit module that the loader has loaded in another
+    /// process.
+    /// @param [in] processHandle Handle to the process in which the module is loaded.
+    /// @param [in] moduleName File name of the module, without any directory.
+    /// @return Base address of the module, or 0 if it is not loaded.
+    static uint32_t GetRemoteModuleBase32(
+        const HANDLE processHandle, std::wstring_view moduleName)
+    {
+      Infra::TemporaryBuffer<HMODULE> loadedModules;
+      DWORD numLoadedModules = 0;
+
+      if (FALSE ==
+          EnumProcessModulesEx(
+              processHandle,
+              loadedModules.Data(),
+              loadedModules.CapacityBytes(),
+              &numLoadedModules,
+              LIST_MODULES_32BIT))
+        return 0;
+
+      numLoadedModules /= sizeof(HMODULE);
+
+      Infra::TemporaryString loadedModuleName;
+      for (DWORD modidx = 0; modidx < numLoadedModules; ++modidx)
+      {
+        loadedModuleName.UnsafeSetSize(GetModuleBaseName(
+            processHandle,
+            loadedModules[modidx],
+            loadedModuleName.Data(),
+            loadedModuleName.Capacity()));
+
+        if (true ==
+            Infra::Strings::EqualsCaseInsensitive(loadedModuleName.AsStringView(), moduleName))
+          return static_cast<uint32_t>(reinterpret_cast<size_t>(loadedModules[modidx]));
+      }
+
+      return 0;
+    }
+
+    /// Retrieves the addresses of procedures exported by a 32-bit module loaded in another
+    /// process. Procedures forwarded to another module are resolved if that module is loaded and
+    /// named directly, rather than by way of an API set.
+    /// @param [in] processHandle Handle to the process in which the module is loaded.
+    /// @param [in] moduleBase Base address of the module in the other process.
+    /// @param [in] procNames Names of the exported procedures.
+    /// @param [in] numProcNames Number of names to resolve.
+    /// @param [out] procAddresses Filled with the address of each requested procedure, or 0 for
+    /// each procedure that could not be resolved.
+    /// @param [in] maxForwardingDepth Maximum number of forwarders to follow in succession.
+    /// @return Number of procedures that were successfully resolved.
+    static size_t GetRemoteProcAddresses32(
+        const HANDLE processHandle,
+        const uint32_t moduleBase,
+        const std::string_view* procNames,
+        size_t numProcNames,
+        uint32_t* procAddresses,
+        unsigned int maxForwardingDepth)
+    {
+      std::fill(procAddresses, procAddresses + numProcNames, 0);
+
+      IMAGE_NT_HEADERS32 ntHeaders;
+      if (false == ReadRemoteNtHeaders32(processHandle, moduleBase, &ntHeaders)) return 0;
+
+      const IMAGE_DATA_DIRECTORY& exportDataDirectory =
+          ntHeaders.OptionalHeader.DataDirectory[IMAGE_DIRECTORY_ENTRY_EXPORT];
+      if (exportDataDirectory.Size < sizeof(IMAGE_EXPORT_DIRECTORY)) return 0;
+
+      std::vector<uint8_t> exportTable(exportDataDirectory.Size);
+      if (false ==
+          ReadRemoteMemory(
+              processHandle,
+              moduleBase + exportDataDirectory.VirtualAddress,
+              exportTable.data(),
+              exportTable.size()))
+        return 0;
+
+      const ExportResolver::SExportTableView exportTableView = {
+          .data = exportTable.data(),
+          .dataRelativeAddress = exportDataDirectory.VirtualAddress,
+          .dataSize = exportDataDirectory.Size,
+          .exportDirectoryRelativeAddress = exportDataDirectory.VirtualAddress,
+          .exportDirectorySize = exportDataDirectory.Size};
+
+      std::vector<DWORD> procRelativeAddresses(numProcNames);
+      std::vector<std::string_view> forwarders(numProcNames);
+      ExportResolver::ResolveExports(
+          exportTableView,
+          procNames,
+          numProcNames,
+          procRelativeAddresses.data(),
+          forwarders.data());
+
+      size_t numResolved = 0;
+      for (size_t i = 0; i < numProcNames; ++i)
+      {
+        if (0 != procRelativeAddresses[i])
+        {
+          procAddresses[i] = moduleBase + static_cast<uint32_t>(procRelativeAddresses[i]);
+          numResolved += 1;
+          continue;
+        }
+
+        if ((true == forwarders[i].empty()) || (0 == maxForwardingDepth)) continue;
+
+        // Forwarders have the form `Module.ProcName`. Forwarding by ordinal is not supported.
+        const size_t separatorPosition = forwarders[i].find('.');
+        if ((std::string_view::npos == separatorPosition) ||
+            ((separatorPosition + 1) >= forwarders[i].length()) ||
+            ('#' == forwarders[i][separatorPosition + 1]))
+          continue;
+
+        std::wstring forwardedModuleName(
+            forwarders[i].begin(), forwarders[i].begin() + separatorPosition);
+        forwardedModuleName.append(L".dll");
+
+        const uint32_t forwardedModuleBase =
+            GetRemoteModuleBase32(processHandle, forwardedModuleName);
+        if (0 == forwardedModuleBase) continue;
+
+        const std::string_view forwardedProcName = forwarders[i].substr(separatorPosition + 1);
+        numResolved += GetRemoteProcAddresses32(
+            processHandle,
+            forwardedModuleBase,
+            &forwardedProcName,
+            1,
+            &procAddresses[i],
+            maxForwardingDepth - 1);
+      }
+
+      return numResolved;
+    }
+
+    /// Locates the 32-bit `ntdll.dll` in a 32-bit process. It is mapped when the process is
+    /// created, but the loader has not yet recorded it, so the address space that 32-bit code can
+    /// use is searched for the base of a 32-bit image mapped from a file of that name.
+    /// @param [in] processHandle Handle to the process to search.
+    /// @return Base address of the 32-bit `ntdll.dll`, or 0 if it could not be located.
+    static uint32_t LocateRemoteNtDll32(const HANDLE processHandle)
+    {
+      Infra::TemporaryString mappedFileName;
+      MEMORY_BASIC_INFORMATION memoryInfo;
+
+      for (size_t address = 0; address < kAddressLimit32;
+           address = reinterpret_cast<size_t>(memoryInfo.BaseAddress) + memoryInfo.RegionSize)
+      {
+        if (0 ==
+            VirtualQueryEx(
+                processHandle,
+                reinterpret_cast<LPCVOID>(address),
+                &memoryInfo,
+                sizeof(memoryInfo)))
+          break;
+
+        if ((MEM_IMAGE != memoryInfo.Type) ||
+            (memoryInfo.BaseAddress != memoryInfo.AllocationBase))
+          continue;
+
+        mappedFileName.UnsafeSetSize(GetMappedFileName(
+            processHandle,
+            memoryInfo.BaseAddress,
+            mappedFileName.Data(),
+            mappedFileName.Capacity()));
+        if (false ==
+            Infra::Strings::EndsWithCaseInsensitive<wchar_t>(
+                mappedFileName.AsStringView(), L"\\ntdll.dll"))
+          continue;
+
+        const uint32_t imageBase = static_cast<uint32_t>(address);
+        IMAGE_NT_HEADERS32 ntHeaders;
+        if (true == ReadRemoteNtHeaders32(processHandle, imageBase, &ntHeaders)) return imageBase;
+      }
+
+      return 0;
+    }
+
+    /// Retrieves the address of a 32-bit thread start routine that immediately exits the thread.
+    /// Because the 32-bit `ntdll.dll` is mapped at the same address in every 32-bit process, it
+    /// only needs to be located once.
+    /// @param [in] processHandle Handle to a 32-bit process, which is searched if the address is
+    /// not already known.
+    /// @return Address of the thread start routine, or 0 if it could not be located.
+    static uint32_t GetExitThreadStartRoutine32(const HANDLE processHandle)
+    {
+      static std::atomic<uint32_t> exitThreadStartRoutine = 0;
+
+      uint32_t startRoutine = exitThreadStartRoutine.load(std::memory_order_relaxed);
+      if (0 != startRoutine) return startRoutine;
+
+      const uint32_t ntdllBase = LocateRemoteNtDll32(processHandle);
+      if (0 == ntdllBase) return 0;
+
+      constexpr std::string_view kProcNameExitThread = "RtlExitUserThread";
+      if (1 !=
+          GetRemoteProcAddresses32(
+              processHandle, ntdllBase, &kProcNameExitThread, 1, &startRoutine, 0))
+        return 0;
+
+      exitThreadStartRoutine.store(startRoutine, std::memory_order_relaxed);
+      return startRoutine;
+    }
+
+    /// Advances the specified 32-bit process' loader progress until it is ready to begin executing,
+    /// which loads its 32-bit system libraries. It is assumed and required that the specified
+    /// process be newly-created and suspended.
+    /// @param [in] processHandle Handle to the process to be advanced.
+    /// @return Indicator of the result of the operation.
+    static EInjectResult AdvanceProcess(const HANDLE processHandle)
+    {
+      // As with processes whose architecture matches, a short-lived thread initializes the process.
+      // Its start routine must be 32-bit code, otherwise the 32-bit loader would never run.
+      const uint32_t loaderThreadStartRoutine = GetExitThreadStartRoutine32(processHandle);
+      if (0 == loaderThreadStartRoutine) return EInjectResult::ErrorAdvanceProcessFailed;
+
+      const HANDLE loaderThread = CreateRemoteThread(
+          processHandle,
+          nullptr,
+          0,
+          reinterpret_cast<LPTHREAD_START_ROUTINE>(RemotePointer(loaderThreadStartRoutine)),
+          nullptr,
+          0,
+          nullptr);
+      if (nullptr == loaderThread) return EInjectResult::ErrorAdvanceProcessFailed;
+
+      const DWORD waitResult =
+          WaitForSingleObject(loaderThread, kAdvanceProcessTimeoutMilliseconds);
+      CloseHandle(loaderThread);
+
+      if (WAIT_OBJECT_0 != waitResult) return EInjectResult::ErrorAdvanceProcessFailed;
+
+      return EInjectResult::Success;
+    }
+
+    /// Attempts to determine the base address of the executable image of a 32-bit process by
+    /// reading its 32-bit process environment block.
+    /// @param [in] processHandle Handle to the process for which information is requested.
+    /// @param [out] baseAddress Filled with the base address of the executable image.
+    /// @return Indicator of the result of the operation.
+    static EInjectResult GetProcessImageBaseAddress32(
+        const HANDLE processHandle, uint32_t* const baseAddress)
+    {
+      static const NTSTATUS(WINAPI * ntdllQueryInformationProcessProc)(
+          HANDLE, PROCESSINFOCLASS, PVOID, ULONG, PULONG) =
+          reinterpret_cast<decltype(ntdllQueryInformationProcessProc)>(
+              GetProcAddress(GetModuleHandle(L"ntdll.dll"), "NtQueryInformationProcess"));
+
+      if (nullptr == ntdllQueryInformationProcessProc)
+        return EInjectResult::ErrorNtQueryInformationProcessUnavailable;
+
+      // For a 32-bit process, this information class yields the address of its 32-bit process
+      // environment block, which is separate from the native one.
+      ULONG_PTR peb32Address = 0;
+      if ((0 !=
+           ntdllQueryInformationProcessProc(
+               processHandle,
+               ProcessWow64Information,
+               &peb32Address,
+               sizeof(peb32Address),
+               nullptr)) ||
+          (0 == peb32Address) || (peb32Address >= kAddressLimit32))
+        return EInjectResult::ErrorNtQueryInformationProcessFailed;
+
+      if (false ==
+          ReadRemoteMemory(
+              processHandle,
+              static_cast<uint32_t>(peb32Address) + kByteOffsetPeb32ImageBaseAddress,
+              baseAddress,
+              sizeof(*baseAddress)))
+        return EInjectResult::ErrorReadProcessPEBFailed;
+
+      return EInjectResult::Success;
+    }
+
+    /// Attempts to determine the address of the entry point of a 32-bit process, which for
+    /// processes managed by the CLR is the `_CorExeMain` function exported by `mscoree.dll`.
+    /// @param [in] processHandle Handle to the process for which information is requested.
+    /// @param [in] baseAddress Base address of the process' executable image.
+    /// @param [out] entryPoint Filled with the entry point address.
+    /// @return Indicator of the result of the operation.
+    static EInjectResult GetProcessEntryPointAddress32(
+        const HANDLE processHandle, const uint32_t baseAddress, uint32_t* const entryPoint)
+    {
+      IMAGE_NT_HEADERS32 ntHeaders;
+      if (false == ReadRemoteNtHeaders32(processHandle, baseAddress, &ntHeaders))
+        return EInjectResult::ErrorReadNTHeadersFailed;
+
+      if (0 == ntHeaders.OptionalHeader.DataDirectory[IMAGE_DIRECTORY_ENTRY_COM_DESCRIPTOR].Size)
+      {
+        *entryPoint = baseAddress + ntHeaders.OptionalHeader.AddressOfEntryPoint;
+        return EInjectResult::Success;
+      }
+
+      const uint32_t clrModuleBase = GetRemoteModuleBase32(processHandle, L"mscoree.dll");
+      if (0 == clrModuleBase) return EInjectResult::ErrorGetModuleHandleClrLibraryFailed;
+
+      constexpr std::string_view kProcNameClrEntryPoint = "_CorExeMain";
+      if (1 !=
+          GetRemoteProcAddresses32(
+              processHandle, clrModuleBase, &kProcNameClrEntryPoint, 1, entryPoint, 1))
+        return EInjectResult::ErrorGetProcAddressClrEntryPointFailed;
+
+      return EInjectResult::Success;
+    }
+
+    /// Determines the location within a 32-bit process of the GetLastError, GetProcAddress,
+    /// LoadLibraryA, and SetEvent functions, which the injected code invokes.
+    /// @param [in] processHandle Handle to the process for which information is requested.
+    /// @param [out] functionAddresses Filled with the address of each function, in that order.
+    /// @return Indicator of the result of the operation.
+    static EInjectResult LocateFunctions32(
+        const HANDLE processHandle, std::array<uint32_t, 4>& functionAddresses)
+    {
+      static constexpr std::string_view kFunctionNames[] = {
+          "GetLastError", "GetProcAddress", "LoadLibraryA", "SetEvent"};
+      static_assert(
+          _countof(kFunctionNames) == std::tuple_size_v<std::array<uint32_t, 4>>,
+          "Each required function must have exactly one address.");
+
+      const uint32_t kernel32Base = GetRemoteModuleBase32(processHandle, L"kernel32.dll");
+      if ((0 == kernel32Base) ||
+          (functionAddresses.size() !=
+           GetRemoteProcAddresses32(
+               processHandle,
+               kernel32Base,
+               kFunctionNames,
+               _countof(kFunctionNames),
+               functionAddresses.data(),
+               1)))
+        return EInjectResult::ErrorCannotLocateRequiredFunctions;
+
+      return EInjectResult::Success;
+    }
+
+    /// Allocates a single region in a 32-bit process that holds the code region followed by the
+    /// data region, both of which must be addressable by 32-bit code.
+    /// @param [in] processHandle Handle to the process in which to allocate.
+    /// @param [in] regionSize Size of each of the code and data regions, in bytes.
+    /// @param [out] codeBase Filled with the base address of the code region.
+    /// @return Indicator of the result of the operation.
+    static EInjectResult AllocateInjectRegions32(
+        const HANDLE processHandle, const size_t regionSize, uint32_t* const codeBase)
+    {
+      void* const allocation = VirtualAllocEx(
+          processHandle, nullptr, regionSize * 2, MEM_RESERVE | MEM_COMMIT, PAGE_READWRITE);
+      if (nullptr == allocation) return EInjectResult::ErrorVirtualAllocFailed;
+
+      if ((reinterpret_cast<size_t>(allocation) + (regionSize * 2)) > kAddressLimit32)
+      {
+        VirtualFreeEx(processHandle, allocation, 0, MEM_RELEASE);
+        return EInjectResult::ErrorVirtualAllocFailed;
+      }
+
+      *codeBase = static_cast<uint32_t>(reinterpret_cast<size_t>(allocation));
+      return EInjectResult::Success;
+    }
+
+    /// Writes the injected code and data into a 32-bit process and places the trampoline at its
+    /// entry point, equivalent to what the 32-bit form of Hookshot writes.
+    /// @param [in] processHandle Handle to the process being injected.
+    /// @param [in] injectInfo Information about the 32-bit injected code.
+    /// @param [in] codeBase Base address of the code region, which the data region follows.
+    /// @param [in] regionSize Size of each of the code and data regions, in bytes.
+    /// @param [in] entryPoint Address of the entry point of the process.
+    /// @param [in] functionAddresses Addresses of the functions that the injected code invokes.
+    /// @param [in] enableDebugFeatures Whether or not to enable debug features.
+    /// @param [out] oldCodeAtTrampoline Filled with the code that the trampoline replaces.
+    /// @return Indicator of the result of the operation.
+    static EInjectResult SetInjectedCode32(
+        const HANDLE processHandle,
+        const InjectInfo& injectInfo,
+        const uint32_t codeBase,
+        const size_t regionSize,
+        const uint32_t entryPoint,
+        const std::array<uint32_t, 4>& functionAddresses,
+        const bool enableDebugFeatures,
+        std::array<uint8_t, CodeInjector::kMaxTrampolineCodeBytes>& oldCodeAtTrampoline)
+    {
+      const uint8_t* const trampolineStart =
+          reinterpret_cast<const uint8_t*>(injectInfo.GetInjectTrampolineStart());
+      const size_t trampolineSize =
+          reinterpret_cast<const uint8_t*>(injectInfo.GetInjectTrampolineEnd()) - trampolineStart;
+
+      const uint8_t* const codeStart =
+          reinterpret_cast<const uint8_t*>(injectInfo.GetInjectCodeStart());
+      const size_t codeSize =
+          reinterpret_cast<const uint8_t*>(injectInfo.GetInjectCodeEnd()) - codeStart;
+
+      if (trampolineSize > oldCodeAtTrampoline.size())
+        return EInjectResult::ErrorInsufficientTrampolineSpace;
+      if (codeSize > regionSize) return EInjectResult::ErrorInsufficientCodeSpace;
+      if (sizeof(SInjectData32) > regionSize) return EInjectResult::ErrorInsufficientDataSpace;
+
+      const uint32_t dataBase = codeBase + static_cast<uint32_t>(regionSize);
+
+      // Back up the code at the entry point and replace it with the trampoline, whose target
+      // address is a 32-bit value that immediately precedes the address marker.
+      if (false ==
+          ReadRemoteMemory(processHandle, entryPoint, oldCodeAtTrampoline.data(), trampolineSize))
+        return EInjectResult::ErrorSetFailedRead;
+
+      std::array<uint8_t, CodeInjector::kMaxTrampolineCodeBytes> trampolineCode;
+      std::memcpy(trampolineCode.data(), trampolineStart, trampolineSize);
+
+      const uint32_t mainCodeEntryPoint = codeBase +
+          static_cast<uint32_t>(
+              reinterpret_cast<const uint8_t*>(injectInfo.GetInjectCodeBegin()) - codeStart);
+      std::memcpy(
+          &trampolineCode[(
+              reinterpret_cast<const uint8_t*>(injectInfo.GetInjectTrampolineAddressMarker()) -
+              trampolineStart - sizeof(uint32_t))],
+          &mainCodeEntryPoint,
+          sizeof(mainCodeEntryPoint));
+
+      if ((false ==
+           injectDataFieldWriteImpl(
+               processHandle, RemotePointer(entryPoint), trampolineCode.data(), trampolineSize)) ||
+          (FALSE ==
+           FlushInstructionCache(processHandle, RemotePointer(entryPoint), trampolineSize)))
+        return EInjectResult::ErrorSetFailedWrite;
+
+      // Build the code and data regions locally and write them all at once. The code region begins
+      // with the 32-bit displacement of the data region.
+      std::vector<uint8_t> image(regionSize * 2, 0);
+      uint8_t* const codeImage = &image[0];
+      uint8_t* const dataImage = &image[regionSize];
+
+      const uint32_t dataDisplacement = static_cast<uint32_t>(regionSize);
+      std::memcpy(codeImage, codeStart, codeSize);
+      std::memcpy(codeImage, &dataDisplacement, sizeof(dataDisplacement));
+
+      {
+        SInjectData32 injectData;
+        char* const injectDataStrings = reinterpret_cast<char*>(&dataImage[sizeof(injectData)]);
+        const size_t injectDataStringsSize = regionSize - sizeof(injectData);
+
+        std::memset(&injectData, 0, sizeof(injectData));
+
+        injectData.enableDebugFeatures = (true == enableDebugFeatures ? 1 : 0);
+        injectData.injectionResultCodeSuccess = static_cast<uint32_t>(EInjectResult::Success);
+        injectData.injectionResultCodeLoadLibraryFailed =
+            static_cast<uint32_t>(EInjectResult::ErrorCannotLoadLibrary);
+        injectData.injectionResultCodeGetProcAddressFailed =
+            static_cast<uint32_t>(EInjectResult::ErrorMalformedLibrary);
+        injectData.injectionResultCodeInitializationFailed =
+            static_cast<uint32_t>(EInjectResult::ErrorLibraryInitFailed);
+        injectData.injectionResult = static_cast<uint32_t>(EInjectResult::Failure);
+
+        strcpy_s(
+            injectDataStrings,
+            injectDataStringsSize,
+            Strings::kStrLibraryInitializationProcName.data());
+
+        const size_t libraryNameOffset = Strings::kStrLibraryInitializationProcName.length() + 1;
+        if (0 !=
+            wcstombs_s(
+                nullptr,
+                &injectDataStrings[libraryNameOffset],
+                injectDataStringsSize - libraryNameOffset - 1,
+                Strings::GetHookshotDynamicLinkLibraryOtherArchitectureFilename().data(),
+                injectDataStringsSize - libraryNameOffset - 2))
+          return EInjectResult::ErrorCannotGenerateLibraryFilename;
+
+        injectData.strProcName = dataBase + static_cast<uint32_t>(sizeof(injectData));
+        injectData.strLibraryName =
+            injectData.strProcName + static_cast<uint32_t>(libraryNameOffset);
+
+        // The code and data regions are a single allocation, so freeing the code region is enough.
+        injectData.cleanupBaseAddress[0] = codeBase;
+
+        // Functions are known before the injected code starts, so they are filled in now. The
+        // injected code still waits at the same synchronization barriers.
+        injectData.funcGetLastError = functionAddresses[0];
+        injectData.funcGetProcAddress = functionAddresses[1];
+        injectData.funcLoadLibraryA = functionAddresses[2];
+
+        std::memcpy(dataImage, &injectData, sizeof(injectData));
+      }
+
+      if (false ==
+          injectDataFieldWriteImpl(
+              processHandle, RemotePointer(codeBase), image.data(), image.size()))
+        return EInjectResult::ErrorSetFailedWrite;
+
+      DWORD unusedOldProtect = 0;
+      if ((FALSE ==
+           VirtualProtectEx(
+               processHandle,
+               RemotePointer(codeBase),
+               regionSize,
+               PAGE_EXECUTE_READ,
+               &unusedOldProtect)) ||
+          (FALSE == FlushInstructionCache(processHandle, RemotePointer(codeBase), codeSize)))
+        return EInjectResult::ErrorVirtualProtectFailed;
+
+      return EInjectResult::Success;
+    }
+
+    /// Runs the injected code in a 32-bit process once it has been set, using the same
+    /// synchronization sequence as the native trampoline, but with a 32-bit sync flag. Upon
+    /// successful completion, the main thread is suspended.
+    /// @param [in] processHandle Handle to the process being injected.
+    /// @param [in] threadHandle Handle to the main thread of the process being injected.
+    /// @param [in] dataBase Base address of the data region.
+    /// @param [in] addrSetEvent Address of the SetEvent function in the process.
+    /// @return Indicator of the result of the operation.
+    static EInjectResult RunInjectedCode32(
+        const HANDLE processHandle,
+        const HANDLE threadHandle,
+        const uint32_t dataBase,
+        const uint32_t addrSetEvent)
+    {
+      uint32_t syncVar1 = 1, syncVar2 = 2;
+      HANDLE syncEventHandle = nullptr;
+      uint32_t* const syncFlagAddress = reinterpret_cast<uint32_t*>(
+          RemotePointer(dataBase + static_cast<uint32_t>(offsetof(SInjectData32, sync))));
+
+      auto injectSync32 = [&]() -> bool
+      {
+        return (
+            injectSyncWaitImpl(
+                syncVar1, syncVar2, processHandle, syncEventHandle, syncFlagAddress) &&
+            injectSyncAdvanceImpl(syncVar1, syncVar2, processHandle, syncFlagAddress));
+      };
+
+      auto writeDataField32 = [processHandle, dataBase](size_t fieldOffset, uint32_t value) -> bool
+      {
+        return injectDataFieldWriteImpl(
+            processHandle,
+            RemotePointer(dataBase + static_cast<uint32_t>(fieldOffset)),
+            &value,
+            sizeof(value));
+      };
+
+      if (1 != ResumeThread(threadHandle)) return EInjectResult::ErrorRunFailedResumeThread;
+      if (false == injectSync32()) return EInjectResult::ErrorRunFailedSync;
+
+      // Failure to create or share the event is not fatal because synchronization can fall back to
+      // polling. Handles in a 32-bit process always fit in 32 bits.
+      const HANDLE syncEvent = CreateEvent(nullptr, FALSE, FALSE, nullptr);
+      HANDLE remoteSyncEvent = nullptr;
+
+      if ((nullptr != syncEvent) &&
+          (FALSE !=
+           DuplicateHandle(
+               GetCurrentProcess(),
+               syncEvent,
+               processHandle,
+               &remoteSyncEvent,
+               EVENT_MODIFY_STATE,
+               FALSE,
+               0)))
+      {
+        if ((true == writeDataField32(offsetof(SInjectData32, funcSetEvent), addrSetEvent)) &&
+            (true ==
+             writeDataField32(
+                 offsetof(SInjectData32, syncEvent),
+                 static_cast<uint32_t>(reinterpret_cast<size_t>(remoteSyncEvent)))))
+          syncEventHandle = syncEvent;
+      }
+
+      EInjectResult result = EInjectResult::Success;
+
+      // The injected code loads the library after this barrier and waits at the next one once it
+      // is done, at which point the main thread is put to sleep before being allowed to advance.
+      if (false == injectSync32())
+        result = EInjectResult::ErrorRunFailedSync;
+      else if (
+          false ==
+          injectSyncWaitImpl(syncVar1, syncVar2, processHandle, syncEventHandle, syncFlagAddress))
+        result = EInjectResult::ErrorRunFailedSync;
+      else if (0 != SuspendThread(threadHandle))
+        result = EInjectResult::ErrorRunFailedSuspendThread;
+      else if (
+          false == injectSyncAdvanceImpl(syncVar1, syncVar2, processHandle, syncFlagAddress))
+        result = EInjectResult::ErrorRunFailedSync;
+
+      if (nullptr != remoteSyncEvent)
+        DuplicateHandle(
+            processHandle, remoteSyncEvent, nullptr, nullptr, 0, FALSE, DUPLICATE_CLOSE_SOURCE);
+      if (nullptr != syncEvent) CloseHandle(syncEvent);
+
+      if (EInjectResult::Success != result) return result;
+
+      uint32_t injectionResult = 0;
+      uint32_t extendedInjectionResult = 0;
+
+      if ((false ==
+           ReadRemoteMemory(
+               processHandle,
+               dataBase + static_cast<uint32_t>(offsetof(SInjectData32, injectionResult)),
+               &injectionResult,
+               sizeof(injectionResult))) ||
+          (false ==
+           ReadRemoteMemory(
+               processHandle,
+               dataBase + static_cast<uint32_t>(offsetof(SInjectData32, extendedInjectionResult)),
+               &extendedInjectionResult,
+               sizeof(extendedInjectionResult))))
+        return EInjectResult::ErrorCannotReadStatus;
+
+      SetLastError(static_cast<DWORD>(extendedInjectionResult));
+      return static_cast<EInjectResult>(injectionResult);
+    }
+
+    EInjectResult InjectProcess(
+        const HANDLE processHandle,
+        const HANDLE threadHandle,
+        const bool enableDebugFeatures,
+        Tracing::SInjectPhaseDurations& phaseDurations,
+        bool* retryPossible)
+    {
+      const DWORD processId = GetProcessId(processHandle);
+      *retryPossible = true;
+
+      auto phaseStartTime = std::chrono::steady_clock::now();
+      auto completePhase = [processId, &phaseDurations, &phaseStartTime](
+                               Tracing::EInjectPhase phase, EInjectResult result) -> void
+      {
+        const long long durationMicroseconds = Tracing::MicrosecondsSince(phaseStartTime);
+        phaseDurations.Record(phase, durationMicroseconds);
+        Tracing::InjectProcessPhase(processId, phase, durationMicroseconds, result);
+      };
+
+      const InjectInfo& injectInfo = InjectInfo::GetWow64Instance();
+      if (EInjectResult::Success != injectInfo.InitializationResult())
+        return injectInfo.InitializationResult();
+
+      const size_t regionSize = std::max(
+          InjectInfo::kMaxInjectBinaryFileSize,
+          static_cast<size_t>(Infra::SystemInfo::GetPlatformAndArchitectureInfo().dwPageSize));
+
+      // Advance the process so that the 32-bit loader finishes loading any modules needed.
+      phaseStartTime = std::chrono::steady_clock::now();
+      EInjectResult operationResult = AdvanceProcess(processHandle);
+      completePhase(Tracing::EInjectPhase::Advance, operationResult);
+      if (EInjectResult::Success != operationResult) return operationResult;
+
+      uint32_t processBaseAddress = 0;
+      phaseStartTime = std::chrono::steady_clock::now();
+      operationResult = GetProcessImageBaseAddress32(processHandle, &processBaseAddress);
+      completePhase(Tracing::EInjectPhase::LocateProcessEnvironmentBlock, operationResult);
+      if (EInjectResult::Success != operationResult) return operationResult;
+
+      uint32_t processEntryPoint = 0;
+      std::array<uint32_t, 4> functionAddresses = {};
+      phaseStartTime = std::chrono::steady_clock::now();
+      operationResult =
+          GetProcessEntryPointAddress32(processHandle, processBaseAddress, &processEntryPoint);
+      if (EInjectResult::Success == operationResult)
+        operationResult = LocateFunctions32(processHandle, functionAddresses);
+      completePhase(Tracing::EInjectPhase::LocateEntryPoint, operationResult);
+      if (EInjectResult::Success != operationResult) return operationResult;
+
+      uint32_t injectedCodeBase = 0;
+      phaseStartTime = std::chrono::steady_clock::now();
+      operationResult = AllocateInjectRegions32(processHandle, regionSize, &injectedCodeBase);
+      completePhase(Tracing::EInjectPhase::Allocate, operationResult);
+      if (EInjectResult::Success != operationResult) return operationResult;
+
+      // From here on the process is modified in ways that cannot be undone by another injector.
+      *retryPossible = false;
+
+      std::array<uint8_t, CodeInjector::kMaxTrampolineCodeBytes> oldCodeAtTrampoline;
+      phaseStartTime = std::chrono::steady_clock::now();
+      operationResult = SetInjectedCode32(
+          processHandle,
+          injectInfo,
+          injectedCodeBase,
+          regionSize,
+          processEntryPoint,
+          functionAddresses,
+          enableDebugFeatures,
+          oldCodeAtTrampoline);
+      completePhase(Tracing::EInjectPhase::SetInjectedCode, operationResult);
+      if (EInjectResult::Success != operationResult) return operationResult;
+
+      phaseStartTime = std::chrono::steady_clock::now();
+      operationResult = RunInjectedCode32(
+          processHandle,
+          threadHandle,
+          injectedCodeBase + static_cast<uint32_t>(regionSize),
+          functionAddresses[3]);
+      completePhase(Tracing::EInjectPhase::RunInjectedCode, operationResult);
+      if (EInjectResult::Success != operationResult) return operationResult;
+
+      // Restore the entry point so that the process runs normally once resumed.
+      const size_t trampolineSize =
+          reinterpret_cast<size_t>(injectInfo.GetInjectTrampolineEnd()) -
+          reinterpret_cast<size_t>(injectInfo.GetInjectTrampolineStart());
+
+      phaseStartTime = std::chrono::steady_clock::now();
+      operationResult = ((true ==
+                          injectDataFieldWriteImpl(
+                              processHandle,
+                              RemotePointer(processEntryPoint),
+                              oldCodeAtTrampoline.data(),
+                              trampolineSize)) &&
+                         (FALSE !=
+                          FlushInstructionCache(
+                              processHandle, RemotePointer(processEntryPoint), trampolineSize)))
+          ? EInjectResult::Success
+          : EInjectResult::ErrorUnsetFailed;
+      completePhase(Tracing::EInjectPhase::Cleanup, operationResult);
+
+      return operationResult;
+    }
+  } // namespace Wow64Injector
+} // namespace Hookshot
+
+#endif
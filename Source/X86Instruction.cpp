@@ -11,10 +11,13 @@
 
 #include "X86Instruction.h"
 
+#include <array>
 #include <climits>
 #include <cstddef>
 #include <cstdint>
 #include <cstdlib>
+#include <cstring>
+#include <mutex>
 
 extern "C"
 {
@@ -40,11 +43,28 @@ namespace Hookshot
 
   /// Comparison value used to determine if a byte is a REX prefix of any form.
   static constexpr uint8_t kRexPrefixCompareValue = 0x40;
+
+  /// REX prefix that specifies only a 64-bit operand size.
+  static constexpr uint8_t kRexWPrefix = 0x48;
 #endif
 
   /// Opcode for a nop instruction.
   static constexpr uint8_t kNopInstructionOpcode = 0x90;
 
+  /// Opcode for an int 3 instruction.
+  static constexpr uint8_t kInt3InstructionOpcode = 0xcc;
+
+  /// Opcode for an unconditional jump instruction with an 8-bit relative displacement.
+  static constexpr uint8_t kShortJumpInstructionOpcode = 0xeb;
+
+  /// Opcode and ModRM byte for an unconditional indirect jump through a pointer in memory whose
+  /// location is given by a 32-bit displacement.
+  static constexpr uint8_t kIndirectJumpInstructionPreamble[] = {0xff, 0x25};
+
+  /// Smallest possible page size, in bytes. Used to determine whether two addresses are definitely
+  /// located in the same page without having to query the system.
+  static constexpr size_t kMinPageSizeBytes = 4096;
+
   /// Tests if the specified byte could be a REX prefix or not.
   /// @param byte Byte to test.
   /// @return `true` if it is a REX prefix, `false` if not.
@@ -109,6 +129,17 @@ namespace Hookshot
     return kReferenceDoesNotExist;
   }
 
+  void X86Instruction::Initialize(void)
+  {
+    static std::once_flag initializeFlag;
+    std::call_once(
+        initializeFlag,
+        []() -> void
+        {
+          xed_tables_init();
+        });
+  }
+
   bool X86Instruction::CanWriteJumpInstruction(const void* const from, const void* const to)
   {
     const int64_t displacement = reinterpret_cast<int64_t>(to) -
@@ -116,6 +147,452 @@ namespace Hookshot
     return (displacement <= INT32_MAX && displacement >= INT32_MIN);
   }
 
+  /// Prefix byte that overrides the operand size.
+  static constexpr uint8_t kOperandSizePrefix = 0x66;
+
+  /// Escape byte that introduces a two-byte opcode.
+  static constexpr uint8_t kTwoByteOpcodeEscape = 0x0f;
+
+  /// Flags that describe how an opcode is encoded, which is enough to determine the layout of an
+  /// instruction without decoding it. Opcodes with no flags are not recognized.
+  enum EOpcodeFlag : uint16_t
+  {
+    /// Opcode is recognized.
+    kOpcodeRecognized = 1 << 0,
+
+    /// Opcode is followed by a ModRM byte.
+    kOpcodeHasModrm = 1 << 1,
+
+    /// ModRM byte must specify a memory operand.
+    kOpcodeModrmMemoryOnly = 1 << 2,
+
+    /// ModRM byte must have 0 in its reg field, which is an opcode extension.
+    kOpcodeModrmRegZeroOnly = 1 << 3,
+
+    /// ModRM reg field selects among the group 5 instructions, of which only indirect call,
+    /// indirect jump, and push are recognized.
+    kOpcodeModrmGroup5 = 1 << 4,
+
+    /// Instruction ends with an 8-bit immediate.
+    kOpcodeHasImm8 = 1 << 5,
+
+    /// Instruction ends with a 16-bit immediate.
+    kOpcodeHasImm16 = 1 << 6,
+
+    /// Instruction ends with a 32-bit immediate, whose size an operand size override would change.
+    kOpcodeHasImm32 = 1 << 7,
+
+    /// Instruction ends with an 8-bit relative branch displacement.
+    kOpcodeHasRel8 = 1 << 8,
+
+    /// Instruction ends with a 32-bit relative branch displacement, whose size an operand size
+    /// override would change.
+    kOpcodeHasRel32 = 1 << 9,
+
+    /// Instruction marks the end of a control flow.
+    kOpcodeIsTerminal = 1 << 10,
+  };
+
+  /// Opcode flags that make an operand size override prefix unacceptable, either because it
+  /// changes the length of the instruction or because it changes how control flow is affected.
+  static constexpr uint16_t kOpcodeFlagsIncompatibleWithOperandSizePrefix = kOpcodeModrmGroup5 |
+      kOpcodeHasImm32 | kOpcodeHasRel8 | kOpcodeHasRel32 | kOpcodeIsTerminal;
+
+  /// Encoding flags for each one-byte opcode.
+  static constexpr std::array<uint16_t, 256> kOneByteOpcodeFlags = []() constexpr
+  {
+    std::array<uint16_t, 256> opcodeFlags{};
+
+    // add, or, and, sub, xor, cmp between registers and memory
+    for (uint8_t opcodeBase : {0x00, 0x08, 0x20, 0x28, 0x30, 0x38})
+    {
+      for (uint8_t i = 0; i < 4; ++i)
+        opcodeFlags[opcodeBase + i] = kOpcodeRecognized | kOpcodeHasModrm;
+    }
+
+    // push r, pop r
+    for (uint8_t opcode = 0x50; opcode <= 0x5f; ++opcode)
+      opcodeFlags[opcode] = kOpcodeRecognized;
+
+    // push imm32, push imm8
+    opcodeFlags[0x68] = kOpcodeRecognized | kOpcodeHasImm32;
+    opcodeFlags[0x6a] = kOpcodeRecognized | kOpcodeHasImm8;
+
+    // jcc rel8
+    for (uint8_t opcode = 0x70; opcode <= 0x7f; ++opcode)
+      opcodeFlags[opcode] = kOpcodeRecognized | kOpcodeHasRel8;
+
+    // group 1 arithmetic with an immediate
+    opcodeFlags[0x80] = kOpcodeRecognized | kOpcodeHasModrm | kOpcodeHasImm8;
+    opcodeFlags[0x81] = kOpcodeRecognized | kOpcodeHasModrm | kOpcodeHasImm32;
+    opcodeFlags[0x83] = kOpcodeRecognized | kOpcodeHasModrm | kOpcodeHasImm8;
+
+    // test, mov between registers and memory
+    for (uint8_t opcode : {0x84, 0x85, 0x88, 0x89, 0x8a, 0x8b})
+      opcodeFlags[opcode] = kOpcodeRecognized | kOpcodeHasModrm;
+
+    // lea
+    opcodeFlags[0x8d] = kOpcodeRecognized | kOpcodeHasModrm | kOpcodeModrmMemoryOnly;
+
+    // nop
+    opcodeFlags[0x90] = kOpcodeRecognized;
+
+    // ret imm16, ret
+    opcodeFlags[0xc2] = kOpcodeRecognized | kOpcodeHasImm16 | kOpcodeIsTerminal;
+    opcodeFlags[0xc3] = kOpcodeRecognized | kOpcodeIsTerminal;
+
+    // mov r/m, imm
+    opcodeFlags[0xc6] =
+        kOpcodeRecognized | kOpcodeHasModrm | kOpcodeModrmRegZeroOnly | kOpcodeHasImm8;
+    opcodeFlags[0xc7] =
+        kOpcodeRecognized | kOpcodeHasModrm | kOpcodeModrmRegZeroOnly | kOpcodeHasImm32;
+
+    // call rel32, jmp rel32, jmp rel8
+    opcodeFlags[0xe8] = kOpcodeRecognized | kOpcodeHasRel32;
+    opcodeFlags[0xe9] = kOpcodeRecognized | kOpcodeHasRel32 | kOpcodeIsTerminal;
+    opcodeFlags[0xeb] = kOpcodeRecognized | kOpcodeHasRel8 | kOpcodeIsTerminal;
+
+    // group 5
+    opcodeFlags[0xff] = kOpcodeRecognized | kOpcodeHasModrm | kOpcodeModrmGroup5;
+
+    return opcodeFlags;
+  }();
+
+  /// Encoding flags for each two-byte opcode, indexed by the byte that follows the escape byte.
+  static constexpr std::array<uint16_t, 256> kTwoByteOpcodeFlags = []() constexpr
+  {
+    std::array<uint16_t, 256> opcodeFlags{};
+
+    // movups, movaps, and their double-precision equivalents with an operand size override
+    for (uint8_t opcode : {0x10, 0x11, 0x28, 0x29})
+      opcodeFlags[opcode] = kOpcodeRecognized | kOpcodeHasModrm;
+
+    // multi-byte nop
+    opcodeFlags[0x1f] = kOpcodeRecognized | kOpcodeHasModrm | kOpcodeModrmRegZeroOnly;
+
+    // jcc rel32
+    for (uint8_t opcode = 0x80; opcode <= 0x8f; ++opcode)
+      opcodeFlags[opcode] = kOpcodeRecognized | kOpcodeHasRel32;
+
+    // movzx, movsx
+    for (uint8_t opcode : {0xb6, 0xb7, 0xbe, 0xbf})
+      opcodeFlags[opcode] = kOpcodeRecognized | kOpcodeHasModrm;
+
+    return opcodeFlags;
+  }();
+
+  /// Computes the number of bytes occupied by a ModRM byte along with whatever SIB byte and
+  /// displacement follow it.
+  /// @param [in] modrmBytes Address of the ModRM byte.
+  /// @param [out] isPositionDependent Set to whether or not the effective address depends on the
+  /// position of the instruction, in which case the displacement immediately follows the ModRM
+  /// byte and is 32 bits wide.
+  /// @return Number of bytes, including the ModRM byte itself.
+  static int ModrmLengthBytes(const uint8_t* const modrmBytes, bool* const isPositionDependent)
+  {
+    const uint8_t mod = (modrmBytes[0] >> 6);
+    const uint8_t rm = (modrmBytes[0] & 0x07);
+
+    *isPositionDependent = false;
+    if (0b11 == mod) return 1;
+
+    int lengthBytes = 1;
+
+    if (0b100 == rm)
+    {
+      // A SIB byte follows. If it specifies no base register, a 32-bit displacement follows it,
+      // which is an absolute address rather than a position-dependent one.
+      lengthBytes += 1;
+      if ((0b00 == mod) && (0b101 == (modrmBytes[1] & 0x07))) lengthBytes += sizeof(int32_t);
+    }
+    else if ((0b00 == mod) && (0b101 == rm))
+    {
+      // RIP-relative addressing in 64-bit mode, an absolute 32-bit displacement otherwise.
+#ifdef _WIN64
+      *isPositionDependent = true;
+#endif
+      lengthBytes += sizeof(int32_t);
+    }
+
+    if (0b01 == mod)
+      lengthBytes += sizeof(int8_t);
+    else if (0b10 == mod)
+      lengthBytes += sizeof(int32_t);
+
+    return lengthBytes;
+  }
+
+  bool X86Instruction::ClassifyCommonInstruction(
+      const void* const instruction, SInstructionLayout* const layout)
+  {
+    const uint8_t* const instructionBytes = reinterpret_cast<const uint8_t*>(instruction);
+    int position = 0;
+
+    const bool hasOperandSizePrefix = (kOperandSizePrefix == instructionBytes[position]);
+    if (true == hasOperandSizePrefix) position += 1;
+
+    // A REX prefix, if present, must come immediately before the opcode.
+    if (true == CouldBeRexPrefix(instructionBytes[position])) position += 1;
+
+    const uint8_t opcode = instructionBytes[position];
+    uint16_t opcodeFlags = kOneByteOpcodeFlags[opcode];
+    if (kTwoByteOpcodeEscape == opcode)
+    {
+      position += 1;
+      opcodeFlags = kTwoByteOpcodeFlags[instructionBytes[position]];
+    }
+    position += 1;
+
+    if (0 == (opcodeFlags & kOpcodeRecognized)) return false;
+    if ((true == hasOperandSizePrefix) &&
+        (0 != (opcodeFlags & kOpcodeFlagsIncompatibleWithOperandSizePrefix)))
+      return false;
+
+    SInstructionLayout instructionLayout = {
+        .lengthBytes = 0,
+        .displacementOffsetBytes = 0,
+        .displacementWidthBytes = 0,
+        .isRelativeBranch = false,
+        .isTerminal = (0 != (opcodeFlags & kOpcodeIsTerminal))};
+
+    if (0 != (opcodeFlags & kOpcodeHasModrm))
+    {
+      const uint8_t modrm = instructionBytes[position];
+      const uint8_t mod = (modrm >> 6);
+      const uint8_t reg = ((modrm >> 3) & 0x07);
+
+      if ((0 != (opcodeFlags & kOpcodeModrmMemoryOnly)) && (0b11 == mod)) return false;
+      if ((0 != (opcodeFlags & kOpcodeModrmRegZeroOnly)) && (0 != reg)) return false;
+
+      if (0 != (opcodeFlags & kOpcodeModrmGroup5))
+      {
+        switch (reg)
+        {
+          case 2: // call r/m
+          case 6: // push r/m
+            break;
+
+          case 4: // jmp r/m
+            instructionLayout.isTerminal = true;
+            break;
+
+          default:
+            return false;
+        }
+      }
+
+      bool isPositionDependent = false;
+      const int modrmLengthBytes =
+          ModrmLengthBytes(&instructionBytes[position], &isPositionDependent);
+      if (true == isPositionDependent)
+      {
+        instructionLayout.displacementOffsetBytes = static_cast<uint8_t>(position + 1);
+        instructionLayout.displacementWidthBytes = sizeof(int32_t);
+      }
+
+      position += modrmLengthBytes;
+    }
+
+    if (0 != (opcodeFlags & kOpcodeHasImm8)) position += sizeof(int8_t);
+    if (0 != (opcodeFlags & kOpcodeHasImm16)) position += sizeof(int16_t);
+    if (0 != (opcodeFlags & kOpcodeHasImm32)) position += sizeof(int32_t);
+
+    if (0 != (opcodeFlags & (kOpcodeHasRel8 | kOpcodeHasRel32)))
+    {
+      const int relativeBranchWidthBytes =
+          ((0 != (opcodeFlags & kOpcodeHasRel8)) ? sizeof(int8_t) : sizeof(int32_t));
+      instructionLayout.displacementOffsetBytes = static_cast<uint8_t>(position);
+      instructionLayout.displacementWidthBytes = static_cast<uint8_t>(relativeBranchWidthBytes);
+      instructionLayout.isRelativeBranch = true;
+      position += relativeBranchWidthBytes;
+    }
+
+    if (position > kMaxInstructionLengthBytes) return false;
+
+    instructionLayout.lengthBytes = static_cast<uint8_t>(position);
+    *layout = instructionLayout;
+    return true;
+  }
+
+  void* X86Instruction::GetJumpThunkTarget(const void* const func)
+  {
+    const uint8_t* const funcBytes = reinterpret_cast<const uint8_t*>(func);
+
+    switch (funcBytes[0])
+    {
+      case kShortJumpInstructionOpcode:
+        return const_cast<uint8_t*>(
+            &funcBytes[2 + static_cast<ptrdiff_t>(static_cast<int8_t>(funcBytes[1]))]);
+
+      case kJumpInstructionPreamble[0]:
+      {
+        int32_t displacement = 0;
+        std::memcpy(&displacement, &funcBytes[1], sizeof(displacement));
+        return const_cast<uint8_t*>(
+            &funcBytes[kJumpInstructionLengthBytes + static_cast<ptrdiff_t>(displacement)]);
+      }
+
+      default:
+        break;
+    }
+
+    // Indirect jumps are sometimes encoded with a redundant REX.W prefix in 64-bit mode.
+    size_t position = 0;
+#ifdef _WIN64
+    if (kRexWPrefix == funcBytes[position]) position += 1;
+#endif
+    if (0 !=
+        std::memcmp(
+            &funcBytes[position],
+            kIndirectJumpInstructionPreamble,
+            sizeof(kIndirectJumpInstructionPreamble)))
+      return nullptr;
+    position += sizeof(kIndirectJumpInstructionPreamble);
+
+    int32_t displacement = 0;
+    std::memcpy(&displacement, &funcBytes[position], sizeof(displacement));
+    position += sizeof(displacement);
+
+#ifdef _WIN64
+    const void* const pointerLocation =
+        &funcBytes[position + static_cast<ptrdiff_t>(displacement)];
+#else
+    const void* const pointerLocation =
+        reinterpret_cast<const void*>(static_cast<size_t>(static_cast<uint32_t>(displacement)));
+#endif
+
+    void* target = nullptr;
+    std::memcpy(&target, pointerLocation, sizeof(target));
+    return target;
+  }
+
+  bool X86Instruction::IsHotPatchable(const void* const func)
+  {
+#ifdef _WIN64
+    // In 64-bit mode, `mov edi, edi` clears the upper half of a register, and hot-patching uses a
+    // different layout anyway.
+    return false;
+#else
+    if ((reinterpret_cast<size_t>(func) % kMinPageSizeBytes) <
+        static_cast<size_t>(kHotPatchPaddingLengthBytes))
+      return false;
+
+    const uint8_t* const funcBytes = reinterpret_cast<const uint8_t*>(func);
+    if (0 != std::memcmp(funcBytes, kHotPatchEntryInstruction, sizeof(kHotPatchEntryInstruction)))
+      return false;
+
+    const uint8_t* const paddingBytes = &funcBytes[-kHotPatchPaddingLengthBytes];
+
+    bool isPadding = true;
+    for (int i = 0; i < kHotPatchPaddingLengthBytes; ++i)
+    {
+      if ((kInt3InstructionOpcode != paddingBytes[i]) && (kNopInstructionOpcode != paddingBytes[i]))
+      {
+        isPadding = false;
+        break;
+      }
+    }
+
+    if (true == isPadding) return true;
+
+    // A jump whose displacement is exactly the length of the entry point instruction targets the
+    // instruction right after it.
+    const int32_t leftoverJumpDisplacement = kHotPatchEntryLengthBytes;
+    return (
+        (0 ==
+         std::memcmp(paddingBytes, kJumpInstructionPreamble, sizeof(kJumpInstructionPreamble))) &&
+        (0 ==
+         std::memcmp(
+             &paddingBytes[sizeof(kJumpInstructionPreamble)],
+             &leftoverJumpDisplacement,
+             sizeof(leftoverJumpDisplacement))));
+#endif
+  }
+
+  bool X86Instruction::DecodeSyscallStub(const void* const func, SSyscallStub* const stub)
+  {
+#ifdef _WIN64
+    const uint8_t* const funcBytes = reinterpret_cast<const uint8_t*>(func);
+
+    // Both forms are identical up to the system call number, which is checked first so that most
+    // functions that are not stubs are rejected after reading just a few bytes.
+    if (0 != std::memcmp(funcBytes, kSyscallStubTemplate, kSyscallStubNumberOffsetBytes))
+      return false;
+
+    uint32_t syscallNumber = 0;
+    std::memcpy(&syscallNumber, &funcBytes[kSyscallStubNumberOffsetBytes], sizeof(syscallNumber));
+
+    const uint8_t* const funcBytesAfterPrologue = &funcBytes[kSyscallStubPrologueLengthBytes];
+
+    // Stubs are aligned such that they never cross a page boundary, so the longer form is only
+    // considered if it would not either.
+    const bool longFormFitsInPage =
+        ((kMinPageSizeBytes - (reinterpret_cast<size_t>(func) % kMinPageSizeBytes)) >=
+         sizeof(kSyscallStubTemplate));
+
+    if ((true == longFormFitsInPage) &&
+        (0 ==
+         std::memcmp(
+             funcBytesAfterPrologue,
+             &kSyscallStubTemplate[kSyscallStubPrologueLengthBytes],
+             sizeof(kSyscallStubTemplate) - kSyscallStubPrologueLengthBytes)))
+    {
+      *stub = {
+          .syscallNumber = syscallNumber,
+          .lengthBytes = static_cast<int>(sizeof(kSyscallStubTemplate))};
+      return true;
+    }
+
+    if (0 ==
+        std::memcmp(
+            funcBytesAfterPrologue,
+            &kSyscallStubShortTemplate[kSyscallStubPrologueLengthBytes],
+            sizeof(kSyscallStubShortTemplate) - kSyscallStubPrologueLengthBytes))
+    {
+      *stub = {
+          .syscallNumber = syscallNumber,
+          .lengthBytes = static_cast<int>(sizeof(kSyscallStubShortTemplate))};
+      return true;
+    }
+
+    return false;
+#else
+    // In 32-bit mode, system call stubs transfer control through an address that differs between
+    // WOW64 and native 32-bit systems, so they are left to the decoder.
+    return false;
+#endif
+  }
+
+  int X86Instruction::WriteSyscallStub(
+      void* const where, const int whereSizeBytes, const SSyscallStub& stub)
+  {
+    const uint8_t* stubTemplate = nullptr;
+    switch (stub.lengthBytes)
+    {
+      case sizeof(kSyscallStubTemplate):
+        stubTemplate = kSyscallStubTemplate;
+        break;
+
+      case sizeof(kSyscallStubShortTemplate):
+        stubTemplate = kSyscallStubShortTemplate;
+        break;
+
+      default:
+        return 0;
+    }
+
+    if (whereSizeBytes < stub.lengthBytes) return 0;
+
+    uint8_t* const whereBytes = reinterpret_cast<uint8_t*>(where);
+    std::memcpy(whereBytes, stubTemplate, stub.lengthBytes);
+    std::memcpy(
+        &whereBytes[kSyscallStubNumberOffsetBytes],
+        &stub.syscallNumber,
+        sizeof(stub.syscallNumber));
+
+    return stub.lengthBytes;
+  }
+
   void X86Instruction::FillWithNop(void* const buf, const size_t numBytes)
   {
     uint8_t* const bufBytes = reinterpret_cast<uint8_t*>(buf);
@@ -143,6 +620,22 @@ namespace Hookshot
     return true;
   }
 
+#ifdef _WIN64
+  bool X86Instruction::WriteAbsoluteJumpInstruction(
+      void* const where, const int whereSizeBytes, const void* const to)
+  {
+    if (whereSizeBytes < kAbsoluteJumpInstructionLengthBytes) return false;
+
+    uint8_t* const whereBytes = reinterpret_cast<uint8_t*>(where);
+    const uint64_t target = reinterpret_cast<uint64_t>(to);
+
+    std::memcpy(
+        &whereBytes[0], kAbsoluteJumpInstructionPreamble, sizeof(kAbsoluteJumpInstructionPreamble));
+    std::memcpy(&whereBytes[sizeof(kAbsoluteJumpInstructionPreamble)], &target, sizeof(target));
+    return true;
+  }
+#endif
+
   bool X86Instruction::CanSetMemoryDisplacementTo(const int64_t displacement) const
   {
     if (false == valid) return false;
@@ -157,6 +650,8 @@ namespace Hookshot
 
   bool X86Instruction::DecodeInstruction(const void* instruction, const int maxLengthBytes)
   {
+    Initialize();
+
     xed_decoded_inst_zero_set_mode(&decodedInstruction, &kXedMachineState);
 
     if (XED_ERROR_NONE !=
@@ -241,6 +736,98 @@ namespace Hookshot
     return static_cast<int>(encodedLength);
   }
 
+#ifdef _WIN64
+  int X86Instruction::EncodeWithAbsoluteMemoryReference(
+      void* const buf, const int maxLengthBytes, const void* const addressSlot) const
+  {
+    const int memoryOperandIndex = positionDependentMemoryReference.GetOperandLocation();
+    if ((false == valid) || (memoryOperandIndex < 0)) return 0;
+
+    // The destination register of the instruction is used to hold the absolute target address until
+    // the instruction overwrites it with its result, so nothing else is modified and the stack
+    // pointer never moves. That requires the first operand to be a general-purpose register that
+    // is written without being read, either by the instruction itself or through any other operand.
+    // Only writes of at least 32 bits qualify, because narrower writes preserve the rest of the
+    // register.
+    const xed_inst_t* const instruction = xed_decoded_inst_inst(&decodedInstruction);
+    const unsigned int numOperands = xed_inst_noperands(instruction);
+    if (0 == numOperands) return 0;
+
+    const xed_operand_enum_t destinationOperandName =
+        xed_operand_name(xed_inst_operand(instruction, 0));
+    if ((0 == xed_operand_is_register(destinationOperandName)) ||
+        (XED_OPERAND_ACTION_W != xed_decoded_inst_operand_action(&decodedInstruction, 0)))
+      return 0;
+
+    const xed_reg_enum_t destinationRegister =
+        xed_decoded_inst_get_reg(&decodedInstruction, destinationOperandName);
+    const xed_reg_enum_t scratchRegister = xed_get_largest_enclosing_register(destinationRegister);
+    if ((scratchRegister < XED_REG_GPR64_FIRST) || (scratchRegister > XED_REG_GPR64_LAST) ||
+        (XED_REG_RSP == scratchRegister) ||
+        (xed_get_register_width_bits64(destinationRegister) < 32))
+      return 0;
+
+    for (unsigned int i = 1; i < numOperands; ++i)
+    {
+      const xed_operand_enum_t operandName = xed_operand_name(xed_inst_operand(instruction, i));
+      if ((0 != xed_operand_is_register(operandName)) &&
+          (scratchRegister ==
+           xed_get_largest_enclosing_register(
+               xed_decoded_inst_get_reg(&decodedInstruction, operandName))))
+        return 0;
+    }
+
+    const int scratchRegisterNumber = static_cast<int>(scratchRegister - XED_REG_GPR64_FIRST);
+    const bool isScratchRegisterExtended = (scratchRegisterNumber >= 8);
+    const uint8_t scratchRegisterLowBits = static_cast<uint8_t>(scratchRegisterNumber & 7);
+
+    uint8_t sequence[kMaxAbsoluteMemoryReferenceSequenceLengthBytes] = {};
+    int sequenceLengthBytes = 0;
+
+    // mov scratch, qword ptr [rip+disp32]
+    sequence[sequenceLengthBytes++] =
+        static_cast<uint8_t>(kRexWPrefix | ((true == isScratchRegisterExtended) ? 0x04 : 0x00));
+    sequence[sequenceLengthBytes++] = 0x8b;
+    sequence[sequenceLengthBytes++] = static_cast<uint8_t>(0x05 | (scratchRegisterLowBits << 3));
+
+    const int64_t addressSlotDisplacement = reinterpret_cast<int64_t>(addressSlot) -
+        (reinterpret_cast<int64_t>(buf) + static_cast<int64_t>(sequenceLengthBytes) +
+         static_cast<int64_t>(sizeof(int32_t)));
+    if ((addressSlotDisplacement > INT32_MAX) || (addressSlotDisplacement < INT32_MIN)) return 0;
+
+    const int32_t addressSlotDisplacement32 = static_cast<int32_t>(addressSlotDisplacement);
+    std::memcpy(
+        &sequence[sequenceLengthBytes],
+        &addressSlotDisplacement32,
+        sizeof(addressSlotDisplacement32));
+    sequenceLengthBytes += static_cast<int>(sizeof(addressSlotDisplacement32));
+
+    // The instruction itself, with its memory operand now based on its destination register.
+    xed_encoder_request_t toEncode = decodedInstruction;
+    xed_encoder_request_init_from_decode(&toEncode);
+    if (0 == memoryOperandIndex)
+      xed_encoder_request_set_base0(&toEncode, scratchRegister);
+    else
+      xed_encoder_request_set_base1(&toEncode, scratchRegister);
+    xed_encoder_request_set_memory_displacement(&toEncode, 0, 1);
+
+    unsigned int encodedLength = 0;
+    if (XED_ERROR_NONE !=
+        xed_encode(
+            &toEncode,
+            &sequence[sequenceLengthBytes],
+            static_cast<unsigned int>(kMaxInstructionLengthBytes),
+            &encodedLength))
+      return 0;
+    sequenceLengthBytes += static_cast<int>(encodedLength);
+
+    if (sequenceLengthBytes > maxLengthBytes) return 0;
+
+    std::memcpy(buf, sequence, static_cast<size_t>(sequenceLengthBytes));
+    return sequenceLengthBytes;
+  }
+#endif
+
   void* X86Instruction::GetAbsoluteMemoryReferenceTarget(void) const
   {
     const int64_t displacement = GetMemoryDisplacement();
@@ -285,6 +872,18 @@ namespace Hookshot
     }
   }
 
+  int X86Instruction::GetMemoryDisplacementOffsetBytes(void) const
+  {
+    const int memoryDisplacementWidthBits = GetMemoryDisplacementWidthBits();
+    if (0 == memoryDisplacementWidthBits) return -1;
+
+    // Displacements are encoded immediately before any immediate operand, which is always the last
+    // part of an instruction.
+    return GetLengthBytes() -
+        static_cast<int>(xed_decoded_inst_get_immediate_width(&decodedInstruction)) -
+        (memoryDisplacementWidthBits / 8);
+  }
+
   int X86Instruction::GetMemoryDisplacementWidthBits(void) const
   {
     if (false == valid) return 0;